@@ -114,6 +114,22 @@ xmlSecAppCryptoSimpleKeysMngrCrlLoad(xmlSecKeysMngrPtr mngr, const char *filenam
 #endif /* XMLSEC_NO_X509 */
 }
 
+int
+xmlSecAppCryptoSimpleKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize) {
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+#ifndef XMLSEC_NO_X509
+
+    return(xmlSecCryptoAppKeysMngrEnableX509VerifyCache(mngr, maxSize));
+
+#else /* XMLSEC_NO_X509 */
+
+    fprintf(stderr, "Error: X509 support is disabled\n");
+    return(-1);
+#endif /* XMLSEC_NO_X509 */
+}
+
 int
 xmlSecAppCryptoSimpleKeysMngrKeyAndCertsLoad(xmlSecKeysMngrPtr mngr,
     const char* files, const char* pwd, const char* name,
@@ -45,6 +45,8 @@ int     xmlSecAppCryptoSimpleKeysMngrCertLoad                   (xmlSecKeysMngrP
 int     xmlSecAppCryptoSimpleKeysMngrCrlLoad                    (xmlSecKeysMngrPtr mngr,
                                                                  const char* filename,
                                                                  xmlSecKeyDataFormat format);
+int     xmlSecAppCryptoSimpleKeysMngrEnableX509VerifyCache      (xmlSecKeysMngrPtr mngr,
+                                                                 xmlSecSize maxSize);
 int     xmlSecAppCryptoSimpleKeysMngrKeyAndCertsLoad            (xmlSecKeysMngrPtr mngr,
                                                                  const char* files,
                                                                  const char* pwd,
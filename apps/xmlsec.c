@@ -5,6 +5,11 @@
  *
  * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
  */
+/* clock_gettime() for the benchmark and pthreads for the server mode */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif /* !defined(_WIN32) && !defined(_POSIX_C_SOURCE) */
+
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -23,6 +28,7 @@
 #include <libxml/parser.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/threads.h>
 
 #ifndef XMLSEC_NO_XSLT
 #include <libxslt/xslt.h>
@@ -40,6 +46,8 @@
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/io.h>
 #include <xmlsec/transforms.h>
+#include <xmlsec/membuf.h>
+#include <xmlsec/executor.h>
 #include <xmlsec/xmldsig.h>
 #include <xmlsec/xmlenc.h>
 #include <xmlsec/parser.h>
@@ -49,11 +57,36 @@
 #include "crypto.h"
 #include "cmdline.h"
 
+#ifndef UNREFERENCED_PARAMETER
+#define UNREFERENCED_PARAMETER(param)   ((void)(param))
+#endif /* UNREFERENCED_PARAMETER */
+
 
 #if defined(_MSC_VER) && defined(_CRTDBG_MAP_ALLOC)
 #include <crtdbg.h>
 #endif /*defined(_MSC_VER) && defined(_CRTDBG_MAP_ALLOC) */
 
+#if defined(XMLSEC_WINDOWS)
+#include <windows.h>
+#elif defined(XMLSEC_APP_HAVE_PTHREAD)
+#include <pthread.h>
+#endif /* defined(XMLSEC_WINDOWS) */
+
+/* UNIX sockets server */
+#if defined(XMLSEC_APP_HAVE_PTHREAD) && !defined(XMLSEC_WINDOWS)
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#define XMLSEC_APP_SERVE        1
+#endif /* defined(XMLSEC_APP_HAVE_PTHREAD) && !defined(XMLSEC_WINDOWS) */
+
+/* peak memory usage for benchmarks */
+#if !defined(XMLSEC_WINDOWS)
+#include <sys/resource.h>
+#endif /* !defined(XMLSEC_WINDOWS) */
+
 static const char copyright[] =
     "Written by Aleksey Sanin <aleksey@aleksey.com>.\n\n"
     "Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved..\n"
@@ -85,6 +118,7 @@ static const char helpCommands2[] =
     "  --encrypt   "    "\tencrypt data and output XML document\n"
     "  --decrypt   "    "\tdecrypt data from XML document\n"
 #endif /* XMLSEC_NO_XMLENC */
+    "  --serve     "    "\tserve sign/verify/encrypt/decrypt requests on a UNIX socket\n"
     ;
 
 static const char helpVersion[] =
@@ -120,6 +154,17 @@ static const char helpDecrypt[] =
     "Usage: xmlsec decrypt [<options>] <file>\n"
     "Decrypts XML Encryption data in the <file>\n";
 
+static const char helpServe[] =
+    "Usage: xmlsec serve [<options>] <socket>\n"
+    "Listens on the UNIX socket <socket> and processes the requests with\n"
+    "the keys loaded once (reloaded on SIGHUP). Each request is a line\n"
+    "\"<op> <size>\\n\" followed by <size> bytes of the XML document, where\n"
+    "<op> is \"sign\", \"verify\", \"encrypt\" or \"decrypt\"; the \"encrypt\"\n"
+    "request is \"encrypt <size> <data size>\\n\" followed by the template\n"
+    "and the binary data to encrypt. Each response is a line\n"
+    "\"<status> <size>\\n\" followed by <size> bytes of the result (\"OK\"),\n"
+    "the failure reason (\"FAILED\") or the error message (\"ERROR\").\n";
+
 static const char helpListKeyData[] =
     "Usage: xmlsec list-key-data\n"
     "Prints the list of known key data klasses\n";
@@ -143,7 +188,7 @@ static const char helpCheckTransforms[] =
 #define xmlSecAppCmdLineTopicEncCommon          0x0010
 #define xmlSecAppCmdLineTopicEncEncrypt         0x0020
 #define xmlSecAppCmdLineTopicEncDecrypt         0x0040
-/* #define UNUSED         0x0080 */
+#define xmlSecAppCmdLineTopicServe              0x0080
 #define xmlSecAppCmdLineTopicKeysMngr           0x1000
 #define xmlSecAppCmdLineTopicX509Certs          0x2000
 #define xmlSecAppCmdLineTopicVersion            0x4000
@@ -201,6 +246,67 @@ static xmlSecAppCmdLineParam repeatParam = {
     NULL
 };
 
+static xmlSecAppCmdLineParam benchParam = {
+    xmlSecAppCmdLineTopicCryptoConfig,
+    "--bench",
+    NULL,
+    "--bench <number>"
+    "\n\tbenchmark the operation: run it <number> times and print"
+    "\n\tthe wall clock latency percentiles, ops/sec and peak memory usage",
+    xmlSecAppCmdLineParamTypeNumber,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam benchWarmupParam = {
+    xmlSecAppCmdLineTopicCryptoConfig,
+    "--bench-warmup",
+    NULL,
+    "--bench-warmup <number>"
+    "\n\trun the operation <number> times before the measured"
+    "\n\t\"--bench\" runs (default: 1)",
+    xmlSecAppCmdLineParamTypeNumber,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam benchPhasesParam = {
+    xmlSecAppCmdLineTopicCryptoConfig,
+    "--bench-phases",
+    NULL,
+    "--bench-phases"
+    "\n\tprint the \"--bench\" time breakdown by phase (parse, key"
+    "\n\tresolution, references, signature or encryption)",
+    xmlSecAppCmdLineParamTypeFlag,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam benchJsonParam = {
+    xmlSecAppCmdLineTopicCryptoConfig,
+    "--bench-json",
+    NULL,
+    "--bench-json <file>"
+    "\n\twrite the \"--bench\" results in JSON format to <file>"
+    "\n\t(use \"-\" for stdout)",
+    xmlSecAppCmdLineParamTypeString,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam threadsParam = {
+    xmlSecAppCmdLineTopicDSigVerify |
+    xmlSecAppCmdLineTopicServe,
+    "--threads",
+    NULL,
+    "--threads <number>"
+    "\n\tverify the \"--batch\" files or serve the requests with"
+    "\n\t<number> worker threads (default: 1)",
+    xmlSecAppCmdLineParamTypeNumber,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
 static xmlSecAppCmdLineParam transformBinChunkSizeParam = {
     xmlSecAppCmdLineTopicCryptoConfig,
     "--transform-binary-chunk-size",
@@ -214,6 +320,44 @@ static xmlSecAppCmdLineParam transformBinChunkSizeParam = {
     NULL
 };
 
+static xmlSecAppCmdLineParam transformBinChunkSizeAdaptiveParam = {
+    xmlSecAppCmdLineTopicCryptoConfig,
+    "--transform-binary-chunk-size-adaptive",
+    NULL,
+    "--transform-binary-chunk-size-adaptive"
+    "\n\tpicks the transforms binary processing chunk size from the"
+    "\n\tinput size (if known) for each transforms chain; the"
+    "\n\t\"--transform-binary-chunk-size\" option sets the maximum",
+    xmlSecAppCmdLineParamTypeFlag,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam transformStatsParam = {
+    xmlSecAppCmdLineTopicCryptoConfig,
+    "--transform-stats",
+    NULL,
+    "--transform-stats"
+    "\n\tcollects the calls, bytes and buffers statistics for each"
+    "\n\ttransform (printed with \"--print-debug\" option)",
+    xmlSecAppCmdLineParamTypeFlag,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam memBufSpillSizeParam = {
+    xmlSecAppCmdLineTopicCryptoConfig,
+    "--membuf-spill-size",
+    NULL,
+    "--membuf-spill-size <size>"
+    "\n\tmoves the stored results (e.g. the decrypted data) larger than"
+    "\n\t<size> bytes to a temporary file in TMPDIR instead of keeping"
+    "\n\tthem in memory",
+    xmlSecAppCmdLineParamTypeNumber,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
 static xmlSecAppCmdLineParam verboseParam = {
     xmlSecAppCmdLineTopicGeneral,
     "--verbose",
@@ -748,6 +892,75 @@ static xmlSecAppCmdLineParam enableVisa3DHackParam = {
     NULL
 };
 
+static xmlSecAppCmdLineParam libxml2C14NParam = {
+    xmlSecAppCmdLineTopicDSigCommon,
+    "--libxml2-c14n",
+    NULL,
+    "--libxml2-c14n"
+    "\n\tuse the libxml2 C14N serializer instead of the xmlsec one",
+    xmlSecAppCmdLineParamTypeFlag,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+/****************************************************************
+ *
+ * Verify dsig params
+ *
+ ***************************************************************/
+static xmlSecAppCmdLineParam streamTemplateParam = {
+    xmlSecAppCmdLineTopicDSigSign,
+    "--stream-template",
+    NULL,
+    "--stream-template <file>"
+    "\n\tsign the whole input document without loading it with the"
+    "\n\tenveloped signature template from <file> (one reference with"
+    "\n\tURI=\"\" and the enveloped signature and c14n transforms only);"
+    "\n\tthe signature is added as the last child of the document element"
+    "\n\tand the canonical form of the signed document is written",
+    xmlSecAppCmdLineParamTypeString,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam batchParam = {
+    xmlSecAppCmdLineTopicDSigVerify,
+    "--batch",
+    NULL,
+    "--batch <file>"
+    "\n\tverify the files listed in <file> (one filename per line,"
+    "\n\tuse \"-\" for stdin) and print one status line per file; the"
+    "\n\tkeys are loaded only once for all the files",
+    xmlSecAppCmdLineParamTypeString,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam verifyCacheParam = {
+    xmlSecAppCmdLineTopicDSigVerify,
+    "--verify-cache",
+    NULL,
+    "--verify-cache <number>"
+    "\n\tcache up to <number> signatures verification results shared"
+    "\n\tby all the verified files (e.g. with \"--batch\" or \"--repeat\")",
+    xmlSecAppCmdLineParamTypeNumber,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam streamParam = {
+    xmlSecAppCmdLineTopicDSigVerify,
+    "--stream",
+    NULL,
+    "--stream"
+    "\n\tverify the enveloped signature of the whole document without"
+    "\n\tloading the document (one reference with URI=\"\" and the"
+    "\n\tenveloped signature and c14n transforms only)",
+    xmlSecAppCmdLineParamTypeFlag,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
 #endif /* XMLSEC_NO_XMLDSIG */
 
 /****************************************************************
@@ -769,6 +982,30 @@ static xmlSecAppCmdLineParam enabledCipherRefUrisParam = {
     NULL
 };
 
+static xmlSecAppCmdLineParam compressDeflateParam = {
+    xmlSecAppCmdLineTopicEncCommon,
+    "--compress-deflate",
+    NULL,
+    "--compress-deflate"
+    "\n\tcompress the data with deflate before the encryption and"
+    "\n\tdecompress it after the decryption (both sides must use it)",
+    xmlSecAppCmdLineParamTypeFlag,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
+static xmlSecAppCmdLineParam maxDecompressedSizeParam = {
+    xmlSecAppCmdLineTopicEncDecrypt,
+    "--max-decompressed-size",
+    NULL,
+    "--max-decompressed-size <number>"
+    "\n\tmax size in bytes of the decompressed data with"
+    "\n\t\"--compress-deflate\" (default: 64MB)",
+    xmlSecAppCmdLineParamTypeNumber,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
 static xmlSecAppCmdLineParam binaryDataParam = {
     xmlSecAppCmdLineTopicEncEncrypt,
     "--binary-data",
@@ -909,6 +1146,18 @@ static xmlSecAppCmdLineParam crlDerParam = {
     NULL
 };
 
+static xmlSecAppCmdLineParam X509VerifyCacheParam = {
+    xmlSecAppCmdLineTopicX509Certs,
+    "--X509-verify-cache",
+    NULL,
+    "--X509-verify-cache <number>"
+    "\n\tcache up to <number> successful certificates verification"
+    "\n\tresults shared by all the verified files (e.g. with \"--batch\")",
+    xmlSecAppCmdLineParamTypeNumber,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
+
 static xmlSecAppCmdLineParam verificationTimeParam = {
     xmlSecAppCmdLineTopicX509Certs,
     "--verification-time",
@@ -965,6 +1214,18 @@ static xmlSecAppCmdLineParam X509DontVerifyCerts = {
     xmlSecAppCmdLineParamFlagNone,
     NULL
 };
+
+static xmlSecAppCmdLineParam X509ShallowCopyParam = {
+    xmlSecAppCmdLineTopicX509Certs,
+    "--X509-shallow-copy",
+    NULL,
+    "--X509-shallow-copy"
+    "\n\tshare the certificates and CRLs between the keys copies"
+    "\n\tinstead of copying them",
+    xmlSecAppCmdLineParamTypeFlag,
+    xmlSecAppCmdLineParamFlagNone,
+    NULL
+};
 #endif /* XMLSEC_NO_X509 */
 
 static xmlSecAppCmdLineParamPtr parameters[] = {
@@ -975,11 +1236,20 @@ static xmlSecAppCmdLineParamPtr parameters[] = {
     &storeSignaturesParam,
     &enabledRefUrisParam,
     &enableVisa3DHackParam,
+    &libxml2C14NParam,
 
 #ifndef XMLSEC_NO_HMAC
     &hmacMinOutputLenParam,
 #endif  /* XMLSEC_NO_HMAC */
 
+    /* sign dsig params */
+    &streamTemplateParam,
+
+    /* verify dsig params */
+    &batchParam,
+    &verifyCacheParam,
+    &streamParam,
+
 #endif /* XMLSEC_NO_XMLDSIG */
 
     /* enc params */
@@ -987,6 +1257,8 @@ static xmlSecAppCmdLineParamPtr parameters[] = {
     &binaryDataParam,
     &xmlDataParam,
     &enabledCipherRefUrisParam,
+    &compressDeflateParam,
+    &maxDecompressedSizeParam,
 #endif /* XMLSEC_NO_XMLENC */
 
     /* common dsig and enc parameters */
@@ -1051,11 +1323,13 @@ static xmlSecAppCmdLineParamPtr parameters[] = {
     &untrustedDerParam,
     &crlPemParam,
     &crlDerParam,
+    &X509VerifyCacheParam,
     &verificationTimeParam,
     &verificationGmtTimeParam,
     &depthParam,
     &X509SkipStrictChecksParam,
     &X509DontVerifyCerts,
+    &X509ShallowCopyParam,
 #endif /* XMLSEC_NO_X509 */
 
 
@@ -1064,7 +1338,15 @@ static xmlSecAppCmdLineParamPtr parameters[] = {
     &cryptoConfigParam,
     &verboseParam,
     &repeatParam,
+    &benchParam,
+    &benchWarmupParam,
+    &benchPhasesParam,
+    &benchJsonParam,
+    &threadsParam,
     &transformBinChunkSizeParam,
+    &transformBinChunkSizeAdaptiveParam,
+    &transformStatsParam,
+    &memBufSpillSizeParam,
     &xxeParam,
     &urlMapParam,
     &helpParam,
@@ -1087,20 +1369,23 @@ typedef enum {
     xmlSecAppCommandSignTmpl,
     xmlSecAppCommandEncrypt,
     xmlSecAppCommandDecrypt,
-    xmlSecAppCommandEncryptTmpl
+    xmlSecAppCommandEncryptTmpl,
+    xmlSecAppCommandServe
 } xmlSecAppCommand;
 
 typedef struct _xmlSecAppXmlData                                xmlSecAppXmlData,
                                                                 *xmlSecAppXmlDataPtr;
 struct _xmlSecAppXmlData {
     xmlDocPtr   doc;
-    xmlDtdPtr   dtd;
     xmlNodePtr  startNode;
 };
 
 static xmlSecAppXmlDataPtr      xmlSecAppXmlDataCreate          (const char* filename,
                                                                  const xmlChar* defStartNodeName,
                                                                  const xmlChar* defStartNodeNs);
+static xmlSecAppXmlDataPtr      xmlSecAppXmlDataCreateFromDoc   (xmlDocPtr doc,
+                                                                 const xmlChar* defStartNodeName,
+                                                                 const xmlChar* defStartNodeNs);
 static void                     xmlSecAppXmlDataDestroy         (xmlSecAppXmlDataPtr data);
 
 
@@ -1114,11 +1399,18 @@ static int                      xmlSecAppInit                   (void);
 static void                     xmlSecAppShutdown               (void);
 static int                      xmlSecAppLoadKeys               (void);
 static int                      xmlSecAppPrepareKeyInfoCtx      (xmlSecKeyInfoCtxPtr ctx);
+static void                     xmlSecAppPrepareTransformCtx    (xmlSecTransformCtxPtr ctx);
 
 #ifndef XMLSEC_NO_XMLDSIG
 static int                      xmlSecAppSignFile               (const char* inputFileName,
                                                                  const char* outputFileNameTmpl);
+static int                      xmlSecAppSignFileStream         (xmlSecDSigCtxPtr dsigCtx,
+                                                                 const char* inputFileName,
+                                                                 const char* templateFileName,
+                                                                 const char* outputFileNameTmpl);
 static int                      xmlSecAppVerifyFile             (const char* inputFileName);
+static int                      xmlSecAppVerifyBatch            (const char* listFileName,
+                                                                 int threadsNum);
 #ifndef XMLSEC_NO_TMPL_TEST
 static int                      xmlSecAppSignTmpl               (const char* outputFileNameTmpl);
 #endif /* XMLSEC_NO_TMPL_TEST */
@@ -1145,14 +1437,13 @@ static int                      xmlSecAppCheckTransform     (const char * name);
 
 static xmlSecTransformUriType   xmlSecAppGetUriType             (const char* string);
 static xmlOutputBufferPtr       xmlSecAppOpenFile               (const char* filename);
+static char*                    xmlSecAppGetOutputFilename      (const char* inputFileName,
+                                                                 const char* outputFileNameTmpl);
 static int                      xmlSecAppWriteResult            (const char* inputFileName,
                                                                  const char* outputFileNameTmpl,
                                                                  xmlDocPtr doc,
                                                                  xmlSecBufferPtr buffer);
-static int                      xmlSecAppAddIDAttr              (xmlNodePtr cur,
-                                                                 const xmlChar* attr,
-                                                                 const xmlChar* node,
-                                                                 const xmlChar* nsHref);
+static int                      xmlSecAppAddIDAttrs             (xmlDocPtr doc);
 
 
 static int                      xmlSecAppInputMatchCallback     (char const * filename);
@@ -1165,6 +1456,32 @@ static int                      xmlSecAppInputCloseCallback     (void * context)
 static int                      xmlSecAppExecute                (xmlSecAppCommand command,
                                                                 const char** utf8_argv,
                                                                 int argc);
+static int                      xmlSecAppServe                  (const char* socketPath,
+                                                                 int threadsNum);
+
+/* benchmark */
+typedef enum {
+    xmlSecAppBenchPhaseParse = 0,
+    xmlSecAppBenchPhaseKeys,
+    xmlSecAppBenchPhaseReferences,
+    xmlSecAppBenchPhaseOutput,
+    xmlSecAppBenchPhaseNum
+} xmlSecAppBenchPhase;
+
+static double                   xmlSecAppBenchGetTime           (void);
+static long                     xmlSecAppBenchGetPeakRss        (void);
+static void                     xmlSecAppBenchAddPhase          (xmlSecAppBenchPhase phase,
+                                                                 double startTime);
+static int                      xmlSecAppBenchInit              (int runs);
+static void                     xmlSecAppBenchShutdown          (void);
+static int                      xmlSecAppBenchPrint             (xmlSecAppCommand command,
+                                                                 int warmup);
+#ifndef XMLSEC_NO_XMLDSIG
+static int                      xmlSecAppBenchReferencesExecutor(void* executorCtx,
+                                                                 xmlSecDSigReferenceExecuteTask task,
+                                                                 xmlSecDSigReferenceCtxPtr* dsigRefCtxs,
+                                                                 xmlSecSize size);
+#endif /* XMLSEC_NO_XMLDSIG */
 
 
 #if defined(XMLSEC_WINDOWS) && defined(UNICODE) && defined(__MINGW32__)
@@ -1172,11 +1489,18 @@ int wmain(int argc, wchar_t* argv[]);
 #endif /* defined(XMLSEC_WINDOWS) && defined(UNICODE) && defined(__MINGW32__) */
 
 xmlSecKeysMngrPtr g_keysManager = NULL;
+#ifndef XMLSEC_NO_XMLDSIG
+xmlSecDSigVerifyCachePtr g_verifyCache = NULL;
+#endif /* XMLSEC_NO_XMLDSIG */
 int g_repeats = 1;
 int g_printDebug = 0;
 int g_printVerboseDebug = 0;
 int g_blockNetworkIO = 0;
-clock_t g_totalTime = 0;
+double g_benchPhases[xmlSecAppBenchPhaseNum];         /* current run, seconds */
+double g_benchPhasesTotal[xmlSecAppBenchPhaseNum];    /* all measured runs, seconds */
+double* g_benchSamples = NULL;                          /* measured runs latency, seconds */
+int g_benchSamplesNum = 0;
+xmlSecGetKeyCallback g_benchGetKey = NULL;
 const char* g_xmlSecCryptoLibrary = NULL;
 const char* gOutputFilename = NULL;
 
@@ -1258,11 +1582,24 @@ int main(int argc, const char **argv) {
 
     /* we need to have some files at the end */
     switch(command) {
+        case xmlSecAppCommandVerify:
+#ifndef XMLSEC_NO_XMLDSIG
+            if(xmlSecAppCmdLineParamIsSet(&batchParam)) {
+                /* files are listed in the batch file */
+                break;
+            }
+#endif /* XMLSEC_NO_XMLDSIG */
+            if(pos >= argc) {
+                fprintf(stderr, "Error: <file> parameter is required for this command\n");
+                xmlSecAppPrintUsage();
+                goto done;
+            }
+            break;
         case xmlSecAppCommandKeys:
         case xmlSecAppCommandSign:
-        case xmlSecAppCommandVerify:
         case xmlSecAppCommandEncrypt:
         case xmlSecAppCommandDecrypt:
+        case xmlSecAppCommandServe:
             if(pos >= argc) {
                 fprintf(stderr, "Error: <file> parameter is required for this command\n");
                 xmlSecAppPrintUsage();
@@ -1316,6 +1653,9 @@ done:
 static int
 xmlSecAppExecute(xmlSecAppCommand command, const char** utf8_argv, int argc) {
     const char* tmp = NULL;
+    double start_time;
+    int warmup = 0;
+    int runs = 1;
     int res = - 1;
     int ii;
 
@@ -1361,9 +1701,26 @@ xmlSecAppExecute(xmlSecAppCommand command, const char** utf8_argv, int argc) {
             xmlSecAppPrintUsage();
             goto done;
         }
-        xmlSecTransformCtxSetDefaultBinaryChunkSize((xmlSecSize)chunkSize);
     }
 
+    /* membuf spill size */
+    if(xmlSecAppCmdLineParamIsSet(&memBufSpillSizeParam)) {
+        int spillSize = xmlSecAppCmdLineParamGetInt(&memBufSpillSizeParam, 0);
+        if(spillSize <= 0) {
+            fprintf(stderr, "Error: membuf spill size should be greater than zero\n");
+            xmlSecAppPrintUsage();
+            goto done;
+        }
+        xmlSecTransformMemBufSetDefaultSpillSize((xmlSecSize)spillSize);
+    }
+
+#ifndef XMLSEC_NO_X509
+    /* X509 key data duplication mode */
+    if(xmlSecAppCmdLineParamIsSet(&X509ShallowCopyParam)) {
+        xmlSecKeyDataX509SetDefaultShallowCopy(1);
+    }
+#endif /* XMLSEC_NO_X509 */
+
     /* load keys */
     if(xmlSecAppLoadKeys() < 0) {
         fprintf(stderr, "Error: keys manager creation failed\n");
@@ -1371,18 +1728,50 @@ xmlSecAppExecute(xmlSecAppCommand command, const char** utf8_argv, int argc) {
         goto done;
     }
 
-    /* get the "g_repeats" number */
-    if(xmlSecAppCmdLineParamIsSet(&repeatParam) &&
-       (xmlSecAppCmdLineParamGetInt(&repeatParam, 1) > 0)) {
+#ifndef XMLSEC_NO_XMLDSIG
+    /* create the verification results cache */
+    if(xmlSecAppCmdLineParamIsSet(&verifyCacheParam)) {
+        int verifyCacheSize = xmlSecAppCmdLineParamGetInt(&verifyCacheParam, 0);
+        if(verifyCacheSize <= 0) {
+            fprintf(stderr, "Error: verify cache size should be greater than zero\n");
+            xmlSecAppPrintUsage();
+            goto done;
+        }
+        g_verifyCache = xmlSecDSigVerifyCacheCreate((xmlSecSize)verifyCacheSize);
+        if(g_verifyCache == NULL) {
+            fprintf(stderr, "Error: verify cache creation failed\n");
+            goto done;
+        }
+    }
+#endif /* XMLSEC_NO_XMLDSIG */
 
-        g_repeats = xmlSecAppCmdLineParamGetInt(&repeatParam, 1);
+    /* get the number of runs: "--bench" wins over "--repeat" */
+    if(xmlSecAppCmdLineParamIsSet(&benchParam)) {
+        runs = xmlSecAppCmdLineParamGetInt(&benchParam, 1);
+        warmup = xmlSecAppCmdLineParamGetInt(&benchWarmupParam, 1);
+        if((runs <= 0) || (warmup < 0)) {
+            fprintf(stderr, "Error: benchmark runs number should be greater than zero\n");
+            xmlSecAppPrintUsage();
+            goto done;
+        }
+    } else if(xmlSecAppCmdLineParamIsSet(&repeatParam) &&
+       (xmlSecAppCmdLineParamGetInt(&repeatParam, 1) > 0)) {
+        runs = xmlSecAppCmdLineParamGetInt(&repeatParam, 1);
+    }
+    if(xmlSecAppBenchInit(runs) < 0) {
+        fprintf(stderr, "Error: benchmark initialization failed\n");
+        goto done;
     }
+    g_repeats = warmup + runs;
 
     /* get the output file */
     gOutputFilename = xmlSecAppCmdLineParamGetString(&outputParam);
 
     /* execute requested number of times */
     for(; g_repeats > 0; --g_repeats) {
+        memset(g_benchPhases, 0, sizeof(g_benchPhases));
+        start_time = xmlSecAppBenchGetTime();
+
         switch(command) {
         case xmlSecAppCommandListKeyData:
             xmlSecAppListKeyData();
@@ -1428,6 +1817,14 @@ xmlSecAppExecute(xmlSecAppCommand command, const char** utf8_argv, int argc) {
             }
             break;
         case xmlSecAppCommandVerify:
+            if(xmlSecAppCmdLineParamIsSet(&batchParam)) {
+                if(xmlSecAppVerifyBatch(xmlSecAppCmdLineParamGetString(&batchParam),
+                                        xmlSecAppCmdLineParamGetInt(&threadsParam, 1)) < 0) {
+                    fprintf(stderr, "Error: failed to verify files from \"%s\"\n",
+                            xmlSecAppCmdLineParamGetString(&batchParam));
+                    goto done;
+                }
+            }
             for(ii = 0; ii < argc; ++ii) {
                 if(xmlSecAppVerifyFile(utf8_argv[ii]) < 0) {
                     fprintf(stderr, "Error: failed to verify file \"%s\"\n", utf8_argv[ii]);
@@ -1472,27 +1869,56 @@ xmlSecAppExecute(xmlSecAppCommand command, const char** utf8_argv, int argc) {
 #endif /* XMLSEC_NO_TMPL_TEST */
 #endif /* XMLSEC_NO_XMLENC */
 
+        case xmlSecAppCommandServe:
+            if(xmlSecAppServe(utf8_argv[0], xmlSecAppCmdLineParamGetInt(&threadsParam, 1)) < 0) {
+                fprintf(stderr, "Error: failed to serve requests on \"%s\"\n", utf8_argv[0]);
+                goto done;
+            }
+            break;
+
         default:
             fprintf(stderr, "Error: invalid command %d\n", (int)command);
             xmlSecAppPrintUsage();
             goto done;
         }
+
+        /* record the measured runs (the result is written once and doesn't count) */
+        if(g_repeats <= runs) {
+            g_benchSamples[g_benchSamplesNum++] = xmlSecAppBenchGetTime() - start_time
+                - g_benchPhases[xmlSecAppBenchPhaseOutput];
+            for(ii = 0; ii < xmlSecAppBenchPhaseNum; ++ii) {
+                g_benchPhasesTotal[ii] += g_benchPhases[ii];
+            }
+        }
     }
 
     /* print perf stats results */
-    if(xmlSecAppCmdLineParamIsSet(&repeatParam) &&
+    if(xmlSecAppCmdLineParamIsSet(&benchParam)) {
+        if(xmlSecAppBenchPrint(command, warmup) < 0) {
+            fprintf(stderr, "Error: failed to write benchmark results\n");
+            goto done;
+        }
+    } else if(xmlSecAppCmdLineParamIsSet(&repeatParam) &&
        (xmlSecAppCmdLineParamGetInt(&repeatParam, 1) > 0)) {
-        long double msecs;
+        double msecs = 0;
 
-        g_repeats = xmlSecAppCmdLineParamGetInt(&repeatParam, 1);
-        msecs = (1000 * g_totalTime) / (long double)CLOCKS_PER_SEC;
-        fprintf(stderr, "Executed %d tests in %.2Lf msec\n", g_repeats, msecs);
+        for(ii = 0; ii < g_benchSamplesNum; ++ii) {
+            msecs += 1000 * g_benchSamples[ii];
+        }
+        fprintf(stderr, "Executed %d tests in %.2f msec\n", g_benchSamplesNum, msecs);
     }
 
     /* success! */
     res = 0;
 
 done:
+    xmlSecAppBenchShutdown();
+#ifndef XMLSEC_NO_XMLDSIG
+    if(g_verifyCache != NULL) {
+        xmlSecDSigVerifyCacheDestroy(g_verifyCache);
+        g_verifyCache = NULL;
+    }
+#endif /* XMLSEC_NO_XMLDSIG */
     if(g_keysManager != NULL) {
         xmlSecKeysMngrDestroy(g_keysManager);
         g_keysManager = NULL;
@@ -1502,11 +1928,67 @@ done:
 }
 
 #ifndef XMLSEC_NO_XMLDSIG
+static int
+xmlSecAppSignFileStream(xmlSecDSigCtxPtr dsigCtx, const char* inputFileName, const char* templateFileName,
+                        const char* outputFileNameTmpl) {
+    xmlSecAppXmlDataPtr data = NULL;
+    char* outputFileName = NULL;
+    xmlOutputBufferPtr outBuffer = NULL;
+    int ret;
+    int res = -1;
+
+    if(templateFileName == NULL) {
+        fprintf(stderr, "Error: template filename is not specified\n");
+        return(-1);
+    }
+    data = xmlSecAppXmlDataCreate(templateFileName, xmlSecNodeSignature, xmlSecDSigNs);
+    if(data == NULL) {
+        fprintf(stderr, "Error: failed to load template \"%s\"\n", templateFileName);
+        goto done;
+    }
+
+    /* get output filename by replacing '{inputfile}' with input file name */
+    if(outputFileNameTmpl != NULL) {
+        outputFileName = xmlSecAppGetOutputFilename(inputFileName, outputFileNameTmpl);
+        if(outputFileName == NULL) {
+            fprintf(stderr, "Error: can't create output filename\n");
+            goto done;
+        }
+    }
+    outBuffer = xmlSecAppOpenFile(outputFileName != NULL ? outputFileName : outputFileNameTmpl);
+    if(outBuffer == NULL) {
+        goto done;
+    }
+
+    ret = xmlSecDSigCtxSignFile(dsigCtx, inputFileName, data->startNode, outBuffer);
+    if(ret < 0) {
+        fprintf(stderr, "Error: failed to sign document \"%s\"\n", inputFileName);
+        goto done;
+    }
+    res = 0;
+
+done:
+    if(outBuffer != NULL) {
+        if((xmlOutputBufferClose(outBuffer) < 0) && (res == 0)) {
+            fprintf(stderr, "Error: failed to write output\n");
+            res = -1;
+        }
+    }
+    if((outputFileName != NULL) && (outputFileName != outputFileNameTmpl)) {
+        xmlFree(outputFileName);
+    }
+    if(data != NULL) {
+        xmlSecAppXmlDataDestroy(data);
+    }
+    return(res);
+}
+
 static int
 xmlSecAppSignFile(const char* inputFileName, const char* outputFileNameTmpl) {
     xmlSecAppXmlDataPtr data = NULL;
     xmlSecDSigCtx dsigCtx;
-    clock_t start_time;
+    double start_time;
+    int ret;
     int res = -1;
 
     if(inputFileName == NULL) {
@@ -1524,8 +2006,22 @@ xmlSecAppSignFile(const char* inputFileName, const char* outputFileNameTmpl) {
         goto done;
     }
 
+    if(xmlSecAppCmdLineParamIsSet(&streamTemplateParam)) {
+        /* the document is parsed while it is signed */
+        ret = xmlSecAppSignFileStream(&dsigCtx, inputFileName,
+            xmlSecAppCmdLineParamGetString(&streamTemplateParam), outputFileNameTmpl);
+        if(ret < 0) {
+            /* caller will print the error */
+            goto done;
+        }
+        res = 0;
+        goto done;
+    }
+
     /* parse template and select start node */
+    start_time = xmlSecAppBenchGetTime();
     data = xmlSecAppXmlDataCreate(inputFileName, xmlSecNodeSignature, xmlSecDSigNs);
+    xmlSecAppBenchAddPhase(xmlSecAppBenchPhaseParse, start_time);
     if(data == NULL) {
         fprintf(stderr, "Error: failed to load template \"%s\"\n", inputFileName);
         goto done;
@@ -1533,12 +2029,10 @@ xmlSecAppSignFile(const char* inputFileName, const char* outputFileNameTmpl) {
 
 
     /* sign */
-    start_time = clock();
     if(xmlSecDSigCtxSign(&dsigCtx, data->startNode) < 0) {
         /* caller will print the error */
         goto done;
     }
-    g_totalTime += clock() - start_time;
 
     /* return an error if siganture failed */
     if(dsigCtx.status != xmlSecDSigStatusSucceeded) {
@@ -1546,8 +2040,6 @@ xmlSecAppSignFile(const char* inputFileName, const char* outputFileNameTmpl) {
     }
 
     if(g_repeats <= 1) {
-        int ret;
-
         ret = xmlSecAppWriteResult(inputFileName, outputFileNameTmpl, data->doc, NULL);
         if(ret < 0) {
             goto done;
@@ -1577,8 +2069,9 @@ done:
 static int
 xmlSecAppVerifyFile(const char* inputFileName) {
     xmlSecAppXmlDataPtr data = NULL;
+    xmlDocPtr signatureDoc = NULL;
     xmlSecDSigCtx dsigCtx;
-    clock_t start_time;
+    double start_time;
     int res = -1;
 
     if(inputFileName == NULL) {
@@ -1595,20 +2088,28 @@ xmlSecAppVerifyFile(const char* inputFileName) {
         goto done;
     }
 
-    /* parse template and select start node */
-    data = xmlSecAppXmlDataCreate(inputFileName, xmlSecNodeSignature, xmlSecDSigNs);
-    if(data == NULL) {
-        fprintf(stderr, "Error: failed to load document \"%s\"\n", inputFileName);
-        goto done;
-    }
+    if(xmlSecAppCmdLineParamIsSet(&streamParam)) {
+        /* the document is parsed while it is verified */
+        if(xmlSecDSigCtxVerifyFile(&dsigCtx, inputFileName, &signatureDoc) < 0) {
+            /* caller will print the error */
+            goto done;
+        }
+    } else {
+        /* parse template and select start node */
+        start_time = xmlSecAppBenchGetTime();
+        data = xmlSecAppXmlDataCreate(inputFileName, xmlSecNodeSignature, xmlSecDSigNs);
+        xmlSecAppBenchAddPhase(xmlSecAppBenchPhaseParse, start_time);
+        if(data == NULL) {
+            fprintf(stderr, "Error: failed to load document \"%s\"\n", inputFileName);
+            goto done;
+        }
 
-    /* sign */
-    start_time = clock();
-    if(xmlSecDSigCtxVerify(&dsigCtx, data->startNode) < 0) {
-        /* caller will print the error */
-        goto done;
+        /* sign */
+        if(xmlSecDSigCtxVerify(&dsigCtx, data->startNode) < 0) {
+            /* caller will print the error */
+            goto done;
+        }
     }
-    g_totalTime += clock() - start_time;
 
     /* return an error if verification failed */
     if(dsigCtx.status != xmlSecDSigStatusSucceeded) {
@@ -1661,19 +2162,203 @@ done:
         xmlSecAppPrintDSigCtx(&dsigCtx);
     }
     xmlSecDSigCtxFinalize(&dsigCtx);
+    if(signatureDoc != NULL) {
+        xmlFreeDoc(signatureDoc);
+    }
+    if(data != NULL) {
+        xmlSecAppXmlDataDestroy(data);
+    }
+    return(res);
+}
+
+/****************************************************************
+ *
+ * Batch verification ("--batch" and "--threads")
+ *
+ ****************************************************************/
+#define XMLSEC_APP_BATCH_MAX_LINE_SIZE          4096
+
+typedef struct _xmlSecAppBatch {
+    FILE*               list;
+    xmlMutexPtr         mutex;
+    unsigned long       ok;
+    unsigned long       failed;
+    unsigned long       errors;
+} xmlSecAppBatch, *xmlSecAppBatchPtr;
+
+/* reads the next filename from the list (locked by the caller) */
+static int
+xmlSecAppBatchReadFilename(xmlSecAppBatchPtr batch, char* buf, size_t bufSize) {
+    size_t len;
+
+    while(fgets(buf, (int)bufSize, batch->list) != NULL) {
+        len = strlen(buf);
+        while((len > 0) && ((buf[len - 1] == '\n') || (buf[len - 1] == '\r'))) {
+            buf[--len] = '\0';
+        }
+        /* skip empty lines and comments */
+        if((len > 0) && (buf[0] != '#')) {
+            return(1);
+        }
+    }
+    return(0);
+}
+
+static int
+xmlSecAppVerifyBatchFile(const char* inputFileName, xmlSecDSigStatus* status,
+                         xmlSecDSigFailureReason* failureReason) {
+    xmlSecAppXmlDataPtr data = NULL;
+    xmlSecDSigCtx dsigCtx;
+    int res = -1;
+
+    (*status) = xmlSecDSigStatusUnknown;
+    (*failureReason) = xmlSecDSigFailureReasonUnknown;
+
+    if(xmlSecDSigCtxInitialize(&dsigCtx, g_keysManager) < 0) {
+        return(-1);
+    }
+    if(xmlSecAppPrepareDSigCtx(&dsigCtx) < 0) {
+        goto done;
+    }
+
+    /* parse document and select start node */
+    data = xmlSecAppXmlDataCreate(inputFileName, xmlSecNodeSignature, xmlSecDSigNs);
+    if(data == NULL) {
+        goto done;
+    }
+    if(xmlSecDSigCtxVerify(&dsigCtx, data->startNode) < 0) {
+        goto done;
+    }
+    res = 0;
+
+done:
+    (*status) = dsigCtx.status;
+    (*failureReason) = dsigCtx.failureReason;
+    xmlSecDSigCtxFinalize(&dsigCtx);
     if(data != NULL) {
         xmlSecAppXmlDataDestroy(data);
     }
     return(res);
 }
 
+static void
+xmlSecAppVerifyBatchWorker(xmlSecAppBatchPtr batch) {
+    char filename[XMLSEC_APP_BATCH_MAX_LINE_SIZE];
+    xmlSecDSigStatus status;
+    xmlSecDSigFailureReason failureReason;
+    int ret;
+
+    while(1) {
+        xmlMutexLock(batch->mutex);
+        ret = xmlSecAppBatchReadFilename(batch, filename, sizeof(filename));
+        xmlMutexUnlock(batch->mutex);
+        if(ret == 0) {
+            break;
+        }
+
+        ret = xmlSecAppVerifyBatchFile(filename, &status, &failureReason);
+
+        /* one status line per file */
+        xmlMutexLock(batch->mutex);
+        if((ret < 0) || (status == xmlSecDSigStatusUnknown)) {
+            fprintf(stdout, "%s: %s\n", filename, xmlSecDSigCtxGetStatusString(xmlSecDSigStatusUnknown));
+            ++batch->errors;
+        } else if(status == xmlSecDSigStatusSucceeded) {
+            fprintf(stdout, "%s: %s\n", filename, xmlSecDSigCtxGetStatusString(status));
+            ++batch->ok;
+        } else {
+            fprintf(stdout, "%s: %s (%s)\n", filename, xmlSecDSigCtxGetStatusString(status),
+                xmlSecDSigCtxGetFailureReasonString(failureReason));
+            ++batch->failed;
+        }
+        xmlMutexUnlock(batch->mutex);
+    }
+}
+
+static void
+xmlSecAppVerifyBatchTask(void* taskCtx, xmlSecSize worker) {
+    UNREFERENCED_PARAMETER(worker);
+    xmlSecAppVerifyBatchWorker((xmlSecAppBatchPtr)taskCtx);
+}
+
+static int
+xmlSecAppVerifyBatch(const char* listFileName, int threadsNum) {
+    xmlSecAppBatch batch;
+    xmlSecExecutorPtr executor = NULL;
+    int res = -1;
+
+    if(listFileName == NULL) {
+        fprintf(stderr, "Error: batch filename is not specified\n");
+        return(-1);
+    }
+    if(threadsNum <= 0) {
+        fprintf(stderr, "Error: threads number should be greater than zero\n");
+        return(-1);
+    }
+#if defined(XMLSEC_NO_THREADS)
+    if(threadsNum > 1) {
+        fprintf(stderr, "Warning: threads are not supported, using the main thread\n");
+        threadsNum = 1;
+    }
+#endif /* defined(XMLSEC_NO_THREADS) */
+
+    memset(&batch, 0, sizeof(batch));
+    if(strcmp(listFileName, "-") == 0) {
+        batch.list = stdin;
+    } else {
+        batch.list = fopen(listFileName, "r");
+        if(batch.list == NULL) {
+            fprintf(stderr, "Error: failed to open file \"%s\"\n", listFileName);
+            return(-1);
+        }
+    }
+    batch.mutex = xmlNewMutex();
+    if(batch.mutex == NULL) {
+        fprintf(stderr, "Error: failed to create mutex\n");
+        goto done;
+    }
+
+    if(threadsNum == 1) {
+        xmlSecAppVerifyBatchWorker(&batch);
+    } else {
+        /* each pool thread reads the file names from the list until it ends */
+        executor = xmlSecExecutorCreate((xmlSecSize)threadsNum);
+        if(executor == NULL) {
+            fprintf(stderr, "Error: failed to start worker threads\n");
+            goto done;
+        }
+        if(xmlSecExecutorRunWorkers(executor, xmlSecAppVerifyBatchTask, &batch, (xmlSecSize)threadsNum) < 0) {
+            fprintf(stderr, "Error: failed to run worker threads\n");
+            goto done;
+        }
+    }
+    fflush(stdout);
+
+    fprintf(stderr, "Batch verification: %lu ok, %lu failed, %lu errors\n",
+        batch.ok, batch.failed, batch.errors);
+    if((batch.failed == 0) && (batch.errors == 0)) {
+        res = 0;
+    }
+
+done:
+    if(executor != NULL) {
+        xmlSecExecutorDestroy(executor);
+    }
+    if(batch.mutex != NULL) {
+        xmlFreeMutex(batch.mutex);
+    }
+    if(batch.list != stdin) {
+        fclose(batch.list);
+    }
+    return(res);
+}
+
 #ifndef XMLSEC_NO_TMPL_TEST
 static int
 xmlSecAppSignTmpl(const char* outputFileNameTmpl) {
     xmlDocPtr doc = NULL;
     xmlNodePtr cur;
     xmlSecDSigCtx dsigCtx;
-    clock_t start_time;
     int res = -1;
 
     if(xmlSecDSigCtxInitialize(&dsigCtx, g_keysManager) < 0) {
@@ -1751,12 +2436,10 @@ xmlSecAppSignTmpl(const char* outputFileNameTmpl) {
     }
 
     /* sign */
-    start_time = clock();
     if(xmlSecDSigCtxSign(&dsigCtx, xmlDocGetRootElement(doc)) < 0) {
         /* caller will print the error */
         goto done;
     }
-    g_totalTime += clock() - start_time;
 
     /* return an error if siganture failed */
     if(dsigCtx.status != xmlSecDSigStatusSucceeded) {
@@ -1836,6 +2519,14 @@ xmlSecAppPrepareDSigCtx(xmlSecDSigCtxPtr dsigCtx) {
     if(xmlSecAppCmdLineParamIsSet(&enableVisa3DHackParam)) {
         dsigCtx->flags |= XMLSEC_DSIG_FLAGS_USE_VISA3D_HACK;
     }
+    if(xmlSecAppCmdLineParamIsSet(&libxml2C14NParam)) {
+        dsigCtx->transformCtx.flags |= XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N;
+    }
+    dsigCtx->verifyCache = g_verifyCache;
+    if(xmlSecAppCmdLineParamIsSet(&benchParam) && xmlSecAppCmdLineParamIsSet(&benchPhasesParam)) {
+        /* time the references */
+        dsigCtx->referencesExecutor = xmlSecAppBenchReferencesExecutor;
+    }
 
 #ifndef XMLSEC_NO_HMAC
     if(xmlSecAppCmdLineParamIsSet(&hmacMinOutputLenParam)) {
@@ -1856,6 +2547,7 @@ xmlSecAppPrepareDSigCtx(xmlSecDSigCtxPtr dsigCtx) {
         }
     }
 
+    xmlSecAppPrepareTransformCtx(&(dsigCtx->transformCtx));
     return(0);
 }
 
@@ -1884,7 +2576,7 @@ xmlSecAppEncryptFile(const char* inputFileName, const char* outputFileNameTmpl)
     xmlSecEncCtx encCtx;
     xmlDocPtr doc = NULL;
     xmlNodePtr startTmplNode;
-    clock_t start_time;
+    double start_time;
     int res = -1;
 
     if(inputFileName == NULL) {
@@ -1902,7 +2594,9 @@ xmlSecAppEncryptFile(const char* inputFileName, const char* outputFileNameTmpl)
     }
 
     /* parse doc and find template node */
+    start_time = xmlSecAppBenchGetTime();
     doc = xmlSecParseFile(inputFileName);
+    xmlSecAppBenchAddPhase(xmlSecAppBenchPhaseParse, start_time);
     if(doc == NULL) {
         fprintf(stderr, "Error: failed to parse xml file \"%s\"\n",
                 inputFileName);
@@ -1917,16 +2611,16 @@ xmlSecAppEncryptFile(const char* inputFileName, const char* outputFileNameTmpl)
 
     if(xmlSecAppCmdLineParamGetString(&binaryDataParam) != NULL) {
         /* encrypt */
-        start_time = clock();
         if(xmlSecEncCtxUriEncrypt(&encCtx, startTmplNode, BAD_CAST xmlSecAppCmdLineParamGetString(&binaryDataParam)) < 0) {
             fprintf(stderr, "Error: failed to encrypt file \"%s\"\n",
                     xmlSecAppCmdLineParamGetString(&binaryDataParam));
             goto done;
         }
-        g_totalTime += clock() - start_time;
     } else if(xmlSecAppCmdLineParamGetString(&xmlDataParam) != NULL) {
         /* parse file and select node for encryption */
+        start_time = xmlSecAppBenchGetTime();
         data = xmlSecAppXmlDataCreate(xmlSecAppCmdLineParamGetString(&xmlDataParam), NULL, NULL);
+        xmlSecAppBenchAddPhase(xmlSecAppBenchPhaseParse, start_time);
         if(data == NULL) {
             fprintf(stderr, "Error: failed to load file \"%s\"\n",
                     xmlSecAppCmdLineParamGetString(&xmlDataParam));
@@ -1934,13 +2628,11 @@ xmlSecAppEncryptFile(const char* inputFileName, const char* outputFileNameTmpl)
         }
 
         /* encrypt */
-        start_time = clock();
         if(xmlSecEncCtxXmlEncrypt(&encCtx, startTmplNode, data->startNode) < 0) {
             fprintf(stderr, "Error: failed to encrypt xml file \"%s\"\n",
                     xmlSecAppCmdLineParamGetString(&xmlDataParam));
             goto done;
         }
-        g_totalTime += clock() - start_time;
     } else {
         fprintf(stderr, "Error: encryption data not specified (use \"--xml-data\" or \"--binary-data\" options)\n");
         goto done;
@@ -1984,7 +2676,7 @@ static int
 xmlSecAppDecryptFile(const char* inputFileName, const char* outputFileNameTmpl) {
     xmlSecAppXmlDataPtr data = NULL;
     xmlSecEncCtx encCtx;
-    clock_t start_time;
+    double start_time;
     int res = -1;
 
     if(inputFileName == NULL) {
@@ -2002,18 +2694,18 @@ xmlSecAppDecryptFile(const char* inputFileName, const char* outputFileNameTmpl)
     }
 
     /* parse template and select start node */
+    start_time = xmlSecAppBenchGetTime();
     data = xmlSecAppXmlDataCreate(inputFileName, xmlSecNodeEncryptedData, xmlSecEncNs);
+    xmlSecAppBenchAddPhase(xmlSecAppBenchPhaseParse, start_time);
     if(data == NULL) {
         fprintf(stderr, "Error: failed to load template \"%s\"\n", inputFileName);
         goto done;
     }
 
-    start_time = clock();
     if(xmlSecEncCtxDecrypt(&encCtx, data->startNode) < 0) {
         fprintf(stderr, "Error: failed to decrypt file\n");
         goto done;
     }
-    g_totalTime += clock() - start_time;
 
     /* print out result only once per execution */
     if(g_repeats <= 1) {
@@ -2053,7 +2745,6 @@ xmlSecAppEncryptTmpl(const char* outputFileNameTmpl) {
     xmlSecEncCtx encCtx;
     xmlDocPtr doc = NULL;
     xmlNodePtr cur;
-    clock_t start_time;
     int res = -1;
 
     if(xmlSecEncCtxInitialize(&encCtx, g_keysManager) < 0) {
@@ -2097,13 +2788,11 @@ xmlSecAppEncryptTmpl(const char* outputFileNameTmpl) {
     }
 
     /* encrypt */
-    start_time = clock();
     if(xmlSecEncCtxBinaryEncrypt(&encCtx, xmlDocGetRootElement(doc),
                                 (const xmlSecByte*)data, xmlSecStrlen(data)) < 0) {
         fprintf(stderr, "Error: failed to encrypt data\n");
         goto done;
     }
-    g_totalTime += clock() - start_time;
 
     /* print out result only once per execution */
     if(g_repeats <= 1) {
@@ -2172,6 +2861,20 @@ xmlSecAppPrepareEncCtx(xmlSecEncCtxPtr encCtx) {
             return(-1);
         }
     }
+
+    if(xmlSecAppCmdLineParamIsSet(&compressDeflateParam)) {
+        encCtx->flags |= XMLSEC_ENC_COMPRESS_DEFLATE;
+    }
+    if(xmlSecAppCmdLineParamIsSet(&maxDecompressedSizeParam)) {
+        int maxDecompressedSize = xmlSecAppCmdLineParamGetInt(&maxDecompressedSizeParam, 0);
+        if(maxDecompressedSize <= 0) {
+            fprintf(stderr, "Error: max decompressed size should be greater than zero\n");
+            return(-1);
+        }
+        encCtx->maxDecompressedSize = (xmlSecSize)maxDecompressedSize;
+    }
+
+    xmlSecAppPrepareTransformCtx(&(encCtx->transformCtx));
     return(0);
 }
 
@@ -2221,6 +2924,28 @@ xmlSecAppCheckTransform(const char * name) {
     return 0;
 }
 
+static void
+xmlSecAppPrepareTransformCtx(xmlSecTransformCtxPtr ctx) {
+    if(ctx == NULL) {
+        return;
+    }
+
+    /* the chunk size is set per context: the global default is not modified */
+    if(xmlSecAppCmdLineParamIsSet(&transformBinChunkSizeParam)) {
+        int chunkSize = xmlSecAppCmdLineParamGetInt(&transformBinChunkSizeParam, 0);
+        if(chunkSize > 0) {
+            ctx->binaryChunkSize = (xmlSecSize)chunkSize;
+            ctx->binaryChunkSizeMax = (xmlSecSize)chunkSize;
+        }
+    }
+    if(xmlSecAppCmdLineParamIsSet(&transformBinChunkSizeAdaptiveParam)) {
+        ctx->flags |= XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE;
+    }
+    if(xmlSecAppCmdLineParamIsSet(&transformStatsParam)) {
+        ctx->flags |= XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS;
+    }
+}
+
 static int
 xmlSecAppPrepareKeyInfoCtx(xmlSecKeyInfoCtxPtr keyInfoCtx) {
     xmlSecAppCmdLineValuePtr value;
@@ -2299,6 +3024,8 @@ xmlSecAppPrepareKeyInfoCtx(xmlSecKeyInfoCtxPtr keyInfoCtx) {
         }
     }
 
+    xmlSecAppPrepareTransformCtx(&(keyInfoCtx->retrievalMethodCtx));
+    xmlSecAppPrepareTransformCtx(&(keyInfoCtx->keyInfoReferenceCtx));
     return(0);
 }
 
@@ -2451,6 +3178,19 @@ xmlSecAppLoadKeys(void) {
             return(-1);
         }
     }
+    if(xmlSecAppCmdLineParamIsSet(&X509VerifyCacheParam)) {
+        int verifyCacheSize = xmlSecAppCmdLineParamGetInt(&X509VerifyCacheParam, 0);
+        if(verifyCacheSize <= 0) {
+            fprintf(stderr, "Error: invalid value for option \"%s\".\n", X509VerifyCacheParam.fullName);
+            xmlSecKeyInfoCtxDestroy(keyInfoCtx);
+            return(-1);
+        } else if(xmlSecAppCryptoSimpleKeysMngrEnableX509VerifyCache(g_keysManager,
+                    (xmlSecSize)verifyCacheSize) < 0) {
+            fprintf(stderr, "Error: failed to enable certificates verification cache.\n");
+            xmlSecKeyInfoCtxDestroy(keyInfoCtx);
+            return(-1);
+        }
+    }
 #endif /* XMLSEC_NO_X509 */
 
     /******************************************************************************************
@@ -3034,6 +3774,13 @@ xmlSecAppInit(void) {
         fprintf(stderr, "Error: loaded xmlsec library version is not compatible.\n");
         return(-1);
     }
+    if(xmlSecAppCmdLineParamGetString(&dtdFileParam) != NULL) {
+        ret = xmlSecDtdIDsEnableCache(4);
+        if(ret < 0) {
+            fprintf(stderr, "Error: dtd cache intialization failed.\n");
+            return(-1);
+        }
+    }
 
     /* Setup IO callbacks */
     ret = xmlSecIORegisterCallbacks(xmlSecAppInputMatchCallback,
@@ -3091,95 +3838,57 @@ xmlSecAppShutdown(void) {
 
 static xmlSecAppXmlDataPtr
 xmlSecAppXmlDataCreate(const char* filename, const xmlChar* defStartNodeName, const xmlChar* defStartNodeNs) {
-    xmlSecAppCmdLineValuePtr value;
-    xmlSecAppXmlDataPtr data;
-    xmlNodePtr cur = NULL;
-
-    xmlChar* attrName;
-    xmlChar* nodeName;
-    xmlChar* nsHref;
-    xmlChar* buf;
+    xmlDocPtr doc;
 
     if(filename == NULL) {
         fprintf(stderr, "Error: xml filename is null\n");
         return(NULL);
     }
 
+    /* parse doc */
+    doc = xmlSecParseFile(filename);
+    if(doc == NULL) {
+        fprintf(stderr, "Error: failed to parse xml file \"%s\"\n",
+                filename);
+        return(NULL);
+    }
+    return(xmlSecAppXmlDataCreateFromDoc(doc, defStartNodeName, defStartNodeNs));
+}
+
+/* takes ownership of the doc */
+static xmlSecAppXmlDataPtr
+xmlSecAppXmlDataCreateFromDoc(xmlDocPtr doc, const xmlChar* defStartNodeName, const xmlChar* defStartNodeNs) {
+    xmlSecAppXmlDataPtr data;
+    xmlNodePtr cur = NULL;
+    xmlChar* buf;
+
     /* create object */
     data = (xmlSecAppXmlDataPtr) xmlMalloc(sizeof(xmlSecAppXmlData));
     if(data == NULL) {
         fprintf(stderr, "Error: failed to create xml data\n");
+        xmlFreeDoc(doc);
         return(NULL);
     }
     memset(data, 0, sizeof(xmlSecAppXmlData));
+    data->doc = doc;
 
-    /* parse doc */
-    data->doc = xmlSecParseFile(filename);
-    if(data->doc == NULL) {
-        fprintf(stderr, "Error: failed to parse xml file \"%s\"\n",
-                filename);
-        xmlSecAppXmlDataDestroy(data);
-        return(NULL);
-    }
-
-    /* load dtd and set default attrs and ids */
+    /* set ID attributes declared in the dtd (the dtd is parsed once) */
     if(xmlSecAppCmdLineParamGetString(&dtdFileParam) != NULL) {
-        xmlValidCtxt ctx;
-
-        data->dtd = xmlParseDTD(NULL, BAD_CAST xmlSecAppCmdLineParamGetString(&dtdFileParam));
-        if(data->dtd == NULL) {
-            fprintf(stderr, "Error: failed to parse dtd file \"%s\"\n",
+        if(xmlSecAddDtdIDs(data->doc, NULL, xmlSecAppCmdLineParamGetString(&dtdFileParam)) < 0) {
+            fprintf(stderr, "Error: failed to add ID attributes from dtd file \"%s\"\n",
                     xmlSecAppCmdLineParamGetString(&dtdFileParam));
             xmlSecAppXmlDataDestroy(data);
             return(NULL);
         }
-
-        memset(&ctx, 0, sizeof(ctx));
-        /* we don't care is doc actually valid or not */
-        xmlValidateDtd(&ctx, data->doc, data->dtd);
     }
 
     /* set ID attributes from command line */
-    for(value = idAttrParam.value; value != NULL; value = value->next) {
-        if(value->strValue == NULL) {
-            fprintf(stderr, "Error: invalid value for option \"%s\".\n",
-                    idAttrParam.fullName);
-            xmlSecAppXmlDataDestroy(data);
-            return(NULL);
-        }
-        attrName = (value->paramNameValue != NULL) ? BAD_CAST value->paramNameValue : BAD_CAST "id";
-
-        buf = xmlStrdup(BAD_CAST value->strValue);
-        if(buf == NULL) {
-            fprintf(stderr, "Error: failed to duplicate string \"%s\"\n", value->strValue);
-            xmlSecAppXmlDataDestroy(data);
-            return(NULL);
-        }
-        nodeName = (xmlChar*)strrchr((char*)buf, ':');
-        if(nodeName != NULL) {
-            (*(nodeName++)) = '\0';
-            nsHref = buf;
-        } else {
-            nodeName = buf;
-            nsHref = NULL;
-        }
-
-        /* process children first because it does not matter much but does simplify code */
-        cur = xmlSecGetNextElementNode(data->doc->children);
-        while(cur != NULL) {
-            if(xmlSecAppAddIDAttr(cur, attrName, nodeName, nsHref) < 0) {
-                fprintf(stderr, "Error: failed to add ID attribute \"%s\" for node \"%s\"\n", attrName, value->strValue);
-                xmlFree(buf);
-                xmlSecAppXmlDataDestroy(data);
-                return(NULL);
-            }
-            cur = xmlSecGetNextElementNode(cur->next);
-        }
-
-        xmlFree(buf);
+    if(xmlSecAppAddIDAttrs(data->doc) < 0) {
+        fprintf(stderr, "Error: failed to add ID attributes\n");
+        xmlSecAppXmlDataDestroy(data);
+        return(NULL);
     }
 
-
     /* now find the start node */
     if(xmlSecAppCmdLineParamGetString(&nodeIdParam) != NULL) {
         xmlAttrPtr attr;
@@ -3305,9 +4014,6 @@ xmlSecAppXmlDataDestroy(xmlSecAppXmlDataPtr data) {
         fprintf(stderr, "Error: xml data is null\n");
         return;
     }
-    if(data->dtd != NULL) {
-        xmlFreeDtd(data->dtd);
-    }
     if(data->doc != NULL) {
         xmlFreeDoc(data->doc);
     }
@@ -3450,6 +4156,19 @@ xmlSecAppParseCommand(const char* cmd, xmlSecAppCmdLineParamTopic* cmdLineTopics
 #endif /* XMLSEC_NO_TMPL_TEST */
 #endif /* XMLSEC_NO_XMLENC */
 
+    if((strcmp(cmd, "serve") == 0) || (strcmp(cmd, "--serve") == 0)) {
+        (*cmdLineTopics) = xmlSecAppCmdLineTopicGeneral |
+            xmlSecAppCmdLineTopicCryptoConfig |
+            xmlSecAppCmdLineTopicDSigCommon |
+            xmlSecAppCmdLineTopicDSigSign |
+            xmlSecAppCmdLineTopicEncCommon |
+            xmlSecAppCmdLineTopicEncEncrypt |
+            xmlSecAppCmdLineTopicServe |
+            xmlSecAppCmdLineTopicKeysMngr |
+            xmlSecAppCmdLineTopicX509Certs;
+        return(xmlSecAppCommandServe);
+    } else
+
     if(1) {
         (*cmdLineTopics) = 0;
         return(xmlSecAppCommandUnknown);
@@ -3502,6 +4221,9 @@ xmlSecAppPrintHelp(xmlSecAppCommand command, xmlSecAppCmdLineParamTopic topics)
     case xmlSecAppCommandEncryptTmpl:
         fprintf(stdout, "%s\n", helpEncryptTmpl);
         break;
+    case xmlSecAppCommandServe:
+        fprintf(stdout, "%s\n", helpServe);
+        break;
     }
     if(topics != 0) {
         fprintf(stdout, "Options:\n");
@@ -3663,8 +4385,11 @@ static int
 xmlSecAppWriteResult(const char* inputFileName, const char* outputFileNameTmpl, xmlDocPtr doc, xmlSecBufferPtr buffer) {
     char* outputFileName = NULL;
     xmlOutputBufferPtr outBuffer;
+    double start_time;
     int ret;
 
+    start_time = xmlSecAppBenchGetTime();
+
     /* get output filename by replacing '{inputfile}' with input file name */
     if((inputFileName != NULL) && (outputFileNameTmpl != NULL)) {
         outputFileName = xmlSecAppGetOutputFilename(inputFileName, outputFileNameTmpl);
@@ -3707,63 +4432,878 @@ xmlSecAppWriteResult(const char* inputFileName, const char* outputFileNameTmpl,
     }
 
     /* done */
+    xmlSecAppBenchAddPhase(xmlSecAppBenchPhaseOutput, start_time);
     return(0);
 }
 
 static int
-xmlSecAppAddIDAttr(xmlNodePtr node, const xmlChar* attrName, const xmlChar* nodeName, const xmlChar* nsHref) {
-    xmlAttrPtr attr, tmpAttr;
-    xmlNodePtr cur;
-    xmlChar* id;
+xmlSecAppAddIDAttrs(xmlDocPtr doc) {
+    xmlSecAppCmdLineValuePtr value;
+    xmlSecIDAttrRule* rules = NULL;
+    xmlChar** bufs = NULL;
+    xmlChar* nodeName;
+    xmlSecSize rulesSize = 0;
+    xmlSecSize ii;
+    int res = -1;
 
-    if((node == NULL) || (attrName == NULL) || (nodeName == NULL)) {
+    if(doc == NULL) {
         return(-1);
     }
 
-    /* process children first because it does not matter much but does simplify code */
-    cur = xmlSecGetNextElementNode(node->children);
-    while(cur != NULL) {
-        if(xmlSecAppAddIDAttr(cur, attrName, nodeName, nsHref) < 0) {
-            return(-1);
-        }
-        cur = xmlSecGetNextElementNode(cur->next);
+    /* all the --id-attr options are registered in one pass over the document */
+    for(value = idAttrParam.value; value != NULL; value = value->next) {
+        ++rulesSize;
     }
-
-    /* node name must match */
-    if(!xmlStrEqual(node->name, nodeName)) {
+    if(rulesSize == 0) {
         return(0);
     }
 
-    /* if nsHref is set then it also should match */
-    if((nsHref != NULL) && (node->ns != NULL) && (!xmlStrEqual(nsHref, node->ns->href))) {
-        return(0);
+    rules = (xmlSecIDAttrRule*)xmlMalloc(sizeof(xmlSecIDAttrRule) * rulesSize);
+    bufs = (xmlChar**)xmlMalloc(sizeof(xmlChar*) * rulesSize);
+    if((rules == NULL) || (bufs == NULL)) {
+        fprintf(stderr, "Error: failed to allocate ID attributes rules\n");
+        goto done;
     }
+    memset(rules, 0, sizeof(xmlSecIDAttrRule) * rulesSize);
+    memset(bufs, 0, sizeof(xmlChar*) * rulesSize);
 
-    /* the attribute with name equal to attrName should exist */
-    for(attr = node->properties; attr != NULL; attr = attr->next) {
-        if(xmlStrEqual(attr->name, attrName)) {
-            break;
+    for(value = idAttrParam.value, ii = 0; value != NULL; value = value->next, ++ii) {
+        if(value->strValue == NULL) {
+            fprintf(stderr, "Error: invalid value for option \"%s\".\n",
+                    idAttrParam.fullName);
+            goto done;
+        }
+        rules[ii].attrName = (value->paramNameValue != NULL) ? BAD_CAST value->paramNameValue : BAD_CAST "id";
+
+        bufs[ii] = xmlStrdup(BAD_CAST value->strValue);
+        if(bufs[ii] == NULL) {
+            fprintf(stderr, "Error: failed to duplicate string \"%s\"\n", value->strValue);
+            goto done;
+        }
+        nodeName = (xmlChar*)strrchr((char*)bufs[ii], ':');
+        if(nodeName != NULL) {
+            (*(nodeName++)) = '\0';
+            rules[ii].nodeName = nodeName;
+            rules[ii].nodeNsHref = bufs[ii];
+        } else {
+            rules[ii].nodeName = bufs[ii];
+            rules[ii].nodeNsHref = NULL;
         }
     }
-    if(attr == NULL) {
-        return(0);
+
+    if(xmlSecAddIDAttrs(doc, NULL, rules, rulesSize) < 0) {
+        fprintf(stderr, "Error: failed to add ID attributes (duplicate ID?)\n");
+        goto done;
     }
 
-    /* and this attr should have a value */
-    id = xmlNodeListGetString(node->doc, attr->children, 1);
-    if(id == NULL) {
-        return(0);
+    /* success */
+    res = 0;
+
+done:
+    if(bufs != NULL) {
+        for(ii = 0; ii < rulesSize; ++ii) {
+            if(bufs[ii] != NULL) {
+                xmlFree(bufs[ii]);
+            }
+        }
+        xmlFree(bufs);
+    }
+    if(rules != NULL) {
+        xmlFree(rules);
     }
+    return(res);
+}
+
+/****************************************************************
+ *
+ * Benchmark ("--bench" and "--repeat")
+ *
+ ****************************************************************/
+static double
+xmlSecAppBenchGetTime(void) {
+#if defined(XMLSEC_WINDOWS)
+    LARGE_INTEGER counter, freq;
+
+    if(!QueryPerformanceFrequency(&freq) || !QueryPerformanceCounter(&counter) || (freq.QuadPart <= 0)) {
+        return((double)time(NULL));
+    }
+    return((double)counter.QuadPart / (double)freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return((double)time(NULL));
+    }
+    return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+#else  /* defined(XMLSEC_WINDOWS) */
+    return((double)clock() / (double)CLOCKS_PER_SEC);
+#endif /* defined(XMLSEC_WINDOWS) */
+}
+
+/* returns the peak resident set size in KB or -1 if it is not available */
+static long
+xmlSecAppBenchGetPeakRss(void) {
+#if !defined(XMLSEC_WINDOWS)
+    struct rusage usage;
 
-    /* check that we don't have same ID already */
-    tmpAttr = xmlGetID(node->doc, id);
-    if(tmpAttr == NULL) {
-        xmlAddID(NULL, node->doc, id, attr);
-    } else if(tmpAttr != attr) {
-        fprintf(stderr, "Error: duplicate ID attribute \"%s\"\n", id);
-        xmlFree(id);
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
         return(-1);
     }
-    xmlFree(id);
+#if defined(__APPLE__)
+    return((long)(usage.ru_maxrss / 1024)); /* bytes on macOS */
+#else  /* defined(__APPLE__) */
+    return((long)usage.ru_maxrss);
+#endif /* defined(__APPLE__) */
+#else  /* !defined(XMLSEC_WINDOWS) */
+    return(-1);
+#endif /* !defined(XMLSEC_WINDOWS) */
+}
+
+static void
+xmlSecAppBenchAddPhase(xmlSecAppBenchPhase phase, double startTime) {
+    g_benchPhases[phase] += xmlSecAppBenchGetTime() - startTime;
+}
+
+static xmlSecKeyPtr
+xmlSecAppBenchGetKey(xmlNodePtr keyInfoNode, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecKeyPtr key;
+    double start_time;
+
+    start_time = xmlSecAppBenchGetTime();
+    key = g_benchGetKey(keyInfoNode, keyInfoCtx);
+    xmlSecAppBenchAddPhase(xmlSecAppBenchPhaseKeys, start_time);
+    return(key);
+}
+
+#ifndef XMLSEC_NO_XMLDSIG
+/* digests the references one by one in the current thread to time them */
+static int
+xmlSecAppBenchReferencesExecutor(void* executorCtx, xmlSecDSigReferenceExecuteTask task,
+                                 xmlSecDSigReferenceCtxPtr* dsigRefCtxs, xmlSecSize size) {
+    double start_time;
+    xmlSecSize ii;
+
+    UNREFERENCED_PARAMETER(executorCtx);
+    start_time = xmlSecAppBenchGetTime();
+    for(ii = 0; ii < size; ++ii) {
+        /* failures are recorded in the reference ctx */
+        (void)task(dsigRefCtxs[ii]);
+    }
+    xmlSecAppBenchAddPhase(xmlSecAppBenchPhaseReferences, start_time);
     return(0);
 }
+#endif /* XMLSEC_NO_XMLDSIG */
+
+static int
+xmlSecAppBenchInit(int runs) {
+    memset(g_benchPhases, 0, sizeof(g_benchPhases));
+    memset(g_benchPhasesTotal, 0, sizeof(g_benchPhasesTotal));
+    g_benchSamplesNum = 0;
+
+    g_benchSamples = (double*)xmlMalloc(sizeof(double) * (size_t)runs);
+    if(g_benchSamples == NULL) {
+        fprintf(stderr, "Error: can not allocate memory (" XMLSEC_SIZE_T_FMT " bytes)\n",
+            sizeof(double) * (size_t)runs);
+        return(-1);
+    }
+
+    /* time the key resolution */
+    if(xmlSecAppCmdLineParamIsSet(&benchPhasesParam) && (g_keysManager != NULL)) {
+        g_benchGetKey = g_keysManager->getKey;
+        g_keysManager->getKey = xmlSecAppBenchGetKey;
+    }
+    return(0);
+}
+
+static void
+xmlSecAppBenchShutdown(void) {
+    if((g_benchGetKey != NULL) && (g_keysManager != NULL)) {
+        g_keysManager->getKey = g_benchGetKey;
+        g_benchGetKey = NULL;
+    }
+    if(g_benchSamples != NULL) {
+        xmlFree(g_benchSamples);
+        g_benchSamples = NULL;
+    }
+    g_benchSamplesNum = 0;
+}
+
+static int
+xmlSecAppBenchCompareSamples(const void* a, const void* b) {
+    double aa = *(const double*)a;
+    double bb = *(const double*)b;
+
+    return((aa < bb) ? -1 : ((aa > bb) ? 1 : 0));
+}
+
+/* nearest rank percentile in msec */
+static double
+xmlSecAppBenchGetPercentile(int percentile) {
+    int pos;
+
+    pos = (percentile * g_benchSamplesNum + 99) / 100 - 1;
+    if(pos < 0) {
+        pos = 0;
+    }
+    return(1000 * g_benchSamples[pos]);
+}
+
+static int
+xmlSecAppBenchPrint(xmlSecAppCommand command, int warmup) {
+    const char* jsonFileName;
+    const char* opPhaseName;
+    double total = 0;
+    double phases[xmlSecAppBenchPhaseNum + 1];
+    long peakRss;
+    FILE* f;
+    int ii;
+
+    if(g_benchSamplesNum <= 0) {
+        return(0);
+    }
+    peakRss = xmlSecAppBenchGetPeakRss();
+    for(ii = 0; ii < g_benchSamplesNum; ++ii) {
+        total += g_benchSamples[ii];
+    }
+    qsort(g_benchSamples, (size_t)g_benchSamplesNum, sizeof(double), xmlSecAppBenchCompareSamples);
+
+    /* per op phases (msec); the operation itself is whatever is left */
+    for(ii = 0; ii < xmlSecAppBenchPhaseNum; ++ii) {
+        phases[ii] = 1000 * g_benchPhasesTotal[ii] / g_benchSamplesNum;
+    }
+    phases[xmlSecAppBenchPhaseNum] = 1000 * total / g_benchSamplesNum - phases[xmlSecAppBenchPhaseParse]
+        - phases[xmlSecAppBenchPhaseKeys] - phases[xmlSecAppBenchPhaseReferences];
+    if(phases[xmlSecAppBenchPhaseNum] < 0) {
+        phases[xmlSecAppBenchPhaseNum] = 0;
+    }
+    switch(command) {
+    case xmlSecAppCommandSign:
+    case xmlSecAppCommandVerify:
+    case xmlSecAppCommandSignTmpl:
+        opPhaseName = "signature";
+        break;
+    case xmlSecAppCommandEncrypt:
+    case xmlSecAppCommandDecrypt:
+    case xmlSecAppCommandEncryptTmpl:
+        opPhaseName = "encryption";
+        break;
+    default:
+        opPhaseName = "operation";
+        break;
+    }
+
+    fprintf(stderr, "Benchmark: %d runs (%d warmup) in %.2f msec, %.2f ops/sec\n",
+        g_benchSamplesNum, warmup, 1000 * total, (total > 0) ? g_benchSamplesNum / total : 0);
+    fprintf(stderr, "Latency (msec): min=%.3f p50=%.3f p90=%.3f p99=%.3f max=%.3f\n",
+        1000 * g_benchSamples[0], xmlSecAppBenchGetPercentile(50),
+        xmlSecAppBenchGetPercentile(90), xmlSecAppBenchGetPercentile(99),
+        1000 * g_benchSamples[g_benchSamplesNum - 1]);
+    if(xmlSecAppCmdLineParamIsSet(&benchPhasesParam)) {
+        fprintf(stderr, "Phases (msec/op): parse=%.3f keys=%.3f references=%.3f %s=%.3f\n",
+            phases[xmlSecAppBenchPhaseParse], phases[xmlSecAppBenchPhaseKeys],
+            phases[xmlSecAppBenchPhaseReferences], opPhaseName, phases[xmlSecAppBenchPhaseNum]);
+    }
+    if(peakRss >= 0) {
+        fprintf(stderr, "Peak memory usage: %ld KB\n", peakRss);
+    }
+
+    jsonFileName = xmlSecAppCmdLineParamGetString(&benchJsonParam);
+    if(jsonFileName == NULL) {
+        return(0);
+    }
+    if(strcmp(jsonFileName, "-") == 0) {
+        f = stdout;
+    } else {
+        f = fopen(jsonFileName, "w");
+        if(f == NULL) {
+            fprintf(stderr, "Error: failed to open file \"%s\"\n", jsonFileName);
+            return(-1);
+        }
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"runs\": %d,\n", g_benchSamplesNum);
+    fprintf(f, "  \"warmup\": %d,\n", warmup);
+    fprintf(f, "  \"total_msec\": %.3f,\n", 1000 * total);
+    fprintf(f, "  \"ops_per_sec\": %.3f,\n", (total > 0) ? g_benchSamplesNum / total : 0);
+    fprintf(f, "  \"latency_msec\": { \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f }",
+        1000 * g_benchSamples[0], xmlSecAppBenchGetPercentile(50),
+        xmlSecAppBenchGetPercentile(90), xmlSecAppBenchGetPercentile(99),
+        1000 * g_benchSamples[g_benchSamplesNum - 1]);
+    if(xmlSecAppCmdLineParamIsSet(&benchPhasesParam)) {
+        fprintf(f, ",\n  \"phases_msec\": { \"parse\": %.3f, \"keys\": %.3f, \"references\": %.3f, \"%s\": %.3f }",
+            phases[xmlSecAppBenchPhaseParse], phases[xmlSecAppBenchPhaseKeys],
+            phases[xmlSecAppBenchPhaseReferences], opPhaseName, phases[xmlSecAppBenchPhaseNum]);
+    }
+    if(peakRss >= 0) {
+        fprintf(f, ",\n  \"peak_rss_kb\": %ld", peakRss);
+    }
+    fprintf(f, "\n}\n");
+    if(f != stdout) {
+        fclose(f);
+    }
+    return(0);
+}
+
+/****************************************************************
+ *
+ * Server ("serve" command)
+ *
+ ****************************************************************/
+#if defined(XMLSEC_APP_SERVE)
+
+#define XMLSEC_APP_SERVE_MAX_HEADER_SIZE        128
+#define XMLSEC_APP_SERVE_MAX_REQUEST_SIZE       (64 * 1024 * 1024)
+#define XMLSEC_APP_SERVE_QUEUE_SIZE             64
+
+typedef struct _xmlSecAppServer                 xmlSecAppServer,
+                                                *xmlSecAppServerPtr;
+typedef struct _xmlSecAppServerWorker           xmlSecAppServerWorker,
+                                                *xmlSecAppServerWorkerPtr;
+
+struct _xmlSecAppServerWorker {
+    xmlSecAppServerPtr  server;
+    pthread_t           thread;
+    int                 fd;             /* the connection in progress or -1 */
+};
+
+struct _xmlSecAppServer {
+    pthread_mutex_t     mutex;          /* protects the queue, workers fds and stop */
+    pthread_cond_t      cond;           /* the queue or stop changed */
+    pthread_rwlock_t    keysLock;       /* g_keysManager: read by requests, replaced by reload */
+    int                 queue[XMLSEC_APP_SERVE_QUEUE_SIZE];
+    int                 queueStart;
+    int                 queueSize;
+    int                 stop;
+    xmlSecAppServerWorkerPtr workers;
+    int                 workersNum;
+};
+
+static volatile sig_atomic_t g_serveReload = 0;
+static volatile sig_atomic_t g_serveStop = 0;
+
+static void
+xmlSecAppServeSignalHandler(int sig) {
+    if(sig == SIGHUP) {
+        g_serveReload = 1;
+    } else {
+        g_serveStop = 1;
+    }
+}
+
+static int
+xmlSecAppServeRead(int fd, xmlSecByte* buf, xmlSecSize size) {
+    ssize_t ret;
+
+    while(size > 0) {
+        ret = read(fd, buf, size);
+        if((ret < 0) && (errno == EINTR)) {
+            continue;
+        } else if(ret <= 0) {
+            return(-1);
+        }
+        buf += ret;
+        size -= (xmlSecSize)ret;
+    }
+    return(0);
+}
+
+static int
+xmlSecAppServeWrite(int fd, const xmlSecByte* buf, xmlSecSize size) {
+    ssize_t ret;
+
+    while(size > 0) {
+        ret = write(fd, buf, size);
+        if((ret < 0) && (errno == EINTR)) {
+            continue;
+        } else if(ret <= 0) {
+            return(-1);
+        }
+        buf += ret;
+        size -= (xmlSecSize)ret;
+    }
+    return(0);
+}
+
+/* returns 1 if the header line is read, 0 on EOF and -1 on error */
+static int
+xmlSecAppServeReadHeader(int fd, char* buf, size_t bufSize) {
+    size_t pos = 0;
+    ssize_t ret;
+
+    while(pos + 1 < bufSize) {
+        ret = read(fd, buf + pos, 1);
+        if((ret < 0) && (errno == EINTR)) {
+            continue;
+        } else if(ret < 0) {
+            return(-1);
+        } else if(ret == 0) {
+            return((pos == 0) ? 0 : -1);
+        }
+        if(buf[pos] == '\n') {
+            buf[pos] = '\0';
+            return(1);
+        }
+        ++pos;
+    }
+    /* too long */
+    return(-1);
+}
+
+static int
+xmlSecAppServeWriteResponse(int fd, const char* status, const xmlSecByte* data, xmlSecSize size) {
+    char header[XMLSEC_APP_SERVE_MAX_HEADER_SIZE];
+    int len;
+
+    len = snprintf(header, sizeof(header), "%s " XMLSEC_SIZE_FMT "\n", status, size);
+    if((len <= 0) || ((size_t)len >= sizeof(header))) {
+        return(-1);
+    }
+    if(xmlSecAppServeWrite(fd, (const xmlSecByte*)header, (xmlSecSize)len) < 0) {
+        return(-1);
+    }
+    if((size > 0) && (xmlSecAppServeWrite(fd, data, size) < 0)) {
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecAppServeSetDocResult(xmlDocPtr doc, xmlSecBufferPtr out) {
+    xmlChar* buf = NULL;
+    int size = 0;
+    int ret;
+
+    xmlDocDumpMemory(doc, &buf, &size);
+    if((buf == NULL) || (size < 0)) {
+        return(-1);
+    }
+    ret = xmlSecBufferSetData(out, buf, (xmlSecSize)size);
+    xmlFree(buf);
+    return(ret);
+}
+
+/* returns 0 if the status is set: "OK" (@out is the result) or "FAILED" (@out is the reason) */
+static int
+xmlSecAppServeDSig(int sign, const xmlSecByte* data, xmlSecSize size, xmlSecBufferPtr out, const char** status) {
+#ifndef XMLSEC_NO_XMLDSIG
+    xmlSecAppXmlDataPtr xmlData = NULL;
+    xmlSecDSigCtx dsigCtx;
+    xmlDocPtr doc;
+    const char* reason;
+    int res = -1;
+
+    if(xmlSecDSigCtxInitialize(&dsigCtx, g_keysManager) < 0) {
+        return(-1);
+    }
+    if(xmlSecAppPrepareDSigCtx(&dsigCtx) < 0) {
+        goto done;
+    }
+    doc = xmlSecParseMemory(data, size, 0);
+    if(doc == NULL) {
+        goto done;
+    }
+    xmlData = xmlSecAppXmlDataCreateFromDoc(doc, xmlSecNodeSignature, xmlSecDSigNs);
+    if(xmlData == NULL) {
+        goto done;
+    }
+
+    if(sign != 0) {
+        if(xmlSecDSigCtxSign(&dsigCtx, xmlData->startNode) < 0) {
+            goto done;
+        }
+    } else {
+        if(xmlSecDSigCtxVerify(&dsigCtx, xmlData->startNode) < 0) {
+            goto done;
+        }
+    }
+
+    if(dsigCtx.status == xmlSecDSigStatusSucceeded) {
+        if((sign != 0) && (xmlSecAppServeSetDocResult(xmlData->doc, out) < 0)) {
+            goto done;
+        }
+        (*status) = "OK";
+    } else {
+        reason = xmlSecDSigCtxGetFailureReasonString(dsigCtx.failureReason);
+        if(xmlSecBufferSetData(out, (const xmlSecByte*)reason, (xmlSecSize)strlen(reason)) < 0) {
+            goto done;
+        }
+        (*status) = "FAILED";
+    }
+    res = 0;
+
+done:
+    xmlSecDSigCtxFinalize(&dsigCtx);
+    if(xmlData != NULL) {
+        xmlSecAppXmlDataDestroy(xmlData);
+    }
+    return(res);
+#else  /* XMLSEC_NO_XMLDSIG */
+    UNREFERENCED_PARAMETER(sign);
+    UNREFERENCED_PARAMETER(data);
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(out);
+    UNREFERENCED_PARAMETER(status);
+    return(-1);
+#endif /* XMLSEC_NO_XMLDSIG */
+}
+
+/* returns 0 if the status is set: "OK" (@out is the result) or "FAILED" (@out is the reason) */
+static int
+xmlSecAppServeEnc(int encrypt, const xmlSecByte* data, xmlSecSize size,
+                  const xmlSecByte* binData, xmlSecSize binDataSize,
+                  xmlSecBufferPtr out, const char** status) {
+#ifndef XMLSEC_NO_XMLENC
+    xmlSecAppXmlDataPtr xmlData = NULL;
+    xmlSecEncCtx encCtx;
+    xmlDocPtr doc;
+    const char* reason;
+    int ret;
+    int res = -1;
+
+    if(xmlSecEncCtxInitialize(&encCtx, g_keysManager) < 0) {
+        return(-1);
+    }
+    if(xmlSecAppPrepareEncCtx(&encCtx) < 0) {
+        goto done;
+    }
+    doc = xmlSecParseMemory(data, size, 0);
+    if(doc == NULL) {
+        goto done;
+    }
+    xmlData = xmlSecAppXmlDataCreateFromDoc(doc, xmlSecNodeEncryptedData, xmlSecEncNs);
+    if(xmlData == NULL) {
+        goto done;
+    }
+
+    if(encrypt != 0) {
+        ret = xmlSecEncCtxBinaryEncrypt(&encCtx, xmlData->startNode, binData, binDataSize);
+    } else {
+        ret = xmlSecEncCtxDecrypt(&encCtx, xmlData->startNode);
+    }
+    if(ret < 0) {
+        if(encCtx.failureReason == xmlSecEncFailureReasonUnknown) {
+            goto done;
+        }
+        reason = xmlSecEncCtxGetFailureReasonString(encCtx.failureReason);
+        if(xmlSecBufferSetData(out, (const xmlSecByte*)reason, (xmlSecSize)strlen(reason)) < 0) {
+            goto done;
+        }
+        (*status) = "FAILED";
+    } else if(encCtx.resultReplaced) {
+        if(xmlSecAppServeSetDocResult(xmlData->doc, out) < 0) {
+            goto done;
+        }
+        (*status) = "OK";
+    } else {
+        if(xmlSecBufferSetData(out, xmlSecBufferGetData(encCtx.result), xmlSecBufferGetSize(encCtx.result)) < 0) {
+            goto done;
+        }
+        (*status) = "OK";
+    }
+    res = 0;
+
+done:
+    xmlSecEncCtxFinalize(&encCtx);
+    if(xmlData != NULL) {
+        xmlSecAppXmlDataDestroy(xmlData);
+    }
+    return(res);
+#else  /* XMLSEC_NO_XMLENC */
+    UNREFERENCED_PARAMETER(encrypt);
+    UNREFERENCED_PARAMETER(data);
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(binData);
+    UNREFERENCED_PARAMETER(binDataSize);
+    UNREFERENCED_PARAMETER(out);
+    UNREFERENCED_PARAMETER(status);
+    return(-1);
+#endif /* XMLSEC_NO_XMLENC */
+}
+
+/* processes the requests from one connection until EOF or error */
+static void
+xmlSecAppServeConnection(xmlSecAppServerPtr server, int fd) {
+    char header[XMLSEC_APP_SERVE_MAX_HEADER_SIZE];
+    char op[16];
+    unsigned long size, binDataSize;
+    xmlSecByte* data = NULL;
+    xmlSecBuffer out;
+    const char* status;
+    const char* error;
+    int fields;
+    int ret;
+
+    if(xmlSecBufferInitialize(&out, 0) < 0) {
+        return;
+    }
+    while(1) {
+        ret = xmlSecAppServeReadHeader(fd, header, sizeof(header));
+        if(ret <= 0) {
+            break;
+        }
+
+        binDataSize = 0;
+        fields = sscanf(header, "%15s %lu %lu", op, &size, &binDataSize);
+        if((fields < 2) || (size > XMLSEC_APP_SERVE_MAX_REQUEST_SIZE) ||
+           (binDataSize > XMLSEC_APP_SERVE_MAX_REQUEST_SIZE)) {
+            error = "invalid request header";
+            (void)xmlSecAppServeWriteResponse(fd, "ERROR", (const xmlSecByte*)error, (xmlSecSize)strlen(error));
+            break;
+        }
+
+        data = (xmlSecByte*)xmlMalloc(size + binDataSize + 1);
+        if(data == NULL) {
+            break;
+        }
+        if(xmlSecAppServeRead(fd, data, (xmlSecSize)(size + binDataSize)) < 0) {
+            break;
+        }
+
+        /* process */
+        status = NULL;
+        xmlSecBufferEmpty(&out);
+        pthread_rwlock_rdlock(&(server->keysLock));
+        if(strcmp(op, "sign") == 0) {
+            ret = xmlSecAppServeDSig(1, data, (xmlSecSize)size, &out, &status);
+        } else if(strcmp(op, "verify") == 0) {
+            ret = xmlSecAppServeDSig(0, data, (xmlSecSize)size, &out, &status);
+        } else if((strcmp(op, "encrypt") == 0) && (fields == 3)) {
+            ret = xmlSecAppServeEnc(1, data, (xmlSecSize)size, data + size, (xmlSecSize)binDataSize, &out, &status);
+        } else if(strcmp(op, "decrypt") == 0) {
+            ret = xmlSecAppServeEnc(0, data, (xmlSecSize)size, NULL, 0, &out, &status);
+        } else {
+            ret = -1;
+        }
+        pthread_rwlock_unlock(&(server->keysLock));
+        xmlFree(data);
+        data = NULL;
+
+        if((ret < 0) || (status == NULL)) {
+            error = "failed to process request";
+            ret = xmlSecAppServeWriteResponse(fd, "ERROR", (const xmlSecByte*)error, (xmlSecSize)strlen(error));
+        } else {
+            ret = xmlSecAppServeWriteResponse(fd, status, xmlSecBufferGetData(&out), xmlSecBufferGetSize(&out));
+        }
+        if(ret < 0) {
+            break;
+        }
+    }
+
+    if(data != NULL) {
+        xmlFree(data);
+    }
+    xmlSecBufferFinalize(&out);
+}
+
+static void*
+xmlSecAppServeWorkerThread(void* arg) {
+    xmlSecAppServerWorkerPtr worker = (xmlSecAppServerWorkerPtr)arg;
+    xmlSecAppServerPtr server = worker->server;
+    int fd;
+
+    while(1) {
+        pthread_mutex_lock(&(server->mutex));
+        while((server->queueSize == 0) && (server->stop == 0)) {
+            pthread_cond_wait(&(server->cond), &(server->mutex));
+        }
+        if(server->queueSize == 0) {
+            pthread_mutex_unlock(&(server->mutex));
+            break;
+        }
+        fd = server->queue[server->queueStart];
+        server->queueStart = (server->queueStart + 1) % XMLSEC_APP_SERVE_QUEUE_SIZE;
+        --server->queueSize;
+        worker->fd = fd;
+        pthread_cond_broadcast(&(server->cond));
+        pthread_mutex_unlock(&(server->mutex));
+
+        xmlSecAppServeConnection(server, fd);
+
+        pthread_mutex_lock(&(server->mutex));
+        worker->fd = -1;
+        pthread_mutex_unlock(&(server->mutex));
+        close(fd);
+    }
+    return(NULL);
+}
+
+static int
+xmlSecAppServeReloadKeys(xmlSecAppServerPtr server) {
+    xmlSecKeysMngrPtr oldKeysManager;
+    int res = -1;
+
+    /* wait for the requests in progress */
+    pthread_rwlock_wrlock(&(server->keysLock));
+    oldKeysManager = g_keysManager;
+    g_keysManager = NULL;
+    if(xmlSecAppLoadKeys() < 0) {
+        fprintf(stderr, "Error: failed to reload keys, keeping the old keys\n");
+        if(g_keysManager != NULL) {
+            xmlSecKeysMngrDestroy(g_keysManager);
+        }
+        g_keysManager = oldKeysManager;
+    } else {
+        if(oldKeysManager != NULL) {
+            xmlSecKeysMngrDestroy(oldKeysManager);
+        }
+        res = 0;
+    }
+    pthread_rwlock_unlock(&(server->keysLock));
+    return(res);
+}
+
+static int
+xmlSecAppServe(const char* socketPath, int threadsNum) {
+    xmlSecAppServer server;
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    int listenFd = -1;
+    int started = 0;
+    int fd, ii;
+    int res = -1;
+
+    if(socketPath == NULL) {
+        fprintf(stderr, "Error: socket path is not specified\n");
+        return(-1);
+    }
+    if(strlen(socketPath) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket path \"%s\" is too long\n", socketPath);
+        return(-1);
+    }
+    if(threadsNum <= 0) {
+        fprintf(stderr, "Error: threads number should be greater than zero\n");
+        return(-1);
+    }
+
+    memset(&server, 0, sizeof(server));
+    pthread_mutex_init(&(server.mutex), NULL);
+    pthread_cond_init(&(server.cond), NULL);
+    pthread_rwlock_init(&(server.keysLock), NULL);
+
+    /* no SA_RESTART: accept() returns on signals */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = xmlSecAppServeSignalHandler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFd < 0) {
+        fprintf(stderr, "Error: failed to create socket (errno=%d)\n", errno);
+        goto done;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    (void)unlink(socketPath);
+    if(bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Error: failed to bind socket \"%s\" (errno=%d)\n", socketPath, errno);
+        goto done;
+    }
+    if(listen(listenFd, XMLSEC_APP_SERVE_QUEUE_SIZE) < 0) {
+        fprintf(stderr, "Error: failed to listen on socket \"%s\" (errno=%d)\n", socketPath, errno);
+        goto done;
+    }
+
+    /* start workers */
+    server.workers = (xmlSecAppServerWorkerPtr)xmlMalloc(sizeof(xmlSecAppServerWorker) * (size_t)threadsNum);
+    if(server.workers == NULL) {
+        fprintf(stderr, "Error: can not allocate memory (" XMLSEC_SIZE_T_FMT " bytes)\n",
+            sizeof(xmlSecAppServerWorker) * (size_t)threadsNum);
+        goto done;
+    }
+    for(started = 0; started < threadsNum; ++started) {
+        server.workers[started].server = &server;
+        server.workers[started].fd = -1;
+        if(pthread_create(&(server.workers[started].thread), NULL, xmlSecAppServeWorkerThread, &(server.workers[started])) != 0) {
+            fprintf(stderr, "Error: failed to start worker thread\n");
+            break;
+        }
+    }
+    server.workersNum = started;
+    if(started == 0) {
+        goto done;
+    }
+    fprintf(stderr, "Serving requests on \"%s\" with %d threads\n", socketPath, started);
+
+    /* accept connections until SIGINT or SIGTERM */
+    while(g_serveStop == 0) {
+        if(g_serveReload != 0) {
+            g_serveReload = 0;
+            if(xmlSecAppServeReloadKeys(&server) == 0) {
+                fprintf(stderr, "Keys reloaded\n");
+            }
+        }
+
+        fd = accept(listenFd, NULL, NULL);
+        if(fd < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error: failed to accept connection (errno=%d)\n", errno);
+            break;
+        }
+
+        pthread_mutex_lock(&(server.mutex));
+        while((server.queueSize >= XMLSEC_APP_SERVE_QUEUE_SIZE) && (g_serveStop == 0)) {
+            pthread_cond_wait(&(server.cond), &(server.mutex));
+        }
+        if(server.queueSize < XMLSEC_APP_SERVE_QUEUE_SIZE) {
+            server.queue[(server.queueStart + server.queueSize) % XMLSEC_APP_SERVE_QUEUE_SIZE] = fd;
+            ++server.queueSize;
+            pthread_cond_broadcast(&(server.cond));
+        } else {
+            close(fd);
+        }
+        pthread_mutex_unlock(&(server.mutex));
+    }
+    res = 0;
+
+done:
+    /* stop workers: drop the queued connections and wake up the ones in progress */
+    if(server.workersNum > 0) {
+        pthread_mutex_lock(&(server.mutex));
+        server.stop = 1;
+        while(server.queueSize > 0) {
+            close(server.queue[server.queueStart]);
+            server.queueStart = (server.queueStart + 1) % XMLSEC_APP_SERVE_QUEUE_SIZE;
+            --server.queueSize;
+        }
+        for(ii = 0; ii < server.workersNum; ++ii) {
+            if(server.workers[ii].fd >= 0) {
+                shutdown(server.workers[ii].fd, SHUT_RD);
+            }
+        }
+        pthread_cond_broadcast(&(server.cond));
+        pthread_mutex_unlock(&(server.mutex));
+
+        for(ii = 0; ii < server.workersNum; ++ii) {
+            pthread_join(server.workers[ii].thread, NULL);
+        }
+    }
+    if(server.workers != NULL) {
+        xmlFree(server.workers);
+    }
+    if(listenFd >= 0) {
+        close(listenFd);
+        (void)unlink(socketPath);
+    }
+    pthread_rwlock_destroy(&(server.keysLock));
+    pthread_cond_destroy(&(server.cond));
+    pthread_mutex_destroy(&(server.mutex));
+    return(res);
+}
+
+#else  /* defined(XMLSEC_APP_SERVE) */
+
+static int
+xmlSecAppServe(const char* socketPath, int threadsNum) {
+    UNREFERENCED_PARAMETER(socketPath);
+    UNREFERENCED_PARAMETER(threadsNum);
+    fprintf(stderr, "Error: server mode is not supported on this platform\n");
+    return(-1);
+}
+
+#endif /* defined(XMLSEC_APP_SERVE) */
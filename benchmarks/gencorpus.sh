@@ -0,0 +1,257 @@
+#!/bin/sh
+#
+# XML Security Library benchmarks: synthetic large documents generator
+#
+# Usage:
+#       gencorpus.sh <shape> <size> <output-file> [<tests-folder>]
+#
+# Generates a signature template (or a CRL) of the given shape and size:
+#
+#   saml <assertions>     SAML 2.0 Response with <assertions> assertions and
+#                         the enveloped signature over the Response; sign and
+#                         verify with
+#                           --id-attr:ID urn:oasis:names:tc:SAML:2.0:protocol:Response
+#   wsse <references>     SOAP envelope with WS-Security header and the
+#                         signature with <references> references to the Body
+#                         and the header blocks; sign and verify with
+#                           --id-attr:Id http://schemas.xmlsoap.org/soap/envelope/:Body
+#                           --id-attr:Id urn:xmlsec:bench:Block
+#   enveloped <bytes>     document of about <bytes> bytes (K, M and G suffixes
+#                         are supported) with the enveloped signature
+#   deep <depth>          document with <depth> nested elements and the
+#                         enveloped signature
+#   filter2 <nodes>       document with <nodes> items and the signature with
+#                         the XPath Filter 2.0 transform that selects most of
+#                         the items
+#   crl <entries>         PEM CRL with <entries> revoked certificates issued by
+#                         the "keys/ca2cert.pem" CA from the <tests-folder>
+#                         (requires openssl command line tool)
+#
+# The templates use the RSA-SHA256 signature with the "rsakey" key name and
+# an empty X509Data node, sign them with
+#       --pkcs12:rsakey <tests-folder>/keys/rsakey.p12 --pwd secret123
+# and verify with the "keys/cacert.pem" trusted and the "keys/ca2cert.pem"
+# untrusted certificates (see runcorpus.sh).
+#
+# This is free software; see Copyright file in the source
+# distribution for preciese wording.
+#
+# Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+#
+
+shape="$1"
+size="$2"
+output="$3"
+topfolder="$4"
+
+if [ "z$shape" = "z" ] || [ "z$size" = "z" ] || [ "z$output" = "z" ] ; then
+    echo "Usage: $0 <shape> <size> <output-file> [<tests-folder>]" 1>&2
+    exit 1
+fi
+if [ "z$topfolder" = "z" ] ; then
+    topfolder=`dirname $0`/../tests
+fi
+
+#
+# Converts size with optional K, M or G suffix to a number
+#
+parse_size() {
+    echo "$1" | awk '
+        /^[0-9]+$/  { print $0; exit 0 }
+        /^[0-9]+[kK]$/ { print substr($0, 1, length($0) - 1) * 1024; exit 0 }
+        /^[0-9]+[mM]$/ { print substr($0, 1, length($0) - 1) * 1024 * 1024; exit 0 }
+        /^[0-9]+[gG]$/ { print substr($0, 1, length($0) - 1) * 1024 * 1024 * 1024; exit 0 }
+        { exit 1 }
+    '
+}
+
+count=`parse_size "$size"`
+if [ $? != 0 ] || [ "z$count" = "z" ] || [ "$count" -le 0 ] ; then
+    echo "Error: invalid size \"$size\"" 1>&2
+    exit 1
+fi
+
+#
+# Prints the signature template: <uri> <transforms>
+#
+print_signature() {
+    cat <<EOF
+<Signature xmlns="http://www.w3.org/2000/09/xmldsig#">
+<SignedInfo>
+<CanonicalizationMethod Algorithm="http://www.w3.org/2001/10/xml-exc-c14n#"/>
+<SignatureMethod Algorithm="http://www.w3.org/2001/04/xmldsig-more#rsa-sha256"/>
+<Reference URI="$1">
+<Transforms>
+$2
+</Transforms>
+<DigestMethod Algorithm="http://www.w3.org/2001/04/xmlenc#sha256"/>
+<DigestValue></DigestValue>
+</Reference>
+</SignedInfo>
+<SignatureValue></SignatureValue>
+<KeyInfo>
+<KeyName>rsakey</KeyName>
+<X509Data/>
+</KeyInfo>
+</Signature>
+EOF
+}
+
+TRANSFORM_ENVELOPED='<Transform Algorithm="http://www.w3.org/2000/09/xmldsig#enveloped-signature"/>'
+TRANSFORM_C14N='<Transform Algorithm="http://www.w3.org/2001/10/xml-exc-c14n#"/>'
+
+case "$shape" in
+saml)
+    (
+    echo '<?xml version="1.0" encoding="UTF-8"?>'
+    echo '<samlp:Response xmlns:samlp="urn:oasis:names:tc:SAML:2.0:protocol" xmlns:saml="urn:oasis:names:tc:SAML:2.0:assertion" ID="_response" Version="2.0" IssueInstant="2023-01-01T00:00:00Z" Destination="https://sp.example.com/acs">'
+    echo '<saml:Issuer>https://idp.example.com/</saml:Issuer>'
+    print_signature "#_response" "$TRANSFORM_ENVELOPED
+$TRANSFORM_C14N"
+    echo '<samlp:Status><samlp:StatusCode Value="urn:oasis:names:tc:SAML:2.0:status:Success"/></samlp:Status>'
+    awk -v count="$count" 'BEGIN {
+        for(ii = 0; ii < count; ++ii) {
+            printf("<saml:Assertion ID=\"_assertion-%d\" Version=\"2.0\" IssueInstant=\"2023-01-01T00:00:00Z\">\n", ii);
+            printf("<saml:Issuer>https://idp.example.com/</saml:Issuer>\n");
+            printf("<saml:Subject><saml:NameID Format=\"urn:oasis:names:tc:SAML:1.1:nameid-format:emailAddress\">user%d@example.com</saml:NameID>\n", ii);
+            printf("<saml:SubjectConfirmation Method=\"urn:oasis:names:tc:SAML:2.0:cm:bearer\"><saml:SubjectConfirmationData NotOnOrAfter=\"2023-01-01T00:05:00Z\" Recipient=\"https://sp.example.com/acs\"/></saml:SubjectConfirmation></saml:Subject>\n");
+            printf("<saml:Conditions NotBefore=\"2023-01-01T00:00:00Z\" NotOnOrAfter=\"2023-01-01T00:05:00Z\"><saml:AudienceRestriction><saml:Audience>https://sp.example.com/</saml:Audience></saml:AudienceRestriction></saml:Conditions>\n");
+            printf("<saml:AuthnStatement AuthnInstant=\"2023-01-01T00:00:00Z\" SessionIndex=\"_session-%d\"><saml:AuthnContext><saml:AuthnContextClassRef>urn:oasis:names:tc:SAML:2.0:ac:classes:PasswordProtectedTransport</saml:AuthnContextClassRef></saml:AuthnContext></saml:AuthnStatement>\n", ii);
+            printf("<saml:AttributeStatement>\n");
+            for(jj = 0; jj < 5; ++jj) {
+                printf("<saml:Attribute Name=\"attribute-%d\" NameFormat=\"urn:oasis:names:tc:SAML:2.0:attrname-format:basic\"><saml:AttributeValue>value %d of user %d</saml:AttributeValue></saml:Attribute>\n", jj, jj, ii);
+            }
+            printf("</saml:AttributeStatement>\n");
+            printf("</saml:Assertion>\n");
+        }
+    }'
+    echo '</samlp:Response>'
+    ) > "$output"
+    ;;
+wsse)
+    (
+    echo '<?xml version="1.0" encoding="UTF-8"?>'
+    echo '<soap:Envelope xmlns:soap="http://schemas.xmlsoap.org/soap/envelope/" xmlns:wsse="http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-secext-1.0.xsd" xmlns:wsu="http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-utility-1.0.xsd" xmlns:app="urn:xmlsec:bench">'
+    echo '<soap:Header>'
+    echo '<wsse:Security soap:mustUnderstand="1">'
+    awk -v count="$count" 'BEGIN {
+        printf("<Signature xmlns=\"http://www.w3.org/2000/09/xmldsig#\">\n<SignedInfo>\n");
+        printf("<CanonicalizationMethod Algorithm=\"http://www.w3.org/2001/10/xml-exc-c14n#\"/>\n");
+        printf("<SignatureMethod Algorithm=\"http://www.w3.org/2001/04/xmldsig-more#rsa-sha256\"/>\n");
+        for(ii = 0; ii < count; ++ii) {
+            printf("<Reference URI=\"#%s\">\n", (ii == 0) ? "body" : ("block-" ii));
+            printf("<Transforms><Transform Algorithm=\"http://www.w3.org/2001/10/xml-exc-c14n#\"/></Transforms>\n");
+            printf("<DigestMethod Algorithm=\"http://www.w3.org/2001/04/xmlenc#sha256\"/>\n");
+            printf("<DigestValue></DigestValue>\n</Reference>\n");
+        }
+        printf("</SignedInfo>\n<SignatureValue></SignatureValue>\n<KeyInfo>\n<KeyName>rsakey</KeyName>\n<X509Data/>\n</KeyInfo>\n</Signature>\n");
+    }'
+    echo '</wsse:Security>'
+    awk -v count="$count" 'BEGIN {
+        for(ii = 1; ii < count; ++ii) {
+            printf("<app:Block wsu:Id=\"block-%d\" soap:mustUnderstand=\"0\"><app:Name>header block %d</app:Name><app:Value>%d</app:Value></app:Block>\n", ii, ii, ii * 7);
+        }
+    }'
+    echo '</soap:Header>'
+    echo '<soap:Body wsu:Id="body">'
+    echo '<app:Request><app:Operation>transfer</app:Operation><app:Amount currency="USD">100.00</app:Amount><app:Account>1234567890</app:Account></app:Request>'
+    echo '</soap:Body>'
+    echo '</soap:Envelope>'
+    ) > "$output"
+    ;;
+enveloped)
+    (
+    echo '<?xml version="1.0" encoding="UTF-8"?>'
+    echo '<Document xmlns="urn:xmlsec:bench">'
+    print_signature "" "$TRANSFORM_ENVELOPED
+$TRANSFORM_C14N"
+    awk -v count="$count" 'BEGIN {
+        for(ii = 0; size < count; ++ii) {
+            line = sprintf("<Row Id=\"row-%d\" Type=\"%s\"><Name>Row &amp; name %d</Name><Value>%d</Value></Row>", ii, (ii % 2) ? "odd" : "even", ii, ii * 31);
+            print line;
+            size += length(line) + 1;
+        }
+    }'
+    echo '</Document>'
+    ) > "$output"
+    ;;
+deep)
+    (
+    echo '<?xml version="1.0" encoding="UTF-8"?>'
+    echo '<Document xmlns="urn:xmlsec:bench">'
+    print_signature "" "$TRANSFORM_ENVELOPED
+$TRANSFORM_C14N"
+    awk -v count="$count" 'BEGIN {
+        for(ii = 0; ii < count; ++ii) {
+            printf("<Level Depth=\"%d\">", ii);
+        }
+        printf("deepest text");
+        for(ii = 0; ii < count; ++ii) {
+            printf("</Level>");
+        }
+        printf("\n");
+    }'
+    echo '</Document>'
+    ) > "$output"
+    ;;
+filter2)
+    (
+    echo '<?xml version="1.0" encoding="UTF-8"?>'
+    echo '<Document xmlns="urn:xmlsec:bench">'
+    print_signature "" '<Transform Algorithm="http://www.w3.org/2002/06/xmldsig-filter2">
+<XPath xmlns="http://www.w3.org/2002/06/xmldsig-filter2" Filter="intersect">//*[local-name()="Item"]</XPath>
+<XPath xmlns="http://www.w3.org/2002/06/xmldsig-filter2" Filter="subtract">//*[local-name()="Item"][@Skip]</XPath>
+</Transform>'"
+$TRANSFORM_C14N"
+    awk -v count="$count" 'BEGIN {
+        for(ii = 0; ii < count; ++ii) {
+            printf("<Item Id=\"item-%d\"%s><Name>item %d</Name><Value>%d</Value></Item>\n", ii, ((ii % 10) == 0) ? " Skip=\"yes\"" : "", ii, ii * 17);
+        }
+    }'
+    echo '</Document>'
+    ) > "$output"
+    ;;
+crl)
+    if [ ! -f "$topfolder/keys/ca2cert.pem" ] || [ ! -f "$topfolder/keys/ca2key.pem" ] ; then
+        echo "Error: CA certificate or key is not found in \"$topfolder/keys\"" 1>&2
+        exit 1
+    fi
+    crlfolder=`mktemp -d ${TMPDIR:-/tmp}/xmlsec-gencorpus-XXXXXX`
+    if [ $? != 0 ] ; then
+        echo "Error: failed to create temp folder" 1>&2
+        exit 1
+    fi
+    # revoked serials start at 0x10000 to avoid the test certificates serials
+    awk -v count="$count" 'BEGIN {
+        for(ii = 0; ii < count; ++ii) {
+            printf("R\t491231235959Z\t230101000000Z\t%08X\tunknown\t/CN=revoked %d\n", ii + 65536, ii);
+        }
+    }' > "$crlfolder/index.txt"
+    echo "01" > "$crlfolder/crlnumber"
+    cat > "$crlfolder/ca.cnf" <<EOF
+[ ca ]
+default_ca              = bench_ca
+
+[ bench_ca ]
+database                = $crlfolder/index.txt
+crlnumber               = $crlfolder/crlnumber
+certificate             = $topfolder/keys/ca2cert.pem
+private_key             = $topfolder/keys/ca2key.pem
+default_md              = sha256
+default_crl_days        = 36500
+EOF
+    openssl ca -batch -config "$crlfolder/ca.cnf" -gencrl -out "$output" > /dev/null 2>&1
+    res=$?
+    rm -rf "$crlfolder"
+    if [ $res != 0 ] ; then
+        echo "Error: failed to generate CRL" 1>&2
+        exit 1
+    fi
+    ;;
+*)
+    echo "Error: unknown shape \"$shape\"" 1>&2
+    exit 1
+    ;;
+esac
+
+exit 0
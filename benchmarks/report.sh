@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# XML Security Library benchmarks: cross-crypto comparison report
+#
+# Usage:
+#       report.sh <xmlsecbench-app> <keys-folder> <crypto> [<crypto> [...]]
+#
+# Runs the "sign" and "encrypt" benchmarks groups of the xmlsecbench app
+# for every crypto library (each one in a separate process) and prints
+# the ops/sec numbers side by side. The algorithms not supported by a
+# crypto library are shown as "n/a". Additional xmlsecbench options
+# (e.g. "--time 1000") can be passed with the BENCH_ARGS environment
+# variable.
+#
+# This is free software; see Copyright file in the source
+# distribution for preciese wording.
+#
+# Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+#
+
+bench_app="$1"
+keys_folder="$2"
+if [ "z$bench_app" = "z" ] || [ "z$keys_folder" = "z" ] || [ "z$3" = "z" ] ; then
+    echo "Usage: $0 <xmlsecbench-app> <keys-folder> <crypto> [<crypto> [...]]" 1>&2
+    exit 1
+fi
+shift 2
+
+tmpfile=`mktemp /tmp/xmlsec-bench-report.XXXXXX` || exit 1
+trap 'rm -f "$tmpfile"' EXIT
+
+cryptos=""
+for crypto in "$@" ; do
+    echo "Running benchmarks for $crypto..." 1>&2
+    if "$bench_app" --crypto "$crypto" --keys-dir "$keys_folder" $BENCH_ARGS sign encrypt >> "$tmpfile" ; then
+        cryptos="$cryptos $crypto"
+    else
+        echo "Error: benchmarks failed for $crypto" 1>&2
+    fi
+done
+if [ "z$cryptos" = "z" ] ; then
+    exit 1
+fi
+
+# the benchmarks output is "crypto group case param ops/sec MB/sec"
+awk -v cryptos="$cryptos" '
+    /^#/ { next }
+    NF >= 5 {
+        key = $3 " " $4;
+        if(!(key in seen)) {
+            seen[key] = 1;
+            rows[++nrows] = key;
+        }
+        value[key, $1] = $5;
+    }
+    END {
+        ncryptos = split(cryptos, names, " ");
+        printf("%-24s %-10s", "# algorithm", "op");
+        for(ii = 1; ii <= ncryptos; ++ii) {
+            printf(" %14s", names[ii]);
+        }
+        printf("\n");
+        for(jj = 1; jj <= nrows; ++jj) {
+            split(rows[jj], parts, " ");
+            printf("%-24s %-10s", parts[1], parts[2]);
+            for(ii = 1; ii <= ncryptos; ++ii) {
+                v = ((rows[jj], names[ii]) in value) ? value[rows[jj], names[ii]] : "n/a";
+                printf(" %14s", v);
+            }
+            printf("\n");
+        }
+    }
+' "$tmpfile"
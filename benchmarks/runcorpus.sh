@@ -0,0 +1,280 @@
+#!/bin/sh
+#
+# XML Security Library benchmarks: scaling benchmarks on synthetic documents
+#
+# Usage:
+#       runcorpus.sh <xmlsec-app> [<tests-folder> [<output-folder>]]
+#
+# For every shape and size (see gencorpus.sh) generates the document, signs
+# and verifies it with "<xmlsec-app> --bench" and collects the median time
+# and the peak memory usage. The "crl" shape verifies a small signed document
+# with the generated CRLs. The results are written to the <output-folder>
+# (default: "/tmp/xmlsec-corpus"):
+#
+#   results.txt           the results table (also printed to stdout)
+#   <shape>-<op>.dat      the "size msec peak-rss-kb" data for every shape
+#                         and operation
+#   results.gp            gnuplot script that plots time and peak memory
+#                         usage against the input size; results.png is
+#                         created if gnuplot is available
+#
+# The "growth" column is the exponent k in "time ~ size^k" between two
+# consecutive sizes: it is close to 1 for linear algorithms and the values
+# above 1.3 are marked as "superlinear".
+#
+# The following environment variables control the benchmarks:
+#
+#   BENCH_RUNS            the number of runs for each case (default: 3)
+#   BENCH_KEEP_FILES      keep the generated documents if not empty
+#   SHAPES                the shapes (default: "saml wsse enveloped deep filter2 crl")
+#   SAML_SIZES            number of assertions (default: "1 10 100 1000")
+#   WSSE_SIZES            number of references (default: "1 10 50")
+#   ENVELOPED_SIZES       document sizes (default: "1M 10M 100M"); add "1G" for
+#                         the 1GB document (requires about 10GB of memory)
+#   DEEP_SIZES            nesting depth (default: "100 1000 10000")
+#   FILTER2_SIZES         number of items (default: "1000 10000 100000")
+#   CRL_SIZES             number of revoked certificates (default: "1000 10000 100000 500000")
+#
+# This is free software; see Copyright file in the source
+# distribution for preciese wording.
+#
+# Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+#
+
+xmlsec_app="$1"
+topfolder="$2"
+outfolder="$3"
+
+if [ "z$xmlsec_app" = "z" ] ; then
+    echo "Usage: $0 <xmlsec-app> [<tests-folder> [<output-folder>]]" 1>&2
+    exit 1
+fi
+benchfolder=`dirname $0`
+if [ "z$topfolder" = "z" ] ; then
+    topfolder="$benchfolder/../tests"
+fi
+if [ "z$outfolder" = "z" ] ; then
+    outfolder="/tmp/xmlsec-corpus"
+fi
+if [ "z$BENCH_RUNS" = "z" ] ; then
+    BENCH_RUNS=3
+fi
+if [ "z$SHAPES" = "z" ] ; then
+    SHAPES="saml wsse enveloped deep filter2 crl"
+fi
+if [ "z$SAML_SIZES" = "z" ] ; then
+    SAML_SIZES="1 10 100 1000"
+fi
+if [ "z$WSSE_SIZES" = "z" ] ; then
+    WSSE_SIZES="1 10 50"
+fi
+if [ "z$ENVELOPED_SIZES" = "z" ] ; then
+    ENVELOPED_SIZES="1M 10M 100M"
+fi
+if [ "z$DEEP_SIZES" = "z" ] ; then
+    DEEP_SIZES="100 1000 10000"
+fi
+if [ "z$FILTER2_SIZES" = "z" ] ; then
+    FILTER2_SIZES="1000 10000 100000"
+fi
+if [ "z$CRL_SIZES" = "z" ] ; then
+    CRL_SIZES="1000 10000 100000 500000"
+fi
+
+mkdir -p "$outfolder" || exit 1
+results="$outfolder/results.txt"
+gnuplot_script="$outfolder/results.gp"
+
+sign_options="--pkcs12:rsakey $topfolder/keys/rsakey.p12 --pwd secret123"
+verify_options="--trusted-pem $topfolder/keys/cacert.pem --untrusted-pem $topfolder/keys/ca2cert.pem --enabled-key-data x509"
+saml_options="--id-attr:ID urn:oasis:names:tc:SAML:2.0:protocol:Response"
+wsse_options="--id-attr:Id http://schemas.xmlsoap.org/soap/envelope/:Body --id-attr:Id urn:xmlsec:bench:Block"
+
+#
+# Converts size with optional K, M or G suffix to a number
+#
+parse_size() {
+    echo "$1" | awk '
+        /^[0-9]+$/  { print $0; exit 0 }
+        /^[0-9]+[kK]$/ { print substr($0, 1, length($0) - 1) * 1024; exit 0 }
+        /^[0-9]+[mM]$/ { print substr($0, 1, length($0) - 1) * 1024 * 1024; exit 0 }
+        /^[0-9]+[gG]$/ { print substr($0, 1, length($0) - 1) * 1024 * 1024 * 1024; exit 0 }
+        { exit 1 }
+    '
+}
+
+#
+# Runs xmlsec app with "--bench" and records the results:
+#   run_bench <shape> <size> <op> <input-bytes> <xmlsec-app-options...>
+#
+run_bench() {
+    shape="$1"
+    size="$2"
+    op="$3"
+    bytes="$4"
+    shift 4
+
+    json="$outfolder/$shape-$size-$op.json"
+    datfile="$outfolder/$shape-$op.dat"
+    rm -f "$json"
+    "$xmlsec_app" $op --bench $BENCH_RUNS --bench-json "$json" "$@" > "$outfolder/$shape-$size-$op.log" 2>&1
+    if [ $? != 0 ] || [ ! -f "$json" ] ; then
+        printf "%-10s %-8s %10s %14s %12s %12s %8s %s\n" \
+            "$shape" "$op" "$size" "$bytes" "-" "-" "-" "FAILED (see $outfolder/$shape-$size-$op.log)" | tee -a "$results"
+        return 1
+    fi
+
+    msec=`sed -n 's/.*"p50": \([0-9.]*\).*/\1/p' "$json"`
+    rss=`sed -n 's/.*"peak_rss_kb": \([0-9]*\).*/\1/p' "$json"`
+    if [ "z$rss" = "z" ] ; then
+        rss="-"
+    fi
+    count=`parse_size "$size"`
+
+    # compare with the previous size for this shape and operation
+    growth=`tail -n 1 "$datfile" 2>/dev/null | awk -v count="$count" -v msec="$msec" '
+        NF >= 2 && $1 > 0 && $2 > 0 && count > $1 && msec > 0 {
+            printf("%.2f", log(msec / $2) / log(count / $1));
+            exit 0;
+        }
+        { printf("-"); exit 0 }
+    '`
+    if [ "z$growth" = "z" ] ; then
+        growth="-"
+    fi
+    note=`echo "$growth" | awk '$1 != "-" && $1 > 1.3 { print "superlinear" }'`
+
+    echo "$count $msec $rss" >> "$datfile"
+    printf "%-10s %-8s %10s %14s %12s %12s %8s %s\n" \
+        "$shape" "$op" "$size" "$bytes" "$msec" "$rss" "$growth" "$note" | tee -a "$results"
+    return 0
+}
+
+#
+# Generates the document, signs and verifies it:
+#   run_shape <shape> <size> <xmlsec-app-options...>
+#
+run_shape() {
+    shape="$1"
+    size="$2"
+    shift 2
+
+    tmpl="$outfolder/$shape-$size.tmpl.xml"
+    signed="$outfolder/$shape-$size.xml"
+    if ! sh "$benchfolder/gencorpus.sh" "$shape" "$size" "$tmpl" "$topfolder" ; then
+        echo "Error: failed to generate $shape document for size $size" 1>&2
+        return 1
+    fi
+    bytes=`wc -c < "$tmpl" | tr -d ' '`
+
+    if run_bench "$shape" "$size" "sign" "$bytes" $sign_options "$@" --output "$signed" "$tmpl" ; then
+        bytes=`wc -c < "$signed" | tr -d ' '`
+        run_bench "$shape" "$size" "verify" "$bytes" $verify_options "$@" "$signed"
+    fi
+    if [ "z$BENCH_KEEP_FILES" = "z" ] ; then
+        rm -f "$tmpl" "$signed"
+    fi
+}
+
+#
+# Verifies a small signed document with the generated CRL:
+#   run_crl <size> <signed-document>
+#
+run_crl() {
+    size="$1"
+    signed="$2"
+
+    crl="$outfolder/crl-$size.pem"
+    if ! sh "$benchfolder/gencorpus.sh" "crl" "$size" "$crl" "$topfolder" ; then
+        echo "Error: failed to generate CRL for size $size" 1>&2
+        return 1
+    fi
+    bytes=`wc -c < "$crl" | tr -d ' '`
+
+    run_bench "crl" "$size" "verify" "$bytes" $verify_options --crl-pem "$crl" "$signed"
+    if [ "z$BENCH_KEEP_FILES" = "z" ] ; then
+        rm -f "$crl"
+    fi
+}
+
+rm -f "$results" "$outfolder"/*.dat "$outfolder"/*.json "$outfolder"/*.log
+printf "%-10s %-8s %10s %14s %12s %12s %8s %s\n" \
+    "# shape" "op" "size" "bytes" "p50 msec" "peak RSS KB" "growth" "" | tee "$results"
+
+for shape in $SHAPES ; do
+    case "$shape" in
+    saml)
+        for size in $SAML_SIZES ; do
+            run_shape saml $size $saml_options
+        done
+        ;;
+    wsse)
+        for size in $WSSE_SIZES ; do
+            run_shape wsse $size $wsse_options
+        done
+        ;;
+    enveloped)
+        for size in $ENVELOPED_SIZES ; do
+            run_shape enveloped $size
+        done
+        ;;
+    deep)
+        for size in $DEEP_SIZES ; do
+            run_shape deep $size
+        done
+        ;;
+    filter2)
+        for size in $FILTER2_SIZES ; do
+            run_shape filter2 $size
+        done
+        ;;
+    crl)
+        tmpl="$outfolder/crl-doc.tmpl.xml"
+        signed="$outfolder/crl-doc.xml"
+        sh "$benchfolder/gencorpus.sh" enveloped 1K "$tmpl" "$topfolder" && \
+            "$xmlsec_app" sign $sign_options --output "$signed" "$tmpl" > /dev/null 2>&1
+        if [ $? != 0 ] ; then
+            echo "Error: failed to create signed document for CRL benchmarks" 1>&2
+            continue
+        fi
+        for size in $CRL_SIZES ; do
+            run_crl $size "$signed"
+        done
+        rm -f "$tmpl" "$signed"
+        ;;
+    *)
+        echo "Error: unknown shape \"$shape\"" 1>&2
+        ;;
+    esac
+done
+
+#
+# gnuplot script
+#
+(
+    echo 'set terminal png size 1200,1000'
+    echo "set output \"$outfolder/results.png\""
+    echo 'set multiplot layout 2,1'
+    echo 'set logscale xy'
+    echo 'set key outside right'
+    echo 'set grid'
+    echo 'set xlabel "input size (assertions, references, bytes, depth, items or CRL entries)"'
+    echo 'set ylabel "p50 time, msec"'
+    plot="plot"
+    for datfile in "$outfolder"/*.dat ; do
+        [ -f "$datfile" ] || continue
+        title=`basename "$datfile" .dat`
+        plot="$plot \"$datfile\" using 1:2 with linespoints title \"$title\","
+    done
+    echo "$plot" | sed 's/,$//'
+    echo 'set ylabel "peak RSS, KB"'
+    echo "$plot" | sed 's/,$//' | sed 's/using 1:2/using 1:3/g'
+    echo 'unset multiplot'
+) > "$gnuplot_script"
+if command -v gnuplot > /dev/null 2>&1 ; then
+    gnuplot "$gnuplot_script" && echo "Plot: $outfolder/results.png"
+else
+    echo "Plot: gnuplot is not found, run \"gnuplot $gnuplot_script\" to create $outfolder/results.png"
+fi
+
+exit 0
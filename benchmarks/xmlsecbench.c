@@ -0,0 +1,1361 @@
+/**
+ * XML Security Library benchmarks: micro benchmarks for the xmlsec building blocks
+ *
+ * Measures the throughput of the base64 encoder/decoder, the C14N transforms,
+ * the transforms pump, the digest/HMAC/cipher transforms, the keys stores
+ * lookups and the X509 certificates verification for a single xmlsec-crypto
+ * library. Each case is repeated for at least the specified time and the
+ * results are printed one case per line:
+ *
+ *      <crypto> <group> <case> <param> <ops/sec> <MB/sec>
+ *
+ * Usage:
+ *      xmlsecbench [--crypto <name>] [--time <msec>] [--keys-dir <dir>]
+ *                  [--x509-dir <dir>] [<group> [...]]
+ *
+ * where <group> is one of "base64", "c14n", "pump", "digest", "hmac",
+ * "cipher", "sign", "encrypt", "keys" or "x509" (default: all groups).
+ * The "sign" and "encrypt" groups use the PKCS12 keys from the --keys-dir
+ * folder (default: "../tests/keys"). The "x509" group uses the
+ * "sign3-res.xml", "cacert.pem" and "ca2cert.pem" files from the
+ * --x509-dir folder (default: "../examples").
+ *
+ * Example:
+ *      ./xmlsecbench --crypto openssl --time 500 digest cipher
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif /* !defined(_WIN32) && !defined(_POSIX_C_SOURCE) */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif /* defined(_WIN32) */
+
+#include <libxml/tree.h>
+#include <libxml/xmlmemory.h>
+#include <libxml/parser.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/xmltree.h>
+#include <xmlsec/base64.h>
+#include <xmlsec/buffer.h>
+#include <xmlsec/keys.h>
+#include <xmlsec/keysmngr.h>
+#include <xmlsec/keyinfo.h>
+#include <xmlsec/nodeset.h>
+#include <xmlsec/transforms.h>
+#include <xmlsec/crypto.h>
+
+/* the data size for the base64, pump, digest, HMAC and cipher cases */
+#define BENCH_DATA_SIZE         (1024 * 1024)
+
+typedef int (*bench_func)(void* data);
+
+static double   bench_time = 0.2;
+static const char* bench_crypto = "default";
+
+static double   bench_now(void);
+static int      bench_run(const char* group, const char* name, const char* param,
+                          bench_func func, void* data);
+static int      bench_base64(void);
+static int      bench_c14n(void);
+static int      bench_pump(void);
+static int      bench_transforms(const char* group);
+static int      bench_algorithms(const char* group, const char* dir);
+static int      bench_keys(void);
+static int      bench_x509(const char* dir);
+
+int
+main(int argc, char **argv) {
+    static const char* all_groups[] = {
+        "base64", "c14n", "pump", "digest", "hmac", "cipher", "sign", "encrypt", "keys", "x509", NULL
+    };
+    const char* keys_dir = "../tests/keys";
+    const char* x509_dir = "../examples";
+    const char** groups;
+    int groups_num = 0;
+    int res = 1;
+    int i;
+
+    assert(argv);
+
+    groups = (const char**)malloc(sizeof(const char*) * (size_t)argc);
+    if(groups == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        return(1);
+    }
+    for(i = 1; i < argc; ++i) {
+        if((strcmp(argv[i], "--crypto") == 0) && (i + 1 < argc)) {
+            bench_crypto = argv[++i];
+        } else if((strcmp(argv[i], "--time") == 0) && (i + 1 < argc)) {
+            bench_time = atoi(argv[++i]) / 1000.0;
+            if(bench_time <= 0) {
+                fprintf(stderr, "Error: invalid time \"%s\".\n", argv[i]);
+                free((void*)groups);
+                return(1);
+            }
+        } else if((strcmp(argv[i], "--keys-dir") == 0) && (i + 1 < argc)) {
+            keys_dir = argv[++i];
+        } else if((strcmp(argv[i], "--x509-dir") == 0) && (i + 1 < argc)) {
+            x509_dir = argv[++i];
+        } else if(argv[i][0] != '-') {
+            groups[groups_num++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: unknown option \"%s\".\n", argv[i]);
+            fprintf(stderr, "Usage: %s [--crypto <name>] [--time <msec>] [--keys-dir <dir>] [--x509-dir <dir>] [<group> [...]]\n", argv[0]);
+            free((void*)groups);
+            return(1);
+        }
+    }
+    if(groups_num == 0) {
+        free((void*)groups);
+        groups = all_groups;
+        for(groups_num = 0; all_groups[groups_num] != NULL; ++groups_num);
+    }
+
+    /* Init libxml library */
+    xmlInitParser();
+    LIBXML_TEST_VERSION
+
+    /* Init xmlsec library */
+    if(xmlSecInit() < 0) {
+        fprintf(stderr, "Error: xmlsec initialization failed.\n");
+        return(1);
+    }
+
+    /* Check loaded library version */
+    if(xmlSecCheckVersion() != 1) {
+        fprintf(stderr, "Error: loaded xmlsec library version is not compatible.\n");
+        return(1);
+    }
+
+    /* Load the requested crypto engine if we are supporting dynamic
+     * loading for xmlsec-crypto libraries, otherwise only the crypto
+     * library we are linked with is available.
+     */
+#ifdef XMLSEC_CRYPTO_DYNAMIC_LOADING
+    if(xmlSecCryptoDLLoadLibrary((strcmp(bench_crypto, "default") != 0) ? BAD_CAST bench_crypto : NULL) < 0) {
+        fprintf(stderr, "Error: unable to load \"%s\" xmlsec-crypto library. Make sure\n"
+                        "that you have it installed and check shared libraries path\n"
+                        "(LD_LIBRARY_PATH and/or LTDL_LIBRARY_PATH) environment variables.\n",
+                        bench_crypto);
+        return(1);
+    }
+#else  /* XMLSEC_CRYPTO_DYNAMIC_LOADING */
+    if((strcmp(bench_crypto, "default") != 0) && (!xmlStrEqual(BAD_CAST bench_crypto, xmlSecGetDefaultCrypto()))) {
+        fprintf(stderr, "Error: \"%s\" xmlsec-crypto library is not available, "
+                        "the benchmark is linked with \"%s\".\n",
+                        bench_crypto, (const char*)xmlSecGetDefaultCrypto());
+        return(1);
+    }
+#endif /* XMLSEC_CRYPTO_DYNAMIC_LOADING */
+    if(strcmp(bench_crypto, "default") == 0) {
+        bench_crypto = (const char*)xmlSecGetDefaultCrypto();
+    }
+
+    /* Init crypto library */
+    if(xmlSecCryptoAppInit(NULL) < 0) {
+        fprintf(stderr, "Error: crypto initialization failed.\n");
+        return(1);
+    }
+
+    /* Init xmlsec-crypto library */
+    if(xmlSecCryptoInit() < 0) {
+        fprintf(stderr, "Error: xmlsec-crypto initialization failed.\n");
+        return(1);
+    }
+
+    fprintf(stdout, "# %-8s %-8s %-24s %-10s %16s %12s\n",
+        "crypto", "group", "case", "param", "ops/sec", "MB/sec");
+    for(i = 0; i < groups_num; ++i) {
+        int ret;
+
+        if(strcmp(groups[i], "base64") == 0) {
+            ret = bench_base64();
+        } else if(strcmp(groups[i], "c14n") == 0) {
+            ret = bench_c14n();
+        } else if(strcmp(groups[i], "pump") == 0) {
+            ret = bench_pump();
+        } else if((strcmp(groups[i], "digest") == 0) || (strcmp(groups[i], "hmac") == 0) ||
+                  (strcmp(groups[i], "cipher") == 0)) {
+            ret = bench_transforms(groups[i]);
+        } else if((strcmp(groups[i], "sign") == 0) || (strcmp(groups[i], "encrypt") == 0)) {
+            ret = bench_algorithms(groups[i], keys_dir);
+        } else if(strcmp(groups[i], "keys") == 0) {
+            ret = bench_keys();
+        } else if(strcmp(groups[i], "x509") == 0) {
+            ret = bench_x509(x509_dir);
+        } else {
+            fprintf(stderr, "Error: unknown benchmark group \"%s\".\n", groups[i]);
+            ret = -1;
+        }
+        if(ret < 0) {
+            goto done;
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(groups != all_groups) {
+        free((void*)groups);
+    }
+
+    /* Shutdown xmlsec-crypto library */
+    xmlSecCryptoShutdown();
+
+    /* Shutdown crypto library */
+    xmlSecCryptoAppShutdown();
+
+    /* Shutdown xmlsec library */
+    xmlSecShutdown();
+
+    /* Shutdown libxml */
+    xmlCleanupParser();
+
+    return(res);
+}
+
+/**
+ * bench_now:
+ *
+ * Gets the monotonic clock time.
+ *
+ * Returns the current time in seconds.
+ */
+static double
+bench_now(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER freq, counter;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return((double)counter.QuadPart / (double)freq.QuadPart);
+#else  /* defined(_WIN32) */
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0);
+#endif /* defined(_WIN32) */
+}
+
+/**
+ * bench_run:
+ * @group:              the benchmark group name.
+ * @name:               the benchmark case name.
+ * @param:              the benchmark case parameter.
+ * @func:               the function that executes one operation and returns
+ *                      the number of processed bytes or a negative value if
+ *                      an error occurs.
+ * @data:               the parameter for @func.
+ *
+ * Calls @func once to warm up the caches and then repeats it for at
+ * least #bench_time seconds. Prints the operations and bytes rates.
+ *
+ * Returns 0 on success or a negative value if an error occurs.
+ */
+static int
+bench_run(const char* group, const char* name, const char* param, bench_func func, void* data) {
+    double start, elapsed;
+    double bytes = 0;
+    long ops = 0;
+    int ret;
+
+    assert(group);
+    assert(name);
+    assert(param);
+    assert(func);
+
+    ret = func(data);
+    if(ret < 0) {
+        fprintf(stderr, "Error: benchmark %s/%s/%s failed.\n", group, name, param);
+        return(-1);
+    }
+
+    start = bench_now();
+    do {
+        ret = func(data);
+        if(ret < 0) {
+            fprintf(stderr, "Error: benchmark %s/%s/%s failed.\n", group, name, param);
+            return(-1);
+        }
+        bytes += ret;
+        ++ops;
+        elapsed = bench_now() - start;
+    } while(elapsed < bench_time);
+
+    if(bytes > 0) {
+        fprintf(stdout, "  %-8s %-8s %-24s %-10s %16.1f %12.2f\n",
+            bench_crypto, group, name, param,
+            (double)ops / elapsed, (double)bytes / elapsed / (1024.0 * 1024.0));
+    } else {
+        fprintf(stdout, "  %-8s %-8s %-24s %-10s %16.1f %12s\n",
+            bench_crypto, group, name, param, (double)ops / elapsed, "-");
+    }
+    fflush(stdout);
+    return(0);
+}
+
+/**
+ * bench_size_name:
+ * @size:               the size.
+ * @buf:                the output buffer.
+ * @bufSize:            the size of @buf.
+ *
+ * Formats @size as a short string ("64", "16K", "1M", ...).
+ *
+ * Returns @buf.
+ */
+static const char*
+bench_size_name(xmlSecSize size, char* buf, size_t bufSize) {
+    if((size >= 1024 * 1024) && ((size % (1024 * 1024)) == 0)) {
+        snprintf(buf, bufSize, "%luM", (unsigned long)(size / (1024 * 1024)));
+    } else if((size >= 1024) && ((size % 1024) == 0)) {
+        snprintf(buf, bufSize, "%luK", (unsigned long)(size / 1024));
+    } else {
+        snprintf(buf, bufSize, "%lu", (unsigned long)size);
+    }
+    return(buf);
+}
+
+/**
+ * bench_data_create:
+ * @size:               the data size.
+ *
+ * Creates the pseudo-random data buffer. The caller is responsible for
+ * freeing the returned buffer with free().
+ *
+ * Returns the pointer to the buffer or NULL if an error occurs.
+ */
+static xmlSecByte*
+bench_data_create(xmlSecSize size) {
+    xmlSecByte* data;
+    unsigned int seed = 0x12345678;
+    xmlSecSize ii;
+
+    data = (xmlSecByte*)malloc(size);
+    if(data == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        return(NULL);
+    }
+    for(ii = 0; ii < size; ++ii) {
+        seed = seed * 1103515245 + 12345;
+        data[ii] = (xmlSecByte)(seed >> 16);
+    }
+    return(data);
+}
+
+/****************************************************************************
+ *
+ * base64
+ *
+ ***************************************************************************/
+typedef struct _bench_base64_data {
+    const xmlSecByte*   bin;
+    xmlSecSize          binSize;
+    const xmlChar*      str;
+    xmlSecByte*         out;
+    xmlSecSize          outSize;
+} bench_base64_data;
+
+static int
+bench_base64_encode(void* data) {
+    bench_base64_data* ctx = (bench_base64_data*)data;
+    xmlChar* str;
+
+    assert(ctx);
+
+    str = xmlSecBase64Encode(ctx->bin, ctx->binSize, 0);
+    if(str == NULL) {
+        return(-1);
+    }
+    xmlFree(str);
+    return((int)ctx->binSize);
+}
+
+static int
+bench_base64_decode(void* data) {
+    bench_base64_data* ctx = (bench_base64_data*)data;
+    xmlSecSize outSize = 0;
+
+    assert(ctx);
+
+    if(xmlSecBase64Decode_ex(ctx->str, ctx->out, ctx->outSize, &outSize) < 0) {
+        return(-1);
+    }
+    if(outSize != ctx->binSize) {
+        return(-1);
+    }
+    return((int)outSize);
+}
+
+static int
+bench_base64(void) {
+    static const xmlSecSize sizes[] = { 64, 1024, 64 * 1024, BENCH_DATA_SIZE };
+    bench_base64_data ctx;
+    xmlSecByte* bin;
+    xmlChar* str = NULL;
+    char param[32];
+    size_t ii;
+    int res = -1;
+
+    bin = bench_data_create(BENCH_DATA_SIZE);
+    if(bin == NULL) {
+        return(-1);
+    }
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.bin = bin;
+    /* the decoder wants some extra space for the last group */
+    ctx.outSize = BENCH_DATA_SIZE + 16;
+    ctx.out = (xmlSecByte*)malloc(ctx.outSize);
+    if(ctx.out == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        goto done;
+    }
+
+    for(ii = 0; ii < sizeof(sizes) / sizeof(sizes[0]); ++ii) {
+        ctx.binSize = sizes[ii];
+        bench_size_name(sizes[ii], param, sizeof(param));
+
+        if(bench_run("base64", "encode", param, bench_base64_encode, &ctx) < 0) {
+            goto done;
+        }
+
+        /* use the default line size for the decoder input */
+        str = xmlSecBase64Encode(bin, sizes[ii], xmlSecBase64GetDefaultLineSize());
+        if(str == NULL) {
+            fprintf(stderr, "Error: xmlSecBase64Encode failed.\n");
+            goto done;
+        }
+        ctx.str = str;
+        if(bench_run("base64", "decode", param, bench_base64_decode, &ctx) < 0) {
+            goto done;
+        }
+        xmlFree(str);
+        str = NULL;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(str != NULL) {
+        xmlFree(str);
+    }
+    free(ctx.out);
+    free(bin);
+    return(res);
+}
+
+/****************************************************************************
+ *
+ * C14N
+ *
+ ***************************************************************************/
+typedef struct _bench_c14n_data {
+    xmlSecTransformId   id;
+    xmlSecNodeSetPtr    nodes;
+} bench_c14n_data;
+
+static int
+bench_c14n_execute(void* data) {
+    bench_c14n_data* ctx = (bench_c14n_data*)data;
+    xmlSecTransformCtx transformCtx;
+    int res = -1;
+
+    assert(ctx);
+
+    if(xmlSecTransformCtxInitialize(&transformCtx) < 0) {
+        return(-1);
+    }
+    if(xmlSecTransformCtxCreateAndAppend(&transformCtx, ctx->id) == NULL) {
+        goto done;
+    }
+    if(xmlSecTransformCtxXmlExecute(&transformCtx, ctx->nodes) < 0) {
+        goto done;
+    }
+    if(transformCtx.result == NULL) {
+        goto done;
+    }
+    res = (int)xmlSecBufferGetSize(transformCtx.result);
+
+done:
+    xmlSecTransformCtxFinalize(&transformCtx);
+    return(res);
+}
+
+/**
+ * bench_c14n_doc_create:
+ * @items:              the number of items in the document.
+ *
+ * Creates a document with namespaces, attributes, comments and text nodes
+ * in every of the @items items.
+ *
+ * Returns the pointer to the document or NULL if an error occurs.
+ */
+static xmlDocPtr
+bench_c14n_doc_create(int items) {
+    static const char header[] =
+        "<?xml version=\"1.0\"?>\n"
+        "<bench:Root xmlns:bench=\"urn:xmlsec:bench\" xmlns=\"urn:xmlsec:default\" xml:lang=\"en\">\n";
+    static const char footer[] = "</bench:Root>\n";
+    static const char item[] =
+        "  <Item Id=\"item-%d\" bench:Order=\"%d\" Zeta=\"z\" Alpha=\"a\">\n"
+        "    <!-- item %d -->\n"
+        "    <Name>Item &amp; name %d</Name>\n"
+        "    <x:Value xmlns:x=\"urn:xmlsec:value\" x:Type=\"int\">%d</x:Value>\n"
+        "    <Empty/>\n"
+        "  </Item>\n";
+    size_t size, pos;
+    char* buf;
+    xmlDocPtr doc;
+    int ii;
+
+    assert(items > 0);
+
+    size = sizeof(header) + sizeof(footer) + (sizeof(item) + 64) * (size_t)items;
+    buf = (char*)malloc(size);
+    if(buf == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        return(NULL);
+    }
+    pos = (size_t)snprintf(buf, size, "%s", header);
+    for(ii = 0; ii < items; ++ii) {
+        pos += (size_t)snprintf(buf + pos, size - pos, item, ii, ii, ii, ii, ii);
+    }
+    pos += (size_t)snprintf(buf + pos, size - pos, "%s", footer);
+
+    doc = xmlReadMemory(buf, (int)pos, NULL, NULL, 0);
+    if(doc == NULL) {
+        fprintf(stderr, "Error: failed to parse the generated document.\n");
+    }
+    free(buf);
+    return(doc);
+}
+
+static int
+bench_c14n(void) {
+    static const struct {
+        const char* name;
+        int items;
+    } docs[] = {
+        { "small",  10 },
+        { "medium", 1000 },
+        { "large",  100000 }
+    };
+    struct {
+        const char* name;
+        xmlSecTransformId id;
+    } transforms[] = {
+        { "c14n",                   xmlSecTransformInclC14NId },
+        { "c14n-with-comments",     xmlSecTransformInclC14NWithCommentsId },
+        { "c14n11",                 xmlSecTransformInclC14N11Id },
+        { "c14n11-with-comments",   xmlSecTransformInclC14N11WithCommentsId },
+        { "exc-c14n",               xmlSecTransformExclC14NId },
+        { "exc-c14n-with-comments", xmlSecTransformExclC14NWithCommentsId }
+    };
+    bench_c14n_data ctx;
+    xmlDocPtr doc = NULL;
+    size_t ii, jj;
+    int res = -1;
+
+    memset(&ctx, 0, sizeof(ctx));
+    for(ii = 0; ii < sizeof(docs) / sizeof(docs[0]); ++ii) {
+        doc = bench_c14n_doc_create(docs[ii].items);
+        if(doc == NULL) {
+            goto done;
+        }
+        ctx.nodes = xmlSecNodeSetGetChildren(doc, NULL, 1, 0);
+        if(ctx.nodes == NULL) {
+            fprintf(stderr, "Error: xmlSecNodeSetGetChildren failed.\n");
+            goto done;
+        }
+
+        for(jj = 0; jj < sizeof(transforms) / sizeof(transforms[0]); ++jj) {
+            ctx.id = transforms[jj].id;
+            if(bench_run("c14n", transforms[jj].name, docs[ii].name, bench_c14n_execute, &ctx) < 0) {
+                goto done;
+            }
+        }
+
+        xmlSecNodeSetDestroy(ctx.nodes);
+        ctx.nodes = NULL;
+        xmlFreeDoc(doc);
+        doc = NULL;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(ctx.nodes != NULL) {
+        xmlSecNodeSetDestroy(ctx.nodes);
+    }
+    if(doc != NULL) {
+        xmlFreeDoc(doc);
+    }
+    return(res);
+}
+
+/****************************************************************************
+ *
+ * Transforms pump
+ *
+ * The null transform copies its input to the output or drops it if it is
+ * the last transform in the chain: the pump between two null transforms
+ * measures the pump and the default push/pop methods overhead.
+ *
+ ***************************************************************************/
+static int
+bench_null_execute(xmlSecTransformPtr transform, int last, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecBufferPtr in;
+    xmlSecSize inSize;
+
+    assert(transform);
+    assert(transformCtx);
+
+    in = &(transform->inBuf);
+    inSize = xmlSecBufferGetSize(in);
+
+    if(transform->status == xmlSecTransformStatusNone) {
+        transform->status = xmlSecTransformStatusWorking;
+    }
+    if(transform->next != NULL) {
+        if(xmlSecBufferAppend(&(transform->outBuf), xmlSecBufferGetData(in), inSize) < 0) {
+            return(-1);
+        }
+    }
+    if(xmlSecBufferRemoveHead(in, inSize) < 0) {
+        return(-1);
+    }
+    if(last != 0) {
+        transform->status = xmlSecTransformStatusFinished;
+    }
+    return(0);
+}
+
+static xmlSecTransformKlass bench_null_klass = {
+    /* klass/object sizes */
+    sizeof(xmlSecTransformKlass),               /* xmlSecSize klassSize */
+    sizeof(xmlSecTransform),                    /* xmlSecSize objSize */
+
+    BAD_CAST "bench-null",                      /* const xmlChar* name; */
+    NULL,                                       /* const xmlChar* href; */
+    0,                                          /* xmlSecAlgorithmUsage usage; */
+
+    NULL,                                       /* xmlSecTransformInitializeMethod initialize; */
+    NULL,                                       /* xmlSecTransformFinalizeMethod finalize; */
+    NULL,                                       /* xmlSecTransformNodeReadMethod readNode; */
+    NULL,                                       /* xmlSecTransformNodeWriteMethod writeNode; */
+    NULL,                                       /* xmlSecTransformSetKeyReqMethod setKeyReq; */
+    NULL,                                       /* xmlSecTransformSetKeyMethod setKey; */
+    NULL,                                       /* xmlSecTransformValidateMethod validate; */
+    xmlSecTransformDefaultGetDataType,          /* xmlSecTransformGetDataTypeMethod getDataType; */
+    xmlSecTransformDefaultPushBin,              /* xmlSecTransformPushBinMethod pushBin; */
+    xmlSecTransformDefaultPopBin,               /* xmlSecTransformPopBinMethod popBin; */
+    NULL,                                       /* xmlSecTransformPushXmlMethod pushXml; */
+    NULL,                                       /* xmlSecTransformPopXmlMethod popXml; */
+    bench_null_execute,                         /* xmlSecTransformExecuteMethod execute; */
+
+    NULL,                                       /* void* reserved0; */
+    NULL,                                       /* void* reserved1; */
+};
+
+typedef struct _bench_pump_data {
+    const xmlSecByte*   data;
+    xmlSecSize          dataSize;
+    xmlSecSize          chunkSize;
+} bench_pump_data;
+
+static int
+bench_pump_execute(void* data) {
+    bench_pump_data* ctx = (bench_pump_data*)data;
+    xmlSecTransformCtx transformCtx;
+    xmlSecTransformPtr left, right;
+    int res = -1;
+
+    assert(ctx);
+
+    if(xmlSecTransformCtxInitialize(&transformCtx) < 0) {
+        return(-1);
+    }
+    transformCtx.binaryChunkSize = ctx->chunkSize;
+
+    left = xmlSecTransformCtxCreateAndAppend(&transformCtx, &bench_null_klass);
+    if(left == NULL) {
+        goto done;
+    }
+    right = xmlSecTransformCtxCreateAndAppend(&transformCtx, &bench_null_klass);
+    if(right == NULL) {
+        goto done;
+    }
+    if(xmlSecBufferSetData(&(left->inBuf), ctx->data, ctx->dataSize) < 0) {
+        goto done;
+    }
+    if(xmlSecTransformPump(left, right, &transformCtx) < 0) {
+        goto done;
+    }
+    if(right->status != xmlSecTransformStatusFinished) {
+        goto done;
+    }
+    res = (int)ctx->dataSize;
+
+done:
+    xmlSecTransformCtxFinalize(&transformCtx);
+    return(res);
+}
+
+static int
+bench_pump(void) {
+    static const xmlSecSize chunks[] = { 64, 1024, 16 * 1024, 64 * 1024 };
+    bench_pump_data ctx;
+    xmlSecByte* data;
+    char param[32];
+    size_t ii;
+    int res = -1;
+
+    data = bench_data_create(BENCH_DATA_SIZE);
+    if(data == NULL) {
+        return(-1);
+    }
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.data = data;
+    ctx.dataSize = BENCH_DATA_SIZE;
+
+    for(ii = 0; ii < sizeof(chunks) / sizeof(chunks[0]); ++ii) {
+        ctx.chunkSize = chunks[ii];
+        bench_size_name(chunks[ii], param, sizeof(param));
+        if(bench_run("pump", "null-null", param, bench_pump_execute, &ctx) < 0) {
+            goto done;
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    free(data);
+    return(res);
+}
+
+/****************************************************************************
+ *
+ * Digest, HMAC and cipher transforms
+ *
+ ***************************************************************************/
+typedef struct _bench_transform_data {
+    xmlSecTransformId   id;
+    xmlSecTransformOperation operation;
+    xmlSecKeyPtr        key;
+    const xmlSecByte*   data;
+    xmlSecSize          dataSize;
+    xmlSecSize          chunkSize;
+    const xmlSecByte*   signature;      /* the signature for the verify operation */
+    xmlSecSize          signatureSize;
+    xmlSecBufferPtr     output;         /* if not NULL then the result is copied here */
+} bench_transform_data;
+
+static int
+bench_transform_execute(void* data) {
+    bench_transform_data* ctx = (bench_transform_data*)data;
+    xmlSecTransformCtx transformCtx;
+    xmlSecTransformPtr transform;
+    xmlSecSize pos, size;
+    int res = -1;
+
+    assert(ctx);
+
+    if(xmlSecTransformCtxInitialize(&transformCtx) < 0) {
+        return(-1);
+    }
+    transform = xmlSecTransformCtxCreateAndAppend(&transformCtx, ctx->id);
+    if(transform == NULL) {
+        goto done;
+    }
+    transform->operation = ctx->operation;
+    if((ctx->key != NULL) && (xmlSecTransformSetKey(transform, ctx->key) < 0)) {
+        goto done;
+    }
+    if(xmlSecTransformCtxPrepare(&transformCtx, xmlSecTransformDataTypeBin) < 0) {
+        goto done;
+    }
+
+    /* push the data in chunks, the last chunk is final */
+    for(pos = 0; pos < ctx->dataSize; pos += size) {
+        size = ctx->dataSize - pos;
+        if(size > ctx->chunkSize) {
+            size = ctx->chunkSize;
+        }
+        if(xmlSecTransformPushBin(transformCtx.first, ctx->data + pos, size,
+                (pos + size >= ctx->dataSize) ? 1 : 0, &transformCtx) < 0) {
+            goto done;
+        }
+    }
+    if(ctx->operation == xmlSecTransformOperationVerify) {
+        if(xmlSecTransformVerify(transform, ctx->signature, ctx->signatureSize, &transformCtx) < 0) {
+            goto done;
+        }
+        if(transform->status != xmlSecTransformStatusOk) {
+            goto done;
+        }
+    } else {
+        if((transformCtx.result == NULL) || (xmlSecBufferGetSize(transformCtx.result) == 0)) {
+            goto done;
+        }
+        if((ctx->output != NULL) && (xmlSecBufferSetData(ctx->output,
+                xmlSecBufferGetData(transformCtx.result), xmlSecBufferGetSize(transformCtx.result)) < 0)) {
+            goto done;
+        }
+    }
+    res = (int)ctx->dataSize;
+
+done:
+    xmlSecTransformCtxFinalize(&transformCtx);
+    return(res);
+}
+
+/**
+ * bench_key_generate:
+ * @name:               the key data klass name.
+ * @bits:               the key size in bits.
+ *
+ * Generates a session key for the key data klass registered by the
+ * xmlsec-crypto library.
+ *
+ * Returns the pointer to the key or NULL if an error occurs.
+ */
+static xmlSecKeyPtr
+bench_key_generate(const char* name, xmlSecSize bits) {
+    xmlSecKeyPtr key;
+
+    assert(name);
+
+    key = xmlSecKeyGenerateByName(BAD_CAST name, bits, xmlSecKeyDataTypeSession);
+    if(key == NULL) {
+        fprintf(stderr, "Error: failed to generate %s key.\n", name);
+    }
+    return(key);
+}
+
+static int
+bench_transforms(const char* group) {
+    static const xmlSecSize chunks[] = { 64, 1024, 16 * 1024, BENCH_DATA_SIZE };
+    static const struct {
+        const char* name;
+        const char* keyName;
+        xmlSecSize keyBits;
+    } digests[] = {
+        { "sha1",           NULL,   0 },
+        { "sha256",         NULL,   0 },
+        { "sha512",         NULL,   0 },
+        { NULL,             NULL,   0 }
+    }, hmacs[] = {
+        { "hmac-sha1",      "hmac", 256 },
+        { "hmac-sha256",    "hmac", 256 },
+        { NULL,             NULL,   0 }
+    }, ciphers[] = {
+        { "tripledes-cbc",  "des",  192 },
+        { "aes128-cbc",     "aes",  128 },
+        { "aes256-cbc",     "aes",  256 },
+        { "aes128-gcm",     "aes",  128 },
+        { "aes256-gcm",     "aes",  256 },
+        { NULL,             NULL,   0 }
+    }, *transforms;
+    xmlSecTransformOperation operation;
+    bench_transform_data ctx;
+    xmlSecByte* data;
+    char param[32];
+    size_t ii, jj;
+    int res = -1;
+
+    assert(group);
+
+    if(strcmp(group, "digest") == 0) {
+        transforms = digests;
+        operation = xmlSecTransformOperationSign;
+    } else if(strcmp(group, "hmac") == 0) {
+        transforms = hmacs;
+        operation = xmlSecTransformOperationSign;
+    } else {
+        transforms = ciphers;
+        operation = xmlSecTransformOperationEncrypt;
+    }
+
+    data = bench_data_create(BENCH_DATA_SIZE);
+    if(data == NULL) {
+        return(-1);
+    }
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.operation = operation;
+    ctx.data = data;
+    ctx.dataSize = BENCH_DATA_SIZE;
+
+    for(ii = 0; transforms[ii].name != NULL; ++ii) {
+        /* not every xmlsec-crypto library supports every transform */
+        ctx.id = xmlSecTransformIdListFindByName(xmlSecTransformIdsGet(),
+                    BAD_CAST transforms[ii].name, xmlSecTransformUsageAny);
+        if(ctx.id == xmlSecTransformIdUnknown) {
+            fprintf(stdout, "  %-8s %-8s %-24s %-10s %16s %12s\n",
+                bench_crypto, group, transforms[ii].name, "-", "n/a", "n/a");
+            continue;
+        }
+        if(transforms[ii].keyName != NULL) {
+            ctx.key = bench_key_generate(transforms[ii].keyName, transforms[ii].keyBits);
+            if(ctx.key == NULL) {
+                goto done;
+            }
+        }
+        for(jj = 0; jj < sizeof(chunks) / sizeof(chunks[0]); ++jj) {
+            ctx.chunkSize = chunks[jj];
+            bench_size_name(chunks[jj], param, sizeof(param));
+            if(bench_run(group, transforms[ii].name, param, bench_transform_execute, &ctx) < 0) {
+                goto done;
+            }
+        }
+        if(ctx.key != NULL) {
+            xmlSecKeyDestroy(ctx.key);
+            ctx.key = NULL;
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(ctx.key != NULL) {
+        xmlSecKeyDestroy(ctx.key);
+    }
+    free(data);
+    return(res);
+}
+
+/****************************************************************************
+ *
+ * Signature and encryption algorithms: the operations rate for a small
+ * (typical for XML documents) data and the keys from the tests folder
+ *
+ ***************************************************************************/
+typedef struct _bench_algorithm {
+    const char*         name;           /* the transform name */
+    const char*         keyFile;        /* the PKCS12 file in the keys folder or NULL */
+    const char*         keyName;        /* the key data name for the generated key or NULL */
+    xmlSecSize          keyBits;
+    xmlSecSize          dataSize;
+} bench_algorithm;
+
+static void
+bench_print_na(const char* group, const char* name, const char* param, const char* reason) {
+    fprintf(stdout, "  %-8s %-8s %-24s %-10s %16s %12s\n",
+        bench_crypto, group, name, param, reason, "-");
+    fflush(stdout);
+}
+
+/**
+ * bench_algorithm_run:
+ * @group:              the benchmark group name.
+ * @alg:                the algorithm.
+ * @dir:                the keys folder.
+ *
+ * Measures the sign and verify (or encrypt and decrypt) operations
+ * for @alg. The algorithms not supported by the crypto library are
+ * reported as "n/a" and the failed operations are reported as "failed".
+ *
+ * Returns 0 on success or a negative value if an error occurs.
+ */
+static int
+bench_algorithm_run(const char* group, const bench_algorithm* alg, const char* dir) {
+    const char* names[2];
+    xmlSecTransformOperation operations[2];
+    bench_transform_data ctx;
+    xmlSecBufferPtr output = NULL;
+    xmlSecByte* data = NULL;
+    char filename[1024];
+    int res = -1;
+
+    assert(group);
+    assert(alg);
+    assert(alg->name);
+    assert(dir);
+
+    if(strcmp(group, "sign") == 0) {
+        names[0] = "sign";
+        names[1] = "verify";
+        operations[0] = xmlSecTransformOperationSign;
+        operations[1] = xmlSecTransformOperationVerify;
+    } else {
+        names[0] = "encrypt";
+        names[1] = "decrypt";
+        operations[0] = xmlSecTransformOperationEncrypt;
+        operations[1] = xmlSecTransformOperationDecrypt;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.id = xmlSecTransformIdListFindByName(xmlSecTransformIdsGet(),
+                BAD_CAST alg->name, xmlSecTransformUsageAny);
+    if(ctx.id == xmlSecTransformIdUnknown) {
+        bench_print_na(group, alg->name, names[0], "n/a");
+        bench_print_na(group, alg->name, names[1], "n/a");
+        return(0);
+    }
+    if(alg->keyFile != NULL) {
+        snprintf(filename, sizeof(filename), "%s/%s", dir, alg->keyFile);
+        ctx.key = xmlSecCryptoAppPkcs12Load(filename, "secret123", NULL, NULL);
+        if(ctx.key == NULL) {
+            fprintf(stderr, "Error: failed to load pkcs12 key from \"%s\".\n", filename);
+            bench_print_na(group, alg->name, names[0], "n/a");
+            bench_print_na(group, alg->name, names[1], "n/a");
+            return(0);
+        }
+    } else if(alg->keyName != NULL) {
+        ctx.key = bench_key_generate(alg->keyName, alg->keyBits);
+        if(ctx.key == NULL) {
+            return(-1);
+        }
+    }
+
+    data = bench_data_create(alg->dataSize);
+    output = xmlSecBufferCreate(0);
+    if((data == NULL) || (output == NULL)) {
+        goto done;
+    }
+    ctx.data = data;
+    ctx.dataSize = alg->dataSize;
+    ctx.chunkSize = alg->dataSize;
+
+    /* the first operation produces the input for the second one */
+    ctx.operation = operations[0];
+    ctx.output = output;
+    if(bench_transform_execute(&ctx) < 0) {
+        fprintf(stderr, "Error: benchmark %s/%s/%s failed.\n", group, alg->name, names[0]);
+        bench_print_na(group, alg->name, names[0], "failed");
+        bench_print_na(group, alg->name, names[1], "failed");
+        res = 0;
+        goto done;
+    }
+    ctx.output = NULL;
+    if(bench_run(group, alg->name, names[0], bench_transform_execute, &ctx) < 0) {
+        bench_print_na(group, alg->name, names[0], "failed");
+    }
+
+    ctx.operation = operations[1];
+    if(operations[1] == xmlSecTransformOperationVerify) {
+        ctx.signature = xmlSecBufferGetData(output);
+        ctx.signatureSize = xmlSecBufferGetSize(output);
+    } else {
+        ctx.data = xmlSecBufferGetData(output);
+        ctx.dataSize = xmlSecBufferGetSize(output);
+        ctx.chunkSize = ctx.dataSize;
+    }
+    if(bench_run(group, alg->name, names[1], bench_transform_execute, &ctx) < 0) {
+        bench_print_na(group, alg->name, names[1], "failed");
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(output != NULL) {
+        xmlSecBufferDestroy(output);
+    }
+    if(ctx.key != NULL) {
+        xmlSecKeyDestroy(ctx.key);
+    }
+    free(data);
+    return(res);
+}
+
+static int
+bench_algorithms(const char* group, const char* dir) {
+    static const bench_algorithm signatures[] = {
+        { "rsa-sha256",         "rsakey.p12",                   NULL,   0,      1024 },
+        { "rsa-pss-sha256",     "rsakey.p12",                   NULL,   0,      1024 },
+        { "ecdsa-sha256",       "ecdsa-secp256r1-key.p12",      NULL,   0,      1024 },
+        { "ecdsa-sha384",       "ecdsa-secp384r1-key.p12",      NULL,   0,      1024 },
+        { "eddsa-ed25519",      NULL,                           NULL,   0,      1024 },
+        { NULL,                 NULL,                           NULL,   0,      0 }
+    }, encryptions[] = {
+        { "aes128-gcm",         NULL,                           "aes",  128,    1024 },
+        { "aes256-gcm",         NULL,                           "aes",  256,    1024 },
+        { "aes128-cbc",         NULL,                           "aes",  128,    1024 },
+        { "aes256-cbc",         NULL,                           "aes",  256,    1024 },
+        { "kw-aes128",          NULL,                           "aes",  128,    32 },
+        { "kw-aes256",          NULL,                           "aes",  256,    32 },
+        { "rsa-oaep-mgf1p",     "rsakey.p12",                   NULL,   0,      32 },
+        { NULL,                 NULL,                           NULL,   0,      0 }
+    };
+    const bench_algorithm* algs;
+    size_t ii;
+
+    assert(group);
+    assert(dir);
+
+    algs = (strcmp(group, "sign") == 0) ? signatures : encryptions;
+    for(ii = 0; algs[ii].name != NULL; ++ii) {
+        if(bench_algorithm_run(group, &(algs[ii]), dir) < 0) {
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+/****************************************************************************
+ *
+ * Keys stores
+ *
+ ***************************************************************************/
+typedef struct _bench_keys_data {
+    xmlSecKeyStorePtr   store;
+    xmlSecKeyInfoCtxPtr keyInfoCtx;
+    xmlChar**           names;
+    xmlSecSize          namesSize;
+    xmlSecSize          pos;
+} bench_keys_data;
+
+static int
+bench_keys_find(void* data) {
+    bench_keys_data* ctx = (bench_keys_data*)data;
+    xmlSecKeyPtr key;
+
+    assert(ctx);
+
+    /* walk thru all the names in a "random" order */
+    ctx->pos = (ctx->pos + 7919) % ctx->namesSize;
+    key = xmlSecKeyStoreFindKey(ctx->store, ctx->names[ctx->pos], ctx->keyInfoCtx);
+    if(key == NULL) {
+        return(-1);
+    }
+    xmlSecKeyDestroy(key);
+    return(0);
+}
+
+static int
+bench_keys(void) {
+    static const xmlSecSize sizes[] = { 10, 100, 1000, 10000 };
+    bench_keys_data ctx;
+    xmlSecKeyStorePtr simple = NULL;
+    xmlSecKeyStorePtr snapshot = NULL;
+    xmlSecKeyPtr key = NULL;
+    char param[32];
+    char name[32];
+    size_t ii;
+    xmlSecSize jj;
+    int res = -1;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.names = (xmlChar**)calloc(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1], sizeof(xmlChar*));
+    if(ctx.names == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        return(-1);
+    }
+    ctx.keyInfoCtx = xmlSecKeyInfoCtxCreate(NULL);
+    if(ctx.keyInfoCtx == NULL) {
+        fprintf(stderr, "Error: xmlSecKeyInfoCtxCreate failed.\n");
+        goto done;
+    }
+
+    for(ii = 0; ii < sizeof(sizes) / sizeof(sizes[0]); ++ii) {
+        simple = xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId);
+        if(simple == NULL) {
+            fprintf(stderr, "Error: xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId) failed.\n");
+            goto done;
+        }
+        for(jj = 0; jj < sizes[ii]; ++jj) {
+            if(ctx.names[jj] == NULL) {
+                snprintf(name, sizeof(name), "key-%lu", (unsigned long)jj);
+                ctx.names[jj] = xmlStrdup(BAD_CAST name);
+                if(ctx.names[jj] == NULL) {
+                    fprintf(stderr, "Error: out of memory.\n");
+                    goto done;
+                }
+            }
+            key = bench_key_generate("hmac", 128);
+            if(key == NULL) {
+                goto done;
+            }
+            if(xmlSecKeySetName(key, ctx.names[jj]) < 0) {
+                fprintf(stderr, "Error: xmlSecKeySetName failed.\n");
+                goto done;
+            }
+            if(xmlSecSimpleKeysStoreAdoptKey(simple, key) < 0) {
+                fprintf(stderr, "Error: xmlSecSimpleKeysStoreAdoptKey failed.\n");
+                goto done;
+            }
+            key = NULL; /* owned by store */
+        }
+        ctx.namesSize = sizes[ii];
+        bench_size_name(sizes[ii], param, sizeof(param));
+
+        ctx.store = simple;
+        if(bench_run("keys", "simple-store", param, bench_keys_find, &ctx) < 0) {
+            goto done;
+        }
+
+        /* the snapshot store takes the keys from the simple store */
+        snapshot = xmlSecKeyStoreCreate(xmlSecSnapshotKeysStoreId);
+        if(snapshot == NULL) {
+            fprintf(stderr, "Error: xmlSecKeyStoreCreate(xmlSecSnapshotKeysStoreId) failed.\n");
+            goto done;
+        }
+        if(xmlSecSnapshotKeysStoreAdoptKeysStore(snapshot, simple) < 0) {
+            fprintf(stderr, "Error: xmlSecSnapshotKeysStoreAdoptKeysStore failed.\n");
+            goto done;
+        }
+        simple = NULL; /* owned by snapshot */
+
+        ctx.store = snapshot;
+        if(bench_run("keys", "snapshot-store", param, bench_keys_find, &ctx) < 0) {
+            goto done;
+        }
+        xmlSecKeyStoreDestroy(snapshot);
+        snapshot = NULL;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(key != NULL) {
+        xmlSecKeyDestroy(key);
+    }
+    if(simple != NULL) {
+        xmlSecKeyStoreDestroy(simple);
+    }
+    if(snapshot != NULL) {
+        xmlSecKeyStoreDestroy(snapshot);
+    }
+    if(ctx.keyInfoCtx != NULL) {
+        xmlSecKeyInfoCtxDestroy(ctx.keyInfoCtx);
+    }
+    for(jj = 0; jj < sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]; ++jj) {
+        if(ctx.names[jj] != NULL) {
+            xmlFree(ctx.names[jj]);
+        }
+    }
+    free(ctx.names);
+    return(res);
+}
+
+/****************************************************************************
+ *
+ * X509 certificates
+ *
+ ***************************************************************************/
+#ifndef XMLSEC_NO_X509
+typedef struct _bench_x509_data {
+    xmlSecKeysMngrPtr   mngr;
+    xmlNodePtr          keyInfoNode;
+    unsigned int        flags;
+} bench_x509_data;
+
+static int
+bench_x509_get_key(void* data) {
+    bench_x509_data* ctx = (bench_x509_data*)data;
+    xmlSecKeyInfoCtx keyInfoCtx;
+    xmlSecKeyPtr key;
+
+    assert(ctx);
+
+    if(xmlSecKeyInfoCtxInitialize(&keyInfoCtx, ctx->mngr) < 0) {
+        return(-1);
+    }
+    keyInfoCtx.mode = xmlSecKeyInfoModeRead;
+    keyInfoCtx.flags = ctx->flags;
+    keyInfoCtx.keyReq.keyType = xmlSecKeyDataTypePublic;
+    keyInfoCtx.keyReq.keyUsage = xmlSecKeyUsageVerify;
+
+    key = xmlSecKeysMngrGetKey(ctx->keyInfoNode, &keyInfoCtx);
+    xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+    if(key == NULL) {
+        return(-1);
+    }
+    xmlSecKeyDestroy(key);
+    return(0);
+}
+
+static int
+bench_x509(const char* dir) {
+    bench_x509_data ctx;
+    xmlDocPtr doc = NULL;
+    char filename[1024];
+    int res = -1;
+
+    assert(dir);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.mngr = xmlSecKeysMngrCreate();
+    if(ctx.mngr == NULL) {
+        fprintf(stderr, "Error: failed to create keys manager.\n");
+        return(-1);
+    }
+    if(xmlSecCryptoAppDefaultKeysMngrInit(ctx.mngr) < 0) {
+        fprintf(stderr, "Error: failed to initialize keys manager.\n");
+        goto done;
+    }
+
+    /* the document certificate is signed by the untrusted ca2cert which
+     * is signed by the trusted cacert */
+    snprintf(filename, sizeof(filename), "%s/cacert.pem", dir);
+    if(xmlSecCryptoAppKeysMngrCertLoad(ctx.mngr, filename, xmlSecKeyDataFormatPem, xmlSecKeyDataTypeTrusted) < 0) {
+        fprintf(stderr, "Error: failed to load pem certificate from \"%s\"\n", filename);
+        goto done;
+    }
+    snprintf(filename, sizeof(filename), "%s/ca2cert.pem", dir);
+    if(xmlSecCryptoAppKeysMngrCertLoad(ctx.mngr, filename, xmlSecKeyDataFormatPem, xmlSecKeyDataTypeNone) < 0) {
+        fprintf(stderr, "Error: failed to load pem certificate from \"%s\"\n", filename);
+        goto done;
+    }
+
+    snprintf(filename, sizeof(filename), "%s/sign3-res.xml", dir);
+    doc = xmlReadFile(filename, NULL, 0);
+    if((doc == NULL) || (xmlDocGetRootElement(doc) == NULL)) {
+        fprintf(stderr, "Error: unable to parse file \"%s\"\n", filename);
+        goto done;
+    }
+    ctx.keyInfoNode = xmlSecFindNode(xmlDocGetRootElement(doc), xmlSecNodeKeyInfo, xmlSecDSigNs);
+    if(ctx.keyInfoNode == NULL) {
+        fprintf(stderr, "Error: KeyInfo node is not found in \"%s\"\n", filename);
+        goto done;
+    }
+
+    /* parse the certificates only first to see the verification cost */
+    ctx.flags = XMLSEC_KEYINFO_FLAGS_X509DATA_DONT_VERIFY_CERTS;
+    if(bench_run("x509", "parse", "chain-3", bench_x509_get_key, &ctx) < 0) {
+        goto done;
+    }
+    ctx.flags = 0;
+    if(bench_run("x509", "parse-and-verify", "chain-3", bench_x509_get_key, &ctx) < 0) {
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(doc != NULL) {
+        xmlFreeDoc(doc);
+    }
+    xmlSecKeysMngrDestroy(ctx.mngr);
+    return(res);
+}
+#else  /* XMLSEC_NO_X509 */
+static int
+bench_x509(const char* dir) {
+    assert(dir);
+
+    fprintf(stdout, "  %-8s %-8s %-24s %-10s %16s %12s\n",
+        bench_crypto, "x509", "parse-and-verify", "chain-3", "n/a", "n/a");
+    return(0);
+}
+#endif /* XMLSEC_NO_X509 */
@@ -0,0 +1,838 @@
+/**
+ * XML Security Library benchmarks: the recorded workload replay
+ *
+ * Replays the operations recorded with xmlSecRecorderStart() (the documents
+ * and the "workload.txt" operations list in the recorder folder) against the
+ * keys manager loaded from the keys files and reports the throughput, the
+ * latency percentiles and the results for each operation type:
+ *
+ *      <op> <count> <ok> <invalid> <error> <mismatch> <ops/sec> <p50> <p90> <p99> <p99.9> <max>
+ *
+ * where <mismatch> is the number of the operations with the result different
+ * from the recorded one and the latencies are in milliseconds. If the target
+ * rate is set then the operations are started on schedule (open loop) and the
+ * latency includes the time the operation waited for a free thread.
+ *
+ * Usage:
+ *      xmlsecreplay [--crypto <name>] [--keys <file>] [--trusted-pem <file>]
+ *                   [--id-attr <name>] [--threads <number>] [--rate <ops/sec>]
+ *                   [--count <number>] <folder>
+ *
+ * The "--keys", "--trusted-pem" and "--id-attr" options can be repeated.
+ * The operations are replayed in the recorded order, the list is repeated
+ * if "--count" is greater than the number of the recorded operations.
+ *
+ * Example:
+ *      ./xmlsecreplay --keys keys.xml --threads 8 --rate 2000 --count 100000 workload
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif /* !defined(_WIN32) && !defined(_POSIX_C_SOURCE) */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(XMLSEC_APP_HAVE_PTHREAD)
+#include <pthread.h>
+#endif /* defined(_WIN32) */
+
+#include <libxml/tree.h>
+#include <libxml/xmlmemory.h>
+#include <libxml/parser.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/xmltree.h>
+#include <xmlsec/keys.h>
+#include <xmlsec/keysmngr.h>
+#include <xmlsec/xmldsig.h>
+#include <xmlsec/xmlenc.h>
+#include <xmlsec/recorder.h>
+#include <xmlsec/crypto.h>
+
+/* the max manifest line length */
+#define REPLAY_LINE_SIZE        4096
+
+typedef enum {
+    replay_op_verify = 0,
+    replay_op_sign,
+    replay_op_decrypt,
+    replay_op_num
+} replay_op;
+
+typedef enum {
+    replay_result_ok = 0,
+    replay_result_invalid,
+    replay_result_error
+} replay_result;
+
+typedef struct _replay_record {
+    char*               file;
+    replay_op           op;
+    unsigned int        flags;
+    unsigned int        flags2;
+    replay_result       expected;
+    char*               keyName;
+    xmlSecByte*         data;
+    xmlSecSize          size;
+} replay_record;
+
+typedef struct _replay_ctx {
+    xmlSecKeysMngrPtr   mngr;
+    const xmlChar**     ids;
+    replay_record*      records;
+    long                recordsNum;
+    long                count;
+    double              rate;
+    double              start;
+
+    /* the next operation index (protected by the mutex) */
+    long                next;
+#if !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD)
+    pthread_mutex_t     mutex;
+#endif /* !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD) */
+
+    /* the results for each operation index */
+    double*             latencies;
+    replay_result*      results;
+} replay_ctx;
+
+static const char* const replay_op_names[replay_op_num] = { "verify", "sign", "decrypt" };
+static const char* const replay_result_names[] = { "ok", "invalid", "error" };
+
+static double           replay_now              (void);
+static void             replay_sleep            (double seconds);
+static int              replay_load             (const char* dir,
+                                                 replay_record** records,
+                                                 long* recordsNum);
+static void             replay_free             (replay_record* records,
+                                                 long recordsNum);
+static replay_result    replay_run_one          (replay_ctx* ctx,
+                                                 const replay_record* rec);
+static int              replay_run              (replay_ctx* ctx,
+                                                 int threads);
+static void             replay_report           (replay_ctx* ctx,
+                                                 double elapsed);
+
+int
+main(int argc, char **argv) {
+    const char* crypto = "default";
+    const char* dir = NULL;
+    const char** keys;
+    const char** trusted;
+    const xmlChar** ids;
+    int keysNum = 0, trustedNum = 0, idsNum = 0;
+    int threads = 1;
+    replay_ctx ctx;
+    double start;
+    int res = 1;
+    int i;
+
+    assert(argv);
+
+    memset(&ctx, 0, sizeof(ctx));
+    keys = (const char**)malloc(sizeof(const char*) * (size_t)argc);
+    trusted = (const char**)malloc(sizeof(const char*) * (size_t)argc);
+    ids = (const xmlChar**)malloc(sizeof(const xmlChar*) * (size_t)(argc + 1));
+    if((keys == NULL) || (trusted == NULL) || (ids == NULL)) {
+        fprintf(stderr, "Error: out of memory.\n");
+        free((void*)keys);
+        free((void*)trusted);
+        free((void*)ids);
+        return(1);
+    }
+    for(i = 1; i < argc; ++i) {
+        if((strcmp(argv[i], "--crypto") == 0) && (i + 1 < argc)) {
+            crypto = argv[++i];
+        } else if((strcmp(argv[i], "--keys") == 0) && (i + 1 < argc)) {
+            keys[keysNum++] = argv[++i];
+        } else if((strcmp(argv[i], "--trusted-pem") == 0) && (i + 1 < argc)) {
+            trusted[trustedNum++] = argv[++i];
+        } else if((strcmp(argv[i], "--id-attr") == 0) && (i + 1 < argc)) {
+            ids[idsNum++] = BAD_CAST argv[++i];
+        } else if((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc)) {
+            threads = atoi(argv[++i]);
+        } else if((strcmp(argv[i], "--rate") == 0) && (i + 1 < argc)) {
+            ctx.rate = atof(argv[++i]);
+        } else if((strcmp(argv[i], "--count") == 0) && (i + 1 < argc)) {
+            ctx.count = atol(argv[++i]);
+        } else if((argv[i][0] != '-') && (dir == NULL)) {
+            dir = argv[i];
+        } else {
+            dir = NULL;
+            break;
+        }
+    }
+    ids[idsNum] = NULL;
+    if((dir == NULL) || (threads <= 0) || (ctx.rate < 0) || (ctx.count < 0)) {
+        fprintf(stderr, "Usage: %s [--crypto <name>] [--keys <file>] [--trusted-pem <file>] [--id-attr <name>]\n"
+                        "        [--threads <number>] [--rate <ops/sec>] [--count <number>] <folder>\n", argv[0]);
+        goto cleanup;
+    }
+#if defined(_WIN32) || !defined(XMLSEC_APP_HAVE_PTHREAD)
+    if(threads > 1) {
+        fprintf(stderr, "Warning: threads are not supported, using the main thread\n");
+        threads = 1;
+    }
+#endif /* defined(_WIN32) || !defined(XMLSEC_APP_HAVE_PTHREAD) */
+
+    if(replay_load(dir, &(ctx.records), &(ctx.recordsNum)) < 0) {
+        goto cleanup;
+    }
+    if(ctx.count == 0) {
+        ctx.count = ctx.recordsNum;
+    }
+    ctx.ids = (idsNum > 0) ? ids : NULL;
+    ctx.latencies = (double*)malloc(sizeof(double) * (size_t)ctx.count);
+    ctx.results = (replay_result*)malloc(sizeof(replay_result) * (size_t)ctx.count);
+    if((ctx.latencies == NULL) || (ctx.results == NULL)) {
+        fprintf(stderr, "Error: out of memory.\n");
+        goto cleanup;
+    }
+
+    /* Init libxml library */
+    xmlInitParser();
+    LIBXML_TEST_VERSION
+
+    /* Init xmlsec library */
+    if(xmlSecInit() < 0) {
+        fprintf(stderr, "Error: xmlsec initialization failed.\n");
+        goto cleanup;
+    }
+
+    /* Check loaded library version */
+    if(xmlSecCheckVersion() != 1) {
+        fprintf(stderr, "Error: loaded xmlsec library version is not compatible.\n");
+        goto shutdown;
+    }
+
+    /* Load the requested crypto engine if we are supporting dynamic
+     * loading for xmlsec-crypto libraries, otherwise only the crypto
+     * library we are linked with is available.
+     */
+#ifdef XMLSEC_CRYPTO_DYNAMIC_LOADING
+    if(xmlSecCryptoDLLoadLibrary((strcmp(crypto, "default") != 0) ? BAD_CAST crypto : NULL) < 0) {
+        fprintf(stderr, "Error: unable to load \"%s\" xmlsec-crypto library. Make sure\n"
+                        "that you have it installed and check shared libraries path\n"
+                        "(LD_LIBRARY_PATH and/or LTDL_LIBRARY_PATH) environment variables.\n",
+                        crypto);
+        goto shutdown;
+    }
+#else  /* XMLSEC_CRYPTO_DYNAMIC_LOADING */
+    if((strcmp(crypto, "default") != 0) && (!xmlStrEqual(BAD_CAST crypto, xmlSecGetDefaultCrypto()))) {
+        fprintf(stderr, "Error: \"%s\" xmlsec-crypto library is not available, "
+                        "the replay is linked with \"%s\".\n",
+                        crypto, (const char*)xmlSecGetDefaultCrypto());
+        goto shutdown;
+    }
+#endif /* XMLSEC_CRYPTO_DYNAMIC_LOADING */
+
+    /* Init crypto library */
+    if(xmlSecCryptoAppInit(NULL) < 0) {
+        fprintf(stderr, "Error: crypto initialization failed.\n");
+        goto shutdown;
+    }
+
+    /* Init xmlsec-crypto library */
+    if(xmlSecCryptoInit() < 0) {
+        fprintf(stderr, "Error: xmlsec-crypto initialization failed.\n");
+        goto shutdown;
+    }
+
+    /* the keys manager shared by all the threads */
+    ctx.mngr = xmlSecKeysMngrCreate();
+    if((ctx.mngr == NULL) || (xmlSecCryptoAppDefaultKeysMngrInit(ctx.mngr) < 0)) {
+        fprintf(stderr, "Error: failed to create keys manager.\n");
+        goto shutdown;
+    }
+    for(i = 0; i < keysNum; ++i) {
+        if(xmlSecCryptoAppDefaultKeysMngrLoad(ctx.mngr, keys[i]) < 0) {
+            fprintf(stderr, "Error: failed to load keys from \"%s\".\n", keys[i]);
+            goto shutdown;
+        }
+    }
+    for(i = 0; i < trustedNum; ++i) {
+#ifndef XMLSEC_NO_X509
+        if(xmlSecCryptoAppKeysMngrCertLoad(ctx.mngr, trusted[i], xmlSecKeyDataFormatPem, xmlSecKeyDataTypeTrusted) < 0) {
+            fprintf(stderr, "Error: failed to load trusted certificate from \"%s\".\n", trusted[i]);
+            goto shutdown;
+        }
+#else  /* XMLSEC_NO_X509 */
+        fprintf(stderr, "Error: X509 support is disabled, can not load \"%s\".\n", trusted[i]);
+        goto shutdown;
+#endif /* XMLSEC_NO_X509 */
+    }
+
+    start = replay_now();
+    if(replay_run(&ctx, threads) < 0) {
+        goto shutdown;
+    }
+    replay_report(&ctx, replay_now() - start);
+
+    /* success */
+    res = 0;
+
+shutdown:
+    if(ctx.mngr != NULL) {
+        xmlSecKeysMngrDestroy(ctx.mngr);
+    }
+
+    /* Shutdown xmlsec-crypto library */
+    xmlSecCryptoShutdown();
+
+    /* Shutdown crypto library */
+    xmlSecCryptoAppShutdown();
+
+    /* Shutdown xmlsec library */
+    xmlSecShutdown();
+
+    /* Shutdown libxml */
+    xmlCleanupParser();
+
+cleanup:
+    replay_free(ctx.records, ctx.recordsNum);
+    free(ctx.latencies);
+    free(ctx.results);
+    free((void*)keys);
+    free((void*)trusted);
+    free((void*)ids);
+    return(res);
+}
+
+/**
+ * replay_now:
+ *
+ * Gets the monotonic clock time.
+ *
+ * Returns the current time in seconds.
+ */
+static double
+replay_now(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER freq, counter;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return((double)counter.QuadPart / (double)freq.QuadPart);
+#else  /* defined(_WIN32) */
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0);
+#endif /* defined(_WIN32) */
+}
+
+/**
+ * replay_sleep:
+ * @seconds:            the time to sleep.
+ *
+ * Suspends the current thread.
+ */
+static void
+replay_sleep(double seconds) {
+#if defined(_WIN32)
+    Sleep((DWORD)(seconds * 1000));
+#else  /* defined(_WIN32) */
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1000000000.0);
+    nanosleep(&ts, NULL);
+#endif /* defined(_WIN32) */
+}
+
+/**
+ * replay_read_file:
+ * @filename:           the file name.
+ * @size:               the file size.
+ *
+ * Reads the whole file to memory.
+ *
+ * Returns the file content (the caller must free it) or NULL if an error occurs.
+ */
+static xmlSecByte*
+replay_read_file(const char* filename, xmlSecSize* size) {
+    FILE* f;
+    xmlSecByte* data;
+    long len;
+
+    assert(filename);
+    assert(size);
+
+    f = fopen(filename, "rb");
+    if(f == NULL) {
+        fprintf(stderr, "Error: failed to open \"%s\".\n", filename);
+        return(NULL);
+    }
+    if((fseek(f, 0, SEEK_END) != 0) || ((len = ftell(f)) <= 0) || (fseek(f, 0, SEEK_SET) != 0)) {
+        fprintf(stderr, "Error: failed to get \"%s\" file size.\n", filename);
+        fclose(f);
+        return(NULL);
+    }
+    data = (xmlSecByte*)malloc((size_t)len);
+    if(data == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        fclose(f);
+        return(NULL);
+    }
+    if(fread(data, (size_t)len, 1, f) != 1) {
+        fprintf(stderr, "Error: failed to read \"%s\".\n", filename);
+        free(data);
+        fclose(f);
+        return(NULL);
+    }
+    fclose(f);
+    (*size) = (xmlSecSize)len;
+    return(data);
+}
+
+/**
+ * replay_load:
+ * @dir:                the recorder folder.
+ * @records:            the loaded records.
+ * @recordsNum:         the number of the loaded records.
+ *
+ * Loads the operations list and the documents from the recorder folder.
+ *
+ * Returns 0 on success or a negative value if an error occurs.
+ */
+static int
+replay_load(const char* dir, replay_record** records, long* recordsNum) {
+    char line[REPLAY_LINE_SIZE];
+    char file[256], op[16], result[16];
+    char* filename;
+    char* keyName;
+    size_t len, filenameSize;
+    replay_record* rec;
+    long allocated = 0;
+    FILE* f;
+    int pos;
+    int ii;
+    int res = -1;
+
+    assert(dir);
+    assert(records);
+    assert(recordsNum);
+
+    (*records) = NULL;
+    (*recordsNum) = 0;
+
+    filenameSize = strlen(dir) + sizeof(file) + sizeof(XMLSEC_RECORDER_MANIFEST_FILENAME) + 2;
+    filename = (char*)malloc(filenameSize);
+    if(filename == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        return(-1);
+    }
+    snprintf(filename, filenameSize, "%s/%s", dir, XMLSEC_RECORDER_MANIFEST_FILENAME);
+    f = fopen(filename, "r");
+    if(f == NULL) {
+        fprintf(stderr, "Error: failed to open \"%s\".\n", filename);
+        free(filename);
+        return(-1);
+    }
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        len = strlen(line);
+        while((len > 0) && ((line[len - 1] == '\n') || (line[len - 1] == '\r'))) {
+            line[--len] = '\0';
+        }
+        if((len == 0) || (line[0] == '#')) {
+            continue;
+        }
+
+        if((*recordsNum) >= allocated) {
+            replay_record* tmp;
+
+            allocated = (allocated > 0) ? (2 * allocated) : 64;
+            tmp = (replay_record*)realloc((*records), sizeof(replay_record) * (size_t)allocated);
+            if(tmp == NULL) {
+                fprintf(stderr, "Error: out of memory.\n");
+                goto done;
+            }
+            (*records) = tmp;
+        }
+        rec = &((*records)[*recordsNum]);
+        memset(rec, 0, sizeof(replay_record));
+
+        pos = 0;
+        if(sscanf(line, "%255s %15s %x %x %15s %n", file, op, &(rec->flags), &(rec->flags2), result, &pos) != 5) {
+            fprintf(stderr, "Error: invalid line \"%s\".\n", line);
+            goto done;
+        }
+        for(ii = 0; ii < replay_op_num; ++ii) {
+            if(strcmp(op, replay_op_names[ii]) == 0) {
+                break;
+            }
+        }
+        if(ii >= replay_op_num) {
+            fprintf(stderr, "Error: unknown operation \"%s\".\n", op);
+            goto done;
+        }
+        rec->op = (replay_op)ii;
+        if(strcmp(result, "ok") == 0) {
+            rec->expected = replay_result_ok;
+        } else if(strcmp(result, "invalid") == 0) {
+            rec->expected = replay_result_invalid;
+        } else {
+            rec->expected = replay_result_error;
+        }
+
+        /* the key name is the rest of the line */
+        keyName = line + pos;
+        if(strcmp(keyName, "-") != 0) {
+            rec->keyName = (char*)malloc(strlen(keyName) + 1);
+            if(rec->keyName == NULL) {
+                fprintf(stderr, "Error: out of memory.\n");
+                goto done;
+            }
+            strcpy(rec->keyName, keyName);
+        }
+        rec->file = (char*)malloc(strlen(file) + 1);
+        if(rec->file == NULL) {
+            fprintf(stderr, "Error: out of memory.\n");
+            free(rec->keyName);
+            goto done;
+        }
+        strcpy(rec->file, file);
+        ++(*recordsNum);
+
+        /* the documents are parsed for each operation, only read them once */
+        snprintf(filename, filenameSize, "%s/%s", dir, file);
+        rec->data = replay_read_file(filename, &(rec->size));
+        if(rec->data == NULL) {
+            goto done;
+        }
+    }
+    if((*recordsNum) == 0) {
+        fprintf(stderr, "Error: no operations in \"%s\" folder.\n", dir);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    fclose(f);
+    free(filename);
+    return(res);
+}
+
+/**
+ * replay_free:
+ * @records:            the records.
+ * @recordsNum:         the number of the records.
+ *
+ * Frees the records loaded by #replay_load.
+ */
+static void
+replay_free(replay_record* records, long recordsNum) {
+    long ii;
+
+    if(records == NULL) {
+        return;
+    }
+    for(ii = 0; ii < recordsNum; ++ii) {
+        free(records[ii].file);
+        free(records[ii].keyName);
+        free(records[ii].data);
+    }
+    free(records);
+}
+
+/**
+ * replay_run_one:
+ * @ctx:                the replay context.
+ * @rec:                the operation to replay.
+ *
+ * Parses the document and replays one operation.
+ *
+ * Returns the operation result.
+ */
+static replay_result
+replay_run_one(replay_ctx* ctx, const replay_record* rec) {
+    replay_result res = replay_result_error;
+    xmlDocPtr doc;
+    xmlNodePtr node;
+    int ret;
+
+    assert(ctx);
+    assert(rec);
+
+    doc = xmlReadMemory((const char*)rec->data, (int)rec->size, rec->file, NULL, XML_PARSE_NONET);
+    if((doc == NULL) || (xmlDocGetRootElement(doc) == NULL)) {
+        fprintf(stderr, "Error: failed to parse \"%s\".\n", rec->file);
+        goto done;
+    }
+    if(ctx->ids != NULL) {
+        xmlSecAddIDs(doc, xmlDocGetRootElement(doc), ctx->ids);
+    }
+
+    if((rec->op == replay_op_verify) || (rec->op == replay_op_sign)) {
+        xmlSecDSigCtxPtr dsigCtx;
+
+        node = xmlSecFindNode(xmlDocGetRootElement(doc), xmlSecNodeSignature, xmlSecDSigNs);
+        if(node == NULL) {
+            fprintf(stderr, "Error: signature node is not found in \"%s\".\n", rec->file);
+            goto done;
+        }
+        dsigCtx = xmlSecDSigCtxCreate(ctx->mngr);
+        if(dsigCtx == NULL) {
+            fprintf(stderr, "Error: failed to create signature context.\n");
+            goto done;
+        }
+        dsigCtx->flags = rec->flags;
+        dsigCtx->flags2 = rec->flags2;
+
+        if(rec->op == replay_op_verify) {
+            ret = xmlSecDSigCtxVerify(dsigCtx, node);
+            if(ret >= 0) {
+                res = (dsigCtx->status == xmlSecDSigStatusSucceeded) ? replay_result_ok : replay_result_invalid;
+            }
+        } else {
+            /* the key might be set by the application rather than found by the template */
+            if(rec->keyName != NULL) {
+                dsigCtx->signKey = xmlSecKeysMngrFindKey(ctx->mngr, BAD_CAST rec->keyName, &(dsigCtx->keyInfoReadCtx));
+            }
+            ret = xmlSecDSigCtxSign(dsigCtx, node);
+            if(ret >= 0) {
+                res = replay_result_ok;
+            }
+        }
+        xmlSecDSigCtxDestroy(dsigCtx);
+    } else {
+        xmlSecEncCtxPtr encCtx;
+
+        node = xmlSecFindNode(xmlDocGetRootElement(doc), xmlSecNodeEncryptedData, xmlSecEncNs);
+        if(node == NULL) {
+            fprintf(stderr, "Error: encrypted data node is not found in \"%s\".\n", rec->file);
+            goto done;
+        }
+        encCtx = xmlSecEncCtxCreate(ctx->mngr);
+        if(encCtx == NULL) {
+            fprintf(stderr, "Error: failed to create encryption context.\n");
+            goto done;
+        }
+        encCtx->flags = rec->flags;
+        encCtx->flags2 = rec->flags2;
+        ret = xmlSecEncCtxDecrypt(encCtx, node);
+        if(ret >= 0) {
+            res = replay_result_ok;
+        }
+        xmlSecEncCtxDestroy(encCtx);
+    }
+
+done:
+    if(doc != NULL) {
+        xmlFreeDoc(doc);
+    }
+    return(res);
+}
+
+/**
+ * replay_worker:
+ * @data:               the replay context.
+ *
+ * Replays the operations until all of them are started.
+ *
+ * Returns NULL.
+ */
+static void*
+replay_worker(void* data) {
+    replay_ctx* ctx = (replay_ctx*)data;
+    const replay_record* rec;
+    double scheduled, now;
+    long ii;
+
+    assert(ctx);
+
+    for(;;) {
+#if !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD)
+        pthread_mutex_lock(&(ctx->mutex));
+#endif /* !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD) */
+        ii = ctx->next++;
+#if !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD)
+        pthread_mutex_unlock(&(ctx->mutex));
+#endif /* !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD) */
+        if(ii >= ctx->count) {
+            break;
+        }
+
+        /* open loop: the operation latency is counted from the scheduled start */
+        now = replay_now();
+        if(ctx->rate > 0) {
+            scheduled = ctx->start + (double)ii / ctx->rate;
+            if(scheduled > now) {
+                replay_sleep(scheduled - now);
+            }
+        } else {
+            scheduled = now;
+        }
+
+        rec = &(ctx->records[ii % ctx->recordsNum]);
+        ctx->results[ii] = replay_run_one(ctx, rec);
+        ctx->latencies[ii] = replay_now() - scheduled;
+    }
+    return(NULL);
+}
+
+/**
+ * replay_run:
+ * @ctx:                the replay context.
+ * @threads:            the number of threads.
+ *
+ * Replays all the operations with @threads threads.
+ *
+ * Returns 0 on success or a negative value if an error occurs.
+ */
+static int
+replay_run(replay_ctx* ctx, int threads) {
+#if !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD)
+    pthread_t* workers;
+    int started;
+    int ii;
+
+    assert(ctx);
+    assert(threads > 0);
+
+    workers = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)threads);
+    if(workers == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        return(-1);
+    }
+    if(pthread_mutex_init(&(ctx->mutex), NULL) != 0) {
+        fprintf(stderr, "Error: failed to create mutex.\n");
+        free(workers);
+        return(-1);
+    }
+    ctx->next = 0;
+    ctx->start = replay_now();
+    for(started = 0; started < threads; ++started) {
+        if(pthread_create(&(workers[started]), NULL, replay_worker, ctx) != 0) {
+            fprintf(stderr, "Error: failed to start thread %d.\n", started);
+            break;
+        }
+    }
+    for(ii = 0; ii < started; ++ii) {
+        pthread_join(workers[ii], NULL);
+    }
+    pthread_mutex_destroy(&(ctx->mutex));
+    free(workers);
+    return((started == threads) ? 0 : -1);
+#else  /* !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD) */
+    assert(ctx);
+    assert(threads == 1);
+
+    ctx->next = 0;
+    ctx->start = replay_now();
+    replay_worker(ctx);
+    return(0);
+#endif /* !defined(_WIN32) && defined(XMLSEC_APP_HAVE_PTHREAD) */
+}
+
+static int
+replay_compare_latency(const void* a, const void* b) {
+    double aa = *(const double*)a;
+    double bb = *(const double*)b;
+
+    return((aa < bb) ? -1 : ((aa > bb) ? 1 : 0));
+}
+
+/**
+ * replay_percentile:
+ * @sorted:             the sorted latencies.
+ * @num:                the number of latencies.
+ * @p:                  the percentile (0..1).
+ *
+ * Returns the @p percentile latency in milliseconds.
+ */
+static double
+replay_percentile(const double* sorted, long num, double p) {
+    long ii;
+
+    assert(sorted);
+    assert(num > 0);
+
+    ii = (long)(p * (double)num);
+    if(ii >= num) {
+        ii = num - 1;
+    }
+    return(1000.0 * sorted[ii]);
+}
+
+/**
+ * replay_report:
+ * @ctx:                the replay context.
+ * @elapsed:            the total time.
+ *
+ * Prints the results for each operation type and for all the operations.
+ */
+static void
+replay_report(replay_ctx* ctx, double elapsed) {
+    long counts[3];
+    long mismatch;
+    double* sorted;
+    long num, ii;
+    int op;
+
+    assert(ctx);
+
+    sorted = (double*)malloc(sizeof(double) * (size_t)ctx->count);
+    if(sorted == NULL) {
+        fprintf(stderr, "Error: out of memory.\n");
+        return;
+    }
+
+    fprintf(stdout, "# %-8s %10s %10s %10s %10s %10s %12s %10s %10s %10s %10s %10s\n",
+        "op", "count", "ok", "invalid", "error", "mismatch", "ops/sec",
+        "p50", "p90", "p99", "p99.9", "max");
+    for(op = 0; op <= replay_op_num; ++op) {
+        const replay_record* rec;
+
+        /* replay_op_num is used for all the operations */
+        num = mismatch = 0;
+        memset(counts, 0, sizeof(counts));
+        for(ii = 0; ii < ctx->count; ++ii) {
+            rec = &(ctx->records[ii % ctx->recordsNum]);
+            if((op != replay_op_num) && ((int)rec->op != op)) {
+                continue;
+            }
+            sorted[num++] = ctx->latencies[ii];
+            ++counts[ctx->results[ii]];
+            if(ctx->results[ii] != rec->expected) {
+                ++mismatch;
+            }
+        }
+        if(num == 0) {
+            continue;
+        }
+        qsort(sorted, (size_t)num, sizeof(double), replay_compare_latency);
+        fprintf(stdout, "  %-8s %10ld %10ld %10ld %10ld %10ld %12.1f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+            (op != replay_op_num) ? replay_op_names[op] : "all",
+            num, counts[replay_result_ok], counts[replay_result_invalid], counts[replay_result_error],
+            mismatch, (elapsed > 0) ? ((double)num / elapsed) : 0.0,
+            replay_percentile(sorted, num, 0.5), replay_percentile(sorted, num, 0.9),
+            replay_percentile(sorted, num, 0.99), replay_percentile(sorted, num, 0.999),
+            1000.0 * sorted[num - 1]);
+    }
+    fflush(stdout);
+
+    /* the recorded operations with the different results */
+    for(ii = 0; (ii < ctx->count) && (ii < ctx->recordsNum); ++ii) {
+        if(ctx->results[ii] != ctx->records[ii].expected) {
+            fprintf(stderr, "Mismatch: %s %s: recorded %s, replayed %s\n",
+                ctx->records[ii].file, replay_op_names[ctx->records[ii].op],
+                replay_result_names[ctx->records[ii].expected],
+                replay_result_names[ctx->results[ii]]);
+        }
+    }
+    free(sorted);
+}
@@ -715,6 +715,8 @@ XMLSEC_EXPORT int                               xmlSecCryptoAppKeysMngrCrlLoadMe
                                                                                  const xmlSecByte* data,
                                                                                  xmlSecSize dataSize,
                                                                                  xmlSecKeyDataFormat format);
+XMLSEC_EXPORT int                               xmlSecCryptoAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr,
+                                                                                 xmlSecSize maxSize);
 XMLSEC_DEPRECATED XMLSEC_EXPORT xmlSecKeyPtr    xmlSecCryptoAppKeyLoad          (const char *filename,
                                                                                  xmlSecKeyDataFormat format,
                                                                                  const char *pwd,
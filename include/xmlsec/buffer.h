@@ -44,12 +44,50 @@ typedef enum {
  *
  ****************************************************************************/
 
+/**
+ * xmlSecBufferZeroMode:
+ * @xmlSecBufferZeroModeAlways: the new memory is zeroed on growth and the
+ *                              removed data is zeroed immediately (default).
+ * @xmlSecBufferZeroModeOnFree: the new memory is not zeroed on growth and
+ *                              the removed data is zeroed only when the buffer
+ *                              is emptied or finalized; suitable for key material.
+ * @xmlSecBufferZeroModeNever:  the memory is never zeroed; only for non-secret
+ *                              data (e.g. encrypted or public data).
+ * @xmlSecBufferZeroModeSecure: same as #xmlSecBufferZeroModeOnFree but the memory
+ *                              is allocated from the locked secure memory arena
+ *                              (see #xmlSecSecureMemAlloc); used for key material.
+ *
+ * The buffer memory zeroing mode.
+ */
+typedef enum {
+    xmlSecBufferZeroModeAlways = 0,
+    xmlSecBufferZeroModeOnFree,
+    xmlSecBufferZeroModeNever,
+    xmlSecBufferZeroModeSecure
+} xmlSecBufferZeroMode;
+
+/**
+ * XMLSEC_BUFFER_INLINE_SIZE:
+ *
+ * The size of the storage inside #xmlSecBuffer used for small buffers
+ * (e.g. IVs, tags or digests) before allocating memory.
+ */
+#define XMLSEC_BUFFER_INLINE_SIZE                               64
+
 /**
  * xmlSecBuffer:
  * @data: the pointer to buffer data.
  * @size: the current data size.
  * @maxSize: the max data size (allocated buffer size).
  * @allocMode: the buffer memory allocation mode.
+ * @offset: the number of bytes removed from the buffer head and not yet reclaimed
+ *          (the allocated memory starts at @data - @offset).
+ * @zeroMode: the buffer memory zeroing mode.
+ * @spillSize: the allocated size above which the data is moved to an anonymous
+ *          temporary file mapped in memory (0 to always keep the data in memory).
+ * @spillFd: the temporary file descriptor when the data is spilled.
+ * @inlineData: the storage for small buffers (@data points to it until the buffer
+ *          outgrows #XMLSEC_BUFFER_INLINE_SIZE bytes).
  *
  * Binary data buffer.
  */
@@ -58,6 +96,11 @@ struct _xmlSecBuffer {
     xmlSecSize          size;
     xmlSecSize          maxSize;
     xmlSecAllocMode     allocMode;
+    xmlSecSize          offset;
+    xmlSecBufferZeroMode zeroMode;
+    xmlSecSize          spillSize;
+    int                 spillFd;
+    xmlSecByte          inlineData[XMLSEC_BUFFER_INLINE_SIZE];
 };
 
 XMLSEC_EXPORT void              xmlSecBufferSetDefaultAllocMode (xmlSecAllocMode defAllocMode,
@@ -80,8 +123,14 @@ XMLSEC_EXPORT xmlSecSize        xmlSecBufferGetMaxSize          (xmlSecBufferPtr
 XMLSEC_EXPORT int               xmlSecBufferSetMaxSize          (xmlSecBufferPtr buf,
                                                                  xmlSecSize size);
 XMLSEC_EXPORT void              xmlSecBufferEmpty               (xmlSecBufferPtr buf);
+XMLSEC_EXPORT void              xmlSecBufferSetZeroMode         (xmlSecBufferPtr buf,
+                                                                 xmlSecBufferZeroMode zeroMode);
+XMLSEC_EXPORT void              xmlSecBufferSetSpillSize        (xmlSecBufferPtr buf,
+                                                                 xmlSecSize spillSize);
+XMLSEC_EXPORT int               xmlSecBufferIsSpilled           (xmlSecBufferPtr buf);
 XMLSEC_EXPORT void              xmlSecBufferSwap                (xmlSecBufferPtr buf1,
                                                                  xmlSecBufferPtr buf2);
+XMLSEC_EXPORT xmlChar*          xmlSecBufferDetachString        (xmlSecBufferPtr buf);
 XMLSEC_EXPORT int               xmlSecBufferAppend              (xmlSecBufferPtr buf,
                                                                  const xmlSecByte* data,
                                                                  xmlSecSize size);
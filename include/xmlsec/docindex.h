@@ -0,0 +1,52 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The shared per-document index of the elements.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_DOCINDEX_H__
+#define __XMLSEC_DOCINDEX_H__
+
+#include <libxml/tree.h>
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * xmlSecDocIndex:
+ *
+ * The document index: the document order ordinals of the elements, the
+ * elements and the attribute owners by name and the in-scope namespace
+ * declarations. The index is built lazily on the first use after it was
+ * created or invalidated and it is shared by all the processing contexts
+ * (including the contexts running in different threads) working with the
+ * document.
+ */
+typedef struct _xmlSecDocIndex                  xmlSecDocIndex, *xmlSecDocIndexPtr;
+
+XMLSEC_EXPORT xmlSecDocIndexPtr xmlSecDocIndexCreate            (xmlDocPtr doc);
+XMLSEC_EXPORT void              xmlSecDocIndexDestroy           (xmlSecDocIndexPtr index);
+XMLSEC_EXPORT xmlSecDocIndexPtr xmlSecDocIndexGet               (xmlDocPtr doc);
+XMLSEC_EXPORT void              xmlSecDocIndexInvalidate        (xmlDocPtr doc);
+XMLSEC_EXPORT int               xmlSecDocIndexUpdate            (xmlSecDocIndexPtr index);
+XMLSEC_EXPORT xmlSecSize        xmlSecDocIndexGetSize           (xmlSecDocIndexPtr index);
+XMLSEC_EXPORT int               xmlSecDocIndexGetOrdinal        (xmlSecDocIndexPtr index,
+                                                                 xmlNodePtr node,
+                                                                 xmlSecSize* ordinal,
+                                                                 xmlSecSize* last);
+XMLSEC_EXPORT xmlNodePtr        xmlSecDocIndexGetElement        (xmlSecDocIndexPtr index,
+                                                                 xmlSecSize ordinal);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_DOCINDEX_H__ */
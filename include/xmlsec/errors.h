@@ -396,6 +396,27 @@ extern "C" {
  */
 #define XMLSEC_ERRORS_R_DSIG_INVALID_REFERENCE          82
 
+/**
+ * XMLSEC_ERRORS_R_DEADLINE_EXCEEDED:
+ *
+ * The operation time budget is exceeded (see #xmlSecTransformCtxSetDeadline).
+ */
+#define XMLSEC_ERRORS_R_DEADLINE_EXCEEDED               83
+
+/**
+ * XMLSEC_ERRORS_R_OPERATION_CANCELLED:
+ *
+ * The operation is cancelled by the application (see #xmlSecTransformCtxSetDeadline).
+ */
+#define XMLSEC_ERRORS_R_OPERATION_CANCELLED             84
+
+/**
+ * XMLSEC_ERRORS_R_COST_LIMIT_EXCEEDED:
+ *
+ * The estimated processing cost is over the limit (see #xmlSecDSigCtx.maxCost).
+ */
+#define XMLSEC_ERRORS_R_COST_LIMIT_EXCEEDED             85
+
 /**
  * XMLSEC_ERRORS_R_ASSERTION:
  *
@@ -461,6 +482,46 @@ XMLSEC_EXPORT void              xmlSecErrorsDefaultCallbackEnableOutput
 XMLSEC_EXPORT int               xmlSecErrorsGetCode             (xmlSecSize pos);
 XMLSEC_EXPORT const char*       xmlSecErrorsGetMsg              (xmlSecSize pos);
 
+/*******************************************************************
+ *
+ * Deferred errors
+ *
+ *******************************************************************/
+/**
+ * XMLSEC_ERRORS_DEFERRED_MAX_SIZE:
+ *
+ * The maximum number of the deferred errors stored for each thread
+ * (the oldest errors are overwritten).
+ */
+#define XMLSEC_ERRORS_DEFERRED_MAX_SIZE                 32
+
+/**
+ * xmlSecErrorRecord:
+ * @file:               the error location file name (__FILE__ macro).
+ * @line:               the error location line number (__LINE__ macro).
+ * @func:               the error location function name (__func__ macro).
+ * @reason:             the error code.
+ *
+ * The deferred error record.
+ */
+typedef struct _xmlSecErrorRecord {
+    const char*         file;
+    int                 line;
+    const char*         func;
+    int                 reason;
+} xmlSecErrorRecord, *xmlSecErrorRecordPtr;
+
+XMLSEC_EXPORT int               xmlSecErrorsDeferredEnable      (int enabled);
+XMLSEC_EXPORT int               xmlSecErrorsDeferredIsEnabled   (void);
+XMLSEC_EXPORT void              xmlSecErrorsDeferredClear       (void);
+XMLSEC_EXPORT xmlSecSize        xmlSecErrorsDeferredGetSize     (void);
+XMLSEC_EXPORT int               xmlSecErrorsDeferredGet         (xmlSecSize pos,
+                                                                 xmlSecErrorRecordPtr record);
+XMLSEC_EXPORT int               xmlSecErrorsDeferredFormat      (xmlSecSize pos,
+                                                                 char* buf,
+                                                                 xmlSecSize bufSize);
+XMLSEC_EXPORT void              xmlSecErrorsDeferredReport      (void);
+
 
 
 #if !defined(__XMLSEC_FUNCTION__)
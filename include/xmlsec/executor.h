@@ -0,0 +1,93 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The tasks executor shared by the parallel processing functions.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_EXECUTOR_H__
+#define __XMLSEC_EXECUTOR_H__
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * xmlSecExecutor:
+ *
+ * The tasks executor: either the xmlsec work-stealing threads pool
+ * (see #xmlSecExecutorCreate) or a wrapper for the application threads
+ * pool (see #xmlSecExecutorCreateCustom).
+ */
+typedef struct _xmlSecExecutor                  xmlSecExecutor, *xmlSecExecutorPtr;
+
+/**
+ * xmlSecTaskGroup:
+ *
+ * The group of tasks submitted to an executor that are waited for together.
+ */
+typedef struct _xmlSecTaskGroup                 xmlSecTaskGroup, *xmlSecTaskGroupPtr;
+
+/**
+ * xmlSecExecutorTask:
+ * @taskCtx:            the task context.
+ *
+ * The task to run on the executor.
+ */
+typedef void            (*xmlSecExecutorTask)                   (void* taskCtx);
+
+/**
+ * xmlSecExecutorSubmitMethod:
+ * @executorCtx:        the application executor context.
+ * @task:               the task to run.
+ * @taskCtx:            the context to pass to @task.
+ *
+ * The application function that runs @task asynchronously (e.g. queues
+ * it to an existing threads pool or an event loop). The @task must be
+ * called exactly once if this function succeeds.
+ *
+ * Returns: 0 on success or a negative value if the task could not be submitted.
+ */
+typedef int             (*xmlSecExecutorSubmitMethod)           (void* executorCtx,
+                                                                 xmlSecExecutorTask task,
+                                                                 void* taskCtx);
+
+/**
+ * xmlSecExecutorWorkerTask:
+ * @taskCtx:            the task context.
+ * @worker:             the worker index (from 0 to workersNum - 1).
+ *
+ * The task run by #xmlSecExecutorRunWorkers for each worker index.
+ */
+typedef void            (*xmlSecExecutorWorkerTask)             (void* taskCtx,
+                                                                 xmlSecSize worker);
+
+XMLSEC_EXPORT xmlSecExecutorPtr xmlSecExecutorCreate            (xmlSecSize threadsNum);
+XMLSEC_EXPORT xmlSecExecutorPtr xmlSecExecutorCreateCustom      (xmlSecExecutorSubmitMethod submit,
+                                                                 void* executorCtx);
+XMLSEC_EXPORT void              xmlSecExecutorDestroy           (xmlSecExecutorPtr executor);
+XMLSEC_EXPORT xmlSecSize        xmlSecExecutorGetThreadsNum     (xmlSecExecutorPtr executor);
+
+XMLSEC_EXPORT xmlSecTaskGroupPtr xmlSecTaskGroupCreate          (xmlSecExecutorPtr executor);
+XMLSEC_EXPORT void              xmlSecTaskGroupDestroy          (xmlSecTaskGroupPtr group);
+XMLSEC_EXPORT int               xmlSecTaskGroupSubmit           (xmlSecTaskGroupPtr group,
+                                                                 xmlSecExecutorTask task,
+                                                                 void* taskCtx);
+XMLSEC_EXPORT int               xmlSecTaskGroupWait             (xmlSecTaskGroupPtr group);
+
+XMLSEC_EXPORT int               xmlSecExecutorRunWorkers        (void* executorCtx,
+                                                                 xmlSecExecutorWorkerTask task,
+                                                                 void* taskCtx,
+                                                                 xmlSecSize workersNum);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_EXECUTOR_H__ */
@@ -56,6 +56,8 @@ XMLSEC_CRYPTO_EXPORT int        xmlSecGCryptAppKeysMngrCertLoadMemory   (xmlSecK
                                                                          xmlSecSize dataSize,
                                                                          xmlSecKeyDataFormat format,
                                                                          xmlSecKeyDataType type);
+XMLSEC_CRYPTO_EXPORT int        xmlSecGCryptAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize);
 #endif /* XMLSEC_NO_X509 */
 
 
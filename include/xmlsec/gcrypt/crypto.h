@@ -32,6 +32,7 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecGCryptInit                (void);
 XMLSEC_CRYPTO_EXPORT int                xmlSecGCryptShutdown            (void);
 
 XMLSEC_CRYPTO_EXPORT int                xmlSecGCryptKeysMngrInit        (xmlSecKeysMngrPtr mngr);
+XMLSEC_CRYPTO_EXPORT int                xmlSecGCryptSetHmacCtxCache     (int enabled);
 XMLSEC_CRYPTO_EXPORT int                xmlSecGCryptGenerateRandom      (xmlSecBufferPtr buffer,
                                                                          xmlSecSize size);
 
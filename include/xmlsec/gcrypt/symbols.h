@@ -138,6 +138,7 @@ extern "C" {
 #define xmlSecCryptoAppKeysMngrCertLoadMemory   xmlSecGCryptAppKeysMngrCertLoadMemory
 #define xmlSecCryptoAppKeysMngrCrlLoad          xmlSecGCryptAppKeysMngrCrlLoad
 #define xmlSecCryptoAppKeysMngrCrlLoadMemory    xmlSecGCryptAppKeysMngrCrlLoadMemory
+#define xmlSecCryptoAppKeysMngrEnableX509VerifyCache xmlSecGCryptAppKeysMngrEnableX509VerifyCache
 #define xmlSecCryptoAppKeyLoad                  xmlSecGCryptAppKeyLoad
 #define xmlSecCryptoAppKeyLoadEx                xmlSecGCryptAppKeyLoadEx
 #define xmlSecCryptoAppPkcs12Load               xmlSecGCryptAppPkcs12Load
@@ -63,6 +63,8 @@ XMLSEC_CRYPTO_EXPORT int        xmlSecGnuTLSAppKeysMngrCrlLoadMemory    (xmlSecK
                                                                          const xmlSecByte* data,
                                                                          xmlSecSize dataSize,
                                                                          xmlSecKeyDataFormat format);
+XMLSEC_CRYPTO_EXPORT int        xmlSecGnuTLSAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize);
 #endif /* XMLSEC_NO_X509 */
 
 
@@ -37,6 +37,7 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSInit                (void);
 XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSShutdown            (void);
 
 XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSKeysMngrInit        (xmlSecKeysMngrPtr mngr);
+XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSSetCipherCtxCache   (int enabled);
 XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSGenerateRandom      (xmlSecBufferPtr buffer,
                                                                          xmlSecSize size);
 
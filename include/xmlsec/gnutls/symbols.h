@@ -118,6 +118,7 @@ extern "C" {
 #define xmlSecCryptoAppKeysMngrCertLoadMemory   xmlSecGnuTLSAppKeysMngrCertLoadMemory
 #define xmlSecCryptoAppKeysMngrCrlLoad          xmlSecGnuTLSAppKeysMngrCrlLoad
 #define xmlSecCryptoAppKeysMngrCrlLoadMemory    xmlSecGnuTLSAppKeysMngrCrlLoadMemory
+#define xmlSecCryptoAppKeysMngrEnableX509VerifyCache xmlSecGnuTLSAppKeysMngrEnableX509VerifyCache
 #define xmlSecCryptoAppKeyLoad                  xmlSecGnuTLSAppKeyLoad
 #define xmlSecCryptoAppKeyLoadEx                xmlSecGnuTLSAppKeyLoadEx
 #define xmlSecCryptoAppPkcs12Load               xmlSecGnuTLSAppPkcs12Load
@@ -56,6 +56,9 @@ XMLSEC_CRYPTO_EXPORT xmlSecSize         xmlSecGnuTLSKeyDataX509GetCrlsSize
 
 XMLSEC_CRYPTO_EXPORT xmlSecKeyDataPtr   xmlSecGnuTLSX509CertGetKey              (gnutls_x509_crt_t cert);
 
+XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSKeyDataX509EnableCertsCache (xmlSecSize maxSize);
+XMLSEC_CRYPTO_EXPORT void               xmlSecGnuTLSKeyDataX509DisableCertsCache(void);
+
 /**************************************************************************
  *
  * X509 raw cert
@@ -106,6 +109,9 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSX509StoreAdoptCert  (xmlSecK
 
 XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSX509StoreAdoptCrl  (xmlSecKeyDataStorePtr store,
                                                                          gnutls_x509_crl_t crl);
+XMLSEC_CRYPTO_EXPORT int                xmlSecGnuTLSX509StoreEnableVerifyCache (xmlSecKeyDataStorePtr store,
+                                                                         xmlSecSize maxSize);
+XMLSEC_CRYPTO_EXPORT void               xmlSecGnuTLSX509StoreDisableVerifyCache (xmlSecKeyDataStorePtr store);
 
 
 #ifdef __cplusplus
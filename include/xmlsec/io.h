@@ -31,6 +31,93 @@ XMLSEC_EXPORT int       xmlSecIORegisterCallbacks               (xmlInputMatchCa
                                                                  xmlInputReadCallback readFunc,
                                                                  xmlInputCloseCallback closeFunc);
 
+/**
+ * xmlSecIOCallbackPtrListId:
+ *
+ * The I/O callbacks list klass (see @ioCallbacks in #xmlSecTransformCtx).
+ */
+#define xmlSecIOCallbackPtrListId       xmlSecIOCallbackPtrListGetKlass()
+XMLSEC_EXPORT xmlSecPtrListId xmlSecIOCallbackPtrListGetKlass   (void);
+XMLSEC_EXPORT int       xmlSecIOCallbackPtrListAdd              (xmlSecPtrListPtr list,
+                                                                 xmlInputMatchCallback matchFunc,
+                                                                 xmlInputOpenCallback openFunc,
+                                                                 xmlInputReadCallback readFunc,
+                                                                 xmlInputCloseCallback closeFunc);
+
+XMLSEC_EXPORT int       xmlSecIOCallbackPtrListAddMemory        (xmlSecPtrListPtr list,
+                                                                 const xmlChar* uri,
+                                                                 const xmlSecByte* data,
+                                                                 xmlSecSize dataSize);
+
+/**
+ * xmlSecIOPackagePartOpenCallback:
+ * @packageCtx:         the package context passed to #xmlSecIOCallbackPtrListAddPackage.
+ * @partName:           the package part name (e.g. "/word/document.xml").
+ *
+ * Opens the package part for reading directly from the package container.
+ *
+ * Returns: the stream context passed to the read and close callbacks
+ * or NULL if an error occurs.
+ */
+typedef void*           (*xmlSecIOPackagePartOpenCallback)      (void* packageCtx,
+                                                                 const xmlChar* partName);
+
+XMLSEC_EXPORT int       xmlSecIOCallbackPtrListAddPackage       (xmlSecPtrListPtr list,
+                                                                 xmlSecIOPackagePartOpenCallback openFunc,
+                                                                 xmlInputReadCallback readFunc,
+                                                                 xmlInputCloseCallback closeFunc,
+                                                                 void* packageCtx);
+
+/**
+ * XMLSEC_IO_WOULD_BLOCK:
+ *
+ * The value returned by the non-blocking read callback when no data
+ * is available yet (see #xmlSecIOCallbackPtrListAddAsync).
+ */
+#define XMLSEC_IO_WOULD_BLOCK                                   (-2)
+
+/**
+ * xmlSecIOWaitFdCallback:
+ * @context:            the stream context returned by the open callback.
+ *
+ * The callback returns the file descriptor the application should wait on
+ * (e.g. with poll or epoll) before resuming the read that returned
+ * #XMLSEC_IO_WOULD_BLOCK.
+ *
+ * Returns: the file descriptor or -1 if it is not available.
+ */
+typedef int             (*xmlSecIOWaitFdCallback)               (void* context);
+
+XMLSEC_EXPORT int       xmlSecIOCallbackPtrListAddAsync         (xmlSecPtrListPtr list,
+                                                                 xmlInputMatchCallback matchFunc,
+                                                                 xmlInputOpenCallback openFunc,
+                                                                 xmlInputReadCallback readFunc,
+                                                                 xmlInputCloseCallback closeFunc,
+                                                                 xmlSecIOWaitFdCallback waitFdFunc);
+
+/**
+ * xmlSecIOPrefetchCallback:
+ * @context:            the context passed to #xmlSecIORegisterPrefetchCallback.
+ * @uris:               the external URIs (without the fragment part).
+ * @urisSize:           the number of URIs in @uris.
+ *
+ * The callback is invoked with all the external URIs of a signature before
+ * any of them is opened, e.g. to start fetching all of them concurrently.
+ * The URIs are then opened as usual thru the registered I/O callbacks
+ * (see #xmlSecIORegisterCallbacks) that can serve the prefetched data.
+ *
+ * Returns: 0 on success or a negative value if an error occurs (the error is ignored).
+ */
+typedef int             (*xmlSecIOPrefetchCallback)             (void* context,
+                                                                 const xmlChar** uris,
+                                                                 xmlSecSize urisSize);
+
+XMLSEC_EXPORT int       xmlSecIORegisterPrefetchCallback        (xmlSecIOPrefetchCallback prefetchFunc,
+                                                                 void* context);
+XMLSEC_EXPORT int       xmlSecIOHasPrefetchCallback             (void);
+XMLSEC_EXPORT int       xmlSecIOPrefetch                        (const xmlChar** uris,
+                                                                 xmlSecSize urisSize);
+
 /********************************************************************
  *
  * Input URI transform
@@ -206,7 +206,11 @@ typedef enum {
  *                      processing level (see @maxEncryptedKeyLevel).
  * @operation:          the transform operation for this key info.
  * @keyReq:             the current key requirements.
- * @reserved0:          reserved for the future.
+ * @enabledKeyDataRef:  the shared list used instead of @enabledKeyData if not NULL
+ *                      (set for the nested contexts that never outlive the
+ *                      context owning the list, see
+ *                      #xmlSecKeyInfoCtxGetEnabledKeyData); it uses the
+ *                      former reserved0 slot.
  * @reserved1:          reserved for the future.
  *
  * The <dsig:KeyInfo /> reading or writing context.
@@ -250,8 +254,10 @@ struct _xmlSecKeyInfoCtx {
     xmlSecTransformOperation            operation;
     xmlSecKeyReq                        keyReq;
 
+    /* the former reserved0 slot (keeps the structure layout) */
+    xmlSecPtrListPtr                    enabledKeyDataRef;
+
     /* for the future */
-    void*                               reserved0;
     void*                               reserved1;
 };
 
@@ -264,6 +270,7 @@ XMLSEC_EXPORT void                      xmlSecKeyInfoCtxReset           (xmlSecK
 XMLSEC_EXPORT int                       xmlSecKeyInfoCtxCopyUserPref    (xmlSecKeyInfoCtxPtr dst,
                                                                          xmlSecKeyInfoCtxPtr src);
 XMLSEC_EXPORT int                       xmlSecKeyInfoCtxCreateEncCtx    (xmlSecKeyInfoCtxPtr keyInfoCtx);
+XMLSEC_EXPORT xmlSecPtrListPtr          xmlSecKeyInfoCtxGetEnabledKeyData(xmlSecKeyInfoCtxPtr keyInfoCtx);
 XMLSEC_EXPORT void                      xmlSecKeyInfoCtxDebugDump       (xmlSecKeyInfoCtxPtr keyInfoCtx,
                                                                          FILE* output);
 XMLSEC_EXPORT void                      xmlSecKeyInfoCtxDebugXmlDump    (xmlSecKeyInfoCtxPtr keyInfoCtx,
@@ -186,8 +186,10 @@ XMLSEC_EXPORT void      xmlSecKeyReqDebugXmlDump                (xmlSecKeyReqPtr
  * @usage:              the key usage.
  * @notValidBefore:     the start key validity interval.
  * @notValidAfter:      the end key validity interval.
+ * @refCount:           the references counter (private, see #xmlSecKeyRef).
  *
- * The key.
+ * The key. The keys returned by the keys stores might be shared, use
+ * #xmlSecKeyMakeWritable before modifying such key.
  */
 struct _xmlSecKey {
     xmlChar*                            name;
@@ -196,12 +198,17 @@ struct _xmlSecKey {
     xmlSecKeyUsage                      usage;
     time_t                              notValidBefore;
     time_t                              notValidAfter;
+    int                                 refCount;
 };
 
 XMLSEC_EXPORT xmlSecKeyPtr      xmlSecKeyCreate         (void);
 XMLSEC_EXPORT void              xmlSecKeyDestroy        (xmlSecKeyPtr key);
 XMLSEC_EXPORT void              xmlSecKeyEmpty          (xmlSecKeyPtr key);
 XMLSEC_EXPORT xmlSecKeyPtr      xmlSecKeyDuplicate      (xmlSecKeyPtr key);
+XMLSEC_EXPORT xmlSecKeyPtr      xmlSecKeyRef            (xmlSecKeyPtr key);
+XMLSEC_EXPORT void              xmlSecKeyUnref          (xmlSecKeyPtr key);
+XMLSEC_EXPORT int               xmlSecKeyIsShared       (xmlSecKeyPtr key);
+XMLSEC_EXPORT xmlSecKeyPtr      xmlSecKeyMakeWritable   (xmlSecKeyPtr key);
 XMLSEC_EXPORT int               xmlSecKeyCopy           (xmlSecKeyPtr keyDst,
                                                          xmlSecKeyPtr keySrc);
 XMLSEC_EXPORT int               xmlSecKeySwap           (xmlSecKeyPtr key1,
@@ -289,6 +296,28 @@ XMLSEC_EXPORT xmlSecKeyPtr      xmlSecKeyReadMemory     (xmlSecKeyDataId dataId,
 #define xmlSecKeyPtrListId      xmlSecKeyPtrListGetKlass()
 XMLSEC_EXPORT xmlSecPtrListId   xmlSecKeyPtrListGetKlass                (void);
 
+/***********************************************************************
+ *
+ * Keys pool
+ *
+ **********************************************************************/
+/**
+ * xmlSecKeyPool:
+ *
+ * The pool of the interchangeable handles of the same key (e.g. the same
+ * HSM key loaded several times, each with its own session), see
+ * #xmlSecKeyPoolCreate.
+ */
+typedef struct _xmlSecKeyPool                   xmlSecKeyPool,
+                                                *xmlSecKeyPoolPtr;
+
+XMLSEC_EXPORT xmlSecKeyPoolPtr  xmlSecKeyPoolCreate                     (void);
+XMLSEC_EXPORT void              xmlSecKeyPoolDestroy                    (xmlSecKeyPoolPtr pool);
+XMLSEC_EXPORT int               xmlSecKeyPoolAdoptKey                   (xmlSecKeyPoolPtr pool,
+                                                                         xmlSecKeyPtr key);
+XMLSEC_EXPORT xmlSecSize        xmlSecKeyPoolGetSize                    (xmlSecKeyPoolPtr pool);
+XMLSEC_EXPORT xmlSecKeyPtr      xmlSecKeyPoolGetKey                     (xmlSecKeyPoolPtr pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -810,6 +810,16 @@ XMLSEC_EXPORT xmlSecPtrListId   xmlSecKeyDataStorePtrListGetKlass       (void);
 XMLSEC_EXPORT void xmlSecImportSetPersistKey                            (void);
 XMLSEC_EXPORT int xmlSecImportGetPersistKey                             (void);
 
+#if !defined(XMLSEC_NO_X509)
+/***********************************************************************
+ *
+ * X509 key data
+ *
+ **********************************************************************/
+XMLSEC_EXPORT void              xmlSecKeyDataX509SetDefaultShallowCopy  (int enabled);
+XMLSEC_EXPORT int               xmlSecKeyDataX509GetDefaultShallowCopy  (void);
+#endif /* !defined(XMLSEC_NO_X509) */
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
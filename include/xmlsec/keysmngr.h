@@ -14,9 +14,11 @@
 #include <xmlsec/exports.h>
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/list.h>
+#include <xmlsec/executor.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/keysdata.h>
 #include <xmlsec/keyinfo.h>
+#include <xmlsec/settings.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +32,9 @@ typedef const struct _xmlSecKeyStoreKlass               xmlSecKeyStoreKlass,
 typedef struct _xmlSecKeyX509DataValue                  xmlSecKeyX509DataValue,
                                                         *xmlSecKeyX509DataValuePtr;
 
+typedef struct _xmlSecKeysMngrPrivate                   xmlSecKeysMngrPrivate,
+                                                        *xmlSecKeysMngrPrivatePtr;
+
 /****************************************************************************
  *
  * Keys Manager
@@ -37,6 +42,12 @@ typedef struct _xmlSecKeyX509DataValue                  xmlSecKeyX509DataValue,
  ***************************************************************************/
 XMLSEC_EXPORT xmlSecKeysMngrPtr         xmlSecKeysMngrCreate            (void);
 XMLSEC_EXPORT void                      xmlSecKeysMngrDestroy           (xmlSecKeysMngrPtr mngr);
+XMLSEC_EXPORT int                       xmlSecKeysMngrSetParent         (xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecKeysMngrPtr parent);
+XMLSEC_EXPORT xmlSecKeysMngrPtr         xmlSecKeysMngrGetParent         (xmlSecKeysMngrPtr mngr);
+XMLSEC_EXPORT void                      xmlSecKeysMngrSetSettings       (xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSettingsPtr settings);
+XMLSEC_EXPORT xmlSecSettingsPtr         xmlSecKeysMngrGetSettings       (xmlSecKeysMngrPtr mngr);
 
 XMLSEC_EXPORT xmlSecKeyPtr              xmlSecKeysMngrFindKey           (xmlSecKeysMngrPtr mngr,
                                                                          const xmlChar* name,
@@ -54,6 +65,41 @@ XMLSEC_EXPORT int                       xmlSecKeysMngrAdoptDataStore    (xmlSecK
                                                                          xmlSecKeyDataStorePtr store);
 XMLSEC_EXPORT xmlSecKeyDataStorePtr     xmlSecKeysMngrGetDataStore      (xmlSecKeysMngrPtr mngr,
                                                                          xmlSecKeyDataStoreId id);
+XMLSEC_EXPORT xmlSecKeyDataStorePtr     xmlSecKeysMngrFindDataStore     (xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecKeyDataStoreId id);
+
+XMLSEC_EXPORT int                       xmlSecKeysMngrEnableUnwrapCache (xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize,
+                                                                         unsigned int ttl);
+XMLSEC_EXPORT void                      xmlSecKeysMngrDisableUnwrapCache(xmlSecKeysMngrPtr mngr);
+
+XMLSEC_EXPORT int                       xmlSecKeysMngrEnableSessionKeyReuse(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize,
+                                                                         xmlSecSize maxUses,
+                                                                         unsigned int ttl);
+XMLSEC_EXPORT void                      xmlSecKeysMngrDisableSessionKeyReuse(xmlSecKeysMngrPtr mngr);
+
+XMLSEC_EXPORT int                       xmlSecKeysMngrEnableKeyInfoCache(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize,
+                                                                         unsigned int ttl);
+XMLSEC_EXPORT void                      xmlSecKeysMngrDisableKeyInfoCache(xmlSecKeysMngrPtr mngr);
+
+XMLSEC_EXPORT int                       xmlSecKeysMngrEnableRetrievalCache(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize,
+                                                                         unsigned int ttl);
+XMLSEC_EXPORT void                      xmlSecKeysMngrDisableRetrievalCache(xmlSecKeysMngrPtr mngr);
+
+XMLSEC_EXPORT int                       xmlSecKeysMngrEnableNotFoundCache(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize,
+                                                                         unsigned int ttl);
+XMLSEC_EXPORT void                      xmlSecKeysMngrDisableNotFoundCache(xmlSecKeysMngrPtr mngr);
+
+XMLSEC_EXPORT int                       xmlSecKeysMngrEnableEphemeralKeys(xmlSecKeysMngrPtr mngr);
+XMLSEC_EXPORT void                      xmlSecKeysMngrDisableEphemeralKeys(xmlSecKeysMngrPtr mngr);
+XMLSEC_EXPORT int                       xmlSecKeysMngrAdoptEphemeralKey (xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecKeyPtr key);
+XMLSEC_EXPORT xmlSecSize                xmlSecKeysMngrGetEphemeralKeysSize(xmlSecKeysMngrPtr mngr,
+                                                                         const xmlChar* name);
 
 /**
  * xmlSecGetKeyCallback:
@@ -73,6 +119,9 @@ typedef xmlSecKeyPtr    (*xmlSecGetKeyCallback)         (xmlNodePtr keyInfoNode,
  * @keysStore:                  the key store (list of keys known to keys manager).
  * @storesList:                 the list of key data stores known to keys manager.
  * @getKey:                     the callback used to read &lt;dsig:KeyInfo/&gt; node.
+ * @priv:                       the private data (the optional caches, the tuning
+ *                              settings and the parent keys manager); applications
+ *                              must not access it directly.
  *
  * The keys manager structure.
  */
@@ -80,6 +129,7 @@ struct _xmlSecKeysMngr {
     xmlSecKeyStorePtr           keysStore;
     xmlSecPtrList               storesList;
     xmlSecGetKeyCallback        getKey;
+    xmlSecKeysMngrPrivatePtr    priv;
 };
 
 
@@ -300,8 +350,121 @@ XMLSEC_EXPORT int                       xmlSecSimpleKeysStoreLoad_ex    (xmlSecK
 XMLSEC_EXPORT int                       xmlSecSimpleKeysStoreSave       (xmlSecKeyStorePtr store,
                                                                          const char *filename,
                                                                          xmlSecKeyDataType type);
+XMLSEC_EXPORT int                       xmlSecSimpleKeysStoreSaveBinary (xmlSecKeyStorePtr store,
+                                                                         const char *filename,
+                                                                         xmlSecKeyDataType type);
 XMLSEC_EXPORT xmlSecPtrListPtr          xmlSecSimpleKeysStoreGetKeys    (xmlSecKeyStorePtr store);
 
+/****************************************************************************
+ *
+ * Snapshot Keys Store
+ *
+ ***************************************************************************/
+/**
+ * xmlSecSnapshotKeysStoreId:
+ *
+ * A keys store klass id for the keys store that can be updated while
+ * it is used from other threads.
+ */
+#define xmlSecSnapshotKeysStoreId       xmlSecSnapshotKeysStoreGetKlass()
+XMLSEC_EXPORT xmlSecKeyStoreId          xmlSecSnapshotKeysStoreGetKlass (void);
+XMLSEC_EXPORT int                       xmlSecSnapshotKeysStoreAdoptKey (xmlSecKeyStorePtr store,
+                                                                         xmlSecKeyPtr key);
+XMLSEC_EXPORT int                       xmlSecSnapshotKeysStoreAdoptKeysStore(xmlSecKeyStorePtr store,
+                                                                         xmlSecKeyStorePtr keys);
+XMLSEC_EXPORT int                       xmlSecSnapshotKeysStoreSetNumaReplicas(xmlSecKeyStorePtr store,
+                                                                         int enabled);
+XMLSEC_EXPORT int                       xmlSecSnapshotKeysStoreLoad     (xmlSecKeyStorePtr store,
+                                                                         const char *uri,
+                                                                         xmlSecKeysMngrPtr keysMngr);
+
+/****************************************************************************
+ *
+ * Binary Keys Store
+ *
+ ***************************************************************************/
+/**
+ * xmlSecBinaryKeysStoreId:
+ *
+ * A keys store klass id for the read-only keys store loaded from a binary
+ * keys file (see #xmlSecSimpleKeysStoreSaveBinary).
+ */
+#define xmlSecBinaryKeysStoreId         xmlSecBinaryKeysStoreGetKlass()
+XMLSEC_EXPORT xmlSecKeyStoreId          xmlSecBinaryKeysStoreGetKlass   (void);
+XMLSEC_EXPORT int                       xmlSecBinaryKeysStoreLoad       (xmlSecKeyStorePtr store,
+                                                                         const char *filename);
+XMLSEC_EXPORT xmlSecSize                xmlSecBinaryKeysStoreGetSize    (xmlSecKeyStorePtr store);
+
+/****************************************************************************
+ *
+ * Remote Keys Store
+ *
+ ***************************************************************************/
+/**
+ * xmlSecRemoteKeysStoreId:
+ *
+ * A keys store klass id for the keys store that fetches the keys by name
+ * from a remote source (e.g. a KMS or an HSM service) and keeps the recently
+ * used keys in a local LRU cache.
+ */
+#define xmlSecRemoteKeysStoreId         xmlSecRemoteKeysStoreGetKlass()
+
+/**
+ * xmlSecRemoteKeysStoreFetchCallback:
+ * @name:               the key name.
+ * @fetchCtx:           the application context.
+ *
+ * The application function that fetches the key @name from the remote
+ * source. The function might be called concurrently from different
+ * threads (but never for the same @name) and it must not use the
+ * remote keys store itself.
+ *
+ * Returns: the newly created key (the caller takes the ownership) or NULL
+ * if the key is not found or an error occurs.
+ */
+typedef xmlSecKeyPtr    (*xmlSecRemoteKeysStoreFetchCallback)   (const xmlChar* name,
+                                                                 void* fetchCtx);
+
+XMLSEC_EXPORT xmlSecKeyStoreId          xmlSecRemoteKeysStoreGetKlass   (void);
+XMLSEC_EXPORT int                       xmlSecRemoteKeysStoreSetFetchCallback(xmlSecKeyStorePtr store,
+                                                                         xmlSecRemoteKeysStoreFetchCallback fetch,
+                                                                         void* fetchCtx);
+XMLSEC_EXPORT int                       xmlSecRemoteKeysStoreSetExecutor(xmlSecKeyStorePtr store,
+                                                                         xmlSecExecutorPtr executor);
+XMLSEC_EXPORT int                       xmlSecRemoteKeysStoreSetCacheSize(xmlSecKeyStorePtr store,
+                                                                         xmlSecSize maxSize,
+                                                                         unsigned int ttl);
+XMLSEC_EXPORT int                       xmlSecRemoteKeysStorePrefetch   (xmlSecKeyStorePtr store,
+                                                                         const xmlChar* name);
+XMLSEC_EXPORT void                      xmlSecRemoteKeysStoreRemove     (xmlSecKeyStorePtr store,
+                                                                         const xmlChar* name);
+XMLSEC_EXPORT xmlSecSize                xmlSecRemoteKeysStoreGetSize    (xmlSecKeyStorePtr store);
+
+/****************************************************************************
+ *
+ * Symmetric Keys Store
+ *
+ ***************************************************************************/
+/**
+ * xmlSecSymmetricKeysStoreId:
+ *
+ * A keys store klass id for the compact store of the named symmetric keys
+ * (HMAC, AES, DES, ...) for the applications with millions of such keys.
+ */
+#define xmlSecSymmetricKeysStoreId      xmlSecSymmetricKeysStoreGetKlass()
+XMLSEC_EXPORT xmlSecKeyStoreId          xmlSecSymmetricKeysStoreGetKlass(void);
+XMLSEC_EXPORT int                       xmlSecSymmetricKeysStoreReserve (xmlSecKeyStorePtr store,
+                                                                         xmlSecSize keysNum,
+                                                                         xmlSecSize dataSize);
+XMLSEC_EXPORT int                       xmlSecSymmetricKeysStoreAddKey  (xmlSecKeyStorePtr store,
+                                                                         const xmlChar* name,
+                                                                         xmlSecKeyDataId dataId,
+                                                                         const xmlSecByte* data,
+                                                                         xmlSecSize dataSize);
+XMLSEC_EXPORT int                       xmlSecSymmetricKeysStoreAdoptKey(xmlSecKeyStorePtr store,
+                                                                         xmlSecKeyPtr key);
+XMLSEC_EXPORT xmlSecSize                xmlSecSymmetricKeysStoreGetSize (xmlSecKeyStorePtr store);
+
 
 #ifdef __cplusplus
 }
@@ -24,6 +24,14 @@ typedef const struct _xmlSecPtrListKlass                        xmlSecPtrListKla
 typedef struct _xmlSecPtrList                                   xmlSecPtrList,
                                                                 *xmlSecPtrListPtr;
 
+/**
+ * XMLSEC_PTR_LIST_INLINE_SIZE:
+ *
+ * The number of items stored inside the #xmlSecPtrList structure itself
+ * (most of the lists are small and do not need the heap memory).
+ */
+#define XMLSEC_PTR_LIST_INLINE_SIZE                             4
+
 /**
  * xmlSecPtrList:
  * @id:                         the list items description.
@@ -31,8 +39,13 @@ typedef struct _xmlSecPtrList                                   xmlSecPtrList,
  * @use:                        the current list size.
  * @max:                        the max (allocated) list size.
  * @allocMode:                  the memory allocation mode.
+ * @inlineData:                 the inline storage for small lists (@data points
+ *                              to it if the list has no more than
+ *                              #XMLSEC_PTR_LIST_INLINE_SIZE items).
+ * @sharedRefCount:             the references counter if @data is shared with
+ *                              other lists (read-only, copied on write) or NULL.
  *
- * The pointers list.
+ * The pointers list. The list structure must not be copied by value.
  */
 struct _xmlSecPtrList {
     xmlSecPtrListId             id;
@@ -41,6 +54,9 @@ struct _xmlSecPtrList {
     xmlSecSize                  use;
     xmlSecSize                  max;
     xmlSecAllocMode             allocMode;
+
+    xmlSecPtr                   inlineData[XMLSEC_PTR_LIST_INLINE_SIZE];
+    int*                        sharedRefCount;
 };
 
 XMLSEC_EXPORT void              xmlSecPtrListSetDefaultAllocMode(xmlSecAllocMode defAllocMode,
@@ -53,6 +69,7 @@ XMLSEC_EXPORT void              xmlSecPtrListFinalize           (xmlSecPtrListPt
 XMLSEC_EXPORT xmlSecPtrListPtr  xmlSecPtrListCreate             (xmlSecPtrListId id);
 XMLSEC_EXPORT void              xmlSecPtrListDestroy            (xmlSecPtrListPtr list);
 XMLSEC_EXPORT void              xmlSecPtrListEmpty              (xmlSecPtrListPtr list);
+XMLSEC_EXPORT void              xmlSecPtrListClear              (xmlSecPtrListPtr list);
 
 XMLSEC_EXPORT int               xmlSecPtrListCopy               (xmlSecPtrListPtr dst,
                                                                  xmlSecPtrListPtr src);
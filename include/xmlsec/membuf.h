@@ -36,6 +36,29 @@ extern "C" {
         xmlSecTransformMemBufGetKlass()
 XMLSEC_EXPORT xmlSecTransformId xmlSecTransformMemBufGetKlass           (void);
 XMLSEC_EXPORT xmlSecBufferPtr   xmlSecTransformMemBufGetBuffer          (xmlSecTransformPtr transform);
+XMLSEC_EXPORT void              xmlSecTransformMemBufSetDefaultSpillSize(xmlSecSize spillSize);
+XMLSEC_EXPORT xmlSecSize        xmlSecTransformMemBufGetDefaultSpillSize(void);
+
+/**
+ * xmlSecTransformMemBufSink:
+ * @sinkCtx:            the context passed to #xmlSecTransformMemBufSetSink.
+ * @data:               the next chunk of the data.
+ * @size:               the chunk size (might be 0 for the last call).
+ * @last:               the flag: if set then this is the last chunk.
+ *
+ * Receives the data going through the memory buffer transform.
+ *
+ * Returns: 0 on success or a negative value if an error occurs
+ * (the transform fails).
+ */
+typedef int             (*xmlSecTransformMemBufSink)            (void* sinkCtx,
+                                                                 const xmlSecByte* data,
+                                                                 xmlSecSize size,
+                                                                 int last);
+
+XMLSEC_EXPORT int               xmlSecTransformMemBufSetSink            (xmlSecTransformPtr transform,
+                                                                         xmlSecTransformMemBufSink sink,
+                                                                         void* sinkCtx);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,101 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Memory usage accounting.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_MEMSTATS_H__
+#define __XMLSEC_MEMSTATS_H__
+
+#include <stdio.h>
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * xmlSecMemStatsTag:
+ * @xmlSecMemStatsTagBuffer:    the #xmlSecBuffer objects and data.
+ * @xmlSecMemStatsTagList:      the #xmlSecPtrList objects and items arrays.
+ * @xmlSecMemStatsTagTransform: the transform objects.
+ * @xmlSecMemStatsTagKeys:      the key and key data objects.
+ * @xmlSecMemStatsTagNodeSet:   the #xmlSecNodeSet objects and indexes.
+ *
+ * The xmlsec subsystem that made the allocation.
+ */
+typedef enum {
+    xmlSecMemStatsTagBuffer = 0,
+    xmlSecMemStatsTagList,
+    xmlSecMemStatsTagTransform,
+    xmlSecMemStatsTagKeys,
+    xmlSecMemStatsTagNodeSet
+} xmlSecMemStatsTag;
+
+/**
+ * XMLSEC_MEMSTATS_TAGS_SIZE:
+ *
+ * The number of #xmlSecMemStatsTag values.
+ */
+#define XMLSEC_MEMSTATS_TAGS_SIZE                       5
+
+/**
+ * xmlSecMemStatsCounters:
+ * @current:            the currently allocated bytes.
+ * @peak:               the maximum of @current.
+ * @count:              the number of allocations (including reallocations).
+ *
+ * The memory usage counters.
+ */
+typedef struct _xmlSecMemStatsCounters {
+    xmlSecSize          current;
+    xmlSecSize          peak;
+    xmlSecSize          count;
+} xmlSecMemStatsCounters;
+
+/**
+ * xmlSecMemStats:
+ * @limit:              the maximum of the currently allocated bytes or 0
+ *                      for no limit (set by the application).
+ * @limitExceeded:      set to 1 if an allocation failed because of @limit.
+ * @total:              the counters for all the allocations.
+ * @tags:               the counters for each #xmlSecMemStatsTag.
+ *
+ * The memory usage of one operation. Only the memory allocated by xmlsec
+ * for the buffers, lists, transforms, keys and node sets on the thread
+ * the stats object is attached to (see #xmlSecMemStatsAttach) is counted;
+ * the memory allocated by LibXML2 (e.g. for the parsed nodes) or by the
+ * crypto library is not. The memory freed while the stats object is
+ * attached but allocated before is not subtracted below zero.
+ */
+typedef struct _xmlSecMemStats {
+    xmlSecSize                  limit;
+    int                         limitExceeded;
+    xmlSecMemStatsCounters      total;
+    xmlSecMemStatsCounters      tags[XMLSEC_MEMSTATS_TAGS_SIZE];
+} xmlSecMemStats, *xmlSecMemStatsPtr;
+
+XMLSEC_EXPORT void              xmlSecMemStatsReset             (xmlSecMemStatsPtr stats);
+XMLSEC_EXPORT xmlSecMemStatsPtr xmlSecMemStatsAttach            (xmlSecMemStatsPtr stats);
+XMLSEC_EXPORT void              xmlSecMemStatsDetach            (xmlSecMemStatsPtr prev);
+XMLSEC_EXPORT xmlSecMemStatsPtr xmlSecMemStatsGetCurrent        (void);
+XMLSEC_EXPORT int               xmlSecMemStatsUpdate            (xmlSecMemStatsTag tag,
+                                                                 xmlSecSize oldSize,
+                                                                 xmlSecSize newSize);
+XMLSEC_EXPORT const char*       xmlSecMemStatsTagGetName        (xmlSecMemStatsTag tag);
+XMLSEC_EXPORT void              xmlSecMemStatsDebugDump         (xmlSecMemStatsPtr stats,
+                                                                 FILE* output);
+XMLSEC_EXPORT void              xmlSecMemStatsDebugXmlDump      (xmlSecMemStatsPtr stats,
+                                                                 FILE* output);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_MEMSTATS_H__ */
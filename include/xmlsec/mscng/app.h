@@ -64,6 +64,8 @@ XMLSEC_CRYPTO_EXPORT int        xmlSecMSCngAppKeysMngrCrlLoadMemory (xmlSecKeysM
                                                                       const xmlSecByte *data,
                                                                       xmlSecSize dataSize,
                                                                       xmlSecKeyDataFormat format);
+XMLSEC_CRYPTO_EXPORT int        xmlSecMSCngAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr,
+                                                                      xmlSecSize maxSize);
 #endif /* XMLSEC_NO_X509 */
 
 
@@ -130,6 +130,7 @@ extern "C" {
 #define xmlSecCryptoAppKeysMngrCertLoadMemory   xmlSecMSCngAppKeysMngrCertLoadMemory
 #define xmlSecCryptoAppKeysMngrCrlLoad          xmlSecMSCngAppKeysMngrCrlLoad
 #define xmlSecCryptoAppKeysMngrCrlLoadMemory    xmlSecMSCngAppKeysMngrCrlLoadMemory
+#define xmlSecCryptoAppKeysMngrEnableX509VerifyCache xmlSecMSCngAppKeysMngrEnableX509VerifyCache
 #define xmlSecCryptoAppKeyLoad                  xmlSecMSCngAppKeyLoad
 #define xmlSecCryptoAppKeyLoadEx                xmlSecMSCngAppKeyLoadEx
 #define xmlSecCryptoAppPkcs12Load               xmlSecMSCngAppPkcs12Load
@@ -64,6 +64,9 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecMSCngX509StoreAdoptTrustedStore(xm
                                                                               HCERTSTORE trustedStore);
 XMLSEC_CRYPTO_EXPORT int                xmlSecMSCngX509StoreAdoptUntrustedStore(xmlSecKeyDataStorePtr store,
                                                                                 HCERTSTORE untrustedStore);
+XMLSEC_CRYPTO_EXPORT int                xmlSecMSCngX509StoreEnableVerifyCache(xmlSecKeyDataStorePtr store,
+                                                                              xmlSecSize maxSize);
+XMLSEC_CRYPTO_EXPORT void               xmlSecMSCngX509StoreDisableVerifyCache(xmlSecKeyDataStorePtr store);
 XMLSEC_CRYPTO_EXPORT PCCERT_CONTEXT     xmlSecMSCngX509StoreVerify           (xmlSecKeyDataStorePtr store,
                                                                               HCERTSTORE certs,
                                                                               xmlSecKeyInfoCtx* keyInfoCtx);
@@ -80,6 +80,8 @@ XMLSEC_CRYPTO_EXPORT int        xmlSecMSCryptoAppKeysMngrCrlLoadMemory
                                                                                  const xmlSecByte* data,
                                                                                  xmlSecSize dataSize,
                                                                                  xmlSecKeyDataFormat format);
+XMLSEC_CRYPTO_EXPORT int        xmlSecMSCryptoAppKeysMngrEnableX509VerifyCache  (xmlSecKeysMngrPtr mngr,
+                                                                                 xmlSecSize maxSize);
 #endif /* XMLSEC_NO_X509 */
 
 
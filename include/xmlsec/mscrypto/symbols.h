@@ -101,6 +101,7 @@ extern "C" {
 #define xmlSecCryptoAppKeysMngrCertLoadMemory   xmlSecMSCryptoAppKeysMngrCertLoadMemory
 #define xmlSecCryptoAppKeysMngrCrlLoad          xmlSecMSCryptoAppKeysMngrCrlLoad
 #define xmlSecCryptoAppKeysMngrCrlLoadMemory    xmlSecMSCryptoAppKeysMngrCrlLoadMemory
+#define xmlSecCryptoAppKeysMngrEnableX509VerifyCache xmlSecMSCryptoAppKeysMngrEnableX509VerifyCache
 #define xmlSecCryptoAppKeyLoad                  xmlSecMSCryptoAppKeyLoad
 #define xmlSecCryptoAppKeyLoadEx                xmlSecMSCryptoAppKeyLoadEx
 #define xmlSecCryptoAppPkcs12Load               xmlSecMSCryptoAppPkcs12Load
@@ -75,6 +75,12 @@ typedef enum {
  * @prev:                       the previous nodes set.
  * @children:                   the children list (valid only if type
  *                              equal to #xmlSecNodeSetList).
+ * @index:                      the lookup index for @nodes (private, built
+ *                              on the first #xmlSecNodeSetContains call).
+ * @visibility:                 the precomputed visibility of all document nodes
+ *                              for the combined nodes sets (private, built on the
+ *                              first #xmlSecNodeSetContains call). The document
+ *                              should not be modified while the nodes set is in use.
  *
  * The enchanced nodes set.
  */
@@ -87,6 +93,8 @@ struct _xmlSecNodeSet {
     xmlSecNodeSetPtr    next;
     xmlSecNodeSetPtr    prev;
     xmlSecNodeSetPtr    children;
+    struct _xmlSecNodeSetIndex* index;
+    struct _xmlSecNodeSetVisibility* visibility;
 };
 
 /**
@@ -69,6 +69,8 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecNssAppKeysMngrCrlLoadMemory(xmlSec
                                                                          const xmlSecByte *data,
                                                                          xmlSecSize dataSize,
                                                                          xmlSecKeyDataFormat format);
+XMLSEC_CRYPTO_EXPORT int                xmlSecNssAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize);
 #endif /* XMLSEC_NO_X509 */
 
 
@@ -47,6 +47,7 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecNssInit                   (void);
 XMLSEC_CRYPTO_EXPORT int                xmlSecNssShutdown               (void);
 
 XMLSEC_CRYPTO_EXPORT int                xmlSecNssKeysMngrInit           (xmlSecKeysMngrPtr mngr);
+XMLSEC_CRYPTO_EXPORT int                xmlSecNssSetHmacCtxCache        (int enabled);
 XMLSEC_CRYPTO_EXPORT int                xmlSecNssGenerateRandom         (xmlSecBufferPtr buffer,
                                                                          xmlSecSize size);
 
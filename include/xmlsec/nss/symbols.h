@@ -128,6 +128,7 @@ extern "C" {
 #define xmlSecCryptoAppKeysMngrCertLoadMemory   xmlSecNssAppKeysMngrCertLoadMemory
 #define xmlSecCryptoAppKeysMngrCrlLoad          xmlSecNssAppKeysMngrCrlLoad
 #define xmlSecCryptoAppKeysMngrCrlLoadMemory    xmlSecNssAppKeysMngrCrlLoadMemory
+#define xmlSecCryptoAppKeysMngrEnableX509VerifyCache xmlSecNssAppKeysMngrEnableX509VerifyCache
 #define xmlSecCryptoAppKeyLoad                  xmlSecNssAppKeyLoad
 #define xmlSecCryptoAppKeyLoadEx                xmlSecNssAppKeyLoadEx
 #define xmlSecCryptoAppPkcs12Load               xmlSecNssAppPkcs12Load
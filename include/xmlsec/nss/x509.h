@@ -90,6 +90,11 @@ XMLSEC_CRYPTO_EXPORT int                        xmlSecNssX509StoreAdoptCert (xml
                                                                              xmlSecKeyDataType type);
 XMLSEC_CRYPTO_EXPORT int                        xmlSecNssX509StoreAdoptCrl  (xmlSecKeyDataStorePtr store,
                                                                              CERTSignedCrl* crl);
+XMLSEC_CRYPTO_EXPORT int                        xmlSecNssX509StoreSetUseTrustAnchors(xmlSecKeyDataStorePtr store,
+                                                                             int enabled);
+XMLSEC_CRYPTO_EXPORT int                        xmlSecNssX509StoreEnableVerifyCache(xmlSecKeyDataStorePtr store,
+                                                                             xmlSecSize maxSize);
+XMLSEC_CRYPTO_EXPORT void                       xmlSecNssX509StoreDisableVerifyCache(xmlSecKeyDataStorePtr store);
 
 
 #ifdef __cplusplus
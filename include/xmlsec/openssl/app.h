@@ -29,6 +29,8 @@ extern "C" {
  ********************************************************************/
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppInit            (const char* config);
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppShutdown        (void);
+XMLSEC_CRYPTO_EXPORT void               xmlSecOpenSSLAppSetDeferredInit (int enabled);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppGetDeferredInit (void);
 
 
 /********************************************************************
@@ -36,6 +38,34 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppShutdown        (void);
  * Keys Manager
  *
  *******************************************************************/
+/**
+ * xmlSecOpenSSLAppTaskCallback:
+ * @tasksCtx:           the tasks context.
+ * @pos:                the task position.
+ *
+ * Runs the task at @pos. Different tasks from the same batch do not
+ * share any state and might be executed concurrently.
+ */
+typedef void            (*xmlSecOpenSSLAppTaskCallback)                 (void* tasksCtx,
+                                                                         xmlSecSize pos);
+/**
+ * xmlSecOpenSSLAppRunTasksCallback:
+ * @taskCallback:       the task function.
+ * @tasksCtx:           the tasks context to pass to @taskCallback.
+ * @tasksSize:          the number of tasks.
+ * @runCtx:             the application context.
+ *
+ * Executes @taskCallback for every position from 0 to @tasksSize - 1
+ * (for example, on the application's threads pool) and returns after
+ * all the tasks are finished.
+ *
+ * Returns: 0 on success or a negative value if some tasks were not executed.
+ */
+typedef int             (*xmlSecOpenSSLAppRunTasksCallback)             (xmlSecOpenSSLAppTaskCallback taskCallback,
+                                                                         void* tasksCtx,
+                                                                         xmlSecSize tasksSize,
+                                                                         void* runCtx);
+
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppDefaultKeysMngrInit(xmlSecKeysMngrPtr mngr);
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr,
                                                                          xmlSecKeyPtr key);
@@ -47,6 +77,16 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppDefaultKeysMngrLoad(xmlS
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppDefaultKeysMngrSave(xmlSecKeysMngrPtr mngr,
                                                                          const char* filename,
                                                                          xmlSecKeyDataType type);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppDefaultKeysMngrKeysLoad(xmlSecKeysMngrPtr mngr,
+                                                                         const char** filenames,
+                                                                         xmlSecSize filenamesSize,
+                                                                         xmlSecKeyDataType type,
+                                                                         xmlSecKeyDataFormat format,
+                                                                         const char *pwd,
+                                                                         void* pwdCallback,
+                                                                         void* pwdCallbackCtx,
+                                                                         xmlSecOpenSSLAppRunTasksCallback runTasks,
+                                                                         void* runTasksCtx);
 #ifndef XMLSEC_NO_X509
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppKeysMngrCertLoad(xmlSecKeysMngrPtr mngr,
                                                                          const char *filename,
@@ -61,6 +101,13 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppKeysMngrCertLoadBIO(xmlS
                                                                          BIO* bio,
                                                                          xmlSecKeyDataFormat format,
                                                                          xmlSecKeyDataType type);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppKeysMngrCertsLoad(xmlSecKeysMngrPtr mngr,
+                                                                         const char** filenames,
+                                                                         xmlSecSize filenamesSize,
+                                                                         xmlSecKeyDataFormat format,
+                                                                         xmlSecKeyDataType type,
+                                                                         xmlSecOpenSSLAppRunTasksCallback runTasks,
+                                                                         void* runTasksCtx);
 
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppKeysMngrCrlLoad(xmlSecKeysMngrPtr mngr,
                                                                          const char *filename,
@@ -69,6 +116,8 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppKeysMngrCrlLoadMemory(xm
                                                                          const xmlSecByte* data,
                                                                          xmlSecSize dataSize,
                                                                          xmlSecKeyDataFormat format);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize);
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLAppKeysMngrCrlLoadBIO(xmlSecKeysMngrPtr mngr,
                                                                          BIO* bio,
                                                                          xmlSecKeyDataFormat format);
@@ -97,6 +146,13 @@ XMLSEC_CRYPTO_EXPORT xmlSecKeyPtr       xmlSecOpenSSLAppKeyLoadEx       (const c
                                                                          const char *pwd,
                                                                          void* pwdCallback,
                                                                          void* pwdCallbackCtx);
+XMLSEC_CRYPTO_EXPORT xmlSecKeyPoolPtr   xmlSecOpenSSLAppKeyPoolLoad     (const char *filename,
+                                                                         xmlSecKeyDataType type,
+                                                                         xmlSecKeyDataFormat format,
+                                                                         const char *pwd,
+                                                                         void* pwdCallback,
+                                                                         void* pwdCallbackCtx,
+                                                                         xmlSecSize size);
 XMLSEC_CRYPTO_EXPORT xmlSecKeyPtr       xmlSecOpenSSLAppKeyLoadMemory   (const xmlSecByte* data,
                                                                          xmlSecSize dataSize,
                                                                          xmlSecKeyDataFormat format,
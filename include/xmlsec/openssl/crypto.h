@@ -75,6 +75,7 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLShutdown           (void);
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLKeysMngrInit       (xmlSecKeysMngrPtr mngr);
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLGenerateRandom     (xmlSecBufferPtr buffer,
                                                                          xmlSecSize size);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLSetRandomPool      (int enabled);
 
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLSetDefaultTrustedCertsFolder(const xmlChar* path);
 XMLSEC_CRYPTO_EXPORT const xmlChar*     xmlSecOpenSSLGetDefaultTrustedCertsFolder(void);
@@ -82,6 +83,13 @@ XMLSEC_CRYPTO_EXPORT const xmlChar*     xmlSecOpenSSLGetDefaultTrustedCertsFolde
 #ifdef XMLSEC_OPENSSL_API_300
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLSetLibCtx(OSSL_LIB_CTX* libctx);
 XMLSEC_CRYPTO_EXPORT OSSL_LIB_CTX*      xmlSecOpenSSLGetLibCtx(void);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLSetPerThreadLibCtx(int enabled);
+XMLSEC_CRYPTO_EXPORT OSSL_LIB_CTX*      xmlSecOpenSSLGetThreadLibCtx(void);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLSetPropQuery(const char* algorithm,
+                                                                 const char* propQuery);
+XMLSEC_CRYPTO_EXPORT const char*        xmlSecOpenSSLGetPropQuery(const char* algorithm);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLSetHmacCtxCache(int enabled);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLSetPublicKeysCache(int enabled);
 #endif /* XMLSEC_OPENSSL_API_300 */
 
 /********************************************************************
@@ -258,6 +266,11 @@ XMLSEC_CRYPTO_EXPORT xmlSecTransformId  xmlSecOpenSSLTransformKWAes192GetKlass(v
         xmlSecOpenSSLTransformKWAes256GetKlass()
 XMLSEC_CRYPTO_EXPORT xmlSecTransformId  xmlSecOpenSSLTransformKWAes256GetKlass(void);
 
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLTransformKWAesExecuteBatch(xmlSecTransformPtr transform,
+                                                                             xmlSecBufferPtr* in,
+                                                                             xmlSecBufferPtr* out,
+                                                                             xmlSecSize size);
+
 #endif /* XMLSEC_NO_AES */
 
 /********************************************************************
@@ -63,6 +63,11 @@ XMLSEC_CRYPTO_EXPORT xmlSecSize         xmlSecOpenSSLKeyDataX509GetCrlsSize(xmlS
 
 XMLSEC_CRYPTO_EXPORT xmlSecKeyDataPtr   xmlSecOpenSSLX509CertGetKey     (X509* cert);
 
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLKeyDataX509EnableCertsCache(xmlSecSize maxSize);
+XMLSEC_CRYPTO_EXPORT void               xmlSecOpenSSLKeyDataX509DisableCertsCache(void);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLX509EnableNamesCache(xmlSecSize maxSize);
+XMLSEC_CRYPTO_EXPORT void               xmlSecOpenSSLX509DisableNamesCache(void);
+
 
 /**
  * xmlSecOpenSSLKeyDataRawX509CertId:
@@ -110,6 +115,18 @@ XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLX509StoreAddCertsPath(xmlSe
                                                                          const char* path);
 XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLX509StoreAddCertsFile(xmlSecKeyDataStorePtr store,
                                                                          const char* filename);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLX509StoreEnableVerifyCache(xmlSecKeyDataStorePtr store,
+                                                                         xmlSecSize maxSize);
+XMLSEC_CRYPTO_EXPORT void               xmlSecOpenSSLX509StoreDisableVerifyCache(xmlSecKeyDataStorePtr store);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLX509StoreEnableIntern(xmlSecKeyDataStorePtr store);
+XMLSEC_CRYPTO_EXPORT void               xmlSecOpenSSLX509StoreDisableIntern(xmlSecKeyDataStorePtr store);
+XMLSEC_CRYPTO_EXPORT xmlSecSize         xmlSecOpenSSLX509StoreGetInternSize(xmlSecKeyDataStorePtr store);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLX509StoreEnableOcsp(xmlSecKeyDataStorePtr store,
+                                                                         int required);
+XMLSEC_CRYPTO_EXPORT void               xmlSecOpenSSLX509StoreDisableOcsp(xmlSecKeyDataStorePtr store);
+XMLSEC_CRYPTO_EXPORT int                xmlSecOpenSSLX509StoreAddOcspResponse(xmlSecKeyDataStorePtr store,
+                                                                         const xmlSecByte* data,
+                                                                         xmlSecSize dataSize);
 
 #ifdef __cplusplus
 }
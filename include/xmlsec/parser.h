@@ -21,6 +21,20 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/**
+ * xmlSecParserInputSegment:
+ * @data:               the segment data.
+ * @size:               the segment data size.
+ *
+ * One segment of the input for #xmlSecParseMemoryVec.
+ */
+typedef struct _xmlSecParserInputSegment                xmlSecParserInputSegment,
+                                                        *xmlSecParserInputSegmentPtr;
+struct _xmlSecParserInputSegment {
+    const xmlSecByte*           data;
+    xmlSecSize                  size;
+};
+
 XMLSEC_EXPORT xmlDocPtr         xmlSecParseFile         (const char *filename);
 XMLSEC_EXPORT xmlDocPtr         xmlSecParseMemory       (const xmlSecByte *buffer,
                                                          xmlSecSize size,
@@ -31,11 +45,29 @@ XMLSEC_EXPORT xmlDocPtr         xmlSecParseMemoryExt    (const xmlSecByte *prefi
                                                          xmlSecSize bufferSize,
                                                          const xmlSecByte *postfix,
                                                          xmlSecSize postfixSize);
+XMLSEC_EXPORT xmlDocPtr         xmlSecParseMemoryVec    (const xmlSecParserInputSegment *segments,
+                                                         xmlSecSize segmentsSize);
 XMLSEC_EXPORT void              xmlSecParsePrepareCtxt  (xmlParserCtxtPtr ctxt);
 
 XMLSEC_EXPORT int               xmlSecParserGetDefaultOptions(void);
 XMLSEC_EXPORT void              xmlSecParserSetDefaultOptions(int options);
 
+/**
+ * xmlSecParserPool:
+ *
+ * The pool of the XML parser contexts (see #xmlSecParserPoolCreate).
+ */
+typedef struct _xmlSecParserPool                        xmlSecParserPool,
+                                                        *xmlSecParserPoolPtr;
+
+XMLSEC_EXPORT xmlSecParserPoolPtr xmlSecParserPoolCreate        (xmlSecSize maxSize);
+XMLSEC_EXPORT void              xmlSecParserPoolDestroy         (xmlSecParserPoolPtr pool);
+XMLSEC_EXPORT xmlDocPtr         xmlSecParserPoolParseFile       (xmlSecParserPoolPtr pool,
+                                                                 const char* filename);
+XMLSEC_EXPORT xmlDocPtr         xmlSecParserPoolParseMemory     (xmlSecParserPoolPtr pool,
+                                                                 const xmlSecByte* buffer,
+                                                                 xmlSecSize size);
+
 
 /**
  * xmlSecTransformXmlParserId:
@@ -276,6 +276,18 @@ typedef int                     (*xmlSecCryptoAppKeysMngrCrlLoadMemoryMethod)(xm
                                                                          const xmlSecByte* data,
                                                                          xmlSecSize dataSize,
                                                                          xmlSecKeyDataFormat format);
+/**
+ * xmlSecCryptoAppKeysMngrEnableX509VerifyCacheMethod:
+ * @mngr:               the keys manager.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables the cache of the successful certificates verification results
+ * in the X509 store of @mngr.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+typedef int                     (*xmlSecCryptoAppKeysMngrEnableX509VerifyCacheMethod)(xmlSecKeysMngrPtr mngr,
+                                                                         xmlSecSize maxSize);
 
 /**
  * xmlSecCryptoAppKeyLoadMethod:
@@ -503,6 +515,7 @@ typedef int                     (*xmlSecCryptoAppKeyCertLoadMemoryMethod)(xmlSec
  * @cryptoAppKeysMngrCertLoadMemory:    the default keys manager memory cert load method.
  * @cryptoAppKeysMngrCrlLoad:           the default keys manager file crl load method.
  * @cryptoAppKeysMngrCrlLoadMemory:     the default keys manager memory crl load method.
+ * @cryptoAppKeysMngrEnableX509VerifyCache: the default keys manager certificates verification cache method.
  * @cryptoAppKeyLoad:           the key file load method.
  * @cryptoAppKeyLoadEx:         the key file load method.
  * @cryptoAppKeyLoadMemory:     the meory key load method.
@@ -638,6 +651,7 @@ struct _xmlSecCryptoDLFunctions {
     xmlSecCryptoAppKeysMngrCertLoadMemoryMethod  cryptoAppKeysMngrCertLoadMemory;
     xmlSecCryptoAppKeysMngrCrlLoadMethod         cryptoAppKeysMngrCrlLoad;
     xmlSecCryptoAppKeysMngrCrlLoadMemoryMethod   cryptoAppKeysMngrCrlLoadMemory;
+    xmlSecCryptoAppKeysMngrEnableX509VerifyCacheMethod cryptoAppKeysMngrEnableX509VerifyCache;
     xmlSecCryptoAppKeyLoadMethod                 cryptoAppKeyLoad;
     xmlSecCryptoAppKeyLoadExMethod               cryptoAppKeyLoadEx;
     xmlSecCryptoAppKeyLoadMemoryMethod           cryptoAppKeyLoadMemory;
@@ -0,0 +1,50 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The workload recorder for the replay load generator.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_RECORDER_H__
+#define __XMLSEC_RECORDER_H__
+
+#include <libxml/tree.h>
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * XMLSEC_RECORDER_MANIFEST_FILENAME:
+ *
+ * The name of the recorded operations list file in the recorder folder.
+ */
+#define XMLSEC_RECORDER_MANIFEST_FILENAME               "workload.txt"
+
+XMLSEC_EXPORT int               xmlSecRecorderInit              (void);
+XMLSEC_EXPORT void              xmlSecRecorderShutdown          (void);
+XMLSEC_EXPORT int               xmlSecRecorderStart             (const char* dirname,
+                                                                 xmlSecSize maxRecords);
+XMLSEC_EXPORT void              xmlSecRecorderStop              (void);
+XMLSEC_EXPORT int               xmlSecRecorderIsEnabled         (void);
+
+/* the functions below are used by the xmlsec library to record the operations */
+XMLSEC_EXPORT xmlSecSize        xmlSecRecorderAddDoc            (xmlDocPtr doc);
+XMLSEC_EXPORT void              xmlSecRecorderAddOp             (xmlSecSize record,
+                                                                 const char* op,
+                                                                 unsigned int flags,
+                                                                 unsigned int flags2,
+                                                                 const xmlChar* keyName,
+                                                                 const char* result);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_RECORDER_H__ */
@@ -0,0 +1,73 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The locked memory arena for the key material.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_SECMEM_H__
+#define __XMLSEC_SECMEM_H__
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * XMLSEC_SECURE_MEM_DEFAULT_ARENA_SIZE:
+ *
+ * The default size of the secure memory arena.
+ */
+#define XMLSEC_SECURE_MEM_DEFAULT_ARENA_SIZE            (256 * 1024)
+
+/**
+ * XMLSEC_SECURE_MEM_MAX_ALLOC_SIZE:
+ *
+ * The max size of one allocation from the secure memory arena (the larger
+ * allocations are made from the regular heap).
+ */
+#define XMLSEC_SECURE_MEM_MAX_ALLOC_SIZE                4096
+
+/**
+ * xmlSecSecureMemInfo:
+ * @arenaSize:          the arena size (0 if the arena is not created yet
+ *                      or not available).
+ * @used:               the currently allocated bytes (including the size
+ *                      classes rounding).
+ * @peak:               the maximum of @used.
+ * @fallbacks:          the number of allocations made from the regular heap
+ *                      because the arena was full or not available.
+ * @locked:             1 if the arena is locked in memory (it can't be swapped
+ *                      out) or 0 otherwise (e.g. because of RLIMIT_MEMLOCK).
+ *
+ * The secure memory arena usage.
+ */
+typedef struct _xmlSecSecureMemInfo {
+    xmlSecSize          arenaSize;
+    xmlSecSize          used;
+    xmlSecSize          peak;
+    xmlSecSize          fallbacks;
+    int                 locked;
+} xmlSecSecureMemInfo, *xmlSecSecureMemInfoPtr;
+
+XMLSEC_EXPORT int               xmlSecSecureMemInit             (void);
+XMLSEC_EXPORT void              xmlSecSecureMemShutdown         (void);
+XMLSEC_EXPORT int               xmlSecSecureMemSetArenaSize     (xmlSecSize size);
+XMLSEC_EXPORT void              xmlSecSecureMemGetInfo          (xmlSecSecureMemInfoPtr info);
+
+/* the functions below are used by the xmlsec library to allocate the key material */
+XMLSEC_EXPORT void*             xmlSecSecureMemAlloc            (xmlSecSize size,
+                                                                 xmlSecSize* allocSize);
+XMLSEC_EXPORT int               xmlSecSecureMemIsOwned          (const void* ptr);
+XMLSEC_EXPORT void              xmlSecSecureMemFree             (void* ptr);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_SECMEM_H__ */
@@ -0,0 +1,128 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Per-thread tuning settings.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_SETTINGS_H__
+#define __XMLSEC_SETTINGS_H__
+
+#include <libxml/tree.h>
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/buffer.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * XMLSEC_SETTINGS_BINARY_CHUNK_SIZE:
+ *
+ * The #xmlSecSettings.binaryChunkSize value is set.
+ */
+#define XMLSEC_SETTINGS_BINARY_CHUNK_SIZE               0x00000001
+
+/**
+ * XMLSEC_SETTINGS_BUFFER_ALLOC_MODE:
+ *
+ * The #xmlSecSettings.bufferAllocMode and #xmlSecSettings.bufferInitialSize
+ * values are set.
+ */
+#define XMLSEC_SETTINGS_BUFFER_ALLOC_MODE               0x00000002
+
+/**
+ * XMLSEC_SETTINGS_LIST_ALLOC_MODE:
+ *
+ * The #xmlSecSettings.listAllocMode and #xmlSecSettings.listInitialSize
+ * values are set.
+ */
+#define XMLSEC_SETTINGS_LIST_ALLOC_MODE                 0x00000004
+
+/**
+ * XMLSEC_SETTINGS_BASE64_LINE_SIZE:
+ *
+ * The #xmlSecSettings.base64LineSize value is set.
+ */
+#define XMLSEC_SETTINGS_BASE64_LINE_SIZE                0x00000008
+
+/**
+ * XMLSEC_SETTINGS_LINEFEED:
+ *
+ * The #xmlSecSettings.lineFeed value is set.
+ */
+#define XMLSEC_SETTINGS_LINEFEED                        0x00000010
+
+/**
+ * XMLSEC_SETTINGS_MEMBUF_SPILL_SIZE:
+ *
+ * The #xmlSecSettings.memBufSpillSize value is set.
+ */
+#define XMLSEC_SETTINGS_MEMBUF_SPILL_SIZE               0x00000020
+
+/**
+ * XMLSEC_SETTINGS_X509_SHALLOW_COPY:
+ *
+ * The #xmlSecSettings.x509ShallowCopy value is set.
+ */
+#define XMLSEC_SETTINGS_X509_SHALLOW_COPY               0x00000040
+
+/**
+ * xmlSecSettings:
+ * @flags:              the bit mask of the values set in this object
+ *                      (XMLSEC_SETTINGS_* constants); the other values
+ *                      are taken from the global defaults.
+ * @binaryChunkSize:    the transforms binary chunk size
+ *                      (see #xmlSecTransformCtxSetDefaultBinaryChunkSize).
+ * @bufferAllocMode:    the buffers allocation mode
+ *                      (see #xmlSecBufferSetDefaultAllocMode).
+ * @bufferInitialSize:  the buffers minimal initial size
+ *                      (see #xmlSecBufferSetDefaultAllocMode).
+ * @listAllocMode:      the lists allocation mode
+ *                      (see #xmlSecPtrListSetDefaultAllocMode).
+ * @listInitialSize:    the lists minimal initial size
+ *                      (see #xmlSecPtrListSetDefaultAllocMode).
+ * @base64LineSize:     the base64 line size
+ *                      (see #xmlSecBase64SetDefaultLineSize).
+ * @lineFeed:           the linefeed used in the generated nodes; the string
+ *                      is not copied (see #xmlSecSetDefaultLineFeed).
+ * @memBufSpillSize:    the memory buffer transforms spill size
+ *                      (see #xmlSecTransformMemBufSetDefaultSpillSize).
+ * @x509ShallowCopy:    the X509 key data duplication mode
+ *                      (see #xmlSecKeyDataX509SetDefaultShallowCopy).
+ *
+ * The tuning settings that replace the process wide defaults for the
+ * operations on the thread the settings object is attached to (see
+ * #xmlSecSettingsAttach). The DSig and Enc contexts attach the settings
+ * of their keys manager (see #xmlSecKeysMngrSetSettings) for the duration
+ * of each operation. The settings object should not be modified while
+ * it is attached.
+ */
+typedef struct _xmlSecSettings {
+    unsigned int                flags;
+    xmlSecSize                  binaryChunkSize;
+    xmlSecAllocMode             bufferAllocMode;
+    xmlSecSize                  bufferInitialSize;
+    xmlSecAllocMode             listAllocMode;
+    xmlSecSize                  listInitialSize;
+    int                         base64LineSize;
+    const xmlChar*              lineFeed;
+    xmlSecSize                  memBufSpillSize;
+    int                         x509ShallowCopy;
+} xmlSecSettings, *xmlSecSettingsPtr;
+
+XMLSEC_EXPORT void              xmlSecSettingsInitialize        (xmlSecSettingsPtr settings);
+XMLSEC_EXPORT xmlSecSettingsPtr xmlSecSettingsAttach            (xmlSecSettingsPtr settings);
+XMLSEC_EXPORT void              xmlSecSettingsDetach            (xmlSecSettingsPtr prev);
+XMLSEC_EXPORT xmlSecSettingsPtr xmlSecSettingsGetCurrent        (void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_SETTINGS_H__ */
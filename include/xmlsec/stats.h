@@ -0,0 +1,325 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Library-wide operations, phases, caches and transforms statistics.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_STATS_H__
+#define __XMLSEC_STATS_H__
+
+#include <stdio.h>
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/transforms.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * xmlSecStatsOp:
+ * @xmlSecStatsOpDSigSign:      the signature generation (#xmlSecDSigCtxSign, #xmlSecDSigCtxSignPrepare).
+ * @xmlSecStatsOpDSigVerify:    the signature verification (#xmlSecDSigCtxVerify).
+ * @xmlSecStatsOpEncEncrypt:    the encryption (#xmlSecEncCtxBinaryEncrypt, #xmlSecEncCtxXmlEncrypt, etc.).
+ * @xmlSecStatsOpEncDecrypt:    the decryption (#xmlSecEncCtxDecrypt, #xmlSecEncCtxDecryptToBuffer, etc.).
+ *
+ * The operation types.
+ */
+typedef enum {
+    xmlSecStatsOpDSigSign = 0,
+    xmlSecStatsOpDSigVerify,
+    xmlSecStatsOpEncEncrypt,
+    xmlSecStatsOpEncDecrypt
+} xmlSecStatsOp;
+
+/**
+ * XMLSEC_STATS_OPS_SIZE:
+ *
+ * The number of #xmlSecStatsOp values.
+ */
+#define XMLSEC_STATS_OPS_SIZE                           4
+
+/**
+ * xmlSecStatsPhase:
+ * @xmlSecStatsPhaseKeyResolution: the key lookup with the keys manager.
+ * @xmlSecStatsPhaseReferences:    the &lt;dsig:Reference/&gt; nodes processing.
+ * @xmlSecStatsPhaseC14N:          the canonicalization (including the transforms
+ *                                 the canonical output is streamed to, e.g. digest).
+ * @xmlSecStatsPhaseSignature:     the &lt;dsig:SignedInfo/&gt; processing and
+ *                                 &lt;dsig:SignatureValue/&gt; calculation or verification.
+ *
+ * The operation phases. The phases may be nested (e.g. the C14N phase is
+ * a part of the references and signature phases).
+ */
+typedef enum {
+    xmlSecStatsPhaseKeyResolution = 0,
+    xmlSecStatsPhaseReferences,
+    xmlSecStatsPhaseC14N,
+    xmlSecStatsPhaseSignature
+} xmlSecStatsPhase;
+
+/**
+ * XMLSEC_STATS_PHASES_SIZE:
+ *
+ * The number of #xmlSecStatsPhase values.
+ */
+#define XMLSEC_STATS_PHASES_SIZE                        4
+
+/**
+ * xmlSecStatsCache:
+ * @xmlSecStatsCacheXPath:              the compiled XPath expressions.
+ * @xmlSecStatsCacheXslt:               the compiled XSLT stylesheets.
+ * @xmlSecStatsCacheKeyInfo:            the keys manager keys resolved from &lt;dsig:KeyInfo/&gt;.
+ * @xmlSecStatsCacheKeyNotFound:        the keys manager recently not found keys.
+ * @xmlSecStatsCacheEncryptedKey:       the keys manager &lt;enc:EncryptedKey/&gt; unwrap results.
+ * @xmlSecStatsCacheSessionKey:         the keys manager reused session keys.
+ * @xmlSecStatsCacheRetrievalMethod:    the keys manager external &lt;dsig:RetrievalMethod/&gt; results.
+ * @xmlSecStatsCacheReferenceDigest:    the DSig context references digests.
+ * @xmlSecStatsCacheKdf:                the KDF derived keys.
+ * @xmlSecStatsCacheCryptoAlgorithm:    the crypto library digest and cipher objects.
+ * @xmlSecStatsCacheCryptoKeyValue:     the crypto library keys created from &lt;dsig:KeyValue/&gt;.
+ * @xmlSecStatsCacheCryptoKeyCtx:       the crypto library configured key contexts.
+ * @xmlSecStatsCacheHmac:               the crypto library keyed HMAC contexts.
+ * @xmlSecStatsCacheX509Cert:           the parsed &lt;dsig:X509Certificate/&gt; certificates.
+ * @xmlSecStatsCacheX509Write:          the serialized &lt;dsig:X509Data/&gt; values.
+ * @xmlSecStatsCacheX509Verify:         the certificates verification results.
+ * @xmlSecStatsCacheSignature:          the DSig context signatures verification results.
+ * @xmlSecStatsCacheRemoteKey:          the keys fetched by the remote keys stores.
+ * @xmlSecStatsCacheX509Crl:            the CRLs signatures verification results.
+ * @xmlSecStatsCacheKeyAgreement:       the key agreement shared secrets.
+ * @xmlSecStatsCacheX509Name:           the parsed X509 DN strings.
+ * @xmlSecStatsCacheDtd:                the parsed DTDs ID attributes declarations (#xmlSecAddDtdIDs).
+ * @xmlSecStatsCacheCertPubKey:         the crypto library public keys imported from the certificates.
+ *
+ * The library caches. The lookups are counted only when the cache is enabled.
+ */
+typedef enum {
+    xmlSecStatsCacheXPath = 0,
+    xmlSecStatsCacheXslt,
+    xmlSecStatsCacheKeyInfo,
+    xmlSecStatsCacheKeyNotFound,
+    xmlSecStatsCacheEncryptedKey,
+    xmlSecStatsCacheSessionKey,
+    xmlSecStatsCacheRetrievalMethod,
+    xmlSecStatsCacheReferenceDigest,
+    xmlSecStatsCacheKdf,
+    xmlSecStatsCacheCryptoAlgorithm,
+    xmlSecStatsCacheCryptoKeyValue,
+    xmlSecStatsCacheCryptoKeyCtx,
+    xmlSecStatsCacheHmac,
+    xmlSecStatsCacheX509Cert,
+    xmlSecStatsCacheX509Write,
+    xmlSecStatsCacheX509Verify,
+    xmlSecStatsCacheSignature,
+    xmlSecStatsCacheRemoteKey,
+    xmlSecStatsCacheX509Crl,
+    xmlSecStatsCacheKeyAgreement,
+    xmlSecStatsCacheX509Name,
+    xmlSecStatsCacheDtd,
+    xmlSecStatsCacheCertPubKey
+} xmlSecStatsCache;
+
+/**
+ * XMLSEC_STATS_CACHES_SIZE:
+ *
+ * The number of #xmlSecStatsCache values.
+ */
+#define XMLSEC_STATS_CACHES_SIZE                        23
+
+/**
+ * xmlSecStatsStartup:
+ * @xmlSecStatsStartupInit:             the xmlsec library initialization (#xmlSecInit).
+ * @xmlSecStatsStartupCryptoAppInit:    the crypto library initialization (e.g. #xmlSecCryptoAppInit).
+ * @xmlSecStatsStartupCryptoInit:       the xmlsec-crypto library initialization (e.g. #xmlSecCryptoInit).
+ * @xmlSecStatsStartupKeysMngrInit:     the crypto specific keys manager initialization
+ *                                      (e.g. #xmlSecCryptoAppDefaultKeysMngrInit).
+ * @xmlSecStatsStartupDeferredInit:     the crypto library initialization deferred to
+ *                                      the first use of the crypto library or the
+ *                                      trusted certificates.
+ *
+ * The startup steps.
+ */
+typedef enum {
+    xmlSecStatsStartupInit = 0,
+    xmlSecStatsStartupCryptoAppInit,
+    xmlSecStatsStartupCryptoInit,
+    xmlSecStatsStartupKeysMngrInit,
+    xmlSecStatsStartupDeferredInit
+} xmlSecStatsStartup;
+
+/**
+ * XMLSEC_STATS_STARTUP_SIZE:
+ *
+ * The number of #xmlSecStatsStartup values.
+ */
+#define XMLSEC_STATS_STARTUP_SIZE                       5
+
+/**
+ * XMLSEC_STATS_TRANSFORMS_SIZE:
+ *
+ * The maximum number of the transform klasses with the bytes counters
+ * (the bytes processed by the other klasses are not counted).
+ */
+#define XMLSEC_STATS_TRANSFORMS_SIZE                    64
+
+/**
+ * xmlSecStatsOpCounters:
+ * @started:            the number of started operations.
+ * @succeeded:          the number of succeeded operations.
+ * @failed:             the number of failed operations (including the
+ *                      invalid signatures).
+ *
+ * The operation counters.
+ */
+typedef struct _xmlSecStatsOpCounters {
+    xmlSecSize          started;
+    xmlSecSize          succeeded;
+    xmlSecSize          failed;
+} xmlSecStatsOpCounters;
+
+/**
+ * xmlSecStatsPhaseCounters:
+ * @count:              the number of the phase executions.
+ * @time:               the total wall clock time (in seconds).
+ *
+ * The phase counters.
+ */
+typedef struct _xmlSecStatsPhaseCounters {
+    xmlSecSize          count;
+    double              time;
+} xmlSecStatsPhaseCounters;
+
+/**
+ * xmlSecStatsCacheCounters:
+ * @hits:               the number of lookups that found the value.
+ * @misses:             the number of lookups that did not find the value.
+ *
+ * The cache counters.
+ */
+typedef struct _xmlSecStatsCacheCounters {
+    xmlSecSize          hits;
+    xmlSecSize          misses;
+} xmlSecStatsCacheCounters;
+
+/**
+ * xmlSecStatsTransformCounters:
+ * @id:                 the transform klass.
+ * @bytesIn:            the bytes consumed by the transform execute method.
+ * @bytesOut:           the bytes produced by the transform execute method.
+ *
+ * The transform klass counters.
+ */
+typedef struct _xmlSecStatsTransformCounters {
+    xmlSecTransformId   id;
+    xmlSecSize          bytesIn;
+    xmlSecSize          bytesOut;
+} xmlSecStatsTransformCounters;
+
+/**
+ * xmlSecStats:
+ * @ops:                the counters for each #xmlSecStatsOp.
+ * @phases:             the counters for each #xmlSecStatsPhase.
+ * @caches:             the counters for each #xmlSecStatsCache.
+ * @transforms:         the counters for the transform klasses.
+ * @transformsSize:     the number of used @transforms elements.
+ * @startup:            the counters for each #xmlSecStatsStartup step (recorded
+ *                      even if the statistics are disabled).
+ *
+ * The library statistics (see #xmlSecStatsGet).
+ */
+typedef struct _xmlSecStats {
+    xmlSecStatsOpCounters               ops[XMLSEC_STATS_OPS_SIZE];
+    xmlSecStatsPhaseCounters            phases[XMLSEC_STATS_PHASES_SIZE];
+    xmlSecStatsCacheCounters            caches[XMLSEC_STATS_CACHES_SIZE];
+    xmlSecStatsTransformCounters        transforms[XMLSEC_STATS_TRANSFORMS_SIZE];
+    xmlSecSize                          transformsSize;
+    xmlSecStatsPhaseCounters            startup[XMLSEC_STATS_STARTUP_SIZE];
+} xmlSecStats, *xmlSecStatsPtr;
+
+/**
+ * xmlSecStatsSpanType:
+ * @xmlSecStatsSpanTypeOp:      the operation span (see #xmlSecStatsOp).
+ * @xmlSecStatsSpanTypePhase:   the phase span (see #xmlSecStatsPhase).
+ * @xmlSecStatsSpanTypeStartup: the startup step span (see #xmlSecStatsStartup).
+ *
+ * The span types.
+ */
+typedef enum {
+    xmlSecStatsSpanTypeOp = 0,
+    xmlSecStatsSpanTypePhase,
+    xmlSecStatsSpanTypeStartup
+} xmlSecStatsSpanType;
+
+/**
+ * xmlSecStatsSpan:
+ * @type:               the span type.
+ * @id:                 the #xmlSecStatsOp, #xmlSecStatsPhase or #xmlSecStatsStartup value.
+ * @start:              the span start time (in seconds, monotonic clock).
+ * @duration:           the span duration (in seconds, set when the span ends).
+ * @failed:             the operation result (set when the operation span ends).
+ * @active:             set if the span is recorded (internal).
+ *
+ * The operation or phase span (allocated on stack by the caller).
+ */
+typedef struct _xmlSecStatsSpan {
+    xmlSecStatsSpanType type;
+    int                 id;
+    double              start;
+    double              duration;
+    int                 failed;
+    int                 active;
+} xmlSecStatsSpan, *xmlSecStatsSpanPtr;
+
+/**
+ * xmlSecStatsTraceCallback:
+ * @span:               the span.
+ * @end:                0 when the span starts or 1 when the span ends.
+ * @userData:           the user data passed to #xmlSecStatsSetTraceCallback.
+ *
+ * The tracing callback called on the thread that runs the operation.
+ */
+typedef void            (*xmlSecStatsTraceCallback)     (const xmlSecStatsSpan* span,
+                                                         int end,
+                                                         void* userData);
+
+XMLSEC_EXPORT int               xmlSecStatsInit                 (void);
+XMLSEC_EXPORT void              xmlSecStatsShutdown             (void);
+XMLSEC_EXPORT int               xmlSecStatsEnable               (int enabled);
+XMLSEC_EXPORT int               xmlSecStatsIsEnabled            (void);
+XMLSEC_EXPORT void              xmlSecStatsSetTraceCallback     (xmlSecStatsTraceCallback callback,
+                                                                 void* userData);
+XMLSEC_EXPORT int               xmlSecStatsGet                  (xmlSecStatsPtr stats);
+XMLSEC_EXPORT void              xmlSecStatsDebugDump            (xmlSecStatsPtr stats,
+                                                                 FILE* output);
+XMLSEC_EXPORT const char*       xmlSecStatsOpGetName            (xmlSecStatsOp op);
+XMLSEC_EXPORT const char*       xmlSecStatsPhaseGetName         (xmlSecStatsPhase phase);
+XMLSEC_EXPORT const char*       xmlSecStatsCacheGetName         (xmlSecStatsCache cache);
+XMLSEC_EXPORT const char*       xmlSecStatsStartupGetName       (xmlSecStatsStartup step);
+
+/* the functions below are used by the xmlsec and crypto libraries to record the stats */
+XMLSEC_EXPORT void              xmlSecStatsOpStart              (xmlSecStatsOp op,
+                                                                 xmlSecStatsSpanPtr span);
+XMLSEC_EXPORT void              xmlSecStatsOpEnd                (xmlSecStatsSpanPtr span,
+                                                                 int failed);
+XMLSEC_EXPORT void              xmlSecStatsPhaseStart           (xmlSecStatsPhase phase,
+                                                                 xmlSecStatsSpanPtr span);
+XMLSEC_EXPORT void              xmlSecStatsPhaseEnd             (xmlSecStatsSpanPtr span);
+XMLSEC_EXPORT void              xmlSecStatsStartupStart         (xmlSecStatsStartup step,
+                                                                 xmlSecStatsSpanPtr span);
+XMLSEC_EXPORT void              xmlSecStatsStartupEnd           (xmlSecStatsSpanPtr span);
+XMLSEC_EXPORT void              xmlSecStatsCacheLookup          (xmlSecStatsCache cache,
+                                                                 int found);
+XMLSEC_EXPORT void              xmlSecStatsTransformBytes       (xmlSecTransformId id,
+                                                                 xmlSecSize bytesIn,
+                                                                 xmlSecSize bytesOut);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_STATS_H__ */
@@ -33,6 +33,7 @@ XMLSEC_EXPORT_VAR const xmlChar xmlSecEnc11Ns[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecXPathNs[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecXPath2Ns[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecXPointerNs[];
+XMLSEC_EXPORT_VAR const xmlChar xmlSecXopNs[];
 
 
 /*************************************************************************
@@ -67,6 +68,7 @@ XMLSEC_EXPORT_VAR const xmlChar xmlSecNodeReferenceList[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecNodeDataReference[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecNodeKeyReference[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecNodeCarriedKeyName[];
+XMLSEC_EXPORT_VAR const xmlChar xmlSecNodeXopInclude[];
 
 XMLSEC_EXPORT_VAR const xmlChar xmlSecTypeEncContent[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecTypeEncElement[];
@@ -95,6 +97,7 @@ XMLSEC_EXPORT_VAR const xmlChar xmlSecAttrAlgorithm[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecAttrTarget[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecAttrFilter[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecAttrRecipient[];
+XMLSEC_EXPORT_VAR const xmlChar xmlSecAttrHref[];
 
 /*************************************************************************
  *
@@ -722,6 +725,14 @@ XMLSEC_EXPORT_VAR const xmlChar xmlSecRelationshipAttrTargetMode[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecNameXslt[];
 XMLSEC_EXPORT_VAR const xmlChar xmlSecHrefXslt[];
 
+/*************************************************************************
+ *
+ * Deflate strings
+ *
+ ************************************************************************/
+XMLSEC_EXPORT_VAR const xmlChar xmlSecNameDeflate[];
+XMLSEC_EXPORT_VAR const xmlChar xmlSecHrefDeflate[];
+
 /*************************************************************************
  *
  * Utility strings
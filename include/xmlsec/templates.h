@@ -42,6 +42,10 @@ XMLSEC_EXPORT xmlNodePtr xmlSecTmplSignatureAddReference        (xmlNodePtr sign
                                                                  const xmlChar *id,
                                                                  const xmlChar *uri,
                                                                  const xmlChar *type);
+XMLSEC_EXPORT int        xmlSecTmplSignatureAddReferences       (xmlNodePtr signNode,
+                                                                 xmlSecTransformId digestMethodId,
+                                                                 const xmlChar **uris,
+                                                                 xmlSecSize urisSize);
 XMLSEC_EXPORT xmlNodePtr xmlSecTmplSignatureAddObject           (xmlNodePtr signNode,
                                                                  const xmlChar *id,
                                                                  const xmlChar *mimeType,
@@ -291,6 +291,133 @@ typedef int             (*xmlSecTransformCtxPreExecuteCallback)         (xmlSecT
  */
 #define XMLSEC_TRANSFORMCTX_FLAGS_USE_VISA3D_HACK               0x00000001
 
+/**
+ * XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS:
+ *
+ * If this flag is set then the calls counters, the bytes counters and the
+ * time spent in each transform are collected in the transform's @stats
+ * (see #xmlSecTransformStats).
+ */
+#define XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS                 0x00000002
+
+/**
+ * XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N:
+ *
+ * If this flag is set then the C14N transforms use libxml2 xmlC14NExecute()
+ * instead of the xmlsec native C14N serializer.
+ */
+#define XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N              0x00000004
+
+/**
+ * XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE:
+ *
+ * If this flag is set then the @binaryChunkSize is picked for each
+ * execution from the input size (if known, e.g. the binary data size or
+ * the local file size) within the [@binaryChunkSizeMin, @binaryChunkSizeMax]
+ * range: the small inputs use small buffers and the large ones are
+ * processed in fewer and larger chunks.
+ */
+#define XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE           0x00000008
+
+/**
+ * XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_MIN:
+ *
+ * The default minimum binary chunk size for the
+ * #XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE flag (4KB).
+ */
+#define XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_MIN               (4*1024)
+
+/**
+ * XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_MAX:
+ *
+ * The default maximum binary chunk size for the
+ * #XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE flag (64KB). The larger
+ * chunks reduce the number of calls but do not fit in the CPU caches:
+ * increase it only if the transforms calls overhead is significant.
+ */
+#define XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_MAX               (64*1024)
+
+/**
+ * XMLSEC_TRANSFORMCTX_EXECUTOR_MIN_SIZE:
+ *
+ * The default minimum size of the data decrypted on the executor at once
+ * (see #xmlSecTransformCtxSetExecutor, 4MB). The smaller payloads are
+ * decrypted in the current thread.
+ */
+#define XMLSEC_TRANSFORMCTX_EXECUTOR_MIN_SIZE                   (4*1024*1024)
+
+/**
+ * xmlSecTransformOpStats:
+ * @calls:              the number of calls.
+ * @wallTime:           the wall clock time (in seconds) spent in the calls, excluding
+ *                      the time spent in the other transforms called from it.
+ * @cpuTime:            the CPU time (in seconds) spent in the calls, excluding
+ *                      the time spent in the other transforms called from it.
+ *
+ * The statistics for one transform operation (push, pop or execute).
+ */
+typedef struct _xmlSecTransformOpStats          xmlSecTransformOpStats,
+                                                *xmlSecTransformOpStatsPtr;
+struct _xmlSecTransformOpStats {
+    xmlSecSize                                  calls;
+    double                                      wallTime;
+    double                                      cpuTime;
+};
+
+/**
+ * xmlSecTransformStats:
+ * @bytesIn:            the number of bytes consumed from the transform's input buffer.
+ * @bytesOut:           the number of bytes produced in the transform's output buffer.
+ * @outBufMaxSize:      the maximum allocated size of the transform's output buffer.
+ * @pushBin:            the #xmlSecTransformPushBin statistics.
+ * @popBin:             the #xmlSecTransformPopBin statistics.
+ * @pushXml:            the #xmlSecTransformPushXml statistics.
+ * @popXml:             the #xmlSecTransformPopXml statistics.
+ * @execute:            the #xmlSecTransformExecute statistics.
+ *
+ * The transform statistics collected if #XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS
+ * flag is set.
+ */
+typedef struct _xmlSecTransformStats            xmlSecTransformStats,
+                                                *xmlSecTransformStatsPtr;
+struct _xmlSecTransformStats {
+    xmlSecSize                                  bytesIn;
+    xmlSecSize                                  bytesOut;
+    xmlSecSize                                  outBufMaxSize;
+    xmlSecTransformOpStats                      pushBin;
+    xmlSecTransformOpStats                      popBin;
+    xmlSecTransformOpStats                      pushXml;
+    xmlSecTransformOpStats                      popXml;
+    xmlSecTransformOpStats                      execute;
+};
+
+/**
+ * xmlSecTransformCtxStatsCallback:
+ * @transformCtx:       the pointer to transform's context.
+ * @transform:          the pointer to transform.
+ * @stats:              the pointer to @transform statistics.
+ *
+ * The callback called for each transform in the chain right before the chain
+ * is destroyed if #XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS flag is set.
+ */
+typedef void            (*xmlSecTransformCtxStatsCallback)              (xmlSecTransformCtxPtr transformCtx,
+                                                                         xmlSecTransformPtr transform,
+                                                                         const xmlSecTransformStats* stats);
+
+/**
+ * xmlSecTransformBinSegment:
+ * @data:               the pointer to the segment data.
+ * @size:               the segment data size.
+ *
+ * One segment of the binary input that is not stored contiguously
+ * in memory (e.g. the text children of a node or the network chunks),
+ * see #xmlSecTransformPushBinV.
+ */
+typedef struct _xmlSecTransformBinSegment {
+    const xmlSecByte*                           data;
+    xmlSecSize                                  size;
+} xmlSecTransformBinSegment;
+
 /**
  * xmlSecTransformCtx:
  * @userData:           the pointer to user data (xmlsec and xmlsec-crypto never
@@ -300,6 +427,10 @@ typedef int             (*xmlSecTransformCtxPreExecuteCallback)         (xmlSecT
  * @flags2:             the bit mask flags to control transforms execution
  *                      (reserved for the future).
  * @binaryChunkSize:    the chunk of size for binary transforms processing.
+ * @binaryChunkSizeMin: the minimum @binaryChunkSize picked if the
+ *                      #XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE flag is set.
+ * @binaryChunkSizeMax: the maximum @binaryChunkSize picked if the
+ *                      #XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE flag is set.
  * @enabledUris:        the allowed transform data source uri types.
  * @enabledTransforms:  the list of enabled transforms; if list is empty (default)
  *                      then all registered transforms are enabled.
@@ -316,6 +447,29 @@ typedef int             (*xmlSecTransformCtxPreExecuteCallback)         (xmlSecT
  * @xptrExpr:           the xpointer expression from data source URI (if any).
  * @first:              the first transform in the chain.
  * @last:               the last transform in the chain.
+ * @pumpBuf:            the scratch buffer used by #xmlSecTransformPump (allocated on
+ *                      first use and kept until the context is finalized).
+ * @pumpBufSize:        the size of the @pumpBuf buffer.
+ * @pumpBufExternal:    the flag: if set to 1 then @pumpBuf is owned by the caller
+ *                      (see #xmlSecTransformCtxSetPumpBuffer).
+ * @arena:              the optional arena (not owned) to allocate transforms created
+ *                      by this context from (see #XMLSEC_DSIG_FLAGS_USE_ARENA).
+ * @statsCallback:      the optional callback to report the transforms statistics
+ *                      (see #XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS).
+ * @statsChildWallTime: the wall clock time spent in the nested transform calls (internal).
+ * @statsChildCpuTime:  the CPU time spent in the nested transform calls (internal).
+ * @ioCallbacks:        the optional I/O callbacks list (#xmlSecIOCallbackPtrListId,
+ *                      not owned) searched before the global I/O callbacks
+ *                      when the data source URI is opened; it should not be
+ *                      modified while the context is in use.
+ * @deadline:           the monotonic clock time (in seconds) when the processing
+ *                      fails or 0 if there is no deadline (internal, see
+ *                      #xmlSecTransformCtxSetDeadline).
+ * @cancelFlag:         the optional application flag, the processing fails
+ *                      once it is set to a non-zero value.
+ * @executor:           the optional executor (not owned) to decrypt the large CBC
+ *                      payloads in parallel (see #xmlSecTransformCtxSetExecutor).
+ * @executorMinSize:    the minimum size of the data decrypted on the @executor at once.
  * @reserved0:          reserved for the future.
  * @reserved1:          reserved for the future.
  *
@@ -327,6 +481,8 @@ struct _xmlSecTransformCtx {
     unsigned int                                flags;
     unsigned int                                flags2;
     xmlSecSize                                  binaryChunkSize;
+    xmlSecSize                                  binaryChunkSizeMin;
+    xmlSecSize                                  binaryChunkSizeMax;
     xmlSecTransformUriType                      enabledUris;
     xmlSecPtrList                               enabledTransforms;
     xmlSecTransformCtxPreExecuteCallback        preExecCallback;
@@ -342,6 +498,30 @@ struct _xmlSecTransformCtx {
     xmlSecTransformPtr                          first;
     xmlSecTransformPtr                          last;
 
+    /* scratch buffer for xmlSecTransformPump */
+    xmlSecByte*                                 pumpBuf;
+    xmlSecSize                                  pumpBufSize;
+    int                                         pumpBufExternal;
+
+    /* optional allocator for the transforms */
+    struct _xmlSecArena*                        arena;
+
+    /* statistics */
+    xmlSecTransformCtxStatsCallback             statsCallback;
+    double                                      statsChildWallTime;
+    double                                      statsChildCpuTime;
+
+    /* per context I/O callbacks */
+    xmlSecPtrListPtr                            ioCallbacks;
+
+    /* time budget and cancellation (see xmlSecTransformCtxSetDeadline) */
+    double                                      deadline;
+    volatile int*                               cancelFlag;
+
+    /* parallel decryption (see xmlSecTransformCtxSetExecutor) */
+    struct _xmlSecExecutor*                     executor;
+    xmlSecSize                                  executorMinSize;
+
     /* for the future */
     void*                                       reserved0;
     void*                                       reserved1;
@@ -354,6 +534,17 @@ XMLSEC_EXPORT void                      xmlSecTransformCtxFinalize      (xmlSecT
 XMLSEC_EXPORT void                      xmlSecTransformCtxReset         (xmlSecTransformCtxPtr ctx);
 XMLSEC_EXPORT int                       xmlSecTransformCtxCopyUserPref  (xmlSecTransformCtxPtr dst,
                                                                          xmlSecTransformCtxPtr src);
+XMLSEC_EXPORT int                       xmlSecTransformCtxSetPumpBuffer (xmlSecTransformCtxPtr ctx,
+                                                                         xmlSecByte* buf,
+                                                                         xmlSecSize bufSize);
+XMLSEC_EXPORT int                       xmlSecTransformCtxSetDeadline   (xmlSecTransformCtxPtr ctx,
+                                                                         double timeout,
+                                                                         volatile int* cancelFlag);
+XMLSEC_EXPORT int                       xmlSecTransformCtxCheckDeadline (xmlSecTransformCtxPtr ctx);
+XMLSEC_EXPORT int                       xmlSecTransformCtxIsDeadlineExceeded(xmlSecTransformCtxPtr ctx);
+XMLSEC_EXPORT int                       xmlSecTransformCtxSetExecutor   (xmlSecTransformCtxPtr ctx,
+                                                                         struct _xmlSecExecutor* executor,
+                                                                         xmlSecSize minSize);
 XMLSEC_EXPORT int                       xmlSecTransformCtxSetUri        (xmlSecTransformCtxPtr ctx,
                                                                          const xmlChar* uri,
                                                                          xmlNodePtr hereNode);
@@ -376,8 +567,17 @@ XMLSEC_EXPORT int                       xmlSecTransformCtxPrepare       (xmlSecT
 XMLSEC_EXPORT int                       xmlSecTransformCtxBinaryExecute (xmlSecTransformCtxPtr ctx,
                                                                          const xmlSecByte* data,
                                                                          xmlSecSize dataSize);
+XMLSEC_EXPORT int                       xmlSecTransformCtxBinaryExecuteV(xmlSecTransformCtxPtr ctx,
+                                                                         const xmlSecTransformBinSegment* segments,
+                                                                         xmlSecSize segmentsSize);
+XMLSEC_EXPORT int                       xmlSecTransformCtxNodeContentExecute(xmlSecTransformCtxPtr ctx,
+                                                                         xmlNodePtr node);
 XMLSEC_EXPORT int                       xmlSecTransformCtxUriExecute    (xmlSecTransformCtxPtr ctx,
                                                                          const xmlChar* uri);
+XMLSEC_EXPORT int                       xmlSecTransformCtxUriExecuteStart(xmlSecTransformCtxPtr ctx,
+                                                                         const xmlChar* uri);
+XMLSEC_EXPORT int                       xmlSecTransformCtxUriExecuteResume(xmlSecTransformCtxPtr ctx);
+XMLSEC_EXPORT int                       xmlSecTransformCtxGetWaitFd     (xmlSecTransformCtxPtr ctx);
 XMLSEC_EXPORT int                       xmlSecTransformCtxXmlExecute    (xmlSecTransformCtxPtr ctx,
                                                                          xmlSecNodeSetPtr nodes);
 XMLSEC_EXPORT int                       xmlSecTransformCtxExecute       (xmlSecTransformCtxPtr ctx,
@@ -410,6 +610,13 @@ XMLSEC_EXPORT void                      xmlSecTransformCtxSetDefaultBinaryChunkS
  * @inNodes:            the input XML nodes.
  * @outNodes:           the output XML nodes.
  * @expectedOutputSize: the expected transform output size (used for key wraps).
+ * @arena:              the arena the transform is allocated from (NULL if the transform
+ *                      was allocated with xmlMalloc).
+ * @stats:              the transform statistics (see #XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS).
+ * @borrowInput:        if set then the transform's execute method only reads the data
+ *                      from @inBuf and removes all of it, thus #xmlSecTransformDefaultPushBin
+ *                      gives the pushed data to the transform in place instead of
+ *                      copying it to @inBuf (e.g. digests).
  * @reserved0:          reserved for the future.
  * @reserved1:          reserved for the future.
  *
@@ -436,6 +643,11 @@ struct _xmlSecTransform {
     /* used for some transform (e.g. KDF) to determine the desired output size */
     xmlSecSize                          expectedOutputSize;
 
+    struct _xmlSecArena*                arena;
+
+    xmlSecTransformStats                stats;
+    int                                 borrowInput;
+
     /* reserved for the future */
     void*                               reserved0;
     void*                               reserved1;
@@ -443,6 +655,9 @@ struct _xmlSecTransform {
 
 XMLSEC_EXPORT xmlSecTransformPtr        xmlSecTransformCreate   (xmlSecTransformId id);
 XMLSEC_EXPORT void                      xmlSecTransformDestroy  (xmlSecTransformPtr transform);
+XMLSEC_EXPORT void                      xmlSecTransformPoolEnable(xmlSecSize maxObjects,
+                                                                 xmlSecSize maxBufferSize);
+XMLSEC_EXPORT void                      xmlSecTransformPoolCleanup(void);
 XMLSEC_EXPORT xmlSecTransformPtr        xmlSecTransformNodeRead (xmlNodePtr node,
                                                                  xmlSecTransformUsage usage,
                                                                  xmlSecTransformCtxPtr transformCtx);
@@ -468,6 +683,11 @@ XMLSEC_EXPORT int                       xmlSecTransformPushBin  (xmlSecTransform
                                                                  xmlSecSize dataSize,
                                                                  int final,
                                                                  xmlSecTransformCtxPtr transformCtx);
+XMLSEC_EXPORT int                       xmlSecTransformPushBinV (xmlSecTransformPtr transform,
+                                                                 const xmlSecTransformBinSegment* segments,
+                                                                 xmlSecSize segmentsSize,
+                                                                 int final,
+                                                                 xmlSecTransformCtxPtr transformCtx);
 XMLSEC_EXPORT int                       xmlSecTransformPopBin   (xmlSecTransformPtr transform,
                                                                  xmlSecByte* data,
                                                                  xmlSecSize maxDataSize,
@@ -977,6 +1197,8 @@ XMLSEC_EXPORT int               xmlSecTransformXPointerSetExpr          (xmlSecT
                                                                          const xmlChar* expr,
                                                                          xmlSecNodeSetType nodeSetType,
                                                                          xmlNodePtr hereNode);
+XMLSEC_EXPORT void              xmlSecTransformXPathGetCacheStats       (xmlSecSize* hits,
+                                                                         xmlSecSize* misses);
 /**
  * xmlSecTransformRelationshipId:
  *
@@ -986,6 +1208,30 @@ XMLSEC_EXPORT int               xmlSecTransformXPointerSetExpr          (xmlSecT
         xmlSecTransformRelationshipGetKlass()
 XMLSEC_EXPORT xmlSecTransformId xmlSecTransformRelationshipGetKlass     (void);
 
+#ifndef XMLSEC_NO_ZLIB
+
+/**
+ * XMLSEC_TRANSFORM_DEFLATE_DEFAULT_MAX_OUTPUT_SIZE:
+ *
+ * The default max size of the deflate decode transform output (64MB).
+ */
+#define XMLSEC_TRANSFORM_DEFLATE_DEFAULT_MAX_OUTPUT_SIZE        (64 * 1024 * 1024)
+
+/**
+ * xmlSecTransformDeflateId:
+ *
+ * The deflate (RFC 1951) compression transform klass: the encode operation
+ * compresses the data and the decode operation decompresses it.
+ */
+#define xmlSecTransformDeflateId \
+        xmlSecTransformDeflateGetKlass()
+XMLSEC_EXPORT xmlSecTransformId xmlSecTransformDeflateGetKlass          (void);
+XMLSEC_EXPORT void              xmlSecTransformDeflateSetLevel          (xmlSecTransformPtr transform,
+                                                                         int level);
+XMLSEC_EXPORT void              xmlSecTransformDeflateSetMaxOutputSize  (xmlSecTransformPtr transform,
+                                                                         xmlSecSize maxOutputSize);
+#endif /* XMLSEC_NO_ZLIB */
+
 #ifndef XMLSEC_NO_XSLT
 
 /**
@@ -1030,6 +1276,11 @@ XMLSEC_EXPORT int               xmlSecTransformVisa3DHackSetID          (xmlSecT
  *
  ********************************************************************/
 
+XMLSEC_EXPORT int               xmlSecTransformKdfEnableCache           (xmlSecSize maxSize);
+XMLSEC_EXPORT void              xmlSecTransformKdfDisableCache          (void);
+XMLSEC_EXPORT int               xmlSecTransformKeyAgreementEnableCache  (xmlSecSize maxSize);
+XMLSEC_EXPORT void              xmlSecTransformKeyAgreementDisableCache (void);
+
 #ifndef XMLSEC_NO_HMAC
 XMLSEC_EXPORT xmlSecSize        xmlSecTransformHmacGetMinOutputBitsSize(void);
 XMLSEC_EXPORT void              xmlSecTransformHmacSetMinOutputBitsSize(xmlSecSize val);
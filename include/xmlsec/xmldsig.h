@@ -25,6 +25,8 @@
 #include <xmlsec/keys.h>
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/keyinfo.h>
+#include <xmlsec/memstats.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/transforms.h>
 
 #ifdef __cplusplus
@@ -54,6 +56,10 @@ typedef enum {
  * @xmlSecDSigFailureReasonReference:       the reference processing failure (e.g. digest doesn't match).
  * @xmlSecDSigFailureReasonSignature:       the signature processing failure (e.g. signature doesn't match).
  * @xmlSecDSigFailureReasonKeyNotFound:     the key not found.
+ * @xmlSecDSigFailureReasonDeadline:        the processing is stopped by the deadline
+ *                                          or cancelled (see #xmlSecDSigCtxSetDeadline).
+ * @xmlSecDSigFailureReasonCostLimit:       the estimated processing cost is over
+ *                                          the #xmlSecDSigCtx.maxCost limits.
  *
  * XML Digital signature processing failure reason. The application should use
  * @xmlSecDSigStatus to find out the operation status first.
@@ -63,6 +69,8 @@ typedef enum {
     xmlSecDSigFailureReasonReference,
     xmlSecDSigFailureReasonSignature,
     xmlSecDSigFailureReasonKeyNotFound,
+    xmlSecDSigFailureReasonDeadline,
+    xmlSecDSigFailureReasonCostLimit,
 } xmlSecDSigFailureReason;
 
 
@@ -112,6 +120,316 @@ typedef enum {
  */
 #define XMLSEC_DSIG_FLAGS_USE_VISA3D_HACK                       0x00000010
 
+/**
+ * XMLSEC_DSIG_FLAGS_USE_ARENA:
+ *
+ * If this flag is set then the transforms created while processing
+ * &lt;dsig:Signature/&gt; element are allocated from the context arena
+ * and released all at once by #xmlSecDSigCtxReset or #xmlSecDSigCtxFinalize
+ * functions. The released memory is zeroed.
+ */
+#define XMLSEC_DSIG_FLAGS_USE_ARENA                             0x00000020
+
+/**
+ * XMLSEC_DSIG_FLAGS_VERIFY_SIGNATURE_FIRST:
+ *
+ * If this flag is set then the &lt;dsig:SignatureValue/&gt; is verified
+ * against the canonicalized &lt;dsig:SignedInfo/&gt; before any reference
+ * is digested, and the references are processed only if the signature
+ * matches. The verification result is the same but a signature with
+ * a wrong value or key is rejected without digesting the references
+ * (#xmlSecDSigFailureReasonSignature is reported even if the references
+ * are invalid too). Ignored for signing.
+ */
+#define XMLSEC_DSIG_FLAGS_VERIFY_SIGNATURE_FIRST                0x00000040
+
+/**
+ * XMLSEC_DSIG_FLAGS_DEFER_MANIFEST_REFERENCES:
+ *
+ * If this flag is set then the &lt;dsig:Reference/&gt; elements in
+ * &lt;dsig:Manifest/&gt; nodes are only read during signature verification
+ * and left with #xmlSecDSigStatusUnknown status. The application verifies
+ * the ones it needs with #xmlSecDSigReferenceCtxVerify or
+ * #xmlSecDSigCtxVerifyManifestReferences functions before resetting
+ * the context. Ignored for signing.
+ */
+#define XMLSEC_DSIG_FLAGS_DEFER_MANIFEST_REFERENCES             0x00000080
+
+/**
+ * XMLSEC_DSIG_FLAGS_KEEP_KEYINFO:
+ *
+ * If this flag is set then the &lt;dsig:KeyInfo/&gt; node is not updated
+ * with the signature key data when signing (e.g. it was already written
+ * by #xmlSecDSigTemplateCreate function).
+ */
+#define XMLSEC_DSIG_FLAGS_KEEP_KEYINFO                          0x00000100
+
+/**
+ * XMLSEC_DSIG_FLAGS_IDS_REGISTERED:
+ *
+ * If this flag is set then the &lt;dsig:Signature/&gt; node Id attributes
+ * are not added to the document IDs (e.g. they were already registered
+ * by #xmlSecDSigVerifyAll function) and the document is not modified
+ * during signature verification.
+ */
+#define XMLSEC_DSIG_FLAGS_IDS_REGISTERED                        0x00000200
+
+/**
+ * XMLSEC_DSIG_FLAGS_EXECUTE_MANIFEST_REFERENCES:
+ *
+ * If this flag is set and the #xmlSecDSigCtx.referencesExecutor is set
+ * then the &lt;dsig:Reference/&gt; elements of each &lt;dsig:Manifest/&gt;
+ * node (e.g. the OPC package parts) are digested by the executor too.
+ * The same restrictions as for the &lt;dsig:SignedInfo/&gt; references apply
+ * (see also #xmlSecIOCallbackPtrListAddPackage).
+ */
+#define XMLSEC_DSIG_FLAGS_EXECUTE_MANIFEST_REFERENCES           0x00000400
+
+/**
+ * XMLSEC_DSIG_FLAGS_COLLECT_MEM_STATS:
+ *
+ * If this flag is set (or the #xmlSecDSigCtx.memStats limit is set) then
+ * the memory allocated by xmlsec during the signature processing is counted
+ * in #xmlSecDSigCtx.memStats. The counters are reset by #xmlSecDSigCtxReset.
+ */
+#define XMLSEC_DSIG_FLAGS_COLLECT_MEM_STATS                     0x00000800
+
+/**
+ * xmlSecDSigReferenceExecuteTask:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ *
+ * The xmlsec function that executes the transforms chain of a single
+ * &lt;dsig:Reference/&gt; element and calculates (or verifies) its digest.
+ * The task only reads the document and only modifies @dsigRefCtx, thus
+ * tasks for different references can be run concurrently.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+typedef int             (*xmlSecDSigReferenceExecuteTask)       (xmlSecDSigReferenceCtxPtr dsigRefCtx);
+
+/**
+ * xmlSecDSigReferencesExecutor:
+ * @executorCtx:        the executor context (#xmlSecDSigCtx.referencesExecutorCtx).
+ * @task:               the task to run for each reference.
+ * @dsigRefCtxs:        the array of &lt;dsig:Reference/&gt; element processing contexts.
+ * @size:               the number of elements in @dsigRefCtxs.
+ *
+ * The application supplied executor for &lt;dsig:SignedInfo/&gt; references.
+ * The executor must call @task exactly once for each element of @dsigRefCtxs
+ * (in any order and, possibly, concurrently, e.g. on a worker pool) and return
+ * only after all the tasks have completed. The results are merged by xmlsec
+ * in the document order after the executor returns. Per reference failures
+ * are recorded in the reference context, the executor doesn't need to
+ * collect the tasks results.
+ *
+ * The #xmlSecDSigReferencesExecutorRun function with a #xmlSecExecutor as
+ * @executorCtx can be used as the executor.
+ *
+ * Returns: 0 on success or a negative value if the tasks could not be run.
+ */
+typedef int             (*xmlSecDSigReferencesExecutor)         (void* executorCtx,
+                                                                 xmlSecDSigReferenceExecuteTask task,
+                                                                 xmlSecDSigReferenceCtxPtr* dsigRefCtxs,
+                                                                 xmlSecSize size);
+
+/**
+ * xmlSecDSigPreDataSink:
+ * @context:            the sink context (#xmlSecDSigCtx.preDataSinkCtx).
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; processing context
+ *                      for the pre-digest data or NULL for the pre-sign data.
+ * @data:               the next chunk of the data.
+ * @size:               the chunk size (might be 0 for the last call).
+ * @last:               the flag: if set then this is the last chunk.
+ *
+ * The application supplied sink for the pre-digest and pre-sign data
+ * (e.g. for the audit logging). The sink receives the data chunk by chunk
+ * as it goes through the transforms chain. The sink might be called from
+ * different threads if the #xmlSecDSigCtx.referencesExecutor is used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs
+ * (the signature processing fails).
+ */
+typedef int             (*xmlSecDSigPreDataSink)                (void* context,
+                                                                 xmlSecDSigCtxPtr dsigCtx,
+                                                                 xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                                 const xmlSecByte* data,
+                                                                 xmlSecSize size,
+                                                                 int last);
+
+/**
+ * xmlSecDSigDigestCache:
+ *
+ * The cache of the external and pinned same document &lt;dsig:Reference/&gt;
+ * digests (see #xmlSecDSigDigestCacheCreate).
+ */
+typedef struct _xmlSecDSigDigestCache                   xmlSecDSigDigestCache,
+                                                        *xmlSecDSigDigestCachePtr;
+
+/**
+ * xmlSecDSigVerifyCache:
+ *
+ * The cache of the &lt;dsig:SignatureValue/&gt; verification results
+ * (see #xmlSecDSigVerifyCacheCreate).
+ */
+typedef struct _xmlSecDSigVerifyCache                   xmlSecDSigVerifyCache,
+                                                        *xmlSecDSigVerifyCachePtr;
+
+/**
+ * xmlSecDSigTemplate:
+ *
+ * The prepared &lt;dsig:Signature/&gt; template (see #xmlSecDSigTemplateCreate).
+ */
+typedef struct _xmlSecDSigTemplate                      xmlSecDSigTemplate,
+                                                        *xmlSecDSigTemplatePtr;
+
+/**
+ * xmlSecDSigDigestCacheValidator:
+ * @context:            the context passed to #xmlSecDSigDigestCacheSetValidator.
+ * @uri:                the external reference URI (without the fragment part).
+ * @validator:          the buffer for the resource freshness validator.
+ *
+ * Gets the freshness validator for the resource @uri (e.g. the HTTP ETag
+ * or Last-Modified headers or the file size and modification time). The
+ * cached digest is used only if the validator is the same as when the
+ * digest was calculated. The callback might be called from different threads
+ * if the #xmlSecDSigCtx.referencesExecutor is used.
+ *
+ * Returns: 1 if @validator was set, 0 if the resource can't be validated
+ * (its digest is not cached) or a negative value if an error occurs.
+ */
+typedef int             (*xmlSecDSigDigestCacheValidator)       (void* context,
+                                                                 const xmlChar* uri,
+                                                                 xmlSecBufferPtr validator);
+
+/**
+ * xmlSecDSigDigestCacheNodeValidator:
+ * @context:            the context passed to #xmlSecDSigDigestCacheSetNodeValidator.
+ * @node:               the same document reference (URI="#id") target node.
+ * @validator:          the buffer for the subtree validator.
+ *
+ * Gets the validator for the @node subtree, i.e. pins the subtree as
+ * immutable: the application sets @validator to a value that identifies
+ * the subtree content (e.g. the static fragment name and its generation
+ * counter that is incremented on every change). The cached digest is used
+ * for any node with the same validator (in the same or another document).
+ * The callback might be called from different threads if the
+ * #xmlSecDSigCtx.referencesExecutor is used.
+ *
+ * Returns: 1 if @validator was set, 0 if the subtree is not pinned
+ * (its digest is not cached) or a negative value if an error occurs.
+ */
+typedef int             (*xmlSecDSigDigestCacheNodeValidator)   (void* context,
+                                                                 xmlNodePtr node,
+                                                                 xmlSecBufferPtr validator);
+
+/**
+ * xmlSecDSigBatchDigestCallback:
+ * @context:            the callback context (#xmlSecDSigCtx.batchDigestCtx).
+ * @digestId:           the digest method klass (e.g. #xmlSecTransformSha256Id).
+ * @inputs:             the array of @size data buffers to digest.
+ * @outputs:            the array of @size buffers for the binary digests.
+ * @size:               the number of elements in @inputs and @outputs.
+ *
+ * The application supplied batch digest function for &lt;dsig:SignedInfo/&gt;
+ * references: calculates the @digestId digests of all the @inputs at once
+ * (e.g. with a multi-buffer SHA implementation) and writes them into @outputs.
+ *
+ * Returns: 0 on success, 1 if @digestId is not supported (xmlsec calculates
+ * the digests with @digestId transform) or a negative value if an error occurs.
+ */
+typedef int             (*xmlSecDSigBatchDigestCallback)        (void* context,
+                                                                 xmlSecTransformId digestId,
+                                                                 xmlSecBufferPtr* inputs,
+                                                                 xmlSecBufferPtr* outputs,
+                                                                 xmlSecSize size);
+
+/**
+ * xmlSecDSigCost:
+ * @references:                 the number of &lt;dsig:Reference/&gt; nodes in &lt;dsig:SignedInfo/&gt;.
+ * @sameDocumentReferences:     the references to the same document (the empty and "#..." URIs).
+ * @xpointerReferences:         the same document references with the "#xpointer(...)" URIs.
+ * @externalReferences:         the references to the local files, the remote URIs and
+ *                              the references without URI attribute.
+ * @transforms:                 the total number of the references transforms.
+ * @xpathTransforms:            the XPath, XPath Filter 2.0 and XPointer transforms.
+ * @xsltTransforms:             the XSLT transforms.
+ * @c14nTransforms:             the canonicalization transforms.
+ * @nodes:                      the estimated number of the nodes (elements, attributes,
+ *                              text and comments) in the same document references data.
+ * @bytes:                      the estimated size of the names and the text in these nodes.
+ * @retrievalMethods:           the number of &lt;dsig:RetrievalMethod/&gt; nodes in &lt;dsig:KeyInfo/&gt;.
+ * @encryptedKeys:              the number of &lt;enc:EncryptedKey/&gt; nodes in &lt;dsig:KeyInfo/&gt;.
+ * @encryptedKeysDepth:         the max nesting level of the &lt;enc:EncryptedKey/&gt; nodes.
+ *
+ * The &lt;dsig:Signature/&gt; processing cost estimated by #xmlSecDSigEstimateCost
+ * from the signature nodes only (before any c14n or crypto operation). The same
+ * structure is used for the #xmlSecDSigCtx.maxCost limits (0 means no limit).
+ * The references to an element are estimated with the element subtree and
+ * the "#xpointer(...)" references other than "#xpointer(id(...))" with the
+ * whole document.
+ */
+typedef struct _xmlSecDSigCost {
+    xmlSecSize                  references;
+    xmlSecSize                  sameDocumentReferences;
+    xmlSecSize                  xpointerReferences;
+    xmlSecSize                  externalReferences;
+    xmlSecSize                  transforms;
+    xmlSecSize                  xpathTransforms;
+    xmlSecSize                  xsltTransforms;
+    xmlSecSize                  c14nTransforms;
+    xmlSecSize                  nodes;
+    xmlSecSize                  bytes;
+    xmlSecSize                  retrievalMethods;
+    xmlSecSize                  encryptedKeys;
+    xmlSecSize                  encryptedKeysDepth;
+} xmlSecDSigCost, *xmlSecDSigCostPtr;
+
+/**
+ * xmlSecDSigSlowOpRecord:
+ * @duration:                   the operation wall clock time (in seconds).
+ * @status:                     the signature status.
+ * @failureReason:              the failure reason.
+ * @cost:                       the signature cost (see #xmlSecDSigEstimateCost): the
+ *                              references count and the referenced nodes and bytes.
+ * @keyResolution:              the &lt;dsig:KeyInfo/&gt; children names and the resolved
+ *                              key data klass and name, e.g. "KeyName,X509Data -&gt; rsa \"key1\"".
+ * @caches:                     the caches hits and misses for each #xmlSecStatsCache during
+ *                              the operation on the current thread (all zeros if the statistics
+ *                              are disabled, see #xmlSecStatsEnable).
+ * @dump:                       the #xmlSecDSigCtxDebugDump output with the transforms chains
+ *                              and the per transform timings (zero terminated).
+ * @dumpSize:                   the @dump size.
+ *
+ * The diagnostic record for the signature verification that took longer
+ * than #xmlSecDSigCtx.slowOpThreshold. The record is valid only during
+ * the #xmlSecDSigSlowOpCallback call.
+ */
+typedef struct _xmlSecDSigSlowOpRecord {
+    double                      duration;
+    xmlSecDSigStatus            status;
+    xmlSecDSigFailureReason     failureReason;
+    xmlSecDSigCost              cost;
+    const xmlChar*              keyResolution;
+    xmlSecStatsCacheCounters    caches[XMLSEC_STATS_CACHES_SIZE];
+    const char*                 dump;
+    xmlSecSize                  dumpSize;
+} xmlSecDSigSlowOpRecord;
+
+/**
+ * xmlSecDSigSlowOpCallback:
+ * @dsigCtx:                    the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @record:                     the diagnostic record.
+ * @context:                    the callback context (#xmlSecDSigCtx.slowOpCallbackCtx).
+ *
+ * The callback called on the thread that runs the operation at the end of
+ * #xmlSecDSigCtxVerify if the verification took longer than
+ * #xmlSecDSigCtx.slowOpThreshold.
+ */
+typedef void            (*xmlSecDSigSlowOpCallback)             (xmlSecDSigCtxPtr dsigCtx,
+                                                                 const xmlSecDSigSlowOpRecord* record,
+                                                                 void* context);
+
 /**
  * xmlSecDSigCtx:
  * @userData:                   the pointer to user data (xmlsec and xmlsec-crypto libraries
@@ -127,6 +445,45 @@ typedef enum {
  * @defSignMethodId:            the default signing method klass.
  * @defC14NMethodId:            the default c14n method klass.
  * @defDigestMethodId:          the default digest method klass.
+ * @referencesExecutor:         the optional executor for &lt;dsig:SignedInfo/&gt; references
+ *                              digesting; if set then the references transforms are
+ *                              executed by this callback (e.g. in parallel) instead of
+ *                              sequentially. The document is only read while the callback
+ *                              runs, all the references must be independent of each other
+ *                              (i.e. no reference digests another reference
+ *                              &lt;dsig:DigestValue/&gt; node) and all the transforms,
+ *                              URI handlers and crypto backend in use must be thread-safe.
+ * @referencesExecutorCtx:      the context passed to @referencesExecutor.
+ * @digestCache:                the optional cache of the external references and the pinned
+ *                              subtrees digests (not owned by the context, see
+ *                              #xmlSecDSigDigestCacheCreate).
+ * @verifyCache:                the optional cache of the signatures verification results
+ *                              (not owned by the context, see #xmlSecDSigVerifyCacheCreate).
+ * @batchDigestCallback:        the optional batch digest function for &lt;dsig:SignedInfo/&gt;
+ *                              references; if set then the references transforms are
+ *                              executed first and all the digests of the same method are
+ *                              calculated with one call (@referencesExecutor and
+ *                              @digestCache are not used for these references).
+ * @batchDigestCtx:             the context passed to @batchDigestCallback.
+ * @preDataSink:                the optional sink for the pre-digest and pre-sign data;
+ *                              if set then the data selected by
+ *                              #XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES,
+ *                              #XMLSEC_DSIG_FLAGS_STORE_MANIFEST_REFERENCES and
+ *                              #XMLSEC_DSIG_FLAGS_STORE_SIGNATURE flags is passed
+ *                              to this callback instead of being stored in memory.
+ * @preDataSinkCtx:             the context passed to @preDataSink.
+ * @maxCost:                    the optional limits (not owned by the context): if set then
+ *                              #xmlSecDSigCtxVerify estimates the signature cost first
+ *                              (see #xmlSecDSigEstimateCost) and fails with the
+ *                              #xmlSecDSigFailureReasonCostLimit failure reason if any
+ *                              of the non-zero limits is exceeded.
+ * @slowOpThreshold:            the verification time (in seconds) above which the
+ *                              @slowOpCallback is called (0 disables the sampler); if set
+ *                              then the transforms statistics are collected (see
+ *                              #XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) and the diagnostic
+ *                              record is only created for the slow operations.
+ * @slowOpCallback:             the callback for the slow verifications.
+ * @slowOpCallbackCtx:          the context passed to @slowOpCallback.
  * @signKey:                    the signature key; application may set #signKey
  *                              before calling #xmlSecDSigCtxSign or #xmlSecDSigCtxVerify
  *                              functions.
@@ -142,6 +499,15 @@ typedef enum {
  * @id:                         the pointer to Id attribute of &lt;dsig:Signature/&gt; node.
  * @signedInfoReferences:       the list of references in &lt;dsig:SignedInfo/&gt; node.
  * @manifestReferences:         the list of references in &lt;dsig:Manifest/&gt; nodes.
+ * @arena:                      the arena for the transforms (created on first use if
+ *                              #XMLSEC_DSIG_FLAGS_USE_ARENA flag is set).
+ * @sharedRefs:                 the signatures sharing the references data (set only
+ *                              while #xmlSecDSigCtxSignMultiple is running).
+ * @dirtyNodes:                 the nodes changed since the previous signature (set only
+ *                              while #xmlSecDSigCtxSignIncremental is running).
+ * @memStats:                   the memory usage (if #XMLSEC_DSIG_FLAGS_COLLECT_MEM_STATS
+ *                              flag is set); the application can set the memory limit
+ *                              before performing the operation.
  * @reserved0:                  reserved for the future.
  * @reserved1:                  reserved for the future.
  *
@@ -161,6 +527,18 @@ struct _xmlSecDSigCtx {
     xmlSecTransformId           defSignMethodId;
     xmlSecTransformId           defC14NMethodId;
     xmlSecTransformId           defDigestMethodId;
+    xmlSecDSigReferencesExecutor referencesExecutor;
+    void*                       referencesExecutorCtx;
+    xmlSecDSigDigestCachePtr    digestCache;
+    xmlSecDSigVerifyCachePtr    verifyCache;
+    xmlSecDSigBatchDigestCallback batchDigestCallback;
+    void*                       batchDigestCtx;
+    xmlSecDSigPreDataSink       preDataSink;
+    void*                       preDataSinkCtx;
+    xmlSecDSigCostPtr           maxCost;
+    double                      slowOpThreshold;
+    xmlSecDSigSlowOpCallback    slowOpCallback;
+    void*                       slowOpCallbackCtx;
 
     /* these data are returned */
     xmlSecKeyPtr                signKey;
@@ -175,6 +553,10 @@ struct _xmlSecDSigCtx {
     xmlChar*                    id;
     xmlSecPtrList               signedInfoReferences;
     xmlSecPtrList               manifestReferences;
+    struct _xmlSecArena*        arena;
+    struct _xmlSecDSigSharedRefs* sharedRefs;
+    struct _xmlSecDSigDirtyNodes* dirtyNodes;
+    xmlSecMemStats              memStats;
 
     /* reserved for future */
     void*                       reserved0;
@@ -187,24 +569,188 @@ XMLSEC_EXPORT void              xmlSecDSigCtxDestroy            (xmlSecDSigCtxPt
 XMLSEC_EXPORT int               xmlSecDSigCtxInitialize         (xmlSecDSigCtxPtr dsigCtx,
                                                                  xmlSecKeysMngrPtr keysMngr);
 XMLSEC_EXPORT void              xmlSecDSigCtxFinalize           (xmlSecDSigCtxPtr dsigCtx);
+XMLSEC_EXPORT void              xmlSecDSigCtxReset              (xmlSecDSigCtxPtr dsigCtx);
 XMLSEC_EXPORT int               xmlSecDSigCtxSign               (xmlSecDSigCtxPtr dsigCtx,
                                                                  xmlNodePtr tmpl);
+XMLSEC_EXPORT int               xmlSecDSigCtxSignMultiple       (xmlSecDSigCtxPtr* dsigCtxs,
+                                                                 xmlNodePtr* tmpls,
+                                                                 xmlSecSize size);
+XMLSEC_EXPORT int               xmlSecDSigCtxSignToOutput       (xmlSecDSigCtxPtr dsigCtx,
+                                                                 xmlNodePtr tmpl,
+                                                                 xmlOutputBufferPtr out);
+XMLSEC_EXPORT int               xmlSecDSigCtxSignFile           (xmlSecDSigCtxPtr dsigCtx,
+                                                                 const char* filename,
+                                                                 xmlNodePtr tmpl,
+                                                                 xmlOutputBufferPtr out);
+XMLSEC_EXPORT int               xmlSecDSigCtxSignIncremental    (xmlSecDSigCtxPtr dsigCtx,
+                                                                 xmlNodePtr node,
+                                                                 xmlNodePtr* dirtyNodes,
+                                                                 xmlSecSize dirtyNodesSize);
+XMLSEC_EXPORT int               xmlSecDSigCtxSignPrepare        (xmlSecDSigCtxPtr dsigCtx,
+                                                                 xmlNodePtr tmpl);
+XMLSEC_EXPORT int               xmlSecDSigCtxSignComplete       (xmlSecDSigCtxPtr dsigCtx);
 XMLSEC_EXPORT int               xmlSecDSigCtxVerify             (xmlSecDSigCtxPtr dsigCtx,
                                                                  xmlNodePtr node);
+XMLSEC_EXPORT int               xmlSecDSigCtxVerifyFile         (xmlSecDSigCtxPtr dsigCtx,
+                                                                 const char* filename,
+                                                                 xmlDocPtr* signatureDoc);
+XMLSEC_EXPORT int               xmlSecDSigCtxVerifyManifestReferences(xmlSecDSigCtxPtr dsigCtx);
 XMLSEC_EXPORT int               xmlSecDSigCtxEnableReferenceTransform(xmlSecDSigCtxPtr dsigCtx,
                                                                 xmlSecTransformId transformId);
 XMLSEC_EXPORT int               xmlSecDSigCtxEnableSignatureTransform(xmlSecDSigCtxPtr dsigCtx,
                                                                 xmlSecTransformId transformId);
 XMLSEC_EXPORT xmlSecBufferPtr   xmlSecDSigCtxGetPreSignBuffer   (xmlSecDSigCtxPtr dsigCtx);
+XMLSEC_EXPORT int               xmlSecDSigCtxSetDeadline        (xmlSecDSigCtxPtr dsigCtx,
+                                                                 double timeout,
+                                                                 volatile int* cancelFlag);
+XMLSEC_EXPORT int               xmlSecDSigEstimateCost          (xmlNodePtr node,
+                                                                 xmlSecDSigCostPtr cost);
+XMLSEC_EXPORT int               xmlSecDSigCostCheckLimits       (const xmlSecDSigCost* cost,
+                                                                 const xmlSecDSigCost* maxCost);
 XMLSEC_EXPORT void              xmlSecDSigCtxDebugDump          (xmlSecDSigCtxPtr dsigCtx,
                                                                  FILE* output);
 XMLSEC_EXPORT void              xmlSecDSigCtxDebugXmlDump       (xmlSecDSigCtxPtr dsigCtx,
                                                                  FILE* output);
 
 
+/**
+ * xmlSecDSigCtxPool:
+ * @keysMngr:                   the keys manager for the new contexts.
+ * @ctxs:                       the list of the available contexts.
+ * @maxSize:                    the max number of the available contexts kept by the pool.
+ *
+ * The pool of reusable &lt;dsig:Signature/&gt; processing contexts. The pool
+ * is not locked: the application should use one pool per thread.
+ */
+typedef struct _xmlSecDSigCtxPool {
+    xmlSecKeysMngrPtr           keysMngr;
+    xmlSecPtrList               ctxs;
+    xmlSecSize                  maxSize;
+} xmlSecDSigCtxPool, *xmlSecDSigCtxPoolPtr;
+
+XMLSEC_EXPORT xmlSecDSigCtxPoolPtr xmlSecDSigCtxPoolCreate      (xmlSecKeysMngrPtr keysMngr,
+                                                                 xmlSecSize maxSize);
+XMLSEC_EXPORT void              xmlSecDSigCtxPoolDestroy        (xmlSecDSigCtxPoolPtr pool);
+XMLSEC_EXPORT xmlSecDSigCtxPtr  xmlSecDSigCtxPoolAcquire        (xmlSecDSigCtxPoolPtr pool);
+XMLSEC_EXPORT void              xmlSecDSigCtxPoolRelease        (xmlSecDSigCtxPoolPtr pool,
+                                                                 xmlSecDSigCtxPtr dsigCtx);
+
+XMLSEC_EXPORT xmlSecDSigTemplatePtr xmlSecDSigTemplateCreate     (xmlSecDSigCtxPtr dsigCtx,
+                                                                 xmlNodePtr tmpl);
+XMLSEC_EXPORT void              xmlSecDSigTemplateDestroy       (xmlSecDSigTemplatePtr dsigTmpl);
+XMLSEC_EXPORT xmlNodePtr        xmlSecDSigTemplateInstantiate   (xmlSecDSigTemplatePtr dsigTmpl,
+                                                                 xmlDocPtr doc,
+                                                                 const xmlChar** uris,
+                                                                 xmlSecSize urisSize);
+
+XMLSEC_EXPORT xmlSecDSigDigestCachePtr xmlSecDSigDigestCacheCreate(xmlSecSize maxSize);
+XMLSEC_EXPORT void              xmlSecDSigDigestCacheDestroy    (xmlSecDSigDigestCachePtr cache);
+XMLSEC_EXPORT void              xmlSecDSigDigestCacheSetValidator(xmlSecDSigDigestCachePtr cache,
+                                                                 xmlSecDSigDigestCacheValidator validator,
+                                                                 void* context);
+XMLSEC_EXPORT int               xmlSecDSigDigestCacheFileValidator(void* context,
+                                                                 const xmlChar* uri,
+                                                                 xmlSecBufferPtr validator);
+XMLSEC_EXPORT void              xmlSecDSigDigestCacheSetNodeValidator(xmlSecDSigDigestCachePtr cache,
+                                                                 xmlSecDSigDigestCacheNodeValidator validator,
+                                                                 void* context);
+
+XMLSEC_EXPORT xmlSecDSigVerifyCachePtr xmlSecDSigVerifyCacheCreate(xmlSecSize maxSize);
+XMLSEC_EXPORT void              xmlSecDSigVerifyCacheDestroy    (xmlSecDSigVerifyCachePtr cache);
+
+XMLSEC_EXPORT int               xmlSecDSigReferencesExecutorRun (void* executorCtx,
+                                                                 xmlSecDSigReferenceExecuteTask task,
+                                                                 xmlSecDSigReferenceCtxPtr* dsigRefCtxs,
+                                                                 xmlSecSize size);
 XMLSEC_EXPORT const char*       xmlSecDSigCtxGetStatusString    (xmlSecDSigStatus status);
 XMLSEC_EXPORT const char*       xmlSecDSigCtxGetFailureReasonString(xmlSecDSigFailureReason failureReason);
 
+/**
+ * xmlSecDSigBatchTask:
+ * @taskCtx:            the xmlsec batch context.
+ * @worker:             the worker index (from 0 to workersNum - 1).
+ *
+ * The xmlsec function that verifies the share of the batch assigned
+ * to the @worker. Tasks for different workers can be run concurrently.
+ */
+typedef void            (*xmlSecDSigBatchTask)                  (void* taskCtx,
+                                                                 xmlSecSize worker);
+
+/**
+ * xmlSecDSigBatchExecutor:
+ * @executorCtx:        the application executor context.
+ * @task:               the task to run for each worker.
+ * @taskCtx:            the context to pass to @task.
+ * @workersNum:         the number of workers.
+ *
+ * The application supplied executor for #xmlSecDSigVerifyBatch and
+ * #xmlSecDSigVerifyAll functions.
+ * The executor must call @task once for each worker index from 0 to
+ * @workersNum - 1 (e.g. each on its own thread from a thread pool) and
+ * return only after all the tasks have completed.
+ * The #xmlSecExecutorRunWorkers function with a #xmlSecExecutor as
+ * @executorCtx can be used as the executor.
+ *
+ * Returns: 0 on success or a negative value if the tasks could not be run.
+ */
+typedef int             (*xmlSecDSigBatchExecutor)              (void* executorCtx,
+                                                                 xmlSecDSigBatchTask task,
+                                                                 void* taskCtx,
+                                                                 xmlSecSize workersNum);
+
+XMLSEC_EXPORT int               xmlSecDSigVerifyBatch           (xmlSecKeysMngrPtr keysMngr,
+                                                                 xmlNodePtr* nodes,
+                                                                 xmlSecDSigStatus* statuses,
+                                                                 xmlSecSize size,
+                                                                 xmlSecSize workersNum,
+                                                                 xmlSecDSigBatchExecutor executor,
+                                                                 void* executorCtx);
+XMLSEC_EXPORT int               xmlSecDSigVerifyAll             (xmlSecKeysMngrPtr keysMngr,
+                                                                 xmlDocPtr doc,
+                                                                 xmlNodePtr** nodes,
+                                                                 xmlSecDSigStatus** statuses,
+                                                                 xmlSecSize* size,
+                                                                 xmlSecSize workersNum,
+                                                                 xmlSecDSigBatchExecutor executor,
+                                                                 void* executorCtx);
+
+/**
+ * xmlSecDSigBatchVerifyCallback:
+ * @context:            the callback context.
+ * @signMethodId:       the signature method klass (e.g. #xmlSecTransformEcdsaSha256Id).
+ * @keys:               the array of @size verification keys.
+ * @signedInfos:        the array of @size canonicalized &lt;dsig:SignedInfo/&gt; elements.
+ * @signatureValues:    the array of @size decoded &lt;dsig:SignatureValue/&gt; contents.
+ * @results:            the array to return the @size verification results
+ *                      (1 if the signature is valid and 0 otherwise).
+ * @size:               the number of elements in the arrays.
+ *
+ * The application supplied function for #xmlSecDSigVerifyBatchEx that verifies
+ * the signatures of several documents with the same @signMethodId at once
+ * (e.g. with the Ed25519 batch verification or a multi-buffer EC implementation).
+ *
+ * Returns: 0 on success, 1 if @signMethodId is not supported (xmlsec verifies
+ * the signatures one by one with @signMethodId transform) or a negative value
+ * if an error occurs.
+ */
+typedef int             (*xmlSecDSigBatchVerifyCallback)        (void* context,
+                                                                 xmlSecTransformId signMethodId,
+                                                                 xmlSecKeyPtr* keys,
+                                                                 xmlSecBufferPtr* signedInfos,
+                                                                 xmlSecBufferPtr* signatureValues,
+                                                                 int* results,
+                                                                 xmlSecSize size);
+
+XMLSEC_EXPORT int               xmlSecDSigVerifyBatchEx         (xmlSecKeysMngrPtr keysMngr,
+                                                                 xmlNodePtr* nodes,
+                                                                 xmlSecDSigStatus* statuses,
+                                                                 xmlSecSize size,
+                                                                 xmlSecSize workersNum,
+                                                                 xmlSecDSigBatchExecutor executor,
+                                                                 void* executorCtx,
+                                                                 xmlSecDSigBatchVerifyCallback verifyCallback,
+                                                                 void* verifyCallbackCtx);
+
 
 /**************************************************************************
  *
@@ -241,6 +787,7 @@ typedef enum  {
  * @id:                         the &lt;dsig:Reference/&gt; node ID attribute.
  * @uri:                        the &lt;dsig:Reference/&gt; node URI attribute.
  * @type:                       the &lt;dsig:Reference/&gt; node Type attribute.
+ * @digestValueNode:            the pointer to &lt;dsig:DigestValue/&gt; node.
  * @reserved0:                  reserved for the future.
  * @reserved1:                  reserved for the future.
  *
@@ -259,6 +806,7 @@ struct _xmlSecDSigReferenceCtx {
     xmlChar*                    id;
     xmlChar*                    uri;
     xmlChar*                    type;
+    xmlNodePtr                  digestValueNode;
 
      /* reserved for future */
     void*                       reserved0;
@@ -274,6 +822,7 @@ XMLSEC_EXPORT int               xmlSecDSigReferenceCtxInitialize(xmlSecDSigRefer
 XMLSEC_EXPORT void              xmlSecDSigReferenceCtxFinalize  (xmlSecDSigReferenceCtxPtr dsigRefCtx);
 XMLSEC_EXPORT int               xmlSecDSigReferenceCtxProcessNode(xmlSecDSigReferenceCtxPtr dsigRefCtx,
                                                                   xmlNodePtr node);
+XMLSEC_EXPORT int               xmlSecDSigReferenceCtxVerify    (xmlSecDSigReferenceCtxPtr dsigRefCtx);
 XMLSEC_EXPORT xmlSecBufferPtr   xmlSecDSigReferenceCtxGetPreDigestBuffer
                                                                 (xmlSecDSigReferenceCtxPtr dsigRefCtx);
 XMLSEC_EXPORT void              xmlSecDSigReferenceCtxDebugDump (xmlSecDSigReferenceCtxPtr dsigRefCtx,
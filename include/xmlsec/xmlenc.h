@@ -25,6 +25,7 @@
 #include <xmlsec/keys.h>
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/keyinfo.h>
+#include <xmlsec/memstats.h>
 #include <xmlsec/transforms.h>
 
 #ifdef __cplusplus
@@ -48,6 +49,8 @@ typedef enum {
  * xmlSecEncFailureReason:
  * @xmlSecEncFailureReasonUnknown:            the failure reason is unknown.
  * @xmlSecEncFailureReasonKeyNotFound:        the key not found.
+ * @xmlSecEncFailureReasonDeadline:           the processing is stopped by the deadline
+ *                                            or cancelled (see #xmlSecEncCtxSetDeadline).
  *
  * XML Encryption processing failure reason. The application should use
  * the returned value from the encrypt/decrypt functions first.
@@ -55,6 +58,7 @@ typedef enum {
 typedef enum {
     xmlSecEncFailureReasonUnknown = 0,
     xmlSecEncFailureReasonKeyNotFound,
+    xmlSecEncFailureReasonDeadline,
 } xmlSecEncFailureReason;
 
 /**
@@ -64,6 +68,55 @@ typedef enum {
  */
 #define XMLSEC_ENC_RETURN_REPLACED_NODE                 0x00000001
 
+/**
+ * XMLSEC_ENC_STREAM_DECRYPTED_XML:
+ *
+ * If this flag is set, then #xmlSecEncCtxDecrypt parses the decrypted
+ * &lt;enc:EncryptedData/&gt; node data of Element or Content type as it
+ * is produced by the decryption instead of collecting all the data in
+ * the #result buffer first (the #result buffer stays empty in this case).
+ */
+#define XMLSEC_ENC_STREAM_DECRYPTED_XML                 0x00000002
+
+/**
+ * XMLSEC_ENC_COLLECT_MEM_STATS:
+ *
+ * If this flag is set (or the #xmlSecEncCtx.memStats limit is set) then
+ * the memory allocated by xmlsec during the encryption or decryption is
+ * counted in #xmlSecEncCtx.memStats. The counters are reset by
+ * #xmlSecEncCtxReset.
+ */
+#define XMLSEC_ENC_COLLECT_MEM_STATS                    0x00000004
+
+/**
+ * XMLSEC_ENC_COMPRESS_DEFLATE:
+ *
+ * If this flag is set, then the &lt;enc:EncryptedData/&gt; data are compressed
+ * with the deflate transform (#xmlSecTransformDeflateId) before the encryption
+ * and decompressed after the decryption. The decompressed data size is limited
+ * by #xmlSecEncCtx.maxDecompressedSize. The compression is not defined by the
+ * XML Encryption specification: both sides should set this flag.
+ */
+#define XMLSEC_ENC_COMPRESS_DEFLATE                     0x00000008
+
+/**
+ * XMLSEC_ENC_SKIP_PREFETCH:
+ *
+ * If this flag is set, then #xmlSecEncCtxDecrypt does not pass the
+ * &lt;enc:CipherReference/&gt; URIs to the I/O prefetch callback (e.g.
+ * the application already called #xmlSecEncCtxPrefetchCipherReferences
+ * for the whole document).
+ */
+#define XMLSEC_ENC_SKIP_PREFETCH                        0x00000010
+
+/**
+ * XMLSEC_ENC_KEEP_KEYINFO:
+ *
+ * If this flag is set, then the &lt;enc:KeyInfo/&gt; node is not updated
+ * after the encryption (e.g. it is already written by #xmlSecEncTemplateCreate).
+ */
+#define XMLSEC_ENC_KEEP_KEYINFO                         0x00000020
+
 /**
  * xmlSecEncCtx:
  * @userData:                   the pointer to user data (xmlsec and xmlsec-crypto libraries
@@ -79,7 +132,9 @@ typedef enum {
  * @encKey:                     the signature key; application may set #encKey
  *                              before calling encryption/decryption functions.
  * @operation:                  the operation: encrypt or decrypt.
- * @result:                     the pointer to signature (not valid for signature verification).
+ * @result:                     the pointer to signature (not valid for signature verification);
+ *                              the encrypted data written to &lt;enc:CipherValue/&gt; node
+ *                              is moved into the node and the buffer is left empty.
  * @resultBase64Encoded:        the flag: if set then result in #result is base64 encoded.
  * @resultReplaced:             the flag: if set then resulted &lt;enc:EncryptedData/&gt;
  *                              or &lt;enc:EncryptedKey/&gt; node is added to the document.
@@ -101,6 +156,15 @@ typedef enum {
  * @failureReason:              the detailed failure reason.
  * @keyInfoNode:                the pointer to &lt;enc:KeyInfo/&gt; node.
  * @cipherValueNode:            the pointer to &lt;enc:CipherValue/&gt; node.
+ * @sessionKeyId:               the id of the generated session key in the keys manager
+ *                              cache (see #xmlSecKeysMngrEnableSessionKeyReuse).
+ * @sessionKeyReused:           the flag: if set then the session key and the
+ *                              &lt;enc:KeyInfo/&gt; node are taken from the cache.
+ * @memStats:                   the memory usage (if #XMLSEC_ENC_COLLECT_MEM_STATS
+ *                              flag is set); the application can set the memory limit
+ *                              before performing the operation.
+ * @maxDecompressedSize:        the max decompressed data size if #XMLSEC_ENC_COMPRESS_DEFLATE
+ *                              flag is set (0 for #XMLSEC_TRANSFORM_DEFLATE_DEFAULT_MAX_OUTPUT_SIZE).
  * @reserved1:                  reserved for the future.
  *
  * XML Encryption context.
@@ -140,9 +204,60 @@ struct _xmlSecEncCtx {
     xmlNodePtr                  cipherValueNode;
 
     xmlNodePtr                  replacedNodeList; /* the pointer to the replaced node */
+    xmlSecBufferPtr             sessionKeyId;
+    int                         sessionKeyReused;
+    xmlSecMemStats              memStats;
+    xmlSecSize                  maxDecompressedSize;
     void*                       reserved1;        /* reserved for future */
 };
 
+/**
+ * xmlSecEncCtxDecryptSinkCallback:
+ * @sinkCtx:            the sink context passed to #xmlSecEncCtxDecryptToSink.
+ * @data:               the decrypted data chunk.
+ * @dataSize:           the decrypted data chunk size.
+ *
+ * The callback called by #xmlSecEncCtxDecryptToSink for each decrypted data chunk.
+ *
+ * Returns: 0 on success and a negative value otherwise (in this case,
+ * the decryption stops).
+ */
+typedef int             (*xmlSecEncCtxDecryptSinkCallback)      (void* sinkCtx,
+                                                                 const xmlSecByte* data,
+                                                                 xmlSecSize dataSize);
+
+/**
+ * xmlSecEncBatchTask:
+ * @taskCtx:            the xmlsec batch context.
+ * @worker:             the worker index (from 0 to workersNum - 1).
+ *
+ * The xmlsec function that decrypts the share of the batch assigned
+ * to the @worker. Tasks for different workers can be run concurrently.
+ */
+typedef void            (*xmlSecEncBatchTask)                   (void* taskCtx,
+                                                                 xmlSecSize worker);
+
+/**
+ * xmlSecEncBatchExecutor:
+ * @executorCtx:        the application executor context.
+ * @task:               the task to run for each worker.
+ * @taskCtx:            the context to pass to @task.
+ * @workersNum:         the number of workers.
+ *
+ * The application supplied executor for #xmlSecEncCtxDecryptMultiple function.
+ * The executor must call @task once for each worker index from 0 to
+ * @workersNum - 1 (e.g. each on its own thread from a thread pool) and
+ * return only after all the tasks have completed.
+ * The #xmlSecExecutorRunWorkers function with a #xmlSecExecutor as
+ * @executorCtx can be used as the executor.
+ *
+ * Returns: 0 on success or a negative value if the tasks could not be run.
+ */
+typedef int             (*xmlSecEncBatchExecutor)               (void* executorCtx,
+                                                                 xmlSecEncBatchTask task,
+                                                                 void* taskCtx,
+                                                                 xmlSecSize workersNum);
+
 XMLSEC_EXPORT xmlSecEncCtxPtr   xmlSecEncCtxCreate              (xmlSecKeysMngrPtr keysMngr);
 XMLSEC_EXPORT void              xmlSecEncCtxDestroy             (xmlSecEncCtxPtr encCtx);
 XMLSEC_EXPORT int               xmlSecEncCtxInitialize          (xmlSecEncCtxPtr encCtx,
@@ -158,13 +273,36 @@ XMLSEC_EXPORT int               xmlSecEncCtxBinaryEncrypt       (xmlSecEncCtxPtr
 XMLSEC_EXPORT int               xmlSecEncCtxXmlEncrypt          (xmlSecEncCtxPtr encCtx,
                                                                  xmlNodePtr tmpl,
                                                                  xmlNodePtr node);
+XMLSEC_EXPORT int               xmlSecEncCtxXmlEncryptMultiple  (xmlSecEncCtxPtr encCtx,
+                                                                 xmlNodePtr encKeyTmpl,
+                                                                 xmlNodePtr* tmpls,
+                                                                 xmlNodePtr* nodes,
+                                                                 xmlSecSize nodesSize);
 XMLSEC_EXPORT int               xmlSecEncCtxUriEncrypt          (xmlSecEncCtxPtr encCtx,
                                                                  xmlNodePtr tmpl,
                                                                  const xmlChar *uri);
+XMLSEC_EXPORT int               xmlSecEncCtxUriEncryptToOutput  (xmlSecEncCtxPtr encCtx,
+                                                                 xmlNodePtr tmpl,
+                                                                 const xmlChar *uri,
+                                                                 xmlOutputBufferPtr output);
 XMLSEC_EXPORT int               xmlSecEncCtxDecrypt             (xmlSecEncCtxPtr encCtx,
                                                                  xmlNodePtr node);
 XMLSEC_EXPORT xmlSecBufferPtr   xmlSecEncCtxDecryptToBuffer     (xmlSecEncCtxPtr encCtx,
                                                                  xmlNodePtr node);
+XMLSEC_EXPORT int               xmlSecEncCtxDecryptToSink       (xmlSecEncCtxPtr encCtx,
+                                                                 xmlNodePtr node,
+                                                                 xmlSecEncCtxDecryptSinkCallback sink,
+                                                                 void* sinkCtx);
+XMLSEC_EXPORT int               xmlSecEncCtxDecryptMultiple     (xmlSecEncCtxPtr encCtx,
+                                                                 xmlNodePtr root,
+                                                                 xmlSecSize workersNum,
+                                                                 xmlSecEncBatchExecutor executor,
+                                                                 void* executorCtx);
+XMLSEC_EXPORT int               xmlSecEncCtxSetDeadline         (xmlSecEncCtxPtr encCtx,
+                                                                 double timeout,
+                                                                 volatile int* cancelFlag);
+XMLSEC_EXPORT int               xmlSecEncCtxPrefetchCipherReferences(xmlSecEncCtxPtr encCtx,
+                                                                 xmlNodePtr node);
 XMLSEC_EXPORT void              xmlSecEncCtxDebugDump           (xmlSecEncCtxPtr encCtx,
                                                                  FILE* output);
 XMLSEC_EXPORT void              xmlSecEncCtxDebugXmlDump        (xmlSecEncCtxPtr encCtx,
@@ -187,6 +325,50 @@ XMLSEC_EXPORT int               xmlSecEncCtxAgreementMethodXmlWrite(xmlSecEncCtx
 
 XMLSEC_EXPORT const char*       xmlSecEncCtxGetFailureReasonString(xmlSecEncFailureReason failureReason);
 
+/**
+ * xmlSecEncCtxPool:
+ * @keysMngr:                   the keys manager for the new contexts.
+ * @ctxs:                       the list of the available contexts.
+ * @maxSize:                    the max number of the available contexts kept by the pool.
+ *
+ * The pool of reusable &lt;enc:EncryptedData/&gt; processing contexts. The pool
+ * is not locked: the application should use one pool per thread.
+ */
+typedef struct _xmlSecEncCtxPool {
+    xmlSecKeysMngrPtr           keysMngr;
+    xmlSecPtrList               ctxs;
+    xmlSecSize                  maxSize;
+} xmlSecEncCtxPool, *xmlSecEncCtxPoolPtr;
+
+XMLSEC_EXPORT xmlSecEncCtxPoolPtr xmlSecEncCtxPoolCreate        (xmlSecKeysMngrPtr keysMngr,
+                                                                 xmlSecSize maxSize);
+XMLSEC_EXPORT void              xmlSecEncCtxPoolDestroy         (xmlSecEncCtxPoolPtr pool);
+XMLSEC_EXPORT xmlSecEncCtxPtr   xmlSecEncCtxPoolAcquire         (xmlSecEncCtxPoolPtr pool);
+XMLSEC_EXPORT void              xmlSecEncCtxPoolRelease         (xmlSecEncCtxPoolPtr pool,
+                                                                 xmlSecEncCtxPtr encCtx);
+
+/**
+ * xmlSecEncTemplate:
+ *
+ * The prepared &lt;enc:EncryptedData/&gt; template with the recipients
+ * &lt;enc:EncryptedKey/&gt; nodes (see #xmlSecEncTemplateCreate).
+ */
+typedef struct _xmlSecEncTemplate                       xmlSecEncTemplate,
+                                                        *xmlSecEncTemplatePtr;
+
+XMLSEC_EXPORT xmlSecEncTemplatePtr xmlSecEncTemplateCreate      (xmlSecEncCtxPtr encCtx,
+                                                                 xmlNodePtr tmpl);
+XMLSEC_EXPORT void              xmlSecEncTemplateDestroy        (xmlSecEncTemplatePtr encTmpl);
+XMLSEC_EXPORT xmlSecSize        xmlSecEncTemplateGetRecipientsSize(xmlSecEncTemplatePtr encTmpl);
+XMLSEC_EXPORT xmlNodePtr        xmlSecEncTemplateBinaryEncrypt  (xmlSecEncTemplatePtr encTmpl,
+                                                                 xmlSecEncCtxPtr encCtx,
+                                                                 xmlDocPtr doc,
+                                                                 const xmlSecByte* data,
+                                                                 xmlSecSize dataSize);
+XMLSEC_EXPORT int               xmlSecEncTemplateXmlEncrypt     (xmlSecEncTemplatePtr encTmpl,
+                                                                 xmlSecEncCtxPtr encCtx,
+                                                                 xmlNodePtr node);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -37,6 +37,21 @@ extern "C" {
 #define xmlSecNodeGetName(node) \
     (((node)) ? ((const char*)((node)->name)) : NULL)
 
+/**
+ * xmlSecNodeContentCallback:
+ * @data:               the pointer to the content segment.
+ * @size:               the content segment size.
+ * @context:            the user data passed to #xmlSecNodeContentForEach.
+ *
+ * The callback called for each text segment of the node content
+ * (see #xmlSecNodeContentForEach).
+ *
+ * Returns: 0 on success or a negative value to stop the iteration.
+ */
+typedef int             (*xmlSecNodeContentCallback)    (const xmlChar* data,
+                                                         xmlSecSize size,
+                                                         void* context);
+
 XMLSEC_EXPORT const xmlChar*    xmlSecGetDefaultLineFeed(void);
 XMLSEC_EXPORT void        xmlSecSetDefaultLineFeed(const xmlChar *linefeed);
 
@@ -45,6 +60,9 @@ XMLSEC_EXPORT xmlChar*          xmlSecGetNodeContentAndTrim(const xmlNodePtr cur
 XMLSEC_EXPORT int               xmlSecGetNodeContentAsSize(const xmlNodePtr cur,
                                                          xmlSecSize defValue,
                                                          xmlSecSize* res);
+XMLSEC_EXPORT int               xmlSecNodeContentForEach(const xmlNodePtr node,
+                                                         xmlSecNodeContentCallback callback,
+                                                         void* context);
 XMLSEC_EXPORT int               xmlSecCheckNodeName     (const xmlNodePtr cur,
                                                          const xmlChar *name,
                                                          const xmlChar *ns);
@@ -99,9 +117,38 @@ XMLSEC_EXPORT int               xmlSecReplaceNodeBufferAndReturn
 XMLSEC_EXPORT int               xmlSecNodeEncodeAndSetContent
                                                         (xmlNodePtr node,
                                                          const xmlChar *buffer);
+XMLSEC_EXPORT int               xmlSecNodeAdoptContent  (xmlNodePtr node,
+                                                         xmlChar* content);
 XMLSEC_EXPORT void              xmlSecAddIDs            (xmlDocPtr doc,
                                                          xmlNodePtr cur,
                                                          const xmlChar** ids);
+
+/**
+ * xmlSecIDAttrRule:
+ * @attrName:           the ID attribute name.
+ * @nodeName:           the element name (NULL matches any element).
+ * @nodeNsHref:         the element namespace href (NULL matches any namespace,
+ *                      the elements without namespace always match).
+ *
+ * The ID attribute rule for #xmlSecAddIDAttrs.
+ */
+typedef struct _xmlSecIDAttrRule                        xmlSecIDAttrRule,
+                                                        *xmlSecIDAttrRulePtr;
+struct _xmlSecIDAttrRule {
+    const xmlChar*      attrName;
+    const xmlChar*      nodeName;
+    const xmlChar*      nodeNsHref;
+};
+
+XMLSEC_EXPORT int               xmlSecAddIDAttrs        (xmlDocPtr doc,
+                                                         xmlNodePtr cur,
+                                                         const xmlSecIDAttrRule* rules,
+                                                         xmlSecSize rulesSize);
+XMLSEC_EXPORT int               xmlSecAddDtdIDs         (xmlDocPtr doc,
+                                                         xmlNodePtr cur,
+                                                         const char* filename);
+XMLSEC_EXPORT int               xmlSecDtdIDsEnableCache (xmlSecSize maxSize);
+XMLSEC_EXPORT void              xmlSecDtdIDsDisableCache(void);
 XMLSEC_EXPORT xmlDocPtr         xmlSecCreateTree        (const xmlChar* rootNodeName,
                                                          const xmlChar* rootNodeNs);
 XMLSEC_EXPORT int               xmlSecIsEmptyNode       (xmlNodePtr node);
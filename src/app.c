@@ -36,6 +36,8 @@
 #include <xmlsec/private.h>
 #include <xmlsec/errors.h>
 
+#include "dl_helpers.h"
+
 /******************************************************************************
  *
  * Crypto Init/shutdown
@@ -50,12 +52,12 @@
  */
 int
 xmlSecCryptoInit(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoInit == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoInit == NULL) {
         xmlSecNotImplementedError("cryptoInit");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoInit());
+    return(xmlSecCryptoDLCurrentFunctions.cryptoInit());
 }
 
 /**
@@ -67,12 +69,12 @@ xmlSecCryptoInit(void) {
  */
 int
 xmlSecCryptoShutdown(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoShutdown == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoShutdown == NULL) {
         xmlSecNotImplementedError("cryptoShutdown");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoShutdown());
+    return(xmlSecCryptoDLCurrentFunctions.cryptoShutdown());
 }
 
 /**
@@ -85,12 +87,12 @@ xmlSecCryptoShutdown(void) {
  */
 int
 xmlSecCryptoKeysMngrInit(xmlSecKeysMngrPtr mngr) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoKeysMngrInit == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoKeysMngrInit == NULL) {
         xmlSecNotImplementedError("cryptoKeysMngrInit");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoKeysMngrInit(mngr));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoKeysMngrInit(mngr));
 }
 
 /******************************************************************************
@@ -109,12 +111,12 @@ xmlSecCryptoKeysMngrInit(xmlSecKeysMngrPtr mngr) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataAesGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataAesGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataAesGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataAesGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataAesGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataAesGetKlass());
 }
 
 /**
@@ -128,12 +130,12 @@ xmlSecKeyDataAesGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataConcatKdfGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataConcatKdfGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataConcatKdfGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataConcatKdfGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataConcatKdfGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataConcatKdfGetKlass());
 }
 
 /**
@@ -147,12 +149,12 @@ xmlSecKeyDataConcatKdfGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataDesGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataDesGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataDesGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataDesId");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataDesGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataDesGetKlass());
 }
 
 /**
@@ -166,12 +168,12 @@ xmlSecKeyDataDesGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataDhGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataDhGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataDhGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataDhGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataDhGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataDhGetKlass());
 }
 
 /**
@@ -185,12 +187,12 @@ xmlSecKeyDataDhGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataDsaGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataDsaGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataDsaGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataDsaGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataDsaGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataDsaGetKlass());
 }
 
 
@@ -205,12 +207,12 @@ xmlSecKeyDataDsaGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSeckeyDataEcGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataEcGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataEcGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataEcGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataEcGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataEcGetKlass());
 }
 
 
@@ -225,12 +227,12 @@ xmlSeckeyDataEcGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataEcGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataEcGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataEcGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataEcGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataEcGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataEcGetKlass());
 }
 
 /**
@@ -244,12 +246,12 @@ xmlSecKeyDataEcGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataGost2001GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataGost2001GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataGost2001GetKlass == NULL) {
         xmlSecNotImplementedError("keyDataGost2001GetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataGost2001GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataGost2001GetKlass());
 }
 
 /**
@@ -263,12 +265,12 @@ xmlSecKeyDataGost2001GetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataGostR3410_2012_256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataGostR3410_2012_256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataGostR3410_2012_256GetKlass == NULL) {
         xmlSecNotImplementedError("keyDataGostR3410_2012_256GetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataGostR3410_2012_256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataGostR3410_2012_256GetKlass());
 }
 
 /**
@@ -282,12 +284,12 @@ xmlSecKeyDataGostR3410_2012_256GetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataGostR3410_2012_512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataGostR3410_2012_512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataGostR3410_2012_512GetKlass == NULL) {
         xmlSecNotImplementedError("keyDataGostR3410_2012_512GetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataGostR3410_2012_512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataGostR3410_2012_512GetKlass());
 }
 
 /**
@@ -301,12 +303,12 @@ xmlSecKeyDataGostR3410_2012_512GetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataHmacGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataHmacGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataHmacGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataHmacGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataHmacGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataHmacGetKlass());
 }
 
 /**
@@ -320,12 +322,12 @@ xmlSecKeyDataHmacGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataPbkdf2GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataPbkdf2GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataPbkdf2GetKlass == NULL) {
         xmlSecNotImplementedError("keyDataPbkdf2GetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataPbkdf2GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataPbkdf2GetKlass());
 }
 /**
  * xmlSecKeyDataRsaGetKlass:
@@ -338,12 +340,12 @@ xmlSecKeyDataPbkdf2GetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataRsaGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataRsaGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataRsaGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataRsaGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataRsaGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataRsaGetKlass());
 }
 
 /**
@@ -357,12 +359,12 @@ xmlSecKeyDataRsaGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataX509GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataX509GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataX509GetKlass == NULL) {
         xmlSecNotImplementedError("keyDataX509GetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataX509GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataX509GetKlass());
 }
 
 /**
@@ -376,12 +378,12 @@ xmlSecKeyDataX509GetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataRawX509CertGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataRawX509CertGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataRawX509CertGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataRawX509CertGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataRawX509CertGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataRawX509CertGetKlass());
 }
 
 
@@ -396,12 +398,12 @@ xmlSecKeyDataRawX509CertGetKlass(void) {
  */
 xmlSecKeyDataId
 xmlSecKeyDataDEREncodedKeyValueGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->keyDataDEREncodedKeyValueGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.keyDataDEREncodedKeyValueGetKlass == NULL) {
         xmlSecNotImplementedError("keyDataDEREncodedKeyValueGetKlass");
         return(xmlSecKeyDataIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->keyDataDEREncodedKeyValueGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.keyDataDEREncodedKeyValueGetKlass());
 }
 /******************************************************************************
  *
@@ -419,12 +421,12 @@ xmlSecKeyDataDEREncodedKeyValueGetKlass(void) {
  */
 xmlSecKeyDataStoreId
 xmlSecX509StoreGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->x509StoreGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.x509StoreGetKlass == NULL) {
         xmlSecNotImplementedError("x509StoreGetKlass");
         return(xmlSecKeyStoreIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->x509StoreGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.x509StoreGetKlass());
 }
 
 /******************************************************************************
@@ -443,12 +445,12 @@ xmlSecX509StoreGetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformAes128CbcGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformAes128CbcGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformAes128CbcGetKlass == NULL) {
         xmlSecNotImplementedError("transformAes128CbcGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformAes128CbcGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformAes128CbcGetKlass());
 }
 
 /**
@@ -462,12 +464,12 @@ xmlSecTransformAes128CbcGetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformAes192CbcGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformAes192CbcGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformAes192CbcGetKlass == NULL) {
         xmlSecNotImplementedError("transformAes192CbcGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformAes192CbcGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformAes192CbcGetKlass());
 }
 
 /**
@@ -481,12 +483,12 @@ xmlSecTransformAes192CbcGetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformAes256CbcGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformAes256CbcGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformAes256CbcGetKlass == NULL) {
         xmlSecNotImplementedError("transformAes256CbcGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformAes256CbcGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformAes256CbcGetKlass());
 }
 
 /**
@@ -501,12 +503,12 @@ xmlSecTransformAes256CbcGetKlass(void) {
 xmlSecTransformId
 xmlSecTransformAes128GcmGetKlass(void)
 {
-    if ((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformAes128GcmGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformAes128GcmGetKlass == NULL) {
         xmlSecNotImplementedError("transformAes128GcmGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformAes128GcmGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformAes128GcmGetKlass());
 }
 
 /**
@@ -521,12 +523,12 @@ xmlSecTransformAes128GcmGetKlass(void)
 xmlSecTransformId
 xmlSecTransformAes192GcmGetKlass(void)
 {
-    if ((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformAes192GcmGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformAes192GcmGetKlass == NULL) {
         xmlSecNotImplementedError("transformAes192GcmGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformAes192GcmGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformAes192GcmGetKlass());
 }
 
 /**
@@ -541,12 +543,12 @@ xmlSecTransformAes192GcmGetKlass(void)
 xmlSecTransformId
 xmlSecTransformAes256GcmGetKlass(void)
 {
-    if ((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformAes256GcmGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformAes256GcmGetKlass == NULL) {
         xmlSecNotImplementedError("transformAes256GcmGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformAes256GcmGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformAes256GcmGetKlass());
 }
 
 /**
@@ -561,12 +563,12 @@ xmlSecTransformAes256GcmGetKlass(void)
 xmlSecTransformId
 xmlSecTransformConcatKdfGetKlass(void)
 {
-    if ((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformConcatKdfGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformConcatKdfGetKlass == NULL) {
         xmlSecNotImplementedError("transformConcatKdfGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformConcatKdfGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformConcatKdfGetKlass());
 }
 
 /**
@@ -580,12 +582,12 @@ xmlSecTransformConcatKdfGetKlass(void)
  */
 xmlSecTransformId
 xmlSecTransformKWAes128GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformKWAes128GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformKWAes128GetKlass == NULL) {
         xmlSecNotImplementedError("transformKWAes128GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformKWAes128GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformKWAes128GetKlass());
 }
 
 /**
@@ -599,12 +601,12 @@ xmlSecTransformKWAes128GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformKWAes192GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformKWAes192GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformKWAes192GetKlass == NULL) {
         xmlSecNotImplementedError("transformKWAes192GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformKWAes192GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformKWAes192GetKlass());
 }
 
 /**
@@ -618,12 +620,12 @@ xmlSecTransformKWAes192GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformKWAes256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformKWAes256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformKWAes256GetKlass == NULL) {
         xmlSecNotImplementedError("transformKWAes256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformKWAes256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformKWAes256GetKlass());
 }
 
 /**
@@ -637,12 +639,12 @@ xmlSecTransformKWAes256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformDes3CbcGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformDes3CbcGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformDes3CbcGetKlass == NULL) {
         xmlSecNotImplementedError("transformDes3CbcGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformDes3CbcGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformDes3CbcGetKlass());
 }
 
 /**
@@ -656,12 +658,12 @@ xmlSecTransformDes3CbcGetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformKWDes3GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformKWDes3GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformKWDes3GetKlass == NULL) {
         xmlSecNotImplementedError("transformKWDes3GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformKWDes3GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformKWDes3GetKlass());
 }
 
 /**
@@ -676,12 +678,12 @@ xmlSecTransformKWDes3GetKlass(void) {
 xmlSecTransformId
 xmlSecTransformDhEsGetKlass(void)
 {
-    if ((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformDhEsGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformDhEsGetKlass == NULL) {
         xmlSecNotImplementedError("transformDhEsGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformDhEsGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformDhEsGetKlass());
 }
 
 /**
@@ -695,12 +697,12 @@ xmlSecTransformDhEsGetKlass(void)
  */
 xmlSecTransformId
 xmlSecTransformDsaSha1GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformDsaSha1GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformDsaSha1GetKlass == NULL) {
         xmlSecNotImplementedError("transformDsaSha1GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformDsaSha1GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformDsaSha1GetKlass());
 }
 
 /**
@@ -714,12 +716,12 @@ xmlSecTransformDsaSha1GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformDsaSha256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformDsaSha256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformDsaSha256GetKlass == NULL) {
         xmlSecNotImplementedError("transformDsaSha256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformDsaSha256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformDsaSha256GetKlass());
 }
 
 /**
@@ -734,12 +736,12 @@ xmlSecTransformDsaSha256GetKlass(void) {
 xmlSecTransformId
 xmlSecTransformEcdhGetKlass(void)
 {
-    if ((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdhGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdhGetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdhGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdhGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdhGetKlass());
 }
 
 /**
@@ -753,12 +755,12 @@ xmlSecTransformEcdhGetKlass(void)
  */
 xmlSecTransformId
 xmlSecTransformEcdsaRipemd160GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaRipemd160GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaRipemd160GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaRipemd160GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaRipemd160GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaRipemd160GetKlass());
 }
 
 /**
@@ -772,12 +774,12 @@ xmlSecTransformEcdsaRipemd160GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha1GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha1GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha1GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha1GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha1GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha1GetKlass());
 }
 
 /**
@@ -791,12 +793,12 @@ xmlSecTransformEcdsaSha1GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha224GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha224GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha224GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha224GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha224GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha224GetKlass());
 }
 
 /**
@@ -810,12 +812,12 @@ xmlSecTransformEcdsaSha224GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha256GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha256GetKlass());
 }
 
 /**
@@ -829,12 +831,12 @@ xmlSecTransformEcdsaSha256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha384GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha384GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha384GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha384GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha384GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha384GetKlass());
 }
 
 /**
@@ -848,12 +850,12 @@ xmlSecTransformEcdsaSha384GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha512GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha512GetKlass());
 }
 
 
@@ -868,12 +870,12 @@ xmlSecTransformEcdsaSha512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha3_224GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha3_224GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha3_224GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha3_224GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha3_224GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha3_224GetKlass());
 }
 
 /**
@@ -887,12 +889,12 @@ xmlSecTransformEcdsaSha3_224GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha3_256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha3_256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha3_256GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha3_256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha3_256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha3_256GetKlass());
 }
 
 /**
@@ -906,12 +908,12 @@ xmlSecTransformEcdsaSha3_256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha3_384GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha3_384GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha3_384GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha3_384GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha3_384GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha3_384GetKlass());
 }
 
 /**
@@ -925,12 +927,12 @@ xmlSecTransformEcdsaSha3_384GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformEcdsaSha3_512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformEcdsaSha3_512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha3_512GetKlass == NULL) {
         xmlSecNotImplementedError("transformEcdsaSha3_512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformEcdsaSha3_512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformEcdsaSha3_512GetKlass());
 }
 
 /**
@@ -944,12 +946,12 @@ xmlSecTransformEcdsaSha3_512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformGost2001GostR3411_94GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformGost2001GostR3411_94GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformGost2001GostR3411_94GetKlass == NULL) {
         xmlSecNotImplementedError("transformGost2001GostR3411_94GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformGost2001GostR3411_94GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformGost2001GostR3411_94GetKlass());
 }
 
 /**
@@ -963,12 +965,12 @@ xmlSecTransformGost2001GostR3411_94GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformGostR3410_2012GostR3411_2012_256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformGostR3410_2012GostR3411_2012_256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformGostR3410_2012GostR3411_2012_256GetKlass == NULL) {
         xmlSecNotImplementedError("transformGostR3410_2012GostR3411_2012_256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformGostR3410_2012GostR3411_2012_256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformGostR3410_2012GostR3411_2012_256GetKlass());
 }
 
 /**
@@ -982,12 +984,12 @@ xmlSecTransformGostR3410_2012GostR3411_2012_256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformGostR3410_2012GostR3411_2012_512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformGostR3410_2012GostR3411_2012_512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformGostR3410_2012GostR3411_2012_512GetKlass == NULL) {
         xmlSecNotImplementedError("transformGostR3410_2012GostR3411_2012_512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformGostR3410_2012GostR3411_2012_512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformGostR3410_2012GostR3411_2012_512GetKlass());
 }
 
 /**
@@ -1001,12 +1003,12 @@ xmlSecTransformGostR3410_2012GostR3411_2012_512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformHmacMd5GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformHmacMd5GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformHmacMd5GetKlass == NULL) {
         xmlSecNotImplementedError("transformHmacMd5GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformHmacMd5GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformHmacMd5GetKlass());
 }
 
 /**
@@ -1020,12 +1022,12 @@ xmlSecTransformHmacMd5GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformHmacRipemd160GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformHmacRipemd160GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformHmacRipemd160GetKlass == NULL) {
         xmlSecNotImplementedError("transformHmacRipemd160GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformHmacRipemd160GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformHmacRipemd160GetKlass());
 }
 
 /**
@@ -1039,12 +1041,12 @@ xmlSecTransformHmacRipemd160GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformHmacSha1GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformHmacSha1GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformHmacSha1GetKlass == NULL) {
         xmlSecNotImplementedError("transformHmacSha1GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformHmacSha1GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformHmacSha1GetKlass());
 }
 
 /**
@@ -1058,12 +1060,12 @@ xmlSecTransformHmacSha1GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformHmacSha224GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformHmacSha224GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformHmacSha224GetKlass == NULL) {
         xmlSecNotImplementedError("transformHmacSha224GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformHmacSha224GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformHmacSha224GetKlass());
 }
 
 /**
@@ -1077,12 +1079,12 @@ xmlSecTransformHmacSha224GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformHmacSha256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformHmacSha256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformHmacSha256GetKlass == NULL) {
         xmlSecNotImplementedError("transformHmacSha256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformHmacSha256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformHmacSha256GetKlass());
 }
 
 /**
@@ -1096,12 +1098,12 @@ xmlSecTransformHmacSha256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformHmacSha384GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformHmacSha384GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformHmacSha384GetKlass == NULL) {
         xmlSecNotImplementedError("transformHmacSha384GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformHmacSha384GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformHmacSha384GetKlass());
 }
 
 /**
@@ -1115,12 +1117,12 @@ xmlSecTransformHmacSha384GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformHmacSha512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformHmacSha512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformHmacSha512GetKlass == NULL) {
         xmlSecNotImplementedError("transformHmacSha512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformHmacSha512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformHmacSha512GetKlass());
 }
 
 /**
@@ -1134,12 +1136,12 @@ xmlSecTransformHmacSha512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformMd5GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformMd5GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformMd5GetKlass == NULL) {
         xmlSecNotImplementedError("transformMd5GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformMd5GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformMd5GetKlass());
 }
 
 /**
@@ -1154,12 +1156,12 @@ xmlSecTransformMd5GetKlass(void) {
 xmlSecTransformId
 xmlSecTransformPbkdf2GetKlass(void)
 {
-    if ((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformPbkdf2GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformPbkdf2GetKlass == NULL) {
         xmlSecNotImplementedError("transformPbkdf2GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformPbkdf2GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformPbkdf2GetKlass());
 }
 
 
@@ -1174,12 +1176,12 @@ xmlSecTransformPbkdf2GetKlass(void)
  */
 xmlSecTransformId
 xmlSecTransformRipemd160GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRipemd160GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRipemd160GetKlass == NULL) {
         xmlSecNotImplementedError("transformRipemd160GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRipemd160GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRipemd160GetKlass());
 }
 
 /**
@@ -1193,12 +1195,12 @@ xmlSecTransformRipemd160GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaMd5GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaMd5GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaMd5GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaMd5GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaMd5GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaMd5GetKlass());
 }
 
 /**
@@ -1212,12 +1214,12 @@ xmlSecTransformRsaMd5GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaRipemd160GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaRipemd160GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaRipemd160GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaRipemd160GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaRipemd160GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaRipemd160GetKlass());
 }
 
 /**
@@ -1231,12 +1233,12 @@ xmlSecTransformRsaRipemd160GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaSha1GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaSha1GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaSha1GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaSha1GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaSha1GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaSha1GetKlass());
 }
 
 /**
@@ -1250,12 +1252,12 @@ xmlSecTransformRsaSha1GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaSha224GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaSha224GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaSha224GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaSha224GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaSha224GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaSha224GetKlass());
 }
 
 /**
@@ -1269,12 +1271,12 @@ xmlSecTransformRsaSha224GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaSha256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaSha256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaSha256GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaSha256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaSha256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaSha256GetKlass());
 }
 
 /**
@@ -1288,12 +1290,12 @@ xmlSecTransformRsaSha256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaSha384GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaSha384GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaSha384GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaSha384GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaSha384GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaSha384GetKlass());
 }
 
 /**
@@ -1307,12 +1309,12 @@ xmlSecTransformRsaSha384GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaSha512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaSha512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaSha512GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaSha512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaSha512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaSha512GetKlass());
 }
 
 
@@ -1327,12 +1329,12 @@ xmlSecTransformRsaSha512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha1GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha1GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha1GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha1GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha1GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha1GetKlass());
 }
 
 /**
@@ -1346,12 +1348,12 @@ xmlSecTransformRsaPssSha1GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha224GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha224GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha224GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha224GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha224GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha224GetKlass());
 }
 
 /**
@@ -1365,12 +1367,12 @@ xmlSecTransformRsaPssSha224GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha256GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha256GetKlass());
 }
 
 /**
@@ -1384,12 +1386,12 @@ xmlSecTransformRsaPssSha256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha384GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha384GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha384GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha384GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha384GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha384GetKlass());
 }
 
 /**
@@ -1403,12 +1405,12 @@ xmlSecTransformRsaPssSha384GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha512GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha512GetKlass());
 }
 
 
@@ -1423,12 +1425,12 @@ xmlSecTransformRsaPssSha512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha3_224GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha3_224GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha3_224GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha3_224GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha3_224GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha3_224GetKlass());
 }
 
 /**
@@ -1442,12 +1444,12 @@ xmlSecTransformRsaPssSha3_224GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha3_256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha3_256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha3_256GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha3_256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha3_256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha3_256GetKlass());
 }
 
 /**
@@ -1461,12 +1463,12 @@ xmlSecTransformRsaPssSha3_256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha3_384GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha3_384GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha3_384GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha3_384GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha3_384GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha3_384GetKlass());
 }
 
 /**
@@ -1480,12 +1482,12 @@ xmlSecTransformRsaPssSha3_384GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPssSha3_512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPssSha3_512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha3_512GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPssSha3_512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPssSha3_512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPssSha3_512GetKlass());
 }
 
 
@@ -1500,12 +1502,12 @@ xmlSecTransformRsaPssSha3_512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaPkcs1GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaPkcs1GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaPkcs1GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaPkcs1GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaPkcs1GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaPkcs1GetKlass());
 }
 
 /**
@@ -1519,12 +1521,12 @@ xmlSecTransformRsaPkcs1GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaOaepGetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaOaepGetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaOaepGetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaOaepGetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaOaepGetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaOaepGetKlass());
 }
 
 /**
@@ -1538,12 +1540,12 @@ xmlSecTransformRsaOaepGetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformRsaOaepEnc11GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformRsaOaepEnc11GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformRsaOaepEnc11GetKlass == NULL) {
         xmlSecNotImplementedError("transformRsaOaepEnc11GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformRsaOaepEnc11GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformRsaOaepEnc11GetKlass());
 }
 
 
@@ -1558,12 +1560,12 @@ xmlSecTransformRsaOaepEnc11GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformGostR3411_94GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformGostR3411_94GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformGostR3411_94GetKlass == NULL) {
         xmlSecNotImplementedError("transformGostR3411_94GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformGostR3411_94GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformGostR3411_94GetKlass());
 }
 
 /**
@@ -1578,12 +1580,12 @@ xmlSecTransformGostR3411_94GetKlass(void) {
 
 xmlSecTransformId
 xmlSecTransformGostR3411_2012_256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformGostR3411_2012_256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformGostR3411_2012_256GetKlass == NULL) {
         xmlSecNotImplementedError("transformGostR3411_2012_256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformGostR3411_2012_256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformGostR3411_2012_256GetKlass());
 }
 
 /**
@@ -1597,12 +1599,12 @@ xmlSecTransformGostR3411_2012_256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformGostR3411_2012_512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformGostR3411_2012_512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformGostR3411_2012_512GetKlass == NULL) {
         xmlSecNotImplementedError("transformGostR3411_2012_512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformGostR3411_2012_512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformGostR3411_2012_512GetKlass());
 }
 /**
  * xmlSecTransformSha1GetKlass:
@@ -1615,12 +1617,12 @@ xmlSecTransformGostR3411_2012_512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha1GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha1GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha1GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha1GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha1GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha1GetKlass());
 }
 
 /**
@@ -1634,12 +1636,12 @@ xmlSecTransformSha1GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha224GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha224GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha224GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha224GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha224GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha224GetKlass());
 }
 
 /**
@@ -1653,12 +1655,12 @@ xmlSecTransformSha224GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha256GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha256GetKlass());
 }
 
 /**
@@ -1672,12 +1674,12 @@ xmlSecTransformSha256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha384GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha384GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha384GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha384GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha384GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha384GetKlass());
 }
 
 /**
@@ -1691,12 +1693,12 @@ xmlSecTransformSha384GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha512GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha512GetKlass());
 }
 
 
@@ -1711,12 +1713,12 @@ xmlSecTransformSha512GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha3_224GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha3_224GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha3_224GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha3_224GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha3_224GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha3_224GetKlass());
 }
 
 /**
@@ -1730,12 +1732,12 @@ xmlSecTransformSha3_224GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha3_256GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha3_256GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha3_256GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha3_256GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha3_256GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha3_256GetKlass());
 }
 
 /**
@@ -1749,12 +1751,12 @@ xmlSecTransformSha3_256GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha3_384GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha3_384GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha3_384GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha3_384GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha3_384GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha3_384GetKlass());
 }
 
 /**
@@ -1768,12 +1770,12 @@ xmlSecTransformSha3_384GetKlass(void) {
  */
 xmlSecTransformId
 xmlSecTransformSha3_512GetKlass(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->transformSha3_512GetKlass == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.transformSha3_512GetKlass == NULL) {
         xmlSecNotImplementedError("transformSha3_512GetKlass");
         return(xmlSecTransformIdUnknown);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->transformSha3_512GetKlass());
+    return(xmlSecCryptoDLCurrentFunctions.transformSha3_512GetKlass());
 }
 
 
@@ -1794,12 +1796,12 @@ xmlSecTransformSha3_512GetKlass(void) {
  */
 int
 xmlSecCryptoAppInit(const char* config) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppInit == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppInit == NULL) {
         xmlSecNotImplementedError("cryptoAppInit");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppInit(config));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppInit(config));
 }
 
 
@@ -1814,12 +1816,12 @@ xmlSecCryptoAppInit(const char* config) {
  */
 int
 xmlSecCryptoAppShutdown(void) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppShutdown == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppShutdown == NULL) {
         xmlSecNotImplementedError("cryptoAppShutdown");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppShutdown());
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppShutdown());
 }
 
 /**
@@ -1833,12 +1835,12 @@ xmlSecCryptoAppShutdown(void) {
  */
 int
 xmlSecCryptoAppDefaultKeysMngrInit(xmlSecKeysMngrPtr mngr) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrInit == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrInit == NULL) {
         xmlSecNotImplementedError("cryptoAppDefaultKeysMngrInit");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrInit(mngr));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrInit(mngr));
 }
 
 /**
@@ -1853,12 +1855,12 @@ xmlSecCryptoAppDefaultKeysMngrInit(xmlSecKeysMngrPtr mngr) {
  */
 int
 xmlSecCryptoAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrAdoptKey == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrAdoptKey == NULL) {
         xmlSecNotImplementedError("cryptoAppDefaultKeysMngrAdoptKey");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrAdoptKey(mngr, key));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrAdoptKey(mngr, key));
 }
 
 
@@ -1880,12 +1882,12 @@ xmlSecCryptoAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key)
  */
 int
 xmlSecCryptoAppDefaultKeysMngrVerifyKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key, xmlSecKeyInfoCtxPtr keyInfoCtx) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrVerifyKey == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrVerifyKey == NULL) {
         xmlSecNotImplementedError("cryptoAppDefaultKeysMngrVerifyKey");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrVerifyKey(mngr, key, keyInfoCtx));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrVerifyKey(mngr, key, keyInfoCtx));
 }
 
 /**
@@ -1900,12 +1902,12 @@ xmlSecCryptoAppDefaultKeysMngrVerifyKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key
  */
 int
 xmlSecCryptoAppDefaultKeysMngrLoad(xmlSecKeysMngrPtr mngr, const char* uri) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrLoad == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrLoad == NULL) {
         xmlSecNotImplementedError("cryptoAppDefaultKeysMngrLoad");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrLoad(mngr, uri));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrLoad(mngr, uri));
 }
 
 /**
@@ -1921,12 +1923,12 @@ xmlSecCryptoAppDefaultKeysMngrLoad(xmlSecKeysMngrPtr mngr, const char* uri) {
 int
 xmlSecCryptoAppDefaultKeysMngrSave(xmlSecKeysMngrPtr mngr, const char* filename,
                                    xmlSecKeyDataType type) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrSave == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrSave == NULL) {
         xmlSecNotImplementedError("cryptoAppDefaultKeysMngrSave");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppDefaultKeysMngrSave(mngr, filename, type));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultKeysMngrSave(mngr, filename, type));
 }
 
 /**
@@ -1945,12 +1947,12 @@ xmlSecCryptoAppDefaultKeysMngrSave(xmlSecKeysMngrPtr mngr, const char* filename,
 int
 xmlSecCryptoAppKeysMngrCertLoad(xmlSecKeysMngrPtr mngr, const char *filename,
                                 xmlSecKeyDataFormat format, xmlSecKeyDataType type) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeysMngrCertLoad == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrCertLoad == NULL) {
         xmlSecNotImplementedError("cryptoAppKeysMngrCertLoad");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeysMngrCertLoad(mngr, filename, format, type));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrCertLoad(mngr, filename, format, type));
 }
 
 /**
@@ -1970,12 +1972,12 @@ int
 xmlSecCryptoAppKeysMngrCertLoadMemory(xmlSecKeysMngrPtr mngr, const xmlSecByte* data,
                                     xmlSecSize dataSize, xmlSecKeyDataFormat format,
                                     xmlSecKeyDataType type) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeysMngrCertLoadMemory == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrCertLoadMemory == NULL) {
         xmlSecNotImplementedError("cryptoAppKeysMngrCertLoadMemory");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeysMngrCertLoadMemory(mngr, data, dataSize, format, type));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrCertLoadMemory(mngr, data, dataSize, format, type));
 }
 
 /**
@@ -1990,12 +1992,12 @@ xmlSecCryptoAppKeysMngrCertLoadMemory(xmlSecKeysMngrPtr mngr, const xmlSecByte*
  */
 int
 xmlSecCryptoAppKeysMngrCrlLoad(xmlSecKeysMngrPtr mngr, const char *filename, xmlSecKeyDataFormat format) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeysMngrCrlLoad == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrCrlLoad == NULL) {
         xmlSecNotImplementedError("cryptoAppKeysMngrCrlLoad");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeysMngrCrlLoad(mngr, filename, format));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrCrlLoad(mngr, filename, format));
 }
 
 /**
@@ -2013,12 +2015,34 @@ int
 xmlSecCryptoAppKeysMngrCrlLoadMemory(xmlSecKeysMngrPtr mngr, const xmlSecByte* data, xmlSecSize dataSize,
     xmlSecKeyDataFormat format
 ) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeysMngrCrlLoadMemory == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrCrlLoadMemory == NULL) {
         xmlSecNotImplementedError("cryptoAppKeysMngrCrlLoadMemory");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeysMngrCrlLoadMemory(mngr, data, dataSize, format));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrCrlLoadMemory(mngr, data, dataSize, format));
+}
+
+/**
+ * xmlSecCryptoAppKeysMngrEnableX509VerifyCache:
+ * @mngr:               the keys manager.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables the cache of the successful certificates verification results
+ * in the X509 store of @mngr: the same certificates chain is verified only
+ * once until the first certificate in the chain expires or the store
+ * certificates or CRLs are changed.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecCryptoAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrEnableX509VerifyCache == NULL) {
+        xmlSecNotImplementedError("cryptoAppKeysMngrEnableX509VerifyCache");
+        return(-1);
+    }
+
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeysMngrEnableX509VerifyCache(mngr, maxSize));
 }
 
 
@@ -2037,12 +2061,12 @@ xmlSecCryptoAppKeysMngrCrlLoadMemory(xmlSecKeysMngrPtr mngr, const xmlSecByte* d
 xmlSecKeyPtr
 xmlSecCryptoAppKeyLoad(const char *filename, xmlSecKeyDataFormat format,
                        const char *pwd, void* pwdCallback, void* pwdCallbackCtx) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeyLoad == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyLoad == NULL) {
         xmlSecNotImplementedError("cryptoAppKeyLoad");
         return(NULL);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeyLoad(filename, format, pwd, pwdCallback, pwdCallbackCtx));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyLoad(filename, format, pwd, pwdCallback, pwdCallbackCtx));
 }
 
 /**
@@ -2061,12 +2085,12 @@ xmlSecCryptoAppKeyLoad(const char *filename, xmlSecKeyDataFormat format,
 xmlSecKeyPtr
 xmlSecCryptoAppKeyLoadEx(const char *filename, xmlSecKeyDataType type, xmlSecKeyDataFormat format,
                        const char *pwd, void* pwdCallback, void* pwdCallbackCtx) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeyLoadEx == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyLoadEx == NULL) {
         xmlSecNotImplementedError("cryptoAppKeyLoadEx");
         return(NULL);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeyLoadEx(filename, type, format, pwd, pwdCallback, pwdCallbackCtx));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyLoadEx(filename, type, format, pwd, pwdCallback, pwdCallbackCtx));
 }
 
 /**
@@ -2085,12 +2109,12 @@ xmlSecCryptoAppKeyLoadEx(const char *filename, xmlSecKeyDataType type, xmlSecKey
 xmlSecKeyPtr
 xmlSecCryptoAppKeyLoadMemory(const xmlSecByte* data, xmlSecSize dataSize, xmlSecKeyDataFormat format,
                        const char *pwd, void* pwdCallback, void* pwdCallbackCtx) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeyLoadMemory == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyLoadMemory == NULL) {
         xmlSecNotImplementedError("cryptoAppKeyLoadMemory");
         return(NULL);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeyLoadMemory(data, dataSize, format, pwd, pwdCallback, pwdCallbackCtx));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyLoadMemory(data, dataSize, format, pwd, pwdCallback, pwdCallbackCtx));
 }
 
 /**
@@ -2109,12 +2133,12 @@ xmlSecCryptoAppKeyLoadMemory(const xmlSecByte* data, xmlSecSize dataSize, xmlSec
 xmlSecKeyPtr
 xmlSecCryptoAppPkcs12Load(const char* filename, const char* pwd, void* pwdCallback,
                           void* pwdCallbackCtx) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppPkcs12Load == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppPkcs12Load == NULL) {
         xmlSecNotImplementedError("cryptoAppPkcs12Load");
         return(NULL);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppPkcs12Load(filename, pwd, pwdCallback, pwdCallbackCtx));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppPkcs12Load(filename, pwd, pwdCallback, pwdCallbackCtx));
 }
 
 /**
@@ -2135,12 +2159,12 @@ xmlSecKeyPtr
 xmlSecCryptoAppPkcs12LoadMemory(const xmlSecByte* data, xmlSecSize dataSize,
                            const char *pwd, void* pwdCallback,
                            void* pwdCallbackCtx) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppPkcs12LoadMemory == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppPkcs12LoadMemory == NULL) {
         xmlSecNotImplementedError("cryptoAppPkcs12LoadMemory");
         return(NULL);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppPkcs12LoadMemory(data, dataSize, pwd, pwdCallback, pwdCallbackCtx));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppPkcs12LoadMemory(data, dataSize, pwd, pwdCallback, pwdCallbackCtx));
 }
 
 /**
@@ -2155,12 +2179,12 @@ xmlSecCryptoAppPkcs12LoadMemory(const xmlSecByte* data, xmlSecSize dataSize,
  */
 int
 xmlSecCryptoAppKeyCertLoad(xmlSecKeyPtr key, const char* filename, xmlSecKeyDataFormat format) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeyCertLoad == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyCertLoad == NULL) {
         xmlSecNotImplementedError("cryptoAppKeyCertLoad");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeyCertLoad(key, filename, format));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyCertLoad(key, filename, format));
 }
 
 /**
@@ -2177,12 +2201,12 @@ xmlSecCryptoAppKeyCertLoad(xmlSecKeyPtr key, const char* filename, xmlSecKeyData
 int
 xmlSecCryptoAppKeyCertLoadMemory(xmlSecKeyPtr key, const xmlSecByte* data, xmlSecSize dataSize,
                                 xmlSecKeyDataFormat format) {
-    if((xmlSecCryptoDLGetFunctions() == NULL) || (xmlSecCryptoDLGetFunctions()->cryptoAppKeyCertLoadMemory == NULL)) {
+    if(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyCertLoadMemory == NULL) {
         xmlSecNotImplementedError("cryptoAppKeyCertLoadMemory");
         return(-1);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppKeyCertLoadMemory(key, data, dataSize, format));
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppKeyCertLoadMemory(key, data, dataSize, format));
 }
 
 /**
@@ -2199,7 +2223,7 @@ xmlSecCryptoAppGetDefaultPwdCallback(void) {
         return(NULL);
     }
 
-    return(xmlSecCryptoDLGetFunctions()->cryptoAppDefaultPwdCallback);
+    return(xmlSecCryptoDLCurrentFunctions.cryptoAppDefaultPwdCallback);
 }
 
 #endif /* XMLSEC_NO_CRYPTO_DYNAMIC_LOADING */
@@ -0,0 +1,197 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Bump allocator for the objects that live until the end of one operation.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#include "globals.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libxml/tree.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/errors.h>
+
+#include "arena.h"
+
+/* all the allocations are aligned to this size */
+#define XMLSEC_ARENA_ALIGN                      16
+#define XMLSEC_ARENA_ALIGN_SIZE(size)           (((size) + XMLSEC_ARENA_ALIGN - 1) & ~((xmlSecSize)XMLSEC_ARENA_ALIGN - 1))
+#define XMLSEC_ARENA_CHUNK_HEADER_SIZE          XMLSEC_ARENA_ALIGN_SIZE(sizeof(xmlSecArenaChunk))
+#define XMLSEC_ARENA_DEFAULT_CHUNK_SIZE         4096
+
+typedef struct _xmlSecArenaChunk                xmlSecArenaChunk, *xmlSecArenaChunkPtr;
+struct _xmlSecArenaChunk {
+    xmlSecArenaChunkPtr         next;
+    xmlSecSize                  size;
+    xmlSecSize                  used;
+};
+
+/*
+ * The arena: objects are bump allocated from the chunks and are released
+ * all at once by xmlSecArenaReset or xmlSecArenaDestroy. The used memory
+ * is zeroed before release since it might hold key material. The first
+ * chunk is kept on reset for the next operation.
+ */
+struct _xmlSecArena {
+    xmlSecArenaChunkPtr         chunks;
+    xmlSecSize                  chunkSize;
+};
+
+#define xmlSecArenaChunkGetData(chunk)  (((xmlSecByte*)(chunk)) + XMLSEC_ARENA_CHUNK_HEADER_SIZE)
+
+static xmlSecArenaChunkPtr
+xmlSecArenaChunkCreate(xmlSecSize size) {
+    xmlSecArenaChunkPtr chunk;
+
+    chunk = (xmlSecArenaChunkPtr)xmlMalloc(XMLSEC_ARENA_CHUNK_HEADER_SIZE + size);
+    if(chunk == NULL) {
+        xmlSecMallocError(XMLSEC_ARENA_CHUNK_HEADER_SIZE + size, NULL);
+        return(NULL);
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return(chunk);
+}
+
+static void
+xmlSecArenaChunkDestroy(xmlSecArenaChunkPtr chunk) {
+    xmlSecAssert(chunk != NULL);
+
+    memset(chunk, 0, XMLSEC_ARENA_CHUNK_HEADER_SIZE + chunk->used);
+    xmlFree(chunk);
+}
+
+/**
+ * xmlSecArenaCreate:
+ * @chunkSize:          the size of the memory chunks (0 for default).
+ *
+ * Creates the arena.
+ *
+ * Returns: pointer to newly created arena or NULL if an error occurs.
+ */
+xmlSecArenaPtr
+xmlSecArenaCreate(xmlSecSize chunkSize) {
+    xmlSecArenaPtr arena;
+
+    arena = (xmlSecArenaPtr)xmlMalloc(sizeof(xmlSecArena));
+    if(arena == NULL) {
+        xmlSecMallocError(sizeof(xmlSecArena), NULL);
+        return(NULL);
+    }
+    memset(arena, 0, sizeof(xmlSecArena));
+    arena->chunkSize = XMLSEC_ARENA_ALIGN_SIZE((chunkSize > 0) ? chunkSize : XMLSEC_ARENA_DEFAULT_CHUNK_SIZE);
+    return(arena);
+}
+
+/**
+ * xmlSecArenaDestroy:
+ * @arena:              the pointer to arena.
+ *
+ * Zeroes and frees all the memory allocated from @arena and destroys it.
+ */
+void
+xmlSecArenaDestroy(xmlSecArenaPtr arena) {
+    xmlSecArenaChunkPtr chunk;
+
+    xmlSecAssert(arena != NULL);
+
+    while(arena->chunks != NULL) {
+        chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        xmlSecArenaChunkDestroy(chunk);
+    }
+    memset(arena, 0, sizeof(xmlSecArena));
+    xmlFree(arena);
+}
+
+/**
+ * xmlSecArenaReset:
+ * @arena:              the pointer to arena.
+ *
+ * Zeroes and releases all the memory allocated from @arena, one chunk
+ * is kept for the future allocations.
+ */
+void
+xmlSecArenaReset(xmlSecArenaPtr arena) {
+    xmlSecArenaChunkPtr chunk, keep = NULL;
+
+    xmlSecAssert(arena != NULL);
+
+    while(arena->chunks != NULL) {
+        chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        if((keep == NULL) && (chunk->size == arena->chunkSize)) {
+            memset(xmlSecArenaChunkGetData(chunk), 0, chunk->used);
+            chunk->used = 0;
+            chunk->next = NULL;
+            keep = chunk;
+        } else {
+            xmlSecArenaChunkDestroy(chunk);
+        }
+    }
+    arena->chunks = keep;
+}
+
+/**
+ * xmlSecArenaAlloc:
+ * @arena:              the pointer to arena.
+ * @size:               the size of the memory block.
+ *
+ * Allocates zeroed memory block from @arena. The block is released
+ * by #xmlSecArenaReset or #xmlSecArenaDestroy and should not be freed.
+ *
+ * Returns: pointer to memory block or NULL if an error occurs.
+ */
+void*
+xmlSecArenaAlloc(xmlSecArenaPtr arena, xmlSecSize size) {
+    xmlSecArenaChunkPtr chunk;
+    xmlSecByte* res;
+
+    xmlSecAssert2(arena != NULL, NULL);
+    xmlSecAssert2(size > 0, NULL);
+
+    size = XMLSEC_ARENA_ALIGN_SIZE(size);
+
+    /* big blocks get their own chunk behind the current one */
+    if(size > arena->chunkSize / 4) {
+        chunk = xmlSecArenaChunkCreate(size);
+        if(chunk == NULL) {
+            xmlSecInternalError("xmlSecArenaChunkCreate", NULL);
+            return(NULL);
+        }
+        if(arena->chunks != NULL) {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            arena->chunks = chunk;
+        }
+        chunk->used = size;
+        res = xmlSecArenaChunkGetData(chunk);
+        memset(res, 0, size);
+        return(res);
+    }
+
+    chunk = arena->chunks;
+    if((chunk == NULL) || (chunk->size - chunk->used < size)) {
+        chunk = xmlSecArenaChunkCreate(arena->chunkSize);
+        if(chunk == NULL) {
+            xmlSecInternalError("xmlSecArenaChunkCreate", NULL);
+            return(NULL);
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    res = xmlSecArenaChunkGetData(chunk) + chunk->used;
+    chunk->used += size;
+    memset(res, 0, size);
+    return(res);
+}
@@ -0,0 +1,40 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * THIS IS A PRIVATE XMLSEC HEADER FILE
+ * DON'T USE IT IN YOUR APPLICATION
+ *
+ * Bump allocator for the objects that live until the end of one operation.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_ARENA_H__
+#define __XMLSEC_ARENA_H__
+
+#ifndef XMLSEC_PRIVATE
+#error "arena.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct _xmlSecArena                     xmlSecArena, *xmlSecArenaPtr;
+
+XMLSEC_EXPORT xmlSecArenaPtr    xmlSecArenaCreate               (xmlSecSize chunkSize);
+XMLSEC_EXPORT void              xmlSecArenaDestroy              (xmlSecArenaPtr arena);
+XMLSEC_EXPORT void              xmlSecArenaReset                (xmlSecArenaPtr arena);
+XMLSEC_EXPORT void*             xmlSecArenaAlloc                (xmlSecArenaPtr arena,
+                                                                 xmlSecSize size);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_ARENA_H__ */
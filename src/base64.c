@@ -26,6 +26,7 @@
 #include <xmlsec/keys.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/base64.h>
+#include <xmlsec/settings.h>
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
@@ -46,6 +47,33 @@ static const xmlSecByte base64[] =
     '4', '5', '6', '7', '8', '9', '+', '/'  /* 7 */
 };
 
+/*
+ * the table to map base64 chars to numbers: 0xFE for spaces, 0xFF for
+ * anything else (including '=')
+ */
+#define XMLSEC_BASE64_DECODE_SPACE      0xFE
+#define XMLSEC_BASE64_DECODE_INVALID    0xFF
+
+static const xmlSecByte base64Decode[256] =
+{
+/*  0     1     2     3     4     5     6     7     8     9     A     B     C     D     E     F  */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE, 0xFE, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF, /* 0 */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* 1 */
+    0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F, /* 2 */
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* 3 */
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, /* 4 */
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* 5 */
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, /* 6 */
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* 7 */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* 8 */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* 9 */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* A */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* B */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* C */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* D */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* E */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF  /* F */
+};
 
 /* few macros to simplify the code */
 #define xmlSecBase64Encode1(a)          (((a) >> 2) & 0x3F)
@@ -122,13 +150,19 @@ static int g_xmlsec_base64_default_line_size = XMLSEC_BASE64_LINESIZE;
 /**
  * xmlSecBase64GetDefaultLineSize:
  *
- * Gets the current default line size.
+ * Gets the current default line size (from the settings attached to
+ * the current thread if set, see #xmlSecSettingsAttach).
  *
  * Returns: the current default line size.
  */
 int
 xmlSecBase64GetDefaultLineSize(void)
 {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_BASE64_LINE_SIZE) != 0)) {
+        return(settings->base64LineSize);
+    }
     return g_xmlsec_base64_default_line_size;
 }
 
@@ -459,6 +493,39 @@ xmlSecBase64CtxEncode(xmlSecBase64CtxPtr ctx,
 
     /* encode */
     for(inPos = outPos = 0; (inPos < inBufSize) && (outPos < outBufSize); ) {
+        /* fast path: encode full 3 bytes blocks directly (we need up to 4 chars
+         * and 4 line breaks in the output buffer) */
+        if(ctx->inPos == 0) {
+            while(((inBufSize - inPos) >= 3) && ((outBufSize - outPos) >= 8)) {
+                xmlSecByte chars[4];
+                xmlSecSize ii;
+
+                chars[0] = base64[xmlSecBase64Encode1(inBuf[inPos])];
+                chars[1] = base64[xmlSecBase64Encode2(inBuf[inPos], inBuf[inPos + 1])];
+                chars[2] = base64[xmlSecBase64Encode3(inBuf[inPos + 1], inBuf[inPos + 2])];
+                chars[3] = base64[xmlSecBase64Encode4(inBuf[inPos + 2])];
+                inPos += 3;
+
+                if((ctx->columns == 0) || ((ctx->linePos + 4) <= ctx->columns)) {
+                    memcpy(outBuf + outPos, chars, 4);
+                    outPos += 4;
+                    ctx->linePos += 4;
+                    continue;
+                }
+                for(ii = 0; ii < 4; ++ii) {
+                    if(ctx->linePos >= ctx->columns) {
+                        outBuf[outPos++] = '\n';
+                        ctx->linePos = 0;
+                    }
+                    outBuf[outPos++] = chars[ii];
+                    ++ctx->linePos;
+                }
+            }
+            if((inPos >= inBufSize) || (outPos >= outBufSize)) {
+                break;
+            }
+        }
+
         status = xmlSecBase64CtxEncodeByte(ctx, inBuf[inPos], &(outBuf[outPos]));
         switch(status) {
             case xmlSecBase64StatusConsumeAndNext:
@@ -540,6 +607,35 @@ xmlSecBase64CtxDecode(xmlSecBase64CtxPtr ctx,
 
     /* decode */
     for(inPos = outPos = 0; (inPos < inBufSize) && (outPos < outBufSize) && (status != xmlSecBase64StatusDone); ) {
+        /* fast path: skip spaces and decode full 4 chars blocks directly, anything
+         * else ('=', invalid chars, spaces inside the block) goes thru the
+         * state machine below */
+        if((ctx->inPos == 0) && (ctx->finished == 0)) {
+            while(((inBufSize - inPos) >= 4) && ((outBufSize - outPos) >= 3)) {
+                xmlSecByte aa, bb, cc, dd;
+
+                aa = base64Decode[inBuf[inPos]];
+                if(aa == XMLSEC_BASE64_DECODE_SPACE) {
+                    ++inPos;
+                    continue;
+                }
+                bb = base64Decode[inBuf[inPos + 1]];
+                cc = base64Decode[inBuf[inPos + 2]];
+                dd = base64Decode[inBuf[inPos + 3]];
+                if(((aa | bb | cc | dd) & 0xC0) != 0) {
+                    break;
+                }
+                outBuf[outPos]     = xmlSecBase64Decode1(aa, bb);
+                outBuf[outPos + 1] = xmlSecBase64Decode2(bb, cc);
+                outBuf[outPos + 2] = xmlSecBase64Decode3(cc, dd);
+                inPos  += 4;
+                outPos += 3;
+            }
+            if((inPos >= inBufSize) || (outPos >= outBufSize)) {
+                break;
+            }
+        }
+
         status = xmlSecBase64CtxDecodeByte(ctx, inBuf[inPos], &(outBuf[outPos]));
         switch(status) {
             case xmlSecBase64StatusConsumeAndNext:
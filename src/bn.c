@@ -64,6 +64,112 @@ static const xmlChar xmlSecBnRevLookupTable[XMLSEC_BN_REV_MAX] =
  * xmlSecBn
  *
  ****************************************************************************/
+/*
+ * The conversions between the strings and the bytes representation are done
+ * on the 32 bit limbs (least significant limb first) with the 64 bit
+ * intermediate results: all the digits that fit into a limb (e.g. 9 decimal
+ * digits) are processed in one pass over the number instead of one pass
+ * per digit.
+ */
+typedef uint32_t xmlSecBnLimb;
+typedef uint64_t xmlSecBnDoubleLimb;
+
+#define XMLSEC_BN_LIMB_SIZE     4
+#define XMLSEC_BN_LIMB_BITS     32
+#define XMLSEC_BN_LIMB_MAX      0xFFFFFFFFU
+
+/* converts big endian @data (optionally inverted with @mask) to limbs, returns the limbs number */
+static xmlSecSize
+xmlSecBnLimbsFromBytes(xmlSecBnLimb* limbs, const xmlSecByte* data, xmlSecSize dataSize, xmlSecByte mask) {
+    xmlSecSize ii, limbsNum;
+
+    xmlSecAssert2(limbs != NULL, 0);
+
+    limbsNum = (dataSize + XMLSEC_BN_LIMB_SIZE - 1) / XMLSEC_BN_LIMB_SIZE;
+    memset(limbs, 0, limbsNum * sizeof(xmlSecBnLimb));
+    for(ii = 0; ii < dataSize; ++ii) {
+        xmlSecBnLimb bb = (xmlSecBnLimb)(data[dataSize - ii - 1] ^ mask);
+        limbs[ii / XMLSEC_BN_LIMB_SIZE] |= bb << (8 * (ii % XMLSEC_BN_LIMB_SIZE));
+    }
+
+    /* remove leading zeros */
+    while((limbsNum > 0) && (limbs[limbsNum - 1] == 0)) {
+        --limbsNum;
+    }
+    return(limbsNum);
+}
+
+/* returns the number of significant bytes in the limbs */
+static xmlSecSize
+xmlSecBnLimbsGetBytesSize(const xmlSecBnLimb* limbs, xmlSecSize limbsNum) {
+    xmlSecBnLimb top;
+    xmlSecSize size;
+
+    if(limbsNum <= 0) {
+        return(0);
+    }
+    xmlSecAssert2(limbs != NULL, 0);
+
+    size = (limbsNum - 1) * XMLSEC_BN_LIMB_SIZE;
+    for(top = limbs[limbsNum - 1]; top != 0; top >>= 8) {
+        ++size;
+    }
+    return(size);
+}
+
+/* writes the lowest @dataSize bytes of the limbs to @data in big endian order */
+static void
+xmlSecBnLimbsToBytes(const xmlSecBnLimb* limbs, xmlSecSize limbsNum, xmlSecByte* data, xmlSecSize dataSize) {
+    xmlSecSize ii, jj;
+
+    xmlSecAssert(data != NULL);
+
+    for(ii = 0; ii < dataSize; ++ii) {
+        jj = ii / XMLSEC_BN_LIMB_SIZE;
+        if(jj < limbsNum) {
+            data[dataSize - ii - 1] = (xmlSecByte)(limbs[jj] >> (8 * (ii % XMLSEC_BN_LIMB_SIZE)));
+        } else {
+            data[dataSize - ii - 1] = 0;
+        }
+    }
+}
+
+/* limbs = limbs * mul + add; returns the carry */
+static xmlSecBnLimb
+xmlSecBnLimbsMulAdd(xmlSecBnLimb* limbs, xmlSecSize limbsNum, xmlSecBnLimb mul, xmlSecBnLimb add) {
+    xmlSecBnDoubleLimb acc = add;
+    xmlSecSize ii;
+
+    for(ii = 0; ii < limbsNum; ++ii) {
+        acc += (xmlSecBnDoubleLimb)limbs[ii] * mul;
+        limbs[ii] = (xmlSecBnLimb)acc;
+        acc >>= XMLSEC_BN_LIMB_BITS;
+    }
+    return((xmlSecBnLimb)acc);
+}
+
+/* limbs = limbs / div; returns the remainder */
+static xmlSecBnLimb
+xmlSecBnLimbsDiv(xmlSecBnLimb* limbs, xmlSecSize* limbsNum, xmlSecBnLimb div) {
+    xmlSecBnDoubleLimb acc = 0;
+    xmlSecSize ii;
+
+    xmlSecAssert2(limbsNum != NULL, 0);
+    xmlSecAssert2(div > 0, 0);
+
+    for(ii = (*limbsNum); ii > 0; --ii) {
+        acc = (acc << XMLSEC_BN_LIMB_BITS) | limbs[ii - 1];
+        limbs[ii - 1] = (xmlSecBnLimb)(acc / div);
+        acc = acc % div;
+    }
+
+    /* remove leading zeros */
+    while(((*limbsNum) > 0) && (limbs[(*limbsNum) - 1] == 0)) {
+        --(*limbsNum);
+    }
+    return((xmlSecBnLimb)acc);
+}
+
 /**
  * xmlSecBnCreate:
  * @size:       the initial allocated BN size.
@@ -179,12 +285,17 @@ xmlSecBnZero(xmlSecBnPtr bn) {
  */
 int
 xmlSecBnFromString(xmlSecBnPtr bn, const xmlChar* str, xmlSecSize base) {
+    xmlSecBnLimb* limbs = NULL;
+    xmlSecSize limbsNum, limbsMax;
+    xmlSecBnLimb chunk, chunkMul, carry;
+    xmlSecBnLimb baseLimb;
     int baseInt, nn;
-    xmlSecSize ii, strSize, size;
+    xmlSecSize ii, strSize, size, prefix;
     xmlSecByte ch;
     xmlSecByte* data;
     int positive;
     int ret;
+    int res = -1;
 
     xmlSecAssert2(bn != NULL, -1);
     xmlSecAssert2(str != NULL, -1);
@@ -192,6 +303,7 @@ xmlSecBnFromString(xmlSecBnPtr bn, const xmlChar* str, xmlSecSize base) {
     xmlSecAssert2(base <= XMLSEC_BN_REV_MAX, -1);
 
     XMLSEC_SAFE_CAST_SIZE_TO_INT(base, baseInt, return(-1), NULL);
+    baseLimb = (xmlSecBnLimb)base;
 
     /* trivial case */
     strSize = xmlSecStrlen(str);
@@ -199,21 +311,6 @@ xmlSecBnFromString(xmlSecBnPtr bn, const xmlChar* str, xmlSecSize base) {
         return(0);
     }
 
-    /* The result size could not exceed the input string length
-     * because each char fits inside a byte in all cases :)
-     * In truth, it would be likely less than 1/2 input string length
-     * because each byte is represented by 2 chars. If needed,
-     * buffer size would be increased by Mul/Add functions.
-     * Finally, we can add one byte for 00 or 10 prefix.
-     */
-    size = xmlSecBufferGetSize(bn) + strSize / 2 + 1 + 1;
-    ret = xmlSecBufferSetMaxSize(bn, size);
-    if(ret < 0) {
-        xmlSecInternalError2("xmlSecBufferSetMaxSize", NULL,
-            "size=" XMLSEC_SIZE_FMT, size);
-        return (-1);
-    }
-
     /* figure out if it is positive or negative number */
     positive = 1; /* no sign, positive by default */
     ii = 0;
@@ -241,7 +338,23 @@ xmlSecBnFromString(xmlSecBnPtr bn, const xmlChar* str, xmlSecSize base) {
         break;
     }
 
-    /* now parse the number itself */
+    /* The result size could not exceed the input string length
+     * because each char fits inside a byte in all cases :) The
+     * current @bn value is multiplied by base^<digits> thus
+     * it is counted too.
+     */
+    limbsMax = (xmlSecBufferGetSize(bn) + strSize) / XMLSEC_BN_LIMB_SIZE + 2;
+    limbs = (xmlSecBnLimb*)xmlMalloc(limbsMax * sizeof(xmlSecBnLimb));
+    if(limbs == NULL) {
+        xmlSecMallocError(limbsMax * sizeof(xmlSecBnLimb), NULL);
+        goto done;
+    }
+    limbsNum = xmlSecBnLimbsFromBytes(limbs, xmlSecBufferGetData(bn), xmlSecBufferGetSize(bn), 0);
+
+    /* now parse the number itself: accumulate as many digits as fit
+     * in a limb and then add them to the number in one pass */
+    chunk = 0;
+    chunkMul = 1;
     while(ii < strSize) {
         ch = str[ii++];
         if(isspace(ch)) {
@@ -251,37 +364,52 @@ xmlSecBnFromString(xmlSecBnPtr bn, const xmlChar* str, xmlSecSize base) {
         nn = xmlSecBnLookupTable[ch];
         if((nn < 0) || (nn >= baseInt)) {
             xmlSecInvalidIntegerDataError2("char", nn, "base", baseInt, "0 <= char < base", NULL);
-            return (-1);
+            goto done;
         }
-
-        ret = xmlSecBnMul(bn, baseInt);
-        if(ret < 0) {
-            xmlSecInternalError2("xmlSecBnMul", NULL, "base=" XMLSEC_SIZE_FMT, base);
-            return (-1);
+        chunk = chunk * baseLimb + (xmlSecBnLimb)nn;
+        chunkMul *= baseLimb;
+
+        if(chunkMul > XMLSEC_BN_LIMB_MAX / baseLimb) {
+            carry = xmlSecBnLimbsMulAdd(limbs, limbsNum, chunkMul, chunk);
+            if(carry != 0) {
+                xmlSecAssert2(limbsNum < limbsMax, -1);
+                limbs[limbsNum++] = carry;
+            }
+            chunk = 0;
+            chunkMul = 1;
         }
-
-        ret = xmlSecBnAdd(bn, nn);
-        if(ret < 0) {
-            xmlSecInternalError2("xmlSecBnAdd", NULL, "base=" XMLSEC_SIZE_FMT, base);
-            return (-1);
+    }
+    if(chunkMul > 1) {
+        carry = xmlSecBnLimbsMulAdd(limbs, limbsNum, chunkMul, chunk);
+        if(carry != 0) {
+            xmlSecAssert2(limbsNum < limbsMax, -1);
+            limbs[limbsNum++] = carry;
         }
     }
 
-    /* check if we need to add 00 prefix, do this for empty bn too */
+    /* write the result back and check if we need to add 00 prefix,
+     * do this for empty bn too */
+    size = xmlSecBnLimbsGetBytesSize(limbs, limbsNum);
+    if((size == 0) || ((limbs[(size - 1) / XMLSEC_BN_LIMB_SIZE] >> (8 * ((size - 1) % XMLSEC_BN_LIMB_SIZE))) > 127)) {
+        prefix = 1;
+    } else {
+        prefix = 0;
+    }
+    ret = xmlSecBufferSetSize(bn, size + prefix);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetSize", NULL,
+            "size=" XMLSEC_SIZE_FMT, size + prefix);
+        goto done;
+    }
     data = xmlSecBufferGetData(bn);
-    size = xmlSecBufferGetSize(bn);
-    if(((size > 0) && (data[0] > 127)) || (size == 0))  {
-        ch = 0;
-        ret = xmlSecBufferPrepend(bn, &ch, 1);
-        if(ret < 0) {
-            xmlSecInternalError2("xmlSecBufferPrepend", NULL, "base=" XMLSEC_SIZE_FMT, base);
-            return (-1);
-        }
+    xmlSecAssert2(data != NULL, -1);
+    if(prefix > 0) {
+        data[0] = 0;
     }
+    xmlSecBnLimbsToBytes(limbs, limbsNum, data + prefix, size);
 
     /* do 2's compliment and add 1 to represent negative value */
     if(positive == 0) {
-        data = xmlSecBufferGetData(bn);
         size = xmlSecBufferGetSize(bn);
         for(ii = 0; ii < size; ++ii) {
             data[ii] ^= 0xFF;
@@ -290,11 +418,18 @@ xmlSecBnFromString(xmlSecBnPtr bn, const xmlChar* str, xmlSecSize base) {
         ret = xmlSecBnAdd(bn, 1);
         if(ret < 0) {
             xmlSecInternalError2("xmlSecBnAdd", NULL, "base=" XMLSEC_SIZE_FMT, base);
-            return (-1);
+            goto done;
         }
     }
 
-    return(0);
+    /* success */
+    res = 0;
+
+done:
+    if(limbs != NULL) {
+        xmlFree(limbs);
+    }
+    return(res);
 }
 
 /**
@@ -309,55 +444,46 @@ xmlSecBnFromString(xmlSecBnPtr bn, const xmlChar* str, xmlSecSize base) {
  */
 xmlChar*
 xmlSecBnToString(xmlSecBnPtr bn, xmlSecSize base) {
-    xmlSecBn bn2;
+    xmlSecBnLimb* limbs = NULL;
+    xmlSecSize limbsNum;
+    xmlSecBnLimb chunk, chunkDiv, baseLimb, carry;
+    xmlSecSize chunkDigits;
     int positive = 1;
-    xmlChar* res;
-    xmlSecSize ii, len, size;
+    xmlChar* res = NULL;
+    xmlSecSize ii, jj, len, size;
     xmlSecByte* data;
-    int baseInt;
-    int ret;
-    int nn;
     xmlChar ch;
 
     xmlSecAssert2(bn != NULL, NULL);
     xmlSecAssert2(base > 1, NULL);
     xmlSecAssert2(base <= XMLSEC_BN_REV_MAX, NULL);
 
-    XMLSEC_SAFE_CAST_SIZE_TO_INT(base, baseInt, return(NULL), NULL);
+    baseLimb = (xmlSecBnLimb)base;
 
-    /* copy bn */
-    data = xmlSecBufferGetData(bn);
-    size = xmlSecBufferGetSize(bn);
-    ret = xmlSecBnInitialize(&bn2, size);
-    if(ret < 0) {
-        xmlSecInternalError2("xmlSecBnInitialize", NULL, "size=" XMLSEC_SIZE_FMT, size);
-        return (NULL);
+    /* the max number of digits that fit in a limb */
+    for(chunkDiv = baseLimb, chunkDigits = 1; chunkDiv <= XMLSEC_BN_LIMB_MAX / baseLimb; ++chunkDigits) {
+        chunkDiv *= baseLimb;
     }
 
-    ret = xmlSecBnSetData(&bn2, data, size);
-    if(ret < 0) {
-        xmlSecInternalError2("xmlSecBnSetData", NULL, "size=" XMLSEC_SIZE_FMT, size);
-        xmlSecBnFinalize(&bn2);
+    data = xmlSecBufferGetData(bn);
+    size = xmlSecBufferGetSize(bn);
+    limbs = (xmlSecBnLimb*)xmlMalloc((size / XMLSEC_BN_LIMB_SIZE + 1) * sizeof(xmlSecBnLimb));
+    if(limbs == NULL) {
+        xmlSecMallocError((size / XMLSEC_BN_LIMB_SIZE + 1) * sizeof(xmlSecBnLimb), NULL);
         return (NULL);
     }
 
     /* check if it is a negative number or not */
-    data = xmlSecBufferGetData(&bn2);
-    size = xmlSecBufferGetSize(&bn2);
     if((size > 0) && (data[0] > 127)) {
-        /* subtract 1 and do 2's compliment */
-        ret = xmlSecBnAdd(&bn2, -1);
-        if(ret < 0) {
-            xmlSecInternalError2("xmlSecBnAdd", NULL, "size=" XMLSEC_SIZE_FMT, size);
-            xmlSecBnFinalize(&bn2);
-            return (NULL);
+        /* do 2's compliment and add 1 */
+        limbsNum = xmlSecBnLimbsFromBytes(limbs, data, size, 0xFF);
+        carry = xmlSecBnLimbsMulAdd(limbs, limbsNum, 1, 1);
+        if(carry != 0) {
+            limbs[limbsNum++] = carry;
         }
-        for(ii = 0; ii < size; ++ii) {
-            data[ii] ^= 0xFF;
-        }
-
         positive = 0;
     } else {
+        limbsNum = xmlSecBnLimbsFromBytes(limbs, data, size, 0);
         positive = 1;
     }
 
@@ -365,26 +491,27 @@ xmlSecBnToString(xmlSecBnPtr bn, xmlSecSize base) {
      *      len = log base (256) * <bn size>
      * Since the smallest base == 2 then we can get away with
      *      len = 8 * <bn size>
+     * The last chunk of digits might have leading zeros.
      */
-    len = 8 * size + 1 + 1;
+    len = 8 * size + chunkDigits + 1 + 1;
     res = (xmlChar*)xmlMalloc(len + 1);
     if(res == NULL) {
         xmlSecMallocError(len + 1, NULL);
-        xmlSecBnFinalize(&bn2);
+        xmlFree(limbs);
         return (NULL);
     }
     memset(res, 0, len + 1);
 
-    for(ii = 0; (xmlSecBufferGetSize(&bn2) > 0) && (ii < len); ii++) {
-        if(xmlSecBnDiv(&bn2, baseInt, &nn) < 0) {
-            xmlSecInternalError2("xmlSecBnDiv", NULL, "base=" XMLSEC_SIZE_FMT, base);
-            xmlFree(res);
-            xmlSecBnFinalize(&bn2);
-            return (NULL);
+    for(ii = 0; limbsNum > 0; ) {
+        chunk = xmlSecBnLimbsDiv(limbs, &limbsNum, chunkDiv);
+        for(jj = 0; jj < chunkDigits; ++jj, ++ii) {
+            xmlSecAssert2(ii < len, NULL);
+            res[ii] = xmlSecBnRevLookupTable[chunk % baseLimb];
+            chunk /= baseLimb;
         }
-        xmlSecAssert2(0 <= nn, NULL);
-        xmlSecAssert2(nn < XMLSEC_BN_REV_MAX, NULL);
-        res[ii] = xmlSecBnRevLookupTable[nn];
+    }
+    if((ii == 0) && (size > 0)) {
+        res[ii++] = '0';
     }
     xmlSecAssert2(ii < len, NULL);
 
@@ -406,7 +533,7 @@ xmlSecBnToString(xmlSecBnPtr bn, xmlSecSize base) {
         res[len - ii - 1] = ch;
     }
 
-    xmlSecBnFinalize(&bn2);
+    xmlFree(limbs);
     return(res);
 }
 
@@ -26,18 +26,40 @@
 #include <xmlsec/xmltree.h>
 #include <xmlsec/base64.h>
 #include <xmlsec/buffer.h>
+#include <xmlsec/memstats.h>
+#include <xmlsec/secmem.h>
+#include <xmlsec/settings.h>
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "filemap.h"
 
 /*****************************************************************************
  *
  * xmlSecBuffer
  *
  ****************************************************************************/
+#define xmlSecBufferIsInline(buf) \
+    (((buf)->data != NULL) && (((buf)->data - (buf)->offset) == (buf)->inlineData))
+#define xmlSecBufferIsMapped(buf) \
+    (((buf)->data != NULL) && ((buf)->spillSize > 0) && ((buf)->spillFd >= 0))
+/* the spilled data is not counted in the memory stats */
+#define xmlSecBufferGetAllocatedSize(buf) \
+    ((((buf)->data != NULL) && !xmlSecBufferIsInline(buf) && !xmlSecBufferIsMapped(buf)) ? \
+        ((buf)->offset + (buf)->maxSize) : 0)
+
 static xmlSecAllocMode gAllocMode = xmlSecAllocModeDouble;
 static xmlSecSize gInitialSize = 1024;
 
+static void
+xmlSecBufferFreeData(xmlSecByte* data) {
+    if(xmlSecSecureMemIsOwned(data)) {
+        xmlSecSecureMemFree(data);
+    } else {
+        xmlFree(data);
+    }
+}
+
 /**
  * xmlSecBufferSetDefaultAllocMode:
  * @defAllocMode:       the new default buffer allocation mode.
@@ -53,6 +75,27 @@ xmlSecBufferSetDefaultAllocMode(xmlSecAllocMode defAllocMode, xmlSecSize defInit
     gInitialSize = defInitialSize;
 }
 
+/* the settings attached to the current thread take precedence over the globals */
+static xmlSecAllocMode
+xmlSecBufferGetDefaultAllocMode(void) {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_BUFFER_ALLOC_MODE) != 0)) {
+        return(settings->bufferAllocMode);
+    }
+    return(gAllocMode);
+}
+
+static xmlSecSize
+xmlSecBufferGetDefaultInitialSize(void) {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_BUFFER_ALLOC_MODE) != 0)) {
+        return(settings->bufferInitialSize);
+    }
+    return(gInitialSize);
+}
+
 /**
  * xmlSecBufferCreate:
  * @size:               the intial size.
@@ -73,6 +116,12 @@ xmlSecBufferCreate(xmlSecSize size) {
         xmlSecMallocError(sizeof(xmlSecBuffer), NULL);
         return(NULL);
     }
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagBuffer, 0, sizeof(xmlSecBuffer)) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate", NULL);
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagBuffer, sizeof(xmlSecBuffer), 0);
+        xmlFree(buf);
+        return(NULL);
+    }
 
     ret = xmlSecBufferInitialize(buf, size);
     if(ret < 0) {
@@ -94,6 +143,7 @@ xmlSecBufferDestroy(xmlSecBufferPtr buf) {
     xmlSecAssert(buf != NULL);
 
     xmlSecBufferFinalize(buf);
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagBuffer, sizeof(xmlSecBuffer), 0);
     xmlFree(buf);
 }
 
@@ -113,7 +163,11 @@ xmlSecBufferInitialize(xmlSecBufferPtr buf, xmlSecSize size) {
 
     buf->data = NULL;
     buf->size = buf->maxSize = 0;
-    buf->allocMode = gAllocMode;
+    buf->allocMode = xmlSecBufferGetDefaultAllocMode();
+    buf->offset = 0;
+    buf->zeroMode = xmlSecBufferZeroModeAlways;
+    buf->spillSize = 0;
+    buf->spillFd = -1;
 
     return(xmlSecBufferSetMaxSize(buf, size));
 }
@@ -129,15 +183,53 @@ void
 xmlSecBufferFinalize(xmlSecBufferPtr buf) {
     xmlSecAssert(buf != NULL);
 
+    if(xmlSecBufferIsMapped(buf)) {
+        /* the temporary file is discarded, only the data written to it is zeroed */
+        if((buf->zeroMode != xmlSecBufferZeroModeNever) && ((buf->offset + buf->size) > 0)) {
+            memset(buf->data - buf->offset, 0, buf->offset + buf->size);
+        }
+        xmlSecTempMapDestroy(buf->spillFd, buf->data - buf->offset, (size_t)(buf->offset + buf->maxSize));
+        buf->spillFd = -1;
+        buf->data = NULL;
+        buf->size = buf->maxSize = buf->offset = 0;
+        return;
+    }
+
     xmlSecBufferEmpty(buf);
 
-    if(buf->data != 0) {
-        xmlFree(buf->data);
+    if((buf->data != 0) && !xmlSecBufferIsInline(buf)) {
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagBuffer, xmlSecBufferGetAllocatedSize(buf), 0);
+        xmlSecBufferFreeData(buf->data);
     }
     buf->data = NULL;
     buf->size = buf->maxSize = 0;
 }
 
+/* moves the data back to the beginning of the allocated memory */
+static void
+xmlSecBufferCompact(xmlSecBufferPtr buf) {
+    xmlSecByte* start;
+
+    xmlSecAssert(buf != NULL);
+
+    if(buf->offset == 0) {
+        return;
+    }
+    xmlSecAssert(buf->data != NULL);
+
+    start = buf->data - buf->offset;
+    if(buf->size > 0) {
+        memmove(start, buf->data, buf->size);
+    }
+    if(buf->zeroMode == xmlSecBufferZeroModeAlways) {
+        memset(start + buf->size, 0, buf->offset + buf->maxSize - buf->size);
+    }
+
+    buf->data = start;
+    buf->maxSize += buf->offset;
+    buf->offset = 0;
+}
+
 /**
  * xmlSecBufferEmpty:
  * @buf:                the pointer to buffer object.
@@ -150,11 +242,101 @@ xmlSecBufferEmpty(xmlSecBufferPtr buf) {
 
     if(buf->data != 0) {
         xmlSecAssert(buf->maxSize > 0);
-        memset(buf->data, 0, buf->maxSize);
+
+        /* rewind to the beginning of the allocated memory */
+        buf->data -= buf->offset;
+        buf->maxSize += buf->offset;
+        buf->offset = 0;
+
+        if(buf->zeroMode != xmlSecBufferZeroModeNever) {
+            memset(buf->data, 0, buf->maxSize);
+        }
     }
     buf->size = 0;
 }
 
+/**
+ * xmlSecBufferSetZeroMode:
+ * @buf:                the pointer to buffer object.
+ * @zeroMode:           the new zeroing mode.
+ *
+ * Sets the memory zeroing mode for @buf. The #xmlSecBufferZeroModeOnFree
+ * mode avoids touching the memory twice on growth while still zeroing
+ * it on release, the #xmlSecBufferZeroModeNever mode should only be used
+ * for buffers that never hold secret data. The #xmlSecBufferZeroModeSecure
+ * mode moves the already allocated data to the secure memory arena.
+ */
+void
+xmlSecBufferSetZeroMode(xmlSecBufferPtr buf, xmlSecBufferZeroMode zeroMode) {
+    xmlSecByte* newData;
+    xmlSecSize oldSize, allocSize = 0;
+
+    xmlSecAssert(buf != NULL);
+
+    if((zeroMode == xmlSecBufferZeroModeSecure) && (buf->zeroMode != xmlSecBufferZeroModeSecure) &&
+       (buf->data != NULL) && !xmlSecBufferIsMapped(buf) && !xmlSecSecureMemIsOwned(buf->data))
+    {
+        xmlSecBufferCompact(buf);
+
+        /* the data stays where it is if it doesn't fit into the arena */
+        newData = (xmlSecByte*)xmlSecSecureMemAlloc(buf->maxSize, &allocSize);
+        if(newData != NULL) {
+            oldSize = xmlSecBufferGetAllocatedSize(buf);
+            if(buf->size > 0) {
+                memcpy(newData, buf->data, buf->size);
+            }
+            memset(buf->data, 0, buf->maxSize);
+            if(!xmlSecBufferIsInline(buf)) {
+                xmlFree(buf->data);
+            }
+            buf->data = newData;
+            buf->maxSize = allocSize;
+            xmlSecMemStatsUpdate(xmlSecMemStatsTagBuffer, oldSize, allocSize);
+        }
+    }
+    buf->zeroMode = zeroMode;
+}
+
+/**
+ * xmlSecBufferSetSpillSize:
+ * @buf:                the pointer to buffer object.
+ * @spillSize:          the allocated size above which the data is spilled
+ *                      or 0 to always keep the data in memory.
+ *
+ * Allows @buf to move its data to an anonymous temporary file (in the
+ * TMPDIR directory or in /tmp) once the buffer needs to allocate more
+ * than @spillSize bytes. The spilled data is mapped in memory, so
+ * #xmlSecBufferGetData still returns a contiguous view of the data and
+ * all the other buffer functions work as usual, but the pages are backed
+ * by the file and can be evicted by the kernel rather than counted against
+ * the process memory (the spilled data is not counted in #xmlSecMemStats
+ * either). The data stays in memory if the temporary file can not be
+ * created or on the platforms without memory mapping support.
+ */
+void
+xmlSecBufferSetSpillSize(xmlSecBufferPtr buf, xmlSecSize spillSize) {
+    xmlSecAssert(buf != NULL);
+    xmlSecAssert(!xmlSecBufferIsMapped(buf));
+
+    buf->spillSize = spillSize;
+}
+
+/**
+ * xmlSecBufferIsSpilled:
+ * @buf:                the pointer to buffer object.
+ *
+ * Checks if the @buf data was moved to a temporary file (see
+ * #xmlSecBufferSetSpillSize).
+ *
+ * Returns: 1 if the buffer data is spilled or 0 otherwise.
+ */
+int
+xmlSecBufferIsSpilled(xmlSecBufferPtr buf) {
+    xmlSecAssert2(buf != NULL, 0);
+
+    return(xmlSecBufferIsMapped(buf) ? 1 : 0);
+}
+
 /**
  * xmlSecBufferIsEmpty:
  * @buf:                the pointer to buffer object.
@@ -273,6 +455,91 @@ xmlSecBufferGetMaxSize(xmlSecBufferPtr buf) {
     return(buf->maxSize);
 }
 
+/* moves the data to the temporary file (or grows the file): returns 0 if the
+ * data is spilled, 1 if the data should stay in memory or -1 on error */
+static int
+xmlSecBufferSpill(xmlSecBufferPtr buf, xmlSecSize newSize) {
+    xmlSecByte* newData;
+    xmlSecSize oldSize;
+    int fd = -1;
+
+    xmlSecAssert2(buf != NULL, -1);
+    xmlSecAssert2(buf->offset == 0, -1);
+    xmlSecAssert2(newSize > buf->maxSize, -1);
+
+    if(xmlSecBufferIsMapped(buf)) {
+        newData = xmlSecTempMapResize(buf->spillFd, buf->data, (size_t)buf->maxSize, (size_t)newSize);
+        if(newData == NULL) {
+            xmlSecIOError("xmlSecTempMapResize", NULL, NULL);
+            return(-1);
+        }
+        /* the file grows with zeros */
+        if((buf->size < buf->maxSize) && (buf->zeroMode == xmlSecBufferZeroModeAlways)) {
+            memset(newData + buf->size, 0, buf->maxSize - buf->size);
+        }
+        buf->data = newData;
+        buf->maxSize = newSize;
+        return(0);
+    }
+
+    newData = xmlSecTempMapCreate((size_t)newSize, &fd);
+    if(newData == NULL) {
+        return(1);
+    }
+    oldSize = xmlSecBufferGetAllocatedSize(buf);
+    if(buf->data != NULL) {
+        if(buf->size > 0) {
+            memcpy(newData, buf->data, buf->size);
+        }
+        if(buf->zeroMode != xmlSecBufferZeroModeNever) {
+            memset(buf->data, 0, buf->maxSize);
+        }
+        if(!xmlSecBufferIsInline(buf)) {
+            xmlSecBufferFreeData(buf->data);
+        }
+    }
+
+    buf->data = newData;
+    buf->maxSize = newSize;
+    buf->spillFd = fd;
+
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagBuffer, oldSize, 0);
+    return(0);
+}
+
+/* moves the data to the new memory from the secure memory arena (or from the heap
+ * if it doesn't fit): the secure memory is never reallocated in place */
+static xmlSecByte*
+xmlSecBufferSecureRealloc(xmlSecBufferPtr buf, xmlSecSize* newSize) {
+    xmlSecByte* newData;
+    xmlSecSize allocSize = 0;
+
+    xmlSecAssert2(buf != NULL, NULL);
+    xmlSecAssert2(buf->offset == 0, NULL);
+    xmlSecAssert2(newSize != NULL, NULL);
+
+    newData = (xmlSecByte*)xmlSecSecureMemAlloc((*newSize), &allocSize);
+    if(newData != NULL) {
+        (*newSize) = allocSize;
+    } else {
+        newData = (xmlSecByte*)xmlMalloc(*newSize);
+        if(newData == NULL) {
+            return(NULL);
+        }
+    }
+
+    if(buf->data != NULL) {
+        if(buf->size > 0) {
+            memcpy(newData, buf->data, buf->size);
+        }
+        memset(buf->data, 0, buf->maxSize);
+        if(!xmlSecBufferIsInline(buf)) {
+            xmlSecBufferFreeData(buf->data);
+        }
+    }
+    return(newData);
+}
+
 /**
  * xmlSecBufferSetMaxSize:
  * @buf:                the pointer to buffer object.
@@ -287,12 +554,23 @@ int
 xmlSecBufferSetMaxSize(xmlSecBufferPtr buf, xmlSecSize size) {
     xmlSecByte* newData;
     xmlSecSize newSize = 0;
+    xmlSecSize minSize;
+    xmlSecSize oldSize;
+    int ret;
 
     xmlSecAssert2(buf != NULL, -1);
     if(size <= buf->maxSize) {
         return(0);
     }
 
+    /* reclaim the removed head first */
+    if(buf->offset > 0) {
+        xmlSecBufferCompact(buf);
+        if(size <= buf->maxSize) {
+            return(0);
+        }
+    }
+
     switch(buf->allocMode) {
         case xmlSecAllocModeExact:
             newSize = size + 8;
@@ -302,12 +580,48 @@ xmlSecBufferSetMaxSize(xmlSecBufferPtr buf, xmlSecSize size) {
             break;
     }
 
-    if(newSize < gInitialSize) {
-        newSize = gInitialSize;
+    /* small buffers start in the inline storage (but the key material goes to the arena) */
+    if((buf->data == NULL) && (size <= XMLSEC_BUFFER_INLINE_SIZE) && (buf->zeroMode != xmlSecBufferZeroModeSecure)) {
+        buf->data = buf->inlineData;
+        buf->maxSize = XMLSEC_BUFFER_INLINE_SIZE;
+        if(buf->zeroMode == xmlSecBufferZeroModeAlways) {
+            memset(buf->data, 0, buf->maxSize);
+        }
+        return(0);
     }
 
+    /* the keys are small, the arena size classes are used instead of the min size */
+    minSize = xmlSecBufferGetDefaultInitialSize();
+    if((newSize < minSize) && (buf->zeroMode != xmlSecBufferZeroModeSecure)) {
+        newSize = minSize;
+    }
 
-    if(buf->data != NULL) {
+    /* large buffers move to the temporary file (the key material never does) */
+    if(((buf->spillSize > 0) && (newSize > buf->spillSize) && (buf->zeroMode != xmlSecBufferZeroModeSecure)) ||
+        xmlSecBufferIsMapped(buf))
+    {
+        ret = xmlSecBufferSpill(buf, newSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSpill", NULL, "size=" XMLSEC_SIZE_FMT, newSize);
+            return(-1);
+        } else if(ret == 0) {
+            return(0);
+        }
+    }
+
+    oldSize = xmlSecBufferGetAllocatedSize(buf);
+    if((buf->zeroMode == xmlSecBufferZeroModeSecure) || xmlSecSecureMemIsOwned(buf->data)) {
+        newData = xmlSecBufferSecureRealloc(buf, &newSize);
+    } else if(xmlSecBufferIsInline(buf)) {
+        /* offset is 0 after compaction */
+        newData = (xmlSecByte*)xmlMalloc(newSize);
+        if(newData != NULL) {
+            memcpy(newData, buf->data, buf->size);
+            if(buf->zeroMode != xmlSecBufferZeroModeNever) {
+                memset(buf->inlineData, 0, sizeof(buf->inlineData));
+            }
+        }
+    } else if(buf->data != NULL) {
         newData = (xmlSecByte*)xmlRealloc(buf->data, newSize);
     } else {
         newData = (xmlSecByte*)xmlMalloc(newSize);
@@ -320,11 +634,16 @@ xmlSecBufferSetMaxSize(xmlSecBufferPtr buf, xmlSecSize size) {
     buf->data = newData;
     buf->maxSize = newSize;
 
-    if(buf->size < buf->maxSize) {
+    if((buf->size < buf->maxSize) && (buf->zeroMode == xmlSecBufferZeroModeAlways)) {
         xmlSecAssert2(buf->data != NULL, -1);
         memset(buf->data + buf->size, 0, buf->maxSize - buf->size);
     }
 
+    /* the memory is owned by the buffer even if the limit is exceeded */
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagBuffer, oldSize, newSize) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate", NULL);
+        return(-1);
+    }
     return(0);
 }
 
@@ -339,13 +658,86 @@ xmlSecBufferSetMaxSize(xmlSecBufferPtr buf, xmlSecSize size) {
  */
 void
 xmlSecBufferSwap(xmlSecBufferPtr buf1, xmlSecBufferPtr buf2) {
+    xmlSecByte inlineTmp[XMLSEC_BUFFER_INLINE_SIZE];
+    int inline1, inline2;
+
     xmlSecAssert(buf1 != NULL);
     xmlSecAssert(buf2 != NULL);
 
+    /* the inline data has to be moved rather than pointed to */
+    inline1 = xmlSecBufferIsInline(buf1);
+    inline2 = xmlSecBufferIsInline(buf2);
+    if(inline1 || inline2) {
+        memcpy(inlineTmp, buf1->inlineData, sizeof(inlineTmp));
+        memcpy(buf1->inlineData, buf2->inlineData, sizeof(inlineTmp));
+        memcpy(buf2->inlineData, inlineTmp, sizeof(inlineTmp));
+        memset(inlineTmp, 0, sizeof(inlineTmp));
+        if(inline1) {
+            buf1->data = buf2->inlineData + (buf1->data - buf1->inlineData);
+        }
+        if(inline2) {
+            buf2->data = buf1->inlineData + (buf2->data - buf2->inlineData);
+        }
+    }
+
     SWAP(xmlSecByte*,       buf1->data, buf2->data);
     SWAP(xmlSecSize,        buf1->size, buf2->size);
     SWAP(xmlSecSize,        buf1->maxSize, buf2->maxSize);
     SWAP(xmlSecAllocMode,   buf1->allocMode, buf2->allocMode);
+    SWAP(xmlSecSize,        buf1->offset, buf2->offset);
+    SWAP(xmlSecBufferZeroMode, buf1->zeroMode, buf2->zeroMode);
+    SWAP(xmlSecSize,        buf1->spillSize, buf2->spillSize);
+    SWAP(int,               buf1->spillFd, buf2->spillFd);
+}
+
+/**
+ * xmlSecBufferDetachString:
+ * @buf:                the pointer to buffer object.
+ *
+ * Terminates the buffer data with '\0' and detaches it from @buf, the buffer
+ * is left empty. The data is not copied unless it is small enough to be
+ * stored inside the buffer object. The caller is responsible for freeing
+ * the returned string with xmlFree function (e.g. by passing it
+ * to #xmlSecNodeAdoptContent).
+ *
+ * Returns: the buffer data or NULL if an error occurs.
+ */
+xmlChar*
+xmlSecBufferDetachString(xmlSecBufferPtr buf) {
+    xmlChar* res;
+    xmlSecSize size;
+    int ret;
+
+    xmlSecAssert2(buf != NULL, NULL);
+
+    size = buf->size;
+    ret = xmlSecBufferSetMaxSize(buf, size + 1);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetMaxSize", NULL,
+            "size=" XMLSEC_SIZE_FMT, size + 1);
+        return(NULL);
+    }
+    xmlSecBufferCompact(buf);
+
+    /* the inline storage, the temporary file mapping and the secure memory can't be detached */
+    if(xmlSecBufferIsInline(buf) || xmlSecBufferIsMapped(buf) || xmlSecSecureMemIsOwned(buf->data)) {
+        res = (xmlChar*)xmlMalloc(size + 1);
+        if(res == NULL) {
+            xmlSecMallocError(size + 1, NULL);
+            return(NULL);
+        }
+        memcpy(res, buf->data, size);
+        res[size] = '\0';
+        xmlSecBufferEmpty(buf);
+        return(res);
+    }
+
+    res = buf->data;
+    res[size] = '\0';
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagBuffer, xmlSecBufferGetAllocatedSize(buf), 0);
+    buf->data = NULL;
+    buf->size = buf->maxSize = 0;
+    return(res);
 }
 
 /**
@@ -400,6 +792,18 @@ xmlSecBufferPrepend(xmlSecBufferPtr buf, const xmlSecByte* data, xmlSecSize size
     if(size > 0) {
         xmlSecAssert2(data != NULL, -1);
 
+        /* reuse the removed head if possible */
+        if(size <= buf->offset) {
+            xmlSecAssert2(buf->data != NULL, -1);
+
+            buf->data -= size;
+            buf->offset -= size;
+            buf->maxSize += size;
+            memcpy(buf->data, data, size);
+            buf->size += size;
+            return(0);
+        }
+
         ret = xmlSecBufferSetMaxSize(buf, buf->size + size);
         if(ret < 0) {
             xmlSecInternalError2("xmlSecBufferSetMaxSize", NULL,
@@ -420,7 +824,9 @@ xmlSecBufferPrepend(xmlSecBufferPtr buf, const xmlSecByte* data, xmlSecSize size
  * @buf:                the pointer to buffer object.
  * @size:               the number of bytes to be removed.
  *
- * Removes @size bytes from the beginning of the current buffer.
+ * Removes @size bytes from the beginning of the current buffer. The data
+ * is not moved: the removed bytes are zeroed and skipped, the memory is
+ * reclaimed when the buffer grows or becomes empty.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
@@ -431,14 +837,15 @@ xmlSecBufferRemoveHead(xmlSecBufferPtr buf, xmlSecSize size) {
     if(size < buf->size) {
         xmlSecAssert2(buf->data != NULL, -1);
 
+        if(buf->zeroMode == xmlSecBufferZeroModeAlways) {
+            memset(buf->data, 0, size);
+        }
+        buf->data += size;
+        buf->offset += size;
+        buf->maxSize -= size;
         buf->size -= size;
-        memmove(buf->data, buf->data + size, buf->size);
     } else {
-        buf->size = 0;
-    }
-    if(buf->size < buf->maxSize) {
-        xmlSecAssert2(buf->data != NULL, -1);
-        memset(buf->data + buf->size, 0, buf->maxSize - buf->size);
+        xmlSecBufferEmpty(buf);
     }
     return(0);
 }
@@ -461,7 +868,7 @@ xmlSecBufferRemoveTail(xmlSecBufferPtr buf, xmlSecSize size) {
     } else {
         buf->size = 0;
     }
-    if(buf->size < buf->maxSize) {
+    if((buf->size < buf->maxSize) && (buf->zeroMode == xmlSecBufferZeroModeAlways)) {
         xmlSecAssert2(buf->data != NULL, -1);
         memset(buf->data + buf->size, 0, buf->maxSize - buf->size);
     }
@@ -516,6 +923,7 @@ xmlSecBufferReverse(xmlSecBufferPtr buf) {
 int
 xmlSecBufferReadFile(xmlSecBufferPtr buf, const char* filename) {
     xmlSecByte buffer[1024];
+    xmlSecFileMap map;
     FILE* f = NULL;
     xmlSecSize size;
     size_t len;
@@ -525,6 +933,16 @@ xmlSecBufferReadFile(xmlSecBufferPtr buf, const char* filename) {
     xmlSecAssert2(buf != NULL, -1);
     xmlSecAssert2(filename != NULL, -1);
 
+    /* copy regular files in one step from the memory mapping */
+    if(xmlSecFileMapOpen(&map, filename) == 1) {
+        ret = xmlSecBufferAppend(buf, map.data, map.size);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferAppend", NULL, "size=" XMLSEC_SIZE_FMT, map.size);
+        }
+        xmlSecFileMapClose(&map);
+        return((ret < 0) ? -1 : 0);
+    }
+
 #ifndef _MSC_VER
     f = fopen(filename, "rb");
 #else
@@ -560,50 +978,116 @@ done:
     return(res);
 }
 
+/* the state of the node content base64 decoding */
+typedef struct _xmlSecBufferBase64ReadCtx {
+    xmlSecBufferPtr     buf;
+    xmlSecBase64CtxPtr  base64Ctx;
+} xmlSecBufferBase64ReadCtx;
+
+static int
+xmlSecBufferBase64NodeContentReadSegment(const xmlChar* data, xmlSecSize size, void* context) {
+    xmlSecBufferBase64ReadCtx* readCtx = (xmlSecBufferBase64ReadCtx*)context;
+    xmlSecSize bufSize, outWritten;
+    int ret;
+
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(readCtx != NULL, -1);
+    xmlSecAssert2(readCtx->buf != NULL, -1);
+    xmlSecAssert2(readCtx->base64Ctx != NULL, -1);
+
+    if(size == 0) {
+        return(0);
+    }
+
+    /* base64 decode size is less than input size (plus the partial
+     * quad left in the context from the previous segment) */
+    bufSize = xmlSecBufferGetSize(readCtx->buf);
+    ret = xmlSecBufferSetMaxSize(readCtx->buf, bufSize + size + 4);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetMaxSize", NULL,
+            "size=" XMLSEC_SIZE_FMT, bufSize + size + 4);
+        return(-1);
+    }
+
+    ret = xmlSecBase64CtxUpdate_ex(readCtx->base64Ctx, data, size,
+        xmlSecBufferGetData(readCtx->buf) + bufSize,
+        xmlSecBufferGetMaxSize(readCtx->buf) - bufSize, &outWritten);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBase64CtxUpdate_ex", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecBufferSetSize(readCtx->buf, bufSize + outWritten);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetSize", NULL,
+            "size=" XMLSEC_SIZE_FMT, bufSize + outWritten);
+        return(-1);
+    }
+    return(0);
+}
+
 /**
  * xmlSecBufferBase64NodeContentRead:
  * @buf:                the pointer to buffer object.
  * @node:               the pointer to node.
  *
  * Reads the content of the @node, base64 decodes it and stores the
- * result in the buffer.
+ * result in the buffer. The text children of the @node are decoded
+ * in place (i.e. the node content is not copied into a string first).
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
 int
 xmlSecBufferBase64NodeContentRead(xmlSecBufferPtr buf, xmlNodePtr node) {
-    xmlChar* content = NULL;
-    xmlSecSize outWritten;
+    xmlSecBufferBase64ReadCtx readCtx;
+    xmlSecSize bufSize, outWritten;
     int ret;
     int res = -1;
 
     xmlSecAssert2(buf != NULL, -1);
     xmlSecAssert2(node != NULL, -1);
 
-    content = xmlNodeGetContent(node);
-    if(content == NULL) {
-        xmlSecInvalidNodeContentError(node, NULL, "empty");
+    memset(&readCtx, 0, sizeof(readCtx));
+    readCtx.buf = buf;
+    readCtx.base64Ctx = xmlSecBase64CtxCreate(0, 0);
+    if(readCtx.base64Ctx == NULL) {
+        xmlSecInternalError("xmlSecBase64CtxCreate", NULL);
         goto done;
     }
 
-    /* base64 decode size is less than input size */
-    ret = xmlSecBufferSetMaxSize(buf, xmlSecStrlen(content));
+    ret = xmlSecBufferSetSize(buf, 0);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecBufferSetMaxSize", NULL);
+        xmlSecInternalError("xmlSecBufferSetSize", NULL);
         goto done;
     }
 
-    ret = xmlSecBase64Decode_ex(content, xmlSecBufferGetData(buf),
-        xmlSecBufferGetMaxSize(buf), &outWritten);
+    ret = xmlSecNodeContentForEach(node, xmlSecBufferBase64NodeContentReadSegment, &readCtx);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecBase64Decode_ex", NULL);
+        xmlSecInternalError2("xmlSecNodeContentForEach", NULL,
+            "node=%s", xmlSecErrorsSafeString(xmlSecNodeGetName(node)));
         goto done;
     }
 
-    ret = xmlSecBufferSetSize(buf, outWritten);
+    /* final needs at least one byte in the output */
+    bufSize = xmlSecBufferGetSize(buf);
+    ret = xmlSecBufferSetMaxSize(buf, bufSize + 1);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetMaxSize", NULL,
+            "size=" XMLSEC_SIZE_FMT, bufSize + 1);
+        goto done;
+    }
+
+    ret = xmlSecBase64CtxFinal_ex(readCtx.base64Ctx, xmlSecBufferGetData(buf) + bufSize,
+        xmlSecBufferGetMaxSize(buf) - bufSize, &outWritten);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBase64CtxFinal_ex", NULL);
+        goto done;
+    }
+
+    ret = xmlSecBufferSetSize(buf, bufSize + outWritten);
     if(ret < 0) {
         xmlSecInternalError2("xmlSecBufferSetSize", NULL,
-            "size=" XMLSEC_SIZE_FMT, outWritten);
+            "size=" XMLSEC_SIZE_FMT, bufSize + outWritten);
         goto done;
     }
 
@@ -611,8 +1095,8 @@ xmlSecBufferBase64NodeContentRead(xmlSecBufferPtr buf, xmlNodePtr node) {
     res = 0;
 
 done:
-    if(content != NULL) {
-        xmlFree(content);
+    if(readCtx.base64Ctx != NULL) {
+        xmlSecBase64CtxDestroy(readCtx.base64Ctx);
     }
     return(res);
 }
@@ -630,6 +1114,7 @@ done:
 int
 xmlSecBufferBase64NodeContentWrite(xmlSecBufferPtr buf, xmlNodePtr node, int columns) {
     xmlChar* content;
+    int ret;
 
     xmlSecAssert2(buf != NULL, -1);
     xmlSecAssert2(node != NULL, -1);
@@ -640,8 +1125,12 @@ xmlSecBufferBase64NodeContentWrite(xmlSecBufferPtr buf, xmlNodePtr node, int col
         return(-1);
     }
 
-    xmlNodeAddContent(node, content);
-    xmlFree(content);
+    /* the node takes the encoded string as is */
+    ret = xmlSecNodeAdoptContent(node, content);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecNodeAdoptContent", NULL);
+        return(-1);
+    }
 
     return(0);
 }
@@ -23,10 +23,12 @@
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/list.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/xmltree.h>
 #include <xmlsec/errors.h>
 
+#include "c14n_native.h"
 #include "cast_helpers.h"
 
 /******************************************************************************
@@ -74,6 +76,7 @@ static int              xmlSecTransformC14NPopBin       (xmlSecTransformPtr tran
 static int              xmlSecTransformC14NExecute      (xmlSecTransformId id,
                                                          xmlSecNodeSetPtr nodes,
                                                          xmlSecPtrListPtr nsList,
+                                                         int useLibxml2,
                                                          xmlOutputBufferPtr buf);
 static int
 xmlSecTransformC14NInitialize(xmlSecTransformPtr transform) {
@@ -227,8 +230,9 @@ xmlSecTransformC14NPushXml(xmlSecTransformPtr transform, xmlSecNodeSetPtr nodes,
         }
     }
 
-    ret = xmlSecTransformC14NExecute(transform->id, nodes,
-            xmlSecC14NGetCtx(transform), buf);
+    ret = xmlSecTransformC14NExecute(transform->id, nodes, xmlSecC14NGetCtx(transform),
+            ((transformCtx->flags & XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N) != 0) ? 1 : 0,
+            buf);
     if(ret < 0) {
         xmlSecInternalError("xmlSecTransformC14NExecute",
                             xmlSecTransformGetName(transform));
@@ -245,6 +249,12 @@ xmlSecTransformC14NPushXml(xmlSecTransformPtr transform, xmlSecNodeSetPtr nodes,
     return(0);
 }
 
+/*
+ * The pop mode requires the whole canonical output to be stored in the
+ * transform's output buffer. To avoid this, #xmlSecTransformCtxXmlExecute
+ * drives the C14N transform in the push mode (see #xmlSecTransformC14NPushXml)
+ * which streams the output directly into the next transform.
+ */
 static int
 xmlSecTransformC14NPopBin(xmlSecTransformPtr transform, xmlSecByte* data,
                             xmlSecSize maxDataSize, xmlSecSize* dataSize,
@@ -288,8 +298,9 @@ xmlSecTransformC14NPopBin(xmlSecTransformPtr transform, xmlSecByte* data,
 
         /* we are using a semi-hack here: we know that xmlSecPtrList keeps
          * all pointers in the big array */
-        ret = xmlSecTransformC14NExecute(transform->id, transform->inNodes,
-                xmlSecC14NGetCtx(transform), buf);
+        ret = xmlSecTransformC14NExecute(transform->id, transform->inNodes, xmlSecC14NGetCtx(transform),
+                ((transformCtx->flags & XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N) != 0) ? 1 : 0,
+                buf);
         if(ret < 0) {
             xmlSecInternalError("xmlSecTransformC14NExecute",
                                 xmlSecTransformGetName(transform));
@@ -342,60 +353,144 @@ xmlSecTransformC14NPopBin(xmlSecTransformPtr transform, xmlSecByte* data,
 }
 
 static int
-xmlSecTransformC14NExecute(xmlSecTransformId id, xmlSecNodeSetPtr nodes, xmlSecPtrListPtr nsList,
-                           xmlOutputBufferPtr buf) {
-    int ret;
-
+xmlSecTransformC14NGetMode(xmlSecTransformId id, xmlSecPtrListPtr nsList, xmlC14NMode* mode,
+                           xmlChar*** inclusiveNsPrefixes, int* withComments) {
     xmlSecAssert2(id != xmlSecTransformIdUnknown, -1);
-    xmlSecAssert2(nodes != NULL, -1);
-    xmlSecAssert2(nodes->doc != NULL, -1);
     xmlSecAssert2(nsList != NULL, -1);
-    xmlSecAssert2(xmlSecPtrListCheckId(nsList, xmlSecStringListId), -1);
-    xmlSecAssert2(buf != NULL, -1);
+    xmlSecAssert2(mode != NULL, -1);
+    xmlSecAssert2(inclusiveNsPrefixes != NULL, -1);
+    xmlSecAssert2(withComments != NULL, -1);
 
-    /* execute c14n transform */
+    (*inclusiveNsPrefixes) = NULL;
     if(id == xmlSecTransformInclC14NId) {
-        ret = xmlC14NExecute(nodes->doc,
-                        (xmlC14NIsVisibleCallback)xmlSecNodeSetContains,
-                        nodes, XML_C14N_1_0, NULL, 0, buf);
+        (*mode) = XML_C14N_1_0;
+        (*withComments) = 0;
     } else if(id == xmlSecTransformInclC14NWithCommentsId) {
-         ret = xmlC14NExecute(nodes->doc,
-                        (xmlC14NIsVisibleCallback)xmlSecNodeSetContains,
-                        nodes, XML_C14N_1_0, NULL, 1, buf);
+        (*mode) = XML_C14N_1_0;
+        (*withComments) = 1;
     } else if(id == xmlSecTransformInclC14N11Id) {
-        ret = xmlC14NExecute(nodes->doc,
-                        (xmlC14NIsVisibleCallback)xmlSecNodeSetContains,
-                        nodes, XML_C14N_1_1, NULL, 0, buf);
+        (*mode) = XML_C14N_1_1;
+        (*withComments) = 0;
     } else if(id == xmlSecTransformInclC14N11WithCommentsId) {
-         ret = xmlC14NExecute(nodes->doc,
-                        (xmlC14NIsVisibleCallback)xmlSecNodeSetContains,
-                        nodes, XML_C14N_1_1, NULL, 1, buf);
+        (*mode) = XML_C14N_1_1;
+        (*withComments) = 1;
     } else if(id == xmlSecTransformExclC14NId) {
+        (*mode) = XML_C14N_EXCLUSIVE_1_0;
+        (*withComments) = 0;
         /* we are using a semi-hack here: we know that xmlSecPtrList keeps
          * all pointers in the big array */
-        ret = xmlC14NExecute(nodes->doc,
-                        (xmlC14NIsVisibleCallback)xmlSecNodeSetContains,
-                        nodes, XML_C14N_EXCLUSIVE_1_0, (xmlChar**)(nsList->data), 0, buf);
+        (*inclusiveNsPrefixes) = (xmlChar**)(nsList->data);
     } else if(id == xmlSecTransformExclC14NWithCommentsId) {
+        (*mode) = XML_C14N_EXCLUSIVE_1_0;
+        (*withComments) = 1;
         /* we are using a semi-hack here: we know that xmlSecPtrList keeps
          * all pointers in the big array */
-        ret = xmlC14NExecute(nodes->doc,
-                        (xmlC14NIsVisibleCallback)xmlSecNodeSetContains,
-                        nodes, XML_C14N_EXCLUSIVE_1_0, (xmlChar**)(nsList->data), 1, buf);
-    } else if(id == xmlSecTransformRemoveXmlTagsC14NId) {
-        ret = xmlSecNodeSetDumpTextNodes(nodes, buf);
+        (*inclusiveNsPrefixes) = (xmlChar**)(nsList->data);
     } else {
         /* shoudn't be possible to come here, actually */
         xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_TRANSFORM,
                          xmlSecTransformKlassGetName(id), NULL);
         return(-1);
     }
+    return(0);
+}
+
+/**
+ * xmlSecTransformC14NGetStreamMode:
+ * @transform:          the pointer to transform.
+ * @transformCtx:       the pointer to transform context.
+ * @mode:               the pointer to the returned C14N mode.
+ * @inclusiveNsPrefixes: the pointer to the returned inclusive namespaces
+ *                      prefixes list (owned by @transform).
+ * @withComments:       the pointer to the returned comments flag.
+ *
+ * Checks if @transform is a C14N transform that is not started yet and
+ * can canonicalize the whole document with the native serializer while
+ * the document is parsed (see #xmlSecC14NNativeStreamCreate). The caller
+ * writes the output into the next transform and marks @transform finished.
+ *
+ * Returns: 1 if @transform can be streamed, 0 if not or a negative value
+ * if an error occurs.
+ */
+int
+xmlSecTransformC14NGetStreamMode(xmlSecTransformPtr transform, xmlSecTransformCtxPtr transformCtx,
+                                 xmlC14NMode* mode, xmlChar*** inclusiveNsPrefixes, int* withComments) {
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    if((!xmlSecTransformC14NCheckId(transform)) ||
+       xmlSecTransformCheckId(transform, xmlSecTransformRemoveXmlTagsC14NId) ||
+       (transform->status != xmlSecTransformStatusNone) ||
+       ((transformCtx->flags & XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N) != 0)) {
+        return(0);
+    }
+    ret = xmlSecTransformC14NGetMode(transform->id, xmlSecC14NGetCtx(transform),
+                                     mode, inclusiveNsPrefixes, withComments);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformC14NGetMode", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    return(1);
+}
+
+/*
+ * The C14N transforms use the native serializer (see c14n_native.c) unless
+ * XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N flag is set or the native
+ * serializer doesn't support the input (C14N 1.1 with xml:base attributes).
+ * In these cases, libxml2 xmlC14NExecute() is used.
+ */
+static int
+xmlSecTransformC14NExecute(xmlSecTransformId id, xmlSecNodeSetPtr nodes, xmlSecPtrListPtr nsList,
+                           int useLibxml2, xmlOutputBufferPtr buf) {
+    xmlSecStatsSpan span;
+    xmlC14NMode mode;
+    xmlChar** inclusiveNsPrefixes = NULL;
+    int withComments;
+    int ret;
 
+    xmlSecAssert2(id != xmlSecTransformIdUnknown, -1);
+    xmlSecAssert2(nodes != NULL, -1);
+    xmlSecAssert2(nodes->doc != NULL, -1);
+    xmlSecAssert2(nsList != NULL, -1);
+    xmlSecAssert2(xmlSecPtrListCheckId(nsList, xmlSecStringListId), -1);
+    xmlSecAssert2(buf != NULL, -1);
+
+    /* execute c14n transform */
+    if(id == xmlSecTransformRemoveXmlTagsC14NId) {
+        ret = xmlSecNodeSetDumpTextNodes(nodes, buf);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecNodeSetDumpTextNodes", xmlSecTransformKlassGetName(id));
+            return(-1);
+        }
+        return(0);
+    }
+    ret = xmlSecTransformC14NGetMode(id, nsList, &mode, &inclusiveNsPrefixes, &withComments);
     if(ret < 0) {
-        xmlSecXmlError("xmlC14NExecute", xmlSecTransformKlassGetName(id));
+        xmlSecInternalError("xmlSecTransformC14NGetMode", xmlSecTransformKlassGetName(id));
         return(-1);
     }
 
+    /* the output is streamed to the next transforms, their time is included */
+    xmlSecStatsPhaseStart(xmlSecStatsPhaseC14N, &span);
+    if((useLibxml2 == 0) && (xmlSecC14NNativeIsSupported(nodes, mode) != 0)) {
+        ret = xmlSecC14NNativeExecute(nodes, mode, inclusiveNsPrefixes, withComments, buf);
+        xmlSecStatsPhaseEnd(&span);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecC14NNativeExecute", xmlSecTransformKlassGetName(id));
+            return(-1);
+        }
+    } else {
+        ret = xmlC14NExecute(nodes->doc,
+                        (xmlC14NIsVisibleCallback)xmlSecNodeSetContains,
+                        nodes, mode, inclusiveNsPrefixes, withComments, buf);
+        xmlSecStatsPhaseEnd(&span);
+        if(ret < 0) {
+            xmlSecXmlError("xmlC14NExecute", xmlSecTransformKlassGetName(id));
+            return(-1);
+        }
+    }
     return(0);
 }
 
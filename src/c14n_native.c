@@ -0,0 +1,2106 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Native C14N serializer.
+ *
+ * The output is the same as the output of libxml2 xmlC14NExecute() with
+ * the xmlSecNodeSetContains() visibility callback. The differences are in
+ * how the output is computed:
+ *   - the in-scope namespaces are maintained incrementally during the
+ *     document walk instead of searching the ancestors for every element;
+ *   - for a single tree nodes set (the most common case, e.g. SignedInfo
+ *     or a same document reference without transforms) the visibility
+ *     is inherited from the parent element during the walk instead of
+ *     checking the nodes set for every node, attribute and namespace;
+ *   - the enveloped signature output (a tree without the <dsig:Signature/>
+ *     subtree) is handled the same way and the excluded subtree is skipped;
+ *   - the attributes values are written without copying when possible;
+ *   - the text is scanned for the characters to replace 16 bytes at a time
+ *     (when SSE2 is available) and the clean runs are written in one call.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#include "globals.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libxml/tree.h>
+#include <libxml/uri.h>
+#include <libxml/c14n.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/nodeset.h>
+#include <xmlsec/xmltree.h>
+#include <xmlsec/errors.h>
+
+#include "c14n_native.h"
+#include "cast_helpers.h"
+#include "docindex_helpers.h"
+
+#define XMLSEC_C14N_NATIVE_INITIAL_SIZE                 16
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define XMLSEC_C14N_NATIVE_USE_SSE2                     1
+#endif /* defined(__SSE2__) && defined(__GNUC__) */
+
+typedef enum {
+    xmlSecC14NNativePosBeforeDocumentElement = 0,
+    xmlSecC14NNativePosInsideDocumentElement,
+    xmlSecC14NNativePosAfterDocumentElement
+} xmlSecC14NNativePos;
+
+typedef enum {
+    xmlSecC14NNativeNormalizeAttr = 0,
+    xmlSecC14NNativeNormalizeText,
+    xmlSecC14NNativeNormalizeComment,
+    xmlSecC14NNativeNormalizePI
+} xmlSecC14NNativeNormalizeMode;
+
+typedef struct _xmlSecC14NNativeRenderedNs {
+    xmlNsPtr                    ns;
+    xmlNodePtr                  node;
+    int                         nodeVisible;
+} xmlSecC14NNativeRenderedNs, *xmlSecC14NNativeRenderedNsPtr;
+
+/* the namespaces state saved by the element start and restored by its end */
+typedef struct _xmlSecC14NNativeElementState {
+    xmlSecSize                  inScopeNsSize;
+    xmlSecSize                  inScopeInclusiveNsCount;
+    xmlSecSize                  renderedNsCurEnd;
+    xmlSecSize                  renderedNsPrevStart;
+    xmlSecSize                  renderedNsPrevEnd;
+    int                         parentIsDoc;
+    int                         visible;
+} xmlSecC14NNativeElementState, *xmlSecC14NNativeElementStatePtr;
+
+typedef struct _xmlSecC14NNativeCtx {
+    xmlSecNodeSetPtr            nodes;
+    xmlC14NMode                 mode;
+    int                         withComments;
+    xmlOutputBufferPtr          buf;
+
+    /* single tree nodes set: visibility is inherited from the parent element */
+    int                         simpleTree;
+    int                         simpleTreeWithoutComments;
+    /* enveloped signature: the subtree excluded from the single tree set */
+    xmlNodePtr                  excludedNode;
+    /* the output after the excluded subtree (see #xmlSecC14NNativeExecuteSplit) */
+    xmlOutputBufferPtr          tailBuf;
+
+    xmlSecC14NNativePos         pos;
+    int                         parentIsDoc;
+
+    /* exclusive c14n: the InclusiveNamespaces PrefixList (NULL is the default namespace) */
+    const xmlChar**             inclusiveNs;
+    xmlSecSize                  inclusiveNsSize;
+    int                         inclusiveNsHasDefault;
+
+    /* nsDef of the current element and all its ancestors */
+    xmlNsPtr*                   inScopeNs;
+    xmlSecSize                  inScopeNsSize;
+    xmlSecSize                  inScopeNsMaxSize;
+    /* the number of the in-scope namespaces with a prefix from the PrefixList */
+    xmlSecSize                  inScopeInclusiveNsCount;
+
+    /* namespaces rendered by the ancestors (same semantics as in libxml2) */
+    xmlSecC14NNativeRenderedNsPtr renderedNs;
+    xmlSecSize                  renderedNsCurEnd;
+    xmlSecSize                  renderedNsPrevStart;
+    xmlSecSize                  renderedNsPrevEnd;
+    xmlSecSize                  renderedNsMaxSize;
+
+    /* sorted namespaces and attributes of the current element */
+    xmlNsPtr*                   nsList;
+    xmlSecSize                  nsListSize;
+    xmlSecSize                  nsListMaxSize;
+    xmlAttrPtr*                 attrList;
+    xmlSecSize                  attrListSize;
+    xmlSecSize                  attrListMaxSize;
+
+    /* the open elements (see #xmlSecC14NNativeStreamStartElement) */
+    xmlSecC14NNativeElementStatePtr elements;
+    xmlSecSize                  elementsSize;
+    xmlSecSize                  elementsMaxSize;
+} xmlSecC14NNativeCtx, *xmlSecC14NNativeCtxPtr;
+
+static int      xmlSecC14NNativeProcessNodeList         (xmlSecC14NNativeCtxPtr ctx,
+                                                         xmlNodePtr first,
+                                                         int parentVisible);
+
+/**************************************************************************
+ *
+ * Helpers
+ *
+ *************************************************************************/
+static void*
+xmlSecC14NNativeGrow(void* items, xmlSecSize* maxSize, xmlSecSize itemSize) {
+    void* newItems;
+    xmlSecSize newMaxSize;
+
+    xmlSecAssert2(maxSize != NULL, NULL);
+    xmlSecAssert2(itemSize > 0, NULL);
+
+    newMaxSize = ((*maxSize) > 0) ? 2 * (*maxSize) : XMLSEC_C14N_NATIVE_INITIAL_SIZE;
+    newItems = xmlRealloc(items, newMaxSize * itemSize);
+    if(newItems == NULL) {
+        xmlSecMallocError(newMaxSize * itemSize, NULL);
+        return(NULL);
+    }
+    (*maxSize) = newMaxSize;
+    return(newItems);
+}
+
+/* same as xmlStrEqual() but NULL is equal to the empty string */
+static int
+xmlSecC14NNativeStrEqual(const xmlChar* str1, const xmlChar* str2) {
+    if(str1 == str2) {
+        return(1);
+    }
+    if(str1 == NULL) {
+        return((*str2) == '\0');
+    }
+    if(str2 == NULL) {
+        return((*str1) == '\0');
+    }
+    return(xmlStrEqual(str1, str2));
+}
+
+static int
+xmlSecC14NNativeIsXmlNs(xmlNsPtr ns) {
+    return((ns != NULL) &&
+        xmlStrEqual(ns->prefix, BAD_CAST "xml") &&
+        xmlStrEqual(ns->href, XML_XML_NAMESPACE));
+}
+
+static int
+xmlSecC14NNativeIsXmlAttr(xmlAttrPtr attr) {
+    return((attr->ns != NULL) && xmlSecC14NNativeIsXmlNs(attr->ns));
+}
+
+/* Returns 1 if the node is visible, 0 if it is not or a negative value if an error occurs.
+ * The @parentVisible is the visibility of the @parent node. */
+static int
+xmlSecC14NNativeIsVisible(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr node, xmlNodePtr parent, int parentVisible) {
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    if(ctx->simpleTree != 0) {
+        if((ctx->simpleTreeWithoutComments != 0) && (node->type == XML_COMMENT_NODE)) {
+            return(0);
+        }
+        if(node == ctx->excludedNode) {
+            return(0);
+        }
+        if((parentVisible != 0) && (parent != NULL) && (parent->type == XML_ELEMENT_NODE)) {
+            return(1);
+        }
+    }
+    return(xmlSecNodeSetContains(ctx->nodes, node, parent));
+}
+
+/**************************************************************************
+ *
+ * Output
+ *
+ *************************************************************************/
+static int
+xmlSecC14NNativeWrite(xmlSecC14NNativeCtxPtr ctx, const xmlChar* data, xmlSecSize size) {
+    int len;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->buf != NULL, -1);
+
+    if(size == 0) {
+        return(0);
+    }
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(size, len, return(-1), NULL);
+    ret = xmlOutputBufferWrite(ctx->buf, len, (const char*)data);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferWrite", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecC14NNativeWriteString(xmlSecC14NNativeCtxPtr ctx, const xmlChar* str) {
+    if(str == NULL) {
+        return(0);
+    }
+    return(xmlSecC14NNativeWrite(ctx, str, strlen((const char*)str)));
+}
+
+/* returns the replacement for the character or NULL if it is written as-is */
+static const char*
+xmlSecC14NNativeGetReplacement(xmlChar ch, xmlSecC14NNativeNormalizeMode mode) {
+    switch(ch) {
+    case '&':
+        if((mode == xmlSecC14NNativeNormalizeAttr) || (mode == xmlSecC14NNativeNormalizeText)) {
+            return("&amp;");
+        }
+        break;
+    case '<':
+        if((mode == xmlSecC14NNativeNormalizeAttr) || (mode == xmlSecC14NNativeNormalizeText)) {
+            return("&lt;");
+        }
+        break;
+    case '>':
+        if(mode == xmlSecC14NNativeNormalizeText) {
+            return("&gt;");
+        }
+        break;
+    case '"':
+        if(mode == xmlSecC14NNativeNormalizeAttr) {
+            return("&quot;");
+        }
+        break;
+    case '\x09':
+        if(mode == xmlSecC14NNativeNormalizeAttr) {
+            return("&#x9;");
+        }
+        break;
+    case '\x0A':
+        if(mode == xmlSecC14NNativeNormalizeAttr) {
+            return("&#xA;");
+        }
+        break;
+    case '\x0D':
+        return("&#xD;");
+    default:
+        break;
+    }
+    return(NULL);
+}
+
+/*
+ * Returns the pointer to the first character in [cur, end) that needs to be
+ * replaced or end if there are none. Most of the text and attribute values
+ * do not have any characters to replace thus the SSE2 (when available) scan
+ * checks 16 bytes at a time and the clean runs are written with one call.
+ */
+static const xmlChar*
+xmlSecC14NNativeFindReplacement(const xmlChar* cur, const xmlChar* end,
+                                xmlSecC14NNativeNormalizeMode mode) {
+#ifdef XMLSEC_C14N_NATIVE_USE_SSE2
+    const __m128i cr = _mm_set1_epi8('\x0D');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quot = _mm_set1_epi8('"');
+    const __m128i tab = _mm_set1_epi8('\x09');
+    const __m128i lf = _mm_set1_epi8('\x0A');
+    __m128i data, found;
+    int mask;
+
+    while(end - cur >= 16) {
+        data = _mm_loadu_si128((const __m128i*)(const void*)cur);
+        found = _mm_cmpeq_epi8(data, cr);
+        if((mode == xmlSecC14NNativeNormalizeAttr) || (mode == xmlSecC14NNativeNormalizeText)) {
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(data, amp));
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(data, lt));
+        }
+        if(mode == xmlSecC14NNativeNormalizeText) {
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(data, gt));
+        } else if(mode == xmlSecC14NNativeNormalizeAttr) {
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(data, quot));
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(data, tab));
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(data, lf));
+        }
+        mask = _mm_movemask_epi8(found);
+        if(mask != 0) {
+            return(cur + __builtin_ctz((unsigned int)mask));
+        }
+        cur += 16;
+    }
+#endif /* XMLSEC_C14N_NATIVE_USE_SSE2 */
+
+    for(; cur < end; ++cur) {
+        if(xmlSecC14NNativeGetReplacement((*cur), mode) != NULL) {
+            return(cur);
+        }
+    }
+    return(end);
+}
+
+/* writes the string with the characters replaced as required by C14N */
+static int
+xmlSecC14NNativeWriteNormalized(xmlSecC14NNativeCtxPtr ctx, const xmlChar* str,
+                                xmlSecC14NNativeNormalizeMode mode) {
+    const xmlChar* start;
+    const xmlChar* cur;
+    const xmlChar* end;
+    const char* replacement;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(str != NULL, -1);
+
+    end = str + strlen((const char*)str);
+    for(start = str; start < end; start = cur + 1) {
+        cur = xmlSecC14NNativeFindReplacement(start, end, mode);
+        if(cur >= end) {
+            break;
+        }
+        replacement = xmlSecC14NNativeGetReplacement((*cur), mode);
+        xmlSecAssert2(replacement != NULL, -1);
+
+        ret = xmlSecC14NNativeWrite(ctx, start, (xmlSecSize)(cur - start));
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST replacement);
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    if(start >= end) {
+        return(0);
+    }
+    return(xmlSecC14NNativeWrite(ctx, start, (xmlSecSize)(end - start)));
+}
+
+static int
+xmlSecC14NNativeWriteQName(xmlSecC14NNativeCtxPtr ctx, xmlNsPtr ns, const xmlChar* name) {
+    int ret;
+
+    if((ns != NULL) && (xmlStrlen(ns->prefix) > 0)) {
+        ret = xmlSecC14NNativeWriteString(ctx, ns->prefix);
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST ":");
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    return(xmlSecC14NNativeWriteString(ctx, name));
+}
+
+static int
+xmlSecC14NNativeWriteNs(xmlSecC14NNativeCtxPtr ctx, xmlNsPtr ns) {
+    const xmlChar* start;
+    const xmlChar* cur;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ns != NULL, -1);
+
+    if(ns->prefix != NULL) {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST " xmlns:");
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, ns->prefix);
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "=");
+    } else {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST " xmlns=");
+    }
+    if(ret < 0) {
+        return(-1);
+    }
+    if(ns->href == NULL) {
+        return(xmlSecC14NNativeWriteString(ctx, BAD_CAST "\"\""));
+    }
+
+    /* same quoting as in libxml2 */
+    if(xmlStrchr(ns->href, '\"') == NULL) {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "\"");
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, ns->href);
+        if(ret < 0) {
+            return(-1);
+        }
+        return(xmlSecC14NNativeWriteString(ctx, BAD_CAST "\""));
+    } else if(xmlStrchr(ns->href, '\'') == NULL) {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "\'");
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, ns->href);
+        if(ret < 0) {
+            return(-1);
+        }
+        return(xmlSecC14NNativeWriteString(ctx, BAD_CAST "\'"));
+    }
+
+    ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "\"");
+    if(ret < 0) {
+        return(-1);
+    }
+    for(start = cur = ns->href; (*cur) != '\0'; ++cur) {
+        if((*cur) != '\"') {
+            continue;
+        }
+        ret = xmlSecC14NNativeWrite(ctx, start, (xmlSecSize)(cur - start));
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "&quot;");
+        if(ret < 0) {
+            return(-1);
+        }
+        start = cur + 1;
+    }
+    ret = xmlSecC14NNativeWrite(ctx, start, (xmlSecSize)(cur - start));
+    if(ret < 0) {
+        return(-1);
+    }
+    return(xmlSecC14NNativeWriteString(ctx, BAD_CAST "\""));
+}
+
+static int
+xmlSecC14NNativeWriteAttr(xmlSecC14NNativeCtxPtr ctx, xmlAttrPtr attr) {
+    xmlChar* value = NULL;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(attr != NULL, -1);
+
+    ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST " ");
+    if(ret < 0) {
+        return(-1);
+    }
+    ret = xmlSecC14NNativeWriteQName(ctx, attr->ns, attr->name);
+    if(ret < 0) {
+        return(-1);
+    }
+    ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "=\"");
+    if(ret < 0) {
+        return(-1);
+    }
+
+    /* the most common case is a single text node: no need to copy it */
+    if((attr->children != NULL) && (attr->children->type == XML_TEXT_NODE) && (attr->children->next == NULL)) {
+        if(attr->children->content != NULL) {
+            ret = xmlSecC14NNativeWriteNormalized(ctx, attr->children->content, xmlSecC14NNativeNormalizeAttr);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+    } else if(attr->children != NULL) {
+        value = xmlNodeListGetString(attr->doc, attr->children, 1);
+        if(value != NULL) {
+            ret = xmlSecC14NNativeWriteNormalized(ctx, value, xmlSecC14NNativeNormalizeAttr);
+            xmlFree(value);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+    }
+    return(xmlSecC14NNativeWriteString(ctx, BAD_CAST "\""));
+}
+
+/**************************************************************************
+ *
+ * Sorted namespaces and attributes lists
+ *
+ *************************************************************************/
+static int
+xmlSecC14NNativeNsCompare(xmlNsPtr ns1, xmlNsPtr ns2) {
+    if(ns1 == ns2) {
+        return(0);
+    }
+    return(xmlStrcmp(ns1->prefix, ns2->prefix));
+}
+
+static int
+xmlSecC14NNativeAttrCompare(xmlAttrPtr attr1, xmlAttrPtr attr2) {
+    int ret;
+
+    if(attr1 == attr2) {
+        return(0);
+    }
+    if(attr1->ns == attr2->ns) {
+        return(xmlStrcmp(attr1->name, attr2->name));
+    }
+
+    /* the attributes without namespace go first */
+    if(attr1->ns == NULL) {
+        return(-1);
+    }
+    if(attr2->ns == NULL) {
+        return(1);
+    }
+    if(attr1->ns->prefix == NULL) {
+        return(-1);
+    }
+    if(attr2->ns->prefix == NULL) {
+        return(1);
+    }
+    ret = xmlStrcmp(attr1->ns->href, attr2->ns->href);
+    if(ret == 0) {
+        ret = xmlStrcmp(attr1->name, attr2->name);
+    }
+    return(ret);
+}
+
+static int
+xmlSecC14NNativeNsListInsert(xmlSecC14NNativeCtxPtr ctx, xmlNsPtr ns) {
+    xmlSecSize pos;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ns != NULL, -1);
+
+    if(ctx->nsListSize >= ctx->nsListMaxSize) {
+        void* items = xmlSecC14NNativeGrow(ctx->nsList, &(ctx->nsListMaxSize), sizeof(xmlNsPtr));
+        if(items == NULL) {
+            xmlSecInternalError("xmlSecC14NNativeGrow(nsList)", NULL);
+            return(-1);
+        }
+        ctx->nsList = (xmlNsPtr*)items;
+    }
+    for(pos = 0; (pos < ctx->nsListSize) && (xmlSecC14NNativeNsCompare(ctx->nsList[pos], ns) < 0); ++pos) {
+        /* find the position */
+    }
+    memmove(ctx->nsList + pos + 1, ctx->nsList + pos, (ctx->nsListSize - pos) * sizeof(xmlNsPtr));
+    ctx->nsList[pos] = ns;
+    ++ctx->nsListSize;
+    return(0);
+}
+
+static int
+xmlSecC14NNativeAttrListInsert(xmlSecC14NNativeCtxPtr ctx, xmlAttrPtr attr) {
+    xmlSecSize pos;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(attr != NULL, -1);
+
+    if(ctx->attrListSize >= ctx->attrListMaxSize) {
+        void* items = xmlSecC14NNativeGrow(ctx->attrList, &(ctx->attrListMaxSize), sizeof(xmlAttrPtr));
+        if(items == NULL) {
+            xmlSecInternalError("xmlSecC14NNativeGrow(attrList)", NULL);
+            return(-1);
+        }
+        ctx->attrList = (xmlAttrPtr*)items;
+    }
+    for(pos = 0; (pos < ctx->attrListSize) && (xmlSecC14NNativeAttrCompare(ctx->attrList[pos], attr) < 0); ++pos) {
+        /* find the position */
+    }
+    memmove(ctx->attrList + pos + 1, ctx->attrList + pos, (ctx->attrListSize - pos) * sizeof(xmlAttrPtr));
+    ctx->attrList[pos] = attr;
+    ++ctx->attrListSize;
+    return(0);
+}
+
+static int
+xmlSecC14NNativeAttrListContains(xmlSecC14NNativeCtxPtr ctx, xmlAttrPtr attr) {
+    xmlSecSize ii;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(attr != NULL, 0);
+
+    for(ii = 0; ii < ctx->attrListSize; ++ii) {
+        if(xmlSecC14NNativeAttrCompare(ctx->attrList[ii], attr) == 0) {
+            return(1);
+        }
+    }
+    return(0);
+}
+
+/**************************************************************************
+ *
+ * In-scope namespaces
+ *
+ *************************************************************************/
+static int      xmlSecC14NNativeInScopeNsMatch          (xmlNsPtr ns,
+                                                         const xmlChar* prefix);
+
+/* checks if @ns prefix is in the InclusiveNamespaces PrefixList */
+static int
+xmlSecC14NNativeIsInclusiveNs(xmlSecC14NNativeCtxPtr ctx, xmlNsPtr ns) {
+    xmlSecSize ii;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(ns != NULL, 0);
+
+    for(ii = 0; ii < ctx->inclusiveNsSize; ++ii) {
+        if(xmlSecC14NNativeInScopeNsMatch(ns, ctx->inclusiveNs[ii])) {
+            return(1);
+        }
+    }
+    return(0);
+}
+
+static int
+xmlSecC14NNativeInScopeNsPush(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur) {
+    xmlNsPtr ns;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    for(ns = cur->nsDef; ns != NULL; ns = ns->next) {
+        if(ctx->inScopeNsSize >= ctx->inScopeNsMaxSize) {
+            void* items = xmlSecC14NNativeGrow(ctx->inScopeNs, &(ctx->inScopeNsMaxSize), sizeof(xmlNsPtr));
+            if(items == NULL) {
+                xmlSecInternalError("xmlSecC14NNativeGrow(inScopeNs)", NULL);
+                return(-1);
+            }
+            ctx->inScopeNs = (xmlNsPtr*)items;
+        }
+        ctx->inScopeNs[ctx->inScopeNsSize++] = ns;
+
+        if((ctx->inclusiveNsSize > 0) && xmlSecC14NNativeIsInclusiveNs(ctx, ns)) {
+            ++ctx->inScopeInclusiveNsCount;
+        }
+    }
+    return(0);
+}
+
+/* checks if @ns would be returned by xmlSearchNs() for its prefix */
+static int
+xmlSecC14NNativeInScopeNsMatch(xmlNsPtr ns, const xmlChar* prefix) {
+    if(prefix == NULL) {
+        return((ns->prefix == NULL) && (ns->href != NULL));
+    }
+    return((ns->prefix != NULL) && xmlStrEqual(ns->prefix, prefix));
+}
+
+/* same as xmlSearchNs() for the current element */
+static xmlNsPtr
+xmlSecC14NNativeInScopeNsSearch(xmlSecC14NNativeCtxPtr ctx, const xmlChar* prefix) {
+    xmlSecSize ii;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+
+    for(ii = ctx->inScopeNsSize; ii > 0; --ii) {
+        if(xmlSecC14NNativeInScopeNsMatch(ctx->inScopeNs[ii - 1], prefix)) {
+            return(ctx->inScopeNs[ii - 1]);
+        }
+    }
+    return(NULL);
+}
+
+/* checks if ctx->inScopeNs[pos] is not hidden by the declarations on the
+ * descendant elements */
+static int
+xmlSecC14NNativeInScopeNsIsActive(xmlSecC14NNativeCtxPtr ctx, xmlSecSize pos) {
+    xmlNsPtr ns;
+    xmlSecSize ii;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(pos < ctx->inScopeNsSize, 0);
+
+    ns = ctx->inScopeNs[pos];
+    if((ns->prefix == NULL) && (ns->href == NULL)) {
+        return(0);
+    }
+    for(ii = pos + 1; ii < ctx->inScopeNsSize; ++ii) {
+        if(xmlSecC14NNativeInScopeNsMatch(ctx->inScopeNs[ii], ns->prefix)) {
+            return(0);
+        }
+    }
+    return(1);
+}
+
+/**************************************************************************
+ *
+ * Rendered namespaces stack
+ *
+ *************************************************************************/
+static int
+xmlSecC14NNativeRenderedNsAdd(xmlSecC14NNativeCtxPtr ctx, xmlNsPtr ns, xmlNodePtr node, int nodeVisible) {
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ns != NULL, -1);
+
+    if(ctx->renderedNsCurEnd >= ctx->renderedNsMaxSize) {
+        void* items = xmlSecC14NNativeGrow(ctx->renderedNs, &(ctx->renderedNsMaxSize), sizeof(xmlSecC14NNativeRenderedNs));
+        if(items == NULL) {
+            xmlSecInternalError("xmlSecC14NNativeGrow(renderedNs)", NULL);
+            return(-1);
+        }
+        ctx->renderedNs = (xmlSecC14NNativeRenderedNsPtr)items;
+    }
+    ctx->renderedNs[ctx->renderedNsCurEnd].ns = ns;
+    ctx->renderedNs[ctx->renderedNsCurEnd].node = node;
+    ctx->renderedNs[ctx->renderedNsCurEnd].nodeVisible = nodeVisible;
+    ++ctx->renderedNsCurEnd;
+    return(0);
+}
+
+/* checks if the same namespace was rendered by the nearest visible ancestor */
+static int
+xmlSecC14NNativeRenderedNsFind(xmlSecC14NNativeCtxPtr ctx, xmlNsPtr ns) {
+    const xmlChar* prefix;
+    const xmlChar* href;
+    xmlSecSize ii, start;
+    int hasEmptyNs;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(ns != NULL, 0);
+
+    prefix = (ns->prefix != NULL) ? ns->prefix : BAD_CAST "";
+    href = (ns->href != NULL) ? ns->href : BAD_CAST "";
+    hasEmptyNs = (((*prefix) == '\0') && ((*href) == '\0')) ? 1 : 0;
+
+    start = (hasEmptyNs != 0) ? 0 : ctx->renderedNsPrevStart;
+    for(ii = ctx->renderedNsCurEnd; ii > start; --ii) {
+        xmlNsPtr ns1 = ctx->renderedNs[ii - 1].ns;
+        if(xmlSecC14NNativeStrEqual(prefix, ns1->prefix)) {
+            return(xmlSecC14NNativeStrEqual(href, ns1->href));
+        }
+    }
+    return(hasEmptyNs);
+}
+
+/* checks if the same namespace was rendered by any ancestor (exclusive c14n)
+ * Returns 1 if found, 0 if not and a negative value if an error occurs */
+static int
+xmlSecC14NNativeRenderedNsFindExcl(xmlSecC14NNativeCtxPtr ctx, xmlNsPtr ns) {
+    const xmlChar* prefix;
+    const xmlChar* href;
+    xmlSecSize ii;
+    int hasEmptyNs;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ns != NULL, -1);
+
+    prefix = (ns->prefix != NULL) ? ns->prefix : BAD_CAST "";
+    href = (ns->href != NULL) ? ns->href : BAD_CAST "";
+    hasEmptyNs = (((*prefix) == '\0') && ((*href) == '\0')) ? 1 : 0;
+
+    for(ii = ctx->renderedNsCurEnd; ii > 0; --ii) {
+        xmlSecC14NNativeRenderedNsPtr item = &(ctx->renderedNs[ii - 1]);
+        if(xmlSecC14NNativeStrEqual(prefix, item->ns->prefix)) {
+            if(!xmlSecC14NNativeStrEqual(href, item->ns->href)) {
+                return(0);
+            }
+            return(xmlSecC14NNativeIsVisible(ctx, (xmlNodePtr)item->ns, item->node, item->nodeVisible));
+        }
+    }
+    return(hasEmptyNs);
+}
+
+/**************************************************************************
+ *
+ * Namespaces axis
+ *
+ *************************************************************************/
+static int
+xmlSecC14NNativeCheckRelativeNs(xmlNodePtr cur) {
+    xmlNsPtr ns;
+    xmlURIPtr uri;
+    int relative;
+
+    xmlSecAssert2(cur != NULL, -1);
+
+    for(ns = cur->nsDef; ns != NULL; ns = ns->next) {
+        if(xmlStrlen(ns->href) <= 0) {
+            continue;
+        }
+        uri = xmlParseURI((const char*)ns->href);
+        if(uri == NULL) {
+            xmlSecXmlError2("xmlParseURI", NULL, "uri=%s", xmlSecErrorsSafeString(ns->href));
+            return(-1);
+        }
+        relative = (xmlStrlen(BAD_CAST uri->scheme) <= 0) ? 1 : 0;
+        xmlFreeURI(uri);
+
+        /* C14N implementations MUST report an operation failure on documents
+         * containing relative namespace URIs */
+        if(relative != 0) {
+            xmlSecInvalidNodeContentError2(cur, NULL, "relative namespace uri=%s",
+                xmlSecErrorsSafeString(ns->href));
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static int
+xmlSecC14NNativeWriteNsList(xmlSecC14NNativeCtxPtr ctx) {
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+
+    for(ii = 0; ii < ctx->nsListSize; ++ii) {
+        ret = xmlSecC14NNativeWriteNs(ctx, ctx->nsList[ii]);
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+/* inclusive c14n: all the visible namespaces in scope */
+static int
+xmlSecC14NNativeProcessNsAxis(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur, int visible) {
+    xmlNsPtr ns;
+    xmlSecSize ii;
+    int hasEmptyNs = 0;
+    int nsVisible;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    ctx->nsListSize = 0;
+    for(ii = ctx->inScopeNsSize; ii > 0; --ii) {
+        ns = ctx->inScopeNs[ii - 1];
+        if(!xmlSecC14NNativeInScopeNsIsActive(ctx, ii - 1) || xmlSecC14NNativeIsXmlNs(ns)) {
+            continue;
+        }
+        nsVisible = xmlSecC14NNativeIsVisible(ctx, (xmlNodePtr)ns, cur, visible);
+        if(nsVisible < 0) {
+            xmlSecInternalError("xmlSecC14NNativeIsVisible(ns)", NULL);
+            return(-1);
+        } else if(nsVisible == 0) {
+            continue;
+        }
+
+        if(!xmlSecC14NNativeRenderedNsFind(ctx, ns)) {
+            ret = xmlSecC14NNativeNsListInsert(ctx, ns);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecC14NNativeNsListInsert", NULL);
+                return(-1);
+            }
+        }
+        if(visible) {
+            ret = xmlSecC14NNativeRenderedNsAdd(ctx, ns, cur, visible);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecC14NNativeRenderedNsAdd", NULL);
+                return(-1);
+            }
+        }
+        if(xmlStrlen(ns->prefix) == 0) {
+            hasEmptyNs = 1;
+        }
+    }
+
+    /* xmlns="" if the nearest visible ancestor has the default namespace */
+    if(visible && !hasEmptyNs) {
+        xmlNs nsDefault;
+
+        memset(&nsDefault, 0, sizeof(nsDefault));
+        if(!xmlSecC14NNativeRenderedNsFind(ctx, &nsDefault)) {
+            ret = xmlSecC14NNativeWriteNs(ctx, &nsDefault);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+    }
+    return(xmlSecC14NNativeWriteNsList(ctx));
+}
+
+/* exclusive c14n: only the visibly utilized namespaces and the namespaces
+ * from the InclusiveNamespaces PrefixList */
+static int
+xmlSecC14NNativeProcessNsAxisExcl(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur, int visible) {
+    xmlNsPtr ns;
+    xmlAttrPtr attr;
+    int hasEmptyNs = 0;
+    int hasVisiblyUtilizedEmptyNs = 0;
+    int hasEmptyNsInInclusiveList = 0;
+    int alreadyRendered;
+    int nodeVisible;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    ctx->nsListSize = 0;
+
+    /* the namespaces from the inclusive list are handled as in the inclusive c14n
+     * (nothing to do if none of the PrefixList prefixes is declared in scope) */
+    hasEmptyNsInInclusiveList = ctx->inclusiveNsHasDefault;
+    if(ctx->inScopeInclusiveNsCount > 0) {
+        xmlSecSize ii;
+
+        for(ii = 0; ii < ctx->inclusiveNsSize; ++ii) {
+            ns = xmlSecC14NNativeInScopeNsSearch(ctx, ctx->inclusiveNs[ii]);
+            if((ns == NULL) || xmlSecC14NNativeIsXmlNs(ns)) {
+                continue;
+            }
+            nodeVisible = xmlSecC14NNativeIsVisible(ctx, (xmlNodePtr)ns, cur, visible);
+            if(nodeVisible < 0) {
+                xmlSecInternalError("xmlSecC14NNativeIsVisible(ns)", NULL);
+                return(-1);
+            } else if(nodeVisible == 0) {
+                continue;
+            }
+
+            alreadyRendered = xmlSecC14NNativeRenderedNsFind(ctx, ns);
+            if(visible) {
+                ret = xmlSecC14NNativeRenderedNsAdd(ctx, ns, cur, visible);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecC14NNativeRenderedNsAdd", NULL);
+                    return(-1);
+                }
+            }
+            if(!alreadyRendered) {
+                ret = xmlSecC14NNativeNsListInsert(ctx, ns);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecC14NNativeNsListInsert", NULL);
+                    return(-1);
+                }
+            }
+            if(xmlStrlen(ns->prefix) == 0) {
+                hasEmptyNs = 1;
+            }
+        }
+    }
+
+    /* the element namespace */
+    if(cur->ns != NULL) {
+        ns = cur->ns;
+    } else {
+        ns = xmlSecC14NNativeInScopeNsSearch(ctx, NULL);
+        hasVisiblyUtilizedEmptyNs = 1;
+    }
+    if((ns != NULL) && !xmlSecC14NNativeIsXmlNs(ns)) {
+        if(visible) {
+            nodeVisible = xmlSecC14NNativeIsVisible(ctx, (xmlNodePtr)ns, cur, visible);
+            if(nodeVisible < 0) {
+                xmlSecInternalError("xmlSecC14NNativeIsVisible(ns)", NULL);
+                return(-1);
+            }
+            if(nodeVisible != 0) {
+                alreadyRendered = xmlSecC14NNativeRenderedNsFindExcl(ctx, ns);
+                if(alreadyRendered < 0) {
+                    xmlSecInternalError("xmlSecC14NNativeRenderedNsFindExcl", NULL);
+                    return(-1);
+                }
+                if(!alreadyRendered) {
+                    ret = xmlSecC14NNativeNsListInsert(ctx, ns);
+                    if(ret < 0) {
+                        xmlSecInternalError("xmlSecC14NNativeNsListInsert", NULL);
+                        return(-1);
+                    }
+                }
+            }
+            ret = xmlSecC14NNativeRenderedNsAdd(ctx, ns, cur, visible);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecC14NNativeRenderedNsAdd", NULL);
+                return(-1);
+            }
+        }
+        if(xmlStrlen(ns->prefix) == 0) {
+            hasEmptyNs = 1;
+        }
+    }
+
+    /* the attributes namespaces (the default namespace doesn't apply to attributes) */
+    for(attr = cur->properties; attr != NULL; attr = attr->next) {
+        if((attr->ns != NULL) && !xmlSecC14NNativeIsXmlNs(attr->ns)) {
+            nodeVisible = xmlSecC14NNativeIsVisible(ctx, (xmlNodePtr)attr, cur, visible);
+            if(nodeVisible < 0) {
+                xmlSecInternalError("xmlSecC14NNativeIsVisible(attr)", NULL);
+                return(-1);
+            }
+        } else {
+            nodeVisible = 0;
+        }
+
+        if(nodeVisible != 0) {
+            alreadyRendered = xmlSecC14NNativeRenderedNsFindExcl(ctx, attr->ns);
+            if(alreadyRendered < 0) {
+                xmlSecInternalError("xmlSecC14NNativeRenderedNsFindExcl", NULL);
+                return(-1);
+            }
+            ret = xmlSecC14NNativeRenderedNsAdd(ctx, attr->ns, cur, visible);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecC14NNativeRenderedNsAdd", NULL);
+                return(-1);
+            }
+            if(!alreadyRendered && visible) {
+                ret = xmlSecC14NNativeNsListInsert(ctx, attr->ns);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecC14NNativeNsListInsert", NULL);
+                    return(-1);
+                }
+            }
+            if(xmlStrlen(attr->ns->prefix) == 0) {
+                hasEmptyNs = 1;
+            }
+        } else if((attr->ns != NULL) && (xmlStrlen(attr->ns->prefix) == 0) && (xmlStrlen(attr->ns->href) == 0)) {
+            hasVisiblyUtilizedEmptyNs = 1;
+        }
+    }
+
+    /* xmlns="" */
+    if(visible && !hasEmptyNs && (hasVisiblyUtilizedEmptyNs || hasEmptyNsInInclusiveList)) {
+        xmlNs nsDefault;
+
+        memset(&nsDefault, 0, sizeof(nsDefault));
+        if(hasEmptyNsInInclusiveList) {
+            alreadyRendered = xmlSecC14NNativeRenderedNsFind(ctx, &nsDefault);
+        } else {
+            alreadyRendered = xmlSecC14NNativeRenderedNsFindExcl(ctx, &nsDefault);
+            if(alreadyRendered < 0) {
+                xmlSecInternalError("xmlSecC14NNativeRenderedNsFindExcl", NULL);
+                return(-1);
+            }
+        }
+        if(!alreadyRendered) {
+            ret = xmlSecC14NNativeWriteNs(ctx, &nsDefault);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+    }
+    return(xmlSecC14NNativeWriteNsList(ctx));
+}
+
+/**************************************************************************
+ *
+ * Attributes axis
+ *
+ *************************************************************************/
+/* finds the attribute on the nearest invisible ancestors (C14N 1.1) */
+static xmlAttrPtr
+xmlSecC14NNativeFindHiddenParentAttr(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur, int curVisible,
+                                     const xmlChar* name) {
+    xmlAttrPtr attr;
+    int visible = curVisible;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(name != NULL, NULL);
+
+    while((cur != NULL) && (cur->type == XML_ELEMENT_NODE) && (visible == 0)) {
+        attr = xmlHasNsProp(cur, name, XML_XML_NAMESPACE);
+        if((attr != NULL) && (attr->type == XML_ATTRIBUTE_NODE)) {
+            return(attr);
+        }
+        cur = cur->parent;
+        if(cur != NULL) {
+            visible = xmlSecNodeSetContains(ctx->nodes, cur, cur->parent);
+        }
+    }
+    return(NULL);
+}
+
+static int
+xmlSecC14NNativeProcessAttrsAxis(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur, int visible, int parentVisible) {
+    xmlAttrPtr attr;
+    xmlAttrPtr xmlLangAttr = NULL;
+    xmlAttrPtr xmlSpaceAttr = NULL;
+    xmlNodePtr tmp;
+    xmlSecSize ii;
+    int attrVisible;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    ctx->attrListSize = 0;
+    for(attr = cur->properties; attr != NULL; attr = attr->next) {
+        /* C14N 1.1: xml:lang and xml:space are always rendered for visible elements,
+         * xml:base is not supported (see xmlSecC14NNativeIsSupported) */
+        if((ctx->mode == XML_C14N_1_1) && visible && xmlSecC14NNativeIsXmlAttr(attr)) {
+            if((xmlLangAttr == NULL) && xmlStrEqual(attr->name, BAD_CAST "lang")) {
+                xmlLangAttr = attr;
+                continue;
+            }
+            if((xmlSpaceAttr == NULL) && xmlStrEqual(attr->name, BAD_CAST "space")) {
+                xmlSpaceAttr = attr;
+                continue;
+            }
+        }
+
+        attrVisible = xmlSecC14NNativeIsVisible(ctx, (xmlNodePtr)attr, cur, visible);
+        if(attrVisible < 0) {
+            xmlSecInternalError("xmlSecC14NNativeIsVisible(attr)", NULL);
+            return(-1);
+        } else if(attrVisible != 0) {
+            ret = xmlSecC14NNativeAttrListInsert(ctx, attr);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecC14NNativeAttrListInsert", NULL);
+                return(-1);
+            }
+        }
+    }
+
+    switch(ctx->mode) {
+    case XML_C14N_1_0:
+        /* the nearest xml:* attributes from the ancestors if the parent is not visible */
+        if(visible && (cur->parent != NULL) && !parentVisible) {
+            for(tmp = cur->parent; (tmp != NULL) && (tmp->type == XML_ELEMENT_NODE); tmp = tmp->parent) {
+                for(attr = tmp->properties; attr != NULL; attr = attr->next) {
+                    if(!xmlSecC14NNativeIsXmlAttr(attr) || xmlSecC14NNativeAttrListContains(ctx, attr)) {
+                        continue;
+                    }
+                    ret = xmlSecC14NNativeAttrListInsert(ctx, attr);
+                    if(ret < 0) {
+                        xmlSecInternalError("xmlSecC14NNativeAttrListInsert", NULL);
+                        return(-1);
+                    }
+                }
+            }
+        }
+        break;
+    case XML_C14N_1_1:
+        if(visible) {
+            if(xmlLangAttr == NULL) {
+                xmlLangAttr = xmlSecC14NNativeFindHiddenParentAttr(ctx, cur->parent, parentVisible, BAD_CAST "lang");
+            }
+            if(xmlLangAttr != NULL) {
+                ret = xmlSecC14NNativeAttrListInsert(ctx, xmlLangAttr);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecC14NNativeAttrListInsert", NULL);
+                    return(-1);
+                }
+            }
+            if(xmlSpaceAttr == NULL) {
+                xmlSpaceAttr = xmlSecC14NNativeFindHiddenParentAttr(ctx, cur->parent, parentVisible, BAD_CAST "space");
+            }
+            if(xmlSpaceAttr != NULL) {
+                ret = xmlSecC14NNativeAttrListInsert(ctx, xmlSpaceAttr);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecC14NNativeAttrListInsert", NULL);
+                    return(-1);
+                }
+            }
+        }
+        break;
+    default:
+        /* exclusive c14n doesn't import xml:* attributes */
+        break;
+    }
+
+    for(ii = 0; ii < ctx->attrListSize; ++ii) {
+        ret = xmlSecC14NNativeWriteAttr(ctx, ctx->attrList[ii]);
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+/**************************************************************************
+ *
+ * Nodes
+ *
+ *************************************************************************/
+/* writes the element start tag: the namespaces state is saved in @state */
+static int
+xmlSecC14NNativeStartElement(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur, int visible, int parentVisible,
+                             xmlSecC14NNativeElementStatePtr state) {
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+    xmlSecAssert2(cur->type == XML_ELEMENT_NODE, -1);
+    xmlSecAssert2(state != NULL, -1);
+
+    ret = xmlSecC14NNativeCheckRelativeNs(cur);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeCheckRelativeNs", NULL);
+        return(-1);
+    }
+
+    /* save the namespaces state */
+    state->inScopeNsSize = ctx->inScopeNsSize;
+    state->inScopeInclusiveNsCount = ctx->inScopeInclusiveNsCount;
+    state->renderedNsCurEnd = ctx->renderedNsCurEnd;
+    state->renderedNsPrevStart = ctx->renderedNsPrevStart;
+    state->renderedNsPrevEnd = ctx->renderedNsPrevEnd;
+    state->parentIsDoc = 0;
+    state->visible = visible;
+
+    ret = xmlSecC14NNativeInScopeNsPush(ctx, cur);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeInScopeNsPush", NULL);
+        return(-1);
+    }
+
+    if(visible) {
+        if(ctx->parentIsDoc != 0) {
+            state->parentIsDoc = ctx->parentIsDoc;
+            ctx->parentIsDoc = 0;
+            ctx->pos = xmlSecC14NNativePosInsideDocumentElement;
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "<");
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteQName(ctx, cur->ns, cur->name);
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+
+    if(ctx->mode != XML_C14N_EXCLUSIVE_1_0) {
+        ret = xmlSecC14NNativeProcessNsAxis(ctx, cur, visible);
+    } else {
+        ret = xmlSecC14NNativeProcessNsAxisExcl(ctx, cur, visible);
+    }
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeProcessNsAxis", NULL);
+        return(-1);
+    }
+    if(visible) {
+        ctx->renderedNsPrevStart = ctx->renderedNsPrevEnd;
+        ctx->renderedNsPrevEnd = ctx->renderedNsCurEnd;
+    }
+
+    ret = xmlSecC14NNativeProcessAttrsAxis(ctx, cur, visible, parentVisible);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeProcessAttrsAxis", NULL);
+        return(-1);
+    }
+
+    if(visible) {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST ">");
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+/* writes the element end tag and restores the namespaces state saved in @state */
+static int
+xmlSecC14NNativeEndElement(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur, xmlSecC14NNativeElementStatePtr state) {
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+    xmlSecAssert2(state != NULL, -1);
+
+    if(state->visible) {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "</");
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteQName(ctx, cur->ns, cur->name);
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST ">");
+        if(ret < 0) {
+            return(-1);
+        }
+        if(state->parentIsDoc != 0) {
+            ctx->parentIsDoc = state->parentIsDoc;
+            ctx->pos = xmlSecC14NNativePosAfterDocumentElement;
+        }
+    }
+
+    /* restore the namespaces state */
+    ctx->inScopeNsSize = state->inScopeNsSize;
+    ctx->inScopeInclusiveNsCount = state->inScopeInclusiveNsCount;
+    ctx->renderedNsCurEnd = state->renderedNsCurEnd;
+    ctx->renderedNsPrevStart = state->renderedNsPrevStart;
+    ctx->renderedNsPrevEnd = state->renderedNsPrevEnd;
+    return(0);
+}
+
+static int
+xmlSecC14NNativeProcessElement(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur, int visible, int parentVisible) {
+    xmlSecC14NNativeElementState state;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    ret = xmlSecC14NNativeStartElement(ctx, cur, visible, parentVisible, &state);
+    if(ret < 0) {
+        return(-1);
+    }
+    if(cur->children != NULL) {
+        ret = xmlSecC14NNativeProcessNodeList(ctx, cur->children, visible);
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    return(xmlSecC14NNativeEndElement(ctx, cur, &state));
+}
+
+static int
+xmlSecC14NNativeProcessPIOrComment(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur) {
+    xmlSecC14NNativePos pos;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    pos = ctx->pos;
+    if(pos == xmlSecC14NNativePosAfterDocumentElement) {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "\x0A");
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    if(cur->type == XML_PI_NODE) {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "<?");
+        if(ret < 0) {
+            return(-1);
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, cur->name);
+        if(ret < 0) {
+            return(-1);
+        }
+        if((cur->content != NULL) && ((*cur->content) != '\0')) {
+            ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST " ");
+            if(ret < 0) {
+                return(-1);
+            }
+            ret = xmlSecC14NNativeWriteNormalized(ctx, cur->content, xmlSecC14NNativeNormalizePI);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "?>");
+    } else {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "<!--");
+        if(ret < 0) {
+            return(-1);
+        }
+        if(cur->content != NULL) {
+            ret = xmlSecC14NNativeWriteNormalized(ctx, cur->content, xmlSecC14NNativeNormalizeComment);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "-->");
+    }
+    if(ret < 0) {
+        return(-1);
+    }
+    if(pos == xmlSecC14NNativePosBeforeDocumentElement) {
+        ret = xmlSecC14NNativeWriteString(ctx, BAD_CAST "\x0A");
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static int
+xmlSecC14NNativeProcessNode(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr cur, int parentVisible) {
+    int visible;
+    int ret = 0;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    visible = xmlSecC14NNativeIsVisible(ctx, cur, cur->parent, parentVisible);
+    if(visible < 0) {
+        xmlSecInternalError("xmlSecC14NNativeIsVisible", NULL);
+        return(-1);
+    }
+
+    /* nothing in the excluded subtree is visible, skip it completely
+     * (the document element is processed to keep the PIs and comments positions) */
+    if((cur == ctx->excludedNode) && (cur->parent != NULL) && (cur->parent->type == XML_ELEMENT_NODE)) {
+        if((ctx->tailBuf != NULL) && (ctx->buf != ctx->tailBuf)) {
+            ret = xmlOutputBufferFlush(ctx->buf);
+            if(ret < 0) {
+                xmlSecXmlError("xmlOutputBufferFlush", NULL);
+                return(-1);
+            }
+            ctx->buf = ctx->tailBuf;
+        }
+        return(0);
+    }
+
+    switch(cur->type) {
+    case XML_ELEMENT_NODE:
+        ret = xmlSecC14NNativeProcessElement(ctx, cur, visible, parentVisible);
+        break;
+    case XML_CDATA_SECTION_NODE:
+    case XML_TEXT_NODE:
+        if(visible && (cur->content != NULL)) {
+            ret = xmlSecC14NNativeWriteNormalized(ctx, cur->content, xmlSecC14NNativeNormalizeText);
+        }
+        break;
+    case XML_PI_NODE:
+        if(visible) {
+            ret = xmlSecC14NNativeProcessPIOrComment(ctx, cur);
+        }
+        break;
+    case XML_COMMENT_NODE:
+        if(visible && ctx->withComments) {
+            ret = xmlSecC14NNativeProcessPIOrComment(ctx, cur);
+        }
+        break;
+    case XML_DOCUMENT_NODE:
+    case XML_DOCUMENT_FRAG_NODE:
+    case XML_HTML_DOCUMENT_NODE:
+        if(cur->children != NULL) {
+            ctx->pos = xmlSecC14NNativePosBeforeDocumentElement;
+            ctx->parentIsDoc = 1;
+            ret = xmlSecC14NNativeProcessNodeList(ctx, cur->children, visible);
+        }
+        break;
+    case XML_DOCUMENT_TYPE_NODE:
+    case XML_NOTATION_NODE:
+    case XML_DTD_NODE:
+    case XML_ELEMENT_DECL:
+    case XML_ATTRIBUTE_DECL:
+    case XML_ENTITY_DECL:
+    case XML_XINCLUDE_START:
+    case XML_XINCLUDE_END:
+        /* should be ignored according to "W3C Canonical XML" */
+        break;
+    default:
+        /* attribute, namespace, entity and entity reference nodes are not expected here */
+        xmlSecUnsupportedEnumValueError("node type", cur->type, NULL);
+        return(-1);
+    }
+    return(ret);
+}
+
+static int
+xmlSecC14NNativeProcessNodeList(xmlSecC14NNativeCtxPtr ctx, xmlNodePtr first, int parentVisible) {
+    xmlNodePtr cur;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+
+    for(cur = first; cur != NULL; cur = cur->next) {
+        ret = xmlSecC14NNativeProcessNode(ctx, cur, parentVisible);
+        if(ret < 0) {
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+/* returns the excluded subtree root if @nset is a single element inverted tree
+ * (the enveloped signature transform output) or NULL otherwise */
+static xmlNodePtr
+xmlSecC14NNativeGetExcludedNode(xmlSecNodeSetPtr nset) {
+    xmlSecAssert2(nset != NULL, NULL);
+
+    if(nset->op != xmlSecNodeSetIntersection) {
+        return(NULL);
+    }
+    if((nset->type != xmlSecNodeSetTreeInvert) && (nset->type != xmlSecNodeSetTreeWithoutCommentsInvert)) {
+        return(NULL);
+    }
+    if((nset->nodes == NULL) || (nset->nodes->nodeNr != 1) || (nset->nodes->nodeTab == NULL)) {
+        return(NULL);
+    }
+    if((nset->nodes->nodeTab[0] == NULL) || (nset->nodes->nodeTab[0]->type != XML_ELEMENT_NODE)) {
+        return(NULL);
+    }
+    return(nset->nodes->nodeTab[0]);
+}
+
+/*
+ * Detects the nodes sets where the visibility is inherited from the parent element:
+ *   - a single tree (with or without comments);
+ *   - the whole document without one subtree (enveloped signature with URI="");
+ *   - a tree without one subtree (enveloped signature with URI="#id").
+ * The last two are the common enveloped signature profiles (e.g. SAML or WS-Security).
+ */
+static void
+xmlSecC14NNativeInitSimpleTree(xmlSecC14NNativeCtxPtr ctx, xmlSecNodeSetPtr nodes) {
+    xmlSecNodeSetPtr excluded = NULL;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(nodes != NULL);
+
+    if(nodes->op != xmlSecNodeSetIntersection) {
+        return;
+    }
+    if(nodes->next == nodes) {
+        switch(nodes->type) {
+        case xmlSecNodeSetTree:
+        case xmlSecNodeSetTreeWithoutComments:
+            break;
+        case xmlSecNodeSetTreeInvert:
+        case xmlSecNodeSetTreeWithoutCommentsInvert:
+            excluded = nodes;
+            break;
+        default:
+            return;
+        }
+    } else if((nodes->next->next == nodes) &&
+              ((nodes->type == xmlSecNodeSetTree) || (nodes->type == xmlSecNodeSetTreeWithoutComments))) {
+        excluded = nodes->next;
+    } else {
+        return;
+    }
+
+    if(excluded != NULL) {
+        ctx->excludedNode = xmlSecC14NNativeGetExcludedNode(excluded);
+        if(ctx->excludedNode == NULL) {
+            return;
+        }
+        if(excluded->type == xmlSecNodeSetTreeWithoutCommentsInvert) {
+            ctx->simpleTreeWithoutComments = 1;
+        }
+    }
+    if(nodes->type == xmlSecNodeSetTreeWithoutComments) {
+        ctx->simpleTreeWithoutComments = 1;
+    }
+    ctx->simpleTree = 1;
+}
+
+/* precompiles the InclusiveNamespaces PrefixList: "#default" and "" are
+ * replaced with NULL (same as in libxml2) to match the in-scope namespaces
+ * without the strings compares */
+static int
+xmlSecC14NNativeInitInclusiveNs(xmlSecC14NNativeCtxPtr ctx, xmlChar** inclusiveNsPrefixes) {
+    const xmlChar* prefix;
+    xmlSecSize size, ii;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->inclusiveNs == NULL, -1);
+    xmlSecAssert2(inclusiveNsPrefixes != NULL, -1);
+
+    size = 0;
+    while(inclusiveNsPrefixes[size] != NULL) {
+        ++size;
+    }
+    if(size == 0) {
+        return(0);
+    }
+
+    ctx->inclusiveNs = (const xmlChar**)xmlMalloc(size * sizeof(const xmlChar*));
+    if(ctx->inclusiveNs == NULL) {
+        xmlSecMallocError(size * sizeof(const xmlChar*), NULL);
+        return(-1);
+    }
+    for(ii = 0; ii < size; ++ii) {
+        prefix = inclusiveNsPrefixes[ii];
+        if(xmlStrEqual(prefix, BAD_CAST "#default") || xmlStrEqual(prefix, BAD_CAST "")) {
+            prefix = NULL;
+            ctx->inclusiveNsHasDefault = 1;
+        }
+        ctx->inclusiveNs[ii] = prefix;
+    }
+    ctx->inclusiveNsSize = size;
+    return(0);
+}
+
+static void
+xmlSecC14NNativeCtxFinalize(xmlSecC14NNativeCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->inclusiveNs != NULL) {
+        xmlFree((void*)ctx->inclusiveNs);
+    }
+    if(ctx->inScopeNs != NULL) {
+        xmlFree(ctx->inScopeNs);
+    }
+    if(ctx->renderedNs != NULL) {
+        xmlFree(ctx->renderedNs);
+    }
+    if(ctx->nsList != NULL) {
+        xmlFree(ctx->nsList);
+    }
+    if(ctx->attrList != NULL) {
+        xmlFree(ctx->attrList);
+    }
+    if(ctx->elements != NULL) {
+        xmlFree(ctx->elements);
+    }
+    memset(ctx, 0, sizeof(xmlSecC14NNativeCtx));
+}
+
+/**************************************************************************
+ *
+ * Public functions
+ *
+ *************************************************************************/
+/* checks if the element has xml:base attribute */
+static int
+xmlSecC14NNativeHasXmlBaseAttr(xmlNodePtr cur) {
+    xmlAttrPtr attr;
+
+    xmlSecAssert2(cur != NULL, 0);
+
+    for(attr = cur->properties; attr != NULL; attr = attr->next) {
+        if(xmlSecC14NNativeIsXmlAttr(attr) && xmlStrEqual(attr->name, BAD_CAST "base")) {
+            return(1);
+        }
+    }
+    return(0);
+}
+
+/* checks if the document has xml:base attributes (looks at the "base" attributes
+ * owners from the document index if available or walks the elements) */
+static int
+xmlSecC14NNativeHasXmlBase(xmlDocPtr doc) {
+    xmlSecDocIndexPtr index;
+    xmlSecDocIndexNamePtr owners;
+    xmlNodePtr cur;
+    xmlSecSize ii;
+
+    xmlSecAssert2(doc != NULL, 0);
+
+    index = xmlSecDocIndexAcquire(doc);
+    if(index != NULL) {
+        owners = xmlSecDocIndexGetAttrOwners(index, BAD_CAST "base");
+        if(owners == NULL) {
+            return(0);
+        }
+        for(ii = 0; ii < owners->size; ++ii) {
+            if(xmlSecC14NNativeHasXmlBaseAttr(xmlSecDocIndexGetElement(index, owners->ordinals[ii])) != 0) {
+                return(1);
+            }
+        }
+        return(0);
+    }
+
+    cur = xmlDocGetRootElement(doc);
+    while(cur != NULL) {
+        if(cur->type == XML_ELEMENT_NODE) {
+            if(xmlSecC14NNativeHasXmlBaseAttr(cur) != 0) {
+                return(1);
+            }
+            if(cur->children != NULL) {
+                cur = cur->children;
+                continue;
+            }
+        }
+
+        /* next sibling or the next sibling of the nearest ancestor */
+        while((cur != NULL) && (cur->next == NULL)) {
+            cur = cur->parent;
+            if((cur != NULL) && (cur->type != XML_ELEMENT_NODE)) {
+                cur = NULL;
+            }
+        }
+        if(cur != NULL) {
+            cur = cur->next;
+        }
+    }
+    return(0);
+}
+
+/**
+ * xmlSecC14NNativeIsSupported:
+ * @nodes:              the nodes set.
+ * @mode:               the c14n mode.
+ *
+ * Checks if the native C14N serializer can process @nodes. The xml:base
+ * fixup required by C14N 1.1 for the document subsets is not implemented,
+ * the documents with xml:base attributes should be processed by libxml2.
+ *
+ * Returns: 1 if the native serializer can be used or 0 otherwise.
+ */
+int
+xmlSecC14NNativeIsSupported(xmlSecNodeSetPtr nodes, xmlC14NMode mode) {
+    if((nodes == NULL) || (nodes->doc == NULL)) {
+        return(0);
+    }
+    switch(mode) {
+    case XML_C14N_1_0:
+    case XML_C14N_EXCLUSIVE_1_0:
+        return(1);
+    case XML_C14N_1_1:
+        return(xmlSecC14NNativeHasXmlBase(nodes->doc) ? 0 : 1);
+    default:
+        return(0);
+    }
+}
+
+/**
+ * xmlSecC14NNativeExecute:
+ * @nodes:              the nodes set.
+ * @mode:               the c14n mode.
+ * @inclusiveNsPrefixes: the NULL terminated list of the inclusive namespace
+ *                      prefixes (exclusive c14n only) or NULL.
+ * @withComments:       the flag: include comments or not.
+ * @buf:                the output buffer.
+ *
+ * Writes the canonical form of @nodes into @buf. The result is the same as
+ * the result of xmlC14NExecute() with #xmlSecNodeSetContains visibility
+ * callback (see #xmlSecC14NNativeIsSupported).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecC14NNativeExecute(xmlSecNodeSetPtr nodes, xmlC14NMode mode, xmlChar** inclusiveNsPrefixes,
+                        int withComments, xmlOutputBufferPtr buf) {
+    return(xmlSecC14NNativeExecuteSplit(nodes, mode, inclusiveNsPrefixes, withComments, buf, NULL));
+}
+
+/**
+ * xmlSecC14NNativeExecuteSplit:
+ * @nodes:              the nodes set.
+ * @mode:               the c14n mode.
+ * @inclusiveNsPrefixes: the NULL terminated list of the inclusive namespace
+ *                      prefixes (exclusive c14n only) or NULL.
+ * @withComments:       the flag: include comments or not.
+ * @buf:                the output buffer.
+ * @tailBuf:            the output buffer for the data after the excluded subtree or NULL.
+ *
+ * Same as #xmlSecC14NNativeExecute but if @nodes is a tree without one
+ * subtree (the enveloped signature) then @buf is flushed where the subtree
+ * would be and the rest of the output is written into @tailBuf. The
+ * application can put the canonical form of the subtree in between.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecC14NNativeExecuteSplit(xmlSecNodeSetPtr nodes, xmlC14NMode mode, xmlChar** inclusiveNsPrefixes,
+                             int withComments, xmlOutputBufferPtr buf, xmlOutputBufferPtr tailBuf) {
+    xmlSecC14NNativeCtx ctx;
+    int docVisible;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(nodes != NULL, -1);
+    xmlSecAssert2(nodes->doc != NULL, -1);
+    xmlSecAssert2(buf != NULL, -1);
+
+    /* C14N requires UTF8 output */
+    if((buf->encoder != NULL) || ((tailBuf != NULL) && (tailBuf->encoder != NULL))) {
+        xmlSecInvalidDataError("output buffer encoder is not supported", NULL);
+        return(-1);
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.nodes = nodes;
+    ctx.mode = mode;
+    ctx.withComments = withComments;
+    ctx.buf = buf;
+    ctx.tailBuf = tailBuf;
+    ctx.pos = xmlSecC14NNativePosBeforeDocumentElement;
+    ctx.parentIsDoc = 1;
+
+    /* the visibility of a single tree set is inherited from the parent element */
+    xmlSecC14NNativeInitSimpleTree(&ctx, nodes);
+
+    if((mode == XML_C14N_EXCLUSIVE_1_0) && (inclusiveNsPrefixes != NULL)) {
+        ret = xmlSecC14NNativeInitInclusiveNs(&ctx, inclusiveNsPrefixes);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecC14NNativeInitInclusiveNs", NULL);
+            goto done;
+        }
+    }
+
+    docVisible = xmlSecNodeSetContains(nodes, (xmlNodePtr)nodes->doc, NULL);
+    if(docVisible < 0) {
+        xmlSecInternalError("xmlSecNodeSetContains(doc)", NULL);
+        goto done;
+    }
+    ret = xmlSecC14NNativeProcessNodeList(&ctx, nodes->doc->children, docVisible);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeProcessNodeList", NULL);
+        goto done;
+    }
+
+    ret = xmlOutputBufferFlush(ctx.buf);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferFlush", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    xmlSecC14NNativeCtxFinalize(&ctx);
+    return(res);
+}
+
+/**************************************************************************
+ *
+ * Streaming
+ *
+ *************************************************************************/
+/**
+ * xmlSecC14NNativeStreamCreate:
+ * @mode:               the c14n mode.
+ * @inclusiveNsPrefixes: the NULL terminated list of the inclusive namespace
+ *                      prefixes (exclusive c14n only) or NULL.
+ * @withComments:       the flag: include comments or not.
+ * @buf:                the output buffer.
+ *
+ * Creates the serializer for the whole document delivered one node at a time
+ * (e.g. by a streaming parser): only the open elements and their ancestors
+ * namespaces and attributes are accessed, the processed nodes can be freed.
+ * The caller must destroy the result with #xmlSecC14NNativeStreamDestroy.
+ *
+ * Returns: the pointer to the serializer or NULL if an error occurs.
+ */
+xmlSecC14NNativeStreamPtr
+xmlSecC14NNativeStreamCreate(xmlC14NMode mode, xmlChar** inclusiveNsPrefixes, int withComments,
+                             xmlOutputBufferPtr buf) {
+    xmlSecC14NNativeCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(buf != NULL, NULL);
+
+    /* C14N requires UTF8 output */
+    if(buf->encoder != NULL) {
+        xmlSecInvalidDataError("output buffer encoder is not supported", NULL);
+        return(NULL);
+    }
+    switch(mode) {
+    case XML_C14N_1_0:
+    case XML_C14N_EXCLUSIVE_1_0:
+    case XML_C14N_1_1:
+        /* the whole document: no xml:base fixup is required */
+        break;
+    default:
+        xmlSecUnsupportedEnumValueError("mode", mode, NULL);
+        return(NULL);
+    }
+
+    ctx = (xmlSecC14NNativeCtxPtr)xmlMalloc(sizeof(xmlSecC14NNativeCtx));
+    if(ctx == NULL) {
+        xmlSecMallocError(sizeof(xmlSecC14NNativeCtx), NULL);
+        return(NULL);
+    }
+    memset(ctx, 0, sizeof(xmlSecC14NNativeCtx));
+    ctx->mode = mode;
+    ctx->withComments = withComments;
+    ctx->buf = buf;
+    ctx->simpleTree = 1;
+    ctx->pos = xmlSecC14NNativePosBeforeDocumentElement;
+    ctx->parentIsDoc = 1;
+
+    if((mode == XML_C14N_EXCLUSIVE_1_0) && (inclusiveNsPrefixes != NULL)) {
+        ret = xmlSecC14NNativeInitInclusiveNs(ctx, inclusiveNsPrefixes);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecC14NNativeInitInclusiveNs", NULL);
+            xmlSecC14NNativeStreamDestroy(ctx);
+            return(NULL);
+        }
+    }
+    return(ctx);
+}
+
+/**
+ * xmlSecC14NNativeStreamDestroy:
+ * @stream:             the pointer to the serializer.
+ *
+ * Destroys the serializer created by #xmlSecC14NNativeStreamCreate.
+ */
+void
+xmlSecC14NNativeStreamDestroy(xmlSecC14NNativeStreamPtr stream) {
+    xmlSecAssert(stream != NULL);
+
+    xmlSecC14NNativeCtxFinalize(stream);
+    xmlFree(stream);
+}
+
+/**
+ * xmlSecC14NNativeStreamSetOutput:
+ * @stream:             the pointer to the serializer.
+ * @buf:                the new output buffer (without encoder).
+ *
+ * Flushes the current output buffer and writes the rest of the output
+ * into @buf (e.g. to keep the end of the document apart).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecC14NNativeStreamSetOutput(xmlSecC14NNativeStreamPtr stream, xmlOutputBufferPtr buf) {
+    int ret;
+
+    xmlSecAssert2(stream != NULL, -1);
+    xmlSecAssert2(stream->buf != NULL, -1);
+    xmlSecAssert2(buf != NULL, -1);
+
+    /* C14N requires UTF8 output */
+    if(buf->encoder != NULL) {
+        xmlSecInvalidDataError("output buffer encoder is not supported", NULL);
+        return(-1);
+    }
+    ret = xmlOutputBufferFlush(stream->buf);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferFlush", NULL);
+        return(-1);
+    }
+    stream->buf = buf;
+    return(0);
+}
+
+/**
+ * xmlSecC14NNativeStreamStartElement:
+ * @stream:             the pointer to the serializer.
+ * @cur:                the element node with its attributes and namespaces
+ *                      (the children are not accessed).
+ *
+ * Writes the element start tag. The element and all its ancestors must
+ * stay valid until #xmlSecC14NNativeStreamEndElement is called for it.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecC14NNativeStreamStartElement(xmlSecC14NNativeStreamPtr stream, xmlNodePtr cur) {
+    int ret;
+
+    xmlSecAssert2(stream != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+    xmlSecAssert2(cur->type == XML_ELEMENT_NODE, -1);
+
+    if(stream->elementsSize >= stream->elementsMaxSize) {
+        void* items = xmlSecC14NNativeGrow(stream->elements, &(stream->elementsMaxSize),
+            sizeof(xmlSecC14NNativeElementState));
+        if(items == NULL) {
+            xmlSecInternalError("xmlSecC14NNativeGrow(elements)", NULL);
+            return(-1);
+        }
+        stream->elements = (xmlSecC14NNativeElementStatePtr)items;
+    }
+
+    ret = xmlSecC14NNativeStartElement(stream, cur, 1, 1, &(stream->elements[stream->elementsSize]));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeStartElement", NULL);
+        return(-1);
+    }
+    ++stream->elementsSize;
+    return(0);
+}
+
+/**
+ * xmlSecC14NNativeStreamEndElement:
+ * @stream:             the pointer to the serializer.
+ * @cur:                the element node passed to the matching
+ *                      #xmlSecC14NNativeStreamStartElement call.
+ *
+ * Writes the element end tag.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecC14NNativeStreamEndElement(xmlSecC14NNativeStreamPtr stream, xmlNodePtr cur) {
+    int ret;
+
+    xmlSecAssert2(stream != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    if(stream->elementsSize == 0) {
+        xmlSecInvalidDataError("no open elements", NULL);
+        return(-1);
+    }
+    --stream->elementsSize;
+
+    ret = xmlSecC14NNativeEndElement(stream, cur, &(stream->elements[stream->elementsSize]));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeEndElement", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecC14NNativeStreamNode:
+ * @stream:             the pointer to the serializer.
+ * @cur:                the text, CDATA, PI or comment node.
+ *
+ * Writes the node (the document type and other nodes ignored by C14N
+ * are skipped).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecC14NNativeStreamNode(xmlSecC14NNativeStreamPtr stream, xmlNodePtr cur) {
+    xmlSecAssert2(stream != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+    xmlSecAssert2(cur->type != XML_ELEMENT_NODE, -1);
+
+    switch(cur->type) {
+    case XML_DOCUMENT_NODE:
+    case XML_DOCUMENT_FRAG_NODE:
+    case XML_HTML_DOCUMENT_NODE:
+        /* the children are delivered separately */
+        return(0);
+    default:
+        return(xmlSecC14NNativeProcessNode(stream, cur, 1));
+    }
+}
+
+/**
+ * xmlSecC14NNativeStreamFinish:
+ * @stream:             the pointer to the serializer.
+ *
+ * Checks that all the elements are closed and flushes the output buffer.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecC14NNativeStreamFinish(xmlSecC14NNativeStreamPtr stream) {
+    int ret;
+
+    xmlSecAssert2(stream != NULL, -1);
+    xmlSecAssert2(stream->buf != NULL, -1);
+
+    if(stream->elementsSize != 0) {
+        xmlSecInvalidDataError("the document elements are not closed", NULL);
+        return(-1);
+    }
+    ret = xmlOutputBufferFlush(stream->buf);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferFlush", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+#ifdef LIBXML_READER_ENABLED
+/**
+ * xmlSecC14NNativeStreamReaderNode:
+ * @stream:             the pointer to the serializer.
+ * @reader:             the reader positioned on the node to write.
+ *
+ * Writes the current @reader node (the start or end tag for the elements).
+ * The reader should be created with the entities substitution enabled:
+ * the entity references are not supported.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecC14NNativeStreamReaderNode(xmlSecC14NNativeStreamPtr stream, xmlTextReaderPtr reader) {
+    xmlNodePtr cur;
+    int type;
+    int ret;
+
+    xmlSecAssert2(stream != NULL, -1);
+    xmlSecAssert2(reader != NULL, -1);
+
+    type = xmlTextReaderNodeType(reader);
+    switch(type) {
+    case XML_READER_TYPE_ELEMENT:
+    case XML_READER_TYPE_END_ELEMENT:
+    case XML_READER_TYPE_TEXT:
+    case XML_READER_TYPE_CDATA:
+    case XML_READER_TYPE_WHITESPACE:
+    case XML_READER_TYPE_SIGNIFICANT_WHITESPACE:
+    case XML_READER_TYPE_PROCESSING_INSTRUCTION:
+    case XML_READER_TYPE_COMMENT:
+        break;
+    case XML_READER_TYPE_ENTITY_REFERENCE:
+        xmlSecUnsupportedEnumValueError("reader node type", type, NULL);
+        return(-1);
+    default:
+        /* should be ignored according to "W3C Canonical XML" */
+        return(0);
+    }
+
+    cur = xmlTextReaderCurrentNode(reader);
+    if(cur == NULL) {
+        xmlSecXmlError("xmlTextReaderCurrentNode", NULL);
+        return(-1);
+    }
+    switch(type) {
+    case XML_READER_TYPE_ELEMENT:
+        ret = xmlSecC14NNativeStreamStartElement(stream, cur);
+        if((ret >= 0) && (xmlTextReaderIsEmptyElement(reader) == 1)) {
+            ret = xmlSecC14NNativeStreamEndElement(stream, cur);
+        }
+        break;
+    case XML_READER_TYPE_END_ELEMENT:
+        ret = xmlSecC14NNativeStreamEndElement(stream, cur);
+        break;
+    default:
+        ret = xmlSecC14NNativeStreamNode(stream, cur);
+        break;
+    }
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeStream", NULL);
+        return(-1);
+    }
+    return(0);
+}
+#endif /* LIBXML_READER_ENABLED */
@@ -0,0 +1,81 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * THIS IS A PRIVATE XMLSEC HEADER FILE
+ * DON'T USE IT IN YOUR APPLICATION
+ *
+ * Native C14N serializer.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_C14N_NATIVE_H__
+#define __XMLSEC_C14N_NATIVE_H__
+
+#ifndef XMLSEC_PRIVATE
+#error "c14n_native.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <libxml/tree.h>
+#include <libxml/c14n.h>
+#ifdef LIBXML_READER_ENABLED
+#include <libxml/xmlreader.h>
+#endif /* LIBXML_READER_ENABLED */
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/nodeset.h>
+#include <xmlsec/transforms.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+XMLSEC_EXPORT int               xmlSecC14NNativeIsSupported     (xmlSecNodeSetPtr nodes,
+                                                                 xmlC14NMode mode);
+XMLSEC_EXPORT int               xmlSecC14NNativeExecute         (xmlSecNodeSetPtr nodes,
+                                                                 xmlC14NMode mode,
+                                                                 xmlChar** inclusiveNsPrefixes,
+                                                                 int withComments,
+                                                                 xmlOutputBufferPtr buf);
+XMLSEC_EXPORT int               xmlSecC14NNativeExecuteSplit    (xmlSecNodeSetPtr nodes,
+                                                                 xmlC14NMode mode,
+                                                                 xmlChar** inclusiveNsPrefixes,
+                                                                 int withComments,
+                                                                 xmlOutputBufferPtr buf,
+                                                                 xmlOutputBufferPtr tailBuf);
+
+typedef struct _xmlSecC14NNativeCtx*    xmlSecC14NNativeStreamPtr;
+
+XMLSEC_EXPORT xmlSecC14NNativeStreamPtr xmlSecC14NNativeStreamCreate    (xmlC14NMode mode,
+                                                                 xmlChar** inclusiveNsPrefixes,
+                                                                 int withComments,
+                                                                 xmlOutputBufferPtr buf);
+XMLSEC_EXPORT void              xmlSecC14NNativeStreamDestroy   (xmlSecC14NNativeStreamPtr stream);
+XMLSEC_EXPORT int               xmlSecC14NNativeStreamSetOutput (xmlSecC14NNativeStreamPtr stream,
+                                                                 xmlOutputBufferPtr buf);
+XMLSEC_EXPORT int               xmlSecC14NNativeStreamStartElement(xmlSecC14NNativeStreamPtr stream,
+                                                                 xmlNodePtr cur);
+XMLSEC_EXPORT int               xmlSecC14NNativeStreamEndElement(xmlSecC14NNativeStreamPtr stream,
+                                                                 xmlNodePtr cur);
+XMLSEC_EXPORT int               xmlSecC14NNativeStreamNode      (xmlSecC14NNativeStreamPtr stream,
+                                                                 xmlNodePtr cur);
+XMLSEC_EXPORT int               xmlSecC14NNativeStreamFinish    (xmlSecC14NNativeStreamPtr stream);
+#ifdef LIBXML_READER_ENABLED
+XMLSEC_EXPORT int               xmlSecC14NNativeStreamReaderNode(xmlSecC14NNativeStreamPtr stream,
+                                                                 xmlTextReaderPtr reader);
+#endif /* LIBXML_READER_ENABLED */
+
+XMLSEC_EXPORT int               xmlSecTransformC14NGetStreamMode(xmlSecTransformPtr transform,
+                                                                 xmlSecTransformCtxPtr transformCtx,
+                                                                 xmlC14NMode* mode,
+                                                                 xmlChar*** inclusiveNsPrefixes,
+                                                                 int* withComments);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_C14N_NATIVE_H__ */
@@ -0,0 +1,364 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Deflate (RFC 1951) compression transform implementation.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/**
+ * SECTION:deflate
+ * @Short_description: Deflate compression transform implementation.
+ * @Stability: Private
+ *
+ */
+
+#include "globals.h"
+
+#ifndef XMLSEC_NO_ZLIB
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <libxml/tree.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/keys.h>
+#include <xmlsec/transforms.h>
+#include <xmlsec/errors.h>
+
+#include "cast_helpers.h"
+
+/* the output buffer grows by this size while the data are (de)compressed */
+#define XMLSEC_DEFLATE_CHUNK_SIZE               16384
+
+/* raw deflate stream without zlib or gzip header */
+#define XMLSEC_DEFLATE_WINDOW_BITS              (-15)
+#define XMLSEC_DEFLATE_MEM_LEVEL                8
+
+/**************************************************************
+ *
+ * Deflate Transform
+ *
+ * xmlSecTransform + xmlSecDeflateCtx
+ *
+ **************************************************************/
+typedef struct _xmlSecDeflateCtx                xmlSecDeflateCtx, *xmlSecDeflateCtxPtr;
+struct _xmlSecDeflateCtx {
+    z_stream                    stream;
+    int                         initialized;
+    int                         encode;
+    int                         finished;
+    int                         level;
+    xmlSecSize                  maxOutputSize;
+    xmlSecSize                  outputSize;
+};
+
+XMLSEC_TRANSFORM_DECLARE(Deflate, xmlSecDeflateCtx)
+#define xmlSecDeflateSize XMLSEC_TRANSFORM_SIZE(Deflate)
+
+static int              xmlSecDeflateInitialize         (xmlSecTransformPtr transform);
+static void             xmlSecDeflateFinalize           (xmlSecTransformPtr transform);
+static int              xmlSecDeflateExecute            (xmlSecTransformPtr transform,
+                                                         int last,
+                                                         xmlSecTransformCtxPtr transformCtx);
+
+static xmlSecTransformKlass xmlSecDeflateKlass = {
+    /* klass/object sizes */
+    sizeof(xmlSecTransformKlass),               /* xmlSecSize klassSize */
+    xmlSecDeflateSize,                          /* xmlSecSize objSize */
+
+    xmlSecNameDeflate,                          /* const xmlChar* name; */
+    xmlSecHrefDeflate,                          /* const xmlChar* href; */
+    xmlSecTransformUsageDSigTransform,          /* xmlSecAlgorithmUsage usage; */
+
+    xmlSecDeflateInitialize,                    /* xmlSecTransformInitializeMethod initialize; */
+    xmlSecDeflateFinalize,                      /* xmlSecTransformFinalizeMethod finalize; */
+    NULL,                                       /* xmlSecTransformNodeReadMethod readNode; */
+    NULL,                                       /* xmlSecTransformNodeWriteMethod writeNode; */
+    NULL,                                       /* xmlSecTransformSetKeyReqMethod setKeyReq; */
+    NULL,                                       /* xmlSecTransformSetKeyMethod setKey; */
+    NULL,                                       /* xmlSecTransformValidateMethod validate; */
+    xmlSecTransformDefaultGetDataType,          /* xmlSecTransformGetDataTypeMethod getDataType; */
+    xmlSecTransformDefaultPushBin,              /* xmlSecTransformPushBinMethod pushBin; */
+    xmlSecTransformDefaultPopBin,               /* xmlSecTransformPopBinMethod popBin; */
+    NULL,                                       /* xmlSecTransformPushXmlMethod pushXml; */
+    NULL,                                       /* xmlSecTransformPopXmlMethod popXml; */
+    xmlSecDeflateExecute,                       /* xmlSecTransformExecuteMethod execute; */
+
+    NULL,                                       /* void* reserved0; */
+    NULL,                                       /* void* reserved1; */
+};
+
+/**
+ * xmlSecTransformDeflateGetKlass:
+ *
+ * The deflate (RFC 1951) compression transform klass. The encode operation
+ * compresses the input data and the decode operation (default) decompresses
+ * it. The transform is not defined by the XML Encryption specification: it
+ * is intended to be added to the encryption chain before the cipher (see
+ * #XMLSEC_ENC_COMPRESS_DEFLATE) when both sides agree to use it.
+ *
+ * Returns: deflate transform id.
+ */
+xmlSecTransformId
+xmlSecTransformDeflateGetKlass(void) {
+    return(&xmlSecDeflateKlass);
+}
+
+/**
+ * xmlSecTransformDeflateSetLevel:
+ * @transform:          the pointer to deflate transform.
+ * @level:              the compression level (from 0 to 9 or -1 for the zlib default).
+ *
+ * Sets the compression level for the encode operation.
+ */
+void
+xmlSecTransformDeflateSetLevel(xmlSecTransformPtr transform, int level) {
+    xmlSecDeflateCtxPtr ctx;
+
+    xmlSecAssert(xmlSecTransformCheckId(transform, xmlSecTransformDeflateId));
+    xmlSecAssert((level >= Z_DEFAULT_COMPRESSION) && (level <= Z_BEST_COMPRESSION));
+
+    ctx = xmlSecDeflateGetCtx(transform);
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->initialized == 0);
+
+    ctx->level = level;
+}
+
+/**
+ * xmlSecTransformDeflateSetMaxOutputSize:
+ * @transform:          the pointer to deflate transform.
+ * @maxOutputSize:      the max decompressed data size (0 for no limit).
+ *
+ * Sets the max size of the decompressed data for the decode operation
+ * (the default is #XMLSEC_TRANSFORM_DEFLATE_DEFAULT_MAX_OUTPUT_SIZE). The
+ * decompression fails as soon as the output exceeds this size.
+ */
+void
+xmlSecTransformDeflateSetMaxOutputSize(xmlSecTransformPtr transform, xmlSecSize maxOutputSize) {
+    xmlSecDeflateCtxPtr ctx;
+
+    xmlSecAssert(xmlSecTransformCheckId(transform, xmlSecTransformDeflateId));
+
+    ctx = xmlSecDeflateGetCtx(transform);
+    xmlSecAssert(ctx != NULL);
+
+    ctx->maxOutputSize = maxOutputSize;
+}
+
+static int
+xmlSecDeflateInitialize(xmlSecTransformPtr transform) {
+    xmlSecDeflateCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformDeflateId), -1);
+
+    ctx = xmlSecDeflateGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    memset(ctx, 0, sizeof(xmlSecDeflateCtx));
+    ctx->level = Z_DEFAULT_COMPRESSION;
+    ctx->maxOutputSize = XMLSEC_TRANSFORM_DEFLATE_DEFAULT_MAX_OUTPUT_SIZE;
+
+    transform->operation = xmlSecTransformOperationDecode;
+    return(0);
+}
+
+static void
+xmlSecDeflateFinalize(xmlSecTransformPtr transform) {
+    xmlSecDeflateCtxPtr ctx;
+
+    xmlSecAssert(xmlSecTransformCheckId(transform, xmlSecTransformDeflateId));
+
+    ctx = xmlSecDeflateGetCtx(transform);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->initialized != 0) {
+        if(ctx->encode != 0) {
+            deflateEnd(&(ctx->stream));
+        } else {
+            inflateEnd(&(ctx->stream));
+        }
+    }
+    memset(ctx, 0, sizeof(xmlSecDeflateCtx));
+}
+
+static int
+xmlSecDeflateStart(xmlSecTransformPtr transform, xmlSecDeflateCtxPtr ctx) {
+    int ret;
+
+    xmlSecAssert2(transform != NULL, -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->initialized == 0, -1);
+
+    ctx->encode = (transform->operation == xmlSecTransformOperationEncode) ? 1 : 0;
+    if(ctx->encode != 0) {
+        ret = deflateInit2(&(ctx->stream), ctx->level, Z_DEFLATED, XMLSEC_DEFLATE_WINDOW_BITS,
+            XMLSEC_DEFLATE_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+        if(ret != Z_OK) {
+            xmlSecOtherError2(XMLSEC_ERRORS_R_CRYPTO_FAILED, xmlSecTransformGetName(transform),
+                "deflateInit2: ret=%d", ret);
+            return(-1);
+        }
+    } else {
+        ret = inflateInit2(&(ctx->stream), XMLSEC_DEFLATE_WINDOW_BITS);
+        if(ret != Z_OK) {
+            xmlSecOtherError2(XMLSEC_ERRORS_R_CRYPTO_FAILED, xmlSecTransformGetName(transform),
+                "inflateInit2: ret=%d", ret);
+            return(-1);
+        }
+    }
+    ctx->initialized = 1;
+    return(0);
+}
+
+/* (de)compresses @data and appends the result to the transform output buffer */
+static int
+xmlSecDeflateUpdate(xmlSecTransformPtr transform, xmlSecDeflateCtxPtr ctx,
+                    const xmlSecByte* data, xmlSecSize dataSize, int last) {
+    xmlSecBufferPtr out;
+    xmlSecSize outSize, outLen;
+    unsigned int availIn, availOut;
+    int ret;
+
+    xmlSecAssert2(transform != NULL, -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->initialized != 0, -1);
+
+    out = &(transform->outBuf);
+
+    XMLSEC_SAFE_CAST_SIZE_TO_UINT(dataSize, availIn, return(-1), xmlSecTransformGetName(transform));
+    availOut = XMLSEC_DEFLATE_CHUNK_SIZE;
+    ctx->stream.next_in = (Bytef*)data;
+    ctx->stream.avail_in = availIn;
+
+    do {
+        outSize = xmlSecBufferGetSize(out);
+        ret = xmlSecBufferSetMaxSize(out, outSize + XMLSEC_DEFLATE_CHUNK_SIZE);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetMaxSize", xmlSecTransformGetName(transform),
+                "size=" XMLSEC_SIZE_FMT, (outSize + XMLSEC_DEFLATE_CHUNK_SIZE));
+            return(-1);
+        }
+        ctx->stream.next_out = xmlSecBufferGetData(out) + outSize;
+        ctx->stream.avail_out = availOut;
+
+        if(ctx->encode != 0) {
+            ret = deflate(&(ctx->stream), (last != 0) ? Z_FINISH : Z_NO_FLUSH);
+            if(ret == Z_STREAM_END) {
+                ctx->finished = 1;
+            } else if((ret != Z_OK) && (ret != Z_BUF_ERROR)) {
+                xmlSecOtherError3(XMLSEC_ERRORS_R_CRYPTO_FAILED, xmlSecTransformGetName(transform),
+                    "deflate: ret=%d; msg=%s", ret, xmlSecErrorsSafeString(ctx->stream.msg));
+                return(-1);
+            }
+        } else {
+            ret = inflate(&(ctx->stream), Z_NO_FLUSH);
+            if(ret == Z_STREAM_END) {
+                ctx->finished = 1;
+            } else if((ret != Z_OK) && (ret != Z_BUF_ERROR)) {
+                xmlSecOtherError3(XMLSEC_ERRORS_R_INVALID_DATA, xmlSecTransformGetName(transform),
+                    "inflate: ret=%d; msg=%s", ret, xmlSecErrorsSafeString(ctx->stream.msg));
+                return(-1);
+            }
+        }
+
+        XMLSEC_SAFE_CAST_UINT_TO_SIZE((availOut - ctx->stream.avail_out), outLen, return(-1), xmlSecTransformGetName(transform));
+        ret = xmlSecBufferSetSize(out, outSize + outLen);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetSize", xmlSecTransformGetName(transform),
+                "size=" XMLSEC_SIZE_FMT, (outSize + outLen));
+            return(-1);
+        }
+
+        /* decompression bomb protection */
+        ctx->outputSize += outLen;
+        if((ctx->encode == 0) && (ctx->maxOutputSize > 0) && (ctx->outputSize > ctx->maxOutputSize)) {
+            xmlSecInvalidSizeMoreThanError("Decompressed data size",
+                ctx->outputSize, ctx->maxOutputSize, xmlSecTransformGetName(transform));
+            return(-1);
+        }
+    } while((ctx->finished == 0) && ((ctx->stream.avail_out == 0) || ((ctx->encode != 0) && (last != 0))));
+
+    if((ctx->encode == 0) && (ctx->finished != 0) && (ctx->stream.avail_in > 0)) {
+        xmlSecInvalidDataError("unexpected data after the end of the compressed stream",
+            xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    if((last != 0) && (ctx->finished == 0)) {
+        xmlSecInvalidDataError("the compressed stream is truncated",
+            xmlSecTransformGetName(transform));
+        return(-1);
+    }
+
+    ctx->stream.next_in = NULL;
+    ctx->stream.avail_in = 0;
+    ctx->stream.next_out = NULL;
+    ctx->stream.avail_out = 0;
+    return(0);
+}
+
+static int
+xmlSecDeflateExecute(xmlSecTransformPtr transform, int last, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecDeflateCtxPtr ctx;
+    xmlSecBufferPtr in;
+    xmlSecSize inSize;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformDeflateId), -1);
+    xmlSecAssert2((transform->operation == xmlSecTransformOperationEncode) || (transform->operation == xmlSecTransformOperationDecode), -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    ctx = xmlSecDeflateGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    in = &(transform->inBuf);
+
+    if(transform->status == xmlSecTransformStatusNone) {
+        ret = xmlSecDeflateStart(transform, ctx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDeflateStart", xmlSecTransformGetName(transform));
+            return(-1);
+        }
+        transform->status = xmlSecTransformStatusWorking;
+    }
+
+    switch(transform->status) {
+        case xmlSecTransformStatusWorking:
+            inSize = xmlSecBufferGetSize(in);
+            if((inSize > 0) || (last != 0)) {
+                ret = xmlSecDeflateUpdate(transform, ctx, xmlSecBufferGetData(in), inSize, last);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecDeflateUpdate", xmlSecTransformGetName(transform));
+                    return(-1);
+                }
+
+                /* remove chunk from input */
+                ret = xmlSecBufferRemoveHead(in, inSize);
+                if(ret < 0) {
+                    xmlSecInternalError2("xmlSecBufferRemoveHead", xmlSecTransformGetName(transform),
+                        "size=" XMLSEC_SIZE_FMT, inSize);
+                    return(-1);
+                }
+            }
+            if(last != 0) {
+                transform->status = xmlSecTransformStatusFinished;
+            }
+            break;
+        case xmlSecTransformStatusFinished:
+            /* the only way we can get here is if there is no input */
+            xmlSecAssert2(xmlSecBufferGetSize(in) == 0, -1);
+            break;
+        default:
+            xmlSecInvalidTransfromStatusError(transform);
+            return(-1);
+    }
+    return(0);
+}
+
+#endif /* XMLSEC_NO_ZLIB */
@@ -15,6 +15,7 @@
  */
 #include "globals.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -35,6 +36,10 @@
 #include <xmlsec/errors.h>
 #include <xmlsec/dl.h>
 
+#include "dl_helpers.h"
+#include "keysdata_helpers.h"
+#include "transform_helpers.h"
+
 #ifndef XMLSEC_NO_CRYPTO_DYNAMIC_LOADING
 
 #ifdef XMLSEC_DL_LIBLTDL
@@ -347,6 +352,9 @@ xmlSecCryptoDLLibrariesListFindByName(xmlSecPtrListPtr list, const xmlChar* name
 static xmlSecCryptoDLFunctionsPtr gXmlSecCryptoDLFunctions = NULL;
 static xmlSecPtrList gXmlSecCryptoDLLibraries;
 
+/* resolved once in xmlSecCryptoDLSetFunctions() */
+xmlSecCryptoDLFunctions xmlSecCryptoDLCurrentFunctions;
+
 /**
  * xmlSecCryptoDLInit:
  *
@@ -510,6 +518,7 @@ xmlSecCryptoDLUnloadLibrary(const xmlChar* crypto) {
     lib = (xmlSecCryptoDLLibraryPtr)xmlSecPtrListGetItem(&gXmlSecCryptoDLLibraries, pos);
     if((lib != NULL) && (lib->functions == gXmlSecCryptoDLFunctions)) {
         gXmlSecCryptoDLFunctions = NULL;
+        memset(&xmlSecCryptoDLCurrentFunctions, 0, sizeof(xmlSecCryptoDLCurrentFunctions));
     }
 
     ret = xmlSecPtrListRemove(&gXmlSecCryptoDLLibraries, pos);
@@ -526,6 +535,10 @@ xmlSecCryptoDLUnloadLibrary(const xmlChar* crypto) {
  * @functions:          the new table
  *
  * Sets global crypto functions/transforms/keys data/keys store table.
+ * The table is copied and the crypto engine independent functions (e.g.
+ * #xmlSecCryptoAppInit) call the xmlsec-$crypto library through this copy:
+ * the changes made to @functions after this call are ignored until
+ * #xmlSecCryptoDLSetFunctions is called again.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
@@ -534,6 +547,7 @@ xmlSecCryptoDLSetFunctions(xmlSecCryptoDLFunctionsPtr functions) {
     xmlSecAssert2(functions != NULL, -1);
 
     gXmlSecCryptoDLFunctions = functions;
+    memcpy(&xmlSecCryptoDLCurrentFunctions, functions, sizeof(xmlSecCryptoDLCurrentFunctions));
 
     return(0);
 }
@@ -553,162 +567,175 @@ xmlSecCryptoDLGetFunctions(void) {
 #endif /* XMLSEC_NO_CRYPTO_DYNAMIC_LOADING */
 
 
-#define XMLSEC_REGISTER_KEY_DATA(name)      \
-    if((functions->keyData ## name ## GetKlass != NULL) && (xmlSecKeyDataIdsRegister(functions->keyData ## name ## GetKlass()) < 0)) {    \
-        xmlSecInternalError("xmlSecKeyDataIdsRegister", xmlSecKeyDataKlassGetName(functions->keyData ## name ## GetKlass()));             \
-        return(-1);                                                                                                                       \
-    }                                                                                                                                     \
+/* the offsets of the klass getters in the functions table: the tables are built at compile time */
+#define XMLSEC_KEY_DATA_KLASS(name)     offsetof(xmlSecCryptoDLFunctions, keyData ## name ## GetKlass)
+#define XMLSEC_TRANSFORM_KLASS(name)    offsetof(xmlSecCryptoDLFunctions, transform ## name ## GetKlass)
+
+static const size_t xmlSecCryptoDLKeyDataKlasses[] = {
+    XMLSEC_KEY_DATA_KLASS(Aes),
+    XMLSEC_KEY_DATA_KLASS(ConcatKdf),
+    XMLSEC_KEY_DATA_KLASS(Des),
+    XMLSEC_KEY_DATA_KLASS(Dh),
+    XMLSEC_KEY_DATA_KLASS(Dsa),
+    XMLSEC_KEY_DATA_KLASS(Ec),
+    XMLSEC_KEY_DATA_KLASS(Gost2001),
+    XMLSEC_KEY_DATA_KLASS(GostR3410_2012_256),
+    XMLSEC_KEY_DATA_KLASS(GostR3410_2012_512),
+    XMLSEC_KEY_DATA_KLASS(Hmac),
+    XMLSEC_KEY_DATA_KLASS(Pbkdf2),
+    XMLSEC_KEY_DATA_KLASS(Rsa),
+    XMLSEC_KEY_DATA_KLASS(X509),
+    XMLSEC_KEY_DATA_KLASS(RawX509Cert),
+    XMLSEC_KEY_DATA_KLASS(DEREncodedKeyValue),
+};
 
+static const size_t xmlSecCryptoDLTransformKlasses[] = {
+    XMLSEC_TRANSFORM_KLASS(Aes128Cbc),
+    XMLSEC_TRANSFORM_KLASS(Aes192Cbc),
+    XMLSEC_TRANSFORM_KLASS(Aes256Cbc),
 
-#define XMLSEC_REGISTER_TRANSFORM(name)     \
-    if((functions->transform ## name ## GetKlass != NULL) && xmlSecTransformIdsRegister(functions->transform ## name ## GetKlass()) < 0) {   \
-        xmlSecInternalError("xmlSecTransformIdsRegister", xmlSecTransformKlassGetName(functions->transform ## name ## GetKlass()));          \
-        return(-1);                                                                                                                             \
-    }                                                                                                                                           \
+    XMLSEC_TRANSFORM_KLASS(Aes128Gcm),
+    XMLSEC_TRANSFORM_KLASS(Aes192Gcm),
+    XMLSEC_TRANSFORM_KLASS(Aes256Gcm),
 
+    XMLSEC_TRANSFORM_KLASS(ConcatKdf),
 
-/**
- * xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms:
- * @functions:          the functions table.
- *
- * Registers the key data and transforms klasses from @functions table in xmlsec.
- *
- * Returns: 0 on success or a negative value if an error occurs.
- */
-int
-xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms(struct _xmlSecCryptoDLFunctions* functions) {
-    xmlSecAssert2(functions != NULL, -1);
+    XMLSEC_TRANSFORM_KLASS(KWAes128),
+    XMLSEC_TRANSFORM_KLASS(KWAes192),
+    XMLSEC_TRANSFORM_KLASS(KWAes256),
 
-    /****************************************************************************
-     *
-     * Register keys
-     *
-     ****************************************************************************/
-    XMLSEC_REGISTER_KEY_DATA(Aes);                  // keyDataAesGetKlass
-    XMLSEC_REGISTER_KEY_DATA(ConcatKdf);            // keyDataConcatKdfGetKlass
-    XMLSEC_REGISTER_KEY_DATA(Des);                  // keyDataDesGetKlass
-    XMLSEC_REGISTER_KEY_DATA(Dh);                   // keyDataDhGetKlass
-    XMLSEC_REGISTER_KEY_DATA(Dsa);                  // keyDataDsaGetKlass
-    XMLSEC_REGISTER_KEY_DATA(Ec);                   // keyDataEcGetKlass
-    XMLSEC_REGISTER_KEY_DATA(Gost2001);             // keyDataGost2001GetKlass
-    XMLSEC_REGISTER_KEY_DATA(GostR3410_2012_256);   // keyDataGostR3410_2012_256GetKlass
-    XMLSEC_REGISTER_KEY_DATA(GostR3410_2012_512);   // keyDataGetKlass
-    XMLSEC_REGISTER_KEY_DATA(Hmac);                 // keyDataHmacGetKlass
-    XMLSEC_REGISTER_KEY_DATA(Pbkdf2);               // keyDataPbkdf2GetKlass
-    XMLSEC_REGISTER_KEY_DATA(Rsa);                  // keyDataRsaGetKlass
-    XMLSEC_REGISTER_KEY_DATA(X509);                 // keyDataX509GetKlass
-    XMLSEC_REGISTER_KEY_DATA(RawX509Cert);          // keyDataRawX509CertGetKlass
-    XMLSEC_REGISTER_KEY_DATA(DEREncodedKeyValue);   // keyDataDEREncodedKeyValueGetKlass
+    XMLSEC_TRANSFORM_KLASS(Des3Cbc),
 
-    /****************************************************************************
-     *
-     * Register transforms
-     *
-     ****************************************************************************/
-    XMLSEC_REGISTER_TRANSFORM(Aes128Cbc);                           // transformAes128CbcGetKlass
-    XMLSEC_REGISTER_TRANSFORM(Aes192Cbc);                           // transformAes192CbcGetKlass
-    XMLSEC_REGISTER_TRANSFORM(Aes192Cbc);                           // transformAes192CbcGetKlass
-    XMLSEC_REGISTER_TRANSFORM(Aes256Cbc);                           // transformAes256CbcGetKlass
+    XMLSEC_TRANSFORM_KLASS(KWDes3),
 
-    XMLSEC_REGISTER_TRANSFORM(Aes128Gcm);                           // transformAes128GcmGetKlass
-    XMLSEC_REGISTER_TRANSFORM(Aes192Gcm);                           // transformAes192GcmGetKlass
-    XMLSEC_REGISTER_TRANSFORM(Aes256Gcm);                           // transformAes256GcmGetKlass
+    XMLSEC_TRANSFORM_KLASS(Gost2001GostR3411_94),
+    XMLSEC_TRANSFORM_KLASS(GostR3410_2012GostR3411_2012_256),
+    XMLSEC_TRANSFORM_KLASS(GostR3410_2012GostR3411_2012_512),
 
-    XMLSEC_REGISTER_TRANSFORM(ConcatKdf);                           // transformConcatKdfGetKlass
+    XMLSEC_TRANSFORM_KLASS(DhEs),
 
-    XMLSEC_REGISTER_TRANSFORM(KWAes128);                            // transformKWAes128GetKlass
-    XMLSEC_REGISTER_TRANSFORM(KWAes192);                            // transformKWAes192GetKlass
-    XMLSEC_REGISTER_TRANSFORM(KWAes256);                            // transformKWAes256GetKlass
+    XMLSEC_TRANSFORM_KLASS(DsaSha1),
+    XMLSEC_TRANSFORM_KLASS(DsaSha256),
 
-    XMLSEC_REGISTER_TRANSFORM(Des3Cbc);                             // transformDes3CbcGetKlass
+    XMLSEC_TRANSFORM_KLASS(Ecdh),
 
-    XMLSEC_REGISTER_TRANSFORM(KWDes3);                              // transformKWDes3GetKlass
+    XMLSEC_TRANSFORM_KLASS(EcdsaRipemd160),
 
-    XMLSEC_REGISTER_TRANSFORM(Gost2001GostR3411_94);                // transformGost2001GostR3411_94GetKlass
-    XMLSEC_REGISTER_TRANSFORM(GostR3410_2012GostR3411_2012_256);    // transformGostR3410_2012GostR3411_2012_256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(GostR3410_2012GostR3411_2012_512);    // transformGostR3410_2012GostR3411_2012_512GetKlass
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha1),
 
-    XMLSEC_REGISTER_TRANSFORM(DhEs);                                // transformDhEsGetKlass
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha224),
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha256),
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha384),
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha512),
 
-    XMLSEC_REGISTER_TRANSFORM(DsaSha1);                             // transformDsaSha1GetKlass
-    XMLSEC_REGISTER_TRANSFORM(DsaSha256);                           // transformDsaSha256GetKlass
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha3_224),
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha3_256),
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha3_384),
+    XMLSEC_TRANSFORM_KLASS(EcdsaSha3_512),
 
-    XMLSEC_REGISTER_TRANSFORM(Ecdh);                                // transformEcdhGetKlass
+    XMLSEC_TRANSFORM_KLASS(HmacMd5),
 
-    XMLSEC_REGISTER_TRANSFORM(EcdsaRipemd160);                      // transformEcdsaRipemd160GetKlass
+    XMLSEC_TRANSFORM_KLASS(HmacRipemd160),
 
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha1);                           // transformEcdsaSha1GetKlass
+    XMLSEC_TRANSFORM_KLASS(HmacSha1),
 
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha224);                         // transformEcdsaSha224GetKlass
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha256);                         // transformEcdsaSha256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha384);                         // transformEcdsaSha384GetKlass
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha512);                         // transformEcdsaSha512GetKlass
+    XMLSEC_TRANSFORM_KLASS(HmacSha224),
+    XMLSEC_TRANSFORM_KLASS(HmacSha256),
+    XMLSEC_TRANSFORM_KLASS(HmacSha384),
+    XMLSEC_TRANSFORM_KLASS(HmacSha512),
 
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha3_224);                       // transformEcdsaSha3_224GetKlass
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha3_256);                       // transformEcdsaSha3_256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha3_384);                       // transformEcdsaSha3_384GetKlass
-    XMLSEC_REGISTER_TRANSFORM(EcdsaSha3_512);                       // transformEcdsaSha3_512GetKlass
+    XMLSEC_TRANSFORM_KLASS(Md5),
 
-    XMLSEC_REGISTER_TRANSFORM(HmacMd5);                             // transformHmacMd5GetKlass
+    XMLSEC_TRANSFORM_KLASS(Pbkdf2),
 
-    XMLSEC_REGISTER_TRANSFORM(HmacRipemd160);                       // transformHmacRipemd160GetKlass
+    XMLSEC_TRANSFORM_KLASS(Ripemd160),
 
-    XMLSEC_REGISTER_TRANSFORM(HmacSha1);                            // transformHmacSha1GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaMd5),
 
-    XMLSEC_REGISTER_TRANSFORM(HmacSha224);                          // transformHmacSha224GetKlass
-    XMLSEC_REGISTER_TRANSFORM(HmacSha256);                          // transformHmacSha256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(HmacSha384);                          // transformHmacSha384GetKlass
-    XMLSEC_REGISTER_TRANSFORM(HmacSha512);                          // transformHmacSha512GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaRipemd160),
 
-    XMLSEC_REGISTER_TRANSFORM(Md5);                                 // transformMd5GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaSha1),
 
-    XMLSEC_REGISTER_TRANSFORM(Pbkdf2);                              // transformPbkdf2GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaSha224),
+    XMLSEC_TRANSFORM_KLASS(RsaSha256),
+    XMLSEC_TRANSFORM_KLASS(RsaSha384),
+    XMLSEC_TRANSFORM_KLASS(RsaSha512),
 
-    XMLSEC_REGISTER_TRANSFORM(Ripemd160);                           // transformRipemd160GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha1),
 
-    XMLSEC_REGISTER_TRANSFORM(RsaMd5);                              // transformRsaMd5GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha224),
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha256),
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha384),
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha512),
 
-    XMLSEC_REGISTER_TRANSFORM(RsaRipemd160);                        // transformRsaRipemd160GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha3_224),
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha3_256),
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha3_384),
+    XMLSEC_TRANSFORM_KLASS(RsaPssSha3_512),
 
-    XMLSEC_REGISTER_TRANSFORM(RsaSha1);                             // transformRsaSha1GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaPkcs1),
 
-    XMLSEC_REGISTER_TRANSFORM(RsaSha224);                           // transformRsaSha224GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaSha256);                           // transformRsaSha256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaSha384);                           // transformRsaSha384GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaSha512);                           // transformRsaSha512GetKlass
+    XMLSEC_TRANSFORM_KLASS(RsaOaep),
+    XMLSEC_TRANSFORM_KLASS(RsaOaepEnc11),
 
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha1);                          // transformRsaPssSha1GetKlass
+    XMLSEC_TRANSFORM_KLASS(GostR3411_94),
+    XMLSEC_TRANSFORM_KLASS(GostR3411_2012_256),
+    XMLSEC_TRANSFORM_KLASS(GostR3411_2012_512),
 
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha224);                        // transformRsaPssSha224GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha256);                        // transformRsaPssSha256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha384);                        // transformRsaPssSha384GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha512);                        // transformRsaPssSha512GetKlass
+    XMLSEC_TRANSFORM_KLASS(Sha1),
 
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha3_224);                      // transformRsaPssSha3_224GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha3_256);                      // transformRsaPssSha3_256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha3_384);                      // transformRsaPssSha3_384GetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaPssSha3_512);                      // transformRsaPssSha3_512GetKlass
+    XMLSEC_TRANSFORM_KLASS(Sha224),
+    XMLSEC_TRANSFORM_KLASS(Sha256),
+    XMLSEC_TRANSFORM_KLASS(Sha384),
+    XMLSEC_TRANSFORM_KLASS(Sha512),
 
-    XMLSEC_REGISTER_TRANSFORM(RsaPkcs1);                            // transformRsaPkcs1GetKlass
+    XMLSEC_TRANSFORM_KLASS(Sha3_224),
+    XMLSEC_TRANSFORM_KLASS(Sha3_256),
+    XMLSEC_TRANSFORM_KLASS(Sha3_384),
+    XMLSEC_TRANSFORM_KLASS(Sha3_512),
+};
 
-    XMLSEC_REGISTER_TRANSFORM(RsaOaep);                             // transformRsaOaepGetKlass
-    XMLSEC_REGISTER_TRANSFORM(RsaOaepEnc11);                        // transformRsaOaepEnc11GetKlass
+#define XMLSEC_CRYPTO_DL_KEY_DATA_KLASSES_SIZE \
+    (sizeof(xmlSecCryptoDLKeyDataKlasses) / sizeof(xmlSecCryptoDLKeyDataKlasses[0]))
+#define XMLSEC_CRYPTO_DL_TRANSFORM_KLASSES_SIZE \
+    (sizeof(xmlSecCryptoDLTransformKlasses) / sizeof(xmlSecCryptoDLTransformKlasses[0]))
 
-    XMLSEC_REGISTER_TRANSFORM(GostR3411_94);                        // transformGostR3411_94GetKlass
-    XMLSEC_REGISTER_TRANSFORM(GostR3411_2012_256);                  // transformGostR3411_2012_256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(GostR3411_2012_512);                  // transformGostR3411_2012_512GetKlass
+/**
+ * xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms:
+ * @functions:          the functions table.
+ *
+ * Registers the key data and transforms klasses from @functions table in xmlsec.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms(struct _xmlSecCryptoDLFunctions* functions) {
+    xmlSecKeyDataId keyDataIds[XMLSEC_CRYPTO_DL_KEY_DATA_KLASSES_SIZE];
+    xmlSecTransformId transformIds[XMLSEC_CRYPTO_DL_TRANSFORM_KLASSES_SIZE];
+    xmlSecCryptoKeyDataGetKlassMethod keyDataGetKlass;
+    xmlSecCryptoTransformGetKlassMethod transformGetKlass;
+    xmlSecSize ii;
 
-    XMLSEC_REGISTER_TRANSFORM(Sha1);                                // transformSha1GetKlass
+    xmlSecAssert2(functions != NULL, -1);
 
-    XMLSEC_REGISTER_TRANSFORM(Sha224);                              // transformSha224GetKlass
-    XMLSEC_REGISTER_TRANSFORM(Sha256);                              // transformSha256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(Sha384);                              // transformSha384GetKlass
-    XMLSEC_REGISTER_TRANSFORM(Sha512);                              // transformSha512GetKlass
+    /* the klasses not implemented by the crypto library are skipped */
+    for(ii = 0; ii < XMLSEC_CRYPTO_DL_KEY_DATA_KLASSES_SIZE; ++ii) {
+        memcpy(&keyDataGetKlass, (const xmlSecByte*)functions + xmlSecCryptoDLKeyDataKlasses[ii], sizeof(keyDataGetKlass));
+        keyDataIds[ii] = (keyDataGetKlass != NULL) ? keyDataGetKlass() : xmlSecKeyDataIdUnknown;
+    }
+    if(xmlSecKeyDataIdsRegisterArray(keyDataIds, XMLSEC_CRYPTO_DL_KEY_DATA_KLASSES_SIZE) < 0) {
+        xmlSecInternalError("xmlSecKeyDataIdsRegisterArray", NULL);
+        return(-1);
+    }
 
-    XMLSEC_REGISTER_TRANSFORM(Sha3_224);                            // transformSha3_224GetKlass
-    XMLSEC_REGISTER_TRANSFORM(Sha3_256);                            // transformSha3_256GetKlass
-    XMLSEC_REGISTER_TRANSFORM(Sha3_384);                            // transformSha3_384GetKlass
-    XMLSEC_REGISTER_TRANSFORM(Sha3_512);                            // transformSha3_512GetKlass
+    for(ii = 0; ii < XMLSEC_CRYPTO_DL_TRANSFORM_KLASSES_SIZE; ++ii) {
+        memcpy(&transformGetKlass, (const xmlSecByte*)functions + xmlSecCryptoDLTransformKlasses[ii], sizeof(transformGetKlass));
+        transformIds[ii] = (transformGetKlass != NULL) ? transformGetKlass() : xmlSecTransformIdUnknown;
+    }
+    if(xmlSecTransformIdsRegisterArray(transformIds, XMLSEC_CRYPTO_DL_TRANSFORM_KLASSES_SIZE) < 0) {
+        xmlSecInternalError("xmlSecTransformIdsRegisterArray", NULL);
+        return(-1);
+    }
 
     /* done */
     return(0);
@@ -0,0 +1,35 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Internal header only used during the compilation,
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_DL_HELPERS_H__
+#define __XMLSEC_DL_HELPERS_H__
+
+
+#ifndef XMLSEC_PRIVATE
+#error "dl_helpers.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/private.h>
+
+/**************************** Crypto functions dispatch ********************************/
+
+#ifndef XMLSEC_NO_CRYPTO_DYNAMIC_LOADING
+
+/* The copy of the table set with xmlSecCryptoDLSetFunctions() (dl.c): the
+ * crypto engine independent functions (app.c) call the xmlsec-$crypto library
+ * directly through it. All the entries are NULL if no library is loaded.
+ * With XMLSEC_NO_CRYPTO_DYNAMIC_LOADING, the calls are bound at compile
+ * time instead (see xmlsec/crypto.h). */
+extern xmlSecCryptoDLFunctions xmlSecCryptoDLCurrentFunctions;
+
+#endif /* XMLSEC_NO_CRYPTO_DYNAMIC_LOADING */
+
+#endif /* __XMLSEC_DL_HELPERS_H__ */
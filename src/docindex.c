@@ -0,0 +1,777 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The shared per-document index of the elements.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/**
+ * SECTION:docindex
+ * @Short_description: The shared per-document index.
+ * @Stability: Stable
+ *
+ * The document index replaces the repeated document walks (looking for the
+ * ID attributes, the signatures, the in-scope namespaces, etc.) with the
+ * lookups in the tables built with one walk. The index is registered for
+ * the document with #xmlSecDocIndexCreate and all the processing contexts
+ * working with this document find and use it automatically.
+ *
+ * The xmlsec functions that modify the document (#xmlSecAddChild,
+ * #xmlSecReplaceNode, the decryption, etc.) invalidate the index. The
+ * application must call #xmlSecDocIndexInvalidate after changing the
+ * document elements or attributes by other means. The document must not
+ * be modified while it is processed in other threads.
+ */
+#include "globals.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libxml/tree.h>
+#include <libxml/threads.h>
+#include <libxml/xpath.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/docindex.h>
+#include <xmlsec/errors.h>
+
+#include "docindex_helpers.h"
+
+/**************************************************************************
+ *
+ * The registry of the indexes (doc -> index)
+ *
+ *************************************************************************/
+#define XMLSEC_DOC_INDEX_REGISTRY_SIZE          64
+
+static xmlMutexPtr              gXmlSecDocIndexMutex = NULL;
+static xmlSecDocIndexPtr        gXmlSecDocIndexTable[XMLSEC_DOC_INDEX_REGISTRY_SIZE];
+static xmlSecSize               gXmlSecDocIndexCount = 0;
+
+static xmlSecSize
+xmlSecDocIndexHashPtr(const void* ptr) {
+    xmlSecSize hash = (xmlSecSize)((size_t)ptr);
+
+    /* pointers are aligned, mix the bits a bit */
+    hash ^= (hash >> 4) ^ (hash >> 12);
+    return(hash * 2654435761U);
+}
+
+static xmlSecSize
+xmlSecDocIndexHashName(const xmlChar* name) {
+    xmlSecSize hash = 2166136261U;
+
+    xmlSecAssert2(name != NULL, 0);
+
+    for(; (*name) != '\0'; ++name) {
+        hash = (hash ^ (*name)) * 16777619U;
+    }
+    return(hash);
+}
+
+/**
+ * xmlSecDocIndexInitialize:
+ *
+ * Initializes the documents indexes registry. If the registry can't be
+ * initialized then the indexes can't be created.
+ */
+void
+xmlSecDocIndexInitialize(void) {
+    xmlSecAssert(gXmlSecDocIndexMutex == NULL);
+
+    memset(gXmlSecDocIndexTable, 0, sizeof(gXmlSecDocIndexTable));
+    gXmlSecDocIndexCount = 0;
+
+    gXmlSecDocIndexMutex = xmlNewMutex();
+    if(gXmlSecDocIndexMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+    }
+}
+
+/**
+ * xmlSecDocIndexShutdown:
+ *
+ * Shutdowns the documents indexes registry. The indexes that are still
+ * registered are not destroyed (the application owns them) but they are
+ * not found for the documents anymore.
+ */
+void
+xmlSecDocIndexShutdown(void) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < XMLSEC_DOC_INDEX_REGISTRY_SIZE; ++ii) {
+        while(gXmlSecDocIndexTable[ii] != NULL) {
+            xmlSecDocIndexPtr index = gXmlSecDocIndexTable[ii];
+            gXmlSecDocIndexTable[ii] = index->next;
+            index->next = NULL;
+        }
+    }
+    gXmlSecDocIndexCount = 0;
+
+    if(gXmlSecDocIndexMutex != NULL) {
+        xmlFreeMutex(gXmlSecDocIndexMutex);
+        gXmlSecDocIndexMutex = NULL;
+    }
+}
+
+/**************************************************************************
+ *
+ * The index tables
+ *
+ *************************************************************************/
+static void
+xmlSecDocIndexNamesReset(xmlSecDocIndexNamesPtr names) {
+    xmlSecSize ii;
+
+    xmlSecAssert(names != NULL);
+
+    if(names->table != NULL) {
+        for(ii = 0; ii < names->tableSize; ++ii) {
+            if(names->table[ii].ordinals != NULL) {
+                xmlFree(names->table[ii].ordinals);
+            }
+        }
+        xmlFree(names->table);
+    }
+    memset(names, 0, sizeof(xmlSecDocIndexNames));
+}
+
+static xmlSecDocIndexNamePtr
+xmlSecDocIndexNamesFind(xmlSecDocIndexNamesPtr names, const xmlChar* name) {
+    xmlSecSize pos;
+
+    xmlSecAssert2(names != NULL, NULL);
+    xmlSecAssert2(name != NULL, NULL);
+
+    if(names->tableSize == 0) {
+        return(NULL);
+    }
+    pos = xmlSecDocIndexHashName(name) & (names->tableSize - 1);
+    while(names->table[pos].name != NULL) {
+        if((names->table[pos].name == name) || xmlStrEqual(names->table[pos].name, name)) {
+            return(&(names->table[pos]));
+        }
+        pos = (pos + 1) & (names->tableSize - 1);
+    }
+    return(NULL);
+}
+
+static int
+xmlSecDocIndexNamesGrow(xmlSecDocIndexNamesPtr names) {
+    xmlSecDocIndexNamePtr newTable;
+    xmlSecSize newSize, ii, pos;
+
+    xmlSecAssert2(names != NULL, -1);
+
+    newSize = (names->tableSize > 0) ? (2 * names->tableSize) : 64;
+    newTable = (xmlSecDocIndexNamePtr)xmlMalloc(newSize * sizeof(xmlSecDocIndexName));
+    if(newTable == NULL) {
+        xmlSecMallocError(newSize * sizeof(xmlSecDocIndexName), NULL);
+        return(-1);
+    }
+    memset(newTable, 0, newSize * sizeof(xmlSecDocIndexName));
+
+    for(ii = 0; ii < names->tableSize; ++ii) {
+        if(names->table[ii].name == NULL) {
+            continue;
+        }
+        pos = xmlSecDocIndexHashName(names->table[ii].name) & (newSize - 1);
+        while(newTable[pos].name != NULL) {
+            pos = (pos + 1) & (newSize - 1);
+        }
+        newTable[pos] = names->table[ii];
+    }
+    if(names->table != NULL) {
+        xmlFree(names->table);
+    }
+    names->table = newTable;
+    names->tableSize = newSize;
+    return(0);
+}
+
+/* adds the @ordinal to the list for @name (the ordinals are added in the document order) */
+static int
+xmlSecDocIndexNamesAdd(xmlSecDocIndexNamesPtr names, const xmlChar* name, xmlSecSize ordinal) {
+    xmlSecDocIndexNamePtr entry;
+    xmlSecSize pos;
+    int ret;
+
+    xmlSecAssert2(names != NULL, -1);
+    xmlSecAssert2(name != NULL, -1);
+
+    entry = xmlSecDocIndexNamesFind(names, name);
+    if(entry == NULL) {
+        /* keep the load factor under 1/2 */
+        if(2 * (names->size + 1) > names->tableSize) {
+            ret = xmlSecDocIndexNamesGrow(names);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDocIndexNamesGrow", NULL);
+                return(-1);
+            }
+        }
+        pos = xmlSecDocIndexHashName(name) & (names->tableSize - 1);
+        while(names->table[pos].name != NULL) {
+            pos = (pos + 1) & (names->tableSize - 1);
+        }
+        entry = &(names->table[pos]);
+        entry->name = name;
+        ++names->size;
+    } else if((entry->size > 0) && (entry->ordinals[entry->size - 1] == ordinal)) {
+        /* the same element has several attributes with this local name */
+        return(0);
+    }
+
+    if(entry->size >= entry->maxSize) {
+        xmlSecSize newSize = (entry->maxSize > 0) ? (2 * entry->maxSize) : 4;
+        xmlSecSize* newOrdinals;
+
+        newOrdinals = (xmlSecSize*)xmlRealloc(entry->ordinals, newSize * sizeof(xmlSecSize));
+        if(newOrdinals == NULL) {
+            xmlSecMallocError(newSize * sizeof(xmlSecSize), NULL);
+            return(-1);
+        }
+        entry->ordinals = newOrdinals;
+        entry->maxSize = newSize;
+    }
+    entry->ordinals[entry->size++] = ordinal;
+    return(0);
+}
+
+static void
+xmlSecDocIndexReset(xmlSecDocIndexPtr index) {
+    xmlSecAssert(index != NULL);
+
+    if(index->elements != NULL) {
+        xmlFree(index->elements);
+    }
+    if(index->nodesTable != NULL) {
+        xmlFree(index->nodesTable);
+    }
+    index->elements = NULL;
+    index->elementsSize = 0;
+    index->elementsMaxSize = 0;
+    index->nodesTable = NULL;
+    index->nodesTableSize = 0;
+    xmlSecDocIndexNamesReset(&(index->elementNames));
+    xmlSecDocIndexNamesReset(&(index->attrNames));
+    index->built = 0;
+}
+
+static int
+xmlSecDocIndexAddElement(xmlSecDocIndexPtr index, xmlNodePtr node, xmlSecSize parent) {
+    xmlSecDocIndexElementPtr elem;
+    xmlSecSize ordinal;
+    xmlAttrPtr attr;
+    int ret;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->type == XML_ELEMENT_NODE, -1);
+
+    if(index->elementsSize >= index->elementsMaxSize) {
+        xmlSecSize newSize = (index->elementsMaxSize > 0) ? (2 * index->elementsMaxSize) : 256;
+        xmlSecDocIndexElementPtr newElements;
+
+        newElements = (xmlSecDocIndexElementPtr)xmlRealloc(index->elements, newSize * sizeof(xmlSecDocIndexElement));
+        if(newElements == NULL) {
+            xmlSecMallocError(newSize * sizeof(xmlSecDocIndexElement), NULL);
+            return(-1);
+        }
+        index->elements = newElements;
+        index->elementsMaxSize = newSize;
+    }
+
+    ordinal = index->elementsSize++;
+    elem = &(index->elements[ordinal]);
+    elem->node = node;
+    elem->last = ordinal;
+    elem->parent = parent;
+    if(node->nsDef != NULL) {
+        elem->nsScope = ordinal + 1;
+    } else if(parent > 0) {
+        elem->nsScope = index->elements[parent - 1].nsScope;
+    } else {
+        elem->nsScope = 0;
+    }
+
+    ret = xmlSecDocIndexNamesAdd(&(index->elementNames), node->name, ordinal);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDocIndexNamesAdd(element)", NULL);
+        return(-1);
+    }
+    for(attr = node->properties; attr != NULL; attr = attr->next) {
+        ret = xmlSecDocIndexNamesAdd(&(index->attrNames), attr->name, ordinal);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDocIndexNamesAdd(attr)", NULL);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static int
+xmlSecDocIndexBuildNodesTable(xmlSecDocIndexPtr index) {
+    xmlSecSize ii, pos;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(index->nodesTable == NULL, -1);
+
+    /* keep the load factor under 1/2 */
+    index->nodesTableSize = 64;
+    while(index->nodesTableSize < 2 * index->elementsSize) {
+        index->nodesTableSize *= 2;
+    }
+    index->nodesTable = (xmlSecSize*)xmlMalloc(index->nodesTableSize * sizeof(xmlSecSize));
+    if(index->nodesTable == NULL) {
+        xmlSecMallocError(index->nodesTableSize * sizeof(xmlSecSize), NULL);
+        index->nodesTableSize = 0;
+        return(-1);
+    }
+    memset(index->nodesTable, 0, index->nodesTableSize * sizeof(xmlSecSize));
+
+    for(ii = 0; ii < index->elementsSize; ++ii) {
+        pos = xmlSecDocIndexHashPtr(index->elements[ii].node) & (index->nodesTableSize - 1);
+        while(index->nodesTable[pos] != 0) {
+            pos = (pos + 1) & (index->nodesTableSize - 1);
+        }
+        index->nodesTable[pos] = ii + 1;
+    }
+    return(0);
+}
+
+/* walks the document elements once and builds all the tables */
+static int
+xmlSecDocIndexBuild(xmlSecDocIndexPtr index) {
+    xmlNodePtr cur;
+    xmlSecSize parent = 0;
+    int ret;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(index->doc != NULL, -1);
+
+    xmlSecDocIndexReset(index);
+
+    cur = index->doc->children;
+    while(cur != NULL) {
+        if(cur->type == XML_ELEMENT_NODE) {
+            ret = xmlSecDocIndexAddElement(index, cur, parent);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDocIndexAddElement", NULL);
+                xmlSecDocIndexReset(index);
+                return(-1);
+            }
+            if(cur->children != NULL) {
+                parent = index->elementsSize;
+                cur = cur->children;
+                continue;
+            }
+        }
+
+        /* the next sibling or the next sibling of the nearest ancestor */
+        while((cur->next == NULL) && (parent > 0)) {
+            /* all the descendants of the parent are added */
+            index->elements[parent - 1].last = index->elementsSize - 1;
+            cur = index->elements[parent - 1].node;
+            parent = index->elements[parent - 1].parent;
+        }
+        cur = cur->next;
+    }
+
+    ret = xmlSecDocIndexBuildNodesTable(index);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDocIndexBuildNodesTable", NULL);
+        xmlSecDocIndexReset(index);
+        return(-1);
+    }
+
+    /* libxml2 XPath engine uses the elements ordinals to sort the results */
+    (void)xmlXPathOrderDocElems(index->doc);
+
+    index->built = 1;
+    index->builtGeneration = index->generation;
+    return(0);
+}
+
+/**************************************************************************
+ *
+ * Public functions
+ *
+ *************************************************************************/
+/**
+ * xmlSecDocIndexCreate:
+ * @doc:                the pointer to the document.
+ *
+ * Creates the index for @doc and registers it so all the processing
+ * contexts working with @doc use it. The tables are built on the first
+ * use. The index must be destroyed with #xmlSecDocIndexDestroy before
+ * @doc is freed.
+ *
+ * Returns: the pointer to the newly created index or NULL if an error occurs.
+ */
+xmlSecDocIndexPtr
+xmlSecDocIndexCreate(xmlDocPtr doc) {
+    xmlSecDocIndexPtr index;
+    xmlSecDocIndexPtr cur;
+    xmlSecSize pos;
+
+    xmlSecAssert2(doc != NULL, NULL);
+
+    if(gXmlSecDocIndexMutex == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_OPERATION, NULL,
+            "documents indexes registry is not initialized");
+        return(NULL);
+    }
+
+    index = (xmlSecDocIndexPtr)xmlMalloc(sizeof(xmlSecDocIndex));
+    if(index == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDocIndex), NULL);
+        return(NULL);
+    }
+    memset(index, 0, sizeof(xmlSecDocIndex));
+    index->doc = doc;
+
+    index->mutex = xmlNewMutex();
+    if(index->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(index);
+        return(NULL);
+    }
+
+    pos = xmlSecDocIndexHashPtr(doc) % XMLSEC_DOC_INDEX_REGISTRY_SIZE;
+    xmlMutexLock(gXmlSecDocIndexMutex);
+    for(cur = gXmlSecDocIndexTable[pos]; cur != NULL; cur = cur->next) {
+        if(cur->doc == doc) {
+            xmlMutexUnlock(gXmlSecDocIndexMutex);
+            xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_OPERATION, NULL,
+                "the document already has an index");
+            xmlFreeMutex(index->mutex);
+            xmlFree(index);
+            return(NULL);
+        }
+    }
+    index->next = gXmlSecDocIndexTable[pos];
+    gXmlSecDocIndexTable[pos] = index;
+    ++gXmlSecDocIndexCount;
+    xmlMutexUnlock(gXmlSecDocIndexMutex);
+
+    return(index);
+}
+
+/**
+ * xmlSecDocIndexDestroy:
+ * @index:              the pointer to the index.
+ *
+ * Unregisters and destroys @index.
+ */
+void
+xmlSecDocIndexDestroy(xmlSecDocIndexPtr index) {
+    xmlSecDocIndexPtr* prev;
+    xmlSecSize pos;
+
+    xmlSecAssert(index != NULL);
+
+    if(gXmlSecDocIndexMutex != NULL) {
+        pos = xmlSecDocIndexHashPtr(index->doc) % XMLSEC_DOC_INDEX_REGISTRY_SIZE;
+        xmlMutexLock(gXmlSecDocIndexMutex);
+        for(prev = &(gXmlSecDocIndexTable[pos]); (*prev) != NULL; prev = &((*prev)->next)) {
+            if((*prev) == index) {
+                (*prev) = index->next;
+                --gXmlSecDocIndexCount;
+                break;
+            }
+        }
+        xmlMutexUnlock(gXmlSecDocIndexMutex);
+    }
+
+    xmlSecDocIndexReset(index);
+    if(index->mutex != NULL) {
+        xmlFreeMutex(index->mutex);
+    }
+    memset(index, 0, sizeof(xmlSecDocIndex));
+    xmlFree(index);
+}
+
+/**
+ * xmlSecDocIndexGet:
+ * @doc:                the pointer to the document.
+ *
+ * Finds the index registered for @doc.
+ *
+ * Returns: the pointer to the index or NULL if @doc doesn't have an index.
+ */
+xmlSecDocIndexPtr
+xmlSecDocIndexGet(xmlDocPtr doc) {
+    xmlSecDocIndexPtr cur;
+    xmlSecSize pos;
+
+    /* the common case: no indexes at all */
+    if((doc == NULL) || (gXmlSecDocIndexCount == 0) || (gXmlSecDocIndexMutex == NULL)) {
+        return(NULL);
+    }
+
+    pos = xmlSecDocIndexHashPtr(doc) % XMLSEC_DOC_INDEX_REGISTRY_SIZE;
+    xmlMutexLock(gXmlSecDocIndexMutex);
+    for(cur = gXmlSecDocIndexTable[pos]; cur != NULL; cur = cur->next) {
+        if(cur->doc == doc) {
+            break;
+        }
+    }
+    xmlMutexUnlock(gXmlSecDocIndexMutex);
+    return(cur);
+}
+
+/**
+ * xmlSecDocIndexInvalidate:
+ * @doc:                the pointer to the document.
+ *
+ * Marks the index registered for @doc (if any) as outdated: it is rebuilt
+ * on the next use. The application must call this function after modifying
+ * the @doc elements or attributes (the text content changes don't matter).
+ */
+void
+xmlSecDocIndexInvalidate(xmlDocPtr doc) {
+    xmlSecDocIndexPtr index;
+
+    index = xmlSecDocIndexGet(doc);
+    if(index == NULL) {
+        return;
+    }
+    xmlMutexLock(index->mutex);
+    ++index->generation;
+    xmlMutexUnlock(index->mutex);
+}
+
+/**
+ * xmlSecDocIndexUpdate:
+ * @index:              the pointer to the index.
+ *
+ * Builds the @index tables if they were not built yet or if the index
+ * was invalidated.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDocIndexUpdate(xmlSecDocIndexPtr index) {
+    int ret = 0;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(index->mutex != NULL, -1);
+
+    xmlMutexLock(index->mutex);
+    if((index->built == 0) || (index->builtGeneration != index->generation)) {
+        ret = xmlSecDocIndexBuild(index);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDocIndexBuild", NULL);
+        }
+    }
+    xmlMutexUnlock(index->mutex);
+    return(ret);
+}
+
+/**
+ * xmlSecDocIndexGetSize:
+ * @index:              the pointer to the index.
+ *
+ * Gets the number of elements in the document (the index must be up to
+ * date, see #xmlSecDocIndexUpdate).
+ *
+ * Returns: the number of indexed elements.
+ */
+xmlSecSize
+xmlSecDocIndexGetSize(xmlSecDocIndexPtr index) {
+    xmlSecAssert2(index != NULL, 0);
+
+    return(index->elementsSize);
+}
+
+/**
+ * xmlSecDocIndexGetOrdinal:
+ * @index:              the pointer to the index.
+ * @node:               the pointer to the element.
+ * @ordinal:            the pointer to return the @node position in the document order.
+ * @last:               the pointer to return the position of the last @node descendant
+ *                      in the document order (may be NULL).
+ *
+ * Gets the @node position among the document elements and the positions
+ * range of its subtree (the index must be up to date, see #xmlSecDocIndexUpdate).
+ *
+ * Returns: 1 if the element is found, 0 if it is not or a negative value if an error occurs.
+ */
+int
+xmlSecDocIndexGetOrdinal(xmlSecDocIndexPtr index, xmlNodePtr node, xmlSecSize* ordinal, xmlSecSize* last) {
+    xmlSecSize pos = 0;
+    int ret;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(ordinal != NULL, -1);
+
+    ret = xmlSecDocIndexFindOrdinal(index, node, &pos);
+    if(ret <= 0) {
+        return(ret);
+    }
+    (*ordinal) = pos;
+    if(last != NULL) {
+        (*last) = index->elements[pos].last;
+    }
+    return(1);
+}
+
+/**
+ * xmlSecDocIndexGetElement:
+ * @index:              the pointer to the index.
+ * @ordinal:            the element position in the document order.
+ *
+ * Gets the element at the @ordinal position in the document order (the
+ * index must be up to date, see #xmlSecDocIndexUpdate).
+ *
+ * Returns: the element or NULL if @ordinal is out of range.
+ */
+xmlNodePtr
+xmlSecDocIndexGetElement(xmlSecDocIndexPtr index, xmlSecSize ordinal) {
+    xmlSecAssert2(index != NULL, NULL);
+
+    if(ordinal >= index->elementsSize) {
+        return(NULL);
+    }
+    return(index->elements[ordinal].node);
+}
+
+/**************************************************************************
+ *
+ * Internal functions
+ *
+ *************************************************************************/
+/* returns the up to date index for @doc or NULL if there is no index (or it can't be built) */
+xmlSecDocIndexPtr
+xmlSecDocIndexAcquire(xmlDocPtr doc) {
+    xmlSecDocIndexPtr index;
+    int ret;
+
+    index = xmlSecDocIndexGet(doc);
+    if(index == NULL) {
+        return(NULL);
+    }
+    ret = xmlSecDocIndexUpdate(index);
+    if(ret < 0) {
+        /* the callers fall back to the document walk */
+        return(NULL);
+    }
+    return(index);
+}
+
+/* returns 1 if @node is found, 0 if it is not */
+int
+xmlSecDocIndexFindOrdinal(xmlSecDocIndexPtr index, xmlNodePtr node, xmlSecSize* ordinal) {
+    xmlSecSize pos;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(ordinal != NULL, -1);
+
+    if((index->nodesTableSize == 0) || (node->type != XML_ELEMENT_NODE)) {
+        return(0);
+    }
+    pos = xmlSecDocIndexHashPtr(node) & (index->nodesTableSize - 1);
+    while(index->nodesTable[pos] != 0) {
+        if(index->elements[index->nodesTable[pos] - 1].node == node) {
+            (*ordinal) = index->nodesTable[pos] - 1;
+            return(1);
+        }
+        pos = (pos + 1) & (index->nodesTableSize - 1);
+    }
+    return(0);
+}
+
+/* gets the [first, last] ordinals range of the @root subtree (the whole document if @root is NULL),
+ * returns 1 if the range is not empty, 0 if it is empty (or @root is not indexed) */
+int
+xmlSecDocIndexGetRange(xmlSecDocIndexPtr index, xmlNodePtr root, xmlSecSize* first, xmlSecSize* last) {
+    xmlSecSize pos = 0;
+    int ret;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(first != NULL, -1);
+    xmlSecAssert2(last != NULL, -1);
+
+    if((root == NULL) || (root == (xmlNodePtr)index->doc)) {
+        if(index->elementsSize == 0) {
+            return(0);
+        }
+        (*first) = 0;
+        (*last) = index->elementsSize - 1;
+        return(1);
+    }
+
+    ret = xmlSecDocIndexFindOrdinal(index, root, &pos);
+    if(ret <= 0) {
+        return(ret);
+    }
+    (*first) = pos;
+    (*last) = index->elements[pos].last;
+    return(1);
+}
+
+/* returns the elements with the local @name or NULL if there are none */
+xmlSecDocIndexNamePtr
+xmlSecDocIndexGetElementsByName(xmlSecDocIndexPtr index, const xmlChar* name) {
+    xmlSecAssert2(index != NULL, NULL);
+    xmlSecAssert2(name != NULL, NULL);
+
+    return(xmlSecDocIndexNamesFind(&(index->elementNames), name));
+}
+
+/* returns the elements with the attribute with the local @name or NULL if there are none */
+xmlSecDocIndexNamePtr
+xmlSecDocIndexGetAttrOwners(xmlSecDocIndexPtr index, const xmlChar* name) {
+    xmlSecAssert2(index != NULL, NULL);
+    xmlSecAssert2(name != NULL, NULL);
+
+    return(xmlSecDocIndexNamesFind(&(index->attrNames), name));
+}
+
+/* returns the position of the first ordinal in @name that is not less than @ordinal */
+xmlSecSize
+xmlSecDocIndexLowerBound(xmlSecDocIndexNamePtr name, xmlSecSize ordinal) {
+    xmlSecSize lo, hi, mid;
+
+    xmlSecAssert2(name != NULL, 0);
+
+    lo = 0;
+    hi = name->size;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(name->ordinals[mid] < ordinal) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return(lo);
+}
+
+/* returns the next ancestor of @cur that might have the namespace declarations: the parent
+ * or (with the index) the nearest ancestor element with nsDef or the document node */
+xmlNodePtr
+xmlSecDocIndexGetNextNsHolder(xmlSecDocIndexPtr index, xmlNodePtr cur) {
+    xmlSecSize ordinal = 0;
+    xmlSecSize parent, scope;
+
+    xmlSecAssert2(cur != NULL, NULL);
+
+    if((index == NULL) || (cur->type != XML_ELEMENT_NODE) || (cur->doc != index->doc)) {
+        return(cur->parent);
+    }
+    if(xmlSecDocIndexFindOrdinal(index, cur, &ordinal) != 1) {
+        return(cur->parent);
+    }
+    parent = index->elements[ordinal].parent;
+    scope = (parent > 0) ? index->elements[parent - 1].nsScope : 0;
+    if(scope > 0) {
+        return(index->elements[scope - 1].node);
+    }
+    return((xmlNodePtr)index->doc);
+}
@@ -0,0 +1,98 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * THIS IS A PRIVATE XMLSEC HEADER FILE
+ * DON'T USE IT IN YOUR APPLICATION
+ *
+ * The shared per-document index internals.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_DOCINDEX_HELPERS_H__
+#define __XMLSEC_DOCINDEX_HELPERS_H__
+
+#ifndef XMLSEC_PRIVATE
+#error "docindex_helpers.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <libxml/tree.h>
+#include <libxml/threads.h>
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/docindex.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* the element in the document order, the ordinals are the positions in the elements array */
+typedef struct _xmlSecDocIndexElement           xmlSecDocIndexElement, *xmlSecDocIndexElementPtr;
+struct _xmlSecDocIndexElement {
+    xmlNodePtr                  node;
+    xmlSecSize                  last;       /* the ordinal of the last descendant (or the element itself) */
+    xmlSecSize                  parent;     /* the parent element ordinal + 1 or 0 for the top level elements */
+    xmlSecSize                  nsScope;    /* the nearest ancestor-or-self element with nsDef ordinal + 1 or 0 */
+};
+
+/* the sorted ordinals of the elements with the given name (or with the attribute with the given name) */
+typedef struct _xmlSecDocIndexName              xmlSecDocIndexName, *xmlSecDocIndexNamePtr;
+struct _xmlSecDocIndexName {
+    const xmlChar*              name;
+    xmlSecSize*                 ordinals;
+    xmlSecSize                  size;
+    xmlSecSize                  maxSize;
+};
+
+typedef struct _xmlSecDocIndexNames             xmlSecDocIndexNames, *xmlSecDocIndexNamesPtr;
+struct _xmlSecDocIndexNames {
+    xmlSecDocIndexNamePtr       table;      /* open addressing hash table */
+    xmlSecSize                  tableSize;
+    xmlSecSize                  size;
+};
+
+struct _xmlSecDocIndex {
+    xmlSecDocIndexPtr           next;       /* the registry bucket list */
+    xmlDocPtr                   doc;
+    xmlMutexPtr                 mutex;
+    xmlSecSize                  generation;
+    xmlSecSize                  builtGeneration;
+    int                         built;
+
+    xmlSecDocIndexElementPtr    elements;
+    xmlSecSize                  elementsSize;
+    xmlSecSize                  elementsMaxSize;
+    xmlSecSize*                 nodesTable; /* open addressing hash table: the element ordinal + 1 or 0 */
+    xmlSecSize                  nodesTableSize;
+    xmlSecDocIndexNames         elementNames;
+    xmlSecDocIndexNames         attrNames;
+};
+
+void                    xmlSecDocIndexInitialize                (void);
+void                    xmlSecDocIndexShutdown                  (void);
+
+XMLSEC_EXPORT xmlSecDocIndexPtr xmlSecDocIndexAcquire           (xmlDocPtr doc);
+XMLSEC_EXPORT int               xmlSecDocIndexFindOrdinal       (xmlSecDocIndexPtr index,
+                                                                 xmlNodePtr node,
+                                                                 xmlSecSize* ordinal);
+XMLSEC_EXPORT int               xmlSecDocIndexGetRange          (xmlSecDocIndexPtr index,
+                                                                 xmlNodePtr root,
+                                                                 xmlSecSize* first,
+                                                                 xmlSecSize* last);
+XMLSEC_EXPORT xmlSecDocIndexNamePtr xmlSecDocIndexGetElementsByName(xmlSecDocIndexPtr index,
+                                                                 const xmlChar* name);
+XMLSEC_EXPORT xmlSecDocIndexNamePtr xmlSecDocIndexGetAttrOwners (xmlSecDocIndexPtr index,
+                                                                 const xmlChar* name);
+XMLSEC_EXPORT xmlSecSize        xmlSecDocIndexLowerBound        (xmlSecDocIndexNamePtr name,
+                                                                 xmlSecSize ordinal);
+XMLSEC_EXPORT xmlNodePtr        xmlSecDocIndexGetNextNsHolder   (xmlSecDocIndexPtr index,
+                                                                 xmlNodePtr cur);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_DOCINDEX_HELPERS_H__ */
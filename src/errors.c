@@ -21,6 +21,7 @@
 #include <stdarg.h>
 #include <time.h>
 #include <string.h>
+#include <limits.h>
 
 #include <libxml/tree.h>
 
@@ -94,6 +95,9 @@ static xmlSecErrorDescription xmlSecErrorsTable[XMLSEC_ERRORS_MAX_NUMBER + 1] =
   { XMLSEC_ERRORS_R_CRL_HAS_EXPIRED,            "CRL has expired" },
   { XMLSEC_ERRORS_R_DSIG_NO_REFERENCES,         "Reference nodes are not found" },
   { XMLSEC_ERRORS_R_DSIG_INVALID_REFERENCE,     "Reference verification failed" },
+  { XMLSEC_ERRORS_R_DEADLINE_EXCEEDED,          "operation deadline exceeded" },
+  { XMLSEC_ERRORS_R_OPERATION_CANCELLED,        "operation cancelled" },
+  { XMLSEC_ERRORS_R_COST_LIMIT_EXCEEDED,        "cost limit exceeded" },
   { XMLSEC_ERRORS_R_ASSERTION,                  "assertion" },
   { 0,                                          NULL}
 };
@@ -101,6 +105,30 @@ static xmlSecErrorDescription xmlSecErrorsTable[XMLSEC_ERRORS_MAX_NUMBER + 1] =
 static xmlSecErrorsCallback xmlSecErrorsClbk = xmlSecErrorsDefaultCallback;
 static int  xmlSecPrintErrorMessages = 1;       /* whether the error messages will be printed immediately */
 
+/* the deferred errors ring buffer for the current thread */
+typedef struct _xmlSecErrorsDeferred {
+    int                 enabled;
+    xmlSecSize          start;
+    xmlSecSize          size;
+    xmlSecErrorRecord   records[XMLSEC_ERRORS_DEFERRED_MAX_SIZE];
+} xmlSecErrorsDeferred;
+
+#ifdef XMLSEC_THREAD_LOCAL
+static XMLSEC_THREAD_LOCAL xmlSecErrorsDeferred gErrorsDeferred;
+#endif /* XMLSEC_THREAD_LOCAL */
+
+static const char*
+xmlSecErrorsGetReasonMsg(int reason) {
+    xmlSecSize i;
+
+    for(i = 0; (i < XMLSEC_ERRORS_MAX_NUMBER) && (xmlSecErrorsGetMsg(i) != NULL); ++i) {
+        if(xmlSecErrorsGetCode(i) == reason) {
+            return(xmlSecErrorsGetMsg(i));
+        }
+    }
+    return(NULL);
+}
+
 /**
  * xmlSecErrorsInit:
  *
@@ -151,15 +179,8 @@ xmlSecErrorsDefaultCallback(const char* file, int line, const char* func,
                             const char* errorObject, const char* errorSubject,
                             int reason, const char* msg) {
     if(xmlSecPrintErrorMessages) {
-        const char* error_msg = NULL;
-        xmlSecSize i;
+        const char* error_msg = xmlSecErrorsGetReasonMsg(reason);
 
-        for(i = 0; (i < XMLSEC_ERRORS_MAX_NUMBER) && (xmlSecErrorsGetMsg(i) != NULL); ++i) {
-            if(xmlSecErrorsGetCode(i) == reason) {
-                error_msg = xmlSecErrorsGetMsg(i);
-                break;
-            }
-        }
         xmlGenericError(xmlGenericErrorContext,
             "func=%s:file=%s:line=%d:obj=%s:subj=%s:error=%d:%s:%s\n",
             (func != NULL) ? func : "unknown",
@@ -221,6 +242,169 @@ xmlSecErrorsGetMsg(xmlSecSize pos) {
     return(NULL);
 }
 
+/**
+ * xmlSecErrorsDeferredEnable:
+ * @enabled:            the flag.
+ *
+ * Enables or disables the deferred errors mode for the current thread.
+ * In this mode #xmlSecError does not format the error message and does
+ * not call the errors callback: only the error code and location are
+ * stored in the per-thread ring buffer (the last
+ * #XMLSEC_ERRORS_DEFERRED_MAX_SIZE errors are kept). The errors can be
+ * formatted later with #xmlSecErrorsDeferredFormat or passed to the
+ * errors callback with #xmlSecErrorsDeferredReport. The error object,
+ * subject and message parameters are not preserved. Disabling the mode
+ * does not clear the stored errors.
+ *
+ * Returns: 0 on success or a negative value if the compiler does not
+ * support thread local variables.
+ */
+int
+xmlSecErrorsDeferredEnable(int enabled) {
+#ifdef XMLSEC_THREAD_LOCAL
+    gErrorsDeferred.enabled = enabled;
+    return(0);
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(enabled);
+    return(-1);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecErrorsDeferredIsEnabled:
+ *
+ * Checks if the deferred errors mode is enabled for the current thread.
+ *
+ * Returns: 1 if the deferred errors mode is enabled or 0 otherwise.
+ */
+int
+xmlSecErrorsDeferredIsEnabled(void) {
+#ifdef XMLSEC_THREAD_LOCAL
+    return((gErrorsDeferred.enabled != 0) ? 1 : 0);
+#else  /* XMLSEC_THREAD_LOCAL */
+    return(0);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecErrorsDeferredClear:
+ *
+ * Removes all the deferred errors stored for the current thread.
+ */
+void
+xmlSecErrorsDeferredClear(void) {
+#ifdef XMLSEC_THREAD_LOCAL
+    gErrorsDeferred.start = 0;
+    gErrorsDeferred.size = 0;
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecErrorsDeferredGetSize:
+ *
+ * Gets the number of the deferred errors stored for the current thread.
+ *
+ * Returns: the number of the deferred errors.
+ */
+xmlSecSize
+xmlSecErrorsDeferredGetSize(void) {
+#ifdef XMLSEC_THREAD_LOCAL
+    return(gErrorsDeferred.size);
+#else  /* XMLSEC_THREAD_LOCAL */
+    return(0);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecErrorsDeferredGet:
+ * @pos:                the error position (0 for the oldest error).
+ * @record:             the pointer to the result record.
+ *
+ * Gets the deferred error at position @pos for the current thread.
+ *
+ * Returns: 0 on success or a negative value if @pos is out of range.
+ */
+int
+xmlSecErrorsDeferredGet(xmlSecSize pos, xmlSecErrorRecordPtr record) {
+    /* could not use asserts here! */
+    if(record == NULL) {
+        return(-1);
+    }
+#ifdef XMLSEC_THREAD_LOCAL
+    if(pos >= gErrorsDeferred.size) {
+        return(-1);
+    }
+    (*record) = gErrorsDeferred.records[(gErrorsDeferred.start + pos) % XMLSEC_ERRORS_DEFERRED_MAX_SIZE];
+    return(0);
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(pos);
+    return(-1);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecErrorsDeferredFormat:
+ * @pos:                the error position (0 for the oldest error).
+ * @buf:                the output buffer.
+ * @bufSize:            the output buffer size.
+ *
+ * Formats the deferred error at position @pos for the current thread
+ * in the same format as #xmlSecErrorsDefaultCallback (the message is
+ * truncated to fit into @buf).
+ *
+ * Returns: 0 on success or a negative value if @pos is out of range.
+ */
+int
+xmlSecErrorsDeferredFormat(xmlSecSize pos, char* buf, xmlSecSize bufSize) {
+    xmlSecErrorRecord record;
+    const char* error_msg;
+    int ret;
+
+    /* could not use asserts here! */
+    if((buf == NULL) || (bufSize == 0) || (bufSize > INT_MAX)) {
+        return(-1);
+    }
+    ret = xmlSecErrorsDeferredGet(pos, &record);
+    if(ret < 0) {
+        return(-1);
+    }
+
+    error_msg = xmlSecErrorsGetReasonMsg(record.reason);
+    ret = xmlStrPrintf(BAD_CAST buf, (int)bufSize,
+        "func=%s:file=%s:line=%d:error=%d:%s",
+        (record.func != NULL) ? record.func : "unknown",
+        (record.file != NULL) ? record.file : "unknown",
+        record.line,
+        record.reason,
+        (error_msg != NULL) ? error_msg : "");
+    if(ret < 0) {
+        return(-1);
+    }
+    buf[bufSize - 1] = '\0'; /* just in case */
+    return(0);
+}
+
+/**
+ * xmlSecErrorsDeferredReport:
+ *
+ * Passes all the deferred errors stored for the current thread to the
+ * errors callback (oldest first) and removes them.
+ */
+void
+xmlSecErrorsDeferredReport(void) {
+#ifdef XMLSEC_THREAD_LOCAL
+    xmlSecErrorRecord record;
+    xmlSecSize ii;
+
+    if(xmlSecErrorsClbk != NULL) {
+        for(ii = 0; xmlSecErrorsDeferredGet(ii, &record) == 0; ++ii) {
+            xmlSecErrorsClbk(record.file, record.line, record.func, NULL, NULL, record.reason, "");
+        }
+    }
+    xmlSecErrorsDeferredClear();
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
 /**
  * xmlSecError:
  * @file:               the error location filename (__FILE__).
@@ -234,12 +418,34 @@ xmlSecErrorsGetMsg(xmlSecSize pos) {
  *
  * Reports an error to the default (#xmlSecErrorsDefaultCallback) or
  * application specific callback installed using #xmlSecErrorsSetCallback
- * function.
+ * function. If the deferred errors mode is enabled for the current thread
+ * (see #xmlSecErrorsDeferredEnable) then only the error code and location
+ * are stored.
  */
 void
 xmlSecError(const char* file, int line, const char* func,
             const char* errorObject, const char* errorSubject,
             int reason, const char* msg, ...) {
+#ifdef XMLSEC_THREAD_LOCAL
+    if(gErrorsDeferred.enabled != 0) {
+        xmlSecErrorRecordPtr record;
+
+        if(gErrorsDeferred.size < XMLSEC_ERRORS_DEFERRED_MAX_SIZE) {
+            record = &(gErrorsDeferred.records[(gErrorsDeferred.start + gErrorsDeferred.size) % XMLSEC_ERRORS_DEFERRED_MAX_SIZE]);
+            ++gErrorsDeferred.size;
+        } else {
+            /* overwrite the oldest one */
+            record = &(gErrorsDeferred.records[gErrorsDeferred.start]);
+            gErrorsDeferred.start = (gErrorsDeferred.start + 1) % XMLSEC_ERRORS_DEFERRED_MAX_SIZE;
+        }
+        record->file   = file;
+        record->line   = line;
+        record->func   = func;
+        record->reason = reason;
+        return;
+    }
+#endif /* XMLSEC_THREAD_LOCAL */
+
     if(xmlSecErrorsClbk != NULL) {
         xmlChar error_msg[XMLSEC_ERRORS_BUFFER_SIZE];
         int ret;
@@ -0,0 +1,923 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The tasks executor shared by the parallel processing functions.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/**
+ * SECTION:executor
+ * @Short_description: The tasks executor.
+ * @Stability: Stable
+ *
+ * The executor runs the tasks for the parallel processing functions
+ * (the &lt;dsig:Reference/&gt; elements digesting, the batch verification,
+ * the multiple &lt;enc:EncryptedData/&gt; elements decryption, etc.).
+ *
+ * The default executor (#xmlSecExecutorCreate) is a threads pool where each
+ * thread has its own tasks deque: the tasks submitted from a pool thread
+ * are added to its deque and taken back in the LIFO order, the idle threads
+ * steal the oldest tasks from the other threads deques. The thread waiting
+ * for a #xmlSecTaskGroup runs the queued tasks instead of blocking, so the
+ * tasks can submit and wait for the nested groups.
+ *
+ * The applications that already have a threads pool (or an event loop)
+ * can wrap it with #xmlSecExecutorCreateCustom.
+ */
+#include "globals.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(XMLSEC_NO_THREADS)
+#if defined(XMLSEC_WINDOWS)
+#include <windows.h>
+#include <process.h>
+#else  /* defined(XMLSEC_WINDOWS) */
+#include <pthread.h>
+#include <unistd.h>
+#endif /* defined(XMLSEC_WINDOWS) */
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/executor.h>
+#include <xmlsec/errors.h>
+
+#include "cast_helpers.h"
+
+/**************************************************************************
+ *
+ * Threads primitives
+ *
+ *************************************************************************/
+#if !defined(XMLSEC_NO_THREADS)
+#if defined(XMLSEC_WINDOWS)
+
+typedef CRITICAL_SECTION                        xmlSecExecutorMutex;
+typedef CONDITION_VARIABLE                      xmlSecExecutorCond;
+typedef HANDLE                                  xmlSecExecutorThread;
+
+#define xmlSecExecutorMutexInit(mutex)          (InitializeCriticalSection(mutex), 0)
+#define xmlSecExecutorMutexFree(mutex)          DeleteCriticalSection(mutex)
+#define xmlSecExecutorMutexLock(mutex)          EnterCriticalSection(mutex)
+#define xmlSecExecutorMutexUnlock(mutex)        LeaveCriticalSection(mutex)
+#define xmlSecExecutorCondInit(cond)            (InitializeConditionVariable(cond), 0)
+#define xmlSecExecutorCondFree(cond)
+#define xmlSecExecutorCondWait(cond, mutex)     SleepConditionVariableCS((cond), (mutex), INFINITE)
+#define xmlSecExecutorCondBroadcast(cond)       WakeAllConditionVariable(cond)
+
+#else  /* defined(XMLSEC_WINDOWS) */
+
+typedef pthread_mutex_t                         xmlSecExecutorMutex;
+typedef pthread_cond_t                          xmlSecExecutorCond;
+typedef pthread_t                               xmlSecExecutorThread;
+
+#define xmlSecExecutorMutexInit(mutex)          pthread_mutex_init((mutex), NULL)
+#define xmlSecExecutorMutexFree(mutex)          pthread_mutex_destroy(mutex)
+#define xmlSecExecutorMutexLock(mutex)          pthread_mutex_lock(mutex)
+#define xmlSecExecutorMutexUnlock(mutex)        pthread_mutex_unlock(mutex)
+#define xmlSecExecutorCondInit(cond)            pthread_cond_init((cond), NULL)
+#define xmlSecExecutorCondFree(cond)            pthread_cond_destroy(cond)
+#define xmlSecExecutorCondWait(cond, mutex)     pthread_cond_wait((cond), (mutex))
+#define xmlSecExecutorCondBroadcast(cond)       pthread_cond_broadcast(cond)
+
+#endif /* defined(XMLSEC_WINDOWS) */
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+/**************************************************************************
+ *
+ * Internal structures
+ *
+ *************************************************************************/
+typedef struct _xmlSecExecutorItem              xmlSecExecutorItem, *xmlSecExecutorItemPtr;
+struct _xmlSecExecutorItem {
+    xmlSecExecutorTask          task;
+    void*                       taskCtx;
+    xmlSecTaskGroupPtr          group;
+};
+
+#if !defined(XMLSEC_NO_THREADS)
+/* the pool thread with its tasks deque (the ring buffer) */
+typedef struct _xmlSecExecutorWorker            xmlSecExecutorWorker, *xmlSecExecutorWorkerPtr;
+struct _xmlSecExecutorWorker {
+    xmlSecExecutorPtr           executor;
+    xmlSecSize                  index;
+    xmlSecExecutorThread        thread;
+    int                         started;
+    xmlSecExecutorMutex         mutex;      /* protects the deque */
+    xmlSecExecutorItemPtr       items;
+    xmlSecSize                  head;       /* the oldest item (stolen by the other workers) */
+    xmlSecSize                  size;
+    xmlSecSize                  maxSize;
+};
+
+#ifdef XMLSEC_THREAD_LOCAL
+static XMLSEC_THREAD_LOCAL xmlSecExecutorWorkerPtr gXmlSecExecutorCurrentWorker = NULL;
+#endif /* XMLSEC_THREAD_LOCAL */
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+struct _xmlSecExecutor {
+    /* the application pool */
+    xmlSecExecutorSubmitMethod  submit;
+    void*                       submitCtx;
+
+#if !defined(XMLSEC_NO_THREADS)
+    /* the default pool */
+    xmlSecExecutorWorkerPtr     workers;
+    xmlSecSize                  workersNum;
+    xmlSecSize                  nextWorker; /* the round robin for the tasks submitted outside of the pool */
+
+    xmlSecExecutorMutex         mutex;      /* protects the counters below and the groups */
+    xmlSecExecutorCond          cond;       /* a task is queued, a group is completed or stop */
+    xmlSecSize                  queued;
+    int                         stop;
+#endif /* !defined(XMLSEC_NO_THREADS) */
+};
+
+struct _xmlSecTaskGroup {
+    xmlSecExecutorPtr           executor;
+    xmlSecSize                  outstanding;
+};
+
+/* the application pool task wrapper */
+typedef struct _xmlSecExecutorCustomItem        xmlSecExecutorCustomItem, *xmlSecExecutorCustomItemPtr;
+struct _xmlSecExecutorCustomItem {
+    xmlSecExecutorItem          item;
+};
+
+static void             xmlSecExecutorItemRun                   (xmlSecExecutorPtr executor,
+                                                                 xmlSecExecutorItemPtr item);
+
+#if !defined(XMLSEC_NO_THREADS)
+/**************************************************************************
+ *
+ * The default pool: the deques
+ *
+ *************************************************************************/
+static int
+xmlSecExecutorWorkerPush(xmlSecExecutorWorkerPtr worker, xmlSecExecutorItemPtr item) {
+    xmlSecAssert2(worker != NULL, -1);
+    xmlSecAssert2(item != NULL, -1);
+
+    xmlSecExecutorMutexLock(&(worker->mutex));
+    if(worker->size >= worker->maxSize) {
+        xmlSecSize newSize = (worker->maxSize > 0) ? (2 * worker->maxSize) : 32;
+        xmlSecExecutorItemPtr newItems;
+        xmlSecSize ii;
+
+        newItems = (xmlSecExecutorItemPtr)xmlMalloc(newSize * sizeof(xmlSecExecutorItem));
+        if(newItems == NULL) {
+            xmlSecExecutorMutexUnlock(&(worker->mutex));
+            xmlSecMallocError(newSize * sizeof(xmlSecExecutorItem), NULL);
+            return(-1);
+        }
+        for(ii = 0; ii < worker->size; ++ii) {
+            newItems[ii] = worker->items[(worker->head + ii) % worker->maxSize];
+        }
+        if(worker->items != NULL) {
+            xmlFree(worker->items);
+        }
+        worker->items = newItems;
+        worker->head = 0;
+        worker->maxSize = newSize;
+    }
+    worker->items[(worker->head + worker->size) % worker->maxSize] = (*item);
+    ++worker->size;
+    xmlSecExecutorMutexUnlock(&(worker->mutex));
+    return(0);
+}
+
+/* takes the newest item (the owner side) */
+static int
+xmlSecExecutorWorkerPop(xmlSecExecutorWorkerPtr worker, xmlSecExecutorItemPtr item) {
+    int res = 0;
+
+    xmlSecAssert2(worker != NULL, 0);
+    xmlSecAssert2(item != NULL, 0);
+
+    xmlSecExecutorMutexLock(&(worker->mutex));
+    if(worker->size > 0) {
+        --worker->size;
+        (*item) = worker->items[(worker->head + worker->size) % worker->maxSize];
+        res = 1;
+    }
+    xmlSecExecutorMutexUnlock(&(worker->mutex));
+    return(res);
+}
+
+/* takes the oldest item (the thief side) */
+static int
+xmlSecExecutorWorkerSteal(xmlSecExecutorWorkerPtr worker, xmlSecExecutorItemPtr item) {
+    int res = 0;
+
+    xmlSecAssert2(worker != NULL, 0);
+    xmlSecAssert2(item != NULL, 0);
+
+    xmlSecExecutorMutexLock(&(worker->mutex));
+    if(worker->size > 0) {
+        (*item) = worker->items[worker->head];
+        worker->head = (worker->head + 1) % worker->maxSize;
+        --worker->size;
+        res = 1;
+    }
+    xmlSecExecutorMutexUnlock(&(worker->mutex));
+    return(res);
+}
+
+static xmlSecExecutorWorkerPtr
+xmlSecExecutorGetCurrentWorker(xmlSecExecutorPtr executor) {
+    xmlSecAssert2(executor != NULL, NULL);
+
+#ifdef XMLSEC_THREAD_LOCAL
+    if((gXmlSecExecutorCurrentWorker != NULL) && (gXmlSecExecutorCurrentWorker->executor == executor)) {
+        return(gXmlSecExecutorCurrentWorker);
+    }
+#endif /* XMLSEC_THREAD_LOCAL */
+    return(NULL);
+}
+
+/* takes an item from the @self deque or steals it from the others, returns 1 if the item is found */
+static int
+xmlSecExecutorTake(xmlSecExecutorPtr executor, xmlSecExecutorWorkerPtr self, xmlSecExecutorItemPtr item) {
+    xmlSecSize start, ii;
+    int found = 0;
+
+    xmlSecAssert2(executor != NULL, 0);
+    xmlSecAssert2(executor->workersNum > 0, 0);
+    xmlSecAssert2(item != NULL, 0);
+
+    if(self != NULL) {
+        found = xmlSecExecutorWorkerPop(self, item);
+        start = self->index + 1;
+    } else {
+        start = 0;
+    }
+    for(ii = 0; (found == 0) && (ii < executor->workersNum); ++ii) {
+        xmlSecExecutorWorkerPtr victim = &(executor->workers[(start + ii) % executor->workersNum]);
+        if(victim != self) {
+            found = xmlSecExecutorWorkerSteal(victim, item);
+        }
+    }
+    if(found == 0) {
+        return(0);
+    }
+
+    xmlSecExecutorMutexLock(&(executor->mutex));
+    xmlSecAssert2(executor->queued > 0, 0);
+    --executor->queued;
+    xmlSecExecutorMutexUnlock(&(executor->mutex));
+    return(1);
+}
+
+static void
+xmlSecExecutorWorkerLoop(xmlSecExecutorWorkerPtr worker) {
+    xmlSecExecutorPtr executor;
+    xmlSecExecutorItem item;
+
+    xmlSecAssert(worker != NULL);
+    xmlSecAssert(worker->executor != NULL);
+
+    executor = worker->executor;
+#ifdef XMLSEC_THREAD_LOCAL
+    gXmlSecExecutorCurrentWorker = worker;
+#endif /* XMLSEC_THREAD_LOCAL */
+
+    while(1) {
+        if(xmlSecExecutorTake(executor, worker, &item) != 0) {
+            xmlSecExecutorItemRun(executor, &item);
+            continue;
+        }
+
+        xmlSecExecutorMutexLock(&(executor->mutex));
+        while((executor->queued == 0) && (executor->stop == 0)) {
+            xmlSecExecutorCondWait(&(executor->cond), &(executor->mutex));
+        }
+        if((executor->queued == 0) && (executor->stop != 0)) {
+            xmlSecExecutorMutexUnlock(&(executor->mutex));
+            break;
+        }
+        xmlSecExecutorMutexUnlock(&(executor->mutex));
+    }
+
+#ifdef XMLSEC_THREAD_LOCAL
+    gXmlSecExecutorCurrentWorker = NULL;
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+#if defined(XMLSEC_WINDOWS)
+static unsigned __stdcall
+xmlSecExecutorWorkerThread(void* arg) {
+    xmlSecExecutorWorkerLoop((xmlSecExecutorWorkerPtr)arg);
+    return(0);
+}
+#else  /* defined(XMLSEC_WINDOWS) */
+static void*
+xmlSecExecutorWorkerThread(void* arg) {
+    xmlSecExecutorWorkerLoop((xmlSecExecutorWorkerPtr)arg);
+    return(NULL);
+}
+#endif /* defined(XMLSEC_WINDOWS) */
+
+static xmlSecSize
+xmlSecExecutorGetCpusNum(void) {
+#if defined(XMLSEC_WINDOWS)
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return((info.dwNumberOfProcessors > 0) ? (xmlSecSize)info.dwNumberOfProcessors : 1);
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return((num > 0) ? (xmlSecSize)num : 1);
+#else  /* defined(XMLSEC_WINDOWS) */
+    return(1);
+#endif /* defined(XMLSEC_WINDOWS) */
+}
+
+static int
+xmlSecExecutorStartWorkers(xmlSecExecutorPtr executor, xmlSecSize threadsNum) {
+    xmlSecExecutorWorkerPtr worker;
+    xmlSecSize ii;
+
+    xmlSecAssert2(executor != NULL, -1);
+    xmlSecAssert2(executor->workers == NULL, -1);
+    xmlSecAssert2(threadsNum > 0, -1);
+
+    executor->workers = (xmlSecExecutorWorkerPtr)xmlMalloc(threadsNum * sizeof(xmlSecExecutorWorker));
+    if(executor->workers == NULL) {
+        xmlSecMallocError(threadsNum * sizeof(xmlSecExecutorWorker), NULL);
+        return(-1);
+    }
+    memset(executor->workers, 0, threadsNum * sizeof(xmlSecExecutorWorker));
+
+    /* the deques must be ready before any thread starts stealing */
+    for(ii = 0; ii < threadsNum; ++ii) {
+        worker = &(executor->workers[ii]);
+        worker->executor = executor;
+        worker->index = ii;
+        if(xmlSecExecutorMutexInit(&(worker->mutex)) != 0) {
+            xmlSecInternalError("xmlSecExecutorMutexInit", NULL);
+            while(ii > 0) {
+                --ii;
+                xmlSecExecutorMutexFree(&(executor->workers[ii].mutex));
+            }
+            xmlFree(executor->workers);
+            executor->workers = NULL;
+            return(-1);
+        }
+    }
+    executor->workersNum = threadsNum;
+
+    for(ii = 0; ii < threadsNum; ++ii) {
+        worker = &(executor->workers[ii]);
+#if defined(XMLSEC_WINDOWS)
+        worker->thread = (HANDLE)_beginthreadex(NULL, 0, xmlSecExecutorWorkerThread, worker, 0, NULL);
+        if(worker->thread == 0) {
+            xmlSecIOError("_beginthreadex", NULL, NULL);
+            break;
+        }
+        worker->started = 1;
+#else  /* defined(XMLSEC_WINDOWS) */
+        if(pthread_create(&(worker->thread), NULL, xmlSecExecutorWorkerThread, worker) != 0) {
+            xmlSecIOError("pthread_create", NULL, NULL);
+            break;
+        }
+        worker->started = 1;
+#endif /* defined(XMLSEC_WINDOWS) */
+    }
+    if(ii == 0) {
+        for(ii = 0; ii < threadsNum; ++ii) {
+            xmlSecExecutorMutexFree(&(executor->workers[ii].mutex));
+        }
+        xmlFree(executor->workers);
+        executor->workers = NULL;
+        executor->workersNum = 0;
+        return(-1);
+    }
+
+    /* the deques of the threads that failed to start are still stolen from */
+    return(0);
+}
+
+static void
+xmlSecExecutorStopWorkers(xmlSecExecutorPtr executor) {
+    xmlSecExecutorWorkerPtr worker;
+    xmlSecSize ii;
+
+    xmlSecAssert(executor != NULL);
+
+    if(executor->workers == NULL) {
+        return;
+    }
+
+    xmlSecExecutorMutexLock(&(executor->mutex));
+    executor->stop = 1;
+    xmlSecExecutorCondBroadcast(&(executor->cond));
+    xmlSecExecutorMutexUnlock(&(executor->mutex));
+
+    for(ii = 0; ii < executor->workersNum; ++ii) {
+        worker = &(executor->workers[ii]);
+        if(worker->started == 0) {
+            continue;
+        }
+#if defined(XMLSEC_WINDOWS)
+        WaitForSingleObject(worker->thread, INFINITE);
+        CloseHandle(worker->thread);
+#else  /* defined(XMLSEC_WINDOWS) */
+        pthread_join(worker->thread, NULL);
+#endif /* defined(XMLSEC_WINDOWS) */
+    }
+    for(ii = 0; ii < executor->workersNum; ++ii) {
+        worker = &(executor->workers[ii]);
+        if(worker->items != NULL) {
+            xmlFree(worker->items);
+        }
+        xmlSecExecutorMutexFree(&(worker->mutex));
+    }
+    xmlFree(executor->workers);
+    executor->workers = NULL;
+    executor->workersNum = 0;
+}
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+/**************************************************************************
+ *
+ * Public functions
+ *
+ *************************************************************************/
+static xmlSecExecutorPtr
+xmlSecExecutorAlloc(void) {
+    xmlSecExecutorPtr executor;
+
+    executor = (xmlSecExecutorPtr)xmlMalloc(sizeof(xmlSecExecutor));
+    if(executor == NULL) {
+        xmlSecMallocError(sizeof(xmlSecExecutor), NULL);
+        return(NULL);
+    }
+    memset(executor, 0, sizeof(xmlSecExecutor));
+
+#if !defined(XMLSEC_NO_THREADS)
+    if(xmlSecExecutorMutexInit(&(executor->mutex)) != 0) {
+        xmlSecInternalError("xmlSecExecutorMutexInit", NULL);
+        xmlFree(executor);
+        return(NULL);
+    }
+    if(xmlSecExecutorCondInit(&(executor->cond)) != 0) {
+        xmlSecInternalError("xmlSecExecutorCondInit", NULL);
+        xmlSecExecutorMutexFree(&(executor->mutex));
+        xmlFree(executor);
+        return(NULL);
+    }
+#endif /* !defined(XMLSEC_NO_THREADS) */
+    return(executor);
+}
+
+/**
+ * xmlSecExecutorCreate:
+ * @threadsNum:         the number of threads (0 for the number of CPUs).
+ *
+ * Creates the default work-stealing threads pool executor. If the library
+ * is built without threads support then the tasks are run in the thread
+ * that submits them. The executor must be destroyed with #xmlSecExecutorDestroy.
+ *
+ * Returns: the pointer to the newly created executor or NULL if an error occurs.
+ */
+xmlSecExecutorPtr
+xmlSecExecutorCreate(xmlSecSize threadsNum) {
+    xmlSecExecutorPtr executor;
+
+    executor = xmlSecExecutorAlloc();
+    if(executor == NULL) {
+        xmlSecInternalError("xmlSecExecutorAlloc", NULL);
+        return(NULL);
+    }
+
+#if !defined(XMLSEC_NO_THREADS)
+    if(threadsNum == 0) {
+        threadsNum = xmlSecExecutorGetCpusNum();
+    }
+    if(xmlSecExecutorStartWorkers(executor, threadsNum) < 0) {
+        xmlSecInternalError2("xmlSecExecutorStartWorkers", NULL,
+            "threadsNum=" XMLSEC_SIZE_FMT, threadsNum);
+        xmlSecExecutorDestroy(executor);
+        return(NULL);
+    }
+#else  /* !defined(XMLSEC_NO_THREADS) */
+    UNREFERENCED_PARAMETER(threadsNum);
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+    return(executor);
+}
+
+/**
+ * xmlSecExecutorCreateCustom:
+ * @submit:             the application function that runs the tasks.
+ * @executorCtx:        the context passed to @submit.
+ *
+ * Creates the executor that runs the tasks with the application @submit
+ * function (e.g. on an existing threads pool). The thread waiting for
+ * a #xmlSecTaskGroup is blocked until all the group tasks complete, the
+ * tasks run by @submit must not wait for the groups submitted to the same
+ * pool unless the pool can grow. The executor must be destroyed with
+ * #xmlSecExecutorDestroy.
+ *
+ * Returns: the pointer to the newly created executor or NULL if an error occurs.
+ */
+xmlSecExecutorPtr
+xmlSecExecutorCreateCustom(xmlSecExecutorSubmitMethod submit, void* executorCtx) {
+    xmlSecExecutorPtr executor;
+
+    xmlSecAssert2(submit != NULL, NULL);
+
+    executor = xmlSecExecutorAlloc();
+    if(executor == NULL) {
+        xmlSecInternalError("xmlSecExecutorAlloc", NULL);
+        return(NULL);
+    }
+    executor->submit = submit;
+    executor->submitCtx = executorCtx;
+    return(executor);
+}
+
+/**
+ * xmlSecExecutorDestroy:
+ * @executor:           the pointer to the executor.
+ *
+ * Stops the default pool threads (after running all the queued tasks)
+ * and destroys @executor. All the groups must be completed before this call.
+ */
+void
+xmlSecExecutorDestroy(xmlSecExecutorPtr executor) {
+    xmlSecAssert(executor != NULL);
+
+#if !defined(XMLSEC_NO_THREADS)
+    xmlSecExecutorStopWorkers(executor);
+    xmlSecExecutorCondFree(&(executor->cond));
+    xmlSecExecutorMutexFree(&(executor->mutex));
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+    memset(executor, 0, sizeof(xmlSecExecutor));
+    xmlFree(executor);
+}
+
+/**
+ * xmlSecExecutorGetThreadsNum:
+ * @executor:           the pointer to the executor.
+ *
+ * Gets the number of the default pool threads (e.g. to choose the number
+ * of workers for #xmlSecExecutorRunWorkers).
+ *
+ * Returns: the number of threads, 1 for the application pool executors
+ * and for the library built without threads support.
+ */
+xmlSecSize
+xmlSecExecutorGetThreadsNum(xmlSecExecutorPtr executor) {
+    xmlSecAssert2(executor != NULL, 0);
+
+#if !defined(XMLSEC_NO_THREADS)
+    if(executor->workersNum > 0) {
+        return(executor->workersNum);
+    }
+#endif /* !defined(XMLSEC_NO_THREADS) */
+    return(1);
+}
+
+/**
+ * xmlSecTaskGroupCreate:
+ * @executor:           the pointer to the executor.
+ *
+ * Creates the tasks group for @executor.
+ *
+ * Returns: the pointer to the newly created group or NULL if an error occurs.
+ */
+xmlSecTaskGroupPtr
+xmlSecTaskGroupCreate(xmlSecExecutorPtr executor) {
+    xmlSecTaskGroupPtr group;
+
+    xmlSecAssert2(executor != NULL, NULL);
+
+    group = (xmlSecTaskGroupPtr)xmlMalloc(sizeof(xmlSecTaskGroup));
+    if(group == NULL) {
+        xmlSecMallocError(sizeof(xmlSecTaskGroup), NULL);
+        return(NULL);
+    }
+    memset(group, 0, sizeof(xmlSecTaskGroup));
+    group->executor = executor;
+    return(group);
+}
+
+/**
+ * xmlSecTaskGroupDestroy:
+ * @group:              the pointer to the group.
+ *
+ * Destroys @group. The group tasks must be completed (see #xmlSecTaskGroupWait).
+ */
+void
+xmlSecTaskGroupDestroy(xmlSecTaskGroupPtr group) {
+    xmlSecAssert(group != NULL);
+    xmlSecAssert(group->outstanding == 0);
+
+    memset(group, 0, sizeof(xmlSecTaskGroup));
+    xmlFree(group);
+}
+
+static void
+xmlSecExecutorItemRun(xmlSecExecutorPtr executor, xmlSecExecutorItemPtr item) {
+    xmlSecTaskGroupPtr group;
+
+    xmlSecAssert(executor != NULL);
+    xmlSecAssert(item != NULL);
+    xmlSecAssert(item->task != NULL);
+    xmlSecAssert(item->group != NULL);
+
+    group = item->group;
+    item->task(item->taskCtx);
+
+#if !defined(XMLSEC_NO_THREADS)
+    xmlSecExecutorMutexLock(&(executor->mutex));
+    xmlSecAssert(group->outstanding > 0);
+    --group->outstanding;
+    if(group->outstanding == 0) {
+        xmlSecExecutorCondBroadcast(&(executor->cond));
+    }
+    xmlSecExecutorMutexUnlock(&(executor->mutex));
+#else  /* !defined(XMLSEC_NO_THREADS) */
+    xmlSecAssert(group->outstanding > 0);
+    --group->outstanding;
+#endif /* !defined(XMLSEC_NO_THREADS) */
+}
+
+static void
+xmlSecExecutorCustomTask(void* taskCtx) {
+    xmlSecExecutorCustomItemPtr custom = (xmlSecExecutorCustomItemPtr)taskCtx;
+    xmlSecExecutorPtr executor;
+
+    xmlSecAssert(custom != NULL);
+    xmlSecAssert(custom->item.group != NULL);
+
+    executor = custom->item.group->executor;
+    xmlSecExecutorItemRun(executor, &(custom->item));
+    xmlFree(custom);
+}
+
+/**
+ * xmlSecTaskGroupSubmit:
+ * @group:              the pointer to the group.
+ * @task:               the task.
+ * @taskCtx:            the context passed to @task.
+ *
+ * Submits @task to the @group executor. The task can be run right away
+ * in another thread (or in the current thread if the library is built
+ * without threads support).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecTaskGroupSubmit(xmlSecTaskGroupPtr group, xmlSecExecutorTask task, void* taskCtx) {
+    xmlSecExecutorPtr executor;
+    xmlSecExecutorItem item;
+    int ret;
+
+    xmlSecAssert2(group != NULL, -1);
+    xmlSecAssert2(group->executor != NULL, -1);
+    xmlSecAssert2(task != NULL, -1);
+
+    executor = group->executor;
+    item.task = task;
+    item.taskCtx = taskCtx;
+    item.group = group;
+
+    /* the application pool */
+    if(executor->submit != NULL) {
+        xmlSecExecutorCustomItemPtr custom;
+
+        custom = (xmlSecExecutorCustomItemPtr)xmlMalloc(sizeof(xmlSecExecutorCustomItem));
+        if(custom == NULL) {
+            xmlSecMallocError(sizeof(xmlSecExecutorCustomItem), NULL);
+            return(-1);
+        }
+        custom->item = item;
+
+#if !defined(XMLSEC_NO_THREADS)
+        xmlSecExecutorMutexLock(&(executor->mutex));
+        ++group->outstanding;
+        xmlSecExecutorMutexUnlock(&(executor->mutex));
+#else  /* !defined(XMLSEC_NO_THREADS) */
+        ++group->outstanding;
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+        ret = executor->submit(executor->submitCtx, xmlSecExecutorCustomTask, custom);
+        if(ret < 0) {
+            xmlSecInternalError("executor->submit", NULL);
+#if !defined(XMLSEC_NO_THREADS)
+            xmlSecExecutorMutexLock(&(executor->mutex));
+            --group->outstanding;
+            xmlSecExecutorMutexUnlock(&(executor->mutex));
+#else  /* !defined(XMLSEC_NO_THREADS) */
+            --group->outstanding;
+#endif /* !defined(XMLSEC_NO_THREADS) */
+            xmlFree(custom);
+            return(-1);
+        }
+        return(0);
+    }
+
+#if !defined(XMLSEC_NO_THREADS)
+    /* the default pool: the current pool thread deque or the next one */
+    if(executor->workersNum > 0) {
+        xmlSecExecutorWorkerPtr worker;
+
+        xmlSecExecutorMutexLock(&(executor->mutex));
+        ++group->outstanding;
+        ++executor->queued;
+        worker = xmlSecExecutorGetCurrentWorker(executor);
+        if(worker == NULL) {
+            worker = &(executor->workers[executor->nextWorker]);
+            executor->nextWorker = (executor->nextWorker + 1) % executor->workersNum;
+        }
+        xmlSecExecutorMutexUnlock(&(executor->mutex));
+
+        ret = xmlSecExecutorWorkerPush(worker, &item);
+
+        xmlSecExecutorMutexLock(&(executor->mutex));
+        if(ret < 0) {
+            --group->outstanding;
+            --executor->queued;
+        }
+        xmlSecExecutorCondBroadcast(&(executor->cond));
+        xmlSecExecutorMutexUnlock(&(executor->mutex));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecExecutorWorkerPush", NULL);
+            return(-1);
+        }
+        return(0);
+    }
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+    /* no threads: run the task right away */
+    ++group->outstanding;
+    xmlSecExecutorItemRun(executor, &item);
+    return(0);
+}
+
+/**
+ * xmlSecTaskGroupWait:
+ * @group:              the pointer to the group.
+ *
+ * Waits until all the tasks submitted to @group complete. With the default
+ * executor, the current thread runs the queued tasks while waiting.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecTaskGroupWait(xmlSecTaskGroupPtr group) {
+#if !defined(XMLSEC_NO_THREADS)
+    xmlSecExecutorPtr executor;
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+    xmlSecAssert2(group != NULL, -1);
+    xmlSecAssert2(group->executor != NULL, -1);
+
+#if !defined(XMLSEC_NO_THREADS)
+    executor = group->executor;
+
+    /* the default pool: help to run the tasks */
+    if(executor->workersNum > 0) {
+        xmlSecExecutorWorkerPtr self = xmlSecExecutorGetCurrentWorker(executor);
+        xmlSecExecutorItem item;
+
+        while(1) {
+            xmlSecExecutorMutexLock(&(executor->mutex));
+            if(group->outstanding == 0) {
+                xmlSecExecutorMutexUnlock(&(executor->mutex));
+                break;
+            }
+            xmlSecExecutorMutexUnlock(&(executor->mutex));
+
+            if(xmlSecExecutorTake(executor, self, &item) != 0) {
+                xmlSecExecutorItemRun(executor, &item);
+                continue;
+            }
+
+            xmlSecExecutorMutexLock(&(executor->mutex));
+            while((group->outstanding > 0) && (executor->queued == 0)) {
+                xmlSecExecutorCondWait(&(executor->cond), &(executor->mutex));
+            }
+            xmlSecExecutorMutexUnlock(&(executor->mutex));
+        }
+        return(0);
+    }
+
+    /* the application pool */
+    if(executor->submit != NULL) {
+        xmlSecExecutorMutexLock(&(executor->mutex));
+        while(group->outstanding > 0) {
+            xmlSecExecutorCondWait(&(executor->cond), &(executor->mutex));
+        }
+        xmlSecExecutorMutexUnlock(&(executor->mutex));
+        return(0);
+    }
+#endif /* !defined(XMLSEC_NO_THREADS) */
+
+    /* no threads: the tasks must be completed already */
+    if(group->outstanding > 0) {
+        xmlSecOtherError2(XMLSEC_ERRORS_R_INVALID_OPERATION, NULL,
+            "outstanding=" XMLSEC_SIZE_FMT " (waiting requires threads support)",
+            group->outstanding);
+        return(-1);
+    }
+    return(0);
+}
+
+/* runs the task for one worker index */
+typedef struct _xmlSecExecutorWorkersTask      xmlSecExecutorWorkersTask, *xmlSecExecutorWorkersTaskPtr;
+struct _xmlSecExecutorWorkersTask {
+    xmlSecExecutorWorkerTask    task;
+    void*                       taskCtx;
+    xmlSecSize                  worker;
+};
+
+static void
+xmlSecExecutorWorkersTaskRun(void* taskCtx) {
+    xmlSecExecutorWorkersTaskPtr ctx = (xmlSecExecutorWorkersTaskPtr)taskCtx;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->task != NULL);
+
+    ctx->task(ctx->taskCtx, ctx->worker);
+}
+
+/**
+ * xmlSecExecutorRunWorkers:
+ * @executorCtx:        the pointer to the executor (#xmlSecExecutorPtr).
+ * @task:               the task to run for each worker.
+ * @taskCtx:            the context passed to @task.
+ * @workersNum:         the number of workers.
+ *
+ * Runs @task for each worker index from 0 to @workersNum - 1 on the
+ * executor and waits for all of them to complete. This function can be
+ * used as #xmlSecDSigBatchExecutor or #xmlSecEncBatchExecutor with
+ * the executor as the executor context.
+ *
+ * Returns: 0 on success or a negative value if the tasks could not be run.
+ */
+int
+xmlSecExecutorRunWorkers(void* executorCtx, xmlSecExecutorWorkerTask task, void* taskCtx, xmlSecSize workersNum) {
+    xmlSecExecutorPtr executor = (xmlSecExecutorPtr)executorCtx;
+    xmlSecExecutorWorkersTaskPtr tasks = NULL;
+    xmlSecTaskGroupPtr group = NULL;
+    xmlSecSize ii;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(executor != NULL, -1);
+    xmlSecAssert2(task != NULL, -1);
+
+    if(workersNum == 0) {
+        return(0);
+    }
+
+    tasks = (xmlSecExecutorWorkersTaskPtr)xmlMalloc(workersNum * sizeof(xmlSecExecutorWorkersTask));
+    if(tasks == NULL) {
+        xmlSecMallocError(workersNum * sizeof(xmlSecExecutorWorkersTask), NULL);
+        goto done;
+    }
+    group = xmlSecTaskGroupCreate(executor);
+    if(group == NULL) {
+        xmlSecInternalError("xmlSecTaskGroupCreate", NULL);
+        goto done;
+    }
+
+    for(ii = 0; ii < workersNum; ++ii) {
+        tasks[ii].task = task;
+        tasks[ii].taskCtx = taskCtx;
+        tasks[ii].worker = ii;
+        ret = xmlSecTaskGroupSubmit(group, xmlSecExecutorWorkersTaskRun, &(tasks[ii]));
+        if(ret < 0) {
+            /* the submitted tasks still use the tasks array */
+            xmlSecInternalError2("xmlSecTaskGroupSubmit", NULL, "worker=" XMLSEC_SIZE_FMT, ii);
+            (void)xmlSecTaskGroupWait(group);
+            goto done;
+        }
+    }
+    ret = xmlSecTaskGroupWait(group);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTaskGroupWait", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(group != NULL) {
+        xmlSecTaskGroupDestroy(group);
+    }
+    if(tasks != NULL) {
+        xmlFree(tasks);
+    }
+    return(res);
+}
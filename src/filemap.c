@@ -0,0 +1,305 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Read-only memory mapping of the local files and the anonymous
+ * temporary files.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/* mkstemp() and ftruncate() with -std=c99 */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif /* !defined(_WIN32) && !defined(_POSIX_C_SOURCE) */
+
+#include "globals.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* !defined(_WIN32) */
+
+#include <libxml/uri.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/errors.h>
+
+#include "filemap.h"
+
+/**
+ * xmlSecFileMapOpen:
+ * @map:                the pointer to the file map.
+ * @filename:           the file name.
+ *
+ * Maps the regular non-empty file @filename into the memory (read-only).
+ * The mapping is an optimization and the errors are not reported: the
+ * caller is expected to fall back to the regular file reading if the file
+ * can not be mapped (e.g. it is not a local regular file or the platform
+ * doesn't support mapping).
+ *
+ * Returns: 1 if the file is mapped or 0 otherwise.
+ */
+int
+xmlSecFileMapOpen(xmlSecFileMapPtr map, const char* filename) {
+#if !defined(_WIN32)
+    struct stat st;
+    void* data;
+    int fd;
+#endif /* !defined(_WIN32) */
+
+    xmlSecAssert2(map != NULL, 0);
+    xmlSecAssert2(filename != NULL, 0);
+
+    memset(map, 0, sizeof(xmlSecFileMap));
+
+#if !defined(_WIN32)
+    fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        return(0);
+    }
+    if((fstat(fd, &st) != 0) || (!S_ISREG(st.st_mode)) || (st.st_size <= 0) ||
+       ((unsigned long long)st.st_size > (unsigned long long)XMLSEC_SIZE_MAX) ||
+       ((unsigned long long)st.st_size > (unsigned long long)((size_t)-1))
+    ) {
+        close(fd);
+        return(0);
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        return(0);
+    }
+
+#if defined(POSIX_MADV_SEQUENTIAL)
+    /* all the users read the mapping from the start to the end */
+    (void)posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+#endif /* defined(POSIX_MADV_SEQUENTIAL) */
+
+    map->data = (const xmlSecByte*)data;
+    map->size = (xmlSecSize)st.st_size;
+    map->mappedSize = (size_t)st.st_size;
+    return(1);
+#else  /* !defined(_WIN32) */
+    return(0);
+#endif /* !defined(_WIN32) */
+}
+
+/**
+ * xmlSecFileMapClose:
+ * @map:                the pointer to the file map.
+ *
+ * Unmaps the file mapped with #xmlSecFileMapOpen.
+ */
+void
+xmlSecFileMapClose(xmlSecFileMapPtr map) {
+    xmlSecAssert(map != NULL);
+
+#if !defined(_WIN32)
+    if(map->data != NULL) {
+        munmap((void*)map->data, map->mappedSize);
+    }
+#endif /* !defined(_WIN32) */
+    memset(map, 0, sizeof(xmlSecFileMap));
+}
+
+#if !defined(_WIN32)
+/* creates the temporary file that is removed when @fd is closed */
+static int
+xmlSecTempMapOpenFile(void) {
+    const char* dir;
+    char* path;
+    size_t len;
+    int fd;
+
+    dir = getenv("TMPDIR");
+    if((dir == NULL) || (dir[0] == '\0')) {
+        dir = "/tmp";
+    }
+
+#if defined(O_TMPFILE)
+    /* the file never shows up in the directory */
+    fd = open(dir, O_TMPFILE | O_RDWR | O_EXCL, S_IRUSR | S_IWUSR);
+    if(fd >= 0) {
+        return(fd);
+    }
+#endif /* defined(O_TMPFILE) */
+
+    len = strlen(dir) + sizeof("/xmlsecXXXXXX");
+    path = (char*)malloc(len);
+    if(path == NULL) {
+        return(-1);
+    }
+    snprintf(path, len, "%s/xmlsecXXXXXX", dir);
+    fd = mkstemp(path);
+    if(fd >= 0) {
+        (void)unlink(path);
+    }
+    free(path);
+    return(fd);
+}
+#endif /* !defined(_WIN32) */
+
+/**
+ * xmlSecTempMapCreate:
+ * @size:               the mapping size.
+ * @fd:                 the pointer to the returned temporary file descriptor.
+ *
+ * Creates an anonymous temporary file of @size bytes (in the TMPDIR
+ * directory or in /tmp) and maps it into the memory (read-write). The
+ * mapped pages are backed by the file and can be evicted by the kernel
+ * instead of being kept in the process memory. The file is removed
+ * when it is unmapped with #xmlSecTempMapDestroy. Same as with
+ * #xmlSecFileMapOpen, the errors are not reported: the caller is
+ * expected to fall back to the regular memory allocation.
+ *
+ * Returns: the mapped memory (filled with zeros) or NULL if the file
+ * can not be created or mapped.
+ */
+xmlSecByte*
+xmlSecTempMapCreate(size_t size, int* fd) {
+#if !defined(_WIN32)
+    void* data;
+    int tmpFd;
+#endif /* !defined(_WIN32) */
+
+    xmlSecAssert2(size > 0, NULL);
+    xmlSecAssert2(fd != NULL, NULL);
+
+    (*fd) = -1;
+#if !defined(_WIN32)
+    if(((off_t)size < 0) || ((size_t)((off_t)size) != size)) {
+        return(NULL);
+    }
+    tmpFd = xmlSecTempMapOpenFile();
+    if(tmpFd < 0) {
+        return(NULL);
+    }
+    if(ftruncate(tmpFd, (off_t)size) != 0) {
+        close(tmpFd);
+        return(NULL);
+    }
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, tmpFd, 0);
+    if(data == MAP_FAILED) {
+        close(tmpFd);
+        return(NULL);
+    }
+
+    (*fd) = tmpFd;
+    return((xmlSecByte*)data);
+#else  /* !defined(_WIN32) */
+    return(NULL);
+#endif /* !defined(_WIN32) */
+}
+
+/**
+ * xmlSecTempMapResize:
+ * @fd:                 the temporary file descriptor.
+ * @data:               the current mapping.
+ * @oldSize:            the current mapping size.
+ * @newSize:            the new mapping size.
+ *
+ * Grows the temporary file created with #xmlSecTempMapCreate and maps it
+ * again: the data is preserved (but the address can change) and the new
+ * space is filled with zeros.
+ *
+ * Returns: the new mapping or NULL if an error occurs (the current mapping
+ * is still valid in this case).
+ */
+xmlSecByte*
+xmlSecTempMapResize(int fd, xmlSecByte* data, size_t oldSize, size_t newSize) {
+#if !defined(_WIN32)
+    void* newData;
+#endif /* !defined(_WIN32) */
+
+    xmlSecAssert2(fd >= 0, NULL);
+    xmlSecAssert2(data != NULL, NULL);
+    xmlSecAssert2(newSize > oldSize, NULL);
+
+#if !defined(_WIN32)
+    if(((off_t)newSize < 0) || ((size_t)((off_t)newSize) != newSize)) {
+        return(NULL);
+    }
+    if(ftruncate(fd, (off_t)newSize) != 0) {
+        return(NULL);
+    }
+    /* both mappings share the file pages so nothing is copied */
+    newData = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(newData == MAP_FAILED) {
+        return(NULL);
+    }
+    munmap(data, oldSize);
+    return((xmlSecByte*)newData);
+#else  /* !defined(_WIN32) */
+    UNREFERENCED_PARAMETER(oldSize);
+    return(NULL);
+#endif /* !defined(_WIN32) */
+}
+
+/**
+ * xmlSecTempMapDestroy:
+ * @fd:                 the temporary file descriptor.
+ * @data:               the mapping.
+ * @size:               the mapping size.
+ *
+ * Unmaps and removes the temporary file created with #xmlSecTempMapCreate.
+ */
+void
+xmlSecTempMapDestroy(int fd, xmlSecByte* data, size_t size) {
+#if !defined(_WIN32)
+    if(data != NULL) {
+        munmap(data, size);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+#else  /* !defined(_WIN32) */
+    UNREFERENCED_PARAMETER(fd);
+    UNREFERENCED_PARAMETER(data);
+    UNREFERENCED_PARAMETER(size);
+#endif /* !defined(_WIN32) */
+}
+
+/**
+ * xmlSecFileUriToPath:
+ * @uri:                the URI.
+ *
+ * Converts the local file URI (the plain path or the file: URI, same as
+ * the libxml2 file input) to the file name.
+ *
+ * Returns: the newly allocated file name (the caller should free it with
+ * xmlFree()) or NULL if @uri is not a local file or an error occurs.
+ */
+char*
+xmlSecFileUriToPath(const xmlChar* uri) {
+    const char* path;
+
+    xmlSecAssert2(uri != NULL, NULL);
+
+    path = (const char*)uri;
+    if(xmlStrncasecmp(uri, BAD_CAST "file://localhost/", 17) == 0) {
+        path += 16;
+    } else if(xmlStrncasecmp(uri, BAD_CAST "file:///", 8) == 0) {
+        path += 7;
+    } else if(xmlStrncasecmp(uri, BAD_CAST "file:/", 6) == 0) {
+        path += 5;
+    } else if(xmlStrstr(uri, BAD_CAST "://") != NULL) {
+        return(NULL);
+    }
+#ifdef _WIN32
+    if((path[0] == '/') && (path[1] != '\0') && (path[2] == ':')) {
+        ++path;
+    }
+#endif /* _WIN32 */
+
+    return(xmlURIUnescapeString(path, 0, NULL));
+}
@@ -0,0 +1,56 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * THIS IS A PRIVATE XMLSEC HEADER FILE
+ * DON'T USE IT IN YOUR APPLICATION
+ *
+ * Read-only memory mapping of the local files and the anonymous
+ * temporary files.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_FILEMAP_H__
+#define __XMLSEC_FILEMAP_H__
+
+#ifndef XMLSEC_PRIVATE
+#error "filemap.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct _xmlSecFileMap                   xmlSecFileMap, *xmlSecFileMapPtr;
+struct _xmlSecFileMap {
+    const xmlSecByte*           data;
+    xmlSecSize                  size;
+    size_t                      mappedSize;
+};
+
+XMLSEC_EXPORT int               xmlSecFileMapOpen               (xmlSecFileMapPtr map,
+                                                                 const char* filename);
+XMLSEC_EXPORT void              xmlSecFileMapClose              (xmlSecFileMapPtr map);
+
+XMLSEC_EXPORT xmlSecByte*       xmlSecTempMapCreate             (size_t size,
+                                                                 int* fd);
+XMLSEC_EXPORT xmlSecByte*       xmlSecTempMapResize             (int fd,
+                                                                 xmlSecByte* data,
+                                                                 size_t oldSize,
+                                                                 size_t newSize);
+XMLSEC_EXPORT void              xmlSecTempMapDestroy            (int fd,
+                                                                 xmlSecByte* data,
+                                                                 size_t size);
+
+XMLSEC_EXPORT char*             xmlSecFileUriToPath             (const xmlChar* uri);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_FILEMAP_H__ */
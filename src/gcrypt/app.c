@@ -31,6 +31,7 @@
 
 #include "asn1.h"
 #include "../cast_helpers.h"
+#include "../keysdata_helpers.h"
 
 /**
  * xmlSecGCryptAppInit:
@@ -484,6 +485,28 @@ xmlSecGCryptAppKeysMngrCertLoadMemory(xmlSecKeysMngrPtr mngr,
     return(-1);
 }
 
+/**
+ * xmlSecGCryptAppKeysMngrEnableX509VerifyCache:
+ * @mngr:               the keys manager.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Placeholder. GCrypt  does not support X509 certificates.
+ *
+ * Enables the cache of the successful certificates verification results
+ * in the X509 store of @mngr.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecGCryptAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize) {
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    /* GCrypt  does not support X509 certificates */
+    xmlSecNotImplementedError(NULL);
+    return(-1);
+}
+
 #endif /* XMLSEC_NO_X509 */
 
 /**
@@ -560,6 +583,9 @@ xmlSecGCryptAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key)
         return(-1);
     }
 
+    /* the new key might be one of the recently not found keys */
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
+
     return(0);
 }
 
@@ -388,6 +388,204 @@ xmlSecGCryptAsn1GuessKeyType(gcry_mpi_t * integers, xmlSecSize integers_num, xml
     }
 }
 
+#if !defined(XMLSEC_NO_RSA) || !defined(XMLSEC_NO_EC)
+/* the SubjectPublicKeyInfo algorithm object ids */
+static const xmlSecByte g_xmlSecGCryptAsn1RsaEncryptionObjectId[] = {
+    0x2A,0x86,0x48,0x86,0xF7,0x0D,0x01,0x01,0x01                       /* OBJ_rsaEncryption */
+};
+static const xmlSecByte g_xmlSecGCryptAsn1EcPublicKeyObjectId[] = {
+    0x2A,0x86,0x48,0xCE,0x3D,0x02,0x01                                 /* OBJ_X9_62_id_ecPublicKey */
+};
+
+/* Reads the next primitive or constructed TLV with the expected tag from the
+   buffer and returns its value.  */
+static int
+xmlSecGCryptAsn1ReadValue(xmlSecByte const **buffer, unsigned long *buflen,
+                          unsigned long tag, unsigned int cons,
+                          xmlSecByte const **value, unsigned long *valueLen)
+{
+    struct tag_info ti;
+    int ret;
+
+    xmlSecAssert2(buffer != NULL, -1);
+    xmlSecAssert2(buflen != NULL, -1);
+    xmlSecAssert2(value != NULL, -1);
+    xmlSecAssert2(valueLen != NULL, -1);
+
+    memset(&ti, 0, sizeof(ti));
+    ret = xmlSecGCryptAsn1ParseTag(buffer, buflen, &ti);
+    if((ret != 0) || (ti.class != UNIVERSAL) || (ti.tag != tag) || (ti.cons != cons) || (ti.ndef != 0)) {
+        return(-1);
+    }
+
+    (*value) = (*buffer);
+    (*valueLen) = ti.length;
+    (*buffer) += ti.length;
+    (*buflen) -= ti.length;
+    return(0);
+}
+
+/* Fast path for the common RSA and EC SubjectPublicKeyInfo layouts:
+ *
+ *   SEQUENCE { SEQUENCE { OID, NULL | OID }, BIT STRING { 00, key } }
+ *
+ * The key S-expression is built directly from the DER bytes without
+ * converting the values to MPIs first. Returns 1 if the public key was
+ * read, 0 if the layout doesn't match (the caller falls back to the
+ * generic parser) or a negative value if an error occurs.
+ */
+static int
+xmlSecGCryptAsn1ParseSubjectPublicKeyInfo(const xmlSecByte * der, xmlSecSize derlen,
+                                          xmlSecKeyDataPtr * key_data)
+{
+    const xmlSecByte *buf, *seq, *alg, *oid, *key;
+    unsigned long length, seqLen, algLen, oidLen, keyLen;
+    gcry_sexp_t s_pub_key = NULL;
+    xmlSecKeyDataPtr data = NULL;
+    gcry_error_t err;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(der != NULL, -1);
+    xmlSecAssert2(key_data != NULL, -1);
+    xmlSecAssert2((*key_data) == NULL, -1);
+
+    buf = der;
+    XMLSEC_SAFE_CAST_SIZE_TO_ULONG(derlen, length, return(-1), NULL);
+
+    /* SEQUENCE { SEQUENCE { OID, params }, BIT STRING } covering the whole buffer */
+    if((xmlSecGCryptAsn1ReadValue(&buf, &length, TAG_SEQUENCE, 1, &seq, &seqLen) != 0) || (length != 0)) {
+        return(0);
+    }
+    if(xmlSecGCryptAsn1ReadValue(&seq, &seqLen, TAG_SEQUENCE, 1, &alg, &algLen) != 0) {
+        return(0);
+    }
+    if((xmlSecGCryptAsn1ReadValue(&seq, &seqLen, TAG_BIT_STRING, 0, &key, &keyLen) != 0) || (seqLen != 0)) {
+        return(0);
+    }
+    if(xmlSecGCryptAsn1ReadValue(&alg, &algLen, TAG_OBJECT_ID, 0, &oid, &oidLen) != 0) {
+        return(0);
+    }
+
+    /* no unused bits in the key */
+    if((keyLen < 2) || (key[0] != 0)) {
+        return(0);
+    }
+    ++key;
+    --keyLen;
+
+#ifndef XMLSEC_NO_RSA
+    if((oidLen == sizeof(g_xmlSecGCryptAsn1RsaEncryptionObjectId)) &&
+       (memcmp(oid, g_xmlSecGCryptAsn1RsaEncryptionObjectId, oidLen) == 0))
+    {
+        const xmlSecByte *n, *e;
+        unsigned long nLen, eLen;
+
+        /* RSAPublicKey ::= SEQUENCE { modulus INTEGER, publicExponent INTEGER } */
+        if(xmlSecGCryptAsn1ReadValue(&key, &keyLen, TAG_SEQUENCE, 1, &seq, &seqLen) != 0) {
+            return(0);
+        }
+        if((xmlSecGCryptAsn1ReadValue(&seq, &seqLen, TAG_INTEGER, 0, &n, &nLen) != 0) ||
+           (xmlSecGCryptAsn1ReadValue(&seq, &seqLen, TAG_INTEGER, 0, &e, &eLen) != 0) ||
+           (seqLen != 0) || (nLen > INT_MAX) || (eLen > INT_MAX))
+        {
+            return(0);
+        }
+
+        err = gcry_sexp_build (&s_pub_key, NULL,
+                         "(public-key(rsa(n%b)(e%b)))",
+                         (int)nLen, n, (int)eLen, e
+        );
+        if((err != GPG_ERR_NO_ERROR) || (s_pub_key == NULL)) {
+            xmlSecGCryptError("gcry_sexp_build(public-key/rsa)", err, NULL);
+            goto done;
+        }
+
+        data = xmlSecKeyDataCreate(xmlSecGCryptKeyDataRsaId);
+        if(data == NULL) {
+            xmlSecInternalError("xmlSecKeyDataCreate(xmlSecGCryptKeyDataRsaId)", NULL);
+            goto done;
+        }
+        ret = xmlSecGCryptKeyDataRsaAdoptKeyPair(data, s_pub_key, NULL);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecGCryptKeyDataRsaAdoptKeyPair(xmlSecGCryptKeyDataRsaId)", NULL);
+            goto done;
+        }
+        s_pub_key = NULL; /* owned by data now */
+    } else
+#endif /* XMLSEC_NO_RSA */
+
+#ifndef XMLSEC_NO_EC
+    if((oidLen == sizeof(g_xmlSecGCryptAsn1EcPublicKeyObjectId)) &&
+       (memcmp(oid, g_xmlSecGCryptAsn1EcPublicKeyObjectId, oidLen) == 0))
+    {
+        xmlSecGCryptAsn1ObjectId curveId;
+        const xmlSecByte *params;
+        unsigned long paramsLen;
+        const char* ecCurve;
+
+        /* the named curve object id */
+        if((xmlSecGCryptAsn1ReadValue(&alg, &algLen, TAG_OBJECT_ID, 0, &params, &paramsLen) != 0) ||
+           (algLen != 0) || (paramsLen > XMLSEC_GCRYPT_ASN1_MAX_OBJECT_ID_SIZE) || (keyLen > INT_MAX))
+        {
+            return(0);
+        }
+        memset(curveId, 0, sizeof(curveId));
+        memcpy(curveId, params, paramsLen);
+        ecCurve = xmlSecGCryptAsn1GetCurveFromObjectId(curveId);
+        if(ecCurve == NULL) {
+            return(0);
+        }
+
+        /* the key is the EC point */
+        err = gcry_sexp_build (&s_pub_key, NULL,
+            "(public-key"
+            " (ecdsa"
+            " (curve %s)"
+            " (q %b)"
+            " ))",
+            ecCurve, (int)keyLen, key
+        );
+        if((err != GPG_ERR_NO_ERROR) || (s_pub_key == NULL)) {
+            xmlSecGCryptError("gcry_sexp_build(public-key/ecdsa)", err, NULL);
+            goto done;
+        }
+
+        data = xmlSecKeyDataCreate(xmlSecGCryptKeyDataEcId);
+        if(data == NULL) {
+            xmlSecInternalError("xmlSecKeyDataCreate(xmlSecGCryptKeyDataEcId)", NULL);
+            goto done;
+        }
+        ret = xmlSecGCryptKeyDataEcAdoptKeyPair(data, s_pub_key, NULL);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecGCryptKeyDataEcAdoptKeyPair(xmlSecGCryptKeyDataEcId)", NULL);
+            goto done;
+        }
+        s_pub_key = NULL; /* owned by data now */
+    } else
+#endif /* XMLSEC_NO_EC */
+
+    {
+        /* not RSA or EC key */
+        return(0);
+    }
+
+    /* success */
+    (*key_data) = data;
+    data = NULL;
+    res = 1;
+
+done:
+    if(s_pub_key != NULL) {
+        gcry_sexp_release(s_pub_key);
+    }
+    if(data != NULL) {
+        xmlSecKeyDataDestroy(data);
+    }
+    return(res);
+}
+#endif /* !defined(XMLSEC_NO_RSA) || !defined(XMLSEC_NO_EC) */
+
 xmlSecKeyDataPtr
 xmlSecGCryptParseDer(const xmlSecByte * der, xmlSecSize derlen,
                      enum xmlSecGCryptDerKeyType type) {
@@ -406,9 +604,24 @@ xmlSecGCryptParseDer(const xmlSecByte * der, xmlSecSize derlen,
     xmlSecAssert2(der != NULL, NULL);
     xmlSecAssert2(derlen > 0, NULL);
 
-    /* Parse the ASN.1 structure.  */
     memset(&integers, 0, sizeof(integers));
     memset(&objectids, 0, sizeof(objectids));
+
+#if !defined(XMLSEC_NO_RSA) || !defined(XMLSEC_NO_EC)
+    /* try the common public keys layouts first */
+    if(type == xmlSecGCryptDerKeyTypeAuto) {
+        ret = xmlSecGCryptAsn1ParseSubjectPublicKeyInfo(der, derlen, &key_data);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecGCryptAsn1ParseSubjectPublicKeyInfo", NULL);
+            goto done;
+        } else if(ret > 0) {
+            /* done */
+            goto done;
+        }
+    }
+#endif /* !defined(XMLSEC_NO_RSA) || !defined(XMLSEC_NO_EC) */
+
+    /* Parse the ASN.1 structure.  */
     ret = xmlSecGCryptAsn1ParseIntegerSequence(
         0, &der, &derlen,
         integers,  sizeof(integers) / sizeof(integers[0]), &integers_num,
@@ -31,12 +31,40 @@
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 
+/* the key pairs references counter is changed from different threads when
+ * the keys are shared between them (e.g. keys from the keys store) */
+#if defined(__GNUC__) || defined(__clang__)
+#define XMLSEC_GCRYPT_KEY_PAIR_REF_INC(ptr)     __atomic_add_fetch((ptr), 1, __ATOMIC_RELAXED)
+#define XMLSEC_GCRYPT_KEY_PAIR_REF_DEC(ptr)     __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+#elif defined(_MSC_VER)
+#include <windows.h>
+#define XMLSEC_GCRYPT_KEY_PAIR_REF_INC(ptr)     InterlockedIncrement((volatile LONG*)(ptr))
+#define XMLSEC_GCRYPT_KEY_PAIR_REF_DEC(ptr)     InterlockedDecrement((volatile LONG*)(ptr))
+#else /* defined(_MSC_VER) */
+#define XMLSEC_GCRYPT_KEY_PAIR_REF_INC(ptr)     (++(*(ptr)))
+#define XMLSEC_GCRYPT_KEY_PAIR_REF_DEC(ptr)     (--(*(ptr)))
+#endif /* defined(__GNUC__) || defined(__clang__) */
+
 /**************************************************************************
  *
- * Helpers
+ * Shared key pair: the S-expressions are never modified after they are
+ * built, so the duplicated key data (e.g. the keys copied into the
+ * signature transforms for every operation) share them instead of
+ * re-building them from the printed form.
  *
  *************************************************************************/
-static gcry_sexp_t             xmlSecGCryptAsymSExpDup    (gcry_sexp_t sexp);
+typedef struct _xmlSecGCryptAsymKeyPair          xmlSecGCryptAsymKeyPair,
+                                                *xmlSecGCryptAsymKeyPairPtr;
+struct _xmlSecGCryptAsymKeyPair {
+    int         refCount;
+    gcry_sexp_t pub_key;
+    gcry_sexp_t priv_key;
+};
+
+static xmlSecGCryptAsymKeyPairPtr xmlSecGCryptAsymKeyPairCreate (gcry_sexp_t pub_key,
+                                                                 gcry_sexp_t priv_key);
+static xmlSecGCryptAsymKeyPairPtr xmlSecGCryptAsymKeyPairRef    (xmlSecGCryptAsymKeyPairPtr pair);
+static void                     xmlSecGCryptAsymKeyPairUnref    (xmlSecGCryptAsymKeyPairPtr pair);
 
 
 /**************************************************************************
@@ -47,8 +75,9 @@ static gcry_sexp_t             xmlSecGCryptAsymSExpDup    (gcry_sexp_t sexp);
 typedef struct _xmlSecGCryptAsymKeyDataCtx       xmlSecGCryptAsymKeyDataCtx,
                                                 *xmlSecGCryptAsymKeyDataCtxPtr;
 struct _xmlSecGCryptAsymKeyDataCtx {
-    gcry_sexp_t pub_key;
-    gcry_sexp_t priv_key;
+    xmlSecGCryptAsymKeyPairPtr pair;
+    gcry_sexp_t pub_key;        /* owned by pair */
+    gcry_sexp_t priv_key;       /* owned by pair */
 };
 
 /******************************************************************************
@@ -105,28 +134,15 @@ xmlSecGCryptAsymKeyDataDuplicate(xmlSecKeyDataPtr dst, xmlSecKeyDataPtr src) {
 
     ctxDst = xmlSecGCryptAsymKeyDataGetCtx(dst);
     xmlSecAssert2(ctxDst != NULL, -1);
-    xmlSecAssert2(ctxDst->pub_key == NULL, -1);
-    xmlSecAssert2(ctxDst->priv_key == NULL, -1);
+    xmlSecAssert2(ctxDst->pair == NULL, -1);
 
     ctxSrc = xmlSecGCryptAsymKeyDataGetCtx(src);
     xmlSecAssert2(ctxSrc != NULL, -1);
 
-    if(ctxSrc->pub_key != NULL) {
-        ctxDst->pub_key = xmlSecGCryptAsymSExpDup(ctxSrc->pub_key);
-        if(ctxDst->pub_key == NULL) {
-            xmlSecInternalError("xmlSecGCryptAsymSExpDup(pub_key)",
-                                xmlSecKeyDataGetName(dst));
-            return(-1);
-        }
-    }
-
-    if(ctxSrc->priv_key != NULL) {
-        ctxDst->priv_key = xmlSecGCryptAsymSExpDup(ctxSrc->priv_key);
-        if(ctxDst->priv_key == NULL) {
-            xmlSecInternalError("xmlSecGCryptAsymSExpDup(priv_key)",
-                                xmlSecKeyDataGetName(dst));
-            return(-1);
-        }
+    if(ctxSrc->pair != NULL) {
+        ctxDst->pair = xmlSecGCryptAsymKeyPairRef(ctxSrc->pair);
+        ctxDst->pub_key = ctxSrc->pub_key;
+        ctxDst->priv_key = ctxSrc->priv_key;
     }
 
     return(0);
@@ -142,11 +158,8 @@ xmlSecGCryptAsymKeyDataFinalize(xmlSecKeyDataPtr data) {
     ctx = xmlSecGCryptAsymKeyDataGetCtx(data);
     xmlSecAssert(ctx != NULL);
 
-    if(ctx->pub_key != NULL) {
-        gcry_sexp_release(ctx->pub_key);
-    }
-    if(ctx->priv_key != NULL) {
-        gcry_sexp_release(ctx->priv_key);
+    if(ctx->pair != NULL) {
+        xmlSecGCryptAsymKeyPairUnref(ctx->pair);
     }
     memset(ctx, 0, sizeof(xmlSecGCryptAsymKeyDataCtx));
 }
@@ -201,6 +214,7 @@ done:
 static int
 xmlSecGCryptAsymKeyDataAdoptKeyPair(xmlSecKeyDataPtr data, gcry_sexp_t pub_key, gcry_sexp_t priv_key) {
     xmlSecGCryptAsymKeyDataCtxPtr ctx;
+    xmlSecGCryptAsymKeyPairPtr pair;
 
     xmlSecAssert2(xmlSecKeyDataIsValid(data), -1);
     xmlSecAssert2(xmlSecKeyDataCheckSize(data, xmlSecGCryptAsymKeyDataSize), -1);
@@ -215,14 +229,18 @@ xmlSecGCryptAsymKeyDataAdoptKeyPair(xmlSecKeyDataPtr data, gcry_sexp_t pub_key,
     ctx = xmlSecGCryptAsymKeyDataGetCtx(data);
     xmlSecAssert2(ctx != NULL, -1);
 
-    /* release prev values and assign new ones */
-    if(ctx->pub_key != NULL) {
-        gcry_sexp_release(ctx->pub_key);
-    }
-    if(ctx->priv_key != NULL) {
-        gcry_sexp_release(ctx->priv_key);
+    pair = xmlSecGCryptAsymKeyPairCreate(pub_key, priv_key);
+    if(pair == NULL) {
+        xmlSecInternalError("xmlSecGCryptAsymKeyPairCreate", NULL);
+        return(-1);
     }
 
+    /* release prev values (the other key data might still share them)
+     * and assign new ones */
+    if(ctx->pair != NULL) {
+        xmlSecGCryptAsymKeyPairUnref(ctx->pair);
+    }
+    ctx->pair = pair;
     ctx->pub_key = pub_key;
     ctx->priv_key = priv_key;
 
@@ -353,45 +371,49 @@ xmlSecGCryptAsymKeyDataGetSize(xmlSecKeyDataPtr data) {
  * helper functions
  *
  *****************************************************************************/
-static gcry_sexp_t
-xmlSecGCryptAsymSExpDup(gcry_sexp_t pKey) {
-    gcry_sexp_t res = NULL;
-    xmlSecByte *buf = NULL;
-    gcry_error_t err;
-    size_t size;
+static xmlSecGCryptAsymKeyPairPtr
+xmlSecGCryptAsymKeyPairCreate(gcry_sexp_t pub_key, gcry_sexp_t priv_key) {
+    xmlSecGCryptAsymKeyPairPtr pair;
 
-    xmlSecAssert2(pKey != NULL, NULL);
+    xmlSecAssert2(pub_key != NULL, NULL);
 
-    size = gcry_sexp_sprint(pKey, GCRYSEXP_FMT_ADVANCED, NULL, 0);
-    if(size == 0) {
-        xmlSecGCryptError("gcry_sexp_sprint", (gcry_error_t)GPG_ERR_NO_ERROR, NULL);
-        goto done;
+    pair = (xmlSecGCryptAsymKeyPairPtr)xmlMalloc(sizeof(xmlSecGCryptAsymKeyPair));
+    if(pair == NULL) {
+        xmlSecMallocError(sizeof(xmlSecGCryptAsymKeyPair), NULL);
+        return(NULL);
     }
+    memset(pair, 0, sizeof(xmlSecGCryptAsymKeyPair));
 
-    buf = (xmlSecByte *)xmlMalloc(size);
-    if(buf == NULL) {
-        xmlSecMallocError(size, NULL);
-        goto done;
-    }
+    pair->refCount = 1;
+    pair->pub_key = pub_key;
+    pair->priv_key = priv_key;
+    return(pair);
+}
 
-    size = gcry_sexp_sprint(pKey, GCRYSEXP_FMT_ADVANCED, buf, size);
-    if(size == 0) {
-        xmlSecGCryptError2("gcry_sexp_sprint", (gcry_error_t)GPG_ERR_NO_ERROR, NULL,
-                           "size" XMLSEC_SIZE_T_FMT, size);
-        goto done;
-    }
+static xmlSecGCryptAsymKeyPairPtr
+xmlSecGCryptAsymKeyPairRef(xmlSecGCryptAsymKeyPairPtr pair) {
+    xmlSecAssert2(pair != NULL, NULL);
 
-    err = gcry_sexp_new(&res, buf, size, 1);
-    if((err != GPG_ERR_NO_ERROR) || (res == NULL)) {
-        xmlSecGCryptError("gcry_sexp_new", err, NULL);
-        goto done;
+    XMLSEC_GCRYPT_KEY_PAIR_REF_INC(&(pair->refCount));
+    return(pair);
+}
+
+static void
+xmlSecGCryptAsymKeyPairUnref(xmlSecGCryptAsymKeyPairPtr pair) {
+    xmlSecAssert(pair != NULL);
+
+    if(XMLSEC_GCRYPT_KEY_PAIR_REF_DEC(&(pair->refCount)) > 0) {
+        return;
     }
 
-done:
-    if(buf != NULL) {
-        xmlFree(buf);
+    if(pair->pub_key != NULL) {
+        gcry_sexp_release(pair->pub_key);
+    }
+    if(pair->priv_key != NULL) {
+        gcry_sexp_release(pair->priv_key);
     }
-    return (res);
+    memset(pair, 0, sizeof(xmlSecGCryptAsymKeyPair));
+    xmlFree(pair);
 }
 
 /**
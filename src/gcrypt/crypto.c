@@ -22,18 +22,26 @@
 
 #include <gcrypt.h>
 
+#include <libxml/threads.h>
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/dl.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 
 #include <xmlsec/gcrypt/app.h>
 #include <xmlsec/gcrypt/crypto.h>
 
+#include "private.h"
+
 static xmlSecCryptoDLFunctionsPtr gXmlSecGCryptFunctions = NULL;
 
+static int              xmlSecGCryptTemplatesInit               (void);
+static void             xmlSecGCryptTemplatesShutdown           (void);
+
 /**
  * xmlSecCryptoGetFunctions_gcrypt:
  *
@@ -290,6 +298,7 @@ xmlSecCryptoGetFunctions_gcrypt(void) {
 #ifndef XMLSEC_NO_X509
     gXmlSecGCryptFunctions->cryptoAppKeysMngrCertLoad           = xmlSecGCryptAppKeysMngrCertLoad;
     gXmlSecGCryptFunctions->cryptoAppKeysMngrCrlLoad            = xmlSecGCryptAppKeysMngrCrlLoad;
+    gXmlSecGCryptFunctions->cryptoAppKeysMngrEnableX509VerifyCache = xmlSecGCryptAppKeysMngrEnableX509VerifyCache;
     gXmlSecGCryptFunctions->cryptoAppPkcs12Load                 = xmlSecGCryptAppPkcs12Load;
     gXmlSecGCryptFunctions->cryptoAppKeyCertLoad                = xmlSecGCryptAppKeyCertLoad;
 #endif /* XMLSEC_NO_X509 */
@@ -322,6 +331,11 @@ xmlSecGCryptInit (void)  {
         return(-1);
     }
 
+    /* not fatal: the contexts are created every time */
+    if(xmlSecGCryptTemplatesInit() < 0) {
+        xmlSecInternalError("xmlSecGCryptTemplatesInit", NULL);
+    }
+
     return(0);
 }
 
@@ -334,6 +348,7 @@ xmlSecGCryptInit (void)  {
  */
 int
 xmlSecGCryptShutdown(void) {
+    xmlSecGCryptTemplatesShutdown();
     return(0);
 }
 
@@ -380,3 +395,334 @@ xmlSecGCryptGenerateRandom(xmlSecBufferPtr buffer, xmlSecSize size) {
     gcry_randomize(xmlSecBufferGetData(buffer), size, GCRY_STRONG_RANDOM);
     return(0);
 }
+
+/******************************************************************************
+ *
+ * Template contexts: gcry_md_open() allocates and sets up a new handle for
+ * every transform (and the HMAC transforms also run gcry_md_setkey()).
+ * Instead we keep one opened handle per digest and give out gcry_md_copy()
+ * copies. The keyed HMAC templates are disabled by default: the entries keep
+ * a copy of the key (in the secure memory) to match the lookups, it is
+ * cleared when the entry is removed.
+ *
+ *****************************************************************************/
+#define XMLSEC_GCRYPT_DIGEST_TEMPLATES_MAX_SIZE         16
+#define XMLSEC_GCRYPT_HMAC_TEMPLATES_MAX_SIZE           32
+#define XMLSEC_GCRYPT_HMAC_TEMPLATES_MAX_KEY_SIZE       128
+
+typedef struct _xmlSecGCryptDigestTemplate {
+    int                 digest;
+    gcry_md_hd_t        tmpl;
+} xmlSecGCryptDigestTemplate;
+
+typedef struct _xmlSecGCryptHmacTemplate {
+    int                 digest;
+    xmlSecByte*         key;            /* gcry_malloc_secure() */
+    xmlSecSize          keySize;
+    gcry_md_hd_t        tmpl;
+} xmlSecGCryptHmacTemplate;
+
+static xmlMutexPtr                  gXmlSecGCryptTemplatesMutex = NULL;
+static xmlSecGCryptDigestTemplate   gXmlSecGCryptDigestTemplates[XMLSEC_GCRYPT_DIGEST_TEMPLATES_MAX_SIZE];
+static xmlSecSize                   gXmlSecGCryptDigestTemplatesSize = 0;
+static int                          gXmlSecGCryptHmacTemplatesEnabled = 0;
+static xmlSecGCryptHmacTemplate     gXmlSecGCryptHmacTemplates[XMLSEC_GCRYPT_HMAC_TEMPLATES_MAX_SIZE];
+static xmlSecSize                   gXmlSecGCryptHmacTemplatesSize = 0;
+static xmlSecSize                   gXmlSecGCryptHmacTemplatesNext = 0;
+
+static int
+xmlSecGCryptTemplatesInit(void) {
+    if(gXmlSecGCryptTemplatesMutex != NULL) {
+        return(0);
+    }
+
+    gXmlSecGCryptTemplatesMutex = xmlNewMutex();
+    if(gXmlSecGCryptTemplatesMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    memset(gXmlSecGCryptDigestTemplates, 0, sizeof(gXmlSecGCryptDigestTemplates));
+    memset(gXmlSecGCryptHmacTemplates, 0, sizeof(gXmlSecGCryptHmacTemplates));
+    gXmlSecGCryptDigestTemplatesSize = 0;
+    gXmlSecGCryptHmacTemplatesSize = 0;
+    gXmlSecGCryptHmacTemplatesNext = 0;
+    gXmlSecGCryptHmacTemplatesEnabled = 0;
+    return(0);
+}
+
+static void
+xmlSecGCryptHmacTemplateFinalize(xmlSecGCryptHmacTemplate* entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->tmpl != NULL) {
+        gcry_md_close(entry->tmpl);
+    }
+    if(entry->key != NULL) {
+        memset(entry->key, 0, entry->keySize);
+        gcry_free(entry->key);
+    }
+    memset(entry, 0, sizeof(xmlSecGCryptHmacTemplate));
+}
+
+/* should be called under lock */
+static void
+xmlSecGCryptHmacTemplatesFlush(void) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecGCryptHmacTemplatesSize; ++ii) {
+        xmlSecGCryptHmacTemplateFinalize(&(gXmlSecGCryptHmacTemplates[ii]));
+    }
+    gXmlSecGCryptHmacTemplatesSize = 0;
+    gXmlSecGCryptHmacTemplatesNext = 0;
+}
+
+static void
+xmlSecGCryptTemplatesShutdown(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecGCryptTemplatesMutex == NULL) {
+        return;
+    }
+    for(ii = 0; ii < gXmlSecGCryptDigestTemplatesSize; ++ii) {
+        gcry_md_close(gXmlSecGCryptDigestTemplates[ii].tmpl);
+    }
+    memset(gXmlSecGCryptDigestTemplates, 0, sizeof(gXmlSecGCryptDigestTemplates));
+    gXmlSecGCryptDigestTemplatesSize = 0;
+
+    xmlSecGCryptHmacTemplatesFlush();
+    gXmlSecGCryptHmacTemplatesEnabled = 0;
+
+    xmlFreeMutex(gXmlSecGCryptTemplatesMutex);
+    gXmlSecGCryptTemplatesMutex = NULL;
+}
+
+/* should be called under lock */
+static xmlSecGCryptDigestTemplate*
+xmlSecGCryptDigestTemplatesFind(int digest) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecGCryptDigestTemplatesSize; ++ii) {
+        if(gXmlSecGCryptDigestTemplates[ii].digest == digest) {
+            return(&(gXmlSecGCryptDigestTemplates[ii]));
+        }
+    }
+    return(NULL);
+}
+
+/* should be called under lock */
+static xmlSecGCryptHmacTemplate*
+xmlSecGCryptHmacTemplatesFind(int digest, const xmlSecByte* key, xmlSecSize keySize) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecGCryptHmacTemplatesSize; ++ii) {
+        if((gXmlSecGCryptHmacTemplates[ii].digest == digest) &&
+           (gXmlSecGCryptHmacTemplates[ii].keySize == keySize) &&
+           (memcmp(gXmlSecGCryptHmacTemplates[ii].key, key, keySize) == 0)
+        ) {
+            return(&(gXmlSecGCryptHmacTemplates[ii]));
+        }
+    }
+    return(NULL);
+}
+
+/* should be called under lock, takes ownership of @tmpl on success */
+static int
+xmlSecGCryptHmacTemplatesAdd(int digest, const xmlSecByte* key, xmlSecSize keySize, gcry_md_hd_t tmpl) {
+    xmlSecGCryptHmacTemplate* entry;
+    xmlSecByte* keyCopy;
+
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(keySize <= XMLSEC_GCRYPT_HMAC_TEMPLATES_MAX_KEY_SIZE, -1);
+
+    keyCopy = (xmlSecByte*)gcry_malloc_secure(keySize);
+    if(keyCopy == NULL) {
+        xmlSecMallocError(keySize, NULL);
+        return(-1);
+    }
+    memcpy(keyCopy, key, keySize);
+
+    if(gXmlSecGCryptHmacTemplatesSize < XMLSEC_GCRYPT_HMAC_TEMPLATES_MAX_SIZE) {
+        entry = &(gXmlSecGCryptHmacTemplates[gXmlSecGCryptHmacTemplatesSize++]);
+    } else {
+        /* replace the oldest entry */
+        if(gXmlSecGCryptHmacTemplatesNext >= XMLSEC_GCRYPT_HMAC_TEMPLATES_MAX_SIZE) {
+            gXmlSecGCryptHmacTemplatesNext = 0;
+        }
+        entry = &(gXmlSecGCryptHmacTemplates[gXmlSecGCryptHmacTemplatesNext++]);
+        xmlSecGCryptHmacTemplateFinalize(entry);
+    }
+    entry->digest  = digest;
+    entry->key     = keyCopy;
+    entry->keySize = keySize;
+    entry->tmpl    = tmpl;
+    return(0);
+}
+
+/**
+ * xmlSecGCryptSetHmacCtxCache:
+ * @enabled:            1 to enable the keyed HMAC contexts cache or
+ *                      0 to disable it.
+ *
+ * Enables or disables the cache of the keyed gcry_md_hd_t handles for the
+ * HMAC transforms. When enabled, the HMAC transforms that use the same key
+ * and digest copy the cached handle with gcry_md_copy() instead of opening
+ * a new handle and setting the key. The cache is small and keeps a copy of
+ * the most recently used keys until they are replaced or the cache is
+ * disabled. Disabling the cache removes (and clears) all the entries.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecGCryptSetHmacCtxCache(int enabled) {
+    if(gXmlSecGCryptTemplatesMutex == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_CRYPTO_FAILED, NULL, "cache is not initialized");
+        return(-1);
+    }
+
+    xmlMutexLock(gXmlSecGCryptTemplatesMutex);
+    gXmlSecGCryptHmacTemplatesEnabled = (enabled != 0) ? 1 : 0;
+    if(enabled == 0) {
+        xmlSecGCryptHmacTemplatesFlush();
+    }
+    xmlMutexUnlock(gXmlSecGCryptTemplatesMutex);
+    return(0);
+}
+
+/**
+ * xmlSecGCryptDigestContextCreate:
+ * @digestCtx:          the pointer to the result digest handle.
+ * @digest:             the digest algorithm (e.g. GCRY_MD_SHA256).
+ *
+ * Creates the digest handle for @digest by copying the cached
+ * template handle (the template is created on the first call).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecGCryptDigestContextCreate(gcry_md_hd_t* digestCtx, int digest) {
+    xmlSecGCryptDigestTemplate* entry;
+    gcry_md_hd_t tmpl = NULL;
+    gcry_error_t err;
+
+    xmlSecAssert2(digestCtx != NULL, -1);
+
+    (*digestCtx) = NULL;
+    if(gXmlSecGCryptTemplatesMutex != NULL) {
+        xmlMutexLock(gXmlSecGCryptTemplatesMutex);
+        entry = xmlSecGCryptDigestTemplatesFind(digest);
+        if((entry != NULL) && (gcry_md_copy(digestCtx, entry->tmpl) != GPG_ERR_NO_ERROR)) {
+            (*digestCtx) = NULL;
+        }
+        xmlMutexUnlock(gXmlSecGCryptTemplatesMutex);
+
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoAlgorithm, ((*digestCtx) != NULL) ? 1 : 0);
+        if((*digestCtx) != NULL) {
+            return(0);
+        }
+    }
+
+    /* create outside of the lock */
+    err = gcry_md_open(digestCtx, digest, GCRY_MD_FLAG_SECURE); /* we are paranoid */
+    if(err != GPG_ERR_NO_ERROR) {
+        xmlSecGCryptError("gcry_md_open", err, NULL);
+        (*digestCtx) = NULL;
+        return(-1);
+    }
+
+    /* not fatal if we can't cache it */
+    if((gXmlSecGCryptTemplatesMutex != NULL) && (gcry_md_copy(&tmpl, (*digestCtx)) == GPG_ERR_NO_ERROR)) {
+        xmlMutexLock(gXmlSecGCryptTemplatesMutex);
+        if((xmlSecGCryptDigestTemplatesFind(digest) == NULL) &&
+           (gXmlSecGCryptDigestTemplatesSize < XMLSEC_GCRYPT_DIGEST_TEMPLATES_MAX_SIZE)) {
+            gXmlSecGCryptDigestTemplates[gXmlSecGCryptDigestTemplatesSize].digest = digest;
+            gXmlSecGCryptDigestTemplates[gXmlSecGCryptDigestTemplatesSize].tmpl   = tmpl;
+            ++gXmlSecGCryptDigestTemplatesSize;
+            tmpl = NULL;
+        }
+        xmlMutexUnlock(gXmlSecGCryptTemplatesMutex);
+
+        if(tmpl != NULL) {
+            gcry_md_close(tmpl);
+        }
+    }
+    return(0);
+}
+
+/**
+ * xmlSecGCryptHmacContextCreate:
+ * @digestCtx:          the pointer to the result HMAC handle.
+ * @digest:             the digest algorithm (e.g. GCRY_MD_SHA256).
+ * @key:                the key.
+ * @keySize:            the key size.
+ *
+ * Creates the keyed HMAC handle for @digest and @key. If the cache
+ * is enabled (see #xmlSecGCryptSetHmacCtxCache) then the handle is copied
+ * from the cached template for the same digest and key.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecGCryptHmacContextCreate(gcry_md_hd_t* digestCtx, int digest, const xmlSecByte* key, xmlSecSize keySize) {
+    xmlSecGCryptHmacTemplate* entry;
+    gcry_md_hd_t tmpl = NULL;
+    gcry_error_t err;
+    int enabled = 0;
+    int ret;
+
+    xmlSecAssert2(digestCtx != NULL, -1);
+    xmlSecAssert2(key != NULL, -1);
+    xmlSecAssert2(keySize > 0, -1);
+
+    (*digestCtx) = NULL;
+    if((keySize <= XMLSEC_GCRYPT_HMAC_TEMPLATES_MAX_KEY_SIZE) && (gXmlSecGCryptTemplatesMutex != NULL)) {
+        xmlMutexLock(gXmlSecGCryptTemplatesMutex);
+        enabled = gXmlSecGCryptHmacTemplatesEnabled;
+        if(enabled != 0) {
+            entry = xmlSecGCryptHmacTemplatesFind(digest, key, keySize);
+            if((entry != NULL) && (gcry_md_copy(digestCtx, entry->tmpl) != GPG_ERR_NO_ERROR)) {
+                (*digestCtx) = NULL;
+            }
+        }
+        xmlMutexUnlock(gXmlSecGCryptTemplatesMutex);
+
+        if(enabled != 0) {
+            xmlSecStatsCacheLookup(xmlSecStatsCacheHmac, ((*digestCtx) != NULL) ? 1 : 0);
+        }
+        if((*digestCtx) != NULL) {
+            return(0);
+        }
+    }
+
+    /* create outside of the lock */
+    err = gcry_md_open(digestCtx, digest, GCRY_MD_FLAG_HMAC | GCRY_MD_FLAG_SECURE); /* we are paranoid */
+    if(err != GPG_ERR_NO_ERROR) {
+        xmlSecGCryptError("gcry_md_open", err, NULL);
+        (*digestCtx) = NULL;
+        return(-1);
+    }
+    err = gcry_md_setkey((*digestCtx), key, keySize);
+    if(err != GPG_ERR_NO_ERROR) {
+        xmlSecGCryptError("gcry_md_setkey", err, NULL);
+        gcry_md_close(*digestCtx);
+        (*digestCtx) = NULL;
+        return(-1);
+    }
+
+    /* not fatal if we can't cache it */
+    if((enabled != 0) && (gcry_md_copy(&tmpl, (*digestCtx)) == GPG_ERR_NO_ERROR)) {
+        xmlMutexLock(gXmlSecGCryptTemplatesMutex);
+        if((gXmlSecGCryptHmacTemplatesEnabled != 0) &&
+           (xmlSecGCryptHmacTemplatesFind(digest, key, keySize) == NULL)) {
+            ret = xmlSecGCryptHmacTemplatesAdd(digest, key, keySize, tmpl);
+            if(ret == 0) {
+                tmpl = NULL;
+            }
+        }
+        xmlMutexUnlock(gXmlSecGCryptTemplatesMutex);
+
+        if(tmpl != NULL) {
+            gcry_md_close(tmpl);
+        }
+    }
+    return(0);
+}
@@ -27,6 +27,7 @@
 #include <xmlsec/gcrypt/crypto.h>
 
 #include "../cast_helpers.h"
+#include "private.h"
 
 /**************************************************************************
  *
@@ -126,7 +127,7 @@ xmlSecGCryptDigestCheckId(xmlSecTransformPtr transform) {
 static int
 xmlSecGCryptDigestInitialize(xmlSecTransformPtr transform) {
     xmlSecGCryptDigestCtxPtr ctx;
-    gcry_error_t err;
+    int ret;
 
     xmlSecAssert2(xmlSecGCryptDigestCheckId(transform), -1);
     xmlSecAssert2(xmlSecTransformCheckSize(transform, xmlSecGCryptDigestSize), -1);
@@ -192,12 +193,16 @@ xmlSecGCryptDigestInitialize(xmlSecTransformPtr transform) {
     }
 
     /* create digest ctx */
-    err = gcry_md_open(&ctx->digestCtx, ctx->digest, GCRY_MD_FLAG_SECURE); /* we are paranoid */
-    if(err != GPG_ERR_NO_ERROR) {
-        xmlSecGCryptError("gcry_md_open", err,
-                          xmlSecTransformGetName(transform));
+    ret = xmlSecGCryptDigestContextCreate(&ctx->digestCtx, ctx->digest);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecGCryptDigestContextCreate",
+                            xmlSecTransformGetName(transform));
         return(-1);
     }
+
+    /* the digest only reads the input, no need to copy it */
+    transform->borrowInput = 1;
+
     return(0);
 }
 
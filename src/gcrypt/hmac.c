@@ -30,6 +30,7 @@
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 #include "../transform_helpers.h"
+#include "private.h"
 
 /**************************************************************************
  *
@@ -125,7 +126,6 @@ static int
 xmlSecGCryptHmacInitialize(xmlSecTransformPtr transform) {
     xmlSecGCryptHmacCtxPtr ctx;
     xmlSecSize hmacSize;
-    gcry_error_t err;
 
     xmlSecAssert2(xmlSecGCryptHmacCheckId(transform), -1);
     xmlSecAssert2(xmlSecTransformCheckSize(transform, xmlSecGCryptHmacSize), -1);
@@ -182,14 +182,7 @@ xmlSecGCryptHmacInitialize(xmlSecTransformPtr transform) {
     xmlSecAssert2(hmacSize <= XMLSEC_TRASNFORM_HMAC_MAX_OUTPUT_SIZE, -1);
     ctx->dgstSizeInBits = 8 * hmacSize;
 
-    /* open context */
-    err = gcry_md_open(&ctx->digestCtx, ctx->digest, GCRY_MD_FLAG_HMAC | GCRY_MD_FLAG_SECURE); /* we are paranoid */
-    if(err != GPG_ERR_NO_ERROR) {
-        xmlSecGCryptError("gcry_md_open", err,
-                          xmlSecTransformGetName(transform));
-        return(-1);
-    }
-
+    /* the context is created when the key is set */
     return(0);
 }
 
@@ -264,7 +257,7 @@ xmlSecGCryptHmacSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
     xmlSecGCryptHmacCtxPtr ctx;
     xmlSecKeyDataPtr value;
     xmlSecBufferPtr buffer;
-    gcry_error_t err;
+    int ret;
 
     xmlSecAssert2(xmlSecGCryptHmacCheckId(transform), -1);
     xmlSecAssert2((transform->operation == xmlSecTransformOperationSign) || (transform->operation == xmlSecTransformOperationVerify), -1);
@@ -273,7 +266,7 @@ xmlSecGCryptHmacSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
 
     ctx = xmlSecGCryptHmacGetCtx(transform);
     xmlSecAssert2(ctx != NULL, -1);
-    xmlSecAssert2(ctx->digestCtx != NULL, -1);
+    xmlSecAssert2(ctx->digestCtx == NULL, -1);
 
     value = xmlSecKeyGetValue(key);
     xmlSecAssert2(xmlSecKeyDataCheckId(value, xmlSecGCryptKeyDataHmacId), -1);
@@ -286,11 +279,11 @@ xmlSecGCryptHmacSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
         return(-1);
     }
 
-    err = gcry_md_setkey(ctx->digestCtx, xmlSecBufferGetData(buffer),
-                        xmlSecBufferGetSize(buffer));
-    if(err != GPG_ERR_NO_ERROR) {
-        xmlSecGCryptError("gcry_md_setkey", err,
-                          xmlSecTransformGetName(transform));
+    ret = xmlSecGCryptHmacContextCreate(&ctx->digestCtx, ctx->digest,
+        xmlSecBufferGetData(buffer), xmlSecBufferGetSize(buffer));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecGCryptHmacContextCreate",
+                            xmlSecTransformGetName(transform));
         return(-1);
     }
     return(0);
@@ -52,6 +52,8 @@ static xmlSecKWAesKlass xmlSecGCryptKWAesKlass = {
     /* callbacks */
     xmlSecGCryptKWAesBlockEncrypt,          /* xmlSecKWAesBlockEncryptMethod       encrypt; */
     xmlSecGCryptKWAesBlockDecrypt,          /* xmlSecKWAesBlockDecryptMethod       decrypt; */
+    NULL,                                   /* xmlSecKWAesBlocksEncryptMethod      encryptBlocks; */
+    NULL,                                   /* xmlSecKWAesBlocksDecryptMethod      decryptBlocks; */
 
     /* for the future */
     NULL,                                   /* void*                               reserved0; */
@@ -0,0 +1,44 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * THIS IS A PRIVATE XMLSEC HEADER FILE
+ * DON'T USE IT IN YOUR APPLICATION
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_GCRYPT_PRIVATE_H__
+#define __XMLSEC_GCRYPT_PRIVATE_H__
+
+#ifndef XMLSEC_PRIVATE
+#error "gcrypt/private.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <gcrypt.h>
+
+#include <xmlsec/exports.h>
+#include <xmlsec/xmlsec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/******************************************************************************
+ *
+ * Template contexts
+ *
+ ******************************************************************************/
+int                 xmlSecGCryptDigestContextCreate         (gcry_md_hd_t* digestCtx,
+                                                             int digest);
+int                 xmlSecGCryptHmacContextCreate           (gcry_md_hd_t* digestCtx,
+                                                             int digest,
+                                                             const xmlSecByte* key,
+                                                             xmlSecSize keySize);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XMLSEC_GCRYPT_PRIVATE_H__ */
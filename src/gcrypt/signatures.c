@@ -828,7 +828,6 @@ static int
 xmlSecGCryptDsaSign(int digest ATTRIBUTE_UNUSED, xmlSecKeyDataPtr key_data,
                       const xmlSecByte* dgst, xmlSecSize dgstSize,
                       xmlSecBufferPtr out) {
-    gcry_mpi_t m_hash = NULL;
     gcry_sexp_t s_data = NULL;
     gcry_sexp_t s_sig = NULL;
     gcry_sexp_t s_r = NULL;
@@ -838,6 +837,7 @@ xmlSecGCryptDsaSign(int digest ATTRIBUTE_UNUSED, xmlSecKeyDataPtr key_data,
     gcry_sexp_t s_key;
     gcry_sexp_t s_tmp;
     gpg_error_t err;
+    int dgstLen;
     int ret;
     int res = -1;
 
@@ -850,16 +850,11 @@ xmlSecGCryptDsaSign(int digest ATTRIBUTE_UNUSED, xmlSecKeyDataPtr key_data,
     xmlSecAssert2(s_key != NULL, -1);
 
     /* get the current digest, can't use "hash" :( */
-    err = gcry_mpi_scan(&m_hash, GCRYMPI_FMT_USG, dgst, dgstSize, NULL);
-    if((err != GPG_ERR_NO_ERROR) || (m_hash == NULL)) {
-        xmlSecGCryptError("gcry_mpi_scan(hash)", err, NULL);
-        goto done;
-    }
-
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(dgstSize, dgstLen, goto done, NULL);
     err = gcry_sexp_build (&s_data, NULL,
                            "(data (flags raw)"
-                           "(value %m))",
-                           m_hash);
+                           "(value %b))",
+                           dgstLen, dgst);
     if((err != GPG_ERR_NO_ERROR) || (s_data == NULL)) {
         xmlSecGCryptError("gcry_sexp_build(data)", err, NULL);
         goto done;
@@ -934,9 +929,6 @@ xmlSecGCryptDsaSign(int digest ATTRIBUTE_UNUSED, xmlSecKeyDataPtr key_data,
     res = 0;
 
 done:
-    if(m_hash != NULL) {
-        gcry_mpi_release(m_hash);
-    }
     if(m_r != NULL) {
         gcry_mpi_release(m_r);
     }
@@ -964,13 +956,11 @@ static int
 xmlSecGCryptDsaVerify(int digest ATTRIBUTE_UNUSED, xmlSecKeyDataPtr key_data,
                         const xmlSecByte* dgst, xmlSecSize dgstSize,
                         const xmlSecByte* data, xmlSecSize dataSize) {
-    gcry_mpi_t m_hash = NULL;
     gcry_sexp_t s_data = NULL;
-    gcry_mpi_t m_sig_r = NULL;
-    gcry_mpi_t m_sig_s = NULL;
     gcry_sexp_t s_sig = NULL;
     gcry_sexp_t s_key;
     gpg_error_t err;
+    int dgstLen;
     int res = -1;
 
     xmlSecAssert2(key_data != NULL, -1);
@@ -983,36 +973,21 @@ xmlSecGCryptDsaVerify(int digest ATTRIBUTE_UNUSED, xmlSecKeyDataPtr key_data,
     xmlSecAssert2(s_key != NULL, -1);
 
     /* get the current digest, can't use "hash" :( */
-    err = gcry_mpi_scan(&m_hash, GCRYMPI_FMT_USG, dgst, dgstSize, NULL);
-    if((err != GPG_ERR_NO_ERROR) || (m_hash == NULL)) {
-        xmlSecGCryptError("gcry_mpi_scan(hash)", err, NULL);
-        goto done;
-    }
-
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(dgstSize, dgstLen, goto done, NULL);
     err = gcry_sexp_build (&s_data, NULL,
                            "(data (flags raw)"
-                           "(value %m))",
-                           m_hash);
+                           "(value %b))",
+                           dgstLen, dgst);
     if((err != GPG_ERR_NO_ERROR) || (s_data == NULL)) {
         xmlSecGCryptError("gcry_sexp_build(data)", err, NULL);
         goto done;
     }
 
-    /* get the existing signature */
-    err = gcry_mpi_scan(&m_sig_r, GCRYMPI_FMT_USG, data, XMLSEC_GCRYPT_DSA_SIG_SIZE, NULL);
-    if((err != GPG_ERR_NO_ERROR) || (m_sig_r == NULL)) {
-        xmlSecGCryptError("gcry_mpi_scan(r)", err, NULL);
-        goto done;
-    }
-    err = gcry_mpi_scan(&m_sig_s, GCRYMPI_FMT_USG, data + XMLSEC_GCRYPT_DSA_SIG_SIZE, XMLSEC_GCRYPT_DSA_SIG_SIZE, NULL);
-    if((err != GPG_ERR_NO_ERROR) || (m_sig_s == NULL)) {
-        xmlSecGCryptError("gcry_mpi_scan(s)", err, NULL);
-        goto done;
-    }
-
+    /* get the existing signature (the values are read as unsigned integers) */
     err = gcry_sexp_build (&s_sig, NULL,
-                           "(sig-val(dsa(r %m)(s %m)))",
-                           m_sig_r, m_sig_s);
+                           "(sig-val(dsa(r %b)(s %b)))",
+                           (int)XMLSEC_GCRYPT_DSA_SIG_SIZE, data,
+                           (int)XMLSEC_GCRYPT_DSA_SIG_SIZE, data + XMLSEC_GCRYPT_DSA_SIG_SIZE);
     if((err != GPG_ERR_NO_ERROR) || (s_sig == NULL)) {
         xmlSecGCryptError("gcry_sexp_build(sig-val)", err, NULL);
         goto done;
@@ -1031,16 +1006,6 @@ xmlSecGCryptDsaVerify(int digest ATTRIBUTE_UNUSED, xmlSecKeyDataPtr key_data,
 
     /* done */
 done:
-    if(m_hash != NULL) {
-        gcry_mpi_release(m_hash);
-    }
-    if(m_sig_r != NULL) {
-        gcry_mpi_release(m_sig_r);
-    }
-    if(m_sig_s != NULL) {
-        gcry_mpi_release(m_sig_s);
-    }
-
     if(s_data != NULL) {
         gcry_sexp_release(s_data);
     }
@@ -1233,11 +1198,11 @@ xmlSecGCryptRsaPkcs1Verify(int digest, xmlSecKeyDataPtr key_data,
                              const xmlSecByte* dgst, xmlSecSize dgstSize,
                              const xmlSecByte* data, xmlSecSize dataSize) {
     gcry_sexp_t s_data = NULL;
-    gcry_mpi_t m_sig = NULL;
     gcry_sexp_t s_sig = NULL;
     gcry_sexp_t s_key;
     gpg_error_t err;
     int dgstLen;
+    int dataLen;
     int res = -1;
 
     xmlSecAssert2(key_data != NULL, -1);
@@ -1260,16 +1225,11 @@ xmlSecGCryptRsaPkcs1Verify(int digest, xmlSecKeyDataPtr key_data,
         goto done;
     }
 
-    /* get the existing signature */
-    err = gcry_mpi_scan(&m_sig, GCRYMPI_FMT_USG, data, dataSize, NULL);
-    if((err != GPG_ERR_NO_ERROR) || (m_sig == NULL)) {
-        xmlSecGCryptError("gcry_mpi_scan", err, NULL);
-        goto done;
-    }
-
+    /* get the existing signature (the value is read as unsigned integer) */
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(dataSize, dataLen, goto done, NULL);
     err = gcry_sexp_build (&s_sig, NULL,
-                           "(sig-val(rsa(s %m)))",
-                           m_sig);
+                           "(sig-val(rsa(s %b)))",
+                           dataLen, data);
     if((err != GPG_ERR_NO_ERROR) || (s_sig == NULL)) {
         xmlSecGCryptError("gcry_sexp_build(sig-val)", err, NULL);
         goto done;
@@ -1288,10 +1248,6 @@ xmlSecGCryptRsaPkcs1Verify(int digest, xmlSecKeyDataPtr key_data,
 
     /* done */
 done:
-    if(m_sig != NULL) {
-        gcry_mpi_release(m_sig);
-    }
-
     if(s_data != NULL) {
         gcry_sexp_release(s_data);
     }
@@ -1412,11 +1368,11 @@ xmlSecGCryptRsaPssVerify(int digest, xmlSecKeyDataPtr key_data,
                              const xmlSecByte* dgst, xmlSecSize dgstSize,
                              const xmlSecByte* data, xmlSecSize dataSize) {
     gcry_sexp_t s_data = NULL;
-    gcry_mpi_t m_sig = NULL;
     gcry_sexp_t s_sig = NULL;
     gcry_sexp_t s_key;
     gpg_error_t err;
     int dgstLen;
+    int dataLen;
     int res = -1;
 
     xmlSecAssert2(key_data != NULL, -1);
@@ -1442,16 +1398,11 @@ xmlSecGCryptRsaPssVerify(int digest, xmlSecKeyDataPtr key_data,
         goto done;
     }
 
-    /* get the existing signature */
-    err = gcry_mpi_scan(&m_sig, GCRYMPI_FMT_USG, data, dataSize, NULL);
-    if((err != GPG_ERR_NO_ERROR) || (m_sig == NULL)) {
-        xmlSecGCryptError("gcry_mpi_scan", err, NULL);
-        goto done;
-    }
-
+    /* get the existing signature (the value is read as unsigned integer) */
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(dataSize, dataLen, goto done, NULL);
     err = gcry_sexp_build (&s_sig, NULL,
-                           "(sig-val(rsa(s %m)))",
-                           m_sig);
+                           "(sig-val(rsa(s %b)))",
+                           dataLen, data);
     if((err != GPG_ERR_NO_ERROR) || (s_sig == NULL)) {
         xmlSecGCryptError("gcry_sexp_build(sig-val)", err, NULL);
         goto done;
@@ -1470,10 +1421,6 @@ xmlSecGCryptRsaPssVerify(int digest, xmlSecKeyDataPtr key_data,
 
     /* done */
 done:
-    if(m_sig != NULL) {
-        gcry_mpi_release(m_sig);
-    }
-
     if(s_data != NULL) {
         gcry_sexp_release(s_data);
     }
@@ -2265,13 +2212,12 @@ xmlSecGCryptEcdsaVerify(int digest, xmlSecKeyDataPtr key_data,
 {
     gcry_mpi_t m_hash = NULL;
     gcry_sexp_t s_data = NULL;
-    gcry_mpi_t m_sig_r = NULL;
-    gcry_mpi_t m_sig_s = NULL;
     gcry_sexp_t s_sig = NULL;
     gcry_sexp_t s_key;
     const char * algo_name;
     xmlSecSize keySize;
     gpg_error_t err;
+    int keyLen;
     int res = -1;
 
     xmlSecAssert2(key_data != NULL, -1);
@@ -2316,21 +2262,12 @@ xmlSecGCryptEcdsaVerify(int digest, xmlSecKeyDataPtr key_data,
         goto done;
     }
 
-    /* get the existing signature */
-    err = gcry_mpi_scan(&m_sig_r, GCRYMPI_FMT_USG, data, keySize, NULL);
-    if((err != GPG_ERR_NO_ERROR) || (m_sig_r == NULL)) {
-        xmlSecGCryptError("gcry_mpi_scan(r)", err, NULL);
-        goto done;
-    }
-    err = gcry_mpi_scan(&m_sig_s, GCRYMPI_FMT_USG, data + keySize, keySize, NULL);
-    if((err != GPG_ERR_NO_ERROR) || (m_sig_s == NULL)) {
-        xmlSecGCryptError("gcry_mpi_scan(s)", err, NULL);
-        goto done;
-    }
-
+    /* get the existing signature (the values are read as unsigned integers) */
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(keySize, keyLen, goto done, NULL);
     err = gcry_sexp_build (&s_sig, NULL,
-                           "(sig-val(ecdsa(r %m)(s %m)))",
-                           m_sig_r, m_sig_s);
+                           "(sig-val(ecdsa(r %b)(s %b)))",
+                           keyLen, data,
+                           keyLen, data + keySize);
     if((err != GPG_ERR_NO_ERROR) || (s_sig == NULL)) {
         xmlSecGCryptError("gcry_sexp_build(sig-val)", err, NULL);
         goto done;
@@ -2352,12 +2289,6 @@ done:
     if(m_hash != NULL) {
         gcry_mpi_release(m_hash);
     }
-    if(m_sig_r != NULL) {
-        gcry_mpi_release(m_sig_r);
-    }
-    if(m_sig_s != NULL) {
-        gcry_mpi_release(m_sig_s);
-    }
 
     if(s_data != NULL) {
         gcry_sexp_release(s_data);
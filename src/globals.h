@@ -22,6 +22,15 @@
 #define IN_XMLSEC
 #define XMLSEC_PRIVATE
 
+/* Thread local variables (not defined if the compiler does not support them). */
+#if defined(_MSC_VER)
+#define XMLSEC_THREAD_LOCAL                     __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define XMLSEC_THREAD_LOCAL                     __thread
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_THREADS__)
+#define XMLSEC_THREAD_LOCAL                     _Thread_local
+#endif
+
 /* Include common error helper macros. */
 #include "errors_helpers.h"
 
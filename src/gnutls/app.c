@@ -34,6 +34,7 @@
 #include <xmlsec/gnutls/x509.h>
 
 #include "../cast_helpers.h"
+#include "../keysdata_helpers.h"
 #include "private.h"
 
 
@@ -964,6 +965,38 @@ xmlSecGnuTLSAppKeysMngrCrlLoadMemory(xmlSecKeysMngrPtr mngr,
     return(0);
 }
 
+/**
+ * xmlSecGnuTLSAppKeysMngrEnableX509VerifyCache:
+ * @mngr:               the keys manager.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables the cache of the successful certificates verification results
+ * in the X509 store of @mngr (see #xmlSecGnuTLSX509StoreEnableVerifyCache).
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecGnuTLSAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize) {
+    xmlSecKeyDataStorePtr x509Store;
+    int ret;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    x509Store = xmlSecKeysMngrGetDataStore(mngr, xmlSecGnuTLSX509StoreId);
+    if(x509Store == NULL) {
+        xmlSecInternalError("xmlSecKeysMngrGetDataStore(xmlSecGnuTLSX509StoreId)", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecGnuTLSX509StoreEnableVerifyCache(x509Store, maxSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecGnuTLSX509StoreEnableVerifyCache", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
 
 #endif /* XMLSEC_NO_X509 */
 
@@ -1041,6 +1074,9 @@ xmlSecGnuTLSAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key)
         return(-1);
     }
 
+    /* the new key might be one of the recently not found keys */
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
+
     return(0);
 }
 
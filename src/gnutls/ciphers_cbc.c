@@ -27,11 +27,14 @@
 
 #include <xmlsec/gnutls/crypto.h>
 
+#include "private.h"
 #include "../cast_helpers.h"
 #include "../kw_aes_des.h"
+#include "../transform_helpers.h"
 
 #define XMLSEC_GNUTLS_CBC_CIPHER_MAX_BLOCK_SIZE             32
 #define XMLSEC_GNUTLS_CBC_CIPHER_MAX_IV_SIZE                32
+#define XMLSEC_GNUTLS_CBC_CIPHER_MAX_KEY_SIZE               32
 #define XMLSEC_GNUTLS_CBC_CIPHER_PAD_SIZE                   (2 * XMLSEC_GNUTLS_CBC_CIPHER_MAX_BLOCK_SIZE)
 
 /**************************************************************************
@@ -50,6 +53,7 @@ struct _xmlSecGnuTLSCbcCipherCtx {
 
     gnutls_cipher_hd_t          cipher;
     int                         ctxInitialized;
+    xmlSecByte                  key[XMLSEC_GNUTLS_CBC_CIPHER_MAX_KEY_SIZE];
     xmlSecByte                  iv[XMLSEC_GNUTLS_CBC_CIPHER_MAX_IV_SIZE];
     xmlSecByte                  pad[XMLSEC_GNUTLS_CBC_CIPHER_PAD_SIZE];
 };
@@ -69,12 +73,14 @@ static int      xmlSecGnuTLSCbcCipherCtxUpdate      (xmlSecGnuTLSCbcCipherCtxPtr
                                                      xmlSecBufferPtr in,
                                                      xmlSecBufferPtr out,
                                                      int encrypt,
-                                                     const xmlChar* cipherName);
+                                                     const xmlChar* cipherName,
+                                                     xmlSecTransformCtxPtr transformCtx);
 static int      xmlSecGnuTLSCbcCipherCtxFinal       (xmlSecGnuTLSCbcCipherCtxPtr ctx,
                                                      xmlSecBufferPtr in,
                                                      xmlSecBufferPtr out,
                                                      int encrypt,
-                                                     const xmlChar* cipherName);
+                                                     const xmlChar* cipherName,
+                                                     xmlSecTransformCtxPtr transformCtx);
 
 static int
 xmlSecGnuTLSCbcCipherCtxInit(xmlSecGnuTLSCbcCipherCtxPtr ctx, xmlSecBufferPtr in,
@@ -181,9 +187,74 @@ xmlSecGnuTLSCbcCipherCtxUpdateBlock(xmlSecGnuTLSCbcCipherCtxPtr ctx, const xmlSe
     return (0);
 }
 
+/* decrypts one segment of the CBC ciphertext with its own cipher context
+ * (called from the executor threads, see xmlSecTransformCbcDecryptParallel()) */
+static int
+xmlSecGnuTLSCbcCipherDecryptSegment(void* cipherCtx, const xmlSecByte* iv,
+    const xmlSecByte* in, xmlSecSize inSize, xmlSecByte* out)
+{
+    xmlSecGnuTLSCbcCipherCtxPtr ctx = (xmlSecGnuTLSCbcCipherCtxPtr)cipherCtx;
+    xmlSecByte segmentIv[XMLSEC_GNUTLS_CBC_CIPHER_MAX_IV_SIZE];
+    gnutls_cipher_hd_t cipher;
+    int err;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->keySize > 0, -1);
+    xmlSecAssert2(ctx->ivSize <= sizeof(segmentIv), -1);
+    xmlSecAssert2(iv != NULL, -1);
+    xmlSecAssert2(in != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    cipher = xmlSecGnuTLSCipherCtxAcquire(ctx->algorithm, ctx->key, ctx->keySize);
+    if(cipher == NULL) {
+        xmlSecInternalError("xmlSecGnuTLSCipherCtxAcquire", NULL);
+        return(-1);
+    }
+    memcpy(segmentIv, iv, ctx->ivSize);
+    gnutls_cipher_set_iv(cipher, segmentIv, ctx->ivSize);
+
+    err = gnutls_cipher_decrypt2(cipher, in, inSize, out, inSize);
+    xmlSecGnuTLSCipherCtxRelease(cipher);
+    if(err != GNUTLS_E_SUCCESS) {
+        xmlSecGnuTLSError("gnutls_cipher_decrypt2", err, NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* decrypts the buffered CBC ciphertext on the executor and continues
+ * the ctx->cipher decryption from the new iv */
+static int
+xmlSecGnuTLSCbcCipherCtxParallel(xmlSecGnuTLSCbcCipherCtxPtr ctx, xmlSecBufferPtr in,
+    xmlSecBufferPtr out, const xmlChar* cipherName, xmlSecTransformCtxPtr transformCtx,
+    int last)
+{
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->cipher != NULL, -1);
+    xmlSecAssert2(ctx->blockSize > 0, -1);
+    xmlSecAssert2(ctx->ivSize == ctx->blockSize, -1);
+
+    ret = xmlSecTransformCbcDecryptParallel(transformCtx, xmlSecGnuTLSCbcCipherDecryptSegment,
+        ctx, ctx->iv, ctx->blockSize, in, out, last);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCbcDecryptParallel", xmlSecErrorsSafeString(cipherName));
+        return(-1);
+    } else if(ret == 0) {
+        /* wait for more data */
+        return(0);
+    }
+
+    /* the final block is decrypted with ctx->cipher */
+    gnutls_cipher_set_iv(ctx->cipher, ctx->iv, ctx->ivSize);
+    return(0);
+}
+
 static int
 xmlSecGnuTLSCbcCipherCtxUpdate(xmlSecGnuTLSCbcCipherCtxPtr ctx, xmlSecBufferPtr in,
-    xmlSecBufferPtr out, int encrypt, const xmlChar* cipherName)
+    xmlSecBufferPtr out, int encrypt, const xmlChar* cipherName,
+    xmlSecTransformCtxPtr transformCtx)
 {
     xmlSecSize inSize, inBlocksSize;
     xmlSecByte* inBuf;
@@ -196,6 +267,10 @@ xmlSecGnuTLSCbcCipherCtxUpdate(xmlSecGnuTLSCbcCipherCtxPtr ctx, xmlSecBufferPtr
     xmlSecAssert2(in != NULL, -1);
     xmlSecAssert2(out != NULL, -1);
 
+    if((encrypt == 0) && (xmlSecTransformCbcDecryptIsParallel(transformCtx) != 0)) {
+        return(xmlSecGnuTLSCbcCipherCtxParallel(ctx, in, out, cipherName, transformCtx, 0)); /* not final */
+    }
+
     /* The total amount of data encrypted or decrypted must then be a multiple of the block size or an error will occur.
      * We process all complete blocks from the input
      */
@@ -235,7 +310,8 @@ xmlSecGnuTLSCbcCipherCtxUpdate(xmlSecGnuTLSCbcCipherCtxPtr ctx, xmlSecBufferPtr
 
 static int
 xmlSecGnuTLSCbcCipherCtxFinal(xmlSecGnuTLSCbcCipherCtxPtr ctx, xmlSecBufferPtr in,
-    xmlSecBufferPtr out, int encrypt, const xmlChar* cipherName)
+    xmlSecBufferPtr out, int encrypt, const xmlChar* cipherName,
+    xmlSecTransformCtxPtr transformCtx)
 {
     xmlSecSize inSize, padSize, outSize;
     xmlSecByte* inBuf;
@@ -250,6 +326,15 @@ xmlSecGnuTLSCbcCipherCtxFinal(xmlSecGnuTLSCbcCipherCtxPtr ctx, xmlSecBufferPtr i
     xmlSecAssert2(in != NULL, -1);
     xmlSecAssert2(out != NULL, -1);
 
+    /* decrypt the rest of the buffered data but the last block */
+    if((encrypt == 0) && (xmlSecTransformCbcDecryptIsParallel(transformCtx) != 0)) {
+        ret = xmlSecGnuTLSCbcCipherCtxParallel(ctx, in, out, cipherName, transformCtx, 1); /* final */
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecGnuTLSCbcCipherCtxParallel", xmlSecErrorsSafeString(cipherName));
+            return(-1);
+        }
+    }
+
     /* not more than one block left */
     inBuf = xmlSecBufferGetData(in);
     xmlSecAssert2(inBuf != NULL, -1);
@@ -455,7 +540,7 @@ xmlSecGnuTLSCbcCipherFinalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     if(ctx->cipher != NULL) {
-        gnutls_cipher_deinit(ctx->cipher);
+        xmlSecGnuTLSCipherCtxRelease(ctx->cipher);
     }
     memset(ctx, 0, sizeof(xmlSecGnuTLSCbcCipherCtx));
 }
@@ -493,8 +578,6 @@ xmlSecGnuTLSCbcCipherSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
     xmlSecKeyDataPtr keyData;
     xmlSecBufferPtr keyBuf;
     xmlSecSize keySize;
-    gnutls_datum_t gnutlsKey;
-    int err;
 
     xmlSecAssert2(xmlSecGnuTLSCbcCipherCheckId(transform), -1);
     xmlSecAssert2((transform->operation == xmlSecTransformOperationEncrypt) || (transform->operation == xmlSecTransformOperationDecrypt), -1);
@@ -520,14 +603,16 @@ xmlSecGnuTLSCbcCipherSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
     }
     keySize = ctx->keySize;
 
-    gnutlsKey.data = xmlSecBufferGetData(keyBuf);
-    XMLSEC_SAFE_CAST_SIZE_TO_UINT(keySize, gnutlsKey.size, return(-1), xmlSecTransformGetName(transform));
-    xmlSecAssert2(gnutlsKey.data != NULL, -1);
+    xmlSecAssert2(xmlSecBufferGetData(keyBuf) != NULL, -1);
+    xmlSecAssert2(keySize <= sizeof(ctx->key), -1);
+
+    /* the key is also used by the parallel decryption segments */
+    memcpy(ctx->key, xmlSecBufferGetData(keyBuf), keySize);
 
     /* we will set IV later */
-    err = gnutls_cipher_init(&(ctx->cipher), ctx->algorithm, &gnutlsKey, NULL);
-    if(err != GNUTLS_E_SUCCESS) {
-        xmlSecGnuTLSError("gnutls_cipher_init", err, xmlSecTransformGetName(transform));
+    ctx->cipher = xmlSecGnuTLSCipherCtxAcquire(ctx->algorithm, xmlSecBufferGetData(keyBuf), keySize);
+    if(ctx->cipher == NULL) {
+        xmlSecInternalError("xmlSecGnuTLSCipherCtxAcquire", xmlSecTransformGetName(transform));
         return(-1);
     }
 
@@ -576,7 +661,8 @@ xmlSecGnuTLSCbcCipherExecute(xmlSecTransformPtr transform, int last, xmlSecTrans
         }
 
         if(ctx->ctxInitialized != 0) {
-            ret = xmlSecGnuTLSCbcCipherCtxUpdate(ctx, in, out, encrypt, xmlSecTransformGetName(transform));
+            ret = xmlSecGnuTLSCbcCipherCtxUpdate(ctx, in, out, encrypt, xmlSecTransformGetName(transform),
+                transformCtx);
             if(ret < 0) {
                 xmlSecInternalError("xmlSecGnuTLSCbcCipherCtxUpdate", xmlSecTransformGetName(transform));
                 return(-1);
@@ -584,7 +670,8 @@ xmlSecGnuTLSCbcCipherExecute(xmlSecTransformPtr transform, int last, xmlSecTrans
         }
 
         if(last != 0) {
-            ret = xmlSecGnuTLSCbcCipherCtxFinal(ctx, in, out, encrypt, xmlSecTransformGetName(transform));
+            ret = xmlSecGnuTLSCbcCipherCtxFinal(ctx, in, out, encrypt, xmlSecTransformGetName(transform),
+                transformCtx);
             if(ret < 0) {
                 xmlSecInternalError("xmlSecGnuTLSCbcCipherCtxFinal", xmlSecTransformGetName(transform));
                 return(-1);
@@ -35,7 +35,6 @@
  * For the purposes of this specification, AES-GCM shall be used with
  * a 96 bit Initialization Vector (IV) and a 128 bit Authentication Tag (T).
  */
-#define XMLSEC_GNUTLS_GCM_CIPHER_MAX_BLOCK_SIZE             32
 #define XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE                    12
 #define XMLSEC_GNUTLS_GCM_CIPHER_TAG_SIZE                   16
 
@@ -217,11 +216,13 @@ xmlSecGnuTLSGcmCipherSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
     return(0);
 }
 
+/* encrypts in place inside @in and hands the buffer over to @out */
 static int
 xmlSecGnuTLSGcmCipherEncrypt(xmlSecGnuTLSGcmCipherCtxPtr ctx, xmlSecBufferPtr in, xmlSecBufferPtr out) {
+    xmlSecByte iv[XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE];
     xmlSecSize inSize, outSize;
     size_t outSizeT;
-    xmlSecByte *plaintext, *iv, *outData;
+    xmlSecByte *data;
     int ret;
     int err;
 
@@ -229,61 +230,67 @@ xmlSecGnuTLSGcmCipherEncrypt(xmlSecGnuTLSGcmCipherCtxPtr ctx, xmlSecBufferPtr in
     xmlSecAssert2(ctx->cipher != NULL, -1);
     xmlSecAssert2(in != NULL, -1);
     xmlSecAssert2(out != NULL, -1);
+    xmlSecAssert2(xmlSecBufferGetSize(out) == 0, -1);
 
     inSize = xmlSecBufferGetSize(in);
     xmlSecAssert2(inSize > XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE, -1);
 
-    plaintext = xmlSecBufferGetData(in);
-    xmlSecAssert2(plaintext != NULL, -1);
-
-    /* output is at most same as input + iv + tag + at most a couple blocks */
-    outSize = XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE + inSize + XMLSEC_GNUTLS_GCM_CIPHER_TAG_SIZE + 2 * XMLSEC_GNUTLS_GCM_CIPHER_MAX_BLOCK_SIZE;
-    ret = xmlSecBufferSetMaxSize(out, outSize);
+    /* the ciphertext has the same size as the plaintext followed by the tag */
+    outSize = inSize + XMLSEC_GNUTLS_GCM_CIPHER_TAG_SIZE;
+    ret = xmlSecBufferSetMaxSize(in, outSize);
     if(ret < 0) {
         xmlSecInternalError2("xmlSecBufferSetMaxSize", NULL, "size=" XMLSEC_SIZE_FMT, outSize);
         return(-1);
     }
+    data = xmlSecBufferGetData(in);
+    xmlSecAssert2(data != NULL, -1);
+    outSizeT = outSize;
 
-    /* generate random iv prepended to the output data */
-    iv = xmlSecBufferGetData(out);
-    xmlSecAssert2(iv != NULL, -1);
-    err = gnutls_rnd(GNUTLS_RND_KEY, iv, XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE);
+    /* generate random iv */
+    err = gnutls_rnd(GNUTLS_RND_KEY, iv, sizeof(iv));
     if(err != GNUTLS_E_SUCCESS) {
         xmlSecGnuTLSError("gnutls_rnd", err, NULL);
         return(-1);
     }
-    outData = iv + XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE;
-    outSizeT = outSize - XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE;
 
     /* encrypt */
     err = gnutls_aead_cipher_encrypt(ctx->cipher,
-        iv, XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE,
+        iv, sizeof(iv),
         NULL, 0,  /* no additional auth data */
         XMLSEC_GNUTLS_GCM_CIPHER_TAG_SIZE,
-        plaintext, inSize,
-        outData, &outSizeT);
+        data, inSize,
+        data, &outSizeT);
     if(err != GNUTLS_E_SUCCESS) {
         xmlSecGnuTLSError("gnutls_aead_cipher_encrypt", err, NULL);
         return(-1);
     }
 
-    /* set correct output size */
+    /* set correct output size and prepend the iv */
     XMLSEC_SAFE_CAST_SIZE_T_TO_SIZE(outSizeT, outSize, return(-1), NULL);
-    ret = xmlSecBufferSetSize(out, outSize + XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE);
+    ret = xmlSecBufferSetSize(in, outSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetSize", NULL, "size=" XMLSEC_SIZE_FMT, outSize);
+        return(-1);
+    }
+    ret = xmlSecBufferPrepend(in, iv, sizeof(iv));
     if(ret < 0) {
-        xmlSecInternalError2("xmlSecBufferSetSize", NULL, "size=" XMLSEC_SIZE_FMT, (outSize + XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE));
+        xmlSecInternalError("xmlSecBufferPrepend", NULL);
         return(-1);
     }
 
+    /* the input buffer becomes the output */
+    xmlSecBufferSwap(in, out);
+
     /* success */
     return(0);
 }
 
+/* decrypts in place inside @in and hands the buffer over to @out */
 static int
 xmlSecGnuTLSGcmCipherDecrypt(xmlSecGnuTLSGcmCipherCtxPtr ctx, xmlSecBufferPtr in, xmlSecBufferPtr out) {
     xmlSecSize inSize, outSize;
     size_t outSizeT;
-    xmlSecByte *iv, *ciphertext, *outData;
+    xmlSecByte *iv, *ciphertext;
     int ret;
     int err;
 
@@ -291,6 +298,7 @@ xmlSecGnuTLSGcmCipherDecrypt(xmlSecGnuTLSGcmCipherCtxPtr ctx, xmlSecBufferPtr in
     xmlSecAssert2(ctx->cipher != NULL, -1);
     xmlSecAssert2(in != NULL, -1);
     xmlSecAssert2(out != NULL, -1);
+    xmlSecAssert2(xmlSecBufferGetSize(out) == 0, -1);
 
     /* iv is prepended */
     inSize = xmlSecBufferGetSize(in);
@@ -302,34 +310,34 @@ xmlSecGnuTLSGcmCipherDecrypt(xmlSecGnuTLSGcmCipherCtxPtr ctx, xmlSecBufferPtr in
     inSize -= XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE;
 
     /* output is at most same as input */
-    ret = xmlSecBufferSetMaxSize(out, inSize);
-    if(ret < 0) {
-        xmlSecInternalError2("xmlSecBufferSetMaxSize", NULL, "size=" XMLSEC_SIZE_FMT, inSize);
-        return(-1);
-    }
-    outData = xmlSecBufferGetData(out);
-    xmlSecAssert2(outData != NULL, -1);
     outSizeT = inSize;
-
     err = gnutls_aead_cipher_decrypt(ctx->cipher,
         iv, XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE,
         NULL, 0,  /* no additional auth data */
         XMLSEC_GNUTLS_GCM_CIPHER_TAG_SIZE,
         ciphertext, inSize,
-        outData, &outSizeT);
+        ciphertext, &outSizeT);
     if(err != GNUTLS_E_SUCCESS) {
         xmlSecGnuTLSError("gnutls_aead_cipher_decrypt", err, NULL);
         return(-1);
     }
 
-    /* set correct output size */
+    /* skip the iv (the data is not moved) and set correct output size */
     XMLSEC_SAFE_CAST_SIZE_T_TO_SIZE(outSizeT, outSize, return(-1), NULL);
-    ret = xmlSecBufferSetSize(out, outSize);
+    ret = xmlSecBufferRemoveHead(in, XMLSEC_GNUTLS_GCM_CIPHER_IV_SIZE);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferRemoveHead", NULL);
+        return(-1);
+    }
+    ret = xmlSecBufferSetSize(in, outSize);
     if(ret < 0) {
         xmlSecInternalError2("xmlSecBufferSetSize", NULL, "size=" XMLSEC_SIZE_FMT, outSize);
         return(-1);
     }
 
+    /* the input buffer becomes the output */
+    xmlSecBufferSwap(in, out);
+
     /* success */
     return(0);
 }
@@ -22,6 +22,8 @@
 #include <gnutls/abstract.h>
 #include <gnutls/crypto.h>
 
+#include <libxml/threads.h>
+
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
@@ -29,11 +31,18 @@
 #include <xmlsec/errors.h>
 #include <xmlsec/dl.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 
 #include <xmlsec/gnutls/app.h>
 #include <xmlsec/gnutls/crypto.h>
 #include <xmlsec/gnutls/x509.h>
 
+#include "private.h"
+#include "../cast_helpers.h"
+
+static int              xmlSecGnuTLSCtxPoolsInit                (void);
+static void             xmlSecGnuTLSCtxPoolsShutdown            (void);
+
 static xmlSecCryptoDLFunctionsPtr gXmlSecGnuTLSFunctions = NULL;
 
 /**
@@ -276,6 +285,7 @@ xmlSecCryptoGetFunctions_gnutls(void) {
     gXmlSecGnuTLSFunctions->cryptoAppKeysMngrCertLoadMemory     = xmlSecGnuTLSAppKeysMngrCertLoadMemory;
     gXmlSecGnuTLSFunctions->cryptoAppKeysMngrCrlLoad            = xmlSecGnuTLSAppKeysMngrCrlLoad;
     gXmlSecGnuTLSFunctions->cryptoAppKeysMngrCrlLoadMemory      = xmlSecGnuTLSAppKeysMngrCrlLoadMemory;
+    gXmlSecGnuTLSFunctions->cryptoAppKeysMngrEnableX509VerifyCache = xmlSecGnuTLSAppKeysMngrEnableX509VerifyCache;
     gXmlSecGnuTLSFunctions->cryptoAppPkcs12Load                 = xmlSecGnuTLSAppPkcs12Load;
     gXmlSecGnuTLSFunctions->cryptoAppKeyCertLoad                = xmlSecGnuTLSAppKeyCertLoad;
 #endif /* XMLSEC_NO_X509 */
@@ -308,6 +318,11 @@ xmlSecGnuTLSInit (void)  {
         return(-1);
     }
 
+    /* not fatal: the contexts are created every time */
+    if(xmlSecGnuTLSCtxPoolsInit() < 0) {
+        xmlSecInternalError("xmlSecGnuTLSCtxPoolsInit", NULL);
+    }
+
     return(0);
 }
 
@@ -320,6 +335,10 @@ xmlSecGnuTLSInit (void)  {
  */
 int
 xmlSecGnuTLSShutdown(void) {
+#ifndef XMLSEC_NO_X509
+    xmlSecGnuTLSKeyDataX509DisableCertsCache();
+#endif /* XMLSEC_NO_X509 */
+    xmlSecGnuTLSCtxPoolsShutdown();
     return(0);
 }
 
@@ -339,7 +358,7 @@ xmlSecGnuTLSKeysMngrInit(xmlSecKeysMngrPtr mngr) {
     xmlSecAssert2(mngr != NULL, -1);
 
     /* create x509 store if needed */
-    if(xmlSecKeysMngrGetDataStore(mngr, xmlSecGnuTLSX509StoreId) == NULL) {
+    if(xmlSecKeysMngrFindDataStore(mngr, xmlSecGnuTLSX509StoreId) == NULL) {
         xmlSecKeyDataStorePtr x509Store;
 
         x509Store = xmlSecKeyDataStoreCreate(xmlSecGnuTLSX509StoreId);
@@ -401,3 +420,328 @@ xmlSecGnuTLSGenerateRandom(xmlSecBufferPtr buffer, xmlSecSize size) {
 
     return(0);
 }
+
+/******************************************************************************
+ *
+ * Contexts pools: gnutls_hash_init() and gnutls_cipher_init() allocate and
+ * set up a new context for every transform. Instead the released contexts
+ * are kept in small pools and given out again. The hash contexts are reset
+ * by gnutls_hash_output() before they are returned to the pool. The cipher
+ * contexts are keyed and the transforms always set the IV before using them,
+ * they are pooled only if the keyed contexts cache is enabled (disabled by
+ * default): the entries keep a copy of the key to match the lookups, it is
+ * cleared when the entry is removed.
+ *
+ *****************************************************************************/
+#define XMLSEC_GNUTLS_HASH_CTX_POOL_MAX_SIZE            32
+#define XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_SIZE          16
+#define XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_KEY_SIZE      64
+
+typedef struct _xmlSecGnuTLSHashCtxPoolEntry {
+    gnutls_digest_algorithm_t   algorithm;
+    gnutls_hash_hd_t            hash;
+} xmlSecGnuTLSHashCtxPoolEntry;
+
+/* the cipher contexts stay in the pool while they are used (busy != 0) */
+typedef struct _xmlSecGnuTLSCipherCtxPoolEntry {
+    gnutls_cipher_algorithm_t   algorithm;
+    xmlSecByte                  key[XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_KEY_SIZE];
+    xmlSecSize                  keySize;
+    gnutls_cipher_hd_t          cipher;
+    int                         busy;
+} xmlSecGnuTLSCipherCtxPoolEntry;
+
+static xmlMutexPtr                      gXmlSecGnuTLSCtxPoolsMutex = NULL;
+static xmlSecGnuTLSHashCtxPoolEntry     gXmlSecGnuTLSHashCtxPool[XMLSEC_GNUTLS_HASH_CTX_POOL_MAX_SIZE];
+static xmlSecSize                       gXmlSecGnuTLSHashCtxPoolSize = 0;
+static int                              gXmlSecGnuTLSCipherCtxPoolEnabled = 0;
+static xmlSecGnuTLSCipherCtxPoolEntry   gXmlSecGnuTLSCipherCtxPool[XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_SIZE];
+static xmlSecSize                       gXmlSecGnuTLSCipherCtxPoolNext = 0;
+
+static int
+xmlSecGnuTLSCtxPoolsInit(void) {
+    if(gXmlSecGnuTLSCtxPoolsMutex != NULL) {
+        return(0);
+    }
+
+    gXmlSecGnuTLSCtxPoolsMutex = xmlNewMutex();
+    if(gXmlSecGnuTLSCtxPoolsMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    memset(gXmlSecGnuTLSHashCtxPool, 0, sizeof(gXmlSecGnuTLSHashCtxPool));
+    memset(gXmlSecGnuTLSCipherCtxPool, 0, sizeof(gXmlSecGnuTLSCipherCtxPool));
+    gXmlSecGnuTLSHashCtxPoolSize = 0;
+    gXmlSecGnuTLSCipherCtxPoolNext = 0;
+    gXmlSecGnuTLSCipherCtxPoolEnabled = 0;
+    return(0);
+}
+
+/* should be called under lock; the busy entries are detached from the pool
+ * and will be destroyed when released */
+static void
+xmlSecGnuTLSCipherCtxPoolFlush(void) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_SIZE; ++ii) {
+        if((gXmlSecGnuTLSCipherCtxPool[ii].cipher != NULL) && (gXmlSecGnuTLSCipherCtxPool[ii].busy == 0)) {
+            gnutls_cipher_deinit(gXmlSecGnuTLSCipherCtxPool[ii].cipher);
+        }
+        gnutls_memset(&(gXmlSecGnuTLSCipherCtxPool[ii]), 0, sizeof(xmlSecGnuTLSCipherCtxPoolEntry));
+    }
+    gXmlSecGnuTLSCipherCtxPoolNext = 0;
+}
+
+static void
+xmlSecGnuTLSCtxPoolsShutdown(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecGnuTLSCtxPoolsMutex == NULL) {
+        return;
+    }
+    for(ii = 0; ii < gXmlSecGnuTLSHashCtxPoolSize; ++ii) {
+        gnutls_hash_deinit(gXmlSecGnuTLSHashCtxPool[ii].hash, NULL);
+    }
+    memset(gXmlSecGnuTLSHashCtxPool, 0, sizeof(gXmlSecGnuTLSHashCtxPool));
+    gXmlSecGnuTLSHashCtxPoolSize = 0;
+
+    xmlSecGnuTLSCipherCtxPoolFlush();
+    gXmlSecGnuTLSCipherCtxPoolEnabled = 0;
+
+    xmlFreeMutex(gXmlSecGnuTLSCtxPoolsMutex);
+    gXmlSecGnuTLSCtxPoolsMutex = NULL;
+}
+
+/**
+ * xmlSecGnuTLSSetCipherCtxCache:
+ * @enabled:            1 to enable the keyed cipher contexts cache or
+ *                      0 to disable it.
+ *
+ * Enables or disables the cache of the keyed gnutls_cipher_hd_t objects for
+ * the AES/DES CBC and AES KW transforms. When enabled, the transforms that
+ * use the same key reuse the released context instead of creating a new one
+ * and expanding the key again. The cache is small and keeps a copy of the
+ * most recently used keys until they are replaced or the cache is disabled.
+ * Disabling the cache removes (and clears) all the entries.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecGnuTLSSetCipherCtxCache(int enabled) {
+    if(gXmlSecGnuTLSCtxPoolsMutex == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_CRYPTO_FAILED, NULL, "cache is not initialized");
+        return(-1);
+    }
+
+    xmlMutexLock(gXmlSecGnuTLSCtxPoolsMutex);
+    gXmlSecGnuTLSCipherCtxPoolEnabled = (enabled != 0) ? 1 : 0;
+    if(enabled == 0) {
+        xmlSecGnuTLSCipherCtxPoolFlush();
+    }
+    xmlMutexUnlock(gXmlSecGnuTLSCtxPoolsMutex);
+    return(0);
+}
+
+/**
+ * xmlSecGnuTLSHashCtxAcquire:
+ * @algorithm:          the digest algorithm.
+ *
+ * Gets a hash context for @algorithm from the pool or creates a new one.
+ * The context should be returned with #xmlSecGnuTLSHashCtxRelease.
+ *
+ * Returns: the hash context or NULL if an error occurs.
+ */
+gnutls_hash_hd_t
+xmlSecGnuTLSHashCtxAcquire(gnutls_digest_algorithm_t algorithm) {
+    gnutls_hash_hd_t hash = NULL;
+    xmlSecSize ii;
+    int err;
+
+    if(gXmlSecGnuTLSCtxPoolsMutex != NULL) {
+        xmlMutexLock(gXmlSecGnuTLSCtxPoolsMutex);
+        for(ii = 0; ii < gXmlSecGnuTLSHashCtxPoolSize; ++ii) {
+            if(gXmlSecGnuTLSHashCtxPool[ii].algorithm == algorithm) {
+                hash = gXmlSecGnuTLSHashCtxPool[ii].hash;
+                gXmlSecGnuTLSHashCtxPool[ii] = gXmlSecGnuTLSHashCtxPool[--gXmlSecGnuTLSHashCtxPoolSize];
+                break;
+            }
+        }
+        xmlMutexUnlock(gXmlSecGnuTLSCtxPoolsMutex);
+
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoAlgorithm, (hash != NULL) ? 1 : 0);
+        if(hash != NULL) {
+            return(hash);
+        }
+    }
+
+    err = gnutls_hash_init(&hash, algorithm);
+    if(err != GNUTLS_E_SUCCESS) {
+        xmlSecGnuTLSError("gnutls_hash_init", err, NULL);
+        return(NULL);
+    }
+    return(hash);
+}
+
+/**
+ * xmlSecGnuTLSHashCtxRelease:
+ * @hash:               the hash context.
+ * @algorithm:          the @hash digest algorithm.
+ * @clean:              1 if the @hash state was reset by gnutls_hash_output()
+ *                      after the last update or 0 otherwise.
+ *
+ * Returns @hash to the pool (or destroys it if the pool is full).
+ */
+void
+xmlSecGnuTLSHashCtxRelease(gnutls_hash_hd_t hash, gnutls_digest_algorithm_t algorithm, int clean) {
+    xmlSecByte dgst[XMLSEC_GNUTLS_MAX_DIGEST_SIZE];
+
+    xmlSecAssert(hash != NULL);
+
+    if(gXmlSecGnuTLSCtxPoolsMutex == NULL) {
+        gnutls_hash_deinit(hash, NULL);
+        return;
+    }
+
+    /* gnutls_hash_output() resets the state */
+    if(clean == 0) {
+        xmlSecAssert(gnutls_hash_get_len(algorithm) <= sizeof(dgst));
+        gnutls_hash_output(hash, dgst);
+    }
+
+    xmlMutexLock(gXmlSecGnuTLSCtxPoolsMutex);
+    if(gXmlSecGnuTLSHashCtxPoolSize < XMLSEC_GNUTLS_HASH_CTX_POOL_MAX_SIZE) {
+        gXmlSecGnuTLSHashCtxPool[gXmlSecGnuTLSHashCtxPoolSize].algorithm = algorithm;
+        gXmlSecGnuTLSHashCtxPool[gXmlSecGnuTLSHashCtxPoolSize].hash      = hash;
+        ++gXmlSecGnuTLSHashCtxPoolSize;
+        hash = NULL;
+    }
+    xmlMutexUnlock(gXmlSecGnuTLSCtxPoolsMutex);
+
+    if(hash != NULL) {
+        gnutls_hash_deinit(hash, NULL);
+    }
+}
+
+/* should be called under lock; returns the free or the oldest idle entry */
+static xmlSecGnuTLSCipherCtxPoolEntry*
+xmlSecGnuTLSCipherCtxPoolGetFreeEntry(void) {
+    xmlSecGnuTLSCipherCtxPoolEntry* entry;
+    xmlSecSize ii;
+
+    for(ii = 0; ii < XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_SIZE; ++ii) {
+        if(gXmlSecGnuTLSCipherCtxPool[ii].cipher == NULL) {
+            return(&(gXmlSecGnuTLSCipherCtxPool[ii]));
+        }
+    }
+    for(ii = 0; ii < XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_SIZE; ++ii) {
+        if(gXmlSecGnuTLSCipherCtxPoolNext >= XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_SIZE) {
+            gXmlSecGnuTLSCipherCtxPoolNext = 0;
+        }
+        entry = &(gXmlSecGnuTLSCipherCtxPool[gXmlSecGnuTLSCipherCtxPoolNext++]);
+        if(entry->busy == 0) {
+            gnutls_cipher_deinit(entry->cipher);
+            gnutls_memset(entry, 0, sizeof(xmlSecGnuTLSCipherCtxPoolEntry));
+            return(entry);
+        }
+    }
+    return(NULL);
+}
+
+/**
+ * xmlSecGnuTLSCipherCtxAcquire:
+ * @algorithm:          the cipher algorithm.
+ * @key:                the key.
+ * @keySize:            the key size.
+ *
+ * Gets a cipher context for @algorithm and @key from the pool or creates
+ * a new one. The IV is not set and should be set by the caller before
+ * every use. The context should be returned with #xmlSecGnuTLSCipherCtxRelease.
+ *
+ * Returns: the cipher context or NULL if an error occurs.
+ */
+gnutls_cipher_hd_t
+xmlSecGnuTLSCipherCtxAcquire(gnutls_cipher_algorithm_t algorithm, const xmlSecByte* key, xmlSecSize keySize) {
+    xmlSecGnuTLSCipherCtxPoolEntry* entry;
+    gnutls_cipher_hd_t cipher = NULL;
+    gnutls_datum_t gnutlsKey;
+    xmlSecSize ii;
+    int err;
+
+    xmlSecAssert2(key != NULL, NULL);
+    xmlSecAssert2(keySize > 0, NULL);
+
+    if((gXmlSecGnuTLSCtxPoolsMutex != NULL) && (gXmlSecGnuTLSCipherCtxPoolEnabled != 0)) {
+        xmlMutexLock(gXmlSecGnuTLSCtxPoolsMutex);
+        for(ii = 0; ii < XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_SIZE; ++ii) {
+            entry = &(gXmlSecGnuTLSCipherCtxPool[ii]);
+            if((entry->cipher != NULL) && (entry->busy == 0) &&
+               (entry->algorithm == algorithm) && (entry->keySize == keySize) &&
+               (gnutls_memcmp(entry->key, key, keySize) == 0)
+            ) {
+                entry->busy = 1;
+                cipher = entry->cipher;
+                break;
+            }
+        }
+        xmlMutexUnlock(gXmlSecGnuTLSCtxPoolsMutex);
+
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoKeyCtx, (cipher != NULL) ? 1 : 0);
+        if(cipher != NULL) {
+            return(cipher);
+        }
+    }
+
+    /* create outside of the lock */
+    gnutlsKey.data = (unsigned char*)key;
+    XMLSEC_SAFE_CAST_SIZE_TO_UINT(keySize, gnutlsKey.size, return(NULL), NULL);
+    err = gnutls_cipher_init(&cipher, algorithm, &gnutlsKey, NULL);
+    if(err != GNUTLS_E_SUCCESS) {
+        xmlSecGnuTLSError("gnutls_cipher_init", err, NULL);
+        return(NULL);
+    }
+
+    /* not fatal if we can't cache it */
+    if((gXmlSecGnuTLSCtxPoolsMutex != NULL) && (keySize <= XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_KEY_SIZE)) {
+        xmlMutexLock(gXmlSecGnuTLSCtxPoolsMutex);
+        if(gXmlSecGnuTLSCipherCtxPoolEnabled != 0) {
+            entry = xmlSecGnuTLSCipherCtxPoolGetFreeEntry();
+            if(entry != NULL) {
+                entry->algorithm = algorithm;
+                memcpy(entry->key, key, keySize);
+                entry->keySize   = keySize;
+                entry->cipher    = cipher;
+                entry->busy      = 1;
+            }
+        }
+        xmlMutexUnlock(gXmlSecGnuTLSCtxPoolsMutex);
+    }
+    return(cipher);
+}
+
+/**
+ * xmlSecGnuTLSCipherCtxRelease:
+ * @cipher:             the cipher context.
+ *
+ * Returns @cipher to the pool (or destroys it if it is not in the pool).
+ */
+void
+xmlSecGnuTLSCipherCtxRelease(gnutls_cipher_hd_t cipher) {
+    xmlSecSize ii;
+
+    xmlSecAssert(cipher != NULL);
+
+    if(gXmlSecGnuTLSCtxPoolsMutex != NULL) {
+        xmlMutexLock(gXmlSecGnuTLSCtxPoolsMutex);
+        for(ii = 0; ii < XMLSEC_GNUTLS_CIPHER_CTX_POOL_MAX_SIZE; ++ii) {
+            if((gXmlSecGnuTLSCipherCtxPool[ii].cipher == cipher) && (gXmlSecGnuTLSCipherCtxPool[ii].busy != 0)) {
+                gXmlSecGnuTLSCipherCtxPool[ii].busy = 0;
+                cipher = NULL;
+                break;
+            }
+        }
+        xmlMutexUnlock(gXmlSecGnuTLSCtxPoolsMutex);
+    }
+    if(cipher != NULL) {
+        gnutls_cipher_deinit(cipher);
+    }
+}
@@ -28,7 +28,7 @@
 #include <xmlsec/gnutls/app.h>
 #include <xmlsec/gnutls/crypto.h>
 
-
+#include "private.h"
 #include "../cast_helpers.h"
 
 /**************************************************************************
@@ -111,7 +111,6 @@ xmlSecGnuTLSDigestCheckId(xmlSecTransformPtr transform) {
 static int
 xmlSecGnuTLSDigestInitialize(xmlSecTransformPtr transform) {
     xmlSecGnuTLSDigestCtxPtr ctx;
-    int err;
 
     xmlSecAssert2(xmlSecGnuTLSDigestCheckId(transform), -1);
     xmlSecAssert2(xmlSecTransformCheckSize(transform, xmlSecGnuTLSDigestSize), -1);
@@ -172,13 +171,16 @@ xmlSecGnuTLSDigestInitialize(xmlSecTransformPtr transform) {
     }
     xmlSecAssert2(ctx->dgstSize < XMLSEC_GNUTLS_MAX_DIGEST_SIZE, -1);
 
-    /* create hash */
-    err =  gnutls_hash_init(&(ctx->hash), ctx->dgstAlgo);
-    if(err != GNUTLS_E_SUCCESS) {
-        xmlSecGnuTLSError("gnutls_hash_init", err, NULL);
+    /* get hash from the pool */
+    ctx->hash = xmlSecGnuTLSHashCtxAcquire(ctx->dgstAlgo);
+    if(ctx->hash == NULL) {
+        xmlSecInternalError("xmlSecGnuTLSHashCtxAcquire", xmlSecTransformGetName(transform));
         return(-1);
     }
 
+    /* the digest only reads the input, no need to copy it */
+    transform->borrowInput = 1;
+
     /* done */
     return(0);
 }
@@ -194,7 +196,9 @@ xmlSecGnuTLSDigestFinalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     if(ctx->hash != NULL) {
-        gnutls_hash_deinit(ctx->hash, NULL);
+        /* the hash state is reset once the transform produced its output */
+        xmlSecGnuTLSHashCtxRelease(ctx->hash, ctx->dgstAlgo,
+            ((transform->status != xmlSecTransformStatusNone) && (transform->status != xmlSecTransformStatusWorking)) ? 1 : 0);
     }
     memset(ctx, 0, sizeof(xmlSecGnuTLSDigestCtx));
 }
@@ -30,6 +30,7 @@
 
 #include <xmlsec/gnutls/crypto.h>
 
+#include "private.h"
 #include "../kw_aes_des.h"
 #include "../cast_helpers.h"
 
@@ -54,6 +55,8 @@ static xmlSecKWAesKlass xmlSecGnuTLSKWAesKlass = {
     /* callbacks */
     xmlSecGnuTLSKWAesBlockEncrypt,         /* xmlSecKWAesBlockEncryptMethod       encrypt; */
     xmlSecGnuTLSKWAesBlockDecrypt,         /* xmlSecKWAesBlockDecryptMethod       decrypt; */
+    NULL,                                  /* xmlSecKWAesBlocksEncryptMethod      encryptBlocks; */
+    NULL,                                  /* xmlSecKWAesBlocksDecryptMethod      decryptBlocks; */
 
     /* for the future */
     NULL,                                   /* void*                               reserved0; */
@@ -164,7 +167,7 @@ xmlSecGnuTLSKWAesFinalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     if(ctx->cipher != NULL) {
-        gnutls_cipher_deinit(ctx->cipher);
+        xmlSecGnuTLSCipherCtxRelease(ctx->cipher);
     }
     xmlSecTransformKWAesFinalize(transform, &(ctx->parentCtx));
     memset(ctx, 0, sizeof(xmlSecGnuTLSKWAesCtx));
@@ -359,8 +362,6 @@ static int
 xmlSecGnuTLSKWAesInitCipher(xmlSecGnuTLSKWAesCtxPtr ctx) {
     xmlSecByte* keyData;
     xmlSecSize keySize;
-    gnutls_datum_t gnutlsKey;
-    int err;
 
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(ctx->parentCtx.keyExpectedSize > 0, -1);
@@ -372,12 +373,9 @@ xmlSecGnuTLSKWAesInitCipher(xmlSecGnuTLSKWAesCtxPtr ctx) {
     xmlSecAssert2(keySize > 0, -1);
     xmlSecAssert2(keySize == ctx->parentCtx.keyExpectedSize, -1);
 
-    gnutlsKey.data = keyData;
-    XMLSEC_SAFE_CAST_SIZE_TO_UINT(keySize, gnutlsKey.size, return(-1), NULL);
-
-    err = gnutls_cipher_init(&(ctx->cipher), ctx->algorithm, &gnutlsKey, NULL);
-    if(err != GNUTLS_E_SUCCESS) {
-        xmlSecGnuTLSError("gnutls_cipher_init", err, NULL);
+    ctx->cipher = xmlSecGnuTLSCipherCtxAcquire(ctx->algorithm, keyData, keySize);
+    if(ctx->cipher == NULL) {
+        xmlSecInternalError("xmlSecGnuTLSCipherCtxAcquire", NULL);
         return(-1);
     }
 
@@ -52,6 +52,7 @@ struct _xmlSecGnuTLSPbkdf2Ctx {
     xmlSecTransformPbkdf2Params params;
     gnutls_mac_algorithm_t mac;
     xmlSecBuffer key;
+    xmlSecBuffer cacheId;
 };
 XMLSEC_TRANSFORM_DECLARE(GnuTLSPbkdf2, xmlSecGnuTLSPbkdf2Ctx)
 #define xmlSecGnuTLSPbkdf2CtxSize XMLSEC_TRANSFORM_SIZE(GnuTLSPbkdf2)
@@ -105,6 +106,12 @@ xmlSecGnuTLSPbkdf2Initialize(xmlSecTransformPtr transform) {
         xmlSecGnuTLSPbkdf2Finalize(transform);
         return(-1);
     }
+    ret = xmlSecBufferInitialize(&(ctx->cacheId), XMLSEC_GNUTLS_KDF_DEFAULT_BUF_SIZE);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize(cacheId)", NULL);
+        xmlSecGnuTLSPbkdf2Finalize(transform);
+        return(-1);
+    }
     ret = xmlSecTransformPbkdf2ParamsInitialize(&(ctx->params));
     if(ret < 0) {
         xmlSecInternalError("xmlSecTransformPbkdf2ParamsInitialize", NULL);
@@ -127,6 +134,7 @@ xmlSecGnuTLSPbkdf2Finalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     xmlSecBufferFinalize(&(ctx->key));
+    xmlSecBufferFinalize(&(ctx->cacheId));
     xmlSecTransformPbkdf2ParamsFinalize(&(ctx->params));
 
     memset(ctx, 0, sizeof(xmlSecGnuTLSPbkdf2Ctx));
@@ -335,12 +343,34 @@ xmlSecGnuTLSPbkdf2Execute(xmlSecTransformPtr transform, int last, xmlSecTransfor
         }
         ctx->params.keyLength = transform->expectedOutputSize;
 
+        /* the same key might be already derived */
+        ret = xmlSecTransformPbkdf2ParamsGetCacheId(&(ctx->params), &(ctx->cacheId));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformPbkdf2ParamsGetCacheId", xmlSecTransformGetName(transform));
+            return(-1);
+        }
+        ret = xmlSecTransformKdfCacheFind(transform, &(ctx->cacheId),
+            xmlSecBufferGetData(&(ctx->key)), xmlSecBufferGetSize(&(ctx->key)), out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheFind", xmlSecTransformGetName(transform));
+            return(-1);
+        } else if(ret > 0) {
+            transform->status = xmlSecTransformStatusFinished;
+            return(0);
+        }
+
         /* generate key */
         ret = xmlSecGnuTLSPbkdf2GenerateKey(ctx, out);
         if(ret < 0) {
             xmlSecInternalError("xmlSecGnuTLSPbkdf2GenerateKey", xmlSecTransformGetName(transform));
             return(-1);
         }
+        ret = xmlSecTransformKdfCacheAdd(transform, &(ctx->cacheId),
+            xmlSecBufferGetData(&(ctx->key)), xmlSecBufferGetSize(&(ctx->key)), out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheAdd", xmlSecTransformGetName(transform));
+            return(-1);
+        }
 
         /* done */
         transform->status = xmlSecTransformStatusFinished;
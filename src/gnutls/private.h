@@ -16,6 +16,16 @@
 #error "gnutls/private.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
 #endif /* XMLSEC_PRIVATE */
 
+#include <gnutls/gnutls.h>
+#include <gnutls/abstract.h>
+#include <gnutls/crypto.h>
+#include <gnutls/x509.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/bn.h>
+#include <xmlsec/keys.h>
+#include <xmlsec/keysmngr.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -30,6 +40,20 @@ extern "C" {
 xmlSecKeyDataPtr        xmlSecGnuTLSAsymKeyDataCreate           (gnutls_pubkey_t pubkey,
                                                                  gnutls_privkey_t privkey);
 
+/**************************************************************************
+ *
+ * Contexts pools
+ *
+ *****************************************************************************/
+gnutls_hash_hd_t        xmlSecGnuTLSHashCtxAcquire              (gnutls_digest_algorithm_t algorithm);
+void                    xmlSecGnuTLSHashCtxRelease              (gnutls_hash_hd_t hash,
+                                                                 gnutls_digest_algorithm_t algorithm,
+                                                                 int clean);
+gnutls_cipher_hd_t      xmlSecGnuTLSCipherCtxAcquire            (gnutls_cipher_algorithm_t algorithm,
+                                                                 const xmlSecByte* key,
+                                                                 xmlSecSize keySize);
+void                    xmlSecGnuTLSCipherCtxRelease            (gnutls_cipher_hd_t cipher);
+
 
 
 #ifndef XMLSEC_NO_X509
@@ -94,7 +118,7 @@ typedef struct _xmlSecGnuTLSX509FindCertCtx {
     const xmlChar *subjectName;         /* NOT OWNED */
 
     const xmlChar *issuerName;          /* NOT OWNED */
-    const xmlChar *issuerSerial;        /* NOT OWNED */
+    xmlSecBnPtr issuerSerialBn;
 
     const xmlSecByte * ski;             /* NOT OWNED */
     xmlSecSize skiSize;
@@ -27,7 +27,7 @@
 
 #include <xmlsec/gnutls/crypto.h>
 
-
+#include "private.h"
 #include "../cast_helpers.h"
 
 /* https://www.w3.org/TR/xmldsig-core1/#sec-DSA
@@ -204,7 +204,6 @@ xmlSecGnuTLSSignatureCheckId(xmlSecTransformPtr transform) {
 static int
 xmlSecGnuTLSSignatureInitialize(xmlSecTransformPtr transform) {
     xmlSecGnuTLSSignatureCtxPtr ctx;
-    int err;
 
     xmlSecAssert2(xmlSecGnuTLSSignatureCheckId(transform), -1);
     xmlSecAssert2(xmlSecTransformCheckSize(transform, xmlSecGnuTLSSignatureSize), -1);
@@ -393,10 +392,10 @@ xmlSecGnuTLSSignatureInitialize(xmlSecTransformPtr transform) {
     }
     xmlSecAssert2(ctx->dgstSize < XMLSEC_GNUTLS_MAX_DIGEST_SIZE, -1);
 
-    /* create hash */
-    err =  gnutls_hash_init(&(ctx->hash), ctx->dgstAlgo);
-    if(err != GNUTLS_E_SUCCESS) {
-        xmlSecGnuTLSError("gnutls_hash_init", err, NULL);
+    /* get hash from the pool */
+    ctx->hash = xmlSecGnuTLSHashCtxAcquire(ctx->dgstAlgo);
+    if(ctx->hash == NULL) {
+        xmlSecInternalError("xmlSecGnuTLSHashCtxAcquire", xmlSecTransformGetName(transform));
         return(-1);
     }
 
@@ -419,7 +418,9 @@ xmlSecGnuTLSSignatureFinalize(xmlSecTransformPtr transform) {
         xmlSecKeyDataDestroy(ctx->keyData);
     }
     if(ctx->hash != NULL) {
-        gnutls_hash_deinit(ctx->hash, NULL);
+        /* the hash state is reset once the transform produced its output */
+        xmlSecGnuTLSHashCtxRelease(ctx->hash, ctx->dgstAlgo,
+            ((transform->status != xmlSecTransformStatusNone) && (transform->status != xmlSecTransformStatusWorking)) ? 1 : 0);
     }
     memset(ctx, 0, sizeof(xmlSecGnuTLSSignatureCtx));
 }
@@ -28,6 +28,8 @@
 #include <gnutls/x509.h>
 #include <gnutls/pkcs12.h>
 
+#include <libxml/threads.h>
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/keyinfo.h>
@@ -36,6 +38,7 @@
 #include <xmlsec/base64.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 
 #include <xmlsec/gnutls/crypto.h>
 #include <xmlsec/gnutls/x509.h>
@@ -197,8 +200,8 @@ xmlSecGnuTLSX509CertDup(gnutls_x509_crt_t src) {
     return (res);
 }
 
-xmlChar *
-xmlSecGnuTLSX509CertGetSubjectDN(gnutls_x509_crt_t cert) {
+static xmlChar *
+xmlSecGnuTLSX509CertReadSubjectDN(gnutls_x509_crt_t cert) {
     char* buf = NULL;
     size_t bufSize = 0;
     int err;
@@ -231,8 +234,8 @@ xmlSecGnuTLSX509CertGetSubjectDN(gnutls_x509_crt_t cert) {
     return(BAD_CAST buf);
 }
 
-xmlChar *
-xmlSecGnuTLSX509CertGetIssuerDN(gnutls_x509_crt_t cert) {
+static xmlChar *
+xmlSecGnuTLSX509CertReadIssuerDN(gnutls_x509_crt_t cert) {
     char* buf = NULL;
     size_t bufSize = 0;
     int err;
@@ -265,8 +268,8 @@ xmlSecGnuTLSX509CertGetIssuerDN(gnutls_x509_crt_t cert) {
     return(BAD_CAST buf);
 }
 
-xmlChar *
-xmlSecGnuTLSX509CertGetIssuerSerial(gnutls_x509_crt_t cert) {
+static xmlChar *
+xmlSecGnuTLSX509CertReadIssuerSerial(gnutls_x509_crt_t cert) {
     xmlChar * res = NULL;
     unsigned char* buf = NULL;
     size_t bufSize = 0;
@@ -309,6 +312,217 @@ xmlSecGnuTLSX509CertGetIssuerSerial(gnutls_x509_crt_t cert) {
     return(res);
 }
 
+/**************************************************************************
+ *
+ * Certificates identity cache (disabled by default): the same few certificates
+ * are matched against &lt;dsig:X509Data/&gt; and chained by the DN strings
+ * again and again. GnuTLS has no reference counting for the certificate
+ * objects thus every key data owns its own copy, but the identity fields
+ * extracted from the certificate are the same for all the copies. The cache
+ * maps the SHA256 fingerprint of the certificate to its subject DN, issuer DN
+ * and serial number strings; each field is extracted on the first request.
+ *
+ *************************************************************************/
+#define XMLSEC_GNUTLS_X509_CERT_CACHE_DIGEST            GNUTLS_DIG_SHA256
+#define XMLSEC_GNUTLS_X509_CERT_CACHE_DIGEST_SIZE       32
+
+typedef enum {
+    xmlSecGnuTLSX509CertFieldSubjectDN = 0,
+    xmlSecGnuTLSX509CertFieldIssuerDN,
+    xmlSecGnuTLSX509CertFieldIssuerSerial
+} xmlSecGnuTLSX509CertField;
+
+#define XMLSEC_GNUTLS_X509_CERT_FIELDS_SIZE             3
+
+typedef xmlChar* (*xmlSecGnuTLSX509CertFieldReadMethod) (gnutls_x509_crt_t cert);
+
+typedef struct _xmlSecGnuTLSX509CertCacheEntry {
+    int                 used;
+    xmlSecByte          digest[XMLSEC_GNUTLS_X509_CERT_CACHE_DIGEST_SIZE];
+    xmlChar*            fields[XMLSEC_GNUTLS_X509_CERT_FIELDS_SIZE];
+} xmlSecGnuTLSX509CertCacheEntry, *xmlSecGnuTLSX509CertCacheEntryPtr;
+
+static xmlMutexPtr                          gXmlSecGnuTLSX509CertCacheMutex = NULL;
+static xmlSecGnuTLSX509CertCacheEntryPtr    gXmlSecGnuTLSX509CertCacheEntries = NULL;
+static xmlSecSize                           gXmlSecGnuTLSX509CertCacheMaxSize = 0;
+static xmlSecSize                           gXmlSecGnuTLSX509CertCachePos = 0;
+
+static void
+xmlSecGnuTLSX509CertCacheEntryClear(xmlSecGnuTLSX509CertCacheEntryPtr entry) {
+    xmlSecSize ii;
+
+    xmlSecAssert(entry != NULL);
+
+    for(ii = 0; ii < XMLSEC_GNUTLS_X509_CERT_FIELDS_SIZE; ++ii) {
+        if(entry->fields[ii] != NULL) {
+            xmlFree(entry->fields[ii]);
+        }
+    }
+    memset(entry, 0, sizeof(xmlSecGnuTLSX509CertCacheEntry));
+}
+
+/**
+ * xmlSecGnuTLSKeyDataX509EnableCertsCache:
+ * @maxSize:            the max number of cached certificates.
+ *
+ * Enables the process wide cache of the certificates identity fields
+ * (subject DN, issuer DN and serial number) used to match the certificates
+ * against &lt;dsig:X509Data/&gt; and to build the certificates chains. The
+ * fields are shared by all the certificates with the same DER bytes. This
+ * function is not thread safe and should be called during the application
+ * initialization.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecGnuTLSKeyDataX509EnableCertsCache(xmlSecSize maxSize) {
+    xmlSecAssert2(maxSize > 0, -1);
+
+    xmlSecGnuTLSKeyDataX509DisableCertsCache();
+
+    gXmlSecGnuTLSX509CertCacheEntries = (xmlSecGnuTLSX509CertCacheEntryPtr)xmlMalloc(sizeof(xmlSecGnuTLSX509CertCacheEntry) * maxSize);
+    if(gXmlSecGnuTLSX509CertCacheEntries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecGnuTLSX509CertCacheEntry) * maxSize, NULL);
+        return(-1);
+    }
+    memset(gXmlSecGnuTLSX509CertCacheEntries, 0, sizeof(xmlSecGnuTLSX509CertCacheEntry) * maxSize);
+
+    gXmlSecGnuTLSX509CertCacheMutex = xmlNewMutex();
+    if(gXmlSecGnuTLSX509CertCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(gXmlSecGnuTLSX509CertCacheEntries);
+        gXmlSecGnuTLSX509CertCacheEntries = NULL;
+        return(-1);
+    }
+    gXmlSecGnuTLSX509CertCacheMaxSize = maxSize;
+    gXmlSecGnuTLSX509CertCachePos = 0;
+    return(0);
+}
+
+/**
+ * xmlSecGnuTLSKeyDataX509DisableCertsCache:
+ *
+ * Disables the certificates identity cache and frees the cached values.
+ * This function is not thread safe and is called from #xmlSecGnuTLSShutdown.
+ */
+void
+xmlSecGnuTLSKeyDataX509DisableCertsCache(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecGnuTLSX509CertCacheEntries != NULL) {
+        for(ii = 0; ii < gXmlSecGnuTLSX509CertCacheMaxSize; ++ii) {
+            xmlSecGnuTLSX509CertCacheEntryClear(&(gXmlSecGnuTLSX509CertCacheEntries[ii]));
+        }
+        xmlFree(gXmlSecGnuTLSX509CertCacheEntries);
+        gXmlSecGnuTLSX509CertCacheEntries = NULL;
+    }
+    if(gXmlSecGnuTLSX509CertCacheMutex != NULL) {
+        xmlFreeMutex(gXmlSecGnuTLSX509CertCacheMutex);
+        gXmlSecGnuTLSX509CertCacheMutex = NULL;
+    }
+    gXmlSecGnuTLSX509CertCacheMaxSize = 0;
+    gXmlSecGnuTLSX509CertCachePos = 0;
+}
+
+/* the caller is responsible for locking */
+static xmlSecGnuTLSX509CertCacheEntryPtr
+xmlSecGnuTLSX509CertCacheFind(const xmlSecByte* digest) {
+    xmlSecSize ii;
+
+    xmlSecAssert2(digest != NULL, NULL);
+
+    for(ii = 0; ii < gXmlSecGnuTLSX509CertCacheMaxSize; ++ii) {
+        xmlSecGnuTLSX509CertCacheEntryPtr entry = &(gXmlSecGnuTLSX509CertCacheEntries[ii]);
+        if((entry->used != 0) && (memcmp(entry->digest, digest, sizeof(entry->digest)) == 0)) {
+            return(entry);
+        }
+    }
+    return(NULL);
+}
+
+/* returns the cached (or just read) copy of the @field from @cert */
+static xmlChar *
+xmlSecGnuTLSX509CertGetField(gnutls_x509_crt_t cert, xmlSecGnuTLSX509CertField field,
+    xmlSecGnuTLSX509CertFieldReadMethod readMethod
+) {
+    xmlSecByte digest[XMLSEC_GNUTLS_X509_CERT_CACHE_DIGEST_SIZE];
+    size_t digestSize = sizeof(digest);
+    xmlSecGnuTLSX509CertCacheEntryPtr entry;
+    xmlChar * res = NULL;
+    int err;
+
+    xmlSecAssert2(cert != NULL, NULL);
+    xmlSecAssert2((xmlSecSize)field < XMLSEC_GNUTLS_X509_CERT_FIELDS_SIZE, NULL);
+    xmlSecAssert2(readMethod != NULL, NULL);
+
+    if(gXmlSecGnuTLSX509CertCacheMutex == NULL) {
+        return(readMethod(cert));
+    }
+
+    /* the fingerprint is calculated over the DER bytes kept by GnuTLS */
+    err = gnutls_x509_crt_get_fingerprint(cert, XMLSEC_GNUTLS_X509_CERT_CACHE_DIGEST, digest, &digestSize);
+    if((err != GNUTLS_E_SUCCESS) || (digestSize != sizeof(digest))) {
+        xmlSecGnuTLSError("gnutls_x509_crt_get_fingerprint", err, NULL);
+        return(NULL);
+    }
+
+    /* check the cache first */
+    xmlMutexLock(gXmlSecGnuTLSX509CertCacheMutex);
+    entry = xmlSecGnuTLSX509CertCacheFind(digest);
+    if((entry != NULL) && (entry->fields[field] != NULL)) {
+        res = xmlStrdup(entry->fields[field]);
+    }
+    xmlMutexUnlock(gXmlSecGnuTLSX509CertCacheMutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheX509Cert, (res != NULL) ? 1 : 0);
+    if(res != NULL) {
+        return(res);
+    }
+
+    /* read the field outside of the lock */
+    res = readMethod(cert);
+    if(res == NULL) {
+        return(NULL);
+    }
+
+    /* not fatal if the field can't be cached; another thread might have
+     * added the same cert while we were reading it */
+    xmlMutexLock(gXmlSecGnuTLSX509CertCacheMutex);
+    entry = xmlSecGnuTLSX509CertCacheFind(digest);
+    if(entry == NULL) {
+        if(gXmlSecGnuTLSX509CertCachePos >= gXmlSecGnuTLSX509CertCacheMaxSize) {
+            gXmlSecGnuTLSX509CertCachePos = 0;
+        }
+        entry = &(gXmlSecGnuTLSX509CertCacheEntries[gXmlSecGnuTLSX509CertCachePos++]);
+        xmlSecGnuTLSX509CertCacheEntryClear(entry);
+        memcpy(entry->digest, digest, sizeof(entry->digest));
+        entry->used = 1;
+    }
+    if(entry->fields[field] == NULL) {
+        entry->fields[field] = xmlStrdup(res);
+    }
+    xmlMutexUnlock(gXmlSecGnuTLSX509CertCacheMutex);
+
+    return(res);
+}
+
+xmlChar *
+xmlSecGnuTLSX509CertGetSubjectDN(gnutls_x509_crt_t cert) {
+    return(xmlSecGnuTLSX509CertGetField(cert, xmlSecGnuTLSX509CertFieldSubjectDN,
+        xmlSecGnuTLSX509CertReadSubjectDN));
+}
+
+xmlChar *
+xmlSecGnuTLSX509CertGetIssuerDN(gnutls_x509_crt_t cert) {
+    return(xmlSecGnuTLSX509CertGetField(cert, xmlSecGnuTLSX509CertFieldIssuerDN,
+        xmlSecGnuTLSX509CertReadIssuerDN));
+}
+
+xmlChar *
+xmlSecGnuTLSX509CertGetIssuerSerial(gnutls_x509_crt_t cert) {
+    return(xmlSecGnuTLSX509CertGetField(cert, xmlSecGnuTLSX509CertFieldIssuerSerial,
+        xmlSecGnuTLSX509CertReadIssuerSerial));
+}
+
 int
 xmlSecGnuTLSX509DigestWrite(gnutls_x509_crt_t cert, const xmlChar* algorithm, xmlSecBufferPtr buf) {
     gnutls_digest_algorithm_t digestAlgo;
@@ -508,17 +722,31 @@ int xmlSecGnuTLSX509FindCertCtxInitialize(xmlSecGnuTLSX509FindCertCtxPtr ctx,
     const xmlChar *issuerName, const xmlChar *issuerSerial,
     const xmlSecByte * ski, xmlSecSize skiSize
 ) {
+    int ret;
+
     xmlSecAssert2(ctx != NULL, -1);
 
     memset(ctx, 0, sizeof(*ctx));
 
-    /* TODO: figure out if we can convert the X509 Data into any faster representation */
     if(subjectName != NULL) {
         ctx->subjectName = subjectName;
     }
     if((issuerName != NULL) && (issuerSerial != NULL)) {
         ctx->issuerName = issuerName;
-        ctx->issuerSerial = issuerSerial;
+
+        /* the serial is compared with the certificates in the binary form */
+        ctx->issuerSerialBn = xmlSecBnCreate(0);
+        if(ctx->issuerSerialBn == NULL) {
+            xmlSecInternalError("xmlSecBnCreate(issuerSerial)", NULL);
+            xmlSecGnuTLSX509FindCertCtxFinalize(ctx);
+            return(-1);
+        }
+        ret = xmlSecBnFromDecString(ctx->issuerSerialBn, issuerSerial);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBnFromDecString(issuerSerial)", NULL);
+            xmlSecGnuTLSX509FindCertCtxFinalize(ctx);
+            return(-1);
+        }
     }
     if((ski != NULL) && (skiSize > 0)) {
         ctx->ski = ski;
@@ -565,6 +793,9 @@ xmlSecGnuTLSX509FindCertCtxInitializeFromValue(xmlSecGnuTLSX509FindCertCtxPtr ct
 void xmlSecGnuTLSX509FindCertCtxFinalize(xmlSecGnuTLSX509FindCertCtxPtr ctx) {
     xmlSecAssert(ctx != NULL);
 
+    if(ctx->issuerSerialBn != NULL) {
+        xmlSecBnDestroy(ctx->issuerSerialBn);
+    }
     memset(ctx, 0, sizeof(*ctx));
 }
 
@@ -595,14 +826,33 @@ xmlSecGnuTLSX509MatchBySubjectName(gnutls_x509_crt_t cert, const xmlChar* subjec
     return(1);
 }
 
+#define XMLSEC_GNUTLS_X509_SERIAL_MAX_SIZE      64
+
 static int
-xmlSecGnuTLSX509MatchByIssuer(gnutls_x509_crt_t cert,  const xmlChar* issuerName, const xmlChar* issuerSerial) {
-    xmlChar* certIssuerSerial;
+xmlSecGnuTLSX509MatchByIssuer(gnutls_x509_crt_t cert,  const xmlChar* issuerName, xmlSecBnPtr issuerSerialBn) {
+    xmlSecByte serial[XMLSEC_GNUTLS_X509_SERIAL_MAX_SIZE];
+    size_t serialLen = sizeof(serial);
+    xmlSecSize serialSize;
     xmlChar* certIssuerName;
+    int err;
 
     xmlSecAssert2(cert != NULL, -1);
 
-    if((issuerName == NULL) || (issuerSerial == NULL)) {
+    if((issuerName == NULL) || (issuerSerialBn == NULL)) {
+        return(0);
+    }
+
+    /* the serial is cheap to compare, check it first; RFC 5280 limits
+     * serials to 20 bytes thus the longer ones simply don't match */
+    err = gnutls_x509_crt_get_serial(cert, serial, &serialLen);
+    if(err == GNUTLS_E_SHORT_MEMORY_BUFFER) {
+        return(0);
+    } else if(err != GNUTLS_E_SUCCESS) {
+        xmlSecGnuTLSError("gnutls_x509_crt_get_serial", err, NULL);
+        return(-1);
+    }
+    XMLSEC_SAFE_CAST_SIZE_T_TO_SIZE(serialLen, serialSize, return(-1), NULL);
+    if(xmlSecBnCompare(issuerSerialBn, serial, serialSize) != 0) {
         return(0);
     }
 
@@ -613,13 +863,6 @@ xmlSecGnuTLSX509MatchByIssuer(gnutls_x509_crt_t cert,  const xmlChar* issuerName
     }
     xmlFree(certIssuerName);
 
-    certIssuerSerial = xmlSecGnuTLSX509CertGetIssuerSerial(cert);
-    if((certIssuerSerial == NULL) || (!xmlStrEqual(issuerSerial, certIssuerSerial))) {
-        xmlFree(certIssuerSerial);
-        return(0);
-    }
-    xmlFree(certIssuerSerial);
-
     /* success */
     return(1);
 }
@@ -692,7 +935,7 @@ xmlSecGnuTLSX509FindCertCtxMatch(xmlSecGnuTLSX509FindCertCtxPtr ctx, gnutls_x509
         return(1);
     }
 
-    ret = xmlSecGnuTLSX509MatchByIssuer(cert, ctx->issuerName, ctx->issuerSerial);
+    ret = xmlSecGnuTLSX509MatchByIssuer(cert, ctx->issuerName, ctx->issuerSerialBn);
     if(ret < 0) {
         xmlSecInternalError("xmlSecGnuTLSX509MatchByIssuer", NULL);
         return(-1);
@@ -985,36 +1228,45 @@ xmlSecGnuTLSX509CrlDebugXmlDump(gnutls_x509_crl_t crl, FILE* output) {
  * Misc. utils/helpers
  *
  ************************************************************************/
-#define XMLSEC_GNUTLS_INT_TO_STR_MAX_SIZE 64
 xmlChar*
 xmlSecGnuTLSASN1IntegerWrite(const unsigned char * data, size_t len) {
+    xmlSecBn bn;
+    xmlSecSize size;
+    xmlSecByte zero = 0;
     xmlChar *res = NULL;
-    unsigned long long int val = 0;
-    size_t ii = 0;
-    int shift = 0;
     int ret;
 
     xmlSecAssert2(data != NULL, NULL);
-    xmlSecAssert2(len <= 9, NULL);
-
-    /* HACK : to be fixed after GnuTLS provides a way to read opaque ASN1 integer */
-    for(ii = len; ii > 0; --ii, shift += 8) {
-        val |= ((unsigned long long)data[ii - 1]) << shift;
-    }
+    XMLSEC_SAFE_CAST_SIZE_T_TO_SIZE(len, size, return(NULL), NULL);
 
-    res = (xmlChar*)xmlMalloc(XMLSEC_GNUTLS_INT_TO_STR_MAX_SIZE + 1);
-    if(res == NULL) {
-        xmlSecMallocError(XMLSEC_GNUTLS_INT_TO_STR_MAX_SIZE + 1, NULL);
+    ret = xmlSecBnInitialize(&bn, size + 1);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBnInitialize", NULL);
         return(NULL);
     }
 
-    ret = xmlStrPrintf(res, XMLSEC_GNUTLS_INT_TO_STR_MAX_SIZE, "%llu", val);
+    /* the integer is treated as unsigned */
+    if((len > 0) && (data[0] > 127)) {
+        ret = xmlSecBufferAppend(&bn, &zero, 1);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", NULL);
+            goto done;
+        }
+    }
+    ret = xmlSecBufferAppend(&bn, data, size);
     if(ret < 0) {
-        xmlSecXmlError("xmlStrPrintf", NULL);
-        xmlFree(res);
-        return(NULL);
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        goto done;
+    }
+
+    res = xmlSecBnToDecString(&bn);
+    if(res == NULL) {
+        xmlSecInternalError("xmlSecBnToDecString", NULL);
+        goto done;
     }
 
+done:
+    xmlSecBnFinalize(&bn);
     return(res);
 }
 
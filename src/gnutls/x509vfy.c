@@ -22,6 +22,12 @@
 #include <ctype.h>
 #include <errno.h>
 
+#include <gnutls/gnutls.h>
+#include <gnutls/crypto.h>
+#include <gnutls/x509.h>
+
+#include <libxml/threads.h>
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/keyinfo.h>
@@ -29,6 +35,7 @@
 #include <xmlsec/base64.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 
 #include <xmlsec/gnutls/crypto.h>
 #include <xmlsec/gnutls/x509.h>
@@ -36,6 +43,29 @@
 #include "private.h"
 #include "../cast_helpers.h"
 
+/**************************************************************************
+ *
+ * Verification results cache: the successful verifications are identified
+ * by the leaf cert fingerprint, the digest of the certs chain built from
+ * the document and the store untrusted certs, the verification flags and
+ * the verification time. The store trusted certs and CRLs are not part of
+ * the id, the cache is flushed when they change.
+ *
+ *************************************************************************/
+#define XMLSEC_GNUTLS_X509_VERIFY_CACHE_DIGEST          GNUTLS_DIG_SHA256
+#define XMLSEC_GNUTLS_X509_VERIFY_CACHE_DIGEST_SIZE     32
+
+typedef struct _xmlSecGnuTLSX509VerifyCacheEntry        xmlSecGnuTLSX509VerifyCacheEntry,
+                                                        *xmlSecGnuTLSX509VerifyCacheEntryPtr;
+struct _xmlSecGnuTLSX509VerifyCacheEntry {
+    int                 used;
+    xmlSecByte          leafDigest[XMLSEC_GNUTLS_X509_VERIFY_CACHE_DIGEST_SIZE];
+    xmlSecByte          chainDigest[XMLSEC_GNUTLS_X509_VERIFY_CACHE_DIGEST_SIZE];
+    unsigned int        flags;
+    time_t              verificationTime;
+    time_t              expires;
+};
+
 /**************************************************************************
  *
  * Internal GnuTLS X509 store CTX
@@ -47,6 +77,16 @@ struct _xmlSecGnuTLSX509StoreCtx {
     xmlSecPtrList certsTrusted;
     xmlSecPtrList certsUntrusted;
     xmlSecPtrList crls;
+
+    /* the copies of the trusted certs and the CRLs indexed by GnuTLS
+     * for the chains verification without the documents CRLs */
+    gnutls_x509_trust_list_t            trustList;
+
+    /* verification results cache (disabled by default) */
+    xmlMutexPtr                         verifyCacheMutex;
+    xmlSecGnuTLSX509VerifyCacheEntryPtr verifyCache;
+    xmlSecSize                          verifyCacheMaxSize;
+    xmlSecSize                          verifyCachePos;
 };
 
 /****************************************************************************
@@ -350,6 +390,222 @@ xmlSecGnuTLSX509CheckCrtsTime(const gnutls_x509_crt_t * cert_list, xmlSecSize ce
     return(1);
 }
 
+/* the caller is responsible for locking */
+static void
+xmlSecGnuTLSX509VerifyCacheFlush(xmlSecGnuTLSX509StoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache != NULL) {
+        memset(ctx->verifyCache, 0, sizeof(xmlSecGnuTLSX509VerifyCacheEntry) * ctx->verifyCacheMaxSize);
+    }
+    ctx->verifyCachePos = 0;
+}
+
+/* the store certs or CRLs have changed */
+static void
+xmlSecGnuTLSX509VerifyCacheReset(xmlSecGnuTLSX509StoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache == NULL) {
+        return;
+    }
+    xmlMutexLock(ctx->verifyCacheMutex);
+    xmlSecGnuTLSX509VerifyCacheFlush(ctx);
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
+/* prepares the cache entry (without expiration time) for the @cert_list chain verification */
+static int
+xmlSecGnuTLSX509VerifyCacheEntryInit(xmlSecGnuTLSX509VerifyCacheEntryPtr entry,
+    const gnutls_x509_crt_t * cert_list, xmlSecSize cert_list_size,
+    unsigned int flags, time_t verificationTime
+) {
+    gnutls_hash_hd_t hash = NULL;
+    xmlSecByte fingerprint[XMLSEC_GNUTLS_X509_VERIFY_CACHE_DIGEST_SIZE];
+    size_t fingerprintSize;
+    xmlSecSize ii;
+    int err;
+
+    xmlSecAssert2(entry != NULL, -1);
+    xmlSecAssert2(cert_list != NULL, -1);
+    xmlSecAssert2(cert_list_size > 0, -1);
+
+    memset(entry, 0, sizeof(xmlSecGnuTLSX509VerifyCacheEntry));
+    entry->flags = flags;
+    entry->verificationTime = verificationTime;
+
+    err = gnutls_hash_init(&hash, XMLSEC_GNUTLS_X509_VERIFY_CACHE_DIGEST);
+    if(err != GNUTLS_E_SUCCESS) {
+        xmlSecGnuTLSError("gnutls_hash_init", err, NULL);
+        return(-1);
+    }
+    for(ii = 0; ii < cert_list_size; ++ii) {
+        fingerprintSize = sizeof(fingerprint);
+        err = gnutls_x509_crt_get_fingerprint(cert_list[ii], XMLSEC_GNUTLS_X509_VERIFY_CACHE_DIGEST,
+            fingerprint, &fingerprintSize);
+        if((err != GNUTLS_E_SUCCESS) || (fingerprintSize != sizeof(fingerprint))) {
+            xmlSecGnuTLSError("gnutls_x509_crt_get_fingerprint", err, NULL);
+            gnutls_hash_deinit(hash, NULL);
+            return(-1);
+        }
+        if(ii == 0) {
+            memcpy(entry->leafDigest, fingerprint, sizeof(fingerprint));
+        }
+        err = gnutls_hash(hash, fingerprint, fingerprintSize);
+        if(err != GNUTLS_E_SUCCESS) {
+            xmlSecGnuTLSError("gnutls_hash", err, NULL);
+            gnutls_hash_deinit(hash, NULL);
+            return(-1);
+        }
+    }
+    gnutls_hash_deinit(hash, entry->chainDigest);
+    return(0);
+}
+
+/* returns 1 if @entry matches a not expired cache entry, 0 otherwise */
+static int
+xmlSecGnuTLSX509VerifyCacheFind(xmlSecGnuTLSX509StoreCtxPtr ctx, xmlSecGnuTLSX509VerifyCacheEntryPtr entry) {
+    xmlSecGnuTLSX509VerifyCacheEntryPtr cur;
+    time_t now;
+    xmlSecSize ii;
+    int res = 0;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(entry != NULL, 0);
+
+    if(ctx->verifyCache == NULL) {
+        return(0);
+    }
+
+    now = time(NULL);
+    xmlMutexLock(ctx->verifyCacheMutex);
+    for(ii = 0; ii < ctx->verifyCacheMaxSize; ++ii) {
+        cur = &(ctx->verifyCache[ii]);
+        if(cur->used == 0) {
+            continue;
+        }
+        if((cur->expires > 0) && (cur->expires <= now)) {
+            memset(cur, 0, sizeof(xmlSecGnuTLSX509VerifyCacheEntry));
+            continue;
+        }
+        if((cur->verificationTime == entry->verificationTime) && (cur->flags == entry->flags) &&
+           (memcmp(cur->leafDigest, entry->leafDigest, sizeof(cur->leafDigest)) == 0) &&
+           (memcmp(cur->chainDigest, entry->chainDigest, sizeof(cur->chainDigest)) == 0)
+        ) {
+            res = 1;
+            break;
+        }
+    }
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+
+    xmlSecStatsCacheLookup(xmlSecStatsCacheX509Verify, res);
+    return(res);
+}
+
+static void
+xmlSecGnuTLSX509VerifyCacheAdd(xmlSecGnuTLSX509StoreCtxPtr ctx, xmlSecGnuTLSX509VerifyCacheEntryPtr entry) {
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(entry != NULL);
+
+    if(ctx->verifyCache == NULL) {
+        return;
+    }
+
+    /* replace the oldest entry */
+    xmlMutexLock(ctx->verifyCacheMutex);
+    entry->used = 1;
+    memcpy(&(ctx->verifyCache[ctx->verifyCachePos]), entry, sizeof(xmlSecGnuTLSX509VerifyCacheEntry));
+    ctx->verifyCachePos = (ctx->verifyCachePos + 1) % ctx->verifyCacheMaxSize;
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
+/* returns the first expiration time of the chain certs, its trusted
+ * issuer or the next update of the store CRLs (0 if unknown) */
+static time_t
+xmlSecGnuTLSX509ChainGetExpires(xmlSecGnuTLSX509StoreCtxPtr ctx,
+    const gnutls_x509_crt_t * cert_list, xmlSecSize cert_list_size
+) {
+    gnutls_x509_crt_t issuer;
+    gnutls_x509_crl_t crl;
+    time_t tt, res = 0;
+    xmlSecSize ii, size;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(cert_list != NULL, 0);
+    xmlSecAssert2(cert_list_size > 0, 0);
+
+    for(ii = 0; ii < cert_list_size; ++ii) {
+        tt = gnutls_x509_crt_get_expiration_time(cert_list[ii]);
+        if(tt == (time_t)-1) {
+            return(0);
+        }
+        if((res == 0) || (tt < res)) {
+            res = tt;
+        }
+    }
+    issuer = xmlSecGnuTLSX509FindSignerCert(&(ctx->certsTrusted), cert_list[cert_list_size - 1]);
+    if(issuer != NULL) {
+        tt = gnutls_x509_crt_get_expiration_time(issuer);
+        if((tt != (time_t)-1) && (tt < res)) {
+            res = tt;
+        }
+    }
+    size = xmlSecPtrListGetSize(&(ctx->crls));
+    for(ii = 0; ii < size; ++ii) {
+        crl = xmlSecPtrListGetItem(&(ctx->crls), ii);
+        if(crl == NULL) {
+            continue;
+        }
+        tt = gnutls_x509_crl_get_next_update(crl);
+        if((tt != (time_t)-1) && (tt > 0) && (tt < res)) {
+            res = tt;
+        }
+    }
+    return(res);
+}
+
+/* adds the copies of the trusted cert or CRL to the trust list */
+static int
+xmlSecGnuTLSX509StoreTrustListAdd(xmlSecGnuTLSX509StoreCtxPtr ctx, gnutls_x509_crt_t cert, gnutls_x509_crl_t crl) {
+    gnutls_x509_crt_t certCopy;
+    gnutls_x509_crl_t crlCopy;
+    int err;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2((cert != NULL) || (crl != NULL), -1);
+
+    if(ctx->trustList == NULL) {
+        return(0);
+    }
+    if(cert != NULL) {
+        certCopy = xmlSecGnuTLSX509CertDup(cert);
+        if(certCopy == NULL) {
+            xmlSecInternalError("xmlSecGnuTLSX509CertDup", NULL);
+            return(-1);
+        }
+        err = gnutls_x509_trust_list_add_cas(ctx->trustList, &certCopy, 1, 0);
+        if(err != 1) {
+            xmlSecGnuTLSError("gnutls_x509_trust_list_add_cas", err, NULL);
+            gnutls_x509_crt_deinit(certCopy);
+            return(-1);
+        }
+    }
+    if(crl != NULL) {
+        crlCopy = xmlSecGnuTLSX509CrlDup(crl);
+        if(crlCopy == NULL) {
+            xmlSecInternalError("xmlSecGnuTLSX509CrlDup", NULL);
+            return(-1);
+        }
+        err = gnutls_x509_trust_list_add_crls(ctx->trustList, &crlCopy, 1, 0, 0);
+        if(err != 1) {
+            xmlSecGnuTLSError("gnutls_x509_trust_list_add_crls", err, NULL);
+            gnutls_x509_crl_deinit(crlCopy);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
 /**
  * xmlSecGnuTLSX509StoreVerify:
  * @store:              the pointer to X509 key data store klass.
@@ -357,7 +613,10 @@ xmlSecGnuTLSX509CheckCrtsTime(const gnutls_x509_crt_t * cert_list, xmlSecSize ce
  * @crls:               the crls.
  * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; element processing context.
  *
- * Verifies @certs list.
+ * Verifies @certs list. If @crls list is empty then the chains are verified
+ * against the store trust list (and the results are cached if the verification
+ * cache is enabled), otherwise the store trusted certs and CRLs are combined
+ * with @crls for each verification.
  *
  * Returns: pointer to the first verified certificate from @certs.
  */
@@ -380,6 +639,9 @@ xmlSecGnuTLSX509StoreVerify(xmlSecKeyDataStorePtr store,
     xmlSecSize ca_list_size;
     time_t verification_time;
     unsigned int flags = 0;
+    int useTrustList;
+    xmlSecGnuTLSX509VerifyCacheEntry cacheEntry;
+    int useCache;
     xmlSecSize ii;
     int ret;
     int err;
@@ -415,8 +677,13 @@ xmlSecGnuTLSX509StoreVerify(xmlSecKeyDataStorePtr store,
         }
     }
 
+    /* the documents CRLs are not in the store trust list */
     crl_list_size = xmlSecPtrListGetSize(crls);
-    crl_ctx_list_size = xmlSecPtrListGetSize(&(ctx->crls));
+    useTrustList = (crl_list_size == 0) ? 1 : 0;
+    useCache = ((useTrustList != 0) && (ctx->verifyCache != NULL) &&
+        ((keyInfoCtx->flags & XMLSEC_KEYINFO_FLAGS_X509DATA_DONT_VERIFY_CERTS) == 0)) ? 1 : 0;
+
+    crl_ctx_list_size = (useTrustList == 0) ? xmlSecPtrListGetSize(&(ctx->crls)) : 0;
     if((crl_list_size + crl_ctx_list_size) > 0) {
         crl_list = (gnutls_x509_crl_t *)xmlMalloc(sizeof(gnutls_x509_crl_t) * (crl_list_size + crl_ctx_list_size));
         if(crl_list == NULL) {
@@ -444,7 +711,7 @@ xmlSecGnuTLSX509StoreVerify(xmlSecKeyDataStorePtr store,
         }
     }
 
-    ca_list_size = xmlSecPtrListGetSize(&(ctx->certsTrusted));
+    ca_list_size = (useTrustList == 0) ? xmlSecPtrListGetSize(&(ctx->certsTrusted)) : 0;
     if(ca_list_size > 0) {
         ca_list = (gnutls_x509_crt_t *)xmlMalloc(sizeof(gnutls_x509_crt_t) * ca_list_size);
         if(ca_list == NULL) {
@@ -516,8 +783,35 @@ xmlSecGnuTLSX509StoreVerify(xmlSecKeyDataStorePtr store,
             cert2 = tmp;
         }
 
+        /* check if we verified this chain before */
+        if(useCache != 0) {
+            ret = xmlSecGnuTLSX509VerifyCacheEntryInit(&cacheEntry, cert_list, cert_list_cur_size,
+                flags, keyInfoCtx->certsVerificationTime);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecGnuTLSX509VerifyCacheEntryInit",
+                    xmlSecKeyDataStoreGetName(store));
+                goto done;
+            }
+            if(xmlSecGnuTLSX509VerifyCacheFind(ctx, &cacheEntry) == 1) {
+                res = cert;
+                break;
+            }
+        }
+
         /* try to verify */
-        if((keyInfoCtx->flags & XMLSEC_KEYINFO_FLAGS_X509DATA_DONT_VERIFY_CERTS) == 0) {
+        if((keyInfoCtx->flags & XMLSEC_KEYINFO_FLAGS_X509DATA_DONT_VERIFY_CERTS) != 0) {
+            err = GNUTLS_E_SUCCESS;
+        } else if(useTrustList != 0) {
+            unsigned int cert_list_cur_len;
+
+            XMLSEC_SAFE_CAST_SIZE_TO_UINT(cert_list_cur_size, cert_list_cur_len, goto done, NULL);
+
+            err = gnutls_x509_trust_list_verify_crt(ctx->trustList,
+                    cert_list, cert_list_cur_len, /* certs chain */
+                    flags, /* flags */
+                    &verify,
+                    NULL);
+        } else {
             unsigned int cert_list_cur_len, ca_list_len, crl_list_len;
 
             XMLSEC_SAFE_CAST_SIZE_TO_UINT(cert_list_cur_size, cert_list_cur_len, goto done, NULL);
@@ -530,8 +824,6 @@ xmlSecGnuTLSX509StoreVerify(xmlSecKeyDataStorePtr store,
                     crl_list, crl_list_len, /* crls */
                     flags, /* flags */
                     &verify);
-        } else {
-            err = GNUTLS_E_SUCCESS;
         }
         if(err != GNUTLS_E_SUCCESS) {
             xmlSecGnuTLSError("gnutls_x509_crt_list_verify", err, NULL);
@@ -553,6 +845,16 @@ xmlSecGnuTLSX509StoreVerify(xmlSecKeyDataStorePtr store,
             continue;
         }
 
+        /* current time results expire with the chain, fixed time results never expire */
+        if(useCache != 0) {
+            if(keyInfoCtx->certsVerificationTime <= 0) {
+                cacheEntry.expires = xmlSecGnuTLSX509ChainGetExpires(ctx, cert_list, cert_list_cur_size);
+            }
+            if((keyInfoCtx->certsVerificationTime > 0) || (cacheEntry.expires > 0)) {
+                xmlSecGnuTLSX509VerifyCacheAdd(ctx, &cacheEntry);
+            }
+        }
+
         /* DONE! */
         res = cert;
     }
@@ -594,6 +896,12 @@ xmlSecGnuTLSX509StoreAdoptCert(xmlSecKeyDataStorePtr store, gnutls_x509_crt_t ce
     xmlSecAssert2(ctx != NULL, -1);
 
     if((type & xmlSecKeyDataTypeTrusted) != 0) {
+        ret = xmlSecGnuTLSX509StoreTrustListAdd(ctx, cert, NULL);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecGnuTLSX509StoreTrustListAdd(cert)",
+                                xmlSecKeyDataStoreGetName(store));
+            return(-1);
+        }
         ret = xmlSecPtrListAdd(&(ctx->certsTrusted), cert);
         if(ret < 0) {
             xmlSecInternalError("xmlSecPtrListAdd(trusted)",
@@ -608,6 +916,7 @@ xmlSecGnuTLSX509StoreAdoptCert(xmlSecKeyDataStorePtr store, gnutls_x509_crt_t ce
             return(-1);
         }
     }
+    xmlSecGnuTLSX509VerifyCacheReset(ctx);
 
     /* done */
     return(0);
@@ -634,21 +943,99 @@ xmlSecGnuTLSX509StoreAdoptCrl(xmlSecKeyDataStorePtr store, gnutls_x509_crl_t crl
     ctx = xmlSecGnuTLSX509StoreGetCtx(store);
     xmlSecAssert2(ctx != NULL, -1);
 
-   ret = xmlSecPtrListAdd(&(ctx->crls), crl);
+    ret = xmlSecGnuTLSX509StoreTrustListAdd(ctx, NULL, crl);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecGnuTLSX509StoreTrustListAdd(crl)", xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+    ret = xmlSecPtrListAdd(&(ctx->crls), crl);
     if(ret < 0) {
         xmlSecInternalError("xmlSecPtrListAdd(crls)", xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
+    xmlSecGnuTLSX509VerifyCacheReset(ctx);
 
     /* done */
     return(0);
 }
 
 
+/**
+ * xmlSecGnuTLSX509StoreEnableVerifyCache:
+ * @store:              the pointer to X509 key data store klass.
+ * @maxSize:            the max number of cached verification results.
+ *
+ * Enables the cache of the successful certificates chains verifications
+ * against the store trust list (the chains verified with the documents
+ * CRLs are never cached). The results for the current time expire
+ * at the earliest expiration time of the chain certificates or the
+ * next update time of the store CRLs. The cache is flushed when
+ * a certificate or CRL is added to the store.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecGnuTLSX509StoreEnableVerifyCache(xmlSecKeyDataStorePtr store, xmlSecSize maxSize) {
+    xmlSecGnuTLSX509StoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecGnuTLSX509StoreId), -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    ctx = xmlSecGnuTLSX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    xmlSecGnuTLSX509StoreDisableVerifyCache(store);
+
+    ctx->verifyCacheMutex = xmlNewMutex();
+    if(ctx->verifyCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+    ctx->verifyCache = (xmlSecGnuTLSX509VerifyCacheEntryPtr)xmlMalloc(sizeof(xmlSecGnuTLSX509VerifyCacheEntry) * maxSize);
+    if(ctx->verifyCache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecGnuTLSX509VerifyCacheEntry) * maxSize,
+            xmlSecKeyDataStoreGetName(store));
+        xmlFreeMutex(ctx->verifyCacheMutex);
+        ctx->verifyCacheMutex = NULL;
+        return(-1);
+    }
+    ctx->verifyCacheMaxSize = maxSize;
+    xmlSecGnuTLSX509VerifyCacheFlush(ctx);
+    return(0);
+}
+
+/**
+ * xmlSecGnuTLSX509StoreDisableVerifyCache:
+ * @store:              the pointer to X509 key data store klass.
+ *
+ * Disables and frees the verification results cache (if any).
+ */
+void
+xmlSecGnuTLSX509StoreDisableVerifyCache(xmlSecKeyDataStorePtr store) {
+    xmlSecGnuTLSX509StoreCtxPtr ctx;
+
+    xmlSecAssert(xmlSecKeyDataStoreCheckId(store, xmlSecGnuTLSX509StoreId));
+
+    ctx = xmlSecGnuTLSX509StoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache != NULL) {
+        xmlFree(ctx->verifyCache);
+        ctx->verifyCache = NULL;
+    }
+    if(ctx->verifyCacheMutex != NULL) {
+        xmlFreeMutex(ctx->verifyCacheMutex);
+        ctx->verifyCacheMutex = NULL;
+    }
+    ctx->verifyCacheMaxSize = 0;
+    ctx->verifyCachePos = 0;
+}
+
 static int
 xmlSecGnuTLSX509StoreInitialize(xmlSecKeyDataStorePtr store) {
     xmlSecGnuTLSX509StoreCtxPtr ctx;
     int ret;
+    int err;
 
     xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecGnuTLSX509StoreId), -1);
 
@@ -678,6 +1065,13 @@ xmlSecGnuTLSX509StoreInitialize(xmlSecKeyDataStorePtr store) {
         return(-1);
     }
 
+    err = gnutls_x509_trust_list_init(&(ctx->trustList), 0);
+    if(err != GNUTLS_E_SUCCESS) {
+        xmlSecGnuTLSError("gnutls_x509_trust_list_init", err,
+                          xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+
     return(0);
 }
 
@@ -689,6 +1083,10 @@ xmlSecGnuTLSX509StoreFinalize(xmlSecKeyDataStorePtr store) {
     ctx = xmlSecGnuTLSX509StoreGetCtx(store);
     xmlSecAssert(ctx != NULL);
 
+    xmlSecGnuTLSX509StoreDisableVerifyCache(store);
+    if(ctx->trustList != NULL) {
+        gnutls_x509_trust_list_deinit(ctx->trustList, 1);
+    }
     xmlSecPtrListFinalize(&(ctx->certsTrusted));
     xmlSecPtrListFinalize(&(ctx->certsUntrusted));
     xmlSecPtrListFinalize(&(ctx->crls));
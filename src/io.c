@@ -49,6 +49,8 @@
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "filemap.h"
+#include "transform_helpers.h"
 
 /*******************************************************************
  *
@@ -60,17 +62,27 @@ typedef struct _xmlSecIOCallback {
     xmlInputOpenCallback opencallback;
     xmlInputReadCallback readcallback;
     xmlInputCloseCallback closecallback;
+    xmlSecIOWaitFdCallback waitfdcallback;
+    xmlSecIOPackagePartOpenCallback packageopencallback;
+    void* packagectx;
+    xmlChar* memuri;
+    const xmlSecByte* memdata;
+    xmlSecSize memdatasize;
 } xmlSecIOCallback, *xmlSecIOCallbackPtr;
 
 static xmlSecIOCallbackPtr      xmlSecIOCallbackCreate  (xmlInputMatchCallback matchFunc,
                                                          xmlInputOpenCallback openFunc,
                                                          xmlInputReadCallback readFunc,
-                                                         xmlInputCloseCallback closeFunc);
+                                                         xmlInputCloseCallback closeFunc,
+                                                         xmlSecIOWaitFdCallback waitFdFunc);
 static void                     xmlSecIOCallbackDestroy (xmlSecIOCallbackPtr callbacks);
+static void*                    xmlSecIOCallbackOpen    (xmlSecIOCallbackPtr callbacks,
+                                                         const char* uri);
 
 static xmlSecIOCallbackPtr
 xmlSecIOCallbackCreate(xmlInputMatchCallback matchFunc, xmlInputOpenCallback openFunc,
-                       xmlInputReadCallback readFunc, xmlInputCloseCallback closeFunc) {
+                       xmlInputReadCallback readFunc, xmlInputCloseCallback closeFunc,
+                       xmlSecIOWaitFdCallback waitFdFunc) {
     xmlSecIOCallbackPtr callbacks;
 
     xmlSecAssert2(matchFunc != NULL, NULL);
@@ -87,6 +99,7 @@ xmlSecIOCallbackCreate(xmlInputMatchCallback matchFunc, xmlInputOpenCallback ope
     callbacks->opencallback  = openFunc;
     callbacks->readcallback  = readFunc;
     callbacks->closecallback = closeFunc;
+    callbacks->waitfdcallback = waitFdFunc;
 
     return(callbacks);
 }
@@ -95,10 +108,51 @@ static void
 xmlSecIOCallbackDestroy(xmlSecIOCallbackPtr callbacks) {
     xmlSecAssert(callbacks != NULL);
 
+    if(callbacks->memuri != NULL) {
+        xmlFree(callbacks->memuri);
+    }
     memset(callbacks, 0, sizeof(xmlSecIOCallback));
     xmlFree(callbacks);
 }
 
+static void*
+xmlSecIOCallbackOpen(xmlSecIOCallbackPtr callbacks, const char* uri) {
+    xmlChar* partName;
+    const char* query;
+    int len;
+    void* res;
+
+    xmlSecAssert2(callbacks != NULL, NULL);
+    xmlSecAssert2(uri != NULL, NULL);
+
+    if(callbacks->packageopencallback == NULL) {
+        return((callbacks->opencallback != NULL) ? callbacks->opencallback(uri) : NULL);
+    }
+
+    /* the package part name is the URI without the query (e.g. "?ContentType=...") */
+    query = strchr(uri, '?');
+    if(query == NULL) {
+        return(callbacks->packageopencallback(callbacks->packagectx, BAD_CAST uri));
+    }
+    XMLSEC_SAFE_CAST_PTRDIFF_TO_INT((query - uri), len, return(NULL), NULL);
+    partName = xmlStrndup(BAD_CAST uri, len);
+    if(partName == NULL) {
+        xmlSecStrdupError(BAD_CAST uri, NULL);
+        return(NULL);
+    }
+    res = callbacks->packageopencallback(callbacks->packagectx, partName);
+    xmlFree(partName);
+    return(res);
+}
+
+/* the package part names are absolute paths within the package (but not network paths) */
+static int
+xmlSecIOPackagePartMatch(const char* uri) {
+    xmlSecAssert2(uri != NULL, 0);
+
+    return(((uri[0] == '/') && (uri[1] != '/')) ? 1 : 0);
+}
+
 /*******************************************************************
  *
  * Input I/O callback list
@@ -112,23 +166,193 @@ static xmlSecPtrListKlass xmlSecIOCallbackPtrListKlass = {
     NULL                                                /* xmlSecPtrDebugDumpItemMethod debugXmlDumpItem; */
 };
 
-#define xmlSecIOCallbackPtrListId       xmlSecIOCallbackPtrListGetKlass ()
-static xmlSecPtrListId                  xmlSecIOCallbackPtrListGetKlass (void);
 static xmlSecIOCallbackPtr              xmlSecIOCallbackPtrListFind     (xmlSecPtrListPtr list,
                                                                          const char* uri);
+static xmlSecIOCallbackPtr              xmlSecIOCallbackFind            (xmlSecPtrListPtr ioCallbacks,
+                                                                         const char* uri);
 
 /**
  * xmlSecIOCallbackPtrListGetKlass:
  *
- * The keys list klass.
+ * The I/O callbacks list klass.
  *
- * Returns: keys list id.
+ * Returns: I/O callbacks list id.
  */
-static xmlSecPtrListId
+xmlSecPtrListId
 xmlSecIOCallbackPtrListGetKlass(void) {
     return(&xmlSecIOCallbackPtrListKlass);
 }
 
+/**
+ * xmlSecIOCallbackPtrListAdd:
+ * @list:               the pointer to I/O callbacks list (#xmlSecIOCallbackPtrListId).
+ * @matchFunc:          the protocol match callback.
+ * @openFunc:           the open stream callback.
+ * @readFunc:           the read from stream callback.
+ * @closeFunc:          the close stream callback.
+ *
+ * Adds a new set of I/O callbacks to the @list. The callbacks added
+ * later are picked up first.
+ *
+ * Returns: the 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecIOCallbackPtrListAdd(xmlSecPtrListPtr list, xmlInputMatchCallback matchFunc,
+        xmlInputOpenCallback openFunc, xmlInputReadCallback readFunc,
+        xmlInputCloseCallback closeFunc) {
+    int ret;
+
+    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecIOCallbackPtrListId), -1);
+    xmlSecAssert2(matchFunc != NULL, -1);
+
+    ret = xmlSecIOCallbackPtrListAddAsync(list, matchFunc, openFunc, readFunc, closeFunc, NULL);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecIOCallbackPtrListAddAsync", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecIOCallbackPtrListAddAsync:
+ * @list:               the pointer to I/O callbacks list (#xmlSecIOCallbackPtrListId).
+ * @matchFunc:          the protocol match callback.
+ * @openFunc:           the open stream callback.
+ * @readFunc:           the read from stream callback that can return
+ *                      #XMLSEC_IO_WOULD_BLOCK.
+ * @closeFunc:          the close stream callback.
+ * @waitFdFunc:         the callback that returns the file descriptor to wait
+ *                      on after @readFunc returned #XMLSEC_IO_WOULD_BLOCK.
+ *
+ * Adds a new set of non-blocking I/O callbacks to the @list. The streams
+ * opened with these callbacks can be processed by
+ * #xmlSecTransformCtxUriExecuteStart and #xmlSecTransformCtxUriExecuteResume
+ * without blocking the calling thread; #xmlSecTransformCtxUriExecute treats
+ * #XMLSEC_IO_WOULD_BLOCK as an error.
+ *
+ * Returns: the 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecIOCallbackPtrListAddAsync(xmlSecPtrListPtr list, xmlInputMatchCallback matchFunc,
+        xmlInputOpenCallback openFunc, xmlInputReadCallback readFunc,
+        xmlInputCloseCallback closeFunc, xmlSecIOWaitFdCallback waitFdFunc) {
+    xmlSecIOCallbackPtr callbacks;
+    int ret;
+
+    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecIOCallbackPtrListId), -1);
+    xmlSecAssert2(matchFunc != NULL, -1);
+
+    callbacks = xmlSecIOCallbackCreate(matchFunc, openFunc, readFunc, closeFunc, waitFdFunc);
+    if(callbacks == NULL) {
+        xmlSecInternalError("xmlSecIOCallbackCreate", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecPtrListAdd(list, callbacks);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListAdd", NULL);
+        xmlSecIOCallbackDestroy(callbacks);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecIOCallbackPtrListAddPackage:
+ * @list:               the pointer to I/O callbacks list (#xmlSecIOCallbackPtrListId).
+ * @openFunc:           the open package part callback.
+ * @readFunc:           the read from package part callback.
+ * @closeFunc:          the close package part callback.
+ * @packageCtx:         the package context passed to @openFunc.
+ *
+ * Adds a new set of I/O callbacks that read the OPC (e.g. OOXML) package parts
+ * directly from the package container (e.g. a zip archive opened by the application)
+ * to the @list. The callbacks handle the package part name URIs, i.e. all the
+ * absolute paths (e.g. "/word/document.xml?ContentType=..."): the query part is
+ * removed and the part name is passed to @openFunc. The callbacks might be
+ * called from different threads if the #xmlSecDSigCtx.referencesExecutor is used.
+ *
+ * Returns: the 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecIOCallbackPtrListAddPackage(xmlSecPtrListPtr list, xmlSecIOPackagePartOpenCallback openFunc,
+        xmlInputReadCallback readFunc, xmlInputCloseCallback closeFunc, void* packageCtx) {
+    xmlSecIOCallbackPtr callbacks;
+    int ret;
+
+    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecIOCallbackPtrListId), -1);
+    xmlSecAssert2(openFunc != NULL, -1);
+    xmlSecAssert2(readFunc != NULL, -1);
+
+    callbacks = xmlSecIOCallbackCreate(xmlSecIOPackagePartMatch, NULL, readFunc, closeFunc, NULL);
+    if(callbacks == NULL) {
+        xmlSecInternalError("xmlSecIOCallbackCreate", NULL);
+        return(-1);
+    }
+    callbacks->packageopencallback = openFunc;
+    callbacks->packagectx = packageCtx;
+
+    ret = xmlSecPtrListAdd(list, callbacks);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListAdd", NULL);
+        xmlSecIOCallbackDestroy(callbacks);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecIOCallbackPtrListAddMemory:
+ * @list:               the pointer to I/O callbacks list (#xmlSecIOCallbackPtrListId).
+ * @uri:                the URI (e.g. "cid:part1@example.com").
+ * @data:               the data.
+ * @dataSize:           the data size.
+ *
+ * Adds the memory view for the @uri to the @list: e.g. the raw octets of a MIME
+ * part referenced by a "cid:" URI (RFC 2392) from the SOAP with Attachments
+ * &lt;dsig:Reference/&gt; nodes or from the MTOM/XOP &lt;xop:Include/&gt; elements
+ * in the &lt;enc:CipherValue/&gt; nodes. The URI should match the reference URI
+ * exactly (after the URI unescaping). The @data is not copied and should stay
+ * valid until the @list is destroyed; it is pushed to the transforms chain at once
+ * (e.g. directly to the digest) without the base64 encoding and decoding.
+ *
+ * Returns: the 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecIOCallbackPtrListAddMemory(xmlSecPtrListPtr list, const xmlChar* uri,
+        const xmlSecByte* data, xmlSecSize dataSize) {
+    xmlSecIOCallbackPtr callbacks;
+    int ret;
+
+    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecIOCallbackPtrListId), -1);
+    xmlSecAssert2(uri != NULL, -1);
+    xmlSecAssert2((data != NULL) || (dataSize == 0), -1);
+
+    callbacks = (xmlSecIOCallbackPtr)xmlMalloc(sizeof(xmlSecIOCallback));
+    if(callbacks == NULL) {
+        xmlSecMallocError(sizeof(xmlSecIOCallback), NULL);
+        return(-1);
+    }
+    memset(callbacks, 0, sizeof(xmlSecIOCallback));
+
+    callbacks->memuri = xmlStrdup(uri);
+    if(callbacks->memuri == NULL) {
+        xmlSecStrdupError(uri, NULL);
+        xmlSecIOCallbackDestroy(callbacks);
+        return(-1);
+    }
+    callbacks->memdata = data;
+    callbacks->memdatasize = dataSize;
+
+    ret = xmlSecPtrListAdd(list, callbacks);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListAdd", NULL);
+        xmlSecIOCallbackDestroy(callbacks);
+        return(-1);
+    }
+    return(0);
+}
+
 static xmlSecIOCallbackPtr
 xmlSecIOCallbackPtrListFind(xmlSecPtrListPtr list, const char* uri) {
     xmlSecIOCallbackPtr callbacks;
@@ -142,6 +366,14 @@ xmlSecIOCallbackPtrListFind(xmlSecPtrListPtr list, const char* uri) {
     for(i = size; i > 0; --i) {
         callbacks = (xmlSecIOCallbackPtr)xmlSecPtrListGetItem(list, i - 1);
         xmlSecAssert2(callbacks != NULL, NULL);
+
+        /* the memory views match the exact URI */
+        if(callbacks->memuri != NULL) {
+            if(xmlStrEqual(callbacks->memuri, BAD_CAST uri)) {
+                return(callbacks);
+            }
+            continue;
+        }
         xmlSecAssert2(callbacks->matchcallback != NULL, NULL);
 
         if((callbacks->matchcallback(uri)) != 0) {
@@ -153,6 +385,25 @@ xmlSecIOCallbackPtrListFind(xmlSecPtrListPtr list, const char* uri) {
 
 static xmlSecPtrList xmlSecAllIOCallbacks;
 
+/* the context callbacks (if any) take precedence over the global ones */
+static xmlSecIOCallbackPtr
+xmlSecIOCallbackFind(xmlSecPtrListPtr ioCallbacks, const char* uri) {
+    xmlSecIOCallbackPtr callbacks;
+
+    xmlSecAssert2(uri != NULL, NULL);
+
+    if(ioCallbacks != NULL) {
+        callbacks = xmlSecIOCallbackPtrListFind(ioCallbacks, uri);
+        if(callbacks != NULL) {
+            return(callbacks);
+        }
+    }
+    return(xmlSecIOCallbackPtrListFind(&xmlSecAllIOCallbacks, uri));
+}
+
+static xmlSecIOPrefetchCallback xmlSecIOPrefetchFunc = NULL;
+static void* xmlSecIOPrefetchCtx = NULL;
+
 /**
  * xmlSecIOInit:
  *
@@ -207,6 +458,8 @@ xmlSecIOShutdown(void) {
 #endif /* XMLSEC_NO_FTP */
 
     xmlSecPtrListFinalize(&xmlSecAllIOCallbacks);
+    xmlSecIOPrefetchFunc = NULL;
+    xmlSecIOPrefetchCtx = NULL;
 }
 
 /**
@@ -227,7 +480,10 @@ xmlSecIOCleanupCallbacks(void) {
  * @readFunc:           the read from stream callback.
  * @closeFunc:          the close stream callback.
  *
- * Register a new set of I/O callback for handling parser input.
+ * Register a new set of I/O callback for handling parser input. The global
+ * callbacks are shared by all the transform contexts; use
+ * #xmlSecIOCallbackPtrListAdd and the @ioCallbacks member of #xmlSecTransformCtx
+ * to set up the callbacks for one context only.
  *
  * Returns: the 0 on success or a negative value if an error occurs.
  */
@@ -235,27 +491,78 @@ int
 xmlSecIORegisterCallbacks(xmlInputMatchCallback matchFunc,
         xmlInputOpenCallback openFunc, xmlInputReadCallback readFunc,
         xmlInputCloseCallback closeFunc) {
-    xmlSecIOCallbackPtr callbacks;
     int ret;
 
     xmlSecAssert2(matchFunc != NULL, -1);
 
-    callbacks = xmlSecIOCallbackCreate(matchFunc, openFunc, readFunc, closeFunc);
-    if(callbacks == NULL) {
-        xmlSecInternalError("xmlSecIOCallbackCreate", NULL);
+    ret = xmlSecIOCallbackPtrListAdd(&xmlSecAllIOCallbacks, matchFunc, openFunc, readFunc, closeFunc);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecIOCallbackPtrListAdd", NULL);
         return(-1);
     }
+    return(0);
+}
+
+
+/**
+ * xmlSecIORegisterPrefetchCallback:
+ * @prefetchFunc:       the prefetch callback or NULL to remove the current one.
+ * @context:            the context passed to @prefetchFunc.
+ *
+ * Registers the callback that gets all the external URIs of a signature
+ * before they are opened (see #xmlSecIOPrefetchCallback). Only one prefetch
+ * callback can be registered, it replaces the previous one. Like the other
+ * I/O callbacks, it should be registered before processing any signatures.
+ *
+ * Returns: the 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecIORegisterPrefetchCallback(xmlSecIOPrefetchCallback prefetchFunc, void* context) {
+    xmlSecIOPrefetchFunc = prefetchFunc;
+    xmlSecIOPrefetchCtx = (prefetchFunc != NULL) ? context : NULL;
+    return(0);
+}
+
+/**
+ * xmlSecIOHasPrefetchCallback:
+ *
+ * Checks if the prefetch callback is registered.
+ *
+ * Returns: 1 if the prefetch callback is registered or 0 otherwise.
+ */
+int
+xmlSecIOHasPrefetchCallback(void) {
+    return((xmlSecIOPrefetchFunc != NULL) ? 1 : 0);
+}
+
+/**
+ * xmlSecIOPrefetch:
+ * @uris:               the external URIs (without the fragment part).
+ * @urisSize:           the number of URIs in @uris.
+ *
+ * Passes the @uris to the registered prefetch callback, if any.
+ *
+ * Returns: the 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecIOPrefetch(const xmlChar** uris, xmlSecSize urisSize) {
+    int ret;
+
+    xmlSecAssert2(uris != NULL, -1);
+
+    if((xmlSecIOPrefetchFunc == NULL) || (urisSize == 0)) {
+        return(0);
+    }
 
-    ret = xmlSecPtrListAdd(&xmlSecAllIOCallbacks, callbacks);
+    ret = xmlSecIOPrefetchFunc(xmlSecIOPrefetchCtx, uris, urisSize);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecPtrListAdd", NULL);
-        xmlSecIOCallbackDestroy(callbacks);
+        xmlSecInternalError2("xmlSecIOPrefetchFunc", NULL,
+            "urisSize=" XMLSEC_SIZE_FMT, urisSize);
         return(-1);
     }
     return(0);
 }
 
-
 /**
  * xmlSecIORegisterDefaultCallbacks:
  *
@@ -311,6 +618,12 @@ typedef struct _xmlSecInputURICtx                               xmlSecInputURICt
 struct _xmlSecInputURICtx {
     xmlSecIOCallbackPtr         clbks;
     void*                       clbksCtx;
+    xmlSecFileMap               map;
+    xmlSecSize                  mapPos;
+    int                         mapped;
+    int                         memView;    /* the map is the memory view, not the file mapping */
+    int                         async;
+    int                         wouldBlock;
 };
 
 XMLSEC_TRANSFORM_DECLARE(InputUri, xmlSecInputURICtx)
@@ -323,6 +636,11 @@ static int              xmlSecTransformInputURIPopBin           (xmlSecTransform
                                                                  xmlSecSize maxDataSize,
                                                                  xmlSecSize* dataSize,
                                                                  xmlSecTransformCtxPtr transformCtx);
+#ifndef XMLSEC_NO_FILES
+static int              xmlSecTransformInputURIOpenMapped       (xmlSecInputURICtxPtr ctx,
+                                                                 const xmlChar* uri,
+                                                                 xmlSecPtrListPtr ioCallbacks);
+#endif /* XMLSEC_NO_FILES */
 
 static xmlSecTransformKlass xmlSecTransformInputURIKlass = {
     /* klass/object sizes */
@@ -363,6 +681,181 @@ xmlSecTransformInputURIGetKlass(void) {
     return(&xmlSecTransformInputURIKlass);
 }
 
+#ifndef XMLSEC_NO_FILES
+/* returns 1 if the file is mapped or 0 if the regular callbacks should be used */
+static int
+xmlSecTransformInputURIOpenMapped(xmlSecInputURICtxPtr ctx, const xmlChar* uri,
+                                  xmlSecPtrListPtr ioCallbacks) {
+    xmlSecIOCallbackPtr clbks;
+    char* unescaped;
+    char* filename;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(ctx->mapped == 0, 0);
+    xmlSecAssert2(uri != NULL, 0);
+
+    /* same lookup as below: the user defined handlers take precedence */
+    unescaped = xmlURIUnescapeString((char*)uri, 0, NULL);
+    if(unescaped == NULL) {
+        return(0);
+    }
+    clbks = xmlSecIOCallbackFind(ioCallbacks, unescaped);
+    xmlFree(unescaped);
+    if((clbks == NULL) || (clbks->matchcallback != xmlFileMatch)) {
+        return(0);
+    }
+
+    filename = xmlSecFileUriToPath(uri);
+    if(filename == NULL) {
+        return(0);
+    }
+    ret = xmlSecFileMapOpen(&(ctx->map), filename);
+    xmlFree(filename);
+    if(ret != 1) {
+        return(0);
+    }
+
+    ctx->mapPos = 0;
+    ctx->mapped = 1;
+    return(1);
+}
+
+/**
+ * xmlSecTransformInputURIPumpMapped:
+ * @transform:          the pointer to IO transform.
+ * @right:              the destination transform.
+ * @transformCtx:       the pointer to transform context object.
+ *
+ * Pushes the whole memory mapped file opened by @transform into @right
+ * at once (e.g. to a digest) instead of copying it chunk by chunk thru
+ * the pump buffer.
+ *
+ * Returns: 1 if the data was pushed, 0 if @transform is not a mapped file
+ * or a negative value if an error occurs.
+ */
+int
+xmlSecTransformInputURIPumpMapped(xmlSecTransformPtr transform, xmlSecTransformPtr right,
+                                  xmlSecTransformCtxPtr transformCtx) {
+    xmlSecInputURICtxPtr ctx;
+    xmlSecTransformDataType rightType;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformInputURIId), -1);
+    xmlSecAssert2(xmlSecTransformIsValid(right), -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    ctx = xmlSecInputUriGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    if((ctx->mapped == 0) || (ctx->mapPos != 0)) {
+        return(0);
+    }
+    rightType = xmlSecTransformGetDataType(right, xmlSecTransformModePush, transformCtx);
+    if((rightType & xmlSecTransformDataTypeBin) == 0) {
+        return(0);
+    }
+
+    ctx->mapPos = ctx->map.size;
+    ret = xmlSecTransformPushBin(right, ctx->map.data, ctx->map.size, 1, transformCtx);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecTransformPushBin", xmlSecTransformGetName(right),
+            "size=" XMLSEC_SIZE_FMT, ctx->map.size);
+        return(-1);
+    }
+    return(1);
+}
+#endif /* XMLSEC_NO_FILES */
+
+/**
+ * xmlSecTransformInputURIPopBinAsync:
+ * @transform:          the pointer to IO transform.
+ * @data:               the buffer to store the data.
+ * @maxDataSize:        the size of the @data buffer.
+ * @dataSize:           the pointer to the number of bytes read (0 at the end of the stream).
+ * @transformCtx:       the pointer to transform context object.
+ *
+ * Reads the next chunk from @transform without blocking if the stream
+ * was opened with the non-blocking callbacks (see #xmlSecIOCallbackPtrListAddAsync).
+ *
+ * Returns: 1 if no data is available yet, 0 if the data (or the end of the
+ * stream) was read or a negative value if an error occurs.
+ */
+int
+xmlSecTransformInputURIPopBinAsync(xmlSecTransformPtr transform, xmlSecByte* data,
+                                   xmlSecSize maxDataSize, xmlSecSize* dataSize,
+                                   xmlSecTransformCtxPtr transformCtx) {
+    xmlSecInputURICtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformInputURIId), -1);
+    xmlSecAssert2(dataSize != NULL, -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    ctx = xmlSecInputUriGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    ctx->async = 1;
+    ctx->wouldBlock = 0;
+    ret = xmlSecTransformPopBin(transform, data, maxDataSize, dataSize, transformCtx);
+    ctx->async = 0;
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformPopBin", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    return((ctx->wouldBlock != 0) ? 1 : 0);
+}
+
+/**
+ * xmlSecTransformInputURIGetWaitFd:
+ * @transform:          the pointer to IO transform.
+ *
+ * Gets the file descriptor to wait on after #xmlSecTransformInputURIPopBinAsync
+ * returned 1.
+ *
+ * Returns: the file descriptor or -1 if it is not available.
+ */
+int
+xmlSecTransformInputURIGetWaitFd(xmlSecTransformPtr transform) {
+    xmlSecInputURICtxPtr ctx;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformInputURIId), -1);
+
+    ctx = xmlSecInputUriGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    if((ctx->clbksCtx == NULL) || (ctx->clbks == NULL) || (ctx->clbks->waitfdcallback == NULL)) {
+        return(-1);
+    }
+    return((ctx->clbks->waitfdcallback)(ctx->clbksCtx));
+}
+
+/**
+ * xmlSecTransformInputURIGetSize:
+ * @transform:          the pointer to IO transform.
+ *
+ * Gets the size of the data source opened by @transform if it is known
+ * (e.g. the memory mapped local file).
+ *
+ * Returns: the data size or 0 if it is not known.
+ */
+xmlSecSize
+xmlSecTransformInputURIGetSize(xmlSecTransformPtr transform) {
+    xmlSecInputURICtxPtr ctx;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformInputURIId), 0);
+
+    ctx = xmlSecInputUriGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, 0);
+
+#ifndef XMLSEC_NO_FILES
+    if(ctx->mapped != 0) {
+        return(ctx->map.size);
+    }
+#endif /* XMLSEC_NO_FILES */
+    return(0);
+}
+
 /**
  * xmlSecTransformInputURIOpen:
  * @transform:          the pointer to IO transform.
@@ -374,6 +867,24 @@ xmlSecTransformInputURIGetKlass(void) {
  */
 int
 xmlSecTransformInputURIOpen(xmlSecTransformPtr transform, const xmlChar *uri) {
+    return(xmlSecTransformInputURIOpenEx(transform, uri, NULL));
+}
+
+/**
+ * xmlSecTransformInputURIOpenEx:
+ * @transform:          the pointer to IO transform.
+ * @uri:                the URL to open.
+ * @ioCallbacks:        the optional I/O callbacks list (#xmlSecIOCallbackPtrListId)
+ *                      searched before the global one.
+ *
+ * Opens the given @uri for reading using the @ioCallbacks or the global
+ * I/O callbacks.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecTransformInputURIOpenEx(xmlSecTransformPtr transform, const xmlChar *uri,
+                              xmlSecPtrListPtr ioCallbacks) {
     xmlSecInputURICtxPtr ctx;
 
     xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformInputURIId), -1);
@@ -383,6 +894,14 @@ xmlSecTransformInputURIOpen(xmlSecTransformPtr transform, const xmlChar *uri) {
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(ctx->clbks == NULL, -1);
     xmlSecAssert2(ctx->clbksCtx == NULL, -1);
+    xmlSecAssert2(ctx->mapped == 0, -1);
+
+#ifndef XMLSEC_NO_FILES
+    /* the local files handled by the default file callbacks are read from the memory mapping */
+    if(xmlSecTransformInputURIOpenMapped(ctx, uri, ioCallbacks) == 1) {
+        return(0);
+    }
+#endif /* XMLSEC_NO_FILES */
 
     /*
      * Try to find one of the input accept method accepting that scheme
@@ -394,9 +913,9 @@ xmlSecTransformInputURIOpen(xmlSecTransformPtr transform, const xmlChar *uri) {
 
         unescaped = xmlURIUnescapeString((char*)uri, 0, NULL);
         if (unescaped != NULL) {
-            ctx->clbks = xmlSecIOCallbackPtrListFind(&xmlSecAllIOCallbacks, unescaped);
+            ctx->clbks = xmlSecIOCallbackFind(ioCallbacks, unescaped);
             if(ctx->clbks != NULL) {
-                ctx->clbksCtx = ctx->clbks->opencallback(unescaped);
+                ctx->clbksCtx = xmlSecIOCallbackOpen(ctx->clbks, unescaped);
             }
             xmlFree(unescaped);
         }
@@ -407,12 +926,23 @@ xmlSecTransformInputURIOpen(xmlSecTransformPtr transform, const xmlChar *uri) {
      * filename
      */
     if (ctx->clbks == NULL) {
-        ctx->clbks = xmlSecIOCallbackPtrListFind(&xmlSecAllIOCallbacks, (char*)uri);
+        ctx->clbks = xmlSecIOCallbackFind(ioCallbacks, (char*)uri);
         if(ctx->clbks != NULL) {
-            ctx->clbksCtx = ctx->clbks->opencallback((char*)uri);
+            ctx->clbksCtx = xmlSecIOCallbackOpen(ctx->clbks, (char*)uri);
         }
     }
 
+    /* the memory views are read as the mapped files */
+    if((ctx->clbks != NULL) && (ctx->clbks->memuri != NULL)) {
+        ctx->map.data = ctx->clbks->memdata;
+        ctx->map.size = ctx->clbks->memdatasize;
+        ctx->mapPos = 0;
+        ctx->mapped = 1;
+        ctx->memView = 1;
+        ctx->clbks = NULL;
+        return(0);
+    }
+
     if((ctx->clbks == NULL) || (ctx->clbksCtx == NULL)) {
         xmlSecInternalError2("ctx->clbks->opencallback", xmlSecTransformGetName(transform),
                             "uri=%s", xmlSecErrorsSafeString(uri));
@@ -441,6 +971,15 @@ xmlSecTransformInputURIClose(xmlSecTransformPtr transform) {
     xmlSecAssert2(ctx != NULL, -1);
 
     /* close if still open and mark as closed */
+    if(ctx->mapped != 0) {
+        if(ctx->memView == 0) {
+            xmlSecFileMapClose(&(ctx->map));
+        }
+        memset(&(ctx->map), 0, sizeof(ctx->map));
+        ctx->mapPos = 0;
+        ctx->mapped = 0;
+        ctx->memView = 0;
+    }
     if((ctx->clbksCtx != NULL) && (ctx->clbks != NULL) && (ctx->clbks->closecallback != NULL)) {
         (ctx->clbks->closecallback)(ctx->clbksCtx);
         ctx->clbksCtx = NULL;
@@ -503,9 +1042,28 @@ xmlSecTransformInputURIPopBin(xmlSecTransformPtr transform, xmlSecByte* data,
     ctx = xmlSecInputUriGetCtx(transform);
     xmlSecAssert2(ctx != NULL, -1);
 
-    if((ctx->clbksCtx != NULL) && (ctx->clbks != NULL) && (ctx->clbks->readcallback != NULL)) {
+    if(ctx->mapped != 0) {
+        (*dataSize) = ctx->map.size - ctx->mapPos;
+        if((*dataSize) > maxDataSize) {
+            (*dataSize) = maxDataSize;
+        }
+        if((*dataSize) > 0) {
+            memcpy(data, ctx->map.data + ctx->mapPos, (*dataSize));
+            ctx->mapPos += (*dataSize);
+        }
+    } else if((ctx->clbksCtx != NULL) && (ctx->clbks != NULL) && (ctx->clbks->readcallback != NULL)) {
         XMLSEC_SAFE_CAST_SIZE_TO_INT(maxDataSize, maxDataLen, return(-1), xmlSecTransformGetName(transform));
         ret = (ctx->clbks->readcallback)(ctx->clbksCtx, (char*)data, maxDataLen);
+        if((ret == XMLSEC_IO_WOULD_BLOCK) && (ctx->clbks->waitfdcallback != NULL)) {
+            if(ctx->async == 0) {
+                xmlSecOtherError(XMLSEC_ERRORS_R_IO_FAILED, xmlSecTransformGetName(transform),
+                    "non-blocking stream read in the blocking mode");
+                return(-1);
+            }
+            ctx->wouldBlock = 1;
+            (*dataSize) = 0;
+            return(0);
+        }
         if(ret < 0) {
             xmlSecInternalError("ctx->clbks->readcallback", xmlSecTransformGetName(transform));
             return(-1);
@@ -66,6 +66,9 @@
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "keysdata_helpers.h"
+#include "keysmngr_helpers.h"
+#include "transform_helpers.h"
 
 /**************************************************************************
  *
@@ -103,13 +106,19 @@ xmlSecKeyInfoNodeRead(xmlNodePtr keyInfoNode, xmlSecKeyPtr key, xmlSecKeyInfoCtx
          (xmlSecKeyMatch(key, NULL, &(keyInfoCtx->keyReq)) == 0));
         cur = xmlSecGetNextElementNode(cur->next)) {
 
+        ret = XMLSEC_TRANSFORM_CTX_CHECK_DEADLINE(&(keyInfoCtx->retrievalMethodCtx));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformCtxCheckDeadline", NULL);
+            return(-1);
+        }
+
         /* find data id */
         nodeName = cur->name;
         nodeNs = xmlSecGetNodeNsHref(cur);
 
         /* use global list only if we don't have a local one */
-        if(xmlSecPtrListGetSize(&(keyInfoCtx->enabledKeyData)) > 0) {
-            dataId = xmlSecKeyDataIdListFindByNode(&(keyInfoCtx->enabledKeyData),
+        if(xmlSecPtrListGetSize(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx)) > 0) {
+            dataId = xmlSecKeyDataIdListFindByNode(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx),
                             nodeName, nodeNs, xmlSecKeyDataUsageKeyInfoNodeRead);
         } else {
             dataId = xmlSecKeyDataIdListFindByNode(xmlSecKeyDataIdsGet(),
@@ -168,8 +177,8 @@ xmlSecKeyInfoNodeWrite(xmlNodePtr keyInfoNode, xmlSecKeyPtr key, xmlSecKeyInfoCt
         nodeNs = xmlSecGetNodeNsHref(cur);
 
         /* use global list only if we don't have a local one */
-        if(xmlSecPtrListGetSize(&(keyInfoCtx->enabledKeyData)) > 0) {
-                dataId = xmlSecKeyDataIdListFindByNode(&(keyInfoCtx->enabledKeyData),
+        if(xmlSecPtrListGetSize(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx)) > 0) {
+                dataId = xmlSecKeyDataIdListFindByNode(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx),
                             nodeName, nodeNs,
                             xmlSecKeyDataUsageKeyInfoNodeWrite);
         } else {
@@ -357,6 +366,10 @@ xmlSecKeyInfoCtxReset(xmlSecKeyInfoCtxPtr keyInfoCtx) {
     xmlSecKeyReqReset(&(keyInfoCtx->keyReq));
 }
 
+static int      xmlSecKeyInfoCtxCopyUserPrefInternal    (xmlSecKeyInfoCtxPtr dst,
+                                                         xmlSecKeyInfoCtxPtr src,
+                                                         int shareLists);
+
 /**
  * xmlSecKeyInfoCtxCreateEncCtx:
  * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; element processing context.
@@ -386,7 +399,7 @@ xmlSecKeyInfoCtxCreateEncCtx(xmlSecKeyInfoCtxPtr keyInfoCtx) {
     /* copy user preferences from our current ctx */
     switch(keyInfoCtx->mode) {
         case xmlSecKeyInfoModeRead:
-            ret = xmlSecKeyInfoCtxCopyUserPref(&(tmp->keyInfoReadCtx), keyInfoCtx);
+            ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(tmp->keyInfoReadCtx), keyInfoCtx, 1);
             if(ret < 0) {
                 xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref", NULL);
                 xmlSecEncCtxDestroy(tmp);
@@ -394,7 +407,7 @@ xmlSecKeyInfoCtxCreateEncCtx(xmlSecKeyInfoCtxPtr keyInfoCtx) {
             }
             break;
         case xmlSecKeyInfoModeWrite:
-            ret = xmlSecKeyInfoCtxCopyUserPref(&(tmp->keyInfoWriteCtx), keyInfoCtx);
+            ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(tmp->keyInfoWriteCtx), keyInfoCtx, 1);
             if(ret < 0) {
                 xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref", NULL);
                 xmlSecEncCtxDestroy(tmp);
@@ -414,17 +427,10 @@ xmlSecKeyInfoCtxCreateEncCtx(xmlSecKeyInfoCtxPtr keyInfoCtx) {
 #endif /* XMLSEC_NO_XMLENC */
 }
 
-/**
- * xmlSecKeyInfoCtxCopyUserPref:
- * @dst:                the pointer to destination context object.
- * @src:                the pointer to source context object.
- *
- * Copies user preferences from @src context to @dst context.
- *
- * Returns: 0 on success and a negative value if an error occurs.
- */
-int
-xmlSecKeyInfoCtxCopyUserPref(xmlSecKeyInfoCtxPtr dst, xmlSecKeyInfoCtxPtr src) {
+/* the nested contexts (e.g. for &lt;enc:EncryptedKey/&gt;) are owned by @src
+ * and never outlive it: share the lists instead of copying them */
+static int
+xmlSecKeyInfoCtxCopyUserPrefInternal(xmlSecKeyInfoCtxPtr dst, xmlSecKeyInfoCtxPtr src, int shareLists) {
     int ret;
 
     xmlSecAssert2(dst != NULL, -1);
@@ -436,10 +442,17 @@ xmlSecKeyInfoCtxCopyUserPref(xmlSecKeyInfoCtxPtr dst, xmlSecKeyInfoCtxPtr src) {
     dst->keysMngr       = src->keysMngr;
     dst->base64LineSize = src->base64LineSize;
 
-    ret = xmlSecPtrListCopy(&(dst->enabledKeyData), &(src->enabledKeyData));
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecPtrListCopy(enabledKeyData)", NULL);
-        return(-1);
+    /* replace (not append to) the enabled key data list: the contexts are reused */
+    xmlSecPtrListEmpty(&(dst->enabledKeyData));
+    if(shareLists != 0) {
+        dst->enabledKeyDataRef = xmlSecKeyInfoCtxGetEnabledKeyData(src);
+    } else {
+        dst->enabledKeyDataRef = NULL;
+        ret = xmlSecPtrListCopy(&(dst->enabledKeyData), xmlSecKeyInfoCtxGetEnabledKeyData(src));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecPtrListCopy(enabledKeyData)", NULL);
+            return(-1);
+        }
     }
 
     /* &lt;dsig:RetrievalMethod/&gt; */
@@ -480,6 +493,41 @@ xmlSecKeyInfoCtxCopyUserPref(xmlSecKeyInfoCtxPtr dst, xmlSecKeyInfoCtxPtr src) {
     return(0);
 }
 
+/**
+ * xmlSecKeyInfoCtxCopyUserPref:
+ * @dst:                the pointer to destination context object.
+ * @src:                the pointer to source context object.
+ *
+ * Copies user preferences from @src context to @dst context.
+ *
+ * Returns: 0 on success and a negative value if an error occurs.
+ */
+int
+xmlSecKeyInfoCtxCopyUserPref(xmlSecKeyInfoCtxPtr dst, xmlSecKeyInfoCtxPtr src) {
+    return(xmlSecKeyInfoCtxCopyUserPrefInternal(dst, src, 0));
+}
+
+/**
+ * xmlSecKeyInfoCtxGetEnabledKeyData:
+ * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; element processing context.
+ *
+ * Gets the list of enabled @xmlSecKeyDataId for @keyInfoCtx: the shared
+ * list of the parent context for the nested contexts or the
+ * #xmlSecKeyInfoCtx.enabledKeyData list otherwise.
+ *
+ * Returns: the list of enabled key data ids (if list is empty then
+ * all data ids are enabled).
+ */
+xmlSecPtrListPtr
+xmlSecKeyInfoCtxGetEnabledKeyData(xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecAssert2(keyInfoCtx != NULL, NULL);
+
+    if(keyInfoCtx->enabledKeyDataRef != NULL) {
+        return(keyInfoCtx->enabledKeyDataRef);
+    }
+    return(&(keyInfoCtx->enabledKeyData));
+}
+
 /**
  * xmlSecKeyInfoCtxDebugDump:
  * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; element processing context.
@@ -503,9 +551,9 @@ xmlSecKeyInfoCtxDebugDump(xmlSecKeyInfoCtxPtr keyInfoCtx, FILE* output) {
 
     fprintf(output, "== flags: 0x%08x\n", keyInfoCtx->flags);
     fprintf(output, "== flags2: 0x%08x\n", keyInfoCtx->flags2);
-    if(xmlSecPtrListGetSize(&(keyInfoCtx->enabledKeyData)) > 0) {
+    if(xmlSecPtrListGetSize(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx)) > 0) {
         fprintf(output, "== enabled key data: ");
-        xmlSecKeyDataIdListDebugDump(&(keyInfoCtx->enabledKeyData), output);
+        xmlSecKeyDataIdListDebugDump(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx), output);
     } else {
         fprintf(output, "== enabled key data: all\n");
     }
@@ -552,9 +600,9 @@ xmlSecKeyInfoCtxDebugXmlDump(xmlSecKeyInfoCtxPtr keyInfoCtx, FILE* output) {
 
     fprintf(output, "<Flags>%08x</Flags>\n", keyInfoCtx->flags);
     fprintf(output, "<Flags2>%08x</Flags2>\n", keyInfoCtx->flags2);
-    if(xmlSecPtrListGetSize(&(keyInfoCtx->enabledKeyData)) > 0) {
+    if(xmlSecPtrListGetSize(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx)) > 0) {
         fprintf(output, "<EnabledKeyData>\n");
-        xmlSecKeyDataIdListDebugXmlDump(&(keyInfoCtx->enabledKeyData), output);
+        xmlSecKeyDataIdListDebugXmlDump(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx), output);
         fprintf(output, "</EnabledKeyData>\n");
     } else {
         fprintf(output, "<EnabledKeyData>all</EnabledKeyData>\n");
@@ -683,24 +731,30 @@ xmlSecKeyDataNameXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePtr node,
 
         tmpKey = xmlSecKeysMngrFindKey(keyInfoCtx->keysMngr, newName, keyInfoCtx);
         if(tmpKey != NULL) {
-            /* erase any current information in the key */
-            xmlSecKeyEmpty(key);
+            xmlSecKeyPtr newKey;
 
-            /* TODO: since we will destroy tmpKey anyway, we can easily
-             * just re-assign key data values. It'll save use some memory
-             * malloc/free
-             */
+            /* the found key might be shared with the keys store: copy it
+             * only if needed and then just take its data */
+            newKey = xmlSecKeyMakeWritable(tmpKey);
+            if(newKey == NULL) {
+                xmlSecInternalError("xmlSecKeyMakeWritable",
+                                    xmlSecKeyDataKlassGetName(id));
+                xmlSecKeyDestroy(tmpKey);
+                xmlFree(newName);
+                return(-1);
+            }
 
-            /* and copy what we've found */
-            ret = xmlSecKeyCopy(key, tmpKey);
+            /* erase any current information in the key and take what we've found */
+            xmlSecKeyEmpty(key);
+            ret = xmlSecKeySwap(key, newKey);
             if(ret < 0) {
-                xmlSecInternalError("xmlSecKeyCopy",
+                xmlSecInternalError("xmlSecKeySwap",
                                     xmlSecKeyDataKlassGetName(id));
-                xmlSecKeyDestroy(tmpKey);
+                xmlSecKeyDestroy(newKey);
                 xmlFree(newName);
                 return(-1);
             }
-            xmlSecKeyDestroy(tmpKey);
+            xmlSecKeyDestroy(newKey);
 
             /* and set the key name */
             ret = xmlSecKeySetName(key, newName);
@@ -863,8 +917,8 @@ xmlSecKeyDataValueXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePtr node,
     nodeNs = xmlSecGetNodeNsHref(cur);
 
     /* use global list only if we don't have a local one */
-    if(xmlSecPtrListGetSize(&(keyInfoCtx->enabledKeyData)) > 0) {
-        dataId = xmlSecKeyDataIdListFindByNode(&(keyInfoCtx->enabledKeyData),
+    if(xmlSecPtrListGetSize(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx)) > 0) {
+        dataId = xmlSecKeyDataIdListFindByNode(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx),
                             nodeName, nodeNs, xmlSecKeyDataUsageKeyValueNodeRead);
     } else {
         dataId = xmlSecKeyDataIdListFindByNode(xmlSecKeyDataIdsGet(),
@@ -914,8 +968,8 @@ xmlSecKeyDataValueXmlWrite(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePtr node
         /* nothing to write */
         return(0);
     }
-    if((xmlSecPtrListGetSize(&(keyInfoCtx->enabledKeyData)) > 0) &&
-        (xmlSecKeyDataIdListFind(&(keyInfoCtx->enabledKeyData), id) != 1)) {
+    if((xmlSecPtrListGetSize(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx)) > 0) &&
+        (xmlSecKeyDataIdListFind(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx), id) != 1)) {
 
         /* we are not enabled to write out key data with this id */
         return(0);
@@ -1036,12 +1090,77 @@ xmlSecKeyDataRetrievalMethodGetKlass(void) {
     return(&xmlSecKeyDataRetrievalMethodKlass);
 }
 
+/* returns 1 if the cache id is created, 0 if the result can't be cached or a negative value if an error occurs */
+static int
+xmlSecKeyInfoRetrievalCacheId(xmlNodePtr node, const xmlChar* uri, const xmlChar* type,
+                              xmlNodePtr transformsNode, xmlSecKeyInfoCtxPtr keyInfoCtx,
+                              xmlSecBufferPtr cacheId) {
+    xmlOutputBufferPtr output;
+    const xmlChar* strs[3];
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->doc != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+
+    /* only the external documents are cached */
+    if((keyInfoCtx->keysMngr == NULL) || (keyInfoCtx->keysMngr->priv->retrievalCache == NULL) ||
+       (uri == NULL) || (uri[0] == '\0') || (uri[0] == '#'))
+    {
+        return(0);
+    }
+
+    ret = xmlSecBufferInitialize(cacheId, 256);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        return(-1);
+    }
+
+    /* the relative URIs are resolved against the document URL */
+    strs[0] = (node->doc->URL != NULL) ? node->doc->URL : BAD_CAST "";
+    strs[1] = uri;
+    strs[2] = (type != NULL) ? type : BAD_CAST "";
+    for(ii = 0; ii < sizeof(strs) / sizeof(strs[0]); ++ii) {
+        ret = xmlSecBufferAppend(cacheId, strs[ii], xmlSecStrlen(strs[ii]) + 1);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", NULL);
+            xmlSecBufferFinalize(cacheId);
+            return(-1);
+        }
+    }
+
+    if(transformsNode != NULL) {
+        output = xmlSecBufferCreateOutputBuffer(cacheId);
+        if(output == NULL) {
+            xmlSecInternalError("xmlSecBufferCreateOutputBuffer", NULL);
+            xmlSecBufferFinalize(cacheId);
+            return(-1);
+        }
+        xmlNodeDumpOutput(output, transformsNode->doc, transformsNode, 0, 0, NULL);
+        ret = xmlOutputBufferClose(output);
+        if(ret < 0) {
+            xmlSecXmlError("xmlOutputBufferClose", NULL);
+            xmlSecBufferFinalize(cacheId);
+            return(-1);
+        }
+    }
+
+    return(1);
+}
+
 static int
 xmlSecKeyDataRetrievalMethodXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePtr node, xmlSecKeyInfoCtxPtr keyInfoCtx) {
     xmlSecKeyDataId dataId = xmlSecKeyDataIdUnknown;
     xmlChar *retrType = NULL;
     xmlChar *uri = NULL;
     xmlNodePtr cur;
+    xmlNodePtr transformsNode = NULL;
+    xmlSecBuffer cacheId;
+    xmlSecBuffer cached;
+    xmlSecBufferPtr result;
+    int useCache = 0;
     int res = -1;
     int ret;
 
@@ -1063,8 +1182,8 @@ xmlSecKeyDataRetrievalMethodXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNod
     retrType = xmlGetProp(node, xmlSecAttrType);
     if(retrType != NULL) {
         /* use global list only if we don't have a local one */
-        if(xmlSecPtrListGetSize(&(keyInfoCtx->enabledKeyData)) > 0) {
-            dataId = xmlSecKeyDataIdListFindByHref(&(keyInfoCtx->enabledKeyData),
+        if(xmlSecPtrListGetSize(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx)) > 0) {
+            dataId = xmlSecKeyDataIdListFindByHref(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx),
                             retrType, xmlSecKeyDataUsageRetrievalMethodNode);
         } else {
             dataId = xmlSecKeyDataIdListFindByHref(xmlSecKeyDataIdsGet(),
@@ -1100,6 +1219,7 @@ xmlSecKeyDataRetrievalMethodXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNod
     /* the only one node is optional Transforms node */
     cur = xmlSecGetNextElementNode(node->children);
     if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeTransforms, xmlSecDSigNs))) {
+        transformsNode = cur;
         ret = xmlSecTransformCtxNodesListRead(&(keyInfoCtx->retrievalMethodCtx),
                                             cur, xmlSecTransformUsageDSigTransform);
         if(ret < 0) {
@@ -1117,25 +1237,64 @@ xmlSecKeyDataRetrievalMethodXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNod
         goto done;
     }
 
-    /* finally get transforms results */
-    ret = xmlSecTransformCtxExecute(&(keyInfoCtx->retrievalMethodCtx), node->doc);
-    if((ret < 0) ||
-       (keyInfoCtx->retrievalMethodCtx.result == NULL) ||
-       (xmlSecBufferGetData(keyInfoCtx->retrievalMethodCtx.result) == NULL)) {
-
-        xmlSecInternalError("xmlSecTransformCtxExecute",
-                            xmlSecKeyDataKlassGetName(id));
+    /* check the cache for the external documents (the URI and the transforms are already checked) */
+    useCache = xmlSecKeyInfoRetrievalCacheId(node, uri, retrType, transformsNode, keyInfoCtx, &cacheId);
+    if(useCache < 0) {
+        xmlSecInternalError("xmlSecKeyInfoRetrievalCacheId", xmlSecKeyDataKlassGetName(id));
         goto done;
+    } else if(useCache > 0) {
+        ret = xmlSecBufferInitialize(&cached, 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize", xmlSecKeyDataKlassGetName(id));
+            xmlSecBufferFinalize(&cacheId);
+            useCache = 0;
+            goto done;
+        }
+    }
+
+    result = NULL;
+    if(useCache > 0) {
+        ret = xmlSecKeysMngrRetrievalCacheFind(keyInfoCtx->keysMngr,
+            xmlSecBufferGetData(&cacheId), xmlSecBufferGetSize(&cacheId), &cached);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeysMngrRetrievalCacheFind", xmlSecKeyDataKlassGetName(id));
+            goto done;
+        } else if(ret > 0) {
+            result = &cached;
+        }
     }
 
+    /* finally get transforms results */
+    if(result == NULL) {
+        ret = xmlSecTransformCtxExecute(&(keyInfoCtx->retrievalMethodCtx), node->doc);
+        if((ret < 0) ||
+           (keyInfoCtx->retrievalMethodCtx.result == NULL) ||
+           (xmlSecBufferGetData(keyInfoCtx->retrievalMethodCtx.result) == NULL)) {
+
+            xmlSecInternalError("xmlSecTransformCtxExecute",
+                                xmlSecKeyDataKlassGetName(id));
+            goto done;
+        }
+        result = keyInfoCtx->retrievalMethodCtx.result;
+
+        if(useCache > 0) {
+            /* the cache is an optimization, ignore errors */
+            ret = xmlSecKeysMngrRetrievalCacheAdd(keyInfoCtx->keysMngr,
+                xmlSecBufferGetData(&cacheId), xmlSecBufferGetSize(&cacheId),
+                xmlSecBufferGetData(result), xmlSecBufferGetSize(result));
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecKeysMngrRetrievalCacheAdd", xmlSecKeyDataKlassGetName(id));
+            }
+        }
+    }
 
     /* assume that the data is in XML if we could not find id */
     if((dataId == xmlSecKeyDataIdUnknown) ||
        ((dataId->usage & xmlSecKeyDataUsageRetrievalMethodNodeXml) != 0)) {
 
         ret = xmlSecKeyDataRetrievalMethodReadXmlResult(dataId, key,
-                    xmlSecBufferGetData(keyInfoCtx->retrievalMethodCtx.result),
-                    xmlSecBufferGetSize(keyInfoCtx->retrievalMethodCtx.result),
+                    xmlSecBufferGetData(result),
+                    xmlSecBufferGetSize(result),
                     keyInfoCtx);
         if(ret < 0) {
             xmlSecInternalError("xmlSecKeyDataRetrievalMethodReadXmlResult",
@@ -1144,8 +1303,8 @@ xmlSecKeyDataRetrievalMethodXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNod
         }
     } else {
         ret = xmlSecKeyDataBinRead(dataId, key,
-                    xmlSecBufferGetData(keyInfoCtx->retrievalMethodCtx.result),
-                    xmlSecBufferGetSize(keyInfoCtx->retrievalMethodCtx.result),
+                    xmlSecBufferGetData(result),
+                    xmlSecBufferGetSize(result),
                     keyInfoCtx);
         if(ret < 0) {
             xmlSecInternalError("xmlSecKeyDataBinRead",
@@ -1157,6 +1316,10 @@ xmlSecKeyDataRetrievalMethodXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNod
 
     res = 0;
 done:
+    if(useCache > 0) {
+        xmlSecBufferFinalize(&cached);
+        xmlSecBufferFinalize(&cacheId);
+    }
     if(uri != NULL) {
         xmlFree(uri);
     }
@@ -1214,8 +1377,8 @@ xmlSecKeyDataRetrievalMethodReadXmlResult(xmlSecKeyDataId typeId, xmlSecKeyPtr k
     nodeNs = xmlSecGetNodeNsHref(cur);
 
     /* use global list only if we don't have a local one */
-    if(xmlSecPtrListGetSize(&(keyInfoCtx->enabledKeyData)) > 0) {
-        dataId = xmlSecKeyDataIdListFindByNode(&(keyInfoCtx->enabledKeyData),
+    if(xmlSecPtrListGetSize(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx)) > 0) {
+        dataId = xmlSecKeyDataIdListFindByNode(xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx),
                             nodeName, nodeNs, xmlSecKeyDataUsageRetrievalMethodNodeXml);
     } else {
         dataId = xmlSecKeyDataIdListFindByNode(xmlSecKeyDataIdsGet(),
@@ -1349,6 +1512,10 @@ xmlSecKeyDataKeyInfoReferenceXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNo
     xmlSecKeyDataId dataId = xmlSecKeyDataIdUnknown;
     xmlChar *uri = NULL;
     xmlNodePtr cur;
+    xmlSecBuffer cacheId;
+    xmlSecBuffer cached;
+    xmlSecBufferPtr result;
+    int useCache = 0;
     int res = -1;
     int ret;
 
@@ -1390,23 +1557,63 @@ xmlSecKeyDataKeyInfoReferenceXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNo
         goto done;
     }
 
-    /* get transforms results */
-    ret = xmlSecTransformCtxExecute(&(keyInfoCtx->keyInfoReferenceCtx), node->doc);
-    if(
-        (ret < 0) ||
-        (keyInfoCtx->keyInfoReferenceCtx.result == NULL) ||
-        (xmlSecBufferGetData(keyInfoCtx->keyInfoReferenceCtx.result) == NULL)
-    ) {
-
-        xmlSecInternalError("xmlSecTransformCtxExecute", xmlSecKeyDataKlassGetName(id));
+    /* check the cache for the external documents (the URI is already checked) */
+    useCache = xmlSecKeyInfoRetrievalCacheId(node, uri, xmlSecNodeKeyInfoReference, NULL, keyInfoCtx, &cacheId);
+    if(useCache < 0) {
+        xmlSecInternalError("xmlSecKeyInfoRetrievalCacheId", xmlSecKeyDataKlassGetName(id));
         goto done;
+    } else if(useCache > 0) {
+        ret = xmlSecBufferInitialize(&cached, 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize", xmlSecKeyDataKlassGetName(id));
+            xmlSecBufferFinalize(&cacheId);
+            useCache = 0;
+            goto done;
+        }
+    }
+
+    result = NULL;
+    if(useCache > 0) {
+        ret = xmlSecKeysMngrRetrievalCacheFind(keyInfoCtx->keysMngr,
+            xmlSecBufferGetData(&cacheId), xmlSecBufferGetSize(&cacheId), &cached);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeysMngrRetrievalCacheFind", xmlSecKeyDataKlassGetName(id));
+            goto done;
+        } else if(ret > 0) {
+            result = &cached;
+        }
+    }
+
+    /* get transforms results */
+    if(result == NULL) {
+        ret = xmlSecTransformCtxExecute(&(keyInfoCtx->keyInfoReferenceCtx), node->doc);
+        if(
+            (ret < 0) ||
+            (keyInfoCtx->keyInfoReferenceCtx.result == NULL) ||
+            (xmlSecBufferGetData(keyInfoCtx->keyInfoReferenceCtx.result) == NULL)
+        ) {
+
+            xmlSecInternalError("xmlSecTransformCtxExecute", xmlSecKeyDataKlassGetName(id));
+            goto done;
+        }
+        result = keyInfoCtx->keyInfoReferenceCtx.result;
+
+        if(useCache > 0) {
+            /* the cache is an optimization, ignore errors */
+            ret = xmlSecKeysMngrRetrievalCacheAdd(keyInfoCtx->keysMngr,
+                xmlSecBufferGetData(&cacheId), xmlSecBufferGetSize(&cacheId),
+                xmlSecBufferGetData(result), xmlSecBufferGetSize(result));
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecKeysMngrRetrievalCacheAdd", xmlSecKeyDataKlassGetName(id));
+            }
+        }
     }
 
     /* The result of dereferencing a KeyInfoReference MUST be a KeyInfo element,
      * or an XML document with a KeyInfo element as the root */
     ret = xmlSecKeyDataKeyInfoReferenceReadXmlResult(dataId, key,
-                    xmlSecBufferGetData(keyInfoCtx->keyInfoReferenceCtx.result),
-                    xmlSecBufferGetSize(keyInfoCtx->keyInfoReferenceCtx.result),
+                    xmlSecBufferGetData(result),
+                    xmlSecBufferGetSize(result),
                     keyInfoCtx);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyDataKeyInfoReferenceReadXmlResult", xmlSecKeyDataKlassGetName(id));
@@ -1417,6 +1624,10 @@ xmlSecKeyDataKeyInfoReferenceXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNo
     res = 0;
 
 done:
+    if(useCache > 0) {
+        xmlSecBufferFinalize(&cached);
+        xmlSecBufferFinalize(&cacheId);
+    }
     if(uri != NULL) {
         xmlFree(uri);
     }
@@ -1493,6 +1704,17 @@ xmlSecKeyDataKeyInfoReferenceReadXmlResult(xmlSecKeyDataId typeId, xmlSecKeyPtr
  * &lt;enc:EncryptedKey/&gt; processing
  *
  *************************************************************************/
+
+/* the nested <enc:EncryptedKey/> decryption shares the caller's deadline */
+static void
+xmlSecKeyInfoCtxShareDeadline(xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecAssert(keyInfoCtx != NULL);
+    xmlSecAssert(keyInfoCtx->encCtx != NULL);
+
+    keyInfoCtx->encCtx->transformCtx.deadline = keyInfoCtx->retrievalMethodCtx.deadline;
+    keyInfoCtx->encCtx->transformCtx.cancelFlag = keyInfoCtx->retrievalMethodCtx.cancelFlag;
+}
+
 static int      xmlSecKeyDataEncryptedKeyXmlRead        (xmlSecKeyDataId id,
                                                          xmlSecKeyPtr key,
                                                          xmlNodePtr node,
@@ -1501,6 +1723,14 @@ static int      xmlSecKeyDataEncryptedKeyXmlWrite       (xmlSecKeyDataId id,
                                                          xmlSecKeyPtr key,
                                                          xmlNodePtr node,
                                                          xmlSecKeyInfoCtxPtr keyInfoCtx);
+static int      xmlSecKeyDataEncryptedKeyCacheId        (xmlSecKeyDataId id,
+                                                         xmlNodePtr node,
+                                                         xmlSecKeyInfoCtxPtr keyInfoCtx,
+                                                         xmlSecBufferPtr cacheId);
+static int      xmlSecKeyDataEncryptedKeyCacheFind      (xmlSecKeyDataId id,
+                                                         xmlSecKeyPtr key,
+                                                         xmlSecKeyInfoCtxPtr keyInfoCtx,
+                                                         xmlSecBufferPtr cacheId);
 
 
 
@@ -1566,6 +1796,8 @@ xmlSecKeyDataEncryptedKeyGetKlass(void) {
 static int
 xmlSecKeyDataEncryptedKeyXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePtr node, xmlSecKeyInfoCtxPtr keyInfoCtx) {
     xmlSecBufferPtr result;
+    xmlSecBuffer cacheId;
+    int useCache = 0;
     int ret;
 
     xmlSecAssert2(id == xmlSecKeyDataEncryptedKeyId, -1);
@@ -1581,10 +1813,8 @@ xmlSecKeyDataEncryptedKeyXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePt
         return(-1);
     }
 
-    /* init Enc context */
-    if(keyInfoCtx->encCtx != NULL) {
-        xmlSecEncCtxReset(keyInfoCtx->encCtx);
-    } else {
+    /* init Enc context (the cache id includes its preferences) */
+    if(keyInfoCtx->encCtx == NULL) {
         ret = xmlSecKeyInfoCtxCreateEncCtx(keyInfoCtx);
         if(ret < 0) {
             xmlSecInternalError("xmlSecKeyInfoCtxCreateEncCtx", xmlSecKeyDataKlassGetName(id));
@@ -1593,23 +1823,48 @@ xmlSecKeyDataEncryptedKeyXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePt
     }
     xmlSecAssert2(keyInfoCtx->encCtx != NULL, -1);
 
+    /* check if we already decrypted this key with the same preferences */
+    if((keyInfoCtx->keysMngr != NULL) && (keyInfoCtx->keysMngr->priv->unwrapCache != NULL)) {
+        ret = xmlSecKeyDataEncryptedKeyCacheId(id, node, keyInfoCtx, &cacheId);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeyDataEncryptedKeyCacheId", xmlSecKeyDataKlassGetName(id));
+            return(-1);
+        } else if(ret > 0) {
+            useCache = 1;
+            ret = xmlSecKeyDataEncryptedKeyCacheFind(id, key, keyInfoCtx, &cacheId);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecKeyDataEncryptedKeyCacheFind", xmlSecKeyDataKlassGetName(id));
+                goto error;
+            } else if(ret > 0) {
+                xmlSecBufferFinalize(&cacheId);
+                return(0);
+            }
+        }
+    }
+    xmlSecEncCtxReset(keyInfoCtx->encCtx);
+
     /* copy prefs */
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(readCtx)", xmlSecKeyDataKlassGetName(id));
-        return(-1);
+        goto error;
     }
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(writeCtx)", xmlSecKeyDataKlassGetName(id));
-        return(-1);
+        goto error;
     }
+    xmlSecKeyInfoCtxShareDeadline(keyInfoCtx);
 
     /* decrypt */
     ++keyInfoCtx->curEncryptedKeyLevel;
     result = xmlSecEncCtxDecryptToBuffer(keyInfoCtx->encCtx, node);
     --keyInfoCtx->curEncryptedKeyLevel;
     if((result == NULL) || (xmlSecBufferGetData(result) == NULL)) {
+        if(useCache != 0) {
+            xmlSecBufferFinalize(&cacheId);
+        }
+
         /* We might have multiple EncryptedKey elements, encrypted
          * for different recipients but application can enforce
          * correct enc key.
@@ -1628,10 +1883,185 @@ xmlSecKeyDataEncryptedKeyXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePt
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyDataBinRead",
                             xmlSecKeyDataKlassGetName(id));
-        return(-1);
+        goto error;
     }
 
+    /* remember the decrypted key (errors are not fatal) */
+    if(useCache != 0) {
+        if(xmlSecBufferGetSize(result) > 0) {
+            ret = xmlSecKeysMngrUnwrapCacheAdd(keyInfoCtx->keysMngr,
+                xmlSecBufferGetData(&cacheId), xmlSecBufferGetSize(&cacheId),
+                xmlSecBufferGetData(result), xmlSecBufferGetSize(result));
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecKeysMngrUnwrapCacheAdd", xmlSecKeyDataKlassGetName(id));
+            }
+        }
+        xmlSecBufferFinalize(&cacheId);
+    }
     return(0);
+
+error:
+    if(useCache != 0) {
+        xmlSecBufferFinalize(&cacheId);
+    }
+    return(-1);
+}
+
+/* returns 1 if the cache id is created, 0 if the key can't be cached or a negative value if an error occurs */
+static int
+xmlSecKeyDataEncryptedKeyCacheId(xmlSecKeyDataId id, xmlNodePtr node, xmlSecKeyInfoCtxPtr keyInfoCtx,
+                                 xmlSecBufferPtr cacheId) {
+    struct {
+        xmlSecKeyDataId         keyId;
+        xmlSecKeyDataType       keyType;
+        xmlSecKeyUsage          keyUsage;
+        xmlSecSize              keyBitsSize;
+        unsigned int            flags;
+        unsigned int            flags2;
+#ifndef XMLSEC_NO_X509
+        time_t                  certsVerificationTime;
+        int                     certsVerificationDepth;
+#endif /* XMLSEC_NO_X509 */
+        unsigned int            encFlags;
+        unsigned int            encFlags2;
+        unsigned int            transformFlags;
+        xmlSecTransformUriType  enabledUris;
+    } params;
+    xmlOutputBufferPtr output;
+    xmlSecPtrListPtr list;
+    xmlSecSize ii, size;
+    int ret;
+
+    xmlSecAssert2(id == xmlSecKeyDataEncryptedKeyId, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+    xmlSecAssert2(keyInfoCtx->encCtx != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+
+    /* the application decides on the key usage: don't cache */
+    if((xmlSecPtrListGetSize(&(keyInfoCtx->keyReq.keyUseWithList)) > 0) ||
+       (keyInfoCtx->encCtx->transformCtx.preExecCallback != NULL))
+    {
+        return(0);
+    }
+
+    /* the whole node (CipherValue, algorithms, recipient KeyInfo, ...) */
+    ret = xmlSecBufferInitialize(cacheId, 1024);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", xmlSecKeyDataKlassGetName(id));
+        return(-1);
+    }
+    output = xmlSecBufferCreateOutputBuffer(cacheId);
+    if(output == NULL) {
+        xmlSecInternalError("xmlSecBufferCreateOutputBuffer", xmlSecKeyDataKlassGetName(id));
+        xmlSecBufferFinalize(cacheId);
+        return(-1);
+    }
+    xmlNodeDumpOutput(output, node->doc, node, 0, 0, NULL);
+    ret = xmlOutputBufferClose(output);
+    if((ret < 0) || (xmlSecBufferGetSize(cacheId) == 0)) {
+        xmlSecXmlError("xmlOutputBufferClose", xmlSecKeyDataKlassGetName(id));
+        xmlSecBufferFinalize(cacheId);
+        return(-1);
+    }
+
+    /* the key requirements and the processing flags: the keys manager
+     * can be shared by the contexts with different policies */
+    memset(&params, 0, sizeof(params));
+    params.keyId            = keyInfoCtx->keyReq.keyId;
+    params.keyType          = keyInfoCtx->keyReq.keyType;
+    params.keyUsage         = keyInfoCtx->keyReq.keyUsage;
+    params.keyBitsSize      = keyInfoCtx->keyReq.keyBitsSize;
+    params.flags            = keyInfoCtx->flags;
+    params.flags2           = keyInfoCtx->flags2;
+#ifndef XMLSEC_NO_X509
+    params.certsVerificationTime  = keyInfoCtx->certsVerificationTime;
+    params.certsVerificationDepth = keyInfoCtx->certsVerificationDepth;
+#endif /* XMLSEC_NO_X509 */
+    params.encFlags         = keyInfoCtx->encCtx->flags;
+    params.encFlags2        = keyInfoCtx->encCtx->flags2;
+    params.transformFlags   = keyInfoCtx->encCtx->transformCtx.flags;
+    params.enabledUris      = keyInfoCtx->encCtx->transformCtx.enabledUris;
+    ret = xmlSecBufferAppend(cacheId, (const xmlSecByte*)&params, sizeof(params));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", xmlSecKeyDataKlassGetName(id));
+        xmlSecBufferFinalize(cacheId);
+        return(-1);
+    }
+
+    /* the enabled key data and the enabled &lt;enc:EncryptionMethod/&gt; transforms */
+    list = xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx);
+    size = xmlSecPtrListGetSize(list);
+    for(ii = 0; ii < size; ++ii) {
+        xmlSecKeyDataId dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(list, ii);
+
+        ret = xmlSecBufferAppend(cacheId, (const xmlSecByte*)&dataId, sizeof(dataId));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", xmlSecKeyDataKlassGetName(id));
+            xmlSecBufferFinalize(cacheId);
+            return(-1);
+        }
+    }
+    list = &(keyInfoCtx->encCtx->transformCtx.enabledTransforms);
+    size = xmlSecPtrListGetSize(list);
+    for(ii = 0; ii < size; ++ii) {
+        xmlSecTransformId transformId = (xmlSecTransformId)xmlSecPtrListGetItem(list, ii);
+
+        ret = xmlSecBufferAppend(cacheId, (const xmlSecByte*)&transformId, sizeof(transformId));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", xmlSecKeyDataKlassGetName(id));
+            xmlSecBufferFinalize(cacheId);
+            return(-1);
+        }
+    }
+
+    return(1);
+}
+
+/* returns 1 if the key was found in the cache, 0 if not or a negative value if an error occurs */
+static int
+xmlSecKeyDataEncryptedKeyCacheFind(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlSecKeyInfoCtxPtr keyInfoCtx,
+                                   xmlSecBufferPtr cacheId) {
+    xmlSecBuffer cached;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(id == xmlSecKeyDataEncryptedKeyId, -1);
+    xmlSecAssert2(key != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+    xmlSecAssert2(keyInfoCtx->keysMngr != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+
+    ret = xmlSecBufferInitialize(&cached, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", xmlSecKeyDataKlassGetName(id));
+        return(-1);
+    }
+    xmlSecBufferSetZeroMode(&cached, xmlSecBufferZeroModeAlways);
+
+    ret = xmlSecKeysMngrUnwrapCacheFind(keyInfoCtx->keysMngr,
+        xmlSecBufferGetData(cacheId), xmlSecBufferGetSize(cacheId), &cached);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeysMngrUnwrapCacheFind", xmlSecKeyDataKlassGetName(id));
+        goto done;
+    } else if(ret == 0) {
+        res = 0;
+        goto done;
+    }
+
+    ret = xmlSecKeyDataBinRead(keyInfoCtx->keyReq.keyId, key,
+                           xmlSecBufferGetData(&cached),
+                           xmlSecBufferGetSize(&cached),
+                           keyInfoCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyDataBinRead", xmlSecKeyDataKlassGetName(id));
+        goto done;
+    }
+    res = 1;
+
+done:
+    xmlSecBufferFinalize(&cached);
+    return(res);
 }
 
 static int
@@ -1686,16 +2116,17 @@ xmlSecKeyDataEncryptedKeyXmlWrite(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodeP
     xmlSecAssert2(keyInfoCtx->encCtx != NULL, -1);
 
     /* copy prefs */
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(readCtx)", xmlSecKeyDataKlassGetName(id));
         goto done;
     }
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(writeCtx)", xmlSecKeyDataKlassGetName(id));
         goto done;
     }
+    xmlSecKeyInfoCtxShareDeadline(keyInfoCtx);
 
     /* encrypt */
     ret = xmlSecEncCtxBinaryEncrypt(keyInfoCtx->encCtx, node, keyBuf, keySize);
@@ -1823,16 +2254,17 @@ xmlSecKeyDataDerivedKeyXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNodePtr
     xmlSecAssert2(keyInfoCtx->encCtx != NULL, -1);
 
     /* copy prefs */
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(readCtx)", xmlSecKeyDataKlassGetName(id));
         return(-1);
     }
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(writeCtx)", xmlSecKeyDataKlassGetName(id));
         return(-1);
     }
+    xmlSecKeyInfoCtxShareDeadline(keyInfoCtx);
 
     ++keyInfoCtx->curEncryptedKeyLevel;
     generatedKey = xmlSecEncCtxDerivedKeyGenerate(keyInfoCtx->encCtx, keyInfoCtx->keyReq.keyId, node, keyInfoCtx);
@@ -1992,16 +2424,17 @@ xmlSecKeyDataAgreementMethodXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNod
     xmlSecAssert2(keyInfoCtx->encCtx != NULL, -1);
 
     /* copy prefs */
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(readCtx)", xmlSecKeyDataKlassGetName(id));
         return(-1);
     }
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(writeCtx)", xmlSecKeyDataKlassGetName(id));
         return(-1);
     }
+    xmlSecKeyInfoCtxShareDeadline(keyInfoCtx);
 
     ++keyInfoCtx->curEncryptedKeyLevel;
     generatedKey = xmlSecEncCtxAgreementMethodGenerate(keyInfoCtx->encCtx, keyInfoCtx->keyReq.keyId, node, keyInfoCtx);
@@ -2070,16 +2503,17 @@ xmlSecKeyDataAgreementMethodXmlWrite(xmlSecKeyDataId id, xmlSecKeyPtr key, xmlNo
     xmlSecAssert2(keyInfoCtx->encCtx != NULL, -1);
 
     /* copy prefs */
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoReadCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(readCtx)", xmlSecKeyDataKlassGetName(id));
         return(-1);
     }
-    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx);
+    ret = xmlSecKeyInfoCtxCopyUserPrefInternal(&(keyInfoCtx->encCtx->keyInfoWriteCtx), keyInfoCtx, 1);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(writeCtx)", xmlSecKeyDataKlassGetName(id));
         return(-1);
     }
+    xmlSecKeyInfoCtxShareDeadline(keyInfoCtx);
 
     ++keyInfoCtx->curEncryptedKeyLevel;
     ret = xmlSecEncCtxAgreementMethodXmlWrite(keyInfoCtx->encCtx, node, keyInfoCtx);
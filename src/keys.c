@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include <libxml/tree.h>
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/xmltree.h>
@@ -28,9 +29,29 @@
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/keyinfo.h>
+#include <xmlsec/memstats.h>
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "keysdata_helpers.h"
+#include "keysmngr_helpers.h"
+
+/* the keys references counter is changed from different threads when
+ * the keys are shared between them (e.g. keys from the keys store) */
+#if defined(__GNUC__) || defined(__clang__)
+#define XMLSEC_KEY_REF_INC(ptr)         __atomic_add_fetch((ptr), 1, __ATOMIC_RELAXED)
+#define XMLSEC_KEY_REF_DEC(ptr)         __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+#define XMLSEC_KEY_REF_GET(ptr)         __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#elif defined(_MSC_VER)
+#include <windows.h>
+#define XMLSEC_KEY_REF_INC(ptr)         InterlockedIncrement((volatile LONG*)(ptr))
+#define XMLSEC_KEY_REF_DEC(ptr)         InterlockedDecrement((volatile LONG*)(ptr))
+#define XMLSEC_KEY_REF_GET(ptr)         InterlockedCompareExchange((volatile LONG*)(ptr), 0, 0)
+#else /* defined(_MSC_VER) */
+#define XMLSEC_KEY_REF_INC(ptr)         (++(*(ptr)))
+#define XMLSEC_KEY_REF_DEC(ptr)         (--(*(ptr)))
+#define XMLSEC_KEY_REF_GET(ptr)         (*(ptr))
+#endif /* defined(__GNUC__) || defined(__clang__) */
 
 /**************************************************************************
  *
@@ -516,7 +537,14 @@ xmlSecKeyCreate(void)  {
         return(NULL);
     }
     memset(key, 0, sizeof(xmlSecKey));
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagKeys, 0, sizeof(xmlSecKey)) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate", NULL);
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagKeys, sizeof(xmlSecKey), 0);
+        xmlFree(key);
+        return(NULL);
+    }
     key->usage = xmlSecKeyUsageAny;
+    key->refCount = 1;
     return(key);
 }
 
@@ -528,6 +556,8 @@ xmlSecKeyCreate(void)  {
  */
 void
 xmlSecKeyEmpty(xmlSecKeyPtr key) {
+    int refCount;
+
     xmlSecAssert(key != NULL);
 
     if(key->value != NULL) {
@@ -540,23 +570,109 @@ xmlSecKeyEmpty(xmlSecKeyPtr key) {
         xmlSecPtrListDestroy(key->dataList);
     }
 
+    /* the key itself is still alive */
+    refCount = key->refCount;
     memset(key, 0, sizeof(xmlSecKey));
+    key->refCount = refCount;
 }
 
 /**
  * xmlSecKeyDestroy:
  * @key:                the pointer to key.
  *
- * Destroys the key created using #xmlSecKeyCreate function.
+ * Releases a reference to the key created using #xmlSecKeyCreate function
+ * and destroys the key when the last reference is released (same as
+ * #xmlSecKeyUnref).
  */
 void
 xmlSecKeyDestroy(xmlSecKeyPtr key) {
     xmlSecAssert(key != NULL);
 
+    if(XMLSEC_KEY_REF_DEC(&(key->refCount)) > 0) {
+        return;
+    }
     xmlSecKeyEmpty(key);
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagKeys, sizeof(xmlSecKey), 0);
     xmlFree(key);
 }
 
+/**
+ * xmlSecKeyRef:
+ * @key:                the pointer to key.
+ *
+ * Adds a reference to the @key. The key is shared between all the
+ * references and should not be modified (see #xmlSecKeyMakeWritable).
+ * Each reference is released with #xmlSecKeyUnref or #xmlSecKeyDestroy.
+ *
+ * Returns: the @key.
+ */
+xmlSecKeyPtr
+xmlSecKeyRef(xmlSecKeyPtr key) {
+    xmlSecAssert2(key != NULL, NULL);
+
+    XMLSEC_KEY_REF_INC(&(key->refCount));
+    return(key);
+}
+
+/**
+ * xmlSecKeyUnref:
+ * @key:                the pointer to key.
+ *
+ * Releases a reference to the @key and destroys it when the last
+ * reference is released.
+ */
+void
+xmlSecKeyUnref(xmlSecKeyPtr key) {
+    xmlSecAssert(key != NULL);
+
+    xmlSecKeyDestroy(key);
+}
+
+/**
+ * xmlSecKeyIsShared:
+ * @key:                the pointer to key.
+ *
+ * Checks if the @key has more than one reference.
+ *
+ * Returns: 1 if the key is shared, 0 if it isn't or a negative value if an error occurs.
+ */
+int
+xmlSecKeyIsShared(xmlSecKeyPtr key) {
+    xmlSecAssert2(key != NULL, -1);
+
+    return((XMLSEC_KEY_REF_GET(&(key->refCount)) > 1) ? 1 : 0);
+}
+
+/**
+ * xmlSecKeyMakeWritable:
+ * @key:                the pointer to key.
+ *
+ * Copy-on-write helper: if the @key is shared then creates a copy of it
+ * and releases the caller's reference to the @key, otherwise returns the
+ * @key itself. The caller owns the returned key. On error, the caller
+ * still owns the reference to the original @key.
+ *
+ * Returns: the key that can be modified or NULL if an error occurs.
+ */
+xmlSecKeyPtr
+xmlSecKeyMakeWritable(xmlSecKeyPtr key) {
+    xmlSecKeyPtr newKey;
+
+    xmlSecAssert2(key != NULL, NULL);
+
+    if(xmlSecKeyIsShared(key) == 0) {
+        return(key);
+    }
+
+    newKey = xmlSecKeyDuplicate(key);
+    if(newKey == NULL) {
+        xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+        return(NULL);
+    }
+    xmlSecKeyDestroy(key);
+    return(newKey);
+}
+
 /**
  * xmlSecKeyCopy:
  * @keyDst:             the destination key.
@@ -1288,6 +1404,113 @@ xmlSecKeyReadMemory(xmlSecKeyDataId dataId, const xmlSecByte* data, xmlSecSize d
     return (key);
 }
 
+/* returns 1 if the key resolved from the node depends only on the node itself */
+static int
+xmlSecKeysMngrIsKeyInfoCacheable(xmlNodePtr node) {
+    xmlNodePtr cur;
+
+    xmlSecAssert2(node != NULL, 0);
+
+    for(cur = node->children; cur != NULL; cur = cur->next) {
+        if(cur->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+        if(xmlStrEqual(cur->name, xmlSecNodeRetrievalMethod) || xmlStrEqual(cur->name, xmlSecNodeKeyInfoReference)) {
+            return(0);
+        }
+        if(xmlSecKeysMngrIsKeyInfoCacheable(cur) == 0) {
+            return(0);
+        }
+    }
+    return(1);
+}
+
+/* returns 1 if the cache id is created, 0 if the key can't be cached or a negative value if an error occurs */
+static int
+xmlSecKeysMngrGetKeyCacheId(xmlNodePtr keyInfoNode, xmlSecKeyInfoCtxPtr keyInfoCtx, xmlSecBufferPtr cacheId) {
+    struct {
+        xmlSecKeyDataId         keyId;
+        xmlSecKeyDataType       keyType;
+        xmlSecKeyUsage          keyUsage;
+        xmlSecSize              keyBitsSize;
+        unsigned int            flags;
+        unsigned int            flags2;
+#ifndef XMLSEC_NO_X509
+        time_t                  certsVerificationTime;
+        int                     certsVerificationDepth;
+#endif /* XMLSEC_NO_X509 */
+    } params;
+    xmlOutputBufferPtr output;
+    xmlSecPtrListPtr enabledKeyData;
+    xmlSecSize ii, size;
+    int ret;
+
+    xmlSecAssert2(keyInfoNode != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+
+    if((xmlSecPtrListGetSize(&(keyInfoCtx->keyReq.keyUseWithList)) > 0) ||
+       (xmlSecKeysMngrIsKeyInfoCacheable(keyInfoNode) == 0))
+    {
+        return(0);
+    }
+
+    ret = xmlSecBufferInitialize(cacheId, 1024);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        return(-1);
+    }
+
+    output = xmlSecBufferCreateOutputBuffer(cacheId);
+    if(output == NULL) {
+        xmlSecInternalError("xmlSecBufferCreateOutputBuffer", NULL);
+        xmlSecBufferFinalize(cacheId);
+        return(-1);
+    }
+    xmlNodeDumpOutput(output, keyInfoNode->doc, keyInfoNode, 0, 0, NULL);
+    ret = xmlOutputBufferClose(output);
+    if((ret < 0) || (xmlSecBufferGetSize(cacheId) == 0)) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        xmlSecBufferFinalize(cacheId);
+        return(-1);
+    }
+
+    /* the key requirements and the processing flags */
+    memset(&params, 0, sizeof(params));
+    params.keyId            = keyInfoCtx->keyReq.keyId;
+    params.keyType          = keyInfoCtx->keyReq.keyType;
+    params.keyUsage         = keyInfoCtx->keyReq.keyUsage;
+    params.keyBitsSize      = keyInfoCtx->keyReq.keyBitsSize;
+    params.flags            = keyInfoCtx->flags;
+    params.flags2           = keyInfoCtx->flags2;
+#ifndef XMLSEC_NO_X509
+    params.certsVerificationTime  = keyInfoCtx->certsVerificationTime;
+    params.certsVerificationDepth = keyInfoCtx->certsVerificationDepth;
+#endif /* XMLSEC_NO_X509 */
+    ret = xmlSecBufferAppend(cacheId, (const xmlSecByte*)&params, sizeof(params));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        xmlSecBufferFinalize(cacheId);
+        return(-1);
+    }
+
+    /* the enabled key data */
+    enabledKeyData = xmlSecKeyInfoCtxGetEnabledKeyData(keyInfoCtx);
+    size = xmlSecPtrListGetSize(enabledKeyData);
+    for(ii = 0; ii < size; ++ii) {
+        xmlSecKeyDataId dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(enabledKeyData, ii);
+
+        ret = xmlSecBufferAppend(cacheId, (const xmlSecByte*)&dataId, sizeof(dataId));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", NULL);
+            xmlSecBufferFinalize(cacheId);
+            return(-1);
+        }
+    }
+
+    return(1);
+}
+
 /**
  * xmlSecKeysMngrGetKey:
  * @keyInfoNode:        the pointer to &lt;dsig:KeyInfo/&gt; node.
@@ -1301,15 +1524,35 @@ xmlSecKeyReadMemory(xmlSecKeyDataId dataId, const xmlSecByte* data, xmlSecSize d
 xmlSecKeyPtr
 xmlSecKeysMngrGetKey(xmlNodePtr keyInfoNode, xmlSecKeyInfoCtxPtr keyInfoCtx) {
     xmlSecKeyPtr key;
+    xmlSecBuffer cacheId;
+    int useCache = 0;
     int ret;
 
     xmlSecAssert2(keyInfoCtx != NULL, NULL);
 
+    /* check the cache first */
+    if((keyInfoNode != NULL) && (keyInfoCtx->keysMngr != NULL) && (keyInfoCtx->keysMngr->priv->keyInfoCache != NULL)) {
+        useCache = xmlSecKeysMngrGetKeyCacheId(keyInfoNode, keyInfoCtx, &cacheId);
+        if(useCache < 0) {
+            xmlSecInternalError("xmlSecKeysMngrGetKeyCacheId", NULL);
+            return(NULL);
+        } else if(useCache > 0) {
+            key = xmlSecKeysMngrKeyInfoCacheFind(keyInfoCtx->keysMngr,
+                xmlSecBufferGetData(&cacheId), xmlSecBufferGetSize(&cacheId));
+            if(key != NULL) {
+                xmlSecBufferFinalize(&cacheId);
+                return(key);
+            }
+        }
+    }
 
     /* first try to read data from &lt;dsig:KeyInfo/&gt; node */
     key = xmlSecKeyCreate();
     if(key == NULL) {
         xmlSecInternalError("xmlSecKeyCreate", NULL);
+        if(useCache > 0) {
+            xmlSecBufferFinalize(&cacheId);
+        }
         return(NULL);
     }
 
@@ -1321,15 +1564,30 @@ xmlSecKeysMngrGetKey(xmlNodePtr keyInfoNode, xmlSecKeyInfoCtxPtr keyInfoCtx) {
                                  "node=%s",
                                  xmlSecErrorsSafeString(xmlSecNodeGetName(keyInfoNode)));
             xmlSecKeyDestroy(key);
+            if(useCache > 0) {
+                xmlSecBufferFinalize(&cacheId);
+            }
             return(NULL);
         }
 
         if((xmlSecKeyGetValue(key) != NULL) &&
            (xmlSecKeyMatch(key, NULL, &(keyInfoCtx->keyReq)) != 0)) {
+            if(useCache > 0) {
+                /* the cache is an optimization, ignore errors */
+                ret = xmlSecKeysMngrKeyInfoCacheAdd(keyInfoCtx->keysMngr,
+                    xmlSecBufferGetData(&cacheId), xmlSecBufferGetSize(&cacheId), key);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecKeysMngrKeyInfoCacheAdd", NULL);
+                }
+                xmlSecBufferFinalize(&cacheId);
+            }
             return(key);
         }
     }
     xmlSecKeyDestroy(key);
+    if(useCache > 0) {
+        xmlSecBufferFinalize(&cacheId);
+    }
 
     /* if we have keys manager, try to find any key that matches the required key (if lax key search is allowed) */
     if(((keyInfoCtx->flags & XMLSEC_KEYINFO_FLAGS_LAX_KEY_SEARCH) != 0) &&  (keyInfoCtx->keysMngr != NULL)) {
@@ -1372,3 +1630,159 @@ xmlSecPtrListId
 xmlSecKeyPtrListGetKlass(void) {
     return(&xmlSecKeyPtrListKlass);
 }
+
+/***********************************************************************
+ *
+ * Keys pool: the keys are handed out in turn, each caller gets its own
+ * duplicate that shares the key handle (and the HSM session behind it)
+ * with the pool key.
+ *
+ **********************************************************************/
+struct _xmlSecKeyPool {
+    xmlMutexPtr                 mutex;
+    xmlSecPtrList               keys;
+    xmlSecSize                  pos;
+};
+
+/**
+ * xmlSecKeyPoolCreate:
+ *
+ * Creates an empty keys pool. The pool holds several handles of the same
+ * key (e.g. loaded from an HSM several times with the crypto library
+ * specific functions) and dispatches the callers to them in turn, this way
+ * concurrent operations with the key are not serialized on a single handle.
+ * The pool is thread safe.
+ *
+ * Returns: the pointer to newly allocated keys pool or NULL if an error occurs.
+ */
+xmlSecKeyPoolPtr
+xmlSecKeyPoolCreate(void) {
+    xmlSecKeyPoolPtr pool;
+    int ret;
+
+    pool = (xmlSecKeyPoolPtr)xmlMalloc(sizeof(xmlSecKeyPool));
+    if(pool == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeyPool), NULL);
+        return(NULL);
+    }
+    memset(pool, 0, sizeof(xmlSecKeyPool));
+
+    ret = xmlSecPtrListInitialize(&(pool->keys), xmlSecKeyPtrListId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListInitialize", NULL);
+        xmlFree(pool);
+        return(NULL);
+    }
+
+    pool->mutex = xmlNewMutex();
+    if(pool->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlSecPtrListFinalize(&(pool->keys));
+        xmlFree(pool);
+        return(NULL);
+    }
+    return(pool);
+}
+
+/**
+ * xmlSecKeyPoolDestroy:
+ * @pool:               the pointer to keys pool.
+ *
+ * Destroys the keys pool and all the keys in it. The keys returned
+ * by #xmlSecKeyPoolGetKey are not affected.
+ */
+void
+xmlSecKeyPoolDestroy(xmlSecKeyPoolPtr pool) {
+    xmlSecAssert(pool != NULL);
+
+    xmlSecPtrListFinalize(&(pool->keys));
+    xmlFreeMutex(pool->mutex);
+    memset(pool, 0, sizeof(xmlSecKeyPool));
+    xmlFree(pool);
+}
+
+/**
+ * xmlSecKeyPoolAdoptKey:
+ * @pool:               the pointer to keys pool.
+ * @key:                the pointer to key.
+ *
+ * Adds @key to the @pool. The @key is destroyed with the @pool.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeyPoolAdoptKey(xmlSecKeyPoolPtr pool, xmlSecKeyPtr key) {
+    int ret;
+
+    xmlSecAssert2(pool != NULL, -1);
+    xmlSecAssert2(xmlSecKeyIsValid(key), -1);
+
+    xmlMutexLock(pool->mutex);
+    ret = xmlSecPtrListAdd(&(pool->keys), key);
+    xmlMutexUnlock(pool->mutex);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListAdd", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecKeyPoolGetSize:
+ * @pool:               the pointer to keys pool.
+ *
+ * Gets the number of keys in the @pool.
+ *
+ * Returns: the number of keys in the @pool.
+ */
+xmlSecSize
+xmlSecKeyPoolGetSize(xmlSecKeyPoolPtr pool) {
+    xmlSecSize size;
+
+    xmlSecAssert2(pool != NULL, 0);
+
+    xmlMutexLock(pool->mutex);
+    size = xmlSecPtrListGetSize(&(pool->keys));
+    xmlMutexUnlock(pool->mutex);
+    return(size);
+}
+
+/**
+ * xmlSecKeyPoolGetKey:
+ * @pool:               the pointer to keys pool.
+ *
+ * Gets the duplicate of the next key from the @pool (e.g. to set as
+ * #xmlSecDSigCtx.signKey), the keys are used in turn. The caller is
+ * responsible for destroying the returned key with #xmlSecKeyDestroy.
+ *
+ * Returns: the pointer to key or NULL if the @pool is empty or an error occurs.
+ */
+xmlSecKeyPtr
+xmlSecKeyPoolGetKey(xmlSecKeyPoolPtr pool) {
+    xmlSecKeyPtr key = NULL;
+    xmlSecKeyPtr res;
+    xmlSecSize size;
+
+    xmlSecAssert2(pool != NULL, NULL);
+
+    xmlMutexLock(pool->mutex);
+    size = xmlSecPtrListGetSize(&(pool->keys));
+    if(size > 0) {
+        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(&(pool->keys), pool->pos % size);
+        pool->pos = (pool->pos + 1) % size;
+    }
+    xmlMutexUnlock(pool->mutex);
+
+    if(key == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_KEY_NOT_FOUND, NULL, "keys pool is empty");
+        return(NULL);
+    }
+
+    /* the pool keys are never modified, the duplicate can be created outside of the lock */
+    res = xmlSecKeyDuplicate(key);
+    if(res == NULL) {
+        xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+        return(NULL);
+    }
+    return(res);
+}
@@ -28,13 +28,16 @@
 #include <xmlsec/keyinfo.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/base64.h>
+#include <xmlsec/memstats.h>
 #include <xmlsec/keyinfo.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/private.h>
+#include <xmlsec/settings.h>
 #include <xmlsec/x509.h>
 
 #include "cast_helpers.h"
 #include "keysdata_helpers.h"
+#include "list_helpers.h"
 
 /**************************************************************************
  *
@@ -42,6 +45,49 @@
  *
  *************************************************************************/
 static xmlSecPtrList xmlSecAllKeyDataIds;
+
+/* lookup indexes for xmlSecAllKeyDataIds */
+static xmlSecPtrListIndex xmlSecAllKeyDataIdsByNode;
+static xmlSecPtrListIndex xmlSecAllKeyDataIdsByHref;
+static xmlSecPtrListIndex xmlSecAllKeyDataIdsByName;
+
+static const xmlChar*
+xmlSecKeyDataIdGetNodeName(xmlSecPtr item) {
+    return(((xmlSecKeyDataId)item)->dataNodeName);
+}
+
+static const xmlChar*
+xmlSecKeyDataIdGetHref(xmlSecPtr item) {
+    return(((xmlSecKeyDataId)item)->href);
+}
+
+static const xmlChar*
+xmlSecKeyDataIdGetName(xmlSecPtr item) {
+    return(((xmlSecKeyDataId)item)->name);
+}
+
+static int
+xmlSecKeyDataIdsUpdateIndexes(void) {
+    int ret;
+
+    ret = xmlSecPtrListIndexUpdate(&xmlSecAllKeyDataIdsByNode, xmlSecKeyDataIdsGet());
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListIndexUpdate(node)", NULL);
+        return(-1);
+    }
+    ret = xmlSecPtrListIndexUpdate(&xmlSecAllKeyDataIdsByHref, xmlSecKeyDataIdsGet());
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListIndexUpdate(href)", NULL);
+        return(-1);
+    }
+    ret = xmlSecPtrListIndexUpdate(&xmlSecAllKeyDataIdsByName, xmlSecKeyDataIdsGet());
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListIndexUpdate(name)", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
 static int xmlSecImportPersistKey = 0;
 
 /**
@@ -73,6 +119,9 @@ xmlSecKeyDataIdsInit(void) {
         xmlSecInternalError("xmlSecPtrListInitialize(xmlSecKeyDataIdListId)", NULL);
         return(-1);
     }
+    xmlSecPtrListIndexInitialize(&xmlSecAllKeyDataIdsByNode, xmlSecKeyDataIdGetNodeName);
+    xmlSecPtrListIndexInitialize(&xmlSecAllKeyDataIdsByHref, xmlSecKeyDataIdGetHref);
+    xmlSecPtrListIndexInitialize(&xmlSecAllKeyDataIdsByName, xmlSecKeyDataIdGetName);
 
     ret = xmlSecKeyDataIdsRegisterDefault();
     if(ret < 0) {
@@ -91,6 +140,9 @@ xmlSecKeyDataIdsInit(void) {
  */
 void
 xmlSecKeyDataIdsShutdown(void) {
+    xmlSecPtrListIndexFinalize(&xmlSecAllKeyDataIdsByNode);
+    xmlSecPtrListIndexFinalize(&xmlSecAllKeyDataIdsByHref);
+    xmlSecPtrListIndexFinalize(&xmlSecAllKeyDataIdsByName);
     xmlSecPtrListFinalize(xmlSecKeyDataIdsGet());
 }
 
@@ -115,55 +167,93 @@ xmlSecKeyDataIdsRegister(xmlSecKeyDataId id) {
         return(-1);
     }
 
+    /* lookups fall back to the list scan if the indexes are out of date */
+    ret = xmlSecKeyDataIdsUpdateIndexes();
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyDataIdsUpdateIndexes",
+                            xmlSecKeyDataKlassGetName(id));
+        return(-1);
+    }
+
     return(0);
 }
 
 /**
- * xmlSecKeyDataIdsRegisterDefault:
+ * xmlSecKeyDataIdsRegisterArray:
+ * @ids:                the array of key data klasses.
+ * @idsSize:            the number of elements in @ids.
  *
- * Registers default (implemented by XML Security Library)
- * key data klasses: &lt;dsig:KeyName/&gt; element processing klass,
- * &lt;dsig:KeyValue/&gt; element processing klass, ...
+ * Registers all the non-NULL klasses from @ids in the global list of
+ * key data klasses. The lookup indexes are updated once for the whole
+ * array.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
 int
-xmlSecKeyDataIdsRegisterDefault(void) {
-    if(xmlSecKeyDataIdsRegister(xmlSecKeyDataNameId) < 0) {
-        xmlSecInternalError("xmlSecKeyDataIdsRegister(xmlSecKeyDataNameId)", NULL);
-        return(-1);
-    }
+xmlSecKeyDataIdsRegisterArray(const xmlSecKeyDataId* ids, xmlSecSize idsSize) {
+    xmlSecSize ii;
+    int ret;
 
-    if(xmlSecKeyDataIdsRegister(xmlSecKeyDataValueId) < 0) {
-        xmlSecInternalError("xmlSecKeyDataIdsRegister(xmlSecKeyDataValueId)", NULL);
-        return(-1);
-    }
+    xmlSecAssert2((ids != NULL) || (idsSize == 0), -1);
 
-    if(xmlSecKeyDataIdsRegister(xmlSecKeyDataRetrievalMethodId) < 0) {
-        xmlSecInternalError("xmlSecKeyDataIdsRegister(xmlSecKeyDataRetrievalMethodId", NULL);
-        return(-1);
+    for(ii = 0; ii < idsSize; ++ii) {
+        if(ids[ii] == xmlSecKeyDataIdUnknown) {
+            continue;
+        }
+        ret = xmlSecPtrListAdd(xmlSecKeyDataIdsGet(), (xmlSecPtr)ids[ii]);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecPtrListAdd",
+                                xmlSecKeyDataKlassGetName(ids[ii]));
+            return(-1);
+        }
     }
 
-    if(xmlSecKeyDataIdsRegister(xmlSecKeyDataKeyInfoReferenceId) < 0) {
-        xmlSecInternalError("xmlSecKeyDataIdsRegister(xmlSecKeyDataKeyInfoReferenceId", NULL);
+    ret = xmlSecKeyDataIdsUpdateIndexes();
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyDataIdsUpdateIndexes", NULL);
         return(-1);
     }
+    return(0);
+}
+
+/* the default key data klasses: the table is built at compile time */
+static const xmlSecCryptoKeyDataGetKlassMethod xmlSecKeyDataDefaultKlasses[] = {
+    xmlSecKeyDataNameGetKlass,
+    xmlSecKeyDataValueGetKlass,
+    xmlSecKeyDataRetrievalMethodGetKlass,
+    xmlSecKeyDataKeyInfoReferenceGetKlass,
 
 #ifndef XMLSEC_NO_XMLENC
-    if(xmlSecKeyDataIdsRegister(xmlSecKeyDataEncryptedKeyId) < 0) {
-        xmlSecInternalError("xmlSecKeyDataIdsRegister(xmlSecKeyDataEncryptedKeyId)", NULL);
-        return(-1);
-    }
-    if(xmlSecKeyDataIdsRegister(xmlSecKeyDataAgreementMethodId) < 0) {
-        xmlSecInternalError("xmlSecKeyDataIdsRegister(xmlSecKeyDataAgreementMethodId)", NULL);
-        return(-1);
+    xmlSecKeyDataEncryptedKeyGetKlass,
+    xmlSecKeyDataAgreementMethodGetKlass,
+    xmlSecKeyDataDerivedKeyGetKlass,
+#endif /* XMLSEC_NO_XMLENC */
+};
+
+#define XMLSEC_KEY_DATA_DEFAULT_KLASSES_SIZE \
+    (sizeof(xmlSecKeyDataDefaultKlasses) / sizeof(xmlSecKeyDataDefaultKlasses[0]))
+
+/**
+ * xmlSecKeyDataIdsRegisterDefault:
+ *
+ * Registers default (implemented by XML Security Library)
+ * key data klasses: &lt;dsig:KeyName/&gt; element processing klass,
+ * &lt;dsig:KeyValue/&gt; element processing klass, ...
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeyDataIdsRegisterDefault(void) {
+    xmlSecKeyDataId ids[XMLSEC_KEY_DATA_DEFAULT_KLASSES_SIZE];
+    xmlSecSize ii;
+
+    for(ii = 0; ii < XMLSEC_KEY_DATA_DEFAULT_KLASSES_SIZE; ++ii) {
+        ids[ii] = xmlSecKeyDataDefaultKlasses[ii]();
     }
-    if(xmlSecKeyDataIdsRegister(xmlSecKeyDataDerivedKeyId) < 0) {
-        xmlSecInternalError("xmlSecKeyDataIdsRegister(xmlSecKeyDataDerivedKeyId)", NULL);
+    if(xmlSecKeyDataIdsRegisterArray(ids, XMLSEC_KEY_DATA_DEFAULT_KLASSES_SIZE) < 0) {
+        xmlSecInternalError("xmlSecKeyDataIdsRegisterArray", NULL);
         return(-1);
     }
-#endif /* XMLSEC_NO_XMLENC */
-
     return(0);
 }
 
@@ -203,6 +293,14 @@ xmlSecKeyDataCreate(xmlSecKeyDataId id)  {
     memset(data, 0, id->objSize);
     data->id = id;
 
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagKeys, 0, id->objSize) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate",
+                            xmlSecKeyDataKlassGetName(id));
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagKeys, id->objSize, 0);
+        xmlFree(data);
+        return(NULL);
+    }
+
     if(id->initialize != NULL) {
         ret = (id->initialize)(data);
         if(ret < 0) {
@@ -266,6 +364,7 @@ xmlSecKeyDataDestroy(xmlSecKeyDataPtr data) {
     if(data->id->finalize != NULL) {
         (data->id->finalize)(data);
     }
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagKeys, data->id->objSize, 0);
     memset(data, 0, data->id->objSize);
     xmlFree(data);
 }
@@ -501,6 +600,7 @@ xmlSecKeyDataBinaryValueInitialize(xmlSecKeyDataPtr data) {
                             xmlSecKeyDataGetName(data));
         return(-1);
     }
+    xmlSecBufferSetZeroMode(buffer, xmlSecBufferZeroModeSecure);
 
     return(0);
 }
@@ -574,7 +674,8 @@ xmlSecKeyDataBinaryValueFinalize(xmlSecKeyDataPtr data) {
 int
 xmlSecKeyDataBinaryValueXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key,
                                 xmlNodePtr node, xmlSecKeyInfoCtxPtr keyInfoCtx) {
-    xmlChar* str = NULL;
+    xmlSecBuffer buf;
+    int bufInitialized = 0;
     xmlSecKeyDataPtr data = NULL;
     xmlSecSize decodedSize;
     int ret;
@@ -585,19 +686,20 @@ xmlSecKeyDataBinaryValueXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key,
     xmlSecAssert2(node != NULL, -1);
     xmlSecAssert2(keyInfoCtx != NULL, -1);
 
-    str = xmlNodeGetContent(node);
-    if(str == NULL) {
-        xmlSecInvalidNodeContentError(node, xmlSecKeyDataKlassGetName(id), "empty");
+    ret = xmlSecBufferInitialize(&buf, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", xmlSecKeyDataKlassGetName(id));
         goto done;
     }
+    bufInitialized = 1;
 
-    /* usual trick: decode into the same buffer */
-    decodedSize = 0;
-    ret = xmlSecBase64DecodeInPlace(str, &decodedSize);
+    /* decode the text children directly into the buffer */
+    ret = xmlSecBufferBase64NodeContentRead(&buf, node);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecBase64Decode_ex", xmlSecKeyDataKlassGetName(id));
+        xmlSecInternalError("xmlSecBufferBase64NodeContentRead", xmlSecKeyDataKlassGetName(id));
         goto done;
     }
+    decodedSize = xmlSecBufferGetSize(&buf);
 
     /* check do we have a key already */
     data = xmlSecKeyGetValue(key);
@@ -619,7 +721,7 @@ xmlSecKeyDataBinaryValueXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key,
                     xmlSecBufferGetSize(buffer), decodedSize);
                 goto done;
             }
-            if((decodedSize > 0) && (memcmp(xmlSecBufferGetData(buffer), str, decodedSize) != 0)) {
+            if((decodedSize > 0) && (memcmp(xmlSecBufferGetData(buffer), xmlSecBufferGetData(&buf), decodedSize) != 0)) {
                 xmlSecOtherError(XMLSEC_ERRORS_R_KEY_DATA_ALREADY_EXIST,
                     xmlSecKeyDataGetName(data),
                     "key already has a different value");
@@ -641,7 +743,7 @@ xmlSecKeyDataBinaryValueXmlRead(xmlSecKeyDataId id, xmlSecKeyPtr key,
         goto done;
     }
 
-    ret = xmlSecKeyDataBinaryValueSetBuffer(data, (xmlSecByte*)str, decodedSize);
+    ret = xmlSecKeyDataBinaryValueSetBuffer(data, xmlSecBufferGetData(&buf), decodedSize);
     if(ret < 0) {
         xmlSecInternalError2("xmlSecKeyDataBinaryValueSetBuffer",
             xmlSecKeyDataKlassGetName(id),
@@ -668,8 +770,8 @@ done:
     if(data != NULL) {
         xmlSecKeyDataDestroy(data);
     }
-    if(str != NULL) {
-        xmlFree(str);
+    if(bufInitialized != 0) {
+        xmlSecBufferFinalize(&buf);
     }
     return(res);
 }
@@ -692,6 +794,7 @@ xmlSecKeyDataBinaryValueXmlWrite(xmlSecKeyDataId id, xmlSecKeyPtr key,
     xmlSecBufferPtr buffer;
     xmlSecKeyDataPtr value;
     xmlChar* str;
+    int ret;
 
     xmlSecAssert2(id != xmlSecKeyDataIdUnknown, -1);
     xmlSecAssert2(key != NULL, -1);
@@ -717,8 +820,13 @@ xmlSecKeyDataBinaryValueXmlWrite(xmlSecKeyDataId id, xmlSecKeyPtr key,
                             xmlSecKeyDataKlassGetName(id));
         return(-1);
     }
-    xmlNodeSetContent(node, str);
-    xmlFree(str);
+    xmlNodeSetContent(node, NULL);
+    ret = xmlSecNodeAdoptContent(node, str);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecNodeAdoptContent",
+                            xmlSecKeyDataKlassGetName(id));
+        return(-1);
+    }
     return(0);
 }
 
@@ -2125,12 +2233,14 @@ xmlSecKeyValueDsaInitialize(xmlSecKeyValueDsaPtr data) {
         xmlSecKeyValueDsaFinalize(data);
         return(-1);
     }
-    ret = xmlSecBufferInitialize(&(data->x), XMLSEC_KEY_DATA_DSA_INIT_BUF_SIZE);
+    /* the private key goes to the secure memory arena */
+    ret = xmlSecBufferInitialize(&(data->x), 0);
     if(ret < 0) {
         xmlSecInternalError("xmlSecBufferInitialize(x)", NULL);
         xmlSecKeyValueDsaFinalize(data);
         return(-1);
     }
+    xmlSecBufferSetZeroMode(&(data->x), xmlSecBufferZeroModeSecure);
     ret = xmlSecBufferInitialize(&(data->y), XMLSEC_KEY_DATA_DSA_INIT_BUF_SIZE);
     if(ret < 0) {
         xmlSecInternalError("xmlSecBufferInitialize(y)", NULL);
@@ -2569,12 +2679,14 @@ xmlSecKeyValueRsaInitialize(xmlSecKeyValueRsaPtr data) {
         xmlSecKeyValueRsaFinalize(data);
         return(-1);
     }
-    ret = xmlSecBufferInitialize(&(data->privateExponent), XMLSEC_KEY_DATA_RSA_INIT_BUF_SIZE);
+    /* the private key goes to the secure memory arena */
+    ret = xmlSecBufferInitialize(&(data->privateExponent), 0);
     if(ret < 0) {
         xmlSecInternalError("xmlSecBufferInitialize(g)", NULL);
         xmlSecKeyValueRsaFinalize(data);
         return(-1);
     }
+    xmlSecBufferSetZeroMode(&(data->privateExponent), xmlSecBufferZeroModeSecure);
     return(0);
 }
 
@@ -2815,6 +2927,8 @@ xmlSecKeyValueRsaXmlWrite(xmlSecKeyValueRsaPtr data, xmlNodePtr node,
  *************************************************************************/
 #define XMLSEC_KEY_DATA_X509_INIT_BUF_SIZE     512
 
+static int gXmlSecKeyDataX509ShallowCopy = 0;
+
 static int                      xmlSecKeyX509DataValueInitialize            (xmlSecKeyX509DataValuePtr x509Value);
 static void                     xmlSecKeyX509DataValueFinalize              (xmlSecKeyX509DataValuePtr x509Value);
 static void                     xmlSecKeyX509DataValueReset                 (xmlSecKeyX509DataValuePtr x509Value,
@@ -2827,6 +2941,47 @@ static int                      xmlSecKeyX509DataValueXmlWrite              (xml
                                                                              int base64LineSize,
                                                                              int addLineBreaks);
 
+/**
+ * xmlSecKeyDataX509SetDefaultShallowCopy:
+ * @enabled:            1 to share the certificates and CRLs between the
+ *                      duplicated X509 key data or 0 to copy them.
+ *
+ * Sets the default X509 key data duplication mode. By default, the crypto
+ * libraries that keep the certificates as plain objects (OpenSSL) copy all
+ * the certificates and CRLs when the key is duplicated (e.g. for every key
+ * returned by the keys manager). In the shallow copy mode, the duplicated
+ * key data shares the same reference counted objects instead: the X509 key
+ * data never modifies the certificates or CRLs after they were added and
+ * only the lists holding them are copied. The crypto libraries that always
+ * share the objects (NSS, MSCrypto, MSCng) or can't share them (GnuTLS, GCrypt)
+ * ignore this setting. This function is not thread safe and should be called
+ * during initialization, the settings attached to the current thread override
+ * it (see #xmlSecSettings).
+ */
+void
+xmlSecKeyDataX509SetDefaultShallowCopy(int enabled) {
+    gXmlSecKeyDataX509ShallowCopy = (enabled != 0) ? 1 : 0;
+}
+
+/**
+ * xmlSecKeyDataX509GetDefaultShallowCopy:
+ *
+ * Gets the X509 key data duplication mode for the current thread
+ * (see #xmlSecKeyDataX509SetDefaultShallowCopy).
+ *
+ * Returns: 1 if the certificates and CRLs are shared between the duplicated
+ * X509 key data or 0 if they are copied.
+ */
+int
+xmlSecKeyDataX509GetDefaultShallowCopy(void) {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_X509_SHALLOW_COPY) != 0)) {
+        return((settings->x509ShallowCopy != 0) ? 1 : 0);
+    }
+    return(gXmlSecKeyDataX509ShallowCopy);
+}
+
 /**
  * xmlSecKeyDataX509XmlRead:
  * @key:                the resulting key
@@ -2876,6 +3031,17 @@ xmlSecKeyDataX509XmlRead(xmlSecKeyPtr key, xmlSecKeyDataPtr data, xmlNodePtr nod
 
             tmpKey = xmlSecKeysMngrFindKeyFromX509Data(keyInfoCtx->keysMngr, &x509Value, keyInfoCtx);
             if(tmpKey != NULL) {
+                xmlSecKeyPtr newKey;
+
+                /* the found key might be shared with the keys store */
+                newKey = xmlSecKeyMakeWritable(tmpKey);
+                if(newKey == NULL) {
+                    xmlSecInternalError("xmlSecKeyMakeWritable", NULL);
+                    xmlSecKeyDestroy(tmpKey);
+                    goto done;
+                }
+                tmpKey = newKey;
+
                 ret = xmlSecKeySwap(key, tmpKey);
                 if(ret < 0) {
                     xmlSecInternalError("xmlSecKeysMngrFindKeyFromX509Data", NULL);
@@ -3166,54 +3332,28 @@ xmlSecKeyX509DataValueReset(xmlSecKeyX509DataValuePtr x509Value, int writeMode)
 
 static int
 xmlSecKeyX509DataValueXmlReadBase64Blob(xmlSecBufferPtr buf, xmlNodePtr node, xmlSecKeyInfoCtxPtr keyInfoCtx) {
-    xmlChar *content;
-    xmlSecSize decodedSize;
     int ret;
-    int res = -1;
 
     xmlSecAssert2(buf != NULL, -1);
     xmlSecAssert2(node != NULL, -1);
     xmlSecAssert2(keyInfoCtx != NULL, -1);
 
-    content = xmlNodeGetContent(node);
-    if((content == NULL) || (xmlSecIsEmptyString(content) == 1)) {
-        if((keyInfoCtx->flags & XMLSEC_KEYINFO_FLAGS_STOP_ON_EMPTY_NODE) != 0) {
-            xmlSecInvalidNodeContentError(node, NULL, "empty");
-            goto done;
-        }
-
-        /* success */
-        res = 0;
-        goto done;
-    }
-
-    /* usual trick with base64 decoding "in-place" */
-    decodedSize = 0;
-    ret = xmlSecBase64DecodeInPlace(content, &decodedSize);
+    /* decode the text children directly into the buffer */
+    ret = xmlSecBufferBase64NodeContentRead(buf, node);
     if(ret < 0) {
-        xmlSecInternalError2("xmlSecBase64DecodeInPlace", NULL,
+        xmlSecInternalError2("xmlSecBufferBase64NodeContentRead", NULL,
             "node=%s", xmlSecErrorsSafeString(xmlSecNodeGetName(node)));
-        goto done;
+        return(-1);
     }
-
-    ret = xmlSecBufferSetData(buf, (xmlSecByte*)content, decodedSize);
-    if(ret < 0) {
-        xmlSecInternalError3("xmlSecBufferSetData", NULL,
-            "node=%s; size=" XMLSEC_SIZE_FMT,
-            xmlSecErrorsSafeString(xmlSecNodeGetName(node)),
-            decodedSize);
-        goto done;
+    if(xmlSecBufferGetSize(buf) <= 0) {
+        if((keyInfoCtx->flags & XMLSEC_KEYINFO_FLAGS_STOP_ON_EMPTY_NODE) != 0) {
+            xmlSecInvalidNodeContentError(node, NULL, "empty");
+            return(-1);
+        }
     }
 
     /* success */
-    res = 0;
-
-done:
-    /* cleanup */
-    if(content != NULL) {
-        xmlFree(content);
-    }
-    return(res);
+    return(0);
 }
 
 static void
@@ -3417,6 +3557,7 @@ xmlSecKeyX509DataValueXmlWriteBase64Blob(xmlSecBufferPtr buf, xmlNodePtr node,
                                     int base64LineSize, int addLineBreaks) {
     xmlNodePtr child = NULL;
     xmlChar *content;
+    int ret;
 
     xmlSecAssert2(buf != NULL, NULL);
     xmlSecAssert2(node != NULL, NULL);
@@ -3440,7 +3581,15 @@ xmlSecKeyX509DataValueXmlWriteBase64Blob(xmlSecBufferPtr buf, xmlNodePtr node,
         xmlNodeAddContent(child, xmlSecGetDefaultLineFeed());
     }
 
-    xmlNodeSetContent(child, content);
+    /* the node takes the encoded string as is */
+    xmlNodeSetContent(child, NULL);
+    ret = xmlSecNodeAdoptContent(child, content);
+    content = NULL;
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecNodeAdoptContent", NULL);
+        child = NULL;
+        goto done;
+    }
 
     if(addLineBreaks) {
         xmlNodeAddContent(child, xmlSecGetDefaultLineFeed());
@@ -3674,6 +3823,23 @@ xmlSecKeyDataIdListFindByNode(xmlSecPtrListPtr list, const xmlChar* nodeName,
     xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyDataIdListId), xmlSecKeyDataIdUnknown);
     xmlSecAssert2(nodeName != NULL, xmlSecKeyDataIdUnknown);
 
+    if((list == xmlSecKeyDataIdsGet()) && xmlSecPtrListIndexIsValid(&xmlSecAllKeyDataIdsByNode, list)) {
+        for(i = xmlSecPtrListIndexFirst(&xmlSecAllKeyDataIdsByNode, nodeName); i > 0;
+            i = xmlSecPtrListIndexNext(&xmlSecAllKeyDataIdsByNode, i))
+        {
+            dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(list, i - 1);
+            xmlSecAssert2(dataId != xmlSecKeyDataIdUnknown, xmlSecKeyDataIdUnknown);
+
+            if(((usage & dataId->usage) != 0) &&
+               xmlStrEqual(nodeName, dataId->dataNodeName) &&
+               xmlStrEqual(nodeNs, dataId->dataNodeNs)) {
+
+               return(dataId);
+            }
+        }
+        return(xmlSecKeyDataIdUnknown);
+    }
+
     size = xmlSecPtrListGetSize(list);
     for(i = 0; i < size; ++i) {
         dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(list, i);
@@ -3708,6 +3874,20 @@ xmlSecKeyDataIdListFindByHref(xmlSecPtrListPtr list, const xmlChar* href,
     xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyDataIdListId), xmlSecKeyDataIdUnknown);
     xmlSecAssert2(href != NULL, xmlSecKeyDataIdUnknown);
 
+    if((list == xmlSecKeyDataIdsGet()) && xmlSecPtrListIndexIsValid(&xmlSecAllKeyDataIdsByHref, list)) {
+        for(i = xmlSecPtrListIndexFirst(&xmlSecAllKeyDataIdsByHref, href); i > 0;
+            i = xmlSecPtrListIndexNext(&xmlSecAllKeyDataIdsByHref, i))
+        {
+            dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(list, i - 1);
+            xmlSecAssert2(dataId != xmlSecKeyDataIdUnknown, xmlSecKeyDataIdUnknown);
+
+            if(((usage & dataId->usage) != 0) && xmlStrEqual(href, dataId->href)) {
+               return(dataId);
+            }
+        }
+        return(xmlSecKeyDataIdUnknown);
+    }
+
     size = xmlSecPtrListGetSize(list);
     for(i = 0; i < size; ++i) {
         dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(list, i);
@@ -3741,6 +3921,20 @@ xmlSecKeyDataIdListFindByName(xmlSecPtrListPtr list, const xmlChar* name,
     xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyDataIdListId), xmlSecKeyDataIdUnknown);
     xmlSecAssert2(name != NULL, xmlSecKeyDataIdUnknown);
 
+    if((list == xmlSecKeyDataIdsGet()) && xmlSecPtrListIndexIsValid(&xmlSecAllKeyDataIdsByName, list)) {
+        for(i = xmlSecPtrListIndexFirst(&xmlSecAllKeyDataIdsByName, name); i > 0;
+            i = xmlSecPtrListIndexNext(&xmlSecAllKeyDataIdsByName, i))
+        {
+            dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(list, i - 1);
+            xmlSecAssert2(dataId != xmlSecKeyDataIdUnknown, xmlSecKeyDataIdUnknown);
+
+            if(((usage & dataId->usage) != 0) && xmlStrEqual(name, BAD_CAST dataId->name)) {
+               return(dataId);
+            }
+        }
+        return(xmlSecKeyDataIdUnknown);
+    }
+
     size = xmlSecPtrListGetSize(list);
     for(i = 0; i < size; ++i) {
         dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(list, i);
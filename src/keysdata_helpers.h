@@ -20,6 +20,14 @@
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/x509.h>
 
+/**************************************************************************
+ *
+ * Registration
+ *
+ *************************************************************************/
+XMLSEC_EXPORT int               xmlSecKeyDataIdsRegisterArray           (const xmlSecKeyDataId* ids,
+                                                                         xmlSecSize idsSize);
+
 /**************************************************************************
  *
  * xmlSecKeyDataBinary (for HMAC, AES, DES, ...)
@@ -354,4 +362,83 @@ XMLSEC_EXPORT int               xmlSecKeyDataX509XmlWrite               (xmlSecK
                                                                          void* writeFuncContext);
 #endif /* !defined(XMLSEC_NO_X509) */
 
+/**************************************************************************
+ *
+ * Keys manager cache for decrypted &lt;enc:EncryptedKey/&gt; keys
+ *
+ *************************************************************************/
+int                             xmlSecKeysMngrUnwrapCacheFind           (xmlSecKeysMngrPtr mngr,
+                                                                         const xmlSecByte* id,
+                                                                         xmlSecSize idSize,
+                                                                         xmlSecBufferPtr result);
+int                             xmlSecKeysMngrUnwrapCacheAdd            (xmlSecKeysMngrPtr mngr,
+                                                                         const xmlSecByte* id,
+                                                                         xmlSecSize idSize,
+                                                                         const xmlSecByte* data,
+                                                                         xmlSecSize dataSize);
+
+/**************************************************************************
+ *
+ * Keys manager cache for generated session keys
+ *
+ *************************************************************************/
+int                             xmlSecKeysMngrSessionKeyCacheFind       (xmlSecKeysMngrPtr mngr,
+                                                                         const xmlSecByte* id,
+                                                                         xmlSecSize idSize,
+                                                                         xmlDocPtr doc,
+                                                                         xmlSecKeyPtr* key,
+                                                                         xmlNodePtr* keyInfoNode);
+int                             xmlSecKeysMngrSessionKeyCacheAdd        (xmlSecKeysMngrPtr mngr,
+                                                                         const xmlSecByte* id,
+                                                                         xmlSecSize idSize,
+                                                                         xmlSecKeyPtr key,
+                                                                         xmlNodePtr keyInfoNode);
+
+/**************************************************************************
+ *
+ * Keys manager cache for the keys resolved from &lt;dsig:KeyInfo/&gt; nodes
+ *
+ *************************************************************************/
+xmlSecKeyPtr                    xmlSecKeysMngrKeyInfoCacheFind          (xmlSecKeysMngrPtr mngr,
+                                                                         const xmlSecByte* id,
+                                                                         xmlSecSize idSize);
+int                             xmlSecKeysMngrKeyInfoCacheAdd           (xmlSecKeysMngrPtr mngr,
+                                                                         const xmlSecByte* id,
+                                                                         xmlSecSize idSize,
+                                                                         xmlSecKeyPtr key);
+
+/**************************************************************************
+ *
+ * Keys manager cache for the external &lt;dsig:RetrievalMethod/&gt; and
+ * &lt;dsig11:KeyInfoReference/&gt; results
+ *
+ *************************************************************************/
+int                             xmlSecKeysMngrRetrievalCacheFind        (xmlSecKeysMngrPtr mngr,
+                                                                         const xmlSecByte* id,
+                                                                         xmlSecSize idSize,
+                                                                         xmlSecBufferPtr result);
+int                             xmlSecKeysMngrRetrievalCacheAdd         (xmlSecKeysMngrPtr mngr,
+                                                                         const xmlSecByte* id,
+                                                                         xmlSecSize idSize,
+                                                                         const xmlSecByte* data,
+                                                                         xmlSecSize dataSize);
+
+/**************************************************************************
+ *
+ * Keys manager cache for the keys that were not found
+ *
+ *************************************************************************/
+void                            xmlSecKeysMngrNotFoundCacheReset        (xmlSecKeysMngrPtr mngr);
+
+/**************************************************************************
+ *
+ * Keys manager pool of one-time originator keys for key agreement
+ *
+ *************************************************************************/
+xmlSecKeyPtr                    xmlSecKeysMngrPopEphemeralKey           (xmlSecKeysMngrPtr mngr,
+                                                                         xmlNodePtr node,
+                                                                         const xmlChar* name,
+                                                                         xmlSecKeyReqPtr keyReq,
+                                                                         int claim);
+
 #endif /* __XMLSEC_KEYSDATA_HELPERS_H__ */
@@ -13,15 +13,28 @@
  * @Stability: Stable
  *
  */
+
+/* syscall(SYS_getcpu) for the snapshot keys store NUMA replicas */
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif /* defined(__linux__) && !defined(_DEFAULT_SOURCE) */
+
 #include "globals.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif /* defined(__linux__) */
 
 #include <libxml/tree.h>
 #include <libxml/parser.h>
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/xmltree.h>
@@ -29,10 +42,16 @@
 #include <xmlsec/keys.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/keysmngr.h>
+#include <xmlsec/executor.h>
+#include <xmlsec/parser.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/private.h>
 
 #include "cast_helpers.h"
+#include "filemap.h"
+#include "keysdata_helpers.h"
+#include "keysmngr_helpers.h"
 
 /****************************************************************************
  *
@@ -61,9 +80,19 @@ xmlSecKeysMngrCreate(void) {
     }
     memset(mngr, 0, sizeof(xmlSecKeysMngr));
 
+    mngr->priv = (xmlSecKeysMngrPrivatePtr)xmlMalloc(sizeof(xmlSecKeysMngrPrivate));
+    if(mngr->priv == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrPrivate), NULL);
+        xmlFree(mngr);
+        return(NULL);
+    }
+    memset(mngr->priv, 0, sizeof(xmlSecKeysMngrPrivate));
+
     ret = xmlSecPtrListInitialize(&(mngr->storesList), xmlSecKeyDataStorePtrListId);
     if(ret < 0) {
         xmlSecInternalError("xmlSecPtrListInitialize(xmlSecKeyDataStorePtrListId)", NULL);
+        xmlFree(mngr->priv);
+        xmlFree(mngr);
         return(NULL);
     }
 
@@ -88,35 +117,169 @@ xmlSecKeysMngrDestroy(xmlSecKeysMngrPtr mngr) {
     /* destroy other data stores */
     xmlSecPtrListFinalize(&(mngr->storesList));
 
+    /* destroy the cache */
+    xmlSecKeysMngrDisableUnwrapCache(mngr);
+    xmlSecKeysMngrDisableSessionKeyReuse(mngr);
+    xmlSecKeysMngrDisableKeyInfoCache(mngr);
+    xmlSecKeysMngrDisableRetrievalCache(mngr);
+    xmlSecKeysMngrDisableNotFoundCache(mngr);
+    xmlSecKeysMngrDisableEphemeralKeys(mngr);
+
+    memset(mngr->priv, 0, sizeof(xmlSecKeysMngrPrivate));
+    xmlFree(mngr->priv);
     memset(mngr, 0, sizeof(xmlSecKeysMngr));
     xmlFree(mngr);
 }
 
+/**
+ * xmlSecKeysMngrSetParent:
+ * @mngr:               the pointer to keys manager.
+ * @parent:             the pointer to parent keys manager or NULL.
+ *
+ * Sets the parent keys manager for @mngr. The keys and the data stores
+ * (e.g. the trusted certificates store) that are not found in @mngr are
+ * looked up in the @parent (and its parents). This allows to create many
+ * lightweight keys managers (e.g. one per tenant) with their own keys on top
+ * of one shared keys manager with the common keys and trusted certificates.
+ *
+ * The @parent is not owned by @mngr: it must outlive all its children
+ * and must not be modified while they are used. The shared data stores
+ * from the @parent must not be modified through the children either:
+ * use #xmlSecKeysMngrGetDataStore to get the data stores owned by @mngr.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeysMngrSetParent(xmlSecKeysMngrPtr mngr, xmlSecKeysMngrPtr parent) {
+    xmlSecKeysMngrPtr cur;
+
+    xmlSecAssert2(mngr != NULL, -1);
+
+    for(cur = parent; cur != NULL; cur = cur->priv->parent) {
+        if(cur == mngr) {
+            xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_OPERATION, NULL,
+                "the keys managers hierarchy can not have cycles");
+            return(-1);
+        }
+    }
+
+    mngr->priv->parent = parent;
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
+    return(0);
+}
+
+/**
+ * xmlSecKeysMngrGetParent:
+ * @mngr:               the pointer to keys manager.
+ *
+ * Gets the parent keys manager set with #xmlSecKeysMngrSetParent.
+ *
+ * Returns: the parent keys manager or NULL if there is no parent
+ * or an error occurs.
+ */
+xmlSecKeysMngrPtr
+xmlSecKeysMngrGetParent(xmlSecKeysMngrPtr mngr) {
+    xmlSecAssert2(mngr != NULL, NULL);
+
+    return(mngr->priv->parent);
+}
+
+/**
+ * xmlSecKeysMngrSetSettings:
+ * @mngr:               the pointer to keys manager.
+ * @settings:           the pointer to tuning settings or NULL.
+ *
+ * Sets the tuning settings attached to the thread for the duration of each
+ * DSig or Enc operation that uses @mngr (see #xmlSecSettingsAttach). The
+ * @settings are not owned by @mngr: they must outlive it and must not be
+ * modified while they are used.
+ */
+void
+xmlSecKeysMngrSetSettings(xmlSecKeysMngrPtr mngr, xmlSecSettingsPtr settings) {
+    xmlSecAssert(mngr != NULL);
+    xmlSecAssert(mngr->priv != NULL);
+
+    mngr->priv->settings = settings;
+}
+
+/**
+ * xmlSecKeysMngrGetSettings:
+ * @mngr:               the pointer to keys manager.
+ *
+ * Gets the tuning settings set with #xmlSecKeysMngrSetSettings.
+ *
+ * Returns: the tuning settings or NULL if there are no settings
+ * or an error occurs.
+ */
+xmlSecSettingsPtr
+xmlSecKeysMngrGetSettings(xmlSecKeysMngrPtr mngr) {
+    xmlSecAssert2(mngr != NULL, NULL);
+    xmlSecAssert2(mngr->priv != NULL, NULL);
+
+    return(mngr->priv->settings);
+}
+
+static int              xmlSecKeysMngrNotFoundCacheId           (xmlSecBufferPtr cacheId,
+                                                                 const xmlChar* name,
+                                                                 xmlSecKeyX509DataValuePtr x509Data,
+                                                                 xmlSecKeyInfoCtxPtr keyInfoCtx);
+static int              xmlSecKeysMngrNotFoundCacheFind         (xmlSecKeysMngrPtr mngr,
+                                                                 xmlSecBufferPtr cacheId);
+static void             xmlSecKeysMngrNotFoundCacheAdd          (xmlSecKeysMngrPtr mngr,
+                                                                 xmlSecBufferPtr cacheId);
+
 /**
  * xmlSecKeysMngrFindKey:
  * @mngr:               the pointer to keys manager.
  * @name:               the desired key name.
  * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; node processing context.
  *
- * Lookups key in the keys manager keys store. The caller is responsible
- * for destroying the returned key using #xmlSecKeyDestroy method.
+ * Lookups key in the keys manager keys store and then in the parent keys
+ * manager (if any). The caller is responsible for destroying the returned
+ * key using #xmlSecKeyDestroy method.
  *
  * Returns: the pointer to a key or NULL if key is not found or an error occurs.
  */
 xmlSecKeyPtr
 xmlSecKeysMngrFindKey(xmlSecKeysMngrPtr mngr, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
     xmlSecKeyStorePtr store;
+    xmlSecBuffer cacheId;
+    xmlSecKeyPtr key;
+    int useCache = 0;
 
     xmlSecAssert2(mngr != NULL, NULL);
     xmlSecAssert2(keyInfoCtx != NULL, NULL);
 
     store = xmlSecKeysMngrGetKeysStore(mngr);
-    if(store == NULL) {
+    if((store == NULL) && (mngr->priv->parent == NULL)) {
         /* no store. is it an error? */
         return(NULL);
     }
 
-    return(xmlSecKeyStoreFindKey(store, name, keyInfoCtx));
+    /* don't search again for the recently not found keys */
+    if(mngr->priv->notFoundCache != NULL) {
+        useCache = xmlSecKeysMngrNotFoundCacheId(&cacheId, name, NULL, keyInfoCtx);
+        if(useCache < 0) {
+            xmlSecInternalError("xmlSecKeysMngrNotFoundCacheId", NULL);
+            return(NULL);
+        }
+        if(xmlSecKeysMngrNotFoundCacheFind(mngr, &cacheId) != 0) {
+            xmlSecBufferFinalize(&cacheId);
+            return(NULL);
+        }
+    }
+
+    key = (store != NULL) ? xmlSecKeyStoreFindKey(store, name, keyInfoCtx) : NULL;
+    if((key == NULL) && (mngr->priv->parent != NULL)) {
+        key = xmlSecKeysMngrFindKey(mngr->priv->parent, name, keyInfoCtx);
+    }
+    if(useCache > 0) {
+        if(key == NULL) {
+            xmlSecKeysMngrNotFoundCacheAdd(mngr, &cacheId);
+        }
+        xmlSecBufferFinalize(&cacheId);
+    }
+    return(key);
 }
 
 /**
@@ -125,26 +288,53 @@ xmlSecKeysMngrFindKey(xmlSecKeysMngrPtr mngr, const xmlChar* name, xmlSecKeyInfo
  * @x509Data:           the X509 data to use for searching the keys.
  * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; node processing context.
  *
- * Lookups key in the keys manager keys store. The caller is responsible
- * for destroying the returned key using #xmlSecKeyDestroy method.
+ * Lookups key in the keys manager keys store and then in the parent keys
+ * manager (if any). The caller is responsible for destroying the returned
+ * key using #xmlSecKeyDestroy method.
  *
  * Returns: the pointer to a key or NULL if key is not found or an error occurs.
  */
 xmlSecKeyPtr
 xmlSecKeysMngrFindKeyFromX509Data(xmlSecKeysMngrPtr mngr, xmlSecKeyX509DataValuePtr x509Data, xmlSecKeyInfoCtxPtr keyInfoCtx) {
     xmlSecKeyStorePtr store;
+    xmlSecBuffer cacheId;
+    xmlSecKeyPtr key;
+    int useCache = 0;
 
     xmlSecAssert2(mngr != NULL, NULL);
     xmlSecAssert2(x509Data != NULL, NULL);
     xmlSecAssert2(keyInfoCtx != NULL, NULL);
 
     store = xmlSecKeysMngrGetKeysStore(mngr);
-    if(store == NULL) {
+    if((store == NULL) && (mngr->priv->parent == NULL)) {
         /* no store. is it an error? */
         return(NULL);
     }
 
-    return(xmlSecKeyStoreFindKeyFromX509Data(store, x509Data, keyInfoCtx));
+    /* don't search again for the recently not found keys */
+    if(mngr->priv->notFoundCache != NULL) {
+        useCache = xmlSecKeysMngrNotFoundCacheId(&cacheId, NULL, x509Data, keyInfoCtx);
+        if(useCache < 0) {
+            xmlSecInternalError("xmlSecKeysMngrNotFoundCacheId", NULL);
+            return(NULL);
+        }
+        if(xmlSecKeysMngrNotFoundCacheFind(mngr, &cacheId) != 0) {
+            xmlSecBufferFinalize(&cacheId);
+            return(NULL);
+        }
+    }
+
+    key = (store != NULL) ? xmlSecKeyStoreFindKeyFromX509Data(store, x509Data, keyInfoCtx) : NULL;
+    if((key == NULL) && (mngr->priv->parent != NULL)) {
+        key = xmlSecKeysMngrFindKeyFromX509Data(mngr->priv->parent, x509Data, keyInfoCtx);
+    }
+    if(useCache > 0) {
+        if(key == NULL) {
+            xmlSecKeysMngrNotFoundCacheAdd(mngr, &cacheId);
+        }
+        xmlSecBufferFinalize(&cacheId);
+    }
+    return(key);
 }
 
 
@@ -166,6 +356,7 @@ xmlSecKeysMngrAdoptKeysStore(xmlSecKeysMngrPtr mngr, xmlSecKeyStorePtr store) {
         xmlSecKeyStoreDestroy(mngr->keysStore);
     }
     mngr->keysStore = store;
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
 
     return(0);
 }
@@ -203,6 +394,8 @@ xmlSecKeysMngrAdoptDataStore(xmlSecKeysMngrPtr mngr, xmlSecKeyDataStorePtr store
     xmlSecAssert2(mngr != NULL, -1);
     xmlSecAssert2(xmlSecKeyDataStoreIsValid(store), -1);
 
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
+
     size = xmlSecPtrListGetSize(&(mngr->storesList));
     for(pos = 0; pos < size; ++pos) {
         tmp = (xmlSecKeyDataStorePtr)xmlSecPtrListGetItem(&(mngr->storesList), pos);
@@ -244,518 +437,4915 @@ xmlSecKeysMngrGetDataStore(xmlSecKeysMngrPtr mngr, xmlSecKeyDataStoreId id) {
     return(NULL);
 }
 
-/**************************************************************************
- *
- * xmlSecKeyStore functions
- *
- *************************************************************************/
 /**
- * xmlSecKeyStoreCreate:
- * @id:                 the key store klass.
+ * xmlSecKeysMngrFindDataStore:
+ * @mngr:               the pointer to keys manager.
+ * @id:                 the desired data store klass.
  *
- * Creates new store of the specified klass @klass. Caller is responsible
- * for freeing the returned store by calling #xmlSecKeyStoreDestroy function.
+ * Lookups the data store of given klass @id in the keys manager and then
+ * in the parent keys manager (if any). Unlike #xmlSecKeysMngrGetDataStore,
+ * the returned data store might be shared with other keys managers and
+ * should only be used for the lookups (e.g. for the certificates verification).
  *
- * Returns: the pointer to newly allocated keys store or NULL if an error occurs.
+ * Returns: pointer to data store or NULL if it is not found or an error
+ * occurs.
  */
-xmlSecKeyStorePtr
-xmlSecKeyStoreCreate(xmlSecKeyStoreId id)  {
-    xmlSecKeyStorePtr store;
-    int ret;
-
-    xmlSecAssert2(id != NULL, NULL);
-    xmlSecAssert2(id->objSize > 0, NULL);
+xmlSecKeyDataStorePtr
+xmlSecKeysMngrFindDataStore(xmlSecKeysMngrPtr mngr, xmlSecKeyDataStoreId id) {
+    xmlSecKeyDataStorePtr store;
 
-    /* Allocate a new xmlSecKeyStore and fill the fields. */
-    store = (xmlSecKeyStorePtr)xmlMalloc(id->objSize);
-    if(store == NULL) {
-        xmlSecMallocError(id->objSize,
-                          xmlSecKeyStoreKlassGetName(id));
-        return(NULL);
-    }
-    memset(store, 0, id->objSize);
-    store->id = id;
+    xmlSecAssert2(mngr != NULL, NULL);
+    xmlSecAssert2(id != xmlSecKeyDataStoreIdUnknown, NULL);
 
-    if(id->initialize != NULL) {
-        ret = (id->initialize)(store);
-        if(ret < 0) {
-            xmlSecInternalError("id->initialize",
-                                xmlSecKeyStoreKlassGetName(id));
-            xmlSecKeyStoreDestroy(store);
-            return(NULL);
+    for(; mngr != NULL; mngr = mngr->priv->parent) {
+        store = xmlSecKeysMngrGetDataStore(mngr, id);
+        if(store != NULL) {
+            return(store);
         }
     }
-
-    return(store);
+    return(NULL);
 }
 
-/**
- * xmlSecKeyStoreDestroy:
- * @store:              the pointer to keys store.
+/****************************************************************************
  *
- * Destroys the store created with #xmlSecKeyStoreCreate function.
- */
-void
-xmlSecKeyStoreDestroy(xmlSecKeyStorePtr store) {
-    xmlSecAssert(xmlSecKeyStoreIsValid(store));
-    xmlSecAssert(store->id->objSize > 0);
+ * Keys Manager cache for the decrypted &lt;enc:EncryptedKey/&gt; keys. The
+ * entries are identified by the full &lt;enc:EncryptedKey/&gt; node data
+ * (the hash is only used to speed up the comparison), evicted in the
+ * insertion order when the cache is full, and zeroed when removed.
+ *
+ ***************************************************************************/
+typedef struct _xmlSecKeysMngrUnwrapCacheEntry  xmlSecKeysMngrUnwrapCacheEntry,
+                                                *xmlSecKeysMngrUnwrapCacheEntryPtr;
+struct _xmlSecKeysMngrUnwrapCacheEntry {
+    unsigned int                        hash;
+    xmlSecByte*                         id;
+    xmlSecSize                          idSize;
+    xmlSecByte*                         data;
+    xmlSecSize                          dataSize;
+    time_t                              expires;
+};
 
-    if(store->id->finalize != NULL) {
-        (store->id->finalize)(store);
+struct _xmlSecKeysMngrUnwrapCache {
+    xmlMutexPtr                         mutex;
+    xmlSecKeysMngrUnwrapCacheEntryPtr   entries;
+    xmlSecSize                          maxSize;
+    xmlSecSize                          pos;
+    unsigned int                        ttl;
+};
+
+static unsigned int
+xmlSecKeysMngrUnwrapCacheHash(const xmlSecByte* id, xmlSecSize idSize) {
+    unsigned int hash = 5381;
+    xmlSecSize ii;
+
+    for(ii = 0; ii < idSize; ++ii) {
+        hash = (hash * 33) ^ id[ii];
     }
-    memset(store, 0, store->id->objSize);
-    xmlFree(store);
+    return(hash);
 }
 
-/**
- * xmlSecKeyStoreFindKey:
- * @store:              the pointer to keys store.
- * @name:               the desired key name.
- * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; node processing context.
- *
- * Lookups key in the store. The caller is responsible for destroying
- * the returned key using #xmlSecKeyDestroy method.
- *
- * Returns: the pointer to a key or NULL if key is not found or an error occurs.
- */
-xmlSecKeyPtr
-xmlSecKeyStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
-    xmlSecAssert2(xmlSecKeyStoreIsValid(store), NULL);
-    xmlSecAssert2(keyInfoCtx != NULL, NULL);
+static void
+xmlSecKeysMngrUnwrapCacheEntryClear(xmlSecKeysMngrUnwrapCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
 
-    if(store->id->findKey == NULL) {
-        return(NULL);
+    if(entry->data != NULL) {
+        memset(entry->data, 0, entry->dataSize);
+        xmlFree(entry->data);
     }
-    return(store->id->findKey(store, name, keyInfoCtx));
+    if(entry->id != NULL) {
+        xmlFree(entry->id);
+    }
+    memset(entry, 0, sizeof(xmlSecKeysMngrUnwrapCacheEntry));
 }
 
 /**
- * xmlSecKeyStoreFindKeyFromX509Data:
- * @store:              the pointer to keys store.
- * @x509Data:           the X509 data to use for search.
- * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; node processing context.
+ * xmlSecKeysMngrEnableUnwrapCache:
+ * @mngr:               the pointer to keys manager.
+ * @maxSize:            the max number of keys in the cache.
+ * @ttl:                the max time (in seconds) to keep a key in the cache
+ *                      or 0 to keep the keys until they are evicted.
  *
- * Lookups key in the store. The caller is responsible for destroying
- * the returned key using #xmlSecKeyDestroy method.
+ * Enables (or re-creates empty) cache for the decrypted &lt;enc:EncryptedKey/&gt;
+ * keys: the same &lt;enc:EncryptedKey/&gt; node (the same CipherValue,
+ * algorithm, recipient key information, etc.) is decrypted only once
+ * and the following requests get the key from the cache. The cached keys
+ * are only returned to the contexts with the same key requirements, flags,
+ * enabled key data and enabled &lt;enc:EncryptedKey/&gt; transforms as the
+ * context that decrypted the key; the keys are not cached if the context
+ * has the key usage restrictions or the transforms pre-execute callback.
+ * The cache should be cleared by calling #xmlSecKeysMngrEnableUnwrapCache
+ * again if the keys in the keys manager change.
  *
- * Returns: the pointer to a key or NULL if key is not found or an error occurs.
+ * Returns: 0 on success or a negative value if an error occurs.
  */
-xmlSecKeyPtr
-xmlSecKeyStoreFindKeyFromX509Data(xmlSecKeyStorePtr store, xmlSecKeyX509DataValuePtr x509Data, xmlSecKeyInfoCtxPtr keyInfoCtx) {
-    xmlSecAssert2(xmlSecKeyStoreIsValid(store), NULL);
-    xmlSecAssert2(x509Data != NULL, NULL);
-    xmlSecAssert2(keyInfoCtx != NULL, NULL);
-
-    if(store->id->findKeyFromX509Data == NULL) {
-        return(NULL);
-    }
-    return(store->id->findKeyFromX509Data(store, x509Data, keyInfoCtx));
-}
+int
+xmlSecKeysMngrEnableUnwrapCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize, unsigned int ttl) {
+    xmlSecKeysMngrUnwrapCachePtr cache;
 
-/****************************************************************************
- *
- * Simple Keys Store
- *
- * xmlSecKeyStore + xmlSecPtrList (keys list)
- *
- ***************************************************************************/
-XMLSEC_KEY_STORE_DECLARE(SimpleKeysStore, xmlSecPtrList)
-#define xmlSecSimpleKeysStoreSize XMLSEC_KEY_STORE_SIZE(SimpleKeysStore)
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
 
-static int                      xmlSecSimpleKeysStoreInitialize (xmlSecKeyStorePtr store);
-static void                     xmlSecSimpleKeysStoreFinalize   (xmlSecKeyStorePtr store);
-static xmlSecKeyPtr             xmlSecSimpleKeysStoreFindKey    (xmlSecKeyStorePtr store,
-                                                                 const xmlChar* name,
-                                                                 xmlSecKeyInfoCtxPtr keyInfoCtx);
+    xmlSecKeysMngrDisableUnwrapCache(mngr);
 
-static xmlSecKeyStoreKlass xmlSecSimpleKeysStoreKlass = {
-    sizeof(xmlSecKeyStoreKlass),
-    xmlSecSimpleKeysStoreSize,
+    cache = (xmlSecKeysMngrUnwrapCachePtr)xmlMalloc(sizeof(xmlSecKeysMngrUnwrapCache));
+    if(cache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrUnwrapCache), NULL);
+        return(-1);
+    }
+    memset(cache, 0, sizeof(xmlSecKeysMngrUnwrapCache));
 
-    /* data */
-    BAD_CAST "simple-keys-store",               /* const xmlChar* name; */
+    cache->entries = (xmlSecKeysMngrUnwrapCacheEntryPtr)xmlMalloc(sizeof(xmlSecKeysMngrUnwrapCacheEntry) * maxSize);
+    if(cache->entries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrUnwrapCacheEntry) * maxSize, NULL);
+        xmlFree(cache);
+        return(-1);
+    }
+    memset(cache->entries, 0, sizeof(xmlSecKeysMngrUnwrapCacheEntry) * maxSize);
 
-    /* constructors/destructor */
-    xmlSecSimpleKeysStoreInitialize,            /* xmlSecKeyStoreInitializeMethod initialize; */
-    xmlSecSimpleKeysStoreFinalize,              /* xmlSecKeyStoreFinalizeMethod finalize; */
-    xmlSecSimpleKeysStoreFindKey,               /* xmlSecKeyStoreFindKeyMethod findKey; */
-    NULL,                                       /* xmlSecKeyStoreFindKeyFromX509DataMethod findKeyFromX509Data; */
+    cache->mutex = xmlNewMutex();
+    if(cache->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(cache->entries);
+        xmlFree(cache);
+        return(-1);
+    }
+    cache->maxSize = maxSize;
+    cache->ttl = ttl;
 
-    /* reserved for the future */
-    NULL,                                       /* void* reserved0; */
-};
+    mngr->priv->unwrapCache = cache;
+    return(0);
+}
 
 /**
- * xmlSecSimpleKeysStoreGetKlass:
- *
- * The simple list based keys store klass.
+ * xmlSecKeysMngrDisableUnwrapCache:
+ * @mngr:               the pointer to keys manager.
  *
- * Returns: simple list based keys store klass.
+ * Disables the cache for the decrypted &lt;enc:EncryptedKey/&gt; keys
+ * and zeroes all the cached keys.
  */
-xmlSecKeyStoreId
-xmlSecSimpleKeysStoreGetKlass(void) {
-    return(&xmlSecSimpleKeysStoreKlass);
+void
+xmlSecKeysMngrDisableUnwrapCache(xmlSecKeysMngrPtr mngr) {
+    xmlSecKeysMngrUnwrapCachePtr cache;
+    xmlSecSize ii;
+
+    xmlSecAssert(mngr != NULL);
+
+    cache = mngr->priv->unwrapCache;
+    if(cache == NULL) {
+        return;
+    }
+    mngr->priv->unwrapCache = NULL;
+
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        xmlSecKeysMngrUnwrapCacheEntryClear(&(cache->entries[ii]));
+    }
+    xmlFree(cache->entries);
+    xmlFreeMutex(cache->mutex);
+    memset(cache, 0, sizeof(xmlSecKeysMngrUnwrapCache));
+    xmlFree(cache);
 }
 
-/**
- * xmlSecSimpleKeysStoreAdoptKey:
- * @store:              the pointer to simple keys store.
- * @key:                the pointer to key.
- *
- * Adds @key to the @store.
- *
- * Returns: 0 on success or a negative value if an error occurs.
- */
+/* returns 1 if the key was found (and copied to @result), 0 if not or a negative value if an error occurs */
 int
-xmlSecSimpleKeysStoreAdoptKey(xmlSecKeyStorePtr store, xmlSecKeyPtr key) {
-    xmlSecPtrListPtr list;
+xmlSecKeysMngrUnwrapCacheFind(xmlSecKeysMngrPtr mngr, const xmlSecByte* id, xmlSecSize idSize,
+                              xmlSecBufferPtr result) {
+    xmlSecKeysMngrUnwrapCachePtr cache;
+    xmlSecKeysMngrUnwrapCacheEntryPtr entry;
+    unsigned int hash;
+    time_t now;
+    xmlSecSize ii;
+    int res = 0;
     int ret;
 
-    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
-    xmlSecAssert2(key != NULL, -1);
-
-    list = xmlSecSimpleKeysStoreGetCtx(store);
-    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyPtrListId), -1);
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+    xmlSecAssert2(result != NULL, -1);
 
-    ret = xmlSecPtrListAdd(list, key);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecPtrListAdd",
-                            xmlSecKeyStoreGetName(store));
-        return(-1);
+    cache = mngr->priv->unwrapCache;
+    if(cache == NULL) {
+        return(0);
     }
 
-    return(0);
-}
+    hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    now = time(NULL);
+
+    xmlMutexLock(cache->mutex);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        entry = &(cache->entries[ii]);
+        if(entry->data == NULL) {
+            continue;
+        }
+        if((cache->ttl > 0) && (entry->expires <= now)) {
+            xmlSecKeysMngrUnwrapCacheEntryClear(entry);
+            continue;
+        }
+        if((entry->hash != hash) || (entry->idSize != idSize) || (memcmp(entry->id, id, idSize) != 0)) {
+            continue;
+        }
+
+        ret = xmlSecBufferSetData(result, entry->data, entry->dataSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetData", NULL,
+                "size=" XMLSEC_SIZE_FMT, entry->dataSize);
+            res = -1;
+        } else {
+            res = 1;
+        }
+        break;
+    }
+    xmlMutexUnlock(cache->mutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheEncryptedKey, (res > 0) ? 1 : 0);
+
+    return(res);
+}
+
+int
+xmlSecKeysMngrUnwrapCacheAdd(xmlSecKeysMngrPtr mngr, const xmlSecByte* id, xmlSecSize idSize,
+                             const xmlSecByte* data, xmlSecSize dataSize) {
+    xmlSecKeysMngrUnwrapCachePtr cache;
+    xmlSecKeysMngrUnwrapCacheEntry newEntry;
+    xmlSecKeysMngrUnwrapCacheEntryPtr entry;
+    xmlSecSize ii;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+    xmlSecAssert2(idSize > 0, -1);
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(dataSize > 0, -1);
+
+    cache = mngr->priv->unwrapCache;
+    if(cache == NULL) {
+        return(0);
+    }
+
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    newEntry.id = (xmlSecByte*)xmlMalloc(idSize);
+    if(newEntry.id == NULL) {
+        xmlSecMallocError(idSize, NULL);
+        return(-1);
+    }
+    memcpy(newEntry.id, id, idSize);
+    newEntry.idSize = idSize;
+    newEntry.data = (xmlSecByte*)xmlMalloc(dataSize);
+    if(newEntry.data == NULL) {
+        xmlSecMallocError(dataSize, NULL);
+        xmlSecKeysMngrUnwrapCacheEntryClear(&newEntry);
+        return(-1);
+    }
+    memcpy(newEntry.data, data, dataSize);
+    newEntry.dataSize = dataSize;
+    newEntry.expires = time(NULL) + (time_t)cache->ttl;
+
+    xmlMutexLock(cache->mutex);
+
+    /* replace the same entry (e.g. added by another thread) or the oldest one */
+    entry = &(cache->entries[cache->pos]);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        if((cache->entries[ii].data != NULL) && (cache->entries[ii].hash == newEntry.hash) &&
+           (cache->entries[ii].idSize == idSize) && (memcmp(cache->entries[ii].id, id, idSize) == 0)
+        ) {
+            entry = &(cache->entries[ii]);
+            break;
+        }
+    }
+    if(entry == &(cache->entries[cache->pos])) {
+        cache->pos = (cache->pos + 1) % cache->maxSize;
+    }
+    xmlSecKeysMngrUnwrapCacheEntryClear(entry);
+    memcpy(entry, &newEntry, sizeof(newEntry));
+
+    xmlMutexUnlock(cache->mutex);
+    return(0);
+}
+
+/****************************************************************************
+ *
+ * Keys Manager cache for the generated session keys. The entries are
+ * identified by the &lt;dsig:KeyInfo/&gt; template and the encryption method
+ * (the hash is only used to speed up the comparison), store the session key
+ * and the &lt;dsig:KeyInfo/&gt; node with the key already encrypted for the
+ * recipient(s), and are removed after maxUses uses, ttl seconds, or in the
+ * insertion order when the cache is full.
+ *
+ ***************************************************************************/
+typedef struct _xmlSecKeysMngrSessionKeyCacheEntry      xmlSecKeysMngrSessionKeyCacheEntry,
+                                                        *xmlSecKeysMngrSessionKeyCacheEntryPtr;
+struct _xmlSecKeysMngrSessionKeyCacheEntry {
+    unsigned int                        hash;
+    xmlSecByte*                         id;
+    xmlSecSize                          idSize;
+    xmlSecKeyPtr                        key;
+    xmlNodePtr                          keyInfoNode;
+    xmlSecSize                          uses;
+    time_t                              expires;
+};
+
+struct _xmlSecKeysMngrSessionKeyCache {
+    xmlMutexPtr                         mutex;
+    xmlSecKeysMngrSessionKeyCacheEntryPtr entries;
+    xmlSecSize                          maxSize;
+    xmlSecSize                          pos;
+    xmlSecSize                          maxUses;
+    unsigned int                        ttl;
+};
+
+static void
+xmlSecKeysMngrSessionKeyCacheEntryClear(xmlSecKeysMngrSessionKeyCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->key != NULL) {
+        xmlSecKeyDestroy(entry->key);
+    }
+    if(entry->keyInfoNode != NULL) {
+        xmlFreeNode(entry->keyInfoNode);
+    }
+    if(entry->id != NULL) {
+        xmlFree(entry->id);
+    }
+    memset(entry, 0, sizeof(xmlSecKeysMngrSessionKeyCacheEntry));
+}
+
+/**
+ * xmlSecKeysMngrEnableSessionKeyReuse:
+ * @mngr:               the pointer to keys manager.
+ * @maxSize:            the max number of session keys in the cache.
+ * @maxUses:            the max number of messages encrypted with the same
+ *                      session key.
+ * @ttl:                the max time (in seconds) to use the same session key
+ *                      or 0 to only limit the number of uses.
+ *
+ * Enables (or re-creates empty) cache for the session keys generated
+ * by #xmlSecEncCtx when the application doesn't set the encryption key
+ * and the &lt;dsig:KeyInfo/&gt; template transports the key to the
+ * recipient(s) with &lt;enc:EncryptedKey/&gt; or &lt;enc:AgreementMethod/&gt;.
+ * The following encryptions with the same &lt;dsig:KeyInfo/&gt; template
+ * and encryption method reuse the session key and the already encrypted
+ * &lt;dsig:KeyInfo/&gt; node within the given limits (the IVs are still
+ * generated for each message).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeysMngrEnableSessionKeyReuse(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize,
+                                    xmlSecSize maxUses, unsigned int ttl) {
+    xmlSecKeysMngrSessionKeyCachePtr cache;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+    xmlSecAssert2(maxUses > 0, -1);
+
+    xmlSecKeysMngrDisableSessionKeyReuse(mngr);
+
+    cache = (xmlSecKeysMngrSessionKeyCachePtr)xmlMalloc(sizeof(xmlSecKeysMngrSessionKeyCache));
+    if(cache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrSessionKeyCache), NULL);
+        return(-1);
+    }
+    memset(cache, 0, sizeof(xmlSecKeysMngrSessionKeyCache));
+
+    cache->entries = (xmlSecKeysMngrSessionKeyCacheEntryPtr)xmlMalloc(sizeof(xmlSecKeysMngrSessionKeyCacheEntry) * maxSize);
+    if(cache->entries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrSessionKeyCacheEntry) * maxSize, NULL);
+        xmlFree(cache);
+        return(-1);
+    }
+    memset(cache->entries, 0, sizeof(xmlSecKeysMngrSessionKeyCacheEntry) * maxSize);
+
+    cache->mutex = xmlNewMutex();
+    if(cache->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(cache->entries);
+        xmlFree(cache);
+        return(-1);
+    }
+    cache->maxSize = maxSize;
+    cache->maxUses = maxUses;
+    cache->ttl = ttl;
+
+    mngr->priv->sessionKeyCache = cache;
+    return(0);
+}
+
+/**
+ * xmlSecKeysMngrDisableSessionKeyReuse:
+ * @mngr:               the pointer to keys manager.
+ *
+ * Disables the session keys reuse and destroys all the cached keys.
+ */
+void
+xmlSecKeysMngrDisableSessionKeyReuse(xmlSecKeysMngrPtr mngr) {
+    xmlSecKeysMngrSessionKeyCachePtr cache;
+    xmlSecSize ii;
+
+    xmlSecAssert(mngr != NULL);
+
+    cache = mngr->priv->sessionKeyCache;
+    if(cache == NULL) {
+        return;
+    }
+    mngr->priv->sessionKeyCache = NULL;
+
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        xmlSecKeysMngrSessionKeyCacheEntryClear(&(cache->entries[ii]));
+    }
+    xmlFree(cache->entries);
+    xmlFreeMutex(cache->mutex);
+    memset(cache, 0, sizeof(xmlSecKeysMngrSessionKeyCache));
+    xmlFree(cache);
+}
+
+/* returns 1 if the key was found (and copied to @key and @keyInfoNode), 0 if not or a negative value if an error occurs */
+int
+xmlSecKeysMngrSessionKeyCacheFind(xmlSecKeysMngrPtr mngr, const xmlSecByte* id, xmlSecSize idSize,
+                                  xmlDocPtr doc, xmlSecKeyPtr* key, xmlNodePtr* keyInfoNode) {
+    xmlSecKeysMngrSessionKeyCachePtr cache;
+    xmlSecKeysMngrSessionKeyCacheEntryPtr entry;
+    unsigned int hash;
+    time_t now;
+    xmlSecSize ii;
+    int res = 0;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+    xmlSecAssert2(key != NULL, -1);
+    xmlSecAssert2((*key) == NULL, -1);
+    xmlSecAssert2(keyInfoNode != NULL, -1);
+    xmlSecAssert2((*keyInfoNode) == NULL, -1);
+
+    cache = mngr->priv->sessionKeyCache;
+    if(cache == NULL) {
+        return(0);
+    }
+
+    hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    now = time(NULL);
+
+    xmlMutexLock(cache->mutex);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        entry = &(cache->entries[ii]);
+        if(entry->key == NULL) {
+            continue;
+        }
+        if((cache->ttl > 0) && (entry->expires <= now)) {
+            xmlSecKeysMngrSessionKeyCacheEntryClear(entry);
+            continue;
+        }
+        if((entry->hash != hash) || (entry->idSize != idSize) || (memcmp(entry->id, id, idSize) != 0)) {
+            continue;
+        }
+
+        (*key) = xmlSecKeyDuplicate(entry->key);
+        if((*key) == NULL) {
+            xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+            res = -1;
+            break;
+        }
+        (*keyInfoNode) = xmlDocCopyNode(entry->keyInfoNode, doc, 1);
+        if((*keyInfoNode) == NULL) {
+            xmlSecXmlError("xmlDocCopyNode", NULL);
+            xmlSecKeyDestroy(*key);
+            (*key) = NULL;
+            res = -1;
+            break;
+        }
+
+        /* the key is used up */
+        if((++entry->uses) >= cache->maxUses) {
+            xmlSecKeysMngrSessionKeyCacheEntryClear(entry);
+        }
+        res = 1;
+        break;
+    }
+    xmlMutexUnlock(cache->mutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheSessionKey, (res > 0) ? 1 : 0);
+
+    return(res);
+}
+
+int
+xmlSecKeysMngrSessionKeyCacheAdd(xmlSecKeysMngrPtr mngr, const xmlSecByte* id, xmlSecSize idSize,
+                                 xmlSecKeyPtr key, xmlNodePtr keyInfoNode) {
+    xmlSecKeysMngrSessionKeyCachePtr cache;
+    xmlSecKeysMngrSessionKeyCacheEntry newEntry;
+    xmlSecKeysMngrSessionKeyCacheEntryPtr entry;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+    xmlSecAssert2(idSize > 0, -1);
+    xmlSecAssert2(key != NULL, -1);
+    xmlSecAssert2(keyInfoNode != NULL, -1);
+
+    cache = mngr->priv->sessionKeyCache;
+    if(cache == NULL) {
+        return(0);
+    }
+    if(cache->maxUses <= 1) {
+        /* the key is already used */
+        return(0);
+    }
+
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    newEntry.id = (xmlSecByte*)xmlMalloc(idSize);
+    if(newEntry.id == NULL) {
+        xmlSecMallocError(idSize, NULL);
+        return(-1);
+    }
+    memcpy(newEntry.id, id, idSize);
+    newEntry.idSize = idSize;
+    newEntry.key = xmlSecKeyDuplicate(key);
+    if(newEntry.key == NULL) {
+        xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+        xmlSecKeysMngrSessionKeyCacheEntryClear(&newEntry);
+        return(-1);
+    }
+    newEntry.keyInfoNode = xmlCopyNode(keyInfoNode, 1);
+    if(newEntry.keyInfoNode == NULL) {
+        xmlSecXmlError("xmlCopyNode", NULL);
+        xmlSecKeysMngrSessionKeyCacheEntryClear(&newEntry);
+        return(-1);
+    }
+    newEntry.uses = 1;
+    newEntry.expires = time(NULL) + (time_t)cache->ttl;
+
+    /* replace the oldest entry: another thread might have added a key for
+     * the same template but both keys are valid */
+    xmlMutexLock(cache->mutex);
+    entry = &(cache->entries[cache->pos]);
+    cache->pos = (cache->pos + 1) % cache->maxSize;
+    xmlSecKeysMngrSessionKeyCacheEntryClear(entry);
+    memcpy(entry, &newEntry, sizeof(newEntry));
+    xmlMutexUnlock(cache->mutex);
+
+    return(0);
+}
+
+/****************************************************************************
+ *
+ * Keys Manager cache for the keys resolved from &lt;dsig:KeyInfo/&gt; nodes.
+ * The entries are identified by the serialized &lt;dsig:KeyInfo/&gt; node,
+ * the key requirements and the processing flags (the hash is only used
+ * to speed up the comparison), share the key with the callers (see
+ * #xmlSecKeyRef) and are removed after ttl seconds, when the key validity
+ * interval ends, or in the insertion order when the cache is full.
+ *
+ ***************************************************************************/
+typedef struct _xmlSecKeysMngrKeyInfoCacheEntry         xmlSecKeysMngrKeyInfoCacheEntry,
+                                                        *xmlSecKeysMngrKeyInfoCacheEntryPtr;
+struct _xmlSecKeysMngrKeyInfoCacheEntry {
+    unsigned int                        hash;
+    xmlSecByte*                         id;
+    xmlSecSize                          idSize;
+    xmlSecKeyPtr                        key;
+    time_t                              expires;
+};
+
+struct _xmlSecKeysMngrKeyInfoCache {
+    xmlMutexPtr                         mutex;
+    xmlSecKeysMngrKeyInfoCacheEntryPtr  entries;
+    xmlSecSize                          maxSize;
+    xmlSecSize                          pos;
+    unsigned int                        ttl;
+};
+
+static void
+xmlSecKeysMngrKeyInfoCacheEntryClear(xmlSecKeysMngrKeyInfoCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->key != NULL) {
+        xmlSecKeyDestroy(entry->key);
+    }
+    if(entry->id != NULL) {
+        xmlFree(entry->id);
+    }
+    memset(entry, 0, sizeof(xmlSecKeysMngrKeyInfoCacheEntry));
+}
+
+/**
+ * xmlSecKeysMngrEnableKeyInfoCache:
+ * @mngr:               the pointer to keys manager.
+ * @maxSize:            the max number of keys in the cache.
+ * @ttl:                the max time (in seconds) to keep the key in the cache.
+ *
+ * Enables (or re-creates empty) cache for the keys resolved by
+ * #xmlSecKeysMngrGetKey from &lt;dsig:KeyInfo/&gt; nodes. The documents
+ * with the same &lt;dsig:KeyInfo/&gt; node (e.g. the same signer certificate)
+ * processed with the same key requirements and flags reuse the key
+ * without processing the node again (including the certificates
+ * verification) until the @ttl expires or the key validity interval
+ * ends. The &lt;dsig:KeyInfo/&gt; nodes with &lt;dsig:RetrievalMethod/&gt;
+ * or &lt;dsig11:KeyInfoReference/&gt; are never cached.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeysMngrEnableKeyInfoCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize, unsigned int ttl) {
+    xmlSecKeysMngrKeyInfoCachePtr cache;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+    xmlSecAssert2(ttl > 0, -1);
+
+    xmlSecKeysMngrDisableKeyInfoCache(mngr);
+
+    cache = (xmlSecKeysMngrKeyInfoCachePtr)xmlMalloc(sizeof(xmlSecKeysMngrKeyInfoCache));
+    if(cache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrKeyInfoCache), NULL);
+        return(-1);
+    }
+    memset(cache, 0, sizeof(xmlSecKeysMngrKeyInfoCache));
+
+    cache->entries = (xmlSecKeysMngrKeyInfoCacheEntryPtr)xmlMalloc(sizeof(xmlSecKeysMngrKeyInfoCacheEntry) * maxSize);
+    if(cache->entries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrKeyInfoCacheEntry) * maxSize, NULL);
+        xmlFree(cache);
+        return(-1);
+    }
+    memset(cache->entries, 0, sizeof(xmlSecKeysMngrKeyInfoCacheEntry) * maxSize);
+
+    cache->mutex = xmlNewMutex();
+    if(cache->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(cache->entries);
+        xmlFree(cache);
+        return(-1);
+    }
+    cache->maxSize = maxSize;
+    cache->ttl = ttl;
+
+    mngr->priv->keyInfoCache = cache;
+    return(0);
+}
+
+/**
+ * xmlSecKeysMngrDisableKeyInfoCache:
+ * @mngr:               the pointer to keys manager.
+ *
+ * Disables the &lt;dsig:KeyInfo/&gt; keys cache and releases all the cached keys.
+ */
+void
+xmlSecKeysMngrDisableKeyInfoCache(xmlSecKeysMngrPtr mngr) {
+    xmlSecKeysMngrKeyInfoCachePtr cache;
+    xmlSecSize ii;
+
+    xmlSecAssert(mngr != NULL);
+
+    cache = mngr->priv->keyInfoCache;
+    if(cache == NULL) {
+        return;
+    }
+    mngr->priv->keyInfoCache = NULL;
+
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        xmlSecKeysMngrKeyInfoCacheEntryClear(&(cache->entries[ii]));
+    }
+    xmlFree(cache->entries);
+    xmlFreeMutex(cache->mutex);
+    memset(cache, 0, sizeof(xmlSecKeysMngrKeyInfoCache));
+    xmlFree(cache);
+}
+
+/* returns the new reference to the cached key or NULL if the key is not found */
+xmlSecKeyPtr
+xmlSecKeysMngrKeyInfoCacheFind(xmlSecKeysMngrPtr mngr, const xmlSecByte* id, xmlSecSize idSize) {
+    xmlSecKeysMngrKeyInfoCachePtr cache;
+    xmlSecKeysMngrKeyInfoCacheEntryPtr entry;
+    xmlSecKeyPtr res = NULL;
+    unsigned int hash;
+    time_t now;
+    xmlSecSize ii;
+
+    xmlSecAssert2(mngr != NULL, NULL);
+    xmlSecAssert2(id != NULL, NULL);
+
+    cache = mngr->priv->keyInfoCache;
+    if(cache == NULL) {
+        return(NULL);
+    }
+
+    hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    now = time(NULL);
+
+    xmlMutexLock(cache->mutex);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        entry = &(cache->entries[ii]);
+        if(entry->key == NULL) {
+            continue;
+        }
+        if(entry->expires <= now) {
+            xmlSecKeysMngrKeyInfoCacheEntryClear(entry);
+            continue;
+        }
+        if((entry->hash != hash) || (entry->idSize != idSize) || (memcmp(entry->id, id, idSize) != 0)) {
+            continue;
+        }
+        res = xmlSecKeyRef(entry->key);
+        break;
+    }
+    xmlMutexUnlock(cache->mutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheKeyInfo, (res != NULL) ? 1 : 0);
+
+    return(res);
+}
+
+int
+xmlSecKeysMngrKeyInfoCacheAdd(xmlSecKeysMngrPtr mngr, const xmlSecByte* id, xmlSecSize idSize,
+                              xmlSecKeyPtr key) {
+    xmlSecKeysMngrKeyInfoCachePtr cache;
+    xmlSecKeysMngrKeyInfoCacheEntry newEntry;
+    xmlSecKeysMngrKeyInfoCacheEntryPtr entry;
+    xmlSecSize ii;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+    xmlSecAssert2(idSize > 0, -1);
+    xmlSecAssert2(key != NULL, -1);
+
+    cache = mngr->priv->keyInfoCache;
+    if(cache == NULL) {
+        return(0);
+    }
+
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.expires = time(NULL) + (time_t)cache->ttl;
+    if((key->notValidBefore < key->notValidAfter) && (key->notValidAfter < newEntry.expires)) {
+        newEntry.expires = key->notValidAfter;
+    }
+    newEntry.hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    newEntry.id = (xmlSecByte*)xmlMalloc(idSize);
+    if(newEntry.id == NULL) {
+        xmlSecMallocError(idSize, NULL);
+        return(-1);
+    }
+    memcpy(newEntry.id, id, idSize);
+    newEntry.idSize = idSize;
+    newEntry.key = xmlSecKeyRef(key);
+
+    /* replace the entry for the same node (if another thread added it) or the oldest one */
+    xmlMutexLock(cache->mutex);
+    entry = NULL;
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        if((cache->entries[ii].key != NULL) && (cache->entries[ii].hash == newEntry.hash) &&
+           (cache->entries[ii].idSize == idSize) && (memcmp(cache->entries[ii].id, id, idSize) == 0))
+        {
+            entry = &(cache->entries[ii]);
+            break;
+        }
+    }
+    if(entry == NULL) {
+        entry = &(cache->entries[cache->pos]);
+        cache->pos = (cache->pos + 1) % cache->maxSize;
+    }
+    xmlSecKeysMngrKeyInfoCacheEntryClear(entry);
+    memcpy(entry, &newEntry, sizeof(newEntry));
+    xmlMutexUnlock(cache->mutex);
+
+    return(0);
+}
+
+/****************************************************************************
+ *
+ * Keys Manager cache for the results of the external &lt;dsig:RetrievalMethod/&gt;
+ * and &lt;dsig11:KeyInfoReference/&gt; nodes (e.g. the published key or
+ * certificates documents). The entries are identified by the document URL,
+ * the reference URI and Type, and the transforms (the hash is only used to
+ * speed up the comparison), and are removed after ttl seconds or in the
+ * insertion order when the cache is full.
+ *
+ ***************************************************************************/
+typedef struct _xmlSecKeysMngrRetrievalCacheEntry       xmlSecKeysMngrRetrievalCacheEntry,
+                                                        *xmlSecKeysMngrRetrievalCacheEntryPtr;
+struct _xmlSecKeysMngrRetrievalCacheEntry {
+    unsigned int                        hash;
+    xmlSecByte*                         id;
+    xmlSecSize                          idSize;
+    xmlSecByte*                         data;
+    xmlSecSize                          dataSize;
+    time_t                              expires;
+};
+
+struct _xmlSecKeysMngrRetrievalCache {
+    xmlMutexPtr                         mutex;
+    xmlSecKeysMngrRetrievalCacheEntryPtr entries;
+    xmlSecSize                          maxSize;
+    xmlSecSize                          pos;
+    unsigned int                        ttl;
+};
+
+static void
+xmlSecKeysMngrRetrievalCacheEntryClear(xmlSecKeysMngrRetrievalCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->data != NULL) {
+        xmlFree(entry->data);
+    }
+    if(entry->id != NULL) {
+        xmlFree(entry->id);
+    }
+    memset(entry, 0, sizeof(xmlSecKeysMngrRetrievalCacheEntry));
+}
+
+/**
+ * xmlSecKeysMngrEnableRetrievalCache:
+ * @mngr:               the pointer to keys manager.
+ * @maxSize:            the max number of results in the cache.
+ * @ttl:                the max time (in seconds) to keep a result in the cache.
+ *
+ * Enables (or re-creates empty) cache for the results of the
+ * &lt;dsig:RetrievalMethod/&gt; and &lt;dsig11:KeyInfoReference/&gt; nodes
+ * that point outside of the current document: the remote document is
+ * fetched and transformed only once and the following requests with the
+ * same URI, Type and transforms get the result from the cache until
+ * the @ttl expires. The enabled URIs and transforms are still checked
+ * for each request.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeysMngrEnableRetrievalCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize, unsigned int ttl) {
+    xmlSecKeysMngrRetrievalCachePtr cache;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+    xmlSecAssert2(ttl > 0, -1);
+
+    xmlSecKeysMngrDisableRetrievalCache(mngr);
+
+    cache = (xmlSecKeysMngrRetrievalCachePtr)xmlMalloc(sizeof(xmlSecKeysMngrRetrievalCache));
+    if(cache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrRetrievalCache), NULL);
+        return(-1);
+    }
+    memset(cache, 0, sizeof(xmlSecKeysMngrRetrievalCache));
+
+    cache->entries = (xmlSecKeysMngrRetrievalCacheEntryPtr)xmlMalloc(sizeof(xmlSecKeysMngrRetrievalCacheEntry) * maxSize);
+    if(cache->entries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrRetrievalCacheEntry) * maxSize, NULL);
+        xmlFree(cache);
+        return(-1);
+    }
+    memset(cache->entries, 0, sizeof(xmlSecKeysMngrRetrievalCacheEntry) * maxSize);
+
+    cache->mutex = xmlNewMutex();
+    if(cache->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(cache->entries);
+        xmlFree(cache);
+        return(-1);
+    }
+    cache->maxSize = maxSize;
+    cache->ttl = ttl;
+
+    mngr->priv->retrievalCache = cache;
+    return(0);
+}
+
+/**
+ * xmlSecKeysMngrDisableRetrievalCache:
+ * @mngr:               the pointer to keys manager.
+ *
+ * Disables the cache for the &lt;dsig:RetrievalMethod/&gt; and
+ * &lt;dsig11:KeyInfoReference/&gt; results and destroys all the cached results.
+ */
+void
+xmlSecKeysMngrDisableRetrievalCache(xmlSecKeysMngrPtr mngr) {
+    xmlSecKeysMngrRetrievalCachePtr cache;
+    xmlSecSize ii;
+
+    xmlSecAssert(mngr != NULL);
+
+    cache = mngr->priv->retrievalCache;
+    if(cache == NULL) {
+        return;
+    }
+    mngr->priv->retrievalCache = NULL;
+
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        xmlSecKeysMngrRetrievalCacheEntryClear(&(cache->entries[ii]));
+    }
+    xmlFree(cache->entries);
+    xmlFreeMutex(cache->mutex);
+    memset(cache, 0, sizeof(xmlSecKeysMngrRetrievalCache));
+    xmlFree(cache);
+}
+
+/* returns 1 if the result was found (and copied to @result), 0 if not or a negative value if an error occurs */
+int
+xmlSecKeysMngrRetrievalCacheFind(xmlSecKeysMngrPtr mngr, const xmlSecByte* id, xmlSecSize idSize,
+                                 xmlSecBufferPtr result) {
+    xmlSecKeysMngrRetrievalCachePtr cache;
+    xmlSecKeysMngrRetrievalCacheEntryPtr entry;
+    unsigned int hash;
+    time_t now;
+    xmlSecSize ii;
+    int res = 0;
+    int ret;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+    xmlSecAssert2(result != NULL, -1);
+
+    cache = mngr->priv->retrievalCache;
+    if(cache == NULL) {
+        return(0);
+    }
+
+    hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    now = time(NULL);
+
+    xmlMutexLock(cache->mutex);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        entry = &(cache->entries[ii]);
+        if(entry->data == NULL) {
+            continue;
+        }
+        if(entry->expires <= now) {
+            xmlSecKeysMngrRetrievalCacheEntryClear(entry);
+            continue;
+        }
+        if((entry->hash != hash) || (entry->idSize != idSize) || (memcmp(entry->id, id, idSize) != 0)) {
+            continue;
+        }
+
+        ret = xmlSecBufferSetData(result, entry->data, entry->dataSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetData", NULL,
+                "size=" XMLSEC_SIZE_FMT, entry->dataSize);
+            res = -1;
+        } else {
+            res = 1;
+        }
+        break;
+    }
+    xmlMutexUnlock(cache->mutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheRetrievalMethod, (res > 0) ? 1 : 0);
+
+    return(res);
+}
+
+int
+xmlSecKeysMngrRetrievalCacheAdd(xmlSecKeysMngrPtr mngr, const xmlSecByte* id, xmlSecSize idSize,
+                                const xmlSecByte* data, xmlSecSize dataSize) {
+    xmlSecKeysMngrRetrievalCachePtr cache;
+    xmlSecKeysMngrRetrievalCacheEntry newEntry;
+    xmlSecKeysMngrRetrievalCacheEntryPtr entry;
+    xmlSecSize ii;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+    xmlSecAssert2(idSize > 0, -1);
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(dataSize > 0, -1);
+
+    cache = mngr->priv->retrievalCache;
+    if(cache == NULL) {
+        return(0);
+    }
+
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    newEntry.id = (xmlSecByte*)xmlMalloc(idSize);
+    if(newEntry.id == NULL) {
+        xmlSecMallocError(idSize, NULL);
+        return(-1);
+    }
+    memcpy(newEntry.id, id, idSize);
+    newEntry.idSize = idSize;
+    newEntry.data = (xmlSecByte*)xmlMalloc(dataSize);
+    if(newEntry.data == NULL) {
+        xmlSecMallocError(dataSize, NULL);
+        xmlSecKeysMngrRetrievalCacheEntryClear(&newEntry);
+        return(-1);
+    }
+    memcpy(newEntry.data, data, dataSize);
+    newEntry.dataSize = dataSize;
+    newEntry.expires = time(NULL) + (time_t)cache->ttl;
+
+    xmlMutexLock(cache->mutex);
+
+    /* replace the same entry (e.g. added by another thread) or the oldest one */
+    entry = &(cache->entries[cache->pos]);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        if((cache->entries[ii].data != NULL) && (cache->entries[ii].hash == newEntry.hash) &&
+           (cache->entries[ii].idSize == idSize) && (memcmp(cache->entries[ii].id, id, idSize) == 0)
+        ) {
+            entry = &(cache->entries[ii]);
+            break;
+        }
+    }
+    if(entry == &(cache->entries[cache->pos])) {
+        cache->pos = (cache->pos + 1) % cache->maxSize;
+    }
+    xmlSecKeysMngrRetrievalCacheEntryClear(entry);
+    memcpy(entry, &newEntry, sizeof(newEntry));
+
+    xmlMutexUnlock(cache->mutex);
+    return(0);
+}
+
+/****************************************************************************
+ *
+ * Keys Manager cache for the key names and X509 data that were recently
+ * not found in the keys store: a stream of documents with unknown keys
+ * doesn't cause a full keys store search for each document. The entries
+ * are identified by the name or the X509 data and the key requirements
+ * (the hash is only used to speed up the comparison), and are removed
+ * after ttl seconds, in the insertion order when the cache is full, or
+ * all at once when the keys are adopted by the keys manager.
+ *
+ ***************************************************************************/
+typedef struct _xmlSecKeysMngrNotFoundCacheEntry        xmlSecKeysMngrNotFoundCacheEntry,
+                                                        *xmlSecKeysMngrNotFoundCacheEntryPtr;
+struct _xmlSecKeysMngrNotFoundCacheEntry {
+    unsigned int                        hash;
+    xmlSecByte*                         id;
+    xmlSecSize                          idSize;
+    time_t                              expires;
+};
+
+struct _xmlSecKeysMngrNotFoundCache {
+    xmlMutexPtr                         mutex;
+    xmlSecKeysMngrNotFoundCacheEntryPtr entries;
+    xmlSecSize                          maxSize;
+    xmlSecSize                          pos;
+    unsigned int                        ttl;
+};
+
+static void
+xmlSecKeysMngrNotFoundCacheEntryClear(xmlSecKeysMngrNotFoundCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->id != NULL) {
+        xmlFree(entry->id);
+    }
+    memset(entry, 0, sizeof(xmlSecKeysMngrNotFoundCacheEntry));
+}
+
+/**
+ * xmlSecKeysMngrEnableNotFoundCache:
+ * @mngr:               the pointer to keys manager.
+ * @maxSize:            the max number of not found keys in the cache.
+ * @ttl:                the max time (in seconds) to remember a not found key.
+ *
+ * Enables (or re-creates empty) cache for the key names and X509 data
+ * that were not found by #xmlSecKeysMngrFindKey and
+ * #xmlSecKeysMngrFindKeyFromX509Data: the following searches for the same
+ * key with the same key requirements fail immediately until the @ttl
+ * expires. The cache is cleared when a key is adopted by the keys manager
+ * (e.g. with xmlSecCryptoAppDefaultKeysMngrAdoptKey); the application
+ * that adds keys directly to the keys store should clear the cache
+ * by calling #xmlSecKeysMngrEnableNotFoundCache again.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeysMngrEnableNotFoundCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize, unsigned int ttl) {
+    xmlSecKeysMngrNotFoundCachePtr cache;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+    xmlSecAssert2(ttl > 0, -1);
+
+    xmlSecKeysMngrDisableNotFoundCache(mngr);
+
+    cache = (xmlSecKeysMngrNotFoundCachePtr)xmlMalloc(sizeof(xmlSecKeysMngrNotFoundCache));
+    if(cache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrNotFoundCache), NULL);
+        return(-1);
+    }
+    memset(cache, 0, sizeof(xmlSecKeysMngrNotFoundCache));
+
+    cache->entries = (xmlSecKeysMngrNotFoundCacheEntryPtr)xmlMalloc(sizeof(xmlSecKeysMngrNotFoundCacheEntry) * maxSize);
+    if(cache->entries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrNotFoundCacheEntry) * maxSize, NULL);
+        xmlFree(cache);
+        return(-1);
+    }
+    memset(cache->entries, 0, sizeof(xmlSecKeysMngrNotFoundCacheEntry) * maxSize);
+
+    cache->mutex = xmlNewMutex();
+    if(cache->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(cache->entries);
+        xmlFree(cache);
+        return(-1);
+    }
+    cache->maxSize = maxSize;
+    cache->ttl = ttl;
+
+    mngr->priv->notFoundCache = cache;
+    return(0);
+}
+
+/**
+ * xmlSecKeysMngrDisableNotFoundCache:
+ * @mngr:               the pointer to keys manager.
+ *
+ * Disables the cache for the not found keys.
+ */
+void
+xmlSecKeysMngrDisableNotFoundCache(xmlSecKeysMngrPtr mngr) {
+    xmlSecKeysMngrNotFoundCachePtr cache;
+    xmlSecSize ii;
+
+    xmlSecAssert(mngr != NULL);
+
+    cache = mngr->priv->notFoundCache;
+    if(cache == NULL) {
+        return;
+    }
+    mngr->priv->notFoundCache = NULL;
+
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        xmlSecKeysMngrNotFoundCacheEntryClear(&(cache->entries[ii]));
+    }
+    xmlFree(cache->entries);
+    xmlFreeMutex(cache->mutex);
+    memset(cache, 0, sizeof(xmlSecKeysMngrNotFoundCache));
+    xmlFree(cache);
+}
+
+/* removes all the entries, called when the keys are adopted */
+void
+xmlSecKeysMngrNotFoundCacheReset(xmlSecKeysMngrPtr mngr) {
+    xmlSecKeysMngrNotFoundCachePtr cache;
+    xmlSecSize ii;
+
+    xmlSecAssert(mngr != NULL);
+
+    cache = mngr->priv->notFoundCache;
+    if(cache == NULL) {
+        return;
+    }
+
+    xmlMutexLock(cache->mutex);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        xmlSecKeysMngrNotFoundCacheEntryClear(&(cache->entries[ii]));
+    }
+    cache->pos = 0;
+    xmlMutexUnlock(cache->mutex);
+}
+
+static int
+xmlSecKeysMngrNotFoundCacheAppend(xmlSecBufferPtr cacheId, const xmlSecByte* data, xmlSecSize dataSize) {
+    int ret;
+
+    xmlSecAssert2(cacheId != NULL, -1);
+
+    /* the size prefix separates the fields */
+    ret = xmlSecBufferAppend(cacheId, (const xmlSecByte*)&dataSize, sizeof(dataSize));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        return(-1);
+    }
+    if(dataSize > 0) {
+        ret = xmlSecBufferAppend(cacheId, data, dataSize);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", NULL);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static int
+xmlSecKeysMngrNotFoundCacheAppendStr(xmlSecBufferPtr cacheId, const xmlChar* str) {
+    return(xmlSecKeysMngrNotFoundCacheAppend(cacheId, str, xmlSecStrlen(str)));
+}
+
+static int
+xmlSecKeysMngrNotFoundCacheAppendBuffer(xmlSecBufferPtr cacheId, xmlSecBufferPtr buf) {
+    return(xmlSecKeysMngrNotFoundCacheAppend(cacheId, xmlSecBufferGetData(buf), xmlSecBufferGetSize(buf)));
+}
+
+/* returns 1 if the cache id is created or a negative value if an error occurs */
+static int
+xmlSecKeysMngrNotFoundCacheId(xmlSecBufferPtr cacheId, const xmlChar* name,
+                              xmlSecKeyX509DataValuePtr x509Data, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    struct {
+        xmlSecKeyDataId         keyId;
+        xmlSecKeyDataType       keyType;
+        xmlSecKeyUsage          keyUsage;
+        xmlSecSize              keyBitsSize;
+        unsigned int            flags;
+        unsigned int            flags2;
+        int                     isX509Data;
+    } params;
+    int ret;
+
+    xmlSecAssert2(cacheId != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+
+    ret = xmlSecBufferInitialize(cacheId, 128);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        return(-1);
+    }
+
+    /* the key requirements and the processing flags */
+    memset(&params, 0, sizeof(params));
+    params.keyId            = keyInfoCtx->keyReq.keyId;
+    params.keyType          = keyInfoCtx->keyReq.keyType;
+    params.keyUsage         = keyInfoCtx->keyReq.keyUsage;
+    params.keyBitsSize      = keyInfoCtx->keyReq.keyBitsSize;
+    params.flags            = keyInfoCtx->flags;
+    params.flags2           = keyInfoCtx->flags2;
+    params.isX509Data       = (x509Data != NULL) ? 1 : 0;
+    ret = xmlSecBufferAppend(cacheId, (const xmlSecByte*)&params, sizeof(params));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        xmlSecBufferFinalize(cacheId);
+        return(-1);
+    }
+
+    if(x509Data != NULL) {
+        if((xmlSecKeysMngrNotFoundCacheAppendBuffer(cacheId, &(x509Data->cert)) < 0) ||
+           (xmlSecKeysMngrNotFoundCacheAppendBuffer(cacheId, &(x509Data->ski)) < 0) ||
+           (xmlSecKeysMngrNotFoundCacheAppendStr(cacheId, x509Data->subject) < 0) ||
+           (xmlSecKeysMngrNotFoundCacheAppendStr(cacheId, x509Data->issuerName) < 0) ||
+           (xmlSecKeysMngrNotFoundCacheAppendStr(cacheId, x509Data->issuerSerial) < 0) ||
+           (xmlSecKeysMngrNotFoundCacheAppendStr(cacheId, x509Data->digestAlgorithm) < 0) ||
+           (xmlSecKeysMngrNotFoundCacheAppendBuffer(cacheId, &(x509Data->digest)) < 0))
+        {
+            xmlSecInternalError("xmlSecKeysMngrNotFoundCacheAppend", NULL);
+            xmlSecBufferFinalize(cacheId);
+            return(-1);
+        }
+    } else {
+        ret = xmlSecKeysMngrNotFoundCacheAppendStr(cacheId, name);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeysMngrNotFoundCacheAppendStr", NULL);
+            xmlSecBufferFinalize(cacheId);
+            return(-1);
+        }
+    }
+
+    return(1);
+}
+
+/* returns 1 if the key was recently not found or 0 otherwise */
+static int
+xmlSecKeysMngrNotFoundCacheFind(xmlSecKeysMngrPtr mngr, xmlSecBufferPtr cacheId) {
+    xmlSecKeysMngrNotFoundCachePtr cache;
+    xmlSecKeysMngrNotFoundCacheEntryPtr entry;
+    const xmlSecByte* id;
+    xmlSecSize idSize;
+    unsigned int hash;
+    time_t now;
+    xmlSecSize ii;
+    int res = 0;
+
+    xmlSecAssert2(mngr != NULL, 0);
+    xmlSecAssert2(cacheId != NULL, 0);
+
+    cache = mngr->priv->notFoundCache;
+    if(cache == NULL) {
+        return(0);
+    }
+
+    id = xmlSecBufferGetData(cacheId);
+    idSize = xmlSecBufferGetSize(cacheId);
+    hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    now = time(NULL);
+
+    xmlMutexLock(cache->mutex);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        entry = &(cache->entries[ii]);
+        if(entry->id == NULL) {
+            continue;
+        }
+        if(entry->expires <= now) {
+            xmlSecKeysMngrNotFoundCacheEntryClear(entry);
+            continue;
+        }
+        if((entry->hash != hash) || (entry->idSize != idSize) || (memcmp(entry->id, id, idSize) != 0)) {
+            continue;
+        }
+        res = 1;
+        break;
+    }
+    xmlMutexUnlock(cache->mutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheKeyNotFound, (res > 0) ? 1 : 0);
+
+    return(res);
+}
+
+/* the cache is an optimization, the errors are ignored */
+static void
+xmlSecKeysMngrNotFoundCacheAdd(xmlSecKeysMngrPtr mngr, xmlSecBufferPtr cacheId) {
+    xmlSecKeysMngrNotFoundCachePtr cache;
+    xmlSecKeysMngrNotFoundCacheEntry newEntry;
+    xmlSecKeysMngrNotFoundCacheEntryPtr entry;
+    const xmlSecByte* id;
+    xmlSecSize idSize;
+
+    xmlSecAssert(mngr != NULL);
+    xmlSecAssert(cacheId != NULL);
+
+    cache = mngr->priv->notFoundCache;
+    if(cache == NULL) {
+        return;
+    }
+
+    id = xmlSecBufferGetData(cacheId);
+    idSize = xmlSecBufferGetSize(cacheId);
+    xmlSecAssert(id != NULL);
+    xmlSecAssert(idSize > 0);
+
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.hash = xmlSecKeysMngrUnwrapCacheHash(id, idSize);
+    newEntry.id = (xmlSecByte*)xmlMalloc(idSize);
+    if(newEntry.id == NULL) {
+        xmlSecMallocError(idSize, NULL);
+        return;
+    }
+    memcpy(newEntry.id, id, idSize);
+    newEntry.idSize = idSize;
+    newEntry.expires = time(NULL) + (time_t)cache->ttl;
+
+    /* another thread might have added the same entry, the duplicate just expires */
+    xmlMutexLock(cache->mutex);
+    entry = &(cache->entries[cache->pos]);
+    cache->pos = (cache->pos + 1) % cache->maxSize;
+    xmlSecKeysMngrNotFoundCacheEntryClear(entry);
+    memcpy(entry, &newEntry, sizeof(newEntry));
+    xmlMutexUnlock(cache->mutex);
+}
+
+/****************************************************************************
+ *
+ * Keys Manager pool of one-time originator keys for the key agreement
+ * (ECDH-ES, DH-ES). The keys are generated in advance by the application
+ * (e.g. from a background thread), each key is removed from the pool when
+ * it is used and destroyed after the encryption. Since &lt;enc:AgreementMethod/&gt;
+ * node is read again when it is written, the used key is kept for the
+ * &lt;enc:OriginatorKeyInfo/&gt; node until then.
+ *
+ ***************************************************************************/
+typedef struct _xmlSecKeysMngrEphemeralKeyUse   xmlSecKeysMngrEphemeralKeyUse,
+                                                *xmlSecKeysMngrEphemeralKeyUsePtr;
+struct _xmlSecKeysMngrEphemeralKeyUse {
+    xmlNodePtr                          node;
+    xmlSecKeyPtr                        key;
+    xmlSecKeysMngrEphemeralKeyUsePtr    next;
+};
+
+struct _xmlSecKeysMngrEphemeralKeys {
+    xmlMutexPtr                         mutex;
+    xmlSecPtrList                       keys;
+    xmlSecKeysMngrEphemeralKeyUsePtr    used;
+};
+
+static void
+xmlSecKeysMngrEphemeralKeyUseDestroy(xmlSecKeysMngrEphemeralKeyUsePtr use) {
+    xmlSecAssert(use != NULL);
+
+    if(use->key != NULL) {
+        xmlSecKeyDestroy(use->key);
+    }
+    memset(use, 0, sizeof(xmlSecKeysMngrEphemeralKeyUse));
+    xmlFree(use);
+}
+
+/* removes the used key for @node from the list (the caller must hold the lock) */
+static xmlSecKeysMngrEphemeralKeyUsePtr
+xmlSecKeysMngrEphemeralKeyUseRemove(xmlSecKeysMngrEphemeralKeysPtr pool, xmlNodePtr node) {
+    xmlSecKeysMngrEphemeralKeyUsePtr* cur;
+    xmlSecKeysMngrEphemeralKeyUsePtr res;
+
+    xmlSecAssert2(pool != NULL, NULL);
+    xmlSecAssert2(node != NULL, NULL);
+
+    for(cur = &(pool->used); (*cur) != NULL; cur = &((*cur)->next)) {
+        if((*cur)->node == node) {
+            res = (*cur);
+            (*cur) = res->next;
+            res->next = NULL;
+            return(res);
+        }
+    }
+    return(NULL);
+}
+
+/**
+ * xmlSecKeysMngrEnableEphemeralKeys:
+ * @mngr:               the pointer to keys manager.
+ *
+ * Enables (or re-creates empty) pool of one-time originator keys for
+ * the key agreement (see #xmlSecKeysMngrAdoptEphemeralKey). When encrypting,
+ * the originator private key for &lt;enc:AgreementMethod/&gt; is taken
+ * from the pool (matching the &lt;dsig:KeyName/&gt; from the
+ * &lt;enc:OriginatorKeyInfo/&gt; node) if available, and from the keys
+ * manager otherwise.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeysMngrEnableEphemeralKeys(xmlSecKeysMngrPtr mngr) {
+    xmlSecKeysMngrEphemeralKeysPtr pool;
+    int ret;
+
+    xmlSecAssert2(mngr != NULL, -1);
+
+    xmlSecKeysMngrDisableEphemeralKeys(mngr);
+
+    pool = (xmlSecKeysMngrEphemeralKeysPtr)xmlMalloc(sizeof(xmlSecKeysMngrEphemeralKeys));
+    if(pool == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrEphemeralKeys), NULL);
+        return(-1);
+    }
+    memset(pool, 0, sizeof(xmlSecKeysMngrEphemeralKeys));
+
+    ret = xmlSecPtrListInitialize(&(pool->keys), xmlSecKeyPtrListId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListInitialize(xmlSecKeyPtrListId)", NULL);
+        xmlFree(pool);
+        return(-1);
+    }
+
+    pool->mutex = xmlNewMutex();
+    if(pool->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlSecPtrListFinalize(&(pool->keys));
+        xmlFree(pool);
+        return(-1);
+    }
+
+    mngr->priv->ephemeralKeys = pool;
+    return(0);
+}
+
+/**
+ * xmlSecKeysMngrDisableEphemeralKeys:
+ * @mngr:               the pointer to keys manager.
+ *
+ * Disables the pool of one-time originator keys and destroys all
+ * the unused keys.
+ */
+void
+xmlSecKeysMngrDisableEphemeralKeys(xmlSecKeysMngrPtr mngr) {
+    xmlSecKeysMngrEphemeralKeysPtr pool;
+    xmlSecKeysMngrEphemeralKeyUsePtr use;
+
+    xmlSecAssert(mngr != NULL);
+
+    pool = mngr->priv->ephemeralKeys;
+    if(pool == NULL) {
+        return;
+    }
+    mngr->priv->ephemeralKeys = NULL;
+
+    while(pool->used != NULL) {
+        use = pool->used;
+        pool->used = use->next;
+        xmlSecKeysMngrEphemeralKeyUseDestroy(use);
+    }
+    xmlSecPtrListFinalize(&(pool->keys));
+    xmlFreeMutex(pool->mutex);
+    memset(pool, 0, sizeof(xmlSecKeysMngrEphemeralKeys));
+    xmlFree(pool);
+}
+
+/**
+ * xmlSecKeysMngrAdoptEphemeralKey:
+ * @mngr:               the pointer to keys manager.
+ * @key:                the pointer to one-time originator key (with a name
+ *                      and a private key).
+ *
+ * Adds @key to the pool of one-time originator keys. The @key is owned
+ * by the @mngr and is destroyed after the first use. This function can be
+ * called concurrently with encryptions that use @mngr.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecKeysMngrAdoptEphemeralKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key) {
+    xmlSecKeysMngrEphemeralKeysPtr pool;
+    xmlSecSize ii, size;
+    int ret;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(key != NULL, -1);
+
+    pool = mngr->priv->ephemeralKeys;
+    if(pool == NULL) {
+        xmlSecInvalidDataError("ephemeral keys pool is not enabled", NULL);
+        return(-1);
+    }
+
+    /* reuse the slots of the used keys first */
+    xmlMutexLock(pool->mutex);
+    size = xmlSecPtrListGetSize(&(pool->keys));
+    for(ii = 0; ii < size; ++ii) {
+        if(xmlSecPtrListGetItem(&(pool->keys), ii) == NULL) {
+            break;
+        }
+    }
+    if(ii < size) {
+        ret = xmlSecPtrListSet(&(pool->keys), key, ii);
+    } else {
+        ret = xmlSecPtrListAdd(&(pool->keys), key);
+    }
+    xmlMutexUnlock(pool->mutex);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListAdd", NULL);
+        return(-1);
+    }
+
+    return(0);
+}
+
+/**
+ * xmlSecKeysMngrGetEphemeralKeysSize:
+ * @mngr:               the pointer to keys manager.
+ * @name:               the keys name or NULL for all keys.
+ *
+ * Gets the number of unused one-time originator keys with the name @name
+ * (for example, to decide when the pool needs to be refilled).
+ *
+ * Returns: the number of unused keys in the pool.
+ */
+xmlSecSize
+xmlSecKeysMngrGetEphemeralKeysSize(xmlSecKeysMngrPtr mngr, const xmlChar* name) {
+    xmlSecKeysMngrEphemeralKeysPtr pool;
+    xmlSecKeyPtr key;
+    xmlSecSize ii, size;
+    xmlSecSize res = 0;
+
+    xmlSecAssert2(mngr != NULL, 0);
+
+    pool = mngr->priv->ephemeralKeys;
+    if(pool == NULL) {
+        return(0);
+    }
+
+    xmlMutexLock(pool->mutex);
+    size = xmlSecPtrListGetSize(&(pool->keys));
+    for(ii = 0; ii < size; ++ii) {
+        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(&(pool->keys), ii);
+        if((key != NULL) && ((name == NULL) || xmlStrEqual(xmlSecKeyGetName(key), name))) {
+            ++res;
+        }
+    }
+    xmlMutexUnlock(pool->mutex);
+
+    return(res);
+}
+
+/*
+ * Reading (@claim == 0): removes the first matching key from the pool and
+ * keeps a copy for @node. Writing (@claim != 0): returns the key kept for
+ * @node. The caller owns the returned key.
+ */
+xmlSecKeyPtr
+xmlSecKeysMngrPopEphemeralKey(xmlSecKeysMngrPtr mngr, xmlNodePtr node, const xmlChar* name,
+                              xmlSecKeyReqPtr keyReq, int claim) {
+    xmlSecKeysMngrEphemeralKeysPtr pool;
+    xmlSecKeysMngrEphemeralKeyUsePtr use, old;
+    xmlSecKeyPtr key;
+    xmlSecSize ii, size;
+    xmlSecKeyPtr res = NULL;
+
+    xmlSecAssert2(mngr != NULL, NULL);
+    xmlSecAssert2(node != NULL, NULL);
+    xmlSecAssert2(keyReq != NULL, NULL);
+
+    pool = mngr->priv->ephemeralKeys;
+    if(pool == NULL) {
+        return(NULL);
+    }
+
+    if(claim != 0) {
+        xmlMutexLock(pool->mutex);
+        use = xmlSecKeysMngrEphemeralKeyUseRemove(pool, node);
+        xmlMutexUnlock(pool->mutex);
+        if(use == NULL) {
+            return(NULL);
+        }
+        res = use->key;
+        use->key = NULL;
+        xmlSecKeysMngrEphemeralKeyUseDestroy(use);
+        return(res);
+    }
+
+    use = (xmlSecKeysMngrEphemeralKeyUsePtr)xmlMalloc(sizeof(xmlSecKeysMngrEphemeralKeyUse));
+    if(use == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeysMngrEphemeralKeyUse), NULL);
+        return(NULL);
+    }
+    memset(use, 0, sizeof(xmlSecKeysMngrEphemeralKeyUse));
+    use->node = node;
+
+    xmlMutexLock(pool->mutex);
+    size = xmlSecPtrListGetSize(&(pool->keys));
+    for(ii = 0; ii < size; ++ii) {
+        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(&(pool->keys), ii);
+        if((key != NULL) && (xmlSecKeyMatch(key, name, keyReq) == 1)) {
+            use->key = (xmlSecKeyPtr)xmlSecPtrListRemoveAndReturn(&(pool->keys), ii);
+            break;
+        }
+    }
+    xmlMutexUnlock(pool->mutex);
+    if(use->key == NULL) {
+        xmlSecKeysMngrEphemeralKeyUseDestroy(use);
+        return(NULL);
+    }
+
+    res = xmlSecKeyDuplicate(use->key);
+    if(res == NULL) {
+        xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+        xmlSecKeysMngrEphemeralKeyUseDestroy(use);
+        return(NULL);
+    }
+
+    /* replace the key that was never written (e.g. the encryption failed) */
+    xmlMutexLock(pool->mutex);
+    old = xmlSecKeysMngrEphemeralKeyUseRemove(pool, node);
+    use->next = pool->used;
+    pool->used = use;
+    xmlMutexUnlock(pool->mutex);
+    if(old != NULL) {
+        xmlSecKeysMngrEphemeralKeyUseDestroy(old);
+    }
+
+    return(res);
+}
+
+/**************************************************************************
+ *
+ * xmlSecKeyStore functions
+ *
+ *************************************************************************/
+/**
+ * xmlSecKeyStoreCreate:
+ * @id:                 the key store klass.
+ *
+ * Creates new store of the specified klass @klass. Caller is responsible
+ * for freeing the returned store by calling #xmlSecKeyStoreDestroy function.
+ *
+ * Returns: the pointer to newly allocated keys store or NULL if an error occurs.
+ */
+xmlSecKeyStorePtr
+xmlSecKeyStoreCreate(xmlSecKeyStoreId id)  {
+    xmlSecKeyStorePtr store;
+    int ret;
+
+    xmlSecAssert2(id != NULL, NULL);
+    xmlSecAssert2(id->objSize > 0, NULL);
+
+    /* Allocate a new xmlSecKeyStore and fill the fields. */
+    store = (xmlSecKeyStorePtr)xmlMalloc(id->objSize);
+    if(store == NULL) {
+        xmlSecMallocError(id->objSize,
+                          xmlSecKeyStoreKlassGetName(id));
+        return(NULL);
+    }
+    memset(store, 0, id->objSize);
+    store->id = id;
+
+    if(id->initialize != NULL) {
+        ret = (id->initialize)(store);
+        if(ret < 0) {
+            xmlSecInternalError("id->initialize",
+                                xmlSecKeyStoreKlassGetName(id));
+            xmlSecKeyStoreDestroy(store);
+            return(NULL);
+        }
+    }
+
+    return(store);
+}
+
+/**
+ * xmlSecKeyStoreDestroy:
+ * @store:              the pointer to keys store.
+ *
+ * Destroys the store created with #xmlSecKeyStoreCreate function.
+ */
+void
+xmlSecKeyStoreDestroy(xmlSecKeyStorePtr store) {
+    xmlSecAssert(xmlSecKeyStoreIsValid(store));
+    xmlSecAssert(store->id->objSize > 0);
+
+    if(store->id->finalize != NULL) {
+        (store->id->finalize)(store);
+    }
+    memset(store, 0, store->id->objSize);
+    xmlFree(store);
+}
+
+/**
+ * xmlSecKeyStoreFindKey:
+ * @store:              the pointer to keys store.
+ * @name:               the desired key name.
+ * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; node processing context.
+ *
+ * Lookups key in the store. The caller is responsible for destroying
+ * the returned key using #xmlSecKeyDestroy method.
+ *
+ * Returns: the pointer to a key or NULL if key is not found or an error occurs.
+ */
+xmlSecKeyPtr
+xmlSecKeyStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecAssert2(xmlSecKeyStoreIsValid(store), NULL);
+    xmlSecAssert2(keyInfoCtx != NULL, NULL);
+
+    if(store->id->findKey == NULL) {
+        return(NULL);
+    }
+    return(store->id->findKey(store, name, keyInfoCtx));
+}
+
+/**
+ * xmlSecKeyStoreFindKeyFromX509Data:
+ * @store:              the pointer to keys store.
+ * @x509Data:           the X509 data to use for search.
+ * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; node processing context.
+ *
+ * Lookups key in the store. The caller is responsible for destroying
+ * the returned key using #xmlSecKeyDestroy method.
+ *
+ * Returns: the pointer to a key or NULL if key is not found or an error occurs.
+ */
+xmlSecKeyPtr
+xmlSecKeyStoreFindKeyFromX509Data(xmlSecKeyStorePtr store, xmlSecKeyX509DataValuePtr x509Data, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecAssert2(xmlSecKeyStoreIsValid(store), NULL);
+    xmlSecAssert2(x509Data != NULL, NULL);
+    xmlSecAssert2(keyInfoCtx != NULL, NULL);
+
+    if(store->id->findKeyFromX509Data == NULL) {
+        return(NULL);
+    }
+    return(store->id->findKeyFromX509Data(store, x509Data, keyInfoCtx));
+}
+
+/****************************************************************************
+ *
+ * Simple Keys Store
+ *
+ * xmlSecKeyStore + xmlSecSimpleKeysStoreCtx (keys list + keys names index)
+ *
+ ***************************************************************************/
+#define XMLSEC_SIMPLE_KEYS_STORE_INDEX_MIN_SIZE         64
+
+/*
+ * The keys names index: hash table of chains of positions in the keys list,
+ * each chain is sorted by the position so the first matching key is the
+ * same as in the list. The positions are stored +1 and 0 means "none".
+ * The index is rebuilt if the keys list was changed directly (e.g. using
+ * the list returned by xmlSecSimpleKeysStoreGetKeys()).
+ */
+typedef struct _xmlSecSimpleKeysStoreCtx {
+    xmlSecPtrList       keys;
+
+    xmlSecSize*         heads;          /* tableSize entries */
+    xmlSecSize*         tails;          /* tableSize entries */
+    xmlSecSize          tableSize;      /* power of 2 */
+    xmlSecSize*         next;           /* nextSize entries, one per key */
+    xmlSecSize          nextSize;
+    xmlSecSize          indexedSize;    /* number of the indexed keys */
+} xmlSecSimpleKeysStoreCtx, *xmlSecSimpleKeysStoreCtxPtr;
+
+XMLSEC_KEY_STORE_DECLARE(SimpleKeysStore, xmlSecSimpleKeysStoreCtx)
+#define xmlSecSimpleKeysStoreSize XMLSEC_KEY_STORE_SIZE(SimpleKeysStore)
+
+static int                      xmlSecSimpleKeysStoreInitialize (xmlSecKeyStorePtr store);
+static void                     xmlSecSimpleKeysStoreFinalize   (xmlSecKeyStorePtr store);
+static xmlSecKeyPtr             xmlSecSimpleKeysStoreFindKey    (xmlSecKeyStorePtr store,
+                                                                 const xmlChar* name,
+                                                                 xmlSecKeyInfoCtxPtr keyInfoCtx);
+
+static void                     xmlSecSimpleKeysStoreIndexReset (xmlSecSimpleKeysStoreCtxPtr ctx);
+static int                      xmlSecSimpleKeysStoreIndexAdd   (xmlSecSimpleKeysStoreCtxPtr ctx,
+                                                                 xmlSecSize pos);
+static int                      xmlSecSimpleKeysStoreIndexUpdate(xmlSecSimpleKeysStoreCtxPtr ctx);
+
+static xmlSecKeyStoreKlass xmlSecSimpleKeysStoreKlass = {
+    sizeof(xmlSecKeyStoreKlass),
+    xmlSecSimpleKeysStoreSize,
+
+    /* data */
+    BAD_CAST "simple-keys-store",               /* const xmlChar* name; */
+
+    /* constructors/destructor */
+    xmlSecSimpleKeysStoreInitialize,            /* xmlSecKeyStoreInitializeMethod initialize; */
+    xmlSecSimpleKeysStoreFinalize,              /* xmlSecKeyStoreFinalizeMethod finalize; */
+    xmlSecSimpleKeysStoreFindKey,               /* xmlSecKeyStoreFindKeyMethod findKey; */
+    NULL,                                       /* xmlSecKeyStoreFindKeyFromX509DataMethod findKeyFromX509Data; */
+
+    /* reserved for the future */
+    NULL,                                       /* void* reserved0; */
+};
+
+/**
+ * xmlSecSimpleKeysStoreGetKlass:
+ *
+ * The simple list based keys store klass.
+ *
+ * Returns: simple list based keys store klass.
+ */
+xmlSecKeyStoreId
+xmlSecSimpleKeysStoreGetKlass(void) {
+    return(&xmlSecSimpleKeysStoreKlass);
+}
+
+/**
+ * xmlSecSimpleKeysStoreAdoptKey:
+ * @store:              the pointer to simple keys store.
+ * @key:                the pointer to key.
+ *
+ * Adds @key to the @store.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSimpleKeysStoreAdoptKey(xmlSecKeyStorePtr store, xmlSecKeyPtr key) {
+    xmlSecSimpleKeysStoreCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
+    xmlSecAssert2(key != NULL, -1);
+
+    ctx = xmlSecSimpleKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(xmlSecPtrListCheckId(&(ctx->keys), xmlSecKeyPtrListId), -1);
+
+    ret = xmlSecPtrListAdd(&(ctx->keys), key);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListAdd",
+                            xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    /* keep the index up to date if we can, otherwise it will be rebuilt on the next lookup */
+    if((ctx->heads != NULL) && ((ctx->indexedSize + 1) == xmlSecPtrListGetSize(&(ctx->keys)))) {
+        ret = xmlSecSimpleKeysStoreIndexAdd(ctx, ctx->indexedSize);
+        if(ret < 0) {
+            xmlSecSimpleKeysStoreIndexReset(ctx);
+        }
+    }
+    return(0);
+}
+
+/* reads the key from the &lt;dsig:KeyInfo/&gt; node @node, the returned key might be invalid */
+static xmlSecKeyPtr
+xmlSecSimpleKeysStoreReadKey(xmlSecKeyStorePtr store, xmlNodePtr node) {
+    xmlSecKeyInfoCtx keyInfoCtx;
+    xmlSecKeyPtr key;
+    int ret;
+
+    xmlSecAssert2(store != NULL, NULL);
+    xmlSecAssert2(node != NULL, NULL);
+
+    key = xmlSecKeyCreate();
+    if(key == NULL) {
+        xmlSecInternalError("xmlSecKeyCreate",
+            xmlSecKeyStoreGetName(store));
+        return(NULL);
+    }
+
+    ret = xmlSecKeyInfoCtxInitialize(&keyInfoCtx, NULL);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoCtxInitialize",
+            xmlSecKeyStoreGetName(store));
+        xmlSecKeyDestroy(key);
+        return(NULL);
+    }
+
+    keyInfoCtx.mode           = xmlSecKeyInfoModeRead;
+    keyInfoCtx.keysMngr       = NULL;
+    keyInfoCtx.flags          = XMLSEC_KEYINFO_FLAGS_DONT_STOP_ON_KEY_FOUND |
+                                XMLSEC_KEYINFO_FLAGS_X509DATA_DONT_VERIFY_CERTS;
+    keyInfoCtx.keyReq.keyId   = xmlSecKeyDataIdUnknown;
+    keyInfoCtx.keyReq.keyType = xmlSecKeyDataTypeAny;
+    keyInfoCtx.keyReq.keyUsage= xmlSecKeyDataUsageAny;
+
+    ret = xmlSecKeyInfoNodeRead(node, key, &keyInfoCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoNodeRead",
+            xmlSecKeyStoreGetName(store));
+        xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+        xmlSecKeyDestroy(key);
+        return(NULL);
+    }
+    xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+
+    return(key);
+}
+
+/**
+ * xmlSecSimpleKeysStoreLoad:
+ * @store:              the pointer to simple keys store.
+ * @uri:                the filename.
+ * @keysMngr:           the pointer to associated keys manager.
+ *
+ * Reads keys from an XML file.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSimpleKeysStoreLoad(xmlSecKeyStorePtr store, const char *uri,
+                            xmlSecKeysMngrPtr keysMngr) {
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
+
+    return(xmlSecSimpleKeysStoreLoad_ex(store, uri, keysMngr,
+        xmlSecSimpleKeysStoreAdoptKey));
+}
+
+/**
+ * xmlSecSimpleKeysStoreLoad_ex:
+ * @store:              the pointer to simple keys store.
+ * @uri:                the filename.
+ * @keysMngr:           the pointer to associated keys manager.
+ * @adoptKeyFunc:       the callback to add the key to keys manager.
+ *
+ * Reads keys from an XML file.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSimpleKeysStoreLoad_ex(xmlSecKeyStorePtr store, const char *uri,
+                            xmlSecKeysMngrPtr keysMngr ATTRIBUTE_UNUSED,
+                            xmlSecSimpleKeysStoreAdoptKeyFunc adoptKeyFunc) {
+    xmlDocPtr doc;
+    xmlNodePtr root;
+    xmlNodePtr cur;
+    xmlSecKeyPtr key;
+    int ret;
+
+    /* don't check store ID here because it might not be simple store ID;
+     * we will check for the correct store ID in the adoptKeyFunc instead */
+    xmlSecAssert2(store != NULL, -1);
+    xmlSecAssert2(uri != NULL, -1);
+    xmlSecAssert2(adoptKeyFunc != NULL, -1);
+    UNREFERENCED_PARAMETER(keysMngr);
+
+    doc = xmlParseFile(uri);
+    if(doc == NULL) {
+        xmlSecXmlError2("xmlParseFile", xmlSecKeyStoreGetName(store),
+                        "uri=%s", xmlSecErrorsSafeString(uri));
+        return(-1);
+    }
+
+    root = xmlDocGetRootElement(doc);
+    if((root == NULL) || (!xmlSecCheckNodeName(root, BAD_CAST "Keys", xmlSecNs))) {
+        xmlSecInvalidNodeError(root, BAD_CAST "Keys",
+            xmlSecKeyStoreGetName(store));
+        xmlFreeDoc(doc);
+        return(-1);
+    }
+
+    cur = xmlSecGetNextElementNode(root->children);
+    while((cur != NULL) && xmlSecCheckNodeName(cur, xmlSecNodeKeyInfo, xmlSecDSigNs)) {
+        key = xmlSecSimpleKeysStoreReadKey(store, cur);
+        if(key == NULL) {
+            xmlSecInternalError("xmlSecSimpleKeysStoreReadKey",
+                xmlSecKeyStoreGetName(store));
+            xmlFreeDoc(doc);
+            return(-1);
+        }
+
+        if(xmlSecKeyIsValid(key)) {
+            ret = adoptKeyFunc(store, key);
+            if(ret < 0) {
+                xmlSecInternalError("adoptKeyFunc",
+                    xmlSecKeyStoreGetName(store));
+                xmlSecKeyDestroy(key);
+                xmlFreeDoc(doc);
+                return(-1);
+            }
+        } else {
+            /* we have an unknown key in our file, just ignore it */
+            xmlSecKeyDestroy(key);
+        }
+        cur = xmlSecGetNextElementNode(cur->next);
+    }
+
+    if(cur != NULL) {
+        xmlSecUnexpectedNodeError(cur, xmlSecKeyStoreGetName(store));
+        xmlFreeDoc(doc);
+        return(-1);
+    }
+
+    xmlFreeDoc(doc);
+    return(0);
+
+}
+
+/* writes @key into the empty &lt;dsig:KeyInfo/&gt; node @cur */
+static int
+xmlSecSimpleKeysStoreWriteKey(xmlSecKeyStorePtr store, xmlSecKeyPtr key, xmlNodePtr cur, xmlSecKeyDataType type) {
+    xmlSecKeyInfoCtx keyInfoCtx;
+    xmlSecKeyDataPtr data;
+    xmlSecPtrListPtr idsList;
+    xmlSecKeyDataId dataId;
+    xmlSecSize idsSize, j;
+    int ret;
+
+    xmlSecAssert2(store != NULL, -1);
+    xmlSecAssert2(key != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+
+    idsList = xmlSecKeyDataIdsGet();
+    xmlSecAssert2(idsList != NULL, -1);
+
+    /* special data key name */
+    if(xmlSecKeyGetName(key) != NULL) {
+        if(xmlSecAddChild(cur, xmlSecNodeKeyName, xmlSecDSigNs) == NULL) {
+            xmlSecInternalError2("xmlSecAddChild",
+                                 xmlSecKeyStoreGetName(store),
+                                 "node=%s",
+                                 xmlSecErrorsSafeString(xmlSecNodeKeyName));
+            return(-1);
+        }
+    }
+
+    /* create nodes for other keys data */
+    idsSize = xmlSecPtrListGetSize(idsList);
+    for(j = 0; j < idsSize; ++j) {
+        dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(idsList, j);
+        xmlSecAssert2(dataId != xmlSecKeyDataIdUnknown, -1);
+
+        if(dataId->dataNodeName == NULL) {
+            continue;
+        }
+
+        data = xmlSecKeyGetData(key, dataId);
+        if(data == NULL) {
+            continue;
+        }
+
+        if(xmlSecAddChild(cur, dataId->dataNodeName, dataId->dataNodeNs) == NULL) {
+            xmlSecInternalError2("xmlSecAddChild",
+                                 xmlSecKeyStoreGetName(store),
+                                "node=%s", xmlSecErrorsSafeString(dataId->dataNodeName));
+            return(-1);
+        }
+    }
+
+    ret = xmlSecKeyInfoCtxInitialize(&keyInfoCtx, NULL);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoCtxInitialize",
+                            xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    keyInfoCtx.mode                 = xmlSecKeyInfoModeWrite;
+    keyInfoCtx.keyReq.keyId         = xmlSecKeyDataIdUnknown;
+    keyInfoCtx.keyReq.keyType       = type;
+    keyInfoCtx.keyReq.keyUsage      = xmlSecKeyDataUsageAny;
+
+    /* finally write key in the node */
+    ret = xmlSecKeyInfoNodeWrite(cur, key, &keyInfoCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoNodeWrite",
+                            xmlSecKeyStoreGetName(store));
+        xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+        return(-1);
+    }
+    xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+
+    return(0);
+}
+
+/**
+ * xmlSecSimpleKeysStoreSave:
+ * @store:              the pointer to simple keys store.
+ * @filename:           the filename.
+ * @type:               the saved keys type (public, private, ...).
+ *
+ * Writes keys from @store to an XML file.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSimpleKeysStoreSave(xmlSecKeyStorePtr store, const char *filename, xmlSecKeyDataType type) {
+    xmlSecPtrListPtr list;
+    xmlSecKeyPtr key;
+    xmlSecSize i, keysSize;
+    xmlDocPtr doc;
+    xmlNodePtr cur;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
+    xmlSecAssert2(filename != NULL, -1);
+
+    list = xmlSecSimpleKeysStoreGetKeys(store);
+    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyPtrListId), -1);
+
+    /* create doc */
+    doc = xmlSecCreateTree(BAD_CAST "Keys", xmlSecNs);
+    if(doc == NULL) {
+        xmlSecInternalError("xmlSecCreateTree",
+                            xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    keysSize = xmlSecPtrListGetSize(list);
+    for(i = 0; i < keysSize; ++i) {
+        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(list, i);
+        xmlSecAssert2(key != NULL, -1);
+
+        cur = xmlSecAddChild(xmlDocGetRootElement(doc), xmlSecNodeKeyInfo, xmlSecDSigNs);
+        if(cur == NULL) {
+            xmlSecInternalError2("xmlSecAddChild",
+                                 xmlSecKeyStoreGetName(store),
+                                 "node=%s",
+                                 xmlSecErrorsSafeString(xmlSecNodeKeyInfo));
+            xmlFreeDoc(doc);
+            return(-1);
+        }
+
+        ret = xmlSecSimpleKeysStoreWriteKey(store, key, cur, type);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecSimpleKeysStoreWriteKey",
+                                xmlSecKeyStoreGetName(store));
+            xmlFreeDoc(doc);
+            return(-1);
+        }
+    }
+
+    /* now write result */
+    ret = xmlSaveFormatFile(filename, doc, 1);
+    if(ret < 0) {
+        xmlSecXmlError2("xmlSaveFormatFile", xmlSecKeyStoreGetName(store),
+                        "filename=%s", xmlSecErrorsSafeString(filename));
+        xmlFreeDoc(doc);
+        return(-1);
+    }
+
+    xmlFreeDoc(doc);
+    return(0);
+}
+
+/*
+ * The binary keys file (all the numbers are 32 bit little-endian):
+ *
+ *   header:    "XSKS", version, keys count
+ *   table:     keys count * (name offset, name size, key offset, key size)
+ *              sorted by the key name (the keys with the same name are
+ *              in the original order)
+ *   data:      the key names and the &lt;dsig:KeyInfo/&gt; XML documents
+ *
+ * All the offsets are from the start of the file.
+ */
+#define XMLSEC_BINARY_KEYS_FILE_MAGIC           "XSKS"
+#define XMLSEC_BINARY_KEYS_FILE_VERSION         1
+#define XMLSEC_BINARY_KEYS_FILE_HEADER_SIZE     12
+#define XMLSEC_BINARY_KEYS_FILE_ENTRY_SIZE      16
+#define XMLSEC_BINARY_KEYS_FILE_MAX_SIZE        0xFFFFFFFFU
+
+typedef struct _xmlSecBinaryKeysFileEntry {
+    xmlSecSize          pos;
+    xmlSecSize          nameOffset;
+    xmlSecSize          nameSize;
+    xmlSecSize          dataOffset;
+    xmlSecSize          dataSize;
+    const xmlSecByte*   name;
+} xmlSecBinaryKeysFileEntry, *xmlSecBinaryKeysFileEntryPtr;
+
+static int
+xmlSecBinaryKeysFileNameCompare(const xmlSecByte* name1, xmlSecSize nameSize1,
+                                const xmlSecByte* name2, xmlSecSize nameSize2) {
+    xmlSecSize size = (nameSize1 < nameSize2) ? nameSize1 : nameSize2;
+    int ret;
+
+    if(size > 0) {
+        ret = memcmp(name1, name2, size);
+        if(ret != 0) {
+            return(ret);
+        }
+    }
+    if(nameSize1 != nameSize2) {
+        return((nameSize1 < nameSize2) ? -1 : 1);
+    }
+    return(0);
+}
+
+static int
+xmlSecBinaryKeysFileEntryCompare(const void* a, const void* b) {
+    const xmlSecBinaryKeysFileEntry* entry1 = (const xmlSecBinaryKeysFileEntry*)a;
+    const xmlSecBinaryKeysFileEntry* entry2 = (const xmlSecBinaryKeysFileEntry*)b;
+    int ret;
+
+    ret = xmlSecBinaryKeysFileNameCompare(entry1->name, entry1->nameSize, entry2->name, entry2->nameSize);
+    if(ret != 0) {
+        return(ret);
+    }
+    return((entry1->pos < entry2->pos) ? -1 : ((entry1->pos > entry2->pos) ? 1 : 0));
+}
+
+static unsigned int
+xmlSecBinaryKeysFileGetUInt32(const xmlSecByte* p) {
+    return(((unsigned int)p[0]) | (((unsigned int)p[1]) << 8) |
+           (((unsigned int)p[2]) << 16) | (((unsigned int)p[3]) << 24));
+}
+
+static void
+xmlSecBinaryKeysFileSetUInt32(xmlSecByte* p, xmlSecSize val) {
+    p[0] = (xmlSecByte)(val & 0xFF);
+    p[1] = (xmlSecByte)((val >> 8) & 0xFF);
+    p[2] = (xmlSecByte)((val >> 16) & 0xFF);
+    p[3] = (xmlSecByte)((val >> 24) & 0xFF);
+}
+
+/**
+ * xmlSecSimpleKeysStoreSaveBinary:
+ * @store:              the pointer to simple keys store.
+ * @filename:           the filename.
+ * @type:               the saved keys type (public, private, ...).
+ *
+ * Writes keys from @store to a binary keys file with the keys names
+ * index. The file is loaded with #xmlSecBinaryKeysStoreLoad without
+ * reading the keys: each key is read when it is used for the first time.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSimpleKeysStoreSaveBinary(xmlSecKeyStorePtr store, const char *filename, xmlSecKeyDataType type) {
+    xmlSecPtrListPtr list;
+    xmlSecKeyPtr key;
+    xmlSecBinaryKeysFileEntryPtr entries = NULL;
+    xmlSecBuffer data;
+    xmlSecBuffer header;
+    xmlOutputBufferPtr output;
+    xmlDocPtr doc;
+    const xmlChar* name;
+    xmlSecByte* p;
+    xmlSecSize ii, keysSize, headerSize, offset;
+    FILE* f = NULL;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
+    xmlSecAssert2(filename != NULL, -1);
+
+    list = xmlSecSimpleKeysStoreGetKeys(store);
+    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyPtrListId), -1);
+    keysSize = xmlSecPtrListGetSize(list);
+
+    ret = xmlSecBufferInitialize(&data, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+    ret = xmlSecBufferInitialize(&header, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", xmlSecKeyStoreGetName(store));
+        xmlSecBufferFinalize(&data);
+        return(-1);
+    }
+
+    if(keysSize > 0) {
+        entries = (xmlSecBinaryKeysFileEntryPtr)xmlMalloc(sizeof(xmlSecBinaryKeysFileEntry) * keysSize);
+        if(entries == NULL) {
+            xmlSecMallocError(sizeof(xmlSecBinaryKeysFileEntry) * keysSize, xmlSecKeyStoreGetName(store));
+            goto done;
+        }
+        memset(entries, 0, sizeof(xmlSecBinaryKeysFileEntry) * keysSize);
+    }
+
+    /* write the names and the keys, each key is a separate &lt;dsig:KeyInfo/&gt; document */
+    for(ii = 0; ii < keysSize; ++ii) {
+        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(list, ii);
+        xmlSecAssert2(key != NULL, -1);
+
+        entries[ii].pos = ii;
+        entries[ii].nameOffset = xmlSecBufferGetSize(&data);
+        name = xmlSecKeyGetName(key);
+        if(name != NULL) {
+            entries[ii].nameSize = xmlSecStrlen(name);
+            ret = xmlSecBufferAppend(&data, name, entries[ii].nameSize);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecBufferAppend", xmlSecKeyStoreGetName(store));
+                goto done;
+            }
+        }
+
+        doc = xmlSecCreateTree(xmlSecNodeKeyInfo, xmlSecDSigNs);
+        if(doc == NULL) {
+            xmlSecInternalError("xmlSecCreateTree", xmlSecKeyStoreGetName(store));
+            goto done;
+        }
+        ret = xmlSecSimpleKeysStoreWriteKey(store, key, xmlDocGetRootElement(doc), type);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecSimpleKeysStoreWriteKey", xmlSecKeyStoreGetName(store));
+            xmlFreeDoc(doc);
+            goto done;
+        }
+
+        entries[ii].dataOffset = xmlSecBufferGetSize(&data);
+        output = xmlSecBufferCreateOutputBuffer(&data);
+        if(output == NULL) {
+            xmlSecInternalError("xmlSecBufferCreateOutputBuffer", xmlSecKeyStoreGetName(store));
+            xmlFreeDoc(doc);
+            goto done;
+        }
+        xmlNodeDumpOutput(output, doc, xmlDocGetRootElement(doc), 0, 0, NULL);
+        ret = xmlOutputBufferClose(output);
+        xmlFreeDoc(doc);
+        if(ret < 0) {
+            xmlSecXmlError("xmlOutputBufferClose", xmlSecKeyStoreGetName(store));
+            goto done;
+        }
+        entries[ii].dataSize = xmlSecBufferGetSize(&data) - entries[ii].dataOffset;
+    }
+
+    headerSize = XMLSEC_BINARY_KEYS_FILE_HEADER_SIZE + keysSize * XMLSEC_BINARY_KEYS_FILE_ENTRY_SIZE;
+    if((keysSize > (XMLSEC_BINARY_KEYS_FILE_MAX_SIZE / XMLSEC_BINARY_KEYS_FILE_ENTRY_SIZE)) ||
+       (xmlSecBufferGetSize(&data) > XMLSEC_BINARY_KEYS_FILE_MAX_SIZE - headerSize))
+    {
+        xmlSecInvalidSizeMoreThanError("Binary keys file size",
+            xmlSecBufferGetSize(&data), XMLSEC_BINARY_KEYS_FILE_MAX_SIZE - headerSize,
+            xmlSecKeyStoreGetName(store));
+        goto done;
+    }
+
+    /* sort by name for the binary search (the buffer is not changed anymore) */
+    for(ii = 0; ii < keysSize; ++ii) {
+        entries[ii].name = xmlSecBufferGetData(&data) + entries[ii].nameOffset;
+    }
+    if(keysSize > 1) {
+        qsort(entries, keysSize, sizeof(xmlSecBinaryKeysFileEntry), xmlSecBinaryKeysFileEntryCompare);
+    }
+
+    /* header and table */
+    ret = xmlSecBufferSetSize(&header, headerSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetSize", xmlSecKeyStoreGetName(store),
+            "size=" XMLSEC_SIZE_FMT, headerSize);
+        goto done;
+    }
+    p = xmlSecBufferGetData(&header);
+    memcpy(p, XMLSEC_BINARY_KEYS_FILE_MAGIC, 4);
+    xmlSecBinaryKeysFileSetUInt32(p + 4, XMLSEC_BINARY_KEYS_FILE_VERSION);
+    xmlSecBinaryKeysFileSetUInt32(p + 8, keysSize);
+    p += XMLSEC_BINARY_KEYS_FILE_HEADER_SIZE;
+    for(ii = 0; ii < keysSize; ++ii, p += XMLSEC_BINARY_KEYS_FILE_ENTRY_SIZE) {
+        offset = headerSize;
+        xmlSecBinaryKeysFileSetUInt32(p,      offset + entries[ii].nameOffset);
+        xmlSecBinaryKeysFileSetUInt32(p + 4,  entries[ii].nameSize);
+        xmlSecBinaryKeysFileSetUInt32(p + 8,  offset + entries[ii].dataOffset);
+        xmlSecBinaryKeysFileSetUInt32(p + 12, entries[ii].dataSize);
+    }
+
+    /* now write result */
+#ifndef _MSC_VER
+    f = fopen(filename, "wb");
+#else
+    fopen_s(&f, filename, "wb");
+#endif /* _MSC_VER */
+    if(f == NULL) {
+        xmlSecIOError("fopen", filename, xmlSecKeyStoreGetName(store));
+        goto done;
+    }
+    if((fwrite(xmlSecBufferGetData(&header), 1, xmlSecBufferGetSize(&header), f) != xmlSecBufferGetSize(&header)) ||
+       ((xmlSecBufferGetSize(&data) > 0) &&
+        (fwrite(xmlSecBufferGetData(&data), 1, xmlSecBufferGetSize(&data), f) != xmlSecBufferGetSize(&data))))
+    {
+        xmlSecIOError("fwrite", filename, xmlSecKeyStoreGetName(store));
+        goto done;
+    }
+    ret = fclose(f);
+    f = NULL;
+    if(ret != 0) {
+        xmlSecIOError("fclose", filename, xmlSecKeyStoreGetName(store));
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(f != NULL) {
+        fclose(f);
+    }
+    if(entries != NULL) {
+        xmlFree(entries);
+    }
+    xmlSecBufferFinalize(&header);
+    xmlSecBufferFinalize(&data);
+    return(res);
+}
+
+/**
+ * xmlSecSimpleKeysStoreGetKeys:
+ * @store:              the pointer to simple keys store.
+ *
+ * Gets list of keys from simple keys store.
+ *
+ * Returns: pointer to the list of keys stored in the keys store or NULL
+ * if an error occurs.
+ */
+xmlSecPtrListPtr
+xmlSecSimpleKeysStoreGetKeys(xmlSecKeyStorePtr store) {
+    xmlSecSimpleKeysStoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), NULL);
+
+    ctx = xmlSecSimpleKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(xmlSecPtrListCheckId(&(ctx->keys), xmlSecKeyPtrListId), NULL);
+
+    return &(ctx->keys);
+}
+
+static int
+xmlSecSimpleKeysStoreInitialize(xmlSecKeyStorePtr store) {
+    xmlSecSimpleKeysStoreCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
+
+    ctx = xmlSecSimpleKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    memset(ctx, 0, sizeof(xmlSecSimpleKeysStoreCtx));
+
+    ret = xmlSecPtrListInitialize(&(ctx->keys), xmlSecKeyPtrListId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListInitialize(xmlSecKeyPtrListId)",
+                            xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    return(0);
+}
+
+static void
+xmlSecSimpleKeysStoreFinalize(xmlSecKeyStorePtr store) {
+    xmlSecSimpleKeysStoreCtxPtr ctx;
+
+    xmlSecAssert(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId));
+
+    ctx = xmlSecSimpleKeysStoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    xmlSecSimpleKeysStoreIndexReset(ctx);
+    xmlSecPtrListFinalize(&(ctx->keys));
+    memset(ctx, 0, sizeof(xmlSecSimpleKeysStoreCtx));
+}
+
+static xmlSecSize
+xmlSecSimpleKeysStoreIndexHash(const xmlChar* name) {
+    xmlSecSize hash = 5381;
+
+    xmlSecAssert2(name != NULL, 0);
+
+    for(; (*name) != '\0'; ++name) {
+        hash = ((hash << 5) + hash) + (*name);
+    }
+    return(hash);
+}
+
+static void
+xmlSecSimpleKeysStoreIndexReset(xmlSecSimpleKeysStoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->heads != NULL) {
+        xmlFree(ctx->heads);
+        ctx->heads = NULL;
+    }
+    if(ctx->tails != NULL) {
+        xmlFree(ctx->tails);
+        ctx->tails = NULL;
+    }
+    if(ctx->next != NULL) {
+        xmlFree(ctx->next);
+        ctx->next = NULL;
+    }
+    ctx->tableSize = 0;
+    ctx->nextSize = 0;
+    ctx->indexedSize = 0;
+}
+
+/* adds the key at @pos (should be the next key after the indexed ones) to the index */
+static int
+xmlSecSimpleKeysStoreIndexAdd(xmlSecSimpleKeysStoreCtxPtr ctx, xmlSecSize pos) {
+    xmlSecKeyPtr key;
+    const xmlChar* name;
+    xmlSecSize hash;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->heads != NULL, -1);
+    xmlSecAssert2(ctx->tails != NULL, -1);
+    xmlSecAssert2(pos == ctx->indexedSize, -1);
+
+    /* grow the next array if needed */
+    if(pos >= ctx->nextSize) {
+        xmlSecSize newSize = 2 * (pos + 1);
+        xmlSecSize* newNext;
+
+        newNext = (xmlSecSize*)xmlRealloc(ctx->next, newSize * sizeof(xmlSecSize));
+        if(newNext == NULL) {
+            xmlSecMallocError(newSize * sizeof(xmlSecSize), NULL);
+            return(-1);
+        }
+        ctx->next = newNext;
+        ctx->nextSize = newSize;
+    }
+    ctx->next[pos] = 0;
+    ++ctx->indexedSize;
+
+    /* keys without names are never found by name */
+    key = (xmlSecKeyPtr)xmlSecPtrListGetItem(&(ctx->keys), pos);
+    name = (key != NULL) ? xmlSecKeyGetName(key) : NULL;
+    if(name == NULL) {
+        return(0);
+    }
+
+    hash = xmlSecSimpleKeysStoreIndexHash(name) & (ctx->tableSize - 1);
+    if(ctx->tails[hash] == 0) {
+        ctx->heads[hash] = pos + 1;
+    } else {
+        ctx->next[ctx->tails[hash] - 1] = pos + 1;
+    }
+    ctx->tails[hash] = pos + 1;
+    return(0);
+}
+
+/* (re)builds the index if the keys list was changed */
+static int
+xmlSecSimpleKeysStoreIndexUpdate(xmlSecSimpleKeysStoreCtxPtr ctx) {
+    xmlSecSize size, tableSize, pos;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+
+    size = xmlSecPtrListGetSize(&(ctx->keys));
+    if((ctx->heads != NULL) && (ctx->indexedSize == size) && (size <= 2 * ctx->tableSize)) {
+        return(0);
+    }
+
+    xmlSecSimpleKeysStoreIndexReset(ctx);
+    for(tableSize = XMLSEC_SIMPLE_KEYS_STORE_INDEX_MIN_SIZE; tableSize < size; tableSize *= 2);
+
+    ctx->heads = (xmlSecSize*)xmlMalloc(tableSize * sizeof(xmlSecSize));
+    ctx->tails = (xmlSecSize*)xmlMalloc(tableSize * sizeof(xmlSecSize));
+    if((ctx->heads == NULL) || (ctx->tails == NULL)) {
+        xmlSecMallocError(tableSize * sizeof(xmlSecSize), NULL);
+        xmlSecSimpleKeysStoreIndexReset(ctx);
+        return(-1);
+    }
+    memset(ctx->heads, 0, tableSize * sizeof(xmlSecSize));
+    memset(ctx->tails, 0, tableSize * sizeof(xmlSecSize));
+    ctx->tableSize = tableSize;
+
+    for(pos = 0; pos < size; ++pos) {
+        ret = xmlSecSimpleKeysStoreIndexAdd(ctx, pos);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecSimpleKeysStoreIndexAdd", NULL);
+            xmlSecSimpleKeysStoreIndexReset(ctx);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static xmlSecKeyPtr
+xmlSecSimpleKeysStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecSimpleKeysStoreCtxPtr ctx;
+    xmlSecKeyPtr key;
+    xmlSecSize pos, size;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), NULL);
+    xmlSecAssert2(keyInfoCtx != NULL, NULL);
+
+    ctx = xmlSecSimpleKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(xmlSecPtrListCheckId(&(ctx->keys), xmlSecKeyPtrListId), NULL);
+
+    size = xmlSecPtrListGetSize(&(ctx->keys));
+
+    /* lookup by name: check only the keys with the same name hash */
+    if(name != NULL) {
+        ret = xmlSecSimpleKeysStoreIndexUpdate(ctx);
+        if(ret == 0) {
+            xmlSecSize hash = xmlSecSimpleKeysStoreIndexHash(name) & (ctx->tableSize - 1);
+
+            for(pos = ctx->heads[hash]; (pos > 0) && (pos <= size); pos = ctx->next[pos - 1]) {
+                key = (xmlSecKeyPtr)xmlSecPtrListGetItem(&(ctx->keys), pos - 1);
+                if((key != NULL) && (xmlSecKeyMatch(key, name, &(keyInfoCtx->keyReq)) == 1)) {
+                    return(xmlSecKeyRef(key));
+                }
+            }
+            return(NULL);
+        }
+        /* fallback to the full scan */
+    }
+
+    for(pos = 0; pos < size; ++pos) {
+        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(&(ctx->keys), pos);
+        if((key != NULL) && (xmlSecKeyMatch(key, name, &(keyInfoCtx->keyReq)) == 1)) {
+            /* the key is shared with the store and should not be modified */
+            return(xmlSecKeyRef(key));
+        }
+    }
+    return(NULL);
+}
+
+/****************************************************************************
+ *
+ * Snapshot Keys Store
+ *
+ * xmlSecKeyStore + xmlSecSnapshotKeysStoreCtx (current snapshot)
+ *
+ * The keys are kept in an immutable snapshot (a simple keys store with
+ * the names index already built). The lookups take a reference to the
+ * current snapshot (the only locked operation) and search it without
+ * locks. The writers build a new snapshot and replace the current one,
+ * the lookups in progress keep using the previous snapshot until they
+ * release it. The found keys are shared with the snapshot (see
+ * #xmlSecKeyRef) and stay valid after the snapshot is released.
+ *
+ * With the NUMA replicas enabled, each snapshot also keeps one copy of the
+ * keys (duplicated keys and the names index) per NUMA node. The replica is
+ * built from the snapshot by the first lookup on the node, so its memory
+ * is allocated (first touched) on this node, and is released together with
+ * the snapshot.
+ *
+ ***************************************************************************/
+#define XMLSEC_SNAPSHOT_KEYS_STORE_NUMA_NODES_MAX       16
+
+typedef struct _xmlSecSnapshotKeysStoreSnapshot {
+    xmlSecKeyStorePtr   keys;           /* simple keys store, never modified after publishing */
+    int                 refCount;       /* protected by the ctx mutex */
+    xmlSecKeyStorePtr   replicas[XMLSEC_SNAPSHOT_KEYS_STORE_NUMA_NODES_MAX]; /* protected by the ctx mutex */
+} xmlSecSnapshotKeysStoreSnapshot, *xmlSecSnapshotKeysStoreSnapshotPtr;
+
+typedef struct _xmlSecSnapshotKeysStoreCtx {
+    xmlMutexPtr                         mutex;          /* protects the current snapshot pointer */
+    xmlMutexPtr                         writeMutex;     /* serializes the writers */
+    xmlSecSnapshotKeysStoreSnapshotPtr  current;
+    int                                 numaReplicas;   /* protected by the mutex */
+} xmlSecSnapshotKeysStoreCtx, *xmlSecSnapshotKeysStoreCtxPtr;
+
+XMLSEC_KEY_STORE_DECLARE(SnapshotKeysStore, xmlSecSnapshotKeysStoreCtx)
+#define xmlSecSnapshotKeysStoreSize XMLSEC_KEY_STORE_SIZE(SnapshotKeysStore)
+
+static int                      xmlSecSnapshotKeysStoreInitialize(xmlSecKeyStorePtr store);
+static void                     xmlSecSnapshotKeysStoreFinalize (xmlSecKeyStorePtr store);
+static xmlSecKeyPtr             xmlSecSnapshotKeysStoreFindKey  (xmlSecKeyStorePtr store,
+                                                                 const xmlChar* name,
+                                                                 xmlSecKeyInfoCtxPtr keyInfoCtx);
+
+static xmlSecKeyStoreKlass xmlSecSnapshotKeysStoreKlass = {
+    sizeof(xmlSecKeyStoreKlass),
+    xmlSecSnapshotKeysStoreSize,
+
+    /* data */
+    BAD_CAST "snapshot-keys-store",             /* const xmlChar* name; */
+
+    /* constructors/destructor */
+    xmlSecSnapshotKeysStoreInitialize,          /* xmlSecKeyStoreInitializeMethod initialize; */
+    xmlSecSnapshotKeysStoreFinalize,            /* xmlSecKeyStoreFinalizeMethod finalize; */
+    xmlSecSnapshotKeysStoreFindKey,             /* xmlSecKeyStoreFindKeyMethod findKey; */
+    NULL,                                       /* xmlSecKeyStoreFindKeyFromX509DataMethod findKeyFromX509Data; */
+
+    /* reserved for the future */
+    NULL,                                       /* void* reserved0; */
+};
+
+/**
+ * xmlSecSnapshotKeysStoreGetKlass:
+ *
+ * The snapshot keys store klass: the keys store for the applications
+ * that update the keys (e.g. reload them from a file) while the keys
+ * manager is used by other threads. The lookups don't wait for the
+ * updates and the lookups in progress are not affected by them.
+ *
+ * Returns: snapshot keys store klass.
+ */
+xmlSecKeyStoreId
+xmlSecSnapshotKeysStoreGetKlass(void) {
+    return(&xmlSecSnapshotKeysStoreKlass);
+}
+
+/* takes ownership of @keys on success */
+static xmlSecSnapshotKeysStoreSnapshotPtr
+xmlSecSnapshotKeysStoreSnapshotCreate(xmlSecKeyStorePtr keys) {
+    xmlSecSnapshotKeysStoreSnapshotPtr snapshot;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(keys, xmlSecSimpleKeysStoreId), NULL);
+
+    /* build the names index now, the snapshot is never modified after publishing */
+    ret = xmlSecSimpleKeysStoreIndexUpdate(xmlSecSimpleKeysStoreGetCtx(keys));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecSimpleKeysStoreIndexUpdate", NULL);
+        return(NULL);
+    }
+
+    snapshot = (xmlSecSnapshotKeysStoreSnapshotPtr)xmlMalloc(sizeof(xmlSecSnapshotKeysStoreSnapshot));
+    if(snapshot == NULL) {
+        xmlSecMallocError(sizeof(xmlSecSnapshotKeysStoreSnapshot), NULL);
+        return(NULL);
+    }
+    memset(snapshot, 0, sizeof(xmlSecSnapshotKeysStoreSnapshot));
+    snapshot->keys = keys;
+    snapshot->refCount = 1;
+    return(snapshot);
+}
+
+static xmlSecSnapshotKeysStoreSnapshotPtr
+xmlSecSnapshotKeysStoreSnapshotAcquire(xmlSecSnapshotKeysStoreCtxPtr ctx, int* numaReplicas) {
+    xmlSecSnapshotKeysStoreSnapshotPtr snapshot;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(numaReplicas != NULL, NULL);
+
+    xmlMutexLock(ctx->mutex);
+    snapshot = ctx->current;
+    if(snapshot != NULL) {
+        ++snapshot->refCount;
+    }
+    (*numaReplicas) = ctx->numaReplicas;
+    xmlMutexUnlock(ctx->mutex);
+
+    return(snapshot);
+}
+
+static void
+xmlSecSnapshotKeysStoreSnapshotRelease(xmlSecSnapshotKeysStoreCtxPtr ctx, xmlSecSnapshotKeysStoreSnapshotPtr snapshot) {
+    xmlSecSize ii;
+    int refCount;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(snapshot != NULL);
+
+    xmlMutexLock(ctx->mutex);
+    refCount = --snapshot->refCount;
+    xmlMutexUnlock(ctx->mutex);
+
+    if(refCount > 0) {
+        return;
+    }
+    for(ii = 0; ii < XMLSEC_SNAPSHOT_KEYS_STORE_NUMA_NODES_MAX; ++ii) {
+        if(snapshot->replicas[ii] != NULL) {
+            xmlSecKeyStoreDestroy(snapshot->replicas[ii]);
+        }
+    }
+    if(snapshot->keys != NULL) {
+        xmlSecKeyStoreDestroy(snapshot->keys);
+    }
+    memset(snapshot, 0, sizeof(xmlSecSnapshotKeysStoreSnapshot));
+    xmlFree(snapshot);
+}
+
+/* returns the current thread NUMA node or -1 if it is unknown */
+static int
+xmlSecSnapshotKeysStoreGetNumaNode(void) {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+
+    if(syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+        return(-1);
+    }
+    return((node < XMLSEC_SNAPSHOT_KEYS_STORE_NUMA_NODES_MAX) ? (int)node : -1);
+#else  /* defined(__linux__) && defined(SYS_getcpu) */
+    return(-1);
+#endif /* defined(__linux__) && defined(SYS_getcpu) */
+}
+
+/* creates the copy of the snapshot keys (the keys are duplicated, not shared) */
+static xmlSecKeyStorePtr
+xmlSecSnapshotKeysStoreReplicaCreate(xmlSecKeyStorePtr keys) {
+    xmlSecKeyStorePtr replica;
+    xmlSecPtrListPtr list;
+    xmlSecKeyPtr key, tmp;
+    xmlSecSize pos, size;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(keys, xmlSecSimpleKeysStoreId), NULL);
+
+    replica = xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId);
+    if(replica == NULL) {
+        xmlSecInternalError("xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId)", NULL);
+        return(NULL);
+    }
+
+    list = xmlSecSimpleKeysStoreGetKeys(keys);
+    size = xmlSecPtrListGetSize(list);
+    for(pos = 0; pos < size; ++pos) {
+        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(list, pos);
+        if(key == NULL) {
+            continue;
+        }
+        tmp = xmlSecKeyDuplicate(key);
+        if(tmp == NULL) {
+            xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+            xmlSecKeyStoreDestroy(replica);
+            return(NULL);
+        }
+        ret = xmlSecSimpleKeysStoreAdoptKey(replica, tmp);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecSimpleKeysStoreAdoptKey", NULL);
+            xmlSecKeyDestroy(tmp);
+            xmlSecKeyStoreDestroy(replica);
+            return(NULL);
+        }
+    }
+
+    /* the replica is never modified after publishing */
+    ret = xmlSecSimpleKeysStoreIndexUpdate(xmlSecSimpleKeysStoreGetCtx(replica));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecSimpleKeysStoreIndexUpdate", NULL);
+        xmlSecKeyStoreDestroy(replica);
+        return(NULL);
+    }
+    return(replica);
+}
+
+/* returns the current NUMA node replica of the snapshot (or the snapshot keys) */
+static xmlSecKeyStorePtr
+xmlSecSnapshotKeysStoreReplicaGet(xmlSecSnapshotKeysStoreCtxPtr ctx, xmlSecSnapshotKeysStoreSnapshotPtr snapshot) {
+    xmlSecKeyStorePtr replica;
+    xmlSecKeyStorePtr res;
+    int node;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(snapshot != NULL, NULL);
+
+    node = xmlSecSnapshotKeysStoreGetNumaNode();
+    if(node < 0) {
+        return(snapshot->keys);
+    }
+
+    xmlMutexLock(ctx->mutex);
+    res = snapshot->replicas[node];
+    xmlMutexUnlock(ctx->mutex);
+    if(res != NULL) {
+        return(res);
+    }
+
+    /* build outside of the lock, not fatal if we can't */
+    replica = xmlSecSnapshotKeysStoreReplicaCreate(snapshot->keys);
+    if(replica == NULL) {
+        xmlSecInternalError("xmlSecSnapshotKeysStoreReplicaCreate", NULL);
+        return(snapshot->keys);
+    }
+
+    xmlMutexLock(ctx->mutex);
+    if(snapshot->replicas[node] == NULL) {
+        snapshot->replicas[node] = replica;
+        replica = NULL;
+    }
+    res = snapshot->replicas[node];
+    xmlMutexUnlock(ctx->mutex);
+
+    /* another thread was faster */
+    if(replica != NULL) {
+        xmlSecKeyStoreDestroy(replica);
+    }
+    return(res);
+}
+
+/* replaces the current snapshot, the lookups in progress keep the previous one */
+static void
+xmlSecSnapshotKeysStoreSnapshotPublish(xmlSecSnapshotKeysStoreCtxPtr ctx, xmlSecSnapshotKeysStoreSnapshotPtr snapshot) {
+    xmlSecSnapshotKeysStoreSnapshotPtr prev;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(snapshot != NULL);
+
+    xmlMutexLock(ctx->mutex);
+    prev = ctx->current;
+    ctx->current = snapshot;
+    xmlMutexUnlock(ctx->mutex);
+
+    if(prev != NULL) {
+        xmlSecSnapshotKeysStoreSnapshotRelease(ctx, prev);
+    }
+}
+
+/**
+ * xmlSecSnapshotKeysStoreAdoptKey:
+ * @store:              the pointer to snapshot keys store.
+ * @key:                the pointer to key.
+ *
+ * Adds @key to the @store: the new snapshot with all the current keys
+ * and the @key replaces the current snapshot. Use
+ * #xmlSecSnapshotKeysStoreAdoptKeysStore to add or replace many keys
+ * at once.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSnapshotKeysStoreAdoptKey(xmlSecKeyStorePtr store, xmlSecKeyPtr key) {
+    xmlSecSnapshotKeysStoreCtxPtr ctx;
+    xmlSecSnapshotKeysStoreSnapshotPtr snapshot;
+    xmlSecKeyStorePtr keys = NULL;
+    xmlSecPtrListPtr list;
+    xmlSecKeyPtr tmp;
+    xmlSecSize pos, size;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSnapshotKeysStoreId), -1);
+    xmlSecAssert2(key != NULL, -1);
+
+    ctx = xmlSecSnapshotKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->writeMutex != NULL, -1);
+
+    xmlMutexLock(ctx->writeMutex);
+
+    keys = xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId);
+    if(keys == NULL) {
+        xmlSecInternalError("xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId)",
+                            xmlSecKeyStoreGetName(store));
+        goto done;
+    }
+
+    /* share the current keys with the new snapshot (only writers change the current snapshot) */
+    if(ctx->current != NULL) {
+        list = xmlSecSimpleKeysStoreGetKeys(ctx->current->keys);
+        size = xmlSecPtrListGetSize(list);
+        for(pos = 0; pos < size; ++pos) {
+            tmp = (xmlSecKeyPtr)xmlSecPtrListGetItem(list, pos);
+            if(tmp == NULL) {
+                continue;
+            }
+            ret = xmlSecSimpleKeysStoreAdoptKey(keys, xmlSecKeyRef(tmp));
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecSimpleKeysStoreAdoptKey",
+                                    xmlSecKeyStoreGetName(store));
+                xmlSecKeyDestroy(tmp);
+                goto done;
+            }
+        }
+    }
+
+    /* the key stays with the caller until the new snapshot is published */
+    ret = xmlSecSimpleKeysStoreAdoptKey(keys, xmlSecKeyRef(key));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecSimpleKeysStoreAdoptKey",
+                            xmlSecKeyStoreGetName(store));
+        xmlSecKeyDestroy(key);
+        goto done;
+    }
+
+    snapshot = xmlSecSnapshotKeysStoreSnapshotCreate(keys);
+    if(snapshot == NULL) {
+        xmlSecInternalError("xmlSecSnapshotKeysStoreSnapshotCreate",
+                            xmlSecKeyStoreGetName(store));
+        goto done;
+    }
+    keys = NULL;
+
+    xmlSecSnapshotKeysStoreSnapshotPublish(ctx, snapshot);
+
+    /* the store owns the key now */
+    xmlSecKeyDestroy(key);
+    res = 0;
+
+done:
+    xmlMutexUnlock(ctx->writeMutex);
+    if(keys != NULL) {
+        xmlSecKeyStoreDestroy(keys);
+    }
+    return(res);
+}
+
+/**
+ * xmlSecSnapshotKeysStoreAdoptKeysStore:
+ * @store:              the pointer to snapshot keys store.
+ * @keys:               the pointer to simple keys store with the new keys.
+ *
+ * Replaces all the keys in the @store with the keys from the simple keys
+ * store @keys (e.g. reloaded from a file with #xmlSecSimpleKeysStoreLoad).
+ * The lookups in progress finish with the previous keys. On success, the
+ * @store owns the @keys and the @keys should not be modified anymore.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSnapshotKeysStoreAdoptKeysStore(xmlSecKeyStorePtr store, xmlSecKeyStorePtr keys) {
+    xmlSecSnapshotKeysStoreCtxPtr ctx;
+    xmlSecSnapshotKeysStoreSnapshotPtr snapshot;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSnapshotKeysStoreId), -1);
+    xmlSecAssert2(xmlSecKeyStoreCheckId(keys, xmlSecSimpleKeysStoreId), -1);
+
+    ctx = xmlSecSnapshotKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->writeMutex != NULL, -1);
+
+    snapshot = xmlSecSnapshotKeysStoreSnapshotCreate(keys);
+    if(snapshot == NULL) {
+        xmlSecInternalError("xmlSecSnapshotKeysStoreSnapshotCreate",
+                            xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    xmlMutexLock(ctx->writeMutex);
+    xmlSecSnapshotKeysStoreSnapshotPublish(ctx, snapshot);
+    xmlMutexUnlock(ctx->writeMutex);
+
+    return(0);
+}
+
+/**
+ * xmlSecSnapshotKeysStoreSetNumaReplicas:
+ * @store:              the pointer to snapshot keys store.
+ * @enabled:            1 to enable the NUMA replicas or 0 to disable them.
+ *
+ * Enables or disables the per NUMA node replicas of the @store keys. When
+ * enabled, the lookups are served from a copy of the current snapshot
+ * (the duplicated keys and the names index) built on the first lookup from
+ * each NUMA node, so the multi-socket hosts don't read the keys from the
+ * other node memory. The replicas take one copy of the keys per node and
+ * are only supported on Linux (the lookups use the shared snapshot
+ * otherwise). The existing replicas are kept until the snapshot is replaced.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSnapshotKeysStoreSetNumaReplicas(xmlSecKeyStorePtr store, int enabled) {
+    xmlSecSnapshotKeysStoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSnapshotKeysStoreId), -1);
+
+    ctx = xmlSecSnapshotKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->mutex != NULL, -1);
+
+    xmlMutexLock(ctx->mutex);
+    ctx->numaReplicas = (enabled != 0) ? 1 : 0;
+    xmlMutexUnlock(ctx->mutex);
+    return(0);
+}
+
+/**
+ * xmlSecSnapshotKeysStoreLoad:
+ * @store:              the pointer to snapshot keys store.
+ * @uri:                the filename.
+ * @keysMngr:           the pointer to associated keys manager.
+ *
+ * Reads keys from an XML file (see #xmlSecSimpleKeysStoreLoad) and
+ * replaces all the keys in the @store with them. The @store is not
+ * changed if an error occurs.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSnapshotKeysStoreLoad(xmlSecKeyStorePtr store, const char *uri, xmlSecKeysMngrPtr keysMngr) {
+    xmlSecKeyStorePtr keys;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSnapshotKeysStoreId), -1);
+    xmlSecAssert2(uri != NULL, -1);
+
+    keys = xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId);
+    if(keys == NULL) {
+        xmlSecInternalError("xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId)",
+                            xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    ret = xmlSecSimpleKeysStoreLoad(keys, uri, keysMngr);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecSimpleKeysStoreLoad", xmlSecKeyStoreGetName(store),
+                             "uri=%s", xmlSecErrorsSafeString(uri));
+        xmlSecKeyStoreDestroy(keys);
+        return(-1);
+    }
+
+    ret = xmlSecSnapshotKeysStoreAdoptKeysStore(store, keys);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecSnapshotKeysStoreAdoptKeysStore",
+                            xmlSecKeyStoreGetName(store));
+        xmlSecKeyStoreDestroy(keys);
+        return(-1);
+    }
+
+    return(0);
+}
+
+static int
+xmlSecSnapshotKeysStoreInitialize(xmlSecKeyStorePtr store) {
+    xmlSecSnapshotKeysStoreCtxPtr ctx;
+    xmlSecKeyStorePtr keys;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSnapshotKeysStoreId), -1);
+
+    ctx = xmlSecSnapshotKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    memset(ctx, 0, sizeof(xmlSecSnapshotKeysStoreCtx));
+
+    ctx->mutex = xmlNewMutex();
+    ctx->writeMutex = xmlNewMutex();
+    if((ctx->mutex == NULL) || (ctx->writeMutex == NULL)) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyStoreGetName(store));
+        xmlSecSnapshotKeysStoreFinalize(store);
+        return(-1);
+    }
+
+    /* start with an empty snapshot */
+    keys = xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId);
+    if(keys == NULL) {
+        xmlSecInternalError("xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId)",
+                            xmlSecKeyStoreGetName(store));
+        xmlSecSnapshotKeysStoreFinalize(store);
+        return(-1);
+    }
+    ctx->current = xmlSecSnapshotKeysStoreSnapshotCreate(keys);
+    if(ctx->current == NULL) {
+        xmlSecInternalError("xmlSecSnapshotKeysStoreSnapshotCreate",
+                            xmlSecKeyStoreGetName(store));
+        xmlSecKeyStoreDestroy(keys);
+        xmlSecSnapshotKeysStoreFinalize(store);
+        return(-1);
+    }
+
+    return(0);
+}
+
+static void
+xmlSecSnapshotKeysStoreFinalize(xmlSecKeyStorePtr store) {
+    xmlSecSnapshotKeysStoreCtxPtr ctx;
+
+    xmlSecAssert(xmlSecKeyStoreCheckId(store, xmlSecSnapshotKeysStoreId));
+
+    ctx = xmlSecSnapshotKeysStoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->current != NULL) {
+        xmlSecSnapshotKeysStoreSnapshotRelease(ctx, ctx->current);
+    }
+    if(ctx->writeMutex != NULL) {
+        xmlFreeMutex(ctx->writeMutex);
+    }
+    if(ctx->mutex != NULL) {
+        xmlFreeMutex(ctx->mutex);
+    }
+    memset(ctx, 0, sizeof(xmlSecSnapshotKeysStoreCtx));
+}
+
+static xmlSecKeyPtr
+xmlSecSnapshotKeysStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecSnapshotKeysStoreCtxPtr ctx;
+    xmlSecSnapshotKeysStoreSnapshotPtr snapshot;
+    xmlSecKeyStorePtr keys;
+    xmlSecKeyPtr key;
+    int numaReplicas;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSnapshotKeysStoreId), NULL);
+    xmlSecAssert2(keyInfoCtx != NULL, NULL);
+
+    ctx = xmlSecSnapshotKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
+
+    snapshot = xmlSecSnapshotKeysStoreSnapshotAcquire(ctx, &numaReplicas);
+    if(snapshot == NULL) {
+        return(NULL);
+    }
+    if(numaReplicas != 0) {
+        keys = xmlSecSnapshotKeysStoreReplicaGet(ctx, snapshot);
+    } else {
+        keys = snapshot->keys;
+    }
+    key = xmlSecKeyStoreFindKey(keys, name, keyInfoCtx);
+    xmlSecSnapshotKeysStoreSnapshotRelease(ctx, snapshot);
+
+    return(key);
+}
+
+/****************************************************************************
+ *
+ * Binary Keys Store
+ *
+ * xmlSecKeyStore + xmlSecBinaryKeysStoreCtx (binary keys file + read keys)
+ *
+ * The binary keys file (see #xmlSecSimpleKeysStoreSaveBinary) is mapped
+ * into the memory (or read if it can't be mapped) and only the header
+ * and the names table are checked when it is loaded. The keys are read
+ * when they are used for the first time and cached until the store is
+ * destroyed.
+ *
+ ***************************************************************************/
+typedef struct _xmlSecBinaryKeysStoreCtx {
+    xmlSecFileMap               map;
+    xmlSecBuffer                buffer;         /* the file content if it is not mapped */
+    const xmlSecByte*           data;
+    xmlSecSize                  dataSize;
+    xmlSecSize                  keysSize;
+
+    xmlMutexPtr                 mutex;          /* protects keys and failed */
+    xmlSecKeyPtr*               keys;           /* keysSize entries, NULL if not read yet */
+    xmlSecByte*                 failed;         /* keysSize entries, 1 if the key can't be read */
+} xmlSecBinaryKeysStoreCtx, *xmlSecBinaryKeysStoreCtxPtr;
+
+XMLSEC_KEY_STORE_DECLARE(BinaryKeysStore, xmlSecBinaryKeysStoreCtx)
+#define xmlSecBinaryKeysStoreSize XMLSEC_KEY_STORE_SIZE(BinaryKeysStore)
+
+static int                      xmlSecBinaryKeysStoreInitialize (xmlSecKeyStorePtr store);
+static void                     xmlSecBinaryKeysStoreFinalize   (xmlSecKeyStorePtr store);
+static xmlSecKeyPtr             xmlSecBinaryKeysStoreFindKey    (xmlSecKeyStorePtr store,
+                                                                 const xmlChar* name,
+                                                                 xmlSecKeyInfoCtxPtr keyInfoCtx);
+
+static xmlSecKeyStoreKlass xmlSecBinaryKeysStoreKlass = {
+    sizeof(xmlSecKeyStoreKlass),
+    xmlSecBinaryKeysStoreSize,
+
+    /* data */
+    BAD_CAST "binary-keys-store",               /* const xmlChar* name; */
+
+    /* constructors/destructor */
+    xmlSecBinaryKeysStoreInitialize,            /* xmlSecKeyStoreInitializeMethod initialize; */
+    xmlSecBinaryKeysStoreFinalize,              /* xmlSecKeyStoreFinalizeMethod finalize; */
+    xmlSecBinaryKeysStoreFindKey,               /* xmlSecKeyStoreFindKeyMethod findKey; */
+    NULL,                                       /* xmlSecKeyStoreFindKeyFromX509DataMethod findKeyFromX509Data; */
+
+    /* reserved for the future */
+    NULL,                                       /* void* reserved0; */
+};
+
+/**
+ * xmlSecBinaryKeysStoreGetKlass:
+ *
+ * The binary keys store klass: the read-only keys store loaded from
+ * the binary keys file written by #xmlSecSimpleKeysStoreSaveBinary.
+ *
+ * Returns: binary keys store klass.
+ */
+xmlSecKeyStoreId
+xmlSecBinaryKeysStoreGetKlass(void) {
+    return(&xmlSecBinaryKeysStoreKlass);
+}
+
+static void
+xmlSecBinaryKeysStoreGetEntry(xmlSecBinaryKeysStoreCtxPtr ctx, xmlSecSize pos,
+                              const xmlSecByte** name, xmlSecSize* nameSize,
+                              const xmlSecByte** data, xmlSecSize* dataSize) {
+    const xmlSecByte* p;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->data != NULL);
+    xmlSecAssert(pos < ctx->keysSize);
+
+    /* the table is checked when the file is loaded */
+    p = ctx->data + XMLSEC_BINARY_KEYS_FILE_HEADER_SIZE + pos * XMLSEC_BINARY_KEYS_FILE_ENTRY_SIZE;
+    if(name != NULL) {
+        (*name) = ctx->data + xmlSecBinaryKeysFileGetUInt32(p);
+    }
+    if(nameSize != NULL) {
+        (*nameSize) = xmlSecBinaryKeysFileGetUInt32(p + 4);
+    }
+    if(data != NULL) {
+        (*data) = ctx->data + xmlSecBinaryKeysFileGetUInt32(p + 8);
+    }
+    if(dataSize != NULL) {
+        (*dataSize) = xmlSecBinaryKeysFileGetUInt32(p + 12);
+    }
+}
+
+static int
+xmlSecBinaryKeysStoreCheckFile(xmlSecBinaryKeysStoreCtxPtr ctx) {
+    const xmlSecByte* p;
+    const xmlSecByte* name = NULL;
+    const xmlSecByte* prevName = NULL;
+    xmlSecSize nameSize = 0, prevNameSize = 0;
+    xmlSecSize offset, size;
+    xmlSecSize ii;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->data != NULL, -1);
+
+    p = ctx->data;
+    if((ctx->dataSize < XMLSEC_BINARY_KEYS_FILE_HEADER_SIZE) ||
+       (memcmp(p, XMLSEC_BINARY_KEYS_FILE_MAGIC, 4) != 0) ||
+       (xmlSecBinaryKeysFileGetUInt32(p + 4) != XMLSEC_BINARY_KEYS_FILE_VERSION))
+    {
+        return(-1);
+    }
+    ctx->keysSize = xmlSecBinaryKeysFileGetUInt32(p + 8);
+    if(ctx->keysSize > (ctx->dataSize - XMLSEC_BINARY_KEYS_FILE_HEADER_SIZE) / XMLSEC_BINARY_KEYS_FILE_ENTRY_SIZE) {
+        return(-1);
+    }
+
+    for(ii = 0, p += XMLSEC_BINARY_KEYS_FILE_HEADER_SIZE; ii < ctx->keysSize; ++ii, p += XMLSEC_BINARY_KEYS_FILE_ENTRY_SIZE) {
+        offset = xmlSecBinaryKeysFileGetUInt32(p);
+        size   = xmlSecBinaryKeysFileGetUInt32(p + 4);
+        if((offset > ctx->dataSize) || (size > ctx->dataSize - offset)) {
+            return(-1);
+        }
+        name = ctx->data + offset;
+        nameSize = size;
+
+        offset = xmlSecBinaryKeysFileGetUInt32(p + 8);
+        size   = xmlSecBinaryKeysFileGetUInt32(p + 12);
+        if((offset > ctx->dataSize) || (size == 0) || (size > ctx->dataSize - offset)) {
+            return(-1);
+        }
+
+        /* the binary search needs the sorted names */
+        if((prevName != NULL) && (xmlSecBinaryKeysFileNameCompare(prevName, prevNameSize, name, nameSize) > 0)) {
+            return(-1);
+        }
+        prevName = name;
+        prevNameSize = nameSize;
+    }
+    return(0);
+}
+
+/**
+ * xmlSecBinaryKeysStoreLoad:
+ * @store:              the pointer to binary keys store.
+ * @filename:           the binary keys file name.
+ *
+ * Loads the binary keys file written by #xmlSecSimpleKeysStoreSaveBinary
+ * in the empty @store. The keys are not read until they are used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecBinaryKeysStoreLoad(xmlSecKeyStorePtr store, const char *filename) {
+    xmlSecBinaryKeysStoreCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecBinaryKeysStoreId), -1);
+    xmlSecAssert2(filename != NULL, -1);
+
+    ctx = xmlSecBinaryKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->data == NULL, -1);
+
+    if(xmlSecFileMapOpen(&(ctx->map), filename) == 1) {
+        ctx->data = ctx->map.data;
+        ctx->dataSize = ctx->map.size;
+    } else {
+        ret = xmlSecBufferReadFile(&(ctx->buffer), filename);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferReadFile", xmlSecKeyStoreGetName(store),
+                "filename=%s", xmlSecErrorsSafeString(filename));
+            return(-1);
+        }
+        ctx->data = xmlSecBufferGetData(&(ctx->buffer));
+        ctx->dataSize = xmlSecBufferGetSize(&(ctx->buffer));
+    }
+
+    if((ctx->data == NULL) || (xmlSecBinaryKeysStoreCheckFile(ctx) < 0)) {
+        xmlSecInvalidDataError("invalid binary keys file", xmlSecKeyStoreGetName(store));
+        goto error;
+    }
+
+    if(ctx->keysSize > 0) {
+        ctx->keys = (xmlSecKeyPtr*)xmlMalloc(sizeof(xmlSecKeyPtr) * ctx->keysSize);
+        ctx->failed = (xmlSecByte*)xmlMalloc(sizeof(xmlSecByte) * ctx->keysSize);
+        if((ctx->keys == NULL) || (ctx->failed == NULL)) {
+            xmlSecMallocError(sizeof(xmlSecKeyPtr) * ctx->keysSize, xmlSecKeyStoreGetName(store));
+            goto error;
+        }
+        memset(ctx->keys, 0, sizeof(xmlSecKeyPtr) * ctx->keysSize);
+        memset(ctx->failed, 0, sizeof(xmlSecByte) * ctx->keysSize);
+    }
+    return(0);
+
+error:
+    if(ctx->keys != NULL) {
+        xmlFree(ctx->keys);
+        ctx->keys = NULL;
+    }
+    if(ctx->failed != NULL) {
+        xmlFree(ctx->failed);
+        ctx->failed = NULL;
+    }
+    xmlSecFileMapClose(&(ctx->map));
+    xmlSecBufferEmpty(&(ctx->buffer));
+    ctx->data = NULL;
+    ctx->dataSize = 0;
+    ctx->keysSize = 0;
+    return(-1);
+}
+
+/**
+ * xmlSecBinaryKeysStoreGetSize:
+ * @store:              the pointer to binary keys store.
+ *
+ * Gets the number of keys in the binary keys file.
+ *
+ * Returns: the number of keys in the @store.
+ */
+xmlSecSize
+xmlSecBinaryKeysStoreGetSize(xmlSecKeyStorePtr store) {
+    xmlSecBinaryKeysStoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecBinaryKeysStoreId), 0);
+
+    ctx = xmlSecBinaryKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, 0);
+
+    return(ctx->keysSize);
+}
+
+static int
+xmlSecBinaryKeysStoreInitialize(xmlSecKeyStorePtr store) {
+    xmlSecBinaryKeysStoreCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecBinaryKeysStoreId), -1);
+
+    ctx = xmlSecBinaryKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    memset(ctx, 0, sizeof(xmlSecBinaryKeysStoreCtx));
+
+    ret = xmlSecBufferInitialize(&(ctx->buffer), 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    ctx->mutex = xmlNewMutex();
+    if(ctx->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyStoreGetName(store));
+        xmlSecBufferFinalize(&(ctx->buffer));
+        return(-1);
+    }
+
+    return(0);
+}
+
+static void
+xmlSecBinaryKeysStoreFinalize(xmlSecKeyStorePtr store) {
+    xmlSecBinaryKeysStoreCtxPtr ctx;
+    xmlSecSize ii;
+
+    xmlSecAssert(xmlSecKeyStoreCheckId(store, xmlSecBinaryKeysStoreId));
+
+    ctx = xmlSecBinaryKeysStoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->keys != NULL) {
+        for(ii = 0; ii < ctx->keysSize; ++ii) {
+            if(ctx->keys[ii] != NULL) {
+                xmlSecKeyDestroy(ctx->keys[ii]);
+            }
+        }
+        xmlFree(ctx->keys);
+    }
+    if(ctx->failed != NULL) {
+        xmlFree(ctx->failed);
+    }
+    if(ctx->mutex != NULL) {
+        xmlFreeMutex(ctx->mutex);
+    }
+    xmlSecFileMapClose(&(ctx->map));
+    xmlSecBufferFinalize(&(ctx->buffer));
+    memset(ctx, 0, sizeof(xmlSecBinaryKeysStoreCtx));
+}
+
+/* returns the new reference to the key at @pos (reads it if needed) or NULL if the key can't be read */
+static xmlSecKeyPtr
+xmlSecBinaryKeysStoreGetKey(xmlSecKeyStorePtr store, xmlSecSize pos) {
+    xmlSecBinaryKeysStoreCtxPtr ctx;
+    const xmlSecByte* data = NULL;
+    xmlSecSize dataSize = 0;
+    xmlSecKeyPtr key = NULL;
+    xmlDocPtr doc;
+    xmlNodePtr cur;
+
+    xmlSecAssert2(store != NULL, NULL);
+
+    ctx = xmlSecBinaryKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->keys != NULL, NULL);
+    xmlSecAssert2(ctx->failed != NULL, NULL);
+    xmlSecAssert2(pos < ctx->keysSize, NULL);
+
+    xmlMutexLock(ctx->mutex);
+    if(ctx->keys[pos] != NULL) {
+        key = xmlSecKeyRef(ctx->keys[pos]);
+    }
+    if((key != NULL) || (ctx->failed[pos] != 0)) {
+        xmlMutexUnlock(ctx->mutex);
+        return(key);
+    }
+    xmlMutexUnlock(ctx->mutex);
+
+    /* read the key outside of the lock */
+    xmlSecBinaryKeysStoreGetEntry(ctx, pos, NULL, NULL, &data, &dataSize);
+    doc = xmlSecParseMemory(data, dataSize, 0);
+    if(doc != NULL) {
+        cur = xmlDocGetRootElement(doc);
+        if((cur != NULL) && xmlSecCheckNodeName(cur, xmlSecNodeKeyInfo, xmlSecDSigNs)) {
+            key = xmlSecSimpleKeysStoreReadKey(store, cur);
+        }
+        xmlFreeDoc(doc);
+    }
+    if((key != NULL) && (!xmlSecKeyIsValid(key))) {
+        /* we have an unknown key in our file, just ignore it */
+        xmlSecKeyDestroy(key);
+        key = NULL;
+    }
+
+    /* another thread might have read the same key */
+    xmlMutexLock(ctx->mutex);
+    if(ctx->keys[pos] != NULL) {
+        if(key != NULL) {
+            xmlSecKeyDestroy(key);
+        }
+        key = ctx->keys[pos];
+    } else if(key != NULL) {
+        ctx->keys[pos] = key;
+    } else {
+        ctx->failed[pos] = 1;
+    }
+    if(key != NULL) {
+        key = xmlSecKeyRef(key);
+    }
+    xmlMutexUnlock(ctx->mutex);
+
+    return(key);
+}
+
+static xmlSecKeyPtr
+xmlSecBinaryKeysStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecBinaryKeysStoreCtxPtr ctx;
+    const xmlSecByte* entryName;
+    xmlSecSize entryNameSize, nameSize;
+    xmlSecSize pos, low, high, mid;
+    xmlSecKeyPtr key;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecBinaryKeysStoreId), NULL);
+    xmlSecAssert2(keyInfoCtx != NULL, NULL);
+
+    ctx = xmlSecBinaryKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
+
+    if(ctx->keysSize == 0) {
+        return(NULL);
+    }
+
+    /* lookup without name: check all the keys */
+    if(name == NULL) {
+        for(pos = 0; pos < ctx->keysSize; ++pos) {
+            key = xmlSecBinaryKeysStoreGetKey(store, pos);
+            if(key == NULL) {
+                continue;
+            }
+            if(xmlSecKeyMatch(key, NULL, &(keyInfoCtx->keyReq)) == 1) {
+                return(key);
+            }
+            xmlSecKeyDestroy(key);
+        }
+        return(NULL);
+    }
+
+    /* find the first key with the name */
+    nameSize = xmlSecStrlen(name);
+    low = 0;
+    high = ctx->keysSize;
+    while(low < high) {
+        mid = low + (high - low) / 2;
+        xmlSecBinaryKeysStoreGetEntry(ctx, mid, &entryName, &entryNameSize, NULL, NULL);
+        if(xmlSecBinaryKeysFileNameCompare(entryName, entryNameSize, name, nameSize) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    for(pos = low; pos < ctx->keysSize; ++pos) {
+        xmlSecBinaryKeysStoreGetEntry(ctx, pos, &entryName, &entryNameSize, NULL, NULL);
+        if(xmlSecBinaryKeysFileNameCompare(entryName, entryNameSize, name, nameSize) != 0) {
+            break;
+        }
+        key = xmlSecBinaryKeysStoreGetKey(store, pos);
+        if(key == NULL) {
+            continue;
+        }
+        if(xmlSecKeyMatch(key, name, &(keyInfoCtx->keyReq)) == 1) {
+            /* the key is shared with the store and should not be modified */
+            return(key);
+        }
+        xmlSecKeyDestroy(key);
+    }
+    return(NULL);
+}
+
+/****************************************************************************
+ *
+ * Remote Keys Store
+ *
+ * xmlSecKeyStore + xmlSecRemoteKeysStoreCtx (fetch callback + LRU cache +
+ * in-flight fetches)
+ *
+ * The keys are fetched by name with the application callback and the
+ * recently used keys are kept in the LRU cache (the hash table + the
+ * doubly linked list from the most to the least recently used entry).
+ * The concurrent lookups of the same missing key share one fetch: the
+ * first lookup starts the fetch and the others wait for it. If the
+ * executor is set, the fetches run as the executor tasks and the waiting
+ * threads of the xmlsec threads pool run the other queued tasks instead
+ * of blocking; otherwise the first lookup fetches the key in its own
+ * thread.
+ *
+ ***************************************************************************/
+#define XMLSEC_REMOTE_KEYS_STORE_DEFAULT_CACHE_SIZE     1024
+#define XMLSEC_REMOTE_KEYS_STORE_MIN_TABLE_SIZE         16
+
+typedef struct _xmlSecRemoteKeysStoreEntry      xmlSecRemoteKeysStoreEntry, *xmlSecRemoteKeysStoreEntryPtr;
+struct _xmlSecRemoteKeysStoreEntry {
+    xmlSecRemoteKeysStoreEntryPtr       hashNext;
+    xmlSecRemoteKeysStoreEntryPtr       lruPrev;        /* more recently used */
+    xmlSecRemoteKeysStoreEntryPtr       lruNext;        /* less recently used */
+    xmlChar*                            name;
+    xmlSecSize                          hash;
+    xmlSecKeyPtr                        key;
+    time_t                              expires;        /* 0 if the entry never expires */
+};
+
+typedef struct _xmlSecRemoteKeysStoreFetch      xmlSecRemoteKeysStoreFetch, *xmlSecRemoteKeysStoreFetchPtr;
+struct _xmlSecRemoteKeysStoreFetch {
+    xmlSecRemoteKeysStoreFetchPtr       next;
+    xmlSecKeyStorePtr                   store;
+    xmlChar*                            name;
+    xmlSecSize                          hash;
+    xmlSecTaskGroupPtr                  group;          /* the executor task or NULL */
+    xmlMutexPtr                         latch;          /* locked by the fetching thread if there is no executor */
+    xmlSecKeyPtr                        key;            /* the result */
+    int                                 refCount;       /* the store + the waiting lookups */
+};
+
+typedef struct _xmlSecRemoteKeysStoreCtx {
+    xmlSecRemoteKeysStoreFetchCallback  fetch;
+    void*                               fetchCtx;
+    xmlSecExecutorPtr                   executor;
+
+    xmlMutexPtr                         mutex;          /* protects everything below */
+    xmlSecRemoteKeysStoreEntryPtr*      table;
+    xmlSecSize                          tableSize;
+    xmlSecRemoteKeysStoreEntryPtr       lruHead;
+    xmlSecRemoteKeysStoreEntryPtr       lruTail;
+    xmlSecSize                          size;
+    xmlSecSize                          maxSize;
+    unsigned int                        ttl;
+    xmlSecRemoteKeysStoreFetchPtr       fetching;       /* the fetches in progress */
+    xmlSecRemoteKeysStoreFetchPtr       completed;      /* the completed executor fetches to release */
+} xmlSecRemoteKeysStoreCtx, *xmlSecRemoteKeysStoreCtxPtr;
+
+XMLSEC_KEY_STORE_DECLARE(RemoteKeysStore, xmlSecRemoteKeysStoreCtx)
+#define xmlSecRemoteKeysStoreSize XMLSEC_KEY_STORE_SIZE(RemoteKeysStore)
+
+static int                      xmlSecRemoteKeysStoreInitialize (xmlSecKeyStorePtr store);
+static void                     xmlSecRemoteKeysStoreFinalize   (xmlSecKeyStorePtr store);
+static xmlSecKeyPtr             xmlSecRemoteKeysStoreFindKey    (xmlSecKeyStorePtr store,
+                                                                 const xmlChar* name,
+                                                                 xmlSecKeyInfoCtxPtr keyInfoCtx);
+
+static xmlSecKeyStoreKlass xmlSecRemoteKeysStoreKlass = {
+    sizeof(xmlSecKeyStoreKlass),
+    xmlSecRemoteKeysStoreSize,
+
+    /* data */
+    BAD_CAST "remote-keys-store",               /* const xmlChar* name; */
+
+    /* constructors/destructor */
+    xmlSecRemoteKeysStoreInitialize,            /* xmlSecKeyStoreInitializeMethod initialize; */
+    xmlSecRemoteKeysStoreFinalize,              /* xmlSecKeyStoreFinalizeMethod finalize; */
+    xmlSecRemoteKeysStoreFindKey,               /* xmlSecKeyStoreFindKeyMethod findKey; */
+    NULL,                                       /* xmlSecKeyStoreFindKeyFromX509DataMethod findKeyFromX509Data; */
+
+    /* reserved for the future */
+    NULL,                                       /* void* reserved0; */
+};
+
+/**
+ * xmlSecRemoteKeysStoreGetKlass:
+ *
+ * The remote keys store klass: the keys store that fetches the keys by
+ * name with the application callback (see #xmlSecRemoteKeysStoreSetFetchCallback)
+ * and caches the recently used keys.
+ *
+ * Returns: remote keys store klass.
+ */
+xmlSecKeyStoreId
+xmlSecRemoteKeysStoreGetKlass(void) {
+    return(&xmlSecRemoteKeysStoreKlass);
+}
+
+static void
+xmlSecRemoteKeysStoreEntryDestroy(xmlSecRemoteKeysStoreEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->key != NULL) {
+        xmlSecKeyDestroy(entry->key);
+    }
+    if(entry->name != NULL) {
+        xmlFree(entry->name);
+    }
+    xmlFree(entry);
+}
+
+/* the caller holds the store mutex */
+static void
+xmlSecRemoteKeysStoreCacheUnlink(xmlSecRemoteKeysStoreCtxPtr ctx, xmlSecRemoteKeysStoreEntryPtr entry) {
+    xmlSecRemoteKeysStoreEntryPtr* cur;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->table != NULL);
+    xmlSecAssert(entry != NULL);
+
+    for(cur = &(ctx->table[entry->hash & (ctx->tableSize - 1)]); (*cur) != NULL; cur = &((*cur)->hashNext)) {
+        if((*cur) == entry) {
+            (*cur) = entry->hashNext;
+            break;
+        }
+    }
+    if(entry->lruPrev != NULL) {
+        entry->lruPrev->lruNext = entry->lruNext;
+    } else {
+        ctx->lruHead = entry->lruNext;
+    }
+    if(entry->lruNext != NULL) {
+        entry->lruNext->lruPrev = entry->lruPrev;
+    } else {
+        ctx->lruTail = entry->lruPrev;
+    }
+    entry->hashNext = entry->lruPrev = entry->lruNext = NULL;
+
+    xmlSecAssert(ctx->size > 0);
+    --ctx->size;
+}
+
+/* the caller holds the store mutex */
+static void
+xmlSecRemoteKeysStoreCachePushFront(xmlSecRemoteKeysStoreCtxPtr ctx, xmlSecRemoteKeysStoreEntryPtr entry) {
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(entry != NULL);
+
+    entry->lruPrev = NULL;
+    entry->lruNext = ctx->lruHead;
+    if(ctx->lruHead != NULL) {
+        ctx->lruHead->lruPrev = entry;
+    } else {
+        ctx->lruTail = entry;
+    }
+    ctx->lruHead = entry;
+}
+
+/* the caller holds the store mutex */
+static void
+xmlSecRemoteKeysStoreCacheFlush(xmlSecRemoteKeysStoreCtxPtr ctx) {
+    xmlSecRemoteKeysStoreEntryPtr entry;
+
+    xmlSecAssert(ctx != NULL);
+
+    while(ctx->lruTail != NULL) {
+        entry = ctx->lruTail;
+        xmlSecRemoteKeysStoreCacheUnlink(ctx, entry);
+        xmlSecRemoteKeysStoreEntryDestroy(entry);
+    }
+}
+
+/* the caller holds the store mutex; returns the entry moved to the LRU list head or NULL */
+static xmlSecRemoteKeysStoreEntryPtr
+xmlSecRemoteKeysStoreCacheFind(xmlSecRemoteKeysStoreCtxPtr ctx, const xmlChar* name, xmlSecSize hash) {
+    xmlSecRemoteKeysStoreEntryPtr entry;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(name != NULL, NULL);
+
+    if(ctx->table == NULL) {
+        return(NULL);
+    }
+    for(entry = ctx->table[hash & (ctx->tableSize - 1)]; entry != NULL; entry = entry->hashNext) {
+        if((entry->hash == hash) && xmlStrEqual(entry->name, name)) {
+            break;
+        }
+    }
+    if(entry == NULL) {
+        return(NULL);
+    }
+    if((entry->expires != 0) && (time(NULL) >= entry->expires)) {
+        xmlSecRemoteKeysStoreCacheUnlink(ctx, entry);
+        xmlSecRemoteKeysStoreEntryDestroy(entry);
+        return(NULL);
+    }
+    if(entry != ctx->lruHead) {
+        /* unlink from the LRU list only: the hash chain stays the same */
+        entry->lruPrev->lruNext = entry->lruNext;
+        if(entry->lruNext != NULL) {
+            entry->lruNext->lruPrev = entry->lruPrev;
+        } else {
+            ctx->lruTail = entry->lruPrev;
+        }
+        xmlSecRemoteKeysStoreCachePushFront(ctx, entry);
+    }
+    return(entry);
+}
+
+/* the caller holds the store mutex; the key is shared with the cache */
+static int
+xmlSecRemoteKeysStoreCacheAdd(xmlSecRemoteKeysStoreCtxPtr ctx, const xmlChar* name, xmlSecSize hash, xmlSecKeyPtr key) {
+    xmlSecRemoteKeysStoreEntryPtr entry;
+    xmlSecSize pos;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(name != NULL, -1);
+    xmlSecAssert2(key != NULL, -1);
+
+    if((ctx->table == NULL) || (ctx->maxSize <= 0)) {
+        return(0);
+    }
+
+    entry = xmlSecRemoteKeysStoreCacheFind(ctx, name, hash);
+    if(entry != NULL) {
+        /* removed and re-fetched while the fetch was in progress */
+        xmlSecKeyDestroy(entry->key);
+        entry->key = xmlSecKeyRef(key);
+    } else {
+        entry = (xmlSecRemoteKeysStoreEntryPtr)xmlMalloc(sizeof(xmlSecRemoteKeysStoreEntry));
+        if(entry == NULL) {
+            xmlSecMallocError(sizeof(xmlSecRemoteKeysStoreEntry), NULL);
+            return(-1);
+        }
+        memset(entry, 0, sizeof(xmlSecRemoteKeysStoreEntry));
+        entry->name = xmlStrdup(name);
+        if(entry->name == NULL) {
+            xmlSecStrdupError(name, NULL);
+            xmlFree(entry);
+            return(-1);
+        }
+        entry->hash = hash;
+        entry->key = xmlSecKeyRef(key);
+
+        pos = hash & (ctx->tableSize - 1);
+        entry->hashNext = ctx->table[pos];
+        ctx->table[pos] = entry;
+        xmlSecRemoteKeysStoreCachePushFront(ctx, entry);
+        ++ctx->size;
+    }
+    entry->expires = (ctx->ttl > 0) ? (time(NULL) + (time_t)ctx->ttl) : 0;
+
+    /* evict the least recently used keys */
+    while(ctx->size > ctx->maxSize) {
+        entry = ctx->lruTail;
+        xmlSecRemoteKeysStoreCacheUnlink(ctx, entry);
+        xmlSecRemoteKeysStoreEntryDestroy(entry);
+    }
+    return(0);
+}
+
+static void
+xmlSecRemoteKeysStoreFetchDestroy(xmlSecRemoteKeysStoreFetchPtr fetch) {
+    xmlSecAssert(fetch != NULL);
+
+    if(fetch->key != NULL) {
+        xmlSecKeyDestroy(fetch->key);
+    }
+    if(fetch->group != NULL) {
+        xmlSecTaskGroupDestroy(fetch->group);
+    }
+    if(fetch->latch != NULL) {
+        xmlFreeMutex(fetch->latch);
+    }
+    if(fetch->name != NULL) {
+        xmlFree(fetch->name);
+    }
+    xmlFree(fetch);
+}
+
+/* the caller holds the store mutex; the latch is locked if there is no executor */
+static xmlSecRemoteKeysStoreFetchPtr
+xmlSecRemoteKeysStoreFetchCreate(xmlSecKeyStorePtr store, xmlSecRemoteKeysStoreCtxPtr ctx, const xmlChar* name, xmlSecSize hash) {
+    xmlSecRemoteKeysStoreFetchPtr fetch;
+
+    xmlSecAssert2(store != NULL, NULL);
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(name != NULL, NULL);
+
+    fetch = (xmlSecRemoteKeysStoreFetchPtr)xmlMalloc(sizeof(xmlSecRemoteKeysStoreFetch));
+    if(fetch == NULL) {
+        xmlSecMallocError(sizeof(xmlSecRemoteKeysStoreFetch), xmlSecKeyStoreGetName(store));
+        return(NULL);
+    }
+    memset(fetch, 0, sizeof(xmlSecRemoteKeysStoreFetch));
+    fetch->store = store;
+    fetch->hash = hash;
+    fetch->refCount = 1;
+
+    fetch->name = xmlStrdup(name);
+    if(fetch->name == NULL) {
+        xmlSecStrdupError(name, xmlSecKeyStoreGetName(store));
+        xmlSecRemoteKeysStoreFetchDestroy(fetch);
+        return(NULL);
+    }
+    if(ctx->executor != NULL) {
+        fetch->group = xmlSecTaskGroupCreate(ctx->executor);
+        if(fetch->group == NULL) {
+            xmlSecInternalError("xmlSecTaskGroupCreate", xmlSecKeyStoreGetName(store));
+            xmlSecRemoteKeysStoreFetchDestroy(fetch);
+            return(NULL);
+        }
+    } else {
+        fetch->latch = xmlNewMutex();
+        if(fetch->latch == NULL) {
+            xmlSecXmlError("xmlNewMutex", xmlSecKeyStoreGetName(store));
+            xmlSecRemoteKeysStoreFetchDestroy(fetch);
+            return(NULL);
+        }
+        xmlMutexLock(fetch->latch);
+    }
+
+    fetch->next = ctx->fetching;
+    ctx->fetching = fetch;
+    return(fetch);
+}
+
+static void
+xmlSecRemoteKeysStoreFetchRelease(xmlSecRemoteKeysStoreCtxPtr ctx, xmlSecRemoteKeysStoreFetchPtr fetch) {
+    int refCount;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(fetch != NULL);
+
+    xmlMutexLock(ctx->mutex);
+    xmlSecAssert(fetch->refCount > 0);
+    refCount = --fetch->refCount;
+    xmlMutexUnlock(ctx->mutex);
+
+    if(refCount == 0) {
+        xmlSecRemoteKeysStoreFetchDestroy(fetch);
+    }
+}
+
+/* runs the fetch callback, caches the key and completes the fetch */
+static void
+xmlSecRemoteKeysStoreFetchRun(void* taskCtx) {
+    xmlSecRemoteKeysStoreFetchPtr fetch = (xmlSecRemoteKeysStoreFetchPtr)taskCtx;
+    xmlSecRemoteKeysStoreFetchPtr* cur;
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+    xmlSecKeyPtr key;
+    int ret;
+
+    xmlSecAssert(fetch != NULL);
+    xmlSecAssert(fetch->store != NULL);
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(fetch->store);
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->fetch != NULL);
+
+    key = ctx->fetch(fetch->name, ctx->fetchCtx);
+    if((key != NULL) && (xmlSecKeyGetName(key) == NULL)) {
+        ret = xmlSecKeySetName(key, fetch->name);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeySetName", xmlSecKeyStoreGetName(fetch->store));
+            xmlSecKeyDestroy(key);
+            key = NULL;
+        }
+    }
+
+    xmlMutexLock(ctx->mutex);
+    for(cur = &(ctx->fetching); (*cur) != NULL; cur = &((*cur)->next)) {
+        if((*cur) == fetch) {
+            (*cur) = fetch->next;
+            break;
+        }
+    }
+    fetch->next = NULL;
+    fetch->key = key;
+    if(key != NULL) {
+        ret = xmlSecRemoteKeysStoreCacheAdd(ctx, fetch->name, fetch->hash, key);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecRemoteKeysStoreCacheAdd", xmlSecKeyStoreGetName(fetch->store));
+            /* the waiting lookups still get the key */
+        }
+    }
+    if(fetch->group != NULL) {
+        /* the executor is done with the task group only after this function returns */
+        fetch->next = ctx->completed;
+        ctx->completed = fetch;
+    }
+    xmlMutexUnlock(ctx->mutex);
+}
+
+/* releases the completed executor fetches */
+static void
+xmlSecRemoteKeysStoreReleaseCompleted(xmlSecRemoteKeysStoreCtxPtr ctx) {
+    xmlSecRemoteKeysStoreFetchPtr fetch, next;
+
+    xmlSecAssert(ctx != NULL);
+
+    xmlMutexLock(ctx->mutex);
+    fetch = ctx->completed;
+    ctx->completed = NULL;
+    xmlMutexUnlock(ctx->mutex);
+
+    for(; fetch != NULL; fetch = next) {
+        next = fetch->next;
+        xmlSecAssert(fetch->group != NULL);
+
+        /* returns immediately unless the executor is still finishing the task */
+        if(xmlSecTaskGroupWait(fetch->group) < 0) {
+            xmlSecInternalError("xmlSecTaskGroupWait", NULL);
+        }
+        xmlSecRemoteKeysStoreFetchRelease(ctx, fetch);
+    }
+}
+
+/* starts the fetch created by xmlSecRemoteKeysStoreFetchCreate() */
+static void
+xmlSecRemoteKeysStoreFetchStart(xmlSecRemoteKeysStoreCtxPtr ctx, xmlSecRemoteKeysStoreFetchPtr fetch) {
+    int ret;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(fetch != NULL);
+
+    if(fetch->group != NULL) {
+        ret = xmlSecTaskGroupSubmit(fetch->group, xmlSecRemoteKeysStoreFetchRun, fetch);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTaskGroupSubmit", xmlSecKeyStoreGetName(fetch->store));
+            xmlSecRemoteKeysStoreFetchRun(fetch);
+        }
+    } else {
+        xmlSecRemoteKeysStoreFetchRun(fetch);
+        xmlMutexUnlock(fetch->latch);
+        xmlSecRemoteKeysStoreFetchRelease(ctx, fetch);
+    }
+}
+
+static xmlSecKeyPtr
+xmlSecRemoteKeysStoreFetchWait(xmlSecRemoteKeysStoreCtxPtr ctx, xmlSecRemoteKeysStoreFetchPtr fetch) {
+    xmlSecKeyPtr key = NULL;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(fetch != NULL, NULL);
+
+    if(fetch->group != NULL) {
+        if(xmlSecTaskGroupWait(fetch->group) < 0) {
+            xmlSecInternalError("xmlSecTaskGroupWait", xmlSecKeyStoreGetName(fetch->store));
+        }
+    } else {
+        xmlMutexLock(fetch->latch);
+        xmlMutexUnlock(fetch->latch);
+    }
+
+    xmlMutexLock(ctx->mutex);
+    if(fetch->key != NULL) {
+        key = xmlSecKeyRef(fetch->key);
+    }
+    xmlMutexUnlock(ctx->mutex);
+
+    xmlSecRemoteKeysStoreFetchRelease(ctx, fetch);
+    return(key);
+}
+
+/* the caller holds the store mutex */
+static xmlSecRemoteKeysStoreFetchPtr
+xmlSecRemoteKeysStoreFetchFind(xmlSecRemoteKeysStoreCtxPtr ctx, const xmlChar* name, xmlSecSize hash) {
+    xmlSecRemoteKeysStoreFetchPtr fetch;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(name != NULL, NULL);
+
+    for(fetch = ctx->fetching; fetch != NULL; fetch = fetch->next) {
+        if((fetch->hash == hash) && xmlStrEqual(fetch->name, name)) {
+            return(fetch);
+        }
+    }
+    return(NULL);
+}
 
 /**
- * xmlSecSimpleKeysStoreLoad:
- * @store:              the pointer to simple keys store.
- * @uri:                the filename.
- * @keysMngr:           the pointer to associated keys manager.
+ * xmlSecRemoteKeysStoreSetFetchCallback:
+ * @store:              the pointer to remote keys store.
+ * @fetch:              the fetch callback.
+ * @fetchCtx:           the context for @fetch.
  *
- * Reads keys from an XML file.
+ * Sets the function that fetches the keys from the remote source. The
+ * function should be set before the @store is used.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
 int
-xmlSecSimpleKeysStoreLoad(xmlSecKeyStorePtr store, const char *uri,
-                            xmlSecKeysMngrPtr keysMngr) {
-    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
+xmlSecRemoteKeysStoreSetFetchCallback(xmlSecKeyStorePtr store, xmlSecRemoteKeysStoreFetchCallback fetch, void* fetchCtx) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
 
-    return(xmlSecSimpleKeysStoreLoad_ex(store, uri, keysMngr,
-        xmlSecSimpleKeysStoreAdoptKey));
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId), -1);
+    xmlSecAssert2(fetch != NULL, -1);
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    ctx->fetch = fetch;
+    ctx->fetchCtx = fetchCtx;
+    return(0);
 }
 
 /**
- * xmlSecSimpleKeysStoreLoad_ex:
- * @store:              the pointer to simple keys store.
- * @uri:                the filename.
- * @keysMngr:           the pointer to associated keys manager.
- * @adoptKeyFunc:       the callback to add the key to keys manager.
+ * xmlSecRemoteKeysStoreSetExecutor:
+ * @store:              the pointer to remote keys store.
+ * @executor:           the executor or NULL.
  *
- * Reads keys from an XML file.
+ * Sets the executor for the fetches. If the @executor is set, the keys
+ * are fetched by the executor tasks, #xmlSecRemoteKeysStorePrefetch
+ * doesn't wait for the fetch to complete and the lookups running on the
+ * xmlsec threads pool run the other tasks while waiting for the keys.
+ * The executor is not owned by the @store and it must be destroyed after
+ * the @store. The executor should be set before the @store is used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecRemoteKeysStoreSetExecutor(xmlSecKeyStorePtr store, xmlSecExecutorPtr executor) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId), -1);
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->fetching == NULL, -1);
+
+    ctx->executor = executor;
+    return(0);
+}
+
+/**
+ * xmlSecRemoteKeysStoreSetCacheSize:
+ * @store:              the pointer to remote keys store.
+ * @maxSize:            the max number of the cached keys (0 disables the cache).
+ * @ttl:                the cached keys time to live in seconds (0 for no expiration).
+ *
+ * Sets the LRU cache size and the keys time to live (the default cache
+ * size is 1024 keys and the keys never expire). The cached keys are removed.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecRemoteKeysStoreSetCacheSize(xmlSecKeyStorePtr store, xmlSecSize maxSize, unsigned int ttl) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+    xmlSecRemoteKeysStoreEntryPtr* table = NULL;
+    xmlSecSize tableSize = 0;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId), -1);
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->mutex != NULL, -1);
+
+    if(maxSize > 0) {
+        /* power of 2 with the load factor <= 1 */
+        for(tableSize = XMLSEC_REMOTE_KEYS_STORE_MIN_TABLE_SIZE; tableSize < maxSize; tableSize *= 2) {
+            if(tableSize > XMLSEC_SIZE_MAX / (2 * sizeof(xmlSecRemoteKeysStoreEntryPtr))) {
+                xmlSecInvalidSizeOtherError("remote keys cache size is too big", xmlSecKeyStoreGetName(store));
+                return(-1);
+            }
+        }
+        table = (xmlSecRemoteKeysStoreEntryPtr*)xmlMalloc(sizeof(xmlSecRemoteKeysStoreEntryPtr) * tableSize);
+        if(table == NULL) {
+            xmlSecMallocError(sizeof(xmlSecRemoteKeysStoreEntryPtr) * tableSize, xmlSecKeyStoreGetName(store));
+            return(-1);
+        }
+        memset(table, 0, sizeof(xmlSecRemoteKeysStoreEntryPtr) * tableSize);
+    }
+
+    xmlMutexLock(ctx->mutex);
+    xmlSecRemoteKeysStoreCacheFlush(ctx);
+    if(ctx->table != NULL) {
+        xmlFree(ctx->table);
+    }
+    ctx->table = table;
+    ctx->tableSize = tableSize;
+    ctx->maxSize = maxSize;
+    ctx->ttl = ttl;
+    xmlMutexUnlock(ctx->mutex);
+
+    return(0);
+}
+
+/**
+ * xmlSecRemoteKeysStorePrefetch:
+ * @store:              the pointer to remote keys store.
+ * @name:               the key name.
+ *
+ * Starts fetching the key @name into the cache unless it is already
+ * cached or being fetched. If the executor is set (see
+ * #xmlSecRemoteKeysStoreSetExecutor) then the function doesn't wait for
+ * the fetch to complete, otherwise the key is fetched in the current thread.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecRemoteKeysStorePrefetch(xmlSecKeyStorePtr store, const xmlChar* name) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+    xmlSecRemoteKeysStoreFetchPtr fetch;
+    xmlSecSize hash;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId), -1);
+    xmlSecAssert2(name != NULL, -1);
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->mutex != NULL, -1);
+
+    if(ctx->fetch == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_OPERATION, xmlSecKeyStoreGetName(store),
+            "fetch callback is not set");
+        return(-1);
+    }
+    xmlSecRemoteKeysStoreReleaseCompleted(ctx);
+
+    hash = xmlSecSimpleKeysStoreIndexHash(name);
+    xmlMutexLock(ctx->mutex);
+    if((xmlSecRemoteKeysStoreCacheFind(ctx, name, hash) != NULL) ||
+       (xmlSecRemoteKeysStoreFetchFind(ctx, name, hash) != NULL))
+    {
+        xmlMutexUnlock(ctx->mutex);
+        return(0);
+    }
+    fetch = xmlSecRemoteKeysStoreFetchCreate(store, ctx, name, hash);
+    xmlMutexUnlock(ctx->mutex);
+    if(fetch == NULL) {
+        xmlSecInternalError("xmlSecRemoteKeysStoreFetchCreate", xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    xmlSecRemoteKeysStoreFetchStart(ctx, fetch);
+    return(0);
+}
+
+/**
+ * xmlSecRemoteKeysStoreRemove:
+ * @store:              the pointer to remote keys store.
+ * @name:               the key name or NULL to remove all the keys.
+ *
+ * Removes the key @name (or all the keys) from the cache, e.g. after
+ * the key was rotated. The fetches in progress are not affected.
+ */
+void
+xmlSecRemoteKeysStoreRemove(xmlSecKeyStorePtr store, const xmlChar* name) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+    xmlSecRemoteKeysStoreEntryPtr entry;
+
+    xmlSecAssert(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId));
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->mutex != NULL);
+
+    xmlMutexLock(ctx->mutex);
+    if(name == NULL) {
+        xmlSecRemoteKeysStoreCacheFlush(ctx);
+    } else {
+        entry = xmlSecRemoteKeysStoreCacheFind(ctx, name, xmlSecSimpleKeysStoreIndexHash(name));
+        if(entry != NULL) {
+            xmlSecRemoteKeysStoreCacheUnlink(ctx, entry);
+            xmlSecRemoteKeysStoreEntryDestroy(entry);
+        }
+    }
+    xmlMutexUnlock(ctx->mutex);
+}
+
+/**
+ * xmlSecRemoteKeysStoreGetSize:
+ * @store:              the pointer to remote keys store.
+ *
+ * Gets the number of the cached keys.
+ *
+ * Returns: the number of the cached keys in the @store.
+ */
+xmlSecSize
+xmlSecRemoteKeysStoreGetSize(xmlSecKeyStorePtr store) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+    xmlSecSize size;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId), 0);
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(ctx->mutex != NULL, 0);
+
+    xmlMutexLock(ctx->mutex);
+    size = ctx->size;
+    xmlMutexUnlock(ctx->mutex);
+
+    return(size);
+}
+
+static int
+xmlSecRemoteKeysStoreInitialize(xmlSecKeyStorePtr store) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId), -1);
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    memset(ctx, 0, sizeof(xmlSecRemoteKeysStoreCtx));
+
+    ctx->mutex = xmlNewMutex();
+    if(ctx->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+
+    ret = xmlSecRemoteKeysStoreSetCacheSize(store, XMLSEC_REMOTE_KEYS_STORE_DEFAULT_CACHE_SIZE, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecRemoteKeysStoreSetCacheSize", xmlSecKeyStoreGetName(store));
+        xmlFreeMutex(ctx->mutex);
+        ctx->mutex = NULL;
+        return(-1);
+    }
+
+    return(0);
+}
+
+static void
+xmlSecRemoteKeysStoreFinalize(xmlSecKeyStorePtr store) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+    xmlSecRemoteKeysStoreFetchPtr fetch;
+
+    xmlSecAssert(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId));
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->mutex != NULL) {
+        /* wait for the prefetches in progress */
+        while(1) {
+            xmlMutexLock(ctx->mutex);
+            fetch = ctx->fetching;
+            if(fetch != NULL) {
+                ++fetch->refCount;
+            }
+            xmlMutexUnlock(ctx->mutex);
+            if(fetch == NULL) {
+                break;
+            }
+            xmlSecAssert(fetch->group != NULL);
+            if(xmlSecTaskGroupWait(fetch->group) < 0) {
+                xmlSecInternalError("xmlSecTaskGroupWait", xmlSecKeyStoreGetName(store));
+            }
+            xmlSecRemoteKeysStoreFetchRelease(ctx, fetch);
+        }
+        xmlSecRemoteKeysStoreReleaseCompleted(ctx);
+
+        xmlSecRemoteKeysStoreCacheFlush(ctx);
+        xmlFreeMutex(ctx->mutex);
+    }
+    if(ctx->table != NULL) {
+        xmlFree(ctx->table);
+    }
+    memset(ctx, 0, sizeof(xmlSecRemoteKeysStoreCtx));
+}
+
+static xmlSecKeyPtr
+xmlSecRemoteKeysStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecRemoteKeysStoreCtxPtr ctx;
+    xmlSecRemoteKeysStoreEntryPtr entry;
+    xmlSecRemoteKeysStoreFetchPtr fetch;
+    xmlSecKeyPtr key = NULL;
+    xmlSecSize hash;
+    int start = 0;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecRemoteKeysStoreId), NULL);
+    xmlSecAssert2(keyInfoCtx != NULL, NULL);
+
+    ctx = xmlSecRemoteKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->mutex != NULL, NULL);
+
+    /* the remote keys are fetched by name only */
+    if((name == NULL) || (ctx->fetch == NULL)) {
+        return(NULL);
+    }
+    xmlSecRemoteKeysStoreReleaseCompleted(ctx);
+
+    hash = xmlSecSimpleKeysStoreIndexHash(name);
+    xmlMutexLock(ctx->mutex);
+    entry = xmlSecRemoteKeysStoreCacheFind(ctx, name, hash);
+    if(entry != NULL) {
+        key = xmlSecKeyRef(entry->key);
+        xmlMutexUnlock(ctx->mutex);
+        xmlSecStatsCacheLookup(xmlSecStatsCacheRemoteKey, 1);
+        goto done;
+    }
+    fetch = xmlSecRemoteKeysStoreFetchFind(ctx, name, hash);
+    if(fetch == NULL) {
+        fetch = xmlSecRemoteKeysStoreFetchCreate(store, ctx, name, hash);
+        start = 1;
+    }
+    if(fetch != NULL) {
+        /* the reference for this lookup */
+        ++fetch->refCount;
+    }
+    xmlMutexUnlock(ctx->mutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheRemoteKey, 0);
+
+    if(fetch == NULL) {
+        xmlSecInternalError("xmlSecRemoteKeysStoreFetchCreate", xmlSecKeyStoreGetName(store));
+        return(NULL);
+    }
+    if(start != 0) {
+        xmlSecRemoteKeysStoreFetchStart(ctx, fetch);
+    }
+    key = xmlSecRemoteKeysStoreFetchWait(ctx, fetch);
+
+done:
+    if((key != NULL) && (xmlSecKeyMatch(key, name, &(keyInfoCtx->keyReq)) != 1)) {
+        xmlSecKeyDestroy(key);
+        key = NULL;
+    }
+    /* the key is shared with the store and should not be modified */
+    return(key);
+}
+
+/****************************************************************************
+ *
+ * Symmetric Keys Store
+ *
+ * xmlSecKeyStore + xmlSecSymmetricKeysStoreCtx (keys arena + keys index)
+ *
+ * Each key is stored in the arena as the name (including the trailing
+ * '\0') immediately followed by the key bytes. The index is an open
+ * addressing hash table of the keys themselves (the arena offset, the name
+ * hash, the key size and the key data klass index) and the xmlSecKey
+ * objects are created only when the keys are found. Same as the simple
+ * keys store, the keys must not be added while the store is used.
+ *
+ ***************************************************************************/
+#define XMLSEC_SYMMETRIC_KEYS_STORE_MIN_TABLE_SIZE      64
+#define XMLSEC_SYMMETRIC_KEYS_STORE_MAX_IDS             255
+#define XMLSEC_SYMMETRIC_KEYS_STORE_MAX_KEY_SIZE        ((xmlSecSize)0xFFFF)
+
+typedef struct _xmlSecSymmetricKeysStoreEntry {
+    xmlSecSize                  offset;         /* the name offset + 1 or 0 if the slot is empty */
+    unsigned int                hash;
+    unsigned short              dataSize;
+    unsigned char               id;             /* the ids array index */
+} xmlSecSymmetricKeysStoreEntry, *xmlSecSymmetricKeysStoreEntryPtr;
+
+typedef struct _xmlSecSymmetricKeysStoreCtx {
+    xmlSecByte*                         arena;
+    xmlSecSize                          arenaSize;
+    xmlSecSize                          arenaMaxSize;
+
+    xmlSecSymmetricKeysStoreEntryPtr    table;
+    xmlSecSize                          tableSize;      /* power of 2 */
+    xmlSecSize                          keysSize;
+
+    xmlSecKeyDataId                     ids[XMLSEC_SYMMETRIC_KEYS_STORE_MAX_IDS];
+    xmlSecSize                          idsSize;
+} xmlSecSymmetricKeysStoreCtx, *xmlSecSymmetricKeysStoreCtxPtr;
+
+XMLSEC_KEY_STORE_DECLARE(SymmetricKeysStore, xmlSecSymmetricKeysStoreCtx)
+#define xmlSecSymmetricKeysStoreSize XMLSEC_KEY_STORE_SIZE(SymmetricKeysStore)
+
+static int                      xmlSecSymmetricKeysStoreInitialize(xmlSecKeyStorePtr store);
+static void                     xmlSecSymmetricKeysStoreFinalize(xmlSecKeyStorePtr store);
+static xmlSecKeyPtr             xmlSecSymmetricKeysStoreFindKey (xmlSecKeyStorePtr store,
+                                                                 const xmlChar* name,
+                                                                 xmlSecKeyInfoCtxPtr keyInfoCtx);
+
+static xmlSecKeyStoreKlass xmlSecSymmetricKeysStoreKlass = {
+    sizeof(xmlSecKeyStoreKlass),
+    xmlSecSymmetricKeysStoreSize,
+
+    /* data */
+    BAD_CAST "symmetric-keys-store",            /* const xmlChar* name; */
+
+    /* constructors/destructor */
+    xmlSecSymmetricKeysStoreInitialize,         /* xmlSecKeyStoreInitializeMethod initialize; */
+    xmlSecSymmetricKeysStoreFinalize,           /* xmlSecKeyStoreFinalizeMethod finalize; */
+    xmlSecSymmetricKeysStoreFindKey,            /* xmlSecKeyStoreFindKeyMethod findKey; */
+    NULL,                                       /* xmlSecKeyStoreFindKeyFromX509DataMethod findKeyFromX509Data; */
+
+    /* reserved for the future */
+    NULL,                                       /* void* reserved0; */
+};
+
+/**
+ * xmlSecSymmetricKeysStoreGetKlass:
+ *
+ * The symmetric keys store klass: the keys store that keeps the names and
+ * the values of the symmetric keys in one memory block and creates the
+ * xmlSecKey objects only for the found keys.
  *
- * Returns: 0 on success or a negative value if an error occurs.
+ * Returns: symmetric keys store klass.
  */
-int
-xmlSecSimpleKeysStoreLoad_ex(xmlSecKeyStorePtr store, const char *uri,
-                            xmlSecKeysMngrPtr keysMngr ATTRIBUTE_UNUSED,
-                            xmlSecSimpleKeysStoreAdoptKeyFunc adoptKeyFunc) {
-    xmlDocPtr doc;
-    xmlNodePtr root;
-    xmlNodePtr cur;
-    xmlSecKeyPtr key;
-    xmlSecKeyInfoCtx keyInfoCtx;
-    int ret;
+xmlSecKeyStoreId
+xmlSecSymmetricKeysStoreGetKlass(void) {
+    return(&xmlSecSymmetricKeysStoreKlass);
+}
 
-    /* don't check store ID here because it might not be simple store ID;
-     * we will check for the correct store ID in the adoptKeyFunc instead */
-    xmlSecAssert2(store != NULL, -1);
-    xmlSecAssert2(uri != NULL, -1);
-    xmlSecAssert2(adoptKeyFunc != NULL, -1);
-    UNREFERENCED_PARAMETER(keysMngr);
+static int
+xmlSecSymmetricKeysStoreArenaReserve(xmlSecSymmetricKeysStoreCtxPtr ctx, xmlSecSize size) {
+    xmlSecByte* arena;
+    xmlSecSize maxSize;
 
-    doc = xmlParseFile(uri);
-    if(doc == NULL) {
-        xmlSecXmlError2("xmlParseFile", xmlSecKeyStoreGetName(store),
-                        "uri=%s", xmlSecErrorsSafeString(uri));
+    xmlSecAssert2(ctx != NULL, -1);
+
+    if(size <= ctx->arenaMaxSize - ctx->arenaSize) {
+        return(0);
+    }
+    if(size > XMLSEC_SIZE_MAX - ctx->arenaSize) {
+        xmlSecInvalidSizeOtherError("symmetric keys arena size is too big", NULL);
         return(-1);
     }
+    maxSize = ctx->arenaSize + size;
+    if(maxSize < ctx->arenaMaxSize + ctx->arenaMaxSize / 2) {
+        maxSize = ctx->arenaMaxSize + ctx->arenaMaxSize / 2;
+    }
 
-    root = xmlDocGetRootElement(doc);
-    if((root == NULL) || (!xmlSecCheckNodeName(root, BAD_CAST "Keys", xmlSecNs))) {
-        xmlSecInvalidNodeError(root, BAD_CAST "Keys",
-            xmlSecKeyStoreGetName(store));
-        xmlFreeDoc(doc);
+    /* don't leave the copies of the keys in the freed memory */
+    arena = (xmlSecByte*)xmlMalloc(maxSize);
+    if(arena == NULL) {
+        xmlSecMallocError(maxSize, NULL);
         return(-1);
     }
+    if(ctx->arena != NULL) {
+        memcpy(arena, ctx->arena, ctx->arenaSize);
+        memset(ctx->arena, 0, ctx->arenaMaxSize);
+        xmlFree(ctx->arena);
+    }
+    ctx->arena = arena;
+    ctx->arenaMaxSize = maxSize;
+    return(0);
+}
 
-    cur = xmlSecGetNextElementNode(root->children);
-    while((cur != NULL) && xmlSecCheckNodeName(cur, xmlSecNodeKeyInfo, xmlSecDSigNs)) {
-        key = xmlSecKeyCreate();
-        if(key == NULL) {
-            xmlSecInternalError("xmlSecKeyCreate",
-                xmlSecKeyStoreGetName(store));
-            xmlFreeDoc(doc);
-            return(-1);
-        }
+/* returns the slot for the new entry with the @hash */
+static xmlSecSymmetricKeysStoreEntryPtr
+xmlSecSymmetricKeysStoreTableFindFree(xmlSecSymmetricKeysStoreEntryPtr table, xmlSecSize tableSize, unsigned int hash) {
+    xmlSecSize pos;
 
-        ret = xmlSecKeyInfoCtxInitialize(&keyInfoCtx, NULL);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecKeyInfoCtxInitialize",
-                xmlSecKeyStoreGetName(store));
-            xmlSecKeyDestroy(key);
-            xmlFreeDoc(doc);
-            return(-1);
-        }
+    xmlSecAssert2(table != NULL, NULL);
+    xmlSecAssert2(tableSize > 0, NULL);
 
-        keyInfoCtx.mode           = xmlSecKeyInfoModeRead;
-        keyInfoCtx.keysMngr       = NULL;
-        keyInfoCtx.flags          = XMLSEC_KEYINFO_FLAGS_DONT_STOP_ON_KEY_FOUND |
-                                    XMLSEC_KEYINFO_FLAGS_X509DATA_DONT_VERIFY_CERTS;
-        keyInfoCtx.keyReq.keyId   = xmlSecKeyDataIdUnknown;
-        keyInfoCtx.keyReq.keyType = xmlSecKeyDataTypeAny;
-        keyInfoCtx.keyReq.keyUsage= xmlSecKeyDataUsageAny;
+    for(pos = hash & (tableSize - 1); table[pos].offset != 0; pos = (pos + 1) & (tableSize - 1)) {
+    }
+    return(&(table[pos]));
+}
 
-        ret = xmlSecKeyInfoNodeRead(cur, key, &keyInfoCtx);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecKeyInfoNodeRead",
-                xmlSecKeyStoreGetName(store));
-            xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
-            xmlSecKeyDestroy(key);
-            xmlFreeDoc(doc);
-            return(-1);
-        }
-        xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+static int
+xmlSecSymmetricKeysStoreTableReserve(xmlSecSymmetricKeysStoreCtxPtr ctx, xmlSecSize keysNum) {
+    xmlSecSymmetricKeysStoreEntryPtr table;
+    xmlSecSize tableSize, ii;
 
-        if(xmlSecKeyIsValid(key)) {
-            ret = adoptKeyFunc(store, key);
-            if(ret < 0) {
-                xmlSecInternalError("adoptKeyFunc",
-                    xmlSecKeyStoreGetName(store));
-                xmlSecKeyDestroy(key);
-                xmlFreeDoc(doc);
-                return(-1);
-            }
-        } else {
-            /* we have an unknown key in our file, just ignore it */
-            xmlSecKeyDestroy(key);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    /* the load factor <= 3/4 */
+    if(keysNum < ctx->keysSize) {
+        keysNum = ctx->keysSize;
+    }
+    for(tableSize = XMLSEC_SYMMETRIC_KEYS_STORE_MIN_TABLE_SIZE; tableSize / 4 * 3 < keysNum; tableSize *= 2) {
+        if(tableSize > XMLSEC_SIZE_MAX / (2 * sizeof(xmlSecSymmetricKeysStoreEntry))) {
+            xmlSecInvalidSizeOtherError("symmetric keys index size is too big", NULL);
+            return(-1);
         }
-        cur = xmlSecGetNextElementNode(cur->next);
+    }
+    if(tableSize <= ctx->tableSize) {
+        return(0);
     }
 
-    if(cur != NULL) {
-        xmlSecUnexpectedNodeError(cur, xmlSecKeyStoreGetName(store));
-        xmlFreeDoc(doc);
+    table = (xmlSecSymmetricKeysStoreEntryPtr)xmlMalloc(sizeof(xmlSecSymmetricKeysStoreEntry) * tableSize);
+    if(table == NULL) {
+        xmlSecMallocError(sizeof(xmlSecSymmetricKeysStoreEntry) * tableSize, NULL);
         return(-1);
     }
-
-    xmlFreeDoc(doc);
+    memset(table, 0, sizeof(xmlSecSymmetricKeysStoreEntry) * tableSize);
+    for(ii = 0; ii < ctx->tableSize; ++ii) {
+        if(ctx->table[ii].offset != 0) {
+            (*xmlSecSymmetricKeysStoreTableFindFree(table, tableSize, ctx->table[ii].hash)) = ctx->table[ii];
+        }
+    }
+    if(ctx->table != NULL) {
+        xmlFree(ctx->table);
+    }
+    ctx->table = table;
+    ctx->tableSize = tableSize;
     return(0);
-
 }
 
 /**
- * xmlSecSimpleKeysStoreSave:
- * @store:              the pointer to simple keys store.
- * @filename:           the filename.
- * @type:               the saved keys type (public, private, ...).
+ * xmlSecSymmetricKeysStoreReserve:
+ * @store:              the pointer to symmetric keys store.
+ * @keysNum:            the expected total number of keys.
+ * @dataSize:           the expected total size of the keys names and values.
  *
- * Writes keys from @store to an XML file.
+ * Preallocates the memory for the keys to avoid the memory reallocations
+ * (and the memory overhead of the unused preallocated memory) when the
+ * number of keys to add is known in advance.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
 int
-xmlSecSimpleKeysStoreSave(xmlSecKeyStorePtr store, const char *filename, xmlSecKeyDataType type) {
-    xmlSecKeyInfoCtx keyInfoCtx;
-    xmlSecPtrListPtr list;
-    xmlSecKeyPtr key;
-    xmlSecSize i, keysSize;
-    xmlDocPtr doc;
-    xmlNodePtr cur;
-    xmlSecKeyDataPtr data;
-    xmlSecPtrListPtr idsList;
-    xmlSecKeyDataId dataId;
-    xmlSecSize idsSize, j;
+xmlSecSymmetricKeysStoreReserve(xmlSecKeyStorePtr store, xmlSecSize keysNum, xmlSecSize dataSize) {
+    xmlSecSymmetricKeysStoreCtxPtr ctx;
     int ret;
 
-    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
-    xmlSecAssert2(filename != NULL, -1);
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSymmetricKeysStoreId), -1);
 
-    list = xmlSecSimpleKeysStoreGetCtx(store);
-    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyPtrListId), -1);
+    ctx = xmlSecSymmetricKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
 
-    /* create doc */
-    doc = xmlSecCreateTree(BAD_CAST "Keys", xmlSecNs);
-    if(doc == NULL) {
-        xmlSecInternalError("xmlSecCreateTree",
-                            xmlSecKeyStoreGetName(store));
+    ret = xmlSecSymmetricKeysStoreTableReserve(ctx, keysNum);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecSymmetricKeysStoreTableReserve", xmlSecKeyStoreGetName(store));
         return(-1);
     }
-
-    idsList = xmlSecKeyDataIdsGet();
-    xmlSecAssert2(idsList != NULL, -1);
-
-    keysSize = xmlSecPtrListGetSize(list);
-    idsSize = xmlSecPtrListGetSize(idsList);
-    for(i = 0; i < keysSize; ++i) {
-        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(list, i);
-        xmlSecAssert2(key != NULL, -1);
-
-        cur = xmlSecAddChild(xmlDocGetRootElement(doc), xmlSecNodeKeyInfo, xmlSecDSigNs);
-        if(cur == NULL) {
-            xmlSecInternalError2("xmlSecAddChild",
-                                 xmlSecKeyStoreGetName(store),
-                                 "node=%s",
-                                 xmlSecErrorsSafeString(xmlSecNodeKeyInfo));
-            xmlFreeDoc(doc);
+    if(dataSize > ctx->arenaSize) {
+        ret = xmlSecSymmetricKeysStoreArenaReserve(ctx, dataSize - ctx->arenaSize);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecSymmetricKeysStoreArenaReserve", xmlSecKeyStoreGetName(store));
             return(-1);
         }
+    }
+    return(0);
+}
 
-        /* special data key name */
-        if(xmlSecKeyGetName(key) != NULL) {
-            if(xmlSecAddChild(cur, xmlSecNodeKeyName, xmlSecDSigNs) == NULL) {
-                xmlSecInternalError2("xmlSecAddChild",
-                                     xmlSecKeyStoreGetName(store),
-                                     "node=%s",
-                                     xmlSecErrorsSafeString(xmlSecNodeKeyName));
-                xmlFreeDoc(doc);
-                return(-1);
-            }
-        }
+/**
+ * xmlSecSymmetricKeysStoreAddKey:
+ * @store:              the pointer to symmetric keys store.
+ * @name:               the key name.
+ * @dataId:             the key data klass (e.g. xmlSecKeyDataHmacId).
+ * @data:               the key value.
+ * @dataSize:           the key value size (up to 65535 bytes).
+ *
+ * Adds the key @name with the value @data to the @store. The @dataId must
+ * be a symmetric key data klass that stores the key value in a buffer
+ * (HMAC, AES, DES, ...). Only the key value is stored, the found keys are
+ * created with the default usage (#xmlSecKeyUsageAny) and without validity period.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSymmetricKeysStoreAddKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyDataId dataId,
+                               const xmlSecByte* data, xmlSecSize dataSize) {
+    xmlSecSymmetricKeysStoreCtxPtr ctx;
+    xmlSecSymmetricKeysStoreEntryPtr entry;
+    xmlSecSize nameSize, id;
+    int ret;
 
-        /* create nodes for other keys data */
-        for(j = 0; j < idsSize; ++j) {
-            dataId = (xmlSecKeyDataId)xmlSecPtrListGetItem(idsList, j);
-            xmlSecAssert2(dataId != xmlSecKeyDataIdUnknown, -1);
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSymmetricKeysStoreId), -1);
+    xmlSecAssert2(name != NULL, -1);
+    xmlSecAssert2(dataId != xmlSecKeyDataIdUnknown, -1);
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(dataSize > 0, -1);
 
-            if(dataId->dataNodeName == NULL) {
-                continue;
-            }
+    ctx = xmlSecSymmetricKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
 
-            data = xmlSecKeyGetData(key, dataId);
-            if(data == NULL) {
-                continue;
-            }
+    if(dataId->objSize < xmlSecKeyDataBinarySize) {
+        xmlSecOtherError2(XMLSEC_ERRORS_R_INVALID_KEY_DATA, xmlSecKeyStoreGetName(store),
+            "key data is not a symmetric key value: klass=%s",
+            xmlSecErrorsSafeString(xmlSecKeyDataKlassGetName(dataId)));
+        return(-1);
+    }
+    if(dataSize > XMLSEC_SYMMETRIC_KEYS_STORE_MAX_KEY_SIZE) {
+        xmlSecInvalidSizeMoreThanError("Symmetric key", dataSize, XMLSEC_SYMMETRIC_KEYS_STORE_MAX_KEY_SIZE,
+            xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
 
-            if(xmlSecAddChild(cur, dataId->dataNodeName, dataId->dataNodeNs) == NULL) {
-                xmlSecInternalError2("xmlSecAddChild",
-                                     xmlSecKeyStoreGetName(store),
-                                    "node=%s", xmlSecErrorsSafeString(dataId->dataNodeName));
-                xmlFreeDoc(doc);
-                return(-1);
-            }
+    for(id = 0; (id < ctx->idsSize) && (ctx->ids[id] != dataId); ++id) {
+    }
+    if(id >= ctx->idsSize) {
+        if(ctx->idsSize >= XMLSEC_SYMMETRIC_KEYS_STORE_MAX_IDS) {
+            xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_OPERATION, xmlSecKeyStoreGetName(store),
+                "too many different key data klasses");
+            return(-1);
         }
+        ctx->ids[ctx->idsSize++] = dataId;
+    }
 
-        ret = xmlSecKeyInfoCtxInitialize(&keyInfoCtx, NULL);
+    nameSize = xmlSecStrlen(name) + 1;
+    if(dataSize > XMLSEC_SIZE_MAX - nameSize) {
+        xmlSecInvalidSizeOtherError("symmetric key name is too big", xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+    ret = xmlSecSymmetricKeysStoreArenaReserve(ctx, nameSize + dataSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecSymmetricKeysStoreArenaReserve", xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
+    if((ctx->keysSize + 1) > ctx->tableSize / 4 * 3) {
+        ret = xmlSecSymmetricKeysStoreTableReserve(ctx, 2 * (ctx->keysSize + 1));
         if(ret < 0) {
-            xmlSecInternalError("xmlSecKeyInfoCtxInitialize",
-                                xmlSecKeyStoreGetName(store));
-            xmlFreeDoc(doc);
+            xmlSecInternalError("xmlSecSymmetricKeysStoreTableReserve", xmlSecKeyStoreGetName(store));
             return(-1);
         }
+    }
 
-        keyInfoCtx.mode                 = xmlSecKeyInfoModeWrite;
-        keyInfoCtx.keyReq.keyId         = xmlSecKeyDataIdUnknown;
-        keyInfoCtx.keyReq.keyType       = type;
-        keyInfoCtx.keyReq.keyUsage      = xmlSecKeyDataUsageAny;
+    entry = xmlSecSymmetricKeysStoreTableFindFree(ctx->table, ctx->tableSize,
+        (unsigned int)xmlSecSimpleKeysStoreIndexHash(name));
+    xmlSecAssert2(entry != NULL, -1);
+    entry->offset = ctx->arenaSize + 1;
+    entry->hash = (unsigned int)xmlSecSimpleKeysStoreIndexHash(name);
+    entry->dataSize = (unsigned short)dataSize;
+    entry->id = (unsigned char)id;
 
-        /* finally write key in the node */
-        ret = xmlSecKeyInfoNodeWrite(cur, key, &keyInfoCtx);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecKeyInfoNodeWrite",
-                                xmlSecKeyStoreGetName(store));
-            xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
-            xmlFreeDoc(doc);
-            return(-1);
-        }
-        xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+    memcpy(ctx->arena + ctx->arenaSize, name, nameSize);
+    memcpy(ctx->arena + ctx->arenaSize + nameSize, data, dataSize);
+    ctx->arenaSize += nameSize + dataSize;
+    ++ctx->keysSize;
+    return(0);
+}
+
+/**
+ * xmlSecSymmetricKeysStoreAdoptKey:
+ * @store:              the pointer to symmetric keys store.
+ * @key:                the named symmetric key.
+ *
+ * Adds the name and the value of the @key to the @store (see
+ * #xmlSecSymmetricKeysStoreAddKey) and destroys the @key on success.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSymmetricKeysStoreAdoptKey(xmlSecKeyStorePtr store, xmlSecKeyPtr key) {
+    xmlSecKeyDataPtr value;
+    xmlSecBufferPtr buffer;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSymmetricKeysStoreId), -1);
+    xmlSecAssert2(key != NULL, -1);
+
+    value = xmlSecKeyGetValue(key);
+    if((xmlSecKeyGetName(key) == NULL) || (value == NULL) ||
+       ((xmlSecKeyGetType(key) & xmlSecKeyDataTypeSymmetric) == 0) ||
+       (!xmlSecKeyDataCheckSize(value, xmlSecKeyDataBinarySize)))
+    {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_KEY_DATA, xmlSecKeyStoreGetName(store),
+            "key is not a named symmetric key");
+        return(-1);
+    }
+    buffer = xmlSecKeyDataBinaryValueGetBuffer(value);
+    if((buffer == NULL) || (xmlSecBufferGetData(buffer) == NULL)) {
+        xmlSecInternalError("xmlSecKeyDataBinaryValueGetBuffer", xmlSecKeyStoreGetName(store));
+        return(-1);
     }
 
-    /* now write result */
-    ret = xmlSaveFormatFile(filename, doc, 1);
+    ret = xmlSecSymmetricKeysStoreAddKey(store, xmlSecKeyGetName(key), value->id,
+        xmlSecBufferGetData(buffer), xmlSecBufferGetSize(buffer));
     if(ret < 0) {
-        xmlSecXmlError2("xmlSaveFormatFile", xmlSecKeyStoreGetName(store),
-                        "filename=%s", xmlSecErrorsSafeString(filename));
-        xmlFreeDoc(doc);
+        xmlSecInternalError("xmlSecSymmetricKeysStoreAddKey", xmlSecKeyStoreGetName(store));
         return(-1);
     }
 
-    xmlFreeDoc(doc);
+    xmlSecKeyDestroy(key);
     return(0);
 }
 
 /**
- * xmlSecSimpleKeysStoreGetKeys:
- * @store:              the pointer to simple keys store.
+ * xmlSecSymmetricKeysStoreGetSize:
+ * @store:              the pointer to symmetric keys store.
  *
- * Gets list of keys from simple keys store.
+ * Gets the number of keys in the @store.
  *
- * Returns: pointer to the list of keys stored in the keys store or NULL
- * if an error occurs.
+ * Returns: the number of keys in the @store.
  */
-xmlSecPtrListPtr
-xmlSecSimpleKeysStoreGetKeys(xmlSecKeyStorePtr store) {
-    xmlSecPtrListPtr list;
+xmlSecSize
+xmlSecSymmetricKeysStoreGetSize(xmlSecKeyStorePtr store) {
+    xmlSecSymmetricKeysStoreCtxPtr ctx;
 
-    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), NULL);
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSymmetricKeysStoreId), 0);
 
-    list = xmlSecSimpleKeysStoreGetCtx(store);
-    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyPtrListId), NULL);
+    ctx = xmlSecSymmetricKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, 0);
 
-    return list;
+    return(ctx->keysSize);
 }
 
 static int
-xmlSecSimpleKeysStoreInitialize(xmlSecKeyStorePtr store) {
-    xmlSecPtrListPtr list;
-    int ret;
+xmlSecSymmetricKeysStoreInitialize(xmlSecKeyStorePtr store) {
+    xmlSecSymmetricKeysStoreCtxPtr ctx;
 
-    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), -1);
-
-    list = xmlSecSimpleKeysStoreGetCtx(store);
-    xmlSecAssert2(list != NULL, -1);
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSymmetricKeysStoreId), -1);
 
-    ret = xmlSecPtrListInitialize(list, xmlSecKeyPtrListId);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecPtrListInitialize(xmlSecKeyPtrListId)",
-                            xmlSecKeyStoreGetName(store));
-        return(-1);
-    }
+    ctx = xmlSecSymmetricKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    memset(ctx, 0, sizeof(xmlSecSymmetricKeysStoreCtx));
 
     return(0);
 }
 
 static void
-xmlSecSimpleKeysStoreFinalize(xmlSecKeyStorePtr store) {
-    xmlSecPtrListPtr list;
+xmlSecSymmetricKeysStoreFinalize(xmlSecKeyStorePtr store) {
+    xmlSecSymmetricKeysStoreCtxPtr ctx;
 
-    xmlSecAssert(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId));
+    xmlSecAssert(xmlSecKeyStoreCheckId(store, xmlSecSymmetricKeysStoreId));
 
-    list = xmlSecSimpleKeysStoreGetCtx(store);
-    xmlSecAssert(list != NULL);
+    ctx = xmlSecSymmetricKeysStoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
 
-    xmlSecPtrListFinalize(list);
+    if(ctx->arena != NULL) {
+        memset(ctx->arena, 0, ctx->arenaMaxSize);
+        xmlFree(ctx->arena);
+    }
+    if(ctx->table != NULL) {
+        xmlFree(ctx->table);
+    }
+    memset(ctx, 0, sizeof(xmlSecSymmetricKeysStoreCtx));
 }
 
 static xmlSecKeyPtr
-xmlSecSimpleKeysStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
-    xmlSecPtrListPtr list;
+xmlSecSymmetricKeysStoreCreateKey(xmlSecKeyStorePtr store, xmlSecSymmetricKeysStoreCtxPtr ctx,
+                                  xmlSecSymmetricKeysStoreEntryPtr entry) {
+    const xmlChar* name;
+    xmlSecKeyDataPtr value = NULL;
+    xmlSecKeyPtr key = NULL;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(entry != NULL, NULL);
+    xmlSecAssert2(entry->offset > 0, NULL);
+    xmlSecAssert2(entry->id < ctx->idsSize, NULL);
+
+    name = (const xmlChar*)(ctx->arena + entry->offset - 1);
+
+    value = xmlSecKeyDataCreate(ctx->ids[entry->id]);
+    if(value == NULL) {
+        xmlSecInternalError("xmlSecKeyDataCreate", xmlSecKeyStoreGetName(store));
+        goto error;
+    }
+    ret = xmlSecKeyDataBinaryValueSetBuffer(value, (const xmlSecByte*)name + xmlSecStrlen(name) + 1, entry->dataSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyDataBinaryValueSetBuffer", xmlSecKeyStoreGetName(store));
+        goto error;
+    }
+
+    key = xmlSecKeyCreate();
+    if(key == NULL) {
+        xmlSecInternalError("xmlSecKeyCreate", xmlSecKeyStoreGetName(store));
+        goto error;
+    }
+    ret = xmlSecKeySetValue(key, value);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeySetValue", xmlSecKeyStoreGetName(store));
+        goto error;
+    }
+    value = NULL; /* owned by key now */
+
+    ret = xmlSecKeySetName(key, name);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeySetName", xmlSecKeyStoreGetName(store));
+        goto error;
+    }
+    return(key);
+
+error:
+    if(value != NULL) {
+        xmlSecKeyDataDestroy(value);
+    }
+    if(key != NULL) {
+        xmlSecKeyDestroy(key);
+    }
+    return(NULL);
+}
+
+static xmlSecKeyPtr
+xmlSecSymmetricKeysStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKeyInfoCtxPtr keyInfoCtx) {
+    xmlSecSymmetricKeysStoreCtxPtr ctx;
+    xmlSecSymmetricKeysStoreEntryPtr entry;
+    xmlSecKeyReqPtr keyReq;
     xmlSecKeyPtr key;
-    xmlSecSize pos, size;
+    unsigned int hash;
+    xmlSecSize pos;
 
-    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSimpleKeysStoreId), NULL);
+    xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecSymmetricKeysStoreId), NULL);
     xmlSecAssert2(keyInfoCtx != NULL, NULL);
 
-    list = xmlSecSimpleKeysStoreGetCtx(store);
-    xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecKeyPtrListId), NULL);
+    ctx = xmlSecSymmetricKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
 
-    size = xmlSecPtrListGetSize(list);
-    for(pos = 0; pos < size; ++pos) {
-        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(list, pos);
-        if((key != NULL) && (xmlSecKeyMatch(key, name, &(keyInfoCtx->keyReq)) == 1)) {
-            return(xmlSecKeyDuplicate(key));
+    keyReq = &(keyInfoCtx->keyReq);
+    if((name == NULL) || (ctx->table == NULL)) {
+        return(NULL);
+    }
+    if((keyReq->keyType != xmlSecKeyDataTypeUnknown) && ((keyReq->keyType & xmlSecKeyDataTypeSymmetric) == 0)) {
+        return(NULL);
+    }
+
+    hash = (unsigned int)xmlSecSimpleKeysStoreIndexHash(name);
+    for(pos = hash & (ctx->tableSize - 1); ctx->table[pos].offset != 0; pos = (pos + 1) & (ctx->tableSize - 1)) {
+        entry = &(ctx->table[pos]);
+        if((entry->hash != hash) || !xmlStrEqual(ctx->arena + entry->offset - 1, name)) {
+            continue;
+        }
+        /* don't create the keys that can't match */
+        if((keyReq->keyId != xmlSecKeyDataIdUnknown) && (keyReq->keyId != ctx->ids[entry->id])) {
+            continue;
+        }
+
+        key = xmlSecSymmetricKeysStoreCreateKey(store, ctx, entry);
+        if(key == NULL) {
+            xmlSecInternalError("xmlSecSymmetricKeysStoreCreateKey", xmlSecKeyStoreGetName(store));
+            return(NULL);
+        }
+        if(xmlSecKeyMatch(key, name, keyReq) == 1) {
+            return(key);
         }
+        xmlSecKeyDestroy(key);
     }
     return(NULL);
 }
@@ -0,0 +1,68 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Internal header only used during the compilation,
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_KEYSMNGR_HELPERS_H__
+#define __XMLSEC_KEYSMNGR_HELPERS_H__
+
+
+#ifndef XMLSEC_PRIVATE
+#error "keysmngr_helpers.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/keysmngr.h>
+#include <xmlsec/settings.h>
+
+typedef struct _xmlSecKeysMngrUnwrapCache               xmlSecKeysMngrUnwrapCache,
+                                                        *xmlSecKeysMngrUnwrapCachePtr;
+typedef struct _xmlSecKeysMngrSessionKeyCache           xmlSecKeysMngrSessionKeyCache,
+                                                        *xmlSecKeysMngrSessionKeyCachePtr;
+typedef struct _xmlSecKeysMngrKeyInfoCache              xmlSecKeysMngrKeyInfoCache,
+                                                        *xmlSecKeysMngrKeyInfoCachePtr;
+typedef struct _xmlSecKeysMngrRetrievalCache            xmlSecKeysMngrRetrievalCache,
+                                                        *xmlSecKeysMngrRetrievalCachePtr;
+typedef struct _xmlSecKeysMngrNotFoundCache             xmlSecKeysMngrNotFoundCache,
+                                                        *xmlSecKeysMngrNotFoundCachePtr;
+typedef struct _xmlSecKeysMngrEphemeralKeys             xmlSecKeysMngrEphemeralKeys,
+                                                        *xmlSecKeysMngrEphemeralKeysPtr;
+
+/*
+ * The keys manager state that is not part of the public #xmlSecKeysMngr
+ * structure (allocated by #xmlSecKeysMngrCreate):
+ *  - unwrapCache:      the optional cache of decrypted <enc:EncryptedKey/> keys
+ *                      (see #xmlSecKeysMngrEnableUnwrapCache).
+ *  - sessionKeyCache:  the optional cache of the generated session keys
+ *                      (see #xmlSecKeysMngrEnableSessionKeyReuse).
+ *  - ephemeralKeys:    the optional pool of one-time originator keys for
+ *                      key agreement (see #xmlSecKeysMngrEnableEphemeralKeys).
+ *  - keyInfoCache:     the optional cache of the keys resolved from <dsig:KeyInfo/>
+ *                      nodes (see #xmlSecKeysMngrEnableKeyInfoCache).
+ *  - retrievalCache:   the optional cache of the external <dsig:RetrievalMethod/>
+ *                      and <dsig11:KeyInfoReference/> results
+ *                      (see #xmlSecKeysMngrEnableRetrievalCache).
+ *  - notFoundCache:    the optional cache of the key names and X509 data that
+ *                      were not found (see #xmlSecKeysMngrEnableNotFoundCache).
+ *  - settings:         the optional tuning settings, not owned
+ *                      (see #xmlSecKeysMngrSetSettings).
+ *  - parent:           the optional parent keys manager, not owned
+ *                      (see #xmlSecKeysMngrSetParent).
+ */
+struct _xmlSecKeysMngrPrivate {
+    xmlSecKeysMngrUnwrapCachePtr        unwrapCache;
+    xmlSecKeysMngrSessionKeyCachePtr    sessionKeyCache;
+    xmlSecKeysMngrEphemeralKeysPtr      ephemeralKeys;
+    xmlSecKeysMngrKeyInfoCachePtr       keyInfoCache;
+    xmlSecKeysMngrRetrievalCachePtr     retrievalCache;
+    xmlSecKeysMngrNotFoundCachePtr      notFoundCache;
+    xmlSecSettingsPtr                   settings;
+    xmlSecKeysMngrPtr                   parent;
+};
+
+#endif /* __XMLSEC_KEYSMNGR_HELPERS_H__ */
@@ -502,6 +502,16 @@ static int      xmlSecKWAesDecode                   (xmlSecKWAesId kwAesId,
                                                     xmlSecByte* out,
                                                     xmlSecSize outSize,
                                                     xmlSecSize* outWritten);
+static int      xmlSecKWAesEncodeRounds             (xmlSecKWAesId kwAesId,
+                                                    xmlSecTransformPtr transform,
+                                                    xmlSecByte** data,
+                                                    xmlSecSize dataNum,
+                                                    xmlSecSize NN);
+static int      xmlSecKWAesDecodeRounds             (xmlSecKWAesId kwAesId,
+                                                    xmlSecTransformPtr transform,
+                                                    xmlSecByte** data,
+                                                    xmlSecSize dataNum,
+                                                    xmlSecSize NN);
 
 int
 xmlSecTransformKWAesInitialize(xmlSecTransformPtr transform, xmlSecTransformKWAesCtxPtr ctx,
@@ -763,14 +773,199 @@ static const xmlSecByte xmlSecKWAesMagicBlock[XMLSEC_KW_AES_MAGIC_BLOCK_SIZE] =
     0xA6,  0xA6,  0xA6,  0xA6,  0xA6,  0xA6,  0xA6,  0xA6
 };
 
+static int
+xmlSecKWAesEncryptBlocks(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
+                         xmlSecByte* blocks, xmlSecSize blocksNum) {
+    xmlSecSize ii, outWritten;
+    int ret;
+
+    xmlSecAssert2(kwAesId != NULL, -1);
+    xmlSecAssert2(blocks != NULL, -1);
+
+    /* the backend can do them all at once */
+    if(kwAesId->encryptBlocks != NULL) {
+        ret = kwAesId->encryptBlocks(transform, blocks, blocksNum);
+        if(ret < 0) {
+            xmlSecInternalError2("kwAesId->encryptBlocks", NULL,
+                "blocksNum=" XMLSEC_SIZE_FMT, blocksNum);
+            return(-1);
+        }
+        return(0);
+    }
+
+    xmlSecAssert2(kwAesId->encrypt != NULL, -1);
+    for(ii = 0; ii < blocksNum; ++ii, blocks += XMLSEC_KW_AES_BLOCK_SIZE) {
+        outWritten = 0;
+        ret = kwAesId->encrypt(transform, blocks, XMLSEC_KW_AES_BLOCK_SIZE,
+            blocks, XMLSEC_KW_AES_BLOCK_SIZE, &outWritten);
+        if((ret < 0) || (outWritten != XMLSEC_KW_AES_BLOCK_SIZE)) {
+            xmlSecInternalError2("kwAesId->encrypt", NULL,
+                "outWritten=" XMLSEC_SIZE_FMT, outWritten);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static int
+xmlSecKWAesDecryptBlocks(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
+                         xmlSecByte* blocks, xmlSecSize blocksNum) {
+    xmlSecSize ii, outWritten;
+    int ret;
+
+    xmlSecAssert2(kwAesId != NULL, -1);
+    xmlSecAssert2(blocks != NULL, -1);
+
+    /* the backend can do them all at once */
+    if(kwAesId->decryptBlocks != NULL) {
+        ret = kwAesId->decryptBlocks(transform, blocks, blocksNum);
+        if(ret < 0) {
+            xmlSecInternalError2("kwAesId->decryptBlocks", NULL,
+                "blocksNum=" XMLSEC_SIZE_FMT, blocksNum);
+            return(-1);
+        }
+        return(0);
+    }
+
+    xmlSecAssert2(kwAesId->decrypt != NULL, -1);
+    for(ii = 0; ii < blocksNum; ++ii, blocks += XMLSEC_KW_AES_BLOCK_SIZE) {
+        outWritten = 0;
+        ret = kwAesId->decrypt(transform, blocks, XMLSEC_KW_AES_BLOCK_SIZE,
+            blocks, XMLSEC_KW_AES_BLOCK_SIZE, &outWritten);
+        if((ret < 0) || (outWritten != XMLSEC_KW_AES_BLOCK_SIZE)) {
+            xmlSecInternalError2("kwAesId->decrypt", NULL,
+                "outWritten=" XMLSEC_SIZE_FMT, outWritten);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+/* runs the wrap rounds for @dataNum keys of the same size (magic block + @NN blocks) */
+static int
+xmlSecKWAesEncodeRounds(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
+                        xmlSecByte** data, xmlSecSize dataNum, xmlSecSize NN) {
+    xmlSecByte blocks[XMLSEC_KW_AES_BATCH_SIZE * XMLSEC_KW_AES_BLOCK_SIZE];
+    xmlSecByte *block;
+    xmlSecSize ii, jj, kk, tt;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(kwAesId != NULL, -1);
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(dataNum > 0, -1);
+    xmlSecAssert2(dataNum <= XMLSEC_KW_AES_BATCH_SIZE, -1);
+    xmlSecAssert2(NN > 0, -1);
+
+    if(NN == 1) {
+        for(kk = 0; kk < dataNum; ++kk) {
+            memcpy(blocks + kk * XMLSEC_KW_AES_BLOCK_SIZE, data[kk], XMLSEC_KW_AES_BLOCK_SIZE);
+        }
+        ret = xmlSecKWAesEncryptBlocks(kwAesId, transform, blocks, dataNum);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKWAesEncryptBlocks", NULL);
+            goto done;
+        }
+        for(kk = 0; kk < dataNum; ++kk) {
+            memcpy(data[kk], blocks + kk * XMLSEC_KW_AES_BLOCK_SIZE, XMLSEC_KW_AES_BLOCK_SIZE);
+        }
+    } else {
+        for(jj = 0; jj <= 5; ++jj) {
+            for(ii = 1; ii <= NN; ++ii) {
+                tt = ii + (jj * NN);
+
+                for(kk = 0, block = blocks; kk < dataNum; ++kk, block += XMLSEC_KW_AES_BLOCK_SIZE) {
+                    memcpy(block, data[kk], 8);
+                    memcpy(block + 8, data[kk] + ii * 8, 8);
+                }
+                ret = xmlSecKWAesEncryptBlocks(kwAesId, transform, blocks, dataNum);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecKWAesEncryptBlocks", NULL);
+                    goto done;
+                }
+                for(kk = 0, block = blocks; kk < dataNum; ++kk, block += XMLSEC_KW_AES_BLOCK_SIZE) {
+                    block[7] ^=  (xmlSecByte)tt;
+                    memcpy(data[kk], block, 8);
+                    memcpy(data[kk] + ii * 8, block + 8, 8);
+                }
+            }
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    /* do not keep data in memory */
+    memset(blocks, 0, sizeof(blocks));
+    return(res);
+}
+
+/* runs the unwrap rounds for @dataNum keys of the same size (magic block + @NN blocks) */
+static int
+xmlSecKWAesDecodeRounds(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
+                        xmlSecByte** data, xmlSecSize dataNum, xmlSecSize NN) {
+    xmlSecByte blocks[XMLSEC_KW_AES_BATCH_SIZE * XMLSEC_KW_AES_BLOCK_SIZE];
+    xmlSecByte *block;
+    xmlSecSize ii, jj, kk, tt;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(kwAesId != NULL, -1);
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(dataNum > 0, -1);
+    xmlSecAssert2(dataNum <= XMLSEC_KW_AES_BATCH_SIZE, -1);
+    xmlSecAssert2(NN > 0, -1);
+
+    if(NN == 1) {
+        for(kk = 0; kk < dataNum; ++kk) {
+            memcpy(blocks + kk * XMLSEC_KW_AES_BLOCK_SIZE, data[kk], XMLSEC_KW_AES_BLOCK_SIZE);
+        }
+        ret = xmlSecKWAesDecryptBlocks(kwAesId, transform, blocks, dataNum);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKWAesDecryptBlocks", NULL);
+            goto done;
+        }
+        for(kk = 0; kk < dataNum; ++kk) {
+            memcpy(data[kk], blocks + kk * XMLSEC_KW_AES_BLOCK_SIZE, XMLSEC_KW_AES_BLOCK_SIZE);
+        }
+    } else {
+        for(jj = 6; jj > 0; --jj) {
+            for(ii = NN; ii > 0; --ii) {
+                tt = ii + ((jj - 1) * NN);
+
+                for(kk = 0, block = blocks; kk < dataNum; ++kk, block += XMLSEC_KW_AES_BLOCK_SIZE) {
+                    memcpy(block, data[kk], 8);
+                    memcpy(block + 8, data[kk] + ii * 8, 8);
+                    block[7] ^= (xmlSecByte)tt;
+                }
+                ret = xmlSecKWAesDecryptBlocks(kwAesId, transform, blocks, dataNum);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecKWAesDecryptBlocks", NULL);
+                    goto done;
+                }
+                for(kk = 0, block = blocks; kk < dataNum; ++kk, block += XMLSEC_KW_AES_BLOCK_SIZE) {
+                    memcpy(data[kk], block, 8);
+                    memcpy(data[kk] + ii * 8, block + 8, 8);
+                }
+            }
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    /* do not keep data in memory */
+    memset(blocks, 0, sizeof(blocks));
+    return(res);
+}
+
 int
 xmlSecKWAesEncode(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
                   const xmlSecByte *in, xmlSecSize inSize,
                   xmlSecByte *out, xmlSecSize outSize,
                   xmlSecSize* outWritten) {
-    xmlSecByte block[XMLSEC_KW_AES_BLOCK_SIZE];
-    xmlSecByte *p;
-    xmlSecSize NN, ii, jj, tt, outWritten2;
     int ret;
 
     xmlSecAssert2(kwAesId != NULL, -1);
@@ -791,39 +986,12 @@ xmlSecKWAesEncode(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
     }
     memcpy(out, xmlSecKWAesMagicBlock, XMLSEC_KW_AES_MAGIC_BLOCK_SIZE);
 
-    NN = (inSize / 8);
-    if(NN == 1) {
-        outWritten2 = 0;
-        ret = kwAesId->encrypt(transform, out, inSize + XMLSEC_KW_AES_MAGIC_BLOCK_SIZE,
-            out, outSize, &outWritten2);
-        if((ret < 0) || (outWritten2 != XMLSEC_KW_AES_BLOCK_SIZE)) {
-            xmlSecInternalError2("kwAesId->encrypt", NULL,
-                "outWritten2=" XMLSEC_SIZE_FMT, outWritten2);
-            return(-1);
-        }
-    } else {
-        for(jj = 0; jj <= 5; ++jj) {
-            for(ii = 1; ii <= NN; ++ii) {
-                tt = ii + (jj * NN);
-                p = out + ii * 8;
-
-                memcpy(block, out, 8);
-                memcpy(block + 8, p, 8);
-
-                outWritten2 = 0;
-                ret = kwAesId->encrypt(transform, block, sizeof(block),
-                    block, sizeof(block), &outWritten2);
-                if((ret < 0) || (outWritten2 != XMLSEC_KW_AES_BLOCK_SIZE)) {
-                    xmlSecInternalError2("kwAesId->encrypt", NULL,
-                        "outWritten2=" XMLSEC_SIZE_FMT, outWritten2);
-                    return(-1);
-                }
-                block[7] ^=  (xmlSecByte)tt;
-                memcpy(out, block, 8);
-                memcpy(p, block + 8, 8);
-            }
-        }
+    ret = xmlSecKWAesEncodeRounds(kwAesId, transform, &out, 1, inSize / 8);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKWAesEncodeRounds", NULL);
+        return(-1);
     }
+
     /* don't forget the magic block */
     (*outWritten) = inSize + XMLSEC_KW_AES_MAGIC_BLOCK_SIZE;
     return(0);
@@ -834,9 +1002,6 @@ xmlSecKWAesDecode(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
                   const xmlSecByte *in, xmlSecSize inSize,
                   xmlSecByte *out, xmlSecSize outSize,
                   xmlSecSize* outWritten) {
-    xmlSecByte block[XMLSEC_KW_AES_BLOCK_SIZE];
-    xmlSecByte *p;
-    xmlSecSize NN, ii, jj, tt, outWritten2;
     int ret;
 
     xmlSecAssert2(kwAesId != NULL, -1);
@@ -854,41 +1019,11 @@ xmlSecKWAesDecode(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
         memcpy(out, in, inSize);
     }
 
-    NN = (inSize / 8) - 1;
-    if(NN == 1) {
-        outWritten2 = 0;
-        ret = kwAesId->decrypt(transform, out, inSize,
-            out, outSize, &outWritten2);
-        if((ret < 0) || (outWritten2 != XMLSEC_KW_AES_BLOCK_SIZE)) {
-            xmlSecInternalError2("kwAesId->decrypt", NULL,
-                "outWritten2=" XMLSEC_SIZE_FMT, outWritten2);
-            return(-1);
-        }
-    } else {
-        for(jj = 6; jj > 0; --jj) {
-            for(ii = NN; ii > 0; --ii) {
-                tt = ii + ((jj - 1) * NN);
-                p = out + ii * 8;
-
-                memcpy(block, out, 8);
-                memcpy(block + 8, p, 8);
-                block[7] ^= (xmlSecByte)tt;
-
-                outWritten2 = 0;
-                ret = kwAesId->decrypt(transform, block, sizeof(block),
-                    block, sizeof(block), &outWritten2);
-                if((ret < 0) || (outWritten2 != XMLSEC_KW_AES_BLOCK_SIZE)) {
-                    xmlSecInternalError2("kwAesId->decrypt", NULL,
-                        "outWritten2=" XMLSEC_SIZE_FMT, outWritten2);
-                    return(-1);
-                }
-                memcpy(out, block, 8);
-                memcpy(p, block + 8, 8);
-            }
-        }
+    ret = xmlSecKWAesDecodeRounds(kwAesId, transform, &out, 1, (inSize / 8) - 1);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKWAesDecodeRounds", NULL);
+        return(-1);
     }
-    /* do not keep data in memory */
-    memset(block, 0, sizeof(block));
 
     /* check the output */
     if(memcmp(xmlSecKWAesMagicBlock, out, XMLSEC_KW_AES_MAGIC_BLOCK_SIZE) != 0) {
@@ -902,4 +1037,134 @@ xmlSecKWAesDecode(xmlSecKWAesId kwAesId, xmlSecTransformPtr transform,
     return(0);
 }
 
+/**
+ * xmlSecTransformKWAesExecuteBatch:
+ * @transform:          the AES KW transform with the key set.
+ * @ctx:                the AES KW transform context.
+ * @in:                 the array of input buffers (the keys to wrap or to unwrap).
+ * @out:                the array of output buffers (not the same as the @in buffers).
+ * @size:               the number of buffers in @in and @out.
+ *
+ * Wraps (encrypt operation) or unwraps (decrypt operation) all the @in
+ * buffers with the same key. The consecutive buffers of the same size are
+ * processed together: the AES KW rounds are interleaved so the backend can
+ * encrypt or decrypt one block from each of them in a single call with one
+ * key schedule. The @transform status and input/output buffers are not used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs (including
+ * an integrity check failure for any of the unwrapped keys).
+ */
+int
+xmlSecTransformKWAesExecuteBatch(xmlSecTransformPtr transform, xmlSecTransformKWAesCtxPtr ctx,
+                                 xmlSecBufferPtr* in, xmlSecBufferPtr* out, xmlSecSize size) {
+    xmlSecByte* data[XMLSEC_KW_AES_BATCH_SIZE];
+    xmlSecSize inSize, outSize, keySize, minSize, NN;
+    xmlSecSize ii, kk;
+    int encode;
+    int ret;
+
+    xmlSecAssert2(transform != NULL, -1);
+    xmlSecAssert2((transform->operation == xmlSecTransformOperationEncrypt) || (transform->operation == xmlSecTransformOperationDecrypt), -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->kwAesId != NULL, -1);
+    xmlSecAssert2(in != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    keySize = xmlSecBufferGetSize(&(ctx->keyBuffer));
+    xmlSecAssert2(keySize == ctx->keyExpectedSize, -1);
+
+    encode = (transform->operation == xmlSecTransformOperationEncrypt) ? 1 : 0;
+    minSize = (encode != 0) ? XMLSEC_KW_AES_IN_SIZE_MULTIPLY :
+        (XMLSEC_KW_AES_MAGIC_BLOCK_SIZE + XMLSEC_KW_AES_IN_SIZE_MULTIPLY);
+
+    /* check the inputs and prepare the outputs */
+    for(ii = 0; ii < size; ++ii) {
+        xmlSecAssert2(in[ii] != NULL, -1);
+        xmlSecAssert2(out[ii] != NULL, -1);
+        xmlSecAssert2(in[ii] != out[ii], -1);
+
+        inSize = xmlSecBufferGetSize(in[ii]);
+        if((inSize % XMLSEC_KW_AES_IN_SIZE_MULTIPLY) != 0) {
+            xmlSecInvalidSizeNotMultipleOfError("Input data",
+                inSize, XMLSEC_KW_AES_IN_SIZE_MULTIPLY,
+                xmlSecTransformGetName(transform));
+            return(-1);
+        }
+        if(inSize < minSize) {
+            xmlSecInvalidSizeLessThanError("Input data", inSize, minSize,
+                xmlSecTransformGetName(transform));
+            return(-1);
+        }
+
+        outSize = (encode != 0) ? (inSize + XMLSEC_KW_AES_MAGIC_BLOCK_SIZE) : inSize;
+        ret = xmlSecBufferSetMaxSize(out[ii], outSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetMaxSize",
+                                 xmlSecTransformGetName(transform),
+                                 "size=" XMLSEC_SIZE_FMT, outSize);
+            return(-1);
+        }
+        if(encode != 0) {
+            /* prepend magic block */
+            memcpy(xmlSecBufferGetData(out[ii]), xmlSecKWAesMagicBlock, XMLSEC_KW_AES_MAGIC_BLOCK_SIZE);
+            memcpy(xmlSecBufferGetData(out[ii]) + XMLSEC_KW_AES_MAGIC_BLOCK_SIZE,
+                xmlSecBufferGetData(in[ii]), inSize);
+        } else {
+            memcpy(xmlSecBufferGetData(out[ii]), xmlSecBufferGetData(in[ii]), inSize);
+        }
+        ret = xmlSecBufferSetSize(out[ii], outSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetSize",
+                                 xmlSecTransformGetName(transform),
+                                 "size=" XMLSEC_SIZE_FMT, outSize);
+            return(-1);
+        }
+    }
+
+    /* run the rounds for the consecutive outputs of the same size together */
+    for(ii = 0; ii < size; ii += kk) {
+        outSize = xmlSecBufferGetSize(out[ii]);
+        for(kk = 0; (kk < XMLSEC_KW_AES_BATCH_SIZE) && (ii + kk < size); ++kk) {
+            if(xmlSecBufferGetSize(out[ii + kk]) != outSize) {
+                break;
+            }
+            data[kk] = xmlSecBufferGetData(out[ii + kk]);
+        }
+        xmlSecAssert2(kk > 0, -1);
+
+        NN = (outSize / 8) - 1;
+        if(encode != 0) {
+            ret = xmlSecKWAesEncodeRounds(ctx->kwAesId, transform, data, kk, NN);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecKWAesEncodeRounds", xmlSecTransformGetName(transform));
+                return(-1);
+            }
+        } else {
+            ret = xmlSecKWAesDecodeRounds(ctx->kwAesId, transform, data, kk, NN);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecKWAesDecodeRounds", xmlSecTransformGetName(transform));
+                return(-1);
+            }
+        }
+    }
+
+    /* check and get rid of the magic blocks */
+    if(encode == 0) {
+        for(ii = 0; ii < size; ++ii) {
+            if(memcmp(xmlSecKWAesMagicBlock, xmlSecBufferGetData(out[ii]), XMLSEC_KW_AES_MAGIC_BLOCK_SIZE) != 0) {
+                xmlSecInvalidDataError("bad magic block", xmlSecTransformGetName(transform));
+                return(-1);
+            }
+            ret = xmlSecBufferRemoveHead(out[ii], XMLSEC_KW_AES_MAGIC_BLOCK_SIZE);
+            if(ret < 0) {
+                xmlSecInternalError2("xmlSecBufferRemoveHead",
+                                     xmlSecTransformGetName(transform),
+                                     "size=" XMLSEC_SIZE_FMT, XMLSEC_KW_AES_MAGIC_BLOCK_SIZE);
+                return(-1);
+            }
+        }
+    }
+    return(0);
+}
+
 #endif /* XMLSEC_NO_AES */
@@ -132,6 +132,7 @@ XMLSEC_EXPORT int      xmlSecTransformKWDes3Execute             (xmlSecTransform
 #define XMLSEC_KW_AES128_KEY_SIZE                   ((xmlSecSize)16)
 #define XMLSEC_KW_AES192_KEY_SIZE                   ((xmlSecSize)24)
 #define XMLSEC_KW_AES256_KEY_SIZE                   ((xmlSecSize)32)
+#define XMLSEC_KW_AES_BATCH_SIZE                    ((xmlSecSize)16)
 
 typedef int  (*xmlSecKWAesBlockEncryptMethod)       (xmlSecTransformPtr transform,
                                                      const xmlSecByte * in,
@@ -145,6 +146,12 @@ typedef int  (*xmlSecKWAesBlockDecryptMethod)       (xmlSecTransformPtr transfor
                                                      xmlSecByte * out,
                                                      xmlSecSize outSize,
                                                      xmlSecSize * outWritten);
+typedef int  (*xmlSecKWAesBlocksEncryptMethod)      (xmlSecTransformPtr transform,
+                                                     xmlSecByte * blocks,
+                                                     xmlSecSize blocksNum);
+typedef int  (*xmlSecKWAesBlocksDecryptMethod)      (xmlSecTransformPtr transform,
+                                                     xmlSecByte * blocks,
+                                                     xmlSecSize blocksNum);
 
 
 struct _xmlSecKWAesKlass {
@@ -152,6 +159,11 @@ struct _xmlSecKWAesKlass {
     xmlSecKWAesBlockEncryptMethod       encrypt;
     xmlSecKWAesBlockDecryptMethod       decrypt;
 
+    /* optional: encrypt/decrypt several independent blocks in place (ECB)
+     * with the same key schedule */
+    xmlSecKWAesBlocksEncryptMethod      encryptBlocks;
+    xmlSecKWAesBlocksDecryptMethod      decryptBlocks;
+
     /* for the future */
     void*                               reserved0;
     void*                               reserved1;
@@ -190,6 +202,11 @@ XMLSEC_EXPORT int       xmlSecTransformKWAesSetKey      (xmlSecTransformPtr tran
 XMLSEC_EXPORT int       xmlSecTransformKWAesExecute     (xmlSecTransformPtr transform,
                                                         xmlSecTransformKWAesCtxPtr ctx,
                                                         int last);
+XMLSEC_EXPORT int       xmlSecTransformKWAesExecuteBatch(xmlSecTransformPtr transform,
+                                                        xmlSecTransformKWAesCtxPtr ctx,
+                                                        xmlSecBufferPtr* in,
+                                                        xmlSecBufferPtr* out,
+                                                        xmlSecSize size);
 
 #endif /* XMLSEC_NO_AES */
 
@@ -22,12 +22,44 @@
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/list.h>
+#include <xmlsec/memstats.h>
+#include <xmlsec/settings.h>
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "list_helpers.h"
 
 static int              xmlSecPtrListEnsureSize                 (xmlSecPtrListPtr list,
                                                                  xmlSecSize size);
+static int              xmlSecPtrListMakeWritable               (xmlSecPtrListPtr list);
+static int              xmlSecPtrListShare                      (xmlSecPtrListPtr dst,
+                                                                 xmlSecPtrListPtr src);
+static void             xmlSecPtrListReleaseData                (xmlSecPtrListPtr list);
+
+/* the shared data references counter is changed from different threads
+ * (e.g. the enabled transforms lists copied by the batch workers) */
+#if defined(__GNUC__) || defined(__clang__)
+#define XMLSEC_PTR_LIST_REF_INC(ptr)    __atomic_add_fetch((ptr), 1, __ATOMIC_RELAXED)
+#define XMLSEC_PTR_LIST_REF_DEC(ptr)    __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+#define XMLSEC_PTR_LIST_REF_GET(ptr)    __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define XMLSEC_PTR_LIST_REF_SET_COUNTER(pptr, pexpected, ptr) \
+    __atomic_compare_exchange_n((pptr), (pexpected), (ptr), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#elif defined(_MSC_VER)
+#include <windows.h>
+#define XMLSEC_PTR_LIST_REF_INC(ptr)    InterlockedIncrement((volatile LONG*)(ptr))
+#define XMLSEC_PTR_LIST_REF_DEC(ptr)    InterlockedDecrement((volatile LONG*)(ptr))
+#define XMLSEC_PTR_LIST_REF_GET(ptr)    InterlockedCompareExchange((volatile LONG*)(ptr), 0, 0)
+#define XMLSEC_PTR_LIST_REF_SET_COUNTER(pptr, pexpected, ptr) \
+    (InterlockedCompareExchangePointer((PVOID volatile*)(pptr), (ptr), NULL) == NULL)
+#else /* defined(_MSC_VER) */
+#define XMLSEC_PTR_LIST_REF_INC(ptr)    (++(*(ptr)))
+#define XMLSEC_PTR_LIST_REF_DEC(ptr)    (--(*(ptr)))
+#define XMLSEC_PTR_LIST_REF_GET(ptr)    (*(ptr))
+#define XMLSEC_PTR_LIST_REF_SET_COUNTER(pptr, pexpected, ptr) \
+    (((*(pptr)) == NULL) ? ((*(pptr)) = (ptr), 1) : 0)
+#endif /* defined(__GNUC__) || defined(__clang__) */
+
+#define xmlSecPtrListIsInline(list)     ((list)->data == (list)->inlineData)
 
 static xmlSecAllocMode gAllocMode = xmlSecAllocModeDouble;
 static xmlSecSize gInitialSize = 64;
@@ -47,6 +79,27 @@ xmlSecPtrListSetDefaultAllocMode(xmlSecAllocMode defAllocMode, xmlSecSize defIni
     gInitialSize = defInitialSize;
 }
 
+/* the settings attached to the current thread take precedence over the globals */
+static xmlSecAllocMode
+xmlSecPtrListGetDefaultAllocMode(void) {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_LIST_ALLOC_MODE) != 0)) {
+        return(settings->listAllocMode);
+    }
+    return(gAllocMode);
+}
+
+static xmlSecSize
+xmlSecPtrListGetDefaultInitialSize(void) {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_LIST_ALLOC_MODE) != 0)) {
+        return(settings->listInitialSize);
+    }
+    return(gInitialSize);
+}
+
 /**
  * xmlSecPtrListCreate:
  * @id:                 the list klass.
@@ -70,11 +123,19 @@ xmlSecPtrListCreate(xmlSecPtrListId id) {
                           xmlSecPtrListKlassGetName(id));
         return(NULL);
     }
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagList, 0, sizeof(xmlSecPtrList)) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate",
+                            xmlSecPtrListKlassGetName(id));
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagList, sizeof(xmlSecPtrList), 0);
+        xmlFree(list);
+        return(NULL);
+    }
 
     ret = xmlSecPtrListInitialize(list, id);
     if(ret < 0) {
         xmlSecInternalError("xmlSecPtrListInitialize",
                             xmlSecPtrListKlassGetName(id));
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagList, sizeof(xmlSecPtrList), 0);
         xmlFree(list);
         return(NULL);
     }
@@ -92,6 +153,7 @@ void
 xmlSecPtrListDestroy(xmlSecPtrListPtr list) {
     xmlSecAssert(xmlSecPtrListIsValid(list));
     xmlSecPtrListFinalize(list);
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagList, sizeof(xmlSecPtrList), 0);
     xmlFree(list);
 }
 
@@ -112,7 +174,7 @@ xmlSecPtrListInitialize(xmlSecPtrListPtr list, xmlSecPtrListId id) {
 
     memset(list, 0, sizeof(xmlSecPtrList));
     list->id = id;
-    list->allocMode = gAllocMode;
+    list->allocMode = xmlSecPtrListGetDefaultAllocMode();
 
     return(0);
 }
@@ -152,14 +214,40 @@ xmlSecPtrListEmpty(xmlSecPtrListPtr list) {
             }
         }
     }
-    if(list->max > 0) {
-        xmlSecAssert(list->data != NULL);
+    xmlSecPtrListReleaseData(list);
+}
+
+/**
+ * xmlSecPtrListClear:
+ * @list:               the pointer to list.
+ *
+ * Removes all items from @list (if any) but, unlike #xmlSecPtrListEmpty,
+ * keeps the allocated memory for reuse.
+ */
+void
+xmlSecPtrListClear(xmlSecPtrListPtr list) {
+    xmlSecAssert(xmlSecPtrListIsValid(list));
+
+    if(list->id->destroyItem != NULL) {
+        xmlSecSize pos;
 
+        for(pos = 0; pos < list->use; ++pos) {
+            xmlSecAssert(list->data != NULL);
+            if(list->data[pos] != NULL) {
+                list->id->destroyItem(list->data[pos]);
+            }
+        }
+    }
+    if(list->sharedRefCount != NULL) {
+        /* nothing to keep: the shared data is not ours */
+        xmlSecPtrListReleaseData(list);
+        return;
+    }
+    if(list->use > 0) {
+        xmlSecAssert(list->data != NULL);
         memset(list->data, 0, sizeof(xmlSecPtr) * list->use);
-        xmlFree(list->data);
     }
-    list->max = list->use = 0;
-    list->data = NULL;
+    list->use = 0;
 }
 
 /**
@@ -169,7 +257,10 @@ xmlSecPtrListEmpty(xmlSecPtrListPtr list) {
  *
  * Copies @src list items to @dst list using #duplicateItem method
  * of the list klass. If #duplicateItem method is NULL then
- * we jsut copy pointers to items.
+ * we jsut copy pointers to items. If the list klass has neither
+ * #duplicateItem nor #destroyItem methods (e.g. the transforms or
+ * key data ids lists) and @dst is empty then @dst shares the @src
+ * items memory until one of the lists is modified.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
@@ -182,6 +273,18 @@ xmlSecPtrListCopy(xmlSecPtrListPtr dst, xmlSecPtrListPtr src) {
     xmlSecAssert2(xmlSecPtrListIsValid(src), -1);
     xmlSecAssert2(dst->id == src->id, -1);
 
+    /* the small lists are copied to the inline storage, share the big ones */
+    if((dst->use == 0) && (src->use > XMLSEC_PTR_LIST_INLINE_SIZE) &&
+       (dst->id->duplicateItem == NULL) && (dst->id->destroyItem == NULL))
+    {
+        ret = xmlSecPtrListShare(dst, src);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecPtrListShare", xmlSecPtrListGetName(src));
+            return(-1);
+        }
+        return(0);
+    }
+
     /* allocate memory */
     ret = xmlSecPtrListEnsureSize(dst, dst->use + src->use);
     if(ret < 0) {
@@ -352,10 +455,18 @@ xmlSecPtrListInsert(xmlSecPtrListPtr list, xmlSecPtr item, xmlSecSize pos) {
  */
 int
 xmlSecPtrListSet(xmlSecPtrListPtr list, xmlSecPtr item, xmlSecSize pos) {
+    int ret;
+
     xmlSecAssert2(xmlSecPtrListIsValid(list), -1);
     xmlSecAssert2(list->data != NULL, -1);
     xmlSecAssert2(pos < list->use, -1);
 
+    ret = xmlSecPtrListMakeWritable(list);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListMakeWritable", xmlSecPtrListGetName(list));
+        return(-1);
+    }
+
     if((list->id->destroyItem != NULL) && (list->data[pos] != NULL)) {
         list->id->destroyItem(list->data[pos]);
     }
@@ -374,10 +485,18 @@ xmlSecPtrListSet(xmlSecPtrListPtr list, xmlSecPtr item, xmlSecSize pos) {
  */
 int
 xmlSecPtrListRemove(xmlSecPtrListPtr list, xmlSecSize pos) {
+    int ret;
+
     xmlSecAssert2(xmlSecPtrListIsValid(list), -1);
     xmlSecAssert2(list->data != NULL, -1);
     xmlSecAssert2(pos < list->use, -1);
 
+    ret = xmlSecPtrListMakeWritable(list);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListMakeWritable", xmlSecPtrListGetName(list));
+        return(-1);
+    }
+
     if((list->id->destroyItem != NULL) && (list->data[pos] != NULL)) {
         list->id->destroyItem(list->data[pos]);
     }
@@ -400,11 +519,18 @@ xmlSecPtrListRemove(xmlSecPtrListPtr list, xmlSecSize pos) {
 xmlSecPtr
 xmlSecPtrListRemoveAndReturn(xmlSecPtrListPtr list, xmlSecSize pos) {
     xmlSecPtr res;
+    int ret;
 
     xmlSecAssert2(xmlSecPtrListIsValid(list), NULL);
     xmlSecAssert2(list->data != NULL, NULL);
     xmlSecAssert2(pos < list->use, NULL);
 
+    ret = xmlSecPtrListMakeWritable(list);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListMakeWritable", xmlSecPtrListGetName(list));
+        return(NULL);
+    }
+
     res = list->data[pos];
     list->data[pos] = NULL;
     if(pos == list->use - 1) {
@@ -469,10 +595,25 @@ static int
 xmlSecPtrListEnsureSize(xmlSecPtrListPtr list, xmlSecSize size) {
     xmlSecPtr* newData;
     xmlSecSize newSize = 0;
+    xmlSecSize minSize;
+    xmlSecSize oldSize;
+    int ret;
 
     xmlSecAssert2(xmlSecPtrListIsValid(list), -1);
 
-    if(size < list->max) {
+    ret = xmlSecPtrListMakeWritable(list);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListMakeWritable", xmlSecPtrListGetName(list));
+        return(-1);
+    }
+    if(size <= list->max) {
+        return(0);
+    }
+
+    /* most lists are small: start with the inline storage */
+    if((list->data == NULL) && (size <= XMLSEC_PTR_LIST_INLINE_SIZE)) {
+        list->data = list->inlineData;
+        list->max = XMLSEC_PTR_LIST_INLINE_SIZE;
         return(0);
     }
 
@@ -485,11 +626,12 @@ xmlSecPtrListEnsureSize(xmlSecPtrListPtr list, xmlSecSize size) {
             break;
     }
 
-    if(newSize < gInitialSize) {
-        newSize = gInitialSize;
+    minSize = xmlSecPtrListGetDefaultInitialSize();
+    if(newSize < minSize) {
+        newSize = minSize;
     }
 
-    if(list->data != NULL) {
+    if((list->data != NULL) && !xmlSecPtrListIsInline(list)) {
         newData = (xmlSecPtr*)xmlRealloc(list->data, sizeof(xmlSecPtr) * newSize);
     } else {
         newData = (xmlSecPtr*)xmlMalloc(sizeof(xmlSecPtr) * newSize);
@@ -500,12 +642,324 @@ xmlSecPtrListEnsureSize(xmlSecPtrListPtr list, xmlSecSize size) {
         return(-1);
     }
 
+    /* the inline storage is not counted in the memory stats */
+    if(xmlSecPtrListIsInline(list)) {
+        memcpy(newData, list->inlineData, sizeof(xmlSecPtr) * list->use);
+        memset(list->inlineData, 0, sizeof(list->inlineData));
+        oldSize = 0;
+    } else {
+        oldSize = list->max;
+    }
+    list->data = newData;
+    list->max = newSize;
+
+    /* the memory is owned by the list even if the limit is exceeded */
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagList, sizeof(xmlSecPtr) * oldSize, sizeof(xmlSecPtr) * newSize) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate", xmlSecPtrListGetName(list));
+        return(-1);
+    }
+    return(0);
+}
+
+/* drops the list data (the items are not destroyed) */
+static void
+xmlSecPtrListReleaseData(xmlSecPtrListPtr list) {
+    xmlSecAssert(list != NULL);
+
+    if(list->sharedRefCount != NULL) {
+        if(XMLSEC_PTR_LIST_REF_DEC(list->sharedRefCount) > 0) {
+            /* other lists still use the data */
+            list->sharedRefCount = NULL;
+            list->max = list->use = 0;
+            list->data = NULL;
+            return;
+        }
+        xmlFree(list->sharedRefCount);
+        list->sharedRefCount = NULL;
+    }
+    if(list->data != NULL) {
+        memset(list->data, 0, sizeof(xmlSecPtr) * list->use);
+        if(!xmlSecPtrListIsInline(list)) {
+            xmlSecMemStatsUpdate(xmlSecMemStatsTagList, sizeof(xmlSecPtr) * list->max, 0);
+            xmlFree(list->data);
+        }
+    }
+    list->max = list->use = 0;
+    list->data = NULL;
+}
+
+/* shares the src heap data with the empty dst list */
+static int
+xmlSecPtrListShare(xmlSecPtrListPtr dst, xmlSecPtrListPtr src) {
+    int* refCount;
+    int* expected = NULL;
+
+    xmlSecAssert2(xmlSecPtrListIsValid(dst), -1);
+    xmlSecAssert2(xmlSecPtrListIsValid(src), -1);
+    xmlSecAssert2(dst != src, -1);
+    xmlSecAssert2(dst->use == 0, -1);
+    xmlSecAssert2(src->data != NULL, -1);
+    xmlSecAssert2(!xmlSecPtrListIsInline(src), -1);
+
+    /* several threads might copy the same src list (but not modify it) */
+    if(src->sharedRefCount == NULL) {
+        refCount = (int*)xmlMalloc(sizeof(int));
+        if(refCount == NULL) {
+            xmlSecMallocError(sizeof(int), xmlSecPtrListGetName(src));
+            return(-1);
+        }
+        (*refCount) = 1;
+        if(!XMLSEC_PTR_LIST_REF_SET_COUNTER(&(src->sharedRefCount), &expected, refCount)) {
+            xmlFree(refCount);
+        }
+    }
+    XMLSEC_PTR_LIST_REF_INC(src->sharedRefCount);
+
+    xmlSecPtrListReleaseData(dst);
+    dst->sharedRefCount = src->sharedRefCount;
+    dst->data = src->data;
+    dst->use = src->use;
+    dst->max = src->max;
+    return(0);
+}
+
+/* copy-on-write: makes the list the only owner of its data */
+static int
+xmlSecPtrListMakeWritable(xmlSecPtrListPtr list) {
+    xmlSecPtr* newData;
+    xmlSecSize newSize, use;
+
+    xmlSecAssert2(list != NULL, -1);
+
+    if(list->sharedRefCount == NULL) {
+        return(0);
+    }
+    if(XMLSEC_PTR_LIST_REF_GET(list->sharedRefCount) == 1) {
+        /* the other lists are gone */
+        xmlFree(list->sharedRefCount);
+        list->sharedRefCount = NULL;
+        return(0);
+    }
+    xmlSecAssert2(list->data != NULL, -1);
+
+    newSize = list->max;
+    newData = (xmlSecPtr*)xmlMalloc(sizeof(xmlSecPtr) * newSize);
+    if(newData == NULL) {
+        xmlSecMallocError(sizeof(xmlSecPtr) * newSize, xmlSecPtrListGetName(list));
+        return(-1);
+    }
+    use = list->use;
+    memcpy(newData, list->data, sizeof(xmlSecPtr) * use);
+
+    xmlSecPtrListReleaseData(list);
     list->data = newData;
+    list->use = use;
     list->max = newSize;
 
+    /* the memory is owned by the list even if the limit is exceeded */
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagList, 0, sizeof(xmlSecPtr) * newSize) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate", xmlSecPtrListGetName(list));
+        return(-1);
+    }
     return(0);
 }
 
+/***********************************************************************
+ *
+ * pointers list index
+ *
+ **********************************************************************/
+static xmlSecSize
+xmlSecPtrListIndexHash(const xmlChar* key) {
+    xmlSecSize hash = 5381;
+
+    xmlSecAssert2(key != NULL, 0);
+
+    for(; (*key) != '\0'; ++key) {
+        hash = ((hash << 5) + hash) + (*key);
+    }
+    return(hash);
+}
+
+static void
+xmlSecPtrListIndexReset(xmlSecPtrListIndexPtr index) {
+    xmlSecAssert(index != NULL);
+
+    if(index->heads != NULL) {
+        xmlFree(index->heads);
+    }
+    if(index->tails != NULL) {
+        xmlFree(index->tails);
+    }
+    if(index->next != NULL) {
+        xmlFree(index->next);
+    }
+    index->heads = index->tails = index->next = NULL;
+    index->tableSize = index->nextSize = index->indexedSize = 0;
+}
+
+static void
+xmlSecPtrListIndexAdd(xmlSecPtrListIndexPtr index, xmlSecPtr item, xmlSecSize pos) {
+    const xmlChar* key;
+    xmlSecSize hash;
+
+    xmlSecAssert(index != NULL);
+    xmlSecAssert(index->tableSize > 0);
+    xmlSecAssert(pos < index->nextSize);
+
+    index->next[pos] = 0;
+    if(item == NULL) {
+        return;
+    }
+    key = index->getKey(item);
+    if(key == NULL) {
+        return;
+    }
+
+    hash = xmlSecPtrListIndexHash(key) & (index->tableSize - 1);
+    if(index->tails[hash] == 0) {
+        index->heads[hash] = pos + 1;
+    } else {
+        index->next[index->tails[hash] - 1] = pos + 1;
+    }
+    index->tails[hash] = pos + 1;
+}
+
+/**
+ * xmlSecPtrListIndexInitialize:
+ * @index:              the pointer to list index.
+ * @getKey:             the method to get the key of a list item.
+ *
+ * Initializes empty @index.
+ */
+void
+xmlSecPtrListIndexInitialize(xmlSecPtrListIndexPtr index, xmlSecPtrListIndexGetKeyMethod getKey) {
+    xmlSecAssert(index != NULL);
+    xmlSecAssert(getKey != NULL);
+
+    memset(index, 0, sizeof(xmlSecPtrListIndex));
+    index->getKey = getKey;
+}
+
+/**
+ * xmlSecPtrListIndexFinalize:
+ * @index:              the pointer to list index.
+ *
+ * Frees the memory allocated by @index.
+ */
+void
+xmlSecPtrListIndexFinalize(xmlSecPtrListIndexPtr index) {
+    xmlSecAssert(index != NULL);
+
+    xmlSecPtrListIndexReset(index);
+    memset(index, 0, sizeof(xmlSecPtrListIndex));
+}
+
+/**
+ * xmlSecPtrListIndexUpdate:
+ * @index:              the pointer to list index.
+ * @list:               the pointer to indexed list.
+ *
+ * Adds the items appended to @list since the last update to @index
+ * (the index is rebuilt if @list shrunk or the table is too full).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecPtrListIndexUpdate(xmlSecPtrListIndexPtr index, xmlSecPtrListPtr list) {
+    xmlSecSize size, pos, tableSize;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(index->getKey != NULL, -1);
+    xmlSecAssert2(xmlSecPtrListIsValid(list), -1);
+
+    size = xmlSecPtrListGetSize(list);
+    if(size == index->indexedSize) {
+        return(0);
+    }
+
+    /* rebuild if needed: keep the load factor below 1/2 */
+    if((size < index->indexedSize) || (size > index->nextSize) || (2 * size > index->tableSize)) {
+        xmlSecPtrListIndexReset(index);
+        if(size == 0) {
+            return(0);
+        }
+
+        for(tableSize = 16; tableSize < 4 * size; tableSize *= 2);
+        index->heads = (xmlSecSize*)xmlMalloc(sizeof(xmlSecSize) * tableSize);
+        index->tails = (xmlSecSize*)xmlMalloc(sizeof(xmlSecSize) * tableSize);
+        index->next  = (xmlSecSize*)xmlMalloc(sizeof(xmlSecSize) * tableSize);
+        if((index->heads == NULL) || (index->tails == NULL) || (index->next == NULL)) {
+            xmlSecMallocError(sizeof(xmlSecSize) * tableSize, NULL);
+            xmlSecPtrListIndexReset(index);
+            return(-1);
+        }
+        memset(index->heads, 0, sizeof(xmlSecSize) * tableSize);
+        memset(index->tails, 0, sizeof(xmlSecSize) * tableSize);
+        index->tableSize = tableSize;
+        index->nextSize  = tableSize;
+    }
+
+    for(pos = index->indexedSize; pos < size; ++pos) {
+        xmlSecPtrListIndexAdd(index, xmlSecPtrListGetItem(list, pos), pos);
+    }
+    index->indexedSize = size;
+    return(0);
+}
+
+/**
+ * xmlSecPtrListIndexIsValid:
+ * @index:              the pointer to list index.
+ * @list:               the pointer to indexed list.
+ *
+ * Checks if @index covers all the items of @list.
+ *
+ * Returns: 1 if @index can be used for lookups in @list or 0 otherwise.
+ */
+int
+xmlSecPtrListIndexIsValid(xmlSecPtrListIndexPtr index, xmlSecPtrListPtr list) {
+    xmlSecAssert2(index != NULL, 0);
+    xmlSecAssert2(list != NULL, 0);
+
+    return(((index->tableSize > 0) && (index->indexedSize == list->use)) ? 1 : 0);
+}
+
+/**
+ * xmlSecPtrListIndexFirst:
+ * @index:              the pointer to list index.
+ * @key:                the key.
+ *
+ * Gets the first item in the chain for @key.
+ *
+ * Returns: the item position + 1 or 0 if the chain is empty.
+ */
+xmlSecSize
+xmlSecPtrListIndexFirst(xmlSecPtrListIndexPtr index, const xmlChar* key) {
+    xmlSecAssert2(index != NULL, 0);
+    xmlSecAssert2(index->tableSize > 0, 0);
+    xmlSecAssert2(key != NULL, 0);
+
+    return(index->heads[xmlSecPtrListIndexHash(key) & (index->tableSize - 1)]);
+}
+
+/**
+ * xmlSecPtrListIndexNext:
+ * @index:              the pointer to list index.
+ * @pos:                the current item position + 1.
+ *
+ * Gets the next item in the chain.
+ *
+ * Returns: the next item position + 1 or 0 if the chain ended.
+ */
+xmlSecSize
+xmlSecPtrListIndexNext(xmlSecPtrListIndexPtr index, xmlSecSize pos) {
+    xmlSecAssert2(index != NULL, 0);
+    xmlSecAssert2(pos > 0, 0);
+    xmlSecAssert2(pos <= index->indexedSize, 0);
+
+    return(index->next[pos - 1]);
+}
+
 /***********************************************************************
  *
  * strings list
@@ -0,0 +1,54 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Internal header only used during the compilation,
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_LIST_HELPERS_H__
+#define __XMLSEC_LIST_HELPERS_H__
+
+
+#ifndef XMLSEC_PRIVATE
+#error "list_helpers.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/list.h>
+
+/**************************** Hash index for pointers list ********************************/
+typedef const xmlChar*  (*xmlSecPtrListIndexGetKeyMethod)       (xmlSecPtr item);
+
+/*
+ * The index over the items of an append-only list: items are chained by
+ * the key hash in the list order (the positions are stored as pos + 1,
+ * 0 marks the end of a chain). Chains may contain items with different
+ * keys, the caller has to compare the keys.
+ */
+struct _xmlSecPtrListIndex {
+    xmlSecPtrListIndexGetKeyMethod      getKey;
+    xmlSecSize*                         heads;
+    xmlSecSize*                         tails;
+    xmlSecSize*                         next;
+    xmlSecSize                          tableSize;
+    xmlSecSize                          nextSize;
+    xmlSecSize                          indexedSize;
+};
+typedef struct _xmlSecPtrListIndex xmlSecPtrListIndex, *xmlSecPtrListIndexPtr;
+
+void            xmlSecPtrListIndexInitialize    (xmlSecPtrListIndexPtr index,
+                                                 xmlSecPtrListIndexGetKeyMethod getKey);
+void            xmlSecPtrListIndexFinalize      (xmlSecPtrListIndexPtr index);
+int             xmlSecPtrListIndexUpdate        (xmlSecPtrListIndexPtr index,
+                                                 xmlSecPtrListPtr list);
+int             xmlSecPtrListIndexIsValid       (xmlSecPtrListIndexPtr index,
+                                                 xmlSecPtrListPtr list);
+xmlSecSize      xmlSecPtrListIndexFirst         (xmlSecPtrListIndexPtr index,
+                                                 const xmlChar* key);
+xmlSecSize      xmlSecPtrListIndexNext          (xmlSecPtrListIndexPtr index,
+                                                 xmlSecSize pos);
+
+#endif /* __XMLSEC_LIST_HELPERS_H__ */
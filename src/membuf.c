@@ -28,6 +28,7 @@
 #include <xmlsec/keys.h>
 #include <xmlsec/base64.h>
 #include <xmlsec/membuf.h>
+#include <xmlsec/settings.h>
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
@@ -39,9 +40,17 @@
  * xmlSecTransform + xmlSecBuffer
  *
  ****************************************************************************/
-XMLSEC_TRANSFORM_DECLARE(MemBuf, xmlSecBuffer)
+typedef struct _xmlSecTransformMemBufCtx {
+    xmlSecBuffer                buffer;
+    xmlSecTransformMemBufSink   sink;
+    void*                       sinkCtx;
+} xmlSecTransformMemBufCtx, *xmlSecTransformMemBufCtxPtr;
+
+XMLSEC_TRANSFORM_DECLARE(MemBuf, xmlSecTransformMemBufCtx)
 #define xmlSecMemBufSize XMLSEC_TRANSFORM_SIZE(MemBuf)
 
+static xmlSecSize gMemBufSpillSize = 0;
+
 static int              xmlSecTransformMemBufInitialize         (xmlSecTransformPtr transform);
 static void             xmlSecTransformMemBufFinalize           (xmlSecTransformPtr transform);
 static int              xmlSecTransformMemBufExecute            (xmlSecTransformPtr transform,
@@ -96,50 +105,117 @@ xmlSecTransformMemBufGetKlass(void) {
  */
 xmlSecBufferPtr
 xmlSecTransformMemBufGetBuffer(xmlSecTransformPtr transform) {
-    xmlSecBufferPtr buffer;
+    xmlSecTransformMemBufCtxPtr ctx;
 
     xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformMemBufId), NULL);
 
-    buffer = xmlSecMemBufGetCtx(transform);
-    xmlSecAssert2(buffer != NULL, NULL);
+    ctx = xmlSecMemBufGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, NULL);
+
+    return(&(ctx->buffer));
+}
+
+/**
+ * xmlSecTransformMemBufSetDefaultSpillSize:
+ * @spillSize:          the new default spill size or 0 to keep the data in memory.
+ *
+ * Sets the default size above which the memory buffer transforms created
+ * afterwards move the stored data (i.e. the transform results, the decrypted
+ * data and the pre-digest or pre-sign buffers) to an anonymous temporary
+ * file (see #xmlSecBufferSetSpillSize). The data is still available as a
+ * contiguous memory mapped view from #xmlSecTransformMemBufGetBuffer. The
+ * default is 0 (the data is always kept in memory). This function is not
+ * thread safe and should be called during initialization, the settings
+ * attached to the current thread override it (see #xmlSecSettings).
+ */
+void
+xmlSecTransformMemBufSetDefaultSpillSize(xmlSecSize spillSize) {
+    gMemBufSpillSize = spillSize;
+}
+
+/**
+ * xmlSecTransformMemBufGetDefaultSpillSize:
+ *
+ * Gets the memory buffer transforms spill size for the current thread
+ * (see #xmlSecTransformMemBufSetDefaultSpillSize).
+ *
+ * Returns: the spill size or 0 if the data is always kept in memory.
+ */
+xmlSecSize
+xmlSecTransformMemBufGetDefaultSpillSize(void) {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_MEMBUF_SPILL_SIZE) != 0)) {
+        return(settings->memBufSpillSize);
+    }
+    return(gMemBufSpillSize);
+}
+
+/**
+ * xmlSecTransformMemBufSetSink:
+ * @transform:          the pointer to memory buffer transform.
+ * @sink:               the sink callback or NULL to store the data in the buffer.
+ * @sinkCtx:            the context passed to @sink.
+ *
+ * Sets the callback that receives the data going through the memory buffer
+ * transform chunk by chunk instead of storing the data in the transform
+ * buffer (i.e. #xmlSecTransformMemBufGetBuffer returns an empty buffer).
+ * The sink should be set before the transform is executed.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecTransformMemBufSetSink(xmlSecTransformPtr transform, xmlSecTransformMemBufSink sink, void* sinkCtx) {
+    xmlSecTransformMemBufCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformMemBufId), -1);
+    xmlSecAssert2(transform->status == xmlSecTransformStatusNone, -1);
+
+    ctx = xmlSecMemBufGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
 
-    return(buffer);
+    ctx->sink    = sink;
+    ctx->sinkCtx = sinkCtx;
+    return(0);
 }
 
 static int
 xmlSecTransformMemBufInitialize(xmlSecTransformPtr transform) {
-    xmlSecBufferPtr buffer;
+    xmlSecTransformMemBufCtxPtr ctx;
     int ret;
 
     xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformMemBufId), -1);
 
-    buffer = xmlSecMemBufGetCtx(transform);
-    xmlSecAssert2(buffer != NULL, -1);
+    ctx = xmlSecMemBufGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
 
-    ret = xmlSecBufferInitialize(buffer, 0);
+    memset(ctx, 0, sizeof(xmlSecTransformMemBufCtx));
+    ret = xmlSecBufferInitialize(&(ctx->buffer), 0);
     if(ret < 0) {
         xmlSecInternalError("xmlSecBufferInitialize",
                             xmlSecTransformGetName(transform));
         return(-1);
     }
+    xmlSecBufferSetSpillSize(&(ctx->buffer), xmlSecTransformMemBufGetDefaultSpillSize());
     return(0);
 }
 
 static void
 xmlSecTransformMemBufFinalize(xmlSecTransformPtr transform) {
-    xmlSecBufferPtr buffer;
+    xmlSecTransformMemBufCtxPtr ctx;
 
     xmlSecAssert(xmlSecTransformCheckId(transform, xmlSecTransformMemBufId));
 
-    buffer = xmlSecMemBufGetCtx(transform);
-    xmlSecAssert(buffer != NULL);
+    ctx = xmlSecMemBufGetCtx(transform);
+    xmlSecAssert(ctx != NULL);
 
-    xmlSecBufferFinalize(xmlSecMemBufGetCtx(transform));
+    xmlSecBufferFinalize(&(ctx->buffer));
+    memset(ctx, 0, sizeof(xmlSecTransformMemBufCtx));
 }
 
 static int
 xmlSecTransformMemBufExecute(xmlSecTransformPtr transform, int last, xmlSecTransformCtxPtr transformCtx) {
-    xmlSecBufferPtr buffer;
+    xmlSecTransformMemBufCtxPtr ctx;
     xmlSecBufferPtr in, out;
     xmlSecSize inSize;
     int ret;
@@ -147,8 +223,8 @@ xmlSecTransformMemBufExecute(xmlSecTransformPtr transform, int last, xmlSecTrans
     xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformMemBufId), -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
-    buffer = xmlSecMemBufGetCtx(transform);
-    xmlSecAssert2(buffer != NULL, -1);
+    ctx = xmlSecMemBufGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
 
     in = &(transform->inBuf);
     out = &(transform->outBuf);
@@ -159,13 +235,25 @@ xmlSecTransformMemBufExecute(xmlSecTransformPtr transform, int last, xmlSecTrans
     }
 
     if(transform->status == xmlSecTransformStatusWorking) {
-        /* just copy everything from in to our buffer and out */
-        ret = xmlSecBufferAppend(buffer, xmlSecBufferGetData(in), inSize);
-        if(ret < 0) {
-            xmlSecInternalError2("xmlSecBufferAppend",
-                                 xmlSecTransformGetName(transform),
-                                 "size=" XMLSEC_SIZE_FMT, inSize);
-            return(-1);
+        /* just copy everything from in to our buffer (or sink) and out */
+        if(ctx->sink != NULL) {
+            if((inSize > 0) || (last != 0)) {
+                ret = ctx->sink(ctx->sinkCtx, xmlSecBufferGetData(in), inSize, last);
+                if(ret < 0) {
+                    xmlSecInternalError2("sink",
+                                         xmlSecTransformGetName(transform),
+                                         "size=" XMLSEC_SIZE_FMT, inSize);
+                    return(-1);
+                }
+            }
+        } else {
+            ret = xmlSecBufferAppend(&(ctx->buffer), xmlSecBufferGetData(in), inSize);
+            if(ret < 0) {
+                xmlSecInternalError2("xmlSecBufferAppend",
+                                     xmlSecTransformGetName(transform),
+                                     "size=" XMLSEC_SIZE_FMT, inSize);
+                return(-1);
+            }
         }
 
         ret = xmlSecBufferAppend(out, xmlSecBufferGetData(in), inSize);
@@ -0,0 +1,243 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Memory usage accounting.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/**
+ * SECTION:memstats
+ * @Short_description: Memory usage accounting functions.
+ * @Stability: Stable
+ *
+ * The xmlsec allocations for the buffers, lists, transforms, keys and
+ * node sets are counted in the #xmlSecMemStats object attached to the
+ * current thread. The DSig and Enc contexts attach their own stats
+ * objects for the duration of each operation.
+ */
+#include "globals.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/memstats.h>
+#include <xmlsec/errors.h>
+
+/* the stats object attached to the current thread */
+#ifdef XMLSEC_THREAD_LOCAL
+static XMLSEC_THREAD_LOCAL xmlSecMemStatsPtr gCurrentMemStats = NULL;
+#endif /* XMLSEC_THREAD_LOCAL */
+
+static const char* const gMemStatsTagNames[XMLSEC_MEMSTATS_TAGS_SIZE] = {
+    "buffer",
+    "list",
+    "transform",
+    "keys",
+    "nodeset"
+};
+
+static void
+xmlSecMemStatsCountersUpdate(xmlSecMemStatsCounters* counters, xmlSecSize oldSize, xmlSecSize newSize) {
+    xmlSecAssert(counters != NULL);
+
+    if(newSize > oldSize) {
+        counters->current += (newSize - oldSize);
+        if(counters->current > counters->peak) {
+            counters->peak = counters->current;
+        }
+        ++counters->count;
+    } else if(counters->current > (oldSize - newSize)) {
+        counters->current -= (oldSize - newSize);
+    } else {
+        /* allocated before the stats were attached */
+        counters->current = 0;
+    }
+}
+
+/**
+ * xmlSecMemStatsReset:
+ * @stats:              the pointer to memory stats object.
+ *
+ * Resets all the counters in @stats (the #limit is preserved).
+ */
+void
+xmlSecMemStatsReset(xmlSecMemStatsPtr stats) {
+    xmlSecSize limit;
+
+    xmlSecAssert(stats != NULL);
+
+    limit = stats->limit;
+    memset(stats, 0, sizeof(xmlSecMemStats));
+    stats->limit = limit;
+}
+
+/**
+ * xmlSecMemStatsAttach:
+ * @stats:              the pointer to memory stats object or NULL.
+ *
+ * Attaches @stats to the current thread: the xmlsec allocations on this
+ * thread are counted in @stats until #xmlSecMemStatsDetach is called.
+ * The allocations made on the other threads (e.g. by the references
+ * executor) are not counted. If the compiler does not support thread
+ * local variables then nothing is counted. If @stats is NULL then the
+ * currently attached stats object (if any) is kept.
+ *
+ * Returns: the previously attached stats object that should be passed
+ * to #xmlSecMemStatsDetach.
+ */
+xmlSecMemStatsPtr
+xmlSecMemStatsAttach(xmlSecMemStatsPtr stats) {
+#ifdef XMLSEC_THREAD_LOCAL
+    xmlSecMemStatsPtr prev = gCurrentMemStats;
+
+    if(stats != NULL) {
+        gCurrentMemStats = stats;
+    }
+    return(prev);
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(stats);
+    return(NULL);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecMemStatsDetach:
+ * @prev:               the stats object returned by #xmlSecMemStatsAttach.
+ *
+ * Detaches the current stats object from the current thread and
+ * restores @prev.
+ */
+void
+xmlSecMemStatsDetach(xmlSecMemStatsPtr prev) {
+#ifdef XMLSEC_THREAD_LOCAL
+    gCurrentMemStats = prev;
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(prev);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecMemStatsGetCurrent:
+ *
+ * Gets the stats object attached to the current thread.
+ *
+ * Returns: the current stats object or NULL.
+ */
+xmlSecMemStatsPtr
+xmlSecMemStatsGetCurrent(void) {
+#ifdef XMLSEC_THREAD_LOCAL
+    return(gCurrentMemStats);
+#else  /* XMLSEC_THREAD_LOCAL */
+    return(NULL);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecMemStatsUpdate:
+ * @tag:                the subsystem that made the allocation.
+ * @oldSize:            the previous allocation size (0 for new allocations).
+ * @newSize:            the new allocation size (0 for freed memory).
+ *
+ * Records the successful allocation, reallocation or free in the stats
+ * object attached to the current thread (if any). If the currently
+ * allocated memory exceeds the stats #limit then the caller should
+ * fail the operation (the memory is counted as allocated until it
+ * is freed).
+ *
+ * Returns: 0 on success or a negative value if the limit is exceeded.
+ */
+int
+xmlSecMemStatsUpdate(xmlSecMemStatsTag tag, xmlSecSize oldSize, xmlSecSize newSize) {
+#ifdef XMLSEC_THREAD_LOCAL
+    xmlSecMemStatsPtr stats = gCurrentMemStats;
+
+    if((stats == NULL) || (oldSize == newSize)) {
+        return(0);
+    }
+    xmlSecAssert2((xmlSecSize)tag < XMLSEC_MEMSTATS_TAGS_SIZE, -1);
+
+    xmlSecMemStatsCountersUpdate(&(stats->total), oldSize, newSize);
+    xmlSecMemStatsCountersUpdate(&(stats->tags[tag]), oldSize, newSize);
+    if((newSize > oldSize) && (stats->limit > 0) && (stats->total.current > stats->limit)) {
+        stats->limitExceeded = 1;
+        xmlSecOtherError3(XMLSEC_ERRORS_R_MALLOC_FAILED, NULL,
+            "memory limit exceeded: current=" XMLSEC_SIZE_FMT "; limit=" XMLSEC_SIZE_FMT,
+            stats->total.current, stats->limit);
+        return(-1);
+    }
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(tag);
+    UNREFERENCED_PARAMETER(oldSize);
+    UNREFERENCED_PARAMETER(newSize);
+#endif /* XMLSEC_THREAD_LOCAL */
+    return(0);
+}
+
+/**
+ * xmlSecMemStatsTagGetName:
+ * @tag:                the subsystem tag.
+ *
+ * Gets the name of the subsystem @tag.
+ *
+ * Returns: the name of @tag.
+ */
+const char*
+xmlSecMemStatsTagGetName(xmlSecMemStatsTag tag) {
+    if((xmlSecSize)tag >= XMLSEC_MEMSTATS_TAGS_SIZE) {
+        return("unknown");
+    }
+    return(gMemStatsTagNames[tag]);
+}
+
+/**
+ * xmlSecMemStatsDebugDump:
+ * @stats:              the pointer to memory stats object.
+ * @output:             the pointer to output FILE.
+ *
+ * Prints the memory usage counters to @output.
+ */
+void
+xmlSecMemStatsDebugDump(xmlSecMemStatsPtr stats, FILE* output) {
+    xmlSecSize ii;
+
+    xmlSecAssert(stats != NULL);
+    xmlSecAssert(output != NULL);
+
+    fprintf(output, "=== limit: " XMLSEC_SIZE_FMT "%s\n", stats->limit,
+        (stats->limitExceeded != 0) ? " (exceeded)" : "");
+    fprintf(output, "=== total: current=" XMLSEC_SIZE_FMT " peak=" XMLSEC_SIZE_FMT " count=" XMLSEC_SIZE_FMT "\n",
+        stats->total.current, stats->total.peak, stats->total.count);
+    for(ii = 0; ii < XMLSEC_MEMSTATS_TAGS_SIZE; ++ii) {
+        fprintf(output, "=== %s: current=" XMLSEC_SIZE_FMT " peak=" XMLSEC_SIZE_FMT " count=" XMLSEC_SIZE_FMT "\n",
+            gMemStatsTagNames[ii], stats->tags[ii].current, stats->tags[ii].peak, stats->tags[ii].count);
+    }
+}
+
+/**
+ * xmlSecMemStatsDebugXmlDump:
+ * @stats:              the pointer to memory stats object.
+ * @output:             the pointer to output FILE.
+ *
+ * Prints the memory usage counters to @output in XML format.
+ */
+void
+xmlSecMemStatsDebugXmlDump(xmlSecMemStatsPtr stats, FILE* output) {
+    xmlSecSize ii;
+
+    xmlSecAssert(stats != NULL);
+    xmlSecAssert(output != NULL);
+
+    fprintf(output, "<MemStats limit=\"" XMLSEC_SIZE_FMT "\" limitExceeded=\"%d\">\n",
+        stats->limit, stats->limitExceeded);
+    fprintf(output, "<Total current=\"" XMLSEC_SIZE_FMT "\" peak=\"" XMLSEC_SIZE_FMT "\" count=\"" XMLSEC_SIZE_FMT "\" />\n",
+        stats->total.current, stats->total.peak, stats->total.count);
+    for(ii = 0; ii < XMLSEC_MEMSTATS_TAGS_SIZE; ++ii) {
+        fprintf(output, "<Tag name=\"%s\" current=\"" XMLSEC_SIZE_FMT "\" peak=\"" XMLSEC_SIZE_FMT "\" count=\"" XMLSEC_SIZE_FMT "\" />\n",
+            gMemStatsTagNames[ii], stats->tags[ii].current, stats->tags[ii].peak, stats->tags[ii].count);
+    }
+    fprintf(output, "</MemStats>\n");
+}
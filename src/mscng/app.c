@@ -37,6 +37,7 @@
 #include <xmlsec/mscng/x509.h>
 
 #include "../cast_helpers.h"
+#include "../keysdata_helpers.h"
 #include "private.h"
 
 /* config info for the mscng keysstore */
@@ -771,6 +772,38 @@ xmlSecMSCngAppKeysMngrCrlLoadMemory(xmlSecKeysMngrPtr mngr, const xmlSecByte* da
     return(-1);
 }
 
+/**
+ * xmlSecMSCngAppKeysMngrEnableX509VerifyCache:
+ * @mngr:               the keys manager.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables the cache of the successful certificates verification results
+ * in the X509 store of @mngr (see #xmlSecMSCngX509StoreEnableVerifyCache).
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecMSCngAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize) {
+    xmlSecKeyDataStorePtr x509Store;
+    int ret;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    x509Store = xmlSecKeysMngrGetDataStore(mngr, xmlSecMSCngX509StoreId);
+    if(x509Store == NULL) {
+        xmlSecInternalError("xmlSecKeysMngrGetDataStore(xmlSecMSCngX509StoreId)", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecMSCngX509StoreEnableVerifyCache(x509Store, maxSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecMSCngX509StoreEnableVerifyCache", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
 
 #endif /* XMLSEC_NO_X509 */
 
@@ -847,6 +880,9 @@ xmlSecMSCngAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key)
         return(-1);
     }
 
+    /* the new key might be one of the recently not found keys */
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
+
     return(0);
 }
 
@@ -26,12 +26,15 @@
 #include <bcrypt.h>
 #include <ncrypt.h>
 
+#include <libxml/threads.h>
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/base64.h>
 #include <xmlsec/bn.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/keyinfo.h>
 #include <xmlsec/keys.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/xmltree.h>
 
@@ -42,6 +45,29 @@
 #include "../keysdata_helpers.h"
 #include "private.h"
 
+/******************************************************************************
+ *
+ * Certificates public keys cache: CryptImportPublicKeyInfoEx2() is expensive,
+ * so the public key handle imported from a certificate is shared by all the
+ * key data created or duplicated from this certificate (the certificates are
+ * identified by the SHA1 thumbprint). The shared handles are never modified
+ * and can be used from multiple threads.
+ *
+ *****************************************************************************/
+#define XMLSEC_MSCNG_CERT_PUBKEY_THUMBPRINT_SIZE        20
+#define XMLSEC_MSCNG_CERT_PUBKEYS_CACHE_SIZE            128
+
+typedef struct _xmlSecMSCngCertPubKey {
+    BYTE                thumbprint[XMLSEC_MSCNG_CERT_PUBKEY_THUMBPRINT_SIZE];
+    BCRYPT_KEY_HANDLE   hKey;
+    int                 refCount;       /* protected by gXmlSecMSCngCertPubKeysMutex */
+} xmlSecMSCngCertPubKey, *xmlSecMSCngCertPubKeyPtr;
+
+static xmlMutexPtr              gXmlSecMSCngCertPubKeysMutex = NULL;
+static xmlSecMSCngCertPubKeyPtr gXmlSecMSCngCertPubKeys[XMLSEC_MSCNG_CERT_PUBKEYS_CACHE_SIZE];
+static xmlSecSize               gXmlSecMSCngCertPubKeysSize = 0;
+static xmlSecSize               gXmlSecMSCngCertPubKeysNext = 0; /* the next entry to evict */
+
 typedef struct _xmlSecMSCngKeyDataCtx xmlSecMSCngKeyDataCtx,
                                       *xmlSecMSCngKeyDataCtxPtr;
 
@@ -49,6 +75,7 @@ struct _xmlSecMSCngKeyDataCtx {
     PCCERT_CONTEXT cert;
     NCRYPT_KEY_HANDLE privkey;
     BCRYPT_KEY_HANDLE pubkey;
+    xmlSecMSCngCertPubKeyPtr certPubKey; /* owns the pubkey if not NULL */
 };
 
 XMLSEC_KEY_DATA_DECLARE(MSCngKeyData, xmlSecMSCngKeyDataCtx)
@@ -71,6 +98,214 @@ xmlSecMSCngKeyDataCertGetPubkey(PCCERT_CONTEXT cert, BCRYPT_KEY_HANDLE* key) {
     return(0);
 }
 
+static void
+xmlSecMSCngCertPubKeyDestroy(xmlSecMSCngCertPubKeyPtr pubKey) {
+    NTSTATUS status;
+
+    xmlSecAssert(pubKey != NULL);
+
+    if(pubKey->hKey != NULL) {
+        status = BCryptDestroyKey(pubKey->hKey);
+        if(status != STATUS_SUCCESS) {
+            xmlSecMSCngNtError("BCryptDestroyKey", NULL, status);
+            /* ignore error */
+        }
+    }
+    memset(pubKey, 0, sizeof(xmlSecMSCngCertPubKey));
+    xmlFree(pubKey);
+}
+
+static void
+xmlSecMSCngCertPubKeyAddRef(xmlSecMSCngCertPubKeyPtr pubKey) {
+    xmlSecAssert(pubKey != NULL);
+
+    if(gXmlSecMSCngCertPubKeysMutex != NULL) {
+        xmlMutexLock(gXmlSecMSCngCertPubKeysMutex);
+    }
+    ++pubKey->refCount;
+    if(gXmlSecMSCngCertPubKeysMutex != NULL) {
+        xmlMutexUnlock(gXmlSecMSCngCertPubKeysMutex);
+    }
+}
+
+static void
+xmlSecMSCngCertPubKeyRelease(xmlSecMSCngCertPubKeyPtr pubKey) {
+    int destroy;
+
+    xmlSecAssert(pubKey != NULL);
+
+    if(gXmlSecMSCngCertPubKeysMutex != NULL) {
+        xmlMutexLock(gXmlSecMSCngCertPubKeysMutex);
+    }
+    --pubKey->refCount;
+    destroy = (pubKey->refCount <= 0) ? 1 : 0;
+    if(gXmlSecMSCngCertPubKeysMutex != NULL) {
+        xmlMutexUnlock(gXmlSecMSCngCertPubKeysMutex);
+    }
+
+    if(destroy != 0) {
+        xmlSecMSCngCertPubKeyDestroy(pubKey);
+    }
+}
+
+/* should be called under lock, adds the reference for the caller */
+static xmlSecMSCngCertPubKeyPtr
+xmlSecMSCngCertPubKeysCacheFind(const BYTE* thumbprint) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecMSCngCertPubKeysSize; ++ii) {
+        xmlSecMSCngCertPubKeyPtr pubKey = gXmlSecMSCngCertPubKeys[ii];
+
+        if(memcmp(pubKey->thumbprint, thumbprint, XMLSEC_MSCNG_CERT_PUBKEY_THUMBPRINT_SIZE) == 0) {
+            ++pubKey->refCount;
+            return(pubKey);
+        }
+    }
+    return(NULL);
+}
+
+/* should be called under lock, returns the evicted entry (if any) to release */
+static xmlSecMSCngCertPubKeyPtr
+xmlSecMSCngCertPubKeysCacheAdd(xmlSecMSCngCertPubKeyPtr pubKey) {
+    xmlSecMSCngCertPubKeyPtr evicted = NULL;
+
+    xmlSecAssert2(pubKey != NULL, NULL);
+
+    if(gXmlSecMSCngCertPubKeysSize < XMLSEC_MSCNG_CERT_PUBKEYS_CACHE_SIZE) {
+        gXmlSecMSCngCertPubKeys[gXmlSecMSCngCertPubKeysSize++] = pubKey;
+    } else {
+        evicted = gXmlSecMSCngCertPubKeys[gXmlSecMSCngCertPubKeysNext];
+        gXmlSecMSCngCertPubKeys[gXmlSecMSCngCertPubKeysNext] = pubKey;
+        gXmlSecMSCngCertPubKeysNext = (gXmlSecMSCngCertPubKeysNext + 1) % XMLSEC_MSCNG_CERT_PUBKEYS_CACHE_SIZE;
+    }
+    /* the cache reference */
+    ++pubKey->refCount;
+    return(evicted);
+}
+
+/* returns the shared public key for @cert, the caller owns one reference */
+static xmlSecMSCngCertPubKeyPtr
+xmlSecMSCngCertPubKeyGet(PCCERT_CONTEXT cert) {
+    BYTE thumbprint[XMLSEC_MSCNG_CERT_PUBKEY_THUMBPRINT_SIZE];
+    DWORD thumbprintLen = sizeof(thumbprint);
+    xmlSecMSCngCertPubKeyPtr pubKey;
+    xmlSecMSCngCertPubKeyPtr cached = NULL;
+    xmlSecMSCngCertPubKeyPtr evicted = NULL;
+    int ret;
+
+    xmlSecAssert2(cert != NULL, NULL);
+
+    if(!CertGetCertificateContextProperty(cert, CERT_SHA1_HASH_PROP_ID, thumbprint, &thumbprintLen)) {
+        xmlSecMSCngLastError("CertGetCertificateContextProperty(CERT_SHA1_HASH_PROP_ID)", NULL);
+        return(NULL);
+    }
+    xmlSecAssert2(thumbprintLen == sizeof(thumbprint), NULL);
+
+    if(gXmlSecMSCngCertPubKeysMutex != NULL) {
+        xmlMutexLock(gXmlSecMSCngCertPubKeysMutex);
+        cached = xmlSecMSCngCertPubKeysCacheFind(thumbprint);
+        xmlMutexUnlock(gXmlSecMSCngCertPubKeysMutex);
+
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCertPubKey, (cached != NULL) ? 1 : 0);
+        if(cached != NULL) {
+            return(cached);
+        }
+    }
+
+    /* import outside of the lock */
+    pubKey = (xmlSecMSCngCertPubKeyPtr)xmlMalloc(sizeof(xmlSecMSCngCertPubKey));
+    if(pubKey == NULL) {
+        xmlSecMallocError(sizeof(xmlSecMSCngCertPubKey), NULL);
+        return(NULL);
+    }
+    memset(pubKey, 0, sizeof(xmlSecMSCngCertPubKey));
+    memcpy(pubKey->thumbprint, thumbprint, sizeof(thumbprint));
+    pubKey->refCount = 1;
+
+    ret = xmlSecMSCngKeyDataCertGetPubkey(cert, &(pubKey->hKey));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecMSCngKeyDataCertGetPubkey", NULL);
+        xmlSecMSCngCertPubKeyDestroy(pubKey);
+        return(NULL);
+    }
+
+    if(gXmlSecMSCngCertPubKeysMutex != NULL) {
+        xmlMutexLock(gXmlSecMSCngCertPubKeysMutex);
+        cached = xmlSecMSCngCertPubKeysCacheFind(thumbprint);
+        if(cached == NULL) {
+            evicted = xmlSecMSCngCertPubKeysCacheAdd(pubKey);
+        }
+        xmlMutexUnlock(gXmlSecMSCngCertPubKeysMutex);
+
+        if(evicted != NULL) {
+            xmlSecMSCngCertPubKeyRelease(evicted);
+        }
+
+        /* another thread was faster */
+        if(cached != NULL) {
+            xmlSecMSCngCertPubKeyRelease(pubKey);
+            pubKey = cached;
+        }
+    }
+
+    return(pubKey);
+}
+
+/**
+ * xmlSecMSCngCertPubKeysCacheInit:
+ *
+ * Initializes the certificates public keys cache.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecMSCngCertPubKeysCacheInit(void) {
+    if(gXmlSecMSCngCertPubKeysMutex != NULL) {
+        return(0);
+    }
+
+    gXmlSecMSCngCertPubKeysMutex = xmlNewMutex();
+    if(gXmlSecMSCngCertPubKeysMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    memset(gXmlSecMSCngCertPubKeys, 0, sizeof(gXmlSecMSCngCertPubKeys));
+    gXmlSecMSCngCertPubKeysSize = 0;
+    gXmlSecMSCngCertPubKeysNext = 0;
+    return(0);
+}
+
+/**
+ * xmlSecMSCngCertPubKeysCacheShutdown:
+ *
+ * Releases the cached certificates public keys: the keys still used
+ * by the key data are destroyed with the last key data.
+ */
+void
+xmlSecMSCngCertPubKeysCacheShutdown(void) {
+    xmlSecMSCngCertPubKeyPtr pubKeys[XMLSEC_MSCNG_CERT_PUBKEYS_CACHE_SIZE];
+    xmlSecSize size, ii;
+
+    if(gXmlSecMSCngCertPubKeysMutex == NULL) {
+        return;
+    }
+
+    xmlMutexLock(gXmlSecMSCngCertPubKeysMutex);
+    size = gXmlSecMSCngCertPubKeysSize;
+    memcpy(pubKeys, gXmlSecMSCngCertPubKeys, sizeof(pubKeys));
+    memset(gXmlSecMSCngCertPubKeys, 0, sizeof(gXmlSecMSCngCertPubKeys));
+    gXmlSecMSCngCertPubKeysSize = 0;
+    gXmlSecMSCngCertPubKeysNext = 0;
+    xmlMutexUnlock(gXmlSecMSCngCertPubKeysMutex);
+
+    for(ii = 0; ii < size; ++ii) {
+        xmlSecMSCngCertPubKeyRelease(pubKeys[ii]);
+    }
+
+    xmlFreeMutex(gXmlSecMSCngCertPubKeysMutex);
+    gXmlSecMSCngCertPubKeysMutex = NULL;
+}
+
 static int
 xmlSecMSCngKeyDataCertGetPrivkey(PCCERT_CONTEXT cert, NCRYPT_KEY_HANDLE* key) {
     int ret;
@@ -108,7 +343,6 @@ xmlSecMSCngKeyDataCertGetPrivkey(PCCERT_CONTEXT cert, NCRYPT_KEY_HANDLE* key) {
 static int
 xmlSecMSCngKeyDataAdoptCert(xmlSecKeyDataPtr data, PCCERT_CONTEXT cert, xmlSecKeyDataType type) {
     xmlSecMSCngKeyDataCtxPtr ctx;
-    BCRYPT_KEY_HANDLE hPubKey;
     int ret;
 
     xmlSecAssert2(xmlSecKeyDataIsValid(data), -1);
@@ -120,6 +354,7 @@ xmlSecMSCngKeyDataAdoptCert(xmlSecKeyDataPtr data, PCCERT_CONTEXT cert, xmlSecKe
     ctx = xmlSecMSCngKeyDataGetCtx(data);
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(ctx->pubkey == NULL, -1);
+    xmlSecAssert2(ctx->certPubKey == NULL, -1);
     xmlSecAssert2(ctx->cert == NULL, -1);
 
     /* acquire the CNG key handle from the certificate */
@@ -135,13 +370,13 @@ xmlSecMSCngKeyDataAdoptCert(xmlSecKeyDataPtr data, PCCERT_CONTEXT cert, xmlSecKe
         ctx->privkey = hPrivKey;
     }
 
-    ret = xmlSecMSCngKeyDataCertGetPubkey(cert, &hPubKey);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecMSCngKeyDataCertGetPubkey", NULL);
+    ctx->certPubKey = xmlSecMSCngCertPubKeyGet(cert);
+    if(ctx->certPubKey == NULL) {
+        xmlSecInternalError("xmlSecMSCngCertPubKeyGet", NULL);
         return(-1);
     }
 
-    ctx->pubkey = hPubKey;
+    ctx->pubkey = ctx->certPubKey->hKey;
     ctx->cert = cert;
 
     return(0);
@@ -323,7 +558,9 @@ xmlSecMSCngKeyDataFinalize(xmlSecKeyDataPtr data) {
         }
     }
 
-    if(ctx->pubkey != 0) {
+    if(ctx->certPubKey != NULL) {
+        xmlSecMSCngCertPubKeyRelease(ctx->certPubKey);
+    } else if(ctx->pubkey != 0) {
         status = BCryptDestroyKey(ctx->pubkey);
         if(status != STATUS_SUCCESS) {
             xmlSecMSCngNtError("BCryptDestroyKey", NULL, status);
@@ -359,6 +596,7 @@ xmlSecMSCngKeyDataDuplicate(xmlSecKeyDataPtr dst, xmlSecKeyDataPtr src) {
     xmlSecAssert2(dstCtx->cert == NULL, -1);
     xmlSecAssert2(dstCtx->privkey == 0, -1);
     xmlSecAssert2(dstCtx->pubkey == NULL, -1);
+    xmlSecAssert2(dstCtx->certPubKey == NULL, -1);
 
     srcCtx = xmlSecMSCngKeyDataGetCtx(src);
     xmlSecAssert2(srcCtx != NULL, -1);
@@ -379,13 +617,19 @@ xmlSecMSCngKeyDataDuplicate(xmlSecKeyDataPtr dst, xmlSecKeyDataPtr src) {
         }
     }
 
-    if(dstCtx->cert != NULL) {
+    if(srcCtx->certPubKey != NULL) {
+        /* share the certificate public key */
+        xmlSecMSCngCertPubKeyAddRef(srcCtx->certPubKey);
+        dstCtx->certPubKey = srcCtx->certPubKey;
+        dstCtx->pubkey = dstCtx->certPubKey->hKey;
+    } else if(dstCtx->cert != NULL) {
         /* avoid BCryptDuplicateKey() here as that works for symmetric keys only */
-        ret = xmlSecMSCngKeyDataCertGetPubkey(dstCtx->cert, &dstCtx->pubkey);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecMSCngKeyDataCertGetPubkey", NULL);
+        dstCtx->certPubKey = xmlSecMSCngCertPubKeyGet(dstCtx->cert);
+        if(dstCtx->certPubKey == NULL) {
+            xmlSecInternalError("xmlSecMSCngCertPubKeyGet", NULL);
             return(-1);
         }
+        dstCtx->pubkey = dstCtx->certPubKey->hKey;
     } else if(srcCtx->pubkey != NULL) {
         /* BCryptDuplicateKey() works with symmetric keys only, so go with
          * export + import instead */
@@ -453,13 +697,9 @@ xmlSecMSCngKeyDataDuplicate(xmlSecKeyDataPtr dst, xmlSecKeyDataPtr src) {
                 return(-1);
         }
 
-        status = BCryptOpenAlgorithmProvider(
-            &hAlg,
-            pszAlgId,
-            NULL,
-            0);
+        status = xmlSecMSCngAlgProviderOpen(&hAlg, pszAlgId, 0, NULL);
         if(status != STATUS_SUCCESS) {
-            xmlSecMSCngNtError("BCryptOpenAlgorithmProvider",
+            xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen",
                 NULL, status);
             xmlFree(pbBlob);
             return(-1);
@@ -477,12 +717,12 @@ xmlSecMSCngKeyDataDuplicate(xmlSecKeyDataPtr dst, xmlSecKeyDataPtr src) {
             xmlSecMSCngNtError("BCryptImportKeyPair",
                 NULL, status);
             xmlFree(pbBlob);
-            BCryptCloseAlgorithmProvider(hAlg, 0);
+            xmlSecMSCngAlgProviderClose(hAlg);
             return(-1);
         }
 
         xmlFree(pbBlob);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
 
     return(0);
@@ -880,13 +1120,9 @@ xmlSecMSCngKeyDataDsaRead(xmlSecKeyDataId id, xmlSecKeyValueDsaPtr dsaValue) {
     offset += pSize; /* gSize <= ySize */
 
     /* import the key blob */
-    status = BCryptOpenAlgorithmProvider(
-        &hAlg,
-        BCRYPT_DSA_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_DSA_ALGORITHM, 0, NULL);
     if (status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", xmlSecKeyDataKlassGetName(id), status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", xmlSecKeyDataKlassGetName(id), status);
         goto done;
     }
 
@@ -926,7 +1162,7 @@ done:
         xmlSecKeyDataDestroy(data);
     }
     if (hAlg != 0) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
     if (hKey != 0) {
         BCryptDestroyKey(hKey);
@@ -1152,9 +1388,9 @@ xmlSecMSCngKeyDataDsaGenerate(xmlSecKeyDataPtr data, xmlSecSize sizeBits,
     ctx = xmlSecMSCngKeyDataGetCtx(data);
     xmlSecAssert2(ctx != NULL, -1);
 
-    status = BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_DSA_ALGORITHM, NULL, 0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_DSA_ALGORITHM, 0, NULL);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", xmlSecKeyDataGetName(data), status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", xmlSecKeyDataGetName(data), status);
         goto done;
     }
 
@@ -1191,7 +1427,7 @@ done:
     }
 
     if (hAlg != 0) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
 
     return(res);
@@ -1321,13 +1557,9 @@ xmlSecMSCngKeyDataRsaRead(xmlSecKeyDataId id, xmlSecKeyValueRsaPtr rsaValue) {
      * so we just ignore it */
 
     /* Now that we have the blob, import */
-    status = BCryptOpenAlgorithmProvider(
-        &hAlg,
-        BCRYPT_RSA_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_RSA_ALGORITHM, 0, NULL);
     if (status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", xmlSecKeyDataKlassGetName(id), status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", xmlSecKeyDataKlassGetName(id), status);
         goto done;
     }
 
@@ -1371,7 +1603,7 @@ done:
         BCryptDestroyKey(hKey);
     }
     if (hAlg != 0) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
     if (blobInitialized != 0) {
         xmlSecBufferFinalize(&blob);
@@ -1621,13 +1853,9 @@ xmlSecMSCngKeyDataRsaGenerate(xmlSecKeyDataPtr data, xmlSecSize sizeBits,
     ctx = xmlSecMSCngKeyDataGetCtx(data);
     xmlSecAssert2(ctx != NULL, -1);
 
-    status = BCryptOpenAlgorithmProvider(
-        &hAlg,
-        BCRYPT_RSA_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_RSA_ALGORITHM, 0, NULL);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", xmlSecKeyDataGetName(data), status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", xmlSecKeyDataGetName(data), status);
         goto done;
     }
 
@@ -1661,7 +1889,7 @@ done:
         BCryptDestroyKey(hKey);
     }
     if (hAlg != 0) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
     return(res);
 }
@@ -1880,13 +2108,9 @@ xmlSecMSCngKeyDataEcRead(xmlSecKeyDataId id, xmlSecKeyValueEcPtr ecValue) {
     memcpy(blobData + offset, pubkeyData, pubkeySize);
 
     /* import the key blob */
-    status = BCryptOpenAlgorithmProvider(
-        &hAlg,
-        blobType,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, blobType, 0, NULL);
     if (status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", xmlSecKeyDataKlassGetName(id), status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", xmlSecKeyDataKlassGetName(id), status);
         goto done;
     }
 
@@ -1926,7 +2150,7 @@ done:
         xmlSecKeyDataDestroy(data);
     }
     if (hAlg != 0) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
     if (hKey != 0) {
         BCryptDestroyKey(hKey);
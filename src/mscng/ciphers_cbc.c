@@ -33,6 +33,7 @@
 
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
+#include "private.h"
 
 /**************************************************************************
  *
@@ -146,27 +147,17 @@ xmlSecMSCngCbcBlockCipherInitialize(xmlSecTransformPtr transform) {
         return(-1);
     }
 
-    status = BCryptOpenAlgorithmProvider(
+    status = xmlSecMSCngAlgProviderOpen(
         &ctx->hAlg,
         ctx->pszAlgId,
-        NULL,
-        0);
+        0,
+        BCRYPT_CHAIN_MODE_CBC);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider",
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen",
             xmlSecTransformGetName(transform), status);
         return(-1);
     }
 
-    status = BCryptSetProperty(ctx->hAlg,
-                                BCRYPT_CHAINING_MODE,
-                                (PUCHAR)BCRYPT_CHAIN_MODE_CBC,
-                                sizeof(BCRYPT_CHAIN_MODE_CBC),
-                                0);
-    if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptSetProperty", xmlSecTransformGetName(transform), status);
-        return(-1);
-    }
-
     ctx->ctxInitialized = 0;
 
     return(0);
@@ -194,7 +185,7 @@ xmlSecMSCngCbcBlockCipherFinalize(xmlSecTransformPtr transform) {
     }
 
     if(ctx->hAlg != NULL) {
-        BCryptCloseAlgorithmProvider(ctx->hAlg, 0);
+        xmlSecMSCngAlgProviderClose(ctx->hAlg);
     }
 
     memset(ctx, 0, sizeof(xmlSecMSCngCbcBlockCipherCtx));
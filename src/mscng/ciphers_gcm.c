@@ -33,6 +33,7 @@
 
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
+#include "private.h"
 
 /**************************************************************************
  *
@@ -136,27 +137,17 @@ xmlSecMSCngGcmBlockCipherInitialize(xmlSecTransformPtr transform) {
         return(-1);
     }
 
-    status = BCryptOpenAlgorithmProvider(
+    status = xmlSecMSCngAlgProviderOpen(
         &ctx->hAlg,
         ctx->pszAlgId,
-        NULL,
-        0);
+        0,
+        BCRYPT_CHAIN_MODE_GCM);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider",
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen",
             xmlSecTransformGetName(transform), status);
         return(-1);
     }
 
-    status = BCryptSetProperty(ctx->hAlg,
-                                BCRYPT_CHAINING_MODE,
-                                (PUCHAR)BCRYPT_CHAIN_MODE_GCM,
-                                sizeof(BCRYPT_CHAIN_MODE_GCM),
-                                0);
-    if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptSetProperty", xmlSecTransformGetName(transform), status);
-        return(-1);
-    }
-
     ctx->ctxInitialized = 0;
 
     return(0);
@@ -195,7 +186,7 @@ xmlSecMSCngGcmBlockCipherFinalize(xmlSecTransformPtr transform) {
     }
 
     if(ctx->hAlg != NULL) {
-        BCryptCloseAlgorithmProvider(ctx->hAlg, 0);
+        xmlSecMSCngAlgProviderClose(ctx->hAlg);
     }
 
     memset(ctx, 0, sizeof(xmlSecMSCngGcmBlockCipherCtx));
@@ -41,6 +41,7 @@
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 #include "../transform_helpers.h"
+#include "private.h"
 
 /* Mingw has old version of bcrypt.h file */
 #if !defined(KDF_GENERIC_PARAMETER)
@@ -60,6 +61,7 @@ struct _xmlSecMSCngConcatKdfCtx {
     LPCWSTR pszAlgId;
     xmlSecBuffer key;
     xmlSecBuffer fixedInfo;
+    xmlSecBuffer cacheId;
 };
 XMLSEC_TRANSFORM_DECLARE(MSCngConcatKdf, xmlSecMSCngConcatKdfCtx)
 #define xmlSecMSCngConcatKdfCtxSize XMLSEC_TRANSFORM_SIZE(MSCngConcatKdf)
@@ -113,6 +115,12 @@ xmlSecMSCngConcatKdfInitialize(xmlSecTransformPtr transform) {
         xmlSecMSCngConcatKdfFinalize(transform);
         return(-1);
     }
+    ret = xmlSecBufferInitialize(&(ctx->cacheId), XMLSEC_MSCNG_KDF_DEFAULT_BUF_SIZE);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize(cacheId)", NULL);
+        xmlSecMSCngConcatKdfFinalize(transform);
+        return(-1);
+    }
     ret = xmlSecBufferInitialize(&(ctx->fixedInfo), XMLSEC_MSCNG_KDF_DEFAULT_BUF_SIZE);
     if (ret < 0) {
         xmlSecInternalError("xmlSecBufferInitialize(fixedInfo)", NULL);
@@ -141,6 +149,7 @@ xmlSecMSCngConcatKdfFinalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     xmlSecBufferFinalize(&(ctx->key));
+    xmlSecBufferFinalize(&(ctx->cacheId));
     xmlSecBufferFinalize(&(ctx->fixedInfo));
     xmlSecTransformConcatKdfParamsFinalize(&(ctx->params));
 
@@ -300,13 +309,9 @@ xmlSecMSCngConcatKdfPeformKeyDerivation(
     int res = -1;
 
     /* get algo provider */
-    status = BCryptOpenAlgorithmProvider(
-        &hKdfAlg,
-        BCRYPT_SP80056A_CONCAT_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hKdfAlg, BCRYPT_SP80056A_CONCAT_ALGORITHM, 0, NULL);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", NULL, status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", NULL, status);
         goto done;
     }
 
@@ -351,7 +356,7 @@ done:
     }
 
     if(NULL != hKdfAlg) {
-        BCryptCloseAlgorithmProvider(hKdfAlg, 0);
+        xmlSecMSCngAlgProviderClose(hKdfAlg);
     }
     return(res);
 }
@@ -451,12 +456,34 @@ xmlSecMSCngConcatKdfExecute(xmlSecTransformPtr transform, int last, xmlSecTransf
             return(-1);
         }
 
+        /* the same key might be already derived */
+        ret = xmlSecTransformConcatKdfParamsGetCacheId(&(ctx->params), &(ctx->cacheId));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformConcatKdfParamsGetCacheId", xmlSecTransformGetName(transform));
+            return(-1);
+        }
+        ret = xmlSecTransformKdfCacheFind(transform, &(ctx->cacheId),
+            xmlSecBufferGetData(&(ctx->key)), xmlSecBufferGetSize(&(ctx->key)), out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheFind", xmlSecTransformGetName(transform));
+            return(-1);
+        } else if(ret > 0) {
+            transform->status = xmlSecTransformStatusFinished;
+            return(0);
+        }
+
         /* derive */
         ret = xmlSecMSCngConcatKdfDerive(ctx, out, transform->expectedOutputSize);
         if(ret < 0) {
             xmlSecInternalError("xmlSecMSCngConcatKdfDerive", xmlSecTransformGetName(transform));
             return(-1);
         }
+        ret = xmlSecTransformKdfCacheAdd(transform, &(ctx->cacheId),
+            xmlSecBufferGetData(&(ctx->key)), xmlSecBufferGetSize(&(ctx->key)), out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheAdd", xmlSecTransformGetName(transform));
+            return(-1);
+        }
 
         /* done */
         transform->status = xmlSecTransformStatusFinished;
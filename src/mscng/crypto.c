@@ -17,11 +17,15 @@
 #include "globals.h"
 
 #include <string.h>
+#include <wchar.h>
 
 #define WIN32_NO_STATUS
 #include <windows.h>
 #undef WIN32_NO_STATUS
 #include <ntstatus.h>
+#include <bcrypt.h>
+
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
@@ -29,6 +33,7 @@
 #include <xmlsec/errors.h>
 #include <xmlsec/dl.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/xmltree.h>
 
 #include <xmlsec/mscng/app.h>
@@ -36,6 +41,7 @@
 #include <xmlsec/mscng/x509.h>
 
 #include "../cast_helpers.h"
+#include "private.h"
 
 static xmlSecCryptoDLFunctionsPtr gXmlSecMSCngFunctions = NULL;
 
@@ -294,6 +300,7 @@ xmlSecCryptoGetFunctions_mscng(void) {
     gXmlSecMSCngFunctions->cryptoAppKeysMngrCertLoadMemory      = xmlSecMSCngAppKeysMngrCertLoadMemory;
     gXmlSecMSCngFunctions->cryptoAppKeysMngrCrlLoad             = xmlSecMSCngAppKeysMngrCrlLoad;
     gXmlSecMSCngFunctions->cryptoAppKeysMngrCrlLoadMemory       = xmlSecMSCngAppKeysMngrCrlLoadMemory;
+    gXmlSecMSCngFunctions->cryptoAppKeysMngrEnableX509VerifyCache = xmlSecMSCngAppKeysMngrEnableX509VerifyCache;
     gXmlSecMSCngFunctions->cryptoAppPkcs12Load                  = xmlSecMSCngAppPkcs12Load;
     gXmlSecMSCngFunctions->cryptoAppPkcs12LoadMemory            = xmlSecMSCngAppPkcs12LoadMemory;
     gXmlSecMSCngFunctions->cryptoAppKeyCertLoad                 = xmlSecMSCngAppKeyCertLoad;
@@ -323,6 +330,15 @@ xmlSecMSCngInit (void)  {
         return(-1);
     }
 
+    if(xmlSecMSCngAlgProvidersCacheInit() < 0) {
+        xmlSecInternalError("xmlSecMSCngAlgProvidersCacheInit", NULL);
+        return(-1);
+    }
+    if(xmlSecMSCngCertPubKeysCacheInit() < 0) {
+        xmlSecInternalError("xmlSecMSCngCertPubKeysCacheInit", NULL);
+        return(-1);
+    }
+
     /* register our klasses */
     if(xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms(xmlSecCryptoGetFunctions_mscng()) < 0) {
         xmlSecInternalError("xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms", NULL);
@@ -342,10 +358,266 @@ xmlSecMSCngInit (void)  {
  */
 int
 xmlSecMSCngShutdown(void) {
-    /* TODO: if necessary, do additional shutdown here */
+    xmlSecMSCngCertPubKeysCacheShutdown();
+    xmlSecMSCngAlgProvidersCacheShutdown();
     return(0);
 }
 
+/******************************************************************************
+ *
+ * Algorithm providers cache: BCryptOpenAlgorithmProvider() is expensive and
+ * the algorithm handles can be used from multiple threads, so the handles
+ * are opened once per (algorithm, flags, chaining mode) and shared by all
+ * the transforms and keys until the library shutdown.
+ *
+ *****************************************************************************/
+#define XMLSEC_MSCNG_ALG_PROVIDERS_MAX_SIZE             64
+
+typedef struct _xmlSecMSCngAlgProvider {
+    LPWSTR              pszAlgId;
+    ULONG               dwFlags;
+    LPWSTR              pszChainingMode;
+    BCRYPT_ALG_HANDLE   hAlg;
+} xmlSecMSCngAlgProvider, *xmlSecMSCngAlgProviderPtr;
+
+static xmlMutexPtr              gXmlSecMSCngAlgProvidersMutex = NULL;
+static xmlSecMSCngAlgProvider   gXmlSecMSCngAlgProviders[XMLSEC_MSCNG_ALG_PROVIDERS_MAX_SIZE];
+static xmlSecSize               gXmlSecMSCngAlgProvidersSize = 0;
+
+static LPWSTR
+xmlSecMSCngAlgProvidersStrdup(LPCWSTR str) {
+    LPWSTR res;
+    size_t len;
+
+    if(str == NULL) {
+        return(NULL);
+    }
+    len = wcslen(str) + 1;
+    res = (LPWSTR)xmlMalloc(len * sizeof(WCHAR));
+    if(res == NULL) {
+        xmlSecMallocError(len * sizeof(WCHAR), NULL);
+        return(NULL);
+    }
+    memcpy(res, str, len * sizeof(WCHAR));
+    return(res);
+}
+
+static void
+xmlSecMSCngAlgProviderFinalize(xmlSecMSCngAlgProviderPtr provider) {
+    xmlSecAssert(provider != NULL);
+
+    if(provider->hAlg != NULL) {
+        BCryptCloseAlgorithmProvider(provider->hAlg, 0);
+    }
+    if(provider->pszAlgId != NULL) {
+        xmlFree(provider->pszAlgId);
+    }
+    if(provider->pszChainingMode != NULL) {
+        xmlFree(provider->pszChainingMode);
+    }
+    memset(provider, 0, sizeof(xmlSecMSCngAlgProvider));
+}
+
+/* should be called under lock */
+static BCRYPT_ALG_HANDLE
+xmlSecMSCngAlgProvidersCacheFind(LPCWSTR pszAlgId, ULONG dwFlags, LPCWSTR pszChainingMode) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecMSCngAlgProvidersSize; ++ii) {
+        xmlSecMSCngAlgProviderPtr provider = &(gXmlSecMSCngAlgProviders[ii]);
+
+        if((provider->dwFlags != dwFlags) || (wcscmp(provider->pszAlgId, pszAlgId) != 0)) {
+            continue;
+        }
+        if((provider->pszChainingMode == NULL) && (pszChainingMode == NULL)) {
+            return(provider->hAlg);
+        }
+        if((provider->pszChainingMode != NULL) && (pszChainingMode != NULL) &&
+           (wcscmp(provider->pszChainingMode, pszChainingMode) == 0)) {
+            return(provider->hAlg);
+        }
+    }
+    return(NULL);
+}
+
+/* should be called under lock */
+static void
+xmlSecMSCngAlgProvidersCacheAdd(LPCWSTR pszAlgId, ULONG dwFlags, LPCWSTR pszChainingMode, BCRYPT_ALG_HANDLE hAlg) {
+    xmlSecMSCngAlgProviderPtr provider;
+
+    if(gXmlSecMSCngAlgProvidersSize >= XMLSEC_MSCNG_ALG_PROVIDERS_MAX_SIZE) {
+        /* the handle stays uncached and is closed by the caller */
+        return;
+    }
+
+    provider = &(gXmlSecMSCngAlgProviders[gXmlSecMSCngAlgProvidersSize]);
+    memset(provider, 0, sizeof(xmlSecMSCngAlgProvider));
+    provider->pszAlgId = xmlSecMSCngAlgProvidersStrdup(pszAlgId);
+    if(provider->pszAlgId == NULL) {
+        xmlSecInternalError("xmlSecMSCngAlgProvidersStrdup", NULL);
+        return;
+    }
+    if(pszChainingMode != NULL) {
+        provider->pszChainingMode = xmlSecMSCngAlgProvidersStrdup(pszChainingMode);
+        if(provider->pszChainingMode == NULL) {
+            xmlSecInternalError("xmlSecMSCngAlgProvidersStrdup", NULL);
+            xmlSecMSCngAlgProviderFinalize(provider);
+            return;
+        }
+    }
+    provider->dwFlags = dwFlags;
+    provider->hAlg = hAlg;
+    ++gXmlSecMSCngAlgProvidersSize;
+}
+
+/**
+ * xmlSecMSCngAlgProvidersCacheInit:
+ *
+ * Initializes the algorithm providers cache.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecMSCngAlgProvidersCacheInit(void) {
+    if(gXmlSecMSCngAlgProvidersMutex != NULL) {
+        return(0);
+    }
+
+    gXmlSecMSCngAlgProvidersMutex = xmlNewMutex();
+    if(gXmlSecMSCngAlgProvidersMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    memset(gXmlSecMSCngAlgProviders, 0, sizeof(gXmlSecMSCngAlgProviders));
+    gXmlSecMSCngAlgProvidersSize = 0;
+    return(0);
+}
+
+/**
+ * xmlSecMSCngAlgProvidersCacheShutdown:
+ *
+ * Closes all the cached algorithm handles.
+ */
+void
+xmlSecMSCngAlgProvidersCacheShutdown(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecMSCngAlgProvidersMutex == NULL) {
+        return;
+    }
+    for(ii = 0; ii < gXmlSecMSCngAlgProvidersSize; ++ii) {
+        xmlSecMSCngAlgProviderFinalize(&(gXmlSecMSCngAlgProviders[ii]));
+    }
+    gXmlSecMSCngAlgProvidersSize = 0;
+
+    xmlFreeMutex(gXmlSecMSCngAlgProvidersMutex);
+    gXmlSecMSCngAlgProvidersMutex = NULL;
+}
+
+/**
+ * xmlSecMSCngAlgProviderOpen:
+ * @phAlg:              the pointer to the result algorithm handle.
+ * @pszAlgId:           the algorithm id (e.g. BCRYPT_AES_ALGORITHM).
+ * @dwFlags:            the BCryptOpenAlgorithmProvider() flags (e.g.
+ *                      BCRYPT_ALG_HANDLE_HMAC_FLAG).
+ * @pszChainingMode:    the chaining mode (e.g. BCRYPT_CHAIN_MODE_CBC) or NULL
+ *                      for the default one.
+ *
+ * Gets the shared algorithm handle from the cache or opens a new one. The
+ * handle must not be modified (e.g. with BCryptSetProperty()) and should be
+ * released with #xmlSecMSCngAlgProviderClose.
+ *
+ * Returns: STATUS_SUCCESS or an error status.
+ */
+NTSTATUS
+xmlSecMSCngAlgProviderOpen(BCRYPT_ALG_HANDLE* phAlg, LPCWSTR pszAlgId, ULONG dwFlags, LPCWSTR pszChainingMode) {
+    BCRYPT_ALG_HANDLE hAlg = NULL;
+    BCRYPT_ALG_HANDLE hCachedAlg;
+    NTSTATUS status;
+    size_t len;
+
+    xmlSecAssert2(phAlg != NULL, STATUS_INVALID_PARAMETER);
+    xmlSecAssert2(pszAlgId != NULL, STATUS_INVALID_PARAMETER);
+
+    (*phAlg) = NULL;
+    if(gXmlSecMSCngAlgProvidersMutex != NULL) {
+        xmlMutexLock(gXmlSecMSCngAlgProvidersMutex);
+        hCachedAlg = xmlSecMSCngAlgProvidersCacheFind(pszAlgId, dwFlags, pszChainingMode);
+        xmlMutexUnlock(gXmlSecMSCngAlgProvidersMutex);
+
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoAlgorithm, (hCachedAlg != NULL) ? 1 : 0);
+        if(hCachedAlg != NULL) {
+            (*phAlg) = hCachedAlg;
+            return(STATUS_SUCCESS);
+        }
+    }
+
+    /* open outside of the lock */
+    status = BCryptOpenAlgorithmProvider(&hAlg, pszAlgId, NULL, dwFlags);
+    if(status != STATUS_SUCCESS) {
+        return(status);
+    }
+    if(pszChainingMode != NULL) {
+        len = wcslen(pszChainingMode) + 1;
+        status = BCryptSetProperty(hAlg, BCRYPT_CHAINING_MODE, (PUCHAR)pszChainingMode,
+            (ULONG)(len * sizeof(WCHAR)), 0);
+        if(status != STATUS_SUCCESS) {
+            xmlSecMSCngNtError("BCryptSetProperty(BCRYPT_CHAINING_MODE)", NULL, status);
+            BCryptCloseAlgorithmProvider(hAlg, 0);
+            return(status);
+        }
+    }
+
+    if(gXmlSecMSCngAlgProvidersMutex != NULL) {
+        xmlMutexLock(gXmlSecMSCngAlgProvidersMutex);
+        hCachedAlg = xmlSecMSCngAlgProvidersCacheFind(pszAlgId, dwFlags, pszChainingMode);
+        if(hCachedAlg == NULL) {
+            /* not fatal if we can't cache it */
+            xmlSecMSCngAlgProvidersCacheAdd(pszAlgId, dwFlags, pszChainingMode, hAlg);
+        }
+        xmlMutexUnlock(gXmlSecMSCngAlgProvidersMutex);
+
+        /* another thread was faster */
+        if(hCachedAlg != NULL) {
+            BCryptCloseAlgorithmProvider(hAlg, 0);
+            hAlg = hCachedAlg;
+        }
+    }
+
+    (*phAlg) = hAlg;
+    return(STATUS_SUCCESS);
+}
+
+/**
+ * xmlSecMSCngAlgProviderClose:
+ * @hAlg:               the algorithm handle from #xmlSecMSCngAlgProviderOpen.
+ *
+ * Releases the algorithm handle: the cached handles stay open until
+ * the library shutdown.
+ */
+void
+xmlSecMSCngAlgProviderClose(BCRYPT_ALG_HANDLE hAlg) {
+    xmlSecSize ii;
+    int found = 0;
+
+    if(hAlg == NULL) {
+        return;
+    }
+    if(gXmlSecMSCngAlgProvidersMutex != NULL) {
+        xmlMutexLock(gXmlSecMSCngAlgProvidersMutex);
+        for(ii = 0; ii < gXmlSecMSCngAlgProvidersSize; ++ii) {
+            if(gXmlSecMSCngAlgProviders[ii].hAlg == hAlg) {
+                found = 1;
+                break;
+            }
+        }
+        xmlMutexUnlock(gXmlSecMSCngAlgProvidersMutex);
+    }
+    if(found == 0) {
+        BCryptCloseAlgorithmProvider(hAlg, 0);
+    }
+}
+
 /**
  * xmlSecMSCngGenerateRandom:
  * @buffer:             the destination buffer.
@@ -399,7 +671,7 @@ xmlSecMSCngKeysMngrInit(xmlSecKeysMngrPtr mngr) {
 
 #ifndef XMLSEC_NO_X509
     /* create x509 store if needed */
-    if(xmlSecKeysMngrGetDataStore(mngr, xmlSecMSCngX509StoreId) == NULL) {
+    if(xmlSecKeysMngrFindDataStore(mngr, xmlSecMSCngX509StoreId) == NULL) {
         xmlSecKeyDataStorePtr x509Store;
 
         x509Store = xmlSecKeyDataStoreCreate(xmlSecMSCngX509StoreId);
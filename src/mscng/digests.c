@@ -31,6 +31,7 @@
 #include <xmlsec/mscng/crypto.h>
 
 #include "../cast_helpers.h"
+#include "private.h"
 
 typedef struct _xmlSecMSCngDigestCtx xmlSecMSCngDigestCtx, *xmlSecMSCngDigestCtxPtr;
 struct _xmlSecMSCngDigestCtx {
@@ -142,6 +143,9 @@ xmlSecMSCngDigestInitialize(xmlSecTransformPtr transform) {
         return(-1);
     }
 
+    /* the digest only reads the input, no need to copy it */
+    transform->borrowInput = 1;
+
     return(0);
 }
 
@@ -155,7 +159,7 @@ static void xmlSecMSCngDigestFinalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     if(ctx->hAlg != 0) {
-        BCryptCloseAlgorithmProvider(ctx->hAlg, 0);
+        xmlSecMSCngAlgProviderClose(ctx->hAlg);
     }
 
     if(ctx->hHash != 0) {
@@ -238,13 +242,13 @@ xmlSecMSCngDigestExecute(xmlSecTransformPtr transform,
 
     if(transform->status == xmlSecTransformStatusNone) {
         /* open an algorithm handle */
-        status = BCryptOpenAlgorithmProvider(
+        status = xmlSecMSCngAlgProviderOpen(
             &ctx->hAlg,
             ctx->pszAlgId,
-            NULL,
-            0);
+            0,
+            NULL);
         if(status != STATUS_SUCCESS) {
-            xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", xmlSecTransformGetName(transform), status);
+            xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", xmlSecTransformGetName(transform), status);
             return(-1);
         }
 
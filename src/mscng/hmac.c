@@ -36,6 +36,7 @@
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 #include "../transform_helpers.h"
+#include "private.h"
 
 typedef struct _xmlSecMSCngHmacCtx xmlSecMSCngHmacCtx, *xmlSecMSCngHmacCtxPtr;
 
@@ -164,7 +165,7 @@ xmlSecMSCngHmacFinalize(xmlSecTransformPtr transform) {
     }
 
     if(ctx->hAlg != NULL) {
-        BCryptCloseAlgorithmProvider(ctx->hAlg, 0);
+        xmlSecMSCngAlgProviderClose(ctx->hAlg);
     }
 
     memset(ctx, 0, sizeof(xmlSecMSCngHmacCtx));
@@ -246,12 +247,12 @@ xmlSecMSCngHmacSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
     /* at this point we know what should be they key, go ahead with the CNG
      * calls */
 
-    status = BCryptOpenAlgorithmProvider(&ctx->hAlg,
+    status = xmlSecMSCngAlgProviderOpen(&ctx->hAlg,
         ctx->pszAlgId,
-        NULL,
-        BCRYPT_ALG_HANDLE_HMAC_FLAG);
+        BCRYPT_ALG_HANDLE_HMAC_FLAG,
+        NULL);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", xmlSecTransformGetName(transform), status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", xmlSecTransformGetName(transform), status);
         return(-1);
     }
 
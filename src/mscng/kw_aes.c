@@ -36,6 +36,7 @@
 
 #include "../kw_aes_des.h"
 #include "../cast_helpers.h"
+#include "private.h"
 
  /*********************************************************************
   *
@@ -91,6 +92,8 @@ static xmlSecKWAesKlass xmlSecMSCngKWAesKlass = {
     /* callbacks */
     xmlSecMSCngKWAesBlockEncrypt,           /* xmlSecKWAesBlockEncryptMethod       encrypt; */
     xmlSecMSCngKWAesBlockDecrypt,           /* xmlSecKWAesBlockDecryptMethod       decrypt; */
+    NULL,                                   /* xmlSecKWAesBlocksEncryptMethod      encryptBlocks; */
+    NULL,                                   /* xmlSecKWAesBlocksDecryptMethod      decryptBlocks; */
 
     /* for the future */
     NULL,                                   /* void*                               reserved0; */
@@ -404,13 +407,9 @@ xmlSecMSCngKWAesBlockEncrypt(xmlSecTransformPtr transform, const xmlSecByte* in,
     }
     blob_initialized = 1;
 
-    status = BCryptOpenAlgorithmProvider(
-        &hAlg,
-        BCRYPT_AES_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_AES_ALGORITHM, 0, NULL);
     if (status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", NULL, status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", NULL, status);
         goto done;
     }
 
@@ -501,7 +500,7 @@ done:
         xmlFree(pbKeyObject);
     }
     if (hAlg != NULL) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
     if (blob_initialized != 0) {
         xmlSecBufferFinalize(&blob);
@@ -554,13 +553,9 @@ xmlSecMSCngKWAesBlockDecrypt(xmlSecTransformPtr transform, const xmlSecByte* in,
     }
     blob_initialized = 1;
 
-    status = BCryptOpenAlgorithmProvider(
-        &hAlg,
-        BCRYPT_AES_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_AES_ALGORITHM, 0, NULL);
     if (status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", NULL, status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", NULL, status);
         goto done;
     }
 
@@ -651,7 +646,7 @@ done:
         xmlFree(pbKeyObject);
     }
     if (hAlg != NULL) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
     if (blob_initialized != 0) {
         xmlSecBufferFinalize(&blob);
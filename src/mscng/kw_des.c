@@ -37,6 +37,7 @@
 
 #include "../kw_aes_des.h"
 #include "../cast_helpers.h"
+#include "private.h"
 
 /*********************************************************************
  *
@@ -107,12 +108,9 @@ xmlSecMSCngKWDes3Sha1(xmlSecTransformPtr transform, const xmlSecByte * in, xmlSe
     xmlSecAssert2(ctx != NULL, -1);
 
     /* create */
-    status = BCryptOpenAlgorithmProvider(&hAlg,
-        BCRYPT_SHA1_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_SHA1_ALGORITHM, 0, NULL);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", NULL, status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", NULL, status);
         goto done;
     }
 
@@ -200,7 +198,7 @@ done:
     }
 
     if(hAlg != NULL) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
 
     return(res);
@@ -248,13 +246,9 @@ xmlSecMSCngKWDes3BlockEncrypt(xmlSecTransformPtr transform, const xmlSecByte * i
         goto done;
     }
 
-    status = BCryptOpenAlgorithmProvider(
-        &hAlg,
-        BCRYPT_3DES_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_3DES_ALGORITHM, 0, NULL);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", NULL, status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", NULL, status);
         goto done;
     }
 
@@ -382,7 +376,7 @@ done:
     }
 
     if(hAlg != NULL) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
 
     return(res);
@@ -429,13 +423,9 @@ xmlSecMSCngKWDes3BlockDecrypt(xmlSecTransformPtr transform, const xmlSecByte * i
         goto done;
     }
 
-    status = BCryptOpenAlgorithmProvider(
-        &hAlg,
-        BCRYPT_3DES_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_3DES_ALGORITHM, 0, NULL);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", NULL, status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", NULL, status);
         goto done;
     }
 
@@ -552,7 +542,7 @@ done:
     }
 
     if(hAlg != NULL) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+        xmlSecMSCngAlgProviderClose(hAlg);
     }
 
     return(res);
@@ -41,6 +41,7 @@
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 #include "../transform_helpers.h"
+#include "private.h"
 
 /* Mingw has old version of bcrypt.h file */
 #if !defined(KDF_SALT)
@@ -63,6 +64,7 @@ struct _xmlSecMSCngPbkdf2Ctx {
     xmlSecTransformPbkdf2Params params;
     LPCWSTR pszAlgId;
     xmlSecBuffer key;
+    xmlSecBuffer cacheId;
 };
 XMLSEC_TRANSFORM_DECLARE(MSCngPbkdf2, xmlSecMSCngPbkdf2Ctx)
 #define xmlSecMSCngPbkdf2CtxSize XMLSEC_TRANSFORM_SIZE(MSCngPbkdf2)
@@ -114,6 +116,12 @@ xmlSecMSCngPbkdf2Initialize(xmlSecTransformPtr transform) {
         xmlSecMSCngPbkdf2Finalize(transform);
         return(-1);
     }
+    ret = xmlSecBufferInitialize(&(ctx->cacheId), XMLSEC_MSCNG_KDF_DEFAULT_BUF_SIZE);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize(cacheId)", NULL);
+        xmlSecMSCngPbkdf2Finalize(transform);
+        return(-1);
+    }
     ret = xmlSecTransformPbkdf2ParamsInitialize(&(ctx->params));
     if(ret < 0) {
         xmlSecInternalError("xmlSecTransformPbkdf2ParamsInitialize", NULL);
@@ -136,6 +144,7 @@ xmlSecMSCngPbkdf2Finalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     xmlSecBufferFinalize(&(ctx->key));
+    xmlSecBufferFinalize(&(ctx->cacheId));
     xmlSecTransformPbkdf2ParamsFinalize(&(ctx->params));
 
     memset(ctx, 0, sizeof(xmlSecMSCngPbkdf2Ctx));
@@ -300,13 +309,9 @@ xmlSecMSCngPbkdf2PeformKeyDerivation(
     int res = -1;
 
     /* get algo provider */
-    status = BCryptOpenAlgorithmProvider(
-        &hKdfAlg,
-        BCRYPT_PBKDF2_ALGORITHM,
-        NULL,
-        0);
+    status = xmlSecMSCngAlgProviderOpen(&hKdfAlg, BCRYPT_PBKDF2_ALGORITHM, 0, NULL);
     if(status != STATUS_SUCCESS) {
-        xmlSecMSCngNtError("BCryptOpenAlgorithmProvider", NULL, status);
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", NULL, status);
         goto done;
     }
 
@@ -351,7 +356,7 @@ done:
     }
 
     if(NULL != hKdfAlg) {
-        BCryptCloseAlgorithmProvider(hKdfAlg, 0);
+        xmlSecMSCngAlgProviderClose(hKdfAlg);
     }
     return(res);
 }
@@ -451,12 +456,34 @@ xmlSecMSCngPbkdf2Execute(xmlSecTransformPtr transform, int last, xmlSecTransform
         }
         ctx->params.keyLength = transform->expectedOutputSize;
 
+        /* the same key might be already derived */
+        ret = xmlSecTransformPbkdf2ParamsGetCacheId(&(ctx->params), &(ctx->cacheId));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformPbkdf2ParamsGetCacheId", xmlSecTransformGetName(transform));
+            return(-1);
+        }
+        ret = xmlSecTransformKdfCacheFind(transform, &(ctx->cacheId),
+            xmlSecBufferGetData(&(ctx->key)), xmlSecBufferGetSize(&(ctx->key)), out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheFind", xmlSecTransformGetName(transform));
+            return(-1);
+        } else if(ret > 0) {
+            transform->status = xmlSecTransformStatusFinished;
+            return(0);
+        }
+
         /* derive */
         ret = xmlSecMSCngPbkdf2Derive(ctx, out);
         if(ret < 0) {
             xmlSecInternalError("xmlSecMSCngPbkdf2Derive", xmlSecTransformGetName(transform));
             return(-1);
         }
+        ret = xmlSecTransformKdfCacheAdd(transform, &(ctx->cacheId),
+            xmlSecBufferGetData(&(ctx->key)), xmlSecBufferGetSize(&(ctx->key)), out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheAdd", xmlSecTransformGetName(transform));
+            return(-1);
+        }
 
         /* done */
         transform->status = xmlSecTransformStatusFinished;
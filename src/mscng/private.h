@@ -34,6 +34,22 @@ extern "C" {
  ******************************************************************************/
  xmlSecSize         xmlSecMSCngKeyDataGetSize                       (xmlSecKeyDataPtr data);
 
+/******************************************************************************
+ *
+ * Algorithm providers cache
+ *
+ ******************************************************************************/
+int                 xmlSecMSCngAlgProvidersCacheInit                (void);
+void                xmlSecMSCngAlgProvidersCacheShutdown            (void);
+NTSTATUS            xmlSecMSCngAlgProviderOpen                      (BCRYPT_ALG_HANDLE* phAlg,
+                                                                     LPCWSTR pszAlgId,
+                                                                     ULONG dwFlags,
+                                                                     LPCWSTR pszChainingMode);
+void                xmlSecMSCngAlgProviderClose                     (BCRYPT_ALG_HANDLE hAlg);
+
+int                 xmlSecMSCngCertPubKeysCacheInit                 (void);
+void                xmlSecMSCngCertPubKeysCacheShutdown             (void);
+
 /******************************************************************************
  *
  * X509 Util functions
@@ -359,7 +359,7 @@ static void xmlSecMSCngSignatureFinalize(xmlSecTransformPtr transform) {
     // - hash pointer
 
     if(ctx->hHashAlg != 0) {
-        BCryptCloseAlgorithmProvider(ctx->hHashAlg, 0);
+        xmlSecMSCngAlgProviderClose(ctx->hHashAlg);
     }
 
     if(ctx->hHash != 0) {
@@ -620,13 +620,13 @@ xmlSecMSCngSignatureExecute(xmlSecTransformPtr transform, int last, xmlSecTransf
         xmlSecAssert2(outSize == 0, -1);
 
         /* open an algorithm handle */
-        status = BCryptOpenAlgorithmProvider(
+        status = xmlSecMSCngAlgProviderOpen(
             &ctx->hHashAlg,
             ctx->pszHashAlgId,
-            NULL,
-            0);
+            0,
+            NULL);
         if(status != STATUS_SUCCESS) {
-            xmlSecMSCngNtError("BCryptOpenAlgorithmProvider",
+            xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen",
                 xmlSecTransformGetName(transform), status);
             return(-1);
         }
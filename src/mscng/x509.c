@@ -367,9 +367,9 @@ xmlSecMSCnVerifyAndAdoptX509KeyData(xmlSecKeyPtr key, xmlSecKeyDataPtr data, xml
     }
 
     /* lets find a cert we can verify */
-    x509Store = xmlSecKeysMngrGetDataStore(keyInfoCtx->keysMngr, xmlSecMSCngX509StoreId);
+    x509Store = xmlSecKeysMngrFindDataStore(keyInfoCtx->keysMngr, xmlSecMSCngX509StoreId);
     if(x509Store == NULL) {
-        xmlSecInternalError("xmlSecKeysMngrGetDataStore", xmlSecKeyDataGetName(data));
+        xmlSecInternalError("xmlSecKeysMngrFindDataStore", xmlSecKeyDataGetName(data));
         return(-1);
     }
     cert = xmlSecMSCngX509StoreVerify(x509Store, ctx->hMemStore, keyInfoCtx);
@@ -502,9 +502,9 @@ xmlSecMSCngKeyDataX509Read(xmlSecKeyDataPtr data, xmlSecKeyX509DataValuePtr x509
         xmlSecKeyDataStorePtr x509Store;
         int stopOnUnknownCert = 0;
 
-        x509Store = xmlSecKeysMngrGetDataStore(keysMngr, xmlSecMSCngX509StoreId);
+        x509Store = xmlSecKeysMngrFindDataStore(keysMngr, xmlSecMSCngX509StoreId);
         if (x509Store == NULL) {
-            xmlSecInternalError("xmlSecKeysMngrGetDataStore", xmlSecKeyDataGetName(data));
+            xmlSecInternalError("xmlSecKeysMngrFindDataStore", xmlSecKeyDataGetName(data));
             goto done;
         }
         /* determine what to do */
@@ -19,7 +19,13 @@
 
 #include <string.h>
 
+#define WIN32_NO_STATUS
 #include <windows.h>
+#undef WIN32_NO_STATUS
+#include <ntstatus.h>
+#include <bcrypt.h>
+
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/base64.h>
@@ -36,6 +42,50 @@
 #include "../cast_helpers.h"
 #include "private.h"
 
+#define XMLSEC_MSCNG_X509_THUMBPRINT_SIZE       20
+#define XMLSEC_MSCNG_X509_CERTS_DIGEST_SIZE     32
+
+/**************************************************************************
+ *
+ * Verification results cache: the successful verifications are identified
+ * by the leaf cert thumbprint, the digest of the certs from the document
+ * and the verification time. The store certs are not part of the id, the
+ * cache is flushed when they change.
+ *
+ *************************************************************************/
+typedef struct _xmlSecMSCngX509VerifyCacheEntry         xmlSecMSCngX509VerifyCacheEntry,
+                                                        *xmlSecMSCngX509VerifyCacheEntryPtr;
+struct _xmlSecMSCngX509VerifyCacheEntry {
+    int                 used;
+    BYTE                leafThumbprint[XMLSEC_MSCNG_X509_THUMBPRINT_SIZE];
+    BYTE                certsDigest[XMLSEC_MSCNG_X509_CERTS_DIGEST_SIZE];
+    time_t              verificationTime;
+    ULONGLONG           expires;
+};
+
+/**************************************************************************
+ *
+ * Certs indexes: the lookups by issuer name and serial number and by SKI
+ * are done through the hash indexes over the certs added with
+ * xmlSecMSCngX509StoreAdoptCert(). Each index is an array of (hash, cert)
+ * items sorted by hash and then by the order the certs were added.
+ *
+ *************************************************************************/
+typedef struct _xmlSecMSCngX509CertIndexItem            xmlSecMSCngX509CertIndexItem,
+                                                        *xmlSecMSCngX509CertIndexItemPtr;
+struct _xmlSecMSCngX509CertIndexItem {
+    DWORD               hash;
+    PCCERT_CONTEXT      cert;
+};
+
+typedef struct _xmlSecMSCngX509CertIndex                xmlSecMSCngX509CertIndex,
+                                                        *xmlSecMSCngX509CertIndexPtr;
+struct _xmlSecMSCngX509CertIndex {
+    xmlSecMSCngX509CertIndexItemPtr     items;
+    xmlSecSize                          size;
+    xmlSecSize                          maxSize;
+};
+
 typedef struct _xmlSecMSCngX509StoreCtx xmlSecMSCngX509StoreCtx,
                                        *xmlSecMSCngX509StoreCtxPtr;
 struct _xmlSecMSCngX509StoreCtx {
@@ -43,11 +93,41 @@ struct _xmlSecMSCngX509StoreCtx {
     HCERTSTORE trustedMemStore;
     HCERTSTORE untrusted;
     HCERTSTORE untrustedMemStore;
+
+    /* chain engine for the system certs verification (with the untrusted certs) */
+    HCERTCHAINENGINE                    hChainEngine;
+
+    /* the indexes over the adopted certs: the index is incomplete (and the
+     * collection has to be searched too) once an external store is added */
+    xmlSecMSCngX509CertIndex            trustedIssuerSerialIndex;
+    xmlSecMSCngX509CertIndex            trustedSkiIndex;
+    int                                 trustedIndexIncomplete;
+    xmlSecMSCngX509CertIndex            untrustedIssuerSerialIndex;
+    xmlSecMSCngX509CertIndex            untrustedSkiIndex;
+    int                                 untrustedIndexIncomplete;
+
+    /* verification results cache (disabled by default) */
+    xmlMutexPtr                         verifyCacheMutex;
+    xmlSecMSCngX509VerifyCacheEntryPtr  verifyCache;
+    xmlSecSize                          verifyCacheMaxSize;
+    xmlSecSize                          verifyCachePos;
 };
 
 XMLSEC_KEY_DATA_STORE_DECLARE(MSCngX509Store, xmlSecMSCngX509StoreCtx)
 #define xmlSecMSCngX509StoreSize XMLSEC_KEY_DATA_STORE_SIZE(MSCngX509Store)
 
+static void             xmlSecMSCngX509VerifyCacheReset                 (xmlSecMSCngX509StoreCtxPtr ctx);
+
+static int              xmlSecMSCngX509CertIndexAdd                     (xmlSecMSCngX509CertIndexPtr issuerSerialIndex,
+                                                                         xmlSecMSCngX509CertIndexPtr skiIndex,
+                                                                         PCCERT_CONTEXT cert);
+static void             xmlSecMSCngX509CertIndexFinalize                (xmlSecMSCngX509CertIndexPtr index);
+static PCCERT_CONTEXT   xmlSecMSCngX509StoreFindCertInStore             (HCERTSTORE store,
+                                                                         xmlSecMSCngX509CertIndexPtr issuerSerialIndex,
+                                                                         xmlSecMSCngX509CertIndexPtr skiIndex,
+                                                                         int indexIncomplete,
+                                                                         xmlSecMSCngX509FindCertCtxPtr findCertCtx);
+
 // https://learn.microsoft.com/en-us/windows/win32/api/wincrypt/nf-wincrypt-certclosestore
 //
 // CERT_CLOSE_STORE_CHECK_FLAG should only be used as a diagnostic tool in the development
@@ -67,6 +147,16 @@ xmlSecMSCngX509StoreFinalize(xmlSecKeyDataStorePtr store) {
     ctx = xmlSecMSCngX509StoreGetCtx(store);
     xmlSecAssert(ctx != NULL);
 
+    xmlSecMSCngX509StoreDisableVerifyCache(store);
+    xmlSecMSCngX509CertIndexFinalize(&(ctx->trustedIssuerSerialIndex));
+    xmlSecMSCngX509CertIndexFinalize(&(ctx->trustedSkiIndex));
+    xmlSecMSCngX509CertIndexFinalize(&(ctx->untrustedIssuerSerialIndex));
+    xmlSecMSCngX509CertIndexFinalize(&(ctx->untrustedSkiIndex));
+
+    if(ctx->hChainEngine != NULL) {
+        CertFreeCertificateChainEngine(ctx->hChainEngine);
+    }
+
     if(ctx->trusted != NULL) {
         ret = CertCloseStore(ctx->trusted, XMLSEC_CLOSE_STORE_FLAG);
         if(ret == FALSE) {
@@ -129,6 +219,8 @@ xmlSecMSCngX509StoreAdoptKeyStore(xmlSecKeyDataStorePtr store, HCERTSTORE keySto
             xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
+    ctx->trustedIndexIncomplete = 1;
+    xmlSecMSCngX509VerifyCacheReset(ctx);
 
     return(0);
 }
@@ -160,6 +252,8 @@ xmlSecMSCngX509StoreAdoptTrustedStore(xmlSecKeyDataStorePtr store, HCERTSTORE tr
             xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
+    ctx->trustedIndexIncomplete = 1;
+    xmlSecMSCngX509VerifyCacheReset(ctx);
 
     return(0);
 }
@@ -191,12 +285,15 @@ xmlSecMSCngX509StoreAdoptUntrustedStore(xmlSecKeyDataStorePtr store, HCERTSTORE
             xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
+    ctx->untrustedIndexIncomplete = 1;
+    xmlSecMSCngX509VerifyCacheReset(ctx);
 
     return(0);
 }
 
 static int
 xmlSecMSCngX509StoreInitialize(xmlSecKeyDataStorePtr store) {
+    CERT_CHAIN_ENGINE_CONFIG engineConfig;
     int ret;
     xmlSecMSCngX509StoreCtxPtr ctx;
 
@@ -281,6 +378,20 @@ xmlSecMSCngX509StoreInitialize(xmlSecKeyDataStorePtr store) {
         return(-1);
     }
 
+    /* create the chain engine that keeps the chain building caches between
+     * the verifications and searches the untrusted certs collection */
+    memset(&engineConfig, 0, sizeof(engineConfig));
+    engineConfig.cbSize = sizeof(engineConfig);
+    engineConfig.cAdditionalStore = 1;
+    engineConfig.rghAdditionalStore = &(ctx->untrusted);
+    engineConfig.dwFlags = CERT_CHAIN_CACHE_END_CERT;
+    ret = CertCreateCertificateChainEngine(&engineConfig, &(ctx->hChainEngine));
+    if(ret == FALSE) {
+        xmlSecMSCngLastError("CertCreateCertificateChainEngine", xmlSecKeyDataStoreGetName(store));
+        xmlSecMSCngX509StoreFinalize(store);
+        return(-1);
+    }
+
     return(0);
 }
 
@@ -326,6 +437,9 @@ int
 xmlSecMSCngX509StoreAdoptCert(xmlSecKeyDataStorePtr store, PCCERT_CONTEXT pCert, xmlSecKeyDataType type) {
     xmlSecMSCngX509StoreCtxPtr ctx;
     HCERTSTORE hCertStore;
+    xmlSecMSCngX509CertIndexPtr issuerSerialIndex;
+    xmlSecMSCngX509CertIndexPtr skiIndex;
+    PCCERT_CONTEXT pStoreCert = NULL;
     int ret;
 
     xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecMSCngX509StoreId), -1);
@@ -337,8 +451,12 @@ xmlSecMSCngX509StoreAdoptCert(xmlSecKeyDataStorePtr store, PCCERT_CONTEXT pCert,
 
     if(type == xmlSecKeyDataTypeTrusted) {
         hCertStore = ctx->trusted;
+        issuerSerialIndex = &(ctx->trustedIssuerSerialIndex);
+        skiIndex = &(ctx->trustedSkiIndex);
     } else if(type == xmlSecKeyDataTypeNone) {
         hCertStore = ctx->untrusted;
+        issuerSerialIndex = &(ctx->untrustedIssuerSerialIndex);
+        skiIndex = &(ctx->untrustedSkiIndex);
     } else {
         xmlSecNotImplementedError(NULL);
         return(-1);
@@ -349,16 +467,106 @@ xmlSecMSCngX509StoreAdoptCert(xmlSecKeyDataStorePtr store, PCCERT_CONTEXT pCert,
         hCertStore,
         pCert,
         CERT_STORE_ADD_ALWAYS,
-        NULL);
+        &pStoreCert);
     if(ret == FALSE) {
         xmlSecMSCngLastError("CertAddCertificateContextToStore", xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
     CertFreeCertificateContext(pCert);
+    xmlSecMSCngX509VerifyCacheReset(ctx);
+
+    /* the cert is already in the store, if we can't index it then
+     * the lookups just fall back to the store search */
+    ret = xmlSecMSCngX509CertIndexAdd(issuerSerialIndex, skiIndex, pStoreCert);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecMSCngX509CertIndexAdd", xmlSecKeyDataStoreGetName(store));
+        if(type == xmlSecKeyDataTypeTrusted) {
+            ctx->trustedIndexIncomplete = 1;
+        } else {
+            ctx->untrustedIndexIncomplete = 1;
+        }
+    }
+    CertFreeCertificateContext(pStoreCert);
+
+    return(0);
+}
+
+/**
+ * xmlSecMSCngX509StoreEnableVerifyCache:
+ * @store:              the pointer to X509 key data store klass.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables (or re-creates empty) cache for the successful certificates
+ * verification results: the same leaf certificate with the same certificates
+ * from the document and the same verification time is verified only once.
+ * The results for the current time verification expire with the first
+ * certificate in the chain or at the next update of the CRLs used for
+ * the revocation checks. The certificates with CRLs in the document are
+ * always verified. The cache is flushed when certificates or stores are
+ * added to the store. This function is not thread safe and should be
+ * called before the store is used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecMSCngX509StoreEnableVerifyCache(xmlSecKeyDataStorePtr store, xmlSecSize maxSize) {
+    xmlSecMSCngX509StoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecMSCngX509StoreId), -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    ctx = xmlSecMSCngX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    xmlSecMSCngX509StoreDisableVerifyCache(store);
 
+    ctx->verifyCache = (xmlSecMSCngX509VerifyCacheEntryPtr)xmlMalloc(sizeof(xmlSecMSCngX509VerifyCacheEntry) * maxSize);
+    if(ctx->verifyCache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecMSCngX509VerifyCacheEntry) * maxSize, xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+    memset(ctx->verifyCache, 0, sizeof(xmlSecMSCngX509VerifyCacheEntry) * maxSize);
+
+    ctx->verifyCacheMutex = xmlNewMutex();
+    if(ctx->verifyCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyDataStoreGetName(store));
+        xmlFree(ctx->verifyCache);
+        ctx->verifyCache = NULL;
+        return(-1);
+    }
+    ctx->verifyCacheMaxSize = maxSize;
+    ctx->verifyCachePos = 0;
     return(0);
 }
 
+/**
+ * xmlSecMSCngX509StoreDisableVerifyCache:
+ * @store:              the pointer to X509 key data store klass.
+ *
+ * Disables the certificates verification results cache. This function
+ * is not thread safe and should not be called while the store is used.
+ */
+void
+xmlSecMSCngX509StoreDisableVerifyCache(xmlSecKeyDataStorePtr store) {
+    xmlSecMSCngX509StoreCtxPtr ctx;
+
+    xmlSecAssert(xmlSecKeyDataStoreCheckId(store, xmlSecMSCngX509StoreId));
+
+    ctx = xmlSecMSCngX509StoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache != NULL) {
+        xmlFree(ctx->verifyCache);
+        ctx->verifyCache = NULL;
+    }
+    if(ctx->verifyCacheMutex != NULL) {
+        xmlFreeMutex(ctx->verifyCacheMutex);
+        ctx->verifyCacheMutex = NULL;
+    }
+    ctx->verifyCacheMaxSize = 0;
+    ctx->verifyCachePos = 0;
+}
+
 /**
  * xmlSecMSCngCheckRevocation:
  * @store: may contain a CRL
@@ -447,6 +655,23 @@ xmlSecMSCngX509StoreContainsCert(HCERTSTORE store, CERT_NAME_BLOB* name,
     return(0);
 }
 
+/* updates @expires (0 if not set) to @time if @time is earlier */
+static void
+xmlSecMSCngX509UpdateExpires(ULONGLONG* expires, const FILETIME* time) {
+    ULONGLONG tt;
+
+    xmlSecAssert(expires != NULL);
+    xmlSecAssert(time != NULL);
+
+    tt = (((ULONGLONG)time->dwHighDateTime) << 32) | ((ULONGLONG)time->dwLowDateTime);
+    if(tt == 0) {
+        return;
+    }
+    if(((*expires) == 0) || (tt < (*expires))) {
+        (*expires) = tt;
+    }
+}
+
 static int
 xmlSecMSCngVerifyCertTime(PCCERT_CONTEXT cert, LPFILETIME time) {
     xmlSecAssert2(cert != NULL, -1);
@@ -477,6 +702,7 @@ xmlSecMSCngVerifyCertTime(PCCERT_CONTEXT cert, LPFILETIME time) {
  * @trustedStore: trusted certificates added via xmlSecMSCngX509StoreAdoptCert().
  * @certStore: the untrusted certificates stack.
  * @store: key data store, name used for error reporting only.
+ * @expires: the earliest NotAfter time of the checked certificates.
  *
  * Verifies @cert based on trustedStore (ignoring system trusted certificates).
  *
@@ -485,7 +711,7 @@ xmlSecMSCngVerifyCertTime(PCCERT_CONTEXT cert, LPFILETIME time) {
 static int
 xmlSecMSCngX509StoreVerifyCertificateOwn(PCCERT_CONTEXT cert,
         FILETIME* time, HCERTSTORE trustedStore, HCERTSTORE untrustedStore, HCERTSTORE certStore,
-        xmlSecKeyDataStorePtr store) {
+        xmlSecKeyDataStorePtr store, ULONGLONG* expires) {
     PCCERT_CONTEXT issuerCert = NULL;
     DWORD flags;
     int ret;
@@ -494,6 +720,7 @@ xmlSecMSCngX509StoreVerifyCertificateOwn(PCCERT_CONTEXT cert,
     xmlSecAssert2(trustedStore != NULL, -1);
     xmlSecAssert2(certStore != NULL, -1);
     xmlSecAssert2(store != NULL, -1);
+    xmlSecAssert2(expires != NULL, -1);
 
     ret = xmlSecMSCngVerifyCertTime(cert, time);
     if(ret < 0) {
@@ -501,6 +728,7 @@ xmlSecMSCngX509StoreVerifyCertificateOwn(PCCERT_CONTEXT cert,
             xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
+    xmlSecMSCngX509UpdateExpires(expires, &(cert->pCertInfo->NotAfter));
 
     ret = xmlSecMSCngCheckRevocation(certStore, cert);
     if(ret < 0) {
@@ -559,7 +787,7 @@ xmlSecMSCngX509StoreVerifyCertificateOwn(PCCERT_CONTEXT cert,
         }
 
         ret = xmlSecMSCngX509StoreVerifyCertificateOwn(issuerCert, time,
-            trustedStore, untrustedStore, certStore, store);
+            trustedStore, untrustedStore, certStore, store, expires);
         if(ret < 0) {
             xmlSecInternalError("xmlSecMSCngX509StoreVerifyCertificateOwn", xmlSecKeyDataStoreGetName(store));
             CertFreeCertificateContext(issuerCert);
@@ -588,7 +816,7 @@ xmlSecMSCngX509StoreVerifyCertificateOwn(PCCERT_CONTEXT cert,
         }
 
         ret = xmlSecMSCngX509StoreVerifyCertificateOwn(issuerCert, time,
-            trustedStore, untrustedStore, certStore, store);
+            trustedStore, untrustedStore, certStore, store, expires);
         if(ret < 0) {
             xmlSecInternalError("xmlSecMSCngX509StoreVerifyCertificateOwn", xmlSecKeyDataStoreGetName(store));
             CertFreeCertificateContext(issuerCert);
@@ -601,52 +829,69 @@ xmlSecMSCngX509StoreVerifyCertificateOwn(PCCERT_CONTEXT cert,
     return(-1);
 }
 
+/* the chain is valid until the first NotAfter time or the next update of the CRLs used for the revocation checks */
+static void
+xmlSecMSCngX509ChainGetExpires(PCCERT_CHAIN_CONTEXT pChainContext, ULONGLONG* expires) {
+    PCERT_SIMPLE_CHAIN pChain;
+    PCERT_CHAIN_ELEMENT pElement;
+    PCERT_REVOCATION_INFO pRevocationInfo;
+    DWORD ii, jj;
+
+    xmlSecAssert(pChainContext != NULL);
+    xmlSecAssert(expires != NULL);
+
+    for(ii = 0; ii < pChainContext->cChain; ++ii) {
+        pChain = pChainContext->rgpChain[ii];
+        if(pChain == NULL) {
+            continue;
+        }
+        for(jj = 0; jj < pChain->cElement; ++jj) {
+            pElement = pChain->rgpElement[jj];
+            if((pElement == NULL) || (pElement->pCertContext == NULL)) {
+                continue;
+            }
+            xmlSecMSCngX509UpdateExpires(expires, &(pElement->pCertContext->pCertInfo->NotAfter));
+
+            pRevocationInfo = pElement->pRevocationInfo;
+            if((pRevocationInfo != NULL) && (pRevocationInfo->pCrlInfo != NULL) &&
+               (pRevocationInfo->pCrlInfo->pBaseCrlContext != NULL) &&
+               (pRevocationInfo->pCrlInfo->pBaseCrlContext->pCrlInfo != NULL)
+            ) {
+                xmlSecMSCngX509UpdateExpires(expires, &(pRevocationInfo->pCrlInfo->pBaseCrlContext->pCrlInfo->NextUpdate));
+            }
+        }
+    }
+}
+
 /**
  * xmlSecMSCngX509StoreVerifyCertificateSystem:
+ * @hChainEngine: the chain engine (searches the untrusted certificates added via API)
  * @cert: the certificate we check
  * @time: pointer to FILETIME that we are interested in
- * @untrustedStore: untrusted certificates added via API
  * @docStore: untrusted certificates/CRLs extracted from a document
+ * @expires: the earliest NotAfter or CRL NextUpdate time in the chain.
  *
  * Verifies @cert based on system trusted certificates.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
 static int
-xmlSecMSCngX509StoreVerifyCertificateSystem(PCCERT_CONTEXT cert,
-        FILETIME* time, HCERTSTORE untrustedStore, HCERTSTORE docStore) {
+xmlSecMSCngX509StoreVerifyCertificateSystem(HCERTCHAINENGINE hChainEngine, PCCERT_CONTEXT cert,
+        FILETIME* time, HCERTSTORE docStore, ULONGLONG* expires) {
     PCCERT_CHAIN_CONTEXT pChainContext = NULL;
     CERT_CHAIN_PARA chainPara;
-    HCERTSTORE chainStore = NULL;
     int res = -1;
     int ret;
 
+    xmlSecAssert2(expires != NULL, -1);
+
     /* initialize data structures */
     memset(&chainPara, 0, sizeof(CERT_CHAIN_PARA));
     chainPara.cbSize = sizeof(CERT_CHAIN_PARA);
 
-    /* create additional store for CertGetCertificateChain() */
-    chainStore = CertOpenStore(CERT_STORE_PROV_COLLECTION, 0, 0, 0, NULL);
-    if(chainStore == NULL) {
-        xmlSecMSCngLastError("CertOpenStore", NULL);
-        goto end;
-    }
-
-    ret = CertAddStoreToCollection(chainStore, docStore, 0, 0);
-    if(ret == FALSE) {
-        xmlSecMSCngLastError("CertAddStoreToCollection", NULL);
-        goto end;
-    }
-
-    ret = CertAddStoreToCollection(chainStore, untrustedStore, 0, 0);
-    if(ret == FALSE) {
-        xmlSecMSCngLastError("CertAddStoreToCollection", NULL);
-        goto end;
-    }
-
     /* build a chain using CertGetCertificateChain
      and the certificate retrieved */
-    ret = CertGetCertificateChain(NULL, cert, time, chainStore, &chainPara,
+    ret = CertGetCertificateChain(hChainEngine, cert, time, docStore, &chainPara,
         CERT_CHAIN_REVOCATION_CHECK_CHAIN, NULL, &pChainContext);
     if(ret == FALSE) {
         xmlSecMSCngLastError("CertGetCertificateChain", NULL);
@@ -656,7 +901,7 @@ xmlSecMSCngX509StoreVerifyCertificateSystem(PCCERT_CONTEXT cert,
     if (pChainContext->TrustStatus.dwErrorStatus == CERT_TRUST_REVOCATION_STATUS_UNKNOWN) {
         CertFreeCertificateChain(pChainContext);
         pChainContext = NULL;
-        ret = CertGetCertificateChain(NULL, cert, time, chainStore, &chainPara,
+        ret = CertGetCertificateChain(hChainEngine, cert, time, docStore, &chainPara,
             CERT_CHAIN_REVOCATION_CHECK_CHAIN_EXCLUDE_ROOT, NULL,
             &pChainContext);
         if(ret == FALSE) {
@@ -666,6 +911,7 @@ xmlSecMSCngX509StoreVerifyCertificateSystem(PCCERT_CONTEXT cert,
     }
 
     if(pChainContext->TrustStatus.dwErrorStatus == CERT_TRUST_NO_ERROR) {
+        xmlSecMSCngX509ChainGetExpires(pChainContext, expires);
         res = 0;
     }
 
@@ -674,10 +920,6 @@ end:
         CertFreeCertificateChain(pChainContext);
     }
 
-    if(chainStore != NULL) {
-        CertCloseStore(chainStore, 0);
-    }
-
     return (res);
 }
 
@@ -703,6 +945,175 @@ xmlSecMSCngUnixTimeToFileTime(time_t in, LPFILETIME out) {
     return(0);
 }
 
+/* the caller is responsible for locking */
+static void
+xmlSecMSCngX509VerifyCacheFlush(xmlSecMSCngX509StoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache != NULL) {
+        memset(ctx->verifyCache, 0, sizeof(xmlSecMSCngX509VerifyCacheEntry) * ctx->verifyCacheMaxSize);
+    }
+    ctx->verifyCachePos = 0;
+}
+
+/* the store certs have changed */
+static void
+xmlSecMSCngX509VerifyCacheReset(xmlSecMSCngX509StoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache == NULL) {
+        return;
+    }
+    xmlMutexLock(ctx->verifyCacheMutex);
+    xmlSecMSCngX509VerifyCacheFlush(ctx);
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
+static int
+xmlSecMSCngX509GetThumbprint(PCCERT_CONTEXT cert, BYTE* thumbprint) {
+    DWORD len = XMLSEC_MSCNG_X509_THUMBPRINT_SIZE;
+    BOOL ret;
+
+    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(thumbprint != NULL, -1);
+
+    ret = CertGetCertificateContextProperty(cert, CERT_SHA1_HASH_PROP_ID, thumbprint, &len);
+    if((ret != TRUE) || (len != XMLSEC_MSCNG_X509_THUMBPRINT_SIZE)) {
+        xmlSecMSCngLastError("CertGetCertificateContextProperty(CERT_SHA1_HASH_PROP_ID)", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* prepares the cache entry (without expiration time) for the @cert verification with @certStore */
+static int
+xmlSecMSCngX509VerifyCacheEntryInit(xmlSecMSCngX509VerifyCacheEntryPtr entry, PCCERT_CONTEXT cert,
+    HCERTSTORE certStore, xmlSecKeyInfoCtx* keyInfoCtx
+) {
+    BCRYPT_ALG_HANDLE hAlg = NULL;
+    BCRYPT_HASH_HANDLE hHash = NULL;
+    PCCERT_CONTEXT cur = NULL;
+    BYTE thumbprint[XMLSEC_MSCNG_X509_THUMBPRINT_SIZE];
+    NTSTATUS status;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(entry != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(certStore != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+
+    memset(entry, 0, sizeof(xmlSecMSCngX509VerifyCacheEntry));
+    entry->verificationTime = keyInfoCtx->certsVerificationTime;
+
+    ret = xmlSecMSCngX509GetThumbprint(cert, entry->leafThumbprint);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecMSCngX509GetThumbprint(leaf)", NULL);
+        goto done;
+    }
+
+    status = xmlSecMSCngAlgProviderOpen(&hAlg, BCRYPT_SHA256_ALGORITHM, 0, NULL);
+    if(status != STATUS_SUCCESS) {
+        xmlSecMSCngNtError("xmlSecMSCngAlgProviderOpen", NULL, status);
+        goto done;
+    }
+    status = BCryptCreateHash(hAlg, &hHash, NULL, 0, NULL, 0, 0);
+    if(status != STATUS_SUCCESS) {
+        xmlSecMSCngNtError("BCryptCreateHash", NULL, status);
+        goto done;
+    }
+    while((cur = CertEnumCertificatesInStore(certStore, cur)) != NULL) {
+        ret = xmlSecMSCngX509GetThumbprint(cur, thumbprint);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecMSCngX509GetThumbprint", NULL);
+            goto done;
+        }
+        status = BCryptHashData(hHash, thumbprint, sizeof(thumbprint), 0);
+        if(status != STATUS_SUCCESS) {
+            xmlSecMSCngNtError("BCryptHashData", NULL, status);
+            goto done;
+        }
+    }
+    status = BCryptFinishHash(hHash, entry->certsDigest, sizeof(entry->certsDigest), 0);
+    if(status != STATUS_SUCCESS) {
+        xmlSecMSCngNtError("BCryptFinishHash", NULL, status);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(cur != NULL) {
+        CertFreeCertificateContext(cur);
+    }
+    if(hHash != NULL) {
+        BCryptDestroyHash(hHash);
+    }
+    if(hAlg != NULL) {
+        xmlSecMSCngAlgProviderClose(hAlg);
+    }
+    return(res);
+}
+
+/* returns 1 if @entry matches a not expired cache entry, 0 otherwise */
+static int
+xmlSecMSCngX509VerifyCacheFind(xmlSecMSCngX509StoreCtxPtr ctx, xmlSecMSCngX509VerifyCacheEntryPtr entry) {
+    xmlSecMSCngX509VerifyCacheEntryPtr cur;
+    FILETIME fNow;
+    ULONGLONG now;
+    xmlSecSize ii;
+    int res = 0;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(entry != NULL, 0);
+
+    if(ctx->verifyCache == NULL) {
+        return(0);
+    }
+
+    GetSystemTimeAsFileTime(&fNow);
+    now = (((ULONGLONG)fNow.dwHighDateTime) << 32) | ((ULONGLONG)fNow.dwLowDateTime);
+
+    xmlMutexLock(ctx->verifyCacheMutex);
+    for(ii = 0; ii < ctx->verifyCacheMaxSize; ++ii) {
+        cur = &(ctx->verifyCache[ii]);
+        if(cur->used == 0) {
+            continue;
+        }
+        if((cur->expires > 0) && (cur->expires <= now)) {
+            memset(cur, 0, sizeof(xmlSecMSCngX509VerifyCacheEntry));
+            continue;
+        }
+        if((cur->verificationTime == entry->verificationTime) &&
+           (memcmp(cur->leafThumbprint, entry->leafThumbprint, sizeof(cur->leafThumbprint)) == 0) &&
+           (memcmp(cur->certsDigest, entry->certsDigest, sizeof(cur->certsDigest)) == 0)
+        ) {
+            res = 1;
+            break;
+        }
+    }
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+    return(res);
+}
+
+static void
+xmlSecMSCngX509VerifyCacheAdd(xmlSecMSCngX509StoreCtxPtr ctx, xmlSecMSCngX509VerifyCacheEntryPtr entry) {
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(entry != NULL);
+
+    if(ctx->verifyCache == NULL) {
+        return;
+    }
+
+    /* replace the oldest entry */
+    xmlMutexLock(ctx->verifyCacheMutex);
+    entry->used = 1;
+    memcpy(&(ctx->verifyCache[ctx->verifyCachePos]), entry, sizeof(xmlSecMSCngX509VerifyCacheEntry));
+    ctx->verifyCachePos = (ctx->verifyCachePos + 1) % ctx->verifyCacheMaxSize;
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
 /**
  * xmlSecMSCngX509StoreVerifyCertificate:
  * @store: the pointer to X509 certificate context store klass.
@@ -710,7 +1121,8 @@ xmlSecMSCngUnixTimeToFileTime(time_t in, LPFILETIME out) {
  * @certStore: the untrusted certificates stack.
  * @keyInfoCtx: the pointer to &lt;dsig:KeyInfo/&gt; element processing context.
  *
- * Verifies @cert.
+ * Verifies @cert. The verification results cache (if enabled) is checked
+ * first, the results are only cached if there are no CRLs in @certStore.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
@@ -718,7 +1130,10 @@ static int
 xmlSecMSCngX509StoreVerifyCertificate(xmlSecKeyDataStorePtr store,
     PCCERT_CONTEXT cert, HCERTSTORE certStore, xmlSecKeyInfoCtx* keyInfoCtx) {
     xmlSecMSCngX509StoreCtxPtr ctx;
+    xmlSecMSCngX509VerifyCacheEntry entry;
+    PCCRL_CONTEXT crlCtx;
     FILETIME fTime;
+    int useCache = 0;
     int ret;
 
     xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecMSCngX509StoreId), -1);
@@ -731,6 +1146,23 @@ xmlSecMSCngX509StoreVerifyCertificate(xmlSecKeyDataStorePtr store,
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(ctx->trusted != NULL, -1);
 
+    if(ctx->verifyCache != NULL) {
+        crlCtx = CertEnumCRLsInStore(certStore, NULL);
+        if(crlCtx == NULL) {
+            ret = xmlSecMSCngX509VerifyCacheEntryInit(&entry, cert, certStore, keyInfoCtx);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecMSCngX509VerifyCacheEntryInit", xmlSecKeyDataStoreGetName(store));
+                return(-1);
+            }
+            if(xmlSecMSCngX509VerifyCacheFind(ctx, &entry) == 1) {
+                return(0);
+            }
+            useCache = 1;
+        } else {
+            CertFreeCRLContext(crlCtx);
+        }
+    }
+
     if(keyInfoCtx->certsVerificationTime > 0) {
         xmlSecMSCngUnixTimeToFileTime(keyInfoCtx->certsVerificationTime,
             &fTime);
@@ -740,20 +1172,27 @@ xmlSecMSCngX509StoreVerifyCertificate(xmlSecKeyDataStorePtr store,
     }
 
     /* verify based on the own trusted certificates */
+    entry.expires = 0;
     ret = xmlSecMSCngX509StoreVerifyCertificateOwn(cert,
-        &fTime, ctx->trusted, ctx->untrusted, certStore, store);
-    if(ret >= 0) {
-        return(0);
+        &fTime, ctx->trusted, ctx->untrusted, certStore, store, &(entry.expires));
+    if(ret < 0) {
+        /* verify based on the system certificates */
+        entry.expires = 0;
+        ret = xmlSecMSCngX509StoreVerifyCertificateSystem(ctx->hChainEngine, cert,
+            &fTime, certStore, &(entry.expires));
+        if(ret < 0) {
+            return(-1);
+        }
     }
 
-    /* verify based on the system certificates */
-    ret = xmlSecMSCngX509StoreVerifyCertificateSystem(cert,
-        &fTime, ctx->untrusted, certStore);
-    if(ret >= 0) {
-        return(0);
+    /* the results for the fixed verification time never expire */
+    if(useCache != 0) {
+        if(keyInfoCtx->certsVerificationTime > 0) {
+            entry.expires = 0;
+        }
+        xmlSecMSCngX509VerifyCacheAdd(ctx, &entry);
     }
-
-    return(-1);
+    return(0);
 }
 
 /**
@@ -1196,12 +1635,16 @@ xmlSecMSCngX509StoreFindCert_ex(xmlSecKeyDataStorePtr store, xmlChar* subjectNam
 
     /* search untrusted certs store */
     if ((cert == NULL) && (ctx->untrusted != NULL)) {
-        cert = xmlSecMSCngX509FindCert(ctx->untrusted, &findCertCtx);
+        cert = xmlSecMSCngX509StoreFindCertInStore(ctx->untrusted,
+            &(ctx->untrustedIssuerSerialIndex), &(ctx->untrustedSkiIndex),
+            ctx->untrustedIndexIncomplete, &findCertCtx);
     }
 
     /* search trusted certs store */
     if ((cert == NULL) && (ctx->trusted != NULL)) {
-        cert = xmlSecMSCngX509FindCert(ctx->trusted, &findCertCtx);
+        cert = xmlSecMSCngX509StoreFindCertInStore(ctx->trusted,
+            &(ctx->trustedIssuerSerialIndex), &(ctx->trustedSkiIndex),
+            ctx->trustedIndexIncomplete, &findCertCtx);
     }
 
     /* done */
@@ -1231,12 +1674,16 @@ xmlSecMSCngX509StoreFindCertByValue(xmlSecKeyDataStorePtr store, xmlSecKeyX509Da
 
     /* search untrusted certs store */
     if ((cert == NULL) && (ctx->untrusted != NULL)) {
-        cert = xmlSecMSCngX509FindCert(ctx->untrusted, &findCertCtx);
+        cert = xmlSecMSCngX509StoreFindCertInStore(ctx->untrusted,
+            &(ctx->untrustedIssuerSerialIndex), &(ctx->untrustedSkiIndex),
+            ctx->untrustedIndexIncomplete, &findCertCtx);
     }
 
     /* search trusted certs store */
     if ((cert == NULL) && (ctx->trusted != NULL)) {
-        cert = xmlSecMSCngX509FindCert(ctx->trusted, &findCertCtx);
+        cert = xmlSecMSCngX509StoreFindCertInStore(ctx->trusted,
+            &(ctx->trustedIssuerSerialIndex), &(ctx->trustedSkiIndex),
+            ctx->trustedIndexIncomplete, &findCertCtx);
     }
 
     /* done */
@@ -1350,6 +1797,328 @@ xmlSecMSCngX509FindCertBySubject(HCERTSTORE store, LPTSTR wcSubject,
 }
 
 
+/**************************************************************************
+ *
+ * Certs indexes
+ *
+ *************************************************************************/
+#define XMLSEC_MSCNG_X509_INDEX_HASH_INIT       2166136261UL
+#define XMLSEC_MSCNG_X509_INDEX_HASH_PRIME      16777619UL
+#define XMLSEC_MSCNG_X509_INDEX_MIN_SIZE        16
+
+/* FNV-1a */
+static DWORD
+xmlSecMSCngX509IndexHashBytes(DWORD hash, const BYTE* data, DWORD len) {
+    DWORD ii;
+
+    if(data == NULL) {
+        return(hash);
+    }
+    for(ii = 0; ii < len; ++ii) {
+        hash ^= (DWORD)data[ii];
+        hash *= XMLSEC_MSCNG_X509_INDEX_HASH_PRIME;
+    }
+    return(hash);
+}
+
+/* CertCompareIntegerBlob() ignores the leading 0x00 (positive numbers) and 0xFF
+ * (negative numbers) bytes, so does the hash: the blob is little-endian */
+static DWORD
+xmlSecMSCngX509IndexHashIssuerSerial(const CERT_NAME_BLOB* issuer, const CRYPT_INTEGER_BLOB* serial) {
+    DWORD hash = XMLSEC_MSCNG_X509_INDEX_HASH_INIT;
+    DWORD len;
+
+    xmlSecAssert2(issuer != NULL, 0);
+    xmlSecAssert2(serial != NULL, 0);
+
+    len = serial->cbData;
+    while((len > 1) && (
+        ((serial->pbData[len - 1] == 0x00) && ((serial->pbData[len - 2] & 0x80) == 0)) ||
+        ((serial->pbData[len - 1] == 0xFF) && ((serial->pbData[len - 2] & 0x80) != 0))
+    )) {
+        --len;
+    }
+    hash = xmlSecMSCngX509IndexHashBytes(hash, issuer->pbData, issuer->cbData);
+    hash = xmlSecMSCngX509IndexHashBytes(hash, serial->pbData, len);
+    return(hash);
+}
+
+/* the caller must free the returned SKI with xmlFree() */
+static BYTE*
+xmlSecMSCngX509IndexGetSki(PCCERT_CONTEXT cert, DWORD* len) {
+    BYTE* res;
+    BOOL ret;
+
+    xmlSecAssert2(cert != NULL, NULL);
+    xmlSecAssert2(len != NULL, NULL);
+
+    /* the same value as used by CERT_FIND_KEY_IDENTIFIER: the SKI extension
+     * or the hash of the public key if there is no extension */
+    (*len) = 0;
+    ret = CertGetCertificateContextProperty(cert, CERT_KEY_IDENTIFIER_PROP_ID, NULL, len);
+    if((ret != TRUE) || ((*len) <= 0)) {
+        return(NULL);
+    }
+    res = (BYTE*)xmlMalloc(*len);
+    if(res == NULL) {
+        xmlSecMallocError(*len, NULL);
+        return(NULL);
+    }
+    ret = CertGetCertificateContextProperty(cert, CERT_KEY_IDENTIFIER_PROP_ID, res, len);
+    if(ret != TRUE) {
+        xmlSecMSCngLastError("CertGetCertificateContextProperty(CERT_KEY_IDENTIFIER_PROP_ID)", NULL);
+        xmlFree(res);
+        return(NULL);
+    }
+    return(res);
+}
+
+/* returns the position of the first item with hash >= @hash */
+static xmlSecSize
+xmlSecMSCngX509CertIndexLowerBound(xmlSecMSCngX509CertIndexPtr index, DWORD hash) {
+    xmlSecSize lo, hi, mid;
+
+    xmlSecAssert2(index != NULL, 0);
+
+    lo = 0;
+    hi = index->size;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(index->items[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return(lo);
+}
+
+static int
+xmlSecMSCngX509CertIndexInsert(xmlSecMSCngX509CertIndexPtr index, DWORD hash, PCCERT_CONTEXT cert) {
+    xmlSecMSCngX509CertIndexItemPtr newItems;
+    xmlSecSize newMaxSize, pos;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+
+    if(index->size >= index->maxSize) {
+        newMaxSize = (index->maxSize > 0) ? 2 * index->maxSize : XMLSEC_MSCNG_X509_INDEX_MIN_SIZE;
+        newItems = (xmlSecMSCngX509CertIndexItemPtr)xmlRealloc(index->items,
+            sizeof(xmlSecMSCngX509CertIndexItem) * newMaxSize);
+        if(newItems == NULL) {
+            xmlSecMallocError(sizeof(xmlSecMSCngX509CertIndexItem) * newMaxSize, NULL);
+            return(-1);
+        }
+        index->items = newItems;
+        index->maxSize = newMaxSize;
+    }
+
+    /* after all the items with the same hash to keep the certs order */
+    pos = xmlSecMSCngX509CertIndexLowerBound(index, hash + 1);
+    if((hash + 1) == 0) {
+        pos = index->size;
+    }
+    if(pos < index->size) {
+        memmove(&(index->items[pos + 1]), &(index->items[pos]),
+            sizeof(xmlSecMSCngX509CertIndexItem) * (index->size - pos));
+    }
+    index->items[pos].hash = hash;
+    index->items[pos].cert = CertDuplicateCertificateContext(cert);
+    ++index->size;
+    return(0);
+}
+
+static int
+xmlSecMSCngX509CertIndexAdd(xmlSecMSCngX509CertIndexPtr issuerSerialIndex,
+    xmlSecMSCngX509CertIndexPtr skiIndex, PCCERT_CONTEXT cert
+) {
+    BYTE* ski;
+    DWORD skiLen = 0;
+    DWORD hash;
+    int ret;
+
+    xmlSecAssert2(issuerSerialIndex != NULL, -1);
+    xmlSecAssert2(skiIndex != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(cert->pCertInfo != NULL, -1);
+
+    hash = xmlSecMSCngX509IndexHashIssuerSerial(&(cert->pCertInfo->Issuer), &(cert->pCertInfo->SerialNumber));
+    ret = xmlSecMSCngX509CertIndexInsert(issuerSerialIndex, hash, cert);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecMSCngX509CertIndexInsert(issuerSerial)", NULL);
+        return(-1);
+    }
+
+    ski = xmlSecMSCngX509IndexGetSki(cert, &skiLen);
+    if(ski == NULL) {
+        /* no SKI */
+        return(0);
+    }
+    hash = xmlSecMSCngX509IndexHashBytes(XMLSEC_MSCNG_X509_INDEX_HASH_INIT, ski, skiLen);
+    xmlFree(ski);
+
+    ret = xmlSecMSCngX509CertIndexInsert(skiIndex, hash, cert);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecMSCngX509CertIndexInsert(ski)", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static void
+xmlSecMSCngX509CertIndexFinalize(xmlSecMSCngX509CertIndexPtr index) {
+    xmlSecSize ii;
+
+    xmlSecAssert(index != NULL);
+
+    for(ii = 0; ii < index->size; ++ii) {
+        if(index->items[ii].cert != NULL) {
+            CertFreeCertificateContext(index->items[ii].cert);
+        }
+    }
+    if(index->items != NULL) {
+        xmlFree(index->items);
+    }
+    memset(index, 0, sizeof(xmlSecMSCngX509CertIndex));
+}
+
+static PCCERT_CONTEXT
+xmlSecMSCngX509CertIndexFindByIssuerSerial(xmlSecMSCngX509CertIndexPtr index,
+    CERT_NAME_BLOB* issuer, CRYPT_INTEGER_BLOB* serial, DWORD dwCertEncodingType
+) {
+    PCCERT_CONTEXT cert;
+    DWORD hash;
+    xmlSecSize ii;
+
+    xmlSecAssert2(index != NULL, NULL);
+    xmlSecAssert2(issuer != NULL, NULL);
+    xmlSecAssert2(serial != NULL, NULL);
+
+    hash = xmlSecMSCngX509IndexHashIssuerSerial(issuer, serial);
+    for(ii = xmlSecMSCngX509CertIndexLowerBound(index, hash); (ii < index->size) && (index->items[ii].hash == hash); ++ii) {
+        cert = index->items[ii].cert;
+        if((CertCompareCertificateName(dwCertEncodingType, &(cert->pCertInfo->Issuer), issuer) == TRUE) &&
+           (CertCompareIntegerBlob(&(cert->pCertInfo->SerialNumber), serial) == TRUE)
+        ) {
+            return(CertDuplicateCertificateContext(cert));
+        }
+    }
+    return(NULL);
+}
+
+/* same as xmlSecMSCngX509FindCertByIssuerNameAndSerial() but uses the index */
+static PCCERT_CONTEXT
+xmlSecMSCngX509CertIndexFindByIssuerNameAndSerial(xmlSecMSCngX509CertIndexPtr index,
+    LPTSTR wcIssuerName, xmlSecBnPtr issuerSerialBn, DWORD dwCertEncodingType
+) {
+    static const DWORD strTypes[] = {
+        CERT_NAME_STR_ENABLE_UTF8_UNICODE_FLAG | CERT_OID_NAME_STR,
+        CERT_NAME_STR_ENABLE_UTF8_UNICODE_FLAG | CERT_OID_NAME_STR | CERT_NAME_STR_REVERSE_FLAG,
+        CERT_OID_NAME_STR,
+        CERT_OID_NAME_STR | CERT_NAME_STR_REVERSE_FLAG
+    };
+    PCCERT_CONTEXT res = NULL;
+    CERT_NAME_BLOB issuer;
+    CRYPT_INTEGER_BLOB serial;
+    xmlSecSize issuerSerialSize;
+    BYTE* bdata;
+    DWORD len;
+    xmlSecSize ii;
+
+    xmlSecAssert2(index != NULL, NULL);
+    xmlSecAssert2(wcIssuerName != NULL, NULL);
+    xmlSecAssert2(issuerSerialBn != NULL, NULL);
+
+    if(index->size <= 0) {
+        return(NULL);
+    }
+
+    serial.pbData = xmlSecBnGetData(issuerSerialBn);
+    issuerSerialSize = xmlSecBnGetSize(issuerSerialBn);
+    XMLSEC_SAFE_CAST_SIZE_TO_ULONG(issuerSerialSize, serial.cbData, return(NULL), NULL);
+
+    for(ii = 0; (res == NULL) && (ii < sizeof(strTypes) / sizeof(strTypes[0])); ++ii) {
+        bdata = xmlSecMSCngCertStrToName(dwCertEncodingType, wcIssuerName, strTypes[ii], &len);
+        if(bdata == NULL) {
+            continue;
+        }
+        issuer.cbData = len;
+        issuer.pbData = bdata;
+        res = xmlSecMSCngX509CertIndexFindByIssuerSerial(index, &issuer, &serial, dwCertEncodingType);
+        xmlFree(bdata);
+    }
+    return(res);
+}
+
+static PCCERT_CONTEXT
+xmlSecMSCngX509CertIndexFindBySki(xmlSecMSCngX509CertIndexPtr index, const xmlSecByte* ski, DWORD skiLen) {
+    PCCERT_CONTEXT res = NULL;
+    BYTE* certSki;
+    DWORD certSkiLen;
+    DWORD hash;
+    xmlSecSize ii;
+
+    xmlSecAssert2(index != NULL, NULL);
+    xmlSecAssert2(ski != NULL, NULL);
+    xmlSecAssert2(skiLen > 0, NULL);
+
+    hash = xmlSecMSCngX509IndexHashBytes(XMLSEC_MSCNG_X509_INDEX_HASH_INIT, ski, skiLen);
+    for(ii = xmlSecMSCngX509CertIndexLowerBound(index, hash); (ii < index->size) && (index->items[ii].hash == hash); ++ii) {
+        certSki = xmlSecMSCngX509IndexGetSki(index->items[ii].cert, &certSkiLen);
+        if(certSki == NULL) {
+            continue;
+        }
+        if((certSkiLen == skiLen) && (memcmp(certSki, ski, skiLen) == 0)) {
+            res = CertDuplicateCertificateContext(index->items[ii].cert);
+        }
+        xmlFree(certSki);
+        if(res != NULL) {
+            break;
+        }
+    }
+    return(res);
+}
+
+/* same as xmlSecMSCngX509FindCert() but the issuer name and serial and SKI lookups
+ * are done through the indexes; the @store is searched only if the index is incomplete */
+static PCCERT_CONTEXT
+xmlSecMSCngX509StoreFindCertInStore(HCERTSTORE store, xmlSecMSCngX509CertIndexPtr issuerSerialIndex,
+    xmlSecMSCngX509CertIndexPtr skiIndex, int indexIncomplete, xmlSecMSCngX509FindCertCtxPtr findCertCtx
+) {
+    DWORD dwCertEncodingType = X509_ASN_ENCODING | PKCS_7_ASN_ENCODING;
+    PCCERT_CONTEXT cert = NULL;
+
+    xmlSecAssert2(store != 0, NULL);
+    xmlSecAssert2(issuerSerialIndex != NULL, NULL);
+    xmlSecAssert2(skiIndex != NULL, NULL);
+    xmlSecAssert2(findCertCtx != 0, NULL);
+
+    if((cert == NULL) && (findCertCtx->wcSubjectName != NULL)) {
+        cert = xmlSecMSCngX509FindCertBySubject(store, findCertCtx->wcSubjectName, dwCertEncodingType);
+    }
+
+    if((cert == NULL) && (findCertCtx->wcIssuerName != NULL) && (findCertCtx->issuerSerialBn != NULL)) {
+        cert = xmlSecMSCngX509CertIndexFindByIssuerNameAndSerial(issuerSerialIndex, findCertCtx->wcIssuerName,
+            findCertCtx->issuerSerialBn, dwCertEncodingType);
+        if((cert == NULL) && (indexIncomplete != 0)) {
+            cert = xmlSecMSCngX509FindCertByIssuerNameAndSerial(store, findCertCtx->wcIssuerName,
+                findCertCtx->issuerSerialBn, dwCertEncodingType);
+        }
+    }
+
+    if((cert == NULL) &&  (findCertCtx->ski != NULL) && (findCertCtx->skiLen > 0)) {
+        cert = xmlSecMSCngX509CertIndexFindBySki(skiIndex, findCertCtx->ski, findCertCtx->skiLen);
+        if((cert == NULL) && (indexIncomplete != 0)) {
+            cert = xmlSecMSCngX509FindCertBySki(store, findCertCtx->ski, findCertCtx->skiLen, dwCertEncodingType);
+        }
+    }
+    if ((cert == NULL) && (findCertCtx->digestValue != NULL) && (findCertCtx->digestLen > 0)) {
+        cert = xmlSecMSCngX509FindCertByDigest(store, findCertCtx->digestValue, findCertCtx->digestLen, dwCertEncodingType);
+    }
+
+    return(cert);
+}
+
 /******************************************************************************
  *
  * xmlSecMSCngX509FindCert functions
@@ -38,6 +38,7 @@
 #include <xmlsec/mscrypto/x509.h>
 
 #include "../cast_helpers.h"
+#include "../keysdata_helpers.h"
 #include "private.h"
 
 #ifndef PKCS12_NO_PERSIST_KEY
@@ -850,6 +851,26 @@ xmlSecMSCryptoAppKeysMngrCrlLoadMemory(xmlSecKeysMngrPtr mngr, const xmlSecByte*
     return(-1);
 }
 
+/**
+ * xmlSecMSCryptoAppKeysMngrEnableX509VerifyCache:
+ * @mngr:               the keys manager.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables the cache of the successful certificates verification results
+ * in the X509 store of @mngr (not supported by MSCrypto).
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecMSCryptoAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize) {
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    /* TODO */
+    xmlSecNotImplementedError(NULL);
+    return(-1);
+}
+
 /**
  * xmlSecMSCryptoAppDefaultKeysMngrAdoptKeyStore:
  * @mngr:                       the keys manager.
@@ -1021,6 +1042,9 @@ xmlSecMSCryptoAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr ke
         return(-1);
     }
 
+    /* the new key might be one of the recently not found keys */
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
+
     return(0);
 }
 
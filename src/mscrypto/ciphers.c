@@ -465,9 +465,9 @@ xmlSecMSCryptoBlockCipherInitialize(xmlSecTransformPtr transform) {
         return(-1);
     }
 
-    ctx->cryptProvider = xmlSecMSCryptoFindProvider(ctx->providers, NULL, CRYPT_VERIFYCONTEXT, TRUE);
+    ctx->cryptProvider = xmlSecMSCryptoProviderPoolGet(ctx->providers, CRYPT_VERIFYCONTEXT, TRUE);
     if(ctx->cryptProvider == 0) {
-        xmlSecInternalError("xmlSecMSCryptoFindProvider",
+        xmlSecInternalError("xmlSecMSCryptoProviderPoolGet",
                             xmlSecTransformGetName(transform));
         return(-1);
     }
@@ -500,7 +500,7 @@ xmlSecMSCryptoBlockCipherFinalize(xmlSecTransformPtr transform) {
         CryptDestroyKey(ctx->pubPrivKey);
     }
     if (ctx->cryptProvider) {
-        CryptReleaseContext(ctx->cryptProvider, 0);
+        xmlSecMSCryptoProviderPoolPut(ctx->cryptProvider);
     }
 
     memset(ctx, 0, sizeof(xmlSecMSCryptoBlockCipherCtx));
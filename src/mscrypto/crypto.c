@@ -19,6 +19,9 @@
 #include "globals.h"
 
 #include <string.h>
+#include <wchar.h>
+
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
@@ -26,6 +29,7 @@
 #include <xmlsec/errors.h>
 #include <xmlsec/dl.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/xmltree.h>
 
 #include <xmlsec/mscrypto/app.h>
@@ -257,6 +261,7 @@ xmlSecCryptoGetFunctions_mscrypto(void) {
     gXmlSecMSCryptoFunctions->cryptoAppKeysMngrCertLoadMemory   = xmlSecMSCryptoAppKeysMngrCertLoadMemory;
     gXmlSecMSCryptoFunctions->cryptoAppKeysMngrCrlLoad          = xmlSecMSCryptoAppKeysMngrCrlLoad;
     gXmlSecMSCryptoFunctions->cryptoAppKeysMngrCrlLoadMemory    = xmlSecMSCryptoAppKeysMngrCrlLoadMemory;
+    gXmlSecMSCryptoFunctions->cryptoAppKeysMngrEnableX509VerifyCache = xmlSecMSCryptoAppKeysMngrEnableX509VerifyCache;
     gXmlSecMSCryptoFunctions->cryptoAppPkcs12Load               = xmlSecMSCryptoAppPkcs12Load;
     gXmlSecMSCryptoFunctions->cryptoAppPkcs12LoadMemory         = xmlSecMSCryptoAppPkcs12LoadMemory;
     gXmlSecMSCryptoFunctions->cryptoAppKeyCertLoad              = xmlSecMSCryptoAppKeyCertLoad;
@@ -293,6 +298,11 @@ xmlSecMSCryptoInit (void)  {
         xmlSecInternalError("xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms", NULL);
         return(-1);
     }
+
+    if(xmlSecMSCryptoProvidersPoolInit() < 0) {
+        xmlSecInternalError("xmlSecMSCryptoProvidersPoolInit", NULL);
+        return(-1);
+    }
     return(0);
 }
 
@@ -305,7 +315,7 @@ xmlSecMSCryptoInit (void)  {
  */
 int
 xmlSecMSCryptoShutdown(void) {
-    /* TODO: if necessary, do additional shutdown here */
+    xmlSecMSCryptoProvidersPoolShutdown();
     return(0);
 }
 
@@ -325,7 +335,7 @@ xmlSecMSCryptoKeysMngrInit(xmlSecKeysMngrPtr mngr) {
 
 #ifndef XMLSEC_NO_X509
     /* create x509 store if needed */
-    if(xmlSecKeysMngrGetDataStore(mngr, xmlSecMSCryptoX509StoreId) == NULL) {
+    if(xmlSecKeysMngrFindDataStore(mngr, xmlSecMSCryptoX509StoreId) == NULL) {
         xmlSecKeyDataStorePtr x509Store;
 
         x509Store = xmlSecKeyDataStoreCreate(xmlSecMSCryptoX509StoreId);
@@ -376,9 +386,9 @@ xmlSecMSCryptoGenerateRandom(xmlSecBufferPtr buffer, xmlSecSize size) {
         xmlSecInternalError2("xmlSecBufferSetSize", NULL, "size=" XMLSEC_SIZE_FMT, size);
         goto done;
     }
-    hProv = xmlSecMSCryptoFindProvider(xmlSecMSCryptoProviderInfo_Random, NULL, CRYPT_VERIFYCONTEXT, FALSE);
+    hProv = xmlSecMSCryptoProviderPoolGet(xmlSecMSCryptoProviderInfo_Random, CRYPT_VERIFYCONTEXT, FALSE);
     if (0 == hProv) {
-        xmlSecInternalError("xmlSecMSCryptoFindProvider", NULL);
+        xmlSecInternalError("xmlSecMSCryptoProviderPoolGet", NULL);
         goto done;
     }
 
@@ -394,7 +404,7 @@ xmlSecMSCryptoGenerateRandom(xmlSecBufferPtr buffer, xmlSecSize size) {
 done:
     /* cleanup */
     if (hProv != 0) {
-        CryptReleaseContext(hProv, 0);
+        xmlSecMSCryptoProviderPoolPut(hProv);
     }
     return(res);
 }
@@ -570,6 +580,305 @@ xmlSecMSCryptoFindProvider(const xmlSecMSCryptoProviderInfo * providers,
 }
 
 
+/********************************************************************
+ *
+ * Providers pool: CryptAcquireContext() is slow (and might create key
+ * containers), so the acquired handles are checked out from the pool
+ * by the transforms and returned back when the transform is done. A
+ * handle is used by one transform at a time. The pool entries are
+ * identified either by the providers list (for xmlSecMSCryptoFindProvider)
+ * or by the container name, provider name and type; and the flags.
+ *
+ ********************************************************************/
+#define XMLSEC_MSCRYPTO_PROVIDERS_POOL_MAX_SIZE         64
+
+typedef struct _xmlSecMSCryptoProvidersPoolEntry {
+    const xmlSecMSCryptoProviderInfo *  providers;
+    BOOL                                bUseXmlSecContainer;
+    LPWSTR                              pszContainer;
+    LPWSTR                              pszProvider;
+    DWORD                               dwProvType;
+    DWORD                               dwFlags;
+    HCRYPTPROV                          hProv;
+    int                                 inUse;
+} xmlSecMSCryptoProvidersPoolEntry, *xmlSecMSCryptoProvidersPoolEntryPtr;
+
+static xmlMutexPtr                      gXmlSecMSCryptoProvidersPoolMutex = NULL;
+static xmlSecMSCryptoProvidersPoolEntry gXmlSecMSCryptoProvidersPool[XMLSEC_MSCRYPTO_PROVIDERS_POOL_MAX_SIZE];
+static xmlSecSize                       gXmlSecMSCryptoProvidersPoolSize = 0;
+
+static int
+xmlSecMSCryptoProvidersPoolStrEqual(LPCWSTR str1, LPCWSTR str2) {
+    if((str1 == NULL) || (str2 == NULL)) {
+        return((str1 == str2) ? 1 : 0);
+    }
+    return((wcscmp(str1, str2) == 0) ? 1 : 0);
+}
+
+static LPWSTR
+xmlSecMSCryptoProvidersPoolStrdup(LPCWSTR str, int* err) {
+    LPWSTR res;
+    size_t len;
+
+    xmlSecAssert2(err != NULL, NULL);
+
+    if(str == NULL) {
+        return(NULL);
+    }
+    len = wcslen(str) + 1;
+    res = (LPWSTR)xmlMalloc(len * sizeof(WCHAR));
+    if(res == NULL) {
+        xmlSecMallocError(len * sizeof(WCHAR), NULL);
+        (*err) = 1;
+        return(NULL);
+    }
+    memcpy(res, str, len * sizeof(WCHAR));
+    return(res);
+}
+
+static void
+xmlSecMSCryptoProvidersPoolEntryFinalize(xmlSecMSCryptoProvidersPoolEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->hProv != 0) {
+        CryptReleaseContext(entry->hProv, 0);
+    }
+    if(entry->pszContainer != NULL) {
+        xmlFree(entry->pszContainer);
+    }
+    if(entry->pszProvider != NULL) {
+        xmlFree(entry->pszProvider);
+    }
+    memset(entry, 0, sizeof(xmlSecMSCryptoProvidersPoolEntry));
+}
+
+/* finds a free handle for @key and checks it out */
+static HCRYPTPROV
+xmlSecMSCryptoProvidersPoolCheckOut(const xmlSecMSCryptoProvidersPoolEntry* key) {
+    xmlSecMSCryptoProvidersPoolEntryPtr entry;
+    HCRYPTPROV res = 0;
+    xmlSecSize ii;
+
+    xmlSecAssert2(key != NULL, 0);
+
+    if(gXmlSecMSCryptoProvidersPoolMutex == NULL) {
+        return(0);
+    }
+
+    xmlMutexLock(gXmlSecMSCryptoProvidersPoolMutex);
+    for(ii = 0; ii < gXmlSecMSCryptoProvidersPoolSize; ++ii) {
+        entry = &(gXmlSecMSCryptoProvidersPool[ii]);
+        if((entry->inUse == 0) &&
+           (entry->providers == key->providers) &&
+           (entry->bUseXmlSecContainer == key->bUseXmlSecContainer) &&
+           (entry->dwProvType == key->dwProvType) &&
+           (entry->dwFlags == key->dwFlags) &&
+           (xmlSecMSCryptoProvidersPoolStrEqual(entry->pszContainer, key->pszContainer) == 1) &&
+           (xmlSecMSCryptoProvidersPoolStrEqual(entry->pszProvider, key->pszProvider) == 1)
+        ) {
+            entry->inUse = 1;
+            res = entry->hProv;
+            break;
+        }
+    }
+    xmlMutexUnlock(gXmlSecMSCryptoProvidersPoolMutex);
+
+    xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoAlgorithm, (res != 0) ? 1 : 0);
+    return(res);
+}
+
+/* adds the newly acquired (and checked out) handle to the pool if there is space */
+static void
+xmlSecMSCryptoProvidersPoolAdd(const xmlSecMSCryptoProvidersPoolEntry* key, HCRYPTPROV hProv) {
+    xmlSecMSCryptoProvidersPoolEntryPtr entry;
+    int err = 0;
+
+    xmlSecAssert(key != NULL);
+    xmlSecAssert(hProv != 0);
+
+    if(gXmlSecMSCryptoProvidersPoolMutex == NULL) {
+        return;
+    }
+
+    xmlMutexLock(gXmlSecMSCryptoProvidersPoolMutex);
+    if(gXmlSecMSCryptoProvidersPoolSize < XMLSEC_MSCRYPTO_PROVIDERS_POOL_MAX_SIZE) {
+        entry = &(gXmlSecMSCryptoProvidersPool[gXmlSecMSCryptoProvidersPoolSize]);
+        memset(entry, 0, sizeof(xmlSecMSCryptoProvidersPoolEntry));
+        entry->providers = key->providers;
+        entry->bUseXmlSecContainer = key->bUseXmlSecContainer;
+        entry->pszContainer = xmlSecMSCryptoProvidersPoolStrdup(key->pszContainer, &err);
+        entry->pszProvider = xmlSecMSCryptoProvidersPoolStrdup(key->pszProvider, &err);
+        entry->dwProvType = key->dwProvType;
+        entry->dwFlags = key->dwFlags;
+        if(err == 0) {
+            entry->hProv = hProv;
+            entry->inUse = 1;
+            ++gXmlSecMSCryptoProvidersPoolSize;
+        } else {
+            /* not fatal: the handle just stays out of the pool */
+            xmlSecMSCryptoProvidersPoolEntryFinalize(entry);
+        }
+    }
+    xmlMutexUnlock(gXmlSecMSCryptoProvidersPoolMutex);
+}
+
+/**
+ * xmlSecMSCryptoProvidersPoolInit:
+ *
+ * Initializes the providers pool.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecMSCryptoProvidersPoolInit(void) {
+    if(gXmlSecMSCryptoProvidersPoolMutex != NULL) {
+        return(0);
+    }
+
+    gXmlSecMSCryptoProvidersPoolMutex = xmlNewMutex();
+    if(gXmlSecMSCryptoProvidersPoolMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    memset(gXmlSecMSCryptoProvidersPool, 0, sizeof(gXmlSecMSCryptoProvidersPool));
+    gXmlSecMSCryptoProvidersPoolSize = 0;
+    return(0);
+}
+
+/**
+ * xmlSecMSCryptoProvidersPoolShutdown:
+ *
+ * Releases all the pooled provider handles.
+ */
+void
+xmlSecMSCryptoProvidersPoolShutdown(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecMSCryptoProvidersPoolMutex == NULL) {
+        return;
+    }
+    for(ii = 0; ii < gXmlSecMSCryptoProvidersPoolSize; ++ii) {
+        xmlSecMSCryptoProvidersPoolEntryFinalize(&(gXmlSecMSCryptoProvidersPool[ii]));
+    }
+    gXmlSecMSCryptoProvidersPoolSize = 0;
+
+    xmlFreeMutex(gXmlSecMSCryptoProvidersPoolMutex);
+    gXmlSecMSCryptoProvidersPoolMutex = NULL;
+}
+
+/**
+ * xmlSecMSCryptoProviderPoolGet:
+ * @providers:           the pointer to list of providers, last provider should have NULL for name.
+ * @dwFlags:             the flags for CryptAcquireContext call
+ * @bUseXmlSecContainer: the flag to indicate whether we should try to use XmlSec container if default fails
+ *
+ * Checks out a free provider handle from the pool or finds a new one
+ * with #xmlSecMSCryptoFindProvider (without container name). The handle
+ * should be returned with #xmlSecMSCryptoProviderPoolPut.
+ *
+ * Returns: provider handle on success or NULL for error.
+ */
+HCRYPTPROV
+xmlSecMSCryptoProviderPoolGet(const xmlSecMSCryptoProviderInfo * providers,
+                              DWORD dwFlags,
+                              BOOL bUseXmlSecContainer)
+{
+    xmlSecMSCryptoProvidersPoolEntry key;
+    HCRYPTPROV res;
+
+    xmlSecAssert2(providers != NULL, 0);
+
+    memset(&key, 0, sizeof(key));
+    key.providers = providers;
+    key.bUseXmlSecContainer = bUseXmlSecContainer;
+    key.dwFlags = dwFlags;
+
+    res = xmlSecMSCryptoProvidersPoolCheckOut(&key);
+    if(res != 0) {
+        return(res);
+    }
+
+    res = xmlSecMSCryptoFindProvider(providers, NULL, dwFlags, bUseXmlSecContainer);
+    if(res == 0) {
+        return(0);
+    }
+    xmlSecMSCryptoProvidersPoolAdd(&key, res);
+    return(res);
+}
+
+/**
+ * xmlSecMSCryptoProviderPoolGetW:
+ * @pszContainer:        the container name for CryptAcquireContextW call
+ * @pszProvider:         the provider name for CryptAcquireContextW call
+ * @dwProvType:          the provider type for CryptAcquireContextW call
+ * @dwFlags:             the flags for CryptAcquireContextW call
+ *
+ * Checks out a free provider handle from the pool or acquires a new one
+ * with CryptAcquireContextW. The handle should be returned with
+ * #xmlSecMSCryptoProviderPoolPut.
+ *
+ * Returns: provider handle on success or NULL for error (GetLastError()
+ * has the CryptAcquireContextW error).
+ */
+HCRYPTPROV
+xmlSecMSCryptoProviderPoolGetW(LPCWSTR pszContainer,
+                               LPCWSTR pszProvider,
+                               DWORD dwProvType,
+                               DWORD dwFlags)
+{
+    xmlSecMSCryptoProvidersPoolEntry key;
+    HCRYPTPROV res = 0;
+
+    memset(&key, 0, sizeof(key));
+    key.pszContainer = (LPWSTR)pszContainer;    /* remove const */
+    key.pszProvider = (LPWSTR)pszProvider;      /* remove const */
+    key.dwProvType = dwProvType;
+    key.dwFlags = dwFlags;
+
+    res = xmlSecMSCryptoProvidersPoolCheckOut(&key);
+    if(res != 0) {
+        return(res);
+    }
+
+    if(!CryptAcquireContextW(&res, pszContainer, pszProvider, dwProvType, dwFlags)) {
+        return(0);
+    }
+    xmlSecMSCryptoProvidersPoolAdd(&key, res);
+    return(res);
+}
+
+/**
+ * xmlSecMSCryptoProviderPoolPut:
+ * @hProv:               the provider handle.
+ *
+ * Returns the provider handle checked out with #xmlSecMSCryptoProviderPoolGet
+ * or #xmlSecMSCryptoProviderPoolGetW back to the pool (or releases it if
+ * it is not in the pool).
+ */
+void
+xmlSecMSCryptoProviderPoolPut(HCRYPTPROV hProv) {
+    xmlSecSize ii;
+    int found = 0;
+
+    if(hProv == 0) {
+        return;
+    }
+    if(gXmlSecMSCryptoProvidersPoolMutex != NULL) {
+        xmlMutexLock(gXmlSecMSCryptoProvidersPoolMutex);
+        for(ii = 0; ii < gXmlSecMSCryptoProvidersPoolSize; ++ii) {
+            if((gXmlSecMSCryptoProvidersPool[ii].hProv == hProv) && (gXmlSecMSCryptoProvidersPool[ii].inUse != 0)) {
+                gXmlSecMSCryptoProvidersPool[ii].inUse = 0;
+                found = 1;
+                break;
+            }
+        }
+        xmlMutexUnlock(gXmlSecMSCryptoProvidersPoolMutex);
+    }
+    if(found == 0) {
+        CryptReleaseContext(hProv, 0);
+    }
+}
+
 /********************************************************************
  *
  * Utils
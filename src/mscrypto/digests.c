@@ -237,13 +237,16 @@ xmlSecMSCryptoDigestInitialize(xmlSecTransformPtr transform) {
         return(-1);
     }
 
-    ctx->provider = xmlSecMSCryptoFindProvider(ctx->providers, NULL, CRYPT_VERIFYCONTEXT, TRUE);
+    ctx->provider = xmlSecMSCryptoProviderPoolGet(ctx->providers, CRYPT_VERIFYCONTEXT, TRUE);
     if(ctx->provider == 0) {
-        xmlSecInternalError("xmlSecMSCryptoFindProvider",
+        xmlSecInternalError("xmlSecMSCryptoProviderPoolGet",
                             xmlSecTransformGetName(transform));
         return(-1);
     }
 
+    /* the digest only reads the input, no need to copy it */
+    transform->borrowInput = 1;
+
     return(0);
 }
 
@@ -260,7 +263,7 @@ static void xmlSecMSCryptoDigestFinalize(xmlSecTransformPtr transform) {
         CryptDestroyHash(ctx->mscHash);
     }
     if(ctx->provider != 0) {
-        CryptReleaseContext(ctx->provider, 0);
+        xmlSecMSCryptoProviderPoolPut(ctx->provider);
     }
 
     memset(ctx, 0, sizeof(xmlSecMSCryptoDigestCtx));
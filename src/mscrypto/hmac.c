@@ -206,9 +206,9 @@ xmlSecMSCryptoHmacInitialize(xmlSecTransformPtr transform) {
         return(-1);
     }
 
-    ctx->provider = xmlSecMSCryptoFindProvider(ctx->providers, NULL, CRYPT_VERIFYCONTEXT, TRUE);
+    ctx->provider = xmlSecMSCryptoProviderPoolGet(ctx->providers, CRYPT_VERIFYCONTEXT, TRUE);
     if(ctx->provider == 0) {
-        xmlSecInternalError("xmlSecMSCryptoFindProvider",
+        xmlSecInternalError("xmlSecMSCryptoProviderPoolGet",
                             xmlSecTransformGetName(transform));
         return(-1);
     }
@@ -244,7 +244,7 @@ xmlSecMSCryptoHmacFinalize(xmlSecTransformPtr transform) {
         CryptDestroyKey(ctx->pubPrivKey);
     }
     if(ctx->provider != 0) {
-        CryptReleaseContext(ctx->provider, 0);
+        xmlSecMSCryptoProviderPoolPut(ctx->provider);
     }
 
     memset(ctx, 0, sizeof(xmlSecMSCryptoHmacCtx));
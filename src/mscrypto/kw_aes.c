@@ -59,6 +59,8 @@ static xmlSecKWAesKlass xmlSecMSCryptoKWAesKlass = {
     /* callbacks */
     xmlSecMSCryptoKWAesBlockEncrypt,        /* xmlSecKWAesBlockEncryptMethod       encrypt; */
     xmlSecMSCryptoKWAesBlockDecrypt,        /* xmlSecKWAesBlockDecryptMethod       decrypt; */
+    NULL,                                   /* xmlSecKWAesBlocksEncryptMethod      encryptBlocks; */
+    NULL,                                   /* xmlSecKWAesBlocksDecryptMethod      decryptBlocks; */
 
     /* for the future */
     NULL,                                   /* void*                               reserved0; */
@@ -167,9 +169,9 @@ xmlSecMSCryptoKWAesInitialize(xmlSecTransformPtr transform) {
     }
 
     /* find provider */
-    ctx->cryptProvider = xmlSecMSCryptoFindProvider(ctx->providers, NULL, CRYPT_VERIFYCONTEXT, TRUE);
+    ctx->cryptProvider = xmlSecMSCryptoProviderPoolGet(ctx->providers, CRYPT_VERIFYCONTEXT, TRUE);
     if(ctx->cryptProvider == 0) {
-        xmlSecInternalError("xmlSecMSCryptoFindProvider",
+        xmlSecInternalError("xmlSecMSCryptoProviderPoolGet",
                              xmlSecTransformGetName(transform));
         xmlSecMSCryptoKWAesFinalize(transform);
         return(-1);
@@ -200,7 +202,7 @@ xmlSecMSCryptoKWAesFinalize(xmlSecTransformPtr transform) {
         CryptDestroyKey(ctx->pubPrivKey);
     }
     if (ctx->cryptProvider) {
-        CryptReleaseContext(ctx->cryptProvider, 0);
+        xmlSecMSCryptoProviderPoolPut(ctx->cryptProvider);
     }
 
     xmlSecTransformKWAesFinalize(transform, &(ctx->parentCtx));
@@ -200,17 +200,17 @@ xmlSecMSCryptoKWDes3Initialize(xmlSecTransformPtr transform) {
     ctx->sha1Providers           = xmlSecMSCryptoProviderInfo_Sha1;
 
     /* find providers */
-    ctx->desCryptProvider = xmlSecMSCryptoFindProvider(ctx->desProviders, NULL, CRYPT_VERIFYCONTEXT, TRUE);
+    ctx->desCryptProvider = xmlSecMSCryptoProviderPoolGet(ctx->desProviders, CRYPT_VERIFYCONTEXT, TRUE);
     if(ctx->desCryptProvider == 0) {
-        xmlSecInternalError("xmlSecMSCryptoFindProvider(des)",
+        xmlSecInternalError("xmlSecMSCryptoProviderPoolGet(des)",
                             xmlSecTransformGetName(transform));
         xmlSecMSCryptoKWDes3Finalize(transform);
         return(-1);
     }
 
-    ctx->sha1CryptProvider = xmlSecMSCryptoFindProvider(ctx->sha1Providers, NULL, CRYPT_VERIFYCONTEXT, TRUE);
+    ctx->sha1CryptProvider = xmlSecMSCryptoProviderPoolGet(ctx->sha1Providers, CRYPT_VERIFYCONTEXT, TRUE);
     if(ctx->sha1CryptProvider == 0) {
-        xmlSecInternalError("xmlSecMSCryptoFindProvider(sha1)",
+        xmlSecInternalError("xmlSecMSCryptoProviderPoolGet(sha1)",
                             xmlSecTransformGetName(transform));
         xmlSecMSCryptoKWDes3Finalize(transform);
         return(-1);
@@ -241,10 +241,10 @@ xmlSecMSCryptoKWDes3Finalize(xmlSecTransformPtr transform) {
         CryptDestroyKey(ctx->pubPrivKey);
     }
     if (ctx->desCryptProvider) {
-        CryptReleaseContext(ctx->desCryptProvider, 0);
+        xmlSecMSCryptoProviderPoolPut(ctx->desCryptProvider);
     }
     if (ctx->sha1CryptProvider) {
-        CryptReleaseContext(ctx->sha1CryptProvider, 0);
+        xmlSecMSCryptoProviderPoolPut(ctx->sha1CryptProvider);
     }
 
     xmlSecTransformKWDes3Finalize(transform, &(ctx->parentCtx));
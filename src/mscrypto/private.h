@@ -73,6 +73,17 @@ HCRYPTPROV         xmlSecMSCryptoFindProvider                   (const xmlSecMSC
                                                                  DWORD dwFlags,
                                                                  BOOL bUseXmlSecContainer);
 
+int                xmlSecMSCryptoProvidersPoolInit              (void);
+void               xmlSecMSCryptoProvidersPoolShutdown          (void);
+HCRYPTPROV         xmlSecMSCryptoProviderPoolGet                (const xmlSecMSCryptoProviderInfo * providers,
+                                                                 DWORD dwFlags,
+                                                                 BOOL bUseXmlSecContainer);
+HCRYPTPROV         xmlSecMSCryptoProviderPoolGetW               (LPCWSTR pszContainer,
+                                                                 LPCWSTR pszProvider,
+                                                                 DWORD dwProvType,
+                                                                 DWORD dwFlags);
+void               xmlSecMSCryptoProviderPoolPut                (HCRYPTPROV hProv);
+
 
 /******************************************************************************
  *
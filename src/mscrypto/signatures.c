@@ -49,6 +49,7 @@ struct _xmlSecMSCryptoSignatureCtx {
     xmlSecKeyDataPtr    data;
     ALG_ID              alg_id;
     HCRYPTHASH          mscHash;
+    HCRYPTPROV          hProv;          /* the pooled provider (if the key's provider can't create the hash) */
     ALG_ID              digestAlgId;
     xmlSecKeyDataId     keyId;
 };
@@ -238,6 +239,9 @@ static void xmlSecMSCryptoSignatureFinalize(xmlSecTransformPtr transform) {
     if (ctx->mscHash) {
         CryptDestroyHash(ctx->mscHash);
     }
+    if (ctx->hProv != 0) {
+        xmlSecMSCryptoProviderPoolPut(ctx->hProv);
+    }
 
     if (ctx->data != NULL)  {
         xmlSecKeyDataDestroy(ctx->data);
@@ -486,37 +490,35 @@ xmlSecMSCryptoSignatureExecute(xmlSecTransformPtr transform, int last, xmlSecTra
             }
             hProv = (HCRYPTPROV)0;
 
-            if(!CryptAcquireContextW(&hProv,
+            ctx->hProv = xmlSecMSCryptoProviderPoolGetW(
                 pProviderInfo->pwszContainerName,
                 pProviderInfo->pwszProvName,
                 pProviderInfo->dwProvType,
-                0)) {
-
+                0);
+            if(ctx->hProv == 0) {
                 xmlSecMSCryptoError("CryptAcquireContext", NULL);
                 return(-1);
             }
 
-            bOk = CryptCreateHash(hProv, ctx->digestAlgId, 0, 0, &(ctx->mscHash));
+            bOk = CryptCreateHash(ctx->hProv, ctx->digestAlgId, 0, 0, &(ctx->mscHash));
         }
 
         //Last try it with PROV_RSA_AES provider type.
         if(!bOk) {
-            if (!CryptReleaseContext(hProv, 0)) {
-                xmlSecMSCryptoError("CryptReleaseContext", NULL);
-                return(-1);
-            }
-            hProv = (HCRYPTPROV)0;
+            xmlSecMSCryptoProviderPoolPut(ctx->hProv);
+            ctx->hProv = (HCRYPTPROV)0;
 
-            if(!CryptAcquireContextW(&hProv,
+            ctx->hProv = xmlSecMSCryptoProviderPoolGetW(
                 pProviderInfo->pwszContainerName,
                 NULL,
                 PROV_RSA_AES,
-                0)) {
+                0);
+            if(ctx->hProv == 0) {
                 xmlSecMSCryptoError("CryptAcquireContext", NULL);
                 return(-1);
             }
 
-            bOk = CryptCreateHash(hProv, ctx->digestAlgId, 0, 0, &(ctx->mscHash));
+            bOk = CryptCreateHash(ctx->hProv, ctx->digestAlgId, 0, 0, &(ctx->mscHash));
         }
 
         if(pProviderInfo != NULL) {
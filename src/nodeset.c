@@ -25,24 +25,124 @@
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/nodeset.h>
+#include <xmlsec/memstats.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/private.h>
 
 #include "cast_helpers.h"
+#include "docindex_helpers.h"
+
+/**************************************************************************
+ *
+ * xmlSecNodeSetIndex: open addressing hash table over xmlSecNodeSet nodes
+ * list. The namespace nodes in the XPath nodes set are copies of the
+ * original xmlNs structures (see libxml2 xpath.c) thus they are indexed
+ * by (parent element, prefix) pair instead of the pointer.
+ *
+ *************************************************************************/
+#define XMLSEC_NODESET_INDEX_MIN_SIZE           16
+
+typedef struct _xmlSecNodeSetIndex              xmlSecNodeSetIndex,
+                                                *xmlSecNodeSetIndexPtr;
+struct _xmlSecNodeSetIndex {
+    xmlNodePtr*         table;
+    xmlSecSize          tableSize;      /* power of 2 */
+    int                 nodeNr;         /* nodes->nodeNr when index was built */
+};
+
+/**************************************************************************
+ *
+ * xmlSecNodeSetVisibility: the visibility of every document node (including
+ * attributes and in-scope namespaces) in the combined nodes set computed in
+ * a single document walk. Used for the nodes sets that combine several
+ * nodes sets (e.g. XPath Filter 2.0 transforms) where evaluating the whole
+ * chain for each node is expensive.
+ *
+ *************************************************************************/
+typedef struct _xmlSecNodeSetVisibilityEntry    xmlSecNodeSetVisibilityEntry,
+                                                *xmlSecNodeSetVisibilityEntryPtr;
+struct _xmlSecNodeSetVisibilityEntry {
+    xmlNodePtr          node;
+    xmlNodePtr          parent;
+    int                 visible;
+};
+
+typedef struct _xmlSecNodeSetVisibility         xmlSecNodeSetVisibility,
+                                                *xmlSecNodeSetVisibilityPtr;
+struct _xmlSecNodeSetVisibility {
+    xmlSecNodeSetVisibilityEntryPtr table;      /* NULL if visibility is not available */
+    xmlSecSize          tableSize;              /* power of 2 */
+    xmlSecSize          count;
+
+    /* used only while building the table */
+    xmlSecNodeSetPtr*   leaves;
+    xmlSecSize          leavesNum;
+    xmlSecByte*         stack;                  /* leavesNum bytes per tree level */
+    xmlSecSize          stackSize;
+};
+
+#define XMLSEC_NODESET_WALKER_MIN_SIZE          16
+
+typedef struct _xmlSecNodeSetWalker             xmlSecNodeSetWalker,
+                                                *xmlSecNodeSetWalkerPtr;
+struct _xmlSecNodeSetWalker {
+    xmlSecNodeSetPtr    nset;
+    xmlDocPtr           doc;
+    xmlNsPtr*           inScopeNs;              /* the top is the first nsDef of the current element */
+    xmlSecSize          inScopeNsSize;
+    xmlSecSize          inScopeNsMaxSize;
+
+    /* single tree nodes set: if the node at the given depth or its ancestor is in the nodes list */
+    int                 simpleTree;
+    xmlSecSize          rootDepth;
+    xmlSecByte*         inTree;
+    xmlSecSize          inTreeMaxSize;
+};
+
+typedef int             (*xmlSecNodeSetWalkerVisitor)   (xmlSecNodeSetWalkerPtr walker,
+                                                         xmlNodePtr cur,
+                                                         xmlNodePtr parent,
+                                                         xmlSecSize depth,
+                                                         void* data);
+
+typedef struct _xmlSecNodeSetWalkCtx {
+    xmlSecNodeSetWalkCallback   walkFunc;
+    void*                       data;
+} xmlSecNodeSetWalkCtx, *xmlSecNodeSetWalkCtxPtr;
 
 #define xmlSecGetParent(node)           \
     (((node)->type != XML_NAMESPACE_DECL) ? \
         (node)->parent : \
         (xmlNodePtr)((xmlNsPtr)(node))->next)
 
+static void     xmlSecNodeSetIndexDestroy               (xmlSecNodeSetIndexPtr index);
+static int      xmlSecNodeSetIndexContains              (xmlSecNodeSetPtr nset,
+                                                         xmlNodePtr node,
+                                                         xmlNodePtr parent);
+static void     xmlSecNodeSetVisibilityDestroy          (xmlSecNodeSetVisibilityPtr vis);
+static int      xmlSecNodeSetVisibilityGet              (xmlSecNodeSetPtr nset,
+                                                         xmlNodePtr node,
+                                                         xmlNodePtr parent);
+static int      xmlSecNodeSetContainsInternal           (xmlSecNodeSetPtr nset,
+                                                         xmlNodePtr node,
+                                                         xmlNodePtr parent);
+static int      xmlSecNodeSetOneContainsNodes           (xmlSecNodeSetPtr nset,
+                                                         xmlNodePtr node,
+                                                         xmlNodePtr parent);
 static int      xmlSecNodeSetOneContains                (xmlSecNodeSetPtr nset,
                                                          xmlNodePtr node,
                                                          xmlNodePtr parent);
-static int      xmlSecNodeSetWalkRecursive              (xmlSecNodeSetPtr nset,
-                                                         xmlSecNodeSetWalkCallback walkFunc,
-                                                         void* data,
+static int      xmlSecNodeSetWalkerRun                  (xmlSecNodeSetPtr nset,
+                                                         xmlNodePtr root,
+                                                         xmlNodePtr rootParent,
+                                                         xmlSecSize rootDepth,
+                                                         xmlSecNodeSetWalkerVisitor visitor,
+                                                         void* data);
+static int      xmlSecNodeSetWalkVisit                  (xmlSecNodeSetWalkerPtr walker,
                                                          xmlNodePtr cur,
-                                                         xmlNodePtr parent);
+                                                         xmlNodePtr parent,
+                                                         xmlSecSize depth,
+                                                         void* data);
 
 /**
  * xmlSecNodeSetCreate:
@@ -65,6 +165,12 @@ xmlSecNodeSetCreate(xmlDocPtr doc, xmlNodeSetPtr nodes, xmlSecNodeSetType type)
         return(NULL);
     }
     memset(nset, 0,  sizeof(xmlSecNodeSet));
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagNodeSet, 0, sizeof(xmlSecNodeSet)) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate", NULL);
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagNodeSet, sizeof(xmlSecNodeSet), 0);
+        xmlFree(nset);
+        return(NULL);
+    }
 
     nset->doc   = doc;
     nset->nodes = nodes;
@@ -98,6 +204,12 @@ xmlSecNodeSetDestroy(xmlSecNodeSetPtr nset) {
         if(tmp->nodes != NULL) {
             xmlXPathFreeNodeSet(tmp->nodes);
         }
+        if(tmp->index != NULL) {
+            xmlSecNodeSetIndexDestroy(tmp->index);
+        }
+        if(tmp->visibility != NULL) {
+            xmlSecNodeSetVisibilityDestroy(tmp->visibility);
+        }
         if(tmp->children != NULL) {
             xmlSecNodeSetDestroy(tmp->children);
         }
@@ -107,6 +219,7 @@ xmlSecNodeSetDestroy(xmlSecNodeSetPtr nset) {
             destroyDoc = tmp->doc; /* can't destroy here because other node sets can refer to it */
         }
         memset(tmp, 0,  sizeof(xmlSecNodeSet));
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagNodeSet, sizeof(xmlSecNodeSet), 0);
         xmlFree(tmp);
     }
 
@@ -129,29 +242,177 @@ xmlSecNodeSetDocDestroy(xmlSecNodeSetPtr nset) {
     nset->destroyDoc = 1;
 }
 
-static int
-xmlSecNodeSetOneContains(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent) {
-    int in_nodes_set = 1;
+static xmlSecSize
+xmlSecNodeSetIndexHashPtr(const void* ptr) {
+    xmlSecSize hash = (xmlSecSize)((size_t)ptr);
 
-    xmlSecAssert2(nset != NULL, 0);
+    /* pointers are aligned, mix the bits a bit */
+    hash ^= (hash >> 4) ^ (hash >> 12);
+    return(hash * 2654435761U);
+}
+
+static xmlSecSize
+xmlSecNodeSetIndexHashNs(xmlNodePtr parent, const xmlChar* prefix) {
+    xmlSecSize hash = xmlSecNodeSetIndexHashPtr(parent);
+
+    if(prefix != NULL) {
+        for(; (*prefix) != '\0'; ++prefix) {
+            hash = (hash ^ (*prefix)) * 16777619U;
+        }
+    }
+    return(hash);
+}
+
+static xmlSecSize
+xmlSecNodeSetIndexHashNode(xmlNodePtr node) {
     xmlSecAssert2(node != NULL, 0);
 
-    /* special cases: */
-    switch(nset->type) {
-        case xmlSecNodeSetTreeWithoutComments:
-        case xmlSecNodeSetTreeWithoutCommentsInvert:
-            if(node->type == XML_COMMENT_NODE) {
-                return(0);
+    if(node->type == XML_NAMESPACE_DECL) {
+        return(xmlSecNodeSetIndexHashNs((xmlNodePtr)(((xmlNsPtr)node)->next), ((xmlNsPtr)node)->prefix));
+    }
+    return(xmlSecNodeSetIndexHashPtr(node));
+}
+
+static xmlSecNodeSetIndexPtr
+xmlSecNodeSetIndexCreate(xmlNodeSetPtr nodes) {
+    xmlSecNodeSetIndexPtr index;
+    xmlSecSize nodesSize, pos;
+    int jj;
+
+    xmlSecAssert2(nodes != NULL, NULL);
+    xmlSecAssert2(nodes->nodeNr > 0, NULL);
+
+    index = (xmlSecNodeSetIndexPtr)xmlMalloc(sizeof(xmlSecNodeSetIndex));
+    if(index == NULL) {
+        xmlSecMallocError(sizeof(xmlSecNodeSetIndex), NULL);
+        return(NULL);
+    }
+    memset(index, 0, sizeof(xmlSecNodeSetIndex));
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagNodeSet, 0, sizeof(xmlSecNodeSetIndex));
+
+    /* keep load factor under 1/2 */
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(nodes->nodeNr, nodesSize, xmlSecNodeSetIndexDestroy(index); return(NULL), NULL);
+    for(index->tableSize = 32; index->tableSize < 2 * nodesSize; index->tableSize *= 2);
+
+    index->table = (xmlNodePtr*)xmlMalloc(index->tableSize * sizeof(xmlNodePtr));
+    if(index->table == NULL) {
+        xmlSecMallocError(index->tableSize * sizeof(xmlNodePtr), NULL);
+        xmlSecNodeSetIndexDestroy(index);
+        return(NULL);
+    }
+    memset(index->table, 0, index->tableSize * sizeof(xmlNodePtr));
+
+    /* the caller falls back to the linear search */
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagNodeSet, 0, index->tableSize * sizeof(xmlNodePtr)) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate", NULL);
+        xmlSecNodeSetIndexDestroy(index);
+        return(NULL);
+    }
+
+    for(jj = 0; jj < nodes->nodeNr; ++jj) {
+        xmlNodePtr cur = nodes->nodeTab[jj];
+        if(cur == NULL) {
+            continue;
+        }
+        pos = xmlSecNodeSetIndexHashNode(cur) & (index->tableSize - 1);
+        while((index->table[pos] != NULL) && (index->table[pos] != cur)) {
+            pos = (pos + 1) & (index->tableSize - 1);
+        }
+        index->table[pos] = cur;
+    }
+    index->nodeNr = nodes->nodeNr;
+    return(index);
+}
+
+static void
+xmlSecNodeSetIndexDestroy(xmlSecNodeSetIndexPtr index) {
+    xmlSecAssert(index != NULL);
+
+    if(index->table != NULL) {
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagNodeSet, index->tableSize * sizeof(xmlNodePtr), 0);
+        xmlFree(index->table);
+    }
+    memset(index, 0, sizeof(xmlSecNodeSetIndex));
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagNodeSet, sizeof(xmlSecNodeSetIndex), 0);
+    xmlFree(index);
+}
+
+/* Returns 1 if node is in the nset->nodes, 0 if it is not and a negative value
+ * if the index is not available (caller should fallback to linear search) */
+static int
+xmlSecNodeSetIndexContains(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent) {
+    xmlSecNodeSetIndexPtr index;
+    xmlNodePtr cur;
+    xmlSecSize pos;
+
+    xmlSecAssert2(nset != NULL, -1);
+    xmlSecAssert2(nset->nodes != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* small sets are faster to scan */
+    if(nset->nodes->nodeNr < XMLSEC_NODESET_INDEX_MIN_SIZE) {
+        return(-1);
+    }
+
+    /* (re)build the index if needed */
+    if((nset->index != NULL) && (nset->index->nodeNr != nset->nodes->nodeNr)) {
+        xmlSecNodeSetIndexDestroy(nset->index);
+        nset->index = NULL;
+    }
+    if(nset->index == NULL) {
+        nset->index = xmlSecNodeSetIndexCreate(nset->nodes);
+        if(nset->index == NULL) {
+            xmlSecInternalError("xmlSecNodeSetIndexCreate", NULL);
+            return(-1);
+        }
+    }
+    index = nset->index;
+
+    if(node->type != XML_NAMESPACE_DECL) {
+        pos = xmlSecNodeSetIndexHashPtr(node) & (index->tableSize - 1);
+        while((cur = index->table[pos]) != NULL) {
+            if(cur == node) {
+                return(1);
             }
-            break;
-        case xmlSecNodeSetList:
-            return(xmlSecNodeSetContains(nset->children, node, parent));
-        default:
-            break;
+            pos = (pos + 1) & (index->tableSize - 1);
+        }
+    } else {
+        xmlNsPtr ns = (xmlNsPtr)node;
+
+        /* this is a libxml hack! check xpath.c for details */
+        if((parent != NULL) && (parent->type == XML_ATTRIBUTE_NODE)) {
+            parent = parent->parent;
+        }
+        if(parent == NULL) {
+            return(0);
+        }
+
+        pos = xmlSecNodeSetIndexHashNs(parent, ns->prefix) & (index->tableSize - 1);
+        while((cur = index->table[pos]) != NULL) {
+            if((cur->type == XML_NAMESPACE_DECL) &&
+               (((xmlNsPtr)cur)->next == (xmlNsPtr)parent) &&
+               xmlStrEqual(((xmlNsPtr)cur)->prefix, ns->prefix)) {
+                return(1);
+            }
+            pos = (pos + 1) & (index->tableSize - 1);
+        }
     }
+    return(0);
+}
+
+/* checks if node is in the nset->nodes list (or returns 1 if there is no list) */
+static int
+xmlSecNodeSetOneContainsNodes(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent) {
+    int in_nodes_set = 1;
+
+    xmlSecAssert2(nset != NULL, 0);
+    xmlSecAssert2(node != NULL, 0);
 
     if(nset->nodes != NULL) {
-        if(node->type != XML_NAMESPACE_DECL) {
+        in_nodes_set = xmlSecNodeSetIndexContains(nset, node, parent);
+        if(in_nodes_set >= 0) {
+            /* done */
+        } else if(node->type != XML_NAMESPACE_DECL) {
             in_nodes_set = xmlXPathNodeSetContains(nset->nodes, node);
         } else {
             xmlNs ns;
@@ -172,30 +433,56 @@ xmlSecNodeSetOneContains(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr pare
             in_nodes_set = (xmlXPathNodeSetContains(nset->nodes, (xmlNodePtr)&ns));
         }
     }
+    return(in_nodes_set);
+}
+
+/* checks if @node or any of its ancestor elements is in the nset->nodes list */
+static int
+xmlSecNodeSetOneInTree(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent) {
+    int in_nodes_set;
+
+    xmlSecAssert2(nset != NULL, 0);
+    xmlSecAssert2(node != NULL, 0);
+
+    in_nodes_set = xmlSecNodeSetOneContainsNodes(nset, node, parent);
+    while((!in_nodes_set) && (parent != NULL) && (parent->type == XML_ELEMENT_NODE)) {
+        node = parent;
+        parent = parent->parent;
+        in_nodes_set = xmlSecNodeSetOneContainsNodes(nset, node, parent);
+    }
+    return(in_nodes_set);
+}
+
+static int
+xmlSecNodeSetOneContains(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent) {
+    xmlSecAssert2(nset != NULL, 0);
+    xmlSecAssert2(node != NULL, 0);
+
+    /* special cases: */
+    switch(nset->type) {
+        case xmlSecNodeSetTreeWithoutComments:
+        case xmlSecNodeSetTreeWithoutCommentsInvert:
+            if(node->type == XML_COMMENT_NODE) {
+                return(0);
+            }
+            break;
+        case xmlSecNodeSetList:
+            return(xmlSecNodeSetContainsInternal(nset->children, node, parent));
+        default:
+            break;
+    }
 
     switch(nset->type) {
     case xmlSecNodeSetNormal:
-        return(in_nodes_set);
+        return(xmlSecNodeSetOneContainsNodes(nset, node, parent));
     case xmlSecNodeSetInvert:
-        return(!in_nodes_set);
+        return(!xmlSecNodeSetOneContainsNodes(nset, node, parent));
     case xmlSecNodeSetTree:
     case xmlSecNodeSetTreeWithoutComments:
-        if(in_nodes_set) {
-            return(1);
-        }
-        if((parent != NULL) && (parent->type == XML_ELEMENT_NODE)) {
-            return(xmlSecNodeSetOneContains(nset, parent, parent->parent));
-        }
-        return(0);
+        return(xmlSecNodeSetOneInTree(nset, node, parent));
     case xmlSecNodeSetTreeInvert:
     case xmlSecNodeSetTreeWithoutCommentsInvert:
-        if(in_nodes_set) {
-            return(0);
-        }
-        if((parent != NULL) && (parent->type == XML_ELEMENT_NODE)) {
-            return(xmlSecNodeSetOneContains(nset, parent, parent->parent));
-        }
-        return(1);
+        return(!xmlSecNodeSetOneInTree(nset, node, parent));
     default:
         xmlSecUnsupportedEnumValueError("node set type", nset->type, NULL);
         return(0);
@@ -215,6 +502,25 @@ xmlSecNodeSetOneContains(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr pare
  */
 int
 xmlSecNodeSetContains(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent) {
+    int ret;
+
+    xmlSecAssert2(node != NULL, 0);
+
+    /* special cases: */
+    if(nset == NULL) {
+        return(1);
+    }
+
+    /* try precomputed visibility first */
+    ret = xmlSecNodeSetVisibilityGet(nset, node, parent);
+    if(ret >= 0) {
+        return(ret);
+    }
+    return(xmlSecNodeSetContainsInternal(nset, node, parent));
+}
+
+static int
+xmlSecNodeSetContainsInternal(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent) {
     int status = 1;
     xmlSecNodeSetPtr cur;
 
@@ -255,6 +561,719 @@ xmlSecNodeSetContains(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent)
     return(status);
 }
 
+/**************************************************************************
+ *
+ * xmlSecNodeSetWalker: iterative document subtree walk (the deep documents
+ * do not exhaust the stack). The namespaces in scope are tracked during
+ * the walk instead of searching the ancestors with xmlSearchNs() for
+ * every namespace of every element.
+ *
+ *************************************************************************/
+static xmlNsPtr
+xmlSecNodeSetWalkerGetNsList(xmlNodePtr node) {
+    xmlSecAssert2(node != NULL, NULL);
+
+    switch(node->type) {
+    case XML_ELEMENT_NODE:
+        return(node->nsDef);
+    case XML_DOCUMENT_NODE:
+    case XML_HTML_DOCUMENT_NODE:
+        /* the xml namespace */
+        return(((xmlDocPtr)node)->oldNs);
+    default:
+        return(NULL);
+    }
+}
+
+/* ensures there is space for @size more namespaces in the stack */
+static int
+xmlSecNodeSetWalkerReserve(xmlSecNodeSetWalkerPtr walker, xmlSecSize size) {
+    xmlNsPtr* newInScopeNs;
+    xmlSecSize newSize;
+
+    xmlSecAssert2(walker != NULL, -1);
+
+    if(walker->inScopeNsSize + size <= walker->inScopeNsMaxSize) {
+        return(0);
+    }
+    newSize = 2 * (walker->inScopeNsSize + size) + XMLSEC_NODESET_WALKER_MIN_SIZE;
+    newInScopeNs = (xmlNsPtr*)xmlRealloc(walker->inScopeNs, newSize * sizeof(xmlNsPtr));
+    if(newInScopeNs == NULL) {
+        xmlSecMallocError(newSize * sizeof(xmlNsPtr), NULL);
+        return(-1);
+    }
+    walker->inScopeNs = newInScopeNs;
+    walker->inScopeNsMaxSize = newSize;
+    return(0);
+}
+
+static xmlSecSize
+xmlSecNodeSetWalkerGetNsListSize(xmlNsPtr nsList) {
+    xmlSecSize size = 0;
+
+    for(; nsList != NULL; nsList = nsList->next) {
+        ++size;
+    }
+    return(size);
+}
+
+/* pushes the namespaces declared on @node and (if @withAncestors is set) its ancestors,
+ * the stack order is the xmlSearchNs() search order from the top */
+static int
+xmlSecNodeSetWalkerPush(xmlSecNodeSetWalkerPtr walker, xmlNodePtr node, int withAncestors) {
+    xmlSecDocIndexPtr index = NULL;
+    xmlNodePtr cur;
+    xmlNsPtr ns;
+    xmlSecSize size = 0;
+    xmlSecSize pos;
+    int ret;
+
+    xmlSecAssert2(walker != NULL, -1);
+
+    /* the document index skips the ancestors without namespace declarations */
+    if(withAncestors != 0) {
+        index = xmlSecDocIndexAcquire(walker->doc);
+    }
+
+    for(cur = node; cur != NULL; cur = (withAncestors != 0) ? xmlSecDocIndexGetNextNsHolder(index, cur) : NULL) {
+        size += xmlSecNodeSetWalkerGetNsListSize(xmlSecNodeSetWalkerGetNsList(cur));
+    }
+    if(size == 0) {
+        return(0);
+    }
+
+    ret = xmlSecNodeSetWalkerReserve(walker, size);
+    if(ret < 0) {
+        return(-1);
+    }
+    pos = walker->inScopeNsSize + size;
+    for(cur = node; cur != NULL; cur = (withAncestors != 0) ? xmlSecDocIndexGetNextNsHolder(index, cur) : NULL) {
+        for(ns = xmlSecNodeSetWalkerGetNsList(cur); ns != NULL; ns = ns->next) {
+            walker->inScopeNs[--pos] = ns;
+        }
+    }
+    walker->inScopeNsSize += size;
+    return(0);
+}
+
+static void
+xmlSecNodeSetWalkerPop(xmlSecNodeSetWalkerPtr walker, xmlNodePtr node) {
+    xmlSecSize size;
+
+    xmlSecAssert(walker != NULL);
+    xmlSecAssert(node != NULL);
+
+    size = xmlSecNodeSetWalkerGetNsListSize(xmlSecNodeSetWalkerGetNsList(node));
+    xmlSecAssert(size <= walker->inScopeNsSize);
+    walker->inScopeNsSize -= size;
+}
+
+/* checks if xmlSearchNs() for the current element would return walker->inScopeNs[pos] */
+static int
+xmlSecNodeSetWalkerIsActiveNs(xmlSecNodeSetWalkerPtr walker, xmlSecSize pos) {
+    xmlNsPtr ns, cur;
+    xmlSecSize ii;
+
+    xmlSecAssert2(walker != NULL, 0);
+    xmlSecAssert2(walker->doc != NULL, 0);
+    xmlSecAssert2(pos < walker->inScopeNsSize, 0);
+
+    ns = walker->inScopeNs[pos];
+    if(ns->prefix == NULL) {
+        if(ns->href == NULL) {
+            return(0);
+        }
+    } else if(xmlStrEqual(ns->prefix, BAD_CAST "xml")) {
+        /* xmlSearchNs() always returns the document xml namespace */
+        return((ns == walker->doc->oldNs) ? 1 : 0);
+    }
+
+    for(ii = pos + 1; ii < walker->inScopeNsSize; ++ii) {
+        cur = walker->inScopeNs[ii];
+        if(ns->prefix == NULL) {
+            if((cur->prefix == NULL) && (cur->href != NULL)) {
+                return(0);
+            }
+        } else if((cur->prefix != NULL) && xmlStrEqual(cur->prefix, ns->prefix)) {
+            return(0);
+        }
+    }
+    return(1);
+}
+
+/* same as xmlSecNodeSetContains() for the node at @depth: for the single tree nodes
+ * sets the ancestors are not searched again (the parent result is used instead) */
+static int
+xmlSecNodeSetWalkerContains(xmlSecNodeSetWalkerPtr walker, xmlNodePtr node, xmlNodePtr parent, xmlSecSize depth) {
+    xmlSecNodeSetPtr nset;
+    int in_nodes_set;
+
+    xmlSecAssert2(walker != NULL, 0);
+    xmlSecAssert2(walker->nset != NULL, 0);
+    xmlSecAssert2(node != NULL, 0);
+
+    nset = walker->nset;
+    if(walker->simpleTree == 0) {
+        return(xmlSecNodeSetContains(nset, node, parent));
+    }
+    xmlSecAssert2(depth >= walker->rootDepth, 0);
+    xmlSecAssert2(depth < walker->inTreeMaxSize, 0);
+
+    if(depth == walker->rootDepth) {
+        in_nodes_set = xmlSecNodeSetOneInTree(nset, node, parent);
+    } else {
+        in_nodes_set = xmlSecNodeSetOneContainsNodes(nset, node, parent);
+        if((!in_nodes_set) && (parent != NULL) && (parent->type == XML_ELEMENT_NODE)) {
+            in_nodes_set = walker->inTree[depth - 1];
+        }
+    }
+    if((node->type != XML_ATTRIBUTE_NODE) && (node->type != XML_NAMESPACE_DECL)) {
+        walker->inTree[depth] = (in_nodes_set != 0) ? 1 : 0;
+    }
+
+    switch(nset->type) {
+    case xmlSecNodeSetTree:
+        return(in_nodes_set);
+    case xmlSecNodeSetTreeWithoutComments:
+        return((node->type != XML_COMMENT_NODE) ? in_nodes_set : 0);
+    case xmlSecNodeSetTreeInvert:
+        return(!in_nodes_set);
+    case xmlSecNodeSetTreeWithoutCommentsInvert:
+        return((node->type != XML_COMMENT_NODE) ? !in_nodes_set : 0);
+    default:
+        xmlSecUnsupportedEnumValueError("node set type", nset->type, NULL);
+        return(0);
+    }
+}
+
+/* walks the @root subtree (the children of the element and document nodes only)
+ * in the document order and calls @visitor for every node */
+static int
+xmlSecNodeSetWalkerRun(xmlSecNodeSetPtr nset, xmlNodePtr root, xmlNodePtr rootParent, xmlSecSize rootDepth,
+                       xmlSecNodeSetWalkerVisitor visitor, void* data) {
+    xmlSecNodeSetWalker walker;
+    xmlNodePtr cur, parent;
+    xmlSecSize depth;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(nset != NULL, -1);
+    xmlSecAssert2(nset->doc != NULL, -1);
+    xmlSecAssert2(root != NULL, -1);
+    xmlSecAssert2(visitor != NULL, -1);
+
+    memset(&walker, 0, sizeof(walker));
+    walker.nset = nset;
+    walker.doc = nset->doc;
+    walker.rootDepth = rootDepth;
+
+    /* the single tree nodes set (the visibility doesn't depend on other sets) */
+    if((nset->next == nset) && (nset->op == xmlSecNodeSetIntersection) && (nset->visibility == NULL)) {
+        switch(nset->type) {
+        case xmlSecNodeSetTree:
+        case xmlSecNodeSetTreeWithoutComments:
+        case xmlSecNodeSetTreeInvert:
+        case xmlSecNodeSetTreeWithoutCommentsInvert:
+            walker.simpleTree = 1;
+            break;
+        default:
+            break;
+        }
+    }
+
+    /* the namespaces declared on the root ancestors are in scope */
+    if(root->type == XML_ELEMENT_NODE) {
+        ret = xmlSecNodeSetWalkerPush(&walker, root->parent, 1);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecNodeSetWalkerPush", NULL);
+            goto done;
+        }
+    }
+
+    cur = root;
+    parent = rootParent;
+    depth = rootDepth;
+    while(1) {
+        /* the node and its attributes and namespaces (at depth + 1) */
+        if((walker.simpleTree != 0) && (depth + 2 > walker.inTreeMaxSize)) {
+            xmlSecByte* newInTree;
+            xmlSecSize newSize = 2 * (depth + 2) + XMLSEC_NODESET_WALKER_MIN_SIZE;
+
+            newInTree = (xmlSecByte*)xmlRealloc(walker.inTree, newSize);
+            if(newInTree == NULL) {
+                xmlSecMallocError(newSize, NULL);
+                goto done;
+            }
+            walker.inTree = newInTree;
+            walker.inTreeMaxSize = newSize;
+        }
+        if((cur->type == XML_ELEMENT_NODE) || (cur->type == XML_DOCUMENT_NODE)) {
+            ret = xmlSecNodeSetWalkerPush(&walker, cur, 0);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecNodeSetWalkerPush", NULL);
+                goto done;
+            }
+        }
+
+        ret = visitor(&walker, cur, parent, depth, data);
+        if(ret < 0) {
+            res = ret;
+            goto done;
+        }
+
+        /* element and document nodes have children */
+        if(((cur->type == XML_ELEMENT_NODE) || (cur->type == XML_DOCUMENT_NODE)) && (cur->children != NULL)) {
+            parent = cur;
+            cur = cur->children;
+            ++depth;
+            continue;
+        }
+
+        /* the next sibling or the next sibling of the nearest ancestor */
+        while(1) {
+            if((cur->type == XML_ELEMENT_NODE) || (cur->type == XML_DOCUMENT_NODE)) {
+                xmlSecNodeSetWalkerPop(&walker, cur);
+            }
+            if(cur == root) {
+                res = 0;
+                goto done;
+            }
+            if(cur->next != NULL) {
+                cur = cur->next;
+                break;
+            }
+            cur = parent;
+            parent = cur->parent;
+            --depth;
+        }
+    }
+
+done:
+    if(walker.inTree != NULL) {
+        xmlFree(walker.inTree);
+    }
+    if(walker.inScopeNs != NULL) {
+        xmlFree(walker.inScopeNs);
+    }
+    return(res);
+}
+
+/**************************************************************************
+ *
+ * xmlSecNodeSetVisibility
+ *
+ *************************************************************************/
+#define XMLSEC_NODESET_VISIBILITY_INITIAL_SIZE  1024
+
+static void
+xmlSecNodeSetVisibilityDestroy(xmlSecNodeSetVisibilityPtr vis) {
+    xmlSecAssert(vis != NULL);
+
+    if(vis->table != NULL) {
+        xmlFree(vis->table);
+    }
+    if(vis->leaves != NULL) {
+        xmlFree(vis->leaves);
+    }
+    if(vis->stack != NULL) {
+        xmlFree(vis->stack);
+    }
+    memset(vis, 0, sizeof(xmlSecNodeSetVisibility));
+    xmlFree(vis);
+}
+
+static xmlSecSize
+xmlSecNodeSetVisibilityHash(xmlNodePtr node, xmlNodePtr parent) {
+    xmlSecSize hash;
+
+    hash = ((xmlSecSize)((size_t)node)) ^ (((xmlSecSize)((size_t)parent)) >> 3);
+    hash ^= (hash >> 4) ^ (hash >> 12);
+    return(hash * 2654435761U);
+}
+
+static xmlSecNodeSetVisibilityEntryPtr
+xmlSecNodeSetVisibilityFind(xmlSecNodeSetVisibilityEntryPtr table, xmlSecSize tableSize,
+                            xmlNodePtr node, xmlNodePtr parent) {
+    xmlSecSize pos;
+
+    xmlSecAssert2(table != NULL, NULL);
+    xmlSecAssert2(node != NULL, NULL);
+
+    pos = xmlSecNodeSetVisibilityHash(node, parent) & (tableSize - 1);
+    while((table[pos].node != NULL) && ((table[pos].node != node) || (table[pos].parent != parent))) {
+        pos = (pos + 1) & (tableSize - 1);
+    }
+    return(&(table[pos]));
+}
+
+static int
+xmlSecNodeSetVisibilityAdd(xmlSecNodeSetVisibilityPtr vis, xmlNodePtr node, xmlNodePtr parent, int visible) {
+    xmlSecNodeSetVisibilityEntryPtr entry;
+
+    xmlSecAssert2(vis != NULL, -1);
+    xmlSecAssert2(vis->table != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* keep load factor under 1/2 */
+    if(2 * (vis->count + 1) > vis->tableSize) {
+        xmlSecNodeSetVisibilityEntryPtr newTable;
+        xmlSecSize newTableSize = 2 * vis->tableSize;
+        xmlSecSize ii;
+
+        newTable = (xmlSecNodeSetVisibilityEntryPtr)xmlMalloc(newTableSize * sizeof(xmlSecNodeSetVisibilityEntry));
+        if(newTable == NULL) {
+            xmlSecMallocError(newTableSize * sizeof(xmlSecNodeSetVisibilityEntry), NULL);
+            return(-1);
+        }
+        memset(newTable, 0, newTableSize * sizeof(xmlSecNodeSetVisibilityEntry));
+        for(ii = 0; ii < vis->tableSize; ++ii) {
+            if(vis->table[ii].node != NULL) {
+                entry = xmlSecNodeSetVisibilityFind(newTable, newTableSize,
+                    vis->table[ii].node, vis->table[ii].parent);
+                xmlSecAssert2(entry != NULL, -1);
+                (*entry) = vis->table[ii];
+            }
+        }
+        xmlFree(vis->table);
+        vis->table = newTable;
+        vis->tableSize = newTableSize;
+    }
+
+    entry = xmlSecNodeSetVisibilityFind(vis->table, vis->tableSize, node, parent);
+    xmlSecAssert2(entry != NULL, -1);
+    if(entry->node == NULL) {
+        entry->node = node;
+        entry->parent = parent;
+        ++vis->count;
+    }
+    entry->visible = visible;
+    return(0);
+}
+
+static int
+xmlSecNodeSetVisibilityAddLeaves(xmlSecNodeSetVisibilityPtr vis, xmlSecNodeSetPtr nset) {
+    xmlSecNodeSetPtr cur;
+    int ret;
+
+    xmlSecAssert2(vis != NULL, -1);
+    xmlSecAssert2(nset != NULL, -1);
+
+    cur = nset;
+    do {
+        if(cur->type == xmlSecNodeSetList) {
+            if(cur->children != NULL) {
+                ret = xmlSecNodeSetVisibilityAddLeaves(vis, cur->children);
+                if(ret < 0) {
+                    return(-1);
+                }
+            }
+        } else {
+            xmlSecNodeSetPtr* newLeaves;
+
+            newLeaves = (xmlSecNodeSetPtr*)xmlRealloc(vis->leaves, (vis->leavesNum + 1) * sizeof(xmlSecNodeSetPtr));
+            if(newLeaves == NULL) {
+                xmlSecMallocError((vis->leavesNum + 1) * sizeof(xmlSecNodeSetPtr), NULL);
+                return(-1);
+            }
+            vis->leaves = newLeaves;
+            vis->leaves[vis->leavesNum++] = cur;
+        }
+        cur = cur->next;
+    } while(cur != nset);
+    return(0);
+}
+
+static xmlSecSize
+xmlSecNodeSetVisibilityLeafIndex(xmlSecNodeSetVisibilityPtr vis, xmlSecNodeSetPtr nset) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < vis->leavesNum; ++ii) {
+        if(vis->leaves[ii] == nset) {
+            break;
+        }
+    }
+    return(ii);
+}
+
+/* same as xmlSecNodeSetOneContains() but the parent's visibility for the
+ * tree node sets is taken from the parentVec */
+static int
+xmlSecNodeSetVisibilityEvalLeaf(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent, int parentRes) {
+    int in_nodes_set;
+
+    xmlSecAssert2(nset != NULL, 0);
+    xmlSecAssert2(nset->type != xmlSecNodeSetList, 0);
+    xmlSecAssert2(node != NULL, 0);
+
+    switch(nset->type) {
+        case xmlSecNodeSetTreeWithoutComments:
+        case xmlSecNodeSetTreeWithoutCommentsInvert:
+            if(node->type == XML_COMMENT_NODE) {
+                return(0);
+            }
+            break;
+        default:
+            break;
+    }
+
+    in_nodes_set = xmlSecNodeSetOneContainsNodes(nset, node, parent);
+    switch(nset->type) {
+    case xmlSecNodeSetNormal:
+        return(in_nodes_set);
+    case xmlSecNodeSetInvert:
+        return(!in_nodes_set);
+    case xmlSecNodeSetTree:
+    case xmlSecNodeSetTreeWithoutComments:
+        if(in_nodes_set) {
+            return(1);
+        }
+        if((parent != NULL) && (parent->type == XML_ELEMENT_NODE)) {
+            return(parentRes);
+        }
+        return(0);
+    case xmlSecNodeSetTreeInvert:
+    case xmlSecNodeSetTreeWithoutCommentsInvert:
+        if(in_nodes_set) {
+            return(0);
+        }
+        if((parent != NULL) && (parent->type == XML_ELEMENT_NODE)) {
+            return(parentRes);
+        }
+        return(1);
+    default:
+        xmlSecUnsupportedEnumValueError("node set type", nset->type, NULL);
+        return(0);
+    }
+}
+
+/* same as xmlSecNodeSetContainsInternal() but uses precomputed leaves results */
+static int
+xmlSecNodeSetVisibilityCombine(xmlSecNodeSetVisibilityPtr vis, xmlSecNodeSetPtr nset, const xmlSecByte* vec) {
+    xmlSecNodeSetPtr cur;
+    int status = 1;
+    int res;
+
+    xmlSecAssert2(vis != NULL, -1);
+    xmlSecAssert2(vec != NULL, -1);
+
+    if(nset == NULL) {
+        return(1);
+    }
+
+    cur = nset;
+    do {
+        if(cur->type == xmlSecNodeSetList) {
+            res = xmlSecNodeSetVisibilityCombine(vis, cur->children, vec);
+            if(res < 0) {
+                return(-1);
+            }
+        } else {
+            res = vec[xmlSecNodeSetVisibilityLeafIndex(vis, cur)];
+        }
+
+        switch(cur->op) {
+        case xmlSecNodeSetIntersection:
+            if(status && !res) {
+                status = 0;
+            }
+            break;
+        case xmlSecNodeSetSubtraction:
+            if(status && res) {
+                status = 0;
+            }
+            break;
+        case xmlSecNodeSetUnion:
+            if(!status && res) {
+                status = 1;
+            }
+            break;
+        default:
+            xmlSecOtherError2(XMLSEC_ERRORS_R_INVALID_OPERATION, NULL,
+                "node set operation=" XMLSEC_ENUM_FMT, XMLSEC_ENUM_CAST(cur->op));
+            return(-1);
+        }
+        cur = cur->next;
+    } while(cur != nset);
+
+    return(status);
+}
+
+/* evaluates all the leaves for the node (results are stored at the given depth
+ * of the stack) and records the combined nodes set visibility */
+static int
+xmlSecNodeSetVisibilityEvalNode(xmlSecNodeSetVisibilityPtr vis, xmlSecNodeSetPtr nset,
+                                xmlNodePtr node, xmlNodePtr parent, xmlSecSize depth) {
+    xmlSecByte* parentVec;
+    xmlSecByte* vec;
+    xmlSecSize ii;
+    int res;
+
+    xmlSecAssert2(vis != NULL, -1);
+    xmlSecAssert2(nset != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* ensure we have space in the stack */
+    if(vis->stackSize < (depth + 1) * vis->leavesNum) {
+        xmlSecByte* newStack;
+        xmlSecSize newStackSize = 2 * (depth + 1) * vis->leavesNum;
+
+        newStack = (xmlSecByte*)xmlRealloc(vis->stack, newStackSize);
+        if(newStack == NULL) {
+            xmlSecMallocError(newStackSize, NULL);
+            return(-1);
+        }
+        vis->stack = newStack;
+        vis->stackSize = newStackSize;
+    }
+    parentVec = (depth > 0) ? vis->stack + (depth - 1) * vis->leavesNum : NULL;
+    vec = vis->stack + depth * vis->leavesNum;
+
+    for(ii = 0; ii < vis->leavesNum; ++ii) {
+        res = xmlSecNodeSetVisibilityEvalLeaf(vis->leaves[ii], node, parent,
+            (parentVec != NULL) ? parentVec[ii] : 0);
+        vec[ii] = (res != 0) ? 1 : 0;
+    }
+
+    res = xmlSecNodeSetVisibilityCombine(vis, nset, vec);
+    if(res < 0) {
+        return(-1);
+    }
+    return(xmlSecNodeSetVisibilityAdd(vis, node, parent, res));
+}
+
+static int
+xmlSecNodeSetVisibilityVisit(xmlSecNodeSetWalkerPtr walker, xmlNodePtr cur, xmlNodePtr parent,
+                             xmlSecSize depth, void* data) {
+    xmlSecNodeSetVisibilityPtr vis = (xmlSecNodeSetVisibilityPtr)data;
+    int ret;
+
+    xmlSecAssert2(walker != NULL, -1);
+    xmlSecAssert2(walker->nset != NULL, -1);
+    xmlSecAssert2(cur != NULL, -1);
+    xmlSecAssert2(vis != NULL, -1);
+
+    ret = xmlSecNodeSetVisibilityEvalNode(vis, walker->nset, cur, parent, depth);
+    if(ret < 0) {
+        return(-1);
+    }
+
+    /* element node has attributes, namespaces  */
+    if(cur->type == XML_ELEMENT_NODE) {
+        xmlAttrPtr attr;
+        xmlSecSize ii;
+
+        for(attr = cur->properties; attr != NULL; attr = attr->next) {
+            ret = xmlSecNodeSetVisibilityEvalNode(vis, walker->nset, (xmlNodePtr)attr, cur, depth + 1);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+
+        for(ii = walker->inScopeNsSize; ii > 0; --ii) {
+            if(!xmlSecNodeSetWalkerIsActiveNs(walker, ii - 1)) {
+                continue;
+            }
+            ret = xmlSecNodeSetVisibilityEvalNode(vis, walker->nset, (xmlNodePtr)walker->inScopeNs[ii - 1], cur, depth + 1);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+    }
+    return(0);
+}
+
+static xmlSecNodeSetVisibilityPtr
+xmlSecNodeSetVisibilityCreate(xmlSecNodeSetPtr nset) {
+    xmlSecNodeSetVisibilityPtr vis;
+    int ret;
+
+    xmlSecAssert2(nset != NULL, NULL);
+    xmlSecAssert2(nset->doc != NULL, NULL);
+
+    vis = (xmlSecNodeSetVisibilityPtr)xmlMalloc(sizeof(xmlSecNodeSetVisibility));
+    if(vis == NULL) {
+        xmlSecMallocError(sizeof(xmlSecNodeSetVisibility), NULL);
+        return(NULL);
+    }
+    memset(vis, 0, sizeof(xmlSecNodeSetVisibility));
+
+    ret = xmlSecNodeSetVisibilityAddLeaves(vis, nset);
+    if((ret < 0) || (vis->leavesNum <= 0)) {
+        xmlSecInternalError("xmlSecNodeSetVisibilityAddLeaves", NULL);
+        xmlSecNodeSetVisibilityDestroy(vis);
+        return(NULL);
+    }
+
+    vis->tableSize = XMLSEC_NODESET_VISIBILITY_INITIAL_SIZE;
+    vis->table = (xmlSecNodeSetVisibilityEntryPtr)xmlMalloc(vis->tableSize * sizeof(xmlSecNodeSetVisibilityEntry));
+    if(vis->table == NULL) {
+        xmlSecMallocError(vis->tableSize * sizeof(xmlSecNodeSetVisibilityEntry), NULL);
+        xmlSecNodeSetVisibilityDestroy(vis);
+        return(NULL);
+    }
+    memset(vis->table, 0, vis->tableSize * sizeof(xmlSecNodeSetVisibilityEntry));
+
+    ret = xmlSecNodeSetWalkerRun(nset, (xmlNodePtr)nset->doc, NULL, 0, xmlSecNodeSetVisibilityVisit, vis);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecNodeSetWalkerRun", NULL);
+        xmlSecNodeSetVisibilityDestroy(vis);
+        return(NULL);
+    }
+
+    /* we don't need these anymore */
+    xmlFree(vis->leaves);
+    vis->leaves = NULL;
+    vis->leavesNum = 0;
+    xmlFree(vis->stack);
+    vis->stack = NULL;
+    vis->stackSize = 0;
+
+    return(vis);
+}
+
+/* Returns 1 or 0 if visibility for the node is known or a negative value otherwise */
+static int
+xmlSecNodeSetVisibilityGet(xmlSecNodeSetPtr nset, xmlNodePtr node, xmlNodePtr parent) {
+    xmlSecNodeSetVisibilityEntryPtr entry;
+
+    xmlSecAssert2(nset != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* only the combined nodes sets need it */
+    if((nset->next == nset) && (nset->type != xmlSecNodeSetList)) {
+        return(-1);
+    }
+    if(nset->doc == NULL) {
+        return(-1);
+    }
+
+    if(nset->visibility == NULL) {
+        nset->visibility = xmlSecNodeSetVisibilityCreate(nset);
+        if(nset->visibility == NULL) {
+            xmlSecInternalError("xmlSecNodeSetVisibilityCreate", NULL);
+
+            /* don't try again, fallback to the slow path */
+            nset->visibility = (xmlSecNodeSetVisibilityPtr)xmlMalloc(sizeof(xmlSecNodeSetVisibility));
+            if(nset->visibility == NULL) {
+                xmlSecMallocError(sizeof(xmlSecNodeSetVisibility), NULL);
+                return(-1);
+            }
+            memset(nset->visibility, 0, sizeof(xmlSecNodeSetVisibility));
+            return(-1);
+        }
+    }
+    if(nset->visibility->table == NULL) {
+        return(-1);
+    }
+
+    entry = xmlSecNodeSetVisibilityFind(nset->visibility->table, nset->visibility->tableSize, node, parent);
+    if((entry == NULL) || (entry->node == NULL)) {
+        /* not found (e.g. the node was added after the walk) */
+        return(-1);
+    }
+    return(entry->visible);
+}
+
 /**
  * xmlSecNodeSetAdd:
  * @nset:               the pointer to current nodes set (or NULL).
@@ -280,6 +1299,12 @@ xmlSecNodeSetAdd(xmlSecNodeSetPtr nset, xmlSecNodeSetPtr newNSet,
     /* all nodesets should belong to the same doc */
     xmlSecAssert2(nset->doc == newNSet->doc, NULL);
 
+    /* the combined set is changing, precomputed visibility is not valid anymore */
+    if(nset->visibility != NULL) {
+        xmlSecNodeSetVisibilityDestroy(nset->visibility);
+        nset->visibility = NULL;
+    }
+
     newNSet->next = nset;
     newNSet->prev = nset->prev;
     nset->prev->next = newNSet;
@@ -335,6 +1360,7 @@ xmlSecNodeSetAddList(xmlSecNodeSetPtr nset, xmlSecNodeSetPtr newNSet, xmlSecNode
  */
 int
 xmlSecNodeSetWalk(xmlSecNodeSetPtr nset, xmlSecNodeSetWalkCallback walkFunc, void* data) {
+    xmlSecNodeSetWalkCtx ctx;
     xmlNodePtr cur;
     int ret = 0;
 
@@ -342,6 +1368,9 @@ xmlSecNodeSetWalk(xmlSecNodeSetPtr nset, xmlSecNodeSetWalkCallback walkFunc, voi
     xmlSecAssert2(nset->doc != NULL, -1);
     xmlSecAssert2(walkFunc != NULL, -1);
 
+    ctx.walkFunc = walkFunc;
+    ctx.data = data;
+
     /* special cases */
     if(nset->nodes != NULL) {
         int i;
@@ -351,9 +1380,9 @@ xmlSecNodeSetWalk(xmlSecNodeSetPtr nset, xmlSecNodeSetWalkCallback walkFunc, voi
         case xmlSecNodeSetTree:
         case xmlSecNodeSetTreeWithoutComments:
             for(i = 0; (ret >= 0) && (i < nset->nodes->nodeNr); ++i) {
-                ret = xmlSecNodeSetWalkRecursive(nset, walkFunc, data,
-                    nset->nodes->nodeTab[i],
-                    xmlSecGetParent(nset->nodes->nodeTab[i]));
+                ret = xmlSecNodeSetWalkerRun(nset, nset->nodes->nodeTab[i],
+                    xmlSecGetParent(nset->nodes->nodeTab[i]), 0,
+                    xmlSecNodeSetWalkVisit, &ctx);
             }
             return(ret);
         default:
@@ -362,24 +1391,29 @@ xmlSecNodeSetWalk(xmlSecNodeSetPtr nset, xmlSecNodeSetWalkCallback walkFunc, voi
     }
 
     for(cur = nset->doc->children; (cur != NULL) && (ret >= 0); cur = cur->next) {
-        ret = xmlSecNodeSetWalkRecursive(nset, walkFunc, data, cur, xmlSecGetParent(cur));
+        ret = xmlSecNodeSetWalkerRun(nset, cur, xmlSecGetParent(cur), 0, xmlSecNodeSetWalkVisit, &ctx);
     }
     return(ret);
 }
 
 static int
-xmlSecNodeSetWalkRecursive(xmlSecNodeSetPtr nset, xmlSecNodeSetWalkCallback walkFunc,
-                            void* data, xmlNodePtr cur, xmlNodePtr parent) {
+xmlSecNodeSetWalkVisit(xmlSecNodeSetWalkerPtr walker, xmlNodePtr cur, xmlNodePtr parent,
+                       xmlSecSize depth, void* data) {
+    xmlSecNodeSetWalkCtxPtr ctx = (xmlSecNodeSetWalkCtxPtr)data;
+    xmlSecNodeSetPtr nset;
     int ret;
 
-    xmlSecAssert2(nset != NULL, -1);
+    xmlSecAssert2(walker != NULL, -1);
+    xmlSecAssert2(walker->nset != NULL, -1);
     xmlSecAssert2(cur != NULL, -1);
-    xmlSecAssert2(walkFunc != NULL, -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->walkFunc != NULL, -1);
 
-    /* the node itself */
-    if(xmlSecNodeSetContains(nset, cur, parent)) {
-        ret = walkFunc(nset, cur, parent, data);
+    nset = walker->nset;
 
+    /* the node itself */
+    if(xmlSecNodeSetWalkerContains(walker, cur, parent, depth)) {
+        ret = ctx->walkFunc(nset, cur, parent, ctx->data);
         if(ret < 0) {
             return(ret);
         }
@@ -388,48 +1422,27 @@ xmlSecNodeSetWalkRecursive(xmlSecNodeSetPtr nset, xmlSecNodeSetWalkCallback walk
     /* element node has attributes, namespaces  */
     if(cur->type == XML_ELEMENT_NODE) {
         xmlAttrPtr attr;
-        xmlNodePtr node;
-        xmlNsPtr ns, tmp;
+        xmlNsPtr ns;
+        xmlSecSize ii;
 
-        attr = (xmlAttrPtr)cur->properties;
-        while(attr != NULL) {
-            if(xmlSecNodeSetContains(nset, (xmlNodePtr)attr, cur)) {
-                ret = walkFunc(nset, (xmlNodePtr)attr, cur, data);
+        for(attr = cur->properties; attr != NULL; attr = attr->next) {
+            if(xmlSecNodeSetWalkerContains(walker, (xmlNodePtr)attr, cur, depth + 1)) {
+                ret = ctx->walkFunc(nset, (xmlNodePtr)attr, cur, ctx->data);
                 if(ret < 0) {
                     return(ret);
                 }
             }
-            attr = attr->next;
-        }
-
-        node = cur;
-        while(node != NULL) {
-            ns = node->nsDef;
-            while(ns != NULL) {
-                tmp = xmlSearchNs(nset->doc, cur, ns->prefix);
-                if((tmp == ns) && xmlSecNodeSetContains(nset, (xmlNodePtr)ns, cur)) {
-                    ret = walkFunc(nset, (xmlNodePtr)ns, cur, data);
-                    if(ret < 0) {
-                        return(ret);
-                    }
-                }
-                ns = ns->next;
-            }
-            node = node->parent;
         }
-    }
 
-    /* element and document nodes have children */
-    if((cur->type == XML_ELEMENT_NODE) || (cur->type == XML_DOCUMENT_NODE)) {
-        xmlNodePtr node;
-
-        node = cur->children;
-        while(node != NULL) {
-            ret = xmlSecNodeSetWalkRecursive(nset, walkFunc, data, node, cur);
-            if(ret < 0) {
-                return(ret);
+        for(ii = walker->inScopeNsSize; ii > 0; --ii) {
+            ns = walker->inScopeNs[ii - 1];
+            if(xmlSecNodeSetWalkerIsActiveNs(walker, ii - 1) &&
+               xmlSecNodeSetWalkerContains(walker, (xmlNodePtr)ns, cur, depth + 1)) {
+                ret = ctx->walkFunc(nset, (xmlNodePtr)ns, cur, ctx->data);
+                if(ret < 0) {
+                    return(ret);
+                }
             }
-            node = node->next;
         }
     }
     return(0);
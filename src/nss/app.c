@@ -46,6 +46,7 @@
 #include <xmlsec/nss/keysstore.h>
 
 #include "../cast_helpers.h"
+#include "../keysdata_helpers.h"
 #include "private.h"
 
 static int xmlSecNssAppCreateSECItem                            (SECItem *contents,
@@ -878,7 +879,7 @@ xmlSecNssAppPkcs12LoadSECItem(SECItem* secItem, const char *pwd,
 
     for (head = CERT_LIST_HEAD(certlist); !CERT_LIST_END(head, certlist); head = CERT_LIST_NEXT(head)) {
         cert = head->cert;
-        privkey = PK11_FindKeyByAnyCert(cert, NULL);
+        privkey = xmlSecNssFindKeyByAnyCert(cert);
 
         if (privkey != NULL) {
             if (keyValueData != NULL) {
@@ -1379,6 +1380,38 @@ xmlSecNssAppKeysMngrCrlLoadMemory(xmlSecKeysMngrPtr mngr, const xmlSecByte* data
     return(0);
 }
 
+/**
+ * xmlSecNssAppKeysMngrEnableX509VerifyCache:
+ * @mngr:               the keys manager.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables the cache of the successful certificates verification results
+ * in the X509 store of @mngr (see #xmlSecNssX509StoreEnableVerifyCache).
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecNssAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize) {
+    xmlSecKeyDataStorePtr x509Store;
+    int ret;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    x509Store = xmlSecKeysMngrGetDataStore(mngr, xmlSecNssX509StoreId);
+    if(x509Store == NULL) {
+        xmlSecInternalError("xmlSecKeysMngrGetDataStore(xmlSecNssX509StoreId)", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecNssX509StoreEnableVerifyCache(x509Store, maxSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecNssX509StoreEnableVerifyCache", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
 
 #endif /* XMLSEC_NO_X509 */
 
@@ -1455,6 +1488,9 @@ xmlSecNssAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key) {
         return(-1);
     }
 
+    /* the new key might be one of the recently not found keys */
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
+
     return(0);
 }
 
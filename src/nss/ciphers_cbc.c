@@ -31,10 +31,12 @@
 
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
+#include "../transform_helpers.h"
 
 #define XMLSEC_NSS_CBC_CIPHER_MAX_KEY_SIZE         32
 #define XMLSEC_NSS_CBC_CIPHER_MAX_IV_SIZE          32
 #define XMLSEC_NSS_CBC_CIPHER_MAX_BLOCK_SIZE       32
+#define XMLSEC_NSS_CBC_SEGMENT_CHUNK_SIZE          (64*1024*1024)
 
 /**************************************************************************
  *
@@ -71,16 +73,75 @@ static int      xmlSecNssCbcCipherCtxFinal              (xmlSecNssCbcCipherCtxPt
                                                          int encrypt,
                                                          const xmlChar* cipherName,
                                                          xmlSecTransformCtxPtr transformCtx);
+
+/* creates PK11 context for the ctx->key and the @iv */
+static PK11Context*
+xmlSecNssCbcCipherCreateContext(xmlSecNssCbcCipherCtxPtr ctx, const xmlSecByte* iv,
+    int encrypt, const xmlChar* cipherName)
+{
+    xmlSecByte ivCopy[XMLSEC_NSS_CBC_CIPHER_MAX_IV_SIZE];
+    SECItem keyItem;
+    SECItem ivItem;
+    PK11SlotInfo* slot;
+    PK11SymKey* symKey;
+    PK11Context* cipherCtx;
+    int ivLen;
+    xmlSecSize ivSize;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->cipher != 0, NULL);
+    xmlSecAssert2(ctx->keyInitialized != 0, NULL);
+    xmlSecAssert2(iv != NULL, NULL);
+
+    ivLen = PK11_GetIVLength(ctx->cipher);
+    xmlSecAssert2(ivLen >= 0, NULL);
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(ivLen, ivSize, return(NULL), NULL);
+    xmlSecAssert2(ivSize <= sizeof(ivCopy), NULL);
+    memcpy(ivCopy, iv, ivSize);
+
+    memset(&keyItem, 0, sizeof(keyItem));
+    keyItem.data = ctx->key;
+    XMLSEC_SAFE_CAST_SIZE_TO_UINT(ctx->keySize, keyItem.len, return(NULL), NULL);
+
+    memset(&ivItem, 0, sizeof(ivItem));
+    ivItem.data = ivCopy;
+    XMLSEC_SAFE_CAST_INT_TO_UINT(ivLen, ivItem.len, return(NULL), NULL);
+
+    slot = PK11_GetBestSlot(ctx->cipher, NULL);
+    if(slot == NULL) {
+        xmlSecNssError("PK11_GetBestSlot", cipherName);
+        return(NULL);
+    }
+
+    symKey = PK11_ImportSymKey(slot, ctx->cipher, PK11_OriginDerive,
+                               CKA_ENCRYPT, &keyItem, NULL);
+    if(symKey == NULL) {
+        xmlSecNssError("PK11_ImportSymKey", cipherName);
+        PK11_FreeSlot(slot);
+        return(NULL);
+    }
+
+    cipherCtx = PK11_CreateContextBySymKey(ctx->cipher,
+                        (encrypt) ? CKA_ENCRYPT : CKA_DECRYPT,
+                        symKey, &ivItem);
+    if(cipherCtx == NULL) {
+        xmlSecNssError("PK11_CreateContextBySymKey", cipherName);
+        PK11_FreeSymKey(symKey);
+        PK11_FreeSlot(slot);
+        return(NULL);
+    }
+
+    PK11_FreeSymKey(symKey);
+    PK11_FreeSlot(slot);
+    return(cipherCtx);
+}
+
 static int
 xmlSecNssCbcCipherCtxInit(xmlSecNssCbcCipherCtxPtr ctx,
     xmlSecBufferPtr in, xmlSecBufferPtr out,
     int encrypt, const xmlChar* cipherName,
     xmlSecTransformCtxPtr transformCtx)
 {
-    SECItem keyItem;
-    SECItem ivItem;
-    PK11SlotInfo* slot;
-    PK11SymKey* symKey;
     int ivLen;
     xmlSecSize ivSize;
     SECStatus rv;
@@ -135,41 +196,102 @@ xmlSecNssCbcCipherCtxInit(xmlSecNssCbcCipherCtxPtr ctx,
         }
     }
 
-    memset(&keyItem, 0, sizeof(keyItem));
-    keyItem.data = ctx->key;
-    XMLSEC_SAFE_CAST_SIZE_TO_UINT(ctx->keySize, keyItem.len, return(-1), NULL);
+    ctx->cipherCtx = xmlSecNssCbcCipherCreateContext(ctx, ctx->iv, encrypt, cipherName);
+    if(ctx->cipherCtx == NULL) {
+        xmlSecInternalError("xmlSecNssCbcCipherCreateContext", cipherName);
+        return(-1);
+    }
 
-    memset(&ivItem, 0, sizeof(ivItem));
-    ivItem.data = ctx->iv;
-    XMLSEC_SAFE_CAST_INT_TO_UINT(ivLen, ivItem.len, return(-1), NULL);
+    ctx->ctxInitialized = 1;
+    return(0);
+}
 
-    slot = PK11_GetBestSlot(ctx->cipher, NULL);
-    if(slot == NULL) {
-        xmlSecNssError("PK11_GetBestSlot", cipherName);
+/* decrypts one segment of the CBC ciphertext with its own PK11 context
+ * (called from the executor threads, see xmlSecTransformCbcDecryptParallel()) */
+static int
+xmlSecNssCbcCipherDecryptSegment(void* cipherCtx, const xmlSecByte* iv,
+    const xmlSecByte* in, xmlSecSize inSize, xmlSecByte* out)
+{
+    xmlSecNssCbcCipherCtxPtr ctx = (xmlSecNssCbcCipherCtxPtr)cipherCtx;
+    PK11Context* segmentCtx;
+    xmlSecSize chunkSize;
+    int inLen, outLen;
+    SECStatus rv;
+    int res = -1;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(iv != NULL, -1);
+    xmlSecAssert2(in != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    segmentCtx = xmlSecNssCbcCipherCreateContext(ctx, iv, 0, NULL);
+    if(segmentCtx == NULL) {
+        xmlSecInternalError("xmlSecNssCbcCipherCreateContext", NULL);
         return(-1);
     }
 
-    symKey = PK11_ImportSymKey(slot, ctx->cipher, PK11_OriginDerive,
-                               CKA_ENCRYPT, &keyItem, NULL);
-    if(symKey == NULL) {
-        xmlSecNssError("PK11_ImportSymKey", cipherName);
-        PK11_FreeSlot(slot);
+    while(inSize > 0) {
+        chunkSize = (inSize < XMLSEC_NSS_CBC_SEGMENT_CHUNK_SIZE) ? inSize : XMLSEC_NSS_CBC_SEGMENT_CHUNK_SIZE;
+        XMLSEC_SAFE_CAST_SIZE_TO_INT(chunkSize, inLen, goto done, NULL);
+
+        outLen = 0;
+        rv = PK11_CipherOp(segmentCtx, out, &outLen, inLen, in, inLen);
+        if((rv != SECSuccess) || (outLen != inLen)) {
+            xmlSecNssError2("PK11_CipherOp", NULL, "size=%d", inLen);
+            goto done;
+        }
+        in += chunkSize;
+        out += chunkSize;
+        inSize -= chunkSize;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    PK11_DestroyContext(segmentCtx, PR_TRUE);
+    return(res);
+}
+
+/* decrypts the buffered CBC ciphertext on the executor and re-creates
+ * the ctx->cipherCtx for the new iv */
+static int
+xmlSecNssCbcCipherCtxParallel(xmlSecNssCbcCipherCtxPtr ctx,
+    xmlSecBufferPtr in, xmlSecBufferPtr out,
+    const xmlChar* cipherName, xmlSecTransformCtxPtr transformCtx,
+    int last)
+{
+    xmlSecSize blockSize;
+    int blockLen;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->cipherCtx != NULL, -1);
+    xmlSecAssert2(ctx->ctxInitialized != 0, -1);
+
+    blockLen = PK11_GetBlockSize(ctx->cipher, NULL);
+    xmlSecAssert2(blockLen > 0, -1);
+    xmlSecAssert2(blockLen == PK11_GetIVLength(ctx->cipher), -1);
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(blockLen, blockSize, return(-1), cipherName);
+    xmlSecAssert2(blockSize <= sizeof(ctx->iv), -1);
+
+    ret = xmlSecTransformCbcDecryptParallel(transformCtx, xmlSecNssCbcCipherDecryptSegment,
+        ctx, ctx->iv, blockSize, in, out, last);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCbcDecryptParallel", cipherName);
         return(-1);
+    } else if(ret == 0) {
+        /* wait for more data */
+        return(0);
     }
 
-    ctx->cipherCtx = PK11_CreateContextBySymKey(ctx->cipher,
-                        (encrypt) ? CKA_ENCRYPT : CKA_DECRYPT,
-                        symKey, &ivItem);
+    /* the final block is decrypted with ctx->cipherCtx */
+    PK11_DestroyContext(ctx->cipherCtx, PR_TRUE);
+    ctx->cipherCtx = xmlSecNssCbcCipherCreateContext(ctx, ctx->iv, 0, cipherName);
     if(ctx->cipherCtx == NULL) {
-        xmlSecNssError("PK11_CreateContextBySymKey", cipherName);
-        PK11_FreeSymKey(symKey);
-        PK11_FreeSlot(slot);
+        xmlSecInternalError("xmlSecNssCbcCipherCreateContext", cipherName);
         return(-1);
     }
-
-    ctx->ctxInitialized = 1;
-    PK11_FreeSymKey(symKey);
-    PK11_FreeSlot(slot);
     return(0);
 }
 
@@ -195,6 +317,10 @@ xmlSecNssCbcCipherCtxUpdate(xmlSecNssCbcCipherCtxPtr ctx,
     xmlSecAssert2(out != NULL, -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
+    if((encrypt == 0) && (xmlSecTransformCbcDecryptIsParallel(transformCtx) != 0)) {
+        return(xmlSecNssCbcCipherCtxParallel(ctx, in, out, cipherName, transformCtx, 0)); /* not final */
+    }
+
     blockLen = PK11_GetBlockSize(ctx->cipher, NULL);
     xmlSecAssert2(blockLen > 0, -1);
     XMLSEC_SAFE_CAST_INT_TO_SIZE(blockLen, blockSize, return(-1), NULL);
@@ -275,6 +401,14 @@ xmlSecNssCbcCipherCtxFinal(xmlSecNssCbcCipherCtxPtr ctx,
     xmlSecAssert2(out != NULL, -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
+    if((encrypt == 0) && (xmlSecTransformCbcDecryptIsParallel(transformCtx) != 0)) {
+        ret = xmlSecNssCbcCipherCtxParallel(ctx, in, out, cipherName, transformCtx, 1); /* final */
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecNssCbcCipherCtxParallel", cipherName);
+            return(-1);
+        }
+    }
+
     blockLen = PK11_GetBlockSize(ctx->cipher, NULL);
     xmlSecAssert2(blockLen > 0, -1);
     XMLSEC_SAFE_CAST_INT_TO_SIZE(blockLen, blockSize, return(-1), NULL);
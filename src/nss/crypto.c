@@ -22,9 +22,12 @@
 #include <string.h>
 
 #include <nss.h>
+#include <cert.h>
 #include <pk11func.h>
+#include <keyhi.h>
 #include <prinit.h>
 
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
@@ -33,6 +36,7 @@
 #include <xmlsec/errors.h>
 #include <xmlsec/dl.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/xmltree.h>
 
 #include <xmlsec/nss/app.h>
@@ -40,9 +44,15 @@
 #include <xmlsec/nss/x509.h>
 
 #include "../cast_helpers.h"
+#include "private.h"
 
 static xmlSecCryptoDLFunctionsPtr gXmlSecNssFunctions = NULL;
 
+static int              xmlSecNssTemplatesInit                  (void);
+static void             xmlSecNssTemplatesShutdown              (void);
+static int              xmlSecNssPrivKeysCacheInit              (void);
+static void             xmlSecNssPrivKeysCacheShutdown          (void);
+
 /**
  * xmlSecCryptoGetFunctions_nss:
  *
@@ -311,6 +321,7 @@ xmlSecCryptoGetFunctions_nss(void) {
     gXmlSecNssFunctions->cryptoAppKeysMngrCertLoadMemory= xmlSecNssAppKeysMngrCertLoadMemory;
     gXmlSecNssFunctions->cryptoAppKeysMngrCrlLoad       = xmlSecNssAppKeysMngrCrlLoad;
     gXmlSecNssFunctions->cryptoAppKeysMngrCrlLoadMemory = xmlSecNssAppKeysMngrCrlLoadMemory;
+    gXmlSecNssFunctions->cryptoAppKeysMngrEnableX509VerifyCache = xmlSecNssAppKeysMngrEnableX509VerifyCache;
     gXmlSecNssFunctions->cryptoAppPkcs12Load            = xmlSecNssAppPkcs12Load;
     gXmlSecNssFunctions->cryptoAppPkcs12LoadMemory      = xmlSecNssAppPkcs12LoadMemory;
     gXmlSecNssFunctions->cryptoAppKeyCertLoad           = xmlSecNssAppKeyCertLoad;
@@ -348,6 +359,14 @@ xmlSecNssInit (void)  {
         return(-1);
     }
 
+    /* not fatal: the contexts and keys are created every time */
+    if(xmlSecNssTemplatesInit() < 0) {
+        xmlSecInternalError("xmlSecNssTemplatesInit", NULL);
+    }
+    if(xmlSecNssPrivKeysCacheInit() < 0) {
+        xmlSecInternalError("xmlSecNssPrivKeysCacheInit", NULL);
+    }
+
     return(0);
 }
 
@@ -360,6 +379,8 @@ xmlSecNssInit (void)  {
  */
 int
 xmlSecNssShutdown(void) {
+    xmlSecNssPrivKeysCacheShutdown();
+    xmlSecNssTemplatesShutdown();
     return(0);
 }
 
@@ -379,7 +400,7 @@ xmlSecNssKeysMngrInit(xmlSecKeysMngrPtr mngr) {
     xmlSecAssert2(mngr != NULL, -1);
 
     /* create x509 store if needed */
-    if(xmlSecKeysMngrGetDataStore(mngr, xmlSecNssX509StoreId) == NULL) {
+    if(xmlSecKeysMngrFindDataStore(mngr, xmlSecNssX509StoreId) == NULL) {
         xmlSecKeyDataStorePtr x509Store;
 
         x509Store = xmlSecKeyDataStoreCreate(xmlSecNssX509StoreId);
@@ -443,6 +464,554 @@ xmlSecNssGetInternalKeySlot(void)
     return(slot);
 }
 
+/******************************************************************************
+ *
+ * Template contexts: PK11_CreateDigestContext() and PK11_CreateContextBySymKey()
+ * find the best slot and set up a new context for every transform (and the
+ * HMAC transforms also import the key). Instead we keep one initialized
+ * context per digest and give out PK11_CloneContext() copies. The keyed HMAC
+ * templates are disabled by default: the entries keep a copy of the key to
+ * match the lookups, it is cleared when the entry is removed.
+ *
+ *****************************************************************************/
+#define XMLSEC_NSS_DIGEST_TEMPLATES_MAX_SIZE            16
+#define XMLSEC_NSS_HMAC_TEMPLATES_MAX_SIZE              32
+#define XMLSEC_NSS_HMAC_TEMPLATES_MAX_KEY_SIZE          128
+
+typedef struct _xmlSecNssDigestTemplate {
+    SECOidTag           digest;
+    PK11Context*        tmpl;
+} xmlSecNssDigestTemplate;
+
+typedef struct _xmlSecNssHmacTemplate {
+    CK_MECHANISM_TYPE   digestType;
+    xmlSecByte          key[XMLSEC_NSS_HMAC_TEMPLATES_MAX_KEY_SIZE];
+    xmlSecSize          keySize;
+    PK11Context*        tmpl;
+} xmlSecNssHmacTemplate;
+
+static xmlMutexPtr              gXmlSecNssTemplatesMutex = NULL;
+static xmlSecNssDigestTemplate  gXmlSecNssDigestTemplates[XMLSEC_NSS_DIGEST_TEMPLATES_MAX_SIZE];
+static xmlSecSize               gXmlSecNssDigestTemplatesSize = 0;
+static int                      gXmlSecNssHmacTemplatesEnabled = 0;
+static xmlSecNssHmacTemplate    gXmlSecNssHmacTemplates[XMLSEC_NSS_HMAC_TEMPLATES_MAX_SIZE];
+static xmlSecSize               gXmlSecNssHmacTemplatesSize = 0;
+static xmlSecSize               gXmlSecNssHmacTemplatesNext = 0;
+
+static int
+xmlSecNssTemplatesInit(void) {
+    if(gXmlSecNssTemplatesMutex != NULL) {
+        return(0);
+    }
+
+    gXmlSecNssTemplatesMutex = xmlNewMutex();
+    if(gXmlSecNssTemplatesMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    memset(gXmlSecNssDigestTemplates, 0, sizeof(gXmlSecNssDigestTemplates));
+    memset(gXmlSecNssHmacTemplates, 0, sizeof(gXmlSecNssHmacTemplates));
+    gXmlSecNssDigestTemplatesSize = 0;
+    gXmlSecNssHmacTemplatesSize = 0;
+    gXmlSecNssHmacTemplatesNext = 0;
+    gXmlSecNssHmacTemplatesEnabled = 0;
+    return(0);
+}
+
+/* should be called under lock */
+static void
+xmlSecNssHmacTemplatesFlush(void) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecNssHmacTemplatesSize; ++ii) {
+        if(gXmlSecNssHmacTemplates[ii].tmpl != NULL) {
+            PK11_DestroyContext(gXmlSecNssHmacTemplates[ii].tmpl, PR_TRUE);
+        }
+        PORT_Memset(&(gXmlSecNssHmacTemplates[ii]), 0, sizeof(xmlSecNssHmacTemplate));
+    }
+    gXmlSecNssHmacTemplatesSize = 0;
+    gXmlSecNssHmacTemplatesNext = 0;
+}
+
+static void
+xmlSecNssTemplatesShutdown(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecNssTemplatesMutex == NULL) {
+        return;
+    }
+    for(ii = 0; ii < gXmlSecNssDigestTemplatesSize; ++ii) {
+        PK11_DestroyContext(gXmlSecNssDigestTemplates[ii].tmpl, PR_TRUE);
+    }
+    memset(gXmlSecNssDigestTemplates, 0, sizeof(gXmlSecNssDigestTemplates));
+    gXmlSecNssDigestTemplatesSize = 0;
+
+    xmlSecNssHmacTemplatesFlush();
+    gXmlSecNssHmacTemplatesEnabled = 0;
+
+    xmlFreeMutex(gXmlSecNssTemplatesMutex);
+    gXmlSecNssTemplatesMutex = NULL;
+}
+
+/* should be called under lock */
+static xmlSecNssDigestTemplate*
+xmlSecNssDigestTemplatesFind(SECOidTag digest) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecNssDigestTemplatesSize; ++ii) {
+        if(gXmlSecNssDigestTemplates[ii].digest == digest) {
+            return(&(gXmlSecNssDigestTemplates[ii]));
+        }
+    }
+    return(NULL);
+}
+
+/* should be called under lock */
+static xmlSecNssHmacTemplate*
+xmlSecNssHmacTemplatesFind(CK_MECHANISM_TYPE digestType, const xmlSecByte* key, xmlSecSize keySize) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecNssHmacTemplatesSize; ++ii) {
+        if((gXmlSecNssHmacTemplates[ii].digestType == digestType) &&
+           (gXmlSecNssHmacTemplates[ii].keySize == keySize) &&
+           (NSS_SecureMemcmp(gXmlSecNssHmacTemplates[ii].key, key, keySize) == 0)
+        ) {
+            return(&(gXmlSecNssHmacTemplates[ii]));
+        }
+    }
+    return(NULL);
+}
+
+/* should be called under lock, takes ownership of @tmpl */
+static void
+xmlSecNssHmacTemplatesAdd(CK_MECHANISM_TYPE digestType, const xmlSecByte* key, xmlSecSize keySize,
+                          PK11Context* tmpl) {
+    xmlSecNssHmacTemplate* entry;
+
+    xmlSecAssert(tmpl != NULL);
+    xmlSecAssert(keySize <= XMLSEC_NSS_HMAC_TEMPLATES_MAX_KEY_SIZE);
+
+    if(gXmlSecNssHmacTemplatesSize < XMLSEC_NSS_HMAC_TEMPLATES_MAX_SIZE) {
+        entry = &(gXmlSecNssHmacTemplates[gXmlSecNssHmacTemplatesSize++]);
+    } else {
+        /* replace the oldest entry */
+        if(gXmlSecNssHmacTemplatesNext >= XMLSEC_NSS_HMAC_TEMPLATES_MAX_SIZE) {
+            gXmlSecNssHmacTemplatesNext = 0;
+        }
+        entry = &(gXmlSecNssHmacTemplates[gXmlSecNssHmacTemplatesNext++]);
+        PK11_DestroyContext(entry->tmpl, PR_TRUE);
+        PORT_Memset(entry, 0, sizeof(xmlSecNssHmacTemplate));
+    }
+    entry->digestType = digestType;
+    memcpy(entry->key, key, keySize);
+    entry->keySize    = keySize;
+    entry->tmpl       = tmpl;
+}
+
+/**
+ * xmlSecNssSetHmacCtxCache:
+ * @enabled:            1 to enable the keyed HMAC contexts cache or
+ *                      0 to disable it.
+ *
+ * Enables or disables the cache of the keyed PK11Context objects for the
+ * HMAC transforms. When enabled, the HMAC transforms that use the same key
+ * and digest clone the cached context instead of importing the key and
+ * creating a new one. The cache is small and keeps a copy of the most
+ * recently used keys until they are replaced or the cache is disabled.
+ * Disabling the cache removes (and clears) all the entries.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecNssSetHmacCtxCache(int enabled) {
+    if(gXmlSecNssTemplatesMutex == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_CRYPTO_FAILED, NULL, "cache is not initialized");
+        return(-1);
+    }
+
+    xmlMutexLock(gXmlSecNssTemplatesMutex);
+    gXmlSecNssHmacTemplatesEnabled = (enabled != 0) ? 1 : 0;
+    if(enabled == 0) {
+        xmlSecNssHmacTemplatesFlush();
+    }
+    xmlMutexUnlock(gXmlSecNssTemplatesMutex);
+    return(0);
+}
+
+/**
+ * xmlSecNssDigestContextCreate:
+ * @digest:             the digest algorithm.
+ *
+ * Creates the digest context for @digest by cloning the cached
+ * template context (the template is created on the first call).
+ *
+ * Returns: the new digest context or NULL if an error occurs.
+ */
+PK11Context*
+xmlSecNssDigestContextCreate(SECOidTag digest) {
+    xmlSecNssDigestTemplate* entry;
+    PK11Context* digestCtx = NULL;
+    PK11Context* tmpl;
+
+    if(gXmlSecNssTemplatesMutex != NULL) {
+        xmlMutexLock(gXmlSecNssTemplatesMutex);
+        entry = xmlSecNssDigestTemplatesFind(digest);
+        if(entry != NULL) {
+            digestCtx = PK11_CloneContext(entry->tmpl);
+        }
+        xmlMutexUnlock(gXmlSecNssTemplatesMutex);
+
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoAlgorithm, (digestCtx != NULL) ? 1 : 0);
+        if(digestCtx != NULL) {
+            return(digestCtx);
+        }
+    }
+
+    /* create outside of the lock */
+    digestCtx = PK11_CreateDigestContext(digest);
+    if(digestCtx == NULL) {
+        xmlSecNssError("PK11_CreateDigestContext", NULL);
+        return(NULL);
+    }
+
+    /* not fatal if we can't cache it */
+    if(gXmlSecNssTemplatesMutex != NULL) {
+        tmpl = PK11_CloneContext(digestCtx);
+        if(tmpl != NULL) {
+            xmlMutexLock(gXmlSecNssTemplatesMutex);
+            if((xmlSecNssDigestTemplatesFind(digest) == NULL) &&
+               (gXmlSecNssDigestTemplatesSize < XMLSEC_NSS_DIGEST_TEMPLATES_MAX_SIZE)) {
+                gXmlSecNssDigestTemplates[gXmlSecNssDigestTemplatesSize].digest = digest;
+                gXmlSecNssDigestTemplates[gXmlSecNssDigestTemplatesSize].tmpl   = tmpl;
+                ++gXmlSecNssDigestTemplatesSize;
+                tmpl = NULL;
+            }
+            xmlMutexUnlock(gXmlSecNssTemplatesMutex);
+        }
+        if(tmpl != NULL) {
+            PK11_DestroyContext(tmpl, PR_TRUE);
+        }
+    }
+    return(digestCtx);
+}
+
+static PK11Context*
+xmlSecNssHmacContextCreateNew(CK_MECHANISM_TYPE digestType, const xmlSecByte* key, xmlSecSize keySize) {
+    PK11SlotInfo* slot;
+    PK11SymKey* symKey;
+    PK11Context* hmacCtx;
+    SECItem keyItem;
+    SECItem ignore;
+
+    memset(&ignore, 0, sizeof(ignore));
+    memset(&keyItem, 0, sizeof(keyItem));
+    keyItem.data = (unsigned char*)key;
+    XMLSEC_SAFE_CAST_SIZE_TO_UINT(keySize, keyItem.len, return(NULL), NULL);
+
+    slot = PK11_GetBestSlot(digestType, NULL);
+    if(slot == NULL) {
+        xmlSecNssError("PK11_GetBestSlot", NULL);
+        return(NULL);
+    }
+
+    symKey = PK11_ImportSymKey(slot, digestType, PK11_OriginDerive,
+                               CKA_SIGN, &keyItem, NULL);
+    if(symKey == NULL) {
+        xmlSecNssError("PK11_ImportSymKey", NULL);
+        PK11_FreeSlot(slot);
+        return(NULL);
+    }
+
+    hmacCtx = PK11_CreateContextBySymKey(digestType, CKA_SIGN, symKey, &ignore);
+    if(hmacCtx == NULL) {
+        xmlSecNssError("PK11_CreateContextBySymKey", NULL);
+        PK11_FreeSymKey(symKey);
+        PK11_FreeSlot(slot);
+        return(NULL);
+    }
+
+    PK11_FreeSymKey(symKey);
+    PK11_FreeSlot(slot);
+    return(hmacCtx);
+}
+
+/**
+ * xmlSecNssHmacContextCreate:
+ * @digestType:         the HMAC mechanism (e.g. CKM_SHA256_HMAC).
+ * @key:                the key.
+ * @keySize:            the key size.
+ *
+ * Creates the HMAC signing context for @digestType and @key. If the cache
+ * is enabled (see #xmlSecNssSetHmacCtxCache) then the context is cloned
+ * from the cached template for the same mechanism and key.
+ *
+ * Returns: the new HMAC context or NULL if an error occurs.
+ */
+PK11Context*
+xmlSecNssHmacContextCreate(CK_MECHANISM_TYPE digestType, const xmlSecByte* key, xmlSecSize keySize) {
+    xmlSecNssHmacTemplate* entry;
+    PK11Context* hmacCtx = NULL;
+    PK11Context* tmpl;
+    int enabled = 0;
+
+    xmlSecAssert2(key != NULL, NULL);
+    xmlSecAssert2(keySize > 0, NULL);
+
+    if((keySize <= XMLSEC_NSS_HMAC_TEMPLATES_MAX_KEY_SIZE) && (gXmlSecNssTemplatesMutex != NULL)) {
+        xmlMutexLock(gXmlSecNssTemplatesMutex);
+        enabled = gXmlSecNssHmacTemplatesEnabled;
+        if(enabled != 0) {
+            entry = xmlSecNssHmacTemplatesFind(digestType, key, keySize);
+            if(entry != NULL) {
+                hmacCtx = PK11_CloneContext(entry->tmpl);
+            }
+        }
+        xmlMutexUnlock(gXmlSecNssTemplatesMutex);
+
+        if(enabled != 0) {
+            xmlSecStatsCacheLookup(xmlSecStatsCacheHmac, (hmacCtx != NULL) ? 1 : 0);
+        }
+        if(hmacCtx != NULL) {
+            return(hmacCtx);
+        }
+    }
+
+    /* create outside of the lock */
+    hmacCtx = xmlSecNssHmacContextCreateNew(digestType, key, keySize);
+    if(hmacCtx == NULL) {
+        xmlSecInternalError("xmlSecNssHmacContextCreateNew", NULL);
+        return(NULL);
+    }
+
+    /* not fatal if we can't cache it */
+    if(enabled != 0) {
+        tmpl = PK11_CloneContext(hmacCtx);
+        if(tmpl != NULL) {
+            xmlMutexLock(gXmlSecNssTemplatesMutex);
+            if((gXmlSecNssHmacTemplatesEnabled != 0) &&
+               (xmlSecNssHmacTemplatesFind(digestType, key, keySize) == NULL)) {
+                xmlSecNssHmacTemplatesAdd(digestType, key, keySize, tmpl);
+                tmpl = NULL;
+            }
+            xmlMutexUnlock(gXmlSecNssTemplatesMutex);
+        }
+        if(tmpl != NULL) {
+            PK11_DestroyContext(tmpl, PR_TRUE);
+        }
+    }
+    return(hmacCtx);
+}
+
+/******************************************************************************
+ *
+ * Private keys cache: PK11_FindKeyByAnyCert() searches all the slots (and
+ * might need to login) on every call. The found keys are cached per cert
+ * together with the slot series: the entry is dropped when the token is
+ * removed or re-inserted, when the token is logged out or when the key
+ * object is gone. Only the found keys are cached.
+ *
+ *****************************************************************************/
+#define XMLSEC_NSS_PRIV_KEYS_CACHE_MAX_SIZE             64
+
+typedef struct _xmlSecNssPrivKeysCacheEntry {
+    CERTCertificate*    cert;
+    SECKEYPrivateKey*   privkey;
+    int                 series;
+} xmlSecNssPrivKeysCacheEntry;
+
+static xmlMutexPtr                  gXmlSecNssPrivKeysCacheMutex = NULL;
+static xmlSecNssPrivKeysCacheEntry  gXmlSecNssPrivKeysCache[XMLSEC_NSS_PRIV_KEYS_CACHE_MAX_SIZE];
+static xmlSecSize                   gXmlSecNssPrivKeysCacheSize = 0;
+static xmlSecSize                   gXmlSecNssPrivKeysCacheNext = 0;
+
+static int
+xmlSecNssPrivKeysCacheInit(void) {
+    if(gXmlSecNssPrivKeysCacheMutex != NULL) {
+        return(0);
+    }
+
+    gXmlSecNssPrivKeysCacheMutex = xmlNewMutex();
+    if(gXmlSecNssPrivKeysCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    memset(gXmlSecNssPrivKeysCache, 0, sizeof(gXmlSecNssPrivKeysCache));
+    gXmlSecNssPrivKeysCacheSize = 0;
+    gXmlSecNssPrivKeysCacheNext = 0;
+    return(0);
+}
+
+static void
+xmlSecNssPrivKeysCacheEntryFinalize(xmlSecNssPrivKeysCacheEntry* entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->privkey != NULL) {
+        SECKEY_DestroyPrivateKey(entry->privkey);
+    }
+    if(entry->cert != NULL) {
+        CERT_DestroyCertificate(entry->cert);
+    }
+    memset(entry, 0, sizeof(xmlSecNssPrivKeysCacheEntry));
+}
+
+/* should be called under lock */
+static void
+xmlSecNssPrivKeysCacheRemove(xmlSecSize pos) {
+    xmlSecAssert(pos < gXmlSecNssPrivKeysCacheSize);
+
+    xmlSecNssPrivKeysCacheEntryFinalize(&(gXmlSecNssPrivKeysCache[pos]));
+    --gXmlSecNssPrivKeysCacheSize;
+    if(pos < gXmlSecNssPrivKeysCacheSize) {
+        gXmlSecNssPrivKeysCache[pos] = gXmlSecNssPrivKeysCache[gXmlSecNssPrivKeysCacheSize];
+        memset(&(gXmlSecNssPrivKeysCache[gXmlSecNssPrivKeysCacheSize]), 0, sizeof(xmlSecNssPrivKeysCacheEntry));
+    }
+    gXmlSecNssPrivKeysCacheNext = 0;
+}
+
+static void
+xmlSecNssPrivKeysCacheShutdown(void) {
+    if(gXmlSecNssPrivKeysCacheMutex == NULL) {
+        return;
+    }
+    while(gXmlSecNssPrivKeysCacheSize > 0) {
+        xmlSecNssPrivKeysCacheRemove(gXmlSecNssPrivKeysCacheSize - 1);
+    }
+
+    xmlFreeMutex(gXmlSecNssPrivKeysCacheMutex);
+    gXmlSecNssPrivKeysCacheMutex = NULL;
+}
+
+/* returns 1 if the cached key can still be used */
+static int
+xmlSecNssPrivKeysCacheEntryIsValid(xmlSecNssPrivKeysCacheEntry* entry) {
+    PK11SlotInfo* slot;
+    SECItem item;
+    SECStatus rv;
+
+    xmlSecAssert2(entry != NULL, 0);
+    xmlSecAssert2(entry->privkey != NULL, 0);
+
+    slot = entry->privkey->pkcs11Slot;
+    if((slot == NULL) || (PK11_IsPresent(slot) != PR_TRUE) || (PK11_GetSlotSeries(slot) != entry->series)) {
+        return(0);
+    }
+    if((PK11_NeedLogin(slot) == PR_TRUE) && (PK11_IsLoggedIn(slot, NULL) != PR_TRUE)) {
+        return(0);
+    }
+
+    /* the key object might be deleted */
+    memset(&item, 0, sizeof(item));
+    rv = PK11_ReadRawAttribute(PK11_TypePrivKey, entry->privkey, CKA_CLASS, &item);
+    if(rv != SECSuccess) {
+        return(0);
+    }
+    SECITEM_FreeItem(&item, PR_FALSE);
+    return(1);
+}
+
+/* should be called under lock */
+static xmlSecSize
+xmlSecNssPrivKeysCacheFind(CERTCertificate* cert) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecNssPrivKeysCacheSize; ++ii) {
+        if((gXmlSecNssPrivKeysCache[ii].cert == cert) ||
+           (SECITEM_ItemsAreEqual(&(gXmlSecNssPrivKeysCache[ii].cert->derCert), &(cert->derCert)) == PR_TRUE)
+        ) {
+            return(ii);
+        }
+    }
+    return(gXmlSecNssPrivKeysCacheSize);
+}
+
+/* should be called under lock */
+static void
+xmlSecNssPrivKeysCacheAdd(CERTCertificate* cert, SECKEYPrivateKey* privkey) {
+    xmlSecNssPrivKeysCacheEntry* entry;
+    xmlSecNssPrivKeysCacheEntry tmp;
+
+    xmlSecAssert(cert != NULL);
+    xmlSecAssert(privkey != NULL);
+
+    memset(&tmp, 0, sizeof(tmp));
+    tmp.cert = CERT_DupCertificate(cert);
+    if(tmp.cert == NULL) {
+        xmlSecNssError("CERT_DupCertificate", NULL);
+        return;
+    }
+    tmp.privkey = SECKEY_CopyPrivateKey(privkey);
+    if(tmp.privkey == NULL) {
+        xmlSecNssError("SECKEY_CopyPrivateKey", NULL);
+        xmlSecNssPrivKeysCacheEntryFinalize(&tmp);
+        return;
+    }
+    tmp.series = PK11_GetSlotSeries(privkey->pkcs11Slot);
+
+    if(gXmlSecNssPrivKeysCacheSize < XMLSEC_NSS_PRIV_KEYS_CACHE_MAX_SIZE) {
+        entry = &(gXmlSecNssPrivKeysCache[gXmlSecNssPrivKeysCacheSize++]);
+    } else {
+        /* replace the oldest entry */
+        if(gXmlSecNssPrivKeysCacheNext >= XMLSEC_NSS_PRIV_KEYS_CACHE_MAX_SIZE) {
+            gXmlSecNssPrivKeysCacheNext = 0;
+        }
+        entry = &(gXmlSecNssPrivKeysCache[gXmlSecNssPrivKeysCacheNext++]);
+        xmlSecNssPrivKeysCacheEntryFinalize(entry);
+    }
+    (*entry) = tmp;
+}
+
+/**
+ * xmlSecNssFindKeyByAnyCert:
+ * @cert:               the certificate.
+ *
+ * Finds the private key for @cert in any slot (see PK11_FindKeyByAnyCert()).
+ * The found keys are cached and the next lookups for the same certificate
+ * skip the slots search while the token stays present and logged in.
+ *
+ * Returns: the private key or NULL if the key is not found or an error occurs.
+ */
+SECKEYPrivateKey*
+xmlSecNssFindKeyByAnyCert(CERTCertificate* cert) {
+    SECKEYPrivateKey* privkey = NULL;
+    xmlSecSize pos;
+
+    xmlSecAssert2(cert != NULL, NULL);
+
+    if(gXmlSecNssPrivKeysCacheMutex != NULL) {
+        xmlMutexLock(gXmlSecNssPrivKeysCacheMutex);
+        pos = xmlSecNssPrivKeysCacheFind(cert);
+        if(pos < gXmlSecNssPrivKeysCacheSize) {
+            if(xmlSecNssPrivKeysCacheEntryIsValid(&(gXmlSecNssPrivKeysCache[pos])) == 1) {
+                privkey = SECKEY_CopyPrivateKey(gXmlSecNssPrivKeysCache[pos].privkey);
+            } else {
+                xmlSecNssPrivKeysCacheRemove(pos);
+            }
+        }
+        xmlMutexUnlock(gXmlSecNssPrivKeysCacheMutex);
+
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoKeyCtx, (privkey != NULL) ? 1 : 0);
+        if(privkey != NULL) {
+            return(privkey);
+        }
+    }
+
+    /* search outside of the lock */
+    privkey = PK11_FindKeyByAnyCert(cert, NULL);
+    if(privkey == NULL) {
+        return(NULL);
+    }
+
+    /* not fatal if we can't cache it */
+    if((gXmlSecNssPrivKeysCacheMutex != NULL) && (privkey->pkcs11Slot != NULL)) {
+        xmlMutexLock(gXmlSecNssPrivKeysCacheMutex);
+        if(xmlSecNssPrivKeysCacheFind(cert) >= gXmlSecNssPrivKeysCacheSize) {
+            xmlSecNssPrivKeysCacheAdd(cert, privkey);
+        }
+        xmlMutexUnlock(gXmlSecNssPrivKeysCacheMutex);
+    }
+    return(privkey);
+}
+
 /**
  * xmlSecNssGenerateRandom:
  * @buffer:             the destination buffer.
@@ -168,12 +168,15 @@ xmlSecNssDigestInitialize(xmlSecTransformPtr transform) {
         return(-1);
     }
 
-    ctx->digestCtx = PK11_CreateDigestContext(ctx->digest->offset);
+    ctx->digestCtx = xmlSecNssDigestContextCreate(ctx->digest->offset);
     if(ctx->digestCtx == NULL) {
-        xmlSecNssError("PK11_CreateDigestContext", xmlSecTransformGetName(transform));
+        xmlSecInternalError("xmlSecNssDigestContextCreate", xmlSecTransformGetName(transform));
         return(-1);
     }
 
+    /* the digest only reads the input, no need to copy it */
+    transform->borrowInput = 1;
+
     return(0);
 }
 
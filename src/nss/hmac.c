@@ -35,6 +35,7 @@
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 #include "../transform_helpers.h"
+#include "private.h"
 
 /**************************************************************************
  *
@@ -265,10 +266,6 @@ xmlSecNssHmacSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
     xmlSecKeyDataPtr value;
     xmlSecBufferPtr buffer;
     xmlSecSize bufferSize;
-    SECItem keyItem;
-    SECItem ignore;
-    PK11SlotInfo* slot;
-    PK11SymKey* symKey;
 
     xmlSecAssert2(xmlSecNssHmacCheckId(transform), -1);
     xmlSecAssert2((transform->operation == xmlSecTransformOperationSign) || (transform->operation == xmlSecTransformOperationVerify), -1);
@@ -292,35 +289,13 @@ xmlSecNssHmacSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
         return(-1);
     }
 
-    memset(&ignore, 0, sizeof(ignore));
-    memset(&keyItem, 0, sizeof(keyItem));
-    keyItem.data = xmlSecBufferGetData(buffer);
-    XMLSEC_SAFE_CAST_SIZE_TO_UINT(bufferSize, keyItem.len, return(-1), xmlSecTransformGetName(transform));
-
-    slot = PK11_GetBestSlot(ctx->digestType, NULL);
-    if(slot == NULL) {
-        xmlSecNssError("PK11_GetBestSlot", xmlSecTransformGetName(transform));
-        return(-1);
-    }
-
-    symKey = PK11_ImportSymKey(slot, ctx->digestType, PK11_OriginDerive,
-                               CKA_SIGN, &keyItem, NULL);
-    if(symKey == NULL) {
-        xmlSecNssError("PK11_ImportSymKey", xmlSecTransformGetName(transform));
-        PK11_FreeSlot(slot);
-        return(-1);
-    }
-
-    ctx->digestCtx = PK11_CreateContextBySymKey(ctx->digestType, CKA_SIGN, symKey, &ignore);
+    ctx->digestCtx = xmlSecNssHmacContextCreate(ctx->digestType,
+        xmlSecBufferGetData(buffer), bufferSize);
     if(ctx->digestCtx == NULL) {
-        xmlSecNssError("PK11_CreateContextBySymKey", xmlSecTransformGetName(transform));
-        PK11_FreeSymKey(symKey);
-        PK11_FreeSlot(slot);
+        xmlSecInternalError("xmlSecNssHmacContextCreate", xmlSecTransformGetName(transform));
         return(-1);
     }
 
-    PK11_FreeSymKey(symKey);
-    PK11_FreeSlot(slot);
     return(0);
 }
 
@@ -242,9 +242,9 @@ xmlSecNssKeysStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name, xmlSecKe
         }
 
         if (keyReq->keyType & xmlSecKeyDataTypePrivate) {
-            privkey = PK11_FindKeyByAnyCert(cert, NULL);
+            privkey = xmlSecNssFindKeyByAnyCert(cert);
             if (privkey == NULL) {
-                xmlSecNssError("PK11_FindKeyByAnyCert", NULL);
+                xmlSecInternalError("xmlSecNssFindKeyByAnyCert", NULL);
                 goto done;
             }
         }
@@ -63,6 +63,8 @@ static xmlSecKWAesKlass xmlSecNssKWAesKlass = {
     /* callbacks */
     xmlSecNSSKWAesBlockEncrypt,         /* xmlSecKWAesBlockEncryptMethod       encrypt; */
     xmlSecNSSKWAesBlockDecrypt,         /* xmlSecKWAesBlockDecryptMethod       decrypt; */
+    NULL,                               /* xmlSecKWAesBlocksEncryptMethod      encryptBlocks; */
+    NULL,                               /* xmlSecKWAesBlocksDecryptMethod      decryptBlocks; */
 
     /* for the future */
     NULL,                               /* void*                               reserved0; */
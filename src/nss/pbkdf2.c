@@ -51,6 +51,7 @@ struct _xmlSecNssPbkdf2Ctx {
     xmlSecTransformPbkdf2Params params;
     SECOidTag hashAlgo;
     xmlSecBuffer key;
+    xmlSecBuffer cacheId;
 };
 XMLSEC_TRANSFORM_DECLARE(NssPbkdf2, xmlSecNssPbkdf2Ctx)
 #define xmlSecNssPbkdf2CtxSize XMLSEC_TRANSFORM_SIZE(NssPbkdf2)
@@ -104,6 +105,12 @@ xmlSecNssPbkdf2Initialize(xmlSecTransformPtr transform) {
         xmlSecNssPbkdf2Finalize(transform);
         return(-1);
     }
+    ret = xmlSecBufferInitialize(&(ctx->cacheId), XMLSEC_NSS_KDF_DEFAULT_BUF_SIZE);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize(cacheId)", NULL);
+        xmlSecNssPbkdf2Finalize(transform);
+        return(-1);
+    }
     ret = xmlSecTransformPbkdf2ParamsInitialize(&(ctx->params));
     if(ret < 0) {
         xmlSecInternalError("xmlSecTransformPbkdf2ParamsInitialize", NULL);
@@ -126,6 +133,7 @@ xmlSecNssPbkdf2Finalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     xmlSecBufferFinalize(&(ctx->key));
+    xmlSecBufferFinalize(&(ctx->cacheId));
     xmlSecTransformPbkdf2ParamsFinalize(&(ctx->params));
 
     memset(ctx, 0, sizeof(xmlSecNssPbkdf2Ctx));
@@ -385,12 +393,34 @@ xmlSecNssPbkdf2Execute(xmlSecTransformPtr transform, int last, xmlSecTransformCt
         }
         ctx->params.keyLength = transform->expectedOutputSize;
 
+        /* the same key might be already derived */
+        ret = xmlSecTransformPbkdf2ParamsGetCacheId(&(ctx->params), &(ctx->cacheId));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformPbkdf2ParamsGetCacheId", xmlSecTransformGetName(transform));
+            return(-1);
+        }
+        ret = xmlSecTransformKdfCacheFind(transform, &(ctx->cacheId),
+            xmlSecBufferGetData(&(ctx->key)), xmlSecBufferGetSize(&(ctx->key)), out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheFind", xmlSecTransformGetName(transform));
+            return(-1);
+        } else if(ret > 0) {
+            transform->status = xmlSecTransformStatusFinished;
+            return(0);
+        }
+
         /* derive */
         ret = xmlSecNssPbkdf2Derive(ctx, out);
         if(ret < 0) {
             xmlSecInternalError("xmlSecNssPbkdf2Derive", xmlSecTransformGetName(transform));
             return(-1);
         }
+        ret = xmlSecTransformKdfCacheAdd(transform, &(ctx->cacheId),
+            xmlSecBufferGetData(&(ctx->key)), xmlSecBufferGetSize(&(ctx->key)), out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheAdd", xmlSecTransformGetName(transform));
+            return(-1);
+        }
 
         /* done */
         transform->status = xmlSecTransformStatusFinished;
@@ -37,6 +37,22 @@ extern "C" {
  */
 #define XMLSEC_NSS_MAX_DIGEST_SIZE              128
 
+/******************************************************************************
+ *
+ * Template contexts
+ *
+ ******************************************************************************/
+PK11Context* xmlSecNssDigestContextCreate               (SECOidTag digest);
+PK11Context* xmlSecNssHmacContextCreate                 (CK_MECHANISM_TYPE digestType,
+                                                         const xmlSecByte* key,
+                                                         xmlSecSize keySize);
+
+/******************************************************************************
+ *
+ * Private keys cache
+ *
+ ******************************************************************************/
+SECKEYPrivateKey* xmlSecNssFindKeyByAnyCert             (CERTCertificate* cert);
 
 /******************************************************************************
  *
@@ -54,7 +70,6 @@ typedef struct _xmlSecNssX509FindCertCtx {
 
     CERTName* issuerName;
     SECItem* issuerNameItem;
-    PRUint64 issuerSN;
     CERTIssuerAndSN issuerAndSN;
     int issuerAndSNInitialized;
 
@@ -86,17 +101,23 @@ xmlSecKeyPtr xmlSecNssX509FindKeyByValue                (xmlSecPtrListPtr keysLi
 SECOidTag  xmlSecNssX509GetDigestFromAlgorithm          (const xmlChar* href);
 
 
-/* NSS has a list for Certs but not Crls so we have to do it ourselves */
+/* NSS has a list for Certs but not Crls so we have to do it ourselves; each node
+ * also keeps the CRL entries sorted by serial number for revocation checks */
 typedef struct _xmlSecNssX509CrlNode xmlSecNssX509CrlNode, *xmlSecNssX509CrlNodePtr;
 struct _xmlSecNssX509CrlNode {
     xmlSecNssX509CrlNodePtr  next;
     CERTSignedCrl           *crl;
+    CERTCrlEntry           **entries;
+    size_t                   entriesNum;
 };
 
 xmlSecNssX509CrlNodePtr xmlSecNssX509CrlListDuplicate  (xmlSecNssX509CrlNodePtr head);
 void       xmlSecNssX509CrlListDestroy                 (xmlSecNssX509CrlNodePtr head);
 int        xmlSecNssX509CrlListAdoptCrl                (xmlSecNssX509CrlNodePtr * head,
                                                         CERTSignedCrl* crl);
+CERTCrlEntry* xmlSecNssX509CrlNodeFindEntry            (xmlSecNssX509CrlNodePtr node,
+                                                        SECItem* serialNumber,
+                                                        size_t* pos);
 
 CERTCertificate* xmlSecNssX509CertDerRead               (CERTCertDBHandle *handle,
                                                          xmlSecByte* buf,
@@ -107,6 +128,7 @@ CERTSignedCrl*   xmlSecNssX509CrlDerRead                (xmlSecByte* buf,
 
 int              xmlSecNssX509CertGetTime               (PRTime* t,
                                                          time_t* res);
+void             xmlSecNssX509CrlsChanged               (void);
 #endif /* XMLSEC_NO_X509 */
 
 #ifdef __cplusplus
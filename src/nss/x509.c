@@ -783,9 +783,9 @@ xmlSecNssKeyDataX509Read(xmlSecKeyDataPtr data, xmlSecKeyX509DataValuePtr x509Va
         int stopOnUnknownCert = 0;
 
 
-        x509Store = xmlSecKeysMngrGetDataStore(keysMngr, xmlSecNssX509StoreId);
+        x509Store = xmlSecKeysMngrFindDataStore(keysMngr, xmlSecNssX509StoreId);
         if(x509Store == NULL) {
-            xmlSecInternalError("xmlSecKeysMngrGetDataStore", xmlSecKeyDataGetName(data));
+            xmlSecInternalError("xmlSecKeysMngrFindDataStore", xmlSecKeyDataGetName(data));
             goto done;
         }
 
@@ -982,9 +982,9 @@ xmlSecNssVerifyAndAdoptX509KeyData(xmlSecKeyPtr key, xmlSecKeyDataPtr data,  xml
     }
 
     /* lets find a cert we can verify */
-    x509Store = xmlSecKeysMngrGetDataStore(keyInfoCtx->keysMngr, xmlSecNssX509StoreId);
+    x509Store = xmlSecKeysMngrFindDataStore(keyInfoCtx->keysMngr, xmlSecNssX509StoreId);
     if(x509Store == NULL) {
-        xmlSecInternalError("xmlSecKeysMngrGetDataStore", xmlSecKeyDataGetName(data));
+        xmlSecInternalError("xmlSecKeysMngrFindDataStore", xmlSecKeyDataGetName(data));
         return(-1);
     }
     cert = xmlSecNssX509StoreVerify(x509Store, ctx->certsList, keyInfoCtx);
@@ -1107,7 +1107,7 @@ xmlSecNssX509CertGetKey(CERTCertificate* cert) {
     }
 
     /* see if we can find private key too for this cert */
-    privkey = PK11_FindKeyByAnyCert(cert, NULL);
+    privkey = xmlSecNssFindKeyByAnyCert(cert);
 
     data = xmlSecNssPKIAdoptKey(privkey, pubkey);
     if(data == NULL) {
@@ -1198,6 +1198,7 @@ xmlSecNssX509CrlDerRead(xmlSecByte* buf, xmlSecSize size, unsigned int flags) {
         PK11_FreeSlot(slot);
         return(NULL);
     }
+    xmlSecNssX509CrlsChanged();
 
     PK11_FreeSlot(slot);
     return(crl);
@@ -1397,14 +1398,122 @@ xmlSecNssX509CrlListDestroy(xmlSecNssX509CrlNodePtr head) {
     while(head != NULL) {
         tmp = head->next;
         SEC_DestroyCrl(head->crl);
+        if(head->entries != NULL) {
+            PR_Free(head->entries);
+        }
         PR_Free(head);
         head = tmp;
     }
 }
 
+static int
+xmlSecNssX509CrlEntryCompareSerial(const SECItem* a, const SECItem* b) {
+    if(a->len != b->len) {
+        return((a->len < b->len) ? -1 : 1);
+    }
+    if(a->len == 0) {
+        return(0);
+    }
+    return(memcmp(a->data, b->data, a->len));
+}
+
+static int
+xmlSecNssX509CrlEntryCompare(const void* a, const void* b) {
+    const CERTCrlEntry* entryA = *(const CERTCrlEntry * const *)a;
+    const CERTCrlEntry* entryB = *(const CERTCrlEntry * const *)b;
+
+    return(xmlSecNssX509CrlEntryCompareSerial(&(entryA->serialNumber), &(entryB->serialNumber)));
+}
+
+/* builds the index of the crl entries sorted by serial number */
+static int
+xmlSecNssX509CrlNodeIndex(xmlSecNssX509CrlNodePtr node) {
+    size_t num;
+    PRUint32 allocSize;
+
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->crl != NULL, -1);
+    xmlSecAssert2(node->entries == NULL, -1);
+
+    if(node->crl->crl.entries == NULL) {
+        return(0);
+    }
+    for(num = 0; node->crl->crl.entries[num] != NULL; ++num) ;
+    if(num == 0) {
+        return(0);
+    }
+
+    if(num > SIZE_MAX / sizeof(CERTCrlEntry*)) {
+        xmlSecInvalidSizeOtherError("too many crl entries", NULL);
+        return(-1);
+    }
+    XMLSEC_SAFE_CAST_SIZE_T_TO_UINT(sizeof(CERTCrlEntry*) * num, allocSize, return(-1), NULL);
+    node->entries = (CERTCrlEntry**)PR_Malloc(allocSize);
+    if(node->entries == NULL) {
+        xmlSecNssError("PR_Malloc", NULL);
+        return(-1);
+    }
+    memcpy(node->entries, node->crl->crl.entries, sizeof(CERTCrlEntry*) * num);
+    qsort(node->entries, num, sizeof(CERTCrlEntry*), xmlSecNssX509CrlEntryCompare);
+    node->entriesNum = num;
+    return(0);
+}
+
+/**
+ * xmlSecNssX509CrlNodeFindEntry:
+ * @node:               the CRL list node.
+ * @serialNumber:       the cert serial number.
+ * @pos:                the search start position (in), the found entry position (out).
+ *
+ * Finds the next CRL entry for @serialNumber starting from @pos (use 0 to find
+ * the first entry) in the sorted entries index.
+ *
+ * Returns: the CRL entry or NULL if there are no more entries for @serialNumber.
+ */
+CERTCrlEntry*
+xmlSecNssX509CrlNodeFindEntry(xmlSecNssX509CrlNodePtr node, SECItem* serialNumber, size_t* pos) {
+    size_t lo, hi, mid;
+
+    xmlSecAssert2(node != NULL, NULL);
+    xmlSecAssert2(serialNumber != NULL, NULL);
+    xmlSecAssert2(pos != NULL, NULL);
+
+    if(node->entries == NULL) {
+        return(NULL);
+    }
+
+    /* next entry with the same serial (if any) */
+    if((*pos) > 0) {
+        if(((*pos) < node->entriesNum) &&
+           (xmlSecNssX509CrlEntryCompareSerial(&(node->entries[(*pos)]->serialNumber), serialNumber) == 0)) {
+            return(node->entries[(*pos)]);
+        }
+        return(NULL);
+    }
+
+    /* find the first entry with the serial */
+    lo = 0;
+    hi = node->entriesNum;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(xmlSecNssX509CrlEntryCompareSerial(&(node->entries[mid]->serialNumber), serialNumber) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if((lo < node->entriesNum) &&
+       (xmlSecNssX509CrlEntryCompareSerial(&(node->entries[lo]->serialNumber), serialNumber) == 0)) {
+        (*pos) = lo;
+        return(node->entries[lo]);
+    }
+    return(NULL);
+}
+
 int
 xmlSecNssX509CrlListAdoptCrl(xmlSecNssX509CrlNodePtr * head, CERTSignedCrl* crl) {
     xmlSecNssX509CrlNodePtr crlnode;
+    int ret;
 
     xmlSecAssert2(head != NULL, -1);
     xmlSecAssert2(crl != NULL, -1);
@@ -1416,8 +1525,16 @@ xmlSecNssX509CrlListAdoptCrl(xmlSecNssX509CrlNodePtr * head, CERTSignedCrl* crl)
     }
 
     memset(crlnode, 0, sizeof(xmlSecNssX509CrlNode));
-    crlnode->next = (*head);
     crlnode->crl = crl;
+
+    ret = xmlSecNssX509CrlNodeIndex(crlnode);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecNssX509CrlNodeIndex", NULL);
+        PR_Free(crlnode);
+        return(-1);
+    }
+
+    crlnode->next = (*head);
     (*head) = crlnode;
     return(0);
 }
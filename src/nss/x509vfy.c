@@ -22,18 +22,23 @@
 #include <ctype.h>
 #include <errno.h>
 
+#include <pratom.h>
 #include <cert.h>
 #include <secerr.h>
 #include <secder.h>
 #include <sechash.h>
 
+#include <libxml/threads.h>
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/keyinfo.h>
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/base64.h>
+#include <xmlsec/bn.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/xmltree.h>
 
 #include <xmlsec/nss/crypto.h>
@@ -42,6 +47,33 @@
 #include "../cast_helpers.h"
 #include "private.h"
 
+/**************************************************************************
+ *
+ * Verification results cache: the successful verifications are identified
+ * by the leaf cert DER digest, the digest of the certs from the document
+ * and the verification time. The results for the current time verification
+ * expire with the first certificate in the chain. The store certs are not
+ * part of the id, the cache is flushed when they change. The CRLs imported
+ * into the NSS DB from the documents invalidate all the entries.
+ *
+ *************************************************************************/
+#define XMLSEC_NSS_X509_VERIFY_CACHE_DIGEST_SIZE        SHA256_LENGTH
+#define XMLSEC_NSS_X509_MAX_CHAIN_DEPTH                 16
+
+typedef struct _xmlSecNssX509VerifyCacheEntry           xmlSecNssX509VerifyCacheEntry,
+                                                        *xmlSecNssX509VerifyCacheEntryPtr;
+struct _xmlSecNssX509VerifyCacheEntry {
+    int                 used;
+    xmlSecByte          leafDigest[XMLSEC_NSS_X509_VERIFY_CACHE_DIGEST_SIZE];
+    xmlSecByte          certsDigest[XMLSEC_NSS_X509_VERIFY_CACHE_DIGEST_SIZE];
+    time_t              verificationTime;
+    PRInt32             crlsGeneration;
+    PRTime              expires;
+};
+
+/* incremented every time a CRL is imported into the NSS DB */
+static PRInt32 gXmlSecNssX509CrlsGeneration = 0;
+
 /**************************************************************************
  *
  * Internal NSS X509 store CTX
@@ -63,6 +95,17 @@ struct _xmlSecNssX509StoreCtx {
 
     xmlSecNssX509CrlNodePtr crlsList;
     unsigned int     numCrls;
+
+    /* the trusted certs (also in certsList) used as the only trust anchors
+     * for the CERT_PKIXVerifyCert() verification if enabled */
+    CERTCertList*    trustedCertsList;
+    int              useTrustAnchors;
+
+    /* verification results cache (disabled by default) */
+    xmlMutexPtr                         verifyCacheMutex;
+    xmlSecNssX509VerifyCacheEntryPtr    verifyCache;
+    xmlSecSize                          verifyCacheMaxSize;
+    xmlSecSize                          verifyCachePos;
 };
 
 /****************************************************************************
@@ -84,9 +127,10 @@ static int              xmlSecNssX509NameStringRead     (const xmlSecByte **in,
                                                          int ingoreTrailingSpaces);
 static xmlSecByte *     xmlSecNssX509NameRead           (const xmlChar *str);
 
-static int              xmlSecNssNumToItem              (PLArenaPool *arena,
+static int              xmlSecNssSerialToItem           (PLArenaPool *arena,
                                                          SECItem *it,
-                                                         PRUint64 num);
+                                                         const xmlChar *serial);
+static void             xmlSecNssX509VerifyCacheReset   (xmlSecNssX509StoreCtxPtr ctx);
 
 
 static xmlSecKeyDataStoreKlass xmlSecNssX509StoreKlass = {
@@ -250,24 +294,22 @@ xmlSecNssX509StoreFindCertByValue(xmlSecKeyDataStorePtr store, xmlSecKeyX509Data
 
 /* returns 1 if cert was revoked, 0 if not, and a negative value if an error occurs */
 static int
-xmlSecNssX509StoreCheckIfCertIsRevoked(CERTCertificate* cert, CERTSignedCrl* crl, xmlSecKeyInfoCtx* keyInfoCtx) {
+xmlSecNssX509StoreCheckIfCertIsRevoked(CERTCertificate* cert, xmlSecNssX509CrlNodePtr crlNode, xmlSecKeyInfoCtx* keyInfoCtx) {
     CERTCrlEntry *entry;
     SECStatus rv;
+    size_t pos = 0;
     int ret;
-    int ii;
 
     xmlSecAssert2(cert != NULL, -1);
-    xmlSecAssert2(crl != NULL, -1);
+    xmlSecAssert2(crlNode != NULL, -1);
     xmlSecAssert2(keyInfoCtx != NULL, -1);
 
-    /* do we have any revocation entries? */
-    if (crl->crl.entries == NULL) {
-        return(0);
-    }
-    for(ii = 0; ((entry = crl->crl.entries[ii]) != NULL); ++ii) {
-        if (SECITEM_CompareItem(&(cert->serialNumber), &(entry->serialNumber)) != SECEqual) {
-            continue;
-        }
+    /* the entries are sorted by serial number when CRL is adopted, walk
+     * all the entries for the cert serial number (if any) */
+    for(entry = xmlSecNssX509CrlNodeFindEntry(crlNode, &(cert->serialNumber), &pos);
+        entry != NULL;
+        ++pos, entry = xmlSecNssX509CrlNodeFindEntry(crlNode, &(cert->serialNumber), &pos))
+    {
         /* check revocation date: if we are checking against current time, we assume
          * that CRL and revocation do NOT come from the future and we don't need to check
          * the timestamps */
@@ -300,7 +342,7 @@ xmlSecNssX509StoreCheckIfCertIsRevoked(CERTCertificate* cert, CERTSignedCrl* crl
 }
 
 static int
-xmlSecNssX509StoreFindBestCrl(xmlSecNssX509StoreCtxPtr x509StoreCtx, CERTCertificate* cert, CERTSignedCrl ** res, xmlSecKeyInfoCtx* keyInfoCtx) {
+xmlSecNssX509StoreFindBestCrl(xmlSecNssX509StoreCtxPtr x509StoreCtx, CERTCertificate* cert, xmlSecNssX509CrlNodePtr * res, xmlSecKeyInfoCtx* keyInfoCtx) {
     xmlSecNssX509CrlNodePtr cur;
     PRTime lastUpdate = 0;
     PRTime resLastUpdate = 0;
@@ -330,7 +372,7 @@ xmlSecNssX509StoreFindBestCrl(xmlSecNssX509StoreCtxPtr x509StoreCtx, CERTCertifi
 
         /* Use latest CRL by the last update time */
         if(((*res) == NULL) || (resLastUpdate < lastUpdate)) {
-            (*res) = cur->crl;
+            (*res) = cur;
             resLastUpdate = lastUpdate;
         }
     }
@@ -361,7 +403,7 @@ xmlSecNssX509StoreRemoveRevokedCerts(xmlSecNssX509StoreCtxPtr x509StoreCtx, CERT
     }
 
     for (cur = CERT_LIST_HEAD(certs); !CERT_LIST_END(cur, certs); cur = CERT_LIST_NEXT(cur)) {
-        CERTSignedCrl* crl = NULL;
+        xmlSecNssX509CrlNodePtr crl = NULL;
 
         if(cur->cert == NULL) {
             continue;
@@ -419,6 +461,222 @@ xmlSecNssX509StoreFindChildCert(CERTCertificate* cert, CERTCertList* certs) {
      return(NULL);
 }
 
+/* the caller is responsible for locking */
+static void
+xmlSecNssX509VerifyCacheFlush(xmlSecNssX509StoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache != NULL) {
+        memset(ctx->verifyCache, 0, sizeof(xmlSecNssX509VerifyCacheEntry) * ctx->verifyCacheMaxSize);
+    }
+    ctx->verifyCachePos = 0;
+}
+
+/* the store certs have changed */
+static void
+xmlSecNssX509VerifyCacheReset(xmlSecNssX509StoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache == NULL) {
+        return;
+    }
+    xmlMutexLock(ctx->verifyCacheMutex);
+    xmlSecNssX509VerifyCacheFlush(ctx);
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
+/**
+ * xmlSecNssX509CrlsChanged:
+ *
+ * Invalidates the verification results caches of all the stores: called
+ * when a CRL is imported into the NSS DB.
+ */
+void
+xmlSecNssX509CrlsChanged(void) {
+    PR_ATOMIC_INCREMENT(&gXmlSecNssX509CrlsGeneration);
+}
+
+/* prepares the cache entry (without expiration time) for the @cert verification with @certs */
+static int
+xmlSecNssX509VerifyCacheEntryInit(xmlSecNssX509VerifyCacheEntryPtr entry, CERTCertificate* cert,
+    CERTCertList* certs, xmlSecKeyInfoCtx* keyInfoCtx
+) {
+    HASHContext* hashCtx = NULL;
+    CERTCertListNode* cur;
+    unsigned int len = 0;
+    SECStatus rv;
+    int res = -1;
+
+    xmlSecAssert2(entry != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(certs != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+
+    memset(entry, 0, sizeof(xmlSecNssX509VerifyCacheEntry));
+    entry->verificationTime = keyInfoCtx->certsVerificationTime;
+    entry->crlsGeneration = PR_ATOMIC_ADD(&gXmlSecNssX509CrlsGeneration, 0);
+
+    rv = HASH_HashBuf(HASH_AlgSHA256, entry->leafDigest, cert->derCert.data, cert->derCert.len);
+    if(rv != SECSuccess) {
+        xmlSecNssError("HASH_HashBuf(leaf)", NULL);
+        goto done;
+    }
+
+    hashCtx = HASH_Create(HASH_AlgSHA256);
+    if(hashCtx == NULL) {
+        xmlSecNssError("HASH_Create", NULL);
+        goto done;
+    }
+    HASH_Begin(hashCtx);
+    for(cur = CERT_LIST_HEAD(certs); !CERT_LIST_END(cur, certs); cur = CERT_LIST_NEXT(cur)) {
+        if(cur->cert == NULL) {
+            continue;
+        }
+        HASH_Update(hashCtx, cur->cert->derCert.data, cur->cert->derCert.len);
+    }
+    HASH_End(hashCtx, entry->certsDigest, &len, sizeof(entry->certsDigest));
+    if(len != sizeof(entry->certsDigest)) {
+        xmlSecNssError("HASH_End", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(hashCtx != NULL) {
+        HASH_Destroy(hashCtx);
+    }
+    return(res);
+}
+
+/* returns 1 if @entry matches a not expired cache entry, 0 otherwise */
+static int
+xmlSecNssX509VerifyCacheFind(xmlSecNssX509StoreCtxPtr ctx, xmlSecNssX509VerifyCacheEntryPtr entry) {
+    xmlSecNssX509VerifyCacheEntryPtr cur;
+    PRTime now;
+    xmlSecSize ii;
+    int res = 0;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(entry != NULL, 0);
+
+    if(ctx->verifyCache == NULL) {
+        return(0);
+    }
+
+    now = PR_Now();
+    xmlMutexLock(ctx->verifyCacheMutex);
+    for(ii = 0; ii < ctx->verifyCacheMaxSize; ++ii) {
+        cur = &(ctx->verifyCache[ii]);
+        if(cur->used == 0) {
+            continue;
+        }
+        if((cur->crlsGeneration != entry->crlsGeneration) ||
+           ((cur->expires > 0) && (cur->expires <= now))) {
+            memset(cur, 0, sizeof(xmlSecNssX509VerifyCacheEntry));
+            continue;
+        }
+        if((cur->verificationTime == entry->verificationTime) &&
+           (memcmp(cur->leafDigest, entry->leafDigest, sizeof(cur->leafDigest)) == 0) &&
+           (memcmp(cur->certsDigest, entry->certsDigest, sizeof(cur->certsDigest)) == 0)
+        ) {
+            res = 1;
+            break;
+        }
+    }
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+
+    xmlSecStatsCacheLookup(xmlSecStatsCacheX509Verify, res);
+    return(res);
+}
+
+static void
+xmlSecNssX509VerifyCacheAdd(xmlSecNssX509StoreCtxPtr ctx, xmlSecNssX509VerifyCacheEntryPtr entry) {
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(entry != NULL);
+
+    if(ctx->verifyCache == NULL) {
+        return;
+    }
+
+    /* replace the oldest entry */
+    xmlMutexLock(ctx->verifyCacheMutex);
+    entry->used = 1;
+    memcpy(&(ctx->verifyCache[ctx->verifyCachePos]), entry, sizeof(xmlSecNssX509VerifyCacheEntry));
+    ctx->verifyCachePos = (ctx->verifyCachePos + 1) % ctx->verifyCacheMaxSize;
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
+/* returns the earliest NotAfter time in the @cert chain or 0 if unknown */
+static PRTime
+xmlSecNssX509ChainGetExpires(CERTCertificate* cert, PRTime timeboundary) {
+    CERTCertificate* cur;
+    CERTCertificate* issuer;
+    PRTime notBefore, notAfter;
+    PRTime res = 0;
+    int depth;
+
+    xmlSecAssert2(cert != NULL, 0);
+
+    cur = CERT_DupCertificate(cert);
+    for(depth = 0; (cur != NULL) && (depth < XMLSEC_NSS_X509_MAX_CHAIN_DEPTH); ++depth) {
+        if(CERT_GetCertTimes(cur, &notBefore, &notAfter) != SECSuccess) {
+            res = 0;
+            break;
+        }
+        if((res == 0) || (notAfter < res)) {
+            res = notAfter;
+        }
+        if(cur->isRoot == PR_TRUE) {
+            break;
+        }
+        issuer = CERT_FindCertIssuer(cur, timeboundary, certUsageEmailSigner);
+        CERT_DestroyCertificate(cur);
+        cur = issuer;
+    }
+    if(cur != NULL) {
+        CERT_DestroyCertificate(cur);
+    }
+    return(res);
+}
+
+static SECStatus
+xmlSecNssX509StoreVerifyCert(xmlSecNssX509StoreCtxPtr ctx, CERTCertificate* cert, PRTime timeboundary) {
+    CERTValInParam cvin[5];
+    CERTValOutParam cvout[1];
+
+    xmlSecAssert2(ctx != NULL, SECFailure);
+    xmlSecAssert2(cert != NULL, SECFailure);
+
+    if(ctx->useTrustAnchors == 0) {
+        /* it's important to set the usage here, otherwise no real verification
+         * is performed. */
+        return(CERT_VerifyCertificate(CERT_GetDefaultCertDB(), cert, PR_FALSE,
+                    certificateUsageEmailSigner,
+                    timeboundary , NULL, NULL, NULL));
+    }
+
+    /* NSS uses the DB trusted roots if the trust anchors list is empty */
+    if((ctx->trustedCertsList == NULL) || CERT_LIST_EMPTY(ctx->trustedCertsList)) {
+        PORT_SetError(SEC_ERROR_UNKNOWN_ISSUER);
+        return(SECFailure);
+    }
+
+    cvin[0].type = cert_pi_trustAnchors;
+    cvin[0].value.pointer.chain = ctx->trustedCertsList;
+    cvin[1].type = cert_pi_useOnlyTrustAnchors;
+    cvin[1].value.scalar.b = PR_TRUE;
+    cvin[2].type = cert_pi_date;
+    cvin[2].value.scalar.time = timeboundary;
+    cvin[3].type = cert_pi_revocationFlags;
+    cvin[3].value.pointer.revocation = CERT_GetClassicOCSPDisabledPolicy();
+    cvin[4].type = cert_pi_end;
+    cvout[0].type = cert_po_end;
+
+    return(CERT_PKIXVerifyCert(cert, certificateUsageEmailSigner, cvin, cvout, NULL));
+}
+
 /**
  * xmlSecNssX509StoreVerify:
  * @store:              the pointer to X509 key data store klass.
@@ -435,7 +693,9 @@ xmlSecNssX509StoreVerify(xmlSecKeyDataStorePtr store, CERTCertList* certs, xmlSe
     CERTCertListNode* cur;
     CERTCertList* good_certs = NULL;
     CERTCertificate* cert = NULL;
+    xmlSecNssX509VerifyCacheEntry entry;
     SECStatus status = SECFailure;
+    int useCache;
     int64 timeboundary;
     int64 tmp1, tmp2;
     PRErrorCode err;
@@ -487,12 +747,32 @@ xmlSecNssX509StoreVerify(xmlSecKeyDataStorePtr store, CERTCertList* certs, xmlSe
             status = SECSuccess;
             break;
         }
-        /* it's important to set the usage here, otherwise no real verification
-         * is performed. */
-        status = CERT_VerifyCertificate(CERT_GetDefaultCertDB(), cert, PR_FALSE,
-                    certificateUsageEmailSigner,
-                    timeboundary , NULL, NULL, NULL);
+
+        /* check the verification results cache first */
+        useCache = 0;
+        if(ctx->verifyCache != NULL) {
+            ret = xmlSecNssX509VerifyCacheEntryInit(&entry, cert, certs, keyInfoCtx);
+            if(ret >= 0) {
+                if(xmlSecNssX509VerifyCacheFind(ctx, &entry) == 1) {
+                    status = SECSuccess;
+                    break;
+                }
+                useCache = 1;
+            } else {
+                /* not fatal: just verify the cert */
+                xmlSecInternalError("xmlSecNssX509VerifyCacheEntryInit", xmlSecKeyDataStoreGetName(store));
+            }
+        }
+
+        status = xmlSecNssX509StoreVerifyCert(ctx, cert, timeboundary);
         if(status == SECSuccess) {
+            /* the results for the fixed verification time never expire */
+            if(useCache != 0) {
+                if(keyInfoCtx->certsVerificationTime <= 0) {
+                    entry.expires = xmlSecNssX509ChainGetExpires(cert, timeboundary);
+                }
+                xmlSecNssX509VerifyCacheAdd(ctx, &entry);
+            }
             break;
         }
     }
@@ -577,10 +857,32 @@ xmlSecNssX509StoreAdoptCert(xmlSecKeyDataStorePtr store, CERTCertificate* cert,
         xmlSecNssError("CERT_AddCertToListTail", xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
+    xmlSecNssX509VerifyCacheReset(ctx);
 
     if(type == xmlSecKeyDataTypeTrusted) {
+        CERTCertificate* trustedCert;
         SECStatus status;
 
+        /* keep the trust anchors list for CERT_PKIXVerifyCert() */
+        if(ctx->trustedCertsList == NULL) {
+            ctx->trustedCertsList = CERT_NewCertList();
+            if(ctx->trustedCertsList == NULL) {
+                xmlSecNssError("CERT_NewCertList", xmlSecKeyDataStoreGetName(store));
+                return(-1);
+            }
+        }
+        trustedCert = CERT_DupCertificate(cert);
+        if(trustedCert == NULL) {
+            xmlSecNssError("CERT_DupCertificate", xmlSecKeyDataStoreGetName(store));
+            return(-1);
+        }
+        status = CERT_AddCertToListTail(ctx->trustedCertsList, trustedCert);
+        if(status != SECSuccess) {
+            xmlSecNssError("CERT_AddCertToListTail", xmlSecKeyDataStoreGetName(store));
+            CERT_DestroyCertificate(trustedCert);
+            return(-1);
+        }
+
         /* if requested, mark the certificate as trusted */
         CERTCertTrust trust;
         status = CERT_DecodeTrustString(&trust, "TCu,Cu,Tu");
@@ -624,9 +926,114 @@ xmlSecNssX509StoreAdoptCrl(xmlSecKeyDataStorePtr store, CERTSignedCrl * crl) {
         xmlSecInternalError("xmlSecNssX509CrlListAdoptCrl", xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
+    xmlSecNssX509VerifyCacheReset(ctx);
+    return(0);
+}
+
+/**
+ * xmlSecNssX509StoreSetUseTrustAnchors:
+ * @store:              the pointer to X509 key data store klass.
+ * @enabled:            1 to verify against the store trusted certs only or
+ *                      0 to use the NSS DB trust settings (default).
+ *
+ * When enabled, the certificates are verified with CERT_PKIXVerifyCert()
+ * and only the trusted certificates added to @store with
+ * #xmlSecNssX509StoreAdoptCert are used as the trust anchors: the trust
+ * settings in the NSS DB are ignored and the verification fails if there
+ * are no trusted certificates in @store. The CRLs are checked locally
+ * (OCSP is disabled). This function is not thread safe and should be
+ * called before the store is used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecNssX509StoreSetUseTrustAnchors(xmlSecKeyDataStorePtr store, int enabled) {
+    xmlSecNssX509StoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecNssX509StoreId), -1);
+
+    ctx = xmlSecNssX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    ctx->useTrustAnchors = (enabled != 0) ? 1 : 0;
+    xmlSecNssX509VerifyCacheReset(ctx);
+    return(0);
+}
+
+/**
+ * xmlSecNssX509StoreEnableVerifyCache:
+ * @store:              the pointer to X509 key data store klass.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables (or re-creates empty) cache for the successful certificates
+ * verification results: the same leaf certificate with the same certificates
+ * from the document and the same verification time is verified only once.
+ * The results for the current time verification expire with the first
+ * certificate in the chain. The cache is flushed when certificates or CRLs
+ * are added to the store and when a CRL is imported into the NSS DB. This
+ * function is not thread safe and should be called before the store is used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecNssX509StoreEnableVerifyCache(xmlSecKeyDataStorePtr store, xmlSecSize maxSize) {
+    xmlSecNssX509StoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecNssX509StoreId), -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    ctx = xmlSecNssX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    xmlSecNssX509StoreDisableVerifyCache(store);
+
+    ctx->verifyCache = (xmlSecNssX509VerifyCacheEntryPtr)xmlMalloc(sizeof(xmlSecNssX509VerifyCacheEntry) * maxSize);
+    if(ctx->verifyCache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecNssX509VerifyCacheEntry) * maxSize, xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+    memset(ctx->verifyCache, 0, sizeof(xmlSecNssX509VerifyCacheEntry) * maxSize);
+
+    ctx->verifyCacheMutex = xmlNewMutex();
+    if(ctx->verifyCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyDataStoreGetName(store));
+        xmlFree(ctx->verifyCache);
+        ctx->verifyCache = NULL;
+        return(-1);
+    }
+    ctx->verifyCacheMaxSize = maxSize;
+    ctx->verifyCachePos = 0;
     return(0);
 }
 
+/**
+ * xmlSecNssX509StoreDisableVerifyCache:
+ * @store:              the pointer to X509 key data store klass.
+ *
+ * Disables the certificates verification results cache. This function
+ * is not thread safe and should not be called while the store is used.
+ */
+void
+xmlSecNssX509StoreDisableVerifyCache(xmlSecKeyDataStorePtr store) {
+    xmlSecNssX509StoreCtxPtr ctx;
+
+    xmlSecAssert(xmlSecKeyDataStoreCheckId(store, xmlSecNssX509StoreId));
+
+    ctx = xmlSecNssX509StoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache != NULL) {
+        xmlFree(ctx->verifyCache);
+        ctx->verifyCache = NULL;
+    }
+    if(ctx->verifyCacheMutex != NULL) {
+        xmlFreeMutex(ctx->verifyCacheMutex);
+        ctx->verifyCacheMutex = NULL;
+    }
+    ctx->verifyCacheMaxSize = 0;
+    ctx->verifyCachePos = 0;
+}
+
 static int
 xmlSecNssX509StoreInitialize(xmlSecKeyDataStorePtr store) {
     xmlSecNssX509StoreCtxPtr ctx;
@@ -648,6 +1055,11 @@ xmlSecNssX509StoreFinalize(xmlSecKeyDataStorePtr store) {
     ctx = xmlSecNssX509StoreGetCtx(store);
     xmlSecAssert(ctx != NULL);
 
+    xmlSecNssX509StoreDisableVerifyCache(store);
+    if (ctx->trustedCertsList != NULL) {
+        CERT_DestroyCertList(ctx->trustedCertsList);
+        ctx->trustedCertsList = NULL;
+    }
     if (ctx->certsList) {
         CERT_DestroyCertList(ctx->certsList);
         ctx->certsList = NULL;
@@ -943,46 +1355,51 @@ xmlSecNssX509NameStringRead(const xmlSecByte **in, xmlSecSize *inSize,
     return(0);
 }
 
-/* code lifted from NSS */
+/* converts the decimal @serial to the DER integer bytes */
 static int
-xmlSecNssNumToItem(PLArenaPool *arena, SECItem *it, PRUint64 ui)
+xmlSecNssSerialToItem(PLArenaPool *arena, SECItem *it, const xmlChar *serial)
 {
-    unsigned char bb[9];
-    unsigned int bb_len, zeros_len;
-    int res;
+    xmlSecBn bn;
+    xmlSecSize size;
+    int ret;
+    int res = -1;
 
     xmlSecAssert2(arena != NULL, -1);
     xmlSecAssert2(it != NULL, -1);
+    xmlSecAssert2(serial != NULL, -1);
+
+    ret = xmlSecBnInitialize(&bn, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBnInitialize", NULL);
+        return(-1);
+    }
+
+    /* the result has 00 prefix if the highest bit is set */
+    ret = xmlSecBnFromDecString(&bn, serial);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBnFromDecString", NULL);
+        goto done;
+    }
+    size = xmlSecBnGetSize(&bn);
+    if(size <= 0) {
+        xmlSecInvalidSizeDataError("serial", size, "> 0", NULL);
+        goto done;
+    }
 
-    bb[0] = 0; /* important: we should have 0 at the beginning! */
-    bb[1] = (unsigned char) (ui >> 56);
-    bb[2] = (unsigned char) (ui >> 48);
-    bb[3] = (unsigned char) (ui >> 40);
-    bb[4] = (unsigned char) (ui >> 32);
-    bb[5] = (unsigned char) (ui >> 24);
-    bb[6] = (unsigned char) (ui >> 16);
-    bb[7] = (unsigned char) (ui >> 8);
-    bb[8] = (unsigned char) (ui);
-
-    /*
-    ** Small integers are encoded in a single byte. Larger integers
-    ** require progressively more space. Start from 1 because byte at
-    ** position 0 is zero
-    */
-    bb_len = sizeof(bb) / sizeof(bb[0]);
-    for(zeros_len = 1; (zeros_len < bb_len) && (bb[zeros_len] == 0); ++zeros_len) {
-    }
-
-    it->len = bb_len - (zeros_len - 1);
-    it->data = (unsigned char *)PORT_ArenaAlloc(arena, it->len * sizeof(bb[0]));
+    XMLSEC_SAFE_CAST_SIZE_TO_UINT(size, it->len, goto done, NULL);
+    it->data = (unsigned char *)PORT_ArenaAlloc(arena, it->len);
     if (it->data == NULL) {
+        xmlSecNssError("PORT_ArenaAlloc", NULL);
         it->len = 0;
-        return (-1);
+        goto done;
     }
+    PORT_Memcpy(it->data, xmlSecBnGetData(&bn), it->len);
 
-    PORT_Memcpy(it->data, bb + (zeros_len - 1), it->len);
-    XMLSEC_SAFE_CAST_UINT_TO_INT(it->len, res, return(-1), NULL);
+    /* success */
+    res = 0;
 
+done:
+    xmlSecBnFinalize(&bn);
     return(res);
 }
 
@@ -1161,15 +1578,9 @@ int xmlSecNssX509FindCertCtxInitialize(xmlSecNssX509FindCertCtxPtr ctx,
         ctx->issuerAndSN.derIssuer.data = ctx->issuerNameItem->data;
         ctx->issuerAndSN.derIssuer.len  = ctx->issuerNameItem->len;
 
-        /* TBD: serial num can be arbitrarily long */
-        if(PR_sscanf((char *)issuerSerial, "%llu", &(ctx->issuerSN)) != 1) {
-            xmlSecNssError("PR_sscanf(issuerSerial)", NULL);
-            xmlSecNssX509FindCertCtxFinalize(ctx);
-            return(-1);
-        }
-        ret = xmlSecNssNumToItem(ctx->arena, &(ctx->issuerAndSN.serialNumber), ctx->issuerSN);
-        if(ret <= 0) {
-            xmlSecInternalError("xmlSecNssNumToItem(serialNumber)", NULL);
+        ret = xmlSecNssSerialToItem(ctx->arena, &(ctx->issuerAndSN.serialNumber), issuerSerial);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecNssSerialToItem(serialNumber)", NULL);
             xmlSecNssX509FindCertCtxFinalize(ctx);
             return(-1);
         }
@@ -23,10 +23,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include <libxml/threads.h>
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/errors.h>
 
 #include <xmlsec/openssl/app.h>
@@ -57,8 +60,16 @@
 #endif /* XMLSEC_OPENSSL_API_300 */
 
 #include "../cast_helpers.h"
+#include "../keysdata_helpers.h"
 #include "private.h"
 
+/* the key kind detected from the first bytes of the key data */
+typedef enum {
+    xmlSecOpenSSLAppKeyKindUnknown = 0,
+    xmlSecOpenSSLAppKeyKindPrivate,
+    xmlSecOpenSSLAppKeyKindPublic
+} xmlSecOpenSSLAppKeyKind;
+
 static int      xmlSecOpenSSLDefaultPasswordCallback    (char *buf,
                                                          int bufsiz,
                                                          int verify,
@@ -79,6 +90,13 @@ static xmlSecKeyPtr xmlSecOpenSSLAppStoreKeyLoad        (const char *uri,
                                                          const char *pwd,
                                                          void* pwdCallback,
                                                          void* pwdCallbackCtx);
+static xmlSecOpenSSLAppKeyKind xmlSecOpenSSLAppKeyBioGetKind
+                                                        (BIO* bio,
+                                                         int isPem);
+#ifdef XMLSEC_OPENSSL_API_300
+static int      xmlSecOpenSSLAppPropQueriesConfInit     (CONF_IMODULE* md,
+                                                         const CONF* cnf);
+#endif /* XMLSEC_OPENSSL_API_300 */
 
 
 /* conversion from ptr to func "the right way" */
@@ -109,6 +127,31 @@ XMLSEC_FUNC_TO_PTR_IMPL(pem_password_cb)
 
 #endif /* XMLSEC_OPENSSL_API_300 */
 
+/* deferred initialization (see xmlSecOpenSSLAppSetDeferredInit) */
+static int              gXmlSecOpenSSLAppDeferredInit = 0;
+static int              gXmlSecOpenSSLAppDeferredInitPending = 0;
+static xmlMutexPtr      gXmlSecOpenSSLAppDeferredInitMutex = NULL;
+
+static uint64_t
+xmlSecOpenSSLAppGetInitOptions(void) {
+    uint64_t opts = 0;
+
+    opts |= OPENSSL_INIT_LOAD_CRYPTO_STRINGS;
+    opts |= OPENSSL_INIT_ADD_ALL_CIPHERS;
+    opts |= OPENSSL_INIT_ADD_ALL_DIGESTS;
+    opts |= OPENSSL_INIT_LOAD_CONFIG;
+
+#if !defined(OPENSSL_IS_BORINGSSL)
+    opts |= OPENSSL_INIT_ASYNC;
+#endif /* !defined(OPENSSL_IS_BORINGSSL) */
+
+#if !defined(OPENSSL_IS_BORINGSSL) && !defined(XMLSEC_OPENSSL_API_300)
+    opts |= OPENSSL_INIT_ENGINE_ALL_BUILTIN;
+#endif /* !defined(OPENSSL_IS_BORINGSSL) && !defined(XMLSEC_OPENSSL_API_300) */
+
+    return(opts);
+}
+
 /**
  * xmlSecOpenSSLAppInit:
  * @config:             the path to certs.
@@ -117,6 +160,21 @@ XMLSEC_FUNC_TO_PTR_IMPL(pem_password_cb)
  * by XMLSec command line utility and called before
  * @xmlSecInit function.
  *
+ * For OpenSSL 3.0+, the OpenSSL config file may route algorithms to specific
+ * providers (see @xmlSecOpenSSLSetPropQuery) with the "xmlsec_prop_queries"
+ * module, where "default" sets the query for algorithms without an entry:
+ *
+ *     [openssl_init]
+ *     xmlsec_prop_queries = xmlsec_prop_queries_sect
+ *
+ *     [xmlsec_prop_queries_sect]
+ *     RSA = provider=qatprovider
+ *     default = ?fips=yes
+ *
+ * If the deferred initialization is enabled (see #xmlSecOpenSSLAppSetDeferredInit)
+ * then the OpenSSL initialization is postponed until the crypto library
+ * is used for the first time.
+ *
  * Returns: 0 on success or a negative value otherwise.
  */
 int
@@ -130,47 +188,171 @@ xmlSecOpenSSLAppInit(const char* config) {
     OSSL_PROVIDER * defaultProvider = OSSL_PROVIDER_load(libCtx, "default");
     if(!libCtx || !legacyProvider || !defaultProvider) {
         xmlSecOpenSSLError("OSSL_LIB_CTX_new or OSSL_PROVIDER_load", NULL);
-        goto error;
+        goto done;
     }
     xmlSecOpenSSLSetLibCtx(libCtx);
     */
 #endif /* XMLSEC_OPENSSL_API_300 */
 
+    xmlSecStatsSpan span;
     int ret;
-    uint64_t opts = 0;
-
-    opts |= OPENSSL_INIT_LOAD_CRYPTO_STRINGS;
-    opts |= OPENSSL_INIT_ADD_ALL_CIPHERS;
-    opts |= OPENSSL_INIT_ADD_ALL_DIGESTS;
-    opts |= OPENSSL_INIT_LOAD_CONFIG;
-
-#if !defined(OPENSSL_IS_BORINGSSL)
-    opts |= OPENSSL_INIT_ASYNC;
-#endif /* !defined(OPENSSL_IS_BORINGSSL) */
+    int res = -1;
 
-#if !defined(OPENSSL_IS_BORINGSSL) && !defined(XMLSEC_OPENSSL_API_300)
-    opts |= OPENSSL_INIT_ENGINE_ALL_BUILTIN;
-#endif /* !defined(OPENSSL_IS_BORINGSSL) && !defined(XMLSEC_OPENSSL_API_300) */
+    xmlSecStatsStartupStart(xmlSecStatsStartupCryptoAppInit, &span);
 
-    ret = OPENSSL_init_crypto(opts, NULL);
+#ifdef XMLSEC_OPENSSL_API_300
+    /* the module should be registered before the config file is loaded,
+     * even if it is loaded implicitly on the first use of OpenSSL */
+    ret = CONF_module_add("xmlsec_prop_queries", xmlSecOpenSSLAppPropQueriesConfInit, NULL);
     if(ret != 1) {
-        xmlSecOpenSSLError("OPENSSL_init_crypto", NULL);
-        goto error;
+        xmlSecOpenSSLError("CONF_module_add(xmlsec_prop_queries)", NULL);
+        goto done;
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
+
+    if(gXmlSecOpenSSLAppDeferredInit != 0) {
+        if(gXmlSecOpenSSLAppDeferredInitMutex == NULL) {
+            gXmlSecOpenSSLAppDeferredInitMutex = xmlNewMutex();
+            if(gXmlSecOpenSSLAppDeferredInitMutex == NULL) {
+                xmlSecXmlError("xmlNewMutex", NULL);
+                goto done;
+            }
+        }
+        gXmlSecOpenSSLAppDeferredInitPending = 1;
+    } else {
+        ret = OPENSSL_init_crypto(xmlSecOpenSSLAppGetInitOptions(), NULL);
+        if(ret != 1) {
+            xmlSecOpenSSLError("OPENSSL_init_crypto", NULL);
+            goto done;
+        }
     }
 
     if((config != NULL) && (xmlSecOpenSSLSetDefaultTrustedCertsFolder(BAD_CAST config) < 0)) {
         xmlSecInternalError("xmlSecOpenSSLSetDefaultTrustedCertsFolder", NULL);
-        goto error;
+        goto done;
     }
 
     /* done! */
-    return(0);
+    res = 0;
 
-error:
-    /* cleanup */
-    return(-1);
+done:
+    xmlSecStatsStartupEnd(&span);
+    return(res);
+}
+
+/**
+ * xmlSecOpenSSLAppSetDeferredInit:
+ * @enabled:            the flag.
+ *
+ * Enables or disables the deferred initialization: #xmlSecOpenSSLAppInit
+ * does not initialize OpenSSL (load the config file, providers and engines)
+ * and the X509 stores do not load the default trusted certificates until
+ * they are needed for the first time. This reduces the cold start time for
+ * the applications that might not need all of them (e.g. the short lived
+ * processes). The time spent in the deferred initialization is reported
+ * in the #xmlSecStatsStartupDeferredInit statistics. This function is not
+ * thread safe and should be called before #xmlSecOpenSSLAppInit.
+ */
+void
+xmlSecOpenSSLAppSetDeferredInit(int enabled) {
+    gXmlSecOpenSSLAppDeferredInit = enabled;
+}
+
+/**
+ * xmlSecOpenSSLAppGetDeferredInit:
+ *
+ * Checks if the deferred initialization is enabled (see
+ * #xmlSecOpenSSLAppSetDeferredInit).
+ *
+ * Returns: 1 if the deferred initialization is enabled or 0 otherwise.
+ */
+int
+xmlSecOpenSSLAppGetDeferredInit(void) {
+    return((gXmlSecOpenSSLAppDeferredInit != 0) ? 1 : 0);
 }
 
+/**
+ * xmlSecOpenSSLAppDeferredInit:
+ *
+ * Runs the OpenSSL initialization deferred by #xmlSecOpenSSLAppInit (if
+ * any). This function is called by the xmlsec-openssl library before
+ * the crypto library is used and is thread safe.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecOpenSSLAppDeferredInit(void) {
+    xmlSecStatsSpan span;
+    int ret;
+    int res = -1;
+
+    if(gXmlSecOpenSSLAppDeferredInitPending == 0) {
+        return(0);
+    }
+    xmlSecAssert2(gXmlSecOpenSSLAppDeferredInitMutex != NULL, -1);
+
+    xmlMutexLock(gXmlSecOpenSSLAppDeferredInitMutex);
+    if(gXmlSecOpenSSLAppDeferredInitPending == 0) {
+        /* another thread did it */
+        xmlMutexUnlock(gXmlSecOpenSSLAppDeferredInitMutex);
+        return(0);
+    }
+
+    xmlSecStatsStartupStart(xmlSecStatsStartupDeferredInit, &span);
+    ret = OPENSSL_init_crypto(xmlSecOpenSSLAppGetInitOptions(), NULL);
+    if(ret != 1) {
+        xmlSecOpenSSLError("OPENSSL_init_crypto", NULL);
+        goto done;
+    }
+    gXmlSecOpenSSLAppDeferredInitPending = 0;
+
+    /* done! */
+    res = 0;
+
+done:
+    xmlSecStatsStartupEnd(&span);
+    xmlMutexUnlock(gXmlSecOpenSSLAppDeferredInitMutex);
+    return(res);
+}
+
+#ifdef XMLSEC_OPENSSL_API_300
+/* reads the "xmlsec_prop_queries" section of the OpenSSL config file */
+static int
+xmlSecOpenSSLAppPropQueriesConfInit(CONF_IMODULE* md, const CONF* cnf) {
+    STACK_OF(CONF_VALUE)* sect;
+    CONF_VALUE* val;
+    const char* algorithm;
+    int ii, ret;
+
+    xmlSecAssert2(md != NULL, 0);
+    xmlSecAssert2(cnf != NULL, 0);
+
+    sect = NCONF_get_section(cnf, CONF_imodule_get_value(md));
+    if(sect == NULL) {
+        xmlSecOpenSSLError2("NCONF_get_section", NULL,
+            "section=%s", xmlSecErrorsSafeString(CONF_imodule_get_value(md)));
+        return(0);
+    }
+
+    for(ii = 0; ii < sk_CONF_VALUE_num(sect); ++ii) {
+        val = sk_CONF_VALUE_value(sect, ii);
+        if((val == NULL) || (val->name == NULL)) {
+            continue;
+        }
+        algorithm = (strcmp(val->name, "default") == 0) ? NULL : val->name;
+        ret = xmlSecOpenSSLSetPropQuery(algorithm, val->value);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecOpenSSLSetPropQuery", NULL,
+                "algorithm=%s", xmlSecErrorsSafeString(val->name));
+            return(0);
+        }
+    }
+
+    /* success */
+    return(1);
+}
+#endif /* XMLSEC_OPENSSL_API_300 */
+
 /**
  * xmlSecOpenSSLAppShutdown:
  *
@@ -182,6 +364,12 @@ error:
  */
 int
 xmlSecOpenSSLAppShutdown(void) {
+    gXmlSecOpenSSLAppDeferredInitPending = 0;
+    if(gXmlSecOpenSSLAppDeferredInitMutex != NULL) {
+        xmlFreeMutex(gXmlSecOpenSSLAppDeferredInitMutex);
+        gXmlSecOpenSSLAppDeferredInitMutex = NULL;
+    }
+
     /* OpenSSL 1.1.0+ does not require explicit cleanup */
     return(0);
 }
@@ -358,6 +546,7 @@ xmlSecOpenSSLAppKeyLoadBIO(BIO* bio, xmlSecKeyDataFormat format,
     EVP_PKEY* pKey = NULL;
     pem_password_cb* pwdCb = NULL;
     void* pwdCbCtx = NULL;
+    xmlSecOpenSSLAppKeyKind kind;
     int ret;
 
     xmlSecAssert2(bio != NULL, NULL);
@@ -375,10 +564,16 @@ xmlSecOpenSSLAppKeyLoadBIO(BIO* bio, xmlSecKeyDataFormat format,
     switch(format) {
     case xmlSecKeyDataFormatPem:
         /* try to read private key first; if can't read private key then
-         reset bio to the start of the file and try to read public key. */
-        pKey = PEM_read_bio_PrivateKey_ex(bio, NULL, pwdCb, pwdCbCtx, xmlSecOpenSSLGetLibCtx(), NULL);
-        if(pKey == NULL) {
-            (void)BIO_reset(bio);
+         reset bio to the start of the file and try to read public key.
+         If the PEM label tells the key kind then only one try is needed */
+        kind = xmlSecOpenSSLAppKeyBioGetKind(bio, 1);
+        if(kind != xmlSecOpenSSLAppKeyKindPublic) {
+            pKey = PEM_read_bio_PrivateKey_ex(bio, NULL, pwdCb, pwdCbCtx, xmlSecOpenSSLGetLibCtx(), NULL);
+        }
+        if((pKey == NULL) && (kind != xmlSecOpenSSLAppKeyKindPrivate)) {
+            if(kind == xmlSecOpenSSLAppKeyKindUnknown) {
+                (void)BIO_reset(bio);
+            }
             pKey = PEM_read_bio_PUBKEY_ex(bio, NULL, pwdCb, pwdCbCtx, xmlSecOpenSSLGetLibCtx(), NULL);
         }
 
@@ -389,10 +584,16 @@ xmlSecOpenSSLAppKeyLoadBIO(BIO* bio, xmlSecKeyDataFormat format,
         break;
     case xmlSecKeyDataFormatDer:
         /* try to read private key first; if can't read private key then
-         reset bio to the start of the file and try to read public key. */
-        pKey = d2i_PrivateKey_ex_bio(bio, NULL, xmlSecOpenSSLGetLibCtx(), NULL);
-        if(pKey == NULL) {
-            (void)BIO_reset(bio);
+         reset bio to the start of the file and try to read public key.
+         If the ASN.1 structure tells the key kind then only one try is needed */
+        kind = xmlSecOpenSSLAppKeyBioGetKind(bio, 0);
+        if(kind != xmlSecOpenSSLAppKeyKindPublic) {
+            pKey = d2i_PrivateKey_ex_bio(bio, NULL, xmlSecOpenSSLGetLibCtx(), NULL);
+        }
+        if((pKey == NULL) && (kind != xmlSecOpenSSLAppKeyKindPrivate)) {
+            if(kind == xmlSecOpenSSLAppKeyKindUnknown) {
+                (void)BIO_reset(bio);
+            }
 
             XMLSEC_OPENSSL_PUSH_LIB_CTX(return(NULL));
             pKey = d2i_PUBKEY_bio(bio, NULL);
@@ -473,6 +674,238 @@ xmlSecOpenSSLAppKeyLoadBIO(BIO* bio, xmlSecKeyDataFormat format,
     return(key);
 }
 
+/**************************************************************************
+ *
+ * Key kind sniffing: the PEM and DER key loaders try to read the private
+ * key first and then the public key. Each failed try decodes the data
+ * and fills the errors queue thus the key kind is detected from the PEM
+ * labels or the DER structure before decoding if possible.
+ *
+ *************************************************************************/
+#define XMLSEC_OPENSSL_APP_KEY_SNIFF_SIZE       4096
+
+/* PEM_read_bio_PrivateKey skips the other PEM blocks thus the key kind is
+ * known only if all the blocks are seen and only one kind is present */
+static xmlSecOpenSSLAppKeyKind
+xmlSecOpenSSLAppKeyPemGetKind(const char* data, size_t size, int complete) {
+    static const char beginLine[] = "-----BEGIN ";
+    static const char endLine[] = "-----";
+    static const char privateKey[] = "PRIVATE KEY";
+    static const char publicKey[] = "PUBLIC KEY";
+    int hasPrivate = 0;
+    int hasPublic = 0;
+    size_t ii, jj;
+
+    xmlSecAssert2(data != NULL, xmlSecOpenSSLAppKeyKindUnknown);
+
+    if(complete == 0) {
+        return(xmlSecOpenSSLAppKeyKindUnknown);
+    }
+
+    for(ii = 0; ii + sizeof(beginLine) - 1 <= size; ++ii) {
+        if(memcmp(data + ii, beginLine, sizeof(beginLine) - 1) != 0) {
+            continue;
+        }
+        ii += sizeof(beginLine) - 1;
+
+        /* find the end of the label */
+        for(jj = ii; jj + sizeof(endLine) - 1 <= size; ++jj) {
+            if(memcmp(data + jj, endLine, sizeof(endLine) - 1) == 0) {
+                break;
+            }
+        }
+        if(jj + sizeof(endLine) - 1 > size) {
+            break;
+        }
+
+        /* "PRIVATE KEY", "ENCRYPTED PRIVATE KEY", "RSA PRIVATE KEY", ... */
+        if((jj - ii >= sizeof(privateKey) - 1) &&
+           (memcmp(data + jj - (sizeof(privateKey) - 1), privateKey, sizeof(privateKey) - 1) == 0)) {
+            hasPrivate = 1;
+        }
+        /* only "PUBLIC KEY" is read by PEM_read_bio_PUBKEY */
+        if((jj - ii == sizeof(publicKey) - 1) && (memcmp(data + ii, publicKey, sizeof(publicKey) - 1) == 0)) {
+            hasPublic = 1;
+        }
+        ii = jj;
+    }
+
+    if((hasPrivate != 0) && (hasPublic == 0)) {
+        return(xmlSecOpenSSLAppKeyKindPrivate);
+    } else if((hasPrivate == 0) && (hasPublic != 0)) {
+        return(xmlSecOpenSSLAppKeyKindPublic);
+    }
+    return(xmlSecOpenSSLAppKeyKindUnknown);
+}
+
+/* reads the DER tag and length at @pos, returns 0 on success */
+static int
+xmlSecOpenSSLAppDerReadHeader(const xmlSecByte* data, size_t size, size_t* pos, xmlSecByte* tag, size_t* len) {
+    size_t ii, lenBytes;
+
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(pos != NULL, -1);
+    xmlSecAssert2(tag != NULL, -1);
+    xmlSecAssert2(len != NULL, -1);
+
+    if((*pos) + 2 > size) {
+        return(-1);
+    }
+    (*tag) = data[(*pos)++];
+    if(data[(*pos)] < 0x80) {
+        (*len) = data[(*pos)++];
+        return(0);
+    }
+
+    /* long form */
+    lenBytes = data[(*pos)++] & 0x7F;
+    if((lenBytes == 0) || (lenBytes > 4) || ((*pos) + lenBytes > size)) {
+        return(-1);
+    }
+    for((*len) = 0, ii = 0; ii < lenBytes; ++ii) {
+        (*len) = ((*len) << 8) | data[(*pos)++];
+    }
+    return(0);
+}
+
+/*
+ * PrivateKeyInfo, RSAPrivateKey, ECPrivateKey, ...: SEQUENCE { INTEGER, ... }
+ * SubjectPublicKeyInfo: SEQUENCE { SEQUENCE, BIT STRING }
+ */
+static xmlSecOpenSSLAppKeyKind
+xmlSecOpenSSLAppKeyDerGetKind(const xmlSecByte* data, size_t size) {
+    size_t pos = 0;
+    size_t len = 0;
+    xmlSecByte tag = 0;
+
+    xmlSecAssert2(data != NULL, xmlSecOpenSSLAppKeyKindUnknown);
+
+    if((xmlSecOpenSSLAppDerReadHeader(data, size, &pos, &tag, &len) < 0) || (tag != 0x30)) {
+        return(xmlSecOpenSSLAppKeyKindUnknown);
+    }
+    if(xmlSecOpenSSLAppDerReadHeader(data, size, &pos, &tag, &len) < 0) {
+        return(xmlSecOpenSSLAppKeyKindUnknown);
+    }
+    if(tag == 0x02) {
+        return(xmlSecOpenSSLAppKeyKindPrivate);
+    } else if((tag != 0x30) || (len > size - pos)) {
+        return(xmlSecOpenSSLAppKeyKindUnknown);
+    }
+
+    /* skip the algorithm identifier */
+    pos += len;
+    if((xmlSecOpenSSLAppDerReadHeader(data, size, &pos, &tag, &len) < 0) || (tag != 0x03)) {
+        return(xmlSecOpenSSLAppKeyKindUnknown);
+    }
+    return(xmlSecOpenSSLAppKeyKindPublic);
+}
+
+/* peeks at the memory or file @bio data without consuming it */
+static xmlSecOpenSSLAppKeyKind
+xmlSecOpenSSLAppKeyBioGetKind(BIO* bio, int isPem) {
+    char buf[XMLSEC_OPENSSL_APP_KEY_SNIFF_SIZE];
+    char* data = NULL;
+    size_t size = 0;
+    int complete = 0;
+    long len;
+
+    xmlSecAssert2(bio != NULL, xmlSecOpenSSLAppKeyKindUnknown);
+
+    if(BIO_method_type(bio) == BIO_TYPE_MEM) {
+        /* the memory BIO data is available without reading */
+        len = BIO_get_mem_data(bio, &data);
+        if((len <= 0) || (data == NULL)) {
+            return(xmlSecOpenSSLAppKeyKindUnknown);
+        }
+        size = (size_t)len;
+        complete = 1;
+    } else if(BIO_method_type(bio) == BIO_TYPE_FILE) {
+        int pos, ret;
+
+        pos = BIO_tell(bio);
+        if(pos < 0) {
+            return(xmlSecOpenSSLAppKeyKindUnknown);
+        }
+        ret = BIO_read(bio, buf, sizeof(buf));
+        if(BIO_seek(bio, pos) < 0) {
+            xmlSecOpenSSLError("BIO_seek", NULL);
+            return(xmlSecOpenSSLAppKeyKindUnknown);
+        }
+        if(ret <= 0) {
+            return(xmlSecOpenSSLAppKeyKindUnknown);
+        }
+        data = buf;
+        size = (size_t)ret;
+        complete = (size < sizeof(buf)) ? 1 : 0;
+    } else {
+        return(xmlSecOpenSSLAppKeyKindUnknown);
+    }
+
+    if(isPem != 0) {
+        return(xmlSecOpenSSLAppKeyPemGetKind(data, size, complete));
+    } else {
+        return(xmlSecOpenSSLAppKeyDerGetKind((const xmlSecByte*)data, size));
+    }
+}
+
+/**
+ * xmlSecOpenSSLAppKeyPoolLoad:
+ * @filename:           the key filename.
+ * @type:               the expected key type.
+ * @format:             the key file format.
+ * @pwd:                the key file password.
+ * @pwdCallback:        the key password callback.
+ * @pwdCallbackCtx:     the user context for password callback.
+ * @size:               the number of the key handles to load.
+ *
+ * Loads the key @size times into a new keys pool (see #xmlSecKeyPoolCreate).
+ * For the #xmlSecKeyDataFormatEngine and #xmlSecKeyDataFormatStore formats
+ * each load creates its own key handle in the engine or provider (e.g.
+ * PKCS#11 object handle and session), thus signing with the keys from
+ * the pool on several threads is not limited to one in-flight operation.
+ *
+ * Returns: pointer to the keys pool or NULL if an error occurs.
+ */
+xmlSecKeyPoolPtr
+xmlSecOpenSSLAppKeyPoolLoad(const char *filename, xmlSecKeyDataType type, xmlSecKeyDataFormat format,
+    const char *pwd, void* pwdCallback, void* pwdCallbackCtx, xmlSecSize size
+) {
+    xmlSecKeyPoolPtr pool;
+    xmlSecKeyPtr key;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(filename != NULL, NULL);
+    xmlSecAssert2(format != xmlSecKeyDataFormatUnknown, NULL);
+    xmlSecAssert2(size > 0, NULL);
+
+    pool = xmlSecKeyPoolCreate();
+    if(pool == NULL) {
+        xmlSecInternalError("xmlSecKeyPoolCreate", NULL);
+        return(NULL);
+    }
+
+    for(ii = 0; ii < size; ++ii) {
+        key = xmlSecOpenSSLAppKeyLoadEx(filename, type, format, pwd, pwdCallback, pwdCallbackCtx);
+        if(key == NULL) {
+            xmlSecInternalError3("xmlSecOpenSSLAppKeyLoadEx", NULL,
+                "filename=%s; index=" XMLSEC_SIZE_FMT, xmlSecErrorsSafeString(filename), ii);
+            xmlSecKeyPoolDestroy(pool);
+            return(NULL);
+        }
+
+        ret = xmlSecKeyPoolAdoptKey(pool, key);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeyPoolAdoptKey", NULL);
+            xmlSecKeyDestroy(key);
+            xmlSecKeyPoolDestroy(pool);
+            return(NULL);
+        }
+    }
+
+    return(pool);
+}
+
 static xmlSecKeyPtr
 xmlSecOpenSSLAppEngineKeyLoad(const char *engineName, const char *engineKeyId,
     xmlSecKeyDataType type, xmlSecKeyDataFormat format,
@@ -495,6 +928,13 @@ xmlSecOpenSSLAppEngineKeyLoad(const char *engineName, const char *engineKeyId,
     xmlSecAssert2(engineKeyId != NULL, NULL);
     xmlSecAssert2(format == xmlSecKeyDataFormatEngine, NULL);
 
+    /* the builtin engines are loaded by OpenSSL initialization */
+    ret = xmlSecOpenSSLAppDeferredInit();
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLAppDeferredInit", NULL);
+        return(NULL);
+    }
+
 #ifndef XMLSEC_OPENSSL_NO_PWD_CALLBACK
     /* prep pwd callbacks */
     if(pwd != NULL) {
@@ -825,6 +1265,13 @@ xmlSecOpenSSLAppStoreKeyLoad(const char *uri, xmlSecKeyDataType type, const char
 
     xmlSecAssert2(uri != NULL, NULL);
 
+    /* the store loaders might be configured in the OpenSSL config file */
+    ret = xmlSecOpenSSLAppDeferredInit();
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLAppDeferredInit", NULL);
+        return(NULL);
+    }
+
     /* prep pwd callbacks */
     if(pwd != NULL) {
         pwdCb = xmlSecOpenSSLDummyPasswordCallback;
@@ -996,6 +1443,31 @@ done:
 #endif /* !defined(XMLSEC_OPENSSL_NO_STORE) && !defined(XMLSEC_NO_X509) */
 }
 
+/* runs the tasks with the application callback or one by one if there is no callback */
+static int
+xmlSecOpenSSLAppRunTasks(xmlSecOpenSSLAppTaskCallback taskCallback, void* tasksCtx, xmlSecSize tasksSize,
+                         xmlSecOpenSSLAppRunTasksCallback runTasks, void* runTasksCtx) {
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(taskCallback != NULL, -1);
+
+    if(runTasks != NULL) {
+        ret = runTasks(taskCallback, tasksCtx, tasksSize, runTasksCtx);
+        if(ret < 0) {
+            xmlSecInternalError2("runTasks", NULL,
+                "tasksSize=" XMLSEC_SIZE_FMT, tasksSize);
+            return(-1);
+        }
+        return(0);
+    }
+
+    for(ii = 0; ii < tasksSize; ++ii) {
+        taskCallback(tasksCtx, ii);
+    }
+    return(0);
+}
+
 #ifndef XMLSEC_NO_X509
 
 /**
@@ -1631,6 +2103,38 @@ xmlSecOpenSSLAppKeysMngrCrlLoadMemory(xmlSecKeysMngrPtr mngr, const xmlSecByte*
     return(0);
 }
 
+/**
+ * xmlSecOpenSSLAppKeysMngrEnableX509VerifyCache:
+ * @mngr:               the keys manager.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables the cache of the successful certificates verification results
+ * in the X509 store of @mngr (see #xmlSecOpenSSLX509StoreEnableVerifyCache).
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecOpenSSLAppKeysMngrEnableX509VerifyCache(xmlSecKeysMngrPtr mngr, xmlSecSize maxSize) {
+    xmlSecKeyDataStorePtr x509Store;
+    int ret;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    x509Store = xmlSecKeysMngrGetDataStore(mngr, xmlSecOpenSSLX509StoreId);
+    if(x509Store == NULL) {
+        xmlSecInternalError("xmlSecKeysMngrGetDataStore(xmlSecOpenSSLX509StoreId)", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecOpenSSLX509StoreEnableVerifyCache(x509Store, maxSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509StoreEnableVerifyCache", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
 /**
  * xmlSecOpenSSLAppKeysMngrCrlLoadBIO:
  * @mngr:               the keys manager.
@@ -1740,6 +2244,127 @@ xmlSecOpenSSLAppKeysMngrAddCertsFile(xmlSecKeysMngrPtr mngr, const char *filenam
     return(0);
 }
 
+typedef struct _xmlSecOpenSSLAppCertsLoadCtx {
+    const char**                filenames;
+    X509**                      certs;
+    xmlSecKeyDataFormat         format;
+} xmlSecOpenSSLAppCertsLoadCtx, *xmlSecOpenSSLAppCertsLoadCtxPtr;
+
+static void
+xmlSecOpenSSLAppCertsLoadTask(void* tasksCtx, xmlSecSize pos) {
+    xmlSecOpenSSLAppCertsLoadCtxPtr ctx = (xmlSecOpenSSLAppCertsLoadCtxPtr)tasksCtx;
+    BIO* bio;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->filenames != NULL);
+    xmlSecAssert(ctx->filenames[pos] != NULL);
+    xmlSecAssert(ctx->certs != NULL);
+    xmlSecAssert(ctx->certs[pos] == NULL);
+
+    bio = xmlSecOpenSSLCreateReadFileBio(ctx->filenames[pos]);
+    if(bio == NULL) {
+        xmlSecInternalError2("xmlSecOpenSSLCreateReadFileBio", NULL,
+            "filename=%s", xmlSecErrorsSafeString(ctx->filenames[pos]));
+        return;
+    }
+
+    ctx->certs[pos] = xmlSecOpenSSLX509CertLoadBIO(bio, ctx->format);
+    if(ctx->certs[pos] == NULL) {
+        xmlSecInternalError2("xmlSecOpenSSLX509CertLoadBIO", NULL,
+            "filename=%s", xmlSecErrorsSafeString(ctx->filenames[pos]));
+    }
+    BIO_free_all(bio);
+}
+
+/**
+ * xmlSecOpenSSLAppKeysMngrCertsLoad:
+ * @mngr:               the keys manager.
+ * @filenames:          the certificate files.
+ * @filenamesSize:      the number of certificate files.
+ * @format:             the certificate files format.
+ * @type:               the flag that indicates is the certificates in @filenames
+ *                      trusted or not.
+ * @runTasks:           the optional callback to run the loading tasks (e.g. in parallel).
+ * @runTasksCtx:        the context for @runTasks.
+ *
+ * Reads certs from @filenames and adds them to the list of trusted or known
+ * untrusted certs in the keys manager. The files are parsed using @runTasks
+ * (or one by one if @runTasks is NULL) and the certs are added to the store
+ * only after all the files are parsed successfully.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecOpenSSLAppKeysMngrCertsLoad(xmlSecKeysMngrPtr mngr, const char** filenames, xmlSecSize filenamesSize,
+                                  xmlSecKeyDataFormat format, xmlSecKeyDataType type,
+                                  xmlSecOpenSSLAppRunTasksCallback runTasks, void* runTasksCtx) {
+    xmlSecOpenSSLAppCertsLoadCtx ctx;
+    xmlSecKeyDataStorePtr x509Store;
+    xmlSecSize ii;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(filenames != NULL, -1);
+    xmlSecAssert2(format != xmlSecKeyDataFormatUnknown, -1);
+
+    x509Store = xmlSecKeysMngrGetDataStore(mngr, xmlSecOpenSSLX509StoreId);
+    if(x509Store == NULL) {
+        xmlSecInternalError("xmlSecKeysMngrGetDataStore(xmlSecOpenSSLX509StoreId)", NULL);
+        return(-1);
+    }
+    if(filenamesSize <= 0) {
+        return(0);
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.filenames = filenames;
+    ctx.format = format;
+    ctx.certs = (X509**)xmlMalloc(sizeof(X509*) * filenamesSize);
+    if(ctx.certs == NULL) {
+        xmlSecMallocError(sizeof(X509*) * filenamesSize, NULL);
+        return(-1);
+    }
+    memset(ctx.certs, 0, sizeof(X509*) * filenamesSize);
+
+    ret = xmlSecOpenSSLAppRunTasks(xmlSecOpenSSLAppCertsLoadTask, &ctx, filenamesSize,
+        runTasks, runTasksCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLAppRunTasks", NULL);
+        goto done;
+    }
+    for(ii = 0; ii < filenamesSize; ++ii) {
+        if(ctx.certs[ii] == NULL) {
+            xmlSecInternalError2("xmlSecOpenSSLAppCertsLoadTask", NULL,
+                "filename=%s", xmlSecErrorsSafeString(filenames[ii]));
+            goto done;
+        }
+    }
+
+    /* all the certs are loaded, add them to the store */
+    for(ii = 0; ii < filenamesSize; ++ii) {
+        ret = xmlSecOpenSSLX509StoreAdoptCert(x509Store, ctx.certs[ii], type);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecOpenSSLX509StoreAdoptCert", NULL,
+                "filename=%s", xmlSecErrorsSafeString(filenames[ii]));
+            goto done;
+        }
+        ctx.certs[ii] = NULL; /* owned by store now */
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    for(ii = 0; ii < filenamesSize; ++ii) {
+        if(ctx.certs[ii] != NULL) {
+            X509_free(ctx.certs[ii]);
+        }
+    }
+    xmlFree(ctx.certs);
+    return(res);
+}
+
 
 #endif /* XMLSEC_NO_X509 */
 
@@ -1800,6 +2425,11 @@ xmlSecOpenSSLAppDefaultKeysMngrInit(xmlSecKeysMngrPtr mngr) {
 int
 xmlSecOpenSSLAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key) {
     xmlSecKeyStorePtr store;
+#ifndef XMLSEC_NO_X509
+    xmlSecKeyDataStorePtr x509Store;
+    xmlSecKeyDataPtr x509Data;
+#endif /* XMLSEC_NO_X509 */
+    int ret;
 
     xmlSecAssert2(mngr != NULL, -1);
     xmlSecAssert2(key != NULL, -1);
@@ -1810,7 +2440,148 @@ xmlSecOpenSSLAppDefaultKeysMngrAdoptKey(xmlSecKeysMngrPtr mngr, xmlSecKeyPtr key
         return(-1);
     }
 
-    return(xmlSecOpenSSLKeysStoreAdoptKey(store, key));
+#ifndef XMLSEC_NO_X509
+    /* share the certs and CRLs identical to the ones from the other keys */
+    x509Store = xmlSecKeysMngrGetDataStore(mngr, xmlSecOpenSSLX509StoreId);
+    x509Data = xmlSecKeyGetData(key, xmlSecOpenSSLKeyDataX509Id);
+    if((x509Data != NULL) && (xmlSecOpenSSLX509StoreIsInternEnabled(x509Store) == 1)) {
+        ret = xmlSecOpenSSLKeyDataX509Intern(x509Data, x509Store);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLKeyDataX509Intern", NULL);
+            return(-1);
+        }
+    }
+#endif /* XMLSEC_NO_X509 */
+
+    ret = xmlSecOpenSSLKeysStoreAdoptKey(store, key);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLKeysStoreAdoptKey", NULL);
+        return(-1);
+    }
+
+    /* the new key might be one of the recently not found keys */
+    xmlSecKeysMngrNotFoundCacheReset(mngr);
+    return(0);
+}
+
+typedef struct _xmlSecOpenSSLAppKeysLoadCtx {
+    const char**                filenames;
+    xmlSecKeyPtr*               keys;
+    xmlSecKeyDataType           type;
+    xmlSecKeyDataFormat         format;
+    const char*                 pwd;
+    void*                       pwdCallback;
+    void*                       pwdCallbackCtx;
+} xmlSecOpenSSLAppKeysLoadCtx, *xmlSecOpenSSLAppKeysLoadCtxPtr;
+
+static void
+xmlSecOpenSSLAppKeysLoadTask(void* tasksCtx, xmlSecSize pos) {
+    xmlSecOpenSSLAppKeysLoadCtxPtr ctx = (xmlSecOpenSSLAppKeysLoadCtxPtr)tasksCtx;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->filenames != NULL);
+    xmlSecAssert(ctx->filenames[pos] != NULL);
+    xmlSecAssert(ctx->keys != NULL);
+    xmlSecAssert(ctx->keys[pos] == NULL);
+
+    ctx->keys[pos] = xmlSecOpenSSLAppKeyLoadEx(ctx->filenames[pos], ctx->type, ctx->format,
+        ctx->pwd, ctx->pwdCallback, ctx->pwdCallbackCtx);
+    if(ctx->keys[pos] == NULL) {
+        xmlSecInternalError2("xmlSecOpenSSLAppKeyLoadEx", NULL,
+            "filename=%s", xmlSecErrorsSafeString(ctx->filenames[pos]));
+        return;
+    }
+}
+
+/**
+ * xmlSecOpenSSLAppDefaultKeysMngrKeysLoad:
+ * @mngr:               the pointer to keys manager.
+ * @filenames:          the key files.
+ * @filenamesSize:      the number of key files.
+ * @type:               the expected keys type.
+ * @format:             the key files format.
+ * @pwd:                the key files password.
+ * @pwdCallback:        the key password callback.
+ * @pwdCallbackCtx:     the user context for password callback.
+ * @runTasks:           the optional callback to run the loading tasks (e.g. in parallel).
+ * @runTasksCtx:        the context for @runTasks.
+ *
+ * Loads keys from @filenames and adds them to the keys manager @mngr created
+ * with #xmlSecOpenSSLAppDefaultKeysMngrInit function. The files are parsed
+ * using @runTasks (or one by one if @runTasks is NULL) and the keys are added
+ * to the keys manager only after all the files are parsed successfully.
+ * Note that @pwdCallback might be called concurrently from the tasks.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecOpenSSLAppDefaultKeysMngrKeysLoad(xmlSecKeysMngrPtr mngr, const char** filenames, xmlSecSize filenamesSize,
+                                        xmlSecKeyDataType type, xmlSecKeyDataFormat format,
+                                        const char *pwd, void* pwdCallback, void* pwdCallbackCtx,
+                                        xmlSecOpenSSLAppRunTasksCallback runTasks, void* runTasksCtx) {
+    xmlSecOpenSSLAppKeysLoadCtx ctx;
+    xmlSecSize ii;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(mngr != NULL, -1);
+    xmlSecAssert2(filenames != NULL, -1);
+    xmlSecAssert2(format != xmlSecKeyDataFormatUnknown, -1);
+
+    if(filenamesSize <= 0) {
+        return(0);
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.filenames = filenames;
+    ctx.type = type;
+    ctx.format = format;
+    ctx.pwd = pwd;
+    ctx.pwdCallback = pwdCallback;
+    ctx.pwdCallbackCtx = pwdCallbackCtx;
+    ctx.keys = (xmlSecKeyPtr*)xmlMalloc(sizeof(xmlSecKeyPtr) * filenamesSize);
+    if(ctx.keys == NULL) {
+        xmlSecMallocError(sizeof(xmlSecKeyPtr) * filenamesSize, NULL);
+        return(-1);
+    }
+    memset(ctx.keys, 0, sizeof(xmlSecKeyPtr) * filenamesSize);
+
+    ret = xmlSecOpenSSLAppRunTasks(xmlSecOpenSSLAppKeysLoadTask, &ctx, filenamesSize,
+        runTasks, runTasksCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLAppRunTasks", NULL);
+        goto done;
+    }
+    for(ii = 0; ii < filenamesSize; ++ii) {
+        if(ctx.keys[ii] == NULL) {
+            xmlSecInternalError2("xmlSecOpenSSLAppKeysLoadTask", NULL,
+                "filename=%s", xmlSecErrorsSafeString(filenames[ii]));
+            goto done;
+        }
+    }
+
+    /* all the keys are loaded, add them to the keys manager */
+    for(ii = 0; ii < filenamesSize; ++ii) {
+        ret = xmlSecOpenSSLAppDefaultKeysMngrAdoptKey(mngr, ctx.keys[ii]);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecOpenSSLAppDefaultKeysMngrAdoptKey", NULL,
+                "filename=%s", xmlSecErrorsSafeString(filenames[ii]));
+            goto done;
+        }
+        ctx.keys[ii] = NULL; /* owned by mngr now */
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    for(ii = 0; ii < filenamesSize; ++ii) {
+        if(ctx.keys[ii] != NULL) {
+            xmlSecKeyDestroy(ctx.keys[ii]);
+        }
+    }
+    xmlFree(ctx.keys);
+    return(res);
 }
 
 /**
@@ -28,14 +28,24 @@
 #include <xmlsec/openssl/crypto.h>
 #include <xmlsec/openssl/evp.h>
 #include "openssl_compat.h"
+#include "private.h"
 
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
+#include "../transform_helpers.h"
 
 #define XMLSEC_OPENSSL_EVP_CIPHER_PAD_SIZE    (2 * EVP_MAX_BLOCK_LENGTH)
 #define XMLSEC_OPENSSL_AES_GCM_NONCE_SIZE     12
 #define XMLSEC_OPENSSL_AES_GCM_TAG_SIZE       16
 
+/* the max size of the pending output (e.g. the iv) that is moved in front
+ * of the in place processed data instead of appending the data to it */
+#define XMLSEC_OPENSSL_AES_GCM_MAX_PREPEND_SIZE 64
+
+/* the max size of the data passed to one EVP_CipherUpdate() call
+ * by the parallel CBC decryption (a multiple of all block sizes) */
+#define XMLSEC_OPENSSL_CBC_SEGMENT_CHUNK_SIZE   (64*1024*1024)
+
 /**************************************************************************
  *
  * Internal OpenSSL Block cipher CTX
@@ -58,6 +68,7 @@ struct _xmlSecOpenSSLEvpBlockCipherCtx {
     xmlSecByte          key[EVP_MAX_KEY_LENGTH];
     xmlSecByte          iv[EVP_MAX_IV_LENGTH];
     xmlSecByte          pad[XMLSEC_OPENSSL_EVP_CIPHER_PAD_SIZE];
+    xmlSecByte          tag[XMLSEC_OPENSSL_AES_GCM_TAG_SIZE];
 };
 
 static int      xmlSecOpenSSLEvpBlockCipherCtxInit      (xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
@@ -71,8 +82,7 @@ static int      xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(xmlSecOpenSSLEvpBlockC
                                                          xmlSecSize inSize,
                                                          xmlSecBufferPtr out,
                                                          const xmlChar* cipherName,
-                                                         int final,
-                                                         xmlSecByte *tag);
+                                                         int final);
 static int      xmlSecOpenSSLEvpBlockCipherCtxUpdate    (xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
                                                          xmlSecBufferPtr in,
                                                          xmlSecBufferPtr out,
@@ -115,9 +125,9 @@ xmlSecOpenSSLEvpBlockCipherCtxInit(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
     xmlSecAssert2(ivSize <= sizeof(ctx->iv), -1);
     if(encrypt) {
         /* generate random iv */
-        ret = RAND_priv_bytes_ex(xmlSecOpenSSLGetLibCtx(), ctx->iv, ivSize, XMLSEEC_OPENSSL_RAND_BYTES_STRENGTH);
-        if(ret != 1) {
-            xmlSecOpenSSLError2("RAND_priv_bytes_ex", cipherName, "size=%d", ivLen);
+        ret = xmlSecOpenSSLGetRandomBytes(ctx->iv, ivSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecOpenSSLGetRandomBytes", cipherName, "size=%d", ivLen);
             return(-1);
         }
 
@@ -176,8 +186,7 @@ xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
         xmlSecSize inSize,
         xmlSecBufferPtr out,
         const xmlChar* cipherName,
-        int final,
-        xmlSecByte *tagData) {
+        int final) {
     xmlSecByte* outBuf;
     xmlSecSize outSize, outSize2, blockSize;
     int blockLen;
@@ -190,17 +199,11 @@ xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
     xmlSecAssert2(ctx->cipherCtx != NULL, -1);
     xmlSecAssert2(ctx->keyInitialized != 0, -1);
     xmlSecAssert2(ctx->ctxInitialized != 0, -1);
+    xmlSecAssert2(ctx->cbcMode != 0, -1);
     xmlSecAssert2(in != NULL, -1);
+    xmlSecAssert2(inSize > 0, -1);
     xmlSecAssert2(out != NULL, -1);
 
-    if (ctx->cbcMode) {
-        xmlSecAssert2(inSize > 0, -1);
-    } else {
-        if (final != 0) {
-            xmlSecAssert2(tagData != NULL, -1);
-        }
-    }
-
     /* OpenSSL docs: If the pad parameter is zero then no padding is performed, the total amount of
      * data encrypted or decrypted must then be a multiple of the block size or an error will occur.
      */
@@ -212,24 +215,13 @@ xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
 
     outSize = xmlSecBufferGetSize(out);
 
-    if(ctx->cbcMode) {
-        /* prepare: ensure we have enough space (+blockLen for final) */
-        ret = xmlSecBufferSetMaxSize(out, outSize + inSize + blockSize);
-        if(ret < 0) {
-            xmlSecInternalError2("xmlSecBufferSetMaxSize",
-                xmlSecErrorsSafeString(cipherName),
-                "size=" XMLSEC_SIZE_FMT, (outSize + inSize + blockSize));
-            return(-1);
-        }
-    } else {
-        /* prepare: ensure we have enough space */
-        ret = xmlSecBufferSetMaxSize(out, outSize + inSize);
-        if(ret < 0) {
-            xmlSecInternalError2("xmlSecBufferSetMaxSize",
-                xmlSecErrorsSafeString(cipherName),
-                "size=" XMLSEC_SIZE_FMT, (outSize + inSize));
-            return(-1);
-        }
+    /* prepare: ensure we have enough space (+blockLen for final) */
+    ret = xmlSecBufferSetMaxSize(out, outSize + inSize + blockSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetMaxSize",
+            xmlSecErrorsSafeString(cipherName),
+            "size=" XMLSEC_SIZE_FMT, (outSize + inSize + blockSize));
+        return(-1);
     }
 
     outBuf  = xmlSecBufferGetData(out) + outSize;
@@ -247,36 +239,11 @@ xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
     if(final != 0) {
         int outLen2 = 0;
 
-        if(ctx->cbcMode == 0) {
-            xmlSecAssert2(tagData != NULL, -1);
-            if(!EVP_CIPHER_CTX_encrypting(ctx->cipherCtx)) {
-                ret = EVP_CIPHER_CTX_ctrl(ctx->cipherCtx, EVP_CTRL_GCM_SET_TAG,
-                    XMLSEC_OPENSSL_AES_GCM_TAG_SIZE, tagData);
-                if(ret != 1) {
-                    xmlSecOpenSSLError("EVP_CIPHER_CTX_ctrl", cipherName);
-                    return(-1);
-                }
-            }
-        }
-
         ret = EVP_CipherFinal(ctx->cipherCtx, outBuf + outLen, &outLen2);
         if(ret != 1) {
             xmlSecOpenSSLError("EVP_CipherFinal", cipherName);
             return(-1);
         }
-
-        if(ctx->cbcMode == 0) {
-            xmlSecAssert2(tagData != NULL, -1);
-            if(EVP_CIPHER_CTX_encrypting(ctx->cipherCtx)) {
-                ret = EVP_CIPHER_CTX_ctrl(ctx->cipherCtx, EVP_CTRL_GCM_GET_TAG,
-                    XMLSEC_OPENSSL_AES_GCM_TAG_SIZE, tagData);
-                if(ret != 1) {
-                    xmlSecOpenSSLError("EVP_CIPHER_CTX_ctrl", cipherName);
-                    return(-1);
-                }
-            }
-        }
-
         outLen += outLen2;
     }
     XMLSEC_SAFE_CAST_INT_TO_SIZE(outLen, outSize2, return(-1), NULL);
@@ -293,6 +260,300 @@ xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
     return (0);
 }
 
+#ifndef XMLSEC_NO_AES
+/*
+ * Hands over the first @size bytes of @in to @out. The data is not copied
+ * if @out is empty (or only has a small pending prefix like the iv): the
+ * buffers are swapped instead. The remaining (at most 16) bytes are moved
+ * to the new input buffer through the fixed tag buffer.
+ */
+static int
+xmlSecOpenSSLEvpBlockCipherGCMCtxHandOver(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
+        xmlSecBufferPtr in,
+        xmlSecSize size,
+        xmlSecBufferPtr out,
+        const xmlChar* cipherName)
+{
+    xmlSecSize inSize, outSize, keepSize;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(in != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    inSize = xmlSecBufferGetSize(in);
+    xmlSecAssert2(size <= inSize, -1);
+    keepSize = inSize - size;
+    xmlSecAssert2(keepSize <= sizeof(ctx->tag), -1);
+
+    if(size == 0) {
+        return(0);
+    }
+
+    /* stash the bytes we keep */
+    if(keepSize > 0) {
+        memcpy(ctx->tag, xmlSecBufferGetData(in) + size, keepSize);
+        ret = xmlSecBufferRemoveTail(in, keepSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferRemoveTail", cipherName,
+                "size=" XMLSEC_SIZE_FMT, keepSize);
+            return(-1);
+        }
+    }
+
+    outSize = xmlSecBufferGetSize(out);
+    if(outSize <= XMLSEC_OPENSSL_AES_GCM_MAX_PREPEND_SIZE) {
+        if(outSize > 0) {
+            ret = xmlSecBufferPrepend(in, xmlSecBufferGetData(out), outSize);
+            if(ret < 0) {
+                xmlSecInternalError2("xmlSecBufferPrepend", cipherName,
+                    "size=" XMLSEC_SIZE_FMT, outSize);
+                return(-1);
+            }
+            xmlSecBufferEmpty(out);
+        }
+
+        /* the input buffer becomes the output */
+        xmlSecBufferSwap(in, out);
+    } else {
+        /* the output was not consumed yet (e.g. pop mode), append to it */
+        ret = xmlSecBufferAppend(out, xmlSecBufferGetData(in), size);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferAppend", cipherName,
+                "size=" XMLSEC_SIZE_FMT, size);
+            return(-1);
+        }
+        xmlSecBufferEmpty(in);
+    }
+
+    /* and put back the bytes we keep */
+    if(keepSize > 0) {
+        ret = xmlSecBufferAppend(in, ctx->tag, keepSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferAppend", cipherName,
+                "size=" XMLSEC_SIZE_FMT, keepSize);
+            return(-1);
+        }
+    }
+
+    /* done */
+    return(0);
+}
+
+/*
+ * GCM is a stream mode: the data is encrypted or decrypted in place inside
+ * @in and then handed over to @out. During decryption the last 16 bytes of
+ * the input are the tag, so they are kept in @in until the final call.
+ */
+static int
+xmlSecOpenSSLEvpBlockCipherGCMCtxProcess(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
+        xmlSecBufferPtr in,
+        xmlSecBufferPtr out,
+        const xmlChar* cipherName,
+        int final)
+{
+    xmlSecSize inSize, size;
+    xmlSecByte* inBuf;
+    int encrypt;
+    int inLen, outLen;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->cipher != NULL, -1);
+    xmlSecAssert2(ctx->cipherCtx != NULL, -1);
+    xmlSecAssert2(ctx->keyInitialized != 0, -1);
+    xmlSecAssert2(ctx->ctxInitialized != 0, -1);
+    xmlSecAssert2(ctx->cbcMode == 0, -1);
+    xmlSecAssert2(in != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    encrypt = EVP_CIPHER_CTX_encrypting(ctx->cipherCtx);
+    inSize = xmlSecBufferGetSize(in);
+    if(encrypt) {
+        size = inSize;
+    } else if(final != 0) {
+        /* There must be at least 16 bytes in the buffer - the tag and anything left over */
+        if(inSize < XMLSEC_OPENSSL_AES_GCM_TAG_SIZE) {
+            xmlSecInvalidSizeLessThanError("Input data", inSize,
+                (xmlSecSize)XMLSEC_OPENSSL_AES_GCM_TAG_SIZE, cipherName);
+            return(-1);
+        }
+
+        /* extract the tag */
+        size = inSize - XMLSEC_OPENSSL_AES_GCM_TAG_SIZE;
+        memcpy(ctx->tag, xmlSecBufferGetData(in) + size, XMLSEC_OPENSSL_AES_GCM_TAG_SIZE);
+        ret = xmlSecBufferRemoveTail(in, XMLSEC_OPENSSL_AES_GCM_TAG_SIZE);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferRemoveTail", cipherName);
+            return(-1);
+        }
+    } else if(inSize > XMLSEC_OPENSSL_AES_GCM_TAG_SIZE) {
+        /* ensure we keep the last 16 bytes around until the final call */
+        size = inSize - XMLSEC_OPENSSL_AES_GCM_TAG_SIZE;
+    } else {
+        /* wait for more data */
+        return(0);
+    }
+
+    /* encrypt/decrypt in place */
+    if(size > 0) {
+        inBuf = xmlSecBufferGetData(in);
+        xmlSecAssert2(inBuf != NULL, -1);
+
+        XMLSEC_SAFE_CAST_SIZE_TO_INT(size, inLen, return(-1), cipherName);
+        outLen = 0;
+        ret = EVP_CipherUpdate(ctx->cipherCtx, inBuf, &outLen, inBuf, inLen);
+        if(ret != 1) {
+            xmlSecOpenSSLError("EVP_CipherUpdate", cipherName);
+            return(-1);
+        }
+        xmlSecAssert2(outLen == inLen, -1);
+    }
+
+    /* finalize transform if needed */
+    if(final != 0) {
+        if(!encrypt) {
+            ret = EVP_CIPHER_CTX_ctrl(ctx->cipherCtx, EVP_CTRL_GCM_SET_TAG,
+                XMLSEC_OPENSSL_AES_GCM_TAG_SIZE, ctx->tag);
+            if(ret != 1) {
+                xmlSecOpenSSLError("EVP_CIPHER_CTX_ctrl", cipherName);
+                return(-1);
+            }
+        }
+
+        /* GCM doesn't output anything on final */
+        outLen = 0;
+        ret = EVP_CipherFinal(ctx->cipherCtx, ctx->pad, &outLen);
+        if(ret != 1) {
+            xmlSecOpenSSLError("EVP_CipherFinal", cipherName);
+            return(-1);
+        }
+        xmlSecAssert2(outLen == 0, -1);
+
+        /* get the tag and add to the output */
+        if(encrypt) {
+            ret = EVP_CIPHER_CTX_ctrl(ctx->cipherCtx, EVP_CTRL_GCM_GET_TAG,
+                XMLSEC_OPENSSL_AES_GCM_TAG_SIZE, ctx->tag);
+            if(ret != 1) {
+                xmlSecOpenSSLError("EVP_CIPHER_CTX_ctrl", cipherName);
+                return(-1);
+            }
+            ret = xmlSecBufferAppend(in, ctx->tag, XMLSEC_OPENSSL_AES_GCM_TAG_SIZE);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecBufferAppend", cipherName);
+                return(-1);
+            }
+            size += XMLSEC_OPENSSL_AES_GCM_TAG_SIZE;
+        }
+    }
+
+    ret = xmlSecOpenSSLEvpBlockCipherGCMCtxHandOver(ctx, in, size, out, cipherName);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLEvpBlockCipherGCMCtxHandOver", cipherName);
+        return(-1);
+    }
+
+    /* done */
+    return(0);
+}
+#endif /* XMLSEC_NO_AES */
+
+/* decrypts one segment of the CBC ciphertext with its own EVP_CIPHER_CTX
+ * (called from the executor threads, see xmlSecTransformCbcDecryptParallel()) */
+static int
+xmlSecOpenSSLEvpBlockCipherCBCDecryptSegment(void* cipherCtx, const xmlSecByte* iv,
+        const xmlSecByte* in, xmlSecSize inSize, xmlSecByte* out) {
+    xmlSecOpenSSLEvpBlockCipherCtxPtr ctx = (xmlSecOpenSSLEvpBlockCipherCtxPtr)cipherCtx;
+    EVP_CIPHER_CTX* segmentCtx;
+    xmlSecSize chunkSize;
+    int inLen, outLen;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->cipher != NULL, -1);
+    xmlSecAssert2(ctx->keyInitialized != 0, -1);
+    xmlSecAssert2(iv != NULL, -1);
+    xmlSecAssert2(in != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    segmentCtx = xmlSecOpenSSLEvpCipherCtxBorrow();
+    if(segmentCtx == NULL) {
+        xmlSecOpenSSLError("xmlSecOpenSSLEvpCipherCtxBorrow", NULL);
+        return(-1);
+    }
+    ret = EVP_CipherInit(segmentCtx, ctx->cipher, ctx->key, iv, 0);
+    if(ret != 1) {
+        xmlSecOpenSSLError("EVP_CipherInit", NULL);
+        goto done;
+    }
+    EVP_CIPHER_CTX_set_padding(segmentCtx, 0);
+
+    while(inSize > 0) {
+        chunkSize = (inSize < XMLSEC_OPENSSL_CBC_SEGMENT_CHUNK_SIZE) ? inSize : XMLSEC_OPENSSL_CBC_SEGMENT_CHUNK_SIZE;
+        XMLSEC_SAFE_CAST_SIZE_TO_INT(chunkSize, inLen, goto done, NULL);
+
+        outLen = 0;
+        ret = EVP_CipherUpdate(segmentCtx, out, &outLen, in, inLen);
+        if((ret != 1) || (outLen != inLen)) {
+            xmlSecOpenSSLError2("EVP_CipherUpdate", NULL, "size=%d", inLen);
+            goto done;
+        }
+        in += chunkSize;
+        out += chunkSize;
+        inSize -= chunkSize;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    xmlSecOpenSSLEvpCipherCtxRelease(segmentCtx);
+    return(res);
+}
+
+/* decrypts the buffered CBC ciphertext on the executor and continues
+ * the ctx->cipherCtx decryption from the new iv */
+static int
+xmlSecOpenSSLEvpBlockCipherCBCCtxParallel(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
+                                          xmlSecBufferPtr in, xmlSecBufferPtr out,
+                                          const xmlChar* cipherName,
+                                          xmlSecTransformCtxPtr transformCtx,
+                                          int last) {
+    xmlSecSize blockSize;
+    int blockLen;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->cipherCtx != NULL, -1);
+    xmlSecAssert2(ctx->cbcMode != 0, -1);
+
+    blockLen = EVP_CIPHER_block_size(ctx->cipher);
+    xmlSecAssert2(blockLen > 0, -1);
+    xmlSecAssert2(blockLen == EVP_CIPHER_iv_length(ctx->cipher), -1);
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(blockLen, blockSize, return(-1), cipherName);
+    xmlSecAssert2(blockSize <= sizeof(ctx->iv), -1);
+
+    ret = xmlSecTransformCbcDecryptParallel(transformCtx, xmlSecOpenSSLEvpBlockCipherCBCDecryptSegment,
+        ctx, ctx->iv, blockSize, in, out, last);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCbcDecryptParallel", cipherName);
+        return(-1);
+    } else if(ret == 0) {
+        /* wait for more data */
+        return(0);
+    }
+
+    /* the final block is decrypted with ctx->cipherCtx */
+    ret = EVP_CipherInit_ex(ctx->cipherCtx, NULL, NULL, NULL, ctx->iv, -1);
+    if(ret != 1) {
+        xmlSecOpenSSLError("EVP_CipherInit_ex", cipherName);
+        return(-1);
+    }
+    EVP_CIPHER_CTX_set_padding(ctx->cipherCtx, 0);
+    return(0);
+}
+
 static int
 xmlSecOpenSSLEvpBlockCipherCtxUpdate(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
                                      xmlSecBufferPtr in, xmlSecBufferPtr out,
@@ -311,25 +572,26 @@ xmlSecOpenSSLEvpBlockCipherCtxUpdate(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
     xmlSecAssert2(out != NULL, -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
+#ifndef XMLSEC_NO_AES
+    if(ctx->cbcMode == 0) {
+        return(xmlSecOpenSSLEvpBlockCipherGCMCtxProcess(ctx, in, out, cipherName, 0)); /* not final */
+    }
+#endif /* XMLSEC_NO_AES */
+
+    if((xmlSecTransformCbcDecryptIsParallel(transformCtx) != 0) && !EVP_CIPHER_CTX_encrypting(ctx->cipherCtx)) {
+        return(xmlSecOpenSSLEvpBlockCipherCBCCtxParallel(ctx, in, out, cipherName, transformCtx, 0)); /* not final */
+    }
+
     blockLen = EVP_CIPHER_block_size(ctx->cipher);
     xmlSecAssert2(blockLen > 0, -1);
     XMLSEC_SAFE_CAST_INT_TO_SIZE(blockLen, blockSize, return(-1), NULL);
 
     inSize = xmlSecBufferGetSize(in);
-    if(ctx->cbcMode) {
-        if(inSize <= blockSize) {
-            /* wait for more data: we want to make sure we keep the last chunk in tmp buffer for
-             * padding check/removal on decryption
-             */
-            return(0);
-        }
-    } else {
-        if(inSize <= XMLSEC_OPENSSL_AES_GCM_TAG_SIZE) {
-            /* In GCM mode during decryption the last 16 bytes of the buffer are the tag.
-             * Make sure there are always at least 16 bytes left over until we know we're
-             * processing the last buffer */
-            return(0);
-        }
+    if(inSize <= blockSize) {
+        /* wait for more data: we want to make sure we keep the last chunk in tmp buffer for
+         * padding check/removal on decryption
+         */
+        return(0);
     }
 
     /* OpenSSL docs: If the pad parameter is zero then no padding is performed, the total amount of
@@ -337,27 +599,16 @@ xmlSecOpenSSLEvpBlockCipherCtxUpdate(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
      *
      * We process all complete blocks from the input
      */
-    if(ctx->cbcMode) {
-        inBlocksSize = blockSize * (inSize / blockSize);
-    } else {
-        /* ensure we keep the last 16 bytes around until the Final() call */
-        inBlocksSize = blockSize * ((inSize - XMLSEC_OPENSSL_AES_GCM_TAG_SIZE) / blockSize);
-        if(inBlocksSize == 0) {
-            return(0);
-        }
-    }
-
+    inBlocksSize = blockSize * (inSize / blockSize);
     if(inBlocksSize == inSize) {
-        if(ctx->cbcMode) {
-            xmlSecAssert2(inBlocksSize >= blockSize, -1);
-            inBlocksSize -= blockSize; /* ensure we keep the last block around for Final() call to add/check/remove padding */
-        }
+        xmlSecAssert2(inBlocksSize >= blockSize, -1);
+        inBlocksSize -= blockSize; /* ensure we keep the last block around for Final() call to add/check/remove padding */
     }
     xmlSecAssert2(inBlocksSize > 0, -1);
 
     inBuf  = xmlSecBufferGetData(in);
-    ret = xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(ctx, inBuf, inBlocksSize, out, cipherName, 0,
-                                                    NULL); /* not final */
+    ret = xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(ctx, inBuf, inBlocksSize, out, cipherName,
+                                                    0); /* not final */
     if(ret < 0) {
         xmlSecInternalError("xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock", cipherName);
         return(-1);
@@ -374,10 +625,7 @@ xmlSecOpenSSLEvpBlockCipherCtxUpdate(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
     /* just a double check */
     inSize = xmlSecBufferGetSize(in);
     xmlSecAssert2(inSize > 0, -1);
-
-    if(ctx->cbcMode) {
-        xmlSecAssert2(inSize <= blockSize, -1);
-    }
+    xmlSecAssert2(inSize <= blockSize, -1);
 
     /* done */
     return(0);
@@ -388,7 +636,7 @@ xmlSecOpenSSLEvpBlockCipherCBCCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
         xmlSecBufferPtr in,
         xmlSecBufferPtr out,
         const xmlChar* cipherName,
-        xmlSecTransformCtxPtr transformCtx ATTRIBUTE_UNUSED)
+        xmlSecTransformCtxPtr transformCtx)
 {
     xmlSecSize size, inSize, outSize;
     int inLen, outLen, padLen, blockLen;
@@ -403,7 +651,15 @@ xmlSecOpenSSLEvpBlockCipherCBCCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
     xmlSecAssert2(ctx->ctxInitialized != 0, -1);
     xmlSecAssert2(in != NULL, -1);
     xmlSecAssert2(out != NULL, -1);
-    UNREFERENCED_PARAMETER(transformCtx);
+
+    /* decrypt the rest of the buffered data but the last block */
+    if((xmlSecTransformCbcDecryptIsParallel(transformCtx) != 0) && !EVP_CIPHER_CTX_encrypting(ctx->cipherCtx)) {
+        ret = xmlSecOpenSSLEvpBlockCipherCBCCtxParallel(ctx, in, out, cipherName, transformCtx, 1); /* final */
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLEvpBlockCipherCBCCtxParallel", cipherName);
+            return(-1);
+        }
+    }
 
     blockLen = EVP_CIPHER_block_size(ctx->cipher);
     xmlSecAssert2(blockLen > 0, -1);
@@ -440,10 +696,9 @@ xmlSecOpenSSLEvpBlockCipherCBCCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
         /* generate random padding */
         if(padLen > 1) {
             XMLSEC_SAFE_CAST_INT_TO_SIZE(padLen, size, return(-1), NULL);
-            ret = RAND_priv_bytes_ex(xmlSecOpenSSLGetLibCtx(), ctx->pad + inLen, size - 1,
-                                XMLSEEC_OPENSSL_RAND_BYTES_STRENGTH);
-            if (ret != 1) {
-                xmlSecOpenSSLError("RAND_priv_bytes_ex", cipherName);
+            ret = xmlSecOpenSSLGetRandomBytes(ctx->pad + inLen, size - 1);
+            if (ret < 0) {
+                xmlSecInternalError("xmlSecOpenSSLGetRandomBytes", cipherName);
                 return(-1);
             }
         }
@@ -454,7 +709,7 @@ xmlSecOpenSSLEvpBlockCipherCBCCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
 
         /* update the last 1 or 2 blocks with padding */
         XMLSEC_SAFE_CAST_INT_TO_SIZE(outLen, outSize, return(-1), NULL);
-        ret = xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(ctx, ctx->pad, outSize, out, cipherName, 1, NULL); /* final */
+        ret = xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(ctx, ctx->pad, outSize, out, cipherName, 1); /* final */
         if(ret < 0) {
             xmlSecInternalError("xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock", cipherName);
             return(-1);
@@ -463,7 +718,7 @@ xmlSecOpenSSLEvpBlockCipherCBCCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
         xmlSecSize padSize;
 
         /* update the last one block with padding */
-        ret = xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(ctx, inBuf, inSize, out, cipherName, 1, NULL); /* final */
+        ret = xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(ctx, inBuf, inSize, out, cipherName, 1); /* final */
         if(ret < 0) {
             xmlSecInternalError("xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock", cipherName);
             return(-1);
@@ -509,90 +764,6 @@ xmlSecOpenSSLEvpBlockCipherCBCCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
 
 }
 
-#ifndef XMLSEC_NO_AES
-static int
-xmlSecOpenSSLEvpBlockCipherGCMCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
-        xmlSecBufferPtr in,
-        xmlSecBufferPtr out,
-        const xmlChar* cipherName,
-        xmlSecTransformCtxPtr transformCtx)
-{
-    xmlSecSize inSize, outSize;
-    xmlSecByte* inBuf;
-    xmlSecByte* outBuf;
-    xmlSecByte tag[XMLSEC_OPENSSL_AES_GCM_TAG_SIZE];
-    int ret;
-
-    /* unreferenced parameter */
-    (void)transformCtx;
-
-    xmlSecAssert2(ctx != NULL, -1);
-    xmlSecAssert2(ctx->cipher != NULL, -1);
-    xmlSecAssert2(ctx->cipherCtx != NULL, -1);
-    xmlSecAssert2(ctx->keyInitialized != 0, -1);
-    xmlSecAssert2(ctx->ctxInitialized != 0, -1);
-    xmlSecAssert2(in != NULL, -1);
-    xmlSecAssert2(out != NULL, -1);
-    xmlSecAssert2(transformCtx != NULL, -1);
-
-    inSize = xmlSecBufferGetSize(in);
-    inBuf = xmlSecBufferGetData(in);
-
-    if(EVP_CIPHER_CTX_encrypting(ctx->cipherCtx)) {
-        ret = xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(ctx, inBuf, inSize, out, cipherName,
-            1, tag); /* final */
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock", cipherName);
-            return(-1);
-        }
-
-        /* get the tag and add to the output */
-        outSize = xmlSecBufferGetSize(out);
-        ret = xmlSecBufferSetMaxSize(out, outSize + XMLSEC_OPENSSL_AES_GCM_TAG_SIZE);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecBufferSetMaxSize", cipherName);
-            return(-1);
-        }
-        outBuf = xmlSecBufferGetData(out) + outSize;
-        memcpy(outBuf, tag, XMLSEC_OPENSSL_AES_GCM_TAG_SIZE);
-        ret = xmlSecBufferSetSize(out, outSize + XMLSEC_OPENSSL_AES_GCM_TAG_SIZE);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecBufferSetSize", cipherName);
-            return(-1);
-        }
-    } else {
-        /* There must be at least 16 bytes in the buffer - the tag and anything left over */
-        xmlSecAssert2(inSize >= XMLSEC_OPENSSL_AES_GCM_TAG_SIZE, -1);
-
-        /* extract the tag */
-        memcpy(tag, inBuf + inSize - XMLSEC_OPENSSL_AES_GCM_TAG_SIZE,
-            XMLSEC_OPENSSL_AES_GCM_TAG_SIZE);
-        xmlSecBufferRemoveTail(in, XMLSEC_OPENSSL_AES_GCM_TAG_SIZE);
-
-        inBuf = xmlSecBufferGetData(in);
-        inSize = xmlSecBufferGetSize(in);
-
-        /* Decrypt anything remaining and verify the tag */
-        ret = xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock(ctx, inBuf, inSize, out, cipherName,
-            1, tag); /* final */
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecOpenSSLEvpBlockCipherCtxUpdateBlock", cipherName);
-            return(-1);
-        }
-    }
-
-    /* remove the processed data from input */
-    ret = xmlSecBufferRemoveHead(in, inSize);
-    if(ret < 0) {
-        xmlSecInternalError2("xmlSecBufferRemoveHead", cipherName,
-                             "size=" XMLSEC_SIZE_FMT, inSize);
-        return(-1);
-    }
-
-    /* done */
-    return(0);
-}
-#endif
 
 static int
 xmlSecOpenSSLEvpBlockCipherCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
@@ -603,11 +774,12 @@ xmlSecOpenSSLEvpBlockCipherCtxFinal(xmlSecOpenSSLEvpBlockCipherCtxPtr ctx,
 {
     xmlSecAssert2(ctx != NULL, -1);
 
-    if (ctx->cbcMode) {
-        return xmlSecOpenSSLEvpBlockCipherCBCCtxFinal(ctx, in, out, cipherName, transformCtx);
-    } else {
-        return xmlSecOpenSSLEvpBlockCipherGCMCtxFinal(ctx, in, out, cipherName, transformCtx);
+#ifndef XMLSEC_NO_AES
+    if(ctx->cbcMode == 0) {
+        return(xmlSecOpenSSLEvpBlockCipherGCMCtxProcess(ctx, in, out, cipherName, 1)); /* final */
     }
+#endif /* XMLSEC_NO_AES */
+    return(xmlSecOpenSSLEvpBlockCipherCBCCtxFinal(ctx, in, out, cipherName, transformCtx));
 }
 
 
@@ -720,7 +892,7 @@ xmlSecOpenSSLEvpBlockCipherInitialize(xmlSecTransformPtr transform) {
 #ifdef XMLSEC_OPENSSL_API_300
     /* fetch cipher */
     xmlSecAssert2(ctx->cipherName != NULL, -1);
-    ctx->cipher = EVP_CIPHER_fetch(xmlSecOpenSSLGetLibCtx(), ctx->cipherName, NULL);
+    ctx->cipher = xmlSecOpenSSLEvpCipherFetch(ctx->cipherName);
     if(ctx->cipher == NULL) {
         xmlSecOpenSSLError2("EVP_CIPHER_fetch", xmlSecTransformGetName(transform),
             "cipherName=%s", xmlSecErrorsSafeString(ctx->cipherName));
@@ -730,9 +902,9 @@ xmlSecOpenSSLEvpBlockCipherInitialize(xmlSecTransformPtr transform) {
 #endif /* XMLSEC_OPENSSL_API_300 */
 
     /* create cipher ctx */
-    ctx->cipherCtx = EVP_CIPHER_CTX_new();
+    ctx->cipherCtx = xmlSecOpenSSLEvpCipherCtxBorrow();
     if(ctx->cipherCtx == NULL) {
-        xmlSecOpenSSLError("EVP_CIPHER_CTX_new", xmlSecTransformGetName(transform));
+        xmlSecOpenSSLError("xmlSecOpenSSLEvpCipherCtxBorrow", xmlSecTransformGetName(transform));
         xmlSecOpenSSLEvpBlockCipherFinalize(transform);
         return(-1);
     }
@@ -752,7 +924,7 @@ xmlSecOpenSSLEvpBlockCipherFinalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     if(ctx->cipherCtx != NULL) {
-        EVP_CIPHER_CTX_free(ctx->cipherCtx);
+        xmlSecOpenSSLEvpCipherCtxRelease(ctx->cipherCtx);
     }
 #ifdef XMLSEC_OPENSSL_API_300
     if(ctx->cipher != NULL) {
@@ -20,12 +20,17 @@
 
 #include <string.h>
 
+#if !defined(XMLSEC_WINDOWS) && !defined(XMLSEC_NO_THREADS)
+#include <pthread.h>
+#endif /* !defined(XMLSEC_WINDOWS) && !defined(XMLSEC_NO_THREADS) */
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/dl.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/transforms.h>
 
 #include <openssl/x509.h>
@@ -38,10 +43,36 @@
 #include <xmlsec/openssl/x509.h>
 
 #include "openssl_compat.h"
+
+#ifdef XMLSEC_OPENSSL_API_300
+#include <openssl/provider.h>
+#endif /* XMLSEC_OPENSSL_API_300 */
+
+#include "private.h"
 #include "../cast_helpers.h"
 
 static int              xmlSecOpenSSLErrorsInit                 (void);
 static void             xmlSecOpenSSLErrorsShutdown             (void);
+#ifdef XMLSEC_OPENSSL_API_300
+static void             xmlSecOpenSSLEvpCacheInit               (void);
+static void             xmlSecOpenSSLEvpCacheShutdown           (void);
+static void             xmlSecOpenSSLPropQueriesShutdown        (void);
+static void             xmlSecOpenSSLEvpCtxPoolInit             (void);
+static void             xmlSecOpenSSLEvpCtxPoolShutdown         (void);
+static void             xmlSecOpenSSLEvpCtxPoolCleanup          (void* data);
+static void             xmlSecOpenSSLPKeyCtxCacheInit           (void);
+static void             xmlSecOpenSSLPKeyCtxCacheShutdown       (void);
+static void             xmlSecOpenSSLPKeyCtxCacheRemoveLibCtx   (OSSL_LIB_CTX* libCtx);
+static void             xmlSecOpenSSLMacCtxCacheInit            (void);
+static void             xmlSecOpenSSLMacCtxCacheShutdown        (void);
+static void             xmlSecOpenSSLMacCtxCacheRemoveLibCtx    (OSSL_LIB_CTX* libCtx);
+static void             xmlSecOpenSSLPublicKeysCacheInit        (void);
+static void             xmlSecOpenSSLPublicKeysCacheShutdown    (void);
+static void             xmlSecOpenSSLThreadLibCtxShutdown       (void);
+static void             xmlSecOpenSSLThreadLibCtxCleanup        (void* data);
+static int              xmlSecOpenSSLThreadLibCtxLoadProvider   (OSSL_PROVIDER* provider,
+                                                                 void* cbdata);
+#endif /* XMLSEC_OPENSSL_API_300 */
 
 static xmlSecCryptoDLFunctionsPtr gXmlSecOpenSSLFunctions = NULL;
 static xmlChar* gXmlSecOpenSSLTrustedCertsFolder = NULL;
@@ -413,6 +444,7 @@ xmlSecCryptoGetFunctions_openssl(void) {
     gXmlSecOpenSSLFunctions->cryptoAppKeysMngrCertLoadMemory    = xmlSecOpenSSLAppKeysMngrCertLoadMemory;
     gXmlSecOpenSSLFunctions->cryptoAppKeysMngrCrlLoad           = xmlSecOpenSSLAppKeysMngrCrlLoad;
     gXmlSecOpenSSLFunctions->cryptoAppKeysMngrCrlLoadMemory     = xmlSecOpenSSLAppKeysMngrCrlLoadMemory;
+    gXmlSecOpenSSLFunctions->cryptoAppKeysMngrEnableX509VerifyCache = xmlSecOpenSSLAppKeysMngrEnableX509VerifyCache;
     gXmlSecOpenSSLFunctions->cryptoAppPkcs12Load                = xmlSecOpenSSLAppPkcs12Load;
     gXmlSecOpenSSLFunctions->cryptoAppPkcs12LoadMemory          = xmlSecOpenSSLAppPkcs12LoadMemory;
     gXmlSecOpenSSLFunctions->cryptoAppKeyCertLoad               = xmlSecOpenSSLAppKeyCertLoad;
@@ -435,24 +467,42 @@ xmlSecCryptoGetFunctions_openssl(void) {
  */
 int
 xmlSecOpenSSLInit (void)  {
+    xmlSecStatsSpan span;
+    int res = -1;
+
+    xmlSecStatsStartupStart(xmlSecStatsStartupCryptoInit, &span);
+
     /* Check loaded xmlsec library version */
     if(xmlSecCheckVersionExact() != 1) {
         xmlSecInternalError("xmlSecCheckVersionExact", NULL);
-        return(-1);
+        goto done;
     }
 
     if(xmlSecOpenSSLErrorsInit() < 0) {
         xmlSecInternalError("xmlSecOpenSSLErrorsInit", NULL);
-        return(-1);
+        goto done;
     }
 
+#ifdef XMLSEC_OPENSSL_API_300
+    xmlSecOpenSSLEvpCacheInit();
+    xmlSecOpenSSLPKeyCtxCacheInit();
+    xmlSecOpenSSLMacCtxCacheInit();
+    xmlSecOpenSSLPublicKeysCacheInit();
+    xmlSecOpenSSLEvpCtxPoolInit();
+#endif /* XMLSEC_OPENSSL_API_300 */
+
     /* register our klasses */
     if(xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms(xmlSecCryptoGetFunctions_openssl()) < 0) {
         xmlSecInternalError("xmlSecCryptoDLFunctionsRegisterKeyDataAndTransforms", NULL);
-        return(-1);
+        goto done;
     }
 
-    return(0);
+    /* done */
+    res = 0;
+
+done:
+    xmlSecStatsStartupEnd(&span);
+    return(res);
 }
 
 /**
@@ -464,7 +514,21 @@ xmlSecOpenSSLInit (void)  {
  */
 int
 xmlSecOpenSSLShutdown(void) {
+#ifdef XMLSEC_OPENSSL_API_300
+    xmlSecOpenSSLEvpCtxPoolShutdown();
+    xmlSecOpenSSLPublicKeysCacheShutdown();
+    xmlSecOpenSSLMacCtxCacheShutdown();
+    xmlSecOpenSSLPKeyCtxCacheShutdown();
+    xmlSecOpenSSLThreadLibCtxShutdown();
+    xmlSecOpenSSLEvpCacheShutdown();
+    xmlSecOpenSSLPropQueriesShutdown();
+#endif /* XMLSEC_OPENSSL_API_300 */
+#ifndef XMLSEC_NO_X509
+    xmlSecOpenSSLKeyDataX509DisableCertsCache();
+    xmlSecOpenSSLX509DisableNamesCache();
+#endif /* XMLSEC_NO_X509 */
     xmlSecOpenSSLSetDefaultTrustedCertsFolder(NULL);
+    xmlSecOpenSSLSetRandomPool(0);
     xmlSecOpenSSLErrorsShutdown();
     return(0);
 }
@@ -479,35 +543,42 @@ xmlSecOpenSSLShutdown(void) {
  */
 int
 xmlSecOpenSSLKeysMngrInit(xmlSecKeysMngrPtr mngr) {
+    xmlSecStatsSpan span;
+    int res = -1;
 #ifndef XMLSEC_NO_X509
     int ret;
+#endif /* XMLSEC_NO_X509 */
 
     xmlSecAssert2(mngr != NULL, -1);
 
+    xmlSecStatsStartupStart(xmlSecStatsStartupKeysMngrInit, &span);
+
+#ifndef XMLSEC_NO_X509
     /* create x509 store if needed */
-    if(xmlSecKeysMngrGetDataStore(mngr, xmlSecOpenSSLX509StoreId) == NULL) {
+    if(xmlSecKeysMngrFindDataStore(mngr, xmlSecOpenSSLX509StoreId) == NULL) {
         xmlSecKeyDataStorePtr x509Store;
 
         x509Store = xmlSecKeyDataStoreCreate(xmlSecOpenSSLX509StoreId);
         if(x509Store == NULL) {
             xmlSecInternalError("xmlSecKeyDataStoreCreate(xmlSecOpenSSLX509StoreId)", NULL);
-            return(-1);
+            goto done;
         }
 
         ret = xmlSecKeysMngrAdoptDataStore(mngr, x509Store);
         if(ret < 0) {
             xmlSecInternalError("xmlSecKeysMngrAdoptDataStore", NULL);
             xmlSecKeyDataStoreDestroy(x509Store);
-            return(-1);
+            goto done;
         }
     }
-
-#else /* XMLSEC_NO_X509 */
-    xmlSecAssert2(mngr != NULL, -1);
-
 #endif /* XMLSEC_NO_X509 */
 
-    return(0);
+    /* done */
+    res = 0;
+
+done:
+    xmlSecStatsStartupEnd(&span);
+    return(res);
 }
 
 /**
@@ -534,11 +605,127 @@ xmlSecOpenSSLGenerateRandom(xmlSecBufferPtr buffer, xmlSecSize size) {
     }
 
     /* get random data */
-    ret = RAND_priv_bytes_ex(xmlSecOpenSSLGetLibCtx(), (xmlSecByte*)xmlSecBufferGetData(buffer), size,
+    ret = xmlSecOpenSSLGetRandomBytes((xmlSecByte*)xmlSecBufferGetData(buffer), size);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecOpenSSLGetRandomBytes", NULL,
+                             "size=" XMLSEC_SIZE_FMT, size);
+        return(-1);
+    }
+    return(0);
+}
+
+/**************************************************************************
+ *
+ * Per thread random bytes pool (disabled by default): the small requests
+ * (IVs, padding, session keys) are served from a thread local buffer that
+ * is refilled with one DRBG call. The served bytes are cleansed in the pool
+ * and the pool is dropped in the child process after fork().
+ *
+ *************************************************************************/
+#define XMLSEC_OPENSSL_RANDOM_POOL_SIZE                 512
+#define XMLSEC_OPENSSL_RANDOM_POOL_MAX_REQUEST          64
+
+#if defined(XMLSEC_THREAD_LOCAL) && (defined(XMLSEC_WINDOWS) || !defined(XMLSEC_NO_THREADS))
+#define XMLSEC_OPENSSL_RANDOM_POOL                      1
+#endif /* defined(XMLSEC_THREAD_LOCAL) && (defined(XMLSEC_WINDOWS) || !defined(XMLSEC_NO_THREADS)) */
+
+#ifdef XMLSEC_OPENSSL_RANDOM_POOL
+static int gXmlSecOpenSSLRandomPoolEnabled = 0;
+static int gXmlSecOpenSSLRandomPoolForkHandler = 0;
+static volatile unsigned int gXmlSecOpenSSLRandomPoolGeneration = 1;
+
+static XMLSEC_THREAD_LOCAL xmlSecByte gXmlSecOpenSSLRandomPool[XMLSEC_OPENSSL_RANDOM_POOL_SIZE];
+static XMLSEC_THREAD_LOCAL xmlSecSize gXmlSecOpenSSLRandomPoolPos = 0;
+static XMLSEC_THREAD_LOCAL unsigned int gXmlSecOpenSSLRandomPoolFilled = 0;
+
+#ifndef XMLSEC_WINDOWS
+/* the parent's random bytes should never be used by the child */
+static void
+xmlSecOpenSSLRandomPoolAtFork(void) {
+    ++gXmlSecOpenSSLRandomPoolGeneration;
+}
+#endif /* XMLSEC_WINDOWS */
+#endif /* XMLSEC_OPENSSL_RANDOM_POOL */
+
+/**
+ * xmlSecOpenSSLSetRandomPool:
+ * @enabled:            1 to enable the per thread random bytes pool or
+ *                      0 to disable it.
+ *
+ * Enables or disables the per thread random bytes pool: the small random
+ * requests (e.g. IVs, padding, session keys) are served from a thread local
+ * buffer refilled with one call to the private DRBG instead of calling the
+ * DRBG for each request. The bytes are removed from the pool when they are
+ * served and the pool is dropped in the child process after fork().
+ *
+ * This function should be called before any worker thread uses xmlsec-openssl.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLSetRandomPool(int enabled) {
+#ifdef XMLSEC_OPENSSL_RANDOM_POOL
+    if(enabled == 0) {
+        gXmlSecOpenSSLRandomPoolEnabled = 0;
+        ++gXmlSecOpenSSLRandomPoolGeneration;
+        return(0);
+    }
+#ifndef XMLSEC_WINDOWS
+    if(gXmlSecOpenSSLRandomPoolForkHandler == 0) {
+        if(pthread_atfork(NULL, NULL, xmlSecOpenSSLRandomPoolAtFork) != 0) {
+            xmlSecIOError("pthread_atfork", NULL, NULL);
+            return(-1);
+        }
+        gXmlSecOpenSSLRandomPoolForkHandler = 1;
+    }
+#endif /* XMLSEC_WINDOWS */
+    gXmlSecOpenSSLRandomPoolEnabled = 1;
+    return(0);
+#else  /* XMLSEC_OPENSSL_RANDOM_POOL */
+    if(enabled == 0) {
+        return(0);
+    }
+    xmlSecNotImplementedError("thread local variables are not supported");
+    return(-1);
+#endif /* XMLSEC_OPENSSL_RANDOM_POOL */
+}
+
+/* fills @out with @outSize random bytes from the pool (if enabled) or from the DRBG */
+int
+xmlSecOpenSSLGetRandomBytes(xmlSecByte* out, xmlSecSize outSize) {
+    int ret;
+
+    xmlSecAssert2(out != NULL, -1);
+    xmlSecAssert2(outSize > 0, -1);
+
+#ifdef XMLSEC_OPENSSL_RANDOM_POOL
+    if((gXmlSecOpenSSLRandomPoolEnabled != 0) && (outSize <= XMLSEC_OPENSSL_RANDOM_POOL_MAX_REQUEST)) {
+        xmlSecByte* pool = gXmlSecOpenSSLRandomPool;
+
+        if((gXmlSecOpenSSLRandomPoolFilled != gXmlSecOpenSSLRandomPoolGeneration) ||
+           (gXmlSecOpenSSLRandomPoolPos + outSize > XMLSEC_OPENSSL_RANDOM_POOL_SIZE)
+        ) {
+            ret = RAND_priv_bytes_ex(xmlSecOpenSSLGetThreadLibCtx(), pool, XMLSEC_OPENSSL_RANDOM_POOL_SIZE,
                         XMLSEEC_OPENSSL_RAND_BYTES_STRENGTH);
+            if(ret != 1) {
+                xmlSecOpenSSLError2("RAND_priv_bytes_ex", NULL,
+                    "size=%d", XMLSEC_OPENSSL_RANDOM_POOL_SIZE);
+                return(-1);
+            }
+            gXmlSecOpenSSLRandomPoolFilled = gXmlSecOpenSSLRandomPoolGeneration;
+            gXmlSecOpenSSLRandomPoolPos = 0;
+        }
+        memcpy(out, pool + gXmlSecOpenSSLRandomPoolPos, outSize);
+        OPENSSL_cleanse(pool + gXmlSecOpenSSLRandomPoolPos, outSize);
+        gXmlSecOpenSSLRandomPoolPos += outSize;
+        return(0);
+    }
+#endif /* XMLSEC_OPENSSL_RANDOM_POOL */
+
+    ret = RAND_priv_bytes_ex(xmlSecOpenSSLGetThreadLibCtx(), out, outSize, XMLSEEC_OPENSSL_RAND_BYTES_STRENGTH);
     if(ret != 1) {
         xmlSecOpenSSLError2("RAND_priv_bytes_ex", NULL,
-                            "size=" XMLSEC_SIZE_FMT, size);
+            "size=" XMLSEC_SIZE_FMT, outSize);
         return(-1);
     }
     return(0);
@@ -692,6 +879,1604 @@ OSSL_LIB_CTX*
 xmlSecOpenSSLGetLibCtx(void) {
     return(gXmlSecOpenSSLLibCtx);
 }
+
+/********************************************************************
+ *
+ * Per thread library contexts: the name maps, decoders and method
+ * stores in OSSL_LIB_CTX are shared by all threads and become
+ * contention points at high thread counts. In the per thread mode,
+ * each thread gets its own OSSL_LIB_CTX with the same providers as the
+ * shared one and uses it for the algorithm fetches, EVP_PKEY_CTX and
+ * random numbers. Keys, certificates and stores are still created in
+ * the shared library context (see #xmlSecOpenSSLGetLibCtx) so they can
+ * be used from any thread: OpenSSL exports the key to the thread's
+ * provider when needed.
+ *
+ ********************************************************************/
+#define XMLSEC_OPENSSL_THREAD_LIB_CTX_MAX_SIZE  1024
+
+static CRYPTO_RWLOCK*           gXmlSecOpenSSLThreadLibCtxLock = NULL;
+static CRYPTO_THREAD_LOCAL      gXmlSecOpenSSLThreadLibCtxKey;
+static int                      gXmlSecOpenSSLThreadLibCtxEnabled = 0;
+static OSSL_LIB_CTX*            gXmlSecOpenSSLThreadLibCtxs[XMLSEC_OPENSSL_THREAD_LIB_CTX_MAX_SIZE];
+static xmlSecSize               gXmlSecOpenSSLThreadLibCtxsSize = 0;
+
+/* called on thread exit */
+static void
+xmlSecOpenSSLThreadLibCtxCleanup(void* data) {
+    OSSL_LIB_CTX* libCtx = (OSSL_LIB_CTX*)data;
+    xmlSecSize ii;
+    int found = 0;
+
+    if((libCtx == NULL) || (gXmlSecOpenSSLThreadLibCtxLock == NULL)) {
+        return;
+    }
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLThreadLibCtxLock) != 1) {
+        return;
+    }
+    for(ii = 0; ii < gXmlSecOpenSSLThreadLibCtxsSize; ++ii) {
+        if(gXmlSecOpenSSLThreadLibCtxs[ii] == libCtx) {
+            --gXmlSecOpenSSLThreadLibCtxsSize;
+            gXmlSecOpenSSLThreadLibCtxs[ii] = gXmlSecOpenSSLThreadLibCtxs[gXmlSecOpenSSLThreadLibCtxsSize];
+            gXmlSecOpenSSLThreadLibCtxs[gXmlSecOpenSSLThreadLibCtxsSize] = NULL;
+            found = 1;
+            break;
+        }
+    }
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLThreadLibCtxLock);
+
+    /* might be already destroyed in xmlSecOpenSSLThreadLibCtxShutdown() */
+    if(found != 0) {
+        xmlSecOpenSSLPKeyCtxCacheRemoveLibCtx(libCtx);
+        xmlSecOpenSSLMacCtxCacheRemoveLibCtx(libCtx);
+        OSSL_LIB_CTX_free(libCtx);
+    }
+}
+
+static void
+xmlSecOpenSSLThreadLibCtxShutdown(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecOpenSSLThreadLibCtxLock == NULL) {
+        return;
+    }
+    gXmlSecOpenSSLThreadLibCtxEnabled = 0;
+    CRYPTO_THREAD_cleanup_local(&gXmlSecOpenSSLThreadLibCtxKey);
+
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLThreadLibCtxLock) == 1) {
+        for(ii = 0; ii < gXmlSecOpenSSLThreadLibCtxsSize; ++ii) {
+            OSSL_LIB_CTX_free(gXmlSecOpenSSLThreadLibCtxs[ii]);
+            gXmlSecOpenSSLThreadLibCtxs[ii] = NULL;
+        }
+        gXmlSecOpenSSLThreadLibCtxsSize = 0;
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLThreadLibCtxLock);
+    }
+    CRYPTO_THREAD_lock_free(gXmlSecOpenSSLThreadLibCtxLock);
+    gXmlSecOpenSSLThreadLibCtxLock = NULL;
+}
+
+static int
+xmlSecOpenSSLThreadLibCtxLoadProvider(OSSL_PROVIDER* provider, void* cbdata) {
+    OSSL_LIB_CTX* libCtx = (OSSL_LIB_CTX*)cbdata;
+    const char* name;
+
+    xmlSecAssert2(provider != NULL, 0);
+    xmlSecAssert2(libCtx != NULL, 0);
+
+    name = OSSL_PROVIDER_get0_name(provider);
+    if(OSSL_PROVIDER_load(libCtx, name) == NULL) {
+        xmlSecOpenSSLError2("OSSL_PROVIDER_load", NULL,
+            "provider=%s", xmlSecErrorsSafeString(name));
+        return(0);
+    }
+    return(1);
+}
+
+/**
+ * xmlSecOpenSSLSetPerThreadLibCtx:
+ * @enabled:            1 to enable the per thread library contexts or
+ *                      0 to disable them.
+ *
+ * Enables or disables per thread OSSL_LIB_CTX objects. When enabled, each
+ * thread gets its own library context with the same providers as the shared
+ * one (see #xmlSecOpenSSLGetLibCtx) on first use and uses it for the
+ * algorithms and crypto operations. The per thread library context is
+ * destroyed when the thread exits, the crypto objects (e.g. transforms)
+ * created by a thread should not be used after it exits. Keys, certificates
+ * and keys stores remain in the shared library context and can be used
+ * from any thread.
+ *
+ * This function should be called after @xmlSecOpenSSLInit and the providers
+ * setup and before any worker thread uses xmlsec-openssl. Disabling destroys
+ * all the per thread library contexts.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLSetPerThreadLibCtx(int enabled) {
+    if(enabled == 0) {
+        xmlSecOpenSSLThreadLibCtxShutdown();
+        return(0);
+    }
+    if(gXmlSecOpenSSLThreadLibCtxLock != NULL) {
+        /* already enabled */
+        return(0);
+    }
+
+    gXmlSecOpenSSLThreadLibCtxLock = CRYPTO_THREAD_lock_new();
+    if(gXmlSecOpenSSLThreadLibCtxLock == NULL) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_lock_new", NULL);
+        return(-1);
+    }
+    if(CRYPTO_THREAD_init_local(&gXmlSecOpenSSLThreadLibCtxKey, xmlSecOpenSSLThreadLibCtxCleanup) != 1) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_init_local", NULL);
+        CRYPTO_THREAD_lock_free(gXmlSecOpenSSLThreadLibCtxLock);
+        gXmlSecOpenSSLThreadLibCtxLock = NULL;
+        return(-1);
+    }
+    gXmlSecOpenSSLThreadLibCtxsSize = 0;
+    gXmlSecOpenSSLThreadLibCtxEnabled = 1;
+    return(0);
+}
+
+/**
+ * xmlSecOpenSSLGetThreadLibCtx:
+ *
+ * Gets the OSSL_LIB_CTX object for the algorithms and crypto operations
+ * in the current thread: the per thread library context if enabled (see
+ * #xmlSecOpenSSLSetPerThreadLibCtx) or the shared one otherwise.
+ *
+ * Returns: the OSSL_LIB_CTX object or NULL if default is used.
+ */
+OSSL_LIB_CTX*
+xmlSecOpenSSLGetThreadLibCtx(void) {
+    OSSL_LIB_CTX* libCtx;
+    int ret;
+
+    /* first use of the crypto library (see xmlSecOpenSSLAppSetDeferredInit) */
+    if(xmlSecOpenSSLAppDeferredInit() < 0) {
+        xmlSecInternalError("xmlSecOpenSSLAppDeferredInit", NULL);
+    }
+
+    if(gXmlSecOpenSSLThreadLibCtxEnabled == 0) {
+        return(xmlSecOpenSSLGetLibCtx());
+    }
+    libCtx = (OSSL_LIB_CTX*)CRYPTO_THREAD_get_local(&gXmlSecOpenSSLThreadLibCtxKey);
+    if(libCtx != NULL) {
+        return(libCtx);
+    }
+
+    /* first use in this thread: create new library context */
+    libCtx = OSSL_LIB_CTX_new();
+    if(libCtx == NULL) {
+        xmlSecOpenSSLError("OSSL_LIB_CTX_new", NULL);
+        return(xmlSecOpenSSLGetLibCtx());
+    }
+    ret = OSSL_PROVIDER_do_all(xmlSecOpenSSLGetLibCtx(), xmlSecOpenSSLThreadLibCtxLoadProvider, libCtx);
+    if(ret != 1) {
+        xmlSecOpenSSLError("OSSL_PROVIDER_do_all", NULL);
+        OSSL_LIB_CTX_free(libCtx);
+        return(xmlSecOpenSSLGetLibCtx());
+    }
+
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLThreadLibCtxLock) != 1) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_write_lock", NULL);
+        OSSL_LIB_CTX_free(libCtx);
+        return(xmlSecOpenSSLGetLibCtx());
+    }
+    if(gXmlSecOpenSSLThreadLibCtxsSize >= XMLSEC_OPENSSL_THREAD_LIB_CTX_MAX_SIZE) {
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLThreadLibCtxLock);
+        xmlSecInvalidSizeMoreThanError("Number of per thread library contexts",
+            gXmlSecOpenSSLThreadLibCtxsSize, (xmlSecSize)XMLSEC_OPENSSL_THREAD_LIB_CTX_MAX_SIZE, NULL);
+        OSSL_LIB_CTX_free(libCtx);
+        return(xmlSecOpenSSLGetLibCtx());
+    }
+    gXmlSecOpenSSLThreadLibCtxs[gXmlSecOpenSSLThreadLibCtxsSize++] = libCtx;
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLThreadLibCtxLock);
+
+    if(CRYPTO_THREAD_set_local(&gXmlSecOpenSSLThreadLibCtxKey, libCtx) != 1) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_set_local", NULL);
+        /* will be destroyed in xmlSecOpenSSLThreadLibCtxShutdown() */
+        return(xmlSecOpenSSLGetLibCtx());
+    }
+    return(libCtx);
+}
+
+/********************************************************************
+ *
+ * Property queries: the default one and the per algorithm (or key type)
+ * overrides used for all the fetches. These are set at the startup
+ * before any crypto operations and are not locked.
+ *
+ ********************************************************************/
+#define XMLSEC_OPENSSL_PROP_QUERIES_MAX_SIZE    32
+
+typedef struct _xmlSecOpenSSLPropQuery {
+    char*               algorithm;
+    char*               propQuery;
+} xmlSecOpenSSLPropQuery;
+
+static char*                    gXmlSecOpenSSLDefaultPropQuery = NULL;
+static xmlSecOpenSSLPropQuery   gXmlSecOpenSSLPropQueries[XMLSEC_OPENSSL_PROP_QUERIES_MAX_SIZE];
+static xmlSecSize               gXmlSecOpenSSLPropQueriesSize = 0;
+
+static void
+xmlSecOpenSSLPropQueriesShutdown(void) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecOpenSSLPropQueriesSize; ++ii) {
+        xmlFree(gXmlSecOpenSSLPropQueries[ii].algorithm);
+        xmlFree(gXmlSecOpenSSLPropQueries[ii].propQuery);
+    }
+    memset(gXmlSecOpenSSLPropQueries, 0, sizeof(gXmlSecOpenSSLPropQueries));
+    gXmlSecOpenSSLPropQueriesSize = 0;
+
+    if(gXmlSecOpenSSLDefaultPropQuery != NULL) {
+        xmlFree(gXmlSecOpenSSLDefaultPropQuery);
+        gXmlSecOpenSSLDefaultPropQuery = NULL;
+    }
+}
+
+/**
+ * xmlSecOpenSSLSetPropQuery:
+ * @algorithm:          the OpenSSL algorithm name (e.g. "SHA256", "AES-128-CBC",
+ *                      "HMAC") or key type (e.g. "RSA", "EC") for the signature,
+ *                      key transport and key agreement operations; or NULL
+ *                      for the default property query.
+ * @propQuery:          the property query (e.g. "provider=qatprovider" or
+ *                      "?fips=yes") or NULL to remove it.
+ *
+ * Sets the property query that xmlsec-openssl uses to fetch @algorithm
+ * (or all the algorithms without own query if @algorithm is NULL). This
+ * allows routing some algorithms to a hardware accelerator provider while
+ * the others are fetched from the default provider. The property queries
+ * should be set at the startup before any crypto operations, e.g. from
+ * "xmlsec_prop_queries" OpenSSL config section (see #xmlSecOpenSSLAppInit).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLSetPropQuery(const char* algorithm, const char* propQuery) {
+    char* value = NULL;
+    xmlSecSize ii;
+
+    if(propQuery != NULL) {
+        value = (char*)xmlStrdup(BAD_CAST propQuery);
+        if(value == NULL) {
+            xmlSecStrdupError(BAD_CAST propQuery, NULL);
+            return(-1);
+        }
+    }
+
+    if(algorithm == NULL) {
+        if(gXmlSecOpenSSLDefaultPropQuery != NULL) {
+            xmlFree(gXmlSecOpenSSLDefaultPropQuery);
+        }
+        gXmlSecOpenSSLDefaultPropQuery = value;
+        return(0);
+    }
+
+    for(ii = 0; ii < gXmlSecOpenSSLPropQueriesSize; ++ii) {
+        if(xmlStrcasecmp(BAD_CAST gXmlSecOpenSSLPropQueries[ii].algorithm, BAD_CAST algorithm) == 0) {
+            xmlFree(gXmlSecOpenSSLPropQueries[ii].propQuery);
+            gXmlSecOpenSSLPropQueries[ii].propQuery = value;
+            return(0);
+        }
+    }
+    if(value == NULL) {
+        return(0);
+    }
+    if(gXmlSecOpenSSLPropQueriesSize >= XMLSEC_OPENSSL_PROP_QUERIES_MAX_SIZE) {
+        xmlSecInvalidSizeMoreThanError("Number of property queries",
+            gXmlSecOpenSSLPropQueriesSize, (xmlSecSize)XMLSEC_OPENSSL_PROP_QUERIES_MAX_SIZE, NULL);
+        xmlFree(value);
+        return(-1);
+    }
+
+    gXmlSecOpenSSLPropQueries[gXmlSecOpenSSLPropQueriesSize].algorithm = (char*)xmlStrdup(BAD_CAST algorithm);
+    if(gXmlSecOpenSSLPropQueries[gXmlSecOpenSSLPropQueriesSize].algorithm == NULL) {
+        xmlSecStrdupError(BAD_CAST algorithm, NULL);
+        xmlFree(value);
+        return(-1);
+    }
+    gXmlSecOpenSSLPropQueries[gXmlSecOpenSSLPropQueriesSize].propQuery = value;
+    ++gXmlSecOpenSSLPropQueriesSize;
+    return(0);
+}
+
+/**
+ * xmlSecOpenSSLGetPropQuery:
+ * @algorithm:          the OpenSSL algorithm name or key type (or NULL).
+ *
+ * Gets the property query for @algorithm: its own one if set or the default
+ * property query otherwise (see #xmlSecOpenSSLSetPropQuery).
+ *
+ * Returns: the property query or NULL if none is set.
+ */
+const char*
+xmlSecOpenSSLGetPropQuery(const char* algorithm) {
+    xmlSecSize ii;
+
+    if(algorithm != NULL) {
+        for(ii = 0; ii < gXmlSecOpenSSLPropQueriesSize; ++ii) {
+            if(xmlStrcasecmp(BAD_CAST gXmlSecOpenSSLPropQueries[ii].algorithm, BAD_CAST algorithm) == 0) {
+                return(gXmlSecOpenSSLPropQueries[ii].propQuery);
+            }
+        }
+    }
+    return(gXmlSecOpenSSLDefaultPropQuery);
+}
+
+/**
+ * xmlSecOpenSSLPKeyCtxNew:
+ * @pKey:               the key.
+ *
+ * Creates EVP_PKEY_CTX for @pKey using the current OSSL_LIB_CTX and
+ * the property query for the key type.
+ *
+ * Returns: the new EVP_PKEY_CTX or NULL if an error occurs.
+ */
+EVP_PKEY_CTX*
+xmlSecOpenSSLPKeyCtxNew(EVP_PKEY* pKey) {
+    xmlSecAssert2(pKey != NULL, NULL);
+
+    return(EVP_PKEY_CTX_new_from_pkey(xmlSecOpenSSLGetThreadLibCtx(), pKey,
+        xmlSecOpenSSLGetPropQuery(EVP_PKEY_get0_type_name(pKey))));
+}
+
+/********************************************************************
+ *
+ * EVP_PKEY_CTX prototypes cache: creating and initializing EVP_PKEY_CTX
+ * (provider lookups, operation init, padding and digest parameters) is
+ * expensive compared to signing a small digest. For each key and
+ * transform we keep a fully configured prototype and give out copies
+ * made with EVP_PKEY_CTX_dup(). The prototype holds a reference to the
+ * key, the cache is small and the oldest entries are replaced.
+ *
+ ********************************************************************/
+#define XMLSEC_OPENSSL_PKEY_CTX_CACHE_MAX_SIZE  32
+
+typedef struct _xmlSecOpenSSLPKeyCtxCacheEntry {
+    EVP_PKEY*           pKey;
+    const void*         tag;
+    int                 operation;
+    OSSL_LIB_CTX*       libCtx;
+    EVP_PKEY_CTX*       proto;
+} xmlSecOpenSSLPKeyCtxCacheEntry;
+
+static CRYPTO_RWLOCK*                   gXmlSecOpenSSLPKeyCtxCacheLock = NULL;
+static xmlSecOpenSSLPKeyCtxCacheEntry   gXmlSecOpenSSLPKeyCtxCache[XMLSEC_OPENSSL_PKEY_CTX_CACHE_MAX_SIZE];
+static xmlSecSize                       gXmlSecOpenSSLPKeyCtxCacheSize = 0;
+static xmlSecSize                       gXmlSecOpenSSLPKeyCtxCacheNext = 0;
+
+static void
+xmlSecOpenSSLPKeyCtxCacheInit(void) {
+    xmlSecAssert(gXmlSecOpenSSLPKeyCtxCacheLock == NULL);
+
+    memset(gXmlSecOpenSSLPKeyCtxCache, 0, sizeof(gXmlSecOpenSSLPKeyCtxCache));
+    gXmlSecOpenSSLPKeyCtxCacheSize = 0;
+    gXmlSecOpenSSLPKeyCtxCacheNext = 0;
+
+    gXmlSecOpenSSLPKeyCtxCacheLock = CRYPTO_THREAD_lock_new();
+    if(gXmlSecOpenSSLPKeyCtxCacheLock == NULL) {
+        /* not fatal: we just create new objects every time */
+        xmlSecOpenSSLError("CRYPTO_THREAD_lock_new", NULL);
+    }
+}
+
+static void
+xmlSecOpenSSLPKeyCtxCacheShutdown(void) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecOpenSSLPKeyCtxCacheSize; ++ii) {
+        EVP_PKEY_CTX_free(gXmlSecOpenSSLPKeyCtxCache[ii].proto);
+    }
+    memset(gXmlSecOpenSSLPKeyCtxCache, 0, sizeof(gXmlSecOpenSSLPKeyCtxCache));
+    gXmlSecOpenSSLPKeyCtxCacheSize = 0;
+    gXmlSecOpenSSLPKeyCtxCacheNext = 0;
+
+    if(gXmlSecOpenSSLPKeyCtxCacheLock != NULL) {
+        CRYPTO_THREAD_lock_free(gXmlSecOpenSSLPKeyCtxCacheLock);
+        gXmlSecOpenSSLPKeyCtxCacheLock = NULL;
+    }
+}
+
+/* the per thread library context is about to be destroyed */
+static void
+xmlSecOpenSSLPKeyCtxCacheRemoveLibCtx(OSSL_LIB_CTX* libCtx) {
+    xmlSecSize ii;
+
+    if(gXmlSecOpenSSLPKeyCtxCacheLock == NULL) {
+        return;
+    }
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLPKeyCtxCacheLock) != 1) {
+        return;
+    }
+    for(ii = 0; ii < gXmlSecOpenSSLPKeyCtxCacheSize; ) {
+        if(gXmlSecOpenSSLPKeyCtxCache[ii].libCtx != libCtx) {
+            ++ii;
+            continue;
+        }
+        EVP_PKEY_CTX_free(gXmlSecOpenSSLPKeyCtxCache[ii].proto);
+        --gXmlSecOpenSSLPKeyCtxCacheSize;
+        gXmlSecOpenSSLPKeyCtxCache[ii] = gXmlSecOpenSSLPKeyCtxCache[gXmlSecOpenSSLPKeyCtxCacheSize];
+        memset(&(gXmlSecOpenSSLPKeyCtxCache[gXmlSecOpenSSLPKeyCtxCacheSize]), 0, sizeof(xmlSecOpenSSLPKeyCtxCacheEntry));
+    }
+    gXmlSecOpenSSLPKeyCtxCacheNext = 0;
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLPKeyCtxCacheLock);
+}
+
+/* the caller is responsible for locking */
+static xmlSecOpenSSLPKeyCtxCacheEntry*
+xmlSecOpenSSLPKeyCtxCacheFind(EVP_PKEY* pKey, const void* tag, int operation, OSSL_LIB_CTX* libCtx) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecOpenSSLPKeyCtxCacheSize; ++ii) {
+        if((gXmlSecOpenSSLPKeyCtxCache[ii].pKey == pKey) &&
+           (gXmlSecOpenSSLPKeyCtxCache[ii].tag == tag) &&
+           (gXmlSecOpenSSLPKeyCtxCache[ii].operation == operation) &&
+           (gXmlSecOpenSSLPKeyCtxCache[ii].libCtx == libCtx)
+        ) {
+            return(&(gXmlSecOpenSSLPKeyCtxCache[ii]));
+        }
+    }
+    return(NULL);
+}
+
+/* the caller is responsible for locking, takes ownership of @proto */
+static void
+xmlSecOpenSSLPKeyCtxCacheAdd(EVP_PKEY* pKey, const void* tag, int operation, OSSL_LIB_CTX* libCtx,
+                             EVP_PKEY_CTX* proto) {
+    xmlSecOpenSSLPKeyCtxCacheEntry* entry;
+
+    xmlSecAssert(proto != NULL);
+
+    if(gXmlSecOpenSSLPKeyCtxCacheSize < XMLSEC_OPENSSL_PKEY_CTX_CACHE_MAX_SIZE) {
+        entry = &(gXmlSecOpenSSLPKeyCtxCache[gXmlSecOpenSSLPKeyCtxCacheSize++]);
+    } else {
+        /* replace the oldest entry */
+        if(gXmlSecOpenSSLPKeyCtxCacheNext >= XMLSEC_OPENSSL_PKEY_CTX_CACHE_MAX_SIZE) {
+            gXmlSecOpenSSLPKeyCtxCacheNext = 0;
+        }
+        entry = &(gXmlSecOpenSSLPKeyCtxCache[gXmlSecOpenSSLPKeyCtxCacheNext++]);
+        EVP_PKEY_CTX_free(entry->proto);
+    }
+    entry->pKey      = pKey;
+    entry->tag       = tag;
+    entry->operation = operation;
+    entry->libCtx    = libCtx;
+    entry->proto     = proto;
+}
+
+/**
+ * xmlSecOpenSSLPKeyCtxNewCached:
+ * @pKey:               the key.
+ * @tag:                the unique id of the @setup parameters (e.g. transform id).
+ * @operation:          the operation (e.g. sign or verify) for @setup.
+ * @setup:              the function to initialize the new EVP_PKEY_CTX.
+ * @data:               the @setup function data.
+ *
+ * Creates EVP_PKEY_CTX for @pKey (see #xmlSecOpenSSLPKeyCtxNew) initialized
+ * by @setup. The result should depend only on @tag and @operation: the
+ * initialized object is cached and the next calls for the same key, @tag,
+ * @operation and library context return its copy without calling @setup.
+ *
+ * Returns: the new EVP_PKEY_CTX or NULL if an error occurs.
+ */
+EVP_PKEY_CTX*
+xmlSecOpenSSLPKeyCtxNewCached(EVP_PKEY* pKey, const void* tag, int operation,
+                              xmlSecOpenSSLPKeyCtxSetupMethod setup, void* data) {
+    OSSL_LIB_CTX* libCtx = xmlSecOpenSSLGetThreadLibCtx();
+    xmlSecOpenSSLPKeyCtxCacheEntry* entry;
+    EVP_PKEY_CTX* pKeyCtx = NULL;
+    EVP_PKEY_CTX* proto;
+    int ret;
+
+    xmlSecAssert2(pKey != NULL, NULL);
+    xmlSecAssert2(tag != NULL, NULL);
+    xmlSecAssert2(setup != NULL, NULL);
+
+    if((gXmlSecOpenSSLPKeyCtxCacheLock != NULL) && (CRYPTO_THREAD_read_lock(gXmlSecOpenSSLPKeyCtxCacheLock) == 1)) {
+        entry = xmlSecOpenSSLPKeyCtxCacheFind(pKey, tag, operation, libCtx);
+        if(entry != NULL) {
+            pKeyCtx = EVP_PKEY_CTX_dup(entry->proto);
+        }
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLPKeyCtxCacheLock);
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoKeyCtx, (pKeyCtx != NULL) ? 1 : 0);
+        if(pKeyCtx != NULL) {
+            return(pKeyCtx);
+        }
+    }
+
+    /* create and setup outside of the lock */
+    pKeyCtx = xmlSecOpenSSLPKeyCtxNew(pKey);
+    if(pKeyCtx == NULL) {
+        xmlSecOpenSSLError("xmlSecOpenSSLPKeyCtxNew", NULL);
+        return(NULL);
+    }
+    ret = setup(pKeyCtx, data);
+    if(ret < 0) {
+        xmlSecInternalError("setup", NULL);
+        EVP_PKEY_CTX_free(pKeyCtx);
+        return(NULL);
+    }
+
+    /* not fatal if we can't cache it (e.g. the provider doesn't support dup) */
+    if(gXmlSecOpenSSLPKeyCtxCacheLock != NULL) {
+        proto = EVP_PKEY_CTX_dup(pKeyCtx);
+        if((proto != NULL) && (CRYPTO_THREAD_write_lock(gXmlSecOpenSSLPKeyCtxCacheLock) == 1)) {
+            if(xmlSecOpenSSLPKeyCtxCacheFind(pKey, tag, operation, libCtx) == NULL) {
+                xmlSecOpenSSLPKeyCtxCacheAdd(pKey, tag, operation, libCtx, proto);
+                proto = NULL;
+            }
+            CRYPTO_THREAD_unlock(gXmlSecOpenSSLPKeyCtxCacheLock);
+        }
+        if(proto != NULL) {
+            EVP_PKEY_CTX_free(proto);
+        }
+    }
+    return(pKeyCtx);
+}
+
+/********************************************************************
+ *
+ * EVP_MAC_CTX prototypes cache (disabled by default): EVP_MAC_init()
+ * looks up the digest and computes the inner and outer pads from the
+ * key bytes. For applications that verify many small HMAC messages
+ * with a few keys we keep the keyed EVP_MAC_CTX and give out copies.
+ * The entries keep a copy of the key to match the lookups, it is
+ * cleansed when the entry is removed.
+ *
+ ********************************************************************/
+#define XMLSEC_OPENSSL_MAC_CTX_CACHE_MAX_SIZE           32
+#define XMLSEC_OPENSSL_MAC_CTX_CACHE_MAX_KEY_SIZE       128
+
+typedef struct _xmlSecOpenSSLMacCtxCacheEntry {
+    const char*         name;
+    OSSL_LIB_CTX*       libCtx;
+    xmlSecByte          key[XMLSEC_OPENSSL_MAC_CTX_CACHE_MAX_KEY_SIZE];
+    xmlSecSize          keySize;
+    EVP_MAC_CTX*        proto;
+} xmlSecOpenSSLMacCtxCacheEntry;
+
+static CRYPTO_RWLOCK*                   gXmlSecOpenSSLMacCtxCacheLock = NULL;
+static int                              gXmlSecOpenSSLMacCtxCacheEnabled = 0;
+static xmlSecOpenSSLMacCtxCacheEntry    gXmlSecOpenSSLMacCtxCache[XMLSEC_OPENSSL_MAC_CTX_CACHE_MAX_SIZE];
+static xmlSecSize                       gXmlSecOpenSSLMacCtxCacheSize = 0;
+static xmlSecSize                       gXmlSecOpenSSLMacCtxCacheNext = 0;
+
+static void
+xmlSecOpenSSLMacCtxCacheInit(void) {
+    xmlSecAssert(gXmlSecOpenSSLMacCtxCacheLock == NULL);
+
+    memset(gXmlSecOpenSSLMacCtxCache, 0, sizeof(gXmlSecOpenSSLMacCtxCache));
+    gXmlSecOpenSSLMacCtxCacheSize = 0;
+    gXmlSecOpenSSLMacCtxCacheNext = 0;
+
+    gXmlSecOpenSSLMacCtxCacheLock = CRYPTO_THREAD_lock_new();
+    if(gXmlSecOpenSSLMacCtxCacheLock == NULL) {
+        /* not fatal: we just create new objects every time */
+        xmlSecOpenSSLError("CRYPTO_THREAD_lock_new", NULL);
+    }
+}
+
+/* the caller is responsible for locking */
+static void
+xmlSecOpenSSLMacCtxCacheRemove(xmlSecSize pos) {
+    xmlSecAssert(pos < gXmlSecOpenSSLMacCtxCacheSize);
+
+    EVP_MAC_CTX_free(gXmlSecOpenSSLMacCtxCache[pos].proto);
+    OPENSSL_cleanse(&(gXmlSecOpenSSLMacCtxCache[pos]), sizeof(xmlSecOpenSSLMacCtxCacheEntry));
+
+    --gXmlSecOpenSSLMacCtxCacheSize;
+    if(pos < gXmlSecOpenSSLMacCtxCacheSize) {
+        gXmlSecOpenSSLMacCtxCache[pos] = gXmlSecOpenSSLMacCtxCache[gXmlSecOpenSSLMacCtxCacheSize];
+        OPENSSL_cleanse(&(gXmlSecOpenSSLMacCtxCache[gXmlSecOpenSSLMacCtxCacheSize]), sizeof(xmlSecOpenSSLMacCtxCacheEntry));
+    }
+    gXmlSecOpenSSLMacCtxCacheNext = 0;
+}
+
+/* the caller is responsible for locking */
+static void
+xmlSecOpenSSLMacCtxCacheFlush(void) {
+    while(gXmlSecOpenSSLMacCtxCacheSize > 0) {
+        xmlSecOpenSSLMacCtxCacheRemove(gXmlSecOpenSSLMacCtxCacheSize - 1);
+    }
+}
+
+static void
+xmlSecOpenSSLMacCtxCacheShutdown(void) {
+    xmlSecOpenSSLMacCtxCacheFlush();
+    gXmlSecOpenSSLMacCtxCacheEnabled = 0;
+
+    if(gXmlSecOpenSSLMacCtxCacheLock != NULL) {
+        CRYPTO_THREAD_lock_free(gXmlSecOpenSSLMacCtxCacheLock);
+        gXmlSecOpenSSLMacCtxCacheLock = NULL;
+    }
+}
+
+/* the per thread library context is about to be destroyed */
+static void
+xmlSecOpenSSLMacCtxCacheRemoveLibCtx(OSSL_LIB_CTX* libCtx) {
+    xmlSecSize ii;
+
+    if(gXmlSecOpenSSLMacCtxCacheLock == NULL) {
+        return;
+    }
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLMacCtxCacheLock) != 1) {
+        return;
+    }
+    for(ii = 0; ii < gXmlSecOpenSSLMacCtxCacheSize; ) {
+        if(gXmlSecOpenSSLMacCtxCache[ii].libCtx != libCtx) {
+            ++ii;
+            continue;
+        }
+        xmlSecOpenSSLMacCtxCacheRemove(ii);
+    }
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLMacCtxCacheLock);
+}
+
+/* the caller is responsible for locking */
+static xmlSecOpenSSLMacCtxCacheEntry*
+xmlSecOpenSSLMacCtxCacheFind(const char* name, OSSL_LIB_CTX* libCtx, const xmlSecByte* key, xmlSecSize keySize) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecOpenSSLMacCtxCacheSize; ++ii) {
+        if((gXmlSecOpenSSLMacCtxCache[ii].libCtx == libCtx) &&
+           (gXmlSecOpenSSLMacCtxCache[ii].keySize == keySize) &&
+           (strcmp(gXmlSecOpenSSLMacCtxCache[ii].name, name) == 0) &&
+           (CRYPTO_memcmp(gXmlSecOpenSSLMacCtxCache[ii].key, key, keySize) == 0)
+        ) {
+            return(&(gXmlSecOpenSSLMacCtxCache[ii]));
+        }
+    }
+    return(NULL);
+}
+
+/* the caller is responsible for locking, takes ownership of @proto */
+static void
+xmlSecOpenSSLMacCtxCacheAdd(const char* name, OSSL_LIB_CTX* libCtx, const xmlSecByte* key, xmlSecSize keySize,
+                            EVP_MAC_CTX* proto) {
+    xmlSecOpenSSLMacCtxCacheEntry* entry;
+
+    xmlSecAssert(proto != NULL);
+    xmlSecAssert(keySize <= XMLSEC_OPENSSL_MAC_CTX_CACHE_MAX_KEY_SIZE);
+
+    if(gXmlSecOpenSSLMacCtxCacheSize < XMLSEC_OPENSSL_MAC_CTX_CACHE_MAX_SIZE) {
+        entry = &(gXmlSecOpenSSLMacCtxCache[gXmlSecOpenSSLMacCtxCacheSize++]);
+    } else {
+        /* replace the oldest entry */
+        if(gXmlSecOpenSSLMacCtxCacheNext >= XMLSEC_OPENSSL_MAC_CTX_CACHE_MAX_SIZE) {
+            gXmlSecOpenSSLMacCtxCacheNext = 0;
+        }
+        entry = &(gXmlSecOpenSSLMacCtxCache[gXmlSecOpenSSLMacCtxCacheNext++]);
+        EVP_MAC_CTX_free(entry->proto);
+        OPENSSL_cleanse(entry, sizeof(xmlSecOpenSSLMacCtxCacheEntry));
+    }
+    entry->name    = name;
+    entry->libCtx  = libCtx;
+    memcpy(entry->key, key, keySize);
+    entry->keySize = keySize;
+    entry->proto   = proto;
+}
+
+/**
+ * xmlSecOpenSSLSetHmacCtxCache:
+ * @enabled:            1 to enable the keyed HMAC contexts cache or
+ *                      0 to disable it.
+ *
+ * Enables or disables the cache of the keyed EVP_MAC_CTX objects for the
+ * HMAC transforms. When enabled, the HMAC transforms that use the same key
+ * and digest copy the keyed context instead of initializing a new one. The
+ * cache is small and keeps a copy of the most recently used keys until
+ * they are replaced or the cache is disabled. Disabling the cache removes
+ * (and cleanses) all the entries.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLSetHmacCtxCache(int enabled) {
+    if(gXmlSecOpenSSLMacCtxCacheLock == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_CRYPTO_FAILED, NULL, "cache lock is not available");
+        return(-1);
+    }
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLMacCtxCacheLock) != 1) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_write_lock", NULL);
+        return(-1);
+    }
+    gXmlSecOpenSSLMacCtxCacheEnabled = (enabled != 0) ? 1 : 0;
+    if(enabled == 0) {
+        xmlSecOpenSSLMacCtxCacheFlush();
+    }
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLMacCtxCacheLock);
+    return(0);
+}
+
+/**
+ * xmlSecOpenSSLMacCtxNewCached:
+ * @name:               the static name of the @create parameters (e.g. digest name).
+ * @key:                the key.
+ * @keySize:            the key size.
+ * @create:             the function to create the new keyed EVP_MAC_CTX.
+ * @data:               the @create function data.
+ *
+ * Creates EVP_MAC_CTX using @create. The result should depend only on @name
+ * and the key: if the cache is enabled (see #xmlSecOpenSSLSetHmacCtxCache)
+ * then the created object is cached and the next calls for the same @name,
+ * key and library context return its copy without calling @create.
+ *
+ * Returns: the new EVP_MAC_CTX or NULL if an error occurs.
+ */
+EVP_MAC_CTX*
+xmlSecOpenSSLMacCtxNewCached(const char* name, const xmlSecByte* key, xmlSecSize keySize,
+                             xmlSecOpenSSLMacCtxCreateMethod create, void* data) {
+    OSSL_LIB_CTX* libCtx = xmlSecOpenSSLGetThreadLibCtx();
+    xmlSecOpenSSLMacCtxCacheEntry* entry;
+    EVP_MAC_CTX* macCtx = NULL;
+    EVP_MAC_CTX* proto;
+    int enabled = 0;
+
+    xmlSecAssert2(name != NULL, NULL);
+    xmlSecAssert2(key != NULL, NULL);
+    xmlSecAssert2(create != NULL, NULL);
+
+    if((keySize <= XMLSEC_OPENSSL_MAC_CTX_CACHE_MAX_KEY_SIZE) && (gXmlSecOpenSSLMacCtxCacheLock != NULL) &&
+       (CRYPTO_THREAD_read_lock(gXmlSecOpenSSLMacCtxCacheLock) == 1)) {
+        enabled = gXmlSecOpenSSLMacCtxCacheEnabled;
+        if(enabled != 0) {
+            entry = xmlSecOpenSSLMacCtxCacheFind(name, libCtx, key, keySize);
+            if(entry != NULL) {
+                macCtx = EVP_MAC_CTX_dup(entry->proto);
+            }
+        }
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLMacCtxCacheLock);
+        if(enabled != 0) {
+            xmlSecStatsCacheLookup(xmlSecStatsCacheHmac, (macCtx != NULL) ? 1 : 0);
+        }
+        if(macCtx != NULL) {
+            return(macCtx);
+        }
+    }
+
+    /* create outside of the lock */
+    macCtx = create(key, keySize, data);
+    if(macCtx == NULL) {
+        xmlSecInternalError("create", NULL);
+        return(NULL);
+    }
+
+    /* not fatal if we can't cache it */
+    if(enabled != 0) {
+        proto = EVP_MAC_CTX_dup(macCtx);
+        if((proto != NULL) && (CRYPTO_THREAD_write_lock(gXmlSecOpenSSLMacCtxCacheLock) == 1)) {
+            if((gXmlSecOpenSSLMacCtxCacheEnabled != 0) &&
+               (xmlSecOpenSSLMacCtxCacheFind(name, libCtx, key, keySize) == NULL)) {
+                xmlSecOpenSSLMacCtxCacheAdd(name, libCtx, key, keySize, proto);
+                proto = NULL;
+            }
+            CRYPTO_THREAD_unlock(gXmlSecOpenSSLMacCtxCacheLock);
+        }
+        if(proto != NULL) {
+            EVP_MAC_CTX_free(proto);
+        }
+    }
+    return(macCtx);
+}
+
+/********************************************************************
+ *
+ * Public keys cache (disabled by default): creating EVP_PKEY from the
+ * KeyValue requires BIGNUMs conversion, OSSL_PARAM building and the
+ * key import into the provider. For applications that verify many
+ * documents with the same KeyValue public keys we keep the created
+ * EVP_PKEY objects (they are immutable and can be shared between
+ * threads) identified by the SHA256 digest of the KeyValue parts.
+ * The private keys are never cached.
+ *
+ ********************************************************************/
+#define XMLSEC_OPENSSL_PUBLIC_KEYS_CACHE_MAX_SIZE       64
+
+typedef struct _xmlSecOpenSSLPublicKeysCacheEntry {
+    const char*         name;
+    OSSL_LIB_CTX*       libCtx;
+    xmlSecByte          id[XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE];
+    EVP_PKEY*           pKey;
+} xmlSecOpenSSLPublicKeysCacheEntry;
+
+static CRYPTO_RWLOCK*                       gXmlSecOpenSSLPublicKeysCacheLock = NULL;
+static int                                  gXmlSecOpenSSLPublicKeysCacheEnabled = 0;
+static xmlSecOpenSSLPublicKeysCacheEntry    gXmlSecOpenSSLPublicKeysCache[XMLSEC_OPENSSL_PUBLIC_KEYS_CACHE_MAX_SIZE];
+static xmlSecSize                           gXmlSecOpenSSLPublicKeysCacheSize = 0;
+static xmlSecSize                           gXmlSecOpenSSLPublicKeysCacheNext = 0;
+
+static void
+xmlSecOpenSSLPublicKeysCacheInit(void) {
+    xmlSecAssert(gXmlSecOpenSSLPublicKeysCacheLock == NULL);
+
+    memset(gXmlSecOpenSSLPublicKeysCache, 0, sizeof(gXmlSecOpenSSLPublicKeysCache));
+    gXmlSecOpenSSLPublicKeysCacheSize = 0;
+    gXmlSecOpenSSLPublicKeysCacheNext = 0;
+
+    gXmlSecOpenSSLPublicKeysCacheLock = CRYPTO_THREAD_lock_new();
+    if(gXmlSecOpenSSLPublicKeysCacheLock == NULL) {
+        /* not fatal: we just create new objects every time */
+        xmlSecOpenSSLError("CRYPTO_THREAD_lock_new", NULL);
+    }
+}
+
+/* the caller is responsible for locking */
+static void
+xmlSecOpenSSLPublicKeysCacheFlush(void) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecOpenSSLPublicKeysCacheSize; ++ii) {
+        EVP_PKEY_free(gXmlSecOpenSSLPublicKeysCache[ii].pKey);
+    }
+    memset(gXmlSecOpenSSLPublicKeysCache, 0, sizeof(gXmlSecOpenSSLPublicKeysCache));
+    gXmlSecOpenSSLPublicKeysCacheSize = 0;
+    gXmlSecOpenSSLPublicKeysCacheNext = 0;
+}
+
+static void
+xmlSecOpenSSLPublicKeysCacheShutdown(void) {
+    xmlSecOpenSSLPublicKeysCacheFlush();
+    gXmlSecOpenSSLPublicKeysCacheEnabled = 0;
+
+    if(gXmlSecOpenSSLPublicKeysCacheLock != NULL) {
+        CRYPTO_THREAD_lock_free(gXmlSecOpenSSLPublicKeysCacheLock);
+        gXmlSecOpenSSLPublicKeysCacheLock = NULL;
+    }
+}
+
+/* the caller is responsible for locking */
+static xmlSecOpenSSLPublicKeysCacheEntry*
+xmlSecOpenSSLPublicKeysCacheFindEntry(const char* name, OSSL_LIB_CTX* libCtx, const xmlSecByte* id) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecOpenSSLPublicKeysCacheSize; ++ii) {
+        if((gXmlSecOpenSSLPublicKeysCache[ii].libCtx == libCtx) &&
+           (strcmp(gXmlSecOpenSSLPublicKeysCache[ii].name, name) == 0) &&
+           (memcmp(gXmlSecOpenSSLPublicKeysCache[ii].id, id, XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE) == 0)
+        ) {
+            return(&(gXmlSecOpenSSLPublicKeysCache[ii]));
+        }
+    }
+    return(NULL);
+}
+
+/**
+ * xmlSecOpenSSLSetPublicKeysCache:
+ * @enabled:            1 to enable the KeyValue public keys cache or
+ *                      0 to disable it.
+ *
+ * Enables or disables the cache of the public keys read from the
+ * &lt;dsig:KeyValue/&gt; elements (RSA, DSA and EC). When enabled, reading
+ * the same public key again shares the previously created EVP_PKEY object
+ * instead of importing the key one more time. The cache is small and keeps
+ * the most recently used keys until they are replaced or the cache is
+ * disabled. Disabling the cache removes all the entries.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLSetPublicKeysCache(int enabled) {
+    if(gXmlSecOpenSSLPublicKeysCacheLock == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_CRYPTO_FAILED, NULL, "cache lock is not available");
+        return(-1);
+    }
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLPublicKeysCacheLock) != 1) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_write_lock", NULL);
+        return(-1);
+    }
+    gXmlSecOpenSSLPublicKeysCacheEnabled = (enabled != 0) ? 1 : 0;
+    if(enabled == 0) {
+        xmlSecOpenSSLPublicKeysCacheFlush();
+    }
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLPublicKeysCacheLock);
+    return(0);
+}
+
+/**
+ * xmlSecOpenSSLPublicKeyGetId:
+ * @curve:              the EC curve name or NULL.
+ * @parts:              the KeyValue parts (e.g. modulus and exponent for RSA).
+ * @partsSize:          the number of parts.
+ * @id:                 the output buffer (XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE bytes).
+ *
+ * Calculates the public key cache id from the KeyValue parts if the cache
+ * is enabled (see #xmlSecOpenSSLSetPublicKeysCache).
+ *
+ * Returns: 1 if the id was calculated, 0 if the cache is disabled, or
+ * a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLPublicKeyGetId(const xmlChar* curve, const xmlSecBufferPtr* parts, xmlSecSize partsSize,
+                            xmlSecByte* id
+) {
+    EVP_MD_CTX* mdCtx = NULL;
+    xmlSecByte partSize[sizeof(xmlSecSize)];
+    xmlSecSize ii, size;
+    unsigned int idLen = 0;
+    int res = -1;
+
+    xmlSecAssert2(parts != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+
+    /* no need for locking: the worst case is a cache miss */
+    if(gXmlSecOpenSSLPublicKeysCacheEnabled == 0) {
+        return(0);
+    }
+
+    mdCtx = xmlSecOpenSSLEvpMdCtxBorrow();
+    if(mdCtx == NULL) {
+        xmlSecOpenSSLError("xmlSecOpenSSLEvpMdCtxBorrow", NULL);
+        goto done;
+    }
+    if(EVP_DigestInit_ex(mdCtx, EVP_sha256(), NULL) != 1) {
+        xmlSecOpenSSLError("EVP_DigestInit_ex", NULL);
+        goto done;
+    }
+    if((curve != NULL) && (EVP_DigestUpdate(mdCtx, curve, (size_t)xmlStrlen(curve) + 1) != 1)) {
+        xmlSecOpenSSLError("EVP_DigestUpdate", NULL);
+        goto done;
+    }
+    for(ii = 0; ii < partsSize; ++ii) {
+        xmlSecAssert2(parts[ii] != NULL, -1);
+
+        /* the parts sizes are included to make the id unambiguous */
+        size = xmlSecBufferGetSize(parts[ii]);
+        memcpy(partSize, &size, sizeof(partSize));
+        if(EVP_DigestUpdate(mdCtx, partSize, sizeof(partSize)) != 1) {
+            xmlSecOpenSSLError("EVP_DigestUpdate", NULL);
+            goto done;
+        }
+        if((size > 0) && (EVP_DigestUpdate(mdCtx, xmlSecBufferGetData(parts[ii]), size) != 1)) {
+            xmlSecOpenSSLError("EVP_DigestUpdate", NULL);
+            goto done;
+        }
+    }
+    if((EVP_DigestFinal_ex(mdCtx, id, &idLen) != 1) || (idLen != XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE)) {
+        xmlSecOpenSSLError("EVP_DigestFinal_ex", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 1;
+
+done:
+    if(mdCtx != NULL) {
+        xmlSecOpenSSLEvpMdCtxRelease(mdCtx);
+    }
+    return(res);
+}
+
+/**
+ * xmlSecOpenSSLPublicKeyFindCached:
+ * @name:               the static key type name (e.g. "RSA").
+ * @id:                 the public key id (see #xmlSecOpenSSLPublicKeyGetId).
+ *
+ * Searches the public keys cache.
+ *
+ * Returns: the new reference to the cached EVP_PKEY or NULL if not found.
+ */
+EVP_PKEY*
+xmlSecOpenSSLPublicKeyFindCached(const char* name, const xmlSecByte* id) {
+    xmlSecOpenSSLPublicKeysCacheEntry* entry;
+    EVP_PKEY* res = NULL;
+
+    xmlSecAssert2(name != NULL, NULL);
+    xmlSecAssert2(id != NULL, NULL);
+
+    if((gXmlSecOpenSSLPublicKeysCacheLock == NULL) ||
+       (CRYPTO_THREAD_read_lock(gXmlSecOpenSSLPublicKeysCacheLock) != 1)) {
+        return(NULL);
+    }
+    if(gXmlSecOpenSSLPublicKeysCacheEnabled != 0) {
+        entry = xmlSecOpenSSLPublicKeysCacheFindEntry(name, xmlSecOpenSSLGetLibCtx(), id);
+        if((entry != NULL) && (EVP_PKEY_up_ref(entry->pKey) == 1)) {
+            res = entry->pKey;
+        }
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoKeyValue, (res != NULL) ? 1 : 0);
+    }
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLPublicKeysCacheLock);
+    return(res);
+}
+
+/**
+ * xmlSecOpenSSLPublicKeyAddCached:
+ * @name:               the static key type name (e.g. "RSA").
+ * @id:                 the public key id (see #xmlSecOpenSSLPublicKeyGetId).
+ * @pKey:               the public key (the cache takes a new reference).
+ *
+ * Adds @pKey to the public keys cache, errors are ignored.
+ */
+void
+xmlSecOpenSSLPublicKeyAddCached(const char* name, const xmlSecByte* id, EVP_PKEY* pKey) {
+    OSSL_LIB_CTX* libCtx = xmlSecOpenSSLGetLibCtx();
+    xmlSecOpenSSLPublicKeysCacheEntry* entry;
+
+    xmlSecAssert(name != NULL);
+    xmlSecAssert(id != NULL);
+    xmlSecAssert(pKey != NULL);
+
+    if((gXmlSecOpenSSLPublicKeysCacheLock == NULL) ||
+       (CRYPTO_THREAD_write_lock(gXmlSecOpenSSLPublicKeysCacheLock) != 1)) {
+        return;
+    }
+    if((gXmlSecOpenSSLPublicKeysCacheEnabled == 0) ||
+       (xmlSecOpenSSLPublicKeysCacheFindEntry(name, libCtx, id) != NULL) ||
+       (EVP_PKEY_up_ref(pKey) != 1)) {
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLPublicKeysCacheLock);
+        return;
+    }
+
+    if(gXmlSecOpenSSLPublicKeysCacheSize < XMLSEC_OPENSSL_PUBLIC_KEYS_CACHE_MAX_SIZE) {
+        entry = &(gXmlSecOpenSSLPublicKeysCache[gXmlSecOpenSSLPublicKeysCacheSize++]);
+    } else {
+        /* replace the oldest entry */
+        if(gXmlSecOpenSSLPublicKeysCacheNext >= XMLSEC_OPENSSL_PUBLIC_KEYS_CACHE_MAX_SIZE) {
+            gXmlSecOpenSSLPublicKeysCacheNext = 0;
+        }
+        entry = &(gXmlSecOpenSSLPublicKeysCache[gXmlSecOpenSSLPublicKeysCacheNext++]);
+        EVP_PKEY_free(entry->pKey);
+    }
+    entry->name   = name;
+    entry->libCtx = libCtx;
+    memcpy(entry->id, id, XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE);
+    entry->pKey   = pKey;
+
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLPublicKeysCacheLock);
+}
+
+/********************************************************************
+ *
+ * EVP algorithms cache: EVP_MD_fetch()/EVP_CIPHER_fetch() take the
+ * provider store locks, with many threads creating transforms this
+ * becomes a contention point. We keep one reference on each fetched
+ * object until xmlSecOpenSSLShutdown() and give out new references.
+ *
+ ********************************************************************/
+#define XMLSEC_OPENSSL_EVP_CACHE_MAX_SIZE       64
+
+typedef struct _xmlSecOpenSSLEvpCacheEntry {
+    OSSL_LIB_CTX*       libCtx;
+    char*               name;
+    char*               propQuery;
+    EVP_MD*             md;
+    EVP_CIPHER*         cipher;
+} xmlSecOpenSSLEvpCacheEntry;
+
+static CRYPTO_RWLOCK*             gXmlSecOpenSSLEvpCacheLock = NULL;
+static xmlSecOpenSSLEvpCacheEntry gXmlSecOpenSSLEvpCache[XMLSEC_OPENSSL_EVP_CACHE_MAX_SIZE];
+static xmlSecSize                 gXmlSecOpenSSLEvpCacheSize = 0;
+
+static void
+xmlSecOpenSSLEvpCacheInit(void) {
+    xmlSecAssert(gXmlSecOpenSSLEvpCacheLock == NULL);
+
+    memset(gXmlSecOpenSSLEvpCache, 0, sizeof(gXmlSecOpenSSLEvpCache));
+    gXmlSecOpenSSLEvpCacheSize = 0;
+
+    /* if we can't create the lock then we just don't cache */
+    gXmlSecOpenSSLEvpCacheLock = CRYPTO_THREAD_lock_new();
+    if(gXmlSecOpenSSLEvpCacheLock == NULL) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_lock_new", NULL);
+    }
+}
+
+static void
+xmlSecOpenSSLEvpCacheShutdown(void) {
+    xmlSecSize ii;
+
+    for(ii = 0; ii < gXmlSecOpenSSLEvpCacheSize; ++ii) {
+        if(gXmlSecOpenSSLEvpCache[ii].md != NULL) {
+            EVP_MD_free(gXmlSecOpenSSLEvpCache[ii].md);
+        }
+        if(gXmlSecOpenSSLEvpCache[ii].cipher != NULL) {
+            EVP_CIPHER_free(gXmlSecOpenSSLEvpCache[ii].cipher);
+        }
+        xmlFree(gXmlSecOpenSSLEvpCache[ii].name);
+        if(gXmlSecOpenSSLEvpCache[ii].propQuery != NULL) {
+            xmlFree(gXmlSecOpenSSLEvpCache[ii].propQuery);
+        }
+    }
+    memset(gXmlSecOpenSSLEvpCache, 0, sizeof(gXmlSecOpenSSLEvpCache));
+    gXmlSecOpenSSLEvpCacheSize = 0;
+
+    if(gXmlSecOpenSSLEvpCacheLock != NULL) {
+        CRYPTO_THREAD_lock_free(gXmlSecOpenSSLEvpCacheLock);
+        gXmlSecOpenSSLEvpCacheLock = NULL;
+    }
+}
+
+/* should be called under the lock */
+static xmlSecOpenSSLEvpCacheEntry*
+xmlSecOpenSSLEvpCacheFind(OSSL_LIB_CTX* libCtx, const char* name, const char* propQuery, int isMd) {
+    xmlSecSize ii;
+
+    xmlSecAssert2(name != NULL, NULL);
+
+    for(ii = 0; ii < gXmlSecOpenSSLEvpCacheSize; ++ii) {
+        xmlSecOpenSSLEvpCacheEntry* entry = &(gXmlSecOpenSSLEvpCache[ii]);
+        if((entry->libCtx == libCtx) && (strcmp(entry->name, name) == 0) &&
+           (xmlStrEqual(BAD_CAST entry->propQuery, BAD_CAST propQuery) != 0) &&
+           (isMd != 0 ? (entry->md != NULL) : (entry->cipher != NULL))
+        ) {
+            return(entry);
+        }
+    }
+    return(NULL);
+}
+
+/* should be called under the write lock, returns 0 if the object was added
+ * to the cache (the cache takes its own reference) or 1 if cache is full */
+static int
+xmlSecOpenSSLEvpCacheAdd(OSSL_LIB_CTX* libCtx, const char* name, const char* propQuery,
+                         EVP_MD* md, EVP_CIPHER* cipher) {
+    xmlSecOpenSSLEvpCacheEntry* entry;
+
+    xmlSecAssert2(name != NULL, -1);
+    xmlSecAssert2((md != NULL) || (cipher != NULL), -1);
+
+    if(gXmlSecOpenSSLEvpCacheSize >= XMLSEC_OPENSSL_EVP_CACHE_MAX_SIZE) {
+        return(1);
+    }
+
+    entry = &(gXmlSecOpenSSLEvpCache[gXmlSecOpenSSLEvpCacheSize]);
+    entry->name = (char*)xmlStrdup(BAD_CAST name);
+    if(entry->name == NULL) {
+        xmlSecStrdupError(BAD_CAST name, NULL);
+        return(-1);
+    }
+    if(propQuery != NULL) {
+        entry->propQuery = (char*)xmlStrdup(BAD_CAST propQuery);
+        if(entry->propQuery == NULL) {
+            xmlSecStrdupError(BAD_CAST propQuery, NULL);
+            xmlFree(entry->name);
+            entry->name = NULL;
+            return(-1);
+        }
+    }
+    if(((md != NULL) && (EVP_MD_up_ref(md) != 1)) ||
+       ((cipher != NULL) && (EVP_CIPHER_up_ref(cipher) != 1))
+    ) {
+        xmlSecOpenSSLError("EVP_MD_up_ref/EVP_CIPHER_up_ref", NULL);
+        if(entry->propQuery != NULL) {
+            xmlFree(entry->propQuery);
+            entry->propQuery = NULL;
+        }
+        xmlFree(entry->name);
+        entry->name = NULL;
+        return(-1);
+    }
+    entry->libCtx = libCtx;
+    entry->md     = md;
+    entry->cipher = cipher;
+    ++gXmlSecOpenSSLEvpCacheSize;
+    return(0);
+}
+
+/**
+ * xmlSecOpenSSLEvpMdFetch:
+ * @name:               the digest name.
+ *
+ * Fetches the digest @name from the current OSSL_LIB_CTX (see
+ * #xmlSecOpenSSLGetThreadLibCtx) with the property query for @name (see
+ * #xmlSecOpenSSLSetPropQuery) using the process-wide cache.
+ *
+ * Returns: the new reference to the digest (the caller is responsible for
+ * freeing it with EVP_MD_free()) or NULL if an error occurs.
+ */
+EVP_MD*
+xmlSecOpenSSLEvpMdFetch(const char* name) {
+    OSSL_LIB_CTX* libCtx = xmlSecOpenSSLGetThreadLibCtx();
+    xmlSecOpenSSLEvpCacheEntry* entry;
+    const char* propQuery;
+    EVP_MD* md = NULL;
+
+    xmlSecAssert2(name != NULL, NULL);
+
+    propQuery = xmlSecOpenSSLGetPropQuery(name);
+
+    /* per thread library contexts have their own method stores */
+    if((gXmlSecOpenSSLEvpCacheLock == NULL) || (libCtx != xmlSecOpenSSLGetLibCtx())) {
+        return(EVP_MD_fetch(libCtx, name, propQuery));
+    }
+
+    if(CRYPTO_THREAD_read_lock(gXmlSecOpenSSLEvpCacheLock) == 1) {
+        entry = xmlSecOpenSSLEvpCacheFind(libCtx, name, propQuery, 1);
+        if((entry != NULL) && (EVP_MD_up_ref(entry->md) == 1)) {
+            md = entry->md;
+        }
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCacheLock);
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoAlgorithm, (md != NULL) ? 1 : 0);
+        if(md != NULL) {
+            return(md);
+        }
+    }
+
+    /* fetch outside of the lock */
+    md = EVP_MD_fetch(libCtx, name, propQuery);
+    if(md == NULL) {
+        return(NULL);
+    }
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLEvpCacheLock) == 1) {
+        if(xmlSecOpenSSLEvpCacheFind(libCtx, name, propQuery, 1) == NULL) {
+            /* not fatal if we can't cache it */
+            xmlSecOpenSSLEvpCacheAdd(libCtx, name, propQuery, md, NULL);
+        }
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCacheLock);
+    }
+    return(md);
+}
+
+/**
+ * xmlSecOpenSSLEvpCipherFetch:
+ * @name:               the cipher name.
+ *
+ * Fetches the cipher @name from the current OSSL_LIB_CTX (see
+ * #xmlSecOpenSSLGetThreadLibCtx) with the property query for @name (see
+ * #xmlSecOpenSSLSetPropQuery) using the process-wide cache.
+ *
+ * Returns: the new reference to the cipher (the caller is responsible for
+ * freeing it with EVP_CIPHER_free()) or NULL if an error occurs.
+ */
+EVP_CIPHER*
+xmlSecOpenSSLEvpCipherFetch(const char* name) {
+    OSSL_LIB_CTX* libCtx = xmlSecOpenSSLGetThreadLibCtx();
+    xmlSecOpenSSLEvpCacheEntry* entry;
+    const char* propQuery;
+    EVP_CIPHER* cipher = NULL;
+
+    xmlSecAssert2(name != NULL, NULL);
+
+    propQuery = xmlSecOpenSSLGetPropQuery(name);
+
+    /* per thread library contexts have their own method stores */
+    if((gXmlSecOpenSSLEvpCacheLock == NULL) || (libCtx != xmlSecOpenSSLGetLibCtx())) {
+        return(EVP_CIPHER_fetch(libCtx, name, propQuery));
+    }
+
+    if(CRYPTO_THREAD_read_lock(gXmlSecOpenSSLEvpCacheLock) == 1) {
+        entry = xmlSecOpenSSLEvpCacheFind(libCtx, name, propQuery, 0);
+        if((entry != NULL) && (EVP_CIPHER_up_ref(entry->cipher) == 1)) {
+            cipher = entry->cipher;
+        }
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCacheLock);
+        xmlSecStatsCacheLookup(xmlSecStatsCacheCryptoAlgorithm, (cipher != NULL) ? 1 : 0);
+        if(cipher != NULL) {
+            return(cipher);
+        }
+    }
+
+    /* fetch outside of the lock */
+    cipher = EVP_CIPHER_fetch(libCtx, name, propQuery);
+    if(cipher == NULL) {
+        return(NULL);
+    }
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLEvpCacheLock) == 1) {
+        if(xmlSecOpenSSLEvpCacheFind(libCtx, name, propQuery, 0) == NULL) {
+            /* not fatal if we can't cache it */
+            xmlSecOpenSSLEvpCacheAdd(libCtx, name, propQuery, NULL, cipher);
+        }
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCacheLock);
+    }
+    return(cipher);
+}
+
+/********************************************************************
+ *
+ * EVP_MD_CTX/EVP_CIPHER_CTX/X509_STORE_CTX pools: each digest, signature
+ * and block cipher transform (and each certs verification) needs a context
+ * object. Instead of allocating and freeing them every time, we keep small
+ * per thread free lists of reset objects. The objects are never shared
+ * between threads. All the pools are also linked in a global list so the
+ * pools of the threads that are still running can be destroyed on shutdown.
+ *
+ ********************************************************************/
+#define XMLSEC_OPENSSL_EVP_CTX_POOL_MAX_SIZE    16
+
+typedef struct _xmlSecOpenSSLEvpCtxPool         xmlSecOpenSSLEvpCtxPool,
+                                                *xmlSecOpenSSLEvpCtxPoolPtr;
+struct _xmlSecOpenSSLEvpCtxPool {
+    EVP_MD_CTX*                 mdCtxs[XMLSEC_OPENSSL_EVP_CTX_POOL_MAX_SIZE];
+    xmlSecSize                  mdCtxsSize;
+    EVP_CIPHER_CTX*             cipherCtxs[XMLSEC_OPENSSL_EVP_CTX_POOL_MAX_SIZE];
+    xmlSecSize                  cipherCtxsSize;
+#ifndef XMLSEC_NO_X509
+    X509_STORE_CTX*             storeCtxs[XMLSEC_OPENSSL_EVP_CTX_POOL_MAX_SIZE];
+    xmlSecSize                  storeCtxsSize;
+#endif /* XMLSEC_NO_X509 */
+    xmlSecOpenSSLEvpCtxPoolPtr  prev;
+    xmlSecOpenSSLEvpCtxPoolPtr  next;
+};
+
+static CRYPTO_RWLOCK*                   gXmlSecOpenSSLEvpCtxPoolLock = NULL;
+static CRYPTO_THREAD_LOCAL              gXmlSecOpenSSLEvpCtxPoolKey;
+static int                              gXmlSecOpenSSLEvpCtxPoolInitialized = 0;
+static xmlSecOpenSSLEvpCtxPoolPtr       gXmlSecOpenSSLEvpCtxPools = NULL;
+
+static void
+xmlSecOpenSSLEvpCtxPoolDestroy(xmlSecOpenSSLEvpCtxPoolPtr pool) {
+    xmlSecSize ii;
+
+    xmlSecAssert(pool != NULL);
+
+    for(ii = 0; ii < pool->mdCtxsSize; ++ii) {
+        EVP_MD_CTX_free(pool->mdCtxs[ii]);
+    }
+    for(ii = 0; ii < pool->cipherCtxsSize; ++ii) {
+        EVP_CIPHER_CTX_free(pool->cipherCtxs[ii]);
+    }
+#ifndef XMLSEC_NO_X509
+    for(ii = 0; ii < pool->storeCtxsSize; ++ii) {
+        X509_STORE_CTX_free(pool->storeCtxs[ii]);
+    }
+#endif /* XMLSEC_NO_X509 */
+    xmlFree(pool);
+}
+
+/* called on thread exit */
+static void
+xmlSecOpenSSLEvpCtxPoolCleanup(void* data) {
+    xmlSecOpenSSLEvpCtxPoolPtr pool = (xmlSecOpenSSLEvpCtxPoolPtr)data;
+    xmlSecOpenSSLEvpCtxPoolPtr cur;
+    int found = 0;
+
+    if((pool == NULL) || (gXmlSecOpenSSLEvpCtxPoolLock == NULL)) {
+        return;
+    }
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLEvpCtxPoolLock) != 1) {
+        return;
+    }
+    for(cur = gXmlSecOpenSSLEvpCtxPools; cur != NULL; cur = cur->next) {
+        if(cur == pool) {
+            if(pool->prev != NULL) {
+                pool->prev->next = pool->next;
+            } else {
+                gXmlSecOpenSSLEvpCtxPools = pool->next;
+            }
+            if(pool->next != NULL) {
+                pool->next->prev = pool->prev;
+            }
+            found = 1;
+            break;
+        }
+    }
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCtxPoolLock);
+
+    /* might be already destroyed in xmlSecOpenSSLEvpCtxPoolShutdown() */
+    if(found != 0) {
+        xmlSecOpenSSLEvpCtxPoolDestroy(pool);
+    }
+}
+
+static void
+xmlSecOpenSSLEvpCtxPoolInit(void) {
+    xmlSecAssert(gXmlSecOpenSSLEvpCtxPoolInitialized == 0);
+    xmlSecAssert(gXmlSecOpenSSLEvpCtxPoolLock == NULL);
+
+    /* not fatal if anything fails: we just create new objects every time */
+    gXmlSecOpenSSLEvpCtxPoolLock = CRYPTO_THREAD_lock_new();
+    if(gXmlSecOpenSSLEvpCtxPoolLock == NULL) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_lock_new", NULL);
+        return;
+    }
+    if(CRYPTO_THREAD_init_local(&gXmlSecOpenSSLEvpCtxPoolKey, xmlSecOpenSSLEvpCtxPoolCleanup) != 1) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_init_local", NULL);
+        CRYPTO_THREAD_lock_free(gXmlSecOpenSSLEvpCtxPoolLock);
+        gXmlSecOpenSSLEvpCtxPoolLock = NULL;
+        return;
+    }
+    gXmlSecOpenSSLEvpCtxPools = NULL;
+    gXmlSecOpenSSLEvpCtxPoolInitialized = 1;
+}
+
+/* the other threads should not use xmlsec-openssl during or after the shutdown */
+static void
+xmlSecOpenSSLEvpCtxPoolShutdown(void) {
+    xmlSecOpenSSLEvpCtxPoolPtr pools = NULL;
+    xmlSecOpenSSLEvpCtxPoolPtr pool;
+
+    if(gXmlSecOpenSSLEvpCtxPoolLock == NULL) {
+        return;
+    }
+
+    /* detach the pools of all the threads (including this one) */
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLEvpCtxPoolLock) == 1) {
+        gXmlSecOpenSSLEvpCtxPoolInitialized = 0;
+        pools = gXmlSecOpenSSLEvpCtxPools;
+        gXmlSecOpenSSLEvpCtxPools = NULL;
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCtxPoolLock);
+    }
+
+    /* the thread-local destructor is never called for the deleted key, the
+     * pools are destroyed here for all the threads */
+    CRYPTO_THREAD_set_local(&gXmlSecOpenSSLEvpCtxPoolKey, NULL);
+    CRYPTO_THREAD_cleanup_local(&gXmlSecOpenSSLEvpCtxPoolKey);
+    while(pools != NULL) {
+        pool = pools;
+        pools = pools->next;
+        xmlSecOpenSSLEvpCtxPoolDestroy(pool);
+    }
+
+    CRYPTO_THREAD_lock_free(gXmlSecOpenSSLEvpCtxPoolLock);
+    gXmlSecOpenSSLEvpCtxPoolLock = NULL;
+}
+
+static xmlSecOpenSSLEvpCtxPoolPtr
+xmlSecOpenSSLEvpCtxPoolGet(int create) {
+    xmlSecOpenSSLEvpCtxPoolPtr pool;
+
+    if(gXmlSecOpenSSLEvpCtxPoolInitialized == 0) {
+        return(NULL);
+    }
+    pool = (xmlSecOpenSSLEvpCtxPoolPtr)CRYPTO_THREAD_get_local(&gXmlSecOpenSSLEvpCtxPoolKey);
+    if((pool != NULL) || (create == 0)) {
+        return(pool);
+    }
+
+    pool = (xmlSecOpenSSLEvpCtxPoolPtr)xmlMalloc(sizeof(xmlSecOpenSSLEvpCtxPool));
+    if(pool == NULL) {
+        xmlSecMallocError(sizeof(xmlSecOpenSSLEvpCtxPool), NULL);
+        return(NULL);
+    }
+    memset(pool, 0, sizeof(xmlSecOpenSSLEvpCtxPool));
+
+    /* add to the global list unless the pools were shut down meanwhile */
+    if(CRYPTO_THREAD_write_lock(gXmlSecOpenSSLEvpCtxPoolLock) != 1) {
+        xmlSecOpenSSLError("CRYPTO_THREAD_write_lock", NULL);
+        xmlFree(pool);
+        return(NULL);
+    }
+    if(gXmlSecOpenSSLEvpCtxPoolInitialized == 0) {
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCtxPoolLock);
+        xmlFree(pool);
+        return(NULL);
+    }
+    if(CRYPTO_THREAD_set_local(&gXmlSecOpenSSLEvpCtxPoolKey, pool) != 1) {
+        CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCtxPoolLock);
+        xmlSecOpenSSLError("CRYPTO_THREAD_set_local", NULL);
+        xmlFree(pool);
+        return(NULL);
+    }
+    pool->next = gXmlSecOpenSSLEvpCtxPools;
+    if(gXmlSecOpenSSLEvpCtxPools != NULL) {
+        gXmlSecOpenSSLEvpCtxPools->prev = pool;
+    }
+    gXmlSecOpenSSLEvpCtxPools = pool;
+    CRYPTO_THREAD_unlock(gXmlSecOpenSSLEvpCtxPoolLock);
+    return(pool);
+}
+
+/**
+ * xmlSecOpenSSLEvpMdCtxBorrow:
+ *
+ * Gets a reset EVP_MD_CTX from the current thread pool or creates a new one.
+ *
+ * Returns: the EVP_MD_CTX (return it with xmlSecOpenSSLEvpMdCtxRelease())
+ * or NULL if an error occurs.
+ */
+EVP_MD_CTX*
+xmlSecOpenSSLEvpMdCtxBorrow(void) {
+    xmlSecOpenSSLEvpCtxPoolPtr pool;
+
+    pool = xmlSecOpenSSLEvpCtxPoolGet(0);
+    if((pool != NULL) && (pool->mdCtxsSize > 0)) {
+        --pool->mdCtxsSize;
+        return(pool->mdCtxs[pool->mdCtxsSize]);
+    }
+    return(EVP_MD_CTX_new());
+}
+
+/**
+ * xmlSecOpenSSLEvpMdCtxRelease:
+ * @mdCtx:              the EVP_MD_CTX.
+ *
+ * Resets @mdCtx and puts it into the current thread pool or frees it.
+ */
+void
+xmlSecOpenSSLEvpMdCtxRelease(EVP_MD_CTX* mdCtx) {
+    xmlSecOpenSSLEvpCtxPoolPtr pool;
+
+    xmlSecAssert(mdCtx != NULL);
+
+    pool = xmlSecOpenSSLEvpCtxPoolGet(1);
+    if((pool == NULL) || (pool->mdCtxsSize >= XMLSEC_OPENSSL_EVP_CTX_POOL_MAX_SIZE) ||
+       (EVP_MD_CTX_reset(mdCtx) != 1)
+    ) {
+        EVP_MD_CTX_free(mdCtx);
+        return;
+    }
+    pool->mdCtxs[pool->mdCtxsSize++] = mdCtx;
+}
+
+/**
+ * xmlSecOpenSSLEvpCipherCtxBorrow:
+ *
+ * Gets a reset EVP_CIPHER_CTX from the current thread pool or creates a new one.
+ *
+ * Returns: the EVP_CIPHER_CTX (return it with xmlSecOpenSSLEvpCipherCtxRelease())
+ * or NULL if an error occurs.
+ */
+EVP_CIPHER_CTX*
+xmlSecOpenSSLEvpCipherCtxBorrow(void) {
+    xmlSecOpenSSLEvpCtxPoolPtr pool;
+
+    pool = xmlSecOpenSSLEvpCtxPoolGet(0);
+    if((pool != NULL) && (pool->cipherCtxsSize > 0)) {
+        --pool->cipherCtxsSize;
+        return(pool->cipherCtxs[pool->cipherCtxsSize]);
+    }
+    return(EVP_CIPHER_CTX_new());
+}
+
+/**
+ * xmlSecOpenSSLEvpCipherCtxRelease:
+ * @cipherCtx:          the EVP_CIPHER_CTX.
+ *
+ * Resets @cipherCtx (this also cleanses the key material) and puts it into
+ * the current thread pool or frees it.
+ */
+void
+xmlSecOpenSSLEvpCipherCtxRelease(EVP_CIPHER_CTX* cipherCtx) {
+    xmlSecOpenSSLEvpCtxPoolPtr pool;
+
+    xmlSecAssert(cipherCtx != NULL);
+
+    pool = xmlSecOpenSSLEvpCtxPoolGet(1);
+    if((pool == NULL) || (pool->cipherCtxsSize >= XMLSEC_OPENSSL_EVP_CTX_POOL_MAX_SIZE) ||
+       (EVP_CIPHER_CTX_reset(cipherCtx) != 1)
+    ) {
+        EVP_CIPHER_CTX_free(cipherCtx);
+        return;
+    }
+    pool->cipherCtxs[pool->cipherCtxsSize++] = cipherCtx;
+}
+
+#ifndef XMLSEC_NO_X509
+/**
+ * xmlSecOpenSSLX509StoreCtxBorrow:
+ *
+ * Gets a clean X509_STORE_CTX from the current thread pool or creates a new one.
+ *
+ * Returns: the X509_STORE_CTX (return it with xmlSecOpenSSLX509StoreCtxRelease())
+ * or NULL if an error occurs.
+ */
+X509_STORE_CTX*
+xmlSecOpenSSLX509StoreCtxBorrow(void) {
+    xmlSecOpenSSLEvpCtxPoolPtr pool;
+
+    pool = xmlSecOpenSSLEvpCtxPoolGet(0);
+    if((pool != NULL) && (pool->storeCtxsSize > 0)) {
+        --pool->storeCtxsSize;
+        return(pool->storeCtxs[pool->storeCtxsSize]);
+    }
+    return(X509_STORE_CTX_new_ex(xmlSecOpenSSLGetLibCtx(), NULL));
+}
+
+/**
+ * xmlSecOpenSSLX509StoreCtxRelease:
+ * @storeCtx:           the X509_STORE_CTX.
+ *
+ * Cleans up @storeCtx (it can be initialized again with X509_STORE_CTX_init())
+ * and puts it into the current thread pool or frees it.
+ */
+void
+xmlSecOpenSSLX509StoreCtxRelease(X509_STORE_CTX* storeCtx) {
+    xmlSecOpenSSLEvpCtxPoolPtr pool;
+
+    xmlSecAssert(storeCtx != NULL);
+
+    pool = xmlSecOpenSSLEvpCtxPoolGet(1);
+    if((pool == NULL) || (pool->storeCtxsSize >= XMLSEC_OPENSSL_EVP_CTX_POOL_MAX_SIZE)) {
+        X509_STORE_CTX_free(storeCtx);
+        return;
+    }
+    X509_STORE_CTX_cleanup(storeCtx);
+    pool->storeCtxs[pool->storeCtxsSize++] = storeCtx;
+}
+#endif /* XMLSEC_NO_X509 */
 #endif /* XMLSEC_OPENSSL_API_300 */
 
 /********************************************************************
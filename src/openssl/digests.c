@@ -26,6 +26,7 @@
 #include <xmlsec/openssl/crypto.h>
 #include <xmlsec/openssl/evp.h>
 #include "openssl_compat.h"
+#include "private.h"
 
 #ifdef XMLSEC_OPENSSL_API_300
 #include <openssl/core_names.h>
@@ -310,7 +311,7 @@ xmlSecOpenSSLEvpDigestInitialize(xmlSecTransformPtr transform) {
 #ifdef XMLSEC_OPENSSL_API_300
     if(ctx->legacyDigest == 0) {
         xmlSecAssert2(ctx->digestName != NULL, -1);
-        ctx->digest = EVP_MD_fetch(xmlSecOpenSSLGetLibCtx(), ctx->digestName, NULL);
+        ctx->digest = xmlSecOpenSSLEvpMdFetch(ctx->digestName);
         if(ctx->digest == NULL) {
             xmlSecOpenSSLError2("EVP_MD_fetch", xmlSecTransformGetName(transform),
                                 "digestName=%s", xmlSecErrorsSafeString(ctx->digestName));
@@ -322,13 +323,16 @@ xmlSecOpenSSLEvpDigestInitialize(xmlSecTransformPtr transform) {
     xmlSecAssert2(ctx->digest != NULL, -1);
 
     /* create digest CTX */
-    ctx->digestCtx = EVP_MD_CTX_new();
+    ctx->digestCtx = xmlSecOpenSSLEvpMdCtxBorrow();
     if(ctx->digestCtx == NULL) {
-        xmlSecOpenSSLError("EVP_MD_CTX_new", xmlSecTransformGetName(transform));
+        xmlSecOpenSSLError("xmlSecOpenSSLEvpMdCtxBorrow", xmlSecTransformGetName(transform));
         xmlSecOpenSSLEvpDigestFinalize(transform);
         return(-1);
     }
 
+    /* the digest only reads the input, no need to copy it */
+    transform->borrowInput = 1;
+
     /* done */
     return(0);
 }
@@ -344,7 +348,7 @@ xmlSecOpenSSLEvpDigestFinalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
     if(ctx->digestCtx != NULL) {
-        EVP_MD_CTX_free(ctx->digestCtx);
+        xmlSecOpenSSLEvpMdCtxRelease(ctx->digestCtx);
     }
 #ifdef XMLSEC_OPENSSL_API_300
     if((ctx->digest != NULL) && (ctx->legacyDigest == 0)) {
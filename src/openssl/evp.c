@@ -39,6 +39,7 @@
 #include <openssl/param_build.h>
 #endif /* XMLSEC_OPENSSL_API_300 */
 
+#include "private.h"
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 
@@ -288,6 +289,50 @@ xmlSecOpenSSLKeyDataGetKeySize(xmlSecKeyDataPtr data) {
     XMLSEC_SAFE_CAST_INT_TO_SIZE(ret, res,  return(0), xmlSecKeyDataGetName(data));
     return(res);
 }
+
+/* returns the key data with the cached public key or NULL if not found */
+static xmlSecKeyDataPtr
+xmlSecOpenSSLKeyDataCreateCached(xmlSecKeyDataId id, const xmlSecByte* pKeyId) {
+    xmlSecKeyDataPtr data;
+    EVP_PKEY* pKey;
+    int ret;
+
+    xmlSecAssert2(id != NULL, NULL);
+    xmlSecAssert2(pKeyId != NULL, NULL);
+
+    pKey = xmlSecOpenSSLPublicKeyFindCached((const char*)xmlSecKeyDataKlassGetName(id), pKeyId);
+    if(pKey == NULL) {
+        return(NULL);
+    }
+
+    data = xmlSecKeyDataCreate(id);
+    if(data == NULL) {
+        xmlSecInternalError("xmlSecKeyDataCreate", xmlSecKeyDataKlassGetName(id));
+        EVP_PKEY_free(pKey);
+        return(NULL);
+    }
+    ret = xmlSecOpenSSLEvpKeyDataAdoptEvp(data, pKey);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLEvpKeyDataAdoptEvp", xmlSecKeyDataKlassGetName(id));
+        EVP_PKEY_free(pKey);
+        xmlSecKeyDataDestroy(data);
+        return(NULL);
+    }
+    return(data);
+}
+
+static void
+xmlSecOpenSSLKeyDataAddCached(xmlSecKeyDataPtr data, const xmlSecByte* pKeyId) {
+    EVP_PKEY* pKey;
+
+    xmlSecAssert(data != NULL);
+    xmlSecAssert(pKeyId != NULL);
+
+    pKey = xmlSecOpenSSLEvpKeyDataGetEvp(data);
+    if(pKey != NULL) {
+        xmlSecOpenSSLPublicKeyAddCached((const char*)xmlSecKeyDataGetName(data), pKeyId, pKey);
+    }
+}
 #endif /* XMLSEC_OPENSSL_API_300 */
 
 /******************************************************************************
@@ -1446,6 +1491,10 @@ xmlSecOpenSSLKeyDataDsaRead(xmlSecKeyDataId id, xmlSecKeyValueDsaPtr dsaValue) {
     xmlSecKeyDataPtr data = NULL;
     xmlSecKeyDataPtr res = NULL;
     xmlSecOpenSSLKeyValueDsa dsaKeyValue;
+#ifdef XMLSEC_OPENSSL_API_300
+    xmlSecByte pKeyId[XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE];
+    int pKeyIdRet = 0;
+#endif /* XMLSEC_OPENSSL_API_300 */
     int ret;
 
     xmlSecAssert2(id == xmlSecOpenSSLKeyDataDsaId, NULL);
@@ -1458,6 +1507,24 @@ xmlSecOpenSSLKeyDataDsaRead(xmlSecKeyDataId id, xmlSecKeyValueDsaPtr dsaValue) {
         goto done;
     }
 
+#ifdef XMLSEC_OPENSSL_API_300
+    /* public keys might be in the cache */
+    if(xmlSecBufferGetSize(&(dsaValue->x)) <= 0) {
+        xmlSecBufferPtr parts[] = { &(dsaValue->p), &(dsaValue->q), &(dsaValue->g), &(dsaValue->y) };
+
+        pKeyIdRet = xmlSecOpenSSLPublicKeyGetId(NULL, parts, sizeof(parts) / sizeof(parts[0]), pKeyId);
+        if(pKeyIdRet < 0) {
+            xmlSecInternalError("xmlSecOpenSSLPublicKeyGetId", xmlSecKeyDataKlassGetName(id));
+            goto done;
+        } else if(pKeyIdRet > 0) {
+            res = xmlSecOpenSSLKeyDataCreateCached(id, pKeyId);
+            if(res != NULL) {
+                goto done;
+            }
+        }
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
+
     /*** p ***/
     ret = xmlSecOpenSSLGetBNValue(&(dsaValue->p), &(dsaKeyValue.p));
     if(ret < 0) {
@@ -1510,6 +1577,11 @@ xmlSecOpenSSLKeyDataDsaRead(xmlSecKeyDataId id, xmlSecKeyValueDsaPtr dsaValue) {
             xmlSecKeyDataKlassGetName(id));
         goto done;
     }
+#ifdef XMLSEC_OPENSSL_API_300
+    if(pKeyIdRet > 0) {
+        xmlSecOpenSSLKeyDataAddCached(data, pKeyId);
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
 
     /* success */
     res = data;
@@ -3271,12 +3343,31 @@ xmlSecKeyDataPtr
 xmlSecOpenSSLKeyDataEcRead(xmlSecKeyDataId id, xmlSecKeyValueEcPtr ecValue) {
     xmlSecKeyDataPtr data = NULL;
     xmlSecKeyDataPtr res = NULL;
+#ifdef XMLSEC_OPENSSL_API_300
+    xmlSecByte pKeyId[XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE];
+    xmlSecBufferPtr parts[] = { &(ecValue->pubkey) };
+    int pKeyIdRet;
+#endif /* XMLSEC_OPENSSL_API_300 */
     int ret;
 
     xmlSecAssert2(id == xmlSecOpenSSLKeyDataEcId, NULL);
     xmlSecAssert2(ecValue != NULL, NULL);
     xmlSecAssert2(ecValue->curve != NULL, NULL);
 
+#ifdef XMLSEC_OPENSSL_API_300
+    /* public keys might be in the cache */
+    pKeyIdRet = xmlSecOpenSSLPublicKeyGetId(ecValue->curve, parts, sizeof(parts) / sizeof(parts[0]), pKeyId);
+    if(pKeyIdRet < 0) {
+        xmlSecInternalError("xmlSecOpenSSLPublicKeyGetId", xmlSecKeyDataKlassGetName(id));
+        goto done;
+    } else if(pKeyIdRet > 0) {
+        res = xmlSecOpenSSLKeyDataCreateCached(id, pKeyId);
+        if(res != NULL) {
+            goto done;
+        }
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
+
     /* create key data */
     data = xmlSecKeyDataCreate(id);
     if(data == NULL) {
@@ -3289,6 +3380,11 @@ xmlSecOpenSSLKeyDataEcRead(xmlSecKeyDataId id, xmlSecKeyValueEcPtr ecValue) {
         xmlSecInternalError("xmlSecOpenSSLKeyDataEcSetValue()", xmlSecKeyDataKlassGetName(id));
         goto done;
     }
+#ifdef XMLSEC_OPENSSL_API_300
+    if(pKeyIdRet > 0) {
+        xmlSecOpenSSLKeyDataAddCached(data, pKeyId);
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
 
     /* success */
     res = data;
@@ -4065,6 +4161,10 @@ xmlSecOpenSSLKeyDataRsaRead(xmlSecKeyDataId id, xmlSecKeyValueRsaPtr rsaValue) {
     xmlSecKeyDataPtr data = NULL;
     xmlSecKeyDataPtr res = NULL;
     xmlSecOpenSSLKeyValueRsa rsaKeyValue;
+#ifdef XMLSEC_OPENSSL_API_300
+    xmlSecByte pKeyId[XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE];
+    int pKeyIdRet = 0;
+#endif /* XMLSEC_OPENSSL_API_300 */
     int ret;
 
     xmlSecAssert2(id == xmlSecOpenSSLKeyDataRsaId, NULL);
@@ -4077,6 +4177,24 @@ xmlSecOpenSSLKeyDataRsaRead(xmlSecKeyDataId id, xmlSecKeyValueRsaPtr rsaValue) {
         goto done;
     }
 
+#ifdef XMLSEC_OPENSSL_API_300
+    /* public keys might be in the cache */
+    if(xmlSecBufferGetSize(&(rsaValue->privateExponent)) <= 0) {
+        xmlSecBufferPtr parts[] = { &(rsaValue->modulus), &(rsaValue->publicExponent) };
+
+        pKeyIdRet = xmlSecOpenSSLPublicKeyGetId(NULL, parts, sizeof(parts) / sizeof(parts[0]), pKeyId);
+        if(pKeyIdRet < 0) {
+            xmlSecInternalError("xmlSecOpenSSLPublicKeyGetId", xmlSecKeyDataKlassGetName(id));
+            goto done;
+        } else if(pKeyIdRet > 0) {
+            res = xmlSecOpenSSLKeyDataCreateCached(id, pKeyId);
+            if(res != NULL) {
+                goto done;
+            }
+        }
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
+
     /*** Modulus ***/
     ret = xmlSecOpenSSLGetBNValue(&(rsaValue->modulus), &(rsaKeyValue.n));
     if(ret < 0) {
@@ -4115,6 +4233,11 @@ xmlSecOpenSSLKeyDataRsaRead(xmlSecKeyDataId id, xmlSecKeyValueRsaPtr rsaValue) {
             xmlSecKeyDataKlassGetName(id));
         goto done;
     }
+#ifdef XMLSEC_OPENSSL_API_300
+    if(pKeyIdRet > 0) {
+        xmlSecOpenSSLKeyDataAddCached(data, pKeyId);
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
 
     /* success */
     res = data;
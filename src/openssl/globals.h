@@ -21,6 +21,15 @@
 #define IN_XMLSEC_CRYPTO
 #define XMLSEC_PRIVATE
 
+/* Thread local variables (not defined if the compiler does not support them). */
+#if defined(_MSC_VER)
+#define XMLSEC_THREAD_LOCAL                     __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define XMLSEC_THREAD_LOCAL                     __thread
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_THREADS__)
+#define XMLSEC_THREAD_LOCAL                     _Thread_local
+#endif
+
 /* Include common error helper macros. */
 #include "../errors_helpers.h"
 
@@ -42,7 +51,11 @@
     {                                                       \
         char _openssl_error_buf[XMLSEC_OPENSSL_ERROR_BUFFER_SIZE]; \
         unsigned long _openssl_error_code = ERR_peek_last_error(); \
-        ERR_error_string_n(_openssl_error_code, _openssl_error_buf, sizeof(_openssl_error_buf)); \
+        if(xmlSecErrorsDeferredIsEnabled() == 0) {                  \
+            ERR_error_string_n(_openssl_error_code, _openssl_error_buf, sizeof(_openssl_error_buf)); \
+        } else {                                                    \
+            _openssl_error_buf[0] = '\0';                          \
+        }                                                           \
         xmlSecError(XMLSEC_ERRORS_HERE,                     \
                     (const char*)(errorObject),             \
                     (errorFunction),                        \
@@ -65,7 +78,11 @@
 #define xmlSecOpenSSLError2(errorFunction, errorObject, msg, param) \
         char _openssl_error_buf[XMLSEC_OPENSSL_ERROR_BUFFER_SIZE];  \
         unsigned long _openssl_error_code = ERR_peek_last_error();  \
-        ERR_error_string_n(_openssl_error_code, _openssl_error_buf, sizeof(_openssl_error_buf)); \
+        if(xmlSecErrorsDeferredIsEnabled() == 0) {                  \
+            ERR_error_string_n(_openssl_error_code, _openssl_error_buf, sizeof(_openssl_error_buf)); \
+        } else {                                                    \
+            _openssl_error_buf[0] = '\0';                          \
+        }                                                           \
         xmlSecError(XMLSEC_ERRORS_HERE,                     \
                     (const char*)(errorObject),             \
                     (errorFunction),                        \
@@ -88,7 +105,11 @@
 #define xmlSecOpenSSLError3(errorFunction, errorObject, msg, param1, param2) \
         char _openssl_error_buf[XMLSEC_OPENSSL_ERROR_BUFFER_SIZE];  \
         unsigned long _openssl_error_code = ERR_peek_last_error();  \
-        ERR_error_string_n(_openssl_error_code, _openssl_error_buf, sizeof(_openssl_error_buf)); \
+        if(xmlSecErrorsDeferredIsEnabled() == 0) {                  \
+            ERR_error_string_n(_openssl_error_code, _openssl_error_buf, sizeof(_openssl_error_buf)); \
+        } else {                                                    \
+            _openssl_error_buf[0] = '\0';                          \
+        }                                                           \
         xmlSecError(XMLSEC_ERRORS_HERE,                     \
                     (const char*)(errorObject),             \
                     (errorFunction),                        \
@@ -38,6 +38,7 @@
 #include <openssl/param_build.h>
 #endif /* XMLSEC_OPENSSL_API_300 */
 
+#include "private.h"
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 #include "../transform_helpers.h"
@@ -235,19 +236,6 @@ xmlSecOpenSSLHmacInitialize(xmlSecTransformPtr transform) {
         xmlSecOpenSSLHmacFinalize(transform);
         return(-1);
     }
-#else /* XMLSEC_OPENSSL_API_300 */
-    ctx->evpHmac = EVP_MAC_fetch(xmlSecOpenSSLGetLibCtx(), OSSL_MAC_NAME_HMAC, NULL);
-    if (ctx->evpHmac == NULL) {
-        xmlSecOpenSSLError("EVP_MAC_fetch", xmlSecTransformGetName(transform));
-        xmlSecOpenSSLHmacFinalize(transform);
-        return(-1);
-    }
-    ctx->evpHmacCtx = EVP_MAC_CTX_new(ctx->evpHmac);
-    if (ctx->evpHmacCtx == NULL) {
-        xmlSecOpenSSLError("EVP_MAC_CTX_new", xmlSecTransformGetName(transform));
-        xmlSecOpenSSLHmacFinalize(transform);
-        return(-1);
-    }
 #endif /* XMLSEC_OPENSSL_API_300 */
 
     /* done */
@@ -348,18 +336,34 @@ xmlSecOpenSSLHmacSetKeyImpl(xmlSecOpenSSLHmacCtxPtr ctx, const xmlSecByte* key,
 
 #else /* XMLSEC_OPENSSL_API_300 */
 
-static int
-xmlSecOpenSSLHmacSetKeyImpl(xmlSecOpenSSLHmacCtxPtr ctx, const xmlSecByte* key, xmlSecSize keySize) {
+/* creates the keyed EVP_MAC_CTX, the result might be cached (see xmlSecOpenSSLMacCtxNewCached) */
+static EVP_MAC_CTX*
+xmlSecOpenSSLHmacCreateMacCtx(const xmlSecByte* key, xmlSecSize keySize, void* data) {
+    xmlSecOpenSSLHmacCtxPtr ctx = (xmlSecOpenSSLHmacCtxPtr)data;
     OSSL_PARAM_BLD* param_bld = NULL;
     OSSL_PARAM* params = NULL;
+    EVP_MAC_CTX* macCtx = NULL;
+    EVP_MAC_CTX* res = NULL;
     int ret;
-    int res = -1;
 
-    xmlSecAssert2(ctx != NULL, -1);
-    xmlSecAssert2(ctx->evpHmacCtx != NULL, -1);
-    xmlSecAssert2(ctx->evpHmacDgstName != NULL, -1);
-    xmlSecAssert2(key != NULL, -1);
-    xmlSecAssert2(keySize > 0, -1);
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->evpHmacDgstName != NULL, NULL);
+    xmlSecAssert2(key != NULL, NULL);
+    xmlSecAssert2(keySize > 0, NULL);
+
+    if(ctx->evpHmac == NULL) {
+        ctx->evpHmac = EVP_MAC_fetch(xmlSecOpenSSLGetThreadLibCtx(), OSSL_MAC_NAME_HMAC,
+            xmlSecOpenSSLGetPropQuery(OSSL_MAC_NAME_HMAC));
+        if (ctx->evpHmac == NULL) {
+            xmlSecOpenSSLError("EVP_MAC_fetch", NULL);
+            goto done;
+        }
+    }
+    macCtx = EVP_MAC_CTX_new(ctx->evpHmac);
+    if (macCtx == NULL) {
+        xmlSecOpenSSLError("EVP_MAC_CTX_new", NULL);
+        goto done;
+    }
 
     param_bld = OSSL_PARAM_BLD_new();
     if (param_bld == NULL) {
@@ -380,16 +384,20 @@ xmlSecOpenSSLHmacSetKeyImpl(xmlSecOpenSSLHmacCtxPtr ctx, const xmlSecByte* key,
         goto done;
     }
 
-    ret = EVP_MAC_init(ctx->evpHmacCtx, key, keySize, params);
+    ret = EVP_MAC_init(macCtx, key, keySize, params);
     if (ret != 1) {
         xmlSecOpenSSLError("EVP_MAC_init", NULL);
         goto done;
     }
 
     /* success */
-    res = 0;
+    res = macCtx;
+    macCtx = NULL;
 
 done:
+    if(macCtx != NULL) {
+        EVP_MAC_CTX_free(macCtx);
+    }
     if(params != NULL) {
         OSSL_PARAM_free(params);
     }
@@ -397,7 +405,25 @@ done:
         OSSL_PARAM_BLD_free(param_bld);
     }
     return(res);
+}
 
+static int
+xmlSecOpenSSLHmacSetKeyImpl(xmlSecOpenSSLHmacCtxPtr ctx, const xmlSecByte* key, xmlSecSize keySize) {
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->evpHmacCtx == NULL, -1);
+    xmlSecAssert2(ctx->evpHmacDgstName != NULL, -1);
+    xmlSecAssert2(key != NULL, -1);
+    xmlSecAssert2(keySize > 0, -1);
+
+    ctx->evpHmacCtx = xmlSecOpenSSLMacCtxNewCached(ctx->evpHmacDgstName, key, keySize,
+        xmlSecOpenSSLHmacCreateMacCtx, ctx);
+    if(ctx->evpHmacCtx == NULL) {
+        xmlSecInternalError("xmlSecOpenSSLMacCtxNewCached", NULL);
+        return(-1);
+    }
+
+    /* success */
+    return(0);
 }
 
 #endif /* XMLSEC_OPENSSL_API_300 */
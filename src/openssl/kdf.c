@@ -70,6 +70,11 @@ struct _xmlSecOpenSSLKdfCtx {
 
     xmlSecBuffer buffer;
     unsigned int param1;
+
+    /* derived keys cache */
+    xmlSecBuffer cacheId;
+    const xmlSecByte * keyData;
+    xmlSecSize keySize;
 };
 XMLSEC_TRANSFORM_DECLARE(OpenSSLKdf, xmlSecOpenSSLKdfCtx)
 #define xmlSecOpenSSLKdfCtxSize XMLSEC_TRANSFORM_SIZE(OpenSSLKdf)
@@ -145,7 +150,7 @@ xmlSecOpenSSLKdfInitialize(xmlSecTransformPtr transform) {
 
     /* create EVP KDF context */
     xmlSecAssert2(ctx->kdfName != NULL, -1);
-    kdf = EVP_KDF_fetch(NULL, ctx->kdfName, NULL);
+    kdf = EVP_KDF_fetch(xmlSecOpenSSLGetThreadLibCtx(), ctx->kdfName, xmlSecOpenSSLGetPropQuery(ctx->kdfName));
     if(kdf == NULL) {
         xmlSecOpenSSLError2("EVP_KDF_fetch", NULL, "kdf=%s", xmlSecErrorsSafeString(ctx->kdfName));
         xmlSecOpenSSLKdfFinalize(transform);
@@ -168,6 +173,12 @@ xmlSecOpenSSLKdfInitialize(xmlSecTransformPtr transform) {
         xmlSecOpenSSLKdfFinalize(transform);
         return(-1);
     }
+    ret = xmlSecBufferInitialize(&(ctx->cacheId), XMLSEC_OPENSSL_KDF_DEFAULT_BUF_SIZE);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize(cacheId)", NULL);
+        xmlSecOpenSSLKdfFinalize(transform);
+        return(-1);
+    }
 
     /* done */
     return(0);
@@ -196,6 +207,7 @@ xmlSecOpenSSLKdfFinalize(xmlSecTransformPtr transform) {
     }
 
     xmlSecBufferFinalize(&(ctx->buffer));
+    xmlSecBufferFinalize(&(ctx->cacheId));
 
     memset(ctx, 0, sizeof(xmlSecOpenSSLKdfCtx));
 }
@@ -257,6 +269,8 @@ xmlSecOpenSSLKdfSetKey(xmlSecTransformPtr transform, xmlSecKeyPtr key) {
         return(-1);
     }
     ctx->params[ctx->paramsPos++] = OSSL_PARAM_construct_octet_string(ctx->keyParamName, keyData, keySize);
+    ctx->keyData = keyData;
+    ctx->keySize = keySize;
 
     /* done with params! */
     if(ctx->paramsPos >= XMLSEC_OPENSSL_KDF_MAX_PARAMS) {
@@ -317,6 +331,16 @@ xmlSecOpenSSLKdfExecute(xmlSecTransformPtr transform, int last, xmlSecTransformC
         }
         outData = xmlSecBufferGetData(out);
         xmlSecAssert2(outData != NULL, -1);
+        xmlSecAssert2(ctx->keyData != NULL, -1);
+
+        ret = xmlSecTransformKdfCacheFind(transform, &(ctx->cacheId), ctx->keyData, ctx->keySize, out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheFind", xmlSecTransformGetName(transform));
+            return(-1);
+        } else if(ret > 0) {
+            transform->status = xmlSecTransformStatusFinished;
+            return(0);
+        }
 
         ret = EVP_KDF_derive(ctx->kctx, outData, transform->expectedOutputSize, ctx->params);
         if(ret <= 0) {
@@ -324,6 +348,12 @@ xmlSecOpenSSLKdfExecute(xmlSecTransformPtr transform, int last, xmlSecTransformC
             return(-1);
         }
 
+        ret = xmlSecTransformKdfCacheAdd(transform, &(ctx->cacheId), ctx->keyData, ctx->keySize, out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKdfCacheAdd", xmlSecTransformGetName(transform));
+            return(-1);
+        }
+
         transform->status = xmlSecTransformStatusFinished;
         return(0);
     } else if(transform->status == xmlSecTransformStatusFinished) {
@@ -486,6 +516,12 @@ xmlSecOpenSSLConcatKdfNodeRead(xmlSecTransformPtr transform, xmlNodePtr node,
         goto done;
     }
 
+    ret = xmlSecTransformConcatKdfParamsGetCacheId(&params, &(ctx->cacheId));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformConcatKdfParamsGetCacheId", xmlSecTransformGetName(transform));
+        goto done;
+    }
+
     /* set fixedinfo from params and save in the context, params just holds a pointer  */
     ret = xmlSecTransformConcatKdfParamsGetFixedInfo(&params, &(ctx->buffer));
     if(ret < 0) {
@@ -680,6 +716,11 @@ xmlSecOpenSSLPbkdf2NodeRead(xmlSecTransformPtr transform, xmlNodePtr node,
         xmlSecInternalError("xmlSecTransformPbkdf2ParamsRead", NULL);
        goto done;
     }
+    ret = xmlSecTransformPbkdf2ParamsGetCacheId(&params, &(ctx->cacheId));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformPbkdf2ParamsGetCacheId", xmlSecTransformGetName(transform));
+        goto done;
+    }
 
     /* if we have something else then it's an error */
     cur = xmlSecGetNextElementNode(cur->next);
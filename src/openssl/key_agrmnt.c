@@ -21,6 +21,8 @@
 #include <string.h>
 #include <ctype.h>
 
+#include <openssl/x509.h>
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/base64.h>
 #include <xmlsec/keys.h>
@@ -32,12 +34,93 @@
 #include <xmlsec/openssl/crypto.h>
 #include <xmlsec/openssl/evp.h>
 #include "openssl_compat.h"
+#include "private.h"
 
 #include "../cast_helpers.h"
 #include "../keysdata_helpers.h"
 #include "../transform_helpers.h"
 
 
+#if !defined(XMLSEC_NO_EC) || !defined(XMLSEC_NO_DH)
+
+static int
+xmlSecOpenSSLKeyAgreementAppendPubKey(EVP_PKEY* pKey, xmlSecBufferPtr keysId) {
+    unsigned char* der = NULL;
+    xmlSecSize derSize;
+    int derLen;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(pKey != NULL, -1);
+    xmlSecAssert2(keysId != NULL, -1);
+
+    derLen = i2d_PUBKEY(pKey, &der);
+    if((derLen <= 0) || (der == NULL)) {
+        xmlSecOpenSSLError("i2d_PUBKEY", NULL);
+        goto done;
+    }
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(derLen, derSize, goto done, NULL);
+
+    /* the size prefix keeps the originator / recipient keys boundary unambiguous */
+    ret = xmlSecBufferAppend(keysId, (const xmlSecByte*)&derSize, sizeof(derSize));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        goto done;
+    }
+    ret = xmlSecBufferAppend(keysId, der, derSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferAppend", NULL,
+            "size=" XMLSEC_SIZE_FMT, derSize);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(der != NULL) {
+        OPENSSL_free(der);
+    }
+    return(res);
+}
+
+/* the shared secrets cache id: the originator and the recipient public keys */
+static int
+xmlSecOpenSSLKeyAgreementGetCacheId(EVP_PKEY* myPrivKey, EVP_PKEY* otherPubKey,
+                                    xmlSecTransformOperation operation, xmlSecBufferPtr keysId) {
+    EVP_PKEY* originatorKey;
+    EVP_PKEY* recipientKey;
+    int ret;
+
+    xmlSecAssert2(myPrivKey != NULL, -1);
+    xmlSecAssert2(otherPubKey != NULL, -1);
+    xmlSecAssert2(keysId != NULL, -1);
+
+    if(operation == xmlSecTransformOperationEncrypt) {
+        originatorKey = myPrivKey;
+        recipientKey = otherPubKey;
+    } else {
+        originatorKey = otherPubKey;
+        recipientKey = myPrivKey;
+    }
+
+    xmlSecBufferEmpty(keysId);
+    ret = xmlSecOpenSSLKeyAgreementAppendPubKey(originatorKey, keysId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLKeyAgreementAppendPubKey(originator)", NULL);
+        return(-1);
+    }
+    ret = xmlSecOpenSSLKeyAgreementAppendPubKey(recipientKey, keysId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLKeyAgreementAppendPubKey(recipient)", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+#endif /* !defined(XMLSEC_NO_EC) || !defined(XMLSEC_NO_DH) */
+
+
 #ifndef XMLSEC_NO_EC
 
 /**************************************************************************
@@ -205,8 +288,12 @@ xmlSecOpenSSLEcdhNodeWrite(xmlSecTransformPtr transform, xmlNodePtr node, xmlSec
 
 /* https://wiki.openssl.org/index.php/Elliptic_Curve_Diffie_Hellman */
 static int
-xmlSecOpenSSLEcdhGenerateSecret(xmlSecOpenSSLEcdhCtxPtr ctx, xmlSecTransformOperation operation, xmlSecBufferPtr secret) {
+xmlSecOpenSSLEcdhGenerateSecret(xmlSecTransformPtr transform, xmlSecOpenSSLEcdhCtxPtr ctx,
+                            xmlSecTransformOperation operation, xmlSecBufferPtr secret) {
     EVP_PKEY_CTX *pKeyCtx = NULL;
+    xmlSecBuffer keysId;
+    int keysIdInitialized = 0;
+    int useCache = 0;
     xmlSecKeyDataPtr myKeyValue, otherKeyValue;
     EVP_PKEY *myPrivKey;
     EVP_PKEY *otherPubKey;
@@ -216,6 +303,7 @@ xmlSecOpenSSLEcdhGenerateSecret(xmlSecOpenSSLEcdhCtxPtr ctx, xmlSecTransformOper
     int ret;
     int res = -1;
 
+    xmlSecAssert2(transform != NULL, -1);
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(ctx->params.keyRecipient != NULL, -1);
     xmlSecAssert2(ctx->params.keyOriginator != NULL, -1);
@@ -261,12 +349,45 @@ xmlSecOpenSSLEcdhGenerateSecret(xmlSecOpenSSLEcdhCtxPtr ctx, xmlSecTransformOper
         goto done;
     }
 
+    /* check the shared secrets cache first */
+    if(xmlSecTransformKeyAgreementCacheIsEnabled() != 0) {
+        ret = xmlSecBufferInitialize(&keysId, 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize", xmlSecTransformGetName(transform));
+            goto done;
+        }
+        keysIdInitialized = 1;
+
+        ret = xmlSecOpenSSLKeyAgreementGetCacheId(myPrivKey, otherPubKey, operation, &keysId);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLKeyAgreementGetCacheId", xmlSecTransformGetName(transform));
+            goto done;
+        }
+        ret = xmlSecTransformKeyAgreementCacheFind(transform, &keysId, secret);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKeyAgreementCacheFind", xmlSecTransformGetName(transform));
+            goto done;
+        } else if(ret > 0) {
+            res = 0;
+            goto done;
+        }
+        useCache = 1;
+    }
+
     /* create and init ctx */
+#ifndef XMLSEC_OPENSSL_API_300
     pKeyCtx = EVP_PKEY_CTX_new(myPrivKey, NULL);
     if(pKeyCtx == NULL) {
         xmlSecOpenSSLError("EVP_PKEY_CTX_new", NULL);
         goto done;
     }
+#else  /* XMLSEC_OPENSSL_API_300 */
+    pKeyCtx = xmlSecOpenSSLPKeyCtxNew(myPrivKey);
+    if(pKeyCtx == NULL) {
+        xmlSecOpenSSLError("xmlSecOpenSSLPKeyCtxNew", NULL);
+        goto done;
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
     ret = EVP_PKEY_derive_init(pKeyCtx);
     if(ret != 1) {
         xmlSecOpenSSLError("EVP_PKEY_CTX_new", NULL);
@@ -302,6 +423,14 @@ xmlSecOpenSSLEcdhGenerateSecret(xmlSecOpenSSLEcdhCtxPtr ctx, xmlSecTransformOper
         goto done;
     }
 
+    if(useCache != 0) {
+        ret = xmlSecTransformKeyAgreementCacheAdd(transform, &keysId, secret);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKeyAgreementCacheAdd", xmlSecTransformGetName(transform));
+            goto done;
+        }
+    }
+
     /* success */
     res = 0;
 
@@ -309,6 +438,9 @@ done:
     if(pKeyCtx != NULL) {
         EVP_PKEY_CTX_free(pKeyCtx);
     }
+    if(keysIdInitialized != 0) {
+        xmlSecBufferFinalize(&keysId);
+    }
 
     return(res);
 }
@@ -423,14 +555,15 @@ xmlSecOpenSSLEcdhExecute(xmlSecTransformPtr transform, int last, xmlSecTransform
     } else if((transform->status == xmlSecTransformStatusWorking) && (last != 0)) {
         xmlSecBuffer secret;
 
-        ret = xmlSecBufferInitialize(&secret, 128);
+        ret = xmlSecBufferInitialize(&secret, 0);
         if(ret < 0) {
             xmlSecInternalError("xmlSecBufferInitialize", xmlSecTransformGetName(transform));
             return(-1);
         }
+        xmlSecBufferSetZeroMode(&secret, xmlSecBufferZeroModeSecure);
 
         /* step 1: generate secret with ecdh */
-        ret = xmlSecOpenSSLEcdhGenerateSecret(ctx, transform->operation, &secret);
+        ret = xmlSecOpenSSLEcdhGenerateSecret(transform, ctx, transform->operation, &secret);
         if(ret < 0) {
             xmlSecInternalError("xmlSecBufferInitialize", xmlSecTransformGetName(transform));
             xmlSecBufferFinalize(&secret);
@@ -675,8 +808,12 @@ xmlSecOpenSSLDhNodeWrite(xmlSecTransformPtr transform, xmlNodePtr node, xmlSecTr
 
 /* https://wiki.openssl.org/index.php/Elliptic_Curve_Diffie_Hellman */
 static int
-xmlSecOpenSSLDhGenerateSecret(xmlSecOpenSSLDhCtxPtr ctx, xmlSecTransformOperation operation, xmlSecBufferPtr secret) {
+xmlSecOpenSSLDhGenerateSecret(xmlSecTransformPtr transform, xmlSecOpenSSLDhCtxPtr ctx,
+                          xmlSecTransformOperation operation, xmlSecBufferPtr secret) {
     EVP_PKEY_CTX *pKeyCtx = NULL;
+    xmlSecBuffer keysId;
+    int keysIdInitialized = 0;
+    int useCache = 0;
     xmlSecKeyDataPtr myKeyValue, otherKeyValue;
     EVP_PKEY *myPrivKey;
     EVP_PKEY *otherPubKey;
@@ -686,6 +823,7 @@ xmlSecOpenSSLDhGenerateSecret(xmlSecOpenSSLDhCtxPtr ctx, xmlSecTransformOperatio
     int ret;
     int res = -1;
 
+    xmlSecAssert2(transform != NULL, -1);
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(ctx->params.keyRecipient != NULL, -1);
     xmlSecAssert2(ctx->params.keyOriginator != NULL, -1);
@@ -731,12 +869,45 @@ xmlSecOpenSSLDhGenerateSecret(xmlSecOpenSSLDhCtxPtr ctx, xmlSecTransformOperatio
         goto done;
     }
 
+    /* check the shared secrets cache first */
+    if(xmlSecTransformKeyAgreementCacheIsEnabled() != 0) {
+        ret = xmlSecBufferInitialize(&keysId, 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize", xmlSecTransformGetName(transform));
+            goto done;
+        }
+        keysIdInitialized = 1;
+
+        ret = xmlSecOpenSSLKeyAgreementGetCacheId(myPrivKey, otherPubKey, operation, &keysId);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLKeyAgreementGetCacheId", xmlSecTransformGetName(transform));
+            goto done;
+        }
+        ret = xmlSecTransformKeyAgreementCacheFind(transform, &keysId, secret);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKeyAgreementCacheFind", xmlSecTransformGetName(transform));
+            goto done;
+        } else if(ret > 0) {
+            res = 0;
+            goto done;
+        }
+        useCache = 1;
+    }
+
     /* create and init ctx */
+#ifndef XMLSEC_OPENSSL_API_300
     pKeyCtx = EVP_PKEY_CTX_new(myPrivKey, NULL);
     if(pKeyCtx == NULL) {
         xmlSecOpenSSLError("EVP_PKEY_CTX_new", NULL);
         goto done;
     }
+#else  /* XMLSEC_OPENSSL_API_300 */
+    pKeyCtx = xmlSecOpenSSLPKeyCtxNew(myPrivKey);
+    if(pKeyCtx == NULL) {
+        xmlSecOpenSSLError("xmlSecOpenSSLPKeyCtxNew", NULL);
+        goto done;
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
     ret = EVP_PKEY_derive_init(pKeyCtx);
     if(ret != 1) {
         xmlSecOpenSSLError("EVP_PKEY_CTX_new", NULL);
@@ -772,6 +943,14 @@ xmlSecOpenSSLDhGenerateSecret(xmlSecOpenSSLDhCtxPtr ctx, xmlSecTransformOperatio
         goto done;
     }
 
+    if(useCache != 0) {
+        ret = xmlSecTransformKeyAgreementCacheAdd(transform, &keysId, secret);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformKeyAgreementCacheAdd", xmlSecTransformGetName(transform));
+            goto done;
+        }
+    }
+
     /* success */
     res = 0;
 
@@ -779,6 +958,9 @@ done:
     if(pKeyCtx != NULL) {
         EVP_PKEY_CTX_free(pKeyCtx);
     }
+    if(keysIdInitialized != 0) {
+        xmlSecBufferFinalize(&keysId);
+    }
 
     return(res);
 }
@@ -893,14 +1075,15 @@ xmlSecOpenSSLDhExecute(xmlSecTransformPtr transform, int last, xmlSecTransformCt
     } else if((transform->status == xmlSecTransformStatusWorking) && (last != 0)) {
         xmlSecBuffer secret;
 
-        ret = xmlSecBufferInitialize(&secret, 128);
+        ret = xmlSecBufferInitialize(&secret, 0);
         if(ret < 0) {
             xmlSecInternalError("xmlSecBufferInitialize", xmlSecTransformGetName(transform));
             return(-1);
         }
+        xmlSecBufferSetZeroMode(&secret, xmlSecBufferZeroModeSecure);
 
         /* step 1: generate secret with dh */
-        ret = xmlSecOpenSSLDhGenerateSecret(ctx, transform->operation, &secret);
+        ret = xmlSecOpenSSLDhGenerateSecret(transform, ctx, transform->operation, &secret);
         if(ret < 0) {
             xmlSecInternalError("xmlSecBufferInitialize", xmlSecTransformGetName(transform));
             xmlSecBufferFinalize(&secret);
@@ -37,10 +37,24 @@
  *
  * OpenSSL Keys Store. Uses Simple Keys Store under the hood
  *
- * xmlSecKeyStore +  xmlSecKeyStorePtr(Simple Keys Store ptr)
+ * xmlSecKeyStore + xmlSecOpenSSLKeysStoreCtx
+ *
+ * The keys are looked up by X509 data using the index of the keys certs
+ * (subject, issuer and serial number, SKI and digest). The keys are indexed
+ * when they are added to the store (or on the next lookup if the simple
+ * keys store was changed directly), thus the key cert should be set before
+ * the key is added to the store.
  *
  ***************************************************************************/
-XMLSEC_KEY_STORE_DECLARE(OpenSSLKeysStore, xmlSecKeyStorePtr)
+typedef struct _xmlSecOpenSSLKeysStoreCtx {
+    xmlSecKeyStorePtr                   simplekeystore;
+#ifndef XMLSEC_NO_X509
+    xmlSecOpenSSLX509CertsIndex         certsIndex;
+    xmlSecSize                          indexedSize;    /* number of the indexed keys */
+#endif /* XMLSEC_NO_X509 */
+} xmlSecOpenSSLKeysStoreCtx, *xmlSecOpenSSLKeysStoreCtxPtr;
+
+XMLSEC_KEY_STORE_DECLARE(OpenSSLKeysStore, xmlSecOpenSSLKeysStoreCtx)
 #define xmlSecOpenSSLKeysStoreSize XMLSEC_KEY_STORE_SIZE(OpenSSLKeysStore)
 
 static int                      xmlSecOpenSSLKeysStoreInitialize    (xmlSecKeyStorePtr store);
@@ -84,15 +98,20 @@ xmlSecOpenSSLKeysStoreGetKlass(void) {
 
 static int
 xmlSecOpenSSLKeysStoreInitialize(xmlSecKeyStorePtr store) {
-    xmlSecKeyStorePtr *simplekeystore;
+    xmlSecOpenSSLKeysStoreCtxPtr ctx;
 
     xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecOpenSSLKeysStoreId), -1);
 
-    simplekeystore = xmlSecOpenSSLKeysStoreGetCtx(store);
-    xmlSecAssert2(((simplekeystore == NULL) || (*simplekeystore == NULL)), -1);
+    ctx = xmlSecOpenSSLKeysStoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
 
-    *simplekeystore = xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId);
-    if(*simplekeystore == NULL) {
+    memset(ctx, 0, sizeof(xmlSecOpenSSLKeysStoreCtx));
+#ifndef XMLSEC_NO_X509
+    xmlSecOpenSSLX509CertsIndexInitialize(&(ctx->certsIndex));
+#endif /* XMLSEC_NO_X509 */
+
+    ctx->simplekeystore = xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId);
+    if(ctx->simplekeystore == NULL) {
         xmlSecInternalError("xmlSecKeyStoreCreate(xmlSecSimpleKeysStoreId)",
             xmlSecKeyStoreGetName(store));
         return(-1);
@@ -103,53 +122,118 @@ xmlSecOpenSSLKeysStoreInitialize(xmlSecKeyStorePtr store) {
 
 static void
 xmlSecOpenSSLKeysStoreFinalize(xmlSecKeyStorePtr store) {
-    xmlSecKeyStorePtr *simplekeystore;
+    xmlSecOpenSSLKeysStoreCtxPtr ctx;
 
     xmlSecAssert(xmlSecKeyStoreCheckId(store, xmlSecOpenSSLKeysStoreId));
 
-    simplekeystore = xmlSecOpenSSLKeysStoreGetCtx(store);
-    xmlSecAssert((simplekeystore != NULL) && (*simplekeystore != NULL));
+    ctx = xmlSecOpenSSLKeysStoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
 
-    xmlSecKeyStoreDestroy(*simplekeystore);
+    if(ctx->simplekeystore != NULL) {
+        xmlSecKeyStoreDestroy(ctx->simplekeystore);
+    }
+#ifndef XMLSEC_NO_X509
+    xmlSecOpenSSLX509CertsIndexFinalize(&(ctx->certsIndex));
+#endif /* XMLSEC_NO_X509 */
+    memset(ctx, 0, sizeof(xmlSecOpenSSLKeysStoreCtx));
 }
 
 static xmlSecKeyPtr
 xmlSecOpenSSLKeysStoreFindKey(xmlSecKeyStorePtr store, const xmlChar* name,
                           xmlSecKeyInfoCtxPtr keyInfoCtx) {
-    xmlSecKeyStorePtr* simplekeystore;
+    xmlSecOpenSSLKeysStoreCtxPtr ctx;
 
     xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecOpenSSLKeysStoreId), NULL);
     xmlSecAssert2(keyInfoCtx != NULL, NULL);
 
-    simplekeystore = xmlSecOpenSSLKeysStoreGetCtx(store);
-    xmlSecAssert2(((simplekeystore != NULL) && (*simplekeystore != NULL)), NULL);
+    ctx = xmlSecOpenSSLKeysStoreGetCtx(store);
+    xmlSecAssert2(((ctx != NULL) && (ctx->simplekeystore != NULL)), NULL);
+
+    return(xmlSecKeyStoreFindKey(ctx->simplekeystore, name, keyInfoCtx));
+}
+
+#ifndef XMLSEC_NO_X509
+/* indexes the key certs for the keys added since the last update */
+static int
+xmlSecOpenSSLKeysStoreIndexUpdate(xmlSecOpenSSLKeysStoreCtxPtr ctx) {
+    xmlSecPtrListPtr keysList;
+    xmlSecKeyPtr key;
+    xmlSecKeyDataPtr keyData;
+    X509* keyCert;
+    xmlSecSize size;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->simplekeystore != NULL, -1);
+
+    keysList = xmlSecSimpleKeysStoreGetKeys(ctx->simplekeystore);
+    if(keysList == NULL) {
+        xmlSecInternalError("xmlSecSimpleKeysStoreGetKeys", NULL);
+        return(-1);
+    }
 
-    return(xmlSecKeyStoreFindKey(*simplekeystore, name, keyInfoCtx));
+    size = xmlSecPtrListGetSize(keysList);
+    if(size < ctx->indexedSize) {
+        /* the keys list was changed directly, re-index everything */
+        xmlSecOpenSSLX509CertsIndexFinalize(&(ctx->certsIndex));
+        ctx->indexedSize = 0;
+    }
+    for(; ctx->indexedSize < size; ++ctx->indexedSize) {
+        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(keysList, ctx->indexedSize);
+        if(key == NULL) {
+            continue;
+        }
+        keyData = xmlSecKeyGetData(key, xmlSecOpenSSLKeyDataX509Id);
+        if(keyData == NULL) {
+            continue;
+        }
+        keyCert = xmlSecOpenSSLKeyDataX509GetKeyCert(keyData);
+        if(keyCert == NULL) {
+            continue;
+        }
+
+        ret = xmlSecOpenSSLX509CertsIndexAdd(&(ctx->certsIndex), keyCert, ctx->indexedSize);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CertsIndexAdd", NULL);
+            xmlSecOpenSSLX509CertsIndexFinalize(&(ctx->certsIndex));
+            ctx->indexedSize = 0;
+            return(-1);
+        }
+    }
+    return(0);
 }
+#endif /* XMLSEC_NO_X509 */
 
 static xmlSecKeyPtr
 xmlSecOpenSSLKeysStoreFindKeyFromX509Data(xmlSecKeyStorePtr store, xmlSecKeyX509DataValuePtr x509Data,
     xmlSecKeyInfoCtxPtr keyInfoCtx
 ) {
 #ifndef XMLSEC_NO_X509
-    xmlSecKeyStorePtr* simplekeystore;
+    xmlSecOpenSSLKeysStoreCtxPtr ctx;
     xmlSecPtrListPtr keysList;
     xmlSecKeyPtr key, res;
+    int ret;
 
     xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecOpenSSLKeysStoreId), NULL);
     xmlSecAssert2(x509Data != NULL, NULL);
     xmlSecAssert2(keyInfoCtx != NULL, NULL);
 
-    simplekeystore = xmlSecOpenSSLKeysStoreGetCtx(store);
-    xmlSecAssert2(((simplekeystore != NULL) && (*simplekeystore != NULL)), NULL);
+    ctx = xmlSecOpenSSLKeysStoreGetCtx(store);
+    xmlSecAssert2(((ctx != NULL) && (ctx->simplekeystore != NULL)), NULL);
 
-    keysList = xmlSecSimpleKeysStoreGetKeys(*simplekeystore);
+    keysList = xmlSecSimpleKeysStoreGetKeys(ctx->simplekeystore);
     if(keysList == NULL) {
         xmlSecInternalError("xmlSecSimpleKeysStoreGetKeys", NULL);
         return(NULL);
     }
 
-    key = xmlSecOpenSSLX509FindKeyByValue(keysList, x509Data);
+    ret = xmlSecOpenSSLKeysStoreIndexUpdate(ctx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLKeysStoreIndexUpdate", NULL);
+        return(NULL);
+    }
+
+    key = xmlSecOpenSSLX509FindKeyByValue(keysList, &(ctx->certsIndex), x509Data);
     if(key == NULL) {
         /* not found */
         return(NULL);
@@ -184,16 +268,31 @@ xmlSecOpenSSLKeysStoreFindKeyFromX509Data(xmlSecKeyStorePtr store, xmlSecKeyX509
  */
 int
 xmlSecOpenSSLKeysStoreAdoptKey(xmlSecKeyStorePtr store, xmlSecKeyPtr key) {
-    xmlSecKeyStorePtr *simplekeystore;
+    xmlSecOpenSSLKeysStoreCtxPtr ctx;
+    int ret;
 
     xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecOpenSSLKeysStoreId), -1);
     xmlSecAssert2((key != NULL), -1);
 
-    simplekeystore = xmlSecOpenSSLKeysStoreGetCtx(store);
-    xmlSecAssert2(((simplekeystore != NULL) && (*simplekeystore != NULL) &&
-                   (xmlSecKeyStoreCheckId(*simplekeystore, xmlSecSimpleKeysStoreId))), -1);
+    ctx = xmlSecOpenSSLKeysStoreGetCtx(store);
+    xmlSecAssert2(((ctx != NULL) && (ctx->simplekeystore != NULL) &&
+                   (xmlSecKeyStoreCheckId(ctx->simplekeystore, xmlSecSimpleKeysStoreId))), -1);
+
+    ret = xmlSecSimpleKeysStoreAdoptKey(ctx->simplekeystore, key);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecSimpleKeysStoreAdoptKey", xmlSecKeyStoreGetName(store));
+        return(-1);
+    }
 
-    return (xmlSecSimpleKeysStoreAdoptKey(*simplekeystore, key));
+#ifndef XMLSEC_NO_X509
+    /* index the key now so the lookups don't need to change the index */
+    ret = xmlSecOpenSSLKeysStoreIndexUpdate(ctx);
+    if(ret < 0) {
+        /* the index will be rebuilt on the next lookup */
+        xmlSecInternalError("xmlSecOpenSSLKeysStoreIndexUpdate", xmlSecKeyStoreGetName(store));
+    }
+#endif /* XMLSEC_NO_X509 */
+    return(0);
 }
 
 /**
@@ -225,14 +324,14 @@ xmlSecOpenSSLKeysStoreLoad(xmlSecKeyStorePtr store, const char *uri,
  */
 int
 xmlSecOpenSSLKeysStoreSave(xmlSecKeyStorePtr store, const char *filename, xmlSecKeyDataType type) {
-    xmlSecKeyStorePtr *simplekeystore;
+    xmlSecOpenSSLKeysStoreCtxPtr ctx;
 
     xmlSecAssert2(xmlSecKeyStoreCheckId(store, xmlSecOpenSSLKeysStoreId), -1);
     xmlSecAssert2((filename != NULL), -1);
 
-    simplekeystore = xmlSecOpenSSLKeysStoreGetCtx(store);
-    xmlSecAssert2(((simplekeystore != NULL) && (*simplekeystore != NULL) &&
-                   (xmlSecKeyStoreCheckId(*simplekeystore, xmlSecSimpleKeysStoreId))), -1);
+    ctx = xmlSecOpenSSLKeysStoreGetCtx(store);
+    xmlSecAssert2(((ctx != NULL) && (ctx->simplekeystore != NULL) &&
+                   (xmlSecKeyStoreCheckId(ctx->simplekeystore, xmlSecSimpleKeysStoreId))), -1);
 
-    return (xmlSecSimpleKeysStoreSave(*simplekeystore, filename, type));
+    return (xmlSecSimpleKeysStoreSave(ctx->simplekeystore, filename, type));
 }
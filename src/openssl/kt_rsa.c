@@ -35,6 +35,7 @@
 #include <xmlsec/openssl/crypto.h>
 #include <xmlsec/openssl/evp.h>
 #include "openssl_compat.h"
+#include "private.h"
 
 #ifdef XMLSEC_OPENSSL_API_300
 #include <openssl/core_names.h>
@@ -196,45 +197,58 @@ xmlSecOpenSSLRsaPkcs1ProcessImpl(xmlSecOpenSSLRsaPkcs1CtxPtr ctx, const xmlSecBy
 #else /* XMLSEC_OPENSSL_API_300 */
 
 static int
-xmlSecOpenSSLRsaPkcs1SetKeyImpl(xmlSecOpenSSLRsaPkcs1CtxPtr ctx, EVP_PKEY* pKey,
-                                int encrypt) {
-    int keyLen;
+xmlSecOpenSSLRsaPkcs1SetupPkeyCtx(EVP_PKEY_CTX* pKeyCtx, void* data) {
+    int encrypt;
     int ret;
 
-    xmlSecAssert2(ctx != NULL, -1);
-    xmlSecAssert2(ctx->pKeyCtx == NULL, -1);
-    xmlSecAssert2(pKey != NULL, -1);
-
-    keyLen = EVP_PKEY_get_size(pKey);
-    if(keyLen <= 0) {
-        xmlSecOpenSSLError("EVP_PKEY_get_size", NULL);
-        return (-1);
-    }
-    XMLSEC_SAFE_CAST_INT_TO_SIZE(keyLen, ctx->keySize, return(-1), NULL);
-
-    ctx->pKeyCtx = EVP_PKEY_CTX_new_from_pkey(xmlSecOpenSSLGetLibCtx(), pKey, NULL);
-    if (ctx->pKeyCtx == NULL) {
-        xmlSecOpenSSLError("EVP_PKEY_CTX_new_from_pkey", NULL);
-        return (-1);
-    }
+    xmlSecAssert2(pKeyCtx != NULL, -1);
+    xmlSecAssert2(data != NULL, -1);
 
+    encrypt = *((int*)data);
     if (encrypt != 0) {
-        ret = EVP_PKEY_encrypt_init(ctx->pKeyCtx);
+        ret = EVP_PKEY_encrypt_init(pKeyCtx);
         if (ret <= 0) {
             xmlSecOpenSSLError("EVP_PKEY_encrypt_init", NULL);
             return (-1);
         }
     } else {
-        ret = EVP_PKEY_decrypt_init(ctx->pKeyCtx);
+        ret = EVP_PKEY_decrypt_init(pKeyCtx);
         if (ret <= 0) {
             xmlSecOpenSSLError("EVP_PKEY_decrypt_init", NULL);
             return (-1);
         }
     }
 
-    ret = EVP_PKEY_CTX_set_rsa_padding(ctx->pKeyCtx, RSA_PKCS1_PADDING);
+    ret = EVP_PKEY_CTX_set_rsa_padding(pKeyCtx, RSA_PKCS1_PADDING);
     if (ret <= 0) {
         xmlSecOpenSSLError("EVP_PKEY_CTX_set_rsa_padding", NULL);
+        return(-1);
+    }
+
+    /* success */
+    return(0);
+}
+
+static int
+xmlSecOpenSSLRsaPkcs1SetKeyImpl(xmlSecOpenSSLRsaPkcs1CtxPtr ctx, EVP_PKEY* pKey,
+                                int encrypt) {
+    int keyLen;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->pKeyCtx == NULL, -1);
+    xmlSecAssert2(pKey != NULL, -1);
+
+    keyLen = EVP_PKEY_get_size(pKey);
+    if(keyLen <= 0) {
+        xmlSecOpenSSLError("EVP_PKEY_get_size", NULL);
+        return (-1);
+    }
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(keyLen, ctx->keySize, return(-1), NULL);
+
+    ctx->pKeyCtx = xmlSecOpenSSLPKeyCtxNewCached(pKey, xmlSecOpenSSLTransformRsaPkcs1Id, encrypt,
+        xmlSecOpenSSLRsaPkcs1SetupPkeyCtx, &encrypt);
+    if (ctx->pKeyCtx == NULL) {
+        xmlSecInternalError("xmlSecOpenSSLPKeyCtxNewCached", NULL);
         return (-1);
     }
 
@@ -799,45 +813,31 @@ xmlSecOpenSSLRsaOaepProcessImpl(xmlSecOpenSSLRsaOaepCtxPtr ctx, const xmlSecByte
 #else /* XMLSEC_OPENSSL_API_300 */
 
 static int
-xmlSecOpenSSLRsaOaepSetKeyImpl(xmlSecOpenSSLRsaOaepCtxPtr ctx, EVP_PKEY* pKey,
-                            int encrypt) {
-    int keyLen;
+xmlSecOpenSSLRsaOaepSetupPkeyCtx(EVP_PKEY_CTX* pKeyCtx, void* data) {
+    int encrypt;
     int ret;
 
-    xmlSecAssert2(ctx != NULL, -1);
-    xmlSecAssert2(ctx->pKeyCtx == NULL, -1);
-    xmlSecAssert2(pKey != NULL, -1);
-
-    keyLen = EVP_PKEY_get_size(pKey);
-    if(keyLen <= 0) {
-        xmlSecOpenSSLError("EVP_PKEY_get_size", NULL);
-        return (-1);
-    }
-    XMLSEC_SAFE_CAST_INT_TO_SIZE(keyLen, ctx->keySize, return(-1), NULL);
-
-    ctx->pKeyCtx = EVP_PKEY_CTX_new_from_pkey(xmlSecOpenSSLGetLibCtx(), pKey, NULL);
-    if (ctx->pKeyCtx == NULL) {
-        xmlSecOpenSSLError("EVP_PKEY_CTX_new_from_pkey", NULL);
-        return (-1);
-    }
+    xmlSecAssert2(pKeyCtx != NULL, -1);
+    xmlSecAssert2(data != NULL, -1);
 
+    encrypt = *((int*)data);
     if (encrypt != 0) {
-        ret = EVP_PKEY_encrypt_init(ctx->pKeyCtx);
+        ret = EVP_PKEY_encrypt_init(pKeyCtx);
         if (ret <= 0) {
             xmlSecOpenSSLError("EVP_PKEY_encrypt_init", NULL);
             return (-1);
         }
     } else {
-        ret = EVP_PKEY_decrypt_init(ctx->pKeyCtx);
+        ret = EVP_PKEY_decrypt_init(pKeyCtx);
         if (ret <= 0) {
             xmlSecOpenSSLError("EVP_PKEY_decrypt_init", NULL);
             return (-1);
         }
     }
 
-    ret = EVP_PKEY_CTX_set_rsa_padding(ctx->pKeyCtx, RSA_PKCS1_OAEP_PADDING);
+    ret = EVP_PKEY_CTX_set_rsa_padding(pKeyCtx, RSA_PKCS1_OAEP_PADDING);
     if (ret <= 0) {
-         xmlSecOpenSSLError("EVP_PKEY_CTX_set_rsa_padding", NULL);
+        xmlSecOpenSSLError("EVP_PKEY_CTX_set_rsa_padding", NULL);
         return(-1);
     }
 
@@ -845,6 +845,34 @@ xmlSecOpenSSLRsaOaepSetKeyImpl(xmlSecOpenSSLRsaOaepCtxPtr ctx, EVP_PKEY* pKey,
     return(0);
 }
 
+static int
+xmlSecOpenSSLRsaOaepSetKeyImpl(xmlSecOpenSSLRsaOaepCtxPtr ctx, EVP_PKEY* pKey,
+                            int encrypt) {
+    int keyLen;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->pKeyCtx == NULL, -1);
+    xmlSecAssert2(pKey != NULL, -1);
+
+    keyLen = EVP_PKEY_get_size(pKey);
+    if(keyLen <= 0) {
+        xmlSecOpenSSLError("EVP_PKEY_get_size", NULL);
+        return (-1);
+    }
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(keyLen, ctx->keySize, return(-1), NULL);
+
+    /* the OAEP parameters (if any) are set later on the copy */
+    ctx->pKeyCtx = xmlSecOpenSSLPKeyCtxNewCached(pKey, xmlSecOpenSSLTransformRsaOaepId, encrypt,
+        xmlSecOpenSSLRsaOaepSetupPkeyCtx, &encrypt);
+    if (ctx->pKeyCtx == NULL) {
+        xmlSecInternalError("xmlSecOpenSSLPKeyCtxNewCached", NULL);
+        return (-1);
+    }
+
+    /* success */
+    return(0);
+}
+
 // We can put all the params into one OSSL_PARAM array and setup everything at-once.
 // However, in OpenSSL <= 3.0.7 there is a bug that mixes OAEP digest and
 // OAEP MGf1 digest (https://pullanswer.com/questions/mgf1-digest-not-set-correctly-when-configuring-rsa-evp_pkey_ctx-with-ossl_params)
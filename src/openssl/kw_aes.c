@@ -33,6 +33,7 @@
 #include "../kw_aes_des.h"
 #include "../cast_helpers.h"
 #include "openssl_compat.h"
+#include "private.h"
 
 /*********************************************************************
  *
@@ -51,10 +52,18 @@ static int        xmlSecOpenSSLKWAesBlockDecrypt                (xmlSecTransform
                                                                  xmlSecByte * out,
                                                                  xmlSecSize outSize,
                                                                  xmlSecSize * outWritten);
+static int        xmlSecOpenSSLKWAesBlocksEncrypt               (xmlSecTransformPtr transform,
+                                                                 xmlSecByte * blocks,
+                                                                 xmlSecSize blocksNum);
+static int        xmlSecOpenSSLKWAesBlocksDecrypt               (xmlSecTransformPtr transform,
+                                                                 xmlSecByte * blocks,
+                                                                 xmlSecSize blocksNum);
 static xmlSecKWAesKlass xmlSecOpenSSLKWAesKlass = {
     /* callbacks */
     xmlSecOpenSSLKWAesBlockEncrypt,         /* xmlSecKWAesBlockEncryptMethod       encrypt; */
     xmlSecOpenSSLKWAesBlockDecrypt,         /* xmlSecKWAesBlockDecryptMethod       decrypt; */
+    xmlSecOpenSSLKWAesBlocksEncrypt,        /* xmlSecKWAesBlocksEncryptMethod      encryptBlocks; */
+    xmlSecOpenSSLKWAesBlocksDecrypt,        /* xmlSecKWAesBlocksDecryptMethod      decryptBlocks; */
 
     /* for the future */
     NULL,                                   /* void*                               reserved0; */
@@ -71,10 +80,15 @@ typedef struct _xmlSecOpenSSLKWAesCtx   xmlSecOpenSSLKWAesCtx,
 struct _xmlSecOpenSSLKWAesCtx {
     xmlSecTransformKWAesCtx parentCtx;
 
-#ifdef XMLSEC_OPENSSL_API_300
-    const char*  cipherName;
-    EVP_CIPHER*  cipher;
+    /* the key schedule for the bulk blocks operations */
+#ifndef XMLSEC_OPENSSL_API_300
+    AES_KEY          aesKey;
+#else /* XMLSEC_OPENSSL_API_300 */
+    const char*      cipherName;
+    EVP_CIPHER*      cipher;
+    EVP_CIPHER_CTX*  cipherCtx;
 #endif /* XMLSEC_OPENSSL_API_300 */
+    int              keyMode;       /* 0 - not set, 1 - encrypt, 2 - decrypt */
 };
 
 /*********************************************************************
@@ -124,13 +138,13 @@ xmlSecOpenSSLKWAesInitialize(xmlSecTransformPtr transform) {
     memset(ctx, 0, sizeof(xmlSecOpenSSLKWAesCtx));
 
     if(xmlSecTransformCheckId(transform, xmlSecOpenSSLTransformKWAes128Id)) {
-        XMLSEC_OPENSSL_KW_AES_SET_CIPHER(ctx, XMLSEEC_OPENSSL_CIPHER_NAME_AES128_CBC);
+        XMLSEC_OPENSSL_KW_AES_SET_CIPHER(ctx, XMLSEEC_OPENSSL_CIPHER_NAME_AES128_ECB);
         keyExpectedSize = XMLSEC_KW_AES128_KEY_SIZE;
     } else if(xmlSecTransformCheckId(transform, xmlSecOpenSSLTransformKWAes192Id)) {
-        XMLSEC_OPENSSL_KW_AES_SET_CIPHER(ctx, XMLSEEC_OPENSSL_CIPHER_NAME_AES192_CBC);
+        XMLSEC_OPENSSL_KW_AES_SET_CIPHER(ctx, XMLSEEC_OPENSSL_CIPHER_NAME_AES192_ECB);
         keyExpectedSize = XMLSEC_KW_AES192_KEY_SIZE;
     } else if(xmlSecTransformCheckId(transform, xmlSecOpenSSLTransformKWAes256Id)) {
-        XMLSEC_OPENSSL_KW_AES_SET_CIPHER(ctx, XMLSEEC_OPENSSL_CIPHER_NAME_AES256_CBC);
+        XMLSEC_OPENSSL_KW_AES_SET_CIPHER(ctx, XMLSEEC_OPENSSL_CIPHER_NAME_AES256_ECB);
         keyExpectedSize = XMLSEC_KW_AES256_KEY_SIZE;
     } else {
         xmlSecInvalidTransfromError(transform)
@@ -149,7 +163,7 @@ xmlSecOpenSSLKWAesInitialize(xmlSecTransformPtr transform) {
 #ifdef XMLSEC_OPENSSL_API_300
     /* fetch cipher */
     xmlSecAssert2(ctx->cipherName != NULL, -1);
-    ctx->cipher = EVP_CIPHER_fetch(xmlSecOpenSSLGetLibCtx(), ctx->cipherName, NULL);
+    ctx->cipher = xmlSecOpenSSLEvpCipherFetch(ctx->cipherName);
     if(ctx->cipher == NULL) {
         xmlSecOpenSSLError2("EVP_CIPHER_fetch", xmlSecTransformGetName(transform),
             "cipherName=%s", xmlSecErrorsSafeString(ctx->cipherName));
@@ -172,6 +186,9 @@ xmlSecOpenSSLKWAesFinalize(xmlSecTransformPtr transform) {
     xmlSecAssert(ctx != NULL);
 
 #ifdef XMLSEC_OPENSSL_API_300
+    if(ctx->cipherCtx != NULL) {
+        EVP_CIPHER_CTX_free(ctx->cipherCtx);
+    }
     if(ctx->cipher != NULL) {
         EVP_CIPHER_free(ctx->cipher);
     }
@@ -358,12 +375,92 @@ xmlSecOpenSSLTransformKWAes256GetKlass(void) {
     return(&xmlSecOpenSSLKWAes256Klass);
 }
 
+/**
+ * xmlSecOpenSSLTransformKWAesExecuteBatch:
+ * @transform:          the AES key wrap transform with the key set.
+ * @in:                 the array of input buffers (the keys to wrap or to unwrap).
+ * @out:                the array of output buffers (not the same as the @in buffers).
+ * @size:               the number of buffers in @in and @out.
+ *
+ * Wraps (encrypt operation) or unwraps (decrypt operation) all the @in
+ * buffers with the @transform key. The key schedule is set up once and
+ * the AES KW rounds for the keys of the same size are interleaved, so
+ * OpenSSL encrypts or decrypts up to 16 blocks in each call.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLTransformKWAesExecuteBatch(xmlSecTransformPtr transform, xmlSecBufferPtr* in,
+                                        xmlSecBufferPtr* out, xmlSecSize size) {
+    xmlSecOpenSSLKWAesCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecOpenSSLKWAesCheckId(transform), -1);
+    xmlSecAssert2(xmlSecTransformCheckSize(transform, xmlSecOpenSSLKWAesSize), -1);
+
+    ctx = xmlSecOpenSSLKWAesGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    ret = xmlSecTransformKWAesExecuteBatch(transform, &(ctx->parentCtx), in, out, size);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformKWAesExecuteBatch", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    return(0);
+}
+
 /*********************************************************************
  *
  * AES KW implementation
  *
  *********************************************************************/
 #ifndef XMLSEC_OPENSSL_API_300
+static int
+xmlSecOpenSSLKWAesBlocksEncryptDecrypt(xmlSecOpenSSLKWAesCtxPtr ctx, xmlSecByte * blocks,
+                                       xmlSecSize blocksNum, int encrypt) {
+    xmlSecByte* keyData;
+    xmlSecSize keySize, ii;
+    int keyMode, keyLen;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(blocks != NULL, -1);
+
+    /* prepare the key schedule once */
+    keyMode = (encrypt != 0) ? 1 : 2;
+    if(ctx->keyMode != keyMode) {
+        keyData = xmlSecBufferGetData(&(ctx->parentCtx.keyBuffer));
+        keySize = xmlSecBufferGetSize(&(ctx->parentCtx.keyBuffer));
+        xmlSecAssert2(keyData != NULL, -1);
+        xmlSecAssert2(keySize == ctx->parentCtx.keyExpectedSize, -1);
+
+        XMLSEC_SAFE_CAST_SIZE_TO_INT(keySize, keyLen, return(-1), NULL);
+        if(encrypt != 0) {
+            ret = AES_set_encrypt_key(keyData, 8 * keyLen, &(ctx->aesKey));
+            if(ret != 0) {
+                xmlSecOpenSSLError("AES_set_encrypt_key", NULL);
+                return(-1);
+            }
+        } else {
+            ret = AES_set_decrypt_key(keyData, 8 * keyLen, &(ctx->aesKey));
+            if(ret != 0) {
+                xmlSecOpenSSLError("AES_set_decrypt_key", NULL);
+                return(-1);
+            }
+        }
+        ctx->keyMode = keyMode;
+    }
+
+    for(ii = 0; ii < blocksNum; ++ii, blocks += AES_BLOCK_SIZE) {
+        if(encrypt != 0) {
+            AES_encrypt(blocks, blocks, &(ctx->aesKey));
+        } else {
+            AES_decrypt(blocks, blocks, &(ctx->aesKey));
+        }
+    }
+    return(0);
+}
+
 static int
 xmlSecOpenSSLKWAesEncryptDecrypt(xmlSecOpenSSLKWAesCtxPtr ctx, const xmlSecByte * in, xmlSecSize inSize,
                                 xmlSecByte * out, xmlSecSize outSize, xmlSecSize * outWritten,
@@ -412,6 +509,61 @@ xmlSecOpenSSLKWAesEncryptDecrypt(xmlSecOpenSSLKWAesCtxPtr ctx, const xmlSecByte
 
 #else /* XMLSEC_OPENSSL_API_300 */
 
+static int
+xmlSecOpenSSLKWAesBlocksEncryptDecrypt(xmlSecOpenSSLKWAesCtxPtr ctx, xmlSecByte * blocks,
+                                       xmlSecSize blocksNum, int encrypt) {
+    xmlSecByte* keyData;
+    xmlSecSize keySize;
+    int keyMode, inLen, outLen;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->cipher != NULL, -1);
+    xmlSecAssert2(blocks != NULL, -1);
+
+    /* prepare the key schedule once: ECB with no padding doesn't keep
+     * any state between the updates */
+    keyMode = (encrypt != 0) ? 1 : 2;
+    if(ctx->keyMode != keyMode) {
+        keyData = xmlSecBufferGetData(&(ctx->parentCtx.keyBuffer));
+        keySize = xmlSecBufferGetSize(&(ctx->parentCtx.keyBuffer));
+        xmlSecAssert2(keyData != NULL, -1);
+        xmlSecAssert2(keySize == ctx->parentCtx.keyExpectedSize, -1);
+
+        if(ctx->cipherCtx == NULL) {
+            ctx->cipherCtx = EVP_CIPHER_CTX_new();
+            if(ctx->cipherCtx == NULL) {
+                xmlSecOpenSSLError("EVP_CIPHER_CTX_new", NULL);
+                return(-1);
+            }
+        }
+        ctx->keyMode = 0;
+
+        ret = EVP_CipherInit_ex2(ctx->cipherCtx, ctx->cipher, keyData,
+            NULL, ((encrypt != 0) ? 1 : 0), NULL);
+        if(ret != 1) {
+            xmlSecOpenSSLError("EVP_CipherInit_ex2", NULL);
+            return(-1);
+        }
+        ret = EVP_CIPHER_CTX_set_padding(ctx->cipherCtx, 0);
+        if(ret != 1) {
+            xmlSecOpenSSLError("EVP_CIPHER_CTX_set_padding", NULL);
+            return(-1);
+        }
+        ctx->keyMode = keyMode;
+    }
+
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(blocksNum * AES_BLOCK_SIZE, inLen, return(-1), NULL);
+    outLen = 0;
+    ret = EVP_CipherUpdate(ctx->cipherCtx, blocks, &outLen, blocks, inLen);
+    if(ret != 1) {
+        xmlSecOpenSSLError("EVP_CipherUpdate", NULL);
+        return(-1);
+    }
+    xmlSecAssert2(outLen == inLen, -1);
+    return(0);
+}
+
 static int
 xmlSecOpenSSLKWAesEncryptDecrypt(xmlSecOpenSSLKWAesCtxPtr ctx, const xmlSecByte * in, xmlSecSize inSize,
                                 xmlSecByte * out, xmlSecSize outSize, xmlSecSize * outWritten,
@@ -542,6 +694,52 @@ xmlSecOpenSSLKWAesBlockDecrypt(xmlSecTransformPtr transform, const xmlSecByte *
     return(0);
 }
 
+static int
+xmlSecOpenSSLKWAesBlocksEncrypt(xmlSecTransformPtr transform, xmlSecByte * blocks, xmlSecSize blocksNum) {
+    xmlSecOpenSSLKWAesCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecOpenSSLKWAesCheckId(transform), -1);
+    xmlSecAssert2(xmlSecTransformCheckSize(transform, xmlSecOpenSSLKWAesSize), -1);
+    xmlSecAssert2(blocks != NULL, -1);
+
+    ctx = xmlSecOpenSSLKWAesGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    ret = xmlSecOpenSSLKWAesBlocksEncryptDecrypt(ctx, blocks, blocksNum, 1); /* encrypt */
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLKWAesBlocksEncryptDecrypt",
+            xmlSecTransformGetName(transform));
+        return(-1);
+    }
+
+    /* success */
+    return(0);
+}
+
+static int
+xmlSecOpenSSLKWAesBlocksDecrypt(xmlSecTransformPtr transform, xmlSecByte * blocks, xmlSecSize blocksNum) {
+    xmlSecOpenSSLKWAesCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecOpenSSLKWAesCheckId(transform), -1);
+    xmlSecAssert2(xmlSecTransformCheckSize(transform, xmlSecOpenSSLKWAesSize), -1);
+    xmlSecAssert2(blocks != NULL, -1);
+
+    ctx = xmlSecOpenSSLKWAesGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    ret = xmlSecOpenSSLKWAesBlocksEncryptDecrypt(ctx, blocks, blocksNum, 0); /* decrypt */
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLKWAesBlocksEncryptDecrypt",
+            xmlSecTransformGetName(transform));
+        return(-1);
+    }
+
+    /* success */
+    return(0);
+}
+
 #else /* XMLSEC_NO_AES */
 
 /* ISO C forbids an empty translation unit */
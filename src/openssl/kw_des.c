@@ -34,6 +34,7 @@
 #include "../kw_aes_des.h"
 #include "../cast_helpers.h"
 #include "openssl_compat.h"
+#include "private.h"
 
 #ifdef XMLSEC_OPENSSL_API_300
 #include <openssl/core_names.h>
@@ -301,7 +302,8 @@ xmlSecOpenSSLKWDes3Sha1(xmlSecTransformPtr transform ATTRIBUTE_UNUSED,
     xmlSecAssert2(outWritten != NULL, -1);
 
     outSizeT = outSize;
-    ret = EVP_Q_digest(xmlSecOpenSSLGetLibCtx(), OSSL_DIGEST_NAME_SHA1, NULL,
+    ret = EVP_Q_digest(xmlSecOpenSSLGetThreadLibCtx(), OSSL_DIGEST_NAME_SHA1,
+                       xmlSecOpenSSLGetPropQuery(OSSL_DIGEST_NAME_SHA1),
                        in, inSize, out, &outSizeT);
     if(ret != 1) {
         xmlSecOpenSSLError("EVP_Q_digest(SHA1)", NULL);
@@ -326,9 +328,9 @@ xmlSecOpenSSLKWDes3GenerateRandom(xmlSecTransformPtr transform ATTRIBUTE_UNUSED,
     xmlSecAssert2(out != NULL, -1);
     xmlSecAssert2(outSize > 0, -1);
 
-    ret = RAND_priv_bytes_ex(xmlSecOpenSSLGetLibCtx(), out, outSize, XMLSEEC_OPENSSL_RAND_BYTES_STRENGTH);
-    if(ret != 1) {
-        xmlSecOpenSSLError2("RAND_priv_bytes_ex", NULL, "size=" XMLSEC_SIZE_FMT, outSize);
+    ret = xmlSecOpenSSLGetRandomBytes(out, outSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecOpenSSLGetRandomBytes", NULL, "size=" XMLSEC_SIZE_FMT, outSize);
         return(-1);
     }
     (*outWritten) = outSize;
@@ -459,7 +461,7 @@ xmlSecOpenSSLKWDes3Encrypt(const xmlSecByte* key, xmlSecSize keySize,
 #ifndef XMLSEC_OPENSSL_API_300
     cipher = EVP_des_ede3_cbc();
 #else /* XMLSEC_OPENSSL_API_300 */
-    cipher = EVP_CIPHER_fetch(xmlSecOpenSSLGetLibCtx(), XMLSEEC_OPENSSL_CIPHER_NAME_DES3_EDE, NULL);
+    cipher = xmlSecOpenSSLEvpCipherFetch(XMLSEEC_OPENSSL_CIPHER_NAME_DES3_EDE);
     if(cipher == NULL) {
         xmlSecOpenSSLError("EVP_CIPHER_fetch(DES3_EDE)", NULL);
         goto done;
@@ -72,6 +72,7 @@ static inline int xmlSecOpenSSLCompatRand(unsigned char *buf, xmlSecSize size) {
 
 /* Not implemented by LibreSSL (yet?) */
 #define XMLSEC_OPENSSL_NO_ASN1_TIME_TO_TM   1
+#define XMLSEC_OPENSSL_NO_OCSP              1
 
 #define ENGINE_cleanup(...)                 {}
 #define CONF_modules_unload(...)            {}
@@ -148,11 +149,18 @@ int RSA_padding_check_PKCS1_OAEP_mgf1(uint8_t *out, size_t *out_len, size_t max_
 #define XMLSEEC_OPENSSL_CIPHER_NAME_AES128_CBC  "AES-128-CBC"
 #define XMLSEEC_OPENSSL_CIPHER_NAME_AES192_CBC  "AES-192-CBC"
 #define XMLSEEC_OPENSSL_CIPHER_NAME_AES256_CBC  "AES-256-CBC"
+#define XMLSEEC_OPENSSL_CIPHER_NAME_AES128_ECB  "AES-128-ECB"
+#define XMLSEEC_OPENSSL_CIPHER_NAME_AES192_ECB  "AES-192-ECB"
+#define XMLSEEC_OPENSSL_CIPHER_NAME_AES256_ECB  "AES-256-ECB"
 #define XMLSEEC_OPENSSL_CIPHER_NAME_AES128_GCM  "AES-128-GCM"
 #define XMLSEEC_OPENSSL_CIPHER_NAME_AES192_GCM  "AES-192-GCM"
 #define XMLSEEC_OPENSSL_CIPHER_NAME_AES256_GCM  "AES-256-GCM"
 
 #endif /* XMLSEC_OPENSSL_API_300 */
 
+/* OCSP could be disabled in the OpenSSL build */
+#if defined(OPENSSL_NO_OCSP) && !defined(XMLSEC_OPENSSL_NO_OCSP)
+#define XMLSEC_OPENSSL_NO_OCSP              1
+#endif /* defined(OPENSSL_NO_OCSP) && !defined(XMLSEC_OPENSSL_NO_OCSP) */
 
 #endif /* __XMLSEC_OPENSSL_OPENSSL_COMPAT_H__ */
@@ -28,6 +28,99 @@ extern "C" {
 #endif /* __cplusplus */
 
 
+/******************************************************************************
+ *
+ * Deferred initialization (see xmlSecOpenSSLAppSetDeferredInit): called
+ * before the first use of the crypto library.
+ *
+ ******************************************************************************/
+int             xmlSecOpenSSLAppDeferredInit                    (void);
+
+
+/******************************************************************************
+ *
+ * Random bytes: served from the per thread pool if it is enabled
+ * (see xmlSecOpenSSLSetRandomPool).
+ *
+ ******************************************************************************/
+int             xmlSecOpenSSLGetRandomBytes                     (xmlSecByte* out,
+                                                                 xmlSecSize outSize);
+
+
+/******************************************************************************
+ *
+ * EVP algorithms cache: the fetched EVP_MD/EVP_CIPHER objects are shared
+ * between all transforms. The returned object is a new reference and should
+ * be freed with EVP_MD_free()/EVP_CIPHER_free() as usual. All the fetches
+ * use the property query for the algorithm (see xmlSecOpenSSLSetPropQuery).
+ *
+ ******************************************************************************/
+#ifdef XMLSEC_OPENSSL_API_300
+
+EVP_MD*         xmlSecOpenSSLEvpMdFetch                         (const char* name);
+EVP_CIPHER*     xmlSecOpenSSLEvpCipherFetch                     (const char* name);
+EVP_PKEY_CTX*   xmlSecOpenSSLPKeyCtxNew                         (EVP_PKEY* pKey);
+
+typedef int     (*xmlSecOpenSSLPKeyCtxSetupMethod)              (EVP_PKEY_CTX* pKeyCtx,
+                                                                 void* data);
+EVP_PKEY_CTX*   xmlSecOpenSSLPKeyCtxNewCached                   (EVP_PKEY* pKey,
+                                                                 const void* tag,
+                                                                 int operation,
+                                                                 xmlSecOpenSSLPKeyCtxSetupMethod setup,
+                                                                 void* data);
+
+typedef EVP_MAC_CTX* (*xmlSecOpenSSLMacCtxCreateMethod)         (const xmlSecByte* key,
+                                                                 xmlSecSize keySize,
+                                                                 void* data);
+EVP_MAC_CTX*    xmlSecOpenSSLMacCtxNewCached                    (const char* name,
+                                                                 const xmlSecByte* key,
+                                                                 xmlSecSize keySize,
+                                                                 xmlSecOpenSSLMacCtxCreateMethod create,
+                                                                 void* data);
+
+#define XMLSEC_OPENSSL_PUBLIC_KEY_ID_SIZE                       32
+int             xmlSecOpenSSLPublicKeyGetId                     (const xmlChar* curve,
+                                                                 const xmlSecBufferPtr* parts,
+                                                                 xmlSecSize partsSize,
+                                                                 xmlSecByte* id);
+EVP_PKEY*       xmlSecOpenSSLPublicKeyFindCached                (const char* name,
+                                                                 const xmlSecByte* id);
+void            xmlSecOpenSSLPublicKeyAddCached                 (const char* name,
+                                                                 const xmlSecByte* id,
+                                                                 EVP_PKEY* pKey);
+
+
+#endif /* XMLSEC_OPENSSL_API_300 */
+
+
+/******************************************************************************
+ *
+ * EVP_MD_CTX/EVP_CIPHER_CTX/X509_STORE_CTX per thread pools (OpenSSL 3.0+,
+ * otherwise the objects are allocated and freed every time).
+ *
+ ******************************************************************************/
+#ifdef XMLSEC_OPENSSL_API_300
+
+EVP_MD_CTX*     xmlSecOpenSSLEvpMdCtxBorrow                     (void);
+void            xmlSecOpenSSLEvpMdCtxRelease                    (EVP_MD_CTX* mdCtx);
+EVP_CIPHER_CTX* xmlSecOpenSSLEvpCipherCtxBorrow                 (void);
+void            xmlSecOpenSSLEvpCipherCtxRelease                (EVP_CIPHER_CTX* cipherCtx);
+#ifndef XMLSEC_NO_X509
+X509_STORE_CTX* xmlSecOpenSSLX509StoreCtxBorrow                 (void);
+void            xmlSecOpenSSLX509StoreCtxRelease                (X509_STORE_CTX* storeCtx);
+#endif /* XMLSEC_NO_X509 */
+
+#else  /* XMLSEC_OPENSSL_API_300 */
+
+#define xmlSecOpenSSLEvpMdCtxBorrow()                   EVP_MD_CTX_new()
+#define xmlSecOpenSSLEvpMdCtxRelease(mdCtx)             EVP_MD_CTX_free(mdCtx)
+#define xmlSecOpenSSLEvpCipherCtxBorrow()               EVP_CIPHER_CTX_new()
+#define xmlSecOpenSSLEvpCipherCtxRelease(cipherCtx)     EVP_CIPHER_CTX_free(cipherCtx)
+#define xmlSecOpenSSLX509StoreCtxBorrow()               X509_STORE_CTX_new_ex(xmlSecOpenSSLGetLibCtx(), NULL)
+#define xmlSecOpenSSLX509StoreCtxRelease(storeCtx)      X509_STORE_CTX_free(storeCtx)
+
+#endif /* XMLSEC_OPENSSL_API_300 */
+
 
 /******************************************************************************
  *
@@ -65,9 +158,65 @@ int             xmlSecOpenSSLX509FindCertCtxMatch               (xmlSecOpenSSLX5
 
 X509*           xmlSecOpenSSLX509StoreFindCertByValue           (xmlSecKeyDataStorePtr store,
                                                                  xmlSecKeyX509DataValuePtr x509Value);
-
+int             xmlSecOpenSSLX509StoreIsInternEnabled           (xmlSecKeyDataStorePtr store);
+X509*           xmlSecOpenSSLX509StoreInternFindCert            (xmlSecKeyDataStorePtr store,
+                                                                 const xmlSecByte* digest,
+                                                                 xmlSecSize size);
+X509*           xmlSecOpenSSLX509StoreInternAddCert             (xmlSecKeyDataStorePtr store,
+                                                                 const xmlSecByte* digest,
+                                                                 xmlSecSize size,
+                                                                 X509* cert);
+X509_CRL*       xmlSecOpenSSLX509StoreInternFindCrl             (xmlSecKeyDataStorePtr store,
+                                                                 const xmlSecByte* digest,
+                                                                 xmlSecSize size);
+X509_CRL*       xmlSecOpenSSLX509StoreInternAddCrl              (xmlSecKeyDataStorePtr store,
+                                                                 const xmlSecByte* digest,
+                                                                 xmlSecSize size,
+                                                                 X509_CRL* crl);
+int             xmlSecOpenSSLKeyDataX509Intern                  (xmlSecKeyDataPtr data,
+                                                                 xmlSecKeyDataStorePtr x509Store);
+
+
+/* The certs hash indexes by subject, issuer and serial number, SKI and SHA1/SHA256
+ * digest. Each index is an array of (hash, pos) items sorted by hash and then by
+ * the cert position in the certs list, the certs are always appended to the list. */
+typedef struct _xmlSecOpenSSLX509CertIndexItem {
+    unsigned long       hash;
+    xmlSecSize          pos;
+} xmlSecOpenSSLX509CertIndexItem, *xmlSecOpenSSLX509CertIndexItemPtr;
+
+typedef struct _xmlSecOpenSSLX509CertIndex {
+    xmlSecOpenSSLX509CertIndexItemPtr   items;
+    xmlSecSize                          size;
+    xmlSecSize                          maxSize;
+} xmlSecOpenSSLX509CertIndex, *xmlSecOpenSSLX509CertIndexPtr;
+
+typedef struct _xmlSecOpenSSLX509CertsIndex {
+    xmlSecOpenSSLX509CertIndex          subjectIndex;
+    xmlSecOpenSSLX509CertIndex          issuerSerialIndex;
+    xmlSecOpenSSLX509CertIndex          skiIndex;
+    xmlSecOpenSSLX509CertIndex          sha1Index;
+    xmlSecOpenSSLX509CertIndex          sha256Index;
+} xmlSecOpenSSLX509CertsIndex, *xmlSecOpenSSLX509CertsIndexPtr;
+
+/* returns the cert at @pos in the indexed certs list or NULL */
+typedef X509*   (*xmlSecOpenSSLX509CertsIndexGetCertMethod)     (void* certsCtx,
+                                                                 xmlSecSize pos);
+
+void            xmlSecOpenSSLX509CertsIndexInitialize           (xmlSecOpenSSLX509CertsIndexPtr certsIndex);
+void            xmlSecOpenSSLX509CertsIndexFinalize             (xmlSecOpenSSLX509CertsIndexPtr certsIndex);
+int             xmlSecOpenSSLX509CertsIndexAdd                  (xmlSecOpenSSLX509CertsIndexPtr certsIndex,
+                                                                 X509* cert,
+                                                                 xmlSecSize pos);
+int             xmlSecOpenSSLX509CertsIndexFind                 (xmlSecOpenSSLX509CertsIndexPtr certsIndex,
+                                                                 xmlSecOpenSSLX509FindCertCtxPtr findCertCtx,
+                                                                 xmlSecOpenSSLX509CertsIndexGetCertMethod getCert,
+                                                                 void* certsCtx,
+                                                                 xmlSecSize certsSize,
+                                                                 xmlSecSize* pos);
 
 xmlSecKeyPtr    xmlSecOpenSSLX509FindKeyByValue                 (xmlSecPtrListPtr keysList,
+                                                                 xmlSecOpenSSLX509CertsIndexPtr keysIndex,
                                                                  xmlSecKeyX509DataValuePtr x509Value);
 
 const EVP_MD*   xmlSecOpenSSLX509GetDigestFromAlgorithm         (const xmlChar* href);
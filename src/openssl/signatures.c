@@ -30,6 +30,7 @@
 #include <xmlsec/openssl/crypto.h>
 #include <xmlsec/openssl/evp.h>
 #include "openssl_compat.h"
+#include "private.h"
 
 
 #ifdef XMLSEC_OPENSSL_API_300
@@ -743,7 +744,7 @@ xmlSecOpenSSLEvpSignatureInitialize(xmlSecTransformPtr transform) {
     /* fetch digest */
     if(ctx->legacyDigest == 0) {
         xmlSecAssert2(ctx->digestName != NULL, -1);
-        ctx->digest = EVP_MD_fetch(xmlSecOpenSSLGetLibCtx(), ctx->digestName, NULL);
+        ctx->digest = xmlSecOpenSSLEvpMdFetch(ctx->digestName);
         if(ctx->digest == NULL) {
             xmlSecOpenSSLError2("EVP_MD_fetch", xmlSecTransformGetName(transform),
                                "digestName=%s", xmlSecErrorsSafeString(ctx->digestName));
@@ -755,9 +756,9 @@ xmlSecOpenSSLEvpSignatureInitialize(xmlSecTransformPtr transform) {
     xmlSecAssert2(ctx->digest != NULL, -1);
 
     /* create digest CTX */
-    ctx->digestCtx = EVP_MD_CTX_new();
+    ctx->digestCtx = xmlSecOpenSSLEvpMdCtxBorrow();
     if(ctx->digestCtx == NULL) {
-        xmlSecOpenSSLError("EVP_MD_CTX_new", xmlSecTransformGetName(transform));
+        xmlSecOpenSSLError("xmlSecOpenSSLEvpMdCtxBorrow", xmlSecTransformGetName(transform));
         xmlSecOpenSSLEvpSignatureFinalize(transform);
         return(-1);
     }
@@ -781,7 +782,7 @@ xmlSecOpenSSLEvpSignatureFinalize(xmlSecTransformPtr transform) {
     }
 
     if(ctx->digestCtx != NULL) {
-        EVP_MD_CTX_free(ctx->digestCtx);
+        xmlSecOpenSSLEvpMdCtxRelease(ctx->digestCtx);
     }
 #ifdef XMLSEC_OPENSSL_API_300
     if((ctx->digest != NULL) && (ctx->legacyDigest == 0)) {
@@ -889,49 +890,39 @@ xmlSecOpenSSLEvpSignatureCalculateDigest(xmlSecTransformPtr transform, xmlSecOpe
     return(0);
 }
 
-static EVP_PKEY_CTX*
-xmlSecOpenSSLEvpSignatureCreatePkeyCtx(xmlSecTransformPtr transform, xmlSecOpenSSLEvpSignatureCtxPtr ctx) {
-    EVP_PKEY_CTX *pKeyCtx = NULL;
+static int
+xmlSecOpenSSLEvpSignatureSetupPkeyCtx(EVP_PKEY_CTX* pKeyCtx, void* data) {
+    xmlSecTransformPtr transform = (xmlSecTransformPtr)data;
+    xmlSecOpenSSLEvpSignatureCtxPtr ctx;
     int ret;
 
-    xmlSecAssert2(ctx != NULL, NULL);
-    xmlSecAssert2(ctx->digest != NULL, NULL);
-    xmlSecAssert2(ctx->pKey != NULL, NULL);
+    xmlSecAssert2(pKeyCtx != NULL, -1);
+    xmlSecAssert2(transform != NULL, -1);
 
-#ifndef XMLSEC_OPENSSL_API_300
-    pKeyCtx = EVP_PKEY_CTX_new(ctx->pKey, NULL);
-    if (pKeyCtx == NULL) {
-        xmlSecOpenSSLError("EVP_PKEY_CTX_new", xmlSecTransformGetName(transform));
-        goto error;
-    }
-#else  /* XMLSEC_OPENSSL_API_300 */
-    pKeyCtx = EVP_PKEY_CTX_new_from_pkey(xmlSecOpenSSLGetLibCtx(), ctx->pKey, NULL);
-    if (pKeyCtx == NULL) {
-        xmlSecOpenSSLError("EVP_PKEY_CTX_new_from_pkey", xmlSecTransformGetName(transform));
-        goto error;
-    }
-#endif /* XMLSEC_OPENSSL_API_300 */
+    ctx = xmlSecOpenSSLEvpSignatureGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->digest != NULL, -1);
 
     if(transform->operation == xmlSecTransformOperationSign) {
         ret = EVP_PKEY_sign_init(pKeyCtx);
         if(ret <= 0) {
             xmlSecOpenSSLError2("EVP_PKEY_sign_init", xmlSecTransformGetName(transform),
                 "ret=%d", ret);
-            goto error;
+            return(-1);
         }
     } else {
         ret = EVP_PKEY_verify_init(pKeyCtx);
         if(ret <= 0) {
             xmlSecOpenSSLError2("EVP_PKEY_verify_init", xmlSecTransformGetName(transform),
                 "ret=%d", ret);
-            goto error;
+            return(-1);
         }
     }
     ret = EVP_PKEY_CTX_set_signature_md(pKeyCtx, ctx->digest);
     if(ret <= 0) {
         xmlSecOpenSSLError2("EVP_PKEY_CTX_set_signature_md", xmlSecTransformGetName(transform),
             "ret=%d", ret);
-        goto error;
+        return(-1);
     }
 
     if(ctx->mode == xmlSecOpenSSLEvpSignatureMode_RsaPadding) {
@@ -939,7 +930,7 @@ xmlSecOpenSSLEvpSignatureCreatePkeyCtx(xmlSecTransformPtr transform, xmlSecOpenS
         if(ret <= 0) {
             xmlSecOpenSSLError2("EVP_PKEY_CTX_set_rsa_padding", xmlSecTransformGetName(transform),
                 "ret=%d", ret);
-            goto error;
+            return(-1);
         }
 
         if(ctx->rsaPadding == RSA_PKCS1_PSS_PADDING) {
@@ -949,7 +940,7 @@ xmlSecOpenSSLEvpSignatureCreatePkeyCtx(xmlSecTransformPtr transform, xmlSecOpenS
             ret = EVP_MD_size(ctx->digest);
             if (ret <= 0) {
                 xmlSecOpenSSLError("EVP_MD_size", xmlSecTransformGetName(transform));
-                goto error;
+                return(-1);
             }
             saltlen = ret;
 
@@ -957,19 +948,50 @@ xmlSecOpenSSLEvpSignatureCreatePkeyCtx(xmlSecTransformPtr transform, xmlSecOpenS
             if(ret <= 0) {
                 xmlSecOpenSSLError2("EVP_PKEY_CTX_set_rsa_pss_saltlen", xmlSecTransformGetName(transform),
                     "ret=%d", ret);
-                goto error;
+                return(-1);
             }
         }
     }
 
     /* success */
-    return (pKeyCtx);
+    return(0);
+}
 
-error:
-    if(pKeyCtx != NULL) {
+static EVP_PKEY_CTX*
+xmlSecOpenSSLEvpSignatureCreatePkeyCtx(xmlSecTransformPtr transform, xmlSecOpenSSLEvpSignatureCtxPtr ctx) {
+    EVP_PKEY_CTX *pKeyCtx = NULL;
+#ifndef XMLSEC_OPENSSL_API_300
+    int ret;
+#endif /* XMLSEC_OPENSSL_API_300 */
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->digest != NULL, NULL);
+    xmlSecAssert2(ctx->pKey != NULL, NULL);
+
+#ifndef XMLSEC_OPENSSL_API_300
+    pKeyCtx = EVP_PKEY_CTX_new(ctx->pKey, NULL);
+    if (pKeyCtx == NULL) {
+        xmlSecOpenSSLError("EVP_PKEY_CTX_new", xmlSecTransformGetName(transform));
+        return(NULL);
+    }
+    ret = xmlSecOpenSSLEvpSignatureSetupPkeyCtx(pKeyCtx, transform);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLEvpSignatureSetupPkeyCtx", xmlSecTransformGetName(transform));
         EVP_PKEY_CTX_free(pKeyCtx);
+        return(NULL);
     }
-    return(NULL);
+#else  /* XMLSEC_OPENSSL_API_300 */
+    /* the setup depends only on the transform klass and operation */
+    pKeyCtx = xmlSecOpenSSLPKeyCtxNewCached(ctx->pKey, transform->id, (int)transform->operation,
+        xmlSecOpenSSLEvpSignatureSetupPkeyCtx, transform);
+    if (pKeyCtx == NULL) {
+        xmlSecInternalError("xmlSecOpenSSLPKeyCtxNewCached", xmlSecTransformGetName(transform));
+        return(NULL);
+    }
+#endif /* XMLSEC_OPENSSL_API_300 */
+
+    /* success */
+    return (pKeyCtx);
 }
 
 static int
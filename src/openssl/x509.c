@@ -27,6 +27,8 @@
 #include <errno.h>
 #include <time.h>
 
+#include <libxml/threads.h>
+
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/base64.h>
 #include <xmlsec/keys.h>
@@ -37,6 +39,7 @@
 #include <xmlsec/errors.h>
 #include <openssl/pem.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/xmltree.h>
 
 #include <xmlsec/openssl/crypto.h>
@@ -49,6 +52,7 @@
 #include <openssl/x509_vfy.h>
 #include <openssl/x509v3.h>
 #include <openssl/asn1.h>
+#include <openssl/sha.h>
 
 #ifdef OPENSSL_IS_BORINGSSL
 #include <openssl/mem.h>
@@ -72,6 +76,12 @@ static X509*            xmlSecOpenSSLX509CertDerRead            (const xmlSecByt
                                                                  xmlSecSize size);
 static X509_CRL*        xmlSecOpenSSLX509CrlDerRead             (xmlSecByte* buf,
                                                                  xmlSecSize size);
+static X509*            xmlSecOpenSSLX509CertDerReadIntern      (xmlSecKeyDataStorePtr x509Store,
+                                                                 const xmlSecByte* buf,
+                                                                 xmlSecSize size);
+static X509_CRL*        xmlSecOpenSSLX509CrlDerReadIntern       (xmlSecKeyDataStorePtr x509Store,
+                                                                 xmlSecByte* buf,
+                                                                 xmlSecSize size);
 static void             xmlSecOpenSSLX509CertDebugDump          (X509* cert,
                                                                  FILE* output);
 static void             xmlSecOpenSSLX509CertDebugXmlDump       (X509* cert,
@@ -82,12 +92,25 @@ static void             xmlSecOpenSSLX509CertDebugXmlDump       (X509* cert,
  * Internal OpenSSL X509 data CTX
  *
  ************************************************************************/
+typedef struct _xmlSecOpenSSLX509WriteCacheEntry        xmlSecOpenSSLX509WriteCacheEntry,
+                                                        *xmlSecOpenSSLX509WriteCacheEntryPtr;
+struct _xmlSecOpenSSLX509WriteCacheEntry {
+    X509*                   cert;       /* NOT OWNED */
+    int                     content;
+    xmlSecKeyX509DataValue  value;
+};
+
 typedef struct _xmlSecOpenSSLX509DataCtx                xmlSecOpenSSLX509DataCtx,
                                                         *xmlSecOpenSSLX509DataCtxPtr;
 struct _xmlSecOpenSSLX509DataCtx {
     X509*               keyCert;    /* OWNED BY certsList */
     STACK_OF(X509)*     certsList;
     STACK_OF(X509_CRL)* crlsList;
+
+    /* the serialized certs for XmlWrite, the key might be shared between threads */
+    xmlMutexPtr                         writeCacheMutex;
+    xmlSecOpenSSLX509WriteCacheEntryPtr writeCache;
+    xmlSecSize                          writeCacheSize;
 };
 
 /**************************************************************************
@@ -126,6 +149,8 @@ typedef struct _xmlSecOpenSSLKeyDataX509Context {
     xmlSecSize crlSize;
 } xmlSecOpenSSLKeyDataX509Context;
 
+static void             xmlSecOpenSSLX509WriteCacheReset        (xmlSecOpenSSLX509DataCtxPtr ctx);
+
 static int              xmlSecOpenSSLKeyDataX509Read            (xmlSecKeyDataPtr data,
                                                                  xmlSecKeyX509DataValuePtr x509Value,
                                                                  xmlSecKeysMngrPtr keysMngr,
@@ -216,6 +241,9 @@ xmlSecOpenSSLKeyDataX509AddCertInternal(xmlSecOpenSSLX509DataCtxPtr ctx, X509* c
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(cert != NULL, -1);
 
+    /* certs positions might change */
+    xmlSecOpenSSLX509WriteCacheReset(ctx);
+
     if(ctx->certsList == NULL) {
         ctx->certsList = sk_X509_new_null();
         if(ctx->certsList == NULL) {
@@ -512,6 +540,12 @@ xmlSecOpenSSLKeyDataX509Initialize(xmlSecKeyDataPtr data) {
     xmlSecAssert2(ctx != NULL, -1);
 
     memset(ctx, 0, sizeof(xmlSecOpenSSLX509DataCtx));
+
+    ctx->writeCacheMutex = xmlNewMutex();
+    if(ctx->writeCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyDataGetName(data));
+        return(-1);
+    }
     return(0);
 }
 
@@ -530,12 +564,77 @@ xmlSecOpenSSLKeyDataX509Finalize(xmlSecKeyDataPtr data) {
     if(ctx->crlsList != NULL) {
         sk_X509_CRL_pop_free(ctx->crlsList, X509_CRL_free);
     }
+    xmlSecOpenSSLX509WriteCacheReset(ctx);
+    if(ctx->writeCacheMutex != NULL) {
+        xmlFreeMutex(ctx->writeCacheMutex);
+    }
     memset(ctx, 0, sizeof(xmlSecOpenSSLX509DataCtx));
 }
 
+static STACK_OF(X509)*
+xmlSecOpenSSLX509CertsShallowCopy(STACK_OF(X509)* src) {
+    STACK_OF(X509)* res;
+    X509* cert;
+    int ii, size;
+
+    xmlSecAssert2(src != NULL, NULL);
+
+    res = sk_X509_dup(src);
+    if(res == NULL) {
+        xmlSecOpenSSLError("sk_X509_dup", NULL);
+        return(NULL);
+    }
+    size = sk_X509_num(res);
+    for(ii = 0; ii < size; ++ii) {
+        cert = sk_X509_value(res, ii);
+        if((cert != NULL) && (X509_up_ref(cert) != 1)) {
+            xmlSecOpenSSLError("X509_up_ref", NULL);
+            /* release the references we got so far */
+            while(ii > 0) {
+                --ii;
+                X509_free(sk_X509_value(res, ii));
+            }
+            sk_X509_free(res);
+            return(NULL);
+        }
+    }
+    return(res);
+}
+
+static STACK_OF(X509_CRL)*
+xmlSecOpenSSLX509CrlsShallowCopy(STACK_OF(X509_CRL)* src) {
+    STACK_OF(X509_CRL)* res;
+    X509_CRL* crl;
+    int ii, size;
+
+    xmlSecAssert2(src != NULL, NULL);
+
+    res = sk_X509_CRL_dup(src);
+    if(res == NULL) {
+        xmlSecOpenSSLError("sk_X509_CRL_dup", NULL);
+        return(NULL);
+    }
+    size = sk_X509_CRL_num(res);
+    for(ii = 0; ii < size; ++ii) {
+        crl = sk_X509_CRL_value(res, ii);
+        if((crl != NULL) && (X509_CRL_up_ref(crl) != 1)) {
+            xmlSecOpenSSLError("X509_CRL_up_ref", NULL);
+            /* release the references we got so far */
+            while(ii > 0) {
+                --ii;
+                X509_CRL_free(sk_X509_CRL_value(res, ii));
+            }
+            sk_X509_CRL_free(res);
+            return(NULL);
+        }
+    }
+    return(res);
+}
+
 static int
 xmlSecOpenSSLKeyDataX509Duplicate(xmlSecKeyDataPtr dst, xmlSecKeyDataPtr src) {
     xmlSecOpenSSLX509DataCtxPtr ctxSrc, ctxDst;
+    int shallowCopy;
 
     xmlSecAssert2(xmlSecKeyDataCheckId(dst, xmlSecOpenSSLKeyDataX509Id), -1);
     xmlSecAssert2(xmlSecKeyDataCheckId(src, xmlSecOpenSSLKeyDataX509Id), -1);
@@ -550,92 +649,111 @@ xmlSecOpenSSLKeyDataX509Duplicate(xmlSecKeyDataPtr dst, xmlSecKeyDataPtr src) {
     xmlSecAssert2(ctxDst->certsList == NULL, -1);
     xmlSecAssert2(ctxDst->crlsList == NULL, -1);
 
+    /* the certs and crls are never modified after they are added thus can be shared */
+    shallowCopy = xmlSecKeyDataX509GetDefaultShallowCopy();
+
     /* crts */
     if(ctxSrc->certsList != NULL) {
+        if(shallowCopy != 0) {
+            ctxDst->certsList = xmlSecOpenSSLX509CertsShallowCopy(ctxSrc->certsList);
+            if(ctxDst->certsList == NULL) {
+                xmlSecInternalError("xmlSecOpenSSLX509CertsShallowCopy", xmlSecKeyDataGetName(dst));
+                return(-1);
+            }
+        } else {
 #ifndef XMLSEC_OPENSSL_NO_DEEP_COPY
 #ifndef XMLSEC_OPENSSL_API_300
-        ctxDst->certsList = sk_X509_deep_copy(ctxSrc->certsList, (sk_X509_copyfunc)X509_dup, X509_free);
+            ctxDst->certsList = sk_X509_deep_copy(ctxSrc->certsList, (sk_X509_copyfunc)X509_dup, X509_free);
 #else  /* XMLSEC_OPENSSL_API_300 */
-        ctxDst->certsList = sk_X509_deep_copy(ctxSrc->certsList, X509_dup, X509_free);
+            ctxDst->certsList = sk_X509_deep_copy(ctxSrc->certsList, X509_dup, X509_free);
 #endif /* XMLSEC_OPENSSL_API_300 */
-        if(ctxDst->certsList == NULL) {
-            xmlSecOpenSSLError("sk_X509_deep_copy", xmlSecKeyDataGetName(dst));
-            return(-1);
-        }
-#else /* XMLSEC_OPENSSL_NO_DEEP_COPY */
-        int size, ii;
-        X509* certSrc;
-        X509* certDst;
-        int ret;
-
-        ctxDst->certsList = sk_X509_new_null();
-        if(ctxDst->certsList == NULL) {
-            xmlSecOpenSSLError("sk_X509_new_null", xmlSecKeyDataGetName(dst));
-            return(-1);
-        }
-        size = sk_X509_num(ctxSrc->certsList);
-        for(ii = 0; ii < size; ++ii) {
-            certSrc = sk_X509_value(ctxSrc->certsList, ii);
-            if(certSrc == NULL) {
-                continue;
-            }
-            certDst = X509_dup(certSrc);
-            if(certDst == NULL) {
-                xmlSecOpenSSLError("X509_dup", xmlSecKeyDataGetName(dst));
+            if(ctxDst->certsList == NULL) {
+                xmlSecOpenSSLError("sk_X509_deep_copy", xmlSecKeyDataGetName(dst));
                 return(-1);
             }
-            ret = sk_X509_push(ctxDst->certsList, certDst);
-            if(ret <= 0) {
-                xmlSecOpenSSLError("sk_X509_push", NULL);
-                X509_free(certDst);
+#else /* XMLSEC_OPENSSL_NO_DEEP_COPY */
+            int size, ii;
+            X509* certSrc;
+            X509* certDst;
+            int ret;
+
+            ctxDst->certsList = sk_X509_new_null();
+            if(ctxDst->certsList == NULL) {
+                xmlSecOpenSSLError("sk_X509_new_null", xmlSecKeyDataGetName(dst));
                 return(-1);
             }
-        }
+            size = sk_X509_num(ctxSrc->certsList);
+            for(ii = 0; ii < size; ++ii) {
+                certSrc = sk_X509_value(ctxSrc->certsList, ii);
+                if(certSrc == NULL) {
+                    continue;
+                }
+                certDst = X509_dup(certSrc);
+                if(certDst == NULL) {
+                    xmlSecOpenSSLError("X509_dup", xmlSecKeyDataGetName(dst));
+                    return(-1);
+                }
+                ret = sk_X509_push(ctxDst->certsList, certDst);
+                if(ret <= 0) {
+                    xmlSecOpenSSLError("sk_X509_push", NULL);
+                    X509_free(certDst);
+                    return(-1);
+                }
+            }
 #endif /* XMLSEC_OPENSSL_NO_DEEP_COPY */
+        }
     }
 
     /* crls */
     if(ctxSrc->crlsList != NULL) {
+        if(shallowCopy != 0) {
+            ctxDst->crlsList = xmlSecOpenSSLX509CrlsShallowCopy(ctxSrc->crlsList);
+            if(ctxDst->crlsList == NULL) {
+                xmlSecInternalError("xmlSecOpenSSLX509CrlsShallowCopy", xmlSecKeyDataGetName(dst));
+                return(-1);
+            }
+        } else {
 #ifndef XMLSEC_OPENSSL_NO_DEEP_COPY
 #ifndef XMLSEC_OPENSSL_API_300
-        ctxDst->crlsList = sk_X509_CRL_deep_copy(ctxSrc->crlsList, (sk_X509_CRL_copyfunc)X509_CRL_dup, X509_CRL_free);
+            ctxDst->crlsList = sk_X509_CRL_deep_copy(ctxSrc->crlsList, (sk_X509_CRL_copyfunc)X509_CRL_dup, X509_CRL_free);
 #else  /* XMLSEC_OPENSSL_API_300 */
-        ctxDst->crlsList = sk_X509_CRL_deep_copy(ctxSrc->crlsList, X509_CRL_dup, X509_CRL_free);
+            ctxDst->crlsList = sk_X509_CRL_deep_copy(ctxSrc->crlsList, X509_CRL_dup, X509_CRL_free);
 #endif /* XMLSEC_OPENSSL_API_300 */
-        if(ctxDst->crlsList == NULL) {
-            xmlSecOpenSSLError("sk_X509_CRL_deep_copy", xmlSecKeyDataGetName(dst));
-            return(-1);
-        }
-#else /* XMLSEC_OPENSSL_NO_DEEP_COPY */
-        int size, ii;
-        X509_CRL* crlSrc;
-        X509_CRL* crlDst;
-        int ret;
-
-        ctxDst->crlsList = sk_X509_CRL_new_null();
-        if(ctxDst->crlsList == NULL) {
-            xmlSecOpenSSLError("sk_X509_CRL_new_null", xmlSecKeyDataGetName(dst));
-            return(-1);
-        }
-        size = sk_X509_CRL_num(ctxSrc->crlsList);
-        for(ii = 0; ii < size; ++ii) {
-            crlSrc = sk_X509_CRL_value(ctxSrc->crlsList, ii);
-            if(crlSrc == NULL) {
-                continue;
-            }
-            crlDst = X509_CRL_dup(crlSrc);
-            if(crlDst == NULL) {
-                xmlSecOpenSSLError("X509_CRL_dup", xmlSecKeyDataGetName(dst));
+            if(ctxDst->crlsList == NULL) {
+                xmlSecOpenSSLError("sk_X509_CRL_deep_copy", xmlSecKeyDataGetName(dst));
                 return(-1);
             }
-            ret = sk_X509_CRL_push(ctxDst->crlsList, crlDst);
-            if(ret <= 0) {
-                xmlSecOpenSSLError("sk_X509_CRL_push", NULL);
-                X509_CRL_free(crlDst);
+#else /* XMLSEC_OPENSSL_NO_DEEP_COPY */
+            int size, ii;
+            X509_CRL* crlSrc;
+            X509_CRL* crlDst;
+            int ret;
+
+            ctxDst->crlsList = sk_X509_CRL_new_null();
+            if(ctxDst->crlsList == NULL) {
+                xmlSecOpenSSLError("sk_X509_CRL_new_null", xmlSecKeyDataGetName(dst));
                 return(-1);
             }
-        }
+            size = sk_X509_CRL_num(ctxSrc->crlsList);
+            for(ii = 0; ii < size; ++ii) {
+                crlSrc = sk_X509_CRL_value(ctxSrc->crlsList, ii);
+                if(crlSrc == NULL) {
+                    continue;
+                }
+                crlDst = X509_CRL_dup(crlSrc);
+                if(crlDst == NULL) {
+                    xmlSecOpenSSLError("X509_CRL_dup", xmlSecKeyDataGetName(dst));
+                    return(-1);
+                }
+                ret = sk_X509_CRL_push(ctxDst->crlsList, crlDst);
+                if(ret <= 0) {
+                    xmlSecOpenSSLError("sk_X509_CRL_push", NULL);
+                    X509_CRL_free(crlDst);
+                    return(-1);
+                }
+            }
 #endif /* XMLSEC_OPENSSL_NO_DEEP_COPY */
+        }
     }
 
     /* keyCert: should be in the same position in certsList after copy */
@@ -829,6 +947,7 @@ static int
 xmlSecOpenSSLKeyDataX509Read(xmlSecKeyDataPtr data, xmlSecKeyX509DataValuePtr x509Value,
     xmlSecKeysMngrPtr keysMngr, unsigned int flags
 ) {
+    xmlSecKeyDataStorePtr x509Store;
     X509* cert = NULL;
     X509_CRL* crl = NULL;
     int ret;
@@ -839,33 +958,34 @@ xmlSecOpenSSLKeyDataX509Read(xmlSecKeyDataPtr data, xmlSecKeyX509DataValuePtr x5
     xmlSecAssert2(x509Value != NULL, -1);
     xmlSecAssert2(keysMngr != NULL, -1);
 
+    /* the store is optional unless we need to find the cert */
+    x509Store = xmlSecKeysMngrFindDataStore(keysMngr, xmlSecOpenSSLX509StoreId);
+
     /* read CRT or CRL */
     if(xmlSecBufferGetSize(&(x509Value->cert)) > 0) {
-        cert = xmlSecOpenSSLX509CertDerRead(xmlSecBufferGetData(&(x509Value->cert)),
+        cert = xmlSecOpenSSLX509CertDerReadIntern(x509Store, xmlSecBufferGetData(&(x509Value->cert)),
             xmlSecBufferGetSize(&(x509Value->cert)));
         if(cert == NULL) {
-            xmlSecInternalError("xmlSecOpenSSLX509CertDerRead", xmlSecKeyDataGetName(data));
+            xmlSecInternalError("xmlSecOpenSSLX509CertDerReadIntern", xmlSecKeyDataGetName(data));
             goto done;
         }
     }
     if(xmlSecBufferGetSize(&(x509Value->crl)) > 0) {
-        crl = xmlSecOpenSSLX509CrlDerRead(xmlSecBufferGetData(&(x509Value->crl)),
+        crl = xmlSecOpenSSLX509CrlDerReadIntern(x509Store, xmlSecBufferGetData(&(x509Value->crl)),
             xmlSecBufferGetSize(&(x509Value->crl)));
         if(crl == NULL) {
-            xmlSecInternalError("xmlSecOpenSSLX509CrlDerRead", xmlSecKeyDataGetName(data));
+            xmlSecInternalError("xmlSecOpenSSLX509CrlDerReadIntern", xmlSecKeyDataGetName(data));
             goto done;
         }
     }
 
     /* if there is no cert in the X509Data node then try to find one */
     if(cert == NULL) {
-        xmlSecKeyDataStorePtr x509Store;
         X509* storeCert = NULL;
         int stopOnUnknownCert = 0;
 
-        x509Store = xmlSecKeysMngrGetDataStore(keysMngr, xmlSecOpenSSLX509StoreId);
         if (x509Store == NULL) {
-            xmlSecInternalError("xmlSecKeysMngrGetDataStore", xmlSecKeyDataGetName(data));
+            xmlSecInternalError("xmlSecKeysMngrFindDataStore", xmlSecKeyDataGetName(data));
             goto done;
         }
 
@@ -878,8 +998,15 @@ xmlSecOpenSSLKeyDataX509Read(xmlSecKeyDataPtr data, xmlSecKeyX509DataValuePtr x5
             xmlSecOtherError(XMLSEC_ERRORS_R_CERT_NOT_FOUND, xmlSecKeyDataGetName(data), "cert lookup");
             goto done;
         }
-        /* if we found cert in a store, then duplicate it for key data */
-        if(storeCert != NULL) {
+        /* if we found cert in a store, then share (with the intern table
+         * enabled) or duplicate it for key data */
+        if((storeCert != NULL) && (xmlSecOpenSSLX509StoreIsInternEnabled(x509Store) == 1)) {
+            if(X509_up_ref(storeCert) != 1) {
+                xmlSecOpenSSLError("X509_up_ref", xmlSecKeyDataGetName(data));
+                goto done;
+            }
+            cert = storeCert;
+        } else if(storeCert != NULL) {
             cert = X509_dup(storeCert);
             if(cert == NULL) {
                 xmlSecOpenSSLError("X509_dup", xmlSecKeyDataGetName(data));
@@ -1282,6 +1409,224 @@ xmlSecOpenSSLASN1IntegerWrite(ASN1_INTEGER *asni) {
     return(res);
 }
 
+/*************************************************************************
+ *
+ * Serialized certs cache: the same key (and certs) are usually used to
+ * sign many documents, the X509Data children values are computed once
+ * and copied for the next signatures.
+ *
+ ************************************************************************/
+static int
+xmlSecOpenSSLX509ValueCopy(xmlSecKeyX509DataValuePtr dst, xmlSecKeyX509DataValuePtr src) {
+    int ret;
+
+    xmlSecAssert2(dst != NULL, -1);
+    xmlSecAssert2(src != NULL, -1);
+
+    if(!xmlSecBufferIsEmpty(&(src->cert))) {
+        ret = xmlSecBufferSetData(&(dst->cert), xmlSecBufferGetData(&(src->cert)), xmlSecBufferGetSize(&(src->cert)));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferSetData(cert)", NULL);
+            return(-1);
+        }
+    }
+    if(!xmlSecBufferIsEmpty(&(src->ski))) {
+        ret = xmlSecBufferSetData(&(dst->ski), xmlSecBufferGetData(&(src->ski)), xmlSecBufferGetSize(&(src->ski)));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferSetData(ski)", NULL);
+            return(-1);
+        }
+    }
+    if(!xmlSecBufferIsEmpty(&(src->digest))) {
+        ret = xmlSecBufferSetData(&(dst->digest), xmlSecBufferGetData(&(src->digest)), xmlSecBufferGetSize(&(src->digest)));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferSetData(digest)", NULL);
+            return(-1);
+        }
+    }
+    if(src->subject != NULL) {
+        xmlSecAssert2(dst->subject == NULL, -1);
+        dst->subject = xmlStrdup(src->subject);
+        if(dst->subject == NULL) {
+            xmlSecStrdupError(src->subject, NULL);
+            return(-1);
+        }
+    }
+    if(src->issuerName != NULL) {
+        xmlSecAssert2(dst->issuerName == NULL, -1);
+        dst->issuerName = xmlStrdup(src->issuerName);
+        if(dst->issuerName == NULL) {
+            xmlSecStrdupError(src->issuerName, NULL);
+            return(-1);
+        }
+    }
+    if(src->issuerSerial != NULL) {
+        xmlSecAssert2(dst->issuerSerial == NULL, -1);
+        dst->issuerSerial = xmlStrdup(src->issuerSerial);
+        if(dst->issuerSerial == NULL) {
+            xmlSecStrdupError(src->issuerSerial, NULL);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static void
+xmlSecOpenSSLX509WriteCacheEntryFinalize(xmlSecOpenSSLX509WriteCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->cert == NULL) {
+        return;
+    }
+    xmlSecBufferFinalize(&(entry->value.cert));
+    xmlSecBufferFinalize(&(entry->value.crl));
+    xmlSecBufferFinalize(&(entry->value.ski));
+    xmlSecBufferFinalize(&(entry->value.digest));
+    if(entry->value.subject != NULL) {
+        xmlFree(entry->value.subject);
+    }
+    if(entry->value.issuerName != NULL) {
+        xmlFree(entry->value.issuerName);
+    }
+    if(entry->value.issuerSerial != NULL) {
+        xmlFree(entry->value.issuerSerial);
+    }
+    if(entry->value.digestAlgorithm != NULL) {
+        xmlFree(entry->value.digestAlgorithm);
+    }
+    memset(entry, 0, sizeof(*entry));
+}
+
+static void
+xmlSecOpenSSLX509WriteCacheReset(xmlSecOpenSSLX509DataCtxPtr ctx) {
+    xmlSecSize ii;
+
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->writeCache == NULL) {
+        return;
+    }
+    for(ii = 0; ii < ctx->writeCacheSize; ++ii) {
+        xmlSecOpenSSLX509WriteCacheEntryFinalize(&(ctx->writeCache[ii]));
+    }
+    xmlFree(ctx->writeCache);
+    ctx->writeCache = NULL;
+    ctx->writeCacheSize = 0;
+}
+
+/* returns 1 if the cached value was copied to @x509Value, 0 if not found or a negative value if an error occurs */
+static int
+xmlSecOpenSSLX509WriteCacheFind(xmlSecKeyDataPtr data, xmlSecSize pos, X509* cert, int content,
+    xmlSecKeyX509DataValuePtr x509Value
+) {
+    xmlSecOpenSSLX509DataCtxPtr ctx;
+    xmlSecOpenSSLX509WriteCacheEntryPtr entry;
+    int res = 0;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyDataCheckId(data, xmlSecOpenSSLKeyDataX509Id), -1);
+    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(x509Value != NULL, -1);
+
+    ctx = xmlSecOpenSSLX509DataGetCtx(data);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->writeCacheMutex != NULL, -1);
+
+    xmlMutexLock(ctx->writeCacheMutex);
+    if((ctx->writeCache == NULL) || (pos >= ctx->writeCacheSize)) {
+        goto done;
+    }
+    entry = &(ctx->writeCache[pos]);
+    if((entry->cert != cert) || (entry->content != content) ||
+       (xmlStrEqual(entry->value.digestAlgorithm, x509Value->digestAlgorithm) != 1)
+    ) {
+        goto done;
+    }
+
+    ret = xmlSecOpenSSLX509ValueCopy(x509Value, &(entry->value));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509ValueCopy", xmlSecKeyDataGetName(data));
+        res = -1;
+        goto done;
+    }
+
+    /* found */
+    res = 1;
+
+done:
+    if(ctx->writeCache != NULL) {
+        xmlSecStatsCacheLookup(xmlSecStatsCacheX509Write, (res > 0) ? 1 : 0);
+    }
+    xmlMutexUnlock(ctx->writeCacheMutex);
+    return(res);
+}
+
+/* not fatal if the value can't be cached */
+static void
+xmlSecOpenSSLX509WriteCacheAdd(xmlSecKeyDataPtr data, xmlSecSize pos, X509* cert, int content,
+    xmlSecKeyX509DataValuePtr x509Value
+) {
+    xmlSecOpenSSLX509DataCtxPtr ctx;
+    xmlSecOpenSSLX509WriteCacheEntryPtr entry;
+    xmlSecSize size;
+    int ret;
+
+    xmlSecAssert(xmlSecKeyDataCheckId(data, xmlSecOpenSSLKeyDataX509Id));
+    xmlSecAssert(cert != NULL);
+    xmlSecAssert(x509Value != NULL);
+
+    ctx = xmlSecOpenSSLX509DataGetCtx(data);
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->writeCacheMutex != NULL);
+
+    xmlMutexLock(ctx->writeCacheMutex);
+    if(ctx->writeCache == NULL) {
+        size = xmlSecOpenSSLKeyDataX509GetCertsSize(data);
+        if(pos >= size) {
+            goto done;
+        }
+        ctx->writeCache = (xmlSecOpenSSLX509WriteCacheEntryPtr)xmlMalloc(sizeof(xmlSecOpenSSLX509WriteCacheEntry) * size);
+        if(ctx->writeCache == NULL) {
+            goto done;
+        }
+        memset(ctx->writeCache, 0, sizeof(xmlSecOpenSSLX509WriteCacheEntry) * size);
+        ctx->writeCacheSize = size;
+    }
+    if(pos >= ctx->writeCacheSize) {
+        goto done;
+    }
+
+    /* replace the old value (if any) */
+    entry = &(ctx->writeCache[pos]);
+    xmlSecOpenSSLX509WriteCacheEntryFinalize(entry);
+
+    entry->cert = cert;
+    entry->content = content;
+    if((xmlSecBufferInitialize(&(entry->value.cert), 0) < 0) ||
+       (xmlSecBufferInitialize(&(entry->value.crl), 0) < 0) ||
+       (xmlSecBufferInitialize(&(entry->value.ski), 0) < 0) ||
+       (xmlSecBufferInitialize(&(entry->value.digest), 0) < 0)
+    ) {
+        xmlSecOpenSSLX509WriteCacheEntryFinalize(entry);
+        goto done;
+    }
+    if(x509Value->digestAlgorithm != NULL) {
+        entry->value.digestAlgorithm = xmlStrdup(x509Value->digestAlgorithm);
+        if(entry->value.digestAlgorithm == NULL) {
+            xmlSecOpenSSLX509WriteCacheEntryFinalize(entry);
+            goto done;
+        }
+    }
+    ret = xmlSecOpenSSLX509ValueCopy(&(entry->value), x509Value);
+    if(ret < 0) {
+        xmlSecOpenSSLX509WriteCacheEntryFinalize(entry);
+        goto done;
+    }
+
+done:
+    xmlMutexUnlock(ctx->writeCacheMutex);
+}
+
 /* xmlSecKeyDataX509Write: returns 1 on success, 0 if no more certs/crls are available,
  * or a negative value if an error occurs.
  */
@@ -1306,6 +1651,19 @@ xmlSecOpenSSLKeyDataX509Write(xmlSecKeyDataPtr data,  xmlSecKeyX509DataValuePtr
                 "pos=" XMLSEC_SIZE_FMT, ctx->crtPos);
             return(-1);
         }
+
+        /* the cert is serialized once for all signatures */
+        ret = xmlSecOpenSSLX509WriteCacheFind(data, ctx->crtPos, cert, content, x509Value);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecOpenSSLX509WriteCacheFind",
+                xmlSecKeyDataGetName(data),
+                "pos=" XMLSEC_SIZE_FMT, ctx->crtPos);
+            return(-1);
+        } else if(ret == 1) {
+            ++ctx->crtPos;
+            return(1);
+        }
+
         if (XMLSEC_X509DATA_HAS_EMPTY_NODE(content, XMLSEC_X509DATA_CERTIFICATE_NODE)) {
             ret = xmlSecOpenSSLX509CertDerWrite(cert, &(x509Value->cert));
             if(ret < 0) {
@@ -1363,6 +1721,9 @@ xmlSecOpenSSLKeyDataX509Write(xmlSecKeyDataPtr data,  xmlSecKeyX509DataValuePtr
                 return(-1);
             }
         }
+
+        /* not fatal if we can't cache it */
+        xmlSecOpenSSLX509WriteCacheAdd(data, ctx->crtPos, cert, content, x509Value);
         ++ctx->crtPos;
     } else if(ctx->crlPos < ctx->crlSize) {
         /* write crl */
@@ -1571,9 +1932,9 @@ xmlSecOpenSSLVerifyAndAdoptX509KeyData(xmlSecKeyPtr key, xmlSecKeyDataPtr data,
     }
 
     /* lets find a cert we can verify */
-    x509Store = xmlSecKeysMngrGetDataStore(keyInfoCtx->keysMngr, xmlSecOpenSSLX509StoreId);
+    x509Store = xmlSecKeysMngrFindDataStore(keyInfoCtx->keysMngr, xmlSecOpenSSLX509StoreId);
     if(x509Store == NULL) {
-        xmlSecInternalError("xmlSecKeysMngrGetDataStore", xmlSecKeyDataGetName(data));
+        xmlSecInternalError("xmlSecKeysMngrFindDataStore", xmlSecKeyDataGetName(data));
         return(-1);
     }
     cert = xmlSecOpenSSLX509StoreVerify(x509Store, ctx->certsList, ctx->crlsList, keyInfoCtx);
@@ -1587,12 +1948,20 @@ xmlSecOpenSSLVerifyAndAdoptX509KeyData(xmlSecKeyPtr key, xmlSecKeyDataPtr data,
     }
 
     /* set cert into the x509 data, we don't know if the cert is already in KeyData or not
-     * so assume we need to add it again.
+     * so assume we need to add it again (sharing the cert if the intern table is enabled).
      */
-    keyCert = X509_dup(cert);
-    if(keyCert == NULL) {
-        xmlSecOpenSSLError("X509_dup", xmlSecKeyDataGetName(data));
-        return(-1);
+    if(xmlSecOpenSSLX509StoreIsInternEnabled(x509Store) == 1) {
+        if(X509_up_ref(cert) != 1) {
+            xmlSecOpenSSLError("X509_up_ref", xmlSecKeyDataGetName(data));
+            return(-1);
+        }
+        keyCert = cert;
+    } else {
+        keyCert = X509_dup(cert);
+        if(keyCert == NULL) {
+            xmlSecOpenSSLError("X509_dup", xmlSecKeyDataGetName(data));
+            return(-1);
+        }
     }
     ret = xmlSecOpenSSLKeyDataX509AdoptKeyCert(data, keyCert);
     if(ret < 0) {
@@ -1783,14 +2152,162 @@ done:
     return(res);
 }
 
+/**************************************************************************
+ *
+ * Parsed certificates cache (disabled by default): the same few certificates
+ * are usually included in every document. The cache maps the SHA256 digest
+ * of the DER bytes to the parsed X509 object and returns a new reference to
+ * it. OpenSSL keeps the decoded public key inside X509 object, thus it is
+ * shared as well.
+ *
+ *************************************************************************/
+typedef struct _xmlSecOpenSSLX509CertCacheEntry {
+    xmlSecByte          digest[SHA256_DIGEST_LENGTH];
+    xmlSecSize          size;
+    X509*               cert;
+} xmlSecOpenSSLX509CertCacheEntry, *xmlSecOpenSSLX509CertCacheEntryPtr;
+
+static xmlMutexPtr                          gXmlSecOpenSSLX509CertCacheMutex = NULL;
+static xmlSecOpenSSLX509CertCacheEntryPtr   gXmlSecOpenSSLX509CertCacheEntries = NULL;
+static xmlSecSize                           gXmlSecOpenSSLX509CertCacheMaxSize = 0;
+static xmlSecSize                           gXmlSecOpenSSLX509CertCachePos = 0;
+
+/**
+ * xmlSecOpenSSLKeyDataX509EnableCertsCache:
+ * @maxSize:            the max number of cached certificates.
+ *
+ * Enables the process wide cache of the parsed &lt;dsig:X509Certificate/&gt;
+ * certificates: the certificates with the same DER bytes are parsed once
+ * and shared (reference counted) between the keys. This function is not
+ * thread safe and should be called during the application initialization.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLKeyDataX509EnableCertsCache(xmlSecSize maxSize) {
+    xmlSecAssert2(maxSize > 0, -1);
+
+    xmlSecOpenSSLKeyDataX509DisableCertsCache();
+
+    gXmlSecOpenSSLX509CertCacheEntries = (xmlSecOpenSSLX509CertCacheEntryPtr)xmlMalloc(sizeof(xmlSecOpenSSLX509CertCacheEntry) * maxSize);
+    if(gXmlSecOpenSSLX509CertCacheEntries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecOpenSSLX509CertCacheEntry) * maxSize, NULL);
+        return(-1);
+    }
+    memset(gXmlSecOpenSSLX509CertCacheEntries, 0, sizeof(xmlSecOpenSSLX509CertCacheEntry) * maxSize);
+
+    gXmlSecOpenSSLX509CertCacheMutex = xmlNewMutex();
+    if(gXmlSecOpenSSLX509CertCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(gXmlSecOpenSSLX509CertCacheEntries);
+        gXmlSecOpenSSLX509CertCacheEntries = NULL;
+        return(-1);
+    }
+    gXmlSecOpenSSLX509CertCacheMaxSize = maxSize;
+    gXmlSecOpenSSLX509CertCachePos = 0;
+    return(0);
+}
+
+/**
+ * xmlSecOpenSSLKeyDataX509DisableCertsCache:
+ *
+ * Disables the parsed certificates cache and releases the cached certificates.
+ * This function is not thread safe and is called from #xmlSecOpenSSLShutdown.
+ */
+void
+xmlSecOpenSSLKeyDataX509DisableCertsCache(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecOpenSSLX509CertCacheEntries != NULL) {
+        for(ii = 0; ii < gXmlSecOpenSSLX509CertCacheMaxSize; ++ii) {
+            if(gXmlSecOpenSSLX509CertCacheEntries[ii].cert != NULL) {
+                X509_free(gXmlSecOpenSSLX509CertCacheEntries[ii].cert);
+            }
+        }
+        xmlFree(gXmlSecOpenSSLX509CertCacheEntries);
+        gXmlSecOpenSSLX509CertCacheEntries = NULL;
+    }
+    if(gXmlSecOpenSSLX509CertCacheMutex != NULL) {
+        xmlFreeMutex(gXmlSecOpenSSLX509CertCacheMutex);
+        gXmlSecOpenSSLX509CertCacheMutex = NULL;
+    }
+    gXmlSecOpenSSLX509CertCacheMaxSize = 0;
+    gXmlSecOpenSSLX509CertCachePos = 0;
+}
+
+/* returns a new reference to the cached cert or NULL if not found */
+static X509*
+xmlSecOpenSSLX509CertCacheFind(const xmlSecByte* digest, xmlSecSize size) {
+    X509* res = NULL;
+    xmlSecSize ii;
+
+    xmlSecAssert2(digest != NULL, NULL);
+    xmlSecAssert2(gXmlSecOpenSSLX509CertCacheMutex != NULL, NULL);
+
+    xmlMutexLock(gXmlSecOpenSSLX509CertCacheMutex);
+    for(ii = 0; ii < gXmlSecOpenSSLX509CertCacheMaxSize; ++ii) {
+        xmlSecOpenSSLX509CertCacheEntryPtr entry = &(gXmlSecOpenSSLX509CertCacheEntries[ii]);
+        if((entry->cert != NULL) && (entry->size == size) &&
+           (memcmp(entry->digest, digest, sizeof(entry->digest)) == 0) &&
+           (X509_up_ref(entry->cert) == 1)
+        ) {
+            res = entry->cert;
+            break;
+        }
+    }
+    xmlMutexUnlock(gXmlSecOpenSSLX509CertCacheMutex);
+    return(res);
+}
+
+/* not fatal if the cert can't be cached */
+static void
+xmlSecOpenSSLX509CertCacheAdd(const xmlSecByte* digest, xmlSecSize size, X509* cert) {
+    xmlSecOpenSSLX509CertCacheEntryPtr entry;
+
+    xmlSecAssert(digest != NULL);
+    xmlSecAssert(cert != NULL);
+    xmlSecAssert(gXmlSecOpenSSLX509CertCacheMutex != NULL);
+
+    if(X509_up_ref(cert) != 1) {
+        return;
+    }
+
+    xmlMutexLock(gXmlSecOpenSSLX509CertCacheMutex);
+    if(gXmlSecOpenSSLX509CertCachePos >= gXmlSecOpenSSLX509CertCacheMaxSize) {
+        gXmlSecOpenSSLX509CertCachePos = 0;
+    }
+    entry = &(gXmlSecOpenSSLX509CertCacheEntries[gXmlSecOpenSSLX509CertCachePos++]);
+    if(entry->cert != NULL) {
+        X509_free(entry->cert);
+    }
+    memcpy(entry->digest, digest, sizeof(entry->digest));
+    entry->size = size;
+    entry->cert = cert;
+    xmlMutexUnlock(gXmlSecOpenSSLX509CertCacheMutex);
+}
+
 static X509*
 xmlSecOpenSSLX509CertDerRead(const xmlSecByte* buf, xmlSecSize size) {
+    xmlSecByte digest[SHA256_DIGEST_LENGTH];
     X509 *cert = NULL;
     BIO * bio = NULL;
 
     xmlSecAssert2(buf != NULL, NULL);
     xmlSecAssert2(size > 0, NULL);
 
+    /* check the cache first */
+    if(gXmlSecOpenSSLX509CertCacheMutex != NULL) {
+        if(SHA256(buf, size, digest) == NULL) {
+            xmlSecOpenSSLError("SHA256", NULL);
+            goto done;
+        }
+        cert = xmlSecOpenSSLX509CertCacheFind(digest, size);
+        xmlSecStatsCacheLookup(xmlSecStatsCacheX509Cert, (cert != NULL) ? 1 : 0);
+        if(cert != NULL) {
+            goto done;
+        }
+    }
+
     bio = xmlSecOpenSSLCreateMemBufBio(buf, size);
     if(bio == NULL) {
         xmlSecInternalError2("xmlSecOpenSSLCreateMemBufBio", NULL,
@@ -1804,6 +2321,10 @@ xmlSecOpenSSLX509CertDerRead(const xmlSecByte* buf, xmlSecSize size) {
         goto done;
     }
 
+    if(gXmlSecOpenSSLX509CertCacheMutex != NULL) {
+        xmlSecOpenSSLX509CertCacheAdd(digest, size, cert);
+    }
+
 done:
     if(bio != NULL) {
         BIO_free_all(bio);
@@ -1839,6 +2360,181 @@ done:
     return(crl);
 }
 
+/* reads the cert using the intern table of the @x509Store if it is enabled */
+static X509*
+xmlSecOpenSSLX509CertDerReadIntern(xmlSecKeyDataStorePtr x509Store, const xmlSecByte* buf, xmlSecSize size) {
+    xmlSecByte digest[SHA256_DIGEST_LENGTH];
+    X509 *cert;
+
+    xmlSecAssert2(buf != NULL, NULL);
+    xmlSecAssert2(size > 0, NULL);
+
+    if(xmlSecOpenSSLX509StoreIsInternEnabled(x509Store) != 1) {
+        return(xmlSecOpenSSLX509CertDerRead(buf, size));
+    }
+
+    if(SHA256(buf, size, digest) == NULL) {
+        xmlSecOpenSSLError("SHA256", NULL);
+        return(NULL);
+    }
+    cert = xmlSecOpenSSLX509StoreInternFindCert(x509Store, digest, size);
+    if(cert != NULL) {
+        return(cert);
+    }
+
+    cert = xmlSecOpenSSLX509CertDerRead(buf, size);
+    if(cert == NULL) {
+        xmlSecInternalError("xmlSecOpenSSLX509CertDerRead", NULL);
+        return(NULL);
+    }
+    return(xmlSecOpenSSLX509StoreInternAddCert(x509Store, digest, size, cert));
+}
+
+/* reads the CRL using the intern table of the @x509Store if it is enabled */
+static X509_CRL*
+xmlSecOpenSSLX509CrlDerReadIntern(xmlSecKeyDataStorePtr x509Store, xmlSecByte* buf, xmlSecSize size) {
+    xmlSecByte digest[SHA256_DIGEST_LENGTH];
+    X509_CRL *crl;
+
+    xmlSecAssert2(buf != NULL, NULL);
+    xmlSecAssert2(size > 0, NULL);
+
+    if(xmlSecOpenSSLX509StoreIsInternEnabled(x509Store) != 1) {
+        return(xmlSecOpenSSLX509CrlDerRead(buf, size));
+    }
+
+    if(SHA256(buf, size, digest) == NULL) {
+        xmlSecOpenSSLError("SHA256", NULL);
+        return(NULL);
+    }
+    crl = xmlSecOpenSSLX509StoreInternFindCrl(x509Store, digest, size);
+    if(crl != NULL) {
+        return(crl);
+    }
+
+    crl = xmlSecOpenSSLX509CrlDerRead(buf, size);
+    if(crl == NULL) {
+        xmlSecInternalError("xmlSecOpenSSLX509CrlDerRead", NULL);
+        return(NULL);
+    }
+    return(xmlSecOpenSSLX509StoreInternAddCrl(x509Store, digest, size, crl));
+}
+
+/**
+ * xmlSecOpenSSLKeyDataX509Intern:
+ * @data:               the pointer to X509 key data.
+ * @x509Store:          the pointer to OpenSSL x509 store with the intern table enabled.
+ *
+ * Replaces the certificates and CRLs in @data with the identical ones
+ * from the intern table of @x509Store (or adds them to the intern table).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLKeyDataX509Intern(xmlSecKeyDataPtr data, xmlSecKeyDataStorePtr x509Store) {
+    xmlSecOpenSSLX509DataCtxPtr ctx;
+    xmlSecByte digest[SHA256_DIGEST_LENGTH];
+    unsigned char* der = NULL;
+    X509* cert;
+    X509* interned;
+    X509_CRL* crl;
+    X509_CRL* internedCrl;
+    xmlSecSize size;
+    int ii, len;
+    int res = -1;
+
+    xmlSecAssert2(xmlSecKeyDataCheckId(data, xmlSecOpenSSLKeyDataX509Id), -1);
+    xmlSecAssert2(xmlSecOpenSSLX509StoreIsInternEnabled(x509Store) == 1, -1);
+
+    ctx = xmlSecOpenSSLX509DataGetCtx(data);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    /* certs might change */
+    xmlSecOpenSSLX509WriteCacheReset(ctx);
+
+    for(ii = 0; (ctx->certsList != NULL) && (ii < sk_X509_num(ctx->certsList)); ++ii) {
+        cert = sk_X509_value(ctx->certsList, ii);
+        xmlSecAssert2(cert != NULL, -1);
+
+        len = i2d_X509(cert, &der);
+        if((len <= 0) || (der == NULL)) {
+            xmlSecOpenSSLError("i2d_X509", xmlSecKeyDataGetName(data));
+            goto done;
+        }
+        XMLSEC_SAFE_CAST_INT_TO_SIZE(len, size, goto done, xmlSecKeyDataGetName(data));
+        if(SHA256(der, size, digest) == NULL) {
+            xmlSecOpenSSLError("SHA256", xmlSecKeyDataGetName(data));
+            goto done;
+        }
+        OPENSSL_free(der);
+        der = NULL;
+
+        interned = xmlSecOpenSSLX509StoreInternFindCert(x509Store, digest, size);
+        if(interned == NULL) {
+            if(X509_up_ref(cert) != 1) {
+                xmlSecOpenSSLError("X509_up_ref", xmlSecKeyDataGetName(data));
+                goto done;
+            }
+            interned = xmlSecOpenSSLX509StoreInternAddCert(x509Store, digest, size, cert);
+        }
+        if(interned == cert) {
+            X509_free(interned);
+            continue;
+        }
+
+        /* replace the cert with the interned one */
+        (void)sk_X509_set(ctx->certsList, ii, interned);
+        if(ctx->keyCert == cert) {
+            ctx->keyCert = interned;
+        }
+        X509_free(cert);
+    }
+
+    for(ii = 0; (ctx->crlsList != NULL) && (ii < sk_X509_CRL_num(ctx->crlsList)); ++ii) {
+        crl = sk_X509_CRL_value(ctx->crlsList, ii);
+        xmlSecAssert2(crl != NULL, -1);
+
+        len = i2d_X509_CRL(crl, &der);
+        if((len <= 0) || (der == NULL)) {
+            xmlSecOpenSSLError("i2d_X509_CRL", xmlSecKeyDataGetName(data));
+            goto done;
+        }
+        XMLSEC_SAFE_CAST_INT_TO_SIZE(len, size, goto done, xmlSecKeyDataGetName(data));
+        if(SHA256(der, size, digest) == NULL) {
+            xmlSecOpenSSLError("SHA256", xmlSecKeyDataGetName(data));
+            goto done;
+        }
+        OPENSSL_free(der);
+        der = NULL;
+
+        internedCrl = xmlSecOpenSSLX509StoreInternFindCrl(x509Store, digest, size);
+        if(internedCrl == NULL) {
+            if(X509_CRL_up_ref(crl) != 1) {
+                xmlSecOpenSSLError("X509_CRL_up_ref", xmlSecKeyDataGetName(data));
+                goto done;
+            }
+            internedCrl = xmlSecOpenSSLX509StoreInternAddCrl(x509Store, digest, size, crl);
+        }
+        if(internedCrl == crl) {
+            X509_CRL_free(internedCrl);
+            continue;
+        }
+
+        /* replace the CRL with the interned one */
+        (void)sk_X509_CRL_set(ctx->crlsList, ii, internedCrl);
+        X509_CRL_free(crl);
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(der != NULL) {
+        OPENSSL_free(der);
+    }
+    return(res);
+}
+
 static void
 xmlSecOpenSSLX509CertDebugDump(X509* cert, FILE* output) {
     char buf[1024];
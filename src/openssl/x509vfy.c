@@ -21,6 +21,9 @@
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <time.h>
+
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/keys.h>
@@ -29,8 +32,10 @@
 #include <xmlsec/base64.h>
 #include <xmlsec/errors.h>
 #include <xmlsec/private.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/xmltree.h>
 
+#include <xmlsec/openssl/app.h>
 #include <xmlsec/openssl/crypto.h>
 #include <xmlsec/openssl/evp.h>
 #include <xmlsec/openssl/x509.h>
@@ -40,6 +45,10 @@
 #include <openssl/x509.h>
 #include <openssl/x509_vfy.h>
 #include <openssl/x509v3.h>
+#include <openssl/sha.h>
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+#include <openssl/ocsp.h>
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
 
 #include "../cast_helpers.h"
 #include "openssl_compat.h"
@@ -51,6 +60,90 @@ typedef size_t x509_size_t;
 typedef int x509_size_t;
 #endif /* OPENSSL_IS_BORINGSSL */
 
+/**************************************************************************
+ *
+ * Verification results cache: the successful verifications are identified
+ * by the leaf cert digest, the digest of the certs from the document and
+ * the verification params. The store certs and CRLs are not part of the
+ * id, the cache is flushed when they change.
+ *
+ *************************************************************************/
+typedef struct _xmlSecOpenSSLX509VerifyCacheEntry       xmlSecOpenSSLX509VerifyCacheEntry,
+                                                        *xmlSecOpenSSLX509VerifyCacheEntryPtr;
+struct _xmlSecOpenSSLX509VerifyCacheEntry {
+    int                 used;
+    xmlSecByte          leafDigest[SHA256_DIGEST_LENGTH];
+    xmlSecByte          certsDigest[SHA256_DIGEST_LENGTH];
+    time_t              verificationTime;
+    int                 verificationDepth;
+    time_t              expires;
+};
+
+/**************************************************************************
+ *
+ * CRLs verification results cache (enabled with the verification results
+ * cache): the CRL signature verification results are identified by the
+ * CRL digest and the issuer certificate digest. The results do not depend
+ * on the time or the store certs (the CRLs validity is checked for each
+ * certificate verification), thus the entries are only evicted when the
+ * cache is full.
+ *
+ *************************************************************************/
+typedef struct _xmlSecOpenSSLX509CrlCacheEntry          xmlSecOpenSSLX509CrlCacheEntry,
+                                                        *xmlSecOpenSSLX509CrlCacheEntryPtr;
+struct _xmlSecOpenSSLX509CrlCacheEntry {
+    int                 used;
+    xmlSecByte          crlDigest[SHA256_DIGEST_LENGTH];
+    xmlSecByte          issuerDigest[SHA256_DIGEST_LENGTH];
+    int                 verified;
+};
+
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+/**************************************************************************
+ *
+ * OCSP responses cache (disabled by default): the single responses from the
+ * validated OCSP responses added by the application are identified by the
+ * OCSP cert id (the issuer name and key hashes and the serial number) and
+ * indexed by the serial number. The entries expire at the response
+ * nextUpdate and are replaced by the newer responses for the same cert.
+ *
+ *************************************************************************/
+#define XMLSEC_OPENSSL_X509_OCSP_MIN_SIZE               64
+#define XMLSEC_OPENSSL_X509_OCSP_MAX_SKEW               300     /* seconds */
+
+typedef struct _xmlSecOpenSSLX509OcspEntry              xmlSecOpenSSLX509OcspEntry,
+                                                        *xmlSecOpenSSLX509OcspEntryPtr;
+struct _xmlSecOpenSSLX509OcspEntry {
+    xmlSecOpenSSLX509OcspEntryPtr next;
+    xmlSecSize          hash;
+    OCSP_CERTID*        id;
+    int                 status;         /* V_OCSP_CERTSTATUS_* */
+    time_t              revocationTime;
+    time_t              thisUpdate;
+    time_t              nextUpdate;
+};
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
+
+/**************************************************************************
+ *
+ * Intern table (disabled by default): the certificates and CRLs read for
+ * the keys loaded with the keys manager are identified by the SHA256 digest
+ * of the DER bytes and the identical ones are parsed once and shared
+ * (reference counted) by all the keys. The entries are kept until the
+ * store is destroyed.
+ *
+ *************************************************************************/
+#define XMLSEC_OPENSSL_X509_INTERN_MIN_SIZE             64
+
+typedef struct _xmlSecOpenSSLX509InternEntry            xmlSecOpenSSLX509InternEntry,
+                                                        *xmlSecOpenSSLX509InternEntryPtr;
+struct _xmlSecOpenSSLX509InternEntry {
+    xmlSecByte          digest[SHA256_DIGEST_LENGTH];
+    xmlSecSize          size;
+    X509*               cert;
+    X509_CRL*           crl;
+};
+
 /**************************************************************************
  *
  * Internal OpenSSL X509 store CTX
@@ -63,6 +156,38 @@ struct _xmlSecOpenSSLX509StoreCtx {
     STACK_OF(X509)*     untrusted;
     STACK_OF(X509_CRL)* crls;
     X509_VERIFY_PARAM * vpm;
+
+    /* untrusted certs indexes: the lookups by subject name, issuer name and
+     * serial number, SKI and digest are done through the hash indexes */
+    xmlSecOpenSSLX509CertsIndex             certsIndex;
+
+    /* verification results cache (disabled by default) */
+    xmlMutexPtr                             verifyCacheMutex;
+    xmlSecOpenSSLX509VerifyCacheEntryPtr    verifyCache;
+    xmlSecSize                              verifyCacheMaxSize;
+    xmlSecSize                              verifyCachePos;
+    xmlSecOpenSSLX509CrlCacheEntryPtr       crlCache;   /* same size and mutex as verifyCache */
+    xmlSecSize                              crlCachePos;
+
+    /* certificates and CRLs intern table (disabled by default) */
+    xmlMutexPtr                             internMutex;
+    xmlSecOpenSSLX509InternEntryPtr         intern;     /* open addressing hash table */
+    xmlSecSize                              internTableSize;
+    xmlSecSize                              internSize;
+
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+    /* OCSP responses cache (disabled by default) */
+    xmlMutexPtr                             ocspMutex;
+    xmlSecOpenSSLX509OcspEntryPtr*          ocsp;       /* hash table with the entries chains */
+    xmlSecSize                              ocspTableSize;
+    xmlSecSize                              ocspSize;
+    int                                     ocspRequired;
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
+
+    /* the default trusted certs are loaded on the first verification
+     * if the deferred initialization is enabled */
+    xmlMutexPtr                             defaultPathsMutex;
+    int                                     defaultPathsPending;
 };
 
 /****************************************************************************
@@ -75,6 +200,7 @@ XMLSEC_KEY_DATA_STORE_DECLARE(OpenSSLX509Store, xmlSecOpenSSLX509StoreCtx)
 
 static int              xmlSecOpenSSLX509StoreInitialize        (xmlSecKeyDataStorePtr store);
 static void             xmlSecOpenSSLX509StoreFinalize          (xmlSecKeyDataStorePtr store);
+static int              xmlSecOpenSSLX509StoreLoadDefaultPaths  (xmlSecOpenSSLX509StoreCtxPtr ctx);
 
 static xmlSecKeyDataStoreKlass xmlSecOpenSSLX509StoreKlass = {
     sizeof(xmlSecKeyDataStoreKlass),
@@ -92,7 +218,7 @@ static xmlSecKeyDataStoreKlass xmlSecOpenSSLX509StoreKlass = {
     NULL,                                       /* void* reserved1; */
 };
 
-static int              xmlSecOpenSSLX509VerifyCRL                      (X509_STORE* xst,
+static int              xmlSecOpenSSLX509VerifyCRL                      (xmlSecOpenSSLX509StoreCtxPtr ctx,
                                                                          X509_STORE_CTX* xsc,
                                                                          STACK_OF(X509)* untrusted,
                                                                          X509_CRL *crl,
@@ -100,6 +226,7 @@ static int              xmlSecOpenSSLX509VerifyCRL                      (X509_ST
 static X509*            xmlSecOpenSSLX509FindChildCert                  (STACK_OF(X509) *chain,
                                                                          X509 *cert);
 static X509_NAME*       xmlSecOpenSSLX509NameRead                       (const xmlChar *str);
+static X509_NAME*       xmlSecOpenSSLX509NameReadCached                 (const xmlChar *str);
 static int              xmlSecOpenSSLX509NameStringRead                 (const xmlChar **in,
                                                                          xmlSecSize *inSize,
                                                                          xmlSecByte *out,
@@ -117,6 +244,9 @@ static int              xmlSecOpenSSLX509_NAME_ENTRY_cmp                (const X
 
 static STACK_OF(X509)*  xmlSecOpenSSLX509StoreCombineCerts              (STACK_OF(X509)* certs1,
                                                                          STACK_OF(X509)* certs2);
+
+static X509*            xmlSecOpenSSLX509StoreFindCertInIndex           (xmlSecOpenSSLX509StoreCtxPtr ctx,
+                                                                         xmlSecOpenSSLX509FindCertCtxPtr findCertCtx);
 /**
  * xmlSecOpenSSLX509StoreGetKlass:
  *
@@ -192,7 +322,6 @@ xmlSecOpenSSLX509StoreFindCert_ex(xmlSecKeyDataStorePtr store,
 ) {
     xmlSecOpenSSLX509StoreCtxPtr ctx;
     xmlSecOpenSSLX509FindCertCtx findCertCtx;
-    x509_size_t ii;
     int ret;
     X509* res = NULL;
 
@@ -215,22 +344,7 @@ xmlSecOpenSSLX509StoreFindCert_ex(xmlSecKeyDataStorePtr store,
         xmlSecOpenSSLX509FindCertCtxFinalize(&findCertCtx);
         return(NULL);
     }
-    for(ii = 0; ii < sk_X509_num(ctx->untrusted); ++ii) {
-        X509 * cert = sk_X509_value(ctx->untrusted, ii);
-        if(cert == NULL) {
-            continue;
-        }
-
-        ret = xmlSecOpenSSLX509FindCertCtxMatch(&findCertCtx, cert);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecOpenSSLX509FindCertCtxMatch", NULL);
-            xmlSecOpenSSLX509FindCertCtxFinalize(&findCertCtx);
-            return(NULL);
-        } else if(ret == 1) {
-            res = cert;
-            break;
-        }
-    }
+    res = xmlSecOpenSSLX509StoreFindCertInIndex(ctx, &findCertCtx);
 
     /* done */
     xmlSecOpenSSLX509FindCertCtxFinalize(&findCertCtx);
@@ -241,7 +355,6 @@ X509*
 xmlSecOpenSSLX509StoreFindCertByValue(xmlSecKeyDataStorePtr store, xmlSecKeyX509DataValuePtr x509Value) {
     xmlSecOpenSSLX509StoreCtxPtr ctx;
     xmlSecOpenSSLX509FindCertCtx findCertCtx;
-    x509_size_t ii;
     int ret;
     X509* res = NULL;
 
@@ -262,36 +375,45 @@ xmlSecOpenSSLX509StoreFindCertByValue(xmlSecKeyDataStorePtr store, xmlSecKeyX509
         xmlSecOpenSSLX509FindCertCtxFinalize(&findCertCtx);
         return(NULL);
     }
-    for(ii = 0; ii < sk_X509_num(ctx->untrusted); ++ii) {
-        X509 * cert = sk_X509_value(ctx->untrusted, ii);
-        if(cert == NULL) {
-            continue;
-        }
-
-        ret = xmlSecOpenSSLX509FindCertCtxMatch(&findCertCtx, cert);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecOpenSSLX509FindCertCtxMatch", NULL);
-            xmlSecOpenSSLX509FindCertCtxFinalize(&findCertCtx);
-            return(NULL);
-        } else if(ret == 1) {
-            res = cert;
-            break;
-        }
-    }
+    res = xmlSecOpenSSLX509StoreFindCertInIndex(ctx, &findCertCtx);
 
     /* done */
     xmlSecOpenSSLX509FindCertCtxFinalize(&findCertCtx);
     return(res);
 }
 
+static X509*
+xmlSecOpenSSLX509GetKeyCert(void* certsCtx, xmlSecSize pos) {
+    xmlSecPtrListPtr keysList = (xmlSecPtrListPtr)certsCtx;
+    xmlSecKeyPtr key;
+    xmlSecKeyDataPtr keyData;
+
+    xmlSecAssert2(keysList != NULL, NULL);
+
+    /* get key's cert from x509 key data */
+    key = (xmlSecKeyPtr)xmlSecPtrListGetItem(keysList, pos);
+    if(key == NULL) {
+        return(NULL);
+    }
+    keyData = xmlSecKeyGetData(key, xmlSecOpenSSLKeyDataX509Id);
+    if(keyData == NULL) {
+        return(NULL);
+    }
+    return(xmlSecOpenSSLKeyDataX509GetKeyCert(keyData));
+}
+
+/* @keysIndex should index the key certs for all the keys in @keysList */
 xmlSecKeyPtr
-xmlSecOpenSSLX509FindKeyByValue(xmlSecPtrListPtr keysList, xmlSecKeyX509DataValuePtr x509Value) {
+xmlSecOpenSSLX509FindKeyByValue(xmlSecPtrListPtr keysList, xmlSecOpenSSLX509CertsIndexPtr keysIndex,
+    xmlSecKeyX509DataValuePtr x509Value
+) {
     xmlSecOpenSSLX509FindCertCtx findCertCtx;
-    xmlSecSize keysListSize, ii;
+    xmlSecSize keysListSize, pos;
     xmlSecKeyPtr res = NULL;
     int ret;
 
     xmlSecAssert2(keysList != NULL, NULL);
+    xmlSecAssert2(keysIndex != NULL, NULL);
     xmlSecAssert2(x509Value != NULL, NULL);
 
     ret = xmlSecOpenSSLX509FindCertCtxInitializeFromValue(&findCertCtx, x509Value);
@@ -302,35 +424,15 @@ xmlSecOpenSSLX509FindKeyByValue(xmlSecPtrListPtr keysList, xmlSecKeyX509DataValu
     }
 
     keysListSize = xmlSecPtrListGetSize(keysList);
-    for(ii = 0; ii < keysListSize; ++ii) {
-        xmlSecKeyPtr key;
-        xmlSecKeyDataPtr keyData;
-        X509* keyCert;
-
-        /* get key's cert from x509 key data */
-        key = (xmlSecKeyPtr)xmlSecPtrListGetItem(keysList, ii);
-        if(key == NULL) {
-            continue;
-        }
-        keyData = xmlSecKeyGetData(key, xmlSecOpenSSLKeyDataX509Id);
-        if(keyData == NULL) {
-            continue;
-        }
-        keyCert = xmlSecOpenSSLKeyDataX509GetKeyCert(keyData);
-        if(keyCert == NULL) {
-            continue;
-        }
-
-        /* does it match? */
-        ret = xmlSecOpenSSLX509FindCertCtxMatch(&findCertCtx, keyCert);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecOpenSSLX509FindCertCtxMatch", NULL);
-            xmlSecOpenSSLX509FindCertCtxFinalize(&findCertCtx);
-            return(NULL);
-        } else if(ret == 1) {
-            res = key;
-            break;
-        }
+    ret = xmlSecOpenSSLX509CertsIndexFind(keysIndex, &findCertCtx,
+        xmlSecOpenSSLX509GetKeyCert, keysList, keysListSize, &pos);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509CertsIndexFind", NULL);
+        xmlSecOpenSSLX509FindCertCtxFinalize(&findCertCtx);
+        return(NULL);
+    }
+    if(pos < keysListSize) {
+        res = (xmlSecKeyPtr)xmlSecPtrListGetItem(keysList, pos);
     }
 
     /* done */
@@ -340,14 +442,14 @@ xmlSecOpenSSLX509FindKeyByValue(xmlSecPtrListPtr keysList, xmlSecKeyX509DataValu
 
 
 static STACK_OF(X509_CRL)*
-xmlSecOpenSSLX509StoreVerifyAndCopyCrls(X509_STORE* xst, X509_STORE_CTX* xsc, STACK_OF(X509)* untrusted, STACK_OF(X509_CRL)* crls,
-    xmlSecKeyInfoCtx* keyInfoCtx
+xmlSecOpenSSLX509StoreVerifyAndCopyCrls(xmlSecOpenSSLX509StoreCtxPtr ctx, X509_STORE_CTX* xsc, STACK_OF(X509)* untrusted,
+    STACK_OF(X509_CRL)* crls, xmlSecKeyInfoCtx* keyInfoCtx
 ) {
     STACK_OF(X509_CRL)* verified_crls = NULL;
     x509_size_t ii, num;
     int ret;
 
-    xmlSecAssert2(xst != NULL, NULL);
+    xmlSecAssert2(ctx != NULL, NULL);
     xmlSecAssert2(xsc != NULL, NULL);
     xmlSecAssert2(keyInfoCtx != NULL, NULL);
 
@@ -380,7 +482,7 @@ xmlSecOpenSSLX509StoreVerifyAndCopyCrls(X509_STORE* xst, X509_STORE_CTX* xsc, ST
             continue;
         }
 
-        ret = xmlSecOpenSSLX509VerifyCRL(xst, xsc, untrusted, crl, keyInfoCtx);
+        ret = xmlSecOpenSSLX509VerifyCRL(ctx, xsc, untrusted, crl, keyInfoCtx);
         if(ret < 0) {
             xmlSecInternalError("xmlSecOpenSSLX509VerifyCRL", NULL);
             sk_X509_CRL_free(verified_crls);
@@ -403,84 +505,65 @@ xmlSecOpenSSLX509StoreVerifyAndCopyCrls(X509_STORE* xst, X509_STORE_CTX* xsc, ST
     return(verified_crls);
 }
 
+/* The revoked certs lookup by serial number uses the CRL's own index: OpenSSL sorts
+ * the revoked entries by serial number once (on the first lookup) and then does
+ * a binary search, thus large CRLs are not scanned for every cert. */
 static int
-xmlSecOpenSSLX509StoreVerifyCertAgainstRevoked(X509 * cert, STACK_OF(X509_REVOKED) *revoked_certs, xmlSecKeyInfoCtx* keyInfoCtx) {
-    X509_REVOKED * revoked_cert;
-    const ASN1_INTEGER * revoked_cert_serial;
-    const ASN1_INTEGER * cert_serial;
-    x509_size_t ii, num;
+xmlSecOpenSSLX509StoreVerifyCertAgainstRevoked(X509 * cert, X509_CRL * crl, xmlSecKeyInfoCtx* keyInfoCtx) {
+    X509_REVOKED * revoked_cert = NULL;
     int ret;
 
     xmlSecAssert2(cert != NULL, -1);
-    xmlSecAssert2(revoked_certs != NULL, -1);
+    xmlSecAssert2(crl != NULL, -1);
     xmlSecAssert2(keyInfoCtx != NULL, -1);
 
-    cert_serial = X509_get_serialNumber(cert);
-    if(cert_serial == NULL) {
-        xmlSecOpenSSLError("X509_get_serialNumber(cert)", NULL);
-        return(-1);
+    ret = X509_CRL_get0_by_cert(crl, &revoked_cert, cert);
+    if((ret == 0) || (revoked_cert == NULL)) {
+        /* success: nomatch */
+        return(1);
     }
 
-    num = sk_X509_REVOKED_num(revoked_certs);
-    for(ii = 0; ii < num; ++ii) {
-        revoked_cert = sk_X509_REVOKED_value(revoked_certs, ii);
-        if(revoked_cert == NULL) {
-            continue;
-        }
+    /* don't bother checking the revocation date if we are checking against
+     * current time. In this case we assume that CRL didn't come from the future */
+    if(keyInfoCtx->certsVerificationTime > 0) {
+        const ASN1_TIME * revocationDate;
+        time_t tt = keyInfoCtx->certsVerificationTime;
 
-        revoked_cert_serial = X509_REVOKED_get0_serialNumber(revoked_cert);
-        if(revoked_cert_serial == NULL) {
-            xmlSecOpenSSLError("X509_REVOKED_get0_serialNumber(revoked_cert)", NULL);
+        revocationDate = X509_REVOKED_get0_revocationDate(revoked_cert);
+        if(revocationDate == NULL) {
+            xmlSecOpenSSLError("X509_REVOKED_get0_revocationDate(revoked_cert)", NULL);
             return(-1);
         }
-
-        if (ASN1_INTEGER_cmp(cert_serial, revoked_cert_serial) != 0) {
-            continue;
+        ret = X509_cmp_time(revocationDate, &tt);
+        if(ret == 0) {
+            xmlSecOpenSSLError("X509_cmp_time(revocationDate)", NULL);
+            return(-1);
         }
-
-        /* don't bother checking the revocation date if we are checking against
-         * current time. In this case we assume that CRL didn't come from the future */
-        if(keyInfoCtx->certsVerificationTime > 0) {
-            const ASN1_TIME * revocationDate;
-            time_t tt = keyInfoCtx->certsVerificationTime;
-
-            revocationDate = X509_REVOKED_get0_revocationDate(revoked_cert);
-            if(revocationDate == NULL) {
-                xmlSecOpenSSLError("X509_REVOKED_get0_revocationDate(revoked_cert)", NULL);
-                return(-1);
-            }
-            ret = X509_cmp_time(revocationDate, &tt);
-            if(ret == 0) {
-                xmlSecOpenSSLError("X509_cmp_time(revocationDate)", NULL);
-                return(-1);
-            }
-            /* ret = 1: asn1_time is later than time */
-            if(ret > 0) {
-                X509_NAME *issuer;
-                char issuer_name[256];
-                time_t ts;
-
-                /* revocationDate > certsVerificationTime, we are good */
-                ts = xmlSecOpenSSLX509Asn1TimeToTime(revocationDate);
-                issuer = X509_get_issuer_name(cert);
-                if(issuer != NULL) {
-                    X509_NAME_oneline(issuer, issuer_name, sizeof(issuer_name));
-                    xmlSecOtherError3(XMLSEC_ERRORS_R_CRL_NOT_YET_VALID, NULL,
-                        "issuer=%s; revocationDate=%lf", issuer_name, (double)ts);
-                } else {
-                    xmlSecOtherError2(XMLSEC_ERRORS_R_CRL_NOT_YET_VALID, NULL,
-                        "revocationDates=%lf", (double)ts);
-                }
-                continue;
+        /* ret = 1: asn1_time is later than time */
+        if(ret > 0) {
+            X509_NAME *issuer;
+            char issuer_name[256];
+            time_t ts;
+
+            /* revocationDate > certsVerificationTime, we are good */
+            ts = xmlSecOpenSSLX509Asn1TimeToTime(revocationDate);
+            issuer = X509_get_issuer_name(cert);
+            if(issuer != NULL) {
+                X509_NAME_oneline(issuer, issuer_name, sizeof(issuer_name));
+                xmlSecOtherError3(XMLSEC_ERRORS_R_CRL_NOT_YET_VALID, NULL,
+                    "issuer=%s; revocationDate=%lf", issuer_name, (double)ts);
+            } else {
+                xmlSecOtherError2(XMLSEC_ERRORS_R_CRL_NOT_YET_VALID, NULL,
+                    "revocationDates=%lf", (double)ts);
             }
-        }
 
-        /* cert matches revoked */
-        return(0);
+            /* success: nomatch */
+            return(1);
+        }
     }
 
-    /* success: nomatch */
-    return(1);
+    /* cert matches revoked */
+    return(0);
 }
 
 /* tries to find the best CRL, returns 1 on success, 0 if crl is not found, or a negative value on error */
@@ -551,7 +634,6 @@ static int
 xmlSecOpenSSLX509StoreVerifyCertAgainstCrls(STACK_OF(X509_CRL) *crls, X509* cert, xmlSecKeyInfoCtx* keyInfoCtx) {
     X509_NAME *cert_issuer;
     X509_CRL *crl = NULL;
-    STACK_OF(X509_REVOKED) * revoked_certs;
     int ret;
 
     xmlSecAssert2(crls != NULL, -1);
@@ -580,13 +662,7 @@ xmlSecOpenSSLX509StoreVerifyCertAgainstCrls(STACK_OF(X509_CRL) *crls, X509* cert
         return(1);
     }
 
-    revoked_certs = X509_CRL_get_REVOKED(crl);
-    if(revoked_certs == NULL) {
-        xmlSecOpenSSLError("X509_CRL_get_REVOKED", NULL);
-        return(-1);
-    }
-
-    ret = xmlSecOpenSSLX509StoreVerifyCertAgainstRevoked(cert, revoked_certs, keyInfoCtx);
+    ret = xmlSecOpenSSLX509StoreVerifyCertAgainstRevoked(cert, crl, keyInfoCtx);
     if(ret < 0) {
         xmlSecInternalError("xmlSecOpenSSLX509StoreVerifyCertAgainstRevoked", NULL);
         return(-1);
@@ -636,26 +712,177 @@ xmlSecOpenSSLX509StoreVerifyCertsAgainstCrls(STACK_OF(X509)* chain, STACK_OF(X50
     return(1);
 }
 
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+static xmlSecSize
+xmlSecOpenSSLX509OcspHash(const ASN1_INTEGER* serial) {
+    const unsigned char* data;
+    xmlSecSize hash = 5381;
+    int ii, len;
+
+    xmlSecAssert2(serial != NULL, 0);
+
+    data = ASN1_STRING_get0_data(serial);
+    len = ASN1_STRING_length(serial);
+    for(ii = 0; (data != NULL) && (ii < len); ++ii) {
+        hash = ((hash << 5) + hash) + data[ii];
+    }
+    return(hash);
+}
+
+/* returns 1 if @cert issued by @issuer is not revoked (or there is no OCSP
+ * response for it and it is not required), 0 if it is revoked or the required
+ * response is missing or a negative value if an error occurs */
+static int
+xmlSecOpenSSLX509StoreVerifyCertOcsp(xmlSecOpenSSLX509StoreCtxPtr ctx, X509* cert, X509* issuer,
+    int required, xmlSecKeyInfoCtx* keyInfoCtx, time_t* expires
+) {
+    xmlSecOpenSSLX509OcspEntryPtr entry;
+    const ASN1_INTEGER* serial;
+    ASN1_OBJECT* mdObj = NULL;
+    OCSP_CERTID* id;
+    const EVP_MD* md;
+    char subject[256], issuerName[256];
+    xmlSecSize hash;
+    time_t tt;
+    int status = V_OCSP_CERTSTATUS_UNKNOWN;
+    time_t revocationTime = 0, nextUpdate = 0;
+    int res = -1;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->ocspMutex != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(issuer != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+    xmlSecAssert2(expires != NULL, -1);
+
+    tt = (keyInfoCtx->certsVerificationTime > 0) ? keyInfoCtx->certsVerificationTime : time(NULL);
+    serial = X509_get0_serialNumber(cert);
+    if(serial == NULL) {
+        xmlSecOpenSSLError("X509_get0_serialNumber", NULL);
+        return(-1);
+    }
+    hash = xmlSecOpenSSLX509OcspHash(serial);
+
+    xmlMutexLock(ctx->ocspMutex);
+    entry = (ctx->ocsp != NULL) ? ctx->ocsp[hash % ctx->ocspTableSize] : NULL;
+    for(; entry != NULL; entry = entry->next) {
+        if(entry->hash != hash) {
+            continue;
+        }
+        /* the cert id digest is chosen by the responder */
+        if(OCSP_id_get0_info(NULL, &mdObj, NULL, NULL, entry->id) != 1) {
+            xmlSecOpenSSLError("OCSP_id_get0_info", NULL);
+            goto done;
+        }
+        md = EVP_get_digestbyobj(mdObj);
+        if(md == NULL) {
+            continue;
+        }
+        id = OCSP_cert_to_id(md, cert, issuer);
+        if(id == NULL) {
+            xmlSecOpenSSLError("OCSP_cert_to_id", NULL);
+            goto done;
+        }
+        if(OCSP_id_cmp(id, entry->id) == 0) {
+            OCSP_CERTID_free(id);
+            if(tt <= entry->nextUpdate + XMLSEC_OPENSSL_X509_OCSP_MAX_SKEW) {
+                status = entry->status;
+                revocationTime = entry->revocationTime;
+                nextUpdate = entry->nextUpdate;
+            }
+            break;
+        }
+        OCSP_CERTID_free(id);
+    }
+    res = 0;
+
+done:
+    xmlMutexUnlock(ctx->ocspMutex);
+    if(res < 0) {
+        return(res);
+    }
+
+    X509_NAME_oneline(X509_get_subject_name(cert), subject, sizeof(subject));
+    X509_NAME_oneline(X509_get_issuer_name(cert), issuerName, sizeof(issuerName));
+    if((status == V_OCSP_CERTSTATUS_REVOKED) && (revocationTime <= tt)) {
+        xmlSecOtherError3(XMLSEC_ERRORS_R_CERT_REVOKED, NULL,
+            "subject=%s; issuer=%s; OCSP status is revoked", subject, issuerName);
+        return(0);
+    }
+    if(status != V_OCSP_CERTSTATUS_GOOD) {
+        if(required != 0) {
+            xmlSecOtherError3(XMLSEC_ERRORS_R_CERT_VERIFY_FAILED, NULL,
+                "subject=%s; issuer=%s; valid OCSP response is not found", subject, issuerName);
+            return(0);
+        }
+        return(1);
+    }
+
+    /* the verification result expires with the OCSP response */
+    if(((*expires) <= 0) || (nextUpdate < (*expires))) {
+        (*expires) = nextUpdate;
+    }
+    return(1);
+}
+
+/* checks all the certs in the @chain except the trust anchor, the OCSP response is
+ * only required for the leaf cert */
+static int
+xmlSecOpenSSLX509StoreVerifyCertsOcsp(xmlSecOpenSSLX509StoreCtxPtr ctx, STACK_OF(X509)* chain,
+    xmlSecKeyInfoCtx* keyInfoCtx, time_t* expires
+) {
+    X509* cert;
+    X509* issuer;
+    x509_size_t ii, num_certs;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(chain != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+    xmlSecAssert2(expires != NULL, -1);
+
+    num_certs = sk_X509_num(chain);
+    for(ii = 0; ii + 1 < num_certs; ++ii) {
+        cert = sk_X509_value(chain, ii);
+        issuer = sk_X509_value(chain, ii + 1);
+        if((cert == NULL) || (issuer == NULL)) {
+            continue;
+        }
+        ret = xmlSecOpenSSLX509StoreVerifyCertOcsp(ctx, cert, issuer,
+            (ii == 0) ? ctx->ocspRequired : 0, keyInfoCtx, expires);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509StoreVerifyCertOcsp", NULL);
+            return(-1);
+        } else if(ret != 1) {
+            /* cert was revoked */
+            return(0);
+        }
+    }
+
+    /* success! */
+    return(1);
+}
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
+
+/* should be called after X509_STORE_CTX_init(): the verification params created by
+ * X509_STORE_CTX_init() are updated in place instead of allocating new ones */
 static int
 xmlSecOpenSSLX509StoreSetCtx(X509_STORE_CTX* xsc, xmlSecKeyInfoCtx* keyInfoCtx) {
-    X509_VERIFY_PARAM * vpm = NULL;
+    X509_VERIFY_PARAM * vpm;
     unsigned long vpm_flags = 0;
 
     xmlSecAssert2(xsc != NULL, -1);
     xmlSecAssert2(keyInfoCtx != NULL, -1);
 
-    if(keyInfoCtx->certsVerificationTime > 0) {
-        X509_STORE_CTX_set_time(xsc, 0, keyInfoCtx->certsVerificationTime);
-    }
-
-    /* set verification params: we verify CRLs manually because OpenSSL fails cert verification if there is no CRL */
-    vpm = X509_VERIFY_PARAM_new();
+    vpm = X509_STORE_CTX_get0_param(xsc);
     if(vpm == NULL) {
-        xmlSecOpenSSLError("X509_VERIFY_PARAM_new", NULL);
+        xmlSecOpenSSLError("X509_STORE_CTX_get0_param", NULL);
         return(-1);
     }
-    vpm_flags = X509_VERIFY_PARAM_get_flags(vpm);
-    vpm_flags &= (~((unsigned long)X509_V_FLAG_CRL_CHECK));
+
+    /* set verification params: we verify CRLs manually because OpenSSL fails cert verification if there is no CRL
+     * (the other flags inherited from the store and the defaults are dropped too) */
+    X509_VERIFY_PARAM_clear_flags(vpm, X509_VERIFY_PARAM_get_flags(vpm));
     if(keyInfoCtx->certsVerificationTime > 0) {
         vpm_flags |= X509_V_FLAG_USE_CHECK_TIME;
         X509_VERIFY_PARAM_set_time(vpm, keyInfoCtx->certsVerificationTime);
@@ -663,29 +890,81 @@ xmlSecOpenSSLX509StoreSetCtx(X509_STORE_CTX* xsc, xmlSecKeyInfoCtx* keyInfoCtx)
     X509_VERIFY_PARAM_set_flags(vpm, vpm_flags);
     X509_VERIFY_PARAM_set_depth(vpm, keyInfoCtx->certsVerificationDepth);
 
-    X509_STORE_CTX_set0_param(xsc, vpm);
-    vpm = NULL; /* owned by xsc now */
-
     /* done */
     return(0);
 }
 
+/* the result of the verification at the current time expires with the first cert in the chain
+ * or at the next CRLs update; returns 1 on success or 0 if the result can't be cached */
+static int
+xmlSecOpenSSLX509VerifyCacheGetExpires(STACK_OF(X509)* chain, STACK_OF(X509_CRL)* crls, time_t* expires) {
+    const ASN1_TIME* tm;
+    time_t tt;
+    x509_size_t ii, num;
+
+    xmlSecAssert2(chain != NULL, 0);
+    xmlSecAssert2(expires != NULL, 0);
+
+    num = sk_X509_num(chain);
+    for(ii = 0; ii < num; ++ii) {
+        X509* cert = sk_X509_value(chain, ii);
+        if(cert == NULL) {
+            continue;
+        }
+        tm = X509_get0_notAfter(cert);
+        if(tm == NULL) {
+            return(0);
+        }
+        tt = xmlSecOpenSSLX509Asn1TimeToTime(tm);
+        if(tt <= 0) {
+            return(0);
+        }
+        if(((*expires) <= 0) || (tt < (*expires))) {
+            (*expires) = tt;
+        }
+    }
+
+    num = (crls != NULL) ? sk_X509_CRL_num(crls) : 0;
+    for(ii = 0; ii < num; ++ii) {
+        X509_CRL* crl = sk_X509_CRL_value(crls, ii);
+        if(crl == NULL) {
+            continue;
+        }
+        tm = X509_CRL_get0_nextUpdate(crl);
+        if(tm == NULL) {
+            continue;
+        }
+        tt = xmlSecOpenSSLX509Asn1TimeToTime(tm);
+        if(tt <= 0) {
+            return(0);
+        }
+        if(((*expires) <= 0) || (tt < (*expires))) {
+            (*expires) = tt;
+        }
+    }
+    return(1);
+}
+
+/* if @expires is not NULL then it is set to the time when the successful verification result expires
+ * (0 if it never expires) or to a negative value if the result can't be cached */
 static int
-xmlSecOpenSSLX509StoreVerifyCert(X509_STORE* xst, X509_STORE_CTX* xsc, X509* cert,
+xmlSecOpenSSLX509StoreVerifyCert(xmlSecOpenSSLX509StoreCtxPtr ctx, X509_STORE_CTX* xsc, X509* cert,
     STACK_OF(X509)* untrusted, STACK_OF(X509_CRL)* crls, STACK_OF(X509_CRL)* crls2,
-    xmlSecKeyInfoCtx* keyInfoCtx
+    xmlSecKeyInfoCtx* keyInfoCtx, time_t* expires
 ) {
     STACK_OF(X509)* chain;
+    time_t ocspExpires = 0;
     int ret;
     int res = -1;
 
-    xmlSecAssert2(xst != NULL, -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->xst != NULL, -1);
     xmlSecAssert2(xsc != NULL, -1);
     xmlSecAssert2(cert != NULL, -1);
     xmlSecAssert2(keyInfoCtx != NULL, -1);
 
     /* init contenxt and set verification params from keyinfo ctx*/
-    ret = X509_STORE_CTX_init(xsc, xst, cert, untrusted);
+    ret = X509_STORE_CTX_init(xsc, ctx->xst, cert, untrusted);
     if(ret != 1) {
         xmlSecOpenSSLError("X509_STORE_CTX_init", NULL);
         goto done;
@@ -785,6 +1064,34 @@ xmlSecOpenSSLX509StoreVerifyCert(X509_STORE* xst, X509_STORE_CTX* xsc, X509* cer
         }
     }
 
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+    /* and against the OCSP responses */
+    if(ctx->ocspMutex != NULL) {
+        ret = xmlSecOpenSSLX509StoreVerifyCertsOcsp(ctx, chain, keyInfoCtx, &ocspExpires);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509StoreVerifyCertsOcsp", NULL);
+            goto done;
+        } else if(ret != 1) {
+            /* not verified */
+            res = 0;
+            goto done;
+        }
+    }
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
+
+    /* the results for the fixed verification time never expire */
+    if(expires != NULL) {
+        (*expires) = 0;
+        if((keyInfoCtx->certsVerificationTime <= 0) &&
+           (xmlSecOpenSSLX509VerifyCacheGetExpires(chain, crls2, expires) != 1)
+        ) {
+            (*expires) = -1;
+        }
+        if(((*expires) >= 0) && (ocspExpires > 0) && (((*expires) == 0) || (ocspExpires < (*expires)))) {
+            (*expires) = ocspExpires;
+        }
+    }
+
     /* success: verified */
     res = 1;
 
@@ -793,29 +1100,299 @@ done:
     return(res);
 }
 
-/**
- * xmlSecOpenSSLX509StoreVerify:
- * @store:              the pointer to X509 key data store klass.
- * @certs:              the untrusted certificates stack.
- * @crls:               the crls stack.
- * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; element processing context.
- *
- * Verifies @certs list.
- *
- * Returns: pointer to the first verified certificate from @certs.
- */
-X509*
-xmlSecOpenSSLX509StoreVerify(xmlSecKeyDataStorePtr store, XMLSEC_STACK_OF_X509* certs, XMLSEC_STACK_OF_X509_CRL* crls, xmlSecKeyInfoCtx* keyInfoCtx) {
-    xmlSecOpenSSLX509StoreCtxPtr ctx;
-    STACK_OF(X509)* all_untrusted_certs = NULL;
-    STACK_OF(X509_CRL)* verified_crls = NULL;
-    X509 * res = NULL;
-    X509 * cert;
-    X509_STORE_CTX *xsc = NULL;
-    x509_size_t ii, num;
-    int ret;
+/* the caller is responsible for locking */
+static void
+xmlSecOpenSSLX509VerifyCacheFlush(xmlSecOpenSSLX509StoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
 
-    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), NULL);
+    if(ctx->verifyCache != NULL) {
+        memset(ctx->verifyCache, 0, sizeof(xmlSecOpenSSLX509VerifyCacheEntry) * ctx->verifyCacheMaxSize);
+    }
+    ctx->verifyCachePos = 0;
+}
+
+/* the store certs or CRLs have changed */
+static void
+xmlSecOpenSSLX509VerifyCacheReset(xmlSecOpenSSLX509StoreCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->verifyCache == NULL) {
+        return;
+    }
+    xmlMutexLock(ctx->verifyCacheMutex);
+    xmlSecOpenSSLX509VerifyCacheFlush(ctx);
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
+/* prepares the cache entry (without expiration time) for the @cert verification with @certs */
+static int
+xmlSecOpenSSLX509VerifyCacheEntryInit(xmlSecOpenSSLX509VerifyCacheEntryPtr entry, X509* cert,
+    STACK_OF(X509)* certs, xmlSecKeyInfoCtx* keyInfoCtx
+) {
+    EVP_MD_CTX* digestCtx = NULL;
+    xmlSecByte md[EVP_MAX_MD_SIZE];
+    unsigned int mdLen;
+    x509_size_t ii, num;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(entry != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+
+    memset(entry, 0, sizeof(xmlSecOpenSSLX509VerifyCacheEntry));
+    entry->verificationTime = keyInfoCtx->certsVerificationTime;
+    entry->verificationDepth = keyInfoCtx->certsVerificationDepth;
+
+    mdLen = sizeof(entry->leafDigest);
+    ret = X509_digest(cert, EVP_sha256(), entry->leafDigest, &mdLen);
+    if((ret != 1) || (mdLen != sizeof(entry->leafDigest))) {
+        xmlSecOpenSSLError("X509_digest(leaf)", NULL);
+        goto done;
+    }
+
+    digestCtx = EVP_MD_CTX_new();
+    if(digestCtx == NULL) {
+        xmlSecOpenSSLError("EVP_MD_CTX_new", NULL);
+        goto done;
+    }
+    ret = EVP_DigestInit(digestCtx, EVP_sha256());
+    if(ret != 1) {
+        xmlSecOpenSSLError("EVP_DigestInit", NULL);
+        goto done;
+    }
+    num = (certs != NULL) ? sk_X509_num(certs) : 0;
+    for(ii = 0; ii < num; ++ii) {
+        X509* c = sk_X509_value(certs, ii);
+        if(c == NULL) {
+            continue;
+        }
+        mdLen = sizeof(md);
+        ret = X509_digest(c, EVP_sha256(), md, &mdLen);
+        if(ret != 1) {
+            xmlSecOpenSSLError("X509_digest(cert)", NULL);
+            goto done;
+        }
+        ret = EVP_DigestUpdate(digestCtx, md, mdLen);
+        if(ret != 1) {
+            xmlSecOpenSSLError("EVP_DigestUpdate", NULL);
+            goto done;
+        }
+    }
+    mdLen = sizeof(entry->certsDigest);
+    ret = EVP_DigestFinal(digestCtx, entry->certsDigest, &mdLen);
+    if((ret != 1) || (mdLen != sizeof(entry->certsDigest))) {
+        xmlSecOpenSSLError("EVP_DigestFinal", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(digestCtx != NULL) {
+        EVP_MD_CTX_free(digestCtx);
+    }
+    return(res);
+}
+
+/* returns 1 if @entry matches a not expired cache entry, 0 otherwise */
+static int
+xmlSecOpenSSLX509VerifyCacheFind(xmlSecOpenSSLX509StoreCtxPtr ctx, xmlSecOpenSSLX509VerifyCacheEntryPtr entry) {
+    xmlSecOpenSSLX509VerifyCacheEntryPtr cur;
+    time_t now;
+    xmlSecSize ii;
+    int res = 0;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(entry != NULL, 0);
+
+    if(ctx->verifyCache == NULL) {
+        return(0);
+    }
+
+    now = time(NULL);
+    xmlMutexLock(ctx->verifyCacheMutex);
+    for(ii = 0; ii < ctx->verifyCacheMaxSize; ++ii) {
+        cur = &(ctx->verifyCache[ii]);
+        if(cur->used == 0) {
+            continue;
+        }
+        if((cur->expires > 0) && (cur->expires <= now)) {
+            memset(cur, 0, sizeof(xmlSecOpenSSLX509VerifyCacheEntry));
+            continue;
+        }
+        if((cur->verificationTime == entry->verificationTime) &&
+           (cur->verificationDepth == entry->verificationDepth) &&
+           (memcmp(cur->leafDigest, entry->leafDigest, sizeof(cur->leafDigest)) == 0) &&
+           (memcmp(cur->certsDigest, entry->certsDigest, sizeof(cur->certsDigest)) == 0)
+        ) {
+            res = 1;
+            break;
+        }
+    }
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+    return(res);
+}
+
+static void
+xmlSecOpenSSLX509VerifyCacheAdd(xmlSecOpenSSLX509StoreCtxPtr ctx, xmlSecOpenSSLX509VerifyCacheEntryPtr entry) {
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(entry != NULL);
+
+    if(ctx->verifyCache == NULL) {
+        return;
+    }
+
+    /* replace the oldest entry */
+    xmlMutexLock(ctx->verifyCacheMutex);
+    entry->used = 1;
+    memcpy(&(ctx->verifyCache[ctx->verifyCachePos]), entry, sizeof(xmlSecOpenSSLX509VerifyCacheEntry));
+    ctx->verifyCachePos = (ctx->verifyCachePos + 1) % ctx->verifyCacheMaxSize;
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
+/* prepares the CRL cache entry (without the result) for the @crl signed by @issuer */
+static int
+xmlSecOpenSSLX509CrlCacheEntryInit(xmlSecOpenSSLX509CrlCacheEntryPtr entry, X509_CRL* crl, X509* issuer) {
+    unsigned int mdLen;
+    int ret;
+
+    xmlSecAssert2(entry != NULL, -1);
+    xmlSecAssert2(crl != NULL, -1);
+    xmlSecAssert2(issuer != NULL, -1);
+
+    memset(entry, 0, sizeof(xmlSecOpenSSLX509CrlCacheEntry));
+
+    mdLen = sizeof(entry->crlDigest);
+    ret = X509_CRL_digest(crl, EVP_sha256(), entry->crlDigest, &mdLen);
+    if((ret != 1) || (mdLen != sizeof(entry->crlDigest))) {
+        xmlSecOpenSSLError("X509_CRL_digest", NULL);
+        return(-1);
+    }
+    mdLen = sizeof(entry->issuerDigest);
+    ret = X509_digest(issuer, EVP_sha256(), entry->issuerDigest, &mdLen);
+    if((ret != 1) || (mdLen != sizeof(entry->issuerDigest))) {
+        xmlSecOpenSSLError("X509_digest(issuer)", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* returns 1 and sets @entry->verified if @entry matches a cache entry, 0 otherwise */
+static int
+xmlSecOpenSSLX509CrlCacheFind(xmlSecOpenSSLX509StoreCtxPtr ctx, xmlSecOpenSSLX509CrlCacheEntryPtr entry) {
+    xmlSecOpenSSLX509CrlCacheEntryPtr cur;
+    xmlSecSize ii;
+    int res = 0;
+
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(entry != NULL, 0);
+
+    if(ctx->crlCache == NULL) {
+        return(0);
+    }
+
+    xmlMutexLock(ctx->verifyCacheMutex);
+    for(ii = 0; ii < ctx->verifyCacheMaxSize; ++ii) {
+        cur = &(ctx->crlCache[ii]);
+        if((cur->used != 0) &&
+           (memcmp(cur->crlDigest, entry->crlDigest, sizeof(cur->crlDigest)) == 0) &&
+           (memcmp(cur->issuerDigest, entry->issuerDigest, sizeof(cur->issuerDigest)) == 0)
+        ) {
+            entry->verified = cur->verified;
+            res = 1;
+            break;
+        }
+    }
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+    return(res);
+}
+
+static void
+xmlSecOpenSSLX509CrlCacheAdd(xmlSecOpenSSLX509StoreCtxPtr ctx, xmlSecOpenSSLX509CrlCacheEntryPtr entry) {
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(entry != NULL);
+
+    if(ctx->crlCache == NULL) {
+        return;
+    }
+
+    /* replace the oldest entry */
+    xmlMutexLock(ctx->verifyCacheMutex);
+    entry->used = 1;
+    memcpy(&(ctx->crlCache[ctx->crlCachePos]), entry, sizeof(xmlSecOpenSSLX509CrlCacheEntry));
+    ctx->crlCachePos = (ctx->crlCachePos + 1) % ctx->verifyCacheMaxSize;
+    xmlMutexUnlock(ctx->verifyCacheMutex);
+}
+
+/* same as xmlSecOpenSSLX509StoreVerifyCert() but checks the verification results cache first,
+ * the results are only cached if there are no CRLs in the document (@crls is empty) */
+static int
+xmlSecOpenSSLX509StoreVerifyCertCached(xmlSecOpenSSLX509StoreCtxPtr ctx, X509_STORE_CTX* xsc, X509* cert,
+    STACK_OF(X509)* certs, STACK_OF(X509)* untrusted, STACK_OF(X509_CRL)* crls,
+    xmlSecKeyInfoCtx* keyInfoCtx
+) {
+    xmlSecOpenSSLX509VerifyCacheEntry entry;
+    int useCache = 0;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(keyInfoCtx != NULL, -1);
+
+    if((ctx->verifyCache != NULL) && ((crls == NULL) || (sk_X509_CRL_num(crls) <= 0))) {
+        ret = xmlSecOpenSSLX509VerifyCacheEntryInit(&entry, cert, certs, keyInfoCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509VerifyCacheEntryInit", NULL);
+            return(-1);
+        }
+        if(xmlSecOpenSSLX509VerifyCacheFind(ctx, &entry) == 1) {
+            xmlSecStatsCacheLookup(xmlSecStatsCacheX509Verify, 1);
+            return(1);
+        }
+        xmlSecStatsCacheLookup(xmlSecStatsCacheX509Verify, 0);
+        useCache = 1;
+    }
+
+    ret = xmlSecOpenSSLX509StoreVerifyCert(ctx, xsc, cert, untrusted, crls, ctx->crls, keyInfoCtx,
+        (useCache != 0) ? &(entry.expires) : NULL);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509StoreVerifyCert", NULL);
+        return(-1);
+    } else if(ret != 1) {
+        return(ret);
+    }
+
+    if((useCache != 0) && (entry.expires >= 0)) {
+        xmlSecOpenSSLX509VerifyCacheAdd(ctx, &entry);
+    }
+    return(1);
+}
+
+/**
+ * xmlSecOpenSSLX509StoreVerify:
+ * @store:              the pointer to X509 key data store klass.
+ * @certs:              the untrusted certificates stack.
+ * @crls:               the crls stack.
+ * @keyInfoCtx:         the pointer to &lt;dsig:KeyInfo/&gt; element processing context.
+ *
+ * Verifies @certs list.
+ *
+ * Returns: pointer to the first verified certificate from @certs.
+ */
+X509*
+xmlSecOpenSSLX509StoreVerify(xmlSecKeyDataStorePtr store, XMLSEC_STACK_OF_X509* certs, XMLSEC_STACK_OF_X509_CRL* crls, xmlSecKeyInfoCtx* keyInfoCtx) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    STACK_OF(X509)* all_untrusted_certs = NULL;
+    STACK_OF(X509_CRL)* verified_crls = NULL;
+    X509 * res = NULL;
+    X509 * cert;
+    X509_STORE_CTX *xsc = NULL;
+    x509_size_t ii, num;
+    int ret;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), NULL);
     xmlSecAssert2(certs != NULL, NULL);
     xmlSecAssert2(keyInfoCtx != NULL, NULL);
 
@@ -823,11 +1400,10 @@ xmlSecOpenSSLX509StoreVerify(xmlSecKeyDataStorePtr store, XMLSEC_STACK_OF_X509*
     xmlSecAssert2(ctx != NULL, NULL);
     xmlSecAssert2(ctx->xst != NULL, NULL);
 
-    /* reuse xsc for both crls and certs verification */
-    xsc = X509_STORE_CTX_new_ex(xmlSecOpenSSLGetLibCtx(), NULL);
-    if(xsc == NULL) {
-        xmlSecOpenSSLError("X509_STORE_CTX_new", xmlSecKeyDataStoreGetName(store));
-        goto done;
+    ret = xmlSecOpenSSLX509StoreLoadDefaultPaths(ctx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509StoreLoadDefaultPaths", xmlSecKeyDataStoreGetName(store));
+        return(NULL);
     }
 
     /* create a combined list of all untrusted certs*/
@@ -837,8 +1413,18 @@ xmlSecOpenSSLX509StoreVerify(xmlSecKeyDataStorePtr store, XMLSEC_STACK_OF_X509*
         goto done;
     }
 
-    /* copy crls list but remove all non-verified (we assume that CRLs in the store are already verified) */
-    verified_crls = xmlSecOpenSSLX509StoreVerifyAndCopyCrls(ctx->xst, xsc, all_untrusted_certs, crls, keyInfoCtx);
+    /* the CRLs are only needed if we are going to verify the leaf cert */
+    if((keyInfoCtx->flags & XMLSEC_KEYINFO_FLAGS_X509DATA_DONT_VERIFY_CERTS) == 0) {
+        /* reuse xsc for both crls and certs verification */
+        xsc = xmlSecOpenSSLX509StoreCtxBorrow();
+        if(xsc == NULL) {
+            xmlSecOpenSSLError("xmlSecOpenSSLX509StoreCtxBorrow", xmlSecKeyDataStoreGetName(store));
+            goto done;
+        }
+
+        /* copy crls list but remove all non-verified (we assume that CRLs in the store are already verified) */
+        verified_crls = xmlSecOpenSSLX509StoreVerifyAndCopyCrls(ctx, xsc, all_untrusted_certs, crls, keyInfoCtx);
+    }
 
     /* get one cert after another and try to verify */
     num = sk_X509_num(certs);
@@ -859,9 +1445,9 @@ xmlSecOpenSSLX509StoreVerify(xmlSecKeyDataStorePtr store, XMLSEC_STACK_OF_X509*
             goto done;
         }
 
-        ret = xmlSecOpenSSLX509StoreVerifyCert(ctx->xst, xsc, cert, all_untrusted_certs, verified_crls, ctx->crls, keyInfoCtx);
+        ret = xmlSecOpenSSLX509StoreVerifyCertCached(ctx, xsc, cert, certs, all_untrusted_certs, verified_crls, keyInfoCtx);
         if(ret < 0) {
-            xmlSecInternalError("xmlSecOpenSSLX509StoreVerifyCert", xmlSecKeyDataStoreGetName(store));
+            xmlSecInternalError("xmlSecOpenSSLX509StoreVerifyCertCached", xmlSecKeyDataStoreGetName(store));
             goto done;
         } else if(ret != 1) {
             continue;
@@ -883,7 +1469,7 @@ done:
         sk_X509_CRL_free(verified_crls);
     }
     if(xsc != NULL) {
-        X509_STORE_CTX_free(xsc);
+        xmlSecOpenSSLX509StoreCtxRelease(xsc);
     }
     return(res);
 }
@@ -926,6 +1512,12 @@ xmlSecOpenSSLX509StoreVerifyKey(xmlSecKeyDataStorePtr store, xmlSecKeyPtr key, x
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(ctx->xst != NULL,  -1);
 
+    ret = xmlSecOpenSSLX509StoreLoadDefaultPaths(ctx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509StoreLoadDefaultPaths", xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+
     /* retrieve X509 data */
     x509Data = xmlSecKeyGetData(key, xmlSecOpenSSLKeyDataX509Id);
     if(x509Data == NULL) {
@@ -947,9 +1539,9 @@ xmlSecOpenSSLX509StoreVerifyKey(xmlSecKeyDataStorePtr store, xmlSecKeyPtr key, x
     }
 
     /* reuse xsc for both crls and certs verification */
-    xsc = X509_STORE_CTX_new_ex(xmlSecOpenSSLGetLibCtx(), NULL);
+    xsc = xmlSecOpenSSLX509StoreCtxBorrow();
     if(xsc == NULL) {
-        xmlSecOpenSSLError("X509_STORE_CTX_new", xmlSecKeyDataStoreGetName(store));
+        xmlSecOpenSSLError("xmlSecOpenSSLX509StoreCtxBorrow", xmlSecKeyDataStoreGetName(store));
         goto done;
     }
 
@@ -961,12 +1553,12 @@ xmlSecOpenSSLX509StoreVerifyKey(xmlSecKeyDataStorePtr store, xmlSecKeyPtr key, x
     }
 
     /* copy crls list but remove all non-verified (we assume that CRLs in the store are already verified) */
-    verified_crls = xmlSecOpenSSLX509StoreVerifyAndCopyCrls(ctx->xst, xsc, all_untrusted_certs, crls, keyInfoCtx);
+    verified_crls = xmlSecOpenSSLX509StoreVerifyAndCopyCrls(ctx, xsc, all_untrusted_certs, crls, keyInfoCtx);
 
     /* verify */
-    ret = xmlSecOpenSSLX509StoreVerifyCert(ctx->xst, xsc, keyCert, all_untrusted_certs, verified_crls, ctx->crls, keyInfoCtx);
+    ret = xmlSecOpenSSLX509StoreVerifyCertCached(ctx, xsc, keyCert, certs, all_untrusted_certs, verified_crls, keyInfoCtx);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecOpenSSLX509StoreVerifyCert", xmlSecKeyDataStoreGetName(store));
+        xmlSecInternalError("xmlSecOpenSSLX509StoreVerifyCertCached", xmlSecKeyDataStoreGetName(store));
         goto done;
     } else if(ret != 1) {
         res = 0; /* verification failed */
@@ -987,7 +1579,7 @@ done:
         sk_X509_CRL_free(verified_crls);
     }
     if(xsc != NULL) {
-        X509_STORE_CTX_free(xsc);
+        xmlSecOpenSSLX509StoreCtxRelease(xsc);
     }
     return(res);
 }
@@ -1005,6 +1597,7 @@ done:
 int
 xmlSecOpenSSLX509StoreAdoptCert(xmlSecKeyDataStorePtr store, X509* cert, xmlSecKeyDataType type) {
     xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecSize pos;
     int ret;
 
     xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), -1);
@@ -1027,12 +1620,20 @@ xmlSecOpenSSLX509StoreAdoptCert(xmlSecKeyDataStorePtr store, X509* cert, xmlSecK
     } else {
         xmlSecAssert2(ctx->untrusted != NULL, -1);
 
+        XMLSEC_SAFE_CAST_INT_TO_SIZE(sk_X509_num(ctx->untrusted), pos, return(-1), xmlSecKeyDataStoreGetName(store));
+        ret = xmlSecOpenSSLX509CertsIndexAdd(&(ctx->certsIndex), cert, pos);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CertsIndexAdd", xmlSecKeyDataStoreGetName(store));
+            return(-1);
+        }
+
         ret = sk_X509_push(ctx->untrusted, cert);
         if(ret <= 0) {
             xmlSecOpenSSLError("sk_X509_push", xmlSecKeyDataStoreGetName(store));
             return(-1);
         }
     }
+    xmlSecOpenSSLX509VerifyCacheReset(ctx);
     return(0);
 }
 
@@ -1062,6 +1663,7 @@ xmlSecOpenSSLX509StoreAdoptCrl(xmlSecKeyDataStorePtr store, X509_CRL* crl) {
             xmlSecOpenSSLError("sk_X509_CRL_push", xmlSecKeyDataStoreGetName(store));
             return(-1);
         }
+    xmlSecOpenSSLX509VerifyCacheReset(ctx);
 
     return (0);
 }
@@ -1101,6 +1703,7 @@ xmlSecOpenSSLX509StoreAddCertsPath(xmlSecKeyDataStorePtr store, const char *path
                             xmlSecErrorsSafeString(path));
         return(-1);
     }
+    xmlSecOpenSSLX509VerifyCacheReset(ctx);
     return(0);
 }
 
@@ -1139,112 +1742,896 @@ xmlSecOpenSSLX509StoreAddCertsFile(xmlSecKeyDataStorePtr store, const char *file
                             xmlSecErrorsSafeString(filename));
         return(-1);
     }
+    xmlSecOpenSSLX509VerifyCacheReset(ctx);
     return(0);
 }
 
-static int
-xmlSecOpenSSLX509StoreInitialize(xmlSecKeyDataStorePtr store) {
-    const xmlChar* path;
-    X509_LOOKUP *lookup = NULL;
-    int ret;
-
+/**
+ * xmlSecOpenSSLX509StoreEnableVerifyCache:
+ * @store:              the pointer to OpenSSL x509 store.
+ * @maxSize:            the max number of verification results in the cache.
+ *
+ * Enables (or re-creates empty) cache for the successful certificates
+ * verification results: the same leaf certificate with the same certificates
+ * from the document and the same verification params (time, depth) is verified
+ * only once. The results for the current time verification expire with the
+ * first certificate in the chain or at the next update of the store CRLs.
+ * The certificates with CRLs in the document are always verified but the
+ * CRLs signatures are verified only once for each CRL and issuer certificate.
+ * The cache is flushed when certificates or CRLs are added to the store. This function
+ * is not thread safe and should be called before the store is used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLX509StoreEnableVerifyCache(xmlSecKeyDataStorePtr store, xmlSecSize maxSize) {
     xmlSecOpenSSLX509StoreCtxPtr ctx;
+
     xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), -1);
+    xmlSecAssert2(maxSize > 0, -1);
 
     ctx = xmlSecOpenSSLX509StoreGetCtx(store);
     xmlSecAssert2(ctx != NULL, -1);
 
-    memset(ctx, 0, sizeof(xmlSecOpenSSLX509StoreCtx));
-
-    ctx->xst = X509_STORE_new();
-    if(ctx->xst == NULL) {
-        xmlSecOpenSSLError("X509_STORE_new",
-                           xmlSecKeyDataStoreGetName(store));
-        return(-1);
-    }
-
-    ret = X509_STORE_set_default_paths_ex(ctx->xst, xmlSecOpenSSLGetLibCtx(), NULL);
-    if(ret != 1) {
-        xmlSecOpenSSLError("X509_STORE_set_default_paths",
-                           xmlSecKeyDataStoreGetName(store));
-        return(-1);
-    }
-
-
-    lookup = X509_STORE_add_lookup(ctx->xst, X509_LOOKUP_hash_dir());
-    if(lookup == NULL) {
-        xmlSecOpenSSLError("X509_STORE_add_lookup",
-                           xmlSecKeyDataStoreGetName(store));
-         return(-1);
-    }
-
-    path = xmlSecOpenSSLGetDefaultTrustedCertsFolder();
-    if(path != NULL) {
-        if(!X509_LOOKUP_add_dir(lookup, (char*)path, X509_FILETYPE_PEM)) {
-            xmlSecOpenSSLError2("X509_LOOKUP_add_dir",
-                                xmlSecKeyDataStoreGetName(store),
-                                "path='%s'",
-                                xmlSecErrorsSafeString(path));
-            return(-1);
-        }
-    } else {
-        if(!X509_LOOKUP_add_dir(lookup, NULL, X509_FILETYPE_DEFAULT)) {
-            xmlSecOpenSSLError("X509_LOOKUP_add_dir",
-                               xmlSecKeyDataStoreGetName(store));
-            return(-1);
-        }
-    }
+    xmlSecOpenSSLX509StoreDisableVerifyCache(store);
 
-    ctx->untrusted = sk_X509_new_null();
-    if(ctx->untrusted == NULL) {
-        xmlSecOpenSSLError("sk_X509_new_null",
-                           xmlSecKeyDataStoreGetName(store));
+    ctx->verifyCache = (xmlSecOpenSSLX509VerifyCacheEntryPtr)xmlMalloc(sizeof(xmlSecOpenSSLX509VerifyCacheEntry) * maxSize);
+    if(ctx->verifyCache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecOpenSSLX509VerifyCacheEntry) * maxSize, xmlSecKeyDataStoreGetName(store));
         return(-1);
     }
-
-    ctx->crls = sk_X509_CRL_new_null();
-    if(ctx->crls == NULL) {
-        xmlSecOpenSSLError("sk_X509_CRL_new_null",
-                           xmlSecKeyDataStoreGetName(store));
+    memset(ctx->verifyCache, 0, sizeof(xmlSecOpenSSLX509VerifyCacheEntry) * maxSize);
+    ctx->verifyCacheMaxSize = maxSize;
+    ctx->verifyCachePos = 0;
+
+    ctx->crlCache = (xmlSecOpenSSLX509CrlCacheEntryPtr)xmlMalloc(sizeof(xmlSecOpenSSLX509CrlCacheEntry) * maxSize);
+    if(ctx->crlCache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecOpenSSLX509CrlCacheEntry) * maxSize, xmlSecKeyDataStoreGetName(store));
+        xmlSecOpenSSLX509StoreDisableVerifyCache(store);
         return(-1);
     }
+    memset(ctx->crlCache, 0, sizeof(xmlSecOpenSSLX509CrlCacheEntry) * maxSize);
+    ctx->crlCachePos = 0;
 
-    ctx->vpm = X509_VERIFY_PARAM_new();
-    if(ctx->vpm == NULL) {
-        xmlSecOpenSSLError("X509_VERIFY_PARAM_new",
-                           xmlSecKeyDataStoreGetName(store));
+    ctx->verifyCacheMutex = xmlNewMutex();
+    if(ctx->verifyCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyDataStoreGetName(store));
+        xmlSecOpenSSLX509StoreDisableVerifyCache(store);
         return(-1);
     }
-    X509_VERIFY_PARAM_set_depth(ctx->vpm, 9); /* the default cert verification path in openssl */
-    X509_STORE_set1_param(ctx->xst, ctx->vpm);
-
-
     return(0);
 }
 
-static void
-xmlSecOpenSSLX509StoreFinalize(xmlSecKeyDataStorePtr store) {
+/**
+ * xmlSecOpenSSLX509StoreDisableVerifyCache:
+ * @store:              the pointer to OpenSSL x509 store.
+ *
+ * Disables the certificates verification results cache. This function
+ * is not thread safe and should not be called while the store is used.
+ */
+void
+xmlSecOpenSSLX509StoreDisableVerifyCache(xmlSecKeyDataStorePtr store) {
     xmlSecOpenSSLX509StoreCtxPtr ctx;
+
     xmlSecAssert(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId));
 
     ctx = xmlSecOpenSSLX509StoreGetCtx(store);
     xmlSecAssert(ctx != NULL);
 
-
-    if(ctx->xst != NULL) {
-        X509_STORE_free(ctx->xst);
-    }
-    if(ctx->untrusted != NULL) {
-        sk_X509_pop_free(ctx->untrusted, X509_free);
+    if(ctx->verifyCache != NULL) {
+        xmlFree(ctx->verifyCache);
+        ctx->verifyCache = NULL;
     }
-    if(ctx->crls != NULL) {
-        sk_X509_CRL_pop_free(ctx->crls, X509_CRL_free);
+    if(ctx->crlCache != NULL) {
+        xmlFree(ctx->crlCache);
+        ctx->crlCache = NULL;
     }
-    if(ctx->vpm != NULL) {
-        X509_VERIFY_PARAM_free(ctx->vpm);
+    if(ctx->verifyCacheMutex != NULL) {
+        xmlFreeMutex(ctx->verifyCacheMutex);
+        ctx->verifyCacheMutex = NULL;
     }
-
-    memset(ctx, 0, sizeof(xmlSecOpenSSLX509StoreCtx));
+    ctx->verifyCacheMaxSize = 0;
+    ctx->verifyCachePos = 0;
+    ctx->crlCachePos = 0;
+}
+
+/**
+ * xmlSecOpenSSLX509StoreEnableIntern:
+ * @store:              the pointer to OpenSSL x509 store.
+ *
+ * Enables the intern table for the certificates and CRLs read from the
+ * &lt;dsig:X509Data/&gt; nodes for the keys loaded with the keys manager
+ * of the @store (e.g. with #xmlSecSimpleKeysStoreLoad): the identical
+ * certificates and CRLs (e.g. the intermediate and root certificates
+ * included with thousands of keys) are parsed once and shared by all the
+ * keys. The intern table keeps the certificates and CRLs until the
+ * @store is destroyed. This function is not thread safe and should be
+ * called before the store is used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLX509StoreEnableIntern(xmlSecKeyDataStorePtr store) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), -1);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    if(ctx->internMutex != NULL) {
+        return(0);
+    }
+    ctx->internMutex = xmlNewMutex();
+    if(ctx->internMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecOpenSSLX509StoreDisableIntern:
+ * @store:              the pointer to OpenSSL x509 store.
+ *
+ * Disables the certificates and CRLs intern table and releases the table
+ * references (the certificates and CRLs are still shared by the keys).
+ * This function is not thread safe and should not be called while the
+ * store is used.
+ */
+void
+xmlSecOpenSSLX509StoreDisableIntern(xmlSecKeyDataStorePtr store) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecSize ii;
+
+    xmlSecAssert(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId));
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->intern != NULL) {
+        for(ii = 0; ii < ctx->internTableSize; ++ii) {
+            if(ctx->intern[ii].cert != NULL) {
+                X509_free(ctx->intern[ii].cert);
+            }
+            if(ctx->intern[ii].crl != NULL) {
+                X509_CRL_free(ctx->intern[ii].crl);
+            }
+        }
+        xmlFree(ctx->intern);
+        ctx->intern = NULL;
+    }
+    if(ctx->internMutex != NULL) {
+        xmlFreeMutex(ctx->internMutex);
+        ctx->internMutex = NULL;
+    }
+    ctx->internTableSize = 0;
+    ctx->internSize = 0;
+}
+
+/**
+ * xmlSecOpenSSLX509StoreGetInternSize:
+ * @store:              the pointer to OpenSSL x509 store.
+ *
+ * Gets the number of the distinct certificates and CRLs in the intern table.
+ *
+ * Returns: the number of the interned certificates and CRLs.
+ */
+xmlSecSize
+xmlSecOpenSSLX509StoreGetInternSize(xmlSecKeyDataStorePtr store) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecSize size = 0;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), 0);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, 0);
+
+    if(ctx->internMutex != NULL) {
+        xmlMutexLock(ctx->internMutex);
+        size = ctx->internSize;
+        xmlMutexUnlock(ctx->internMutex);
+    }
+    return(size);
+}
+
+/* returns 1 if the intern table is enabled for the @store (which might be NULL) */
+int
+xmlSecOpenSSLX509StoreIsInternEnabled(xmlSecKeyDataStorePtr store) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+
+    if((store == NULL) || (!xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId))) {
+        return(0);
+    }
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, 0);
+
+    return((ctx->internMutex != NULL) ? 1 : 0);
+}
+
+/* the caller holds the intern mutex; returns the entry or the empty slot for it */
+static xmlSecOpenSSLX509InternEntryPtr
+xmlSecOpenSSLX509InternFindSlot(xmlSecOpenSSLX509InternEntryPtr table, xmlSecSize tableSize,
+                                const xmlSecByte* digest, xmlSecSize size) {
+    xmlSecOpenSSLX509InternEntryPtr entry;
+    xmlSecSize hash = 0, pos;
+
+    xmlSecAssert2(table != NULL, NULL);
+    xmlSecAssert2(tableSize > 0, NULL);
+    xmlSecAssert2(digest != NULL, NULL);
+
+    memcpy(&hash, digest, sizeof(hash));
+    for(pos = hash & (tableSize - 1); ; pos = (pos + 1) & (tableSize - 1)) {
+        entry = &(table[pos]);
+        if((entry->cert == NULL) && (entry->crl == NULL)) {
+            return(entry);
+        }
+        if((entry->size == size) && (memcmp(entry->digest, digest, sizeof(entry->digest)) == 0)) {
+            return(entry);
+        }
+    }
+}
+
+/* the caller holds the intern mutex */
+static int
+xmlSecOpenSSLX509InternGrow(xmlSecOpenSSLX509StoreCtxPtr ctx) {
+    xmlSecOpenSSLX509InternEntryPtr table;
+    xmlSecSize tableSize, ii;
+
+    xmlSecAssert2(ctx != NULL, -1);
+
+    /* the load factor <= 3/4 */
+    if((ctx->internSize + 1) <= ctx->internTableSize / 4 * 3) {
+        return(0);
+    }
+    tableSize = (ctx->internTableSize > 0) ? 2 * ctx->internTableSize : XMLSEC_OPENSSL_X509_INTERN_MIN_SIZE;
+    if(tableSize > XMLSEC_SIZE_MAX / sizeof(xmlSecOpenSSLX509InternEntry)) {
+        xmlSecInvalidSizeOtherError("intern table size is too big", NULL);
+        return(-1);
+    }
+    table = (xmlSecOpenSSLX509InternEntryPtr)xmlMalloc(sizeof(xmlSecOpenSSLX509InternEntry) * tableSize);
+    if(table == NULL) {
+        xmlSecMallocError(sizeof(xmlSecOpenSSLX509InternEntry) * tableSize, NULL);
+        return(-1);
+    }
+    memset(table, 0, sizeof(xmlSecOpenSSLX509InternEntry) * tableSize);
+
+    for(ii = 0; ii < ctx->internTableSize; ++ii) {
+        if((ctx->intern[ii].cert != NULL) || (ctx->intern[ii].crl != NULL)) {
+            (*xmlSecOpenSSLX509InternFindSlot(table, tableSize, ctx->intern[ii].digest, ctx->intern[ii].size)) = ctx->intern[ii];
+        }
+    }
+    if(ctx->intern != NULL) {
+        xmlFree(ctx->intern);
+    }
+    ctx->intern = table;
+    ctx->internTableSize = tableSize;
+    return(0);
+}
+
+/* returns a new reference to the interned cert or NULL if not found */
+X509*
+xmlSecOpenSSLX509StoreInternFindCert(xmlSecKeyDataStorePtr store, const xmlSecByte* digest, xmlSecSize size) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecOpenSSLX509InternEntryPtr entry;
+    X509* res = NULL;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), NULL);
+    xmlSecAssert2(digest != NULL, NULL);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->internMutex != NULL, NULL);
+
+    xmlMutexLock(ctx->internMutex);
+    if(ctx->intern != NULL) {
+        entry = xmlSecOpenSSLX509InternFindSlot(ctx->intern, ctx->internTableSize, digest, size);
+        if((entry != NULL) && (entry->cert != NULL) && (X509_up_ref(entry->cert) == 1)) {
+            res = entry->cert;
+        }
+    }
+    xmlMutexUnlock(ctx->internMutex);
+
+    xmlSecStatsCacheLookup(xmlSecStatsCacheX509Cert, (res != NULL) ? 1 : 0);
+    return(res);
+}
+
+/* takes the ownership of @cert and returns a new reference to the interned cert
+ * (the @cert or the identical cert interned by another thread) */
+X509*
+xmlSecOpenSSLX509StoreInternAddCert(xmlSecKeyDataStorePtr store, const xmlSecByte* digest, xmlSecSize size, X509* cert) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecOpenSSLX509InternEntryPtr entry;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), cert);
+    xmlSecAssert2(digest != NULL, cert);
+    xmlSecAssert2(cert != NULL, NULL);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, cert);
+    xmlSecAssert2(ctx->internMutex != NULL, cert);
+
+    xmlMutexLock(ctx->internMutex);
+    if(xmlSecOpenSSLX509InternGrow(ctx) < 0) {
+        /* not fatal: the cert is not shared */
+        xmlMutexUnlock(ctx->internMutex);
+        return(cert);
+    }
+    entry = xmlSecOpenSSLX509InternFindSlot(ctx->intern, ctx->internTableSize, digest, size);
+    xmlSecAssert2(entry != NULL, cert);
+    if((entry->cert != NULL) && (X509_up_ref(entry->cert) == 1)) {
+        xmlMutexUnlock(ctx->internMutex);
+        X509_free(cert);
+        return(entry->cert);
+    }
+    if((entry->cert == NULL) && (entry->crl == NULL) && (X509_up_ref(cert) == 1)) {
+        memcpy(entry->digest, digest, sizeof(entry->digest));
+        entry->size = size;
+        entry->cert = cert;
+        ++ctx->internSize;
+    }
+    xmlMutexUnlock(ctx->internMutex);
+    return(cert);
+}
+
+/* returns a new reference to the interned CRL or NULL if not found */
+X509_CRL*
+xmlSecOpenSSLX509StoreInternFindCrl(xmlSecKeyDataStorePtr store, const xmlSecByte* digest, xmlSecSize size) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecOpenSSLX509InternEntryPtr entry;
+    X509_CRL* res = NULL;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), NULL);
+    xmlSecAssert2(digest != NULL, NULL);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->internMutex != NULL, NULL);
+
+    xmlMutexLock(ctx->internMutex);
+    if(ctx->intern != NULL) {
+        entry = xmlSecOpenSSLX509InternFindSlot(ctx->intern, ctx->internTableSize, digest, size);
+        if((entry != NULL) && (entry->crl != NULL) && (X509_CRL_up_ref(entry->crl) == 1)) {
+            res = entry->crl;
+        }
+    }
+    xmlMutexUnlock(ctx->internMutex);
+    return(res);
+}
+
+/* takes the ownership of @crl and returns a new reference to the interned CRL
+ * (the @crl or the identical CRL interned by another thread) */
+X509_CRL*
+xmlSecOpenSSLX509StoreInternAddCrl(xmlSecKeyDataStorePtr store, const xmlSecByte* digest, xmlSecSize size, X509_CRL* crl) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecOpenSSLX509InternEntryPtr entry;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), crl);
+    xmlSecAssert2(digest != NULL, crl);
+    xmlSecAssert2(crl != NULL, NULL);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, crl);
+    xmlSecAssert2(ctx->internMutex != NULL, crl);
+
+    xmlMutexLock(ctx->internMutex);
+    if(xmlSecOpenSSLX509InternGrow(ctx) < 0) {
+        /* not fatal: the CRL is not shared */
+        xmlMutexUnlock(ctx->internMutex);
+        return(crl);
+    }
+    entry = xmlSecOpenSSLX509InternFindSlot(ctx->intern, ctx->internTableSize, digest, size);
+    xmlSecAssert2(entry != NULL, crl);
+    if((entry->crl != NULL) && (X509_CRL_up_ref(entry->crl) == 1)) {
+        xmlMutexUnlock(ctx->internMutex);
+        X509_CRL_free(crl);
+        return(entry->crl);
+    }
+    if((entry->cert == NULL) && (entry->crl == NULL) && (X509_CRL_up_ref(crl) == 1)) {
+        memcpy(entry->digest, digest, sizeof(entry->digest));
+        entry->size = size;
+        entry->crl = crl;
+        ++ctx->internSize;
+    }
+    xmlMutexUnlock(ctx->internMutex);
+    return(crl);
+}
+
+/**
+ * xmlSecOpenSSLX509StoreEnableOcsp:
+ * @store:              the pointer to OpenSSL x509 store.
+ * @required:           if set then the certificate verification fails if there is
+ *                      no valid OCSP response for the leaf certificate.
+ *
+ * Enables the OCSP revocation checking with the OCSP responses added to
+ * the @store with #xmlSecOpenSSLX509StoreAddOcspResponse (e.g. the responses
+ * fetched or stapled by the application): the certificates in the verified
+ * chain (except the trust anchor) with a "revoked" status in a valid cached
+ * response fail the verification. This function is not thread safe and
+ * should be called before the store is used.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLX509StoreEnableOcsp(xmlSecKeyDataStorePtr store, int required) {
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), -1);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    if(ctx->ocspMutex == NULL) {
+        ctx->ocspMutex = xmlNewMutex();
+        if(ctx->ocspMutex == NULL) {
+            xmlSecXmlError("xmlNewMutex", xmlSecKeyDataStoreGetName(store));
+            return(-1);
+        }
+    }
+    ctx->ocspRequired = required;
+    xmlSecOpenSSLX509VerifyCacheReset(ctx);
+    return(0);
+#else /* XMLSEC_OPENSSL_NO_OCSP */
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), -1);
+    UNREFERENCED_PARAMETER(required);
+
+    xmlSecNotImplementedError("OCSP support is disabled");
+    return(-1);
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
+}
+
+/**
+ * xmlSecOpenSSLX509StoreDisableOcsp:
+ * @store:              the pointer to OpenSSL x509 store.
+ *
+ * Disables the OCSP revocation checking and removes all the cached OCSP
+ * responses. This function is not thread safe and should not be called
+ * while the store is used.
+ */
+void
+xmlSecOpenSSLX509StoreDisableOcsp(xmlSecKeyDataStorePtr store) {
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecOpenSSLX509OcspEntryPtr entry;
+    xmlSecSize ii;
+
+    xmlSecAssert(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId));
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+    if(ctx->ocsp != NULL) {
+        for(ii = 0; ii < ctx->ocspTableSize; ++ii) {
+            while(ctx->ocsp[ii] != NULL) {
+                entry = ctx->ocsp[ii];
+                ctx->ocsp[ii] = entry->next;
+                OCSP_CERTID_free(entry->id);
+                xmlFree(entry);
+            }
+        }
+        xmlFree(ctx->ocsp);
+        ctx->ocsp = NULL;
+    }
+    if(ctx->ocspMutex != NULL) {
+        xmlFreeMutex(ctx->ocspMutex);
+        ctx->ocspMutex = NULL;
+    }
+    ctx->ocspTableSize = 0;
+    ctx->ocspSize = 0;
+    ctx->ocspRequired = 0;
+    xmlSecOpenSSLX509VerifyCacheReset(ctx);
+#else /* XMLSEC_OPENSSL_NO_OCSP */
+    xmlSecAssert(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId));
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
+}
+
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+/* the caller holds the OCSP mutex */
+static int
+xmlSecOpenSSLX509OcspGrow(xmlSecOpenSSLX509StoreCtxPtr ctx) {
+    xmlSecOpenSSLX509OcspEntryPtr* table;
+    xmlSecOpenSSLX509OcspEntryPtr entry;
+    xmlSecSize tableSize, ii;
+
+    xmlSecAssert2(ctx != NULL, -1);
+
+    if(ctx->ocspSize < ctx->ocspTableSize) {
+        return(0);
+    }
+    tableSize = (ctx->ocspTableSize > 0) ? 2 * ctx->ocspTableSize : XMLSEC_OPENSSL_X509_OCSP_MIN_SIZE;
+    if(tableSize > XMLSEC_SIZE_MAX / sizeof(xmlSecOpenSSLX509OcspEntryPtr)) {
+        xmlSecInvalidSizeOtherError("OCSP table size is too big", NULL);
+        return(-1);
+    }
+    table = (xmlSecOpenSSLX509OcspEntryPtr*)xmlMalloc(sizeof(xmlSecOpenSSLX509OcspEntryPtr) * tableSize);
+    if(table == NULL) {
+        xmlSecMallocError(sizeof(xmlSecOpenSSLX509OcspEntryPtr) * tableSize, NULL);
+        return(-1);
+    }
+    memset(table, 0, sizeof(xmlSecOpenSSLX509OcspEntryPtr) * tableSize);
+
+    for(ii = 0; ii < ctx->ocspTableSize; ++ii) {
+        while(ctx->ocsp[ii] != NULL) {
+            entry = ctx->ocsp[ii];
+            ctx->ocsp[ii] = entry->next;
+            entry->next = table[entry->hash % tableSize];
+            table[entry->hash % tableSize] = entry;
+        }
+    }
+    if(ctx->ocsp != NULL) {
+        xmlFree(ctx->ocsp);
+    }
+    ctx->ocsp = table;
+    ctx->ocspTableSize = tableSize;
+    return(0);
+}
+
+/* adds or updates the cache entry for the @single response */
+static int
+xmlSecOpenSSLX509OcspAdd(xmlSecOpenSSLX509StoreCtxPtr ctx, OCSP_SINGLERESP* single) {
+    xmlSecOpenSSLX509OcspEntryPtr entry;
+    const OCSP_CERTID* id;
+    ASN1_INTEGER* serial = NULL;
+    ASN1_GENERALIZEDTIME* revtime = NULL;
+    ASN1_GENERALIZEDTIME* thisupd = NULL;
+    ASN1_GENERALIZEDTIME* nextupd = NULL;
+    xmlSecOpenSSLX509OcspEntry tmp;
+    int reason = 0;
+    int res = -1;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->ocspMutex != NULL, -1);
+    xmlSecAssert2(single != NULL, -1);
+
+    memset(&tmp, 0, sizeof(tmp));
+    tmp.status = OCSP_single_get0_status(single, &reason, &revtime, &thisupd, &nextupd);
+    if((tmp.status < 0) || (thisupd == NULL)) {
+        xmlSecOpenSSLError("OCSP_single_get0_status", NULL);
+        return(-1);
+    }
+    /* the responses without nextUpdate can't be cached */
+    if(nextupd == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_DATA, NULL, "OCSP response doesn't have nextUpdate");
+        return(-1);
+    }
+    if(OCSP_check_validity(thisupd, nextupd, XMLSEC_OPENSSL_X509_OCSP_MAX_SKEW, -1) != 1) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_DATA, NULL, "OCSP response is not valid at the current time");
+        return(-1);
+    }
+    tmp.thisUpdate = xmlSecOpenSSLX509Asn1TimeToTime(thisupd);
+    tmp.nextUpdate = xmlSecOpenSSLX509Asn1TimeToTime(nextupd);
+    if((tmp.thisUpdate <= 0) || (tmp.nextUpdate <= 0)) {
+        xmlSecInternalError("xmlSecOpenSSLX509Asn1TimeToTime", NULL);
+        return(-1);
+    }
+    if((tmp.status == V_OCSP_CERTSTATUS_REVOKED) && (revtime != NULL)) {
+        tmp.revocationTime = xmlSecOpenSSLX509Asn1TimeToTime(revtime);
+    }
+
+    id = OCSP_SINGLERESP_get0_id(single);
+    if((id == NULL) || (OCSP_id_get0_info(NULL, NULL, NULL, &serial, (OCSP_CERTID*)id) != 1) || (serial == NULL)) {
+        xmlSecOpenSSLError("OCSP_id_get0_info", NULL);
+        return(-1);
+    }
+    tmp.hash = xmlSecOpenSSLX509OcspHash(serial);
+
+    xmlMutexLock(ctx->ocspMutex);
+
+    /* replace the older response for the same cert */
+    entry = (ctx->ocsp != NULL) ? ctx->ocsp[tmp.hash % ctx->ocspTableSize] : NULL;
+    for(; entry != NULL; entry = entry->next) {
+        if((entry->hash == tmp.hash) && (OCSP_id_cmp(id, entry->id) == 0)) {
+            if(entry->thisUpdate <= tmp.thisUpdate) {
+                entry->status = tmp.status;
+                entry->revocationTime = tmp.revocationTime;
+                entry->thisUpdate = tmp.thisUpdate;
+                entry->nextUpdate = tmp.nextUpdate;
+            }
+            res = 0;
+            goto done;
+        }
+    }
+
+    if(xmlSecOpenSSLX509OcspGrow(ctx) < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509OcspGrow", NULL);
+        goto done;
+    }
+    entry = (xmlSecOpenSSLX509OcspEntryPtr)xmlMalloc(sizeof(xmlSecOpenSSLX509OcspEntry));
+    if(entry == NULL) {
+        xmlSecMallocError(sizeof(xmlSecOpenSSLX509OcspEntry), NULL);
+        goto done;
+    }
+    memcpy(entry, &tmp, sizeof(xmlSecOpenSSLX509OcspEntry));
+    entry->id = OCSP_CERTID_dup((OCSP_CERTID*)id);
+    if(entry->id == NULL) {
+        xmlSecOpenSSLError("OCSP_CERTID_dup", NULL);
+        xmlFree(entry);
+        goto done;
+    }
+    entry->next = ctx->ocsp[entry->hash % ctx->ocspTableSize];
+    ctx->ocsp[entry->hash % ctx->ocspTableSize] = entry;
+    ++ctx->ocspSize;
+
+    /* success */
+    res = 0;
+
+done:
+    xmlMutexUnlock(ctx->ocspMutex);
+    return(res);
+}
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
+
+/**
+ * xmlSecOpenSSLX509StoreAddOcspResponse:
+ * @store:              the pointer to OpenSSL x509 store.
+ * @data:               the DER encoded OCSP response.
+ * @dataSize:           the @data size.
+ *
+ * Validates the OCSP response (the response status, the responder signature
+ * and authorization with the @store certificates and the response validity
+ * at the current time) and adds the certificates statuses from it to the
+ * OCSP responses cache of the @store (see #xmlSecOpenSSLX509StoreEnableOcsp).
+ * The statuses are used until the response nextUpdate time (the responses
+ * without nextUpdate are rejected) or until a newer response for the same
+ * certificate is added. This function is thread safe.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLX509StoreAddOcspResponse(xmlSecKeyDataStorePtr store, const xmlSecByte* data, xmlSecSize dataSize) {
+#ifndef XMLSEC_OPENSSL_NO_OCSP
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    OCSP_RESPONSE* resp = NULL;
+    OCSP_BASICRESP* bs = NULL;
+    const unsigned char* p;
+    long len;
+    int ii, num;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), -1);
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(dataSize > 0, -1);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->xst != NULL, -1);
+
+    if(ctx->ocspMutex == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_OPERATION, xmlSecKeyDataStoreGetName(store),
+            "OCSP is not enabled for the store");
+        return(-1);
+    }
+    ret = xmlSecOpenSSLX509StoreLoadDefaultPaths(ctx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509StoreLoadDefaultPaths", xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+
+    XMLSEC_SAFE_CAST_SIZE_TO_LONG(dataSize, len, return(-1), xmlSecKeyDataStoreGetName(store));
+    p = data;
+    resp = d2i_OCSP_RESPONSE(NULL, &p, len);
+    if(resp == NULL) {
+        xmlSecOpenSSLError("d2i_OCSP_RESPONSE", xmlSecKeyDataStoreGetName(store));
+        goto done;
+    }
+    ret = OCSP_response_status(resp);
+    if(ret != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+        xmlSecOtherError2(XMLSEC_ERRORS_R_INVALID_DATA, xmlSecKeyDataStoreGetName(store),
+            "OCSP response status=%d", ret);
+        goto done;
+    }
+    bs = OCSP_response_get1_basic(resp);
+    if(bs == NULL) {
+        xmlSecOpenSSLError("OCSP_response_get1_basic", xmlSecKeyDataStoreGetName(store));
+        goto done;
+    }
+
+    /* the responder must be the CA or authorized by it */
+    ret = OCSP_basic_verify(bs, ctx->untrusted, ctx->xst, 0);
+    if(ret != 1) {
+        xmlSecOpenSSLError("OCSP_basic_verify", xmlSecKeyDataStoreGetName(store));
+        goto done;
+    }
+
+    num = OCSP_resp_count(bs);
+    for(ii = 0; ii < num; ++ii) {
+        ret = xmlSecOpenSSLX509OcspAdd(ctx, OCSP_resp_get0(bs, ii));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509OcspAdd", xmlSecKeyDataStoreGetName(store));
+            goto done;
+        }
+    }
+    xmlSecOpenSSLX509VerifyCacheReset(ctx);
+
+    /* success */
+    res = 0;
+
+done:
+    if(bs != NULL) {
+        OCSP_BASICRESP_free(bs);
+    }
+    if(resp != NULL) {
+        OCSP_RESPONSE_free(resp);
+    }
+    return(res);
+#else /* XMLSEC_OPENSSL_NO_OCSP */
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), -1);
+    xmlSecAssert2(data != NULL, -1);
+    UNREFERENCED_PARAMETER(dataSize);
+
+    xmlSecNotImplementedError("OCSP support is disabled");
+    return(-1);
+#endif /* XMLSEC_OPENSSL_NO_OCSP */
+}
+
+static int
+xmlSecOpenSSLX509StoreInitialize(xmlSecKeyDataStorePtr store) {
+    const xmlChar* path;
+    X509_LOOKUP *lookup = NULL;
+    int ret;
+
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecAssert2(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId), -1);
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    memset(ctx, 0, sizeof(xmlSecOpenSSLX509StoreCtx));
+    xmlSecOpenSSLX509CertsIndexInitialize(&(ctx->certsIndex));
+
+    ctx->xst = X509_STORE_new();
+    if(ctx->xst == NULL) {
+        xmlSecOpenSSLError("X509_STORE_new",
+                           xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+
+    /* loading the default trusted certs (e.g. the system CA bundle) is the
+     * most expensive part of the keys manager setup */
+    if(xmlSecOpenSSLAppGetDeferredInit() != 0) {
+        ctx->defaultPathsMutex = xmlNewMutex();
+        if(ctx->defaultPathsMutex == NULL) {
+            xmlSecXmlError("xmlNewMutex", xmlSecKeyDataStoreGetName(store));
+            return(-1);
+        }
+        ctx->defaultPathsPending = 1;
+    } else {
+        ret = X509_STORE_set_default_paths_ex(ctx->xst, xmlSecOpenSSLGetLibCtx(), NULL);
+        if(ret != 1) {
+            xmlSecOpenSSLError("X509_STORE_set_default_paths",
+                               xmlSecKeyDataStoreGetName(store));
+            return(-1);
+        }
+    }
+
+    lookup = X509_STORE_add_lookup(ctx->xst, X509_LOOKUP_hash_dir());
+    if(lookup == NULL) {
+        xmlSecOpenSSLError("X509_STORE_add_lookup",
+                           xmlSecKeyDataStoreGetName(store));
+         return(-1);
+    }
+
+    path = xmlSecOpenSSLGetDefaultTrustedCertsFolder();
+    if(path != NULL) {
+        if(!X509_LOOKUP_add_dir(lookup, (char*)path, X509_FILETYPE_PEM)) {
+            xmlSecOpenSSLError2("X509_LOOKUP_add_dir",
+                                xmlSecKeyDataStoreGetName(store),
+                                "path='%s'",
+                                xmlSecErrorsSafeString(path));
+            return(-1);
+        }
+    } else {
+        if(!X509_LOOKUP_add_dir(lookup, NULL, X509_FILETYPE_DEFAULT)) {
+            xmlSecOpenSSLError("X509_LOOKUP_add_dir",
+                               xmlSecKeyDataStoreGetName(store));
+            return(-1);
+        }
+    }
+
+    ctx->untrusted = sk_X509_new_null();
+    if(ctx->untrusted == NULL) {
+        xmlSecOpenSSLError("sk_X509_new_null",
+                           xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+
+    ctx->crls = sk_X509_CRL_new_null();
+    if(ctx->crls == NULL) {
+        xmlSecOpenSSLError("sk_X509_CRL_new_null",
+                           xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+
+    ctx->vpm = X509_VERIFY_PARAM_new();
+    if(ctx->vpm == NULL) {
+        xmlSecOpenSSLError("X509_VERIFY_PARAM_new",
+                           xmlSecKeyDataStoreGetName(store));
+        return(-1);
+    }
+    X509_VERIFY_PARAM_set_depth(ctx->vpm, 9); /* the default cert verification path in openssl */
+    X509_STORE_set1_param(ctx->xst, ctx->vpm);
+
+
+    return(0);
+}
+
+static void
+xmlSecOpenSSLX509StoreFinalize(xmlSecKeyDataStorePtr store) {
+    xmlSecOpenSSLX509StoreCtxPtr ctx;
+    xmlSecAssert(xmlSecKeyDataStoreCheckId(store, xmlSecOpenSSLX509StoreId));
+
+    ctx = xmlSecOpenSSLX509StoreGetCtx(store);
+    xmlSecAssert(ctx != NULL);
+
+
+    if(ctx->xst != NULL) {
+        X509_STORE_free(ctx->xst);
+    }
+    if(ctx->untrusted != NULL) {
+        sk_X509_pop_free(ctx->untrusted, X509_free);
+    }
+    if(ctx->crls != NULL) {
+        sk_X509_CRL_pop_free(ctx->crls, X509_CRL_free);
+    }
+    if(ctx->vpm != NULL) {
+        X509_VERIFY_PARAM_free(ctx->vpm);
+    }
+    xmlSecOpenSSLX509CertsIndexFinalize(&(ctx->certsIndex));
+    xmlSecOpenSSLX509StoreDisableVerifyCache(store);
+    xmlSecOpenSSLX509StoreDisableIntern(store);
+    xmlSecOpenSSLX509StoreDisableOcsp(store);
+    if(ctx->defaultPathsMutex != NULL) {
+        xmlFreeMutex(ctx->defaultPathsMutex);
+    }
+
+    memset(ctx, 0, sizeof(xmlSecOpenSSLX509StoreCtx));
+}
+
+/* loads the default trusted certs deferred by xmlSecOpenSSLX509StoreInitialize() */
+static int
+xmlSecOpenSSLX509StoreLoadDefaultPaths(xmlSecOpenSSLX509StoreCtxPtr ctx) {
+    xmlSecStatsSpan span;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->xst != NULL, -1);
+
+    if(ctx->defaultPathsPending == 0) {
+        return(0);
+    }
+    xmlSecAssert2(ctx->defaultPathsMutex != NULL, -1);
+
+    ret = xmlSecOpenSSLAppDeferredInit();
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLAppDeferredInit", NULL);
+        return(-1);
+    }
+
+    xmlMutexLock(ctx->defaultPathsMutex);
+    if(ctx->defaultPathsPending == 0) {
+        /* another thread did it */
+        xmlMutexUnlock(ctx->defaultPathsMutex);
+        return(0);
+    }
+
+    xmlSecStatsStartupStart(xmlSecStatsStartupDeferredInit, &span);
+    ret = X509_STORE_set_default_paths_ex(ctx->xst, xmlSecOpenSSLGetLibCtx(), NULL);
+    if(ret != 1) {
+        xmlSecOpenSSLError("X509_STORE_set_default_paths", NULL);
+        goto done;
+    }
+    ctx->defaultPathsPending = 0;
+
+    /* done */
+    res = 0;
+
+done:
+    xmlSecStatsStartupEnd(&span);
+    xmlMutexUnlock(ctx->defaultPathsMutex);
+    return(res);
 }
 
 
@@ -1254,13 +2641,18 @@ xmlSecOpenSSLX509StoreFinalize(xmlSecKeyDataStorePtr store) {
  *
  *****************************************************************************/
 static int
-xmlSecOpenSSLX509VerifyCRL(X509_STORE* xst, X509_STORE_CTX* xsc, STACK_OF(X509)* untrusted, X509_CRL *crl, xmlSecKeyInfoCtx* keyInfoCtx) {
+xmlSecOpenSSLX509VerifyCRL(xmlSecOpenSSLX509StoreCtxPtr ctx, X509_STORE_CTX* xsc, STACK_OF(X509)* untrusted,
+    X509_CRL *crl, xmlSecKeyInfoCtx* keyInfoCtx
+) {
+    xmlSecOpenSSLX509CrlCacheEntry entry;
     X509_OBJECT *xobj = NULL;
     EVP_PKEY *pKey = NULL;
+    int useCache = 0;
     int ret;
     int res = -1;
 
-    xmlSecAssert2(xst != NULL, -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->xst != NULL, -1);
     xmlSecAssert2(xsc != NULL, -1);
     xmlSecAssert2(crl != NULL, -1);
     xmlSecAssert2(keyInfoCtx != NULL, -1);
@@ -1272,7 +2664,7 @@ xmlSecOpenSSLX509VerifyCRL(X509_STORE* xst, X509_STORE_CTX* xsc, STACK_OF(X509)*
     }
 
     /* init contenxt and set verification params from keyinfo ctx*/
-    ret = X509_STORE_CTX_init(xsc, xst, NULL, untrusted);
+    ret = X509_STORE_CTX_init(xsc, ctx->xst, NULL, untrusted);
     if(ret != 1) {
         xmlSecOpenSSLError("X509_STORE_CTX_init", NULL);
         goto done;
@@ -1289,6 +2681,22 @@ xmlSecOpenSSLX509VerifyCRL(X509_STORE* xst, X509_STORE_CTX* xsc, STACK_OF(X509)*
         goto done;
     }
 
+    /* was this CRL already verified with this issuer? */
+    if(ctx->crlCache != NULL) {
+        ret = xmlSecOpenSSLX509CrlCacheEntryInit(&entry, crl, X509_OBJECT_get0_X509(xobj));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CrlCacheEntryInit", NULL);
+            goto done;
+        }
+        if(xmlSecOpenSSLX509CrlCacheFind(ctx, &entry) == 1) {
+            xmlSecStatsCacheLookup(xmlSecStatsCacheX509Crl, 1);
+            res = entry.verified;
+            goto done;
+        }
+        xmlSecStatsCacheLookup(xmlSecStatsCacheX509Crl, 0);
+        useCache = 1;
+    }
+
     pKey = X509_get_pubkey(X509_OBJECT_get0_X509(xobj));
     if(pKey == NULL) {
         xmlSecOpenSSLError("X509_get_pubkey", NULL);
@@ -1308,12 +2716,18 @@ xmlSecOpenSSLX509VerifyCRL(X509_STORE* xst, X509_STORE_CTX* xsc, STACK_OF(X509)*
 
         /* not verified */
         res = 0;
-        goto done;
+        goto cache;
     }
 
     /* success: verified */
     res = 1;
 
+cache:
+    if(useCache != 0) {
+        entry.verified = res;
+        xmlSecOpenSSLX509CrlCacheAdd(ctx, &entry);
+    }
+
 done:
     if(pKey != NULL) {
         EVP_PKEY_free(pKey);
@@ -1343,9 +2757,9 @@ int xmlSecOpenSSLX509FindCertCtxInitialize(xmlSecOpenSSLX509FindCertCtxPtr ctx,
 
 
     if(subjectName != NULL) {
-        ctx->subjectName = xmlSecOpenSSLX509NameRead(subjectName);
+        ctx->subjectName = xmlSecOpenSSLX509NameReadCached(subjectName);
         if(ctx->subjectName == NULL) {
-            xmlSecInternalError2("xmlSecOpenSSLX509NameRead", NULL,
+            xmlSecInternalError2("xmlSecOpenSSLX509NameReadCached", NULL,
                 "subject=%s", xmlSecErrorsSafeString(subjectName));
             xmlSecOpenSSLX509FindCertCtxFinalize(ctx);
             return(-1);
@@ -1355,9 +2769,9 @@ int xmlSecOpenSSLX509FindCertCtxInitialize(xmlSecOpenSSLX509FindCertCtxPtr ctx,
     if((issuerName != NULL) && (issuerSerial != NULL)) {
         BIGNUM *bn = NULL;
 
-        ctx->issuerName = xmlSecOpenSSLX509NameRead(issuerName);
+        ctx->issuerName = xmlSecOpenSSLX509NameReadCached(issuerName);
         if(ctx->issuerName == NULL) {
-            xmlSecInternalError2("xmlSecOpenSSLX509NameRead", NULL,
+            xmlSecInternalError2("xmlSecOpenSSLX509NameReadCached", NULL,
                 "issuer=%s", xmlSecErrorsSafeString(issuerName));
             xmlSecOpenSSLX509FindCertCtxFinalize(ctx);
             return(-1);
@@ -1478,30 +2892,202 @@ xmlSecOpenSSLX509MatchByIssuer(X509* cert,  X509_NAME* issuerName, ASN1_INTEGER*
         return(0);
     }
 
-    certSerial = X509_get_serialNumber(cert);
-    if((certSerial == NULL) || (ASN1_INTEGER_cmp(certSerial, issuerSerial) != 0)) {
-        return(0);
-    }
-    certName = X509_get_issuer_name(cert);
-    if((certName == NULL) || (xmlSecOpenSSLX509NamesCompare(certName, issuerName) != 0)) {
-        return(0);
-    }
+    certSerial = X509_get_serialNumber(cert);
+    if((certSerial == NULL) || (ASN1_INTEGER_cmp(certSerial, issuerSerial) != 0)) {
+        return(0);
+    }
+    certName = X509_get_issuer_name(cert);
+    if((certName == NULL) || (xmlSecOpenSSLX509NamesCompare(certName, issuerName) != 0)) {
+        return(0);
+    }
+
+    /* success */
+    return(1);
+}
+
+static int
+xmlSecOpenSSLX509MatchBySki(X509* cert, const xmlSecByte* ski, int skiLen) {
+    X509_EXTENSION* ext;
+    ASN1_OCTET_STRING* keyId;
+    int index;
+
+    xmlSecAssert2(cert != NULL, -1);
+
+    if((ski == NULL) || (skiLen <= 0)) {
+        return(0);
+    }
+
+    index = X509_get_ext_by_NID(cert, NID_subject_key_identifier, -1);
+    if(index < 0) {
+        return(0);
+    }
+    ext = X509_get_ext(cert, index);
+    if(ext == NULL) {
+        return(0);
+    }
+    keyId = (ASN1_OCTET_STRING *)X509V3_EXT_d2i(ext);
+    if(keyId == NULL) {
+        return(0);
+    }
+    if((keyId->length != skiLen) || (memcmp(keyId->data, ski, (size_t)skiLen) != 0)) {
+        ASN1_OCTET_STRING_free(keyId);
+        return(0);
+    }
+    ASN1_OCTET_STRING_free(keyId);
+
+    /* success */
+    return(1);
+}
+
+static int
+xmlSecOpenSSLX509MatchByDigest(X509* cert, const xmlSecByte * digestValue, unsigned int digestLen, const EVP_MD* digest) {
+    xmlSecByte md[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    int ret;
+
+    xmlSecAssert2(cert != NULL, -1);
+
+    if((digestValue == NULL) || (digestLen <= 0) || (digest == NULL)) {
+        return(0);
+    }
+
+    ret = X509_digest(cert, digest, md, &len);
+    if((ret != 1) || (len <= 0)) {
+        xmlSecOpenSSLError("X509_digest", NULL);
+        return(-1);
+    }
+
+    if((len != digestLen) || (memcmp(md, digestValue, digestLen) != 0)) {
+        return(0);
+    }
+
+    /* success */
+    return(1);
+}
+
+/* returns 1 for match, 0 for no match, and a negative value if an error occurs */
+int
+xmlSecOpenSSLX509FindCertCtxMatch(xmlSecOpenSSLX509FindCertCtxPtr ctx, X509* cert) {
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+
+    ret = xmlSecOpenSSLX509MatchBySubjectName(cert, ctx->subjectName);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509MatchBySubjectName", NULL);
+        return(-1);
+    } else if(ret == 1) {
+        /* success! */
+        return(1);
+    }
+
+    ret = xmlSecOpenSSLX509MatchByIssuer(cert, ctx->issuerName, ctx->issuerSerial);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509MatchByIssuer", NULL);
+        return(-1);
+    } else if(ret == 1) {
+        /* success! */
+        return(1);
+    }
+
+    ret = xmlSecOpenSSLX509MatchBySki(cert, ctx->ski, ctx->skiLen);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509MatchBySki", NULL);
+        return(-1);
+    } else if(ret == 1) {
+        /* success! */
+        return(1);
+    }
+
+    ret = xmlSecOpenSSLX509MatchByDigest(cert, ctx->digestValue, ctx->digestLen, ctx->digestMd);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509MatchByDigest", NULL);
+        return(-1);
+    } else if(ret == 1) {
+        /* success! */
+        return(1);
+    }
+
+    /* not found */
+    return(0);
+}
+
+/**************************************************************************
+ *
+ * Certs indexes (see xmlSecOpenSSLX509CertsIndex)
+ *
+ *************************************************************************/
+#define XMLSEC_OPENSSL_X509_INDEX_HASH_INIT     2166136261UL
+#define XMLSEC_OPENSSL_X509_INDEX_HASH_PRIME    16777619UL
+#define XMLSEC_OPENSSL_X509_INDEX_MIN_SIZE      16
+
+/* FNV-1a */
+static unsigned long
+xmlSecOpenSSLX509IndexHashBytes(unsigned long hash, const xmlSecByte* data, int len) {
+    int ii;
+
+    if(data == NULL) {
+        return(hash);
+    }
+    for(ii = 0; ii < len; ++ii) {
+        hash ^= (unsigned long)data[ii];
+        hash *= XMLSEC_OPENSSL_X509_INDEX_HASH_PRIME;
+    }
+    return(hash);
+}
+
+/* xmlSecOpenSSLX509NamesCompare() ignores the entries order, so does the hash:
+ * it is a sum of the entries hashes */
+static unsigned long
+xmlSecOpenSSLX509IndexHashName(X509_NAME* name) {
+    X509_NAME_ENTRY* entry;
+    ASN1_STRING* value;
+    unsigned long res = 0;
+    unsigned long hash;
+    int nid;
+    int ii;
+
+    xmlSecAssert2(name != NULL, 0);
+
+    for(ii = 0; ii < X509_NAME_entry_count(name); ++ii) {
+        entry = X509_NAME_get_entry(name, ii);
+        if(entry == NULL) {
+            continue;
+        }
+
+        hash = XMLSEC_OPENSSL_X509_INDEX_HASH_INIT;
+        value = X509_NAME_ENTRY_get_data(entry);
+        if(value != NULL) {
+            hash = xmlSecOpenSSLX509IndexHashBytes(hash, ASN1_STRING_get0_data(value), ASN1_STRING_length(value));
+        }
+        nid = OBJ_obj2nid(X509_NAME_ENTRY_get_object(entry));
+        hash = xmlSecOpenSSLX509IndexHashBytes(hash, (const xmlSecByte*)&nid, (int)sizeof(nid));
+        res += hash;
+    }
+    return(res);
+}
+
+static unsigned long
+xmlSecOpenSSLX509IndexHashIssuerSerial(X509_NAME* issuerName, ASN1_INTEGER* issuerSerial) {
+    unsigned long hash;
 
-    /* success */
-    return(1);
+    xmlSecAssert2(issuerName != NULL, 0);
+    xmlSecAssert2(issuerSerial != NULL, 0);
+
+    hash = xmlSecOpenSSLX509IndexHashName(issuerName);
+    return(xmlSecOpenSSLX509IndexHashBytes(hash, ASN1_STRING_get0_data(issuerSerial), ASN1_STRING_length(issuerSerial)));
 }
 
+/* returns 1 if cert has SKI, 0 if not, and a negative value if an error occurs */
 static int
-xmlSecOpenSSLX509MatchBySki(X509* cert, const xmlSecByte* ski, int skiLen) {
+xmlSecOpenSSLX509IndexHashSki(X509* cert, unsigned long* hash) {
     X509_EXTENSION* ext;
     ASN1_OCTET_STRING* keyId;
     int index;
 
     xmlSecAssert2(cert != NULL, -1);
-
-    if((ski == NULL) || (skiLen <= 0)) {
-        return(0);
-    }
+    xmlSecAssert2(hash != NULL, -1);
 
     index = X509_get_ext_by_NID(cert, NID_subject_key_identifier, -1);
     if(index < 0) {
@@ -1515,90 +3101,346 @@ xmlSecOpenSSLX509MatchBySki(X509* cert, const xmlSecByte* ski, int skiLen) {
     if(keyId == NULL) {
         return(0);
     }
-    if((keyId->length != skiLen) || (memcmp(keyId->data, ski, (size_t)skiLen) != 0)) {
-        ASN1_OCTET_STRING_free(keyId);
-        return(0);
-    }
+    (*hash) = xmlSecOpenSSLX509IndexHashBytes(XMLSEC_OPENSSL_X509_INDEX_HASH_INIT,
+        ASN1_STRING_get0_data(keyId), ASN1_STRING_length(keyId));
     ASN1_OCTET_STRING_free(keyId);
-
-    /* success */
     return(1);
 }
 
 static int
-xmlSecOpenSSLX509MatchByDigest(X509* cert, const xmlSecByte * digestValue, unsigned int digestLen, const EVP_MD* digest) {
-    xmlSecByte md[EVP_MAX_MD_SIZE];
-    unsigned int len = 0;
-    int ret;
+xmlSecOpenSSLX509CertIndexAdd(xmlSecOpenSSLX509CertIndexPtr index, unsigned long hash, xmlSecSize pos) {
+    xmlSecSize lo, hi, mid;
 
-    xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(index != NULL, -1);
 
-    if((digestValue == NULL) || (digestLen <= 0) || (digest == NULL)) {
-        return(0);
+    if(index->size >= index->maxSize) {
+        xmlSecOpenSSLX509CertIndexItemPtr newItems;
+        xmlSecSize newMaxSize;
+
+        newMaxSize = (index->maxSize > 0) ? 2 * index->maxSize : XMLSEC_OPENSSL_X509_INDEX_MIN_SIZE;
+        newItems = (xmlSecOpenSSLX509CertIndexItemPtr)xmlRealloc(index->items,
+            sizeof(xmlSecOpenSSLX509CertIndexItem) * newMaxSize);
+        if(newItems == NULL) {
+            xmlSecMallocError(sizeof(xmlSecOpenSSLX509CertIndexItem) * newMaxSize, NULL);
+            return(-1);
+        }
+        index->items = newItems;
+        index->maxSize = newMaxSize;
     }
 
-    ret = X509_digest(cert, digest, md, &len);
-    if((ret != 1) || (len <= 0)) {
-        xmlSecOpenSSLError("X509_digest", NULL);
-        return(-1);
+    /* insert after all the items with the same hash: the certs are always
+     * appended to the stack thus the items stay sorted by pos too */
+    lo = 0;
+    hi = index->size;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(index->items[mid].hash <= hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if(lo < index->size) {
+        memmove(&(index->items[lo + 1]), &(index->items[lo]),
+            sizeof(xmlSecOpenSSLX509CertIndexItem) * (index->size - lo));
     }
+    index->items[lo].hash = hash;
+    index->items[lo].pos = pos;
+    ++index->size;
+    return(0);
+}
 
-    if((len != digestLen) || (memcmp(md, digestValue, digestLen) != 0)) {
-        return(0);
+/* returns the position of the first item with the hash */
+static xmlSecSize
+xmlSecOpenSSLX509CertIndexFind(xmlSecOpenSSLX509CertIndexPtr index, unsigned long hash) {
+    xmlSecSize lo, hi, mid;
+
+    xmlSecAssert2(index != NULL, 0);
+
+    lo = 0;
+    hi = index->size;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(index->items[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
+    return(lo);
+}
 
-    /* success */
-    return(1);
+static void
+xmlSecOpenSSLX509CertIndexFinalize(xmlSecOpenSSLX509CertIndexPtr index) {
+    xmlSecAssert(index != NULL);
+
+    if(index->items != NULL) {
+        xmlFree(index->items);
+    }
+    memset(index, 0, sizeof(*index));
 }
 
-/* returns 1 for match, 0 for no match, and a negative value if an error occurs */
-int
-xmlSecOpenSSLX509FindCertCtxMatch(xmlSecOpenSSLX509FindCertCtxPtr ctx, X509* cert) {
+void
+xmlSecOpenSSLX509CertsIndexInitialize(xmlSecOpenSSLX509CertsIndexPtr certsIndex) {
+    xmlSecAssert(certsIndex != NULL);
+
+    memset(certsIndex, 0, sizeof(*certsIndex));
+}
+
+void
+xmlSecOpenSSLX509CertsIndexFinalize(xmlSecOpenSSLX509CertsIndexPtr certsIndex) {
+    xmlSecAssert(certsIndex != NULL);
+
+    xmlSecOpenSSLX509CertIndexFinalize(&(certsIndex->subjectIndex));
+    xmlSecOpenSSLX509CertIndexFinalize(&(certsIndex->issuerSerialIndex));
+    xmlSecOpenSSLX509CertIndexFinalize(&(certsIndex->skiIndex));
+    xmlSecOpenSSLX509CertIndexFinalize(&(certsIndex->sha1Index));
+    xmlSecOpenSSLX509CertIndexFinalize(&(certsIndex->sha256Index));
+}
+
+static int
+xmlSecOpenSSLX509CertsIndexAddDigest(xmlSecOpenSSLX509CertIndexPtr index, X509* cert, const EVP_MD* md, xmlSecSize pos) {
+    xmlSecByte buf[EVP_MAX_MD_SIZE];
+    unsigned int bufLen = 0;
+    unsigned long hash;
     int ret;
 
-    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(index != NULL, -1);
     xmlSecAssert2(cert != NULL, -1);
+    xmlSecAssert2(md != NULL, -1);
 
-    ret = xmlSecOpenSSLX509MatchBySubjectName(cert, ctx->subjectName);
+    ret = X509_digest(cert, md, buf, &bufLen);
+    if((ret != 1) || (bufLen <= 0)) {
+        xmlSecOpenSSLError("X509_digest", NULL);
+        return(-1);
+    }
+    hash = xmlSecOpenSSLX509IndexHashBytes(XMLSEC_OPENSSL_X509_INDEX_HASH_INIT, buf, (int)bufLen);
+    ret = xmlSecOpenSSLX509CertIndexAdd(index, hash, pos);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecOpenSSLX509MatchBySubjectName", NULL);
+        xmlSecInternalError("xmlSecOpenSSLX509CertIndexAdd", NULL);
         return(-1);
-    } else if(ret == 1) {
-        /* success! */
-        return(1);
     }
+    return(0);
+}
 
-    ret = xmlSecOpenSSLX509MatchByIssuer(cert, ctx->issuerName, ctx->issuerSerial);
+/* adds @cert at @pos (greater than the positions of all the indexed certs) to all the indexes */
+int
+xmlSecOpenSSLX509CertsIndexAdd(xmlSecOpenSSLX509CertsIndexPtr certsIndex, X509* cert, xmlSecSize pos) {
+    X509_NAME* name;
+    ASN1_INTEGER* serial;
+    unsigned long hash = 0;
+    int ret;
+
+    xmlSecAssert2(certsIndex != NULL, -1);
+    xmlSecAssert2(cert != NULL, -1);
+
+    /* subject */
+    name = X509_get_subject_name(cert);
+    if(name != NULL) {
+        ret = xmlSecOpenSSLX509CertIndexAdd(&(certsIndex->subjectIndex), xmlSecOpenSSLX509IndexHashName(name), pos);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CertIndexAdd(subject)", NULL);
+            return(-1);
+        }
+    }
+
+    /* issuer and serial */
+    name = X509_get_issuer_name(cert);
+    serial = X509_get_serialNumber(cert);
+    if((name != NULL) && (serial != NULL)) {
+        ret = xmlSecOpenSSLX509CertIndexAdd(&(certsIndex->issuerSerialIndex), xmlSecOpenSSLX509IndexHashIssuerSerial(name, serial), pos);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CertIndexAdd(issuerSerial)", NULL);
+            return(-1);
+        }
+    }
+
+    /* ski */
+    ret = xmlSecOpenSSLX509IndexHashSki(cert, &hash);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecOpenSSLX509MatchByIssuer", NULL);
+        xmlSecInternalError("xmlSecOpenSSLX509IndexHashSki", NULL);
         return(-1);
-    } else if(ret == 1) {
-        /* success! */
-        return(1);
+    } else if(ret > 0) {
+        ret = xmlSecOpenSSLX509CertIndexAdd(&(certsIndex->skiIndex), hash, pos);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CertIndexAdd(ski)", NULL);
+            return(-1);
+        }
     }
 
-    ret = xmlSecOpenSSLX509MatchBySki(cert, ctx->ski, ctx->skiLen);
+    /* digests: only SHA1 and SHA256 (the default X509Digest algorithm) are indexed */
+    ret = xmlSecOpenSSLX509CertsIndexAddDigest(&(certsIndex->sha1Index), cert, EVP_sha1(), pos);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecOpenSSLX509MatchBySki", NULL);
+        xmlSecInternalError("xmlSecOpenSSLX509CertsIndexAddDigest(sha1)", NULL);
         return(-1);
-    } else if(ret == 1) {
-        /* success! */
-        return(1);
     }
-
-    ret = xmlSecOpenSSLX509MatchByDigest(cert, ctx->digestValue, ctx->digestLen, ctx->digestMd);
+    ret = xmlSecOpenSSLX509CertsIndexAddDigest(&(certsIndex->sha256Index), cert, EVP_sha256(), pos);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecOpenSSLX509MatchByDigest", NULL);
+        xmlSecInternalError("xmlSecOpenSSLX509CertsIndexAddDigest(sha256)", NULL);
         return(-1);
-    } else if(ret == 1) {
-        /* success! */
-        return(1);
     }
 
-    /* not found */
+    /* done */
+    return(0);
+}
+
+/* searches the index for the first cert (with the position less than @maxPos)
+ * that matches @findCertCtx, updates @maxPos with the cert position if found */
+static int
+xmlSecOpenSSLX509CertsIndexFindInIndex(xmlSecOpenSSLX509CertIndexPtr index, unsigned long hash,
+    xmlSecOpenSSLX509FindCertCtxPtr findCertCtx, xmlSecOpenSSLX509CertsIndexGetCertMethod getCert,
+    void* certsCtx, xmlSecSize* maxPos
+) {
+    xmlSecSize ii;
+    X509* cert;
+    int ret;
+
+    xmlSecAssert2(index != NULL, -1);
+    xmlSecAssert2(findCertCtx != NULL, -1);
+    xmlSecAssert2(getCert != NULL, -1);
+    xmlSecAssert2(maxPos != NULL, -1);
+
+    for(ii = xmlSecOpenSSLX509CertIndexFind(index, hash); (ii < index->size) && (index->items[ii].hash == hash); ++ii) {
+        if(index->items[ii].pos >= (*maxPos)) {
+            break;
+        }
+        cert = getCert(certsCtx, index->items[ii].pos);
+        if(cert == NULL) {
+            continue;
+        }
+        ret = xmlSecOpenSSLX509FindCertCtxMatch(findCertCtx, cert);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509FindCertCtxMatch", NULL);
+            return(-1);
+        } else if(ret == 1) {
+            (*maxPos) = index->items[ii].pos;
+            break;
+        }
+    }
+    return(0);
+}
+
+/* searches the certs list for the first cert that matches @findCertCtx, returns its
+ * position in @pos or @certsSize if not found, and a negative value if an error occurs */
+int
+xmlSecOpenSSLX509CertsIndexFind(xmlSecOpenSSLX509CertsIndexPtr certsIndex, xmlSecOpenSSLX509FindCertCtxPtr findCertCtx,
+    xmlSecOpenSSLX509CertsIndexGetCertMethod getCert, void* certsCtx, xmlSecSize certsSize, xmlSecSize* pos
+) {
+    xmlSecOpenSSLX509CertIndexPtr digestIndex = NULL;
+    xmlSecSize ii;
+    unsigned long hash;
+    int ret;
+
+    xmlSecAssert2(certsIndex != NULL, -1);
+    xmlSecAssert2(findCertCtx != NULL, -1);
+    xmlSecAssert2(getCert != NULL, -1);
+    xmlSecAssert2(pos != NULL, -1);
+
+    (*pos) = certsSize;
+    if(findCertCtx->subjectName != NULL) {
+        hash = xmlSecOpenSSLX509IndexHashName(findCertCtx->subjectName);
+        ret = xmlSecOpenSSLX509CertsIndexFindInIndex(&(certsIndex->subjectIndex), hash, findCertCtx, getCert, certsCtx, pos);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CertsIndexFindInIndex(subject)", NULL);
+            return(-1);
+        }
+    }
+    if((findCertCtx->issuerName != NULL) && (findCertCtx->issuerSerial != NULL)) {
+        hash = xmlSecOpenSSLX509IndexHashIssuerSerial(findCertCtx->issuerName, findCertCtx->issuerSerial);
+        ret = xmlSecOpenSSLX509CertsIndexFindInIndex(&(certsIndex->issuerSerialIndex), hash, findCertCtx, getCert, certsCtx, pos);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CertsIndexFindInIndex(issuerSerial)", NULL);
+            return(-1);
+        }
+    }
+    if((findCertCtx->ski != NULL) && (findCertCtx->skiLen > 0)) {
+        hash = xmlSecOpenSSLX509IndexHashBytes(XMLSEC_OPENSSL_X509_INDEX_HASH_INIT, findCertCtx->ski, findCertCtx->skiLen);
+        ret = xmlSecOpenSSLX509CertsIndexFindInIndex(&(certsIndex->skiIndex), hash, findCertCtx, getCert, certsCtx, pos);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecOpenSSLX509CertsIndexFindInIndex(ski)", NULL);
+            return(-1);
+        }
+    }
+    if((findCertCtx->digestValue != NULL) && (findCertCtx->digestLen > 0) && (findCertCtx->digestMd != NULL)) {
+        switch(EVP_MD_type(findCertCtx->digestMd)) {
+        case NID_sha1:
+            digestIndex = &(certsIndex->sha1Index);
+            break;
+        case NID_sha256:
+            digestIndex = &(certsIndex->sha256Index);
+            break;
+        default:
+            digestIndex = NULL;
+            break;
+        }
+
+        if(digestIndex != NULL) {
+            hash = xmlSecOpenSSLX509IndexHashBytes(XMLSEC_OPENSSL_X509_INDEX_HASH_INIT,
+                findCertCtx->digestValue, (int)findCertCtx->digestLen);
+            ret = xmlSecOpenSSLX509CertsIndexFindInIndex(digestIndex, hash, findCertCtx, getCert, certsCtx, pos);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecOpenSSLX509CertsIndexFindInIndex(digest)", NULL);
+                return(-1);
+            }
+        } else {
+            /* other digest algorithms are not indexed */
+            for(ii = 0; ii < (*pos); ++ii) {
+                X509 * cert = getCert(certsCtx, ii);
+                if(cert == NULL) {
+                    continue;
+                }
+
+                ret = xmlSecOpenSSLX509FindCertCtxMatch(findCertCtx, cert);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecOpenSSLX509FindCertCtxMatch", NULL);
+                    return(-1);
+                } else if(ret == 1) {
+                    (*pos) = ii;
+                    break;
+                }
+            }
+        }
+    }
+
+    /* done */
     return(0);
 }
 
+static X509*
+xmlSecOpenSSLX509StoreGetUntrustedCert(void* certsCtx, xmlSecSize pos) {
+    STACK_OF(X509)* untrusted = (STACK_OF(X509)*)certsCtx;
+    int iPos;
+
+    xmlSecAssert2(untrusted != NULL, NULL);
+
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(pos, iPos, return(NULL), NULL);
+    return(sk_X509_value(untrusted, iPos));
+}
+
+/* finds the first cert in the untrusted stack that matches @findCertCtx */
+static X509*
+xmlSecOpenSSLX509StoreFindCertInIndex(xmlSecOpenSSLX509StoreCtxPtr ctx, xmlSecOpenSSLX509FindCertCtxPtr findCertCtx) {
+    xmlSecSize size, pos;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->untrusted != NULL, NULL);
+    xmlSecAssert2(findCertCtx != NULL, NULL);
+
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(sk_X509_num(ctx->untrusted), size, return(NULL), NULL);
+    ret = xmlSecOpenSSLX509CertsIndexFind(&(ctx->certsIndex), findCertCtx,
+        xmlSecOpenSSLX509StoreGetUntrustedCert, ctx->untrusted, size, &pos);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecOpenSSLX509CertsIndexFind", NULL);
+        return(NULL);
+    }
+    if(pos >= size) {
+        /* not found */
+        return(NULL);
+    }
+    return(xmlSecOpenSSLX509StoreGetUntrustedCert(ctx->untrusted, pos));
+}
+
 static unsigned long
 xmlSecOpenSSLX509GetSubjectHash(X509* x) {
     X509_NAME* name;
@@ -1747,6 +3589,188 @@ xmlSecOpenSSLX509FindChildCert(STACK_OF(X509) *chain, X509 *cert) {
     return(NULL);
 }
 
+/**************************************************************************
+ *
+ * Parsed DN strings cache (disabled by default): the same few
+ * &lt;dsig:X509SubjectName/&gt; and &lt;dsig:X509IssuerName/&gt; strings
+ * are usually included in every document. The cache maps the DN string
+ * to the DER encoding of the parsed X509_NAME: decoding DER skips the
+ * string parsing and the attribute names lookups. The certs are found by
+ * the name hash in the store index (see xmlSecOpenSSLX509CertsIndex).
+ *
+ *************************************************************************/
+typedef struct _xmlSecOpenSSLX509NameCacheEntry {
+    xmlChar*            str;
+    xmlSecByte*         der;
+    int                 derLen;
+} xmlSecOpenSSLX509NameCacheEntry, *xmlSecOpenSSLX509NameCacheEntryPtr;
+
+static xmlMutexPtr                          gXmlSecOpenSSLX509NameCacheMutex = NULL;
+static xmlSecOpenSSLX509NameCacheEntryPtr   gXmlSecOpenSSLX509NameCacheEntries = NULL;
+static xmlSecSize                           gXmlSecOpenSSLX509NameCacheMaxSize = 0;
+static xmlSecSize                           gXmlSecOpenSSLX509NameCachePos = 0;
+
+static void
+xmlSecOpenSSLX509NameCacheEntryClear(xmlSecOpenSSLX509NameCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->str != NULL) {
+        xmlFree(entry->str);
+    }
+    if(entry->der != NULL) {
+        OPENSSL_free(entry->der);
+    }
+    memset(entry, 0, sizeof(*entry));
+}
+
+/**
+ * xmlSecOpenSSLX509EnableNamesCache:
+ * @maxSize:            the max number of cached names.
+ *
+ * Enables the process wide cache of the parsed &lt;dsig:X509SubjectName/&gt;
+ * and &lt;dsig:X509IssuerName/&gt; DN strings used to find the certificates
+ * in the X509 store: the same DN strings are parsed once. This function is
+ * not thread safe and should be called during the application initialization.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecOpenSSLX509EnableNamesCache(xmlSecSize maxSize) {
+    xmlSecAssert2(maxSize > 0, -1);
+
+    xmlSecOpenSSLX509DisableNamesCache();
+
+    gXmlSecOpenSSLX509NameCacheEntries = (xmlSecOpenSSLX509NameCacheEntryPtr)xmlMalloc(sizeof(xmlSecOpenSSLX509NameCacheEntry) * maxSize);
+    if(gXmlSecOpenSSLX509NameCacheEntries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecOpenSSLX509NameCacheEntry) * maxSize, NULL);
+        return(-1);
+    }
+    memset(gXmlSecOpenSSLX509NameCacheEntries, 0, sizeof(xmlSecOpenSSLX509NameCacheEntry) * maxSize);
+
+    gXmlSecOpenSSLX509NameCacheMutex = xmlNewMutex();
+    if(gXmlSecOpenSSLX509NameCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(gXmlSecOpenSSLX509NameCacheEntries);
+        gXmlSecOpenSSLX509NameCacheEntries = NULL;
+        return(-1);
+    }
+    gXmlSecOpenSSLX509NameCacheMaxSize = maxSize;
+    gXmlSecOpenSSLX509NameCachePos = 0;
+    return(0);
+}
+
+/**
+ * xmlSecOpenSSLX509DisableNamesCache:
+ *
+ * Disables the parsed DN strings cache and releases the cached names.
+ * This function is not thread safe and is called from #xmlSecOpenSSLShutdown.
+ */
+void
+xmlSecOpenSSLX509DisableNamesCache(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecOpenSSLX509NameCacheEntries != NULL) {
+        for(ii = 0; ii < gXmlSecOpenSSLX509NameCacheMaxSize; ++ii) {
+            xmlSecOpenSSLX509NameCacheEntryClear(&(gXmlSecOpenSSLX509NameCacheEntries[ii]));
+        }
+        xmlFree(gXmlSecOpenSSLX509NameCacheEntries);
+        gXmlSecOpenSSLX509NameCacheEntries = NULL;
+    }
+    if(gXmlSecOpenSSLX509NameCacheMutex != NULL) {
+        xmlFreeMutex(gXmlSecOpenSSLX509NameCacheMutex);
+        gXmlSecOpenSSLX509NameCacheMutex = NULL;
+    }
+    gXmlSecOpenSSLX509NameCacheMaxSize = 0;
+    gXmlSecOpenSSLX509NameCachePos = 0;
+}
+
+/* returns a new name decoded from the cached DER or NULL if not found */
+static X509_NAME*
+xmlSecOpenSSLX509NameCacheFind(const xmlChar* str) {
+    xmlSecOpenSSLX509NameCacheEntryPtr entry;
+    const unsigned char* p;
+    X509_NAME* res = NULL;
+    xmlSecSize ii;
+
+    xmlSecAssert2(str != NULL, NULL);
+    xmlSecAssert2(gXmlSecOpenSSLX509NameCacheMutex != NULL, NULL);
+
+    xmlMutexLock(gXmlSecOpenSSLX509NameCacheMutex);
+    for(ii = 0; ii < gXmlSecOpenSSLX509NameCacheMaxSize; ++ii) {
+        entry = &(gXmlSecOpenSSLX509NameCacheEntries[ii]);
+        if((entry->str != NULL) && (xmlStrEqual(entry->str, str))) {
+            p = entry->der;
+            res = d2i_X509_NAME(NULL, &p, entry->derLen);
+            if(res == NULL) {
+                xmlSecOpenSSLError("d2i_X509_NAME", NULL);
+            }
+            break;
+        }
+    }
+    xmlMutexUnlock(gXmlSecOpenSSLX509NameCacheMutex);
+    return(res);
+}
+
+/* not fatal if the name can't be cached */
+static void
+xmlSecOpenSSLX509NameCacheAdd(const xmlChar* str, X509_NAME* name) {
+    xmlSecOpenSSLX509NameCacheEntry newEntry;
+    xmlSecOpenSSLX509NameCacheEntryPtr entry;
+
+    xmlSecAssert(str != NULL);
+    xmlSecAssert(name != NULL);
+    xmlSecAssert(gXmlSecOpenSSLX509NameCacheMutex != NULL);
+
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.derLen = i2d_X509_NAME(name, &(newEntry.der));
+    if((newEntry.derLen <= 0) || (newEntry.der == NULL)) {
+        xmlSecOpenSSLError("i2d_X509_NAME", NULL);
+        xmlSecOpenSSLX509NameCacheEntryClear(&newEntry);
+        return;
+    }
+    newEntry.str = xmlStrdup(str);
+    if(newEntry.str == NULL) {
+        xmlSecStrdupError(str, NULL);
+        xmlSecOpenSSLX509NameCacheEntryClear(&newEntry);
+        return;
+    }
+
+    xmlMutexLock(gXmlSecOpenSSLX509NameCacheMutex);
+    if(gXmlSecOpenSSLX509NameCachePos >= gXmlSecOpenSSLX509NameCacheMaxSize) {
+        gXmlSecOpenSSLX509NameCachePos = 0;
+    }
+    entry = &(gXmlSecOpenSSLX509NameCacheEntries[gXmlSecOpenSSLX509NameCachePos++]);
+    xmlSecOpenSSLX509NameCacheEntryClear(entry);
+    memcpy(entry, &newEntry, sizeof(newEntry));
+    xmlMutexUnlock(gXmlSecOpenSSLX509NameCacheMutex);
+}
+
+static X509_NAME*
+xmlSecOpenSSLX509NameReadCached(const xmlChar *str) {
+    X509_NAME* res;
+
+    xmlSecAssert2(str != NULL, NULL);
+
+    if(gXmlSecOpenSSLX509NameCacheMutex == NULL) {
+        return(xmlSecOpenSSLX509NameRead(str));
+    }
+
+    res = xmlSecOpenSSLX509NameCacheFind(str);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheX509Name, (res != NULL) ? 1 : 0);
+    if(res != NULL) {
+        return(res);
+    }
+
+    res = xmlSecOpenSSLX509NameRead(str);
+    if(res == NULL) {
+        xmlSecInternalError("xmlSecOpenSSLX509NameRead", NULL);
+        return(NULL);
+    }
+    xmlSecOpenSSLX509NameCacheAdd(str, res);
+    return(res);
+}
+
 static X509_NAME *
 xmlSecOpenSSLX509NameRead(const xmlChar *str) {
     xmlSecByte name[256];
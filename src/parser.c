@@ -20,8 +20,12 @@
 #include <string.h>
 
 #include <libxml/tree.h>
+#include <libxml/dict.h>
 #include <libxml/parser.h>
 #include <libxml/parserInternals.h>
+#include <libxml/SAX2.h>
+#include <libxml/threads.h>
+#include <libxml/uri.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/xmltree.h>
@@ -30,7 +34,10 @@
 #include <xmlsec/parser.h>
 #include <xmlsec/errors.h>
 
+#include "c14n_native.h"
 #include "cast_helpers.h"
+#include "filemap.h"
+#include "parser_helpers.h"
 
 /**************************************************************************
  *
@@ -41,6 +48,11 @@ typedef struct _xmlSecParserCtx                                 xmlSecParserCtx,
                                                                 *xmlSecParserCtxPtr;
 struct _xmlSecParserCtx {
     xmlParserCtxtPtr    parserCtx;
+
+    /* the next C14N transform is executed while the document is parsed */
+    xmlSecC14NNativeStreamPtr stream;
+    xmlOutputBufferPtr  streamBuf;
+    int                 streamFailed;
 };
 
 /**************************************************************************
@@ -92,6 +104,257 @@ static xmlSecTransformKlass xmlSecParserKlass = {
 };
 
 
+/**************************************************************************
+ *
+ * Parser and C14N streaming: the SAX events are canonicalized directly,
+ * each element is freed when it ends and the character data, comments
+ * and PIs are never added to the document.
+ *
+ *************************************************************************/
+#define xmlSecParserStreamGetCtx(ctxt) \
+    ((xmlSecParserCtxPtr)((ctxt)->_private))
+
+static void
+xmlSecParserStreamFail(xmlParserCtxtPtr ctxt, const char* func) {
+    xmlSecParserCtxPtr ctx;
+
+    xmlSecAssert(ctxt != NULL);
+    ctx = xmlSecParserStreamGetCtx(ctxt);
+    xmlSecAssert(ctx != NULL);
+
+    xmlSecInternalError(func, NULL);
+    ctx->streamFailed = 1;
+    xmlStopParser(ctxt);
+}
+
+static void
+xmlSecParserStreamStartElementNs(void* userData, const xmlChar* localname, const xmlChar* prefix,
+                                 const xmlChar* URI, int nb_namespaces, const xmlChar** namespaces,
+                                 int nb_attributes, int nb_defaulted, const xmlChar** attributes) {
+    xmlParserCtxtPtr ctxt = (xmlParserCtxtPtr)userData;
+    xmlSecParserCtxPtr ctx;
+
+    xmlSecAssert(ctxt != NULL);
+    ctx = xmlSecParserStreamGetCtx(ctxt);
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->stream != NULL);
+
+    xmlSAX2StartElementNs(ctxt, localname, prefix, URI, nb_namespaces, namespaces,
+                          nb_attributes, nb_defaulted, attributes);
+    if((ctxt->node == NULL) || (ctxt->node->type != XML_ELEMENT_NODE) ||
+       (!xmlStrEqual(ctxt->node->name, localname))) {
+        xmlSecParserStreamFail(ctxt, "xmlSAX2StartElementNs");
+        return;
+    }
+    if(xmlSecC14NNativeStreamStartElement(ctx->stream, ctxt->node) < 0) {
+        xmlSecParserStreamFail(ctxt, "xmlSecC14NNativeStreamStartElement");
+        return;
+    }
+}
+
+static void
+xmlSecParserStreamEndElementNs(void* userData, const xmlChar* localname, const xmlChar* prefix,
+                               const xmlChar* URI) {
+    xmlParserCtxtPtr ctxt = (xmlParserCtxtPtr)userData;
+    xmlSecParserCtxPtr ctx;
+    xmlNodePtr cur;
+
+    xmlSecAssert(ctxt != NULL);
+    ctx = xmlSecParserStreamGetCtx(ctxt);
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->stream != NULL);
+
+    cur = ctxt->node;
+    if(cur == NULL) {
+        xmlSecParserStreamFail(ctxt, "xmlSAX2EndElementNs");
+        return;
+    }
+    if(xmlSecC14NNativeStreamEndElement(ctx->stream, cur) < 0) {
+        xmlSecParserStreamFail(ctxt, "xmlSecC14NNativeStreamEndElement");
+        return;
+    }
+    xmlSAX2EndElementNs(ctxt, localname, prefix, URI);
+
+    /* the children are already freed */
+    xmlUnlinkNode(cur);
+    xmlFreeNode(cur);
+}
+
+static void
+xmlSecParserStreamNode(xmlParserCtxtPtr ctxt, xmlNodePtr cur) {
+    xmlSecParserCtxPtr ctx;
+
+    xmlSecAssert(ctxt != NULL);
+    ctx = xmlSecParserStreamGetCtx(ctxt);
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->stream != NULL);
+
+    if(cur == NULL) {
+        xmlSecParserStreamFail(ctxt, "xmlNewDocNode");
+        return;
+    }
+    if(xmlSecC14NNativeStreamNode(ctx->stream, cur) < 0) {
+        xmlSecParserStreamFail(ctxt, "xmlSecC14NNativeStreamNode");
+    }
+    xmlFreeNode(cur);
+}
+
+static void
+xmlSecParserStreamCharacters(void* userData, const xmlChar* ch, int len) {
+    xmlParserCtxtPtr ctxt = (xmlParserCtxtPtr)userData;
+
+    xmlSecAssert(ctxt != NULL);
+    xmlSecParserStreamNode(ctxt, xmlNewDocTextLen(ctxt->myDoc, ch, len));
+}
+
+static void
+xmlSecParserStreamCDataBlock(void* userData, const xmlChar* value, int len) {
+    xmlParserCtxtPtr ctxt = (xmlParserCtxtPtr)userData;
+
+    xmlSecAssert(ctxt != NULL);
+    xmlSecParserStreamNode(ctxt, xmlNewCDataBlock(ctxt->myDoc, value, len));
+}
+
+static void
+xmlSecParserStreamComment(void* userData, const xmlChar* value) {
+    xmlParserCtxtPtr ctxt = (xmlParserCtxtPtr)userData;
+
+    xmlSecAssert(ctxt != NULL);
+    xmlSecParserStreamNode(ctxt, xmlNewDocComment(ctxt->myDoc, value));
+}
+
+static void
+xmlSecParserStreamProcessingInstruction(void* userData, const xmlChar* target, const xmlChar* data) {
+    xmlParserCtxtPtr ctxt = (xmlParserCtxtPtr)userData;
+
+    xmlSecAssert(ctxt != NULL);
+    xmlSecParserStreamNode(ctxt, xmlNewDocPI(ctxt->myDoc, target, data));
+}
+
+static void
+xmlSecParserStreamReference(void* userData, const xmlChar* name) {
+    xmlParserCtxtPtr ctxt = (xmlParserCtxtPtr)userData;
+    xmlSecParserCtxPtr ctx;
+
+    xmlSecAssert(ctxt != NULL);
+    ctx = xmlSecParserStreamGetCtx(ctxt);
+    xmlSecAssert(ctx != NULL);
+
+    /* same as the native C14N: the entities should be substituted */
+    xmlSecOtherError2(XMLSEC_ERRORS_R_NOT_IMPLEMENTED, NULL,
+        "entity reference is not supported: name=%s", xmlSecErrorsSafeString(name));
+    ctx->streamFailed = 1;
+    xmlStopParser(ctxt);
+}
+
+/* returns 1 if the next C14N transform is executed while the document is parsed,
+ * 0 if the document should be built or a negative value if an error occurs */
+static int
+xmlSecParserStreamStart(xmlSecTransformPtr transform, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecParserCtxPtr ctx;
+    xmlSecTransformPtr c14n;
+    xmlSAXHandler sax;
+    xmlC14NMode mode = XML_C14N_1_0;
+    xmlChar** inclusiveNsPrefixes = NULL;
+    int withComments = 0;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformXmlParserId), -1);
+    xmlSecAssert2(transform->next != NULL, -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    ctx = xmlSecParserGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->parserCtx == NULL, -1);
+    xmlSecAssert2(ctx->stream == NULL, -1);
+
+    c14n = transform->next;
+    ret = xmlSecTransformC14NGetStreamMode(c14n, transformCtx, &mode, &inclusiveNsPrefixes, &withComments);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformC14NGetStreamMode", xmlSecTransformGetName(transform));
+        return(-1);
+    } else if(ret == 0) {
+        return(0);
+    }
+
+    /* same output as xmlSecTransformC14NPushXml(): next transform or c14n itself */
+    if(c14n->next != NULL) {
+        ctx->streamBuf = xmlSecTransformCreateOutputBuffer(c14n->next, transformCtx);
+        if(ctx->streamBuf == NULL) {
+            xmlSecInternalError("xmlSecTransformCreateOutputBuffer", xmlSecTransformGetName(c14n));
+            return(-1);
+        }
+    } else {
+        ctx->streamBuf = xmlSecBufferCreateOutputBuffer(&(c14n->outBuf));
+        if(ctx->streamBuf == NULL) {
+            xmlSecInternalError("xmlSecBufferCreateOutputBuffer", xmlSecTransformGetName(c14n));
+            return(-1);
+        }
+    }
+    ctx->stream = xmlSecC14NNativeStreamCreate(mode, inclusiveNsPrefixes, withComments, ctx->streamBuf);
+    if(ctx->stream == NULL) {
+        xmlSecInternalError("xmlSecC14NNativeStreamCreate", xmlSecTransformGetName(c14n));
+        return(-1);
+    }
+
+    memset(&sax, 0, sizeof(sax));
+    xmlSAXVersion(&sax, 2);
+    sax.startElementNs          = xmlSecParserStreamStartElementNs;
+    sax.endElementNs            = xmlSecParserStreamEndElementNs;
+    sax.characters              = xmlSecParserStreamCharacters;
+    sax.ignorableWhitespace     = xmlSecParserStreamCharacters;
+    sax.cdataBlock              = xmlSecParserStreamCDataBlock;
+    sax.comment                 = xmlSecParserStreamComment;
+    sax.processingInstruction   = xmlSecParserStreamProcessingInstruction;
+    sax.reference               = xmlSecParserStreamReference;
+
+    ctx->parserCtx = xmlCreatePushParserCtxt(&sax, NULL, NULL, 0, NULL);
+    if(ctx->parserCtx == NULL) {
+        xmlSecXmlError("xmlCreatePushParserCtxt", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    xmlSecParsePrepareCtxt(ctx->parserCtx);
+    ctx->parserCtx->_private = ctx;
+
+    c14n->status = xmlSecTransformStatusWorking;
+    return(1);
+}
+
+static int
+xmlSecParserStreamFinish(xmlSecTransformPtr transform) {
+    xmlSecParserCtxPtr ctx;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformXmlParserId), -1);
+    xmlSecAssert2(transform->next != NULL, -1);
+
+    ctx = xmlSecParserGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->parserCtx != NULL, -1);
+    xmlSecAssert2(ctx->stream != NULL, -1);
+    xmlSecAssert2(ctx->streamBuf != NULL, -1);
+
+    if((ctx->streamFailed != 0) || (ctx->parserCtx->wellFormed == 0)) {
+        xmlSecXmlParserError("xmlParseChunk", ctx->parserCtx, xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    ret = xmlSecC14NNativeStreamFinish(ctx->stream);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeStreamFinish", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+
+    /* pushes the final chunk to the next transforms */
+    ret = xmlOutputBufferClose(ctx->streamBuf);
+    ctx->streamBuf = NULL;
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", xmlSecTransformGetName(transform->next));
+        return(-1);
+    }
+    transform->next->status = xmlSecTransformStatusFinished;
+    return(0);
+}
+
 /**
  * xmlSecTransformXmlParserGetKlass:
  *
@@ -136,6 +399,12 @@ xmlSecParserFinalize(xmlSecTransformPtr transform) {
         }
         xmlFreeParserCtxt(ctx->parserCtx);
     }
+    if(ctx->stream != NULL) {
+        xmlSecC14NNativeStreamDestroy(ctx->stream);
+    }
+    if(ctx->streamBuf != NULL) {
+        (void)xmlOutputBufferClose(ctx->streamBuf);
+    }
     memset(ctx, 0, sizeof(xmlSecParserCtx));
 }
 
@@ -155,12 +424,19 @@ xmlSecParserPushBin(xmlSecTransformPtr transform, const xmlSecByte* data,
     if(transform->status == xmlSecTransformStatusNone) {
         xmlSecAssert2(ctx->parserCtx == NULL, -1);
 
-        ctx->parserCtx = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, NULL);
-        if(ctx->parserCtx == NULL) {
-            xmlSecXmlError("xmlCreatePushParserCtxt", xmlSecTransformGetName(transform));
+        /* the whole document is canonicalized: no need to build it */
+        ret = (transform->next != NULL) ? xmlSecParserStreamStart(transform, transformCtx) : 0;
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecParserStreamStart", xmlSecTransformGetName(transform));
             return(-1);
+        } else if(ret == 0) {
+            ctx->parserCtx = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, NULL);
+            if(ctx->parserCtx == NULL) {
+                xmlSecXmlError("xmlCreatePushParserCtxt", xmlSecTransformGetName(transform));
+                return(-1);
+            }
+            xmlSecParsePrepareCtxt(ctx->parserCtx);
         }
-        xmlSecParsePrepareCtxt(ctx->parserCtx);
 
         transform->status = xmlSecTransformStatusWorking;
     } else if(transform->status == xmlSecTransformStatusFinished) {
@@ -172,10 +448,16 @@ xmlSecParserPushBin(xmlSecTransformPtr transform, const xmlSecByte* data,
     xmlSecAssert2(transform->status == xmlSecTransformStatusWorking, -1);
     xmlSecAssert2(ctx->parserCtx != NULL, -1);
 
-    /* push data to the input buffer */
-    if((data != NULL) && (dataSize > 0)) {
+    /* push data to the input buffer: when streaming, in chunks to keep
+     * the parser input small (e.g. the mapped files are pushed at once) */
+    while((data != NULL) && (dataSize > 0)) {
+        xmlSecSize chunkSize = dataSize;
         int dataLen;
-        XMLSEC_SAFE_CAST_SIZE_TO_INT(dataSize, dataLen, return(-1), xmlSecTransformGetName(transform));
+
+        if((ctx->stream != NULL) && (transformCtx->binaryChunkSize > 0) && (chunkSize > transformCtx->binaryChunkSize)) {
+            chunkSize = transformCtx->binaryChunkSize;
+        }
+        XMLSEC_SAFE_CAST_SIZE_TO_INT(chunkSize, dataLen, return(-1), xmlSecTransformGetName(transform));
         ret = xmlParseChunk(ctx->parserCtx, (const char*)data, dataLen, 0);
         if(ret != 0) {
             xmlSecXmlParserError2("xmlParseChunk", ctx->parserCtx,
@@ -183,10 +465,25 @@ xmlSecParserPushBin(xmlSecTransformPtr transform, const xmlSecByte* data,
                 "size=%d", dataLen);
             return(-1);
         }
+        data += chunkSize;
+        dataSize -= chunkSize;
     }
 
     /* finish parsing and push to next in the chain */
-    if(final != 0) {
+    if((final != 0) && (ctx->stream != NULL)) {
+        ret = xmlParseChunk(ctx->parserCtx, NULL, 0, 1);
+        if(ret != 0) {
+            xmlSecXmlParserError("xmlParseChunk", ctx->parserCtx,
+                xmlSecTransformGetName(transform));
+            return(-1);
+        }
+        ret = xmlSecParserStreamFinish(transform);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecParserStreamFinish", xmlSecTransformGetName(transform));
+            return(-1);
+        }
+        transform->status = xmlSecTransformStatusFinished;
+    } else if(final != 0) {
         ret = xmlParseChunk(ctx->parserCtx, NULL, 0, 1);
         if((ret != 0) || (ctx->parserCtx->myDoc == NULL)) {
             xmlSecXmlParserError("xmlParseChunk", ctx->parserCtx,
@@ -346,6 +643,20 @@ typedef struct _xmlSecExtMemoryParserCtx {
     xmlSecSize                  postfixSize;
 } xmlSecExtMemoryParserCtx, *xmlSecExtMemoryParserCtxPtr;
 
+/* gzip and xz files are decompressed by libxml2 file input, the mapping can't be parsed directly */
+static int
+xmlSecParseIsCompressed(const xmlSecByte* data, xmlSecSize size) {
+    xmlSecAssert2(data != NULL, 0);
+
+    if((size >= 2) && (data[0] == 0x1F) && (data[1] == 0x8B)) {
+        return(1);
+    }
+    if((size >= 6) && (memcmp(data, "\xFD" "7zXZ\x00", 6) == 0)) {
+        return(1);
+    }
+    return(0);
+}
+
 /**
  * xmlSecParseFile:
  * @filename:           the filename.
@@ -357,18 +668,46 @@ typedef struct _xmlSecExtMemoryParserCtx {
  */
 xmlDocPtr
 xmlSecParseFile(const char *filename) {
-    xmlParserCtxtPtr ctxt;
+    xmlParserCtxtPtr ctxt = NULL;
+    xmlSecFileMap map;
+    int mapped;
     int ret;
     xmlDocPtr res = NULL;
 
     xmlSecAssert2(filename != NULL, NULL);
 
     xmlInitParser();
-    ctxt = xmlCreateFileParserCtxt(filename);
-    if (ctxt == NULL) {
-        xmlSecXmlError2("xmlCreateFileParserCtxt", NULL,
-                        "filename=%s", xmlSecErrorsSafeString(filename));
-        goto done;
+
+    /* parse the regular uncompressed files directly from the memory mapping */
+    mapped = xmlSecFileMapOpen(&map, filename);
+    if((mapped == 1) && ((map.size > INT_MAX) || xmlSecParseIsCompressed(map.data, map.size))) {
+        xmlSecFileMapClose(&map);
+        mapped = 0;
+    }
+    if(mapped == 1) {
+        ctxt = xmlCreateMemoryParserCtxt((const char*)map.data, (int)map.size);
+        if (ctxt == NULL) {
+            xmlSecXmlError2("xmlCreateMemoryParserCtxt", NULL,
+                            "filename=%s", xmlSecErrorsSafeString(filename));
+            goto done;
+        }
+
+        /* the document URL is used to resolve relative URIs */
+        if((ctxt->input != NULL) && (ctxt->input->filename == NULL)) {
+            ctxt->input->filename = (char*)xmlCanonicPath(BAD_CAST filename);
+            if(ctxt->input->filename == NULL) {
+                xmlSecXmlError2("xmlCanonicPath", NULL,
+                                "filename=%s", xmlSecErrorsSafeString(filename));
+                goto done;
+            }
+        }
+    } else {
+        ctxt = xmlCreateFileParserCtxt(filename);
+        if (ctxt == NULL) {
+            xmlSecXmlError2("xmlCreateFileParserCtxt", NULL,
+                            "filename=%s", xmlSecErrorsSafeString(filename));
+            goto done;
+        }
     }
     xmlSecParsePrepareCtxt(ctxt);
 
@@ -408,6 +747,9 @@ done:
         }
         xmlFreeParserCtxt(ctxt);
     }
+    if(mapped == 1) {
+        xmlSecFileMapClose(&map);
+    }
     return(res);
 
 }
@@ -429,10 +771,37 @@ xmlDocPtr
 xmlSecParseMemoryExt(const xmlSecByte *prefix, xmlSecSize prefixSize,
                      const xmlSecByte *buffer, xmlSecSize bufferSize,
                      const xmlSecByte *postfix, xmlSecSize postfixSize) {
+    xmlSecParserInputSegment segments[3];
+
+    segments[0].data = prefix;
+    segments[0].size = prefixSize;
+    segments[1].data = buffer;
+    segments[1].size = bufferSize;
+    segments[2].data = postfix;
+    segments[2].size = postfixSize;
+    return(xmlSecParseMemoryVec(segments, 3));
+}
+
+/**
+ * xmlSecParseMemoryVec:
+ * @segments:           the input segments.
+ * @segmentsSize:       the number of segments in @segments.
+ *
+ * Loads XML Doc from the concatenation of the @segments: the segments
+ * are passed to the parser one by one without copying them into one
+ * buffer first. Empty segments (with NULL data or zero size) are skipped.
+ *
+ * Returns: pointer to the loaded XML document or NULL if an error occurs.
+ */
+xmlDocPtr
+xmlSecParseMemoryVec(const xmlSecParserInputSegment *segments, xmlSecSize segmentsSize) {
     xmlParserCtxtPtr ctxt = NULL;
     xmlDocPtr doc = NULL;
+    xmlSecSize ii;
     int ret;
 
+    xmlSecAssert2((segments != NULL) || (segmentsSize == 0), NULL);
+
     /* create context */
     ctxt = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, NULL);
     if(ctxt == NULL) {
@@ -441,41 +810,18 @@ xmlSecParseMemoryExt(const xmlSecByte *prefix, xmlSecSize prefixSize,
     }
     xmlSecParsePrepareCtxt(ctxt);
 
-    /* prefix */
-    if((prefix != NULL) && (prefixSize > 0)) {
-        int prefixLen;
-
-        XMLSEC_SAFE_CAST_SIZE_TO_INT(prefixSize, prefixLen, goto done, NULL);
-        ret = xmlParseChunk(ctxt, (const char*)prefix, prefixLen, 0);
-        if(ret != 0) {
-            xmlSecXmlParserError2("xmlParseChunk", ctxt, NULL,
-                "chunkSize=%d", prefixLen);
-            goto done;
-        }
-    }
-
-    /* buffer */
-    if((buffer != NULL) && (bufferSize > 0)) {
-        int bufferLen;
+    for(ii = 0; ii < segmentsSize; ++ii) {
+        int len;
 
-        XMLSEC_SAFE_CAST_SIZE_TO_INT(bufferSize, bufferLen, goto done, NULL);
-        ret = xmlParseChunk(ctxt, (const char*)buffer, bufferLen, 0);
-        if(ret != 0) {
-            xmlSecXmlParserError2("xmlParseChunk", ctxt, NULL,
-                "chunkSize=%d", bufferLen);
-            goto done;
+        if((segments[ii].data == NULL) || (segments[ii].size <= 0)) {
+            continue;
         }
-    }
 
-    /* postfix */
-    if((postfix != NULL) && (postfixSize > 0)) {
-        int postfixLen;
-
-        XMLSEC_SAFE_CAST_SIZE_TO_INT(postfixSize, postfixLen, goto done, NULL);
-        ret = xmlParseChunk(ctxt, (const char*)postfix, postfixLen, 0);
+        XMLSEC_SAFE_CAST_SIZE_TO_INT(segments[ii].size, len, goto done, NULL);
+        ret = xmlParseChunk(ctxt, (const char*)segments[ii].data, len, 0);
         if(ret != 0) {
             xmlSecXmlParserError2("xmlParseChunk", ctxt, NULL,
-                "chunkSize=%d", postfixLen);
+                "chunkSize=%d", len);
             goto done;
         }
     }
@@ -602,3 +948,440 @@ xmlSecParserGetDefaultOptions(void) {
 void xmlSecParserSetDefaultOptions(int options) {
     g_xmlsec_parser_default_options = options;
 }
+
+/**************************************************************************
+ *
+ * Shared dictionary
+ *
+ *************************************************************************/
+static xmlDictPtr g_xmlsec_parser_dict = NULL;
+
+/* maps the xmlsec string constants (by pointer) to their copies in the shared dictionary */
+#define XMLSEC_PARSER_DICT_NAMES_SIZE   257
+typedef struct _xmlSecParserDictName {
+    const xmlChar*      name;
+    const xmlChar*      interned;
+} xmlSecParserDictName;
+static xmlSecParserDictName g_xmlsec_parser_dict_names[XMLSEC_PARSER_DICT_NAMES_SIZE];
+
+#define XMLSEC_PARSER_DICT_NAME_HASH(name) \
+    ((xmlSecSize)(((size_t)(name)) % XMLSEC_PARSER_DICT_NAMES_SIZE))
+
+static void
+xmlSecParserDictNameAdd(const xmlChar* name, const xmlChar* interned) {
+    xmlSecSize pos, ii;
+
+    xmlSecAssert(name != NULL);
+    xmlSecAssert(interned != NULL);
+
+    pos = XMLSEC_PARSER_DICT_NAME_HASH(name);
+    for(ii = 0; ii < XMLSEC_PARSER_DICT_NAMES_SIZE; ++ii, pos = (pos + 1) % XMLSEC_PARSER_DICT_NAMES_SIZE) {
+        if(g_xmlsec_parser_dict_names[pos].name == name) {
+            return;
+        }
+        if(g_xmlsec_parser_dict_names[pos].name == NULL) {
+            g_xmlsec_parser_dict_names[pos].name = name;
+            g_xmlsec_parser_dict_names[pos].interned = interned;
+            return;
+        }
+    }
+    /* the table is full: the name simply won't have the fast path */
+}
+
+/**
+ * xmlSecParserDictInitialize:
+ *
+ * Creates the dictionary shared by the pooled parsers and seeds it with
+ * the xmlsec element, attribute and namespace names. On failure the pooled
+ * parsers fall back to the per-document dictionaries.
+ */
+void
+xmlSecParserDictInitialize(void) {
+    const xmlChar* interned;
+    xmlSecSize ii;
+
+    if(g_xmlsec_parser_dict != NULL) {
+        return;
+    }
+
+    g_xmlsec_parser_dict = xmlDictCreate();
+    if(g_xmlsec_parser_dict == NULL) {
+        xmlSecXmlError("xmlDictCreate", NULL);
+        return;
+    }
+
+    /* the dictionary is read-only after this point */
+    for(ii = 0; xmlSecStringsDictNames[ii] != NULL; ++ii) {
+        interned = xmlDictLookup(g_xmlsec_parser_dict, xmlSecStringsDictNames[ii], -1);
+        if(interned == NULL) {
+            xmlSecXmlError2("xmlDictLookup", NULL,
+                "name=%s", xmlSecErrorsSafeString(xmlSecStringsDictNames[ii]));
+            xmlSecParserDictShutdown();
+            return;
+        }
+        xmlSecParserDictNameAdd(xmlSecStringsDictNames[ii], interned);
+    }
+}
+
+/**
+ * xmlSecParserDictShutdown:
+ *
+ * Releases the dictionary shared by the pooled parsers. The documents
+ * created by the pooled parsers hold their own references.
+ */
+void
+xmlSecParserDictShutdown(void) {
+    memset(g_xmlsec_parser_dict_names, 0, sizeof(g_xmlsec_parser_dict_names));
+    if(g_xmlsec_parser_dict != NULL) {
+        xmlDictFree(g_xmlsec_parser_dict);
+        g_xmlsec_parser_dict = NULL;
+    }
+}
+
+/**
+ * xmlSecParserGetDict:
+ *
+ * Gets the dictionary shared by the pooled parsers.
+ *
+ * Returns: the shared dictionary or NULL if it is not available.
+ */
+xmlDictPtr
+xmlSecParserGetDict(void) {
+    return(g_xmlsec_parser_dict);
+}
+
+/**
+ * xmlSecParserDictFindName:
+ * @name:               the xmlsec string constant (e.g. #xmlSecNodeSignature).
+ *
+ * Finds the copy of the string constant @name in the shared dictionary.
+ * The lookup is done by the pointer, the strings that are not the xmlsec
+ * constants are not found even if they have the same value.
+ *
+ * Returns: the dictionary string or NULL if @name is not an xmlsec constant.
+ */
+const xmlChar*
+xmlSecParserDictFindName(const xmlChar* name) {
+    xmlSecSize pos, ii;
+
+    if((name == NULL) || (g_xmlsec_parser_dict == NULL)) {
+        return(NULL);
+    }
+
+    pos = XMLSEC_PARSER_DICT_NAME_HASH(name);
+    for(ii = 0; ii < XMLSEC_PARSER_DICT_NAMES_SIZE; ++ii, pos = (pos + 1) % XMLSEC_PARSER_DICT_NAMES_SIZE) {
+        if(g_xmlsec_parser_dict_names[pos].name == name) {
+            return(g_xmlsec_parser_dict_names[pos].interned);
+        }
+        if(g_xmlsec_parser_dict_names[pos].name == NULL) {
+            break;
+        }
+    }
+    return(NULL);
+}
+
+/**************************************************************************
+ *
+ * Parser pool
+ *
+ *************************************************************************/
+struct _xmlSecParserPool {
+    xmlMutexPtr         mutex;
+    xmlParserCtxtPtr*   ctxts;
+    xmlSecSize          maxSize;
+    xmlSecSize          size;
+};
+
+static xmlParserCtxtPtr xmlSecParserPoolAcquire                 (xmlSecParserPoolPtr pool);
+static void             xmlSecParserPoolRelease                 (xmlSecParserPoolPtr pool,
+                                                                 xmlParserCtxtPtr ctxt);
+static int              xmlSecParserPoolResetCtxt               (xmlParserCtxtPtr ctxt,
+                                                                 const char* filename);
+static xmlDocPtr        xmlSecParserPoolParse                   (xmlSecParserPoolPtr pool,
+                                                                 const xmlSecByte* data,
+                                                                 xmlSecSize size,
+                                                                 const char* filename);
+
+/**
+ * xmlSecParserPoolCreate:
+ * @maxSize:            the max number of the idle parser contexts kept in the pool.
+ *
+ * Creates a pool of the parser contexts. The documents parsed with the pool
+ * share the names from the xmlsec dictionary (each document gets its own
+ * sub-dictionary, so the documents can be used from different threads).
+ * Unlike #xmlSecParseFile or #xmlSecParseMemory, the nodes of these documents
+ * can only be moved to another document with xmlDOMWrapAdoptNode() or by
+ * copying them.
+ *
+ * Returns: the pointer to newly allocated pool or NULL if an error occurs.
+ * The caller is responsible for destroying the pool with #xmlSecParserPoolDestroy.
+ */
+xmlSecParserPoolPtr
+xmlSecParserPoolCreate(xmlSecSize maxSize) {
+    xmlSecParserPoolPtr pool;
+
+    xmlSecAssert2(maxSize > 0, NULL);
+
+    pool = (xmlSecParserPoolPtr)xmlMalloc(sizeof(xmlSecParserPool));
+    if(pool == NULL) {
+        xmlSecMallocError(sizeof(xmlSecParserPool), NULL);
+        return(NULL);
+    }
+    memset(pool, 0, sizeof(xmlSecParserPool));
+    pool->maxSize = maxSize;
+
+    pool->ctxts = (xmlParserCtxtPtr*)xmlMalloc(sizeof(xmlParserCtxtPtr) * maxSize);
+    if(pool->ctxts == NULL) {
+        xmlSecMallocError(sizeof(xmlParserCtxtPtr) * maxSize, NULL);
+        xmlSecParserPoolDestroy(pool);
+        return(NULL);
+    }
+
+    pool->mutex = xmlNewMutex();
+    if(pool->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlSecParserPoolDestroy(pool);
+        return(NULL);
+    }
+    return(pool);
+}
+
+/**
+ * xmlSecParserPoolDestroy:
+ * @pool:               the pointer to the parser pool.
+ *
+ * Destroys the pool and all the idle parser contexts.
+ */
+void
+xmlSecParserPoolDestroy(xmlSecParserPoolPtr pool) {
+    xmlSecSize ii;
+
+    xmlSecAssert(pool != NULL);
+
+    if(pool->ctxts != NULL) {
+        for(ii = 0; ii < pool->size; ++ii) {
+            xmlFreeParserCtxt(pool->ctxts[ii]);
+        }
+        xmlFree(pool->ctxts);
+    }
+    if(pool->mutex != NULL) {
+        xmlFreeMutex(pool->mutex);
+    }
+    memset(pool, 0, sizeof(xmlSecParserPool));
+    xmlFree(pool);
+}
+
+/**
+ * xmlSecParserPoolParseMemory:
+ * @pool:               the pointer to the parser pool.
+ * @buffer:             the input buffer.
+ * @size:               the input buffer size.
+ *
+ * Loads XML Doc from memory using a parser context from the @pool.
+ *
+ * Returns: pointer to the loaded XML document or NULL if an error occurs.
+ */
+xmlDocPtr
+xmlSecParserPoolParseMemory(xmlSecParserPoolPtr pool, const xmlSecByte* buffer, xmlSecSize size) {
+    xmlSecAssert2(pool != NULL, NULL);
+    xmlSecAssert2(buffer != NULL, NULL);
+
+    return(xmlSecParserPoolParse(pool, buffer, size, NULL));
+}
+
+/**
+ * xmlSecParserPoolParseFile:
+ * @pool:               the pointer to the parser pool.
+ * @filename:           the filename.
+ *
+ * Loads XML Doc from file @filename using a parser context from the @pool.
+ * The compressed files and the files that can't be mapped into memory
+ * are loaded with #xmlSecParseFile.
+ *
+ * Returns: pointer to the loaded XML document or NULL if an error occurs.
+ */
+xmlDocPtr
+xmlSecParserPoolParseFile(xmlSecParserPoolPtr pool, const char* filename) {
+    xmlSecFileMap map;
+    xmlDocPtr res;
+
+    xmlSecAssert2(pool != NULL, NULL);
+    xmlSecAssert2(filename != NULL, NULL);
+
+    if(xmlSecFileMapOpen(&map, filename) != 1) {
+        return(xmlSecParseFile(filename));
+    }
+    if(xmlSecParseIsCompressed(map.data, map.size)) {
+        xmlSecFileMapClose(&map);
+        return(xmlSecParseFile(filename));
+    }
+
+    res = xmlSecParserPoolParse(pool, map.data, map.size, filename);
+    xmlSecFileMapClose(&map);
+    return(res);
+}
+
+static xmlParserCtxtPtr
+xmlSecParserPoolAcquire(xmlSecParserPoolPtr pool) {
+    xmlParserCtxtPtr ctxt = NULL;
+
+    xmlSecAssert2(pool != NULL, NULL);
+    xmlSecAssert2(pool->mutex != NULL, NULL);
+
+    xmlMutexLock(pool->mutex);
+    if(pool->size > 0) {
+        ctxt = pool->ctxts[--pool->size];
+        pool->ctxts[pool->size] = NULL;
+    }
+    xmlMutexUnlock(pool->mutex);
+
+    if(ctxt == NULL) {
+        ctxt = xmlNewParserCtxt();
+        if(ctxt == NULL) {
+            xmlSecXmlError("xmlNewParserCtxt", NULL);
+            return(NULL);
+        }
+    }
+    return(ctxt);
+}
+
+static void
+xmlSecParserPoolRelease(xmlSecParserPoolPtr pool, xmlParserCtxtPtr ctxt) {
+    xmlSecAssert(pool != NULL);
+    xmlSecAssert(pool->mutex != NULL);
+    xmlSecAssert(ctxt != NULL);
+
+    if(ctxt->myDoc != NULL) {
+        xmlFreeDoc(ctxt->myDoc);
+        ctxt->myDoc = NULL;
+    }
+
+    xmlMutexLock(pool->mutex);
+    if(pool->size < pool->maxSize) {
+        pool->ctxts[pool->size++] = ctxt;
+        ctxt = NULL;
+    }
+    xmlMutexUnlock(pool->mutex);
+
+    if(ctxt != NULL) {
+        xmlFreeParserCtxt(ctxt);
+    }
+}
+
+static int
+xmlSecParserPoolResetCtxt(xmlParserCtxtPtr ctxt, const char* filename) {
+    xmlDictPtr dict;
+    int ret;
+
+    xmlSecAssert2(ctxt != NULL, -1);
+
+    /* release the strings of the previous document while the old dictionary is alive */
+    xmlCtxtReset(ctxt);
+
+    /* every document gets a fresh dictionary backed by the shared one */
+    if(xmlSecParserGetDict() != NULL) {
+        dict = xmlDictCreateSub(xmlSecParserGetDict());
+    } else {
+        dict = xmlDictCreate();
+    }
+    if(dict == NULL) {
+        xmlSecXmlError("xmlDictCreateSub", NULL);
+        return(-1);
+    }
+    if(ctxt->dict != NULL) {
+        xmlDictFree(ctxt->dict);
+    }
+    ctxt->dict = dict;
+    ctxt->str_xml = xmlDictLookup(dict, BAD_CAST "xml", 3);
+    ctxt->str_xmlns = xmlDictLookup(dict, BAD_CAST "xmlns", 5);
+    ctxt->str_xml_ns = xmlDictLookup(dict, XML_XML_NAMESPACE, 36);
+    if((ctxt->str_xml == NULL) || (ctxt->str_xmlns == NULL) || (ctxt->str_xml_ns == NULL)) {
+        xmlSecXmlError("xmlDictLookup", NULL);
+        return(-1);
+    }
+
+    ret = xmlCtxtResetPush(ctxt, NULL, 0, filename, NULL);
+    if(ret != 0) {
+        xmlSecXmlError2("xmlCtxtResetPush", NULL,
+            "filename=%s", xmlSecErrorsSafeString(filename));
+        return(-1);
+    }
+
+    /* same as xmlSecParsePrepareCtxt() but the names go to the dictionary */
+    ctxt->loadsubset = XML_DETECT_IDS | XML_COMPLETE_ATTRS;
+    ctxt->replaceEntities = 1;
+    xmlCtxtUseOptions(ctxt, xmlSecParserGetDefaultOptions() & ~XML_PARSE_NODICT);
+    ctxt->dictNames = 1;
+
+    if((filename != NULL) && (ctxt->directory == NULL)) {
+        ctxt->directory = xmlParserGetDirectory(filename);
+        if(ctxt->directory == NULL) {
+            xmlSecXmlError2("xmlParserGetDirectory", NULL,
+                "filename=%s", xmlSecErrorsSafeString(filename));
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static xmlDocPtr
+xmlSecParserPoolParse(xmlSecParserPoolPtr pool, const xmlSecByte* data, xmlSecSize size,
+                      const char* filename) {
+    xmlParserCtxtPtr ctxt;
+    xmlSecSize chunkSize;
+    int chunkLen;
+    int ret;
+    xmlDocPtr res = NULL;
+
+    xmlSecAssert2(pool != NULL, NULL);
+    xmlSecAssert2(data != NULL, NULL);
+
+    xmlInitParser();
+
+    ctxt = xmlSecParserPoolAcquire(pool);
+    if(ctxt == NULL) {
+        xmlSecInternalError("xmlSecParserPoolAcquire", NULL);
+        return(NULL);
+    }
+
+    ret = xmlSecParserPoolResetCtxt(ctxt, filename);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecParserPoolResetCtxt", NULL);
+        /* don't put a half reset context back to the pool */
+        xmlFreeParserCtxt(ctxt);
+        return(NULL);
+    }
+
+    while(size > 0) {
+        chunkSize = (size < INT_MAX) ? size : INT_MAX;
+        XMLSEC_SAFE_CAST_SIZE_TO_INT(chunkSize, chunkLen, goto done, NULL);
+
+        ret = xmlParseChunk(ctxt, (const char*)data, chunkLen, 0);
+        if(ret != 0) {
+            xmlSecXmlParserError2("xmlParseChunk", ctxt, NULL,
+                "filename=%s", xmlSecErrorsSafeString(filename));
+            goto done;
+        }
+        data += chunkSize;
+        size -= chunkSize;
+    }
+    ret = xmlParseChunk(ctxt, NULL, 0, 1);
+    if(ret != 0) {
+        xmlSecXmlParserError2("xmlParseChunk", ctxt, NULL,
+            "filename=%s", xmlSecErrorsSafeString(filename));
+        goto done;
+    }
+
+    if(!ctxt->wellFormed) {
+        xmlSecInternalError("document is not well formed", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = ctxt->myDoc;
+    ctxt->myDoc = NULL;
+
+done:
+    xmlSecParserPoolRelease(pool, ctxt);
+    return(res);
+}
@@ -0,0 +1,33 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Internal header only used during the compilation,
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_PARSER_HELPERS_H__
+#define __XMLSEC_PARSER_HELPERS_H__
+
+
+#ifndef XMLSEC_PRIVATE
+#error "parser_helpers.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <libxml/dict.h>
+
+#include <xmlsec/xmlsec.h>
+
+/**************************** Shared parser dictionary ********************************/
+
+/* NULL terminated list of the element, attribute and namespace names (strings.c) */
+extern const xmlChar* const xmlSecStringsDictNames[];
+
+void            xmlSecParserDictInitialize                      (void);
+void            xmlSecParserDictShutdown                        (void);
+xmlDictPtr      xmlSecParserGetDict                             (void);
+const xmlChar*  xmlSecParserDictFindName                        (const xmlChar* name);
+
+#endif /* __XMLSEC_PARSER_HELPERS_H__ */
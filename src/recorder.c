@@ -0,0 +1,286 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The workload recorder for the replay load generator.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/**
+ * SECTION:recorder
+ * @Short_description: The workload recorder functions.
+ * @Stability: Stable
+ *
+ * When started with #xmlSecRecorderStart, the library saves the input
+ * documents of #xmlSecDSigCtxVerify, #xmlSecDSigCtxSign and
+ * #xmlSecEncCtxDecrypt operations to the recorder folder and appends
+ * one line for each operation to the #XMLSEC_RECORDER_MANIFEST_FILENAME
+ * file in this folder:
+ *
+ *      &lt;file&gt; &lt;op&gt; &lt;flags&gt; &lt;flags2&gt; &lt;result&gt; &lt;key name&gt;
+ *
+ * where &lt;op&gt; is "verify", "sign" or "decrypt", &lt;flags&gt; and
+ * &lt;flags2&gt; are the operation context flags (hex), &lt;result&gt;
+ * is "ok", "invalid" or "error" and &lt;key name&gt; is the name of the
+ * key used for the operation ("-" if the key has no name). The keys and
+ * the operations results (e.g. the decrypted data) are never saved.
+ * The recorded workload is replayed by the benchmarks/xmlsecreplay tool.
+ */
+
+#include "globals.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <libxml/tree.h>
+#include <libxml/threads.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/recorder.h>
+#include <xmlsec/errors.h>
+
+/* the extra space for the "/<record>.xml" file name */
+#define XMLSEC_RECORDER_FILENAME_EXTRA_SIZE             64
+
+static xmlMutexPtr      gXmlSecRecorderMutex = NULL;
+static int              gXmlSecRecorderEnabled = 0;
+static char*            gXmlSecRecorderDirname = NULL;
+static FILE*            gXmlSecRecorderManifest = NULL;
+static xmlSecSize       gXmlSecRecorderRecords = 0;
+static xmlSecSize       gXmlSecRecorderMaxRecords = 0;
+
+static void             xmlSecRecorderStopInternal      (void);
+
+/**
+ * xmlSecRecorderInit:
+ *
+ * Initializes the workload recorder. It is called from #xmlSecInit function
+ * and applications must not call this function directly.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecRecorderInit(void) {
+    xmlSecAssert2(gXmlSecRecorderMutex == NULL, -1);
+
+    gXmlSecRecorderMutex = xmlNewMutex();
+    if(gXmlSecRecorderMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecRecorderShutdown:
+ *
+ * Stops the workload recorder. It is called from #xmlSecShutdown function
+ * and applications must not call this function directly.
+ */
+void
+xmlSecRecorderShutdown(void) {
+    xmlSecRecorderStopInternal();
+    if(gXmlSecRecorderMutex != NULL) {
+        xmlFreeMutex(gXmlSecRecorderMutex);
+        gXmlSecRecorderMutex = NULL;
+    }
+}
+
+/**
+ * xmlSecRecorderStart:
+ * @dirname:            the existing folder for the recorded documents.
+ * @maxRecords:         the max number of the recorded operations (0 for no limit).
+ *
+ * Starts recording the operations to @dirname (see the recorder section
+ * description). The #XMLSEC_RECORDER_MANIFEST_FILENAME file is overwritten.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecRecorderStart(const char* dirname, xmlSecSize maxRecords) {
+    char* filename = NULL;
+    size_t len;
+    int res = -1;
+
+    xmlSecAssert2(dirname != NULL, -1);
+    xmlSecAssert2(gXmlSecRecorderMutex != NULL, -1);
+
+    len = strlen(dirname) + XMLSEC_RECORDER_FILENAME_EXTRA_SIZE;
+    filename = (char*)xmlMalloc(len);
+    if(filename == NULL) {
+        xmlSecMallocError(len, NULL);
+        return(-1);
+    }
+    snprintf(filename, len, "%s/%s", dirname, XMLSEC_RECORDER_MANIFEST_FILENAME);
+
+    xmlMutexLock(gXmlSecRecorderMutex);
+    xmlSecRecorderStopInternal();
+
+    gXmlSecRecorderDirname = (char*)xmlStrdup(BAD_CAST dirname);
+    if(gXmlSecRecorderDirname == NULL) {
+        xmlSecStrdupError(BAD_CAST dirname, NULL);
+        goto done;
+    }
+    gXmlSecRecorderManifest = fopen(filename, "w");
+    if(gXmlSecRecorderManifest == NULL) {
+        xmlSecIOError("fopen", filename, NULL);
+        xmlSecRecorderStopInternal();
+        goto done;
+    }
+    fprintf(gXmlSecRecorderManifest, "# file op flags flags2 result keyname\n");
+    gXmlSecRecorderRecords = 0;
+    gXmlSecRecorderMaxRecords = maxRecords;
+    gXmlSecRecorderEnabled = 1;
+
+    /* success */
+    res = 0;
+
+done:
+    xmlMutexUnlock(gXmlSecRecorderMutex);
+    xmlFree(filename);
+    return(res);
+}
+
+/**
+ * xmlSecRecorderStop:
+ *
+ * Stops recording the operations and closes the recorder files.
+ */
+void
+xmlSecRecorderStop(void) {
+    if(gXmlSecRecorderMutex == NULL) {
+        return;
+    }
+    xmlMutexLock(gXmlSecRecorderMutex);
+    xmlSecRecorderStopInternal();
+    xmlMutexUnlock(gXmlSecRecorderMutex);
+}
+
+/**
+ * xmlSecRecorderIsEnabled:
+ *
+ * Checks if the operations are recorded.
+ *
+ * Returns: 1 if the operations are recorded or 0 otherwise.
+ */
+int
+xmlSecRecorderIsEnabled(void) {
+    return((gXmlSecRecorderEnabled != 0) ? 1 : 0);
+}
+
+/* must be called under the mutex (or from shutdown) */
+static void
+xmlSecRecorderStopInternal(void) {
+    gXmlSecRecorderEnabled = 0;
+    if(gXmlSecRecorderManifest != NULL) {
+        fclose(gXmlSecRecorderManifest);
+        gXmlSecRecorderManifest = NULL;
+    }
+    if(gXmlSecRecorderDirname != NULL) {
+        xmlFree(gXmlSecRecorderDirname);
+        gXmlSecRecorderDirname = NULL;
+    }
+    gXmlSecRecorderRecords = 0;
+    gXmlSecRecorderMaxRecords = 0;
+}
+
+/**
+ * xmlSecRecorderAddDoc:
+ * @doc:                the operation input document.
+ *
+ * Saves @doc to the recorder folder before the operation starts (used by
+ * the xmlsec library). The operation is added with #xmlSecRecorderAddOp
+ * when it ends.
+ *
+ * Returns: the record number or 0 if the operations are not recorded
+ * (or the document can not be saved).
+ */
+xmlSecSize
+xmlSecRecorderAddDoc(xmlDocPtr doc) {
+    char* filename;
+    xmlSecSize record;
+    size_t len;
+    int ret;
+
+    xmlSecAssert2(doc != NULL, 0);
+
+    /* the cheap check first */
+    if((gXmlSecRecorderEnabled == 0) || (gXmlSecRecorderMutex == NULL)) {
+        return(0);
+    }
+
+    xmlMutexLock(gXmlSecRecorderMutex);
+    if((gXmlSecRecorderEnabled == 0) ||
+       ((gXmlSecRecorderMaxRecords > 0) && (gXmlSecRecorderRecords >= gXmlSecRecorderMaxRecords)))
+    {
+        xmlMutexUnlock(gXmlSecRecorderMutex);
+        return(0);
+    }
+    record = (++gXmlSecRecorderRecords);
+
+    len = strlen(gXmlSecRecorderDirname) + XMLSEC_RECORDER_FILENAME_EXTRA_SIZE;
+    filename = (char*)xmlMalloc(len);
+    if(filename == NULL) {
+        xmlSecMallocError(len, NULL);
+        xmlMutexUnlock(gXmlSecRecorderMutex);
+        return(0);
+    }
+    snprintf(filename, len, "%s/" XMLSEC_SIZE_FMT ".xml", gXmlSecRecorderDirname, record);
+    xmlMutexUnlock(gXmlSecRecorderMutex);
+
+    /* the document is saved as is (not formatted) to keep the signatures valid */
+    ret = xmlSaveFile(filename, doc);
+    if(ret < 0) {
+        xmlSecXmlError2("xmlSaveFile", NULL, "filename=%s", xmlSecErrorsSafeString(filename));
+        xmlFree(filename);
+        return(0);
+    }
+    xmlFree(filename);
+    return(record);
+}
+
+/**
+ * xmlSecRecorderAddOp:
+ * @record:             the record number returned by #xmlSecRecorderAddDoc.
+ * @op:                 the operation name ("verify", "sign" or "decrypt").
+ * @flags:              the operation context flags.
+ * @flags2:             the operation context flags2.
+ * @keyName:            the name of the key used for the operation or NULL.
+ * @result:             the operation result ("ok", "invalid" or "error").
+ *
+ * Adds the operation to the recorder manifest (used by the xmlsec library).
+ */
+void
+xmlSecRecorderAddOp(xmlSecSize record, const char* op, unsigned int flags, unsigned int flags2,
+                    const xmlChar* keyName, const char* result) {
+    const xmlChar* p;
+
+    xmlSecAssert(op != NULL);
+    xmlSecAssert(result != NULL);
+
+    if((record == 0) || (gXmlSecRecorderMutex == NULL)) {
+        return;
+    }
+
+    xmlMutexLock(gXmlSecRecorderMutex);
+    if((gXmlSecRecorderEnabled == 0) || (gXmlSecRecorderManifest == NULL)) {
+        xmlMutexUnlock(gXmlSecRecorderMutex);
+        return;
+    }
+    fprintf(gXmlSecRecorderManifest, XMLSEC_SIZE_FMT ".xml %s 0x%08x 0x%08x %s ",
+        record, op, flags, flags2, result);
+    if((keyName != NULL) && (keyName[0] != '\0')) {
+        /* one line per operation */
+        for(p = keyName; (*p) != '\0'; ++p) {
+            fputc((((*p) == '\n') || ((*p) == '\r')) ? ' ' : (int)(*p), gXmlSecRecorderManifest);
+        }
+        fputc('\n', gXmlSecRecorderManifest);
+    } else {
+        fprintf(gXmlSecRecorderManifest, "-\n");
+    }
+    fflush(gXmlSecRecorderManifest);
+    xmlMutexUnlock(gXmlSecRecorderMutex);
+}
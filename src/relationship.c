@@ -29,6 +29,7 @@
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "list_helpers.h"
 
 
 /**************************************************************************
@@ -102,8 +103,16 @@ typedef struct _xmlSecRelationshipCtx           xmlSecRelationshipCtx,
                                                 *xmlSecRelationshipCtxPtr;
 struct _xmlSecRelationshipCtx {
     xmlSecPtrListPtr                    sourceIdList;
+    xmlSecPtrListIndex                  sourceIdIndex;
 };
 
+/* the Relationship element and its Id for sorting */
+typedef struct _xmlSecRelationshipItem {
+    xmlNodePtr                          node;
+    xmlChar*                            id;
+    xmlSecSize                          pos;
+} xmlSecRelationshipItem, *xmlSecRelationshipItemPtr;
+
 XMLSEC_TRANSFORM_DECLARE(Relationship, xmlSecRelationshipCtx)
 #define xmlSecRelationshipSize XMLSEC_TRANSFORM_SIZE(Relationship)
 
@@ -121,6 +130,7 @@ static int              xmlSecRelationshipReadNode        (xmlSecTransformPtr tr
                                                            xmlNodePtr node,
                                                            xmlSecTransformCtxPtr transformCtx);
 
+static const xmlChar*   xmlSecRelationshipSourceIdGetKey  (xmlSecPtr item);
 static int              xmlSecTransformRelationshipProcessElementNode(xmlSecTransformPtr transform,
                                                             xmlOutputBufferPtr buf,
                                                             xmlNodePtr cur);
@@ -177,6 +187,7 @@ xmlSecRelationshipInitialize(xmlSecTransformPtr transform) {
 
     /* initialize context */
     memset(ctx, 0, sizeof(xmlSecRelationshipCtx));
+    xmlSecPtrListIndexInitialize(&(ctx->sourceIdIndex), xmlSecRelationshipSourceIdGetKey);
 
     ctx->sourceIdList = xmlSecPtrListCreate(xmlSecStringListId);
     if(ctx->sourceIdList == NULL) {
@@ -200,6 +211,7 @@ xmlSecRelationshipFinalize(xmlSecTransformPtr transform) {
     if(ctx->sourceIdList != NULL) {
        xmlSecPtrListDestroy(ctx->sourceIdList);
     }
+    xmlSecPtrListIndexFinalize(&(ctx->sourceIdIndex));
 
     memset(ctx, 0, sizeof(xmlSecRelationshipCtx));
 }
@@ -241,59 +253,80 @@ xmlSecRelationshipReadNode(xmlSecTransformPtr transform, xmlNodePtr node, xmlSec
         cur = cur->next;
     }
 
+    /* the SourceId lookups are done for every Relationship element */
+    ret = xmlSecPtrListIndexUpdate(&(ctx->sourceIdIndex), ctx->sourceIdList);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListIndexUpdate",
+                            xmlSecTransformGetName(transform));
+        return(-1);
+    }
+
     return(0);
 }
 
-/* Sorts Relationship elements by Id value in lexicographical order. */
+static const xmlChar*
+xmlSecRelationshipSourceIdGetKey(xmlSecPtr item) {
+    return((const xmlChar*)item);
+}
+
+/* returns 1 if @id is one of the SourceId values or 0 otherwise */
 static int
-xmlSecTransformRelationshipCompare(xmlNodePtr node1, xmlNodePtr node2) {
-    xmlChar* id1 = NULL;
-    xmlChar* id2 = NULL;
-    int ret;
+xmlSecRelationshipIsSourceId(xmlSecRelationshipCtxPtr ctx, const xmlChar* id) {
+    xmlSecSize ii;
 
-    if(node1 == node2) {
+    xmlSecAssert2(ctx != NULL, 0);
+    xmlSecAssert2(ctx->sourceIdList != NULL, 0);
+    xmlSecAssert2(id != NULL, 0);
+
+    if(xmlSecPtrListIndexIsValid(&(ctx->sourceIdIndex), ctx->sourceIdList)) {
+        for(ii = xmlSecPtrListIndexFirst(&(ctx->sourceIdIndex), id); ii > 0;
+            ii = xmlSecPtrListIndexNext(&(ctx->sourceIdIndex), ii))
+        {
+            if(xmlStrEqual((const xmlChar*)xmlSecPtrListGetItem(ctx->sourceIdList, ii - 1), id)) {
+                return(1);
+            }
+        }
         return(0);
     }
-    if(node1 == NULL) {
-        return(-1);
-    }
-    if(node2 == NULL) {
-        return(1);
-    }
 
-    id1 = xmlGetProp(node1, xmlSecRelationshipAttrId);
-    id2 = xmlGetProp(node2, xmlSecRelationshipAttrId);
-    if(id1 == NULL) {
-        ret = -1;
-        goto done;
-    }
-    if(id2 == NULL) {
-        ret = 1;
-        goto done;
+    for(ii = 0; ii < xmlSecPtrListGetSize(ctx->sourceIdList); ++ii) {
+        if(xmlStrEqual((const xmlChar*)xmlSecPtrListGetItem(ctx->sourceIdList, ii), id)) {
+            return(1);
+        }
     }
+    return(0);
+}
 
-    ret = xmlStrcmp(id1, id2);
+/* Sorts Relationship elements by Id value in lexicographical order
+ * (the elements without Id first, the equal ones in the document order). */
+static int
+xmlSecTransformRelationshipCompare(const void* item1, const void* item2) {
+    const xmlSecRelationshipItem* rel1 = (const xmlSecRelationshipItem*)item1;
+    const xmlSecRelationshipItem* rel2 = (const xmlSecRelationshipItem*)item2;
+    int ret;
 
-done:
-    if (id1 != NULL) {
-        xmlFree(id1);
+    if((rel1->id == NULL) && (rel2->id != NULL)) {
+        return(-1);
+    }
+    if((rel1->id != NULL) && (rel2->id == NULL)) {
+        return(1);
     }
-    if (id2 != NULL) {
-        xmlFree(id2);
+    ret = xmlStrcmp(rel1->id, rel2->id);
+    if(ret != 0) {
+        return(ret);
     }
-
-    return ret;
+    return((rel1->pos < rel2->pos) ? -1 : ((rel1->pos > rel2->pos) ? 1 : 0));
 }
 
 /*
  * This is step 2, point 4: if the input sourceId list doesn't contain the Id attribute of the current node,
- * then exclude it from the output, instead of processing it.
+ * then exclude it from the output, instead of processing it. The @id is the node's Id attribute
+ * value (if it was already read) or NULL.
  */
 static int
-xmlSecTransformRelationshipProcessNode(xmlSecTransformPtr transform, xmlOutputBufferPtr buf, xmlNodePtr cur) {
-    int found = -1;
+xmlSecTransformRelationshipProcessNode(xmlSecTransformPtr transform, xmlOutputBufferPtr buf,
+                                       xmlNodePtr cur, const xmlChar* id) {
     xmlSecRelationshipCtxPtr ctx;
-    xmlSecSize ii;
     int ret;
 
     xmlSecAssert2(transform != NULL, -1);
@@ -301,7 +334,6 @@ xmlSecTransformRelationshipProcessNode(xmlSecTransformPtr transform, xmlOutputBu
     xmlSecAssert2(cur != NULL, -1);
 
     if(xmlSecCheckNodeName(cur, xmlSecNodeRelationship, xmlSecRelationshipsNs)) {
-        xmlChar* id = xmlGetProp(cur, xmlSecRelationshipAttrId);
         if(id == NULL) {
             xmlSecXmlError2("xmlGetProp(xmlSecRelationshipAttrId)",
                             xmlSecTransformGetName(transform),
@@ -310,16 +342,9 @@ xmlSecTransformRelationshipProcessNode(xmlSecTransformPtr transform, xmlOutputBu
         }
 
         ctx = xmlSecRelationshipGetCtx(transform);
-        for(ii = 0; ii < xmlSecPtrListGetSize(ctx->sourceIdList); ++ii) {
-            if(xmlStrcmp((xmlChar *)xmlSecPtrListGetItem(ctx->sourceIdList, ii), id) == 0) {
-                found = 1;
-                break;
-            }
-        }
-
-        xmlFree(id);
+        xmlSecAssert2(ctx != NULL, -1);
 
-        if(found < 0) {
+        if(xmlSecRelationshipIsSourceId(ctx, id) == 0) {
             return(0);
         }
     }
@@ -335,61 +360,79 @@ xmlSecTransformRelationshipProcessNode(xmlSecTransformPtr transform, xmlOutputBu
 }
 
 /*
- * This is step 2, point 3: sort elements by Id: we process other elements as-is, but for elements we collect them in a list,
- * then sort, and finally process them (process the head of the list, then pop the head, till the list becomes empty).
+ * This is step 2, point 3: sort elements by Id: we process other elements as-is, but for elements we collect them
+ * (with the Id values read once) in an array, then sort the array, and finally process them in the sorted order.
  */
 static int
 xmlSecTransformRelationshipProcessNodeList(xmlSecTransformPtr transform, xmlOutputBufferPtr buf, xmlNodePtr cur) {
-    xmlListPtr list;
+    xmlSecRelationshipItemPtr items = NULL;
+    xmlSecSize itemsSize = 0;
+    xmlSecSize itemsMaxSize = 0;
+    xmlNodePtr node;
+    xmlSecSize ii;
     int ret;
+    int res = -1;
 
     xmlSecAssert2(transform != NULL, -1);
     xmlSecAssert2(buf != NULL, -1);
     xmlSecAssert2(cur != NULL, -1);
 
-    list = xmlListCreate(NULL, (xmlListDataCompare)xmlSecTransformRelationshipCompare);
-    if(list == NULL) {
-        xmlSecXmlError("xmlListCreate", xmlSecTransformGetName(transform));
-        return(-1);
+    for(node = cur; node != NULL; node = node->next) {
+        if(xmlStrcmp(node->name, xmlSecNodeRelationship) == 0) {
+            ++itemsMaxSize;
+        }
+    }
+    if(itemsMaxSize > 0) {
+        items = (xmlSecRelationshipItemPtr)xmlMalloc(sizeof(xmlSecRelationshipItem) * itemsMaxSize);
+        if(items == NULL) {
+            xmlSecMallocError(sizeof(xmlSecRelationshipItem) * itemsMaxSize,
+                              xmlSecTransformGetName(transform));
+            return(-1);
+        }
     }
 
-    for(; cur; cur = cur->next) {
-        if(xmlStrcmp(cur->name, xmlSecNodeRelationship) == 0) {
-            if(xmlListInsert(list, cur) != 0) {
-                xmlSecXmlError("xmlListInsert", xmlSecTransformGetName(transform));
-                return(-1);
-            }
+    for(node = cur; node != NULL; node = node->next) {
+        if(xmlStrcmp(node->name, xmlSecNodeRelationship) == 0) {
+            items[itemsSize].node = node;
+            items[itemsSize].id   = xmlGetProp(node, xmlSecRelationshipAttrId);
+            items[itemsSize].pos  = itemsSize;
+            ++itemsSize;
         } else {
-            ret = xmlSecTransformRelationshipProcessNode(transform, buf, cur);
+            ret = xmlSecTransformRelationshipProcessNode(transform, buf, node, NULL);
             if(ret < 0) {
                 xmlSecInternalError("xmlSecTransformRelationshipProcessNode",
                                     xmlSecTransformGetName(transform));
-                xmlListDelete(list);
-                return(-1);
+                goto done;
             }
         }
     }
 
-    xmlListSort(list);
-
-    while(!xmlListEmpty(list)) {
-        xmlLinkPtr link = xmlListFront(list);
-        xmlNodePtr node = (xmlNodePtr)xmlLinkGetData(link);
+    if(itemsSize > 1) {
+        qsort(items, itemsSize, sizeof(xmlSecRelationshipItem), xmlSecTransformRelationshipCompare);
+    }
 
-        ret = xmlSecTransformRelationshipProcessNode(transform, buf, node);
+    for(ii = 0; ii < itemsSize; ++ii) {
+        ret = xmlSecTransformRelationshipProcessNode(transform, buf, items[ii].node, items[ii].id);
         if(ret < 0) {
             xmlSecInternalError("xmlSecTransformRelationshipProcessNode",
                                 xmlSecTransformGetName(transform));
-            xmlListDelete(list);
-            return(-1);
+            goto done;
         }
-
-        xmlListPopFront(list);
     }
 
-    /* done */
-    xmlListDelete(list);
-    return(0);
+    /* success */
+    res = 0;
+
+done:
+    for(ii = 0; ii < itemsSize; ++ii) {
+        if(items[ii].id != NULL) {
+            xmlFree(items[ii].id);
+        }
+    }
+    if(items != NULL) {
+        xmlFree(items);
+    }
+    return(res);
 }
 
 static int
@@ -0,0 +1,405 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The locked memory arena for the key material.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/**
+ * SECTION:secmem
+ * @Short_description: The secure memory arena functions.
+ * @Stability: Stable
+ *
+ * The key material buffers (see #xmlSecBufferZeroModeSecure) are allocated
+ * from one memory region that is locked in memory (it is never written to
+ * the swap) and excluded from the core dumps. The region is mapped and
+ * locked once, on the first allocation, so the keys don't pay for a system
+ * call each. The region is split into pages and each page is split into
+ * the blocks of one size class (16, 32, ... #XMLSEC_SECURE_MEM_MAX_ALLOC_SIZE
+ * bytes); the freed blocks are zeroed and reused for the same size class.
+ *
+ * The larger allocations and the allocations that don't fit into the arena
+ * are made from the regular heap (the memory is still zeroed on free). The
+ * arena is not available on Windows.
+ */
+
+/* MAP_ANONYMOUS and madvise() with -std=c99 */
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif /* defined(__linux__) && !defined(_DEFAULT_SOURCE) */
+
+#include "globals.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/mman.h>
+#endif /* !defined(_WIN32) */
+
+#include <libxml/tree.h>
+#include <libxml/threads.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/secmem.h>
+#include <xmlsec/errors.h>
+
+/* the smallest block (fits the free list link on all platforms) */
+#define XMLSEC_SECURE_MEM_MIN_BLOCK_SIZE                16
+/* 16, 32, 64, ... 4096 */
+#define XMLSEC_SECURE_MEM_CLASSES_SIZE                  9
+/* each page holds the blocks of one size class */
+#define XMLSEC_SECURE_MEM_PAGE_SIZE                     XMLSEC_SECURE_MEM_MAX_ALLOC_SIZE
+/* the page size class is not set yet */
+#define XMLSEC_SECURE_MEM_PAGE_FREE                     0xFF
+
+typedef struct _xmlSecSecureMemBlock                    xmlSecSecureMemBlock, *xmlSecSecureMemBlockPtr;
+struct _xmlSecSecureMemBlock {
+    xmlSecSecureMemBlockPtr     next;
+};
+
+static xmlMutexPtr              gXmlSecSecureMemMutex = NULL;
+static xmlSecSize               gXmlSecSecureMemArenaSize = XMLSEC_SECURE_MEM_DEFAULT_ARENA_SIZE;
+static int                      gXmlSecSecureMemArenaFailed = 0;
+
+/* the arena is created once and never moves, the owned pointers are checked without the mutex */
+static xmlSecByte*              gXmlSecSecureMemData = NULL;
+static xmlSecSize               gXmlSecSecureMemSize = 0;
+static int                      gXmlSecSecureMemLocked = 0;
+
+/* protected by the mutex */
+static xmlSecByte*              gXmlSecSecureMemPageClasses = NULL;
+static xmlSecSize               gXmlSecSecureMemPagesUsed = 0;
+static xmlSecSecureMemBlockPtr  gXmlSecSecureMemFreeLists[XMLSEC_SECURE_MEM_CLASSES_SIZE];
+static xmlSecSize               gXmlSecSecureMemUsed = 0;
+static xmlSecSize               gXmlSecSecureMemPeak = 0;
+static xmlSecSize               gXmlSecSecureMemFallbacks = 0;
+
+static int                      xmlSecSecureMemArenaCreate      (void);
+static void                     xmlSecSecureMemArenaDestroy     (void);
+
+/**
+ * xmlSecSecureMemInit:
+ *
+ * Initializes the secure memory arena (the memory itself is allocated
+ * on the first use). It is called from #xmlSecInit function and
+ * applications must not call this function directly.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecSecureMemInit(void) {
+    /* the mutex is kept by #xmlSecSecureMemShutdown if the arena is still in use */
+    if(gXmlSecSecureMemMutex != NULL) {
+        return(0);
+    }
+
+    gXmlSecSecureMemMutex = xmlNewMutex();
+    if(gXmlSecSecureMemMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecSecureMemShutdown:
+ *
+ * Releases the secure memory arena. The arena is kept if some blocks are
+ * still allocated (e.g. the keys manager is destroyed after the library
+ * shutdown). It is called from #xmlSecShutdown function and applications
+ * must not call this function directly.
+ */
+void
+xmlSecSecureMemShutdown(void) {
+    if(gXmlSecSecureMemMutex == NULL) {
+        return;
+    }
+
+    xmlMutexLock(gXmlSecSecureMemMutex);
+    if(gXmlSecSecureMemUsed > 0) {
+        xmlMutexUnlock(gXmlSecSecureMemMutex);
+        return;
+    }
+    xmlSecSecureMemArenaDestroy();
+    gXmlSecSecureMemArenaFailed = 0;
+    gXmlSecSecureMemPeak = 0;
+    gXmlSecSecureMemFallbacks = 0;
+    xmlMutexUnlock(gXmlSecSecureMemMutex);
+
+    xmlFreeMutex(gXmlSecSecureMemMutex);
+    gXmlSecSecureMemMutex = NULL;
+}
+
+/**
+ * xmlSecSecureMemSetArenaSize:
+ * @size:               the arena size in bytes (0 disables the arena).
+ *
+ * Sets the size of the secure memory arena (#XMLSEC_SECURE_MEM_DEFAULT_ARENA_SIZE
+ * by default). The arena is locked in memory, its size should not exceed
+ * the RLIMIT_MEMLOCK limit. The function must be called before the first
+ * key is loaded or created.
+ *
+ * Returns: 0 on success or a negative value if the arena is already created.
+ */
+int
+xmlSecSecureMemSetArenaSize(xmlSecSize size) {
+    int res = -1;
+
+    xmlSecAssert2(gXmlSecSecureMemMutex != NULL, -1);
+
+    xmlMutexLock(gXmlSecSecureMemMutex);
+    if(gXmlSecSecureMemData == NULL) {
+        gXmlSecSecureMemArenaSize = size;
+        gXmlSecSecureMemArenaFailed = 0;
+        res = 0;
+    }
+    xmlMutexUnlock(gXmlSecSecureMemMutex);
+
+    if(res < 0) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_OPERATION, NULL,
+            "the secure memory arena is already created");
+    }
+    return(res);
+}
+
+/**
+ * xmlSecSecureMemGetInfo:
+ * @info:               the pointer to the returned arena usage.
+ *
+ * Gets the secure memory arena usage.
+ */
+void
+xmlSecSecureMemGetInfo(xmlSecSecureMemInfoPtr info) {
+    xmlSecAssert(info != NULL);
+
+    memset(info, 0, sizeof(xmlSecSecureMemInfo));
+    if(gXmlSecSecureMemMutex == NULL) {
+        return;
+    }
+
+    xmlMutexLock(gXmlSecSecureMemMutex);
+    info->arenaSize = gXmlSecSecureMemSize;
+    info->used = gXmlSecSecureMemUsed;
+    info->peak = gXmlSecSecureMemPeak;
+    info->fallbacks = gXmlSecSecureMemFallbacks;
+    info->locked = gXmlSecSecureMemLocked;
+    xmlMutexUnlock(gXmlSecSecureMemMutex);
+}
+
+/* must be called under the mutex */
+static int
+xmlSecSecureMemArenaCreate(void) {
+#if !defined(_WIN32)
+    xmlSecSize size, pagesNum;
+    void* data;
+
+    xmlSecAssert2(gXmlSecSecureMemData == NULL, -1);
+
+    pagesNum = gXmlSecSecureMemArenaSize / XMLSEC_SECURE_MEM_PAGE_SIZE;
+    if(pagesNum <= 0) {
+        return(-1);
+    }
+    size = pagesNum * XMLSEC_SECURE_MEM_PAGE_SIZE;
+
+    gXmlSecSecureMemPageClasses = (xmlSecByte*)xmlMalloc(pagesNum);
+    if(gXmlSecSecureMemPageClasses == NULL) {
+        xmlSecMallocError(pagesNum, NULL);
+        return(-1);
+    }
+    memset(gXmlSecSecureMemPageClasses, XMLSEC_SECURE_MEM_PAGE_FREE, pagesNum);
+
+    data = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(data == MAP_FAILED) {
+        xmlSecIOError("mmap", NULL, NULL);
+        xmlFree(gXmlSecSecureMemPageClasses);
+        gXmlSecSecureMemPageClasses = NULL;
+        return(-1);
+    }
+#if defined(MADV_DONTDUMP)
+    (void)madvise(data, (size_t)size, MADV_DONTDUMP);
+#endif /* defined(MADV_DONTDUMP) */
+
+    /* the arena is still used if it can't be locked (the blocks are zeroed on free anyway) */
+    gXmlSecSecureMemLocked = (mlock(data, (size_t)size) == 0) ? 1 : 0;
+
+    gXmlSecSecureMemData = (xmlSecByte*)data;
+    gXmlSecSecureMemSize = size;
+    gXmlSecSecureMemPagesUsed = 0;
+    memset(gXmlSecSecureMemFreeLists, 0, sizeof(gXmlSecSecureMemFreeLists));
+    return(0);
+#else  /* !defined(_WIN32) */
+    return(-1);
+#endif /* !defined(_WIN32) */
+}
+
+/* must be called under the mutex */
+static void
+xmlSecSecureMemArenaDestroy(void) {
+#if !defined(_WIN32)
+    if(gXmlSecSecureMemData != NULL) {
+        if(gXmlSecSecureMemLocked != 0) {
+            munlock(gXmlSecSecureMemData, (size_t)gXmlSecSecureMemSize);
+        }
+        munmap(gXmlSecSecureMemData, (size_t)gXmlSecSecureMemSize);
+    }
+#endif /* !defined(_WIN32) */
+    if(gXmlSecSecureMemPageClasses != NULL) {
+        xmlFree(gXmlSecSecureMemPageClasses);
+    }
+    gXmlSecSecureMemData = NULL;
+    gXmlSecSecureMemSize = 0;
+    gXmlSecSecureMemLocked = 0;
+    gXmlSecSecureMemPageClasses = NULL;
+    gXmlSecSecureMemPagesUsed = 0;
+    memset(gXmlSecSecureMemFreeLists, 0, sizeof(gXmlSecSecureMemFreeLists));
+}
+
+/* must be called under the mutex: splits a new page into the blocks of the size class */
+static int
+xmlSecSecureMemAddPage(xmlSecSize sizeClass) {
+    xmlSecByte* page;
+    xmlSecSize blockSize, ii;
+    xmlSecSecureMemBlockPtr block;
+
+    if((gXmlSecSecureMemPagesUsed + 1) * XMLSEC_SECURE_MEM_PAGE_SIZE > gXmlSecSecureMemSize) {
+        return(-1);
+    }
+    page = gXmlSecSecureMemData + gXmlSecSecureMemPagesUsed * XMLSEC_SECURE_MEM_PAGE_SIZE;
+    gXmlSecSecureMemPageClasses[gXmlSecSecureMemPagesUsed] = (xmlSecByte)sizeClass;
+    ++gXmlSecSecureMemPagesUsed;
+
+    /* push the blocks in the reverse order so the first block is returned first */
+    blockSize = ((xmlSecSize)XMLSEC_SECURE_MEM_MIN_BLOCK_SIZE) << sizeClass;
+    for(ii = XMLSEC_SECURE_MEM_PAGE_SIZE / blockSize; ii > 0; --ii) {
+        block = (xmlSecSecureMemBlockPtr)(void*)(page + (ii - 1) * blockSize);
+        block->next = gXmlSecSecureMemFreeLists[sizeClass];
+        gXmlSecSecureMemFreeLists[sizeClass] = block;
+    }
+    return(0);
+}
+
+/**
+ * xmlSecSecureMemAlloc:
+ * @size:               the requested size.
+ * @allocSize:          the pointer to the returned allocated size (the size
+ *                      class, not smaller than @size).
+ *
+ * Allocates zeroed @size bytes from the secure memory arena (used by the
+ * xmlsec library for the key material buffers).
+ *
+ * Returns: the allocated memory or NULL if the arena is not available, full
+ * or @size is larger than #XMLSEC_SECURE_MEM_MAX_ALLOC_SIZE (the caller is
+ * expected to fall back to the regular heap).
+ */
+void*
+xmlSecSecureMemAlloc(xmlSecSize size, xmlSecSize* allocSize) {
+    xmlSecSecureMemBlockPtr block = NULL;
+    xmlSecSize sizeClass, blockSize;
+
+    xmlSecAssert2(size > 0, NULL);
+    xmlSecAssert2(allocSize != NULL, NULL);
+
+    (*allocSize) = 0;
+    if(gXmlSecSecureMemMutex == NULL) {
+        return(NULL);
+    }
+
+    for(sizeClass = 0, blockSize = XMLSEC_SECURE_MEM_MIN_BLOCK_SIZE; blockSize < size; ++sizeClass) {
+        blockSize <<= 1;
+    }
+
+    xmlMutexLock(gXmlSecSecureMemMutex);
+    if(sizeClass >= XMLSEC_SECURE_MEM_CLASSES_SIZE) {
+        goto done;
+    }
+    if((gXmlSecSecureMemData == NULL) && (gXmlSecSecureMemArenaFailed == 0)) {
+        if(xmlSecSecureMemArenaCreate() < 0) {
+            /* don't try again on every key */
+            gXmlSecSecureMemArenaFailed = 1;
+        }
+    }
+    if(gXmlSecSecureMemData == NULL) {
+        goto done;
+    }
+    if((gXmlSecSecureMemFreeLists[sizeClass] == NULL) && (xmlSecSecureMemAddPage(sizeClass) < 0)) {
+        goto done;
+    }
+
+    block = gXmlSecSecureMemFreeLists[sizeClass];
+    gXmlSecSecureMemFreeLists[sizeClass] = block->next;
+    gXmlSecSecureMemUsed += blockSize;
+    if(gXmlSecSecureMemPeak < gXmlSecSecureMemUsed) {
+        gXmlSecSecureMemPeak = gXmlSecSecureMemUsed;
+    }
+
+done:
+    if(block == NULL) {
+        ++gXmlSecSecureMemFallbacks;
+    }
+    xmlMutexUnlock(gXmlSecSecureMemMutex);
+
+    if(block == NULL) {
+        return(NULL);
+    }
+    /* the rest of the free block is already zeroed */
+    block->next = NULL;
+    (*allocSize) = blockSize;
+    return(block);
+}
+
+/**
+ * xmlSecSecureMemIsOwned:
+ * @ptr:                the pointer.
+ *
+ * Checks if @ptr was allocated with #xmlSecSecureMemAlloc.
+ *
+ * Returns: 1 if @ptr is in the secure memory arena or 0 otherwise.
+ */
+int
+xmlSecSecureMemIsOwned(const void* ptr) {
+    const xmlSecByte* p = (const xmlSecByte*)ptr;
+
+    if((p == NULL) || (gXmlSecSecureMemData == NULL)) {
+        return(0);
+    }
+    return(((p >= gXmlSecSecureMemData) && (p < gXmlSecSecureMemData + gXmlSecSecureMemSize)) ? 1 : 0);
+}
+
+/**
+ * xmlSecSecureMemFree:
+ * @ptr:                the memory allocated with #xmlSecSecureMemAlloc.
+ *
+ * Zeroes and returns the block to the secure memory arena.
+ */
+void
+xmlSecSecureMemFree(void* ptr) {
+    xmlSecSecureMemBlockPtr block;
+    xmlSecSize page, sizeClass, blockSize;
+
+    xmlSecAssert(xmlSecSecureMemIsOwned(ptr) == 1);
+    xmlSecAssert(gXmlSecSecureMemMutex != NULL);
+
+    page = (xmlSecSize)((xmlSecByte*)ptr - gXmlSecSecureMemData) / XMLSEC_SECURE_MEM_PAGE_SIZE;
+
+    xmlMutexLock(gXmlSecSecureMemMutex);
+    sizeClass = gXmlSecSecureMemPageClasses[page];
+    if(sizeClass >= XMLSEC_SECURE_MEM_CLASSES_SIZE) {
+        xmlMutexUnlock(gXmlSecSecureMemMutex);
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_DATA, NULL,
+            "the block is not allocated");
+        return;
+    }
+    blockSize = ((xmlSecSize)XMLSEC_SECURE_MEM_MIN_BLOCK_SIZE) << sizeClass;
+
+    block = (xmlSecSecureMemBlockPtr)ptr;
+    memset(block, 0, blockSize);
+    block->next = gXmlSecSecureMemFreeLists[sizeClass];
+    gXmlSecSecureMemFreeLists[sizeClass] = block;
+    gXmlSecSecureMemUsed -= blockSize;
+    xmlMutexUnlock(gXmlSecSecureMemMutex);
+}
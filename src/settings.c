@@ -0,0 +1,109 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Per-thread tuning settings.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/**
+ * SECTION:settings
+ * @Short_description: Per-thread tuning settings functions.
+ * @Stability: Stable
+ *
+ * The buffers and lists allocation modes, the transforms binary chunk
+ * size, the base64 line size and the linefeed defaults are process wide
+ * and can only be changed during initialization. The #xmlSecSettings
+ * object attached to the current thread overrides them, so the
+ * applications serving several tenants with different profiles can
+ * tune each tenant separately.
+ */
+#include "globals.h"
+
+#include <string.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/settings.h>
+#include <xmlsec/errors.h>
+
+/* the settings object attached to the current thread */
+#ifdef XMLSEC_THREAD_LOCAL
+static XMLSEC_THREAD_LOCAL xmlSecSettingsPtr gCurrentSettings = NULL;
+#endif /* XMLSEC_THREAD_LOCAL */
+
+/**
+ * xmlSecSettingsInitialize:
+ * @settings:           the pointer to settings object.
+ *
+ * Initializes @settings with no values set (i.e. all the values are
+ * taken from the global defaults).
+ */
+void
+xmlSecSettingsInitialize(xmlSecSettingsPtr settings) {
+    xmlSecAssert(settings != NULL);
+
+    memset(settings, 0, sizeof(xmlSecSettings));
+}
+
+/**
+ * xmlSecSettingsAttach:
+ * @settings:           the pointer to settings object or NULL.
+ *
+ * Attaches @settings to the current thread: the values set in @settings
+ * are used instead of the global defaults on this thread until
+ * #xmlSecSettingsDetach is called. If the compiler does not support
+ * thread local variables then the global defaults are always used.
+ * If @settings is NULL then the currently attached settings object
+ * (if any) is kept.
+ *
+ * Returns: the previously attached settings object that should be passed
+ * to #xmlSecSettingsDetach.
+ */
+xmlSecSettingsPtr
+xmlSecSettingsAttach(xmlSecSettingsPtr settings) {
+#ifdef XMLSEC_THREAD_LOCAL
+    xmlSecSettingsPtr prev = gCurrentSettings;
+
+    if(settings != NULL) {
+        gCurrentSettings = settings;
+    }
+    return(prev);
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(settings);
+    return(NULL);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecSettingsDetach:
+ * @prev:               the settings object returned by #xmlSecSettingsAttach.
+ *
+ * Detaches the current settings object from the current thread and
+ * restores @prev.
+ */
+void
+xmlSecSettingsDetach(xmlSecSettingsPtr prev) {
+#ifdef XMLSEC_THREAD_LOCAL
+    gCurrentSettings = prev;
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(prev);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecSettingsGetCurrent:
+ *
+ * Gets the settings object attached to the current thread.
+ *
+ * Returns: the current settings object or NULL.
+ */
+xmlSecSettingsPtr
+xmlSecSettingsGetCurrent(void) {
+#ifdef XMLSEC_THREAD_LOCAL
+    return(gCurrentSettings);
+#else  /* XMLSEC_THREAD_LOCAL */
+    return(NULL);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
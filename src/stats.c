@@ -0,0 +1,736 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Library-wide operations, phases, caches and transforms statistics.
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+/**
+ * SECTION:stats
+ * @Short_description: Library-wide statistics and tracing functions.
+ * @Stability: Stable
+ *
+ * When enabled with #xmlSecStatsEnable, the library counts the started,
+ * succeeded and failed operations, the phases durations, the caches hits
+ * and misses and the bytes processed by each transform klass. The counters
+ * are updated without locking in the per-thread blocks and aggregated by
+ * #xmlSecStatsGet (the values for the threads that are currently running
+ * the operations are approximate). The counters are never reset: the
+ * applications should report the differences between two #xmlSecStatsGet
+ * calls if needed. The per-thread blocks are freed by #xmlSecShutdown only.
+ *
+ * The optional tracing callback (see #xmlSecStatsSetTraceCallback) is
+ * called when the operations and phases spans start and end.
+ *
+ * The startup steps durations (the library and crypto initialization,
+ * the keys manager setup and the deferred crypto initialization) are
+ * always recorded so the applications can see where the cold start time
+ * goes without enabling the statistics beforehand.
+ */
+
+/* clock_gettime() for the spans */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif /* !defined(_WIN32) && !defined(_POSIX_C_SOURCE) */
+
+#include "globals.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(XMLSEC_WINDOWS)
+#include <windows.h>
+#endif /* defined(XMLSEC_WINDOWS) */
+
+#include <libxml/threads.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/stats.h>
+#include <xmlsec/errors.h>
+
+#include "stats_helpers.h"
+
+typedef struct _xmlSecStatsThread               xmlSecStatsThread, *xmlSecStatsThreadPtr;
+struct _xmlSecStatsThread {
+    xmlSecStatsThreadPtr                next;
+    xmlSecStatsOpCounters               ops[XMLSEC_STATS_OPS_SIZE];
+    xmlSecStatsPhaseCounters            phases[XMLSEC_STATS_PHASES_SIZE];
+    xmlSecStatsCacheCounters            caches[XMLSEC_STATS_CACHES_SIZE];
+    /* hash table with the transform klass as the key */
+    xmlSecStatsTransformCounters        transforms[XMLSEC_STATS_TRANSFORMS_SIZE];
+};
+
+static const char* const gXmlSecStatsOpNames[XMLSEC_STATS_OPS_SIZE] = {
+    "dsig-sign",
+    "dsig-verify",
+    "enc-encrypt",
+    "enc-decrypt"
+};
+
+static const char* const gXmlSecStatsPhaseNames[XMLSEC_STATS_PHASES_SIZE] = {
+    "key-resolution",
+    "references",
+    "c14n",
+    "signature"
+};
+
+static const char* const gXmlSecStatsCacheNames[XMLSEC_STATS_CACHES_SIZE] = {
+    "xpath",
+    "xslt",
+    "keyinfo",
+    "key-not-found",
+    "encrypted-key",
+    "session-key",
+    "retrieval-method",
+    "reference-digest",
+    "kdf",
+    "crypto-algorithm",
+    "crypto-key-value",
+    "crypto-key-ctx",
+    "hmac",
+    "x509-cert",
+    "x509-write",
+    "x509-verify",
+    "signature",
+    "remote-key",
+    "x509-crl",
+    "key-agreement",
+    "x509-name",
+    "dtd",
+    "cert-pubkey"
+};
+
+static const char* const gXmlSecStatsStartupNames[XMLSEC_STATS_STARTUP_SIZE] = {
+    "init",
+    "crypto-app-init",
+    "crypto-init",
+    "keys-mngr-init",
+    "deferred-init"
+};
+
+static xmlMutexPtr                      gXmlSecStatsMutex = NULL;
+static xmlSecStatsThreadPtr             gXmlSecStatsThreads = NULL;
+static xmlSecSize                       gXmlSecStatsGeneration = 0;
+static int                              gXmlSecStatsEnabled = 0;
+static xmlSecStatsTraceCallback         gXmlSecStatsTraceCallback = NULL;
+static void*                            gXmlSecStatsTraceUserData = NULL;
+static xmlSecStatsPhaseCounters         gXmlSecStatsStartup[XMLSEC_STATS_STARTUP_SIZE];
+
+/* the counters block for the current thread (valid for the current library initialization only) */
+#ifdef XMLSEC_THREAD_LOCAL
+static XMLSEC_THREAD_LOCAL xmlSecStatsThreadPtr gXmlSecStatsCurrent = NULL;
+static XMLSEC_THREAD_LOCAL xmlSecSize           gXmlSecStatsCurrentGeneration = 0;
+#endif /* XMLSEC_THREAD_LOCAL */
+
+static xmlSecStatsThreadPtr
+xmlSecStatsGetThread(void) {
+#ifdef XMLSEC_THREAD_LOCAL
+    xmlSecStatsThreadPtr thread;
+
+    if((gXmlSecStatsCurrent != NULL) && (gXmlSecStatsCurrentGeneration == gXmlSecStatsGeneration)) {
+        return(gXmlSecStatsCurrent);
+    }
+    if(gXmlSecStatsMutex == NULL) {
+        return(NULL);
+    }
+
+    thread = (xmlSecStatsThreadPtr)xmlMalloc(sizeof(xmlSecStatsThread));
+    if(thread == NULL) {
+        xmlSecMallocError(sizeof(xmlSecStatsThread), NULL);
+        return(NULL);
+    }
+    memset(thread, 0, sizeof(xmlSecStatsThread));
+
+    xmlMutexLock(gXmlSecStatsMutex);
+    thread->next = gXmlSecStatsThreads;
+    gXmlSecStatsThreads = thread;
+    xmlMutexUnlock(gXmlSecStatsMutex);
+
+    gXmlSecStatsCurrent = thread;
+    gXmlSecStatsCurrentGeneration = gXmlSecStatsGeneration;
+    return(thread);
+#else  /* XMLSEC_THREAD_LOCAL */
+    return(NULL);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+static double
+xmlSecStatsGetTime(void) {
+#if defined(XMLSEC_WINDOWS)
+    LARGE_INTEGER counter, freq;
+
+    if(!QueryPerformanceFrequency(&freq) || !QueryPerformanceCounter(&counter) || (freq.QuadPart <= 0)) {
+        return((double)time(NULL));
+    }
+    return((double)counter.QuadPart / (double)freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return((double)time(NULL));
+    }
+    return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+#else  /* defined(XMLSEC_WINDOWS) */
+    return((double)time(NULL));
+#endif /* defined(XMLSEC_WINDOWS) */
+}
+
+/**
+ * xmlSecStatsInit:
+ *
+ * Initializes the statistics. It is called from #xmlSecInit function
+ * and applications must not call this function directly.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecStatsInit(void) {
+    xmlSecAssert2(gXmlSecStatsMutex == NULL, -1);
+
+    gXmlSecStatsMutex = xmlNewMutex();
+    if(gXmlSecStatsMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        return(-1);
+    }
+    ++gXmlSecStatsGeneration;
+    return(0);
+}
+
+/**
+ * xmlSecStatsShutdown:
+ *
+ * Frees the statistics counters. It is called from #xmlSecShutdown function
+ * and applications must not call this function directly.
+ */
+void
+xmlSecStatsShutdown(void) {
+    xmlSecStatsThreadPtr thread;
+
+    while(gXmlSecStatsThreads != NULL) {
+        thread = gXmlSecStatsThreads;
+        gXmlSecStatsThreads = thread->next;
+        xmlFree(thread);
+    }
+    if(gXmlSecStatsMutex != NULL) {
+        xmlFreeMutex(gXmlSecStatsMutex);
+        gXmlSecStatsMutex = NULL;
+    }
+    memset(gXmlSecStatsStartup, 0, sizeof(gXmlSecStatsStartup));
+}
+
+/**
+ * xmlSecStatsEnable:
+ * @enabled:            the flag.
+ *
+ * Enables or disables the statistics counters. This function is not
+ * thread safe and should be called during the application initialization.
+ *
+ * Returns: 0 on success or a negative value if the compiler does not
+ * support thread local variables.
+ */
+int
+xmlSecStatsEnable(int enabled) {
+#ifdef XMLSEC_THREAD_LOCAL
+    gXmlSecStatsEnabled = enabled;
+    return(0);
+#else  /* XMLSEC_THREAD_LOCAL */
+    return((enabled != 0) ? -1 : 0);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecStatsIsEnabled:
+ *
+ * Checks if the statistics counters are enabled.
+ *
+ * Returns: 1 if the statistics counters are enabled or 0 otherwise.
+ */
+int
+xmlSecStatsIsEnabled(void) {
+    return((gXmlSecStatsEnabled != 0) ? 1 : 0);
+}
+
+/**
+ * xmlSecStatsSetTraceCallback:
+ * @callback:           the tracing callback or NULL.
+ * @userData:           the user data for @callback.
+ *
+ * Sets the tracing callback that is called when the operations and phases
+ * spans start and end. This function is not thread safe and should be
+ * called during the application initialization.
+ */
+void
+xmlSecStatsSetTraceCallback(xmlSecStatsTraceCallback callback, void* userData) {
+    gXmlSecStatsTraceCallback = callback;
+    gXmlSecStatsTraceUserData = userData;
+}
+
+/**
+ * xmlSecStatsGet:
+ * @stats:              the pointer to the result.
+ *
+ * Sums up the counters from all the threads.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecStatsGet(xmlSecStatsPtr stats) {
+    xmlSecStatsThreadPtr thread;
+    xmlSecSize ii, jj;
+
+    xmlSecAssert2(stats != NULL, -1);
+
+    memset(stats, 0, sizeof(xmlSecStats));
+    if(gXmlSecStatsMutex == NULL) {
+        memcpy(stats->startup, gXmlSecStatsStartup, sizeof(gXmlSecStatsStartup));
+        return(0);
+    }
+
+    xmlMutexLock(gXmlSecStatsMutex);
+    memcpy(stats->startup, gXmlSecStatsStartup, sizeof(gXmlSecStatsStartup));
+    for(thread = gXmlSecStatsThreads; thread != NULL; thread = thread->next) {
+        for(ii = 0; ii < XMLSEC_STATS_OPS_SIZE; ++ii) {
+            stats->ops[ii].started   += thread->ops[ii].started;
+            stats->ops[ii].succeeded += thread->ops[ii].succeeded;
+            stats->ops[ii].failed    += thread->ops[ii].failed;
+        }
+        for(ii = 0; ii < XMLSEC_STATS_PHASES_SIZE; ++ii) {
+            stats->phases[ii].count += thread->phases[ii].count;
+            stats->phases[ii].time  += thread->phases[ii].time;
+        }
+        for(ii = 0; ii < XMLSEC_STATS_CACHES_SIZE; ++ii) {
+            stats->caches[ii].hits   += thread->caches[ii].hits;
+            stats->caches[ii].misses += thread->caches[ii].misses;
+        }
+        for(ii = 0; ii < XMLSEC_STATS_TRANSFORMS_SIZE; ++ii) {
+            if(thread->transforms[ii].id == NULL) {
+                continue;
+            }
+            for(jj = 0; jj < stats->transformsSize; ++jj) {
+                if(stats->transforms[jj].id == thread->transforms[ii].id) {
+                    break;
+                }
+            }
+            if(jj >= XMLSEC_STATS_TRANSFORMS_SIZE) {
+                continue;
+            } else if(jj >= stats->transformsSize) {
+                stats->transforms[jj].id = thread->transforms[ii].id;
+                ++stats->transformsSize;
+            }
+            stats->transforms[jj].bytesIn  += thread->transforms[ii].bytesIn;
+            stats->transforms[jj].bytesOut += thread->transforms[ii].bytesOut;
+        }
+    }
+    xmlMutexUnlock(gXmlSecStatsMutex);
+    return(0);
+}
+
+/**
+ * xmlSecStatsDebugDump:
+ * @stats:              the pointer to the statistics.
+ * @output:             the pointer to output FILE.
+ *
+ * Prints the statistics to @output.
+ */
+void
+xmlSecStatsDebugDump(xmlSecStatsPtr stats, FILE* output) {
+    xmlSecSize ii;
+
+    xmlSecAssert(stats != NULL);
+    xmlSecAssert(output != NULL);
+
+    fprintf(output, "== Operations:\n");
+    for(ii = 0; ii < XMLSEC_STATS_OPS_SIZE; ++ii) {
+        fprintf(output, "=== %s: started=" XMLSEC_SIZE_FMT " succeeded=" XMLSEC_SIZE_FMT " failed=" XMLSEC_SIZE_FMT "\n",
+            gXmlSecStatsOpNames[ii], stats->ops[ii].started, stats->ops[ii].succeeded, stats->ops[ii].failed);
+    }
+    fprintf(output, "== Phases:\n");
+    for(ii = 0; ii < XMLSEC_STATS_PHASES_SIZE; ++ii) {
+        fprintf(output, "=== %s: count=" XMLSEC_SIZE_FMT " time=%.6fs\n",
+            gXmlSecStatsPhaseNames[ii], stats->phases[ii].count, stats->phases[ii].time);
+    }
+    fprintf(output, "== Caches:\n");
+    for(ii = 0; ii < XMLSEC_STATS_CACHES_SIZE; ++ii) {
+        fprintf(output, "=== %s: hits=" XMLSEC_SIZE_FMT " misses=" XMLSEC_SIZE_FMT "\n",
+            gXmlSecStatsCacheNames[ii], stats->caches[ii].hits, stats->caches[ii].misses);
+    }
+    fprintf(output, "== Transforms:\n");
+    for(ii = 0; (ii < stats->transformsSize) && (ii < XMLSEC_STATS_TRANSFORMS_SIZE); ++ii) {
+        fprintf(output, "=== %s: bytesIn=" XMLSEC_SIZE_FMT " bytesOut=" XMLSEC_SIZE_FMT "\n",
+            xmlSecErrorsSafeString(xmlSecTransformKlassGetName(stats->transforms[ii].id)),
+            stats->transforms[ii].bytesIn, stats->transforms[ii].bytesOut);
+    }
+    fprintf(output, "== Startup:\n");
+    for(ii = 0; ii < XMLSEC_STATS_STARTUP_SIZE; ++ii) {
+        fprintf(output, "=== %s: count=" XMLSEC_SIZE_FMT " time=%.6fs\n",
+            gXmlSecStatsStartupNames[ii], stats->startup[ii].count, stats->startup[ii].time);
+    }
+}
+
+/**
+ * xmlSecStatsOpGetName:
+ * @op:                 the operation type.
+ *
+ * Gets the name of @op.
+ *
+ * Returns: the name of @op.
+ */
+const char*
+xmlSecStatsOpGetName(xmlSecStatsOp op) {
+    if((xmlSecSize)op >= XMLSEC_STATS_OPS_SIZE) {
+        return("unknown");
+    }
+    return(gXmlSecStatsOpNames[op]);
+}
+
+/**
+ * xmlSecStatsPhaseGetName:
+ * @phase:              the phase.
+ *
+ * Gets the name of @phase.
+ *
+ * Returns: the name of @phase.
+ */
+const char*
+xmlSecStatsPhaseGetName(xmlSecStatsPhase phase) {
+    if((xmlSecSize)phase >= XMLSEC_STATS_PHASES_SIZE) {
+        return("unknown");
+    }
+    return(gXmlSecStatsPhaseNames[phase]);
+}
+
+/**
+ * xmlSecStatsCacheGetName:
+ * @cache:              the cache.
+ *
+ * Gets the name of @cache.
+ *
+ * Returns: the name of @cache.
+ */
+const char*
+xmlSecStatsCacheGetName(xmlSecStatsCache cache) {
+    if((xmlSecSize)cache >= XMLSEC_STATS_CACHES_SIZE) {
+        return("unknown");
+    }
+    return(gXmlSecStatsCacheNames[cache]);
+}
+
+/**
+ * xmlSecStatsStartupGetName:
+ * @step:               the startup step.
+ *
+ * Gets the name of @step.
+ *
+ * Returns: the name of @step.
+ */
+const char*
+xmlSecStatsStartupGetName(xmlSecStatsStartup step) {
+    if((xmlSecSize)step >= XMLSEC_STATS_STARTUP_SIZE) {
+        return("unknown");
+    }
+    return(gXmlSecStatsStartupNames[step]);
+}
+
+static void
+xmlSecStatsSpanStart(xmlSecStatsSpanType type, int id, xmlSecStatsSpanPtr span) {
+    xmlSecAssert(span != NULL);
+
+    span->type     = type;
+    span->id       = id;
+    span->start    = xmlSecStatsGetTime();
+    span->duration = 0;
+    span->failed   = 0;
+    span->active   = 1;
+
+    if(gXmlSecStatsTraceCallback != NULL) {
+        gXmlSecStatsTraceCallback(span, 0, gXmlSecStatsTraceUserData);
+    }
+}
+
+static void
+xmlSecStatsSpanEnd(xmlSecStatsSpanPtr span) {
+    xmlSecAssert(span != NULL);
+
+    span->duration = xmlSecStatsGetTime() - span->start;
+    if(span->duration < 0) {
+        span->duration = 0;
+    }
+}
+
+/**
+ * xmlSecStatsOpStart:
+ * @op:                 the operation type.
+ * @span:               the pointer to the span.
+ *
+ * Records the operation start in @span (used by the xmlsec library).
+ */
+void
+xmlSecStatsOpStart(xmlSecStatsOp op, xmlSecStatsSpanPtr span) {
+    xmlSecStatsThreadPtr thread;
+
+    xmlSecAssert(span != NULL);
+
+    span->active = 0;
+    if((gXmlSecStatsEnabled == 0) && (gXmlSecStatsTraceCallback == NULL)) {
+        return;
+    }
+    xmlSecAssert((xmlSecSize)op < XMLSEC_STATS_OPS_SIZE);
+
+    if(gXmlSecStatsEnabled != 0) {
+        thread = xmlSecStatsGetThread();
+        if(thread != NULL) {
+            ++thread->ops[op].started;
+        }
+    }
+    xmlSecStatsSpanStart(xmlSecStatsSpanTypeOp, (int)op, span);
+}
+
+/**
+ * xmlSecStatsOpEnd:
+ * @span:               the pointer to the span started with #xmlSecStatsOpStart.
+ * @failed:             set if the operation failed.
+ *
+ * Records the operation end (used by the xmlsec library).
+ */
+void
+xmlSecStatsOpEnd(xmlSecStatsSpanPtr span, int failed) {
+    xmlSecStatsThreadPtr thread;
+
+    xmlSecAssert(span != NULL);
+
+    if(span->active == 0) {
+        return;
+    }
+    xmlSecAssert(span->type == xmlSecStatsSpanTypeOp);
+    xmlSecAssert((span->id >= 0) && (span->id < XMLSEC_STATS_OPS_SIZE));
+
+    xmlSecStatsSpanEnd(span);
+    span->failed = failed;
+    if(gXmlSecStatsEnabled != 0) {
+        thread = xmlSecStatsGetThread();
+        if((thread != NULL) && (failed != 0)) {
+            ++thread->ops[span->id].failed;
+        } else if(thread != NULL) {
+            ++thread->ops[span->id].succeeded;
+        }
+    }
+    if(gXmlSecStatsTraceCallback != NULL) {
+        gXmlSecStatsTraceCallback(span, 1, gXmlSecStatsTraceUserData);
+    }
+    span->active = 0;
+}
+
+/**
+ * xmlSecStatsPhaseStart:
+ * @phase:              the phase.
+ * @span:               the pointer to the span.
+ *
+ * Records the phase start in @span (used by the xmlsec library).
+ */
+void
+xmlSecStatsPhaseStart(xmlSecStatsPhase phase, xmlSecStatsSpanPtr span) {
+    xmlSecAssert(span != NULL);
+
+    span->active = 0;
+    if((gXmlSecStatsEnabled == 0) && (gXmlSecStatsTraceCallback == NULL)) {
+        return;
+    }
+    xmlSecAssert((xmlSecSize)phase < XMLSEC_STATS_PHASES_SIZE);
+
+    xmlSecStatsSpanStart(xmlSecStatsSpanTypePhase, (int)phase, span);
+}
+
+/**
+ * xmlSecStatsPhaseEnd:
+ * @span:               the pointer to the span started with #xmlSecStatsPhaseStart.
+ *
+ * Records the phase end (used by the xmlsec library).
+ */
+void
+xmlSecStatsPhaseEnd(xmlSecStatsSpanPtr span) {
+    xmlSecStatsThreadPtr thread;
+
+    xmlSecAssert(span != NULL);
+
+    if(span->active == 0) {
+        return;
+    }
+    xmlSecAssert(span->type == xmlSecStatsSpanTypePhase);
+    xmlSecAssert((span->id >= 0) && (span->id < XMLSEC_STATS_PHASES_SIZE));
+
+    xmlSecStatsSpanEnd(span);
+    if(gXmlSecStatsEnabled != 0) {
+        thread = xmlSecStatsGetThread();
+        if(thread != NULL) {
+            ++thread->phases[span->id].count;
+            thread->phases[span->id].time += span->duration;
+        }
+    }
+    if(gXmlSecStatsTraceCallback != NULL) {
+        gXmlSecStatsTraceCallback(span, 1, gXmlSecStatsTraceUserData);
+    }
+    span->active = 0;
+}
+
+/**
+ * xmlSecStatsStartupStart:
+ * @step:               the startup step.
+ * @span:               the pointer to the span.
+ *
+ * Records the startup step start in @span (used by the xmlsec and crypto
+ * libraries). The startup steps are recorded even if the statistics are
+ * disabled.
+ */
+void
+xmlSecStatsStartupStart(xmlSecStatsStartup step, xmlSecStatsSpanPtr span) {
+    xmlSecAssert(span != NULL);
+
+    span->active = 0;
+    xmlSecAssert((xmlSecSize)step < XMLSEC_STATS_STARTUP_SIZE);
+
+    xmlSecStatsSpanStart(xmlSecStatsSpanTypeStartup, (int)step, span);
+}
+
+/**
+ * xmlSecStatsStartupEnd:
+ * @span:               the pointer to the span started with #xmlSecStatsStartupStart.
+ *
+ * Records the startup step end (used by the xmlsec and crypto libraries).
+ */
+void
+xmlSecStatsStartupEnd(xmlSecStatsSpanPtr span) {
+    xmlMutexPtr mutex;
+
+    xmlSecAssert(span != NULL);
+
+    if(span->active == 0) {
+        return;
+    }
+    xmlSecAssert(span->type == xmlSecStatsSpanTypeStartup);
+    xmlSecAssert((span->id >= 0) && (span->id < XMLSEC_STATS_STARTUP_SIZE));
+
+    xmlSecStatsSpanEnd(span);
+
+    /* the deferred initialization might run on several threads at once */
+    mutex = gXmlSecStatsMutex;
+    if(mutex != NULL) {
+        xmlMutexLock(mutex);
+    }
+    ++gXmlSecStatsStartup[span->id].count;
+    gXmlSecStatsStartup[span->id].time += span->duration;
+    if(mutex != NULL) {
+        xmlMutexUnlock(mutex);
+    }
+
+    if(gXmlSecStatsTraceCallback != NULL) {
+        gXmlSecStatsTraceCallback(span, 1, gXmlSecStatsTraceUserData);
+    }
+    span->active = 0;
+}
+
+/**
+ * xmlSecStatsCacheLookup:
+ * @cache:              the cache.
+ * @found:              set if the value was found in the cache.
+ *
+ * Records the cache lookup result (used by the xmlsec and crypto libraries).
+ */
+void
+xmlSecStatsCacheLookup(xmlSecStatsCache cache, int found) {
+    xmlSecStatsThreadPtr thread;
+
+    if(gXmlSecStatsEnabled == 0) {
+        return;
+    }
+    xmlSecAssert((xmlSecSize)cache < XMLSEC_STATS_CACHES_SIZE);
+
+    thread = xmlSecStatsGetThread();
+    if(thread == NULL) {
+        return;
+    }
+    if(found != 0) {
+        ++thread->caches[cache].hits;
+    } else {
+        ++thread->caches[cache].misses;
+    }
+}
+
+/**
+ * xmlSecStatsTransformBytes:
+ * @id:                 the transform klass.
+ * @bytesIn:            the consumed bytes.
+ * @bytesOut:           the produced bytes.
+ *
+ * Records the bytes processed by the transform (used by the xmlsec library).
+ */
+void
+xmlSecStatsTransformBytes(xmlSecTransformId id, xmlSecSize bytesIn, xmlSecSize bytesOut) {
+    xmlSecStatsThreadPtr thread;
+    xmlSecStatsTransformCounters* counters;
+    xmlSecSize pos, ii;
+
+    if((gXmlSecStatsEnabled == 0) || (id == NULL) || ((bytesIn == 0) && (bytesOut == 0))) {
+        return;
+    }
+
+    thread = xmlSecStatsGetThread();
+    if(thread == NULL) {
+        return;
+    }
+
+    /* the klasses are static objects: use the address as the hash */
+    pos = (xmlSecSize)(((size_t)id / sizeof(void*)) % XMLSEC_STATS_TRANSFORMS_SIZE);
+    for(ii = 0; ii < XMLSEC_STATS_TRANSFORMS_SIZE; ++ii) {
+        counters = &(thread->transforms[(pos + ii) % XMLSEC_STATS_TRANSFORMS_SIZE]);
+        if(counters->id == NULL) {
+            counters->id = id;
+        } else if(counters->id != id) {
+            continue;
+        }
+        counters->bytesIn  += bytesIn;
+        counters->bytesOut += bytesOut;
+        return;
+    }
+    /* the table is full */
+}
+
+/**
+ * xmlSecStatsGetCurrentTime:
+ *
+ * Gets the current time from the spans clock (used by the xmlsec library).
+ *
+ * Returns: the monotonic clock time (in seconds).
+ */
+double
+xmlSecStatsGetCurrentTime(void) {
+    return(xmlSecStatsGetTime());
+}
+
+/**
+ * xmlSecStatsGetThreadCaches:
+ * @caches:             the pointer to XMLSEC_STATS_CACHES_SIZE counters.
+ *
+ * Gets the caches counters of the current thread (used by the xmlsec
+ * library to get the counters delta for one operation). The counters
+ * are all zeros if the statistics are disabled.
+ */
+void
+xmlSecStatsGetThreadCaches(xmlSecStatsCacheCounters* caches) {
+    xmlSecStatsThreadPtr thread;
+
+    xmlSecAssert(caches != NULL);
+
+    memset(caches, 0, XMLSEC_STATS_CACHES_SIZE * sizeof(xmlSecStatsCacheCounters));
+    if(gXmlSecStatsEnabled == 0) {
+        return;
+    }
+    thread = xmlSecStatsGetThread();
+    if(thread == NULL) {
+        return;
+    }
+    memcpy(caches, thread->caches, XMLSEC_STATS_CACHES_SIZE * sizeof(xmlSecStatsCacheCounters));
+}
@@ -0,0 +1,44 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Internal header only used during the compilation,
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_STATS_HELPERS_H__
+#define __XMLSEC_STATS_HELPERS_H__
+
+
+#ifndef XMLSEC_PRIVATE
+#error "stats_helpers.h file contains private xmlsec definitions and should not be used outside xmlsec or xmlsec-$crypto libraries"
+#endif /* XMLSEC_PRIVATE */
+
+#include <xmlsec/stats.h>
+
+/**************************** Current thread ********************************/
+double                  xmlSecStatsGetCurrentTime               (void);
+void                    xmlSecStatsGetThreadCaches              (xmlSecStatsCacheCounters* caches);
+
+/**************************** USDT probes ********************************/
+
+/*
+ * The static probes for SystemTap / DTrace (provider "xmlsec") enabled with
+ * the "--enable-usdt" configure option. The probes are no-ops otherwise.
+ */
+#ifdef XMLSEC_HAVE_USDT
+#include <sys/sdt.h>
+
+#define XMLSEC_PROBE1(name, arg1)                       DTRACE_PROBE1(xmlsec, name, arg1)
+#define XMLSEC_PROBE2(name, arg1, arg2)                 DTRACE_PROBE2(xmlsec, name, arg1, arg2)
+
+#else  /* XMLSEC_HAVE_USDT */
+
+#define XMLSEC_PROBE1(name, arg1)
+#define XMLSEC_PROBE2(name, arg1, arg2)
+
+#endif /* XMLSEC_HAVE_USDT */
+
+#endif /* __XMLSEC_STATS_HELPERS_H__ */
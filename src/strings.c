@@ -19,6 +19,8 @@
 
 #include <xmlsec/xmlsec.h>
 
+#include "parser_helpers.h"
+
 /*************************************************************************
  *
  * Global Namespaces
@@ -32,6 +34,7 @@ const xmlChar xmlSecEnc11Ns[]                   = "http://www.w3.org/2009/xmlenc
 const xmlChar xmlSecXPathNs[]                   = "http://www.w3.org/TR/1999/REC-xpath-19991116";
 const xmlChar xmlSecXPath2Ns[]                  = "http://www.w3.org/2002/06/xmldsig-filter2";
 const xmlChar xmlSecXPointerNs[]                = "http://www.w3.org/2001/04/xmldsig-more/xptr";
+const xmlChar xmlSecXopNs[]                     = "http://www.w3.org/2004/08/xop/include";
 
 /*************************************************************************
  *
@@ -66,6 +69,7 @@ const xmlChar xmlSecNodeDataReference[]         = "DataReference";
 const xmlChar xmlSecNodeKeyReference[]          = "KeyReference";
 
 const xmlChar xmlSecNodeCarriedKeyName[]        = "CarriedKeyName";
+const xmlChar xmlSecNodeXopInclude[]            = "Include";
 
 const xmlChar xmlSecTypeEncContent[]            = "http://www.w3.org/2001/04/xmlenc#Content";
 const xmlChar xmlSecTypeEncElement[]            = "http://www.w3.org/2001/04/xmlenc#Element";
@@ -94,6 +98,7 @@ const xmlChar xmlSecAttrAlgorithm[]             = "Algorithm";
 const xmlChar xmlSecAttrFilter[]                = "Filter";
 const xmlChar xmlSecAttrRecipient[]             = "Recipient";
 const xmlChar xmlSecAttrTarget[]                = "Target";
+const xmlChar xmlSecAttrHref[]                  = "href";
 
 /*************************************************************************
  *
@@ -720,6 +725,14 @@ const xmlChar xmlSecRelationshipAttrTargetMode[]= "TargetMode";
 const xmlChar xmlSecNameXslt[]                  = "xslt";
 const xmlChar xmlSecHrefXslt[]                  = "http://www.w3.org/TR/1999/REC-xslt-19991116";
 
+/*************************************************************************
+ *
+ * Deflate strings
+ *
+ ************************************************************************/
+const xmlChar xmlSecNameDeflate[]               = "deflate";
+const xmlChar xmlSecHrefDeflate[]               = "http://www.aleksey.com/xmlsec/2002#deflate";
+
 /*************************************************************************
  *
  * Utility strings
@@ -727,3 +740,137 @@ const xmlChar xmlSecHrefXslt[]                  = "http://www.w3.org/TR/1999/REC
  ************************************************************************/
 const xmlChar xmlSecStringEmpty[]               = "";
 const xmlChar xmlSecStringCR[]                  = "\n";
+
+/*************************************************************************
+ *
+ * The element, attribute and namespace names (the parser dictionary
+ * is seeded with these strings)
+ *
+ ************************************************************************/
+const xmlChar* const xmlSecStringsDictNames[] = {
+    xmlSecNs,
+    xmlSecDSigNs,
+    xmlSecDSig11Ns,
+    xmlSecEncNs,
+    xmlSecEnc11Ns,
+    xmlSecXPathNs,
+    xmlSecXPath2Ns,
+    xmlSecXPointerNs,
+    xmlSecNodeSignature,
+    xmlSecNodeSignedInfo,
+    xmlSecNodeCanonicalizationMethod,
+    xmlSecNodeSignatureMethod,
+    xmlSecNodeSignatureValue,
+    xmlSecNodeDigestMethod,
+    xmlSecNodeDigestValue,
+    xmlSecNodeObject,
+    xmlSecNodeManifest,
+    xmlSecNodeSignatureProperties,
+    xmlSecNodeEncryptedData,
+    xmlSecNodeEncryptionMethod,
+    xmlSecNodeEncryptionProperties,
+    xmlSecNodeEncryptionProperty,
+    xmlSecNodeCipherData,
+    xmlSecNodeCipherValue,
+    xmlSecNodeCipherReference,
+    xmlSecNodeReferenceList,
+    xmlSecNodeDataReference,
+    xmlSecNodeKeyReference,
+    xmlSecNodeCarriedKeyName,
+    xmlSecNodeKeyInfo,
+    xmlSecNodeReference,
+    xmlSecNodeTransforms,
+    xmlSecNodeTransform,
+    xmlSecAttrId,
+    xmlSecAttrURI,
+    xmlSecAttrType,
+    xmlSecAttrMimeType,
+    xmlSecAttrEncoding,
+    xmlSecAttrAlgorithm,
+    xmlSecAttrFilter,
+    xmlSecAttrRecipient,
+    xmlSecAttrTarget,
+    xmlSecNodeAESKeyValue,
+    xmlSecNsExcC14N,
+    xmlSecNsExcC14NWithComments,
+    xmlSecNodeInclusiveNamespaces,
+    xmlSecAttrPrefixList,
+    xmlSecNodeConcatKDFParams,
+    xmlSecNodeConcatKDFAttrAlgorithmID,
+    xmlSecNodeConcatKDFAttrPartyUInfo,
+    xmlSecNodeConcatKDFAttrPartyVInfo,
+    xmlSecNodeConcatKDFAttrSuppPubInfo,
+    xmlSecNodeConcatKDFAttrSuppPrivInfo,
+    xmlSecNodeDEREncodedKeyValue,
+    xmlSecNodeDESKeyValue,
+    xmlSecNodeGOST2001KeyValue,
+    xmlSecNodeGostR3410_2012_256KeyValue,
+    xmlSecNodeGostR3410_2012_512KeyValue,
+    xmlSecNodeDHKeyValue,
+    xmlSecNodeDHP,
+    xmlSecNodeDHQ,
+    xmlSecNodeDHGenerator,
+    xmlSecNodeDHPublic,
+    xmlSecNodeDHSeed,
+    xmlSecNodeDHPgenCounter,
+    xmlSecNodeDSAKeyValue,
+    xmlSecNodeDSAP,
+    xmlSecNodeDSAQ,
+    xmlSecNodeDSAG,
+    xmlSecNodeDSAJ,
+    xmlSecNodeDSAX,
+    xmlSecNodeDSAY,
+    xmlSecNodeDSASeed,
+    xmlSecNodeDSAPgenCounter,
+    xmlSecNodeECKeyValue,
+    xmlSecNodeNamedCurve,
+    xmlSecNodePublicKey,
+    xmlSecNodeEncryptedKey,
+    xmlSecNodeDerivedKey,
+    xmlSecNodeKeyDerivationMethod,
+    xmlSecNodeDerivedKeyName,
+    xmlSecNodeMasterKeyName,
+    xmlSecNodeAgreementMethod,
+    xmlSecNodeOriginatorKeyInfo,
+    xmlSecNodeRecipientKeyInfo,
+    xmlSecNodeHMACKeyValue,
+    xmlSecNodeHMACOutputLength,
+    xmlSecNodeKeyInfoReference,
+    xmlSecNodeKeyName,
+    xmlSecNodeKeyValue,
+    xmlSecNodePbkdf2Params,
+    xmlSecNodePbkdf2Salt,
+    xmlSecNodePbkdf2SaltSpecified,
+    xmlSecNodePbkdf2IterationCount,
+    xmlSecNodePbkdf2KeyLength,
+    xmlSecNodePbkdf2PRF,
+    xmlSecNodeRetrievalMethod,
+    xmlSecNodeRSAKeyValue,
+    xmlSecNodeRSAModulus,
+    xmlSecNodeRSAExponent,
+    xmlSecNodeRSAPrivateExponent,
+    xmlSecNodeRsaOAEPparams,
+    xmlSecNodeRsaMGF,
+    xmlSecNodeX509Data,
+    xmlSecNodeX509Certificate,
+    xmlSecNodeX509CRL,
+    xmlSecNodeX509SubjectName,
+    xmlSecNodeX509IssuerSerial,
+    xmlSecNodeX509IssuerName,
+    xmlSecNodeX509SerialNumber,
+    xmlSecNodeX509SKI,
+    xmlSecNodeX509Digest,
+    xmlSecNodePGPData,
+    xmlSecNodeSPKIData,
+    xmlSecNodeXPath,
+    xmlSecNodeXPath2,
+    xmlSecNodeXPointer,
+    xmlSecNodeRelationship,
+    xmlSecNodeRelationshipReference,
+    xmlSecRelationshipsNs,
+    xmlSecRelationshipReferenceNs,
+    xmlSecRelationshipAttrId,
+    xmlSecRelationshipAttrSourceId,
+    xmlSecRelationshipAttrTargetMode,
+    NULL
+};
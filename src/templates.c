@@ -247,6 +247,63 @@ xmlSecTmplSignatureAddReference(xmlNodePtr signNode, xmlSecTransformId digestMet
     return(xmlSecTmplAddReference(signedInfoNode, digestMethodId, id, uri, type));
 }
 
+/**
+ * xmlSecTmplSignatureAddReferences:
+ * @signNode:           the pointer to &lt;dsig:Signature/&gt; node.
+ * @digestMethodId:     the references digest method.
+ * @uris:               the array of the reference nodes uris.
+ * @urisSize:           the number of elements in @uris.
+ *
+ * Adds @urisSize &lt;dsig:Reference/&gt; nodes (one for each URI in @uris)
+ * with the required children &lt;dsig:DigestMethod/&gt; and
+ * &lt;dsig:DigestValue/&gt; to the &lt;dsig:SignedInfo/&gt; child of @signNode.
+ * The &lt;dsig:SignedInfo/&gt; node is looked up only once. If an error
+ * occurs then the references added by this call are removed.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecTmplSignatureAddReferences(xmlNodePtr signNode, xmlSecTransformId digestMethodId,
+                    const xmlChar **uris, xmlSecSize urisSize) {
+    xmlNodePtr signedInfoNode;
+    xmlNodePtr lastNode;
+    xmlNodePtr cur;
+    xmlSecSize ii;
+
+    xmlSecAssert2(signNode != NULL, -1);
+    xmlSecAssert2(digestMethodId != NULL, -1);
+    xmlSecAssert2(digestMethodId->href != NULL, -1);
+    xmlSecAssert2((uris != NULL) || (urisSize == 0), -1);
+
+    signedInfoNode = xmlSecFindChild(signNode, xmlSecNodeSignedInfo, xmlSecDSigNs);
+    if(signedInfoNode == NULL) {
+        xmlSecNodeNotFoundError("xmlSecFindChild", signNode,
+                                xmlSecNodeSignedInfo, NULL);
+        return(-1);
+    }
+
+    lastNode = xmlGetLastChild(signedInfoNode);
+    for(ii = 0; ii < urisSize; ++ii) {
+        cur = xmlSecTmplAddReference(signedInfoNode, digestMethodId, NULL, uris[ii], NULL);
+        if(cur == NULL) {
+            xmlSecInternalError2("xmlSecTmplAddReference", NULL,
+                "index=" XMLSEC_SIZE_FMT, ii);
+
+            /* remove the references added so far */
+            cur = (lastNode != NULL) ? lastNode->next : signedInfoNode->children;
+            while(cur != NULL) {
+                xmlNodePtr next = cur->next;
+
+                xmlUnlinkNode(cur);
+                xmlFreeNode(cur);
+                cur = next;
+            }
+            return(-1);
+        }
+    }
+    return(0);
+}
+
 static xmlNodePtr
 xmlSecTmplAddReference(xmlNodePtr parentNode, xmlSecTransformId digestMethodId,
                     const xmlChar *id, const xmlChar *uri, const xmlChar *type) {
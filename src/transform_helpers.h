@@ -22,6 +22,11 @@
 #include <xmlsec/transforms.h>
 
 
+/**************************** Registration ********************************/
+XMLSEC_EXPORT int   xmlSecTransformIdsRegisterArray             (const xmlSecTransformId* ids,
+                                                                 xmlSecSize idsSize);
+
+
 /**************************** Common Key Agreement params ********************************/
 struct _xmlSecTransformKeyAgreementParams {
     xmlSecTransformPtr  kdfTransform;
@@ -46,7 +51,31 @@ XMLSEC_EXPORT int   xmlSecTransformKeyAgreementParamsWrite         (xmlSecTransf
                                                                     xmlSecTransformCtxPtr transformCtx);
 
 
+/**************************** Deadline ********************************/
+/* the cheap check for the contexts without a deadline or a cancellation flag */
+#define XMLSEC_TRANSFORM_CTX_CHECK_DEADLINE(ctx) \
+    ((((ctx)->deadline > 0) || ((ctx)->cancelFlag != NULL)) ? xmlSecTransformCtxCheckDeadline(ctx) : 0)
+
+
+/********************************** InputURI *******************************/
+XMLSEC_EXPORT int   xmlSecTransformInputURIOpenEx               (xmlSecTransformPtr transform,
+                                                                 const xmlChar* uri,
+                                                                 xmlSecPtrListPtr ioCallbacks);
+XMLSEC_EXPORT int   xmlSecTransformInputURIPopBinAsync          (xmlSecTransformPtr transform,
+                                                                 xmlSecByte* data,
+                                                                 xmlSecSize maxDataSize,
+                                                                 xmlSecSize* dataSize,
+                                                                 xmlSecTransformCtxPtr transformCtx);
+XMLSEC_EXPORT int   xmlSecTransformInputURIGetWaitFd            (xmlSecTransformPtr transform);
+XMLSEC_EXPORT xmlSecSize xmlSecTransformInputURIGetSize         (xmlSecTransformPtr transform);
+#ifndef XMLSEC_NO_FILES
+XMLSEC_EXPORT int   xmlSecTransformInputURIPumpMapped           (xmlSecTransformPtr transform,
+                                                                 xmlSecTransformPtr right,
+                                                                 xmlSecTransformCtxPtr transformCtx);
+#endif /* XMLSEC_NO_FILES */
+
 /**************************** ConcatKDF ********************************/
+
 #ifndef XMLSEC_NO_CONCATKDF
 
 struct _xmlSecTransformConcatKdfParams {
@@ -65,6 +94,8 @@ XMLSEC_EXPORT int   xmlSecTransformConcatKdfParamsRead          (xmlSecTransform
                                                                  xmlNodePtr node);
 XMLSEC_EXPORT int   xmlSecTransformConcatKdfParamsGetFixedInfo  (xmlSecTransformConcatKdfParamsPtr params,
                                                                  xmlSecBufferPtr bufFixedInfo);
+XMLSEC_EXPORT int   xmlSecTransformConcatKdfParamsGetCacheId    (xmlSecTransformConcatKdfParamsPtr params,
+                                                                 xmlSecBufferPtr id);
 
 #endif /* XMLSEC_NO_CONCATKDF */
 
@@ -108,10 +139,52 @@ XMLSEC_EXPORT int   xmlSecTransformPbkdf2ParamsInitialize    (xmlSecTransformPbk
 XMLSEC_EXPORT void  xmlSecTransformPbkdf2ParamsFinalize      (xmlSecTransformPbkdf2ParamsPtr params);
 XMLSEC_EXPORT int   xmlSecTransformPbkdf2ParamsRead          (xmlSecTransformPbkdf2ParamsPtr params,
                                                               xmlNodePtr node);
+XMLSEC_EXPORT int   xmlSecTransformPbkdf2ParamsGetCacheId    (xmlSecTransformPbkdf2ParamsPtr params,
+                                                              xmlSecBufferPtr id);
 
 #endif /* XMLSEC_NO_PBKDF2 */
 
 
+/**************************** Derived keys cache ********************************/
+XMLSEC_EXPORT int   xmlSecTransformKdfCacheFind             (xmlSecTransformPtr transform,
+                                                             xmlSecBufferPtr params,
+                                                             const xmlSecByte* key,
+                                                             xmlSecSize keySize,
+                                                             xmlSecBufferPtr out);
+XMLSEC_EXPORT int   xmlSecTransformKdfCacheAdd              (xmlSecTransformPtr transform,
+                                                             xmlSecBufferPtr params,
+                                                             const xmlSecByte* key,
+                                                             xmlSecSize keySize,
+                                                             xmlSecBufferPtr out);
+XMLSEC_EXPORT int   xmlSecTransformKeyAgreementCacheIsEnabled(void);
+XMLSEC_EXPORT int   xmlSecTransformKeyAgreementCacheFind    (xmlSecTransformPtr transform,
+                                                             xmlSecBufferPtr keysId,
+                                                             xmlSecBufferPtr out);
+XMLSEC_EXPORT int   xmlSecTransformKeyAgreementCacheAdd     (xmlSecTransformPtr transform,
+                                                             xmlSecBufferPtr keysId,
+                                                             xmlSecBufferPtr out);
+void                xmlSecTransformKdfCacheInitialize       (void);
+void                xmlSecTransformKdfCacheShutdown         (void);
+
+
+/**************************** Parallel CBC decryption ********************************/
+typedef int (*xmlSecTransformCbcDecryptSegmentMethod)       (void* cipherCtx,
+                                                             const xmlSecByte* iv,
+                                                             const xmlSecByte* in,
+                                                             xmlSecSize inSize,
+                                                             xmlSecByte* out);
+
+XMLSEC_EXPORT int   xmlSecTransformCbcDecryptIsParallel     (xmlSecTransformCtxPtr transformCtx);
+XMLSEC_EXPORT int   xmlSecTransformCbcDecryptParallel       (xmlSecTransformCtxPtr transformCtx,
+                                                             xmlSecTransformCbcDecryptSegmentMethod decryptSegment,
+                                                             void* cipherCtx,
+                                                             xmlSecByte* iv,
+                                                             xmlSecSize blockSize,
+                                                             xmlSecBufferPtr in,
+                                                             xmlSecBufferPtr out,
+                                                             int last);
+
+
 /********************************** RSA *******************************/
 #ifndef XMLSEC_NO_RSA
 
@@ -131,4 +204,8 @@ XMLSEC_EXPORT int  xmlSecTransformRsaOaepParamsRead         (xmlSecTransformRsaO
 
 #endif /* XMLSEC_NO_RSA */
 
+/********************************** XPath *******************************/
+void xmlSecTransformXPathCacheInitialize                    (void);
+void xmlSecTransformXPathCacheShutdown                      (void);
+
 #endif /* __XMLSEC_TRASNFORMS_HELPERS_H__ */
@@ -48,18 +48,30 @@
  * ]|
  */
 
+/* clock_gettime() for the transforms statistics */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif /* !defined(_WIN32) && !defined(_POSIX_C_SOURCE) */
+
 #include "globals.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <stddef.h>
+#include <time.h>
+
+#if defined(XMLSEC_WINDOWS)
+#include <windows.h>
+#endif /* defined(XMLSEC_WINDOWS) */
 
 #include <libxml/tree.h>
+#include <libxml/threads.h>
 #include <libxml/xpath.h>
 #include <libxml/xpointer.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/buffer.h>
+#include <xmlsec/executor.h>
 #include <xmlsec/xmltree.h>
 #include <xmlsec/keysdata.h>
 #include <xmlsec/keys.h>
@@ -69,15 +81,37 @@
 #include <xmlsec/base64.h>
 #include <xmlsec/io.h>
 #include <xmlsec/membuf.h>
+#include <xmlsec/memstats.h>
 #include <xmlsec/parser.h>
+#include <xmlsec/private.h>
+#include <xmlsec/settings.h>
 #include <xmlsec/errors.h>
 
 #include "xslt.h"
+#include "arena.h"
 #include "cast_helpers.h"
+#include "list_helpers.h"
 #include "transform_helpers.h"
+#include "keysdata_helpers.h"
+#include "keysmngr_helpers.h"
+#include "stats_helpers.h"
 
 #define XMLSEC_TRANSFORM_XPOINTER_TMPL "xpointer(id(\'%s\'))"
 
+static xmlSecTransformPtr       xmlSecTransformCreateInternal   (xmlSecTransformId id,
+                                                                 xmlSecArenaPtr arena);
+static void                     xmlSecTransformStatsDebugDump   (xmlSecTransformStatsPtr stats,
+                                                                 FILE* output);
+static void                     xmlSecTransformStatsDebugXmlDump(xmlSecTransformStatsPtr stats,
+                                                                 FILE* output);
+static xmlSecTransformPtr       xmlSecTransformCtxUriOpen       (xmlSecTransformCtxPtr ctx,
+                                                                 const xmlChar* uri);
+static int                      xmlSecTransformCtxUriFinish     (xmlSecTransformCtxPtr ctx,
+                                                                 xmlSecTransformPtr uriTransform);
+static int                      xmlSecTransformPumpInternal     (xmlSecTransformPtr left,
+                                                                 xmlSecTransformPtr right,
+                                                                 xmlSecTransformCtxPtr transformCtx);
+
 /**************************************************************************
  *
  * Global xmlSecTransformIds list functions
@@ -85,6 +119,37 @@
  *************************************************************************/
 static xmlSecPtrList xmlSecAllTransformIds;
 
+/* lookup indexes for xmlSecAllTransformIds */
+static xmlSecPtrListIndex xmlSecAllTransformIdsByHref;
+static xmlSecPtrListIndex xmlSecAllTransformIdsByName;
+
+static const xmlChar*
+xmlSecTransformIdGetHref(xmlSecPtr item) {
+    return(((xmlSecTransformId)item)->href);
+}
+
+static const xmlChar*
+xmlSecTransformIdGetName(xmlSecPtr item) {
+    return(BAD_CAST ((xmlSecTransformId)item)->name);
+}
+
+static int
+xmlSecTransformIdsUpdateIndexes(void) {
+    int ret;
+
+    ret = xmlSecPtrListIndexUpdate(&xmlSecAllTransformIdsByHref, xmlSecTransformIdsGet());
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListIndexUpdate(href)", NULL);
+        return(-1);
+    }
+    ret = xmlSecPtrListIndexUpdate(&xmlSecAllTransformIdsByName, xmlSecTransformIdsGet());
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListIndexUpdate(name)", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
 
 /**
  * xmlSecTransformIdsGet:
@@ -115,6 +180,8 @@ xmlSecTransformIdsInit(void) {
         xmlSecInternalError("xmlSecPtrListInitialize(xmlSecTransformIdListId)", NULL);
         return(-1);
     }
+    xmlSecPtrListIndexInitialize(&xmlSecAllTransformIdsByHref, xmlSecTransformIdGetHref);
+    xmlSecPtrListIndexInitialize(&xmlSecAllTransformIdsByName, xmlSecTransformIdGetName);
 
     ret = xmlSecTransformIdsRegisterDefault();
     if(ret < 0) {
@@ -126,6 +193,9 @@ xmlSecTransformIdsInit(void) {
     xmlSecTransformXsltInitialize();
 #endif /* XMLSEC_NO_XSLT */
 
+    xmlSecTransformXPathCacheInitialize();
+    xmlSecTransformKdfCacheInitialize();
+
     return(0);
 }
 
@@ -137,10 +207,16 @@ xmlSecTransformIdsInit(void) {
  */
 void
 xmlSecTransformIdsShutdown(void) {
+    xmlSecTransformPoolCleanup();
+    xmlSecTransformKdfCacheShutdown();
+    xmlSecTransformXPathCacheShutdown();
+
 #ifndef XMLSEC_NO_XSLT
     xmlSecTransformXsltShutdown();
 #endif /* XMLSEC_NO_XSLT */
 
+    xmlSecPtrListIndexFinalize(&xmlSecAllTransformIdsByHref);
+    xmlSecPtrListIndexFinalize(&xmlSecAllTransformIdsByName);
     xmlSecPtrListFinalize(xmlSecTransformIdsGet());
 }
 
@@ -165,82 +241,105 @@ xmlSecTransformIdsRegister(xmlSecTransformId id) {
         return(-1);
     }
 
+    /* lookups fall back to the list scan if the indexes are out of date */
+    ret = xmlSecTransformIdsUpdateIndexes();
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformIdsUpdateIndexes",
+                            xmlSecTransformKlassGetName(id));
+        return(-1);
+    }
+
     return(0);
 }
 
 /**
- * xmlSecTransformIdsRegisterDefault:
+ * xmlSecTransformIdsRegisterArray:
+ * @ids:                the array of transform klasses.
+ * @idsSize:            the number of elements in @ids.
  *
- * Registers default (implemented by XML Security Library)
- * transform klasses: XPath transform, Base64 transform, ...
+ * Registers all the non-NULL klasses from @ids in the global list of
+ * transform klasses. The lookup indexes are updated once for the whole
+ * array.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
 int
-xmlSecTransformIdsRegisterDefault(void) {
-    if(xmlSecTransformIdsRegister(xmlSecTransformBase64Id) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformBase64Id)", NULL);
-        return(-1);
+xmlSecTransformIdsRegisterArray(const xmlSecTransformId* ids, xmlSecSize idsSize) {
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2((ids != NULL) || (idsSize == 0), -1);
+
+    for(ii = 0; ii < idsSize; ++ii) {
+        if(ids[ii] == xmlSecTransformIdUnknown) {
+            continue;
+        }
+        ret = xmlSecPtrListAdd(xmlSecTransformIdsGet(), (xmlSecPtr)ids[ii]);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecPtrListAdd",
+                                xmlSecTransformKlassGetName(ids[ii]));
+            return(-1);
+        }
     }
 
-    if(xmlSecTransformIdsRegister(xmlSecTransformEnvelopedId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformEnvelopedId)", NULL);
+    ret = xmlSecTransformIdsUpdateIndexes();
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformIdsUpdateIndexes", NULL);
         return(-1);
     }
+    return(0);
+}
+
+/* the default transform klasses: the table is built at compile time */
+static const xmlSecCryptoTransformGetKlassMethod xmlSecTransformDefaultKlasses[] = {
+    xmlSecTransformBase64GetKlass,
+    xmlSecTransformEnvelopedGetKlass,
 
     /* c14n methods */
-    if(xmlSecTransformIdsRegister(xmlSecTransformInclC14NId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformInclC14NId)", NULL);
-        return(-1);
-    }
-    if(xmlSecTransformIdsRegister(xmlSecTransformInclC14NWithCommentsId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformInclC14NWithCommentsId)", NULL);
-        return(-1);
-    }
-    if(xmlSecTransformIdsRegister(xmlSecTransformInclC14N11Id) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformInclC14N11Id)", NULL);
-        return(-1);
-    }
-    if(xmlSecTransformIdsRegister(xmlSecTransformInclC14N11WithCommentsId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformInclC14N11WithCommentsId)", NULL);
-        return(-1);
-    }
-    if(xmlSecTransformIdsRegister(xmlSecTransformExclC14NId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformExclC14NId)", NULL);
-        return(-1);
-    }
-    if(xmlSecTransformIdsRegister(xmlSecTransformExclC14NWithCommentsId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformExclC14NWithCommentsId)", NULL);
-        return(-1);
-    }
+    xmlSecTransformInclC14NGetKlass,
+    xmlSecTransformInclC14NWithCommentsGetKlass,
+    xmlSecTransformInclC14N11GetKlass,
+    xmlSecTransformInclC14N11WithCommentsGetKlass,
+    xmlSecTransformExclC14NGetKlass,
+    xmlSecTransformExclC14NWithCommentsGetKlass,
+
+    xmlSecTransformXPathGetKlass,
+    xmlSecTransformXPath2GetKlass,
+    xmlSecTransformXPointerGetKlass,
+    xmlSecTransformRelationshipGetKlass,
+
+#ifndef XMLSEC_NO_ZLIB
+    xmlSecTransformDeflateGetKlass,
+#endif /* XMLSEC_NO_ZLIB */
 
-    if(xmlSecTransformIdsRegister(xmlSecTransformXPathId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformXPathId)", NULL);
-        return(-1);
-    }
+#ifndef XMLSEC_NO_XSLT
+    xmlSecTransformXsltGetKlass,
+#endif /* XMLSEC_NO_XSLT */
+};
 
-    if(xmlSecTransformIdsRegister(xmlSecTransformXPath2Id) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformXPath2Id)", NULL);
-        return(-1);
-    }
+#define XMLSEC_TRANSFORM_DEFAULT_KLASSES_SIZE \
+    (sizeof(xmlSecTransformDefaultKlasses) / sizeof(xmlSecTransformDefaultKlasses[0]))
 
-    if(xmlSecTransformIdsRegister(xmlSecTransformXPointerId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformXPointerId)", NULL);
-        return(-1);
-    }
+/**
+ * xmlSecTransformIdsRegisterDefault:
+ *
+ * Registers default (implemented by XML Security Library)
+ * transform klasses: XPath transform, Base64 transform, ...
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecTransformIdsRegisterDefault(void) {
+    xmlSecTransformId ids[XMLSEC_TRANSFORM_DEFAULT_KLASSES_SIZE];
+    xmlSecSize ii;
 
-    if(xmlSecTransformIdsRegister(xmlSecTransformRelationshipId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformRelationshipId)", NULL);
-        return(-1);
+    for(ii = 0; ii < XMLSEC_TRANSFORM_DEFAULT_KLASSES_SIZE; ++ii) {
+        ids[ii] = xmlSecTransformDefaultKlasses[ii]();
     }
-
-#ifndef XMLSEC_NO_XSLT
-    if(xmlSecTransformIdsRegister(xmlSecTransformXsltId) < 0) {
-        xmlSecInternalError("xmlSecTransformIdsRegister(xmlSecTransformXsltId)", NULL);
+    if(xmlSecTransformIdsRegisterArray(ids, XMLSEC_TRANSFORM_DEFAULT_KLASSES_SIZE) < 0) {
+        xmlSecInternalError("xmlSecTransformIdsRegisterArray", NULL);
         return(-1);
     }
-#endif /* XMLSEC_NO_XSLT */
-
     return(0);
 }
 
@@ -287,13 +386,19 @@ static xmlSecSize g_xmlSecTransformCtxDefaultBinaryChunkSize = (64*1024); /* 64k
 /**
  * xmlSecTransformCtxGetDefaultBinaryChunkSize:
  *
- * Gets the binary chunk size. Increasing the chunk size improves
- * XMLSec library performance at the expense of increased memory usage.
+ * Gets the binary chunk size (from the settings attached to the current
+ * thread if set, see #xmlSecSettingsAttach). Increasing the chunk size
+ * improves XMLSec library performance at the expense of increased memory usage.
  *
  * Returns: the current binary processing chunk size.
  */
 xmlSecSize
 xmlSecTransformCtxGetDefaultBinaryChunkSize(void) {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_BINARY_CHUNK_SIZE) != 0) && (settings->binaryChunkSize > 0)) {
+        return(settings->binaryChunkSize);
+    }
     return(g_xmlSecTransformCtxDefaultBinaryChunkSize);
 }
 
@@ -386,6 +491,8 @@ xmlSecTransformCtxInitialize(xmlSecTransformCtxPtr ctx) {
 
     ctx->enabledUris = xmlSecTransformUriTypeAny;
     ctx->binaryChunkSize = xmlSecTransformCtxGetDefaultBinaryChunkSize();
+    ctx->binaryChunkSizeMin = XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_MIN;
+    ctx->binaryChunkSizeMax = XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_MAX;
     return(0);
 }
 
@@ -401,6 +508,9 @@ xmlSecTransformCtxFinalize(xmlSecTransformCtxPtr ctx) {
 
     xmlSecTransformCtxReset(ctx);
     xmlSecPtrListFinalize(&(ctx->enabledTransforms));
+    if((ctx->pumpBuf != NULL) && (ctx->pumpBufExternal == 0)) {
+        xmlFree(ctx->pumpBuf);
+    }
     memset(ctx, 0, sizeof(xmlSecTransformCtx));
 }
 
@@ -429,6 +539,15 @@ xmlSecTransformCtxReset(xmlSecTransformCtxPtr ctx) {
         ctx->xptrExpr = NULL;
     }
 
+    /* report stats before the transforms are gone */
+    if(((ctx->flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) != 0) && (ctx->statsCallback != NULL)) {
+        for(transform = ctx->first; transform != NULL; transform = transform->next) {
+            ctx->statsCallback(ctx, transform, &(transform->stats));
+        }
+    }
+    ctx->statsChildWallTime = 0;
+    ctx->statsChildCpuTime = 0;
+
     /* destroy transforms chain */
     for(transform = ctx->first; transform != NULL; transform = tmp) {
         tmp = transform->next;
@@ -437,6 +556,112 @@ xmlSecTransformCtxReset(xmlSecTransformCtxPtr ctx) {
     ctx->first = ctx->last = NULL;
 }
 
+/**
+ * xmlSecTransformCtxSetPumpBuffer:
+ * @ctx:                the pointer to transforms chain processing context.
+ * @buf:                the caller owned scratch buffer or NULL.
+ * @bufSize:            the size of @buf.
+ *
+ * Sets the scratch buffer used by #xmlSecTransformPump to move binary data
+ * between transforms. The caller is responsible for keeping @buf alive until
+ * the @ctx is finalized or another pump buffer is set. If @buf is NULL then
+ * the @ctx allocates its own buffer on first use and keeps it until the @ctx
+ * is finalized (this is the default).
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecTransformCtxSetPumpBuffer(xmlSecTransformCtxPtr ctx, xmlSecByte* buf, xmlSecSize bufSize) {
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2((buf == NULL) || (bufSize > 0), -1);
+
+    if((ctx->pumpBuf != NULL) && (ctx->pumpBufExternal == 0)) {
+        xmlFree(ctx->pumpBuf);
+    }
+    if(buf != NULL) {
+        ctx->pumpBuf = buf;
+        ctx->pumpBufSize = bufSize;
+        ctx->pumpBufExternal = 1;
+    } else {
+        ctx->pumpBuf = NULL;
+        ctx->pumpBufSize = 0;
+        ctx->pumpBufExternal = 0;
+    }
+    return(0);
+}
+
+static xmlSecByte*
+xmlSecTransformCtxGetPumpBuffer(xmlSecTransformCtxPtr ctx, xmlSecSize* bufSize) {
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->binaryChunkSize > 0, NULL);
+    xmlSecAssert2(bufSize != NULL, NULL);
+
+    /* caller owned buffer: use as much of it as we need */
+    if(ctx->pumpBufExternal != 0) {
+        xmlSecAssert2(ctx->pumpBuf != NULL, NULL);
+        (*bufSize) = (ctx->pumpBufSize < ctx->binaryChunkSize) ? ctx->pumpBufSize : ctx->binaryChunkSize;
+        return(ctx->pumpBuf);
+    }
+
+    /* our own buffer: (re)allocate if binaryChunkSize was increased */
+    if((ctx->pumpBuf == NULL) || (ctx->pumpBufSize < ctx->binaryChunkSize)) {
+        if(ctx->pumpBuf != NULL) {
+            xmlFree(ctx->pumpBuf);
+            ctx->pumpBufSize = 0;
+        }
+        ctx->pumpBuf = (xmlSecByte*)xmlMalloc(ctx->binaryChunkSize);
+        if(ctx->pumpBuf == NULL) {
+            xmlSecMallocError(ctx->binaryChunkSize, NULL);
+            return(NULL);
+        }
+        ctx->pumpBufSize = ctx->binaryChunkSize;
+    }
+    (*bufSize) = ctx->binaryChunkSize;
+    return(ctx->pumpBuf);
+}
+
+/* the chunk size granularity: a multiple of the page size, base64 quad and cipher block sizes */
+#define XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_ALIGN     4096
+
+/*
+ * Picks the binary chunk size for the input of @inputSize bytes (0 if not known)
+ * pushed to the @first transform if XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE
+ * flag is set.
+ */
+static void
+xmlSecTransformCtxAdaptBinaryChunkSize(xmlSecTransformCtxPtr ctx, xmlSecTransformPtr first,
+                                       xmlSecSize inputSize) {
+    xmlSecTransformDataType firstType;
+    xmlSecSize chunkSize;
+
+    xmlSecAssert(ctx != NULL);
+
+    if(((ctx->flags & XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE) == 0) || (inputSize == 0) || (first == NULL)) {
+        return;
+    }
+    if((ctx->binaryChunkSizeMin == 0) || (ctx->binaryChunkSizeMax < ctx->binaryChunkSizeMin)) {
+        return;
+    }
+
+    /* the XML transforms (e.g. parser) read the whole input anyway */
+    firstType = xmlSecTransformGetDataType(first, xmlSecTransformModePush, ctx);
+    if((firstType & xmlSecTransformDataTypeBin) == 0) {
+        return;
+    }
+
+    chunkSize = inputSize;
+    if(chunkSize < ctx->binaryChunkSizeMin) {
+        chunkSize = ctx->binaryChunkSizeMin;
+    }
+    if((chunkSize % XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_ALIGN) != 0) {
+        chunkSize += XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_ALIGN - (chunkSize % XMLSEC_TRANSFORMCTX_BINARY_CHUNK_SIZE_ALIGN);
+    }
+    if(chunkSize > ctx->binaryChunkSizeMax) {
+        chunkSize = ctx->binaryChunkSizeMax;
+    }
+    ctx->binaryChunkSize = chunkSize;
+}
+
 /**
  * xmlSecTransformCtxCopyUserPref:
  * @dst:                the pointer to destination transforms chain processing context.
@@ -456,9 +681,20 @@ xmlSecTransformCtxCopyUserPref(xmlSecTransformCtxPtr dst, xmlSecTransformCtxPtr
     dst->userData        = src->userData;
     dst->flags           = src->flags;
     dst->flags2          = src->flags2;
+    dst->binaryChunkSize = src->binaryChunkSize;
+    dst->binaryChunkSizeMin = src->binaryChunkSizeMin;
+    dst->binaryChunkSizeMax = src->binaryChunkSizeMax;
     dst->enabledUris     = src->enabledUris;
     dst->preExecCallback = src->preExecCallback;
-
+    dst->statsCallback   = src->statsCallback;
+    dst->ioCallbacks     = src->ioCallbacks;
+    dst->deadline        = src->deadline;
+    dst->cancelFlag      = src->cancelFlag;
+    dst->executor        = src->executor;
+    dst->executorMinSize = src->executorMinSize;
+
+    /* replace (not append to) the list: the contexts are reused */
+    xmlSecPtrListEmpty(&(dst->enabledTransforms));
     ret = xmlSecPtrListCopy(&(dst->enabledTransforms), &(src->enabledTransforms));
     if(ret < 0) {
         xmlSecInternalError("xmlSecPtrListCopy(enabledTransforms)", NULL);
@@ -468,6 +704,111 @@ xmlSecTransformCtxCopyUserPref(xmlSecTransformCtxPtr dst, xmlSecTransformCtxPtr
     return(0);
 }
 
+static double           xmlSecTransformStatsGetWallTime         (void);
+
+/**
+ * xmlSecTransformCtxSetDeadline:
+ * @ctx:                the pointer to transforms chain processing context.
+ * @timeout:            the time budget in seconds from now or 0 for no deadline.
+ * @cancelFlag:         the optional pointer to the application flag or NULL.
+ *
+ * Sets the time budget for the processing with the @ctx: once the @timeout
+ * expires or the @cancelFlag is set to a non-zero value (e.g. by another
+ * thread), the processing stops at the next check and fails with
+ * the #XMLSEC_ERRORS_R_DEADLINE_EXCEEDED or #XMLSEC_ERRORS_R_OPERATION_CANCELLED
+ * error. The checks are made when the transforms are executed, between
+ * the #xmlSecTransformPump chunks and during the keys resolution. A single
+ * long running step (e.g. an XPath expression evaluation or a blocking read)
+ * is not interrupted. The deadline is copied with the other user settings
+ * (see #xmlSecTransformCtxCopyUserPref).
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecTransformCtxSetDeadline(xmlSecTransformCtxPtr ctx, double timeout, volatile int* cancelFlag) {
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(timeout >= 0, -1);
+
+    ctx->deadline = (timeout > 0) ? (xmlSecTransformStatsGetWallTime() + timeout) : 0;
+    ctx->cancelFlag = cancelFlag;
+    return(0);
+}
+
+/**
+ * xmlSecTransformCtxCheckDeadline:
+ * @ctx:                the pointer to transforms chain processing context.
+ *
+ * Checks the @ctx deadline and cancellation flag (see #xmlSecTransformCtxSetDeadline)
+ * and reports the #XMLSEC_ERRORS_R_DEADLINE_EXCEEDED or #XMLSEC_ERRORS_R_OPERATION_CANCELLED
+ * error if the processing should stop.
+ *
+ * Returns: 0 if the processing can continue or a negative value otherwise.
+ */
+int
+xmlSecTransformCtxCheckDeadline(xmlSecTransformCtxPtr ctx) {
+    xmlSecAssert2(ctx != NULL, -1);
+
+    switch(xmlSecTransformCtxIsDeadlineExceeded(ctx)) {
+    case 0:
+        return(0);
+    case 2:
+        xmlSecOtherError(XMLSEC_ERRORS_R_OPERATION_CANCELLED, NULL, NULL);
+        return(-1);
+    default:
+        xmlSecOtherError(XMLSEC_ERRORS_R_DEADLINE_EXCEEDED, NULL, NULL);
+        return(-1);
+    }
+}
+
+/**
+ * xmlSecTransformCtxIsDeadlineExceeded:
+ * @ctx:                the pointer to transforms chain processing context.
+ *
+ * Checks the @ctx deadline and cancellation flag (see #xmlSecTransformCtxSetDeadline)
+ * without reporting an error, e.g. to find out why the processing failed.
+ *
+ * Returns: 0 if the processing can continue, 1 if the deadline is exceeded
+ * or 2 if the processing is cancelled.
+ */
+int
+xmlSecTransformCtxIsDeadlineExceeded(xmlSecTransformCtxPtr ctx) {
+    xmlSecAssert2(ctx != NULL, 0);
+
+    if((ctx->cancelFlag != NULL) && ((*(ctx->cancelFlag)) != 0)) {
+        return(2);
+    }
+    if((ctx->deadline > 0) && (xmlSecTransformStatsGetWallTime() >= ctx->deadline)) {
+        return(1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecTransformCtxSetExecutor:
+ * @ctx:                the pointer to transforms chain processing context.
+ * @executor:           the executor (not owned) or NULL to disable the parallel decryption.
+ * @minSize:            the minimum size of the data decrypted on the @executor at once
+ *                      or 0 for the default (#XMLSEC_TRANSFORMCTX_EXECUTOR_MIN_SIZE).
+ *
+ * Enables the parallel decryption of the large CBC payloads (e.g. multi-GB
+ * legacy AES-CBC encrypted data) for the crypto backends that support it
+ * (OpenSSL, NSS and GnuTLS): the ciphertext is buffered until there is at
+ * least @minSize bytes, then it is split into segments that are decrypted
+ * on the @executor. The smaller payloads are decrypted in the current thread.
+ * The encryption is not affected. The executor must outlive the @ctx and
+ * it is copied with the other user settings (see #xmlSecTransformCtxCopyUserPref).
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecTransformCtxSetExecutor(xmlSecTransformCtxPtr ctx, xmlSecExecutorPtr executor, xmlSecSize minSize) {
+    xmlSecAssert2(ctx != NULL, -1);
+
+    ctx->executor = executor;
+    ctx->executorMinSize = minSize;
+    return(0);
+}
+
 /**
  * xmlSecTransformCtxAppend:
  * @ctx:                the pointer to transforms chain processing context.
@@ -555,9 +896,9 @@ xmlSecTransformCtxCreateAndAppend(xmlSecTransformCtxPtr ctx, xmlSecTransformId i
     xmlSecAssert2(ctx->status == xmlSecTransformStatusNone, NULL);
     xmlSecAssert2(id != xmlSecTransformIdUnknown, NULL);
 
-    transform = xmlSecTransformCreate(id);
+    transform = xmlSecTransformCreateInternal(id, ctx->arena);
     if(!xmlSecTransformIsValid(transform)) {
-        xmlSecInternalError("xmlSecTransformCreate",
+        xmlSecInternalError("xmlSecTransformCreateInternal",
                             xmlSecTransformKlassGetName(id));
         return(NULL);
     }
@@ -592,9 +933,9 @@ xmlSecTransformCtxCreateAndPrepend(xmlSecTransformCtxPtr ctx, xmlSecTransformId
     xmlSecAssert2(ctx->status == xmlSecTransformStatusNone, NULL);
     xmlSecAssert2(id != xmlSecTransformIdUnknown, NULL);
 
-    transform = xmlSecTransformCreate(id);
+    transform = xmlSecTransformCreateInternal(id, ctx->arena);
     if(!xmlSecTransformIsValid(transform)) {
-        xmlSecInternalError("xmlSecTransformCreate",
+        xmlSecInternalError("xmlSecTransformCreateInternal",
                             xmlSecTransformKlassGetName(id));
         return(NULL);
     }
@@ -970,6 +1311,7 @@ xmlSecTransformCtxBinaryExecute(xmlSecTransformCtxPtr ctx,
         xmlSecInternalError("xmlSecTransformCtxPrepare(TypeBin)", NULL);
         return(-1);
     }
+    xmlSecTransformCtxAdaptBinaryChunkSize(ctx, ctx->first, dataSize);
 
     ret = xmlSecTransformPushBin(ctx->first, data, dataSize, 1, ctx);
     if(ret < 0) {
@@ -983,95 +1325,491 @@ xmlSecTransformCtxBinaryExecute(xmlSecTransformCtxPtr ctx,
 }
 
 /**
- * xmlSecTransformCtxUriExecute:
+ * xmlSecTransformCtxBinaryExecuteV:
  * @ctx:                the pointer to transforms chain processing context.
- * @uri:                the URI.
+ * @segments:           the input binary data segments.
+ * @segmentsSize:       the number of segments in @segments.
  *
- * Process binary data from the URI using transforms chain in @ctx.
+ * Processes binary data stored in several non-contiguous @segments using
+ * transforms chain in the @ctx (see #xmlSecTransformPushBinV). The segments
+ * are not copied into one buffer.
  *
  * Returns: 0 on success or a negative value otherwise.
  */
 int
-xmlSecTransformCtxUriExecute(xmlSecTransformCtxPtr ctx, const xmlChar* uri) {
-    xmlSecTransformPtr uriTransform;
+xmlSecTransformCtxBinaryExecuteV(xmlSecTransformCtxPtr ctx,
+                                const xmlSecTransformBinSegment* segments, xmlSecSize segmentsSize) {
+    xmlSecSize dataSize = 0;
+    xmlSecSize ii;
     int ret;
 
     xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->result == NULL, -1);
     xmlSecAssert2(ctx->status == xmlSecTransformStatusNone, -1);
-    xmlSecAssert2(uri != NULL, -1);
-
-    /* we should not execute transform for a different uri */
-    xmlSecAssert2((ctx->uri == NULL) || (uri == ctx->uri) || xmlStrEqual(uri, ctx->uri), -1);
+    xmlSecAssert2((segments != NULL) || (segmentsSize == 0), -1);
 
-    uriTransform = xmlSecTransformCtxCreateAndPrepend(ctx, xmlSecTransformInputURIId);
-    if(uriTransform == NULL) {
-        xmlSecInternalError("xmlSecTransformCtxCreateAndPrepend(xmlSecTransformInputURIId)", NULL);
-        return(-1);
-    }
-
-    ret = xmlSecTransformInputURIOpen(uriTransform, uri);
-    if(ret < 0) {
-        xmlSecInternalError2("xmlSecTransformInputURIOpen", NULL,
-                            "uri=%s", xmlSecErrorsSafeString(uri));
-        return(-1);
-    }
+    /* we should not have uri stored in ctx */
+    xmlSecAssert2(ctx->uri == NULL, -1);
 
-    /* we do not need to do something special for this transform */
-    ret = xmlSecTransformCtxPrepare(ctx, xmlSecTransformDataTypeUnknown);
+    ret = xmlSecTransformCtxPrepare(ctx, xmlSecTransformDataTypeBin);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformCtxPrepare(TypeUnknown)", NULL);
+        xmlSecInternalError("xmlSecTransformCtxPrepare(TypeBin)", NULL);
         return(-1);
     }
-
-    /* Now we have a choice: we either can push from first transform or pop
-     * from last. Our C14N transforms prefers push, so push data!
-     */
-    ret = xmlSecTransformPump(uriTransform, uriTransform->next, ctx);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformPump",
-                            xmlSecTransformGetName(uriTransform));
-        return(-1);
+    for(ii = 0; ii < segmentsSize; ++ii) {
+        dataSize += segments[ii].size;
     }
+    xmlSecTransformCtxAdaptBinaryChunkSize(ctx, ctx->first, dataSize);
 
-    /* Close to free up file handle */
-    ret = xmlSecTransformInputURIClose(uriTransform);
+    ret = xmlSecTransformPushBinV(ctx->first, segments, segmentsSize, 1, ctx);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformInputURIClose",
-                            xmlSecTransformGetName(uriTransform));
+        xmlSecInternalError3("xmlSecTransformPushBinV", NULL,
+            "segmentsSize=" XMLSEC_SIZE_FMT "; dataSize=" XMLSEC_SIZE_FMT,
+            segmentsSize, dataSize);
         return(-1);
     }
 
-    /* Done */
     ctx->status = xmlSecTransformStatusFinished;
     return(0);
 }
 
+/* the max number of the node content segments pushed at once */
+#define XMLSEC_TRANSFORM_NODE_CONTENT_SEGMENTS_SIZE     16
+
+/* the state of the node content processing */
+typedef struct _xmlSecTransformNodeContentCtx {
+    xmlSecTransformCtxPtr           ctx;
+    xmlSecTransformBinSegment       segments[XMLSEC_TRANSFORM_NODE_CONTENT_SEGMENTS_SIZE];
+    xmlSecSize                      segmentsSize;
+    xmlSecSize                      dataSize;
+} xmlSecTransformNodeContentCtx;
+
+static int
+xmlSecTransformNodeContentGetSize(const xmlChar* data, xmlSecSize size, void* context) {
+    xmlSecTransformNodeContentCtx* contentCtx = (xmlSecTransformNodeContentCtx*)context;
+
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(contentCtx != NULL, -1);
+
+    contentCtx->dataSize += size;
+    return(0);
+}
+
+static int
+xmlSecTransformNodeContentPush(const xmlChar* data, xmlSecSize size, void* context) {
+    xmlSecTransformNodeContentCtx* contentCtx = (xmlSecTransformNodeContentCtx*)context;
+    int ret;
+
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(contentCtx != NULL, -1);
+    xmlSecAssert2(contentCtx->ctx != NULL, -1);
+
+    if(size == 0) {
+        return(0);
+    }
+    if(contentCtx->segmentsSize >= XMLSEC_TRANSFORM_NODE_CONTENT_SEGMENTS_SIZE) {
+        ret = xmlSecTransformPushBinV(contentCtx->ctx->first, contentCtx->segments,
+            contentCtx->segmentsSize, 0, contentCtx->ctx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformPushBinV", NULL);
+            return(-1);
+        }
+        contentCtx->segmentsSize = 0;
+    }
+    contentCtx->segments[contentCtx->segmentsSize].data = data;
+    contentCtx->segments[contentCtx->segmentsSize].size = size;
+    ++contentCtx->segmentsSize;
+    return(0);
+}
+
 /**
- * xmlSecTransformCtxXmlExecute:
+ * xmlSecTransformCtxNodeContentExecute:
  * @ctx:                the pointer to transforms chain processing context.
- * @nodes:              the input node set.
+ * @node:               the pointer to the node.
  *
- * Process @nodes using transforms in the transforms chain in @ctx.
+ * Processes the @node content (see #xmlSecNodeContentForEach) using
+ * transforms chain in the @ctx. The text children of the @node are
+ * pushed to the chain in place (i.e. the content is not copied
+ * into a string first).
  *
  * Returns: 0 on success or a negative value otherwise.
  */
 int
-xmlSecTransformCtxXmlExecute(xmlSecTransformCtxPtr ctx, xmlSecNodeSetPtr nodes) {
+xmlSecTransformCtxNodeContentExecute(xmlSecTransformCtxPtr ctx, xmlNodePtr node) {
+    xmlSecTransformNodeContentCtx contentCtx;
     int ret;
 
     xmlSecAssert2(ctx != NULL, -1);
     xmlSecAssert2(ctx->result == NULL, -1);
     xmlSecAssert2(ctx->status == xmlSecTransformStatusNone, -1);
-    xmlSecAssert2(nodes != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
 
-    xmlSecAssert2((ctx->uri == NULL) || (xmlStrlen(ctx->uri) == 0), -1);
+    /* we should not have uri stored in ctx */
+    xmlSecAssert2(ctx->uri == NULL, -1);
 
-    ret = xmlSecTransformCtxPrepare(ctx, xmlSecTransformDataTypeXml);
+    memset(&contentCtx, 0, sizeof(contentCtx));
+    contentCtx.ctx = ctx;
+
+    ret = xmlSecTransformCtxPrepare(ctx, xmlSecTransformDataTypeBin);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxPrepare(TypeBin)", NULL);
+        return(-1);
+    }
+
+    /* the chunk size is picked for the whole content */
+    if((ctx->flags & XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE) != 0) {
+        ret = xmlSecNodeContentForEach(node, xmlSecTransformNodeContentGetSize, &contentCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecNodeContentForEach", NULL);
+            return(-1);
+        }
+        xmlSecTransformCtxAdaptBinaryChunkSize(ctx, ctx->first, contentCtx.dataSize);
+    }
+
+    ret = xmlSecNodeContentForEach(node, xmlSecTransformNodeContentPush, &contentCtx);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecNodeContentForEach", NULL,
+            "node=%s", xmlSecErrorsSafeString(xmlSecNodeGetName(node)));
+        return(-1);
+    }
+    ret = xmlSecTransformPushBinV(ctx->first, contentCtx.segments, contentCtx.segmentsSize, 1, ctx);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecTransformPushBinV", NULL,
+            "segmentsSize=" XMLSEC_SIZE_FMT, contentCtx.segmentsSize);
+        return(-1);
+    }
+
+    ctx->status = xmlSecTransformStatusFinished;
+    return(0);
+}
+
+static xmlSecTransformPtr
+xmlSecTransformCtxUriOpen(xmlSecTransformCtxPtr ctx, const xmlChar* uri) {
+    xmlSecTransformPtr uriTransform;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->status == xmlSecTransformStatusNone, NULL);
+    xmlSecAssert2(uri != NULL, NULL);
+
+    /* we should not execute transform for a different uri */
+    xmlSecAssert2((ctx->uri == NULL) || (uri == ctx->uri) || xmlStrEqual(uri, ctx->uri), NULL);
+
+    uriTransform = xmlSecTransformCtxCreateAndPrepend(ctx, xmlSecTransformInputURIId);
+    if(uriTransform == NULL) {
+        xmlSecInternalError("xmlSecTransformCtxCreateAndPrepend(xmlSecTransformInputURIId)", NULL);
+        return(NULL);
+    }
+
+    ret = xmlSecTransformInputURIOpenEx(uriTransform, uri, ctx->ioCallbacks);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecTransformInputURIOpenEx", NULL,
+                            "uri=%s", xmlSecErrorsSafeString(uri));
+        return(NULL);
+    }
+
+    /* we do not need to do something special for this transform */
+    ret = xmlSecTransformCtxPrepare(ctx, xmlSecTransformDataTypeUnknown);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxPrepare(TypeUnknown)", NULL);
+        return(NULL);
+    }
+    xmlSecTransformCtxAdaptBinaryChunkSize(ctx, uriTransform->next,
+        xmlSecTransformInputURIGetSize(uriTransform));
+
+    return(uriTransform);
+}
+
+static int
+xmlSecTransformCtxUriFinish(xmlSecTransformCtxPtr ctx, xmlSecTransformPtr uriTransform) {
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+
+    /* Close to free up file handle */
+    ret = xmlSecTransformInputURIClose(uriTransform);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformInputURIClose",
+                            xmlSecTransformGetName(uriTransform));
+        return(-1);
+    }
+
+    /* Done */
+    ctx->status = xmlSecTransformStatusFinished;
+    return(0);
+}
+
+/**
+ * xmlSecTransformCtxUriExecute:
+ * @ctx:                the pointer to transforms chain processing context.
+ * @uri:                the URI.
+ *
+ * Process binary data from the URI using transforms chain in @ctx.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecTransformCtxUriExecute(xmlSecTransformCtxPtr ctx, const xmlChar* uri) {
+    xmlSecTransformPtr uriTransform;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->status == xmlSecTransformStatusNone, -1);
+    xmlSecAssert2(uri != NULL, -1);
+
+    uriTransform = xmlSecTransformCtxUriOpen(ctx, uri);
+    if(uriTransform == NULL) {
+        xmlSecInternalError2("xmlSecTransformCtxUriOpen", NULL,
+                            "uri=%s", xmlSecErrorsSafeString(uri));
+        return(-1);
+    }
+
+    /* Now we have a choice: we either can push from first transform or pop
+     * from last. Our C14N transforms prefers push, so push data!
+     */
+    ret = 0;
+#ifndef XMLSEC_NO_FILES
+    /* the mapped local files are pushed at once */
+    ret = xmlSecTransformInputURIPumpMapped(uriTransform, uriTransform->next, ctx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformInputURIPumpMapped",
+                            xmlSecTransformGetName(uriTransform));
+        return(-1);
+    }
+#endif /* XMLSEC_NO_FILES */
+    if(ret == 0) {
+        ret = xmlSecTransformPump(uriTransform, uriTransform->next, ctx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformPump",
+                                xmlSecTransformGetName(uriTransform));
+            return(-1);
+        }
+    }
+
+    return(xmlSecTransformCtxUriFinish(ctx, uriTransform));
+}
+
+/**
+ * xmlSecTransformCtxUriExecuteStart:
+ * @ctx:                the pointer to transforms chain processing context.
+ * @uri:                the URI.
+ *
+ * Starts processing binary data from the URI using transforms chain in @ctx
+ * without blocking on the data source. If the @uri is opened with the
+ * non-blocking I/O callbacks (see #xmlSecIOCallbackPtrListAddAsync) and
+ * no data is available then the function returns 1; the application
+ * should wait on the file descriptor from #xmlSecTransformCtxGetWaitFd
+ * and call #xmlSecTransformCtxUriExecuteResume. The chain state is kept
+ * in @ctx in between. For the other data sources the function behaves
+ * like #xmlSecTransformCtxUriExecute.
+ *
+ * Returns: 0 if the processing is finished, 1 if it would block or
+ * a negative value if an error occurs.
+ */
+int
+xmlSecTransformCtxUriExecuteStart(xmlSecTransformCtxPtr ctx, const xmlChar* uri) {
+    xmlSecTransformPtr uriTransform;
+    xmlSecTransformDataType rightType;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->status == xmlSecTransformStatusNone, -1);
+    xmlSecAssert2(uri != NULL, -1);
+
+    uriTransform = xmlSecTransformCtxUriOpen(ctx, uri);
+    if(uriTransform == NULL) {
+        xmlSecInternalError2("xmlSecTransformCtxUriOpen", NULL,
+                            "uri=%s", xmlSecErrorsSafeString(uri));
+        return(-1);
+    }
+
+#ifndef XMLSEC_NO_FILES
+    /* the mapped local files are pushed at once */
+    ret = xmlSecTransformInputURIPumpMapped(uriTransform, uriTransform->next, ctx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformInputURIPumpMapped",
+                            xmlSecTransformGetName(uriTransform));
+        return(-1);
+    } else if(ret == 1) {
+        return(xmlSecTransformCtxUriFinish(ctx, uriTransform));
+    }
+#endif /* XMLSEC_NO_FILES */
+
+    /* only the binary data can be pushed chunk by chunk */
+    rightType = xmlSecTransformGetDataType(uriTransform->next, xmlSecTransformModePush, ctx);
+    if((rightType & xmlSecTransformDataTypeBin) == 0) {
+        ret = xmlSecTransformPump(uriTransform, uriTransform->next, ctx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformPump",
+                                xmlSecTransformGetName(uriTransform));
+            return(-1);
+        }
+        return(xmlSecTransformCtxUriFinish(ctx, uriTransform));
+    }
+
+    return(xmlSecTransformCtxUriExecuteResume(ctx));
+}
+
+/**
+ * xmlSecTransformCtxUriExecuteResume:
+ * @ctx:                the pointer to transforms chain processing context.
+ *
+ * Resumes processing started with #xmlSecTransformCtxUriExecuteStart
+ * after the data source file descriptor (see #xmlSecTransformCtxGetWaitFd)
+ * becomes readable.
+ *
+ * Returns: 0 if the processing is finished, 1 if it would block again or
+ * a negative value if an error occurs.
+ */
+int
+xmlSecTransformCtxUriExecuteResume(xmlSecTransformCtxPtr ctx) {
+    xmlSecTransformPtr uriTransform;
+    xmlSecByte* buf;
+    xmlSecSize bufMaxSize = 0;
+    xmlSecSize bufSize;
+    int final;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->status == xmlSecTransformStatusWorking, -1);
+
+    uriTransform = ctx->first;
+    xmlSecAssert2(xmlSecTransformCheckId(uriTransform, xmlSecTransformInputURIId), -1);
+    xmlSecAssert2(xmlSecTransformIsValid(uriTransform->next), -1);
+
+    /* the buffer is owned by ctx and re-used between calls */
+    buf = xmlSecTransformCtxGetPumpBuffer(ctx, &bufMaxSize);
+    if(buf == NULL) {
+        xmlSecInternalError("xmlSecTransformCtxGetPumpBuffer", xmlSecTransformGetName(uriTransform));
+        return(-1);
+    }
+
+    do {
+        bufSize = 0;
+        ret = xmlSecTransformInputURIPopBinAsync(uriTransform, buf, bufMaxSize, &bufSize, ctx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformInputURIPopBinAsync",
+                                xmlSecTransformGetName(uriTransform));
+            return(-1);
+        } else if(ret == 1) {
+            /* would block: the chain state stays in ctx */
+            return(1);
+        }
+
+        final = (bufSize == 0) ? 1 : 0;
+        ret = xmlSecTransformPushBin(uriTransform->next, buf, bufSize, final, ctx);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecTransformPushBin",
+                                 xmlSecTransformGetName(uriTransform->next),
+                                 "size=" XMLSEC_SIZE_FMT, bufSize);
+            return(-1);
+        }
+    } while(final == 0);
+
+    return(xmlSecTransformCtxUriFinish(ctx, uriTransform));
+}
+
+/**
+ * xmlSecTransformCtxGetWaitFd:
+ * @ctx:                the pointer to transforms chain processing context.
+ *
+ * Gets the file descriptor to wait on after #xmlSecTransformCtxUriExecuteStart
+ * or #xmlSecTransformCtxUriExecuteResume returned 1.
+ *
+ * Returns: the file descriptor or -1 if it is not available.
+ */
+int
+xmlSecTransformCtxGetWaitFd(xmlSecTransformCtxPtr ctx) {
+    xmlSecAssert2(ctx != NULL, -1);
+
+    if((ctx->status != xmlSecTransformStatusWorking) ||
+       (!xmlSecTransformCheckId(ctx->first, xmlSecTransformInputURIId))) {
+        return(-1);
+    }
+    return(xmlSecTransformInputURIGetWaitFd(ctx->first));
+}
+
+/* Returns the first transform in the chain that converts XML to binary data (e.g. C14N) */
+static xmlSecTransformPtr
+xmlSecTransformCtxGetXmlToBin(xmlSecTransformCtxPtr ctx) {
+    xmlSecTransformDataType type;
+    xmlSecTransformPtr transform;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+
+    for(transform = ctx->first; transform != NULL; transform = transform->next) {
+        type = xmlSecTransformGetDataType(transform, xmlSecTransformModePush, ctx);
+        if((type & xmlSecTransformDataTypeXml) == 0) {
+            break;
+        }
+        type = xmlSecTransformGetDataType(transform, xmlSecTransformModePop, ctx);
+        if((type & xmlSecTransformDataTypeXml) == 0) {
+            return(transform);
+        }
+    }
+    return(NULL);
+}
+
+/* Returns 1 if @transform writes its binary output directly to the next transform in the push mode */
+static int
+xmlSecTransformCanStreamXml(xmlSecTransformPtr transform, xmlSecTransformCtxPtr ctx) {
+    xmlSecTransformDataType type;
+
+    xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    /* the default pushXml method pushes XML to the next transform */
+    if((transform->id->pushXml == NULL) || (transform->id->pushXml == xmlSecTransformDefaultPushXml)) {
+        return(0);
+    }
+    if(transform->next == NULL) {
+        return(0);
+    }
+    type = xmlSecTransformGetDataType(transform->next, xmlSecTransformModePush, ctx);
+    if((type & xmlSecTransformDataTypeBin) == 0) {
+        return(0);
+    }
+    return(1);
+}
+
+/**
+ * xmlSecTransformCtxXmlExecute:
+ * @ctx:                the pointer to transforms chain processing context.
+ * @nodes:              the input node set.
+ *
+ * Process @nodes using transforms in the transforms chain in @ctx.
+ *
+ * Returns: 0 on success or a negative value otherwise.
+ */
+int
+xmlSecTransformCtxXmlExecute(xmlSecTransformCtxPtr ctx, xmlSecNodeSetPtr nodes) {
+    xmlSecTransformPtr xml2bin;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->result == NULL, -1);
+    xmlSecAssert2(ctx->status == xmlSecTransformStatusNone, -1);
+    xmlSecAssert2(nodes != NULL, -1);
+
+    xmlSecAssert2((ctx->uri == NULL) || (xmlStrlen(ctx->uri) == 0), -1);
+
+    ret = xmlSecTransformCtxPrepare(ctx, xmlSecTransformDataTypeXml);
     if(ret < 0) {
         xmlSecInternalError("xmlSecTransformCtxPrepare(TypeXml)", NULL);
         return(-1);
     }
 
+    /* the first XML-to-binary transform (e.g. C14N) in the push mode writes
+     * its output directly to the next transform chunk by chunk, in the pop
+     * mode the whole output would be stored in its output buffer */
+    xml2bin = xmlSecTransformCtxGetXmlToBin(ctx);
+    if((xml2bin != NULL) && (xmlSecTransformCanStreamXml(xml2bin, ctx) != 1)) {
+        xmlSecInvalidTransfromError2(xml2bin,
+            "the output can not be streamed to the next transform=\"%s\"",
+            xmlSecErrorsSafeString(xmlSecTransformGetName(xml2bin->next)));
+        return(-1);
+    }
+
     /* it's better to do push than pop because all XML transform
      * just don't care and c14n likes push more than pop */
     ret = xmlSecTransformPushXml(ctx->first, nodes, ctx);
@@ -1173,6 +1911,9 @@ xmlSecTransformCtxDebugDump(xmlSecTransformCtxPtr ctx, FILE* output) {
             (ctx->xptrExpr != NULL) ? ctx->xptrExpr : BAD_CAST "NULL");
     for(transform = ctx->first; transform != NULL; transform = transform->next) {
         xmlSecTransformDebugDump(transform, output);
+        if((ctx->flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) != 0) {
+            xmlSecTransformStatsDebugDump(&(transform->stats), output);
+        }
     }
 }
 
@@ -1214,8 +1955,190 @@ xmlSecTransformCtxDebugXmlDump(xmlSecTransformCtxPtr ctx, FILE* output) {
 
     for(transform = ctx->first; transform != NULL; transform = transform->next) {
         xmlSecTransformDebugXmlDump(transform, output);
+        if((ctx->flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) != 0) {
+            xmlSecTransformStatsDebugXmlDump(&(transform->stats), output);
+        }
+    }
+    fprintf(output, "</TransformCtx>\n");
+}
+
+/**************************************************************************
+ *
+ * Per-thread transforms pool
+ *
+ *************************************************************************/
+/* the max number of transform klasses cached per thread */
+#define XMLSEC_TRANSFORM_POOL_KLASSES_SIZE              32
+
+typedef struct _xmlSecTransformPoolEntry {
+    xmlSecTransformId           id;
+    xmlSecTransformPtr          first;          /* linked thru transform->next */
+    xmlSecSize                  size;
+} xmlSecTransformPoolEntry;
+
+typedef struct _xmlSecTransformPool {
+    xmlSecSize                  maxObjects;
+    xmlSecSize                  maxBufferSize;
+    xmlSecTransformPoolEntry    entries[XMLSEC_TRANSFORM_POOL_KLASSES_SIZE];
+} xmlSecTransformPool;
+
+#ifdef XMLSEC_THREAD_LOCAL
+static XMLSEC_THREAD_LOCAL xmlSecTransformPool gTransformPool;
+#endif /* XMLSEC_THREAD_LOCAL */
+
+/* clears everything but the binary data buffers */
+static void
+xmlSecTransformClearKeepBuffers(xmlSecTransformPtr transform, xmlSecSize objSize) {
+    size_t head, tail;
+
+    xmlSecAssert(transform != NULL);
+    xmlSecAssert(objSize >= sizeof(xmlSecTransform));
+
+    head = offsetof(xmlSecTransform, inBuf);
+    tail = offsetof(xmlSecTransform, outBuf) + sizeof(xmlSecBuffer);
+    memset(transform, 0, head);
+    memset(((xmlSecByte*)transform) + tail, 0, objSize - tail);
+}
+
+/* returns the finalized transform of @id klass with empty buffers or NULL */
+static xmlSecTransformPtr
+xmlSecTransformPoolAcquire(xmlSecTransformId id) {
+#ifdef XMLSEC_THREAD_LOCAL
+    xmlSecTransformPoolEntry* entry;
+    xmlSecTransformPtr transform;
+    xmlSecSize ii;
+
+    xmlSecAssert2(id != NULL, NULL);
+
+    if(gTransformPool.maxObjects == 0) {
+        return(NULL);
+    }
+    for(ii = 0; ii < XMLSEC_TRANSFORM_POOL_KLASSES_SIZE; ++ii) {
+        entry = &(gTransformPool.entries[ii]);
+        if((entry->id == id) && (entry->first != NULL)) {
+            transform = entry->first;
+            entry->first = transform->next;
+            --entry->size;
+            transform->next = NULL;
+            return(transform);
+        }
+    }
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(id);
+#endif /* XMLSEC_THREAD_LOCAL */
+    return(NULL);
+}
+
+/* keeps the finalized @transform for reuse: returns 1 if it was kept, 0 otherwise */
+static int
+xmlSecTransformPoolRelease(xmlSecTransformPtr transform, xmlSecTransformId id) {
+#ifdef XMLSEC_THREAD_LOCAL
+    xmlSecTransformPoolEntry* entry = NULL;
+    xmlSecSize ii;
+
+    xmlSecAssert2(transform != NULL, 0);
+    xmlSecAssert2(id != NULL, 0);
+
+    if(gTransformPool.maxObjects == 0) {
+        return(0);
+    }
+    for(ii = 0; ii < XMLSEC_TRANSFORM_POOL_KLASSES_SIZE; ++ii) {
+        if(gTransformPool.entries[ii].id == id) {
+            entry = &(gTransformPool.entries[ii]);
+            break;
+        }
+        if((entry == NULL) && (gTransformPool.entries[ii].first == NULL)) {
+            entry = &(gTransformPool.entries[ii]);
+        }
+    }
+    if((entry == NULL) || (entry->size >= gTransformPool.maxObjects)) {
+        return(0);
+    }
+
+    /* large buffers are not worth keeping */
+    if(xmlSecBufferGetMaxSize(&(transform->inBuf)) > gTransformPool.maxBufferSize) {
+        xmlSecBufferFinalize(&(transform->inBuf));
+    } else {
+        xmlSecBufferEmpty(&(transform->inBuf));
+    }
+    if(xmlSecBufferGetMaxSize(&(transform->outBuf)) > gTransformPool.maxBufferSize) {
+        xmlSecBufferFinalize(&(transform->outBuf));
+    } else {
+        xmlSecBufferEmpty(&(transform->outBuf));
+    }
+    xmlSecTransformClearKeepBuffers(transform, id->objSize);
+
+    entry->id = id;
+    transform->next = entry->first;
+    entry->first = transform;
+    ++entry->size;
+    return(1);
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(transform);
+    UNREFERENCED_PARAMETER(id);
+    return(0);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecTransformPoolEnable:
+ * @maxObjects:         the max number of the transforms kept per klass
+ *                      (0 disables the pool).
+ * @maxBufferSize:      the max size of the binary data buffer kept
+ *                      with the transform.
+ *
+ * Enables the transforms pool on the current thread: the transforms
+ * destroyed on this thread are finalized and kept (together with their
+ * binary data buffers up to @maxBufferSize bytes) for reuse by the next
+ * #xmlSecTransformCreate call with the same klass instead of being freed.
+ * The transforms allocated from an arena are never pooled. The application
+ * must call #xmlSecTransformPoolCleanup before the thread exits (the pool
+ * of the thread that calls #xmlSecShutdown is freed automatically). If the
+ * compiler does not support thread local variables then the pool is
+ * never used.
+ */
+void
+xmlSecTransformPoolEnable(xmlSecSize maxObjects, xmlSecSize maxBufferSize) {
+#ifdef XMLSEC_THREAD_LOCAL
+    if(maxObjects == 0) {
+        xmlSecTransformPoolCleanup();
+    }
+    gTransformPool.maxObjects = maxObjects;
+    gTransformPool.maxBufferSize = maxBufferSize;
+#else  /* XMLSEC_THREAD_LOCAL */
+    UNREFERENCED_PARAMETER(maxObjects);
+    UNREFERENCED_PARAMETER(maxBufferSize);
+#endif /* XMLSEC_THREAD_LOCAL */
+}
+
+/**
+ * xmlSecTransformPoolCleanup:
+ *
+ * Frees all the transforms kept in the pool of the current thread
+ * (the pool stays enabled).
+ */
+void
+xmlSecTransformPoolCleanup(void) {
+#ifdef XMLSEC_THREAD_LOCAL
+    xmlSecTransformPoolEntry* entry;
+    xmlSecTransformPtr transform;
+    xmlSecSize ii;
+
+    for(ii = 0; ii < XMLSEC_TRANSFORM_POOL_KLASSES_SIZE; ++ii) {
+        entry = &(gTransformPool.entries[ii]);
+        while(entry->first != NULL) {
+            transform = entry->first;
+            entry->first = transform->next;
+
+            xmlSecBufferFinalize(&(transform->inBuf));
+            xmlSecBufferFinalize(&(transform->outBuf));
+            memset(transform, 0, entry->id->objSize);
+            xmlFree(transform);
+        }
+        entry->id = NULL;
+        entry->size = 0;
     }
-    fprintf(output, "</TransformCtx>\n");
+#endif /* XMLSEC_THREAD_LOCAL */
 }
 
 /**************************************************************************
@@ -1234,7 +2157,13 @@ xmlSecTransformCtxDebugXmlDump(xmlSecTransformCtxPtr ctx, FILE* output) {
  */
 xmlSecTransformPtr
 xmlSecTransformCreate(xmlSecTransformId id) {
-    xmlSecTransformPtr transform;
+    return(xmlSecTransformCreateInternal(id, NULL));
+}
+
+static xmlSecTransformPtr
+xmlSecTransformCreateInternal(xmlSecTransformId id, xmlSecArenaPtr arena) {
+    xmlSecTransformPtr transform = NULL;
+    int reused = 0;
     int ret;
 
     xmlSecAssert2(id != NULL, NULL);
@@ -1242,14 +2171,41 @@ xmlSecTransformCreate(xmlSecTransformId id) {
     xmlSecAssert2(id->objSize >= sizeof(xmlSecTransform), NULL);
     xmlSecAssert2(id->name != NULL, NULL);
 
-    /* Allocate a new xmlSecTransform and fill the fields. */
-    transform = (xmlSecTransformPtr)xmlMalloc(id->objSize);
-    if(transform == NULL) {
-        xmlSecMallocError(id->objSize, NULL);
-        return(NULL);
+    /* Allocate a new xmlSecTransform (or reuse the pooled one) and fill the fields. */
+    if(arena == NULL) {
+        transform = xmlSecTransformPoolAcquire(id);
+    }
+    if(transform != NULL) {
+        /* already cleared, the empty buffers are kept */
+        reused = 1;
+    } else if(arena != NULL) {
+        transform = (xmlSecTransformPtr)xmlSecArenaAlloc(arena, id->objSize);
+        if(transform == NULL) {
+            xmlSecInternalError("xmlSecArenaAlloc", NULL);
+            return(NULL);
+        }
+    } else {
+        transform = (xmlSecTransformPtr)xmlMalloc(id->objSize);
+        if(transform == NULL) {
+            xmlSecMallocError(id->objSize, NULL);
+            return(NULL);
+        }
+    }
+    if(reused == 0) {
+        memset(transform, 0, id->objSize);
     }
-    memset(transform, 0, id->objSize);
     transform->id = id;
+    transform->arena = arena;
+
+    if(xmlSecMemStatsUpdate(xmlSecMemStatsTagTransform, 0, id->objSize) < 0) {
+        xmlSecInternalError("xmlSecMemStatsUpdate",
+                            xmlSecTransformGetName(transform));
+        xmlSecMemStatsUpdate(xmlSecMemStatsTagTransform, id->objSize, 0);
+        if(arena == NULL) {
+            xmlFree(transform);
+        }
+        return(NULL);
+    }
 
     if(id->initialize != NULL) {
         ret = (id->initialize)(transform);
@@ -1261,22 +2217,28 @@ xmlSecTransformCreate(xmlSecTransformId id) {
         }
     }
 
-    ret = xmlSecBufferInitialize(&(transform->inBuf), 0);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecBufferInitialize",
-                            xmlSecTransformGetName(transform));
-        xmlSecTransformDestroy(transform);
-        return(NULL);
-    }
+    if(reused == 0) {
+        ret = xmlSecBufferInitialize(&(transform->inBuf), 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize",
+                                xmlSecTransformGetName(transform));
+            xmlSecTransformDestroy(transform);
+            return(NULL);
+        }
 
-    ret = xmlSecBufferInitialize(&(transform->outBuf), 0);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecBufferInitialize",
-                            xmlSecTransformGetName(transform));
-        xmlSecTransformDestroy(transform);
-        return(NULL);
+        ret = xmlSecBufferInitialize(&(transform->outBuf), 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize",
+                                xmlSecTransformGetName(transform));
+            xmlSecTransformDestroy(transform);
+            return(NULL);
+        }
     }
 
+    /* streaming buffers are still zeroed on release */
+    xmlSecBufferSetZeroMode(&(transform->inBuf), xmlSecBufferZeroModeOnFree);
+    xmlSecBufferSetZeroMode(&(transform->outBuf), xmlSecBufferZeroModeOnFree);
+
     return(transform);
 }
 
@@ -1288,15 +2250,15 @@ xmlSecTransformCreate(xmlSecTransformId id) {
  */
 void
 xmlSecTransformDestroy(xmlSecTransformPtr transform) {
+    xmlSecTransformId id;
+    xmlSecArenaPtr arena;
+
     xmlSecAssert(xmlSecTransformIsValid(transform));
     xmlSecAssert(transform->id->objSize > 0);
 
     /* first need to remove ourselves from chain */
     xmlSecTransformRemove(transform);
 
-    xmlSecBufferFinalize(&(transform->inBuf));
-    xmlSecBufferFinalize(&(transform->outBuf));
-
     /* we never destroy input nodes, output nodes
      * are destroyed if and only if they are different
      * from input nodes
@@ -1307,8 +2269,59 @@ xmlSecTransformDestroy(xmlSecTransformPtr transform) {
     if(transform->id->finalize != NULL) {
         (transform->id->finalize)(transform);
     }
-    memset(transform, 0, transform->id->objSize);
-    xmlFree(transform);
+    id = transform->id;
+    arena = transform->arena;
+    xmlSecMemStatsUpdate(xmlSecMemStatsTagTransform, id->objSize, 0);
+
+    /* keep the finalized transform for reuse if the pool is enabled */
+    if((arena == NULL) && (xmlSecTransformPoolRelease(transform, id) != 0)) {
+        return;
+    }
+
+    xmlSecBufferFinalize(&(transform->inBuf));
+    xmlSecBufferFinalize(&(transform->outBuf));
+    memset(transform, 0, id->objSize);
+
+    /* arena memory is released with the arena */
+    if(arena == NULL) {
+        xmlFree(transform);
+    }
+}
+
+/*
+ * The "Algorithm" attribute normally has a single text child: return its content
+ * directly instead of copying it. Otherwise (entities, DTD defaults, ...) fall back
+ * to xmlGetProp() and return the copy in @copy, the caller frees it with
+ * xmlSecTransformNodeFreeAlgorithm().
+ */
+static const xmlChar*
+xmlSecTransformNodeGetAlgorithm(xmlNodePtr node, xmlChar** copy) {
+    xmlAttrPtr attr;
+
+    xmlSecAssert2(node != NULL, NULL);
+    xmlSecAssert2(copy != NULL, NULL);
+    xmlSecAssert2((*copy) == NULL, NULL);
+
+    attr = xmlHasProp(node, xmlSecAttrAlgorithm);
+    if(attr == NULL) {
+        return(NULL);
+    }
+    if((attr->type == XML_ATTRIBUTE_NODE) && (attr->children != NULL) &&
+       (attr->children->type == XML_TEXT_NODE) && (attr->children->next == NULL) &&
+       (attr->children->content != NULL))
+    {
+        return(attr->children->content);
+    }
+
+    (*copy) = xmlGetProp(node, xmlSecAttrAlgorithm);
+    return(*copy);
+}
+
+static void
+xmlSecTransformNodeFreeAlgorithm(xmlChar* copy) {
+    if(copy != NULL) {
+        xmlFree(copy);
+    }
 }
 
 /**
@@ -1333,13 +2346,14 @@ xmlSecTransformPtr
 xmlSecTransformNodeRead(xmlNodePtr node, xmlSecTransformUsage usage, xmlSecTransformCtxPtr transformCtx) {
     xmlSecTransformPtr transform;
     xmlSecTransformId id;
-    xmlChar *href;
+    const xmlChar *href;
+    xmlChar *hrefCopy = NULL;
     int ret;
 
     xmlSecAssert2(node != NULL, NULL);
     xmlSecAssert2(transformCtx != NULL, NULL);
 
-    href = xmlGetProp(node, xmlSecAttrAlgorithm);
+    href = xmlSecTransformNodeGetAlgorithm(node, &hrefCopy);
     if(href == NULL) {
         xmlSecInvalidNodeAttributeError(node, xmlSecAttrAlgorithm,
                                         NULL, "empty");
@@ -1350,7 +2364,7 @@ xmlSecTransformNodeRead(xmlNodePtr node, xmlSecTransformUsage usage, xmlSecTrans
     if(id == xmlSecTransformIdUnknown) {
         xmlSecInternalError2("xmlSecTransformIdListFindByHref", NULL,
                              "href=%s", xmlSecErrorsSafeString(href));
-        xmlFree(href);
+        xmlSecTransformNodeFreeAlgorithm(hrefCopy);
         return(NULL);
     }
 
@@ -1360,15 +2374,15 @@ xmlSecTransformNodeRead(xmlNodePtr node, xmlSecTransformUsage usage, xmlSecTrans
         xmlSecOtherError2(XMLSEC_ERRORS_R_TRANSFORM_DISABLED,
                           xmlSecTransformKlassGetName(id),
                           "href=%s", xmlSecErrorsSafeString(href));
-        xmlFree(href);
+        xmlSecTransformNodeFreeAlgorithm(hrefCopy);
         return(NULL);
     }
 
-    transform = xmlSecTransformCreate(id);
+    transform = xmlSecTransformCreateInternal(id, transformCtx->arena);
     if(!xmlSecTransformIsValid(transform)) {
-        xmlSecInternalError("xmlSecTransformCreate(id)",
+        xmlSecInternalError("xmlSecTransformCreateInternal(id)",
                             xmlSecTransformKlassGetName(id));
-        xmlFree(href);
+        xmlSecTransformNodeFreeAlgorithm(hrefCopy);
         return(NULL);
     }
 
@@ -1378,14 +2392,14 @@ xmlSecTransformNodeRead(xmlNodePtr node, xmlSecTransformUsage usage, xmlSecTrans
             xmlSecInternalError("readNode",
                                 xmlSecTransformGetName(transform));
             xmlSecTransformDestroy(transform);
-            xmlFree(href);
+            xmlSecTransformNodeFreeAlgorithm(hrefCopy);
             return(NULL);
         }
     }
 
     /* finally remember the transform node */
     transform->hereNode = node;
-    xmlFree(href);
+    xmlSecTransformNodeFreeAlgorithm(hrefCopy);
     return(transform);
 }
 
@@ -1402,6 +2416,16 @@ xmlSecTransformNodeRead(xmlNodePtr node, xmlSecTransformUsage usage, xmlSecTrans
  */
 int
 xmlSecTransformPump(xmlSecTransformPtr left, xmlSecTransformPtr right, xmlSecTransformCtxPtr transformCtx) {
+    int ret;
+
+    XMLSEC_PROBE2(transform__pump__start, left, right);
+    ret = xmlSecTransformPumpInternal(left, right, transformCtx);
+    XMLSEC_PROBE2(transform__pump__done, left, ret);
+    return(ret);
+}
+
+static int
+xmlSecTransformPumpInternal(xmlSecTransformPtr left, xmlSecTransformPtr right, xmlSecTransformCtxPtr transformCtx) {
     xmlSecTransformDataType leftType;
     xmlSecTransformDataType rightType;
     int ret;
@@ -1435,32 +2459,35 @@ xmlSecTransformPump(xmlSecTransformPtr left, xmlSecTransformPtr right, xmlSecTra
     }  else if(((leftType & xmlSecTransformDataTypeBin) != 0) &&
                ((rightType & xmlSecTransformDataTypeBin) != 0)) {
         xmlSecByte* buf;
+        xmlSecSize bufMaxSize = 0;
         int final = 0;
 
-        buf = xmlMalloc(transformCtx->binaryChunkSize);
+        /* the buffer is owned by transformCtx and re-used between calls */
+        buf = xmlSecTransformCtxGetPumpBuffer(transformCtx, &bufMaxSize);
         if(buf == NULL) {
-            xmlSecMallocError(transformCtx->binaryChunkSize, NULL);
+            xmlSecInternalError("xmlSecTransformCtxGetPumpBuffer", xmlSecTransformGetName(left));
             return(-1);
         }
 
         do {
             xmlSecSize bufSize = 0;
-            ret = xmlSecTransformPopBin(left, buf, transformCtx->binaryChunkSize, &bufSize, transformCtx);
+
+            if(XMLSEC_TRANSFORM_CTX_CHECK_DEADLINE(transformCtx) < 0) {
+                xmlSecInternalError("xmlSecTransformCtxCheckDeadline", xmlSecTransformGetName(left));
+                return(-1);
+            }
+            ret = xmlSecTransformPopBin(left, buf, bufMaxSize, &bufSize, transformCtx);
             if(ret < 0) {
                 xmlSecInternalError("xmlSecTransformPopBin", xmlSecTransformGetName(left));
-                xmlFree(buf);
                 return(-1);
             }
             final = (bufSize == 0) ? 1 : 0;
             ret = xmlSecTransformPushBin(right, buf, bufSize, final, transformCtx);
             if(ret < 0) {
                 xmlSecInternalError("xmlSecTransformPushBin", xmlSecTransformGetName(right));
-                xmlFree(buf);
                 return(-1);
             }
         } while(final == 0);
-
-        xmlFree(buf);
     } else {
         xmlSecInvalidTransfromError2(left,
                     "transforms input/output data formats do not match, right transform=\"%s\"",
@@ -1607,6 +2634,148 @@ xmlSecTransformGetDataType(xmlSecTransformPtr transform, xmlSecTransformMode mod
     return((transform->id->getDataType)(transform, mode, transformCtx));
 }
 
+/**************************************************************************
+ *
+ * Transform statistics: each push/pop/execute call records the time spent
+ * in it minus the time spent in the nested calls for the other transforms
+ * (e.g. the default pushBin method executes the transform and then pushes
+ * the result to the next transform).
+ *
+ *************************************************************************/
+typedef struct _xmlSecTransformStatsFrame {
+    double      wallTime;
+    double      cpuTime;
+    double      childWallTime;
+    double      childCpuTime;
+} xmlSecTransformStatsFrame;
+
+static double
+xmlSecTransformStatsGetWallTime(void) {
+#if defined(XMLSEC_WINDOWS)
+    LARGE_INTEGER counter, freq;
+
+    if(!QueryPerformanceFrequency(&freq) || !QueryPerformanceCounter(&counter) || (freq.QuadPart <= 0)) {
+        return((double)time(NULL));
+    }
+    return((double)counter.QuadPart / (double)freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return((double)time(NULL));
+    }
+    return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+#else  /* defined(XMLSEC_WINDOWS) */
+    return((double)time(NULL));
+#endif /* defined(XMLSEC_WINDOWS) */
+}
+
+static double
+xmlSecTransformStatsGetCpuTime(void) {
+    return((double)clock() / (double)CLOCKS_PER_SEC);
+}
+
+static void
+xmlSecTransformStatsStart(xmlSecTransformCtxPtr transformCtx, xmlSecTransformStatsFrame* frame) {
+    xmlSecAssert(transformCtx != NULL);
+    xmlSecAssert(frame != NULL);
+
+    frame->childWallTime = transformCtx->statsChildWallTime;
+    frame->childCpuTime = transformCtx->statsChildCpuTime;
+    transformCtx->statsChildWallTime = 0;
+    transformCtx->statsChildCpuTime = 0;
+
+    frame->wallTime = xmlSecTransformStatsGetWallTime();
+    frame->cpuTime = xmlSecTransformStatsGetCpuTime();
+}
+
+static void
+xmlSecTransformStatsStop(xmlSecTransformCtxPtr transformCtx, xmlSecTransformStatsFrame* frame,
+                         xmlSecTransformPtr transform, xmlSecTransformOpStatsPtr opStats) {
+    double wallTime, cpuTime;
+    xmlSecSize outBufSize;
+
+    xmlSecAssert(transformCtx != NULL);
+    xmlSecAssert(frame != NULL);
+    xmlSecAssert(transform != NULL);
+    xmlSecAssert(opStats != NULL);
+
+    wallTime = xmlSecTransformStatsGetWallTime() - frame->wallTime;
+    cpuTime = xmlSecTransformStatsGetCpuTime() - frame->cpuTime;
+
+    ++opStats->calls;
+    if(wallTime > transformCtx->statsChildWallTime) {
+        opStats->wallTime += wallTime - transformCtx->statsChildWallTime;
+    }
+    if(cpuTime > transformCtx->statsChildCpuTime) {
+        opStats->cpuTime += cpuTime - transformCtx->statsChildCpuTime;
+    }
+
+    /* the caller (if any) shouldn't count this time as its own */
+    transformCtx->statsChildWallTime = frame->childWallTime + wallTime;
+    transformCtx->statsChildCpuTime = frame->childCpuTime + cpuTime;
+
+    /* e.g. the transforms that buffer the whole output (C14N in the pop mode) */
+    outBufSize = xmlSecBufferGetMaxSize(&(transform->outBuf));
+    if(outBufSize > transform->stats.outBufMaxSize) {
+        transform->stats.outBufMaxSize = outBufSize;
+    }
+}
+
+static void
+xmlSecTransformOpStatsDebugDump(const char* name, xmlSecTransformOpStatsPtr opStats, FILE* output) {
+    xmlSecAssert(name != NULL);
+    xmlSecAssert(opStats != NULL);
+    xmlSecAssert(output != NULL);
+
+    if(opStats->calls > 0) {
+        fprintf(output, "==== %s: calls=" XMLSEC_SIZE_FMT " wall=%.6fs cpu=%.6fs\n",
+            name, opStats->calls, opStats->wallTime, opStats->cpuTime);
+    }
+}
+
+static void
+xmlSecTransformStatsDebugDump(xmlSecTransformStatsPtr stats, FILE* output) {
+    xmlSecAssert(stats != NULL);
+    xmlSecAssert(output != NULL);
+
+    fprintf(output, "==== bytes in: " XMLSEC_SIZE_FMT "\n", stats->bytesIn);
+    fprintf(output, "==== bytes out: " XMLSEC_SIZE_FMT "\n", stats->bytesOut);
+    fprintf(output, "==== out buffer max size: " XMLSEC_SIZE_FMT "\n", stats->outBufMaxSize);
+    xmlSecTransformOpStatsDebugDump("pushBin", &(stats->pushBin), output);
+    xmlSecTransformOpStatsDebugDump("popBin", &(stats->popBin), output);
+    xmlSecTransformOpStatsDebugDump("pushXml", &(stats->pushXml), output);
+    xmlSecTransformOpStatsDebugDump("popXml", &(stats->popXml), output);
+    xmlSecTransformOpStatsDebugDump("execute", &(stats->execute), output);
+}
+
+static void
+xmlSecTransformOpStatsDebugXmlDump(const char* name, xmlSecTransformOpStatsPtr opStats, FILE* output) {
+    xmlSecAssert(name != NULL);
+    xmlSecAssert(opStats != NULL);
+    xmlSecAssert(output != NULL);
+
+    if(opStats->calls > 0) {
+        fprintf(output, "<Op name=\"%s\" calls=\"" XMLSEC_SIZE_FMT "\" wallTime=\"%.6f\" cpuTime=\"%.6f\" />\n",
+            name, opStats->calls, opStats->wallTime, opStats->cpuTime);
+    }
+}
+
+static void
+xmlSecTransformStatsDebugXmlDump(xmlSecTransformStatsPtr stats, FILE* output) {
+    xmlSecAssert(stats != NULL);
+    xmlSecAssert(output != NULL);
+
+    fprintf(output, "<TransformStats bytesIn=\"" XMLSEC_SIZE_FMT "\" bytesOut=\"" XMLSEC_SIZE_FMT "\" outBufMaxSize=\"" XMLSEC_SIZE_FMT "\">\n",
+        stats->bytesIn, stats->bytesOut, stats->outBufMaxSize);
+    xmlSecTransformOpStatsDebugXmlDump("pushBin", &(stats->pushBin), output);
+    xmlSecTransformOpStatsDebugXmlDump("popBin", &(stats->popBin), output);
+    xmlSecTransformOpStatsDebugXmlDump("pushXml", &(stats->pushXml), output);
+    xmlSecTransformOpStatsDebugXmlDump("popXml", &(stats->popXml), output);
+    xmlSecTransformOpStatsDebugXmlDump("execute", &(stats->execute), output);
+    fprintf(output, "</TransformStats>\n");
+}
+
 /**
  * xmlSecTransformPushBin:
  * @transform:          the pointer to transform object.
@@ -1623,11 +2792,67 @@ xmlSecTransformGetDataType(xmlSecTransformPtr transform, xmlSecTransformMode mod
 int
 xmlSecTransformPushBin(xmlSecTransformPtr transform, const xmlSecByte* data,
                     xmlSecSize dataSize, int final, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecTransformStatsFrame frame;
+    int ret;
+
     xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
     xmlSecAssert2(transform->id->pushBin != NULL, -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
-    return((transform->id->pushBin)(transform, data, dataSize, final, transformCtx));
+    if((transformCtx->flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) == 0) {
+        return((transform->id->pushBin)(transform, data, dataSize, final, transformCtx));
+    }
+
+    xmlSecTransformStatsStart(transformCtx, &frame);
+    ret = (transform->id->pushBin)(transform, data, dataSize, final, transformCtx);
+    xmlSecTransformStatsStop(transformCtx, &frame, transform, &(transform->stats.pushBin));
+    return(ret);
+}
+
+/**
+ * xmlSecTransformPushBinV:
+ * @transform:          the pointer to transform object.
+ * @segments:           the input binary data segments.
+ * @segmentsSize:       the number of segments in @segments.
+ * @final:              the flag: if set to 1 then the last segment is the
+ *                      last data chunk.
+ * @transformCtx:       the pointer to transform context object.
+ *
+ * Process binary data stored in several non-contiguous @segments and pushes
+ * results to next transform. Each segment is pushed to @transform as is
+ * (i.e. the segments are never coalesced into one buffer): the transforms
+ * that only read the input (digests) consume the segments in place and
+ * the other transforms append them to their input buffer one by one.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecTransformPushBinV(xmlSecTransformPtr transform, const xmlSecTransformBinSegment* segments,
+                    xmlSecSize segmentsSize, int final, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
+    xmlSecAssert2((segments != NULL) || (segmentsSize == 0), -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    if(segmentsSize == 0) {
+        return(xmlSecTransformPushBin(transform, NULL, 0, final, transformCtx));
+    }
+    for(ii = 0; ii < segmentsSize; ++ii) {
+        /* skip empty segments except the last one that might carry the final flag */
+        if((segments[ii].size == 0) && ((ii + 1) < segmentsSize)) {
+            continue;
+        }
+        ret = xmlSecTransformPushBin(transform, segments[ii].data, segments[ii].size,
+            (((ii + 1) == segmentsSize) ? final : 0), transformCtx);
+        if(ret < 0) {
+            xmlSecInternalError3("xmlSecTransformPushBin", xmlSecTransformGetName(transform),
+                "segment=" XMLSEC_SIZE_FMT "; size=" XMLSEC_SIZE_FMT, ii, segments[ii].size);
+            return(-1);
+        }
+    }
+    return(0);
 }
 
 /**
@@ -1647,13 +2872,23 @@ xmlSecTransformPushBin(xmlSecTransformPtr transform, const xmlSecByte* data,
 int
 xmlSecTransformPopBin(xmlSecTransformPtr transform, xmlSecByte* data,
                     xmlSecSize maxDataSize, xmlSecSize* dataSize, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecTransformStatsFrame frame;
+    int ret;
+
     xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
     xmlSecAssert2(transform->id->popBin != NULL, -1);
     xmlSecAssert2(data != NULL, -1);
     xmlSecAssert2(dataSize != NULL, -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
-    return((transform->id->popBin)(transform, data, maxDataSize, dataSize, transformCtx));
+    if((transformCtx->flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) == 0) {
+        return((transform->id->popBin)(transform, data, maxDataSize, dataSize, transformCtx));
+    }
+
+    xmlSecTransformStatsStart(transformCtx, &frame);
+    ret = (transform->id->popBin)(transform, data, maxDataSize, dataSize, transformCtx);
+    xmlSecTransformStatsStop(transformCtx, &frame, transform, &(transform->stats.popBin));
+    return(ret);
 }
 
 /**
@@ -1669,11 +2904,21 @@ xmlSecTransformPopBin(xmlSecTransformPtr transform, xmlSecByte* data,
 int
 xmlSecTransformPushXml(xmlSecTransformPtr transform, xmlSecNodeSetPtr nodes,
                     xmlSecTransformCtxPtr transformCtx) {
+    xmlSecTransformStatsFrame frame;
+    int ret;
+
     xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
     xmlSecAssert2(transform->id->pushXml != NULL, -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
-    return((transform->id->pushXml)(transform, nodes, transformCtx));
+    if((transformCtx->flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) == 0) {
+        return((transform->id->pushXml)(transform, nodes, transformCtx));
+    }
+
+    xmlSecTransformStatsStart(transformCtx, &frame);
+    ret = (transform->id->pushXml)(transform, nodes, transformCtx);
+    xmlSecTransformStatsStop(transformCtx, &frame, transform, &(transform->stats.pushXml));
+    return(ret);
 }
 
 /**
@@ -1690,11 +2935,21 @@ xmlSecTransformPushXml(xmlSecTransformPtr transform, xmlSecNodeSetPtr nodes,
 int
 xmlSecTransformPopXml(xmlSecTransformPtr transform, xmlSecNodeSetPtr* nodes,
                     xmlSecTransformCtxPtr transformCtx) {
+    xmlSecTransformStatsFrame frame;
+    int ret;
+
     xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
     xmlSecAssert2(transform->id->popXml != NULL, -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
-    return((transform->id->popXml)(transform, nodes, transformCtx));
+    if((transformCtx->flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) == 0) {
+        return((transform->id->popXml)(transform, nodes, transformCtx));
+    }
+
+    xmlSecTransformStatsStart(transformCtx, &frame);
+    ret = (transform->id->popXml)(transform, nodes, transformCtx);
+    xmlSecTransformStatsStop(transformCtx, &frame, transform, &(transform->stats.popXml));
+    return(ret);
 }
 
 /**
@@ -1709,11 +2964,50 @@ xmlSecTransformPopXml(xmlSecTransformPtr transform, xmlSecNodeSetPtr* nodes,
  */
 int
 xmlSecTransformExecute(xmlSecTransformPtr transform, int last, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecTransformStatsFrame frame;
+    xmlSecSize inSize, outSize;
+    xmlSecSize bytesIn = 0, bytesOut = 0;
+    int collectStats;
+    int ret;
+
     xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
     xmlSecAssert2(transform->id->execute != NULL, -1);
     xmlSecAssert2(transformCtx != NULL, -1);
 
-    return((transform->id->execute)(transform, last, transformCtx));
+    if(XMLSEC_TRANSFORM_CTX_CHECK_DEADLINE(transformCtx) < 0) {
+        xmlSecInternalError("xmlSecTransformCtxCheckDeadline", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+
+    collectStats = ((transformCtx->flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) != 0) ? 1 : 0;
+    if((collectStats == 0) && (xmlSecStatsIsEnabled() == 0)) {
+        return((transform->id->execute)(transform, last, transformCtx));
+    }
+
+    inSize = xmlSecBufferGetSize(&(transform->inBuf));
+    outSize = xmlSecBufferGetSize(&(transform->outBuf));
+
+    if(collectStats != 0) {
+        xmlSecTransformStatsStart(transformCtx, &frame);
+        ret = (transform->id->execute)(transform, last, transformCtx);
+        xmlSecTransformStatsStop(transformCtx, &frame, transform, &(transform->stats.execute));
+    } else {
+        ret = (transform->id->execute)(transform, last, transformCtx);
+    }
+
+    /* execute consumes the input buffer and appends results to the output buffer */
+    if(xmlSecBufferGetSize(&(transform->inBuf)) < inSize) {
+        bytesIn = inSize - xmlSecBufferGetSize(&(transform->inBuf));
+    }
+    if(xmlSecBufferGetSize(&(transform->outBuf)) > outSize) {
+        bytesOut = xmlSecBufferGetSize(&(transform->outBuf)) - outSize;
+    }
+    if(collectStats != 0) {
+        transform->stats.bytesIn += bytesIn;
+        transform->stats.bytesOut += bytesOut;
+    }
+    xmlSecStatsTransformBytes(transform->id, bytesIn, bytesOut);
+    return(ret);
 }
 
 /**
@@ -1915,6 +3209,48 @@ xmlSecTransformDefaultGetDataType(xmlSecTransformPtr transform, xmlSecTransformM
     return(type);
 }
 
+/* executes @transform on the borrowed @data without copying it to the @transform->inBuf */
+static int
+xmlSecTransformExecuteBorrowed(xmlSecTransformPtr transform, const xmlSecByte* data,
+                        xmlSecSize dataSize, int final, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecBuffer view;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformIsValid(transform), -1);
+    xmlSecAssert2(xmlSecBufferGetSize(&(transform->inBuf)) == 0, -1);
+    xmlSecAssert2(data != NULL, -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    /* the view is never resized or finalized: the transform only reads
+     * and removes the data (see #xmlSecTransform.borrowInput) */
+    memset(&view, 0, sizeof(view));
+    view.data = (xmlSecByte*)data; /* read only, cast from const is ok */
+    view.size = dataSize;
+    view.maxSize = dataSize;
+    view.allocMode = xmlSecAllocModeExact;
+    view.zeroMode = xmlSecBufferZeroModeNever;
+
+    xmlSecBufferSwap(&(transform->inBuf), &view);
+    ret = xmlSecTransformExecute(transform, final, transformCtx);
+    xmlSecBufferSwap(&(transform->inBuf), &view);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecTransformExecute", xmlSecTransformGetName(transform),
+            "final=%d", final);
+        return(-1);
+    }
+
+    /* just in case: keep the data that was not consumed */
+    if(xmlSecBufferGetSize(&view) > 0) {
+        ret = xmlSecBufferAppend(&(transform->inBuf), xmlSecBufferGetData(&view), xmlSecBufferGetSize(&view));
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferAppend", xmlSecTransformGetName(transform),
+                "size=" XMLSEC_SIZE_FMT, xmlSecBufferGetSize(&view));
+            return(-1);
+        }
+    }
+    return(0);
+}
+
 /**
  * xmlSecTransformDefaultPushBin:
  * @transform:          the pointer to transform object.
@@ -1925,7 +3261,9 @@ xmlSecTransformDefaultGetDataType(xmlSecTransformPtr transform, xmlSecTransformM
  * @transformCtx:       the pointer to transform context object.
  *
  * Process binary @data by calling transform's execute method and pushes
- * results to next transform.
+ * results to next transform. If the next transform uses this method too
+ * and its input buffer is empty then the output buffer is handed over to
+ * it instead of being copied.
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
@@ -1941,37 +3279,50 @@ xmlSecTransformDefaultPushBin(xmlSecTransformPtr transform, const xmlSecByte* da
     xmlSecAssert2(transformCtx != NULL, -1);
 
     do {
-        /* append data to input buffer */
-        if(dataSize > 0) {
-            xmlSecSize chunkSize;
+        xmlSecSize chunkSize = 0;
 
+        if(dataSize > 0) {
             xmlSecAssert2(data != NULL, -1);
 
             chunkSize = dataSize;
             if(chunkSize > transformCtx->binaryChunkSize) {
                 chunkSize = transformCtx->binaryChunkSize;
             }
+        }
+        finalData = (((dataSize == chunkSize) && (final != 0)) ? 1 : 0);
 
-            ret = xmlSecBufferAppend(&(transform->inBuf), data, chunkSize);
+        if((chunkSize > 0) && (transform->borrowInput != 0) && (xmlSecBufferGetSize(&(transform->inBuf)) == 0)) {
+            /* process data in place */
+            ret = xmlSecTransformExecuteBorrowed(transform, data, chunkSize, finalData, transformCtx);
             if(ret < 0) {
-                xmlSecInternalError2("xmlSecBufferAppend", xmlSecTransformGetName(transform),
-                    "size=" XMLSEC_SIZE_FMT, chunkSize);
+                xmlSecInternalError2("xmlSecTransformExecuteBorrowed", xmlSecTransformGetName(transform),
+                    "final=%d", final);
                 return(-1);
             }
+        } else {
+            /* append data to input buffer */
+            if(chunkSize > 0) {
+                ret = xmlSecBufferAppend(&(transform->inBuf), data, chunkSize);
+                if(ret < 0) {
+                    xmlSecInternalError2("xmlSecBufferAppend", xmlSecTransformGetName(transform),
+                        "size=" XMLSEC_SIZE_FMT, chunkSize);
+                    return(-1);
+                }
+            }
 
+            /* process data */
+            ret = xmlSecTransformExecute(transform, finalData, transformCtx);
+            if(ret < 0) {
+                xmlSecInternalError2("xmlSecTransformExecute", xmlSecTransformGetName(transform),
+                    "final=%d", final);
+                return(-1);
+            }
+        }
+        if(chunkSize > 0) {
             dataSize -= chunkSize;
             data += chunkSize;
         }
 
-        /* process data */
-        finalData = (((dataSize == 0) && (final != 0)) ? 1 : 0);
-        ret = xmlSecTransformExecute(transform, finalData, transformCtx);
-        if(ret < 0) {
-            xmlSecInternalError2("xmlSecTransformExecute", xmlSecTransformGetName(transform),
-                "final=%d", final);
-            return(-1);
-        }
-
         /* push data to the next transform */
         inSize = xmlSecBufferGetSize(&(transform->inBuf));
         outSize = xmlSecBufferGetSize(&(transform->outBuf));
@@ -1979,22 +3330,45 @@ xmlSecTransformDefaultPushBin(xmlSecTransformPtr transform, const xmlSecByte* da
             finalData = 0;
         }
 
-        /* we don't want to push too much */
-        if(outSize > transformCtx->binaryChunkSize) {
-            outSize = transformCtx->binaryChunkSize;
-            finalData = 0;
-        }
-        if((transform->next != NULL) && ((outSize > 0) || (finalData != 0))) {
-            ret = xmlSecTransformPushBin(transform->next,
-                            xmlSecBufferGetData(&(transform->outBuf)),
-                            outSize,
-                            finalData,
-                            transformCtx);
+        if((transform->next != NULL) && (outSize > 0) &&
+           (outSize <= transformCtx->binaryChunkSize) &&
+           (transform->next->id->pushBin == xmlSecTransformDefaultPushBin) &&
+           (xmlSecBufferGetSize(&(transform->next->inBuf)) == 0)
+        ) {
+            /* hand over the whole output buffer to the next transform: it
+             * becomes the next transform input buffer without copying and
+             * the next transform's empty input buffer becomes our output */
+            xmlSecBufferSwap(&(transform->outBuf), &(transform->next->inBuf));
+            ret = xmlSecTransformPushBin(transform->next, NULL, 0, finalData, transformCtx);
             if(ret < 0) {
                 xmlSecInternalError3("xmlSecTransformPushBin", xmlSecTransformGetName(transform->next),
                     "final=%d;outSize=" XMLSEC_SIZE_FMT, final, outSize);
                 return(-1);
             }
+            continue;
+        }
+        if((transform->next != NULL) && ((outSize > 0) || (finalData != 0))) {
+            xmlSecSize pushedSize = 0;
+
+            /* we don't want to push too much at once: the large output (e.g. from
+             * the parallel decryption) is pushed in chunks but removed only once */
+            do {
+                xmlSecSize pushSize = outSize - pushedSize;
+                if(pushSize > transformCtx->binaryChunkSize) {
+                    pushSize = transformCtx->binaryChunkSize;
+                }
+                ret = xmlSecTransformPushBin(transform->next,
+                                xmlSecBufferGetData(&(transform->outBuf)) + pushedSize,
+                                pushSize,
+                                (pushedSize + pushSize == outSize) ? finalData : 0,
+                                transformCtx);
+                if(ret < 0) {
+                    xmlSecInternalError3("xmlSecTransformPushBin", xmlSecTransformGetName(transform->next),
+                        "final=%d;outSize=" XMLSEC_SIZE_FMT, final, pushSize);
+                    return(-1);
+                }
+                pushedSize += pushSize;
+            } while(pushedSize < outSize);
         }
 
         /* remove data anyway */
@@ -2276,6 +3650,20 @@ xmlSecTransformIdListFindByHref(xmlSecPtrListPtr list, const xmlChar* href,
     xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecTransformIdListId), xmlSecTransformIdUnknown);
     xmlSecAssert2(href != NULL, xmlSecTransformIdUnknown);
 
+    if((list == xmlSecTransformIdsGet()) && xmlSecPtrListIndexIsValid(&xmlSecAllTransformIdsByHref, list)) {
+        for(i = xmlSecPtrListIndexFirst(&xmlSecAllTransformIdsByHref, href); i > 0;
+            i = xmlSecPtrListIndexNext(&xmlSecAllTransformIdsByHref, i))
+        {
+            transformId = (xmlSecTransformId)xmlSecPtrListGetItem(list, i - 1);
+            xmlSecAssert2(transformId != xmlSecTransformIdUnknown, xmlSecTransformIdUnknown);
+
+            if(((usage & transformId->usage) != 0) && xmlStrEqual(href, transformId->href)) {
+               return(transformId);
+            }
+        }
+        return(xmlSecTransformIdUnknown);
+    }
+
     size = xmlSecPtrListGetSize(list);
     for(i = 0; i < size; ++i) {
         transformId = (xmlSecTransformId)xmlSecPtrListGetItem(list, i);
@@ -2308,6 +3696,20 @@ xmlSecTransformIdListFindByName(xmlSecPtrListPtr list, const xmlChar* name,
     xmlSecAssert2(xmlSecPtrListCheckId(list, xmlSecTransformIdListId), xmlSecTransformIdUnknown);
     xmlSecAssert2(name != NULL, xmlSecTransformIdUnknown);
 
+    if((list == xmlSecTransformIdsGet()) && xmlSecPtrListIndexIsValid(&xmlSecAllTransformIdsByName, list)) {
+        for(i = xmlSecPtrListIndexFirst(&xmlSecAllTransformIdsByName, name); i > 0;
+            i = xmlSecPtrListIndexNext(&xmlSecAllTransformIdsByName, i))
+        {
+            transformId = (xmlSecTransformId)xmlSecPtrListGetItem(list, i - 1);
+            xmlSecAssert2(transformId != xmlSecTransformIdUnknown, xmlSecTransformIdUnknown);
+
+            if(((usage & transformId->usage) != 0) && xmlStrEqual(name, BAD_CAST transformId->name)) {
+               return(transformId);
+            }
+        }
+        return(xmlSecTransformIdUnknown);
+    }
+
     size = xmlSecPtrListGetSize(list);
     for(i = 0; i < size; ++i) {
         transformId = (xmlSecTransformId)xmlSecPtrListGetItem(list, i);
@@ -2865,6 +4267,31 @@ xmlSecTransformConcatKdfParamsGetFixedInfo(xmlSecTransformConcatKdfParamsPtr par
     return(0);
 }
 
+/* the derived keys cache id: DigestMethod and FixedInfo */
+int
+xmlSecTransformConcatKdfParamsGetCacheId(xmlSecTransformConcatKdfParamsPtr params, xmlSecBufferPtr id) {
+    int ret;
+
+    xmlSecAssert2(params != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+
+    ret = xmlSecTransformConcatKdfParamsGetFixedInfo(params, id);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformConcatKdfParamsGetFixedInfo", NULL);
+        return(-1);
+    }
+    if(params->digestMethod != NULL) {
+        ret = xmlSecBufferPrepend(id, params->digestMethod, xmlSecStrlen(params->digestMethod) + 1);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferPrepend(digestMethod)", NULL);
+            return(-1);
+        }
+    }
+
+    /* done */
+    return(0);
+}
+
 #endif /* XMLSEC_NO_CONCATKDF */
 
 /**************************** Common Key Agreement Params ********************************/
@@ -2950,7 +4377,28 @@ xmlSecTransformKeyAgreementReadKey(xmlSecKeyDataType keyType, xmlNodePtr node,
     }
     keyInfoCtx.keyReq.keyType = keyType;
 
-    key = (keysMngr->getKey)(node, &keyInfoCtx);
+    /* originator can use a one-time key from the pool */
+    if((keyType == xmlSecKeyDataTypePrivate) && (keysMngr->priv->ephemeralKeys != NULL) &&
+       (transformCtx->parentKeyInfoCtx->operation == xmlSecTransformOperationEncrypt)
+    ) {
+        xmlNodePtr keyNameNode;
+        xmlChar* keyName;
+
+        keyNameNode = xmlSecFindChild(node, xmlSecNodeKeyName, xmlSecDSigNs);
+        if(keyNameNode != NULL) {
+            keyName = xmlSecGetNodeContentAndTrim(keyNameNode);
+            if(keyName != NULL) {
+                /* the AgreementMethod node is read again to write it: use the same key */
+                key = xmlSecKeysMngrPopEphemeralKey(keysMngr, node, keyName, &(keyInfoCtx.keyReq),
+                    (transformCtx->parentKeyInfoCtx->mode == xmlSecKeyInfoModeWrite) ? 1 : 0);
+                xmlFree(keyName);
+            }
+        }
+    }
+
+    if(key == NULL) {
+        key = (keysMngr->getKey)(node, &keyInfoCtx);
+    }
     if(key == NULL) {
         xmlSecOtherError(XMLSEC_ERRORS_R_KEY_NOT_FOUND, xmlSecNodeGetName(node), "key not found");
         goto done;
@@ -3515,9 +4963,678 @@ xmlSecTransformPbkdf2ParamsRead(xmlSecTransformPbkdf2ParamsPtr params, xmlNodePt
     return(0);
 }
 
+/* the derived keys cache id: PRF, IterationCount, KeyLength and Salt */
+int
+xmlSecTransformPbkdf2ParamsGetCacheId(xmlSecTransformPbkdf2ParamsPtr params, xmlSecBufferPtr id) {
+    int ret;
+
+    xmlSecAssert2(params != NULL, -1);
+    xmlSecAssert2(id != NULL, -1);
+
+    xmlSecBufferEmpty(id);
+    if(params->prfAlgorithmHref != NULL) {
+        ret = xmlSecBufferAppend(id, params->prfAlgorithmHref, xmlSecStrlen(params->prfAlgorithmHref) + 1);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend(prfAlgorithmHref)", NULL);
+            return(-1);
+        }
+    }
+    ret = xmlSecBufferAppend(id, (const xmlSecByte*)&(params->iterationCount), sizeof(params->iterationCount));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend(iterationCount)", NULL);
+        return(-1);
+    }
+    ret = xmlSecBufferAppend(id, (const xmlSecByte*)&(params->keyLength), sizeof(params->keyLength));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend(keyLength)", NULL);
+        return(-1);
+    }
+    ret = xmlSecBufferAppend(id, xmlSecBufferGetData(&(params->salt)), xmlSecBufferGetSize(&(params->salt)));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend(salt)", NULL);
+        return(-1);
+    }
+
+    /* done */
+    return(0);
+}
+
 #endif /* XMLSEC_NO_CONCATKDF */
 
 
+/**************************** Derived keys cache ********************************
+ *
+ * The derived keys cache (disabled by default): PBKDF2 is slow by design
+ * and the applications that decrypt many messages with the same password
+ * and KDF parameters pay for it on each message. The entries are identified
+ * by the KDF algorithm, the output size, the KDF parameters (see
+ * xmlSecTransformPbkdf2ParamsGetCacheId() and xmlSecTransformConcatKdfParamsGetCacheId())
+ * and the master key. The crypto independent code can't hash the master key,
+ * thus the entries keep a copy of it. The entries are zeroed when replaced
+ * (in the insertion order) or when the cache is disabled.
+ *
+ * The key agreement secrets cache (disabled by default) uses the same entries
+ * for the ECDH / DH shared secrets identified by the key agreement algorithm
+ * and the originator and recipient public keys (provided by the crypto backend).
+ *
+ *********************************************************************************/
+typedef struct _xmlSecTransformKdfCacheEntry    xmlSecTransformKdfCacheEntry,
+                                                *xmlSecTransformKdfCacheEntryPtr;
+struct _xmlSecTransformKdfCacheEntry {
+    unsigned int                        hash;
+    xmlSecByte*                         id;
+    xmlSecSize                          idSize;
+    xmlSecByte*                         data;
+    xmlSecSize                          dataSize;
+};
+
+typedef struct _xmlSecTransformKdfCache         xmlSecTransformKdfCache,
+                                                *xmlSecTransformKdfCachePtr;
+struct _xmlSecTransformKdfCache {
+    xmlMutexPtr                         mutex;
+    xmlSecTransformKdfCacheEntryPtr     entries;
+    xmlSecSize                          maxSize;
+    xmlSecSize                          pos;
+    xmlSecStatsCache                    statsCache;
+};
+
+static xmlSecTransformKdfCache          gXmlSecTransformKdfCache = {
+    NULL, NULL, 0, 0, xmlSecStatsCacheKdf
+};
+static xmlSecTransformKdfCache          gXmlSecTransformKeyAgreementCache = {
+    NULL, NULL, 0, 0, xmlSecStatsCacheKeyAgreement
+};
+
+static void
+xmlSecTransformKdfCacheEntryClear(xmlSecTransformKdfCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->data != NULL) {
+        memset(entry->data, 0, entry->dataSize);
+        xmlFree(entry->data);
+    }
+    if(entry->id != NULL) {
+        memset(entry->id, 0, entry->idSize);
+        xmlFree(entry->id);
+    }
+    memset(entry, 0, sizeof(xmlSecTransformKdfCacheEntry));
+}
+
+/* the caller is responsible for locking */
+static void
+xmlSecTransformKdfCacheFree(xmlSecTransformKdfCachePtr cache) {
+    xmlSecSize ii;
+
+    xmlSecAssert(cache != NULL);
+
+    if(cache->entries != NULL) {
+        for(ii = 0; ii < cache->maxSize; ++ii) {
+            xmlSecTransformKdfCacheEntryClear(&(cache->entries[ii]));
+        }
+        xmlFree(cache->entries);
+    }
+    cache->entries = NULL;
+    cache->maxSize = 0;
+    cache->pos = 0;
+}
+
+static void
+xmlSecTransformKdfCacheInitializeCache(xmlSecTransformKdfCachePtr cache) {
+    xmlSecAssert(cache != NULL);
+    xmlSecAssert(cache->mutex == NULL);
+
+    cache->entries = NULL;
+    cache->maxSize = 0;
+    cache->pos = 0;
+
+    cache->mutex = xmlNewMutex();
+    if(cache->mutex == NULL) {
+        /* not fatal: the cache just can't be enabled */
+        xmlSecXmlError("xmlNewMutex", NULL);
+    }
+}
+
+static void
+xmlSecTransformKdfCacheShutdownCache(xmlSecTransformKdfCachePtr cache) {
+    xmlSecAssert(cache != NULL);
+
+    xmlSecTransformKdfCacheFree(cache);
+
+    if(cache->mutex != NULL) {
+        xmlFreeMutex(cache->mutex);
+        cache->mutex = NULL;
+    }
+}
+
+static int
+xmlSecTransformKdfCacheEnable(xmlSecTransformKdfCachePtr cache, xmlSecSize maxSize) {
+    xmlSecTransformKdfCacheEntryPtr entries;
+
+    xmlSecAssert2(cache != NULL, -1);
+    xmlSecAssert2(maxSize > 0, -1);
+
+    if(cache->mutex == NULL) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_XMLSEC_FAILED, NULL, "cache mutex is not available");
+        return(-1);
+    }
+
+    entries = (xmlSecTransformKdfCacheEntryPtr)xmlMalloc(sizeof(xmlSecTransformKdfCacheEntry) * maxSize);
+    if(entries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecTransformKdfCacheEntry) * maxSize, NULL);
+        return(-1);
+    }
+    memset(entries, 0, sizeof(xmlSecTransformKdfCacheEntry) * maxSize);
+
+    xmlMutexLock(cache->mutex);
+    xmlSecTransformKdfCacheFree(cache);
+    cache->entries = entries;
+    cache->maxSize = maxSize;
+    xmlMutexUnlock(cache->mutex);
+
+    return(0);
+}
+
+static void
+xmlSecTransformKdfCacheDisable(xmlSecTransformKdfCachePtr cache) {
+    xmlSecAssert(cache != NULL);
+
+    if(cache->mutex == NULL) {
+        return;
+    }
+    xmlMutexLock(cache->mutex);
+    xmlSecTransformKdfCacheFree(cache);
+    xmlMutexUnlock(cache->mutex);
+}
+
+void
+xmlSecTransformKdfCacheInitialize(void) {
+    xmlSecTransformKdfCacheInitializeCache(&gXmlSecTransformKdfCache);
+    xmlSecTransformKdfCacheInitializeCache(&gXmlSecTransformKeyAgreementCache);
+}
+
+void
+xmlSecTransformKdfCacheShutdown(void) {
+    xmlSecTransformKdfCacheShutdownCache(&gXmlSecTransformKeyAgreementCache);
+    xmlSecTransformKdfCacheShutdownCache(&gXmlSecTransformKdfCache);
+}
+
+/**
+ * xmlSecTransformKdfEnableCache:
+ * @maxSize:            the max number of derived keys in the cache.
+ *
+ * Enables (or re-creates empty) the process wide cache for the keys derived
+ * by the KDF transforms (PBKDF2, ConcatKDF): the key derivation with the same
+ * algorithm, parameters and master key (e.g. the same password) runs only once
+ * and the following requests get the derived key from the cache. The cache
+ * keeps copies of the master and derived keys in memory until they are replaced
+ * or the cache is disabled with #xmlSecTransformKdfDisableCache.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecTransformKdfEnableCache(xmlSecSize maxSize) {
+    return(xmlSecTransformKdfCacheEnable(&gXmlSecTransformKdfCache, maxSize));
+}
+
+/**
+ * xmlSecTransformKdfDisableCache:
+ *
+ * Disables the derived keys cache and zeroes all the cached keys.
+ */
+void
+xmlSecTransformKdfDisableCache(void) {
+    xmlSecTransformKdfCacheDisable(&gXmlSecTransformKdfCache);
+}
+
+/**
+ * xmlSecTransformKeyAgreementEnableCache:
+ * @maxSize:            the max number of shared secrets in the cache.
+ *
+ * Enables (or re-creates empty) the process wide cache for the shared secrets
+ * computed by the key agreement transforms (ECDH-ES, DH-ES): the applications
+ * that decrypt many messages from the same originator (e.g. with a static
+ * originator key) compute the shared secret only once. The cache entries are
+ * identified by the key agreement algorithm and both the originator and the
+ * recipient public keys. The cache keeps copies of the shared secrets in memory
+ * until they are replaced or the cache is disabled with
+ * #xmlSecTransformKeyAgreementDisableCache.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecTransformKeyAgreementEnableCache(xmlSecSize maxSize) {
+    return(xmlSecTransformKdfCacheEnable(&gXmlSecTransformKeyAgreementCache, maxSize));
+}
+
+/**
+ * xmlSecTransformKeyAgreementDisableCache:
+ *
+ * Disables the key agreement shared secrets cache and zeroes all the cached secrets.
+ */
+void
+xmlSecTransformKeyAgreementDisableCache(void) {
+    xmlSecTransformKdfCacheDisable(&gXmlSecTransformKeyAgreementCache);
+}
+
+/* the entry id: algorithm href, output size, KDF params id and the master key */
+static xmlSecByte*
+xmlSecTransformKdfCacheCreateId(xmlSecTransformPtr transform, xmlSecBufferPtr params,
+                                const xmlSecByte* key, xmlSecSize keySize,
+                                xmlSecSize* idSize, unsigned int* hash) {
+    const xmlChar* href;
+    xmlSecSize hrefSize, paramsSize, size, ii;
+    xmlSecByte* id;
+    xmlSecByte* pos;
+
+    xmlSecAssert2(transform != NULL, NULL);
+    xmlSecAssert2(transform->id != NULL, NULL);
+    xmlSecAssert2(params != NULL, NULL);
+    xmlSecAssert2((key != NULL) || (keySize == 0), NULL);
+    xmlSecAssert2(idSize != NULL, NULL);
+    xmlSecAssert2(hash != NULL, NULL);
+
+    href = transform->id->href;
+    hrefSize = (href != NULL) ? xmlSecStrlen(href) + 1 : 0;
+    paramsSize = xmlSecBufferGetSize(params);
+
+    size = hrefSize + sizeof(transform->expectedOutputSize) + paramsSize + keySize;
+    id = (xmlSecByte*)xmlMalloc(size);
+    if(id == NULL) {
+        xmlSecMallocError(size, xmlSecTransformGetName(transform));
+        return(NULL);
+    }
+    pos = id;
+    if(hrefSize > 0) {
+        memcpy(pos, href, hrefSize);
+        pos += hrefSize;
+    }
+    memcpy(pos, &(transform->expectedOutputSize), sizeof(transform->expectedOutputSize));
+    pos += sizeof(transform->expectedOutputSize);
+    if(paramsSize > 0) {
+        memcpy(pos, xmlSecBufferGetData(params), paramsSize);
+        pos += paramsSize;
+    }
+    if(keySize > 0) {
+        memcpy(pos, key, keySize);
+    }
+
+    (*hash) = 5381;
+    for(ii = 0; ii < size; ++ii) {
+        (*hash) = ((*hash) * 33) ^ id[ii];
+    }
+    (*idSize) = size;
+    return(id);
+}
+
+/* the caller is responsible for locking */
+static xmlSecTransformKdfCacheEntryPtr
+xmlSecTransformKdfCacheFindEntry(xmlSecTransformKdfCachePtr cache, const xmlSecByte* id,
+                                 xmlSecSize idSize, unsigned int hash) {
+    xmlSecTransformKdfCacheEntryPtr entry;
+    xmlSecSize ii;
+
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        entry = &(cache->entries[ii]);
+        if((entry->data != NULL) && (entry->hash == hash) && (entry->idSize == idSize) &&
+           (memcmp(entry->id, id, idSize) == 0)
+        ) {
+            return(entry);
+        }
+    }
+    return(NULL);
+}
+
+static int
+xmlSecTransformKdfCacheFindInCache(xmlSecTransformKdfCachePtr cache, xmlSecTransformPtr transform,
+                                   xmlSecBufferPtr params, const xmlSecByte* key, xmlSecSize keySize,
+                                   xmlSecBufferPtr out) {
+    xmlSecTransformKdfCacheEntryPtr entry;
+    xmlSecByte* id;
+    xmlSecSize idSize = 0;
+    unsigned int hash = 0;
+    int res = 0;
+    int ret;
+
+    xmlSecAssert2(cache != NULL, -1);
+    xmlSecAssert2(transform != NULL, -1);
+    xmlSecAssert2(params != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    /* quick check without locking */
+    if((cache->mutex == NULL) || (cache->entries == NULL)) {
+        return(0);
+    }
+
+    id = xmlSecTransformKdfCacheCreateId(transform, params, key, keySize, &idSize, &hash);
+    if(id == NULL) {
+        xmlSecInternalError("xmlSecTransformKdfCacheCreateId", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+
+    xmlMutexLock(cache->mutex);
+    entry = (cache->entries != NULL) ? xmlSecTransformKdfCacheFindEntry(cache, id, idSize, hash) : NULL;
+    if(entry != NULL) {
+        ret = xmlSecBufferSetData(out, entry->data, entry->dataSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetData", xmlSecTransformGetName(transform),
+                "size=" XMLSEC_SIZE_FMT, entry->dataSize);
+            res = -1;
+        } else {
+            res = 1;
+        }
+    }
+    xmlMutexUnlock(cache->mutex);
+    xmlSecStatsCacheLookup(cache->statsCache, (entry != NULL) ? 1 : 0);
+
+    memset(id, 0, idSize);
+    xmlFree(id);
+    return(res);
+}
+
+static int
+xmlSecTransformKdfCacheAddToCache(xmlSecTransformKdfCachePtr cache, xmlSecTransformPtr transform,
+                                  xmlSecBufferPtr params, const xmlSecByte* key, xmlSecSize keySize,
+                                  xmlSecBufferPtr out) {
+    xmlSecTransformKdfCacheEntry newEntry;
+    xmlSecTransformKdfCacheEntryPtr entry;
+    xmlSecByte* data;
+    xmlSecSize dataSize;
+
+    xmlSecAssert2(cache != NULL, -1);
+    xmlSecAssert2(transform != NULL, -1);
+    xmlSecAssert2(params != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    /* quick check without locking */
+    if((cache->mutex == NULL) || (cache->entries == NULL)) {
+        return(0);
+    }
+    data = xmlSecBufferGetData(out);
+    dataSize = xmlSecBufferGetSize(out);
+    if((data == NULL) || (dataSize == 0)) {
+        return(0);
+    }
+
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.id = xmlSecTransformKdfCacheCreateId(transform, params, key, keySize,
+        &(newEntry.idSize), &(newEntry.hash));
+    if(newEntry.id == NULL) {
+        xmlSecInternalError("xmlSecTransformKdfCacheCreateId", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    newEntry.data = (xmlSecByte*)xmlMalloc(dataSize);
+    if(newEntry.data == NULL) {
+        xmlSecMallocError(dataSize, xmlSecTransformGetName(transform));
+        xmlSecTransformKdfCacheEntryClear(&newEntry);
+        return(-1);
+    }
+    memcpy(newEntry.data, data, dataSize);
+    newEntry.dataSize = dataSize;
+
+    xmlMutexLock(cache->mutex);
+    if(cache->entries != NULL) {
+        /* replace the same entry (e.g. added by another thread) or the oldest one */
+        entry = xmlSecTransformKdfCacheFindEntry(cache, newEntry.id, newEntry.idSize, newEntry.hash);
+        if(entry == NULL) {
+            entry = &(cache->entries[cache->pos]);
+            cache->pos = (cache->pos + 1) % cache->maxSize;
+        }
+        xmlSecTransformKdfCacheEntryClear(entry);
+        memcpy(entry, &newEntry, sizeof(newEntry));
+        memset(&newEntry, 0, sizeof(newEntry));
+    }
+    xmlMutexUnlock(cache->mutex);
+
+    /* the cache was disabled in the meantime */
+    xmlSecTransformKdfCacheEntryClear(&newEntry);
+    return(0);
+}
+
+/* looks up the key derived by @transform (with the transform's expected output size) from
+ * @key with @params. Returns 1 if the key was found (and copied to @out), 0 if not or
+ * a negative value if an error occurs */
+int
+xmlSecTransformKdfCacheFind(xmlSecTransformPtr transform, xmlSecBufferPtr params,
+                            const xmlSecByte* key, xmlSecSize keySize, xmlSecBufferPtr out) {
+    xmlSecAssert2(key != NULL, -1);
+    return(xmlSecTransformKdfCacheFindInCache(&gXmlSecTransformKdfCache, transform,
+        params, key, keySize, out));
+}
+
+/* adds the key derived by @transform from @key with @params to the cache (if enabled) */
+int
+xmlSecTransformKdfCacheAdd(xmlSecTransformPtr transform, xmlSecBufferPtr params,
+                           const xmlSecByte* key, xmlSecSize keySize, xmlSecBufferPtr out) {
+    xmlSecAssert2(key != NULL, -1);
+    return(xmlSecTransformKdfCacheAddToCache(&gXmlSecTransformKdfCache, transform,
+        params, key, keySize, out));
+}
+
+/* returns 1 if the key agreement secrets cache is enabled (quick check without
+ * locking to skip preparing the public keys id) or 0 otherwise */
+int
+xmlSecTransformKeyAgreementCacheIsEnabled(void) {
+    return(((gXmlSecTransformKeyAgreementCache.mutex != NULL) &&
+            (gXmlSecTransformKeyAgreementCache.entries != NULL)) ? 1 : 0);
+}
+
+/* looks up the shared secret computed by @transform for the public keys @keysId
+ * (the originator and recipient public keys). Returns 1 if the secret was found
+ * (and copied to @out), 0 if not or a negative value if an error occurs */
+int
+xmlSecTransformKeyAgreementCacheFind(xmlSecTransformPtr transform, xmlSecBufferPtr keysId,
+                                     xmlSecBufferPtr out) {
+    return(xmlSecTransformKdfCacheFindInCache(&gXmlSecTransformKeyAgreementCache, transform,
+        keysId, NULL, 0, out));
+}
+
+/* adds the shared secret computed by @transform for the public keys @keysId to the cache (if enabled) */
+int
+xmlSecTransformKeyAgreementCacheAdd(xmlSecTransformPtr transform, xmlSecBufferPtr keysId,
+                                    xmlSecBufferPtr out) {
+    return(xmlSecTransformKdfCacheAddToCache(&gXmlSecTransformKeyAgreementCache, transform,
+        keysId, NULL, 0, out));
+}
+
+
+/**************************** Parallel CBC decryption ********************************
+ *
+ * In the CBC mode each plaintext block depends only on the key and on two
+ * ciphertext blocks (the block itself and the previous one). Thus a large
+ * ciphertext is split into segments decrypted independently on the executor:
+ * each segment uses the last ciphertext block of the previous segment as iv.
+ * The last ciphertext block is always kept in the input for the crypto backend
+ * final call that removes the XML Enc padding.
+ *
+ *********************************************************************************/
+/* the smaller segments are not worth the tasks overhead */
+#define XMLSEC_TRANSFORM_CBC_SEGMENT_MIN_SIZE       (256*1024)
+
+typedef struct _xmlSecTransformCbcSegments      xmlSecTransformCbcSegments,
+                                                *xmlSecTransformCbcSegmentsPtr;
+struct _xmlSecTransformCbcSegments {
+    xmlSecTransformCbcDecryptSegmentMethod      decryptSegment;
+    void*                                       cipherCtx;
+    const xmlSecByte*                           iv;
+    xmlSecSize                                  blockSize;
+    const xmlSecByte*                           in;
+    xmlSecSize                                  inSize;
+    xmlSecByte*                                 out;
+    xmlSecSize                                  segmentSize;
+    int*                                        results;
+};
+
+static void
+xmlSecTransformCbcDecryptSegmentTask(void* taskCtx, xmlSecSize worker) {
+    xmlSecTransformCbcSegmentsPtr segments = (xmlSecTransformCbcSegmentsPtr)taskCtx;
+    const xmlSecByte* iv;
+    xmlSecSize start, size;
+    int ret;
+
+    xmlSecAssert(segments != NULL);
+    xmlSecAssert(segments->decryptSegment != NULL);
+    xmlSecAssert(segments->results != NULL);
+    xmlSecAssert(segments->segmentSize > 0);
+
+    start = worker * segments->segmentSize;
+    if(start >= segments->inSize) {
+        /* nothing left for this worker */
+        segments->results[worker] = 0;
+        return;
+    }
+    size = segments->inSize - start;
+    if(size > segments->segmentSize) {
+        size = segments->segmentSize;
+    }
+    iv = (start > 0) ? (segments->in + start - segments->blockSize) : segments->iv;
+
+    ret = segments->decryptSegment(segments->cipherCtx, iv, segments->in + start, size,
+        segments->out + start);
+    if(ret < 0) {
+        xmlSecInternalError2("decryptSegment", NULL, "worker=" XMLSEC_SIZE_FMT, worker);
+        segments->results[worker] = -1;
+        return;
+    }
+    segments->results[worker] = 0;
+}
+
+/* returns 1 if the large CBC payloads should be decrypted with xmlSecTransformCbcDecryptParallel() */
+int
+xmlSecTransformCbcDecryptIsParallel(xmlSecTransformCtxPtr transformCtx) {
+    return(((transformCtx != NULL) && (transformCtx->executor != NULL)) ? 1 : 0);
+}
+
+/* decrypts all the complete blocks from @in except the last one to @out once
+ * there is at least the executor min size of data in @in (or if @last is set).
+ * The @iv (@blockSize bytes) is the previous ciphertext block and it is updated
+ * for the next call. The @decryptSegment method is called from different threads.
+ * Returns 1 if the data was decrypted, 0 if more data is needed or a negative
+ * value if an error occurs */
+int
+xmlSecTransformCbcDecryptParallel(xmlSecTransformCtxPtr transformCtx,
+                                  xmlSecTransformCbcDecryptSegmentMethod decryptSegment,
+                                  void* cipherCtx, xmlSecByte* iv, xmlSecSize blockSize,
+                                  xmlSecBufferPtr in, xmlSecBufferPtr out, int last) {
+    xmlSecTransformCbcSegments segments;
+    xmlSecSize inSize, inBlocksSize, outSize, minSize, blocksNum;
+    xmlSecSize workersNum, threadsNum, ii;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(transformCtx != NULL, -1);
+    xmlSecAssert2(transformCtx->executor != NULL, -1);
+    xmlSecAssert2(decryptSegment != NULL, -1);
+    xmlSecAssert2(iv != NULL, -1);
+    xmlSecAssert2(blockSize > 0, -1);
+    xmlSecAssert2(in != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    minSize = (transformCtx->executorMinSize > 0) ? transformCtx->executorMinSize :
+        XMLSEC_TRANSFORMCTX_EXECUTOR_MIN_SIZE;
+    inSize = xmlSecBufferGetSize(in);
+    if(((last == 0) && (inSize < minSize + blockSize)) || (inSize <= blockSize)) {
+        return(0);
+    }
+
+    /* keep the last block for the padding check / removal */
+    inBlocksSize = blockSize * (inSize / blockSize);
+    if(inBlocksSize == inSize) {
+        inBlocksSize -= blockSize;
+    }
+    xmlSecAssert2(inBlocksSize > 0, -1);
+    blocksNum = inBlocksSize / blockSize;
+
+    outSize = xmlSecBufferGetSize(out);
+    ret = xmlSecBufferSetMaxSize(out, outSize + inBlocksSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetMaxSize", NULL,
+            "size=" XMLSEC_SIZE_FMT, (outSize + inBlocksSize));
+        return(-1);
+    }
+
+    threadsNum = xmlSecExecutorGetThreadsNum(transformCtx->executor);
+    workersNum = inBlocksSize / XMLSEC_TRANSFORM_CBC_SEGMENT_MIN_SIZE;
+    if(workersNum > threadsNum) {
+        workersNum = threadsNum;
+    }
+    if(workersNum > blocksNum) {
+        workersNum = blocksNum;
+    }
+    if(workersNum < 1) {
+        workersNum = 1;
+    }
+
+    memset(&segments, 0, sizeof(segments));
+    segments.decryptSegment = decryptSegment;
+    segments.cipherCtx      = cipherCtx;
+    segments.iv             = iv;
+    segments.blockSize      = blockSize;
+    segments.in             = xmlSecBufferGetData(in);
+    segments.inSize         = inBlocksSize;
+    segments.out            = xmlSecBufferGetData(out) + outSize;
+    segments.segmentSize    = blockSize * ((blocksNum + workersNum - 1) / workersNum);
+    xmlSecAssert2(segments.in != NULL, -1);
+
+    if(workersNum == 1) {
+        ret = decryptSegment(cipherCtx, iv, segments.in, inBlocksSize, segments.out);
+        if(ret < 0) {
+            xmlSecInternalError("decryptSegment", NULL);
+            goto done;
+        }
+    } else {
+        segments.results = (int*)xmlMalloc(workersNum * sizeof(int));
+        if(segments.results == NULL) {
+            xmlSecMallocError(workersNum * sizeof(int), NULL);
+            goto done;
+        }
+        for(ii = 0; ii < workersNum; ++ii) {
+            segments.results[ii] = -1;
+        }
+
+        ret = xmlSecExecutorRunWorkers(transformCtx->executor, xmlSecTransformCbcDecryptSegmentTask,
+            &segments, workersNum);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecExecutorRunWorkers", NULL,
+                "workersNum=" XMLSEC_SIZE_FMT, workersNum);
+            goto done;
+        }
+        for(ii = 0; ii < workersNum; ++ii) {
+            if(segments.results[ii] < 0) {
+                xmlSecInternalError2("xmlSecTransformCbcDecryptSegmentTask", NULL,
+                    "worker=" XMLSEC_SIZE_FMT, ii);
+                goto done;
+            }
+        }
+    }
+
+    /* the last decrypted ciphertext block is the iv for the next data */
+    memcpy(iv, segments.in + inBlocksSize - blockSize, blockSize);
+
+    ret = xmlSecBufferSetSize(out, outSize + inBlocksSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetSize", NULL,
+            "size=" XMLSEC_SIZE_FMT, (outSize + inBlocksSize));
+        goto done;
+    }
+    ret = xmlSecBufferRemoveHead(in, inBlocksSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferRemoveHead", NULL,
+            "size=" XMLSEC_SIZE_FMT, inBlocksSize);
+        goto done;
+    }
+
+    /* success */
+    res = 1;
+
+done:
+    if(segments.results != NULL) {
+        xmlFree(segments.results);
+    }
+    return(res);
+}
+
+
 #ifndef XMLSEC_NO_RSA
 int
 xmlSecTransformRsaOaepParamsInitialize(xmlSecTransformRsaOaepParamsPtr oaepParams) {
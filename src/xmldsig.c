@@ -22,29 +22,65 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <libxml/tree.h>
 #include <libxml/parser.h>
+#include <libxml/threads.h>
+#include <libxml/c14n.h>
+#ifdef LIBXML_READER_ENABLED
+#include <libxml/xmlreader.h>
+#endif /* LIBXML_READER_ENABLED */
 
 #include <xmlsec/xmlsec.h>
+#include <xmlsec/base64.h>
 #include <xmlsec/buffer.h>
 #include <xmlsec/xmltree.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/membuf.h>
+#include <xmlsec/parser.h>
+#include <xmlsec/io.h>
 #include <xmlsec/xmldsig.h>
+#include <xmlsec/recorder.h>
+#include <xmlsec/executor.h>
 #include <xmlsec/errors.h>
 
+#include "arena.h"
+#include "c14n_native.h"
 #include "cast_helpers.h"
+#include "docindex_helpers.h"
+#include "filemap.h"
+#include "keysmngr_helpers.h"
+#include "stats_helpers.h"
 
 /**************************************************************************
  *
  * xmlSecDSigCtx
  *
  *************************************************************************/
+static int      xmlSecDSigCtxSignInternal               (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlNodePtr tmpl,
+                                                         int deferSign);
 static int      xmlSecDSigCtxProcessSignatureNode       (xmlSecDSigCtxPtr dsigCtx,
-                                                         xmlNodePtr node);
+                                                         xmlNodePtr node,
+                                                         int deferSign);
+static int      xmlSecDSigCtxSignOnSerialize            (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlNodePtr tmpl,
+                                                         xmlOutputBufferPtr out);
+static int      xmlSecDSigCtxExecuteSignedInfo          (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlNodePtr signedInfoNode,
+                                                         int deferSign);
+static int      xmlSecDSigCtxPreSignSink                (void* sinkCtx,
+                                                         const xmlSecByte* data,
+                                                         xmlSecSize size,
+                                                         int last);
+static int      xmlSecDSigCtxDetachSignMethod           (xmlSecDSigCtxPtr dsigCtx);
+static void     xmlSecDSigCtxDestroyDetachedSignMethod  (xmlSecDSigCtxPtr dsigCtx);
 static int      xmlSecDSigCtxProcessSignedInfoNode      (xmlSecDSigCtxPtr dsigCtx,
                                                          xmlNodePtr node,
                                                          xmlNodePtr * firstReferenceNode);
@@ -54,15 +90,86 @@ static int      xmlSecDSigCtxProcessObjectNode          (xmlSecDSigCtxPtr dsigCt
                                                          xmlNodePtr node);
 static int      xmlSecDSigCtxProcessManifestNode        (xmlSecDSigCtxPtr dsigCtx,
                                                          xmlNodePtr node);
+static int      xmlSecDSigCtxExecuteManifestReferences  (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlSecSize first);
 
 static int      xmlSecDSigCtxProcessReferences          (xmlSecDSigCtxPtr dsigCtx,
                                                          xmlNodePtr firstReferenceNode);
+static int      xmlSecDSigCtxExecuteReferences          (xmlSecDSigCtxPtr dsigCtx);
+static int      xmlSecDSigCtxBatchDigestReferences      (xmlSecDSigCtxPtr dsigCtx);
+static int      xmlSecDSigCtxPrefetchReferences         (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlNodePtr firstReferenceNode);
 
-
+static int      xmlSecDSigReferenceCtxPrepareNode       (xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                         xmlNodePtr node);
+static int      xmlSecDSigReferenceCtxExecute           (xmlSecDSigReferenceCtxPtr dsigRefCtx);
+static int      xmlSecDSigReferenceCtxExecuteTransforms (xmlSecDSigReferenceCtxPtr dsigRefCtx);
+static int      xmlSecDSigReferenceCtxCacheFind         (xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                         xmlSecBufferPtr cacheId);
+static int      xmlSecDSigReferenceCtxCacheAdd          (xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                         xmlSecBufferPtr cacheId);
+static int      xmlSecDSigReferenceCtxPreDigestSink     (void* sinkCtx,
+                                                         const xmlSecByte* data,
+                                                         xmlSecSize size,
+                                                         int last);
+static int      xmlSecDSigReferenceCtxWriteResult       (xmlSecDSigReferenceCtxPtr dsigRefCtx);
+static int      xmlSecDSigReferenceCtxExecuteTask       (xmlSecDSigReferenceCtxPtr dsigRefCtx);
+static int      xmlSecDSigReferenceCtxProcessNodeIncremental(xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                         xmlNodePtr node);
+static int      xmlSecDSigReferenceCtxIsUnchanged       (xmlSecDSigReferenceCtxPtr dsigRefCtx);
+static int      xmlSecDSigReferenceCtxDetachDigestMethod(xmlSecDSigReferenceCtxPtr dsigRefCtx);
+static void     xmlSecDSigReferenceCtxDestroyDetachedDigestMethod(xmlSecDSigReferenceCtxPtr dsigRefCtx);
+static int      xmlSecDSigReferenceCtxBatchDigestFinish (xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                         xmlSecBufferPtr data,
+                                                         xmlSecBufferPtr digest);
+static int      xmlSecDSigReferenceCtxAppendTransforms  (xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                         xmlSecBufferPtr buf);
+static int      xmlSecDSigReferenceCtxSharedGetKey      (xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                         struct _xmlSecDSigSharedRefs* shared,
+                                                         xmlSecBufferPtr key);
+static int      xmlSecDSigReferenceCtxFindShared        (xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                                         xmlSecBufferPtr* preDigest);
+
+
+static int      xmlSecDSigCtxPrepareArena               (xmlSecDSigCtxPtr dsigCtx);
+static xmlSecMemStatsPtr xmlSecDSigCtxGetMemStats       (xmlSecDSigCtxPtr dsigCtx);
+static xmlSecSettingsPtr xmlSecDSigCtxGetSettings       (xmlSecDSigCtxPtr dsigCtx);
+static int      xmlSecDSigCtxVerifyInternal             (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlNodePtr node,
+                                                         int deferVerify);
+static int      xmlSecDSigCtxVerifyComplete             (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlSecBufferPtr signatureValue,
+                                                         int result);
+static int      xmlSecDSigCtxVerifySignatureValue       (xmlSecDSigCtxPtr dsigCtx,
+                                                         int* verified);
+static int      xmlSecDSigCtxVerifyManifestReferencesInternal(xmlSecDSigCtxPtr dsigCtx);
+static int      xmlSecDSigVerifyCacheFind               (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlSecBufferPtr signedInfo,
+                                                         xmlSecBufferPtr signatureValue,
+                                                         xmlSecBufferPtr cacheId);
+static int      xmlSecDSigVerifyCacheAdd                (xmlSecDSigCtxPtr dsigCtx,
+                                                         xmlSecBufferPtr cacheId);
 static void     xmlSecDSigCtxMarkAsSucceeded            (xmlSecDSigCtxPtr dsigCtx);
 static void     xmlSecDSigCtxMarkAsFailed               (xmlSecDSigCtxPtr dsigCtx,
                                                          xmlSecDSigFailureReason failureReason);
 
+/* the signatures created by #xmlSecDSigCtxSignMultiple */
+struct _xmlSecDSigSharedRefs {
+    xmlSecDSigCtxPtr*   ctxs;
+    xmlNodePtr*         tmpls;
+    xmlSecSize          size;
+    xmlSecSize          done;
+};
+
+/* the nodes changed since the previous signature (#xmlSecDSigCtxSignIncremental) */
+struct _xmlSecDSigDirtyNodes {
+    xmlNodePtr          signature;
+    xmlNodePtr*         nodes;
+    xmlSecSize          size;
+    int                 keepDigests;    /* calculated by #xmlSecDSigCtxSignToOutput or
+                                         * verified by #xmlSecDSigCtxVerifyFile */
+};
+
 /* The ID attribute in XMLDSig is 'Id' */
 static const xmlChar*           xmlSecDSigIds[] = { xmlSecAttrId, NULL };
 
@@ -124,24 +231,29 @@ xmlSecDSigCtxDestroy(xmlSecDSigCtxPtr dsigCtx) {
  */
 int
 xmlSecDSigCtxInitialize(xmlSecDSigCtxPtr dsigCtx, xmlSecKeysMngrPtr keysMngr) {
+    xmlSecSettingsPtr prevSettings;
+    int res = -1;
     int ret;
 
     xmlSecAssert2(dsigCtx != NULL, -1);
 
     memset(dsigCtx, 0, sizeof(xmlSecDSigCtx));
 
+    /* the defaults are taken from the keys manager settings */
+    prevSettings = xmlSecSettingsAttach((keysMngr != NULL) ? keysMngr->priv->settings : NULL);
+
     /* initialize key info */
     ret = xmlSecKeyInfoCtxInitialize(&(dsigCtx->keyInfoReadCtx), keysMngr);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxInitialize", NULL);
-        return(-1);
+        goto done;
     }
     dsigCtx->keyInfoReadCtx.mode = xmlSecKeyInfoModeRead;
 
     ret = xmlSecKeyInfoCtxInitialize(&(dsigCtx->keyInfoWriteCtx), keysMngr);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxInitialize", NULL);
-        return(-1);
+        goto done;
     }
     dsigCtx->keyInfoWriteCtx.mode = xmlSecKeyInfoModeWrite;
     /* it's not wise to write private key :) */
@@ -151,7 +263,7 @@ xmlSecDSigCtxInitialize(xmlSecDSigCtxPtr dsigCtx, xmlSecKeysMngrPtr keysMngr) {
     ret = xmlSecTransformCtxInitialize(&(dsigCtx->transformCtx));
     if(ret < 0) {
         xmlSecInternalError("xmlSecTransformCtxInitialize", NULL);
-        return(-1);
+        goto done;
     }
 
     /* references lists from SignedInfo and Manifest elements */
@@ -159,17 +271,23 @@ xmlSecDSigCtxInitialize(xmlSecDSigCtxPtr dsigCtx, xmlSecKeysMngrPtr keysMngr) {
                                   xmlSecDSigReferenceCtxListId);
     if(ret != 0) {
         xmlSecInternalError("xmlSecPtrListInitialize", NULL);
-        return(ret);
+        goto done;
     }
     ret = xmlSecPtrListInitialize(&(dsigCtx->manifestReferences),
                                   xmlSecDSigReferenceCtxListId);
     if(ret != 0) {
         xmlSecInternalError("xmlSecPtrListInitialize", NULL);
-        return(ret);
+        goto done;
     }
 
     dsigCtx->enabledReferenceUris = xmlSecTransformUriTypeAny;
-    return(0);
+
+    /* success */
+    res = 0;
+
+done:
+    xmlSecSettingsDetach(prevSettings);
+    return(res);
 }
 
 /**
@@ -182,12 +300,17 @@ void
 xmlSecDSigCtxFinalize(xmlSecDSigCtxPtr dsigCtx) {
     xmlSecAssert(dsigCtx != NULL);
 
+    xmlSecDSigCtxDestroyDetachedSignMethod(dsigCtx);
     xmlSecTransformCtxFinalize(&(dsigCtx->transformCtx));
     xmlSecKeyInfoCtxFinalize(&(dsigCtx->keyInfoReadCtx));
     xmlSecKeyInfoCtxFinalize(&(dsigCtx->keyInfoWriteCtx));
     xmlSecPtrListFinalize(&(dsigCtx->signedInfoReferences));
     xmlSecPtrListFinalize(&(dsigCtx->manifestReferences));
 
+    /* all the arena transforms are destroyed by now */
+    if(dsigCtx->arena != NULL) {
+        xmlSecArenaDestroy(dsigCtx->arena);
+    }
     if(dsigCtx->enabledReferenceTransforms != NULL) {
         xmlSecPtrListDestroy(dsigCtx->enabledReferenceTransforms);
     }
@@ -200,6 +323,47 @@ xmlSecDSigCtxFinalize(xmlSecDSigCtxPtr dsigCtx) {
     memset(dsigCtx, 0, sizeof(xmlSecDSigCtx));
 }
 
+/**
+ * xmlSecDSigCtxReset:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ *
+ * Resets @dsigCtx object for processing the next signature, user settings
+ * are not touched and the allocated memory is kept for reuse.
+ */
+void
+xmlSecDSigCtxReset(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecAssert(dsigCtx != NULL);
+
+    xmlSecDSigCtxDestroyDetachedSignMethod(dsigCtx);
+    xmlSecTransformCtxReset(&(dsigCtx->transformCtx));
+    xmlSecKeyInfoCtxReset(&(dsigCtx->keyInfoReadCtx));
+    xmlSecKeyInfoCtxReset(&(dsigCtx->keyInfoWriteCtx));
+    xmlSecPtrListClear(&(dsigCtx->signedInfoReferences));
+    xmlSecPtrListClear(&(dsigCtx->manifestReferences));
+    if(dsigCtx->arena != NULL) {
+        xmlSecArenaReset(dsigCtx->arena);
+    }
+
+    if(dsigCtx->signKey != NULL) {
+        xmlSecKeyDestroy(dsigCtx->signKey);
+        dsigCtx->signKey = NULL;
+    }
+    if(dsigCtx->id != NULL) {
+        xmlFree(dsigCtx->id);
+        dsigCtx->id = NULL;
+    }
+
+    dsigCtx->operation          = xmlSecTransformOperationNone;
+    dsigCtx->result             = NULL;
+    dsigCtx->status             = xmlSecDSigStatusUnknown;
+    dsigCtx->failureReason      = xmlSecDSigFailureReasonUnknown;
+    dsigCtx->signMethod         = NULL;
+    dsigCtx->c14nMethod         = NULL;
+    dsigCtx->preSignMemBufMethod= NULL;
+    dsigCtx->signValueNode      = NULL;
+    xmlSecMemStatsReset(&(dsigCtx->memStats));
+}
+
 /**
  * xmlSecDSigCtxEnableReferenceTransform:
  * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
@@ -257,7 +421,8 @@ xmlSecDSigCtxEnableSignatureTransform(xmlSecDSigCtxPtr dsigCtx, xmlSecTransformI
  *
  * Gets pointer to the buffer with serialized &lt;dsig:SignedInfo/&gt; element
  * just before signature claculation (valid if and only if
- * #XMLSEC_DSIG_FLAGS_STORE_SIGNATURE context flag is set.
+ * #XMLSEC_DSIG_FLAGS_STORE_SIGNATURE context flag is set; the buffer is
+ * empty if the data is passed to #xmlSecDSigCtx.preDataSink instead).
  *
  * Returns: 0 on success or a negative value if an error occurs.
  */
@@ -269,6 +434,54 @@ xmlSecDSigCtxGetPreSignBuffer(xmlSecDSigCtxPtr dsigCtx) {
             xmlSecTransformMemBufGetBuffer(dsigCtx->preSignMemBufMethod) : NULL);
 }
 
+/**
+ * xmlSecDSigCtxSetDeadline:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @timeout:            the time budget in seconds from now or 0 for no deadline.
+ * @cancelFlag:         the optional pointer to the application flag or NULL.
+ *
+ * Sets the time budget for the next signature or verification with @dsigCtx
+ * (see #xmlSecTransformCtxSetDeadline): the references and &lt;dsig:SignedInfo/&gt;
+ * transforms and the keys resolution fail once the @timeout expires or
+ * the @cancelFlag is set to a non-zero value. The failed operation has
+ * the #xmlSecDSigFailureReasonDeadline failure reason.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDSigCtxSetDeadline(xmlSecDSigCtxPtr dsigCtx, double timeout, volatile int* cancelFlag) {
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+
+    ret = xmlSecTransformCtxSetDeadline(&(dsigCtx->transformCtx), timeout, cancelFlag);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxSetDeadline", NULL);
+        return(-1);
+    }
+
+    /* the keys resolution checks the deadline in these contexts */
+    dsigCtx->keyInfoReadCtx.retrievalMethodCtx.deadline = dsigCtx->transformCtx.deadline;
+    dsigCtx->keyInfoReadCtx.retrievalMethodCtx.cancelFlag = cancelFlag;
+    dsigCtx->keyInfoReadCtx.keyInfoReferenceCtx.deadline = dsigCtx->transformCtx.deadline;
+    dsigCtx->keyInfoReadCtx.keyInfoReferenceCtx.cancelFlag = cancelFlag;
+    dsigCtx->keyInfoWriteCtx.retrievalMethodCtx.deadline = dsigCtx->transformCtx.deadline;
+    dsigCtx->keyInfoWriteCtx.retrievalMethodCtx.cancelFlag = cancelFlag;
+    dsigCtx->keyInfoWriteCtx.keyInfoReferenceCtx.deadline = dsigCtx->transformCtx.deadline;
+    dsigCtx->keyInfoWriteCtx.keyInfoReferenceCtx.cancelFlag = cancelFlag;
+    return(0);
+}
+
+static int
+xmlSecDSigCtxPreSignSink(void* sinkCtx, const xmlSecByte* data, xmlSecSize size, int last) {
+    xmlSecDSigCtxPtr dsigCtx = (xmlSecDSigCtxPtr)sinkCtx;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->preDataSink != NULL, -1);
+
+    return(dsigCtx->preDataSink(dsigCtx->preDataSinkCtx, dsigCtx, NULL, data, size, last));
+}
+
 /**
  * xmlSecDSigCtxSign:
  * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
@@ -280,6 +493,9 @@ xmlSecDSigCtxGetPreSignBuffer(xmlSecDSigCtxPtr dsigCtx) {
  */
 int
 xmlSecDSigCtxSign(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr tmpl) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecSize record;
     xmlSecByte* outBuf;
     xmlSecSize outSize;
     int outLen;
@@ -290,19 +506,21 @@ xmlSecDSigCtxSign(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr tmpl) {
     xmlSecAssert2(tmpl != NULL, -1);
     xmlSecAssert2(tmpl->doc != NULL, -1);
 
-    /* add ids for Signature nodes */
-    dsigCtx->operation  = xmlSecTransformOperationSign;
-    dsigCtx->status     = xmlSecDSigStatusUnknown;
-    xmlSecAddIDs(tmpl->doc, tmpl, xmlSecDSigIds);
-
-    /* read signature template */
-    ret = xmlSecDSigCtxProcessSignatureNode(dsigCtx, tmpl);
+    record = xmlSecRecorderAddDoc(tmpl->doc);
+    prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+    ret = xmlSecDSigCtxSignInternal(dsigCtx, tmpl, 0);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(record > 0) {
+        xmlSecRecorderAddOp(record, "sign", dsigCtx->flags, dsigCtx->flags2,
+            (dsigCtx->signKey != NULL) ? xmlSecKeyGetName(dsigCtx->signKey) : NULL,
+            (ret < 0) ? "error" : "ok");
+    }
     if(ret < 0) {
-        xmlSecInternalError("xmlSecDSigCtxProcessSignatureNode", NULL);
+        xmlSecInternalError("xmlSecDSigCtxSignInternal", NULL);
         return(-1);
     }
-    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
-    xmlSecAssert2(dsigCtx->signValueNode != NULL, -1);
 
     /* references processing might change the status */
     if(dsigCtx->status != xmlSecDSigStatusUnknown) {
@@ -328,1318 +546,7063 @@ xmlSecDSigCtxSign(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr tmpl) {
 }
 
 /**
- * xmlSecDSigCtxVerify:
+ * xmlSecDSigCtxSignIncremental:
  * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
- * @node:               the pointer with &lt;dsig:Signature/&gt; node.
+ * @node:               the pointer to previously signed &lt;dsig:Signature/&gt; node.
+ * @dirtyNodes:         the nodes changed since the previous signature.
+ * @dirtyNodesSize:     the number of elements in @dirtyNodes.
  *
- * Validates signature in the @node. The verification result is returned
- * in #status member of the @dsigCtx object.
+ * Signs the document again after the @dirtyNodes subtrees were modified
+ * (the parent of the removed nodes should be passed). The digest in
+ * &lt;dsig:DigestValue/&gt; node is kept as-is for the "#id" references
+ * with only c14n and enveloped signature transforms if the referenced
+ * element does not contain, or is not contained in, any of the @dirtyNodes
+ * and is outside of @node. All other references are digested again, one
+ * after another. The &lt;dsig:SignedInfo/&gt; and &lt;dsig:SignatureValue/&gt;
+ * are always calculated.
  *
- * Returns: 0 on success (check #status member of @dsigCtx to get
- * signature verification result) or a negative value if an error occurs.
+ * Returns: 0 on success or a negative value if an error occurs.
  */
 int
-xmlSecDSigCtxVerify(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
+xmlSecDSigCtxSignIncremental(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node,
+                             xmlNodePtr* dirtyNodes, xmlSecSize dirtyNodesSize) {
+    struct _xmlSecDSigDirtyNodes dirty;
     int ret;
 
     xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->sharedRefs == NULL, -1);
+    xmlSecAssert2(dsigCtx->dirtyNodes == NULL, -1);
     xmlSecAssert2(node != NULL, -1);
-    xmlSecAssert2(node->doc != NULL, -1);
+    xmlSecAssert2((dirtyNodes != NULL) || (dirtyNodesSize == 0), -1);
 
-    /* add ids for Signature nodes */
-    dsigCtx->operation  = xmlSecTransformOperationVerify;
-    dsigCtx->status     = xmlSecDSigStatusUnknown;
-    xmlSecAddIDs(node->doc, node, xmlSecDSigIds);
+    dirty.signature = node;
+    dirty.nodes = dirtyNodes;
+    dirty.size = dirtyNodesSize;
+    dirty.keepDigests = 0;
 
-    /* read signature info */
-    ret = xmlSecDSigCtxProcessSignatureNode(dsigCtx, node);
+    dsigCtx->dirtyNodes = &dirty;
+    ret = xmlSecDSigCtxSign(dsigCtx, node);
+    dsigCtx->dirtyNodes = NULL;
     if(ret < 0) {
-        xmlSecInternalError("xmlSecDSigCtxProcessSignatureNode", NULL);
+        xmlSecInternalError("xmlSecDSigCtxSign", NULL);
         return(-1);
     }
-    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
-    xmlSecAssert2(dsigCtx->signValueNode != NULL, -1);
+    return(0);
+}
 
-    /* references processing might change the status */
-    if(dsigCtx->status != xmlSecDSigStatusUnknown) {
+/**
+ * xmlSecDSigCtxSignToOutput:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @tmpl:               the pointer to &lt;dsig:Signature/&gt; node with signature template.
+ * @out:                the output buffer (without encoder).
+ *
+ * Signs the data as described in @tmpl node and writes the canonical form
+ * (without comments) of the signed document into @out. If @tmpl is an
+ * enveloped signature with one &lt;dsig:Reference URI=""/&gt; that has only
+ * the enveloped signature and C14N 1.0 or exclusive C14N transforms then
+ * the document is canonicalized once: the output before the signature is
+ * written into @out while it is digested, the signature is calculated and
+ * written next, and the rest of the output is written last. Otherwise the
+ * document is signed with #xmlSecDSigCtxSign and written with the inclusive
+ * C14N 1.0. If an error occurs then the output might be incomplete.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDSigCtxSignToOutput(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr tmpl, xmlOutputBufferPtr out) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecNodeSetPtr nodes;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->result == NULL, -1);
+    xmlSecAssert2(dsigCtx->dirtyNodes == NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(tmpl->doc != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+    ret = xmlSecDSigCtxSignOnSerialize(dsigCtx, tmpl, out);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxSignOnSerialize", NULL);
+        return(-1);
+    } else if(ret == 1) {
         return(0);
     }
 
-    /* verify SignatureValue node content */
-    ret = xmlSecTransformVerifyNodeContent(dsigCtx->signMethod, dsigCtx->signValueNode,
-                                           &(dsigCtx->transformCtx));
+    /* sign and write the document */
+    ret = xmlSecDSigCtxSign(dsigCtx, tmpl);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformVerifyNodeContent", NULL);
+        xmlSecInternalError("xmlSecDSigCtxSign", NULL);
+        return(-1);
+    }
+    if(dsigCtx->status != xmlSecDSigStatusSucceeded) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_RESULT, NULL, NULL);
         return(-1);
     }
 
-    /* set status and we are done */
-    if(dsigCtx->signMethod->status == xmlSecTransformStatusOk) {
-        xmlSecDSigCtxMarkAsSucceeded(dsigCtx);
+    nodes = xmlSecNodeSetGetChildren(tmpl->doc, NULL, 0, 0);
+    if(nodes == NULL) {
+        xmlSecInternalError("xmlSecNodeSetGetChildren", NULL);
+        return(-1);
+    }
+    if((dsigCtx->transformCtx.flags & XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N) == 0) {
+        ret = xmlSecC14NNativeExecute(nodes, XML_C14N_1_0, NULL, 0, out);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecC14NNativeExecute", NULL);
+            xmlSecNodeSetDestroy(nodes);
+            return(-1);
+        }
     } else {
-        xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonSignature);
+        ret = xmlC14NExecute(tmpl->doc, (xmlC14NIsVisibleCallback)xmlSecNodeSetContains,
+                             nodes, XML_C14N_1_0, NULL, 0, out);
+        if(ret < 0) {
+            xmlSecXmlError("xmlC14NExecute", NULL);
+            xmlSecNodeSetDestroy(nodes);
+            return(-1);
+        }
     }
+    xmlSecNodeSetDestroy(nodes);
     return(0);
 }
 
-static void
-xmlSecDSigCtxMarkAsSucceeded(xmlSecDSigCtxPtr dsigCtx) {
-    xmlSecAssert(dsigCtx != NULL);
+/**
+ * xmlSecDSigCtxSignMultiple:
+ * @dsigCtxs:           the array of &lt;dsig:Signature/&gt; processing contexts.
+ * @tmpls:              the array of &lt;dsig:Signature/&gt; templates in the same document.
+ * @size:               the number of elements in @dsigCtxs and @tmpls.
+ *
+ * Signs the templates one after another (e.g. the same document with the old
+ * and the new digest algorithms during the migration). If a reference has the
+ * same URI and &lt;dsig:Transforms/&gt; as a reference in one of the previous
+ * signatures then its transforms are not executed again and the pre-digest data
+ * of the previous signature is digested instead. Only the external references and
+ * the "#id" references to the elements that do not contain any of the @tmpls
+ * nodes are shared.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDSigCtxSignMultiple(xmlSecDSigCtxPtr* dsigCtxs, xmlNodePtr* tmpls, xmlSecSize size) {
+    struct _xmlSecDSigSharedRefs shared;
+    xmlSecSize ii;
+    int ret;
 
-    dsigCtx->status = xmlSecDSigStatusSucceeded;
-}
+    xmlSecAssert2(dsigCtxs != NULL, -1);
+    xmlSecAssert2(tmpls != NULL, -1);
 
-static void
-xmlSecDSigCtxMarkAsFailed(xmlSecDSigCtxPtr dsigCtx, xmlSecDSigFailureReason failureReason) {
-    xmlSecAssert(dsigCtx != NULL);
+    for(ii = 0; ii < size; ++ii) {
+        xmlSecAssert2(dsigCtxs[ii] != NULL, -1);
+        xmlSecAssert2(dsigCtxs[ii]->sharedRefs == NULL, -1);
+        xmlSecAssert2(tmpls[ii] != NULL, -1);
+        if(tmpls[ii]->doc != tmpls[0]->doc) {
+            xmlSecInvalidDataError("all the signature templates must be in the same document", NULL);
+            return(-1);
+        }
+    }
 
-    dsigCtx->status = xmlSecDSigStatusInvalid;
-    if(dsigCtx->failureReason == xmlSecDSigFailureReasonUnknown) {
-        dsigCtx->failureReason = failureReason;
+    shared.ctxs = dsigCtxs;
+    shared.tmpls = tmpls;
+    shared.size = size;
+    for(ii = 0; ii < size; ++ii) {
+        shared.done = ii;
+        dsigCtxs[ii]->sharedRefs = &shared;
+        ret = xmlSecDSigCtxSign(dsigCtxs[ii], tmpls[ii]);
+        dsigCtxs[ii]->sharedRefs = NULL;
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecDSigCtxSign", NULL,
+                "signature=" XMLSEC_SIZE_FMT, ii);
+            return(-1);
+        }
     }
+    return(0);
 }
 
-
-/*
- * xmlSecDSigCtxProcessSignatureNode:
- *
- * The Signature  element (http://www.w3.org/TR/xmldsig-core/#sec-Signature)
- *
- * The Signature element is the root element of an XML Signature.
- * Implementation MUST generate laxly schema valid [XML-schema] Signature
- * elements as specified by the following schema:
- * The way in which the SignedInfo element is presented to the
- * canonicalization method is dependent on that method. The following
- * applies to algorithms which process XML as nodes or characters:
- *
- *  - XML based canonicalization implementations MUST be provided with
- *  a [XPath] node-set originally formed from the document containing
- *  the SignedInfo and currently indicating the SignedInfo, its descendants,
- *  and the attribute and namespace nodes of SignedInfo and its descendant
- *  elements.
- *
- *  - Text based canonicalization algorithms (such as CRLF and charset
- *  normalization) should be provided with the UTF-8 octets that represent
- *  the well-formed SignedInfo element, from the first character to the
- *  last character of the XML representation, inclusive. This includes
- *  the entire text of the start and end tags of the SignedInfo element
- *  as well as all descendant markup and character data (i.e., the text)
- *  between those tags. Use of text based canonicalization of SignedInfo
- *  is NOT RECOMMENDED.
- *
- *  =================================
- *  we do not support any non XML based C14N
- *
- * Schema Definition:
+/**
+ * xmlSecDSigCtxSignPrepare:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @tmpl:               the pointer to &lt;dsig:Signature/&gt; node with signature template.
  *
- *  <element name="Signature" type="ds:SignatureType"/>
- *  <complexType name="SignatureType">
- *  <sequence>
- *     <element ref="ds:SignedInfo"/>
- *     <element ref="ds:SignatureValue"/>
- *     <element ref="ds:KeyInfo" minOccurs="0"/>
- *     <element ref="ds:Object" minOccurs="0" maxOccurs="unbounded"/>
- *     </sequence> <attribute name="Id" type="ID" use="optional"/>
- *  </complexType>
+ * Does the first part of signing the data as described in @tmpl node:
+ * calculates the references digests and canonicalizes the &lt;dsig:SignedInfo/&gt;
+ * element. The signature itself (i.e. the private key operation that might
+ * take a round trip to an HSM) is calculated by #xmlSecDSigCtxSignComplete.
+ * The application can submit the latter to its own worker pool and keep
+ * many signatures in flight from one thread. If #status member of the
+ * @dsigCtx is set by this function (e.g. the references processing failed)
+ * then #xmlSecDSigCtxSignComplete should not be called.
  *
- * DTD:
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDSigCtxSignPrepare(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr tmpl) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->result == NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(tmpl->doc != NULL, -1);
+
+    prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+    ret = xmlSecDSigCtxSignInternal(dsigCtx, tmpl, 1);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxSignInternal", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecDSigCtxSignComplete:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
  *
- *  <!ELEMENT Signature (SignedInfo, SignatureValue, KeyInfo?, Object*)  >
- *  <!ATTLIST Signature
- *      xmlns   CDATA   #FIXED 'http://www.w3.org/2000/09/xmldsig#'
- *      Id      ID  #IMPLIED >
+ * Calculates the signature of the &lt;dsig:SignedInfo/&gt; element canonicalized
+ * by #xmlSecDSigCtxSignPrepare and writes it to the &lt;dsig:SignatureValue/&gt;
+ * element. The function only uses the @dsigCtx and modifies this node, thus
+ * it can be called on a different thread as long as the other threads
+ * do not modify the same document at the same time.
  *
+ * Returns: 0 on success or a negative value if an error occurs.
  */
-static int
-xmlSecDSigCtxProcessSignatureNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
-    xmlSecTransformDataType firstType;
-    xmlNodePtr signedInfoNode = NULL;
-    xmlNodePtr keyInfoNode = NULL;
-    xmlNodePtr firstReferenceNode = NULL;
-    xmlNodePtr cur;
+int
+xmlSecDSigCtxSignComplete(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecBufferPtr signedInfo;
+    xmlSecTransformPtr transform;
+    xmlSecByte* outBuf;
+    xmlSecSize outSize;
+    int outLen;
     int ret;
 
     xmlSecAssert2(dsigCtx != NULL, -1);
-    xmlSecAssert2((dsigCtx->operation == xmlSecTransformOperationSign) || (dsigCtx->operation == xmlSecTransformOperationVerify), -1);
+    xmlSecAssert2(dsigCtx->operation == xmlSecTransformOperationSign, -1);
     xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
-    xmlSecAssert2(dsigCtx->signValueNode == NULL, -1);
-    xmlSecAssert2(dsigCtx->signMethod == NULL, -1);
-    xmlSecAssert2(dsigCtx->c14nMethod == NULL, -1);
-    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(dsigCtx->result == NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod->prev == NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod->status == xmlSecTransformStatusNone, -1);
+    xmlSecAssert2(dsigCtx->signValueNode != NULL, -1);
 
-    if(!xmlSecCheckNodeName(node, xmlSecNodeSignature, xmlSecDSigNs)) {
-        xmlSecInvalidNodeError(node, xmlSecNodeSignature, NULL);
+    signedInfo = dsigCtx->transformCtx.result;
+    if((signedInfo == NULL) || (xmlSecBufferGetData(signedInfo) == NULL)) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_RESULT, NULL, "signedInfo");
         return(-1);
     }
 
-    /* read node data */
-    xmlSecAssert2(dsigCtx->id == NULL, -1);
-    dsigCtx->id = xmlGetProp(node, xmlSecAttrId);
-
-    /* first node is required SignedInfo */
-    cur = xmlSecGetNextElementNode(node->children);
-    if((cur == NULL) || (!xmlSecCheckNodeName(cur, xmlSecNodeSignedInfo, xmlSecDSigNs))) {
-        xmlSecInvalidNodeError(cur, xmlSecNodeSignedInfo, NULL);
+    /* push the canonicalized SignedInfo thru sign method -> base64 -> membuf */
+    prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+    ret = xmlSecTransformPushBin(dsigCtx->signMethod, xmlSecBufferGetData(signedInfo),
+        xmlSecBufferGetSize(signedInfo), 1, &(dsigCtx->transformCtx));
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformPushBin",
+                            xmlSecTransformGetName(dsigCtx->signMethod));
         return(-1);
     }
-    signedInfoNode = cur;
-    cur = xmlSecGetNextElementNode(cur->next);
+    for(transform = dsigCtx->signMethod; transform->next != NULL; transform = transform->next);
 
-    /* next node is required SignatureValue */
-    if((cur == NULL) || (!xmlSecCheckNodeName(cur, xmlSecNodeSignatureValue, xmlSecDSigNs))) {
-        xmlSecInvalidNodeError(cur, xmlSecNodeSignatureValue, NULL);
+    /* check what we've got */
+    dsigCtx->result = xmlSecTransformMemBufGetBuffer(transform);
+    if((dsigCtx->result == NULL) || (xmlSecBufferGetData(dsigCtx->result) == NULL)) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_RESULT, NULL, NULL);
         return(-1);
     }
-    dsigCtx->signValueNode = cur;
-    cur = xmlSecGetNextElementNode(cur->next);
 
-    /* next node is optional KeyInfo */
-    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeKeyInfo, xmlSecDSigNs))) {
-        keyInfoNode = cur;
-        cur = xmlSecGetNextElementNode(cur->next);
-    } else {
-        keyInfoNode = NULL;
-    }
+    /* write signed data to xml */
+    outBuf = xmlSecBufferGetData(dsigCtx->result);
+    outSize = xmlSecBufferGetSize(dsigCtx->result);
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(outSize, outLen, return(-1), NULL);
+    xmlNodeSetContentLen(dsigCtx->signValueNode, outBuf, outLen);
 
-    /* next nodes are optional Object nodes */
-    while((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeObject, xmlSecDSigNs))) {
-        /* read manifests from objects */
-        if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_IGNORE_MANIFESTS) == 0) {
-            ret = xmlSecDSigCtxProcessObjectNode(dsigCtx, cur);
-            if(ret < 0) {
-                xmlSecInternalError("xmlSecDSigCtxProcessObjectNode", NULL);
-                return(-1);
-            }
-        }
-        cur = xmlSecGetNextElementNode(cur->next);
-    }
+    /* set success status and we are done */
+    xmlSecDSigCtxMarkAsSucceeded(dsigCtx);
+    return(0);
+}
 
-    /* if there is something left than it's an error */
-    if(cur != NULL) {
-        xmlSecUnexpectedNodeError(cur,  NULL);
+/* takes the sign method (the last one) out of the transforms chain and
+ * connects it to its own base64 encode -> membuf chain */
+static int
+xmlSecDSigCtxDetachSignMethod(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecTransformPtr base64Encode;
+    xmlSecTransformPtr memBuf;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod->prev != NULL, -1);
+    xmlSecAssert2(dsigCtx->transformCtx.last == dsigCtx->signMethod, -1);
+
+    dsigCtx->transformCtx.last = dsigCtx->signMethod->prev;
+    xmlSecTransformRemove(dsigCtx->signMethod);
+
+    base64Encode = xmlSecTransformCreate(xmlSecTransformBase64Id);
+    if(base64Encode == NULL) {
+        xmlSecInternalError("xmlSecTransformCreate",
+                            xmlSecTransformKlassGetName(xmlSecTransformBase64Id));
         return(-1);
     }
+    base64Encode->operation = xmlSecTransformOperationEncode;
 
-    /* now validated all the references and prepare transform */
-    ret = xmlSecDSigCtxProcessSignedInfoNode(dsigCtx, signedInfoNode, &firstReferenceNode);
+    ret = xmlSecTransformConnect(dsigCtx->signMethod, base64Encode, &(dsigCtx->transformCtx));
     if(ret < 0) {
-        xmlSecInternalError("xmlSecDSigCtxProcessSignedInfoNode", NULL);
+        xmlSecInternalError("xmlSecTransformConnect",
+                            xmlSecTransformGetName(dsigCtx->signMethod));
+        xmlSecTransformDestroy(base64Encode);
         return(-1);
     }
 
-    /* as the result, we should have sign and c14n methods set */
-    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
-    xmlSecAssert2(dsigCtx->c14nMethod != NULL, -1);
-
-    /* now read key info node */
-    ret = xmlSecDSigCtxProcessKeyInfoNode(dsigCtx, keyInfoNode);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecDSigCtxProcessKeyInfoNode", NULL);
+    memBuf = xmlSecTransformCreate(xmlSecTransformMemBufId);
+    if(memBuf == NULL) {
+        xmlSecInternalError("xmlSecTransformCreate",
+                            xmlSecTransformKlassGetName(xmlSecTransformMemBufId));
         return(-1);
     }
-    /* as the result, we should have a key */
-    xmlSecAssert2(dsigCtx->signKey != NULL, -1);
 
-    /* now actually process references and calculate digests */
-    ret = xmlSecDSigCtxProcessReferences(dsigCtx, firstReferenceNode);
+    ret = xmlSecTransformConnect(base64Encode, memBuf, &(dsigCtx->transformCtx));
     if(ret < 0) {
-        xmlSecInternalError("xmlSecDSigCtxProcessReferences", NULL);
+        xmlSecInternalError("xmlSecTransformConnect",
+                            xmlSecTransformGetName(base64Encode));
+        xmlSecTransformDestroy(memBuf);
         return(-1);
     }
-    /* references processing might change the status */
-    if(dsigCtx->status != xmlSecDSigStatusUnknown) {
-        return(0);
+    return(0);
+}
+
+/* the sign method attached to the chain always follows the c14n method */
+static void
+xmlSecDSigCtxDestroyDetachedSignMethod(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecTransformPtr transform, tmp;
+
+    xmlSecAssert(dsigCtx != NULL);
+
+    if((dsigCtx->signMethod == NULL) || (dsigCtx->signMethod->prev != NULL)) {
+        return;
     }
+    for(transform = dsigCtx->signMethod; transform != NULL; transform = tmp) {
+        tmp = transform->next;
+        xmlSecTransformDestroy(transform);
+    }
+    dsigCtx->signMethod = NULL;
+}
 
-    /* if we need to write result to xml node then we need base64 encode result */
-    if(dsigCtx->operation == xmlSecTransformOperationSign) {
-        xmlSecTransformPtr base64Encode;
+static int
+xmlSecDSigCtxSignInternal(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr tmpl, int deferSign) {
+    xmlSecStatsSpan span;
+    int ret;
+    int res = -1;
 
-        /* we need to add base64 encode transform */
-        base64Encode = xmlSecTransformCtxCreateAndAppend(&(dsigCtx->transformCtx),
-                                                         xmlSecTransformBase64Id);
-        if(base64Encode == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
-            return(-1);
-        }
-        base64Encode->operation = xmlSecTransformOperationEncode;
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(tmpl->doc != NULL, -1);
+
+    xmlSecStatsOpStart(xmlSecStatsOpDSigSign, &span);
+
+    /* add ids for Signature nodes */
+    dsigCtx->operation  = xmlSecTransformOperationSign;
+    dsigCtx->status     = xmlSecDSigStatusUnknown;
+    xmlSecAddIDs(tmpl->doc, tmpl, xmlSecDSigIds);
+
+    ret = xmlSecDSigCtxPrepareArena(dsigCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxPrepareArena", NULL);
+        goto done;
     }
 
-    firstType = xmlSecTransformGetDataType(dsigCtx->transformCtx.first,
-                                           xmlSecTransformModePush,
-                                           &(dsigCtx->transformCtx));
-    if((firstType & xmlSecTransformDataTypeXml) != 0) {
-        xmlSecNodeSetPtr nodeset = NULL;
+    /* read signature template */
+    ret = xmlSecDSigCtxProcessSignatureNode(dsigCtx, tmpl, deferSign);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxProcessSignatureNode", NULL);
+        goto done;
+    }
+    if((dsigCtx->signMethod == NULL) || (dsigCtx->signValueNode == NULL)) {
+        xmlSecInvalidDataError("signature method or value is not set", NULL);
+        goto done;
+    }
 
-        xmlSecAssert2(signedInfoNode != NULL, -1);
-        nodeset = xmlSecNodeSetGetChildren(signedInfoNode->doc, signedInfoNode, 1, 0);
-        if(nodeset == NULL) {
-            xmlSecInternalError("xmlSecNodeSetGetChildren(signedInfoNode)", NULL);
-            return(-1);
-        }
+    /* success */
+    res = 0;
 
-        /* calculate the signature */
-        ret = xmlSecTransformCtxXmlExecute(&(dsigCtx->transformCtx), nodeset);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecTransformCtxXmlExecute", NULL);
-            xmlSecNodeSetDestroy(nodeset);
-            return(-1);
-        }
-        xmlSecNodeSetDestroy(nodeset);
-    } else {
-        /* TODO */
-        xmlSecNotImplementedError("binary c14n transforms");
-        return(-1);
+done:
+    if((res < 0) && (xmlSecTransformCtxIsDeadlineExceeded(&(dsigCtx->transformCtx)) != 0)) {
+        dsigCtx->failureReason = xmlSecDSigFailureReasonDeadline;
     }
-    return(0);
+    /* the references processing failures are reported in the status */
+    xmlSecStatsOpEnd(&span, ((res < 0) || (dsigCtx->status == xmlSecDSigStatusInvalid)) ? 1 : 0);
+    return(res);
 }
 
-/**
- * xmlSecDSigCtxProcessSignedInfoNode:
- *
- * The SignedInfo Element (http://www.w3.org/TR/xmldsig-core/#sec-SignedInfo)
- *
- * The structure of SignedInfo includes the canonicalization algorithm,
- * a result algorithm, and one or more references. The SignedInfo element
- * may contain an optional ID attribute that will allow it to be referenced by
- * other signatures and objects.
- *
- * SignedInfo does not include explicit result or digest properties (such as
- * calculation time, cryptographic device serial number, etc.). If an
- * application needs to associate properties with the result or digest,
- * it may include such information in a SignatureProperties element within
- * an Object element.
- *
- * Schema Definition:
- *
- *  <element name="SignedInfo" type="ds:SignedInfoType"/>
- *  <complexType name="SignedInfoType">
- *    <sequence>
- *      <element ref="ds:CanonicalizationMethod"/>
- *      <element ref="ds:SignatureMethod"/>
- *      <element ref="ds:Reference" maxOccurs="unbounded"/>
- *    </sequence>
- *    <attribute name="Id" type="ID" use="optional"/>
- *  </complexType>
- *
- * DTD:
- *
- *  <!ELEMENT SignedInfo (CanonicalizationMethod, SignatureMethod,  Reference+) >
- *  <!ATTLIST SignedInfo  Id   ID      #IMPLIED>
- *
- */
+/* sign-on-serialize: the output before the enveloped signature is written while
+ * it is digested, the output after it is kept until the signature is calculated */
+typedef struct _xmlSecDSigSerializeCtx {
+    xmlSecTransformCtx          digestCtx;
+    xmlSecTransformPtr          digestMethod;
+    xmlOutputBufferPtr          out;
+    xmlSecBuffer                tail;
+} xmlSecDSigSerializeCtx, *xmlSecDSigSerializeCtxPtr;
+
 static int
-xmlSecDSigCtxProcessSignedInfoNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node, xmlNodePtr * firstReferenceNode) {
-    xmlSecSize refNodesCount = 0;
-    xmlNodePtr cur;
+xmlSecDSigSerializeHeadWrite(void* context, const char* buffer, int len) {
+    xmlSecDSigSerializeCtxPtr ctx = (xmlSecDSigSerializeCtxPtr)context;
+    xmlSecSize size;
+    int ret;
 
-    xmlSecAssert2(dsigCtx != NULL, -1);
-    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
-    xmlSecAssert2(dsigCtx->signMethod == NULL, -1);
-    xmlSecAssert2(dsigCtx->c14nMethod == NULL, -1);
-    xmlSecAssert2((dsigCtx->operation == xmlSecTransformOperationSign) || (dsigCtx->operation == xmlSecTransformOperationVerify), -1);
-    xmlSecAssert2(node != NULL, -1);
-    xmlSecAssert2(firstReferenceNode != NULL, -1);
-    xmlSecAssert2((*firstReferenceNode) == NULL, -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->digestMethod != NULL, -1);
 
-    /* first node is required CanonicalizationMethod. */
-    cur = xmlSecGetNextElementNode(node->children);
-    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeCanonicalizationMethod, xmlSecDSigNs))) {
-        dsigCtx->c14nMethod = xmlSecTransformCtxNodeRead(&(dsigCtx->transformCtx),
-                                        cur, xmlSecTransformUsageC14NMethod);
-        if(dsigCtx->c14nMethod == NULL) {
-            xmlSecInternalError2("xmlSecTransformCtxNodeRead", NULL,
-                                "node=%s", xmlSecErrorsSafeString(xmlSecNodeGetName(cur)));
-            return(-1);
-        }
-    } else if(dsigCtx->defC14NMethodId != xmlSecTransformIdUnknown) {
-        /* the dsig spec does require CanonicalizationMethod node
-         * to be present but in some case it application might decide to
-         * minimize traffic */
-        dsigCtx->c14nMethod = xmlSecTransformCtxCreateAndAppend(&(dsigCtx->transformCtx),
-                                                              dsigCtx->defC14NMethodId);
-        if(dsigCtx->c14nMethod == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
-            return(-1);
-        }
-    } else {
-        /* if c14n method is not specified in the template and not specified in
-         * the dsig context then it's an error.
-         */
-        xmlSecInvalidNodeError(cur, xmlSecNodeCanonicalizationMethod, NULL);
-        return(-1);
+    if(len <= 0) {
+        return(0);
     }
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(len, size, return(-1), NULL);
 
-    /* insert membuf if requested */
-    if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNATURE) != 0) {
-        xmlSecAssert2(dsigCtx->preSignMemBufMethod == NULL, -1);
-        dsigCtx->preSignMemBufMethod = xmlSecTransformCtxCreateAndAppend(&(dsigCtx->transformCtx),
-                                                xmlSecTransformMemBufId);
-        if(dsigCtx->preSignMemBufMethod == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend",
-                                xmlSecTransformKlassGetName(xmlSecTransformMemBufId));
-            return(-1);
-        }
+    ret = xmlSecTransformPushBin(ctx->digestMethod, (const xmlSecByte*)buffer, size, 0, &(ctx->digestCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformPushBin", xmlSecTransformGetName(ctx->digestMethod));
+        return(-1);
     }
 
-    /* next node is required SignatureMethod. */
-    cur = xmlSecGetNextElementNode( ((cur != NULL) ? cur->next : node->children) );
-    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeSignatureMethod, xmlSecDSigNs))) {
-        dsigCtx->signMethod = xmlSecTransformCtxNodeRead(&(dsigCtx->transformCtx),
-                                        cur, xmlSecTransformUsageSignatureMethod);
-        if(dsigCtx->signMethod == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxNodeRead",
-                                xmlSecNodeGetName(cur));
-            return(-1);
-        }
-        cur = xmlSecGetNextElementNode(cur->next);
-    } else if(dsigCtx->defSignMethodId != xmlSecTransformIdUnknown) {
-        /* the dsig spec does require SignatureMethod node
-         * to be present but in some case it application might decide to
-         * minimize traffic */
-        dsigCtx->signMethod = xmlSecTransformCtxCreateAndAppend(&(dsigCtx->transformCtx),
-                                                              dsigCtx->defSignMethodId);
-        if(dsigCtx->signMethod == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
+    /* the streaming verification only digests the output */
+    if(ctx->out != NULL) {
+        ret = xmlOutputBufferWrite(ctx->out, len, buffer);
+        if(ret < 0) {
+            xmlSecXmlError("xmlOutputBufferWrite", NULL);
             return(-1);
         }
-    } else {
-        /* if sign method is not specified in the template and not specified in
-         * the dsig context then it's an error.
-         */
-        xmlSecInvalidNodeError(cur, xmlSecNodeSignatureMethod, NULL);
-        return(-1);
     }
-    dsigCtx->signMethod->operation = dsigCtx->operation;
+    return(len);
+}
 
-    /* read references */
-    while((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs))) {
-        /* record first reference node */
-        if((*firstReferenceNode) == NULL) {
-            (*firstReferenceNode) = cur;
-        }
-        ++refNodesCount;
+static int
+xmlSecDSigSerializeTailWrite(void* context, const char* buffer, int len) {
+    xmlSecDSigSerializeCtxPtr ctx = (xmlSecDSigSerializeCtxPtr)context;
+    xmlSecSize size;
+    int ret;
 
-        /* go to next */
-        cur = xmlSecGetNextElementNode(cur->next);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->digestMethod != NULL, -1);
+
+    if(len <= 0) {
+        return(0);
     }
+    XMLSEC_SAFE_CAST_INT_TO_SIZE(len, size, return(-1), NULL);
 
-    /* check that we have at least one Reference */
-    if(refNodesCount == 0) {
-        xmlSecOtherError(XMLSEC_ERRORS_R_DSIG_NO_REFERENCES, NULL, NULL);
+    ret = xmlSecTransformPushBin(ctx->digestMethod, (const xmlSecByte*)buffer, size, 0, &(ctx->digestCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformPushBin", xmlSecTransformGetName(ctx->digestMethod));
         return(-1);
     }
-
-    /* if there is something left than it's an error */
-    if(cur != NULL) {
-        xmlSecUnexpectedNodeError(cur,  NULL);
+    ret = xmlSecBufferAppend(&(ctx->tail), (const xmlSecByte*)buffer, size);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
         return(-1);
     }
-
-    /* done */
-    return(0);
+    return(len);
 }
 
-
+/* returns 1 if @node is &lt;dsig:Transform/&gt; or &lt;dsig:DigestMethod/&gt;
+ * node with one of the @ids algorithms (and @id is set), 0 otherwise */
 static int
-xmlSecDSigCtxProcessReferences(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr firstReferenceNode) {
-    xmlSecDSigReferenceCtxPtr dsigRefCtx;
-    xmlNodePtr cur;
-    int ret;
+xmlSecDSigSerializeGetAlgorithm(xmlNodePtr node, const xmlChar* name, const xmlSecTransformId* ids,
+                                xmlSecTransformUsage usage, xmlSecTransformId* id) {
+    xmlChar* href;
+    xmlSecSize ii;
 
-    xmlSecAssert2(dsigCtx != NULL, -1);
-    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
-    xmlSecAssert2((dsigCtx->operation == xmlSecTransformOperationSign) || (dsigCtx->operation == xmlSecTransformOperationVerify), -1);
-    xmlSecAssert2(xmlSecPtrListGetSize(&(dsigCtx->signedInfoReferences)) == 0, -1);
-    xmlSecAssert2(firstReferenceNode != NULL, -1);
+    xmlSecAssert2(name != NULL, 0);
+    xmlSecAssert2(id != NULL, 0);
 
-    /* process references */
-    for(cur = firstReferenceNode; (cur != NULL); cur = xmlSecGetNextElementNode(cur->next)) {
-        /* already checked but we trust none */
-        if(!xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs)) {
-            xmlSecInvalidNodeError(cur, xmlSecNodeReference, NULL);
-            return(-1);
-        }
+    if((node == NULL) || (!xmlSecCheckNodeName(node, name, xmlSecDSigNs))) {
+        return(0);
+    }
+    href = xmlGetProp(node, xmlSecAttrAlgorithm);
+    if(href == NULL) {
+        return(0);
+    }
 
-        /* create reference */
-        dsigRefCtx = xmlSecDSigReferenceCtxCreate(dsigCtx, xmlSecDSigReferenceOriginSignedInfo);
-        if(dsigRefCtx == NULL) {
-            xmlSecInternalError("xmlSecDSigReferenceCtxCreate", NULL);
-            return(-1);
+    (*id) = xmlSecTransformIdUnknown;
+    if(ids != NULL) {
+        for(ii = 0; ids[ii] != xmlSecTransformIdUnknown; ++ii) {
+            if(xmlStrEqual(href, ids[ii]->href)) {
+                (*id) = ids[ii];
+                break;
+            }
         }
+    } else {
+        (*id) = xmlSecTransformIdListFindByHref(xmlSecTransformIdsGet(), href, usage);
+    }
+    xmlFree(href);
+    return(((*id) != xmlSecTransformIdUnknown) ? 1 : 0);
+}
 
-        /* add to the list */
-        ret = xmlSecPtrListAdd(&(dsigCtx->signedInfoReferences), dsigRefCtx);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecPtrListAdd", NULL);
-            xmlSecDSigReferenceCtxDestroy(dsigRefCtx);
-            return(-1);
+/* returns 1 if the template has one &lt;dsig:Reference URI=""/&gt; with the enveloped
+ * signature and c14n transforms (and the out parameters are set), 0 otherwise */
+static int
+xmlSecDSigSerializeReadTemplate(xmlNodePtr tmpl, xmlSecTransformId* c14nId, xmlChar** prefixList,
+                                xmlSecTransformId* digestId, xmlNodePtr* digestValueNode) {
+    const xmlSecTransformId envelopedIds[] = {
+        xmlSecTransformEnvelopedId, xmlSecTransformIdUnknown
+    };
+    const xmlSecTransformId c14nIds[] = {
+        xmlSecTransformInclC14NId, xmlSecTransformInclC14NWithCommentsId,
+        xmlSecTransformExclC14NId, xmlSecTransformExclC14NWithCommentsId,
+        xmlSecTransformIdUnknown
+    };
+    xmlSecTransformId id;
+    xmlNodePtr ref = NULL;
+    xmlNodePtr cur, transform;
+    xmlChar* uri;
+
+    xmlSecAssert2(tmpl != NULL, 0);
+    xmlSecAssert2(c14nId != NULL, 0);
+    xmlSecAssert2(prefixList != NULL, 0);
+    xmlSecAssert2(digestId != NULL, 0);
+    xmlSecAssert2(digestValueNode != NULL, 0);
+
+    /* one reference to the whole document */
+    cur = xmlSecGetNextElementNode(tmpl->children);
+    if((cur == NULL) || (!xmlSecCheckNodeName(cur, xmlSecNodeSignedInfo, xmlSecDSigNs))) {
+        return(0);
+    }
+    for(cur = xmlSecGetNextElementNode(cur->children); cur != NULL; cur = xmlSecGetNextElementNode(cur->next)) {
+        if(xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs)) {
+            if(ref != NULL) {
+                return(0);
+            }
+            ref = cur;
         }
+    }
+    if(ref == NULL) {
+        return(0);
+    }
+    uri = xmlGetProp(ref, xmlSecAttrURI);
+    if(uri == NULL) {
+        return(0);
+    } else if(uri[0] != '\0') {
+        xmlFree(uri);
+        return(0);
+    }
+    xmlFree(uri);
 
-        /* process */
-        ret = xmlSecDSigReferenceCtxProcessNode(dsigRefCtx, cur);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecDSigReferenceCtxProcessNode",
-                                xmlSecNodeGetName(cur));
-            return(-1);
+    /* enveloped signature and c14n transforms */
+    cur = xmlSecGetNextElementNode(ref->children);
+    if((cur == NULL) || (!xmlSecCheckNodeName(cur, xmlSecNodeTransforms, xmlSecDSigNs))) {
+        return(0);
+    }
+    transform = xmlSecGetNextElementNode(cur->children);
+    if((xmlSecDSigSerializeGetAlgorithm(transform, xmlSecNodeTransform, envelopedIds, xmlSecTransformUsageDSigTransform, &id) != 1) ||
+       (xmlSecGetNextElementNode(transform->children) != NULL)) {
+        return(0);
+    }
+    transform = xmlSecGetNextElementNode(transform->next);
+    if((xmlSecDSigSerializeGetAlgorithm(transform, xmlSecNodeTransform, c14nIds, xmlSecTransformUsageDSigTransform, c14nId) != 1) ||
+       (xmlSecGetNextElementNode(transform->next) != NULL)) {
+        return(0);
+    }
+    (*prefixList) = NULL;
+    if(xmlSecGetNextElementNode(transform->children) != NULL) {
+        transform = xmlSecGetNextElementNode(transform->children);
+        if(((*c14nId) != xmlSecTransformExclC14NId) && ((*c14nId) != xmlSecTransformExclC14NWithCommentsId)) {
+            return(0);
         }
-
-        /* bail out if next Reference processing failed */
-        if(dsigRefCtx->status != xmlSecDSigStatusSucceeded) {
-            xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonReference);
+        if((!xmlSecCheckNodeName(transform, xmlSecNodeInclusiveNamespaces, xmlSecNsExcC14N)) ||
+           (xmlSecGetNextElementNode(transform->next) != NULL)) {
+            return(0);
+        }
+        (*prefixList) = xmlGetProp(transform, xmlSecAttrPrefixList);
+        if((*prefixList) == NULL) {
             return(0);
         }
     }
 
-    /* done */
+    /* digest method and value */
+    cur = xmlSecGetNextElementNode(cur->next);
+    if((xmlSecDSigSerializeGetAlgorithm(cur, xmlSecNodeDigestMethod, NULL, xmlSecTransformUsageDigestMethod, digestId) != 1) ||
+       (xmlSecGetNextElementNode(cur->children) != NULL)) {
+        goto error;
+    }
+    cur = xmlSecGetNextElementNode(cur->next);
+    if((cur == NULL) || (!xmlSecCheckNodeName(cur, xmlSecNodeDigestValue, xmlSecDSigNs)) ||
+       (xmlSecGetNextElementNode(cur->next) != NULL)) {
+        goto error;
+    }
+    (*digestValueNode) = cur;
+    return(1);
+
+error:
+    if((*prefixList) != NULL) {
+        xmlFree(*prefixList);
+        (*prefixList) = NULL;
+    }
     return(0);
 }
 
+/* the InclusiveNamespaces PrefixList is space separated (same as in c14n.c) */
+static xmlChar**
+xmlSecDSigSerializeSplitPrefixList(xmlChar* list) {
+    xmlChar** res;
+    xmlChar *p, *n;
+    xmlSecSize size, ii;
+
+    xmlSecAssert2(list != NULL, NULL);
+
+    for(p = list, size = 2; (*p) != '\0'; ++p) {
+        if((*p) == ' ') {
+            ++size;
+        }
+    }
+    res = (xmlChar**)xmlMalloc(sizeof(xmlChar*) * size);
+    if(res == NULL) {
+        xmlSecMallocError(sizeof(xmlChar*) * size, NULL);
+        return(NULL);
+    }
+    for(p = n = list, ii = 0; ((p != NULL) && ((*p) != '\0')); p = n) {
+        n = (xmlChar*)xmlStrchr(p, ' ');
+        if(n != NULL) {
+            *(n++) = '\0';
+        }
+        xmlSecAssert2(ii + 1 < size, NULL);
+        res[ii++] = p;
+    }
+    res[ii] = NULL;
+    return(res);
+}
 
+/* sets the digest, signs @tmpl and writes it followed by the buffered end
+ * of the document into @out */
 static int
-xmlSecDSigCtxProcessKeyInfoNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
+xmlSecDSigSerializeSignAndWrite(xmlSecDSigCtxPtr dsigCtx, xmlSecDSigSerializeCtxPtr ctx, xmlNodePtr tmpl,
+                                xmlNodePtr digestValueNode, xmlC14NMode mode, xmlChar** prefixes,
+                                int withComments, xmlOutputBufferPtr out) {
+    struct _xmlSecDSigDirtyNodes dirty;
+    xmlSecNodeSetPtr nodes = NULL;
+    xmlChar* digestValue = NULL;
+    xmlSecSize tailSize;
+    int tailLen;
     int ret;
+    int res = -1;
 
     xmlSecAssert2(dsigCtx != NULL, -1);
-    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->digestMethod != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(digestValueNode != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
 
-    /* set key requirements */
-    ret = xmlSecTransformSetKeyReq(dsigCtx->signMethod, &(dsigCtx->keyInfoReadCtx.keyReq));
+    /* the digest is the last transform: push would drop the result */
+    ret = xmlSecTransformExecute(ctx->digestMethod, 1, &(ctx->digestCtx));
     if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformSetKeyReq", xmlSecTransformGetName(dsigCtx->signMethod));
-        return(-1);
+        xmlSecInternalError("xmlSecTransformExecute", xmlSecTransformGetName(ctx->digestMethod));
+        goto done;
     }
+    digestValue = xmlSecBase64Encode(xmlSecBufferGetData(&(ctx->digestMethod->outBuf)),
+                                     xmlSecBufferGetSize(&(ctx->digestMethod->outBuf)),
+                                     xmlSecBase64GetDefaultLineSize());
+    if(digestValue == NULL) {
+        xmlSecInternalError("xmlSecBase64Encode", NULL);
+        goto done;
+    }
+    xmlNodeSetContent(digestValueNode, digestValue);
 
-    /* ignore <dsig:KeyInfo /> if there is the key is already set */
-    /* todo: throw an error if key is set and node != NULL? */
-    if((dsigCtx->signKey == NULL) && (dsigCtx->keyInfoReadCtx.keysMngr != NULL)
-                        && (dsigCtx->keyInfoReadCtx.keysMngr->getKey != NULL)) {
-        dsigCtx->signKey = (dsigCtx->keyInfoReadCtx.keysMngr->getKey)(node, &(dsigCtx->keyInfoReadCtx));
+    /* calculate the signature, the digest is already set */
+    dirty.signature = tmpl;
+    dirty.nodes = NULL;
+    dirty.size = 0;
+    dirty.keepDigests = 1;
+
+    dsigCtx->dirtyNodes = &dirty;
+    ret = xmlSecDSigCtxSign(dsigCtx, tmpl);
+    dsigCtx->dirtyNodes = NULL;
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxSign", NULL);
+        goto done;
+    }
+    if(dsigCtx->status != xmlSecDSigStatusSucceeded) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_RESULT, NULL, NULL);
+        goto done;
     }
 
-    /* check that we have exactly what we want */
-    if((dsigCtx->signKey == NULL) || (!xmlSecKeyMatch(dsigCtx->signKey, NULL, &(dsigCtx->keyInfoReadCtx.keyReq)))) {
-        xmlSecOtherError(XMLSEC_ERRORS_R_KEY_NOT_FOUND, NULL, NULL);
-        xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonKeyNotFound);
-        return(-1);
+    /* write the signature and the rest of the document */
+    nodes = xmlSecNodeSetGetChildren(tmpl->doc, tmpl, 0, 0);
+    if(nodes == NULL) {
+        xmlSecInternalError("xmlSecNodeSetGetChildren", NULL);
+        goto done;
+    }
+    ret = xmlSecC14NNativeExecute(nodes, mode, prefixes, withComments, out);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeExecute", NULL);
+        goto done;
+    }
+    tailSize = xmlSecBufferGetSize(&(ctx->tail));
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(tailSize, tailLen, goto done, NULL);
+    ret = xmlOutputBufferWrite(out, tailLen, (const char*)xmlSecBufferGetData(&(ctx->tail)));
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferWrite", NULL);
+        goto done;
+    }
+    ret = xmlOutputBufferFlush(out);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferFlush", NULL);
+        goto done;
     }
 
-    /* set the key to the transform */
-    ret = xmlSecTransformSetKey(dsigCtx->signMethod, dsigCtx->signKey);
+    /* success */
+    res = 0;
+
+done:
+    if(nodes != NULL) {
+        xmlSecNodeSetDestroy(nodes);
+    }
+    if(digestValue != NULL) {
+        xmlFree(digestValue);
+    }
+    return(res);
+}
+
+/* returns 1 if the document was signed and written, 0 if the template is not supported
+ * or a negative value if an error occurs */
+static int
+xmlSecDSigCtxSignOnSerialize(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr tmpl, xmlOutputBufferPtr out) {
+    xmlSecDSigSerializeCtx ctx;
+    xmlSecTransformId c14nId = xmlSecTransformIdUnknown;
+    xmlSecTransformId digestId = xmlSecTransformIdUnknown;
+    xmlChar* prefixList = NULL;
+    xmlChar** prefixes = NULL;
+    xmlNodePtr digestValueNode = NULL;
+    xmlSecNodeSetPtr nodes = NULL;
+    xmlSecNodeSetPtr children;
+    xmlOutputBufferPtr headBuf = NULL;
+    xmlOutputBufferPtr tailBuf = NULL;
+    xmlC14NMode mode;
+    int withComments;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(tmpl->doc != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    /* everything that changes the reference processing goes the usual way */
+    if(((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES) != 0) ||
+       ((dsigCtx->transformCtx.flags & XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N) != 0) ||
+       (dsigCtx->referencePreExecuteCallback != NULL) ||
+       ((dsigCtx->enabledReferenceTransforms != NULL) && (xmlSecPtrListGetSize(dsigCtx->enabledReferenceTransforms) > 0)) ||
+       (xmlSecTransformUriTypeCheck(dsigCtx->enabledReferenceUris, BAD_CAST "") != 1) ||
+       (out->encoder != NULL) ||
+       (tmpl->parent == NULL) || (tmpl->parent->type != XML_ELEMENT_NODE)) {
+        return(0);
+    }
+    if(xmlSecDSigSerializeReadTemplate(tmpl, &c14nId, &prefixList, &digestId, &digestValueNode) != 1) {
+        return(0);
+    }
+    if((c14nId == xmlSecTransformExclC14NId) || (c14nId == xmlSecTransformExclC14NWithCommentsId)) {
+        mode = XML_C14N_EXCLUSIVE_1_0;
+    } else {
+        mode = XML_C14N_1_0;
+    }
+    withComments = ((c14nId == xmlSecTransformInclC14NWithCommentsId) ||
+                    (c14nId == xmlSecTransformExclC14NWithCommentsId)) ? 1 : 0;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ret = xmlSecTransformCtxInitialize(&(ctx.digestCtx));
     if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformSetKey", xmlSecTransformGetName(dsigCtx->signMethod));
+        xmlSecInternalError("xmlSecTransformCtxInitialize", NULL);
+        xmlFree(prefixList);
+        return(-1);
+    }
+    ret = xmlSecBufferInitialize(&(ctx.tail), 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        xmlSecTransformCtxFinalize(&(ctx.digestCtx));
+        xmlFree(prefixList);
         return(-1);
     }
+    ctx.out = out;
 
-    /* if we are signing document, update &lt;dsig:KeyInfo/&gt; node */
-    if((node != NULL) && (dsigCtx->operation == xmlSecTransformOperationSign)) {
-        ret = xmlSecKeyInfoNodeWrite(node, dsigCtx->signKey, &(dsigCtx->keyInfoWriteCtx));
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecKeyInfoNodeWrite", NULL);
-            return(-1);
+    if(prefixList != NULL) {
+        prefixes = xmlSecDSigSerializeSplitPrefixList(prefixList);
+        if(prefixes == NULL) {
+            xmlSecInternalError("xmlSecDSigSerializeSplitPrefixList", NULL);
+            goto done;
         }
     }
 
-    return(0);
+    /* same nodes as URI="" with the enveloped signature transform */
+    nodes = xmlSecNodeSetGetChildren(tmpl->doc, NULL, 0, 0);
+    if(nodes == NULL) {
+        xmlSecInternalError("xmlSecNodeSetGetChildren", NULL);
+        goto done;
+    }
+    children = xmlSecNodeSetGetChildren(tmpl->doc, tmpl, 1, 1);
+    if(children == NULL) {
+        xmlSecInternalError("xmlSecNodeSetGetChildren", NULL);
+        goto done;
+    }
+    nodes = xmlSecNodeSetAdd(nodes, children, xmlSecNodeSetIntersection);
+    if(nodes == NULL) {
+        xmlSecInternalError("xmlSecNodeSetAdd", NULL);
+        xmlSecNodeSetDestroy(children);
+        goto done;
+    }
+    if(xmlSecC14NNativeIsSupported(nodes, mode) == 0) {
+        res = 0;
+        goto done;
+    }
+
+    /* canonicalize the document once: write and digest */
+    ctx.digestMethod = xmlSecTransformCtxCreateAndAppend(&(ctx.digestCtx), digestId);
+    if(ctx.digestMethod == NULL) {
+        xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", xmlSecTransformKlassGetName(digestId));
+        goto done;
+    }
+    ctx.digestMethod->operation = xmlSecTransformOperationSign;
+
+    headBuf = xmlOutputBufferCreateIO(xmlSecDSigSerializeHeadWrite, NULL, &ctx, NULL);
+    if(headBuf == NULL) {
+        xmlSecXmlError("xmlOutputBufferCreateIO", NULL);
+        goto done;
+    }
+    tailBuf = xmlOutputBufferCreateIO(xmlSecDSigSerializeTailWrite, NULL, &ctx, NULL);
+    if(tailBuf == NULL) {
+        xmlSecXmlError("xmlOutputBufferCreateIO", NULL);
+        goto done;
+    }
+    ret = xmlSecC14NNativeExecuteSplit(nodes, mode, prefixes, withComments, headBuf, tailBuf);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeExecuteSplit", NULL);
+        goto done;
+    }
+    ret = xmlOutputBufferClose(headBuf);
+    headBuf = NULL;
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        goto done;
+    }
+    ret = xmlOutputBufferClose(tailBuf);
+    tailBuf = NULL;
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        goto done;
+    }
+    /* the signature parent is an element: its end tag is always after the signature */
+    if(xmlSecBufferGetSize(&(ctx.tail)) == 0) {
+        xmlSecInvalidDataError("the signature position is not found", NULL);
+        goto done;
+    }
+
+    /* sign and write the signature and the rest of the document */
+    ret = xmlSecDSigSerializeSignAndWrite(dsigCtx, &ctx, tmpl, digestValueNode, mode, prefixes, withComments, out);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigSerializeSignAndWrite", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 1;
+
+done:
+    if(tailBuf != NULL) {
+        (void)xmlOutputBufferClose(tailBuf);
+    }
+    if(headBuf != NULL) {
+        (void)xmlOutputBufferClose(headBuf);
+    }
+    if(nodes != NULL) {
+        xmlSecNodeSetDestroy(nodes);
+    }
+    if(prefixes != NULL) {
+        xmlFree(prefixes);
+    }
+    if(prefixList != NULL) {
+        xmlFree(prefixList);
+    }
+    xmlSecBufferFinalize(&(ctx.tail));
+    xmlSecTransformCtxFinalize(&(ctx.digestCtx));
+    return(res);
 }
 
-/**
- * xmlSecDSigCtxProcessObjectNode:
- *
- * The Object Element (http://www.w3.org/TR/xmldsig-core/#sec-Object)
- *
- * Object is an optional element that may occur one or more times. When
- * present, this element may contain any data. The Object element may include
- * optional MIME type, ID, and encoding attributes.
- *
- * Schema Definition:
- *
- * <element name="Object" type="ds:ObjectType"/>
- * <complexType name="ObjectType" mixed="true">
- *   <sequence minOccurs="0" maxOccurs="unbounded">
- *     <any namespace="##any" processContents="lax"/>
- *   </sequence>
- *   <attribute name="Id" type="ID" use="optional"/>
- *   <attribute name="MimeType" type="string" use="optional"/>
- *   <attribute name="Encoding" type="anyURI" use="optional"/>
- * </complexType>
- *
- * DTD:
- *
- * <!ELEMENT Object (#PCDATA|Signature|SignatureProperties|Manifest %Object.ANY;)* >
- * <!ATTLIST Object  Id  ID  #IMPLIED
- *                   MimeType    CDATA   #IMPLIED
- *                   Encoding    CDATA   #IMPLIED >
- */
+#ifdef LIBXML_READER_ENABLED
+/* the enveloped signature for the streaming verification is the first
+ * &lt;dsig:Signature/&gt; element below the document element */
 static int
-xmlSecDSigCtxProcessObjectNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
-    xmlNodePtr cur;
-    int ret;
+xmlSecDSigStreamIsSignature(xmlTextReaderPtr reader) {
+    xmlSecAssert2(reader != NULL, 0);
+
+    return((xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) &&
+           (xmlTextReaderDepth(reader) > 0) &&
+           xmlStrEqual(xmlTextReaderConstLocalName(reader), xmlSecNodeSignature) &&
+           xmlStrEqual(xmlTextReaderConstNamespaceUri(reader), xmlSecDSigNs));
+}
+
+/* adds the namespaces and the xml:* attributes of the @parent element that
+ * are not defined in @node (the @node is moved out of the @parent scope) */
+static int
+xmlSecDSigStreamAddInherited(xmlNodePtr node, xmlNodePtr parent) {
+    xmlNsPtr ns, curNs;
+    xmlAttrPtr attr;
+    xmlChar* value;
 
-    xmlSecAssert2(dsigCtx != NULL, -1);
-    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
     xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(parent != NULL, -1);
 
-    /* we care about Manifest nodes only; ignore everything else */
-    cur = xmlSecGetNextElementNode(node->children);
-    while(cur != NULL) {
-        if(xmlSecCheckNodeName(cur, xmlSecNodeManifest, xmlSecDSigNs)) {
-            ret = xmlSecDSigCtxProcessManifestNode(dsigCtx, cur);
-            if(ret < 0){
-                xmlSecInternalError("xmlSecDSigCtxProcessManifestNode", NULL);
-                return(-1);
+    for(ns = parent->nsDef; ns != NULL; ns = ns->next) {
+        if(xmlStrEqual(ns->prefix, BAD_CAST "xml") || (xmlSearchNs(node->doc, node, ns->prefix) != NULL)) {
+            continue;
+        }
+        if(xmlNewNs(node, ns->href, ns->prefix) == NULL) {
+            xmlSecXmlError("xmlNewNs", NULL);
+            return(-1);
+        }
+    }
+    for(attr = parent->properties; attr != NULL; attr = attr->next) {
+        if((attr->ns == NULL) || !xmlStrEqual(attr->ns->href, XML_XML_NAMESPACE) ||
+           (xmlHasNsProp(node, attr->name, XML_XML_NAMESPACE) != NULL)) {
+            continue;
+        }
+        curNs = xmlSearchNsByHref(node->doc, node, XML_XML_NAMESPACE);
+        value = xmlNodeListGetString(parent->doc, attr->children, 1);
+        if((curNs == NULL) || (xmlSetNsProp(node, curNs, attr->name, value) == NULL)) {
+            xmlSecXmlError2("xmlSetNsProp", NULL, "name=%s", xmlSecErrorsSafeString(attr->name));
+            if(value != NULL) {
+                xmlFree(value);
             }
+            return(-1);
+        }
+        if(value != NULL) {
+            xmlFree(value);
         }
-        cur = xmlSecGetNextElementNode(cur->next);
     }
     return(0);
 }
 
-/**
- * xmlSecDSigCtxProcessManifestNode:
- *
- * The Manifest  Element (http://www.w3.org/TR/xmldsig-core/#sec-Manifest)
- *
- * The Manifest element provides a list of References. The difference from
- * the list in SignedInfo is that it is application defined which, if any, of
- * the digests are actually checked against the objects referenced and what to
- * do if the object is inaccessible or the digest compare fails. If a Manifest
- * is pointed to from SignedInfo, the digest over the Manifest itself will be
- * checked by the core result validation behavior. The digests within such
- * a Manifest are checked at the application's discretion. If a Manifest is
- * referenced from another Manifest, even the overall digest of this two level
- * deep Manifest might not be checked.
- *
- * Schema Definition:
- *
- * <element name="Manifest" type="ds:ManifestType"/>
- * <complexType name="ManifestType">
- *   <sequence>
- *     <element ref="ds:Reference" maxOccurs="unbounded"/>
- *   </sequence>
- *   <attribute name="Id" type="ID" use="optional"/>
- *  </complexType>
- *
- * DTD:
- *
- * <!ELEMENT Manifest (Reference+)  >
- * <!ATTLIST Manifest Id ID  #IMPLIED >
- */
-static int
-xmlSecDSigCtxProcessManifestNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
-    xmlSecDSigReferenceCtxPtr dsigRefCtx;
-    xmlNodePtr cur;
+/* copies the signature subtree into a new document: the namespaces and the xml:*
+ * attributes inherited from the ancestors are added to the document element */
+static xmlDocPtr
+xmlSecDSigStreamCopySignature(xmlTextReaderPtr reader) {
+    xmlDocPtr doc;
+    xmlNodePtr node, copy, parent;
+
+    xmlSecAssert2(reader != NULL, NULL);
+
+    node = xmlTextReaderExpand(reader);
+    if(node == NULL) {
+        xmlSecXmlError("xmlTextReaderExpand", NULL);
+        return(NULL);
+    }
+    doc = xmlNewDoc(BAD_CAST "1.0");
+    if(doc == NULL) {
+        xmlSecXmlError("xmlNewDoc", NULL);
+        return(NULL);
+    }
+    copy = xmlDocCopyNode(node, doc, 1);
+    if(copy == NULL) {
+        xmlSecXmlError("xmlDocCopyNode", NULL);
+        xmlFreeDoc(doc);
+        return(NULL);
+    }
+    xmlDocSetRootElement(doc, copy);
+
+    for(parent = node->parent; (parent != NULL) && (parent->type == XML_ELEMENT_NODE); parent = parent->parent) {
+        if(xmlSecDSigStreamAddInherited(copy, parent) < 0) {
+            xmlSecInternalError("xmlSecDSigStreamAddInherited", NULL);
+            xmlFreeDoc(doc);
+            return(NULL);
+        }
+    }
+    return(doc);
+}
+
+/* checks that the reference URI="" and the @c14nId and enveloped signature
+ * transforms are enabled in @dsigCtx */
+static int
+xmlSecDSigStreamCheckEnabled(xmlSecDSigCtxPtr dsigCtx, xmlSecTransformId c14nId) {
+    xmlSecAssert2(dsigCtx != NULL, -1);
+
+    if((xmlSecTransformUriTypeCheck(dsigCtx->enabledReferenceUris, BAD_CAST "") != 1) ||
+       ((dsigCtx->enabledReferenceTransforms != NULL) &&
+        (xmlSecPtrListGetSize(dsigCtx->enabledReferenceTransforms) > 0) &&
+        ((xmlSecTransformIdListFind(dsigCtx->enabledReferenceTransforms, xmlSecTransformEnvelopedId) != 1) ||
+         (xmlSecTransformIdListFind(dsigCtx->enabledReferenceTransforms, c14nId) != 1)))) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_TRANSFORM_DISABLED, NULL,
+            "the reference uri or transforms are not enabled");
+        return(-1);
+    }
+    return(0);
+}
+
+/* the first pass: finds the enveloped signature and copies it */
+static xmlDocPtr
+xmlSecDSigStreamReadSignature(const char* filename) {
+    xmlTextReaderPtr reader;
+    xmlDocPtr doc = NULL;
+    int ret;
+
+    xmlSecAssert2(filename != NULL, NULL);
+
+    reader = xmlReaderForFile(filename, NULL, xmlSecParserGetDefaultOptions());
+    if(reader == NULL) {
+        xmlSecXmlError2("xmlReaderForFile", NULL, "filename=%s", xmlSecErrorsSafeString(filename));
+        return(NULL);
+    }
+    for(ret = xmlTextReaderRead(reader); ret == 1; ret = xmlTextReaderRead(reader)) {
+        if(xmlSecDSigStreamIsSignature(reader)) {
+            doc = xmlSecDSigStreamCopySignature(reader);
+            if(doc == NULL) {
+                xmlSecInternalError("xmlSecDSigStreamCopySignature", NULL);
+            }
+            break;
+        }
+    }
+    if(ret < 0) {
+        xmlSecXmlError2("xmlTextReaderRead", NULL, "filename=%s", xmlSecErrorsSafeString(filename));
+    } else if((ret == 0) && (doc == NULL)) {
+        xmlSecNodeNotFoundError("xmlTextReaderRead", (xmlNodePtr)NULL, xmlSecNodeSignature, NULL);
+    }
+    xmlFreeTextReader(reader);
+    return(doc);
+}
+
+/* the second pass: canonicalizes the document without the signature into @buf */
+static int
+xmlSecDSigStreamCanonicalize(const char* filename, xmlC14NMode mode, xmlChar** prefixes,
+                             int withComments, xmlOutputBufferPtr buf) {
+    xmlTextReaderPtr reader;
+    xmlSecC14NNativeStreamPtr stream;
+    int found = 0;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(filename != NULL, -1);
+    xmlSecAssert2(buf != NULL, -1);
+
+    reader = xmlReaderForFile(filename, NULL, xmlSecParserGetDefaultOptions());
+    if(reader == NULL) {
+        xmlSecXmlError2("xmlReaderForFile", NULL, "filename=%s", xmlSecErrorsSafeString(filename));
+        return(-1);
+    }
+    stream = xmlSecC14NNativeStreamCreate(mode, prefixes, withComments, buf);
+    if(stream == NULL) {
+        xmlSecInternalError("xmlSecC14NNativeStreamCreate", NULL);
+        xmlFreeTextReader(reader);
+        return(-1);
+    }
+
+    ret = xmlTextReaderRead(reader);
+    while(ret == 1) {
+        /* the enveloped signature transform: skip the signature subtree */
+        if((found == 0) && xmlSecDSigStreamIsSignature(reader)) {
+            found = 1;
+            ret = xmlTextReaderNext(reader);
+            continue;
+        }
+        if(xmlSecC14NNativeStreamReaderNode(stream, reader) < 0) {
+            xmlSecInternalError("xmlSecC14NNativeStreamReaderNode", NULL);
+            goto done;
+        }
+        ret = xmlTextReaderRead(reader);
+    }
+    if(ret < 0) {
+        xmlSecXmlError2("xmlTextReaderRead", NULL, "filename=%s", xmlSecErrorsSafeString(filename));
+        goto done;
+    }
+    if(found == 0) {
+        xmlSecNodeNotFoundError("xmlTextReaderRead", (xmlNodePtr)NULL, xmlSecNodeSignature, NULL);
+        goto done;
+    }
+    ret = xmlSecC14NNativeStreamFinish(stream);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeStreamFinish", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    xmlSecC14NNativeStreamDestroy(stream);
+    xmlFreeTextReader(reader);
+    return(res);
+}
+
+static int
+xmlSecDSigCtxVerifyFileInternal(xmlSecDSigCtxPtr dsigCtx, const char* filename, xmlDocPtr* signatureDoc) {
+    struct _xmlSecDSigDirtyNodes dirty;
+    xmlSecDSigSerializeCtx ctx;
+    xmlSecTransformId c14nId = xmlSecTransformIdUnknown;
+    xmlSecTransformId digestId = xmlSecTransformIdUnknown;
+    xmlChar* prefixList = NULL;
+    xmlChar** prefixes = NULL;
+    xmlNodePtr digestValueNode = NULL;
+    xmlOutputBufferPtr buf = NULL;
+    xmlDocPtr doc = NULL;
+    xmlNodePtr node;
+    xmlC14NMode mode;
     int ret;
+    int res = -1;
 
     xmlSecAssert2(dsigCtx != NULL, -1);
-    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
+    xmlSecAssert2(filename != NULL, -1);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ret = xmlSecTransformCtxInitialize(&(ctx.digestCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxInitialize", NULL);
+        return(-1);
+    }
+
+    /* the signature defines the c14n and digest methods: find it first */
+    doc = xmlSecDSigStreamReadSignature(filename);
+    if(doc == NULL) {
+        xmlSecInternalError("xmlSecDSigStreamReadSignature", NULL);
+        goto done;
+    }
+    node = xmlDocGetRootElement(doc);
     xmlSecAssert2(node != NULL, -1);
 
-    /* calculate references */
-    cur = xmlSecGetNextElementNode(node->children);
-    while((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs))) {
-        /* create reference */
-        dsigRefCtx = xmlSecDSigReferenceCtxCreate(dsigCtx, xmlSecDSigReferenceOriginManifest);
-        if(dsigRefCtx == NULL) {
-            xmlSecInternalError("xmlSecDSigReferenceCtxCreate", NULL);
-            return(-1);
+    if(xmlSecDSigSerializeReadTemplate(node, &c14nId, &prefixList, &digestId, &digestValueNode) != 1) {
+        xmlSecInvalidNodeContentError(node, NULL,
+            "expected one reference URI=\"\" with the enveloped signature and c14n transforms");
+        goto done;
+    }
+    if(xmlSecDSigStreamCheckEnabled(dsigCtx, c14nId) < 0) {
+        xmlSecInternalError("xmlSecDSigStreamCheckEnabled", NULL);
+        goto done;
+    }
+    if((c14nId == xmlSecTransformExclC14NId) || (c14nId == xmlSecTransformExclC14NWithCommentsId)) {
+        mode = XML_C14N_EXCLUSIVE_1_0;
+    } else {
+        mode = XML_C14N_1_0;
+    }
+    if(prefixList != NULL) {
+        prefixes = xmlSecDSigSerializeSplitPrefixList(prefixList);
+        if(prefixes == NULL) {
+            xmlSecInternalError("xmlSecDSigSerializeSplitPrefixList", NULL);
+            goto done;
         }
+    }
 
-        /* add to the list */
-        ret = xmlSecPtrListAdd(&(dsigCtx->manifestReferences), dsigRefCtx);
+    /* canonicalize and digest the document */
+    ctx.digestMethod = xmlSecTransformCtxCreateAndAppend(&(ctx.digestCtx), digestId);
+    if(ctx.digestMethod == NULL) {
+        xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", xmlSecTransformKlassGetName(digestId));
+        goto done;
+    }
+    ctx.digestMethod->operation = xmlSecTransformOperationVerify;
+
+    buf = xmlOutputBufferCreateIO(xmlSecDSigSerializeHeadWrite, NULL, &ctx, NULL);
+    if(buf == NULL) {
+        xmlSecXmlError("xmlOutputBufferCreateIO", NULL);
+        goto done;
+    }
+    /* URI="" selects the document without comments */
+    ret = xmlSecDSigStreamCanonicalize(filename, mode, prefixes, 0, buf);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigStreamCanonicalize", NULL);
+        goto done;
+    }
+    ret = xmlOutputBufferClose(buf);
+    buf = NULL;
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        goto done;
+    }
+
+    /* the digest is the last transform: push would drop the result */
+    ret = xmlSecTransformExecute(ctx.digestMethod, 1, &(ctx.digestCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformExecute", xmlSecTransformGetName(ctx.digestMethod));
+        goto done;
+    }
+    ret = xmlSecTransformVerifyNodeContent(ctx.digestMethod, digestValueNode, &(ctx.digestCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformVerifyNodeContent", xmlSecTransformGetName(ctx.digestMethod));
+        goto done;
+    }
+
+    if(ctx.digestMethod->status != xmlSecTransformStatusOk) {
+        dsigCtx->operation = xmlSecTransformOperationVerify;
+        xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonReference);
+    } else {
+        /* verify the signature, the reference digest is already verified */
+        dirty.signature = node;
+        dirty.nodes = NULL;
+        dirty.size = 0;
+        dirty.keepDigests = 1;
+
+        dsigCtx->dirtyNodes = &dirty;
+        ret = xmlSecDSigCtxVerifyInternal(dsigCtx, node, 0);
+        dsigCtx->dirtyNodes = NULL;
         if(ret < 0) {
-            xmlSecInternalError("xmlSecPtrListAdd", NULL);
-            xmlSecDSigReferenceCtxDestroy(dsigRefCtx);
-            return(-1);
+            xmlSecInternalError("xmlSecDSigCtxVerifyInternal", NULL);
+            goto done;
         }
+    }
 
-        /* process */
-        ret = xmlSecDSigReferenceCtxProcessNode(dsigRefCtx, cur);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecDSigReferenceCtxProcessNode",
-                                xmlSecNodeGetName(cur));
-            return(-1);
+    /* success */
+    res = 0;
+    if(signatureDoc != NULL) {
+        (*signatureDoc) = doc;
+        doc = NULL;
+    }
+
+done:
+    if(buf != NULL) {
+        (void)xmlOutputBufferClose(buf);
+    }
+    if(prefixes != NULL) {
+        xmlFree(prefixes);
+    }
+    if(prefixList != NULL) {
+        xmlFree(prefixList);
+    }
+    if(doc != NULL) {
+        /* the nodes are not valid anymore */
+        dsigCtx->signValueNode = NULL;
+        xmlFreeDoc(doc);
+    }
+    xmlSecTransformCtxFinalize(&(ctx.digestCtx));
+    return(res);
+}
+
+/* one pass: canonicalizes the document into @out while it is digested, the end
+ * tag of the document element and the nodes after it are kept in @ctx */
+static int
+xmlSecDSigStreamSignCanonicalize(const char* filename, xmlNodePtr tmpl, xmlC14NMode mode, xmlChar** prefixes,
+                                 xmlOutputBufferPtr headBuf, xmlOutputBufferPtr tailBuf) {
+    xmlTextReaderPtr reader;
+    xmlSecC14NNativeStreamPtr stream;
+    xmlNodePtr cur;
+    int type;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(filename != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(headBuf != NULL, -1);
+    xmlSecAssert2(tailBuf != NULL, -1);
+
+    reader = xmlReaderForFile(filename, NULL, xmlSecParserGetDefaultOptions());
+    if(reader == NULL) {
+        xmlSecXmlError2("xmlReaderForFile", NULL, "filename=%s", xmlSecErrorsSafeString(filename));
+        return(-1);
+    }
+    /* URI="" selects the document without comments */
+    stream = xmlSecC14NNativeStreamCreate(mode, prefixes, 0, headBuf);
+    if(stream == NULL) {
+        xmlSecInternalError("xmlSecC14NNativeStreamCreate", NULL);
+        xmlFreeTextReader(reader);
+        return(-1);
+    }
+
+    for(ret = xmlTextReaderRead(reader); ret == 1; ret = xmlTextReaderRead(reader)) {
+        type = xmlTextReaderNodeType(reader);
+        if((xmlTextReaderDepth(reader) != 0) ||
+           ((type != XML_READER_TYPE_ELEMENT) && (type != XML_READER_TYPE_END_ELEMENT))) {
+            if(xmlSecC14NNativeStreamReaderNode(stream, reader) < 0) {
+                xmlSecInternalError("xmlSecC14NNativeStreamReaderNode", NULL);
+                goto done;
+            }
+            continue;
         }
 
-        /* we don;t care if Reference processing failed because
-         * it's Manifest node */
-        cur = xmlSecGetNextElementNode(cur->next);
+        cur = xmlTextReaderCurrentNode(reader);
+        if(cur == NULL) {
+            xmlSecXmlError("xmlTextReaderCurrentNode", NULL);
+            goto done;
+        }
+        if(type == XML_READER_TYPE_ELEMENT) {
+            /* the signature is the last child of the document element */
+            if(xmlSecDSigStreamAddInherited(tmpl, cur) < 0) {
+                xmlSecInternalError("xmlSecDSigStreamAddInherited", NULL);
+                goto done;
+            }
+            if(xmlSecC14NNativeStreamStartElement(stream, cur) < 0) {
+                xmlSecInternalError("xmlSecC14NNativeStreamStartElement", NULL);
+                goto done;
+            }
+            if(xmlTextReaderIsEmptyElement(reader) != 1) {
+                continue;
+            }
+        }
+
+        /* the document element end tag goes after the signature */
+        if(xmlSecC14NNativeStreamSetOutput(stream, tailBuf) < 0) {
+            xmlSecInternalError("xmlSecC14NNativeStreamSetOutput", NULL);
+            goto done;
+        }
+        if(xmlSecC14NNativeStreamEndElement(stream, cur) < 0) {
+            xmlSecInternalError("xmlSecC14NNativeStreamEndElement", NULL);
+            goto done;
+        }
+    }
+    if(ret < 0) {
+        xmlSecXmlError2("xmlTextReaderRead", NULL, "filename=%s", xmlSecErrorsSafeString(filename));
+        goto done;
+    }
+    ret = xmlSecC14NNativeStreamFinish(stream);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecC14NNativeStreamFinish", NULL);
+        goto done;
     }
 
-    /* we should have nothing else here */
-    if(cur != NULL) {
-        xmlSecUnexpectedNodeError(cur,  NULL);
+    /* success */
+    res = 0;
+
+done:
+    xmlSecC14NNativeStreamDestroy(stream);
+    xmlFreeTextReader(reader);
+    return(res);
+}
+
+static int
+xmlSecDSigCtxSignFileInternal(xmlSecDSigCtxPtr dsigCtx, const char* filename, xmlNodePtr tmpl,
+                              xmlOutputBufferPtr out) {
+    xmlSecDSigSerializeCtx ctx;
+    xmlSecTransformId c14nId = xmlSecTransformIdUnknown;
+    xmlSecTransformId digestId = xmlSecTransformIdUnknown;
+    xmlChar* prefixList = NULL;
+    xmlChar** prefixes = NULL;
+    xmlNodePtr digestValueNode = NULL;
+    xmlOutputBufferPtr headBuf = NULL;
+    xmlOutputBufferPtr tailBuf = NULL;
+    xmlC14NMode mode;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(filename != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    if(xmlSecDSigSerializeReadTemplate(tmpl, &c14nId, &prefixList, &digestId, &digestValueNode) != 1) {
+        xmlSecInvalidNodeContentError(tmpl, NULL,
+            "expected one reference URI=\"\" with the enveloped signature and c14n transforms");
+        return(-1);
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ret = xmlSecTransformCtxInitialize(&(ctx.digestCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxInitialize", NULL);
+        xmlFree(prefixList);
+        return(-1);
+    }
+    ret = xmlSecBufferInitialize(&(ctx.tail), 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        xmlSecTransformCtxFinalize(&(ctx.digestCtx));
+        xmlFree(prefixList);
+        return(-1);
+    }
+    ctx.out = out;
+
+    if(xmlSecDSigStreamCheckEnabled(dsigCtx, c14nId) < 0) {
+        xmlSecInternalError("xmlSecDSigStreamCheckEnabled", NULL);
+        goto done;
+    }
+    if((c14nId == xmlSecTransformExclC14NId) || (c14nId == xmlSecTransformExclC14NWithCommentsId)) {
+        mode = XML_C14N_EXCLUSIVE_1_0;
+    } else {
+        mode = XML_C14N_1_0;
+    }
+    if(prefixList != NULL) {
+        prefixes = xmlSecDSigSerializeSplitPrefixList(prefixList);
+        if(prefixes == NULL) {
+            xmlSecInternalError("xmlSecDSigSerializeSplitPrefixList", NULL);
+            goto done;
+        }
+    }
+
+    /* canonicalize the document once: write and digest */
+    ctx.digestMethod = xmlSecTransformCtxCreateAndAppend(&(ctx.digestCtx), digestId);
+    if(ctx.digestMethod == NULL) {
+        xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", xmlSecTransformKlassGetName(digestId));
+        goto done;
+    }
+    ctx.digestMethod->operation = xmlSecTransformOperationSign;
+
+    headBuf = xmlOutputBufferCreateIO(xmlSecDSigSerializeHeadWrite, NULL, &ctx, NULL);
+    if(headBuf == NULL) {
+        xmlSecXmlError("xmlOutputBufferCreateIO", NULL);
+        goto done;
+    }
+    tailBuf = xmlOutputBufferCreateIO(xmlSecDSigSerializeTailWrite, NULL, &ctx, NULL);
+    if(tailBuf == NULL) {
+        xmlSecXmlError("xmlOutputBufferCreateIO", NULL);
+        goto done;
+    }
+    ret = xmlSecDSigStreamSignCanonicalize(filename, tmpl, mode, prefixes, headBuf, tailBuf);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigStreamSignCanonicalize", NULL);
+        goto done;
+    }
+    ret = xmlOutputBufferClose(headBuf);
+    headBuf = NULL;
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        goto done;
+    }
+    ret = xmlOutputBufferClose(tailBuf);
+    tailBuf = NULL;
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        goto done;
+    }
+    if(xmlSecBufferGetSize(&(ctx.tail)) == 0) {
+        xmlSecInvalidDataError("the document element is not found", NULL);
+        goto done;
+    }
+
+    /* sign and write the signature and the rest of the document */
+    ret = xmlSecDSigSerializeSignAndWrite(dsigCtx, &ctx, tmpl, digestValueNode, mode, prefixes, 0, out);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigSerializeSignAndWrite", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(tailBuf != NULL) {
+        (void)xmlOutputBufferClose(tailBuf);
+    }
+    if(headBuf != NULL) {
+        (void)xmlOutputBufferClose(headBuf);
+    }
+    if(prefixes != NULL) {
+        xmlFree(prefixes);
+    }
+    if(prefixList != NULL) {
+        xmlFree(prefixList);
+    }
+    xmlSecBufferFinalize(&(ctx.tail));
+    xmlSecTransformCtxFinalize(&(ctx.digestCtx));
+    return(res);
+}
+#endif /* LIBXML_READER_ENABLED */
+
+/**
+ * xmlSecDSigCtxVerifyFile:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @filename:           the document file name.
+ * @signatureDoc:       the pointer to the returned copy of the &lt;dsig:Signature/&gt;
+ *                      node document or NULL.
+ *
+ * Verifies the enveloped signature of the whole document in @filename without
+ * loading the document: the signature must be the first &lt;dsig:Signature/&gt;
+ * element below the document element and must have only one reference with
+ * URI="" and the enveloped signature and c14n transforms. The document is read
+ * twice with the streaming parser: first up to the signature, which is copied
+ * into a new document, and then to canonicalize and digest the rest of it. The
+ * memory used is bounded by the document depth. The &lt;dsig:KeyInfo/&gt; can
+ * not refer to the nodes outside of the signature and the references pre-digest
+ * data is not stored.
+ *
+ * The nodes in @dsigCtx (e.g. #signValueNode) point to the copy: if @signatureDoc
+ * is not NULL then the caller is responsible for freeing it after @dsigCtx is
+ * reset or destroyed, otherwise these nodes are not valid after the function
+ * returns. The verification result is returned in #status member of the @dsigCtx
+ * object.
+ *
+ * Returns: 0 on success (check #status member of @dsigCtx to get
+ * signature verification result) or a negative value if an error occurs.
+ */
+int
+xmlSecDSigCtxVerifyFile(xmlSecDSigCtxPtr dsigCtx, const char* filename, xmlDocPtr* signatureDoc) {
+#ifdef LIBXML_READER_ENABLED
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->dirtyNodes == NULL, -1);
+    xmlSecAssert2(filename != NULL, -1);
+
+    if(((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES) != 0) ||
+       (dsigCtx->referencePreExecuteCallback != NULL)) {
+        xmlSecNotImplementedError("references pre-digest data for streaming verification");
+        return(-1);
+    }
+
+    prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+    ret = xmlSecDSigCtxVerifyFileInternal(dsigCtx, filename, signatureDoc);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecDSigCtxVerifyFileInternal", NULL,
+                             "filename=%s", xmlSecErrorsSafeString(filename));
         return(-1);
     }
     return(0);
+#else  /* LIBXML_READER_ENABLED */
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(filename != NULL, -1);
+    UNREFERENCED_PARAMETER(signatureDoc);
+
+    xmlSecNotImplementedError("libxml2 reader is disabled");
+    return(-1);
+#endif /* LIBXML_READER_ENABLED */
 }
 
 /**
- * xmlSecDSigCtxGetStatusString:
- * @status: the status.
+ * xmlSecDSigCtxSignFile:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @filename:           the document file name (or "-" for stdin).
+ * @tmpl:               the pointer to &lt;dsig:Signature/&gt; node with signature
+ *                      template outside of the document.
+ * @out:                the output buffer (without encoder).
  *
- * Gets status as a string.
+ * Signs the whole document in @filename without loading it and writes the
+ * canonical form (without comments) of the signed document into @out with
+ * the signature added as the last child of the document element. The @tmpl
+ * must have only one reference with URI="" and the enveloped signature and
+ * C14N 1.0 or exclusive C14N transforms. The document is read once with the
+ * streaming parser: the output is written into @out while it is digested,
+ * except the document element end tag and the nodes after it that are kept
+ * until the signature is calculated and written. The memory used is bounded
+ * by the document depth.
  *
- * Returns status as a string.
+ * The namespaces and the xml:* attributes of the document element are added
+ * to @tmpl before it is signed. If an error occurs then the output might be
+ * incomplete.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
  */
-const char*
-xmlSecDSigCtxGetStatusString(xmlSecDSigStatus status) {
-    switch(status) {
-    case xmlSecDSigStatusSucceeded:
-        return "OK";
+int
+xmlSecDSigCtxSignFile(xmlSecDSigCtxPtr dsigCtx, const char* filename, xmlNodePtr tmpl, xmlOutputBufferPtr out) {
+#ifdef LIBXML_READER_ENABLED
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->result == NULL, -1);
+    xmlSecAssert2(dsigCtx->dirtyNodes == NULL, -1);
+    xmlSecAssert2(filename != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(tmpl->doc != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    if(((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES) != 0) ||
+       (dsigCtx->referencePreExecuteCallback != NULL)) {
+        xmlSecNotImplementedError("references pre-digest data for streaming signature");
+        return(-1);
+    }
+    if(out->encoder != NULL) {
+        xmlSecInvalidDataError("output buffer encoder is not supported", NULL);
+        return(-1);
+    }
+
+    prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+    ret = xmlSecDSigCtxSignFileInternal(dsigCtx, filename, tmpl, out);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecDSigCtxSignFileInternal", NULL,
+                             "filename=%s", xmlSecErrorsSafeString(filename));
+        return(-1);
+    }
+    return(0);
+#else  /* LIBXML_READER_ENABLED */
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(filename != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(out != NULL, -1);
+
+    xmlSecNotImplementedError("libxml2 reader is disabled");
+    return(-1);
+#endif /* LIBXML_READER_ENABLED */
+}
+
+/* the slow verifications sampler state */
+typedef struct _xmlSecDSigSlowOpState {
+    double                      start;
+    unsigned int                prevFlags;
+    xmlSecStatsCacheCounters    caches[XMLSEC_STATS_CACHES_SIZE];
+} xmlSecDSigSlowOpState;
+
+static void
+xmlSecDSigSlowOpStart(xmlSecDSigCtxPtr dsigCtx, xmlSecDSigSlowOpState* state) {
+    xmlSecAssert(dsigCtx != NULL);
+    xmlSecAssert(state != NULL);
+
+    /* the transforms timings are cheap, the record is created only if needed */
+    state->prevFlags = dsigCtx->transformCtx.flags;
+    dsigCtx->transformCtx.flags |= XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS;
+    xmlSecStatsGetThreadCaches(state->caches);
+    state->start = xmlSecStatsGetCurrentTime();
+}
+
+static int
+xmlSecDSigSlowOpGetKeyResolution(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node, xmlSecBufferPtr buf) {
+    xmlNodePtr keyInfoNode;
+    xmlNodePtr cur;
+    const xmlChar* name;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(buf != NULL, -1);
+
+    keyInfoNode = xmlSecFindChild(node, xmlSecNodeKeyInfo, xmlSecDSigNs);
+    if(keyInfoNode != NULL) {
+        for(cur = xmlSecGetNextElementNode(keyInfoNode->children); cur != NULL; cur = xmlSecGetNextElementNode(cur->next)) {
+            if(xmlSecBufferGetSize(buf) > 0) {
+                ret = xmlSecBufferAppend(buf, BAD_CAST ",", 1);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecBufferAppend", NULL);
+                    return(-1);
+                }
+            }
+            ret = xmlSecBufferAppend(buf, cur->name, xmlSecStrlen(cur->name));
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecBufferAppend", NULL);
+                return(-1);
+            }
+        }
+    }
+
+    if(dsigCtx->signKey != NULL) {
+        ret = xmlSecBufferAppend(buf, BAD_CAST " -> ", 4);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", NULL);
+            return(-1);
+        }
+        name = (dsigCtx->signKey->value != NULL) ? xmlSecKeyDataGetName(dsigCtx->signKey->value) : NULL;
+        if(name == NULL) {
+            name = BAD_CAST "unknown";
+        }
+        ret = xmlSecBufferAppend(buf, name, xmlSecStrlen(name));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", NULL);
+            return(-1);
+        }
+
+        name = xmlSecKeyGetName(dsigCtx->signKey);
+        if(name != NULL) {
+            ret = xmlSecBufferAppend(buf, BAD_CAST " \"", 2);
+            if(ret >= 0) {
+                ret = xmlSecBufferAppend(buf, name, xmlSecStrlen(name));
+            }
+            if(ret >= 0) {
+                ret = xmlSecBufferAppend(buf, BAD_CAST "\"", 1);
+            }
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecBufferAppend", NULL);
+                return(-1);
+            }
+        }
+    }
+
+    /* zero terminated string */
+    ret = xmlSecBufferAppend(buf, BAD_CAST "", 1);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecDSigSlowOpGetDump(xmlSecDSigCtxPtr dsigCtx, xmlSecBufferPtr buf) {
+    FILE* f;
+    long size;
+    xmlSecSize bufSize;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(buf != NULL, -1);
+
+    f = tmpfile();
+    if(f == NULL) {
+        xmlSecIOError("tmpfile", NULL, NULL);
+        return(-1);
+    }
+    xmlSecDSigCtxDebugDump(dsigCtx, f);
+
+    size = ftell(f);
+    if(size < 0) {
+        xmlSecIOError("ftell", NULL, NULL);
+        goto done;
+    }
+    XMLSEC_SAFE_CAST_LONG_TO_SIZE(size, bufSize, goto done, NULL);
+
+    ret = xmlSecBufferSetSize(buf, bufSize + 1);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecBufferSetSize", NULL, "size=" XMLSEC_SIZE_FMT, bufSize + 1);
+        goto done;
+    }
+    rewind(f);
+    if((bufSize > 0) && (fread(xmlSecBufferGetData(buf), bufSize, 1, f) != 1)) {
+        xmlSecIOError("fread", NULL, NULL);
+        goto done;
+    }
+    xmlSecBufferGetData(buf)[bufSize] = '\0';
+
+    /* success */
+    res = 0;
+
+done:
+    fclose(f);
+    return(res);
+}
+
+static void
+xmlSecDSigSlowOpEnd(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node, xmlSecDSigSlowOpState* state) {
+    xmlSecDSigSlowOpRecord record;
+    xmlSecStatsCacheCounters caches[XMLSEC_STATS_CACHES_SIZE];
+    xmlSecBuffer keyResolution, dump;
+    double duration;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert(dsigCtx != NULL);
+    xmlSecAssert(dsigCtx->slowOpCallback != NULL);
+    xmlSecAssert(node != NULL);
+    xmlSecAssert(state != NULL);
+
+    duration = xmlSecStatsGetCurrentTime() - state->start;
+    if(duration < dsigCtx->slowOpThreshold) {
+        dsigCtx->transformCtx.flags = state->prevFlags;
+        return;
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.duration      = duration;
+    record.status        = dsigCtx->status;
+    record.failureReason = dsigCtx->failureReason;
+
+    /* the signature might be invalid: do not report the same errors again */
+    if(xmlSecCheckNodeName(node, xmlSecNodeSignature, xmlSecDSigNs) &&
+       (xmlSecFindChild(node, xmlSecNodeSignedInfo, xmlSecDSigNs) != NULL))
+    {
+        ret = xmlSecDSigEstimateCost(node, &(record.cost));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigEstimateCost", NULL);
+            memset(&(record.cost), 0, sizeof(record.cost));
+        }
+    }
+
+    xmlSecStatsGetThreadCaches(caches);
+    for(ii = 0; ii < XMLSEC_STATS_CACHES_SIZE; ++ii) {
+        record.caches[ii].hits   = caches[ii].hits - state->caches[ii].hits;
+        record.caches[ii].misses = caches[ii].misses - state->caches[ii].misses;
+    }
+
+    /* the record is created without the buffers if the memory is low */
+    ret = xmlSecBufferInitialize(&keyResolution, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        dsigCtx->transformCtx.flags = state->prevFlags;
+        return;
+    }
+    ret = xmlSecBufferInitialize(&dump, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        xmlSecBufferFinalize(&keyResolution);
+        dsigCtx->transformCtx.flags = state->prevFlags;
+        return;
+    }
+    ret = xmlSecDSigSlowOpGetKeyResolution(dsigCtx, node, &keyResolution);
+    if(ret == 0) {
+        record.keyResolution = xmlSecBufferGetData(&keyResolution);
+    }
+    ret = xmlSecDSigSlowOpGetDump(dsigCtx, &dump);
+    if(ret == 0) {
+        record.dump     = (const char*)xmlSecBufferGetData(&dump);
+        record.dumpSize = xmlSecBufferGetSize(&dump) - 1;
+    }
+
+    /* the flags are restored after the dump to get the signature transforms timings */
+    dsigCtx->transformCtx.flags = state->prevFlags;
+    dsigCtx->slowOpCallback(dsigCtx, &record, dsigCtx->slowOpCallbackCtx);
+
+    xmlSecBufferFinalize(&dump);
+    xmlSecBufferFinalize(&keyResolution);
+}
+
+/**
+ * xmlSecDSigCtxVerify:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @node:               the pointer with &lt;dsig:Signature/&gt; node.
+ *
+ * Validates signature in the @node. The verification result is returned
+ * in #status member of the @dsigCtx object.
+ *
+ * Returns: 0 on success (check #status member of @dsigCtx to get
+ * signature verification result) or a negative value if an error occurs.
+ */
+int
+xmlSecDSigCtxVerify(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecDSigSlowOpState slowOp;
+    xmlSecSize record;
+    int sampled;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->doc != NULL, -1);
+
+    XMLSEC_PROBE1(dsig__verify__start, dsigCtx);
+    sampled = ((dsigCtx->slowOpThreshold > 0) && (dsigCtx->slowOpCallback != NULL)) ? 1 : 0;
+    if(sampled != 0) {
+        xmlSecDSigSlowOpStart(dsigCtx, &slowOp);
+    }
+    record = xmlSecRecorderAddDoc(node->doc);
+    prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+    ret = xmlSecDSigCtxVerifyInternal(dsigCtx, node, 0);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(record > 0) {
+        xmlSecRecorderAddOp(record, "verify", dsigCtx->flags, dsigCtx->flags2,
+            (dsigCtx->signKey != NULL) ? xmlSecKeyGetName(dsigCtx->signKey) : NULL,
+            (ret < 0) ? "error" : ((dsigCtx->status == xmlSecDSigStatusSucceeded) ? "ok" : "invalid"));
+    }
+    if(sampled != 0) {
+        xmlSecDSigSlowOpEnd(dsigCtx, node, &slowOp);
+    }
+    XMLSEC_PROBE2(dsig__verify__done, dsigCtx, ret);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxVerifyInternal", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* if deferVerify is set then the sign method is detached and only the SignedInfo
+ * is canonicalized: the signature is verified by xmlSecDSigCtxVerifyComplete() */
+static int
+xmlSecDSigCtxVerifyInternal(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node, int deferVerify) {
+    xmlSecStatsSpan span, phaseSpan;
+    int verified = 0;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->doc != NULL, -1);
+    xmlSecAssert2((deferVerify == 0) || ((dsigCtx->flags & XMLSEC_DSIG_FLAGS_VERIFY_SIGNATURE_FIRST) == 0), -1);
+
+    xmlSecStatsOpStart(xmlSecStatsOpDSigVerify, &span);
+
+    /* add ids for Signature nodes */
+    dsigCtx->operation  = xmlSecTransformOperationVerify;
+    dsigCtx->status     = xmlSecDSigStatusUnknown;
+    if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_IDS_REGISTERED) == 0) {
+        xmlSecAddIDs(node->doc, node, xmlSecDSigIds);
+    }
+
+    /* reject the expensive signatures before any c14n or crypto */
+    if(dsigCtx->maxCost != NULL) {
+        xmlSecDSigCost cost;
+
+        ret = xmlSecDSigEstimateCost(node, &cost);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigEstimateCost", NULL);
+            goto done;
+        }
+        ret = xmlSecDSigCostCheckLimits(&cost, dsigCtx->maxCost);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCostCheckLimits", NULL);
+            goto done;
+        } else if(ret == 0) {
+            dsigCtx->failureReason = xmlSecDSigFailureReasonCostLimit;
+            goto done;
+        }
+    }
+
+    ret = xmlSecDSigCtxPrepareArena(dsigCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxPrepareArena", NULL);
+        goto done;
+    }
+
+    /* read signature info */
+    ret = xmlSecDSigCtxProcessSignatureNode(dsigCtx, node, deferVerify);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxProcessSignatureNode", NULL);
+        goto done;
+    }
+    if((dsigCtx->signMethod == NULL) || (dsigCtx->signValueNode == NULL)) {
+        xmlSecInvalidDataError("signature method or value is not set", NULL);
+        goto done;
+    }
+
+    /* references processing might change the status */
+    if((dsigCtx->status != xmlSecDSigStatusUnknown) || (deferVerify != 0)) {
+        res = 0;
+        goto done;
+    }
+
+    /* verify SignatureValue node content (unless it was already verified
+     * before the references were processed) */
+    if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_VERIFY_SIGNATURE_FIRST) == 0) {
+        xmlSecStatsPhaseStart(xmlSecStatsPhaseSignature, &phaseSpan);
+        ret = xmlSecDSigCtxVerifySignatureValue(dsigCtx, &verified);
+        xmlSecStatsPhaseEnd(&phaseSpan);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxVerifySignatureValue", NULL);
+            goto done;
+        }
+    } else {
+        /* the failed signature is reported by xmlSecDSigCtxProcessSignatureNode() */
+        verified = 1;
+    }
+
+    /* set status and we are done */
+    if(verified != 0) {
+        xmlSecDSigCtxMarkAsSucceeded(dsigCtx);
+    } else {
+        xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonSignature);
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if((res < 0) && (xmlSecTransformCtxIsDeadlineExceeded(&(dsigCtx->transformCtx)) != 0)) {
+        dsigCtx->failureReason = xmlSecDSigFailureReasonDeadline;
+    }
+    xmlSecStatsOpEnd(&span, ((res < 0) || ((dsigCtx->status != xmlSecDSigStatusSucceeded) &&
+        ((deferVerify == 0) || (dsigCtx->status != xmlSecDSigStatusUnknown)))) ? 1 : 0);
+    return(res);
+}
+
+/* verifies the signature of the SignedInfo canonicalized by xmlSecDSigCtxVerifyInternal()
+ * with deferVerify set: the result is either already known (1 if the signature is
+ * valid and 0 otherwise) or -1 and the sign method verifies @signatureValue */
+static int
+xmlSecDSigCtxVerifyComplete(xmlSecDSigCtxPtr dsigCtx, xmlSecBufferPtr signatureValue, int result) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecBufferPtr signedInfo;
+    xmlSecStatsSpan span;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->operation == xmlSecTransformOperationVerify, -1);
+    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
+    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod->prev == NULL, -1);
+    xmlSecAssert2(signatureValue != NULL, -1);
+
+    if(result < 0) {
+        signedInfo = dsigCtx->transformCtx.result;
+        if((signedInfo == NULL) || (xmlSecBufferGetData(signedInfo) == NULL)) {
+            xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_RESULT, NULL, "signedInfo");
+            return(-1);
+        }
+
+        xmlSecStatsPhaseStart(xmlSecStatsPhaseSignature, &span);
+        prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+        prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+        ret = xmlSecTransformPushBin(dsigCtx->signMethod, xmlSecBufferGetData(signedInfo),
+            xmlSecBufferGetSize(signedInfo), 1, &(dsigCtx->transformCtx));
+        if(ret >= 0) {
+            ret = xmlSecTransformVerify(dsigCtx->signMethod, xmlSecBufferGetData(signatureValue),
+                xmlSecBufferGetSize(signatureValue), &(dsigCtx->transformCtx));
+        }
+        xmlSecSettingsDetach(prevSettings);
+        xmlSecMemStatsDetach(prevMemStats);
+        xmlSecStatsPhaseEnd(&span);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformVerify",
+                                xmlSecTransformGetName(dsigCtx->signMethod));
+            return(-1);
+        }
+        result = (dsigCtx->signMethod->status == xmlSecTransformStatusOk) ? 1 : 0;
+    }
+
+    /* set status and we are done */
+    if(result > 0) {
+        xmlSecDSigCtxMarkAsSucceeded(dsigCtx);
+    } else {
+        xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonSignature);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecDSigCtxVerifyManifestReferences:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ *
+ * Verifies all the &lt;dsig:Manifest/&gt; references left unprocessed
+ * by #xmlSecDSigCtxVerify function because of the
+ * #XMLSEC_DSIG_FLAGS_DEFER_MANIFEST_REFERENCES flag. The references are
+ * handed over to the #xmlSecDSigReferencesExecutor if it is set. The
+ * verification results are returned in #status member of each reference
+ * in #manifestReferences list.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDSigCtxVerifyManifestReferences(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->operation == xmlSecTransformOperationVerify, -1);
+
+    prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+    ret = xmlSecDSigCtxVerifyManifestReferencesInternal(dsigCtx);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxVerifyManifestReferencesInternal", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecDSigCtxVerifyManifestReferencesInternal(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecDSigReferenceCtxPtr* dsigRefCtxs;
+    xmlSecDSigReferenceCtxPtr dsigRefCtx;
+    xmlSecSize ii, size, count;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->operation == xmlSecTransformOperationVerify, -1);
+
+    size = xmlSecPtrListGetSize(&(dsigCtx->manifestReferences));
+    if(size == 0) {
+        return(0);
+    }
+
+    if(dsigCtx->referencesExecutor == NULL) {
+        for(ii = 0; ii < size; ++ii) {
+            dsigRefCtx = (xmlSecDSigReferenceCtxPtr)xmlSecPtrListGetItem(&(dsigCtx->manifestReferences), ii);
+            xmlSecAssert2(dsigRefCtx != NULL, -1);
+
+            ret = xmlSecDSigReferenceCtxVerify(dsigRefCtx);
+            if(ret < 0) {
+                xmlSecInternalError2("xmlSecDSigReferenceCtxVerify", NULL,
+                                     "uri=%s", xmlSecErrorsSafeString(dsigRefCtx->uri));
+                return(-1);
+            }
+        }
+        return(0);
+    }
+
+    /* hand over the pending references to the executor */
+    dsigRefCtxs = (xmlSecDSigReferenceCtxPtr*)xmlMalloc(sizeof(xmlSecDSigReferenceCtxPtr) * size);
+    if(dsigRefCtxs == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigReferenceCtxPtr) * size, NULL);
+        return(-1);
+    }
+    for(ii = count = 0; ii < size; ++ii) {
+        dsigRefCtx = (xmlSecDSigReferenceCtxPtr)xmlSecPtrListGetItem(&(dsigCtx->manifestReferences), ii);
+        xmlSecAssert2(dsigRefCtx != NULL, -1);
+
+        if(dsigRefCtx->status == xmlSecDSigStatusUnknown) {
+            xmlSecAssert2(dsigRefCtx->digestMethod != NULL, -1);
+            dsigRefCtxs[count++] = dsigRefCtx;
+        }
+    }
+    if(count == 0) {
+        xmlFree(dsigRefCtxs);
+        return(0);
+    }
+
+    ret = dsigCtx->referencesExecutor(dsigCtx->referencesExecutorCtx,
+                xmlSecDSigReferenceCtxExecuteTask, dsigRefCtxs, count);
+    if(ret < 0) {
+        xmlSecInternalError("referencesExecutor", NULL);
+        xmlFree(dsigRefCtxs);
+        return(-1);
+    }
+    for(ii = 0; ii < count; ++ii) {
+        if(dsigRefCtxs[ii]->status == xmlSecDSigStatusUnknown) {
+            xmlSecInternalError2("xmlSecDSigReferenceCtxExecute", NULL,
+                                 "uri=%s", xmlSecErrorsSafeString(dsigRefCtxs[ii]->uri));
+            xmlFree(dsigRefCtxs);
+            return(-1);
+        }
+    }
+    xmlFree(dsigRefCtxs);
+    return(0);
+}
+
+typedef struct _xmlSecDSigBatch {
+    xmlSecKeysMngrPtr           keysMngr;
+    xmlNodePtr*                 nodes;
+    xmlSecDSigStatus*           statuses;
+    xmlSecSize                  size;
+    xmlSecSize                  workersNum;
+    unsigned int                flags;
+    xmlSecDSigBatchVerifyCallback verifyCallback;
+    void*                       verifyCallbackCtx;
+} xmlSecDSigBatch, *xmlSecDSigBatchPtr;
+
+/* the max number of signatures verified together by one worker */
+#define XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE     32
+
+typedef struct _xmlSecDSigBatchVerifyChunk {
+    xmlSecDSigCtx               dsigCtxs[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+    xmlSecBuffer                signatureValues[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+    xmlSecSize                  indexes[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+    int                         results[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+    xmlSecSize                  size;
+
+    /* the current group of the signatures with the same sign method */
+    xmlSecKeyPtr                keys[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+    xmlSecBufferPtr             signedInfos[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+    xmlSecBufferPtr             groupSignatureValues[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+    int                         groupResults[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+    xmlSecSize                  groupIndexes[XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE];
+} xmlSecDSigBatchVerifyChunk, *xmlSecDSigBatchVerifyChunkPtr;
+
+static int      xmlSecDSigBatchRun                      (xmlSecDSigBatchPtr batch,
+                                                         xmlSecDSigBatchExecutor executor,
+                                                         void* executorCtx);
+static int      xmlSecDSigFindSignatures                (xmlDocPtr doc,
+                                                         xmlNodePtr** nodes,
+                                                         xmlSecSize* size);
+
+static void     xmlSecDSigBatchVerifyWorker             (xmlSecDSigBatchPtr batch,
+                                                         xmlSecSize worker);
+
+static void
+xmlSecDSigBatchWorker(void* taskCtx, xmlSecSize worker) {
+    xmlSecDSigBatchPtr batch = (xmlSecDSigBatchPtr)taskCtx;
+    xmlSecDSigCtx dsigCtx;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert(batch != NULL);
+    xmlSecAssert(batch->workersNum > 0);
+    xmlSecAssert(worker < batch->workersNum);
+
+    if(batch->verifyCallback != NULL) {
+        xmlSecDSigBatchVerifyWorker(batch, worker);
+        return;
+    }
+
+    ret = xmlSecDSigCtxInitialize(&dsigCtx, batch->keysMngr);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxInitialize", NULL);
+        xmlSecDSigCtxFinalize(&dsigCtx);
+        return;
+    }
+    dsigCtx.flags = batch->flags;
+
+    /* each worker takes every workersNum-th item */
+    for(ii = worker; ii < batch->size; ii += batch->workersNum) {
+        ret = xmlSecDSigCtxVerify(&dsigCtx, batch->nodes[ii]);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxVerify", NULL);
+        } else {
+            batch->statuses[ii] = dsigCtx.status;
+        }
+        xmlSecDSigCtxReset(&dsigCtx);
+    }
+    xmlSecDSigCtxFinalize(&dsigCtx);
+}
+
+/**
+ * xmlSecDSigVerifyBatch:
+ * @keysMngr:           the pointer to keys manager shared by all the verifications.
+ * @nodes:              the array of &lt;dsig:Signature/&gt; nodes to verify.
+ * @statuses:           the array to return verification status for each node.
+ * @size:               the number of nodes in @nodes and @statuses.
+ * @workersNum:         the number of workers (e.g. threads) to use.
+ * @executor:           the optional application executor to run the workers.
+ * @executorCtx:        the context passed to @executor.
+ *
+ * Verifies signatures in @nodes and stores the result for each node in
+ * @statuses (#xmlSecDSigStatusUnknown is used if the verification failed
+ * with an error). The nodes are split between @workersNum workers that are
+ * run by @executor; each worker uses its own &lt;dsig:Signature/&gt;
+ * processing context. If @executor is NULL then all the signatures are
+ * verified sequentially in the current thread.
+ *
+ * The @keysMngr is only read: all the keys should be loaded into the
+ * keys manager before this call. The nodes must belong to different
+ * documents, the crypto library must be initialized for multi-threaded use.
+ *
+ * Returns: 0 on success (check @statuses to get the verification results)
+ * or a negative value if an error occurs.
+ */
+int
+xmlSecDSigVerifyBatch(xmlSecKeysMngrPtr keysMngr, xmlNodePtr* nodes, xmlSecDSigStatus* statuses,
+                      xmlSecSize size, xmlSecSize workersNum,
+                      xmlSecDSigBatchExecutor executor, void* executorCtx) {
+    xmlSecDSigBatch batch;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(nodes != NULL, -1);
+    xmlSecAssert2(statuses != NULL, -1);
+
+    for(ii = 0; ii < size; ++ii) {
+        xmlSecAssert2(nodes[ii] != NULL, -1);
+        statuses[ii] = xmlSecDSigStatusUnknown;
+    }
+    if(size == 0) {
+        return(0);
+    }
+
+    memset(&batch, 0, sizeof(batch));
+    batch.keysMngr   = keysMngr;
+    batch.nodes      = nodes;
+    batch.statuses   = statuses;
+    batch.size       = size;
+    batch.workersNum = workersNum;
+    ret = xmlSecDSigBatchRun(&batch, executor, executorCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigBatchRun", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* verifies the signatures of the chunk items with the same sign method as the
+ * @first item with the batch verify callback */
+static int
+xmlSecDSigBatchVerifyGroup(xmlSecDSigBatchPtr batch, xmlSecDSigBatchVerifyChunkPtr chunk, xmlSecSize first) {
+    xmlSecTransformId signMethodId;
+    xmlSecSize ii, count;
+    int ret;
+
+    xmlSecAssert2(batch != NULL, -1);
+    xmlSecAssert2(batch->verifyCallback != NULL, -1);
+    xmlSecAssert2(chunk != NULL, -1);
+    xmlSecAssert2(first < chunk->size, -1);
+    xmlSecAssert2(chunk->dsigCtxs[first].signMethod != NULL, -1);
+
+    signMethodId = chunk->dsigCtxs[first].signMethod->id;
+    for(ii = first, count = 0; ii < chunk->size; ++ii) {
+        /* only the items with the canonicalized SignedInfo and not verified yet */
+        if((chunk->results[ii] != -1) || (chunk->dsigCtxs[ii].status != xmlSecDSigStatusUnknown) ||
+           (chunk->dsigCtxs[ii].signMethod == NULL) || (chunk->dsigCtxs[ii].signMethod->id != signMethodId)) {
+            continue;
+        }
+        chunk->keys[count] = chunk->dsigCtxs[ii].signKey;
+        chunk->signedInfos[count] = chunk->dsigCtxs[ii].transformCtx.result;
+        chunk->groupSignatureValues[count] = &(chunk->signatureValues[ii]);
+        chunk->groupResults[count] = 0;
+        chunk->groupIndexes[count] = ii;
+        ++count;
+    }
+    xmlSecAssert2(count > 0, -1);
+
+    ret = batch->verifyCallback(batch->verifyCallbackCtx, signMethodId, chunk->keys,
+        chunk->signedInfos, chunk->groupSignatureValues, chunk->groupResults, count);
+    if(ret < 0) {
+        xmlSecInternalError("verifyCallback", xmlSecTransformKlassGetName(signMethodId));
+        return(-1);
+    }
+
+    /* if the sign method is not supported then the results stay unknown (-2)
+     * and the signatures are verified one by one */
+    for(ii = 0; ii < count; ++ii) {
+        chunk->results[chunk->groupIndexes[ii]] = (ret == 0) ? ((chunk->groupResults[ii] != 0) ? 1 : 0) : -2;
+    }
+    return(0);
+}
+
+static void
+xmlSecDSigBatchVerifyWorker(xmlSecDSigBatchPtr batch, xmlSecSize worker) {
+    xmlSecDSigBatchVerifyChunkPtr chunk;
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecDSigCtxPtr dsigCtx;
+    xmlSecSize ii, jj;
+    int ret;
+
+    xmlSecAssert(batch != NULL);
+    xmlSecAssert(batch->verifyCallback != NULL);
+
+    /* the chunk is too big for the worker thread stack */
+    chunk = (xmlSecDSigBatchVerifyChunkPtr)xmlMalloc(sizeof(xmlSecDSigBatchVerifyChunk));
+    if(chunk == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigBatchVerifyChunk), NULL);
+        return;
+    }
+    memset(chunk, 0, sizeof(xmlSecDSigBatchVerifyChunk));
+
+    for(jj = 0; jj < XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE; ++jj) {
+        ret = xmlSecDSigCtxInitialize(&(chunk->dsigCtxs[jj]), batch->keysMngr);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxInitialize", NULL);
+            goto done;
+        }
+        chunk->dsigCtxs[jj].flags = batch->flags;
+
+        ret = xmlSecBufferInitialize(&(chunk->signatureValues[jj]), 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize", NULL);
+            goto done;
+        }
+    }
+
+    /* each worker takes every workersNum-th item */
+    for(ii = worker; ii < batch->size; ) {
+        /* canonicalize SignedInfo of the next chunk items and read the signature values */
+        for(chunk->size = 0; (chunk->size < XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE) && (ii < batch->size); ii += batch->workersNum) {
+            jj = chunk->size++;
+            dsigCtx = &(chunk->dsigCtxs[jj]);
+            chunk->indexes[jj] = ii;
+            chunk->results[jj] = -1;
+
+            prevMemStats = xmlSecMemStatsAttach(xmlSecDSigCtxGetMemStats(dsigCtx));
+            prevSettings = xmlSecSettingsAttach(xmlSecDSigCtxGetSettings(dsigCtx));
+            ret = xmlSecDSigCtxVerifyInternal(dsigCtx, batch->nodes[ii], 1);
+            xmlSecSettingsDetach(prevSettings);
+            xmlSecMemStatsDetach(prevMemStats);
+            if((ret >= 0) && (dsigCtx->status == xmlSecDSigStatusUnknown)) {
+                ret = xmlSecBufferBase64NodeContentRead(&(chunk->signatureValues[jj]), dsigCtx->signValueNode);
+                if((ret < 0) || (xmlSecBufferGetData(&(chunk->signatureValues[jj])) == NULL)) {
+                    xmlSecInternalError("xmlSecBufferBase64NodeContentRead", NULL);
+                    ret = -1;
+                }
+            } else if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigCtxVerifyInternal", NULL);
+            }
+            if(ret < 0) {
+                /* error: the status stays unknown */
+                chunk->results[jj] = -3;
+            }
+        }
+
+        /* verify the signatures with the same sign method together */
+        for(jj = 0; jj < chunk->size; ++jj) {
+            if((chunk->results[jj] != -1) || (chunk->dsigCtxs[jj].status != xmlSecDSigStatusUnknown)) {
+                continue;
+            }
+            ret = xmlSecDSigBatchVerifyGroup(batch, chunk, jj);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigBatchVerifyGroup", NULL);
+                break;
+            }
+        }
+
+        /* set the results */
+        for(jj = 0; jj < chunk->size; ++jj) {
+            dsigCtx = &(chunk->dsigCtxs[jj]);
+            if((dsigCtx->status == xmlSecDSigStatusUnknown) && (chunk->results[jj] >= -2)) {
+                ret = xmlSecDSigCtxVerifyComplete(dsigCtx, &(chunk->signatureValues[jj]),
+                    (chunk->results[jj] >= 0) ? chunk->results[jj] : -1);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecDSigCtxVerifyComplete", NULL);
+                }
+            }
+            if((chunk->results[jj] != -3) && (dsigCtx->status != xmlSecDSigStatusUnknown)) {
+                batch->statuses[chunk->indexes[jj]] = dsigCtx->status;
+            }
+            xmlSecDSigCtxReset(dsigCtx);
+            xmlSecBufferEmpty(&(chunk->signatureValues[jj]));
+        }
+    }
+
+done:
+    for(jj = 0; jj < XMLSEC_DSIG_BATCH_VERIFY_CHUNK_SIZE; ++jj) {
+        xmlSecDSigCtxFinalize(&(chunk->dsigCtxs[jj]));
+        xmlSecBufferFinalize(&(chunk->signatureValues[jj]));
+    }
+    xmlFree(chunk);
+}
+
+/**
+ * xmlSecDSigVerifyBatchEx:
+ * @keysMngr:           the pointer to keys manager shared by all the verifications.
+ * @nodes:              the array of &lt;dsig:Signature/&gt; nodes to verify.
+ * @statuses:           the array to return verification status for each node.
+ * @size:               the number of nodes in @nodes and @statuses.
+ * @workersNum:         the number of workers (e.g. threads) to use.
+ * @executor:           the optional application executor to run the workers.
+ * @executorCtx:        the context passed to @executor.
+ * @verifyCallback:     the optional batch signatures verification function.
+ * @verifyCallbackCtx:  the context passed to @verifyCallback.
+ *
+ * Verifies signatures in @nodes the same way as #xmlSecDSigVerifyBatch
+ * function does. If @verifyCallback is set then each worker processes
+ * the references and canonicalizes &lt;dsig:SignedInfo/&gt; for up to 32
+ * signatures first, and then verifies the signatures with the same signature
+ * method together with @verifyCallback.
+ *
+ * Returns: 0 on success (check @statuses to get the verification results)
+ * or a negative value if an error occurs.
+ */
+int
+xmlSecDSigVerifyBatchEx(xmlSecKeysMngrPtr keysMngr, xmlNodePtr* nodes, xmlSecDSigStatus* statuses,
+                        xmlSecSize size, xmlSecSize workersNum,
+                        xmlSecDSigBatchExecutor executor, void* executorCtx,
+                        xmlSecDSigBatchVerifyCallback verifyCallback, void* verifyCallbackCtx) {
+    xmlSecDSigBatch batch;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(nodes != NULL, -1);
+    xmlSecAssert2(statuses != NULL, -1);
+
+    for(ii = 0; ii < size; ++ii) {
+        xmlSecAssert2(nodes[ii] != NULL, -1);
+        statuses[ii] = xmlSecDSigStatusUnknown;
+    }
+    if(size == 0) {
+        return(0);
+    }
+
+    memset(&batch, 0, sizeof(batch));
+    batch.keysMngr          = keysMngr;
+    batch.nodes             = nodes;
+    batch.statuses          = statuses;
+    batch.size              = size;
+    batch.workersNum        = workersNum;
+    batch.verifyCallback    = verifyCallback;
+    batch.verifyCallbackCtx = verifyCallbackCtx;
+    ret = xmlSecDSigBatchRun(&batch, executor, executorCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigBatchRun", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecDSigVerifyAll:
+ * @keysMngr:           the pointer to keys manager shared by all the verifications.
+ * @doc:                the pointer to the document.
+ * @nodes:              the pointer to the returned array of &lt;dsig:Signature/&gt; nodes.
+ * @statuses:           the pointer to the returned array of verification statuses.
+ * @size:               the pointer to the returned number of nodes in @nodes and @statuses.
+ * @workersNum:         the number of workers (e.g. threads) to use.
+ * @executor:           the optional application executor to run the workers.
+ * @executorCtx:        the context passed to @executor.
+ *
+ * Finds all the &lt;dsig:Signature/&gt; nodes in @doc (in the document order)
+ * and verifies them the same way as #xmlSecDSigVerifyBatch function does.
+ * The signatures Id attributes are added to the document IDs once before
+ * the verification starts, the document is not modified by the workers
+ * (see #XMLSEC_DSIG_FLAGS_IDS_REGISTERED) thus the signatures of one document
+ * can be verified concurrently. The @nodes and @statuses arrays (NULL if
+ * there are no signatures in @doc) must be freed by the caller with xmlFree().
+ *
+ * Returns: 0 on success (check @statuses to get the verification results)
+ * or a negative value if an error occurs.
+ */
+int
+xmlSecDSigVerifyAll(xmlSecKeysMngrPtr keysMngr, xmlDocPtr doc, xmlNodePtr** nodes,
+                    xmlSecDSigStatus** statuses, xmlSecSize* size, xmlSecSize workersNum,
+                    xmlSecDSigBatchExecutor executor, void* executorCtx) {
+    xmlSecDSigBatch batch;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(doc != NULL, -1);
+    xmlSecAssert2(nodes != NULL, -1);
+    xmlSecAssert2(statuses != NULL, -1);
+    xmlSecAssert2(size != NULL, -1);
+
+    (*nodes) = NULL;
+    (*statuses) = NULL;
+    (*size) = 0;
+
+    memset(&batch, 0, sizeof(batch));
+    ret = xmlSecDSigFindSignatures(doc, &(batch.nodes), &(batch.size));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigFindSignatures", NULL);
+        return(-1);
+    }
+    if(batch.size == 0) {
+        return(0);
+    }
+    batch.statuses = (xmlSecDSigStatus*)xmlMalloc(sizeof(xmlSecDSigStatus) * batch.size);
+    if(batch.statuses == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigStatus) * batch.size, NULL);
+        xmlFree(batch.nodes);
+        return(-1);
+    }
+    for(ii = 0; ii < batch.size; ++ii) {
+        batch.statuses[ii] = xmlSecDSigStatusUnknown;
+    }
+    batch.keysMngr   = keysMngr;
+    batch.workersNum = workersNum;
+    batch.flags      = XMLSEC_DSIG_FLAGS_IDS_REGISTERED;
+
+    ret = xmlSecDSigBatchRun(&batch, executor, executorCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigBatchRun", NULL);
+        xmlFree(batch.statuses);
+        xmlFree(batch.nodes);
+        return(-1);
+    }
+
+    (*nodes) = batch.nodes;
+    (*statuses) = batch.statuses;
+    (*size) = batch.size;
+    return(0);
+}
+
+static int
+xmlSecDSigBatchRun(xmlSecDSigBatchPtr batch, xmlSecDSigBatchExecutor executor, void* executorCtx) {
+    int ret;
+
+    xmlSecAssert2(batch != NULL, -1);
+    xmlSecAssert2(batch->size > 0, -1);
+
+    if(batch->workersNum == 0) {
+        batch->workersNum = 1;
+    }
+    if(batch->workersNum > batch->size) {
+        batch->workersNum = batch->size;
+    }
+
+    if((executor == NULL) || (batch->workersNum == 1)) {
+        batch->workersNum = 1;
+        xmlSecDSigBatchWorker(batch, 0);
+        return(0);
+    }
+
+    ret = executor(executorCtx, xmlSecDSigBatchWorker, batch, batch->workersNum);
+    if(ret < 0) {
+        xmlSecInternalError("executor", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* finds all the Signature nodes in the document order and adds their Id attributes
+ * to the document IDs (the nested signatures are registered with the outer one) */
+static int
+xmlSecDSigFindSignatures(xmlDocPtr doc, xmlNodePtr** nodes, xmlSecSize* size) {
+    xmlNodePtr* res = NULL;
+    xmlNodePtr* tmp;
+    xmlSecSize resSize = 0;
+    xmlSecSize resMaxSize = 0;
+    xmlNodePtr outer = NULL;
+    xmlNodePtr cur, parent;
+    xmlSecDocIndexPtr index;
+    xmlSecDocIndexNamePtr signatures;
+    xmlSecSize outerLast = 0;
+    xmlSecSize ii;
+
+    xmlSecAssert2(doc != NULL, -1);
+    xmlSecAssert2(nodes != NULL, -1);
+    xmlSecAssert2(size != NULL, -1);
+
+    /* the document index has the elements by name */
+    index = xmlSecDocIndexAcquire(doc);
+    if(index != NULL) {
+        signatures = xmlSecDocIndexGetElementsByName(index, xmlSecNodeSignature);
+        for(ii = 0; (signatures != NULL) && (ii < signatures->size); ++ii) {
+            cur = xmlSecDocIndexGetElement(index, signatures->ordinals[ii]);
+            if(!xmlSecCheckNodeName(cur, xmlSecNodeSignature, xmlSecDSigNs)) {
+                continue;
+            }
+            if(resSize >= resMaxSize) {
+                resMaxSize = (resMaxSize > 0) ? (2 * resMaxSize) : 16;
+                tmp = (xmlNodePtr*)xmlRealloc(res, sizeof(xmlNodePtr) * resMaxSize);
+                if(tmp == NULL) {
+                    xmlSecMallocError(sizeof(xmlNodePtr) * resMaxSize, NULL);
+                    xmlFree(res);
+                    return(-1);
+                }
+                res = tmp;
+            }
+            res[resSize++] = cur;
+
+            /* the nested signatures Ids are already added with the outer one */
+            if((outer == NULL) || (signatures->ordinals[ii] > outerLast)) {
+                outer = cur;
+                outerLast = index->elements[signatures->ordinals[ii]].last;
+                xmlSecAddIDs(doc, cur, xmlSecDSigIds);
+            }
+        }
+
+        (*nodes) = res;
+        (*size) = resSize;
+        return(0);
+    }
+
+    /* iterative walk over the document elements */
+    cur = xmlDocGetRootElement(doc);
+    while(cur != NULL) {
+        if((cur->type == XML_ELEMENT_NODE) && xmlSecCheckNodeName(cur, xmlSecNodeSignature, xmlSecDSigNs)) {
+            if(resSize >= resMaxSize) {
+                resMaxSize = (resMaxSize > 0) ? (2 * resMaxSize) : 16;
+                tmp = (xmlNodePtr*)xmlRealloc(res, sizeof(xmlNodePtr) * resMaxSize);
+                if(tmp == NULL) {
+                    xmlSecMallocError(sizeof(xmlNodePtr) * resMaxSize, NULL);
+                    xmlFree(res);
+                    return(-1);
+                }
+                res = tmp;
+            }
+            res[resSize++] = cur;
+
+            /* the nested signatures Ids are already added with the outer one */
+            parent = cur->parent;
+            while((outer != NULL) && (parent != NULL) && (parent != outer)) {
+                parent = parent->parent;
+            }
+            if((outer == NULL) || (parent == NULL)) {
+                outer = cur;
+                xmlSecAddIDs(doc, cur, xmlSecDSigIds);
+            }
+        }
+        if((cur->type == XML_ELEMENT_NODE) && (cur->children != NULL)) {
+            cur = cur->children;
+            continue;
+        }
+
+        /* the next sibling or the next sibling of the nearest ancestor */
+        while((cur != NULL) && (cur->next == NULL)) {
+            cur = (cur->parent != (xmlNodePtr)doc) ? cur->parent : NULL;
+        }
+        if(cur != NULL) {
+            cur = cur->next;
+        }
+    }
+
+    (*nodes) = res;
+    (*size) = resSize;
+    return(0);
+}
+
+typedef struct _xmlSecDSigReferenceTask {
+    xmlSecDSigReferenceExecuteTask      task;
+    xmlSecDSigReferenceCtxPtr           dsigRefCtx;
+} xmlSecDSigReferenceTask, *xmlSecDSigReferenceTaskPtr;
+
+static void
+xmlSecDSigReferenceTaskRun(void* taskCtx) {
+    xmlSecDSigReferenceTaskPtr refTask = (xmlSecDSigReferenceTaskPtr)taskCtx;
+
+    xmlSecAssert(refTask != NULL);
+    xmlSecAssert(refTask->task != NULL);
+
+    /* failures are recorded in the reference ctx */
+    (void)refTask->task(refTask->dsigRefCtx);
+}
+
+/**
+ * xmlSecDSigReferencesExecutorRun:
+ * @executorCtx:        the pointer to the executor (#xmlSecExecutorPtr).
+ * @task:               the task to run for each reference.
+ * @dsigRefCtxs:        the array of &lt;dsig:Reference/&gt; element processing contexts.
+ * @size:               the number of elements in @dsigRefCtxs.
+ *
+ * The #xmlSecDSigReferencesExecutor that runs each reference task on the
+ * executor: set it as #xmlSecDSigCtx.referencesExecutor with the executor
+ * as #xmlSecDSigCtx.referencesExecutorCtx.
+ *
+ * Returns: 0 on success or a negative value if the tasks could not be run.
+ */
+int
+xmlSecDSigReferencesExecutorRun(void* executorCtx, xmlSecDSigReferenceExecuteTask task,
+                                xmlSecDSigReferenceCtxPtr* dsigRefCtxs, xmlSecSize size) {
+    xmlSecExecutorPtr executor = (xmlSecExecutorPtr)executorCtx;
+    xmlSecDSigReferenceTaskPtr tasks = NULL;
+    xmlSecTaskGroupPtr group = NULL;
+    xmlSecSize ii;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(executor != NULL, -1);
+    xmlSecAssert2(task != NULL, -1);
+    xmlSecAssert2(dsigRefCtxs != NULL, -1);
+
+    if(size == 0) {
+        return(0);
+    }
+
+    tasks = (xmlSecDSigReferenceTaskPtr)xmlMalloc(size * sizeof(xmlSecDSigReferenceTask));
+    if(tasks == NULL) {
+        xmlSecMallocError(size * sizeof(xmlSecDSigReferenceTask), NULL);
+        goto done;
+    }
+    group = xmlSecTaskGroupCreate(executor);
+    if(group == NULL) {
+        xmlSecInternalError("xmlSecTaskGroupCreate", NULL);
+        goto done;
+    }
+
+    for(ii = 0; ii < size; ++ii) {
+        tasks[ii].task = task;
+        tasks[ii].dsigRefCtx = dsigRefCtxs[ii];
+        ret = xmlSecTaskGroupSubmit(group, xmlSecDSigReferenceTaskRun, &(tasks[ii]));
+        if(ret < 0) {
+            /* the submitted tasks still use the tasks array */
+            xmlSecInternalError("xmlSecTaskGroupSubmit", NULL);
+            (void)xmlSecTaskGroupWait(group);
+            goto done;
+        }
+    }
+    ret = xmlSecTaskGroupWait(group);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTaskGroupWait", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(group != NULL) {
+        xmlSecTaskGroupDestroy(group);
+    }
+    if(tasks != NULL) {
+        xmlFree(tasks);
+    }
+    return(res);
+}
+
+/* returns the stats object to attach for the operation or NULL */
+static xmlSecMemStatsPtr
+xmlSecDSigCtxGetMemStats(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecAssert2(dsigCtx != NULL, NULL);
+
+    if(((dsigCtx->flags & XMLSEC_DSIG_FLAGS_COLLECT_MEM_STATS) == 0) && (dsigCtx->memStats.limit == 0)) {
+        return(NULL);
+    }
+    return(&(dsigCtx->memStats));
+}
+
+/* returns the keys manager settings to attach for the operation or NULL */
+static xmlSecSettingsPtr
+xmlSecDSigCtxGetSettings(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecAssert2(dsigCtx != NULL, NULL);
+
+    if(dsigCtx->keyInfoReadCtx.keysMngr == NULL) {
+        return(NULL);
+    }
+    return(dsigCtx->keyInfoReadCtx.keysMngr->priv->settings);
+}
+
+static int
+xmlSecDSigCtxPrepareArena(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecAssert2(dsigCtx != NULL, -1);
+
+    if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_USE_ARENA) == 0) {
+        dsigCtx->transformCtx.arena = NULL;
+        return(0);
+    }
+    if(dsigCtx->arena == NULL) {
+        dsigCtx->arena = xmlSecArenaCreate(0);
+        if(dsigCtx->arena == NULL) {
+            xmlSecInternalError("xmlSecArenaCreate", NULL);
+            return(-1);
+        }
+    }
+    dsigCtx->transformCtx.arena = dsigCtx->arena;
+    return(0);
+}
+
+static void
+xmlSecDSigCtxMarkAsSucceeded(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecAssert(dsigCtx != NULL);
+
+    dsigCtx->status = xmlSecDSigStatusSucceeded;
+}
+
+static void
+xmlSecDSigCtxMarkAsFailed(xmlSecDSigCtxPtr dsigCtx, xmlSecDSigFailureReason failureReason) {
+    xmlSecAssert(dsigCtx != NULL);
+
+    dsigCtx->status = xmlSecDSigStatusInvalid;
+    if(dsigCtx->failureReason == xmlSecDSigFailureReasonUnknown) {
+        dsigCtx->failureReason = failureReason;
+    }
+}
+
+
+/*
+ * xmlSecDSigCtxProcessSignatureNode:
+ *
+ * The Signature  element (http://www.w3.org/TR/xmldsig-core/#sec-Signature)
+ *
+ * The Signature element is the root element of an XML Signature.
+ * Implementation MUST generate laxly schema valid [XML-schema] Signature
+ * elements as specified by the following schema:
+ * The way in which the SignedInfo element is presented to the
+ * canonicalization method is dependent on that method. The following
+ * applies to algorithms which process XML as nodes or characters:
+ *
+ *  - XML based canonicalization implementations MUST be provided with
+ *  a [XPath] node-set originally formed from the document containing
+ *  the SignedInfo and currently indicating the SignedInfo, its descendants,
+ *  and the attribute and namespace nodes of SignedInfo and its descendant
+ *  elements.
+ *
+ *  - Text based canonicalization algorithms (such as CRLF and charset
+ *  normalization) should be provided with the UTF-8 octets that represent
+ *  the well-formed SignedInfo element, from the first character to the
+ *  last character of the XML representation, inclusive. This includes
+ *  the entire text of the start and end tags of the SignedInfo element
+ *  as well as all descendant markup and character data (i.e., the text)
+ *  between those tags. Use of text based canonicalization of SignedInfo
+ *  is NOT RECOMMENDED.
+ *
+ *  =================================
+ *  we do not support any non XML based C14N
+ *
+ * Schema Definition:
+ *
+ *  <element name="Signature" type="ds:SignatureType"/>
+ *  <complexType name="SignatureType">
+ *  <sequence>
+ *     <element ref="ds:SignedInfo"/>
+ *     <element ref="ds:SignatureValue"/>
+ *     <element ref="ds:KeyInfo" minOccurs="0"/>
+ *     <element ref="ds:Object" minOccurs="0" maxOccurs="unbounded"/>
+ *     </sequence> <attribute name="Id" type="ID" use="optional"/>
+ *  </complexType>
+ *
+ * DTD:
+ *
+ *  <!ELEMENT Signature (SignedInfo, SignatureValue, KeyInfo?, Object*)  >
+ *  <!ATTLIST Signature
+ *      xmlns   CDATA   #FIXED 'http://www.w3.org/2000/09/xmldsig#'
+ *      Id      ID  #IMPLIED >
+ *
+ */
+static int
+xmlSecDSigCtxProcessSignatureNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node, int deferSign) {
+    xmlNodePtr signedInfoNode = NULL;
+    xmlNodePtr keyInfoNode = NULL;
+    xmlNodePtr firstReferenceNode = NULL;
+    xmlNodePtr cur;
+    xmlSecStatsSpan span;
+    int verified = 0;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2((dsigCtx->operation == xmlSecTransformOperationSign) || (dsigCtx->operation == xmlSecTransformOperationVerify), -1);
+    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
+    xmlSecAssert2(dsigCtx->signValueNode == NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod == NULL, -1);
+    xmlSecAssert2(dsigCtx->c14nMethod == NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    if(!xmlSecCheckNodeName(node, xmlSecNodeSignature, xmlSecDSigNs)) {
+        xmlSecInvalidNodeError(node, xmlSecNodeSignature, NULL);
+        return(-1);
+    }
+
+    /* read node data */
+    xmlSecAssert2(dsigCtx->id == NULL, -1);
+    dsigCtx->id = xmlGetProp(node, xmlSecAttrId);
+
+    /* first node is required SignedInfo */
+    cur = xmlSecGetNextElementNode(node->children);
+    if((cur == NULL) || (!xmlSecCheckNodeName(cur, xmlSecNodeSignedInfo, xmlSecDSigNs))) {
+        xmlSecInvalidNodeError(cur, xmlSecNodeSignedInfo, NULL);
+        return(-1);
+    }
+    signedInfoNode = cur;
+    cur = xmlSecGetNextElementNode(cur->next);
+
+    /* next node is required SignatureValue */
+    if((cur == NULL) || (!xmlSecCheckNodeName(cur, xmlSecNodeSignatureValue, xmlSecDSigNs))) {
+        xmlSecInvalidNodeError(cur, xmlSecNodeSignatureValue, NULL);
+        return(-1);
+    }
+    dsigCtx->signValueNode = cur;
+    cur = xmlSecGetNextElementNode(cur->next);
+
+    /* next node is optional KeyInfo */
+    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeKeyInfo, xmlSecDSigNs))) {
+        keyInfoNode = cur;
+        cur = xmlSecGetNextElementNode(cur->next);
+    } else {
+        keyInfoNode = NULL;
+    }
+
+    /* next nodes are optional Object nodes */
+    while((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeObject, xmlSecDSigNs))) {
+        /* read manifests from objects */
+        if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_IGNORE_MANIFESTS) == 0) {
+            ret = xmlSecDSigCtxProcessObjectNode(dsigCtx, cur);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigCtxProcessObjectNode", NULL);
+                return(-1);
+            }
+        }
+        cur = xmlSecGetNextElementNode(cur->next);
+    }
+
+    /* if there is something left than it's an error */
+    if(cur != NULL) {
+        xmlSecUnexpectedNodeError(cur,  NULL);
+        return(-1);
+    }
+
+    /* now validated all the references and prepare transform */
+    ret = xmlSecDSigCtxProcessSignedInfoNode(dsigCtx, signedInfoNode, &firstReferenceNode);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxProcessSignedInfoNode", NULL);
+        return(-1);
+    }
+
+    /* as the result, we should have sign and c14n methods set */
+    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+    xmlSecAssert2(dsigCtx->c14nMethod != NULL, -1);
+
+    /* now read key info node */
+    ret = xmlSecDSigCtxProcessKeyInfoNode(dsigCtx, keyInfoNode);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxProcessKeyInfoNode", NULL);
+        return(-1);
+    }
+    /* as the result, we should have a key */
+    xmlSecAssert2(dsigCtx->signKey != NULL, -1);
+
+    /* the cached verification results are looked up by the canonicalized
+     * SignedInfo: it is not pushed through the sign method right away */
+    if((dsigCtx->operation == xmlSecTransformOperationVerify) && (dsigCtx->verifyCache != NULL)) {
+        deferSign = 1;
+    }
+
+    /* check the signature before digesting the references: if it doesn't match
+     * then the references don't matter */
+    if((dsigCtx->operation == xmlSecTransformOperationVerify) &&
+       ((dsigCtx->flags & XMLSEC_DSIG_FLAGS_VERIFY_SIGNATURE_FIRST) != 0)) {
+        xmlSecStatsPhaseStart(xmlSecStatsPhaseSignature, &span);
+        ret = xmlSecDSigCtxExecuteSignedInfo(dsigCtx, signedInfoNode, deferSign);
+        if(ret >= 0) {
+            ret = xmlSecDSigCtxVerifySignatureValue(dsigCtx, &verified);
+            xmlSecStatsPhaseEnd(&span);
+        } else {
+            xmlSecStatsPhaseEnd(&span);
+            xmlSecInternalError("xmlSecDSigCtxExecuteSignedInfo", NULL);
+            return(-1);
+        }
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxVerifySignatureValue", NULL);
+            return(-1);
+        }
+        if(verified == 0) {
+            xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonSignature);
+            return(0);
+        }
+
+        /* now actually process references and calculate digests */
+        xmlSecStatsPhaseStart(xmlSecStatsPhaseReferences, &span);
+        ret = xmlSecDSigCtxProcessReferences(dsigCtx, firstReferenceNode);
+        xmlSecStatsPhaseEnd(&span);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxProcessReferences", NULL);
+            return(-1);
+        }
+        return(0);
+    }
+
+    /* now actually process references and calculate digests */
+    xmlSecStatsPhaseStart(xmlSecStatsPhaseReferences, &span);
+    ret = xmlSecDSigCtxProcessReferences(dsigCtx, firstReferenceNode);
+    xmlSecStatsPhaseEnd(&span);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxProcessReferences", NULL);
+        return(-1);
+    }
+    /* references processing might change the status */
+    if(dsigCtx->status != xmlSecDSigStatusUnknown) {
+        return(0);
+    }
+
+    /* canonicalize SignedInfo and calculate the signature */
+    xmlSecStatsPhaseStart(xmlSecStatsPhaseSignature, &span);
+    ret = xmlSecDSigCtxExecuteSignedInfo(dsigCtx, signedInfoNode, deferSign);
+    xmlSecStatsPhaseEnd(&span);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigCtxExecuteSignedInfo", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecDSigCtxExecuteSignedInfo(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr signedInfoNode, int deferSign) {
+    xmlSecTransformDataType firstType;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+    xmlSecAssert2(signedInfoNode != NULL, -1);
+
+    /* the signature will be calculated by xmlSecDSigCtxSignComplete() (or verified
+     * by xmlSecDSigCtxVerifyComplete()): detach the sign method and only canonicalize
+     * SignedInfo */
+    if((deferSign != 0) && (dsigCtx->operation == xmlSecTransformOperationSign)) {
+        ret = xmlSecDSigCtxDetachSignMethod(dsigCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxDetachSignMethod", NULL);
+            return(-1);
+        }
+    } else if(deferSign != 0) {
+        xmlSecAssert2(dsigCtx->signMethod->prev != NULL, -1);
+        xmlSecAssert2(dsigCtx->transformCtx.last == dsigCtx->signMethod, -1);
+
+        dsigCtx->transformCtx.last = dsigCtx->signMethod->prev;
+        xmlSecTransformRemove(dsigCtx->signMethod);
+    } else if(dsigCtx->operation == xmlSecTransformOperationSign) {
+        /* if we need to write result to xml node then we need base64 encode result */
+        xmlSecTransformPtr base64Encode;
+
+        /* we need to add base64 encode transform */
+        base64Encode = xmlSecTransformCtxCreateAndAppend(&(dsigCtx->transformCtx),
+                                                         xmlSecTransformBase64Id);
+        if(base64Encode == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
+            return(-1);
+        }
+        base64Encode->operation = xmlSecTransformOperationEncode;
+    }
+
+    firstType = xmlSecTransformGetDataType(dsigCtx->transformCtx.first,
+                                           xmlSecTransformModePush,
+                                           &(dsigCtx->transformCtx));
+    if((firstType & xmlSecTransformDataTypeXml) != 0) {
+        xmlSecNodeSetPtr nodeset = NULL;
+
+        nodeset = xmlSecNodeSetGetChildren(signedInfoNode->doc, signedInfoNode, 1, 0);
+        if(nodeset == NULL) {
+            xmlSecInternalError("xmlSecNodeSetGetChildren(signedInfoNode)", NULL);
+            return(-1);
+        }
+
+        /* calculate the signature */
+        ret = xmlSecTransformCtxXmlExecute(&(dsigCtx->transformCtx), nodeset);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformCtxXmlExecute", NULL);
+            xmlSecNodeSetDestroy(nodeset);
+            return(-1);
+        }
+        xmlSecNodeSetDestroy(nodeset);
+    } else {
+        /* TODO */
+        xmlSecNotImplementedError("binary c14n transforms");
+        return(-1);
+    }
+    return(0);
+}
+
+/* verifies the <dsig:SignatureValue/> node content: the SignedInfo is either already
+ * pushed to the sign method or (if the verification results cache is used) canonicalized
+ * with the sign method detached by xmlSecDSigCtxExecuteSignedInfo() */
+static int
+xmlSecDSigCtxVerifySignatureValue(xmlSecDSigCtxPtr dsigCtx, int* verified) {
+    xmlSecBufferPtr signedInfo;
+    xmlSecBuffer signatureValue;
+    xmlSecBuffer cacheId;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->operation == xmlSecTransformOperationVerify, -1);
+    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+    xmlSecAssert2(dsigCtx->signValueNode != NULL, -1);
+    xmlSecAssert2(verified != NULL, -1);
+
+    if(dsigCtx->verifyCache == NULL) {
+        ret = xmlSecTransformVerifyNodeContent(dsigCtx->signMethod, dsigCtx->signValueNode,
+                                               &(dsigCtx->transformCtx));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformVerifyNodeContent", NULL);
+            return(-1);
+        }
+        (*verified) = (dsigCtx->signMethod->status == xmlSecTransformStatusOk) ? 1 : 0;
+        return(0);
+    }
+    xmlSecAssert2(dsigCtx->signMethod->prev == NULL, -1);
+
+    signedInfo = dsigCtx->transformCtx.result;
+    if((signedInfo == NULL) || (xmlSecBufferGetData(signedInfo) == NULL)) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_INVALID_RESULT, NULL, "signedInfo");
+        return(-1);
+    }
+
+    ret = xmlSecBufferInitialize(&signatureValue, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        return(-1);
+    }
+    ret = xmlSecBufferInitialize(&cacheId, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        xmlSecBufferFinalize(&signatureValue);
+        return(-1);
+    }
+
+    ret = xmlSecBufferBase64NodeContentRead(&signatureValue, dsigCtx->signValueNode);
+    if((ret < 0) || (xmlSecBufferGetData(&signatureValue) == NULL)) {
+        xmlSecInternalError("xmlSecBufferBase64NodeContentRead", NULL);
+        goto done;
+    }
+
+    /* the RSA/ECDSA/... verification is skipped if the same signature of the same
+     * SignedInfo was verified with the same key before */
+    ret = xmlSecDSigVerifyCacheFind(dsigCtx, signedInfo, &signatureValue, &cacheId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigVerifyCacheFind", NULL);
+        goto done;
+    } else if(ret == 1) {
+        (*verified) = 1;
+        res = 0;
+        goto done;
+    }
+
+    ret = xmlSecTransformPushBin(dsigCtx->signMethod, xmlSecBufferGetData(signedInfo),
+        xmlSecBufferGetSize(signedInfo), 1, &(dsigCtx->transformCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformPushBin",
+                            xmlSecTransformGetName(dsigCtx->signMethod));
+        goto done;
+    }
+    ret = xmlSecTransformVerify(dsigCtx->signMethod, xmlSecBufferGetData(&signatureValue),
+        xmlSecBufferGetSize(&signatureValue), &(dsigCtx->transformCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformVerify",
+                            xmlSecTransformGetName(dsigCtx->signMethod));
+        goto done;
+    }
+    (*verified) = (dsigCtx->signMethod->status == xmlSecTransformStatusOk) ? 1 : 0;
+
+    /* only the valid signatures are cached */
+    if(((*verified) != 0) && (xmlSecBufferGetSize(&cacheId) > 0)) {
+        ret = xmlSecDSigVerifyCacheAdd(dsigCtx, &cacheId);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigVerifyCacheAdd", NULL);
+            goto done;
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    xmlSecBufferFinalize(&cacheId);
+    xmlSecBufferFinalize(&signatureValue);
+    return(res);
+}
+
+/**
+ * xmlSecDSigCtxProcessSignedInfoNode:
+ *
+ * The SignedInfo Element (http://www.w3.org/TR/xmldsig-core/#sec-SignedInfo)
+ *
+ * The structure of SignedInfo includes the canonicalization algorithm,
+ * a result algorithm, and one or more references. The SignedInfo element
+ * may contain an optional ID attribute that will allow it to be referenced by
+ * other signatures and objects.
+ *
+ * SignedInfo does not include explicit result or digest properties (such as
+ * calculation time, cryptographic device serial number, etc.). If an
+ * application needs to associate properties with the result or digest,
+ * it may include such information in a SignatureProperties element within
+ * an Object element.
+ *
+ * Schema Definition:
+ *
+ *  <element name="SignedInfo" type="ds:SignedInfoType"/>
+ *  <complexType name="SignedInfoType">
+ *    <sequence>
+ *      <element ref="ds:CanonicalizationMethod"/>
+ *      <element ref="ds:SignatureMethod"/>
+ *      <element ref="ds:Reference" maxOccurs="unbounded"/>
+ *    </sequence>
+ *    <attribute name="Id" type="ID" use="optional"/>
+ *  </complexType>
+ *
+ * DTD:
+ *
+ *  <!ELEMENT SignedInfo (CanonicalizationMethod, SignatureMethod,  Reference+) >
+ *  <!ATTLIST SignedInfo  Id   ID      #IMPLIED>
+ *
+ */
+static int
+xmlSecDSigCtxProcessSignedInfoNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node, xmlNodePtr * firstReferenceNode) {
+    xmlSecSize refNodesCount = 0;
+    xmlNodePtr cur;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
+    xmlSecAssert2(dsigCtx->signMethod == NULL, -1);
+    xmlSecAssert2(dsigCtx->c14nMethod == NULL, -1);
+    xmlSecAssert2((dsigCtx->operation == xmlSecTransformOperationSign) || (dsigCtx->operation == xmlSecTransformOperationVerify), -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(firstReferenceNode != NULL, -1);
+    xmlSecAssert2((*firstReferenceNode) == NULL, -1);
+
+    /* first node is required CanonicalizationMethod. */
+    cur = xmlSecGetNextElementNode(node->children);
+    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeCanonicalizationMethod, xmlSecDSigNs))) {
+        dsigCtx->c14nMethod = xmlSecTransformCtxNodeRead(&(dsigCtx->transformCtx),
+                                        cur, xmlSecTransformUsageC14NMethod);
+        if(dsigCtx->c14nMethod == NULL) {
+            xmlSecInternalError2("xmlSecTransformCtxNodeRead", NULL,
+                                "node=%s", xmlSecErrorsSafeString(xmlSecNodeGetName(cur)));
+            return(-1);
+        }
+    } else if(dsigCtx->defC14NMethodId != xmlSecTransformIdUnknown) {
+        /* the dsig spec does require CanonicalizationMethod node
+         * to be present but in some case it application might decide to
+         * minimize traffic */
+        dsigCtx->c14nMethod = xmlSecTransformCtxCreateAndAppend(&(dsigCtx->transformCtx),
+                                                              dsigCtx->defC14NMethodId);
+        if(dsigCtx->c14nMethod == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
+            return(-1);
+        }
+    } else {
+        /* if c14n method is not specified in the template and not specified in
+         * the dsig context then it's an error.
+         */
+        xmlSecInvalidNodeError(cur, xmlSecNodeCanonicalizationMethod, NULL);
+        return(-1);
+    }
+
+    /* insert membuf if requested */
+    if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNATURE) != 0) {
+        xmlSecAssert2(dsigCtx->preSignMemBufMethod == NULL, -1);
+        dsigCtx->preSignMemBufMethod = xmlSecTransformCtxCreateAndAppend(&(dsigCtx->transformCtx),
+                                                xmlSecTransformMemBufId);
+        if(dsigCtx->preSignMemBufMethod == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend",
+                                xmlSecTransformKlassGetName(xmlSecTransformMemBufId));
+            return(-1);
+        }
+        if(dsigCtx->preDataSink != NULL) {
+            ret = xmlSecTransformMemBufSetSink(dsigCtx->preSignMemBufMethod,
+                                               xmlSecDSigCtxPreSignSink, dsigCtx);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecTransformMemBufSetSink", NULL);
+                return(-1);
+            }
+        }
+    }
+
+    /* next node is required SignatureMethod. */
+    cur = xmlSecGetNextElementNode( ((cur != NULL) ? cur->next : node->children) );
+    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeSignatureMethod, xmlSecDSigNs))) {
+        dsigCtx->signMethod = xmlSecTransformCtxNodeRead(&(dsigCtx->transformCtx),
+                                        cur, xmlSecTransformUsageSignatureMethod);
+        if(dsigCtx->signMethod == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxNodeRead",
+                                xmlSecNodeGetName(cur));
+            return(-1);
+        }
+        cur = xmlSecGetNextElementNode(cur->next);
+    } else if(dsigCtx->defSignMethodId != xmlSecTransformIdUnknown) {
+        /* the dsig spec does require SignatureMethod node
+         * to be present but in some case it application might decide to
+         * minimize traffic */
+        dsigCtx->signMethod = xmlSecTransformCtxCreateAndAppend(&(dsigCtx->transformCtx),
+                                                              dsigCtx->defSignMethodId);
+        if(dsigCtx->signMethod == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
+            return(-1);
+        }
+    } else {
+        /* if sign method is not specified in the template and not specified in
+         * the dsig context then it's an error.
+         */
+        xmlSecInvalidNodeError(cur, xmlSecNodeSignatureMethod, NULL);
+        return(-1);
+    }
+    dsigCtx->signMethod->operation = dsigCtx->operation;
+
+    /* read references */
+    while((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs))) {
+        /* record first reference node */
+        if((*firstReferenceNode) == NULL) {
+            (*firstReferenceNode) = cur;
+        }
+        ++refNodesCount;
+
+        /* go to next */
+        cur = xmlSecGetNextElementNode(cur->next);
+    }
+
+    /* check that we have at least one Reference */
+    if(refNodesCount == 0) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_DSIG_NO_REFERENCES, NULL, NULL);
+        return(-1);
+    }
+
+    /* if there is something left than it's an error */
+    if(cur != NULL) {
+        xmlSecUnexpectedNodeError(cur,  NULL);
+        return(-1);
+    }
+
+    /* done */
+    return(0);
+}
+
+
+static int
+xmlSecDSigCtxProcessReferences(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr firstReferenceNode) {
+    xmlSecDSigReferenceCtxPtr dsigRefCtx;
+    xmlNodePtr cur;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
+    xmlSecAssert2((dsigCtx->operation == xmlSecTransformOperationSign) || (dsigCtx->operation == xmlSecTransformOperationVerify), -1);
+    xmlSecAssert2(xmlSecPtrListGetSize(&(dsigCtx->signedInfoReferences)) == 0, -1);
+    xmlSecAssert2(firstReferenceNode != NULL, -1);
+
+    /* let the application start fetching all the external references at once */
+    if(xmlSecIOHasPrefetchCallback()) {
+        ret = xmlSecDSigCtxPrefetchReferences(dsigCtx, firstReferenceNode);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxPrefetchReferences", NULL);
+            return(-1);
+        }
+    }
+
+    /* process references */
+    for(cur = firstReferenceNode; (cur != NULL); cur = xmlSecGetNextElementNode(cur->next)) {
+        /* already checked but we trust none */
+        if(!xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs)) {
+            xmlSecInvalidNodeError(cur, xmlSecNodeReference, NULL);
+            return(-1);
+        }
+
+        /* create reference */
+        dsigRefCtx = xmlSecDSigReferenceCtxCreate(dsigCtx, xmlSecDSigReferenceOriginSignedInfo);
+        if(dsigRefCtx == NULL) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxCreate", NULL);
+            return(-1);
+        }
+
+        /* add to the list */
+        ret = xmlSecPtrListAdd(&(dsigCtx->signedInfoReferences), dsigRefCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecPtrListAdd", NULL);
+            xmlSecDSigReferenceCtxDestroy(dsigRefCtx);
+            return(-1);
+        }
+
+        /* re-signing: digest only the changed references */
+        if(dsigCtx->dirtyNodes != NULL) {
+            xmlSecAssert2((dsigCtx->operation == xmlSecTransformOperationSign) ||
+                          (dsigCtx->dirtyNodes->keepDigests != 0), -1);
+
+            ret = xmlSecDSigReferenceCtxProcessNodeIncremental(dsigRefCtx, cur);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigReferenceCtxProcessNodeIncremental",
+                                    xmlSecNodeGetName(cur));
+                return(-1);
+            }
+            if(dsigRefCtx->status != xmlSecDSigStatusSucceeded) {
+                xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonReference);
+                return(0);
+            }
+            continue;
+        }
+
+        /* with executor or batch digests, only read the node now and digest all references later */
+        if((dsigCtx->referencesExecutor != NULL) || (dsigCtx->batchDigestCallback != NULL) ||
+           (dsigCtx->sharedRefs != NULL)) {
+            ret = xmlSecDSigReferenceCtxPrepareNode(dsigRefCtx, cur);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigReferenceCtxPrepareNode",
+                                    xmlSecNodeGetName(cur));
+                return(-1);
+            }
+            if((dsigCtx->batchDigestCallback != NULL) || (dsigCtx->sharedRefs != NULL)) {
+                ret = xmlSecDSigReferenceCtxDetachDigestMethod(dsigRefCtx);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecDSigReferenceCtxDetachDigestMethod",
+                                        xmlSecNodeGetName(cur));
+                    return(-1);
+                }
+            }
+            continue;
+        }
+
+        /* process */
+        ret = xmlSecDSigReferenceCtxProcessNode(dsigRefCtx, cur);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxProcessNode",
+                                xmlSecNodeGetName(cur));
+            return(-1);
+        }
+
+        /* bail out if next Reference processing failed */
+        if(dsigRefCtx->status != xmlSecDSigStatusSucceeded) {
+            xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonReference);
+            return(0);
+        }
+    }
+
+    if(dsigCtx->dirtyNodes != NULL) {
+        /* already done */
+    } else if((dsigCtx->batchDigestCallback != NULL) || (dsigCtx->sharedRefs != NULL)) {
+        ret = xmlSecDSigCtxBatchDigestReferences(dsigCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxBatchDigestReferences", NULL);
+            return(-1);
+        }
+    } else if(dsigCtx->referencesExecutor != NULL) {
+        ret = xmlSecDSigCtxExecuteReferences(dsigCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxExecuteReferences", NULL);
+            return(-1);
+        }
+    }
+
+    /* done */
+    return(0);
+}
+
+static int
+xmlSecDSigCtxPrefetchReferences(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr firstReferenceNode) {
+    xmlChar** uris = NULL;
+    xmlChar* uri;
+    xmlChar* xptr;
+    xmlNodePtr cur;
+    xmlSecSize urisSize = 0;
+    xmlSecSize maxSize = 0;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(firstReferenceNode != NULL, -1);
+
+    for(cur = firstReferenceNode; (cur != NULL); cur = xmlSecGetNextElementNode(cur->next)) {
+        ++maxSize;
+    }
+
+    uris = (xmlChar**)xmlMalloc(sizeof(xmlChar*) * maxSize);
+    if(uris == NULL) {
+        xmlSecMallocError(sizeof(xmlChar*) * maxSize, NULL);
+        return(-1);
+    }
+
+    /* only the external URIs that are allowed for this signature */
+    for(cur = firstReferenceNode; (cur != NULL) && (urisSize < maxSize); cur = xmlSecGetNextElementNode(cur->next)) {
+        uri = xmlGetProp(cur, xmlSecAttrURI);
+        if(uri == NULL) {
+            continue;
+        }
+        if((uri[0] == '\0') || (uri[0] == '#') ||
+           (xmlSecTransformUriTypeCheck(dsigCtx->enabledReferenceUris, uri) != 1))
+        {
+            xmlFree(uri);
+            continue;
+        }
+
+        /* same as xmlSecTransformCtxSetUri(): the fragment is not part of the resource */
+        xptr = (xmlChar*)xmlStrchr(uri, '#');
+        if(xptr != NULL) {
+            (*xptr) = '\0';
+        }
+        uris[urisSize++] = uri;
+    }
+
+    /* the prefetch is only an optimization, the references are opened anyway */
+    ret = xmlSecIOPrefetch((const xmlChar**)uris, urisSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecIOPrefetch", NULL);
+        /* ignore the error */
+    }
+
+    for(ii = 0; ii < urisSize; ++ii) {
+        xmlFree(uris[ii]);
+    }
+    xmlFree(uris);
+    return(0);
+}
+
+static int
+xmlSecDSigCtxExecuteReferences(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecDSigReferenceCtxPtr* dsigRefCtxs;
+    xmlSecDSigReferenceCtxPtr dsigRefCtx;
+    xmlSecSize ii, size;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->referencesExecutor != NULL, -1);
+
+    size = xmlSecPtrListGetSize(&(dsigCtx->signedInfoReferences));
+    if(size == 0) {
+        return(0);
+    }
+
+    /* hand over the references to the executor */
+    dsigRefCtxs = (xmlSecDSigReferenceCtxPtr*)xmlMalloc(sizeof(xmlSecDSigReferenceCtxPtr) * size);
+    if(dsigRefCtxs == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigReferenceCtxPtr) * size, NULL);
+        return(-1);
+    }
+    for(ii = 0; ii < size; ++ii) {
+        dsigRefCtxs[ii] = (xmlSecDSigReferenceCtxPtr)xmlSecPtrListGetItem(&(dsigCtx->signedInfoReferences), ii);
+        xmlSecAssert2(dsigRefCtxs[ii] != NULL, -1);
+    }
+
+    ret = dsigCtx->referencesExecutor(dsigCtx->referencesExecutorCtx,
+                xmlSecDSigReferenceCtxExecuteTask, dsigRefCtxs, size);
+    xmlFree(dsigRefCtxs);
+    if(ret < 0) {
+        xmlSecInternalError("referencesExecutor", NULL);
+        return(-1);
+    }
+
+    /* merge results in the document order */
+    for(ii = 0; ii < size; ++ii) {
+        dsigRefCtx = (xmlSecDSigReferenceCtxPtr)xmlSecPtrListGetItem(&(dsigCtx->signedInfoReferences), ii);
+        xmlSecAssert2(dsigRefCtx != NULL, -1);
+
+        if(dsigRefCtx->status == xmlSecDSigStatusUnknown) {
+            xmlSecInternalError2("xmlSecDSigReferenceCtxExecute", NULL,
+                                 "uri=%s", xmlSecErrorsSafeString(dsigRefCtx->uri));
+            return(-1);
+        }
+
+        /* bail out if next Reference processing failed */
+        if(dsigRefCtx->status != xmlSecDSigStatusSucceeded) {
+            xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonReference);
+            return(0);
+        }
+
+        ret = xmlSecDSigReferenceCtxWriteResult(dsigRefCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxWriteResult", NULL);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+static int
+xmlSecDSigCtxBatchDigestReferences(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecDSigReferenceCtxPtr dsigRefCtx;
+    xmlSecDSigReferenceCtxPtr* dsigRefCtxs = NULL;
+    xmlSecBufferPtr* preDigests = NULL;
+    xmlSecBufferPtr* inputs = NULL;
+    xmlSecBufferPtr* outputs = NULL;
+    xmlSecTransformId digestId;
+    xmlSecSize ii, jj, size, count;
+    int supported;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+
+    size = xmlSecPtrListGetSize(&(dsigCtx->signedInfoReferences));
+    if(size == 0) {
+        return(0);
+    }
+
+    dsigRefCtxs = (xmlSecDSigReferenceCtxPtr*)xmlMalloc(sizeof(xmlSecDSigReferenceCtxPtr) * size);
+    preDigests = (xmlSecBufferPtr*)xmlMalloc(sizeof(xmlSecBufferPtr) * size);
+    inputs = (xmlSecBufferPtr*)xmlMalloc(sizeof(xmlSecBufferPtr) * size);
+    outputs = (xmlSecBufferPtr*)xmlMalloc(sizeof(xmlSecBufferPtr) * size);
+    if((dsigRefCtxs == NULL) || (preDigests == NULL) || (inputs == NULL) || (outputs == NULL)) {
+        xmlSecMallocError(sizeof(xmlSecBufferPtr) * size, NULL);
+        goto done;
+    }
+    memset(outputs, 0, sizeof(xmlSecBufferPtr) * size);
+
+    /* run the transforms: the digest methods are detached, the results are the pre-digest data */
+    for(ii = 0; ii < size; ++ii) {
+        dsigRefCtx = (xmlSecDSigReferenceCtxPtr)xmlSecPtrListGetItem(&(dsigCtx->signedInfoReferences), ii);
+        xmlSecAssert2(dsigRefCtx != NULL, -1);
+        xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+        dsigRefCtxs[ii] = dsigRefCtx;
+
+        /* the same data might be already transformed by one of the previous signatures */
+        if(dsigCtx->sharedRefs != NULL) {
+            ret = xmlSecDSigReferenceCtxFindShared(dsigRefCtx, &(preDigests[ii]));
+            if(ret < 0) {
+                xmlSecInternalError2("xmlSecDSigReferenceCtxFindShared", NULL,
+                                     "uri=%s", xmlSecErrorsSafeString(dsigRefCtx->uri));
+                goto done;
+            }
+            if(preDigests[ii] != NULL) {
+                continue;
+            }
+        }
+
+        ret = xmlSecTransformCtxExecute(&(dsigRefCtx->transformCtx), dsigRefCtx->digestValueNode->doc);
+        if((ret < 0) || (dsigRefCtx->transformCtx.result == NULL)) {
+            xmlSecInternalError2("xmlSecTransformCtxExecute", NULL,
+                                 "uri=%s", xmlSecErrorsSafeString(dsigRefCtx->uri));
+            goto done;
+        }
+        preDigests[ii] = dsigRefCtx->transformCtx.result;
+    }
+
+    /* digest all the references with the same digest method at once */
+    for(ii = 0; ii < size; ++ii) {
+        if(dsigRefCtxs[ii] == NULL) {
+            continue;
+        }
+        digestId = dsigRefCtxs[ii]->digestMethod->id;
+
+        for(jj = ii, count = 0; jj < size; ++jj) {
+            if((dsigRefCtxs[jj] == NULL) || (dsigRefCtxs[jj]->digestMethod->id != digestId)) {
+                continue;
+            }
+            outputs[count] = xmlSecBufferCreate(0);
+            if(outputs[count] == NULL) {
+                xmlSecInternalError("xmlSecBufferCreate", NULL);
+                goto done;
+            }
+            inputs[count] = preDigests[jj];
+            ++count;
+        }
+
+        supported = 0;
+        if(dsigCtx->batchDigestCallback != NULL) {
+            ret = dsigCtx->batchDigestCallback(dsigCtx->batchDigestCtx, digestId, inputs, outputs, count);
+            if(ret < 0) {
+                xmlSecInternalError("batchDigestCallback", xmlSecTransformKlassGetName(digestId));
+                goto done;
+            }
+            supported = (ret == 0) ? 1 : 0;
+        }
+
+        for(jj = ii, count = 0; jj < size; ++jj) {
+            if((dsigRefCtxs[jj] == NULL) || (dsigRefCtxs[jj]->digestMethod->id != digestId)) {
+                continue;
+            }
+            /* if not supported then the digest method calculates it */
+            ret = xmlSecDSigReferenceCtxBatchDigestFinish(dsigRefCtxs[jj], preDigests[jj],
+                (supported != 0) ? outputs[count] : NULL);
+            if(ret < 0) {
+                xmlSecInternalError2("xmlSecDSigReferenceCtxBatchDigestFinish", NULL,
+                                     "uri=%s", xmlSecErrorsSafeString(dsigRefCtxs[jj]->uri));
+                goto done;
+            }
+            xmlSecBufferDestroy(outputs[count]);
+            outputs[count] = NULL;
+            dsigRefCtxs[jj] = NULL;
+            ++count;
+        }
+    }
+
+    /* merge results in the document order */
+    for(ii = 0; ii < size; ++ii) {
+        dsigRefCtx = (xmlSecDSigReferenceCtxPtr)xmlSecPtrListGetItem(&(dsigCtx->signedInfoReferences), ii);
+        xmlSecAssert2(dsigRefCtx != NULL, -1);
+
+        /* bail out if next Reference processing failed */
+        if(dsigRefCtx->status != xmlSecDSigStatusSucceeded) {
+            xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonReference);
+            res = 0;
+            goto done;
+        }
+
+        ret = xmlSecDSigReferenceCtxWriteResult(dsigRefCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxWriteResult", NULL);
+            goto done;
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(outputs != NULL) {
+        for(ii = 0; ii < size; ++ii) {
+            if(outputs[ii] != NULL) {
+                xmlSecBufferDestroy(outputs[ii]);
+            }
+        }
+        xmlFree(outputs);
+    }
+    if(inputs != NULL) {
+        xmlFree(inputs);
+    }
+    if(preDigests != NULL) {
+        xmlFree(preDigests);
+    }
+    if(dsigRefCtxs != NULL) {
+        xmlFree(dsigRefCtxs);
+    }
+    return(res);
+}
+
+
+static int
+xmlSecDSigCtxProcessKeyInfoNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
+    xmlSecStatsSpan span;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+
+    /* set key requirements */
+    ret = xmlSecTransformSetKeyReq(dsigCtx->signMethod, &(dsigCtx->keyInfoReadCtx.keyReq));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformSetKeyReq", xmlSecTransformGetName(dsigCtx->signMethod));
+        return(-1);
+    }
+
+    /* ignore <dsig:KeyInfo /> if there is the key is already set */
+    /* todo: throw an error if key is set and node != NULL? */
+    if((dsigCtx->signKey == NULL) && (dsigCtx->keyInfoReadCtx.keysMngr != NULL)
+                        && (dsigCtx->keyInfoReadCtx.keysMngr->getKey != NULL)) {
+        xmlSecStatsPhaseStart(xmlSecStatsPhaseKeyResolution, &span);
+        dsigCtx->signKey = (dsigCtx->keyInfoReadCtx.keysMngr->getKey)(node, &(dsigCtx->keyInfoReadCtx));
+        xmlSecStatsPhaseEnd(&span);
+    }
+
+    /* check that we have exactly what we want */
+    if((dsigCtx->signKey == NULL) || (!xmlSecKeyMatch(dsigCtx->signKey, NULL, &(dsigCtx->keyInfoReadCtx.keyReq)))) {
+        xmlSecOtherError(XMLSEC_ERRORS_R_KEY_NOT_FOUND, NULL, NULL);
+        xmlSecDSigCtxMarkAsFailed(dsigCtx, xmlSecDSigFailureReasonKeyNotFound);
+        return(-1);
+    }
+
+    /* set the key to the transform */
+    ret = xmlSecTransformSetKey(dsigCtx->signMethod, dsigCtx->signKey);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformSetKey", xmlSecTransformGetName(dsigCtx->signMethod));
+        return(-1);
+    }
+
+    /* if we are signing document, update &lt;dsig:KeyInfo/&gt; node */
+    if((node != NULL) && (dsigCtx->operation == xmlSecTransformOperationSign) &&
+       ((dsigCtx->flags & XMLSEC_DSIG_FLAGS_KEEP_KEYINFO) == 0)) {
+        ret = xmlSecKeyInfoNodeWrite(node, dsigCtx->signKey, &(dsigCtx->keyInfoWriteCtx));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeyInfoNodeWrite", NULL);
+            return(-1);
+        }
+    }
+
+    return(0);
+}
+
+/**
+ * xmlSecDSigCtxProcessObjectNode:
+ *
+ * The Object Element (http://www.w3.org/TR/xmldsig-core/#sec-Object)
+ *
+ * Object is an optional element that may occur one or more times. When
+ * present, this element may contain any data. The Object element may include
+ * optional MIME type, ID, and encoding attributes.
+ *
+ * Schema Definition:
+ *
+ * <element name="Object" type="ds:ObjectType"/>
+ * <complexType name="ObjectType" mixed="true">
+ *   <sequence minOccurs="0" maxOccurs="unbounded">
+ *     <any namespace="##any" processContents="lax"/>
+ *   </sequence>
+ *   <attribute name="Id" type="ID" use="optional"/>
+ *   <attribute name="MimeType" type="string" use="optional"/>
+ *   <attribute name="Encoding" type="anyURI" use="optional"/>
+ * </complexType>
+ *
+ * DTD:
+ *
+ * <!ELEMENT Object (#PCDATA|Signature|SignatureProperties|Manifest %Object.ANY;)* >
+ * <!ATTLIST Object  Id  ID  #IMPLIED
+ *                   MimeType    CDATA   #IMPLIED
+ *                   Encoding    CDATA   #IMPLIED >
+ */
+static int
+xmlSecDSigCtxProcessObjectNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
+    xmlNodePtr cur;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* we care about Manifest nodes only; ignore everything else */
+    cur = xmlSecGetNextElementNode(node->children);
+    while(cur != NULL) {
+        if(xmlSecCheckNodeName(cur, xmlSecNodeManifest, xmlSecDSigNs)) {
+            ret = xmlSecDSigCtxProcessManifestNode(dsigCtx, cur);
+            if(ret < 0){
+                xmlSecInternalError("xmlSecDSigCtxProcessManifestNode", NULL);
+                return(-1);
+            }
+        }
+        cur = xmlSecGetNextElementNode(cur->next);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecDSigCtxProcessManifestNode:
+ *
+ * The Manifest  Element (http://www.w3.org/TR/xmldsig-core/#sec-Manifest)
+ *
+ * The Manifest element provides a list of References. The difference from
+ * the list in SignedInfo is that it is application defined which, if any, of
+ * the digests are actually checked against the objects referenced and what to
+ * do if the object is inaccessible or the digest compare fails. If a Manifest
+ * is pointed to from SignedInfo, the digest over the Manifest itself will be
+ * checked by the core result validation behavior. The digests within such
+ * a Manifest are checked at the application's discretion. If a Manifest is
+ * referenced from another Manifest, even the overall digest of this two level
+ * deep Manifest might not be checked.
+ *
+ * Schema Definition:
+ *
+ * <element name="Manifest" type="ds:ManifestType"/>
+ * <complexType name="ManifestType">
+ *   <sequence>
+ *     <element ref="ds:Reference" maxOccurs="unbounded"/>
+ *   </sequence>
+ *   <attribute name="Id" type="ID" use="optional"/>
+ *  </complexType>
+ *
+ * DTD:
+ *
+ * <!ELEMENT Manifest (Reference+)  >
+ * <!ATTLIST Manifest Id ID  #IMPLIED >
+ */
+static int
+xmlSecDSigCtxProcessManifestNode(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr node) {
+    xmlSecDSigReferenceCtxPtr dsigRefCtx;
+    xmlNodePtr cur;
+    xmlSecSize first;
+    int execute;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->status == xmlSecDSigStatusUnknown, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* with executor, only read the nodes now and digest all the references later */
+    execute = ((dsigCtx->referencesExecutor != NULL) &&
+               ((dsigCtx->flags & XMLSEC_DSIG_FLAGS_EXECUTE_MANIFEST_REFERENCES) != 0)) ? 1 : 0;
+    first = xmlSecPtrListGetSize(&(dsigCtx->manifestReferences));
+
+    /* calculate references */
+    cur = xmlSecGetNextElementNode(node->children);
+    while((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs))) {
+        /* create reference */
+        dsigRefCtx = xmlSecDSigReferenceCtxCreate(dsigCtx, xmlSecDSigReferenceOriginManifest);
+        if(dsigRefCtx == NULL) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxCreate", NULL);
+            return(-1);
+        }
+
+        /* add to the list */
+        ret = xmlSecPtrListAdd(&(dsigCtx->manifestReferences), dsigRefCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecPtrListAdd", NULL);
+            xmlSecDSigReferenceCtxDestroy(dsigRefCtx);
+            return(-1);
+        }
+
+        /* only read the node now if the application verifies the reference later */
+        if(((dsigCtx->operation == xmlSecTransformOperationVerify) &&
+            ((dsigCtx->flags & XMLSEC_DSIG_FLAGS_DEFER_MANIFEST_REFERENCES) != 0)) ||
+           (execute != 0)) {
+            ret = xmlSecDSigReferenceCtxPrepareNode(dsigRefCtx, cur);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigReferenceCtxPrepareNode",
+                                    xmlSecNodeGetName(cur));
+                return(-1);
+            }
+            cur = xmlSecGetNextElementNode(cur->next);
+            continue;
+        }
+
+        /* process */
+        ret = xmlSecDSigReferenceCtxProcessNode(dsigRefCtx, cur);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxProcessNode",
+                                xmlSecNodeGetName(cur));
+            return(-1);
+        }
+
+        /* we don;t care if Reference processing failed because
+         * it's Manifest node */
+        cur = xmlSecGetNextElementNode(cur->next);
+    }
+
+    /* we should have nothing else here */
+    if(cur != NULL) {
+        xmlSecUnexpectedNodeError(cur,  NULL);
+        return(-1);
+    }
+
+    if((execute != 0) && ((dsigCtx->operation != xmlSecTransformOperationVerify) ||
+       ((dsigCtx->flags & XMLSEC_DSIG_FLAGS_DEFER_MANIFEST_REFERENCES) == 0))) {
+        ret = xmlSecDSigCtxExecuteManifestReferences(dsigCtx, first);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCtxExecuteManifestReferences", NULL);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+/* digests the Manifest references starting from @first with the executor */
+static int
+xmlSecDSigCtxExecuteManifestReferences(xmlSecDSigCtxPtr dsigCtx, xmlSecSize first) {
+    xmlSecDSigReferenceCtxPtr* dsigRefCtxs;
+    xmlSecSize ii, size;
+    int ret;
+    int res = -1;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->referencesExecutor != NULL, -1);
+
+    size = xmlSecPtrListGetSize(&(dsigCtx->manifestReferences));
+    if(size <= first) {
+        return(0);
+    }
+
+    dsigRefCtxs = (xmlSecDSigReferenceCtxPtr*)xmlMalloc(sizeof(xmlSecDSigReferenceCtxPtr) * (size - first));
+    if(dsigRefCtxs == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigReferenceCtxPtr) * (size - first), NULL);
+        return(-1);
+    }
+    for(ii = first; ii < size; ++ii) {
+        dsigRefCtxs[ii - first] = (xmlSecDSigReferenceCtxPtr)xmlSecPtrListGetItem(&(dsigCtx->manifestReferences), ii);
+        xmlSecAssert2(dsigRefCtxs[ii - first] != NULL, -1);
+    }
+
+    ret = dsigCtx->referencesExecutor(dsigCtx->referencesExecutorCtx,
+                xmlSecDSigReferenceCtxExecuteTask, dsigRefCtxs, size - first);
+    if(ret < 0) {
+        xmlSecInternalError("referencesExecutor", NULL);
+        goto done;
+    }
+
+    /* merge results in the document order (the failed Manifest references
+     * don't fail the signature) */
+    for(ii = 0; ii < size - first; ++ii) {
+        if(dsigRefCtxs[ii]->status == xmlSecDSigStatusUnknown) {
+            xmlSecInternalError2("xmlSecDSigReferenceCtxExecute", NULL,
+                                 "uri=%s", xmlSecErrorsSafeString(dsigRefCtxs[ii]->uri));
+            goto done;
+        }
+        ret = xmlSecDSigReferenceCtxWriteResult(dsigRefCtxs[ii]);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxWriteResult", NULL);
+            goto done;
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    xmlFree(dsigRefCtxs);
+    return(res);
+}
+
+/**************************************************************************
+ *
+ * The signature cost estimation: the &lt;dsig:Signature/&gt; nodes are
+ * examined without any c14n or crypto operation.
+ *
+ *************************************************************************/
+typedef struct _xmlSecDSigCostCtx {
+    xmlSecDSigCostPtr           cost;
+    xmlDocPtr                   doc;
+    int                         docCounted;
+    xmlSecSize                  docNodes;
+    xmlSecSize                  docBytes;
+} xmlSecDSigCostCtx, *xmlSecDSigCostCtxPtr;
+
+/* counts the nodes and the names and text sizes in the @root subtree */
+static void
+xmlSecDSigCostCountSubtree(xmlNodePtr root, xmlSecSize* nodes, xmlSecSize* bytes) {
+    xmlNodePtr cur;
+    xmlAttrPtr attr;
+
+    xmlSecAssert(root != NULL);
+    xmlSecAssert(nodes != NULL);
+    xmlSecAssert(bytes != NULL);
+
+    cur = root;
+    while(cur != NULL) {
+        ++(*nodes);
+        switch(cur->type) {
+        case XML_ELEMENT_NODE:
+            (*bytes) += xmlSecStrlen(cur->name);
+            for(attr = cur->properties; attr != NULL; attr = attr->next) {
+                ++(*nodes);
+                (*bytes) += xmlSecStrlen(attr->name);
+                if((attr->children != NULL) && (attr->children->content != NULL)) {
+                    (*bytes) += xmlSecStrlen(attr->children->content);
+                }
+            }
+            break;
+        case XML_TEXT_NODE:
+        case XML_CDATA_SECTION_NODE:
+        case XML_COMMENT_NODE:
+        case XML_PI_NODE:
+            (*bytes) += xmlSecStrlen(cur->content);
+            break;
+        default:
+            break;
+        }
+
+        /* only the elements and the document have the children in the node set */
+        if(((cur->type == XML_ELEMENT_NODE) || (cur->type == XML_DOCUMENT_NODE)) && (cur->children != NULL)) {
+            cur = cur->children;
+            continue;
+        }
+        while((cur != root) && (cur->next == NULL)) {
+            cur = cur->parent;
+        }
+        cur = (cur != root) ? cur->next : NULL;
+    }
+}
+
+static void
+xmlSecDSigCostAddDocument(xmlSecDSigCostCtxPtr ctx) {
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->cost != NULL);
+    xmlSecAssert(ctx->doc != NULL);
+
+    /* the whole document is walked once */
+    if(ctx->docCounted == 0) {
+        xmlSecDSigCostCountSubtree((xmlNodePtr)ctx->doc, &(ctx->docNodes), &(ctx->docBytes));
+        ctx->docCounted = 1;
+    }
+    ctx->cost->nodes += ctx->docNodes;
+    ctx->cost->bytes += ctx->docBytes;
+}
+
+static void
+xmlSecDSigCostAddId(xmlSecDSigCostCtxPtr ctx, const xmlChar* id) {
+    xmlAttrPtr attr;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->cost != NULL);
+    xmlSecAssert(ctx->doc != NULL);
+    xmlSecAssert(id != NULL);
+
+    /* the reference fails anyway if the id is not found */
+    attr = xmlGetID(ctx->doc, id);
+    if((attr != NULL) && (attr->parent != NULL)) {
+        xmlSecDSigCostCountSubtree(attr->parent, &(ctx->cost->nodes), &(ctx->cost->bytes));
+    }
+}
+
+/* "#xpointer(id('ID'))": the element subtree, any other expression: the whole document */
+static int
+xmlSecDSigCostAddXPointer(xmlSecDSigCostCtxPtr ctx, const xmlChar* uri) {
+    static const char prefix[] = "#xpointer(id(";
+    const xmlChar* start;
+    const xmlChar* end;
+    xmlChar* id;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(uri != NULL, -1);
+
+    if(xmlStrncmp(uri, BAD_CAST prefix, sizeof(prefix) - 1) != 0) {
+        xmlSecDSigCostAddDocument(ctx);
+        return(0);
+    }
+    start = uri + sizeof(prefix) - 1;
+    if(((*start) != '\'') && ((*start) != '\"')) {
+        xmlSecDSigCostAddDocument(ctx);
+        return(0);
+    }
+    end = xmlStrchr(start + 1, (*start));
+    if((end == NULL) || (xmlStrcmp(end + 1, BAD_CAST "))") != 0)) {
+        xmlSecDSigCostAddDocument(ctx);
+        return(0);
+    }
+
+    id = xmlStrndup(start + 1, (int)(end - start - 1));
+    if(id == NULL) {
+        xmlSecStrdupError(start + 1, NULL);
+        return(-1);
+    }
+    xmlSecDSigCostAddId(ctx, id);
+    xmlFree(id);
+    return(0);
+}
+
+static void
+xmlSecDSigCostAddTransforms(xmlSecDSigCostCtxPtr ctx, xmlNodePtr transformsNode) {
+    xmlNodePtr cur;
+    xmlChar* href;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->cost != NULL);
+    xmlSecAssert(transformsNode != NULL);
+
+    for(cur = xmlSecGetNextElementNode(transformsNode->children); cur != NULL; cur = xmlSecGetNextElementNode(cur->next)) {
+        if(!xmlSecCheckNodeName(cur, xmlSecNodeTransform, xmlSecDSigNs)) {
+            continue;
+        }
+        ++ctx->cost->transforms;
+
+        href = xmlGetProp(cur, xmlSecAttrAlgorithm);
+        if(href == NULL) {
+            continue;
+        }
+        if(xmlStrEqual(href, xmlSecXPathNs) || xmlStrEqual(href, xmlSecXPath2Ns) || xmlStrEqual(href, xmlSecXPointerNs)) {
+            ++ctx->cost->xpathTransforms;
+        } else if(xmlStrEqual(href, xmlSecHrefXslt)) {
+            ++ctx->cost->xsltTransforms;
+        } else if(xmlStrEqual(href, xmlSecHrefC14N) || xmlStrEqual(href, xmlSecHrefC14NWithComments) ||
+                  xmlStrEqual(href, xmlSecHrefC14N11) || xmlStrEqual(href, xmlSecHrefC14N11WithComments) ||
+                  xmlStrEqual(href, xmlSecHrefExcC14N) || xmlStrEqual(href, xmlSecHrefExcC14NWithComments)) {
+            ++ctx->cost->c14nTransforms;
+        }
+        xmlFree(href);
+    }
+}
+
+static int
+xmlSecDSigCostAddReference(xmlSecDSigCostCtxPtr ctx, xmlNodePtr refNode) {
+    xmlNodePtr cur;
+    xmlChar* uri;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->cost != NULL, -1);
+    xmlSecAssert2(refNode != NULL, -1);
+
+    ++ctx->cost->references;
+
+    uri = xmlGetProp(refNode, xmlSecAttrURI);
+    if(uri == NULL) {
+        /* the application provides the data */
+        ++ctx->cost->externalReferences;
+    } else if(uri[0] == '\0') {
+        ++ctx->cost->sameDocumentReferences;
+        xmlSecDSigCostAddDocument(ctx);
+    } else if(xmlStrncmp(uri, BAD_CAST "#xpointer(", 10) == 0) {
+        ++ctx->cost->sameDocumentReferences;
+        ++ctx->cost->xpointerReferences;
+        ret = xmlSecDSigCostAddXPointer(ctx, uri);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCostAddXPointer", NULL);
+            xmlFree(uri);
+            return(-1);
+        }
+    } else if(uri[0] == '#') {
+        ++ctx->cost->sameDocumentReferences;
+        xmlSecDSigCostAddId(ctx, uri + 1);
+    } else {
+        ++ctx->cost->externalReferences;
+    }
+    xmlFree(uri);
+
+    cur = xmlSecGetNextElementNode(refNode->children);
+    if((cur != NULL) && xmlSecCheckNodeName(cur, xmlSecNodeTransforms, xmlSecDSigNs)) {
+        xmlSecDSigCostAddTransforms(ctx, cur);
+    }
+    return(0);
+}
+
+/* counts the <dsig:RetrievalMethod/> and <enc:EncryptedKey/> nodes in the @node subtree */
+static void
+xmlSecDSigCostAddKeyInfo(xmlSecDSigCostCtxPtr ctx, xmlNodePtr node, xmlSecSize depth) {
+    xmlNodePtr cur;
+    xmlSecSize curDepth;
+
+    xmlSecAssert(ctx != NULL);
+    xmlSecAssert(ctx->cost != NULL);
+    xmlSecAssert(node != NULL);
+
+    for(cur = xmlSecGetNextElementNode(node->children); cur != NULL; cur = xmlSecGetNextElementNode(cur->next)) {
+        curDepth = depth;
+        if(xmlSecCheckNodeName(cur, xmlSecNodeRetrievalMethod, xmlSecDSigNs)) {
+            ++ctx->cost->retrievalMethods;
+        } else if(xmlSecCheckNodeName(cur, xmlSecNodeEncryptedKey, xmlSecEncNs)) {
+            ++ctx->cost->encryptedKeys;
+            ++curDepth;
+            if(ctx->cost->encryptedKeysDepth < curDepth) {
+                ctx->cost->encryptedKeysDepth = curDepth;
+            }
+        }
+        xmlSecDSigCostAddKeyInfo(ctx, cur, curDepth);
+    }
+}
+
+/**
+ * xmlSecDSigEstimateCost:
+ * @node:               the pointer to &lt;dsig:Signature/&gt; node.
+ * @cost:               the pointer to the result.
+ *
+ * Estimates the @node signature processing cost (see #xmlSecDSigCost) from
+ * the &lt;dsig:SignedInfo/&gt; and &lt;dsig:KeyInfo/&gt; nodes without
+ * executing any transform. The "#id" references are resolved with the
+ * document IDs (see #xmlSecAddIDs). The document nodes are walked at most
+ * once for all the references to the whole document plus once for each
+ * referenced element. The applications can use it to reject the expensive
+ * signatures early (see #xmlSecDSigCtx.maxCost).
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDSigEstimateCost(xmlNodePtr node, xmlSecDSigCostPtr cost) {
+    xmlSecDSigCostCtx ctx;
+    xmlNodePtr signedInfoNode;
+    xmlNodePtr cur;
+    int ret;
+
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->doc != NULL, -1);
+    xmlSecAssert2(cost != NULL, -1);
+
+    memset(cost, 0, sizeof(xmlSecDSigCost));
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.cost = cost;
+    ctx.doc = node->doc;
+
+    if(!xmlSecCheckNodeName(node, xmlSecNodeSignature, xmlSecDSigNs)) {
+        xmlSecInvalidNodeError(node, xmlSecNodeSignature, NULL);
+        return(-1);
+    }
+    signedInfoNode = xmlSecFindChild(node, xmlSecNodeSignedInfo, xmlSecDSigNs);
+    if(signedInfoNode == NULL) {
+        xmlSecNodeNotFoundError("xmlSecFindChild", node, xmlSecNodeSignedInfo, NULL);
+        return(-1);
+    }
+
+    for(cur = xmlSecGetNextElementNode(signedInfoNode->children); cur != NULL; cur = xmlSecGetNextElementNode(cur->next)) {
+        if(!xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs)) {
+            continue;
+        }
+        ret = xmlSecDSigCostAddReference(&ctx, cur);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigCostAddReference", NULL);
+            return(-1);
+        }
+    }
+
+    cur = xmlSecFindChild(node, xmlSecNodeKeyInfo, xmlSecDSigNs);
+    if(cur != NULL) {
+        xmlSecDSigCostAddKeyInfo(&ctx, cur, 0);
+    }
+    return(0);
+}
+
+#define XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, name)                       \
+    if(((maxCost)->name > 0) && ((cost)->name > (maxCost)->name)) {             \
+        xmlSecOtherError3(XMLSEC_ERRORS_R_COST_LIMIT_EXCEEDED, NULL,            \
+            #name "=" XMLSEC_SIZE_FMT "; limit=" XMLSEC_SIZE_FMT,               \
+            (cost)->name, (maxCost)->name);                                     \
+        return(0);                                                              \
+    }
+
+/**
+ * xmlSecDSigCostCheckLimits:
+ * @cost:               the pointer to the estimated cost (see #xmlSecDSigEstimateCost).
+ * @maxCost:            the pointer to the limits (0 means no limit).
+ *
+ * Checks the @cost against the non-zero @maxCost limits and reports
+ * the #XMLSEC_ERRORS_R_COST_LIMIT_EXCEEDED error for the first exceeded one.
+ *
+ * Returns: 1 if the @cost is within the limits, 0 if it is not or a negative
+ * value if an error occurs.
+ */
+int
+xmlSecDSigCostCheckLimits(const xmlSecDSigCost* cost, const xmlSecDSigCost* maxCost) {
+    xmlSecAssert2(cost != NULL, -1);
+    xmlSecAssert2(maxCost != NULL, -1);
+
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, references);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, sameDocumentReferences);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, xpointerReferences);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, externalReferences);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, transforms);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, xpathTransforms);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, xsltTransforms);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, c14nTransforms);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, nodes);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, bytes);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, retrievalMethods);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, encryptedKeys);
+    XMLSEC_DSIG_COST_CHECK_LIMIT(cost, maxCost, encryptedKeysDepth);
+    return(1);
+}
+
+/**************************************************************************
+ *
+ * xmlSecDSigCtxPool
+ *
+ *************************************************************************/
+static xmlSecPtrListKlass xmlSecDSigCtxPoolListKlass = {
+    BAD_CAST "dsig-ctx-pool-list",
+    NULL,                                               /* xmlSecPtrDuplicateItemMethod duplicateItem; */
+    (xmlSecPtrDestroyItemMethod)xmlSecDSigCtxDestroy,   /* xmlSecPtrDestroyItemMethod destroyItem; */
+    NULL,                                               /* xmlSecPtrDebugDumpItemMethod debugDumpItem; */
+    NULL,                                               /* xmlSecPtrDebugDumpItemMethod debugXmlDumpItem; */
+};
+
+/**
+ * xmlSecDSigCtxPoolCreate:
+ * @keysMngr:           the pointer to keys manager for the pooled contexts.
+ * @maxSize:            the max number of released contexts kept for reuse.
+ *
+ * Creates the pool of &lt;dsig:Signature/&gt; element processing contexts.
+ * The caller is responsible for destroying returned object by calling
+ * #xmlSecDSigCtxPoolDestroy function.
+ *
+ * Returns: pointer to newly allocated pool or NULL if an error occurs.
+ */
+xmlSecDSigCtxPoolPtr
+xmlSecDSigCtxPoolCreate(xmlSecKeysMngrPtr keysMngr, xmlSecSize maxSize) {
+    xmlSecDSigCtxPoolPtr pool;
+    int ret;
+
+    pool = (xmlSecDSigCtxPoolPtr) xmlMalloc(sizeof(xmlSecDSigCtxPool));
+    if(pool == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigCtxPool), NULL);
+        return(NULL);
+    }
+    memset(pool, 0, sizeof(xmlSecDSigCtxPool));
+
+    ret = xmlSecPtrListInitialize(&(pool->ctxs), &xmlSecDSigCtxPoolListKlass);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListInitialize", NULL);
+        xmlFree(pool);
+        return(NULL);
+    }
+    pool->keysMngr = keysMngr;
+    pool->maxSize  = maxSize;
+    return(pool);
+}
+
+/**
+ * xmlSecDSigCtxPoolDestroy:
+ * @pool:               the pointer to contexts pool.
+ *
+ * Destroys the pool and all the contexts kept in it. The contexts acquired
+ * from the pool and not released yet are not affected.
+ */
+void
+xmlSecDSigCtxPoolDestroy(xmlSecDSigCtxPoolPtr pool) {
+    xmlSecAssert(pool != NULL);
+
+    xmlSecPtrListFinalize(&(pool->ctxs));
+    memset(pool, 0, sizeof(xmlSecDSigCtxPool));
+    xmlFree(pool);
+}
+
+/**
+ * xmlSecDSigCtxPoolAcquire:
+ * @pool:               the pointer to contexts pool.
+ *
+ * Gets a previously released context from the @pool or creates a new one.
+ * The reused context keeps the user settings from its last use. The caller
+ * is responsible for returning the context with #xmlSecDSigCtxPoolRelease
+ * or destroying it with #xmlSecDSigCtxDestroy function.
+ *
+ * Returns: pointer to &lt;dsig:Signature/&gt; processing context or NULL
+ * if an error occurs.
+ */
+xmlSecDSigCtxPtr
+xmlSecDSigCtxPoolAcquire(xmlSecDSigCtxPoolPtr pool) {
+    xmlSecDSigCtxPtr dsigCtx;
+    xmlSecSize size;
+
+    xmlSecAssert2(pool != NULL, NULL);
+
+    size = xmlSecPtrListGetSize(&(pool->ctxs));
+    if(size > 0) {
+        dsigCtx = (xmlSecDSigCtxPtr)xmlSecPtrListRemoveAndReturn(&(pool->ctxs), size - 1);
+        if(dsigCtx == NULL) {
+            xmlSecInternalError("xmlSecPtrListRemoveAndReturn", NULL);
+            return(NULL);
+        }
+        return(dsigCtx);
+    }
+
+    dsigCtx = xmlSecDSigCtxCreate(pool->keysMngr);
+    if(dsigCtx == NULL) {
+        xmlSecInternalError("xmlSecDSigCtxCreate", NULL);
+        return(NULL);
+    }
+    return(dsigCtx);
+}
+
+/**
+ * xmlSecDSigCtxPoolRelease:
+ * @pool:               the pointer to contexts pool.
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ *
+ * Resets @dsigCtx and returns it to the @pool for reuse (or destroys it
+ * if the pool is full).
+ */
+void
+xmlSecDSigCtxPoolRelease(xmlSecDSigCtxPoolPtr pool, xmlSecDSigCtxPtr dsigCtx) {
+    int ret;
+
+    xmlSecAssert(pool != NULL);
+    xmlSecAssert(dsigCtx != NULL);
+
+    if(xmlSecPtrListGetSize(&(pool->ctxs)) >= pool->maxSize) {
+        xmlSecDSigCtxDestroy(dsigCtx);
+        return;
+    }
+
+    xmlSecDSigCtxReset(dsigCtx);
+    ret = xmlSecPtrListAdd(&(pool->ctxs), dsigCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListAdd", NULL);
+        xmlSecDSigCtxDestroy(dsigCtx);
+        return;
+    }
+}
+
+/**
+ * xmlSecDSigCtxGetStatusString:
+ * @status: the status.
+ *
+ * Gets status as a string.
+ *
+ * Returns status as a string.
+ */
+const char*
+xmlSecDSigCtxGetStatusString(xmlSecDSigStatus status) {
+    switch(status) {
+    case xmlSecDSigStatusSucceeded:
+        return "OK";
+
+    case xmlSecDSigStatusInvalid:
+        return "FAILED";
+
+    /* unknown status can only be caused by an error in the operation */
+    case xmlSecDSigStatusUnknown:
+    default:
+        return "ERROR";
+    }
+}
+
+/**
+ * xmlSecDSigCtxGetFailureReasonString:
+ * @failureReason:   the failure reason.
+ *
+ * Gets failure reason as a string.
+ *
+ * Returns failure reason as a string.
+ */
+const char*
+xmlSecDSigCtxGetFailureReasonString(xmlSecDSigFailureReason failureReason) {
+    switch(failureReason) {
+    case xmlSecDSigFailureReasonReference:
+        return "REFERENCE";
+
+    case xmlSecDSigFailureReasonSignature:
+        return "SIGNATURE";
+
+    case xmlSecDSigFailureReasonKeyNotFound:
+        return "KEY-NOT-FOUND";
+
+    case xmlSecDSigFailureReasonDeadline:
+        return "DEADLINE";
+
+    case xmlSecDSigFailureReasonCostLimit:
+        return "COST-LIMIT";
+
+    case xmlSecDSigFailureReasonUnknown:
+    default:
+        return "UNKNOWN";
+    }
+}
+
+/**
+ * xmlSecDSigCtxDebugDump:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @output:             the pointer to output FILE.
+ *
+ * Prints the debug information about @dsigCtx to @output.
+ */
+void
+xmlSecDSigCtxDebugDump(xmlSecDSigCtxPtr dsigCtx, FILE* output) {
+    xmlSecAssert(dsigCtx != NULL);
+    xmlSecAssert(output != NULL);
+
+    if(dsigCtx->operation == xmlSecTransformOperationSign) {
+        fprintf(output, "= SIGNATURE CONTEXT\n");
+    } else {
+        fprintf(output, "= VERIFICATION CONTEXT\n");
+    }
+    fprintf(output, "== Status: %s\n", xmlSecDSigCtxGetStatusString(dsigCtx->status));
+    fprintf(output, "== Failure reason: %s\n", xmlSecDSigCtxGetFailureReasonString(dsigCtx->failureReason));
+
+    fprintf(output, "== flags: 0x%08x\n", dsigCtx->flags);
+    fprintf(output, "== flags2: 0x%08x\n", dsigCtx->flags2);
+
+    if(dsigCtx->id != NULL) {
+        fprintf(output, "== Id: \"%s\"\n", dsigCtx->id);
+    }
+
+    fprintf(output, "== Key Info Read Ctx:\n");
+    xmlSecKeyInfoCtxDebugDump(&(dsigCtx->keyInfoReadCtx), output);
+    fprintf(output, "== Key Info Write Ctx:\n");
+    xmlSecKeyInfoCtxDebugDump(&(dsigCtx->keyInfoWriteCtx), output);
+
+    fprintf(output, "== Signature Transform Ctx:\n");
+    xmlSecTransformCtxDebugDump(&(dsigCtx->transformCtx), output);
+
+    if(dsigCtx->signMethod != NULL) {
+        fprintf(output, "== Signature Method:\n");
+        xmlSecTransformDebugDump(dsigCtx->signMethod, output);
+    }
+
+    if(dsigCtx->signKey != NULL) {
+        fprintf(output, "== Signature Key:\n");
+        xmlSecKeyDebugDump(dsigCtx->signKey, output);
+    }
+
+    fprintf(output, "== SignedInfo References List:\n");
+    xmlSecPtrListDebugDump(&(dsigCtx->signedInfoReferences), output);
+
+    fprintf(output, "== Manifest References List:\n");
+    xmlSecPtrListDebugDump(&(dsigCtx->manifestReferences), output);
+
+    if(xmlSecDSigCtxGetMemStats(dsigCtx) != NULL) {
+        fprintf(output, "== Memory Stats:\n");
+        xmlSecMemStatsDebugDump(&(dsigCtx->memStats), output);
+    }
+
+    if((dsigCtx->result != NULL) &&
+       (xmlSecBufferGetData(dsigCtx->result) != NULL)) {
+
+        fprintf(output, "== Result - start buffer:\n");
+        (void)fwrite(xmlSecBufferGetData(dsigCtx->result),
+                     xmlSecBufferGetSize(dsigCtx->result),
+                     1, output);
+        fprintf(output, "\n== Result - end buffer\n");
+    }
+    if(((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNATURE) != 0) &&
+       (xmlSecDSigCtxGetPreSignBuffer(dsigCtx) != NULL) &&
+       (xmlSecBufferGetData(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)) != NULL)) {
+
+        fprintf(output, "== PreSigned data - start buffer:\n");
+        (void)fwrite(xmlSecBufferGetData(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)),
+                     xmlSecBufferGetSize(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)),
+                     1, output);
+        fprintf(output, "\n== PreSigned data - end buffer\n");
+    }
+}
+
+/**
+ * xmlSecDSigCtxDebugXmlDump:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @output:             the pointer to output FILE.
+ *
+ * Prints the debug information about @dsigCtx to @output in XML format.
+ */
+void
+xmlSecDSigCtxDebugXmlDump(xmlSecDSigCtxPtr dsigCtx, FILE* output) {
+    xmlSecAssert(dsigCtx != NULL);
+    xmlSecAssert(output != NULL);
+
+    if(dsigCtx->operation == xmlSecTransformOperationSign) {
+        fprintf(output, "<SignatureContext\n");
+    } else {
+        fprintf(output, "<VerificationContext\n");
+    }
+    fprintf(output, " status=\"%s\"", xmlSecDSigCtxGetStatusString(dsigCtx->status));
+    fprintf(output, " failureReason=\"%s\"\n", xmlSecDSigCtxGetFailureReasonString(dsigCtx->failureReason));
+
+
+    fprintf(output, "<Flags>%08x</Flags>\n", dsigCtx->flags);
+    fprintf(output, "<Flags2>%08x</Flags2>\n", dsigCtx->flags2);
+
+    fprintf(output, "<Id>");
+    xmlSecPrintXmlString(output, dsigCtx->id);
+    fprintf(output, "</Id>\n");
+
+    fprintf(output, "<KeyInfoReadCtx>\n");
+    xmlSecKeyInfoCtxDebugXmlDump(&(dsigCtx->keyInfoReadCtx), output);
+    fprintf(output, "</KeyInfoReadCtx>\n");
+
+    fprintf(output, "<KeyInfoWriteCtx>\n");
+    xmlSecKeyInfoCtxDebugXmlDump(&(dsigCtx->keyInfoWriteCtx), output);
+    fprintf(output, "</KeyInfoWriteCtx>\n");
+
+    fprintf(output, "<SignatureTransformCtx>\n");
+    xmlSecTransformCtxDebugXmlDump(&(dsigCtx->transformCtx), output);
+    fprintf(output, "</SignatureTransformCtx>\n");
+
+    if(dsigCtx->signMethod != NULL) {
+        fprintf(output, "<SignatureMethod>\n");
+        xmlSecTransformDebugXmlDump(dsigCtx->signMethod, output);
+        fprintf(output, "</SignatureMethod>\n");
+    }
+
+    if(dsigCtx->signKey != NULL) {
+        fprintf(output, "<SignatureKey>\n");
+        xmlSecKeyDebugXmlDump(dsigCtx->signKey, output);
+        fprintf(output, "</SignatureKey>\n");
+    }
+
+    fprintf(output, "<SignedInfoReferences>\n");
+    xmlSecPtrListDebugXmlDump(&(dsigCtx->signedInfoReferences), output);
+    fprintf(output, "</SignedInfoReferences>\n");
+
+    fprintf(output, "<ManifestReferences>\n");
+    xmlSecPtrListDebugXmlDump(&(dsigCtx->manifestReferences), output);
+    fprintf(output, "</ManifestReferences>\n");
+
+    if(xmlSecDSigCtxGetMemStats(dsigCtx) != NULL) {
+        xmlSecMemStatsDebugXmlDump(&(dsigCtx->memStats), output);
+    }
+
+    if((dsigCtx->result != NULL) &&
+       (xmlSecBufferGetData(dsigCtx->result) != NULL)) {
+
+        fprintf(output, "<Result>");
+        (void)fwrite(xmlSecBufferGetData(dsigCtx->result),
+                     xmlSecBufferGetSize(dsigCtx->result),
+                     1, output);
+        fprintf(output, "</Result>\n");
+    }
+    if(((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNATURE) != 0) &&
+       (xmlSecDSigCtxGetPreSignBuffer(dsigCtx) != NULL) &&
+       (xmlSecBufferGetData(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)) != NULL)) {
+
+        fprintf(output, "<PreSignedData>");
+        (void)fwrite(xmlSecBufferGetData(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)),
+                     xmlSecBufferGetSize(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)),
+                     1, output);
+        fprintf(output, "</PreSignedData>\n");
+    }
+
+    if(dsigCtx->operation == xmlSecTransformOperationSign) {
+        fprintf(output, "</SignatureContext>\n");
+    } else {
+        fprintf(output, "</VerificationContext>\n");
+    }
+}
+
+/**************************************************************************
+ *
+ * xmlSecDSigTemplate: the &lt;dsig:Signature/&gt; template copy in its own
+ * document, instantiated with one xmlDocCopyNode() call
+ *
+ *************************************************************************/
+struct _xmlSecDSigTemplate {
+    xmlDocPtr                   doc;
+    xmlSecSize                  referencesSize;
+};
+
+/**
+ * xmlSecDSigTemplateCreate:
+ * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
+ * @tmpl:               the pointer to &lt;dsig:Signature/&gt; node with signature template.
+ *
+ * Prepares the signature template @tmpl (created with the xmlSecTmpl* functions)
+ * for signing many documents. The template is checked and copied, and if
+ * #xmlSecDSigCtx.signKey is set in @dsigCtx then the &lt;dsig:KeyInfo/&gt;
+ * node is written once using #xmlSecDSigCtx.keyInfoWriteCtx. The instances
+ * created by #xmlSecDSigTemplateInstantiate are signed with the same key
+ * and #XMLSEC_DSIG_FLAGS_KEEP_KEYINFO flag.
+ *
+ * Returns: the pointer to newly allocated template or NULL if an error occurs.
+ * The caller is responsible for destroying the template with #xmlSecDSigTemplateDestroy.
+ */
+xmlSecDSigTemplatePtr
+xmlSecDSigTemplateCreate(xmlSecDSigCtxPtr dsigCtx, xmlNodePtr tmpl) {
+    xmlSecDSigTemplatePtr dsigTmpl;
+    xmlNodePtr root, cur;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, NULL);
+    xmlSecAssert2(tmpl != NULL, NULL);
+
+    if(!xmlSecCheckNodeName(tmpl, xmlSecNodeSignature, xmlSecDSigNs)) {
+        xmlSecInvalidNodeError(tmpl, xmlSecNodeSignature, NULL);
+        return(NULL);
+    }
+
+    dsigTmpl = (xmlSecDSigTemplatePtr)xmlMalloc(sizeof(xmlSecDSigTemplate));
+    if(dsigTmpl == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigTemplate), NULL);
+        return(NULL);
+    }
+    memset(dsigTmpl, 0, sizeof(xmlSecDSigTemplate));
+
+    dsigTmpl->doc = xmlNewDoc(BAD_CAST "1.0");
+    if(dsigTmpl->doc == NULL) {
+        xmlSecXmlError("xmlNewDoc", NULL);
+        xmlSecDSigTemplateDestroy(dsigTmpl);
+        return(NULL);
+    }
+    root = xmlDocCopyNode(tmpl, dsigTmpl->doc, 1);
+    if(root == NULL) {
+        xmlSecXmlError("xmlDocCopyNode", NULL);
+        xmlSecDSigTemplateDestroy(dsigTmpl);
+        return(NULL);
+    }
+    xmlDocSetRootElement(dsigTmpl->doc, root);
+
+    /* first node is required SignedInfo with the references */
+    cur = xmlSecGetNextElementNode(root->children);
+    if((cur == NULL) || (!xmlSecCheckNodeName(cur, xmlSecNodeSignedInfo, xmlSecDSigNs))) {
+        xmlSecInvalidNodeError(cur, xmlSecNodeSignedInfo, NULL);
+        xmlSecDSigTemplateDestroy(dsigTmpl);
+        return(NULL);
+    }
+    for(cur = xmlSecGetNextElementNode(cur->children); cur != NULL; cur = xmlSecGetNextElementNode(cur->next)) {
+        if(xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs)) {
+            ++dsigTmpl->referencesSize;
+        }
+    }
+
+    /* write the key data once */
+    cur = xmlSecFindChild(root, xmlSecNodeKeyInfo, xmlSecDSigNs);
+    if((cur != NULL) && (dsigCtx->signKey != NULL)) {
+        ret = xmlSecKeyInfoNodeWrite(cur, dsigCtx->signKey, &(dsigCtx->keyInfoWriteCtx));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeyInfoNodeWrite", NULL);
+            xmlSecDSigTemplateDestroy(dsigTmpl);
+            return(NULL);
+        }
+    }
+    return(dsigTmpl);
+}
+
+/**
+ * xmlSecDSigTemplateDestroy:
+ * @dsigTmpl:           the pointer to signature template.
+ *
+ * Destroys the signature template.
+ */
+void
+xmlSecDSigTemplateDestroy(xmlSecDSigTemplatePtr dsigTmpl) {
+    xmlSecAssert(dsigTmpl != NULL);
+
+    if(dsigTmpl->doc != NULL) {
+        xmlFreeDoc(dsigTmpl->doc);
+    }
+    memset(dsigTmpl, 0, sizeof(xmlSecDSigTemplate));
+    xmlFree(dsigTmpl);
+}
+
+/**
+ * xmlSecDSigTemplateInstantiate:
+ * @dsigTmpl:           the pointer to signature template.
+ * @doc:                the pointer to the document to sign.
+ * @uris:               the URI attributes for the &lt;dsig:SignedInfo/&gt;
+ *                      references in the document order (a NULL item keeps
+ *                      the template URI) or NULL.
+ * @urisSize:           the number of elements in @uris.
+ *
+ * Creates new &lt;dsig:Signature/&gt; node in @doc from the template. The
+ * application is responsible for inserting the returned node in the XML
+ * document and signing it with #xmlSecDSigCtxSign function.
+ *
+ * Returns: the pointer to newly created &lt;dsig:Signature/&gt; node or
+ * NULL if an error occurs.
+ */
+xmlNodePtr
+xmlSecDSigTemplateInstantiate(xmlSecDSigTemplatePtr dsigTmpl, xmlDocPtr doc,
+                              const xmlChar** uris, xmlSecSize urisSize) {
+    xmlNodePtr res, cur;
+    xmlSecSize ii;
+
+    xmlSecAssert2(dsigTmpl != NULL, NULL);
+    xmlSecAssert2(dsigTmpl->doc != NULL, NULL);
+    xmlSecAssert2(doc != NULL, NULL);
+    xmlSecAssert2((uris != NULL) || (urisSize == 0), NULL);
+
+    if(urisSize > dsigTmpl->referencesSize) {
+        xmlSecInvalidSizeMoreThanError("References number", urisSize,
+                                       dsigTmpl->referencesSize, NULL);
+        return(NULL);
+    }
+
+    res = xmlDocCopyNode(xmlDocGetRootElement(dsigTmpl->doc), doc, 1);
+    if(res == NULL) {
+        xmlSecXmlError("xmlDocCopyNode", NULL);
+        return(NULL);
+    }
+    if(urisSize == 0) {
+        return(res);
+    }
+
+    cur = xmlSecGetNextElementNode(res->children);
+    xmlSecAssert2(cur != NULL, NULL);
+    cur = xmlSecGetNextElementNode(cur->children);
+    for(ii = 0; (cur != NULL) && (ii < urisSize); cur = xmlSecGetNextElementNode(cur->next)) {
+        if(!xmlSecCheckNodeName(cur, xmlSecNodeReference, xmlSecDSigNs)) {
+            continue;
+        }
+        if((uris[ii] != NULL) && (xmlSetProp(cur, xmlSecAttrURI, uris[ii]) == NULL)) {
+            xmlSecXmlError2("xmlSetProp", NULL,
+                            "name=%s", xmlSecErrorsSafeString(xmlSecAttrURI));
+            xmlFreeNode(res);
+            return(NULL);
+        }
+        ++ii;
+    }
+    return(res);
+}
+
+/**************************************************************************
+ *
+ * xmlSecDSigReferenceCtx
+ *
+ *************************************************************************/
+/**
+ * xmlSecDSigReferenceCtxCreate:
+ * @dsigCtx:            the pointer to parent &lt;dsig:Signature/&gt; node processing context.
+ * @origin:             the reference origin (&lt;dsig:SignedInfo/&gt; or &lt;dsig:Manifest/&gt; node).
+ *
+ * Creates new &lt;dsig:Reference/&gt; element processing context. Caller is responsible
+ * for destroying the returned context by calling #xmlSecDSigReferenceCtxDestroy
+ * function.
+ *
+ * Returns: pointer to newly created context or NULL if an error occurs.
+ */
+xmlSecDSigReferenceCtxPtr
+xmlSecDSigReferenceCtxCreate(xmlSecDSigCtxPtr dsigCtx, xmlSecDSigReferenceOrigin origin) {
+    xmlSecDSigReferenceCtxPtr dsigRefCtx;
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, NULL);
+
+    dsigRefCtx = (xmlSecDSigReferenceCtxPtr) xmlMalloc(sizeof(xmlSecDSigReferenceCtx));
+    if(dsigRefCtx == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigReferenceCtx), NULL);
+        return(NULL);
+    }
+
+    ret = xmlSecDSigReferenceCtxInitialize(dsigRefCtx, dsigCtx, origin);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxInitialize", NULL);
+        xmlSecDSigReferenceCtxDestroy(dsigRefCtx);
+        return(NULL);
+    }
+    return(dsigRefCtx);
+}
+
+/**
+ * xmlSecDSigReferenceCtxDestroy:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ *
+ * Destroy context object created with #xmlSecDSigReferenceCtxCreate function.
+ */
+void
+xmlSecDSigReferenceCtxDestroy(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    xmlSecAssert(dsigRefCtx != NULL);
+
+    xmlSecDSigReferenceCtxFinalize(dsigRefCtx);
+    xmlFree(dsigRefCtx);
+}
+
+/**
+ * xmlSecDSigReferenceCtxInitialize:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ * @dsigCtx:            the pointer to parent &lt;dsig:Signature/&gt; node processing context.
+ * @origin:             the reference origin (&lt;dsig:SignedInfo/&gt; or &lt;dsig:Manifest/&gt; node).
+ *
+ * Initializes new &lt;dsig:Reference/&gt; element processing context. Caller is responsible
+ * for cleaning up the returned context by calling #xmlSecDSigReferenceCtxFinalize
+ * function.
+ *
+ * Returns: 0 on succes or aa negative value otherwise.
+ */
+int
+xmlSecDSigReferenceCtxInitialize(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlSecDSigCtxPtr dsigCtx,
+                                xmlSecDSigReferenceOrigin origin) {
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+
+    memset(dsigRefCtx, 0, sizeof(xmlSecDSigReferenceCtx));
+
+    dsigRefCtx->dsigCtx = dsigCtx;
+    dsigRefCtx->origin = origin;
+
+    /* initializes transforms dsigRefCtx */
+    ret = xmlSecTransformCtxInitialize(&(dsigRefCtx->transformCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxInitialize", NULL);
+        return(-1);
+    }
+
+    /* copy enabled transforms */
+    if(dsigCtx->enabledReferenceTransforms != NULL) {
+        ret = xmlSecPtrListCopy(&(dsigRefCtx->transformCtx.enabledTransforms),
+                                     dsigCtx->enabledReferenceTransforms);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecPtrListCopy", NULL);
+            return(-1);
+        }
+    }
+    dsigRefCtx->transformCtx.preExecCallback = dsigCtx->referencePreExecuteCallback;
+    dsigRefCtx->transformCtx.enabledUris = dsigCtx->enabledReferenceUris;
+    dsigRefCtx->transformCtx.ioCallbacks = dsigCtx->transformCtx.ioCallbacks;
+    dsigRefCtx->transformCtx.userData = dsigCtx->userData;
+    dsigRefCtx->transformCtx.binaryChunkSize = dsigCtx->transformCtx.binaryChunkSize;
+    dsigRefCtx->transformCtx.binaryChunkSizeMin = dsigCtx->transformCtx.binaryChunkSizeMin;
+    dsigRefCtx->transformCtx.binaryChunkSizeMax = dsigCtx->transformCtx.binaryChunkSizeMax;
+    dsigRefCtx->transformCtx.deadline = dsigCtx->transformCtx.deadline;
+    dsigRefCtx->transformCtx.cancelFlag = dsigCtx->transformCtx.cancelFlag;
+    /* references executed by the executor might allocate concurrently */
+    if(dsigCtx->referencesExecutor == NULL) {
+        dsigRefCtx->transformCtx.arena = dsigCtx->transformCtx.arena;
+    }
+
+    if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_USE_VISA3D_HACK) != 0) {
+        dsigRefCtx->transformCtx.flags |= XMLSEC_TRANSFORMCTX_FLAGS_USE_VISA3D_HACK;
+    }
+    if((dsigCtx->transformCtx.flags & XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N) != 0) {
+        dsigRefCtx->transformCtx.flags |= XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N;
+    }
+    if((dsigCtx->transformCtx.flags & XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE) != 0) {
+        dsigRefCtx->transformCtx.flags |= XMLSEC_TRANSFORMCTX_FLAGS_ADAPTIVE_CHUNK_SIZE;
+    }
+
+    /* collect the references stats along with the SignedInfo ones */
+    if((dsigCtx->transformCtx.flags & XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS) != 0) {
+        dsigRefCtx->transformCtx.flags |= XMLSEC_TRANSFORMCTX_FLAGS_COLLECT_STATS;
+        dsigRefCtx->transformCtx.statsCallback = dsigCtx->transformCtx.statsCallback;
+    }
+    return(0);
+}
+
+/**
+ * xmlSecDSigReferenceCtxFinalize:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ *
+ * Cleans up context object created with #xmlSecDSigReferenceCtxInitialize function.
+ */
+void
+xmlSecDSigReferenceCtxFinalize(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    xmlSecAssert(dsigRefCtx != NULL);
+
+    xmlSecDSigReferenceCtxDestroyDetachedDigestMethod(dsigRefCtx);
+    xmlSecTransformCtxFinalize(&(dsigRefCtx->transformCtx));
+    if(dsigRefCtx->id != NULL) {
+        xmlFree(dsigRefCtx->id);
+    }
+    if(dsigRefCtx->uri != NULL) {
+        xmlFree(dsigRefCtx->uri);
+    }
+    if(dsigRefCtx->type != NULL) {
+        xmlFree(dsigRefCtx->type);
+    }
+    memset(dsigRefCtx, 0, sizeof(xmlSecDSigReferenceCtx));
+}
+
+/**
+ * xmlSecDSigReferenceCtxGetPreDigestBuffer:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ *
+ * Gets the results of &lt;dsig:Reference/&gt; node processing just before digesting
+ * (valid only if #XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES or
+ * #XMLSEC_DSIG_FLAGS_STORE_MANIFEST_REFERENCES flas of signature context
+ * is set; the buffer is empty if the data is passed to
+ * #xmlSecDSigCtx.preDataSink instead).
+ *
+ * Returns: pointer to the buffer or NULL if an error occurs.
+ */
+xmlSecBufferPtr
+xmlSecDSigReferenceCtxGetPreDigestBuffer(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    xmlSecAssert2(dsigRefCtx != NULL, NULL);
+
+    return((dsigRefCtx->preDigestMemBufMethod != NULL) ?
+            xmlSecTransformMemBufGetBuffer(dsigRefCtx->preDigestMemBufMethod) : NULL);
+}
+
+static int
+xmlSecDSigReferenceCtxPreDigestSink(void* sinkCtx, const xmlSecByte* data, xmlSecSize size, int last) {
+    xmlSecDSigReferenceCtxPtr dsigRefCtx = (xmlSecDSigReferenceCtxPtr)sinkCtx;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx->preDataSink != NULL, -1);
+
+    return(dsigRefCtx->dsigCtx->preDataSink(dsigRefCtx->dsigCtx->preDataSinkCtx,
+                dsigRefCtx->dsigCtx, dsigRefCtx, data, size, last));
+}
+
+/**
+ * xmlSecDSigReferenceCtxProcessNode:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ * @node:               the pointer to &lt;dsig:Reference/&gt; node.
+
+ * The Reference Element (http://www.w3.org/TR/xmldsig-core/#sec-Reference)
+ *
+ * Reference is an element that may occur one or more times. It specifies
+ * a digest algorithm and digest value, and optionally an identifier of the
+ * object being signed, the type of the object, and/or a list of transforms
+ * to be applied prior to digesting. The identification (URI) and transforms
+ * describe how the digested content (i.e., the input to the digest method)
+ * was created. The Type attribute facilitates the processing of referenced
+ * data. For example, while this specification makes no requirements over
+ * external data, an application may wish to signal that the referent is a
+ * Manifest. An optional ID attribute permits a Reference to be referenced
+ * from elsewhere.
+ *
+ * Returns: 0 on succes or aa negative value otherwise.
+ */
+int
+xmlSecDSigReferenceCtxProcessNode(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlNodePtr node) {
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    ret = xmlSecDSigReferenceCtxPrepareNode(dsigRefCtx, node);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxPrepareNode", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecDSigReferenceCtxExecute(dsigRefCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxExecute", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecDSigReferenceCtxWriteResult(dsigRefCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxWriteResult", NULL);
+        return(-1);
+    }
+
+    return(0);
+}
+
+/**
+ * xmlSecDSigReferenceCtxVerify:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ *
+ * Calculates and verifies the digest for the &lt;dsig:Manifest/&gt; reference
+ * left unprocessed by #xmlSecDSigCtxVerify function because of the
+ * #XMLSEC_DSIG_FLAGS_DEFER_MANIFEST_REFERENCES flag. The parent
+ * &lt;dsig:Signature/&gt; processing context must not be reset and
+ * the document must not be modified in between. Does nothing if the
+ * reference was already verified. The verification result is returned
+ * in #status member of the @dsigRefCtx object.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDSigReferenceCtxVerify(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationVerify, -1);
+    xmlSecAssert2(dsigRefCtx->digestMethod != NULL, -1);
+
+    if(dsigRefCtx->status != xmlSecDSigStatusUnknown) {
+        return(0);
+    }
+
+    ret = xmlSecDSigReferenceCtxExecute(dsigRefCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxExecute", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* reads the &lt;dsig:Reference/&gt; node and creates transforms chain */
+static int
+xmlSecDSigReferenceCtxPrepareNode(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlNodePtr node) {
+    xmlSecTransformCtxPtr transformCtx;
+    xmlNodePtr cur;
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestMethod == NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode == NULL, -1);
+    xmlSecAssert2(dsigRefCtx->preDigestMemBufMethod == NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->doc != NULL, -1);
+
+    transformCtx = &(dsigRefCtx->transformCtx);
+
+    /* read attributes first */
+    dsigRefCtx->uri = xmlGetProp(node, xmlSecAttrURI);
+    dsigRefCtx->id  = xmlGetProp(node, xmlSecAttrId);
+    dsigRefCtx->type= xmlGetProp(node, xmlSecAttrType);
+
+    /* set start URI (and check that it is enabled!) */
+    ret = xmlSecTransformCtxSetUri(transformCtx, dsigRefCtx->uri, node);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecTransformCtxSetUri", NULL,
+                             "uri=%s", xmlSecErrorsSafeString(dsigRefCtx->uri));
+        return(-1);
+    }
+
+    /* first is optional Transforms node */
+    cur  = xmlSecGetNextElementNode(node->children);
+    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeTransforms, xmlSecDSigNs))) {
+        ret = xmlSecTransformCtxNodesListRead(transformCtx,
+                                        cur, xmlSecTransformUsageDSigTransform);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecTransformCtxNodesListRead", NULL,
+                                 "node=%s", xmlSecErrorsSafeString(xmlSecNodeGetName(cur)));
+            return(-1);
+        }
+
+        cur = xmlSecGetNextElementNode(cur->next);
+    }
+
+    /* insert membuf if requested */
+    if(((dsigRefCtx->origin == xmlSecDSigReferenceOriginSignedInfo) &&
+        ((dsigRefCtx->dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES) != 0)) ||
+       ((dsigRefCtx->origin == xmlSecDSigReferenceOriginManifest) &&
+        ((dsigRefCtx->dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_MANIFEST_REFERENCES) != 0))) {
+
+        xmlSecAssert2(dsigRefCtx->preDigestMemBufMethod == NULL, -1);
+        dsigRefCtx->preDigestMemBufMethod = xmlSecTransformCtxCreateAndAppend(
+                                                transformCtx,
+                                                xmlSecTransformMemBufId);
+        if(dsigRefCtx->preDigestMemBufMethod == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend(xmlSecTransformMemBufId)", NULL);
+            return(-1);
+        }
+        if(dsigRefCtx->dsigCtx->preDataSink != NULL) {
+            ret = xmlSecTransformMemBufSetSink(dsigRefCtx->preDigestMemBufMethod,
+                                               xmlSecDSigReferenceCtxPreDigestSink, dsigRefCtx);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecTransformMemBufSetSink", NULL);
+                return(-1);
+            }
+        }
+    }
+
+    /* next node is required DigestMethod. */
+    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeDigestMethod, xmlSecDSigNs))) {
+        dsigRefCtx->digestMethod = xmlSecTransformCtxNodeRead(&(dsigRefCtx->transformCtx),
+                                        cur, xmlSecTransformUsageDigestMethod);
+        if(dsigRefCtx->digestMethod == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxNodeRead",
+                                xmlSecNodeGetName(cur));
+            return(-1);
+        }
+
+        cur = xmlSecGetNextElementNode(cur->next);
+    } else if(dsigRefCtx->dsigCtx->defSignMethodId != xmlSecTransformIdUnknown) {
+        /* the dsig spec does require DigestMethod node
+         * to be present but in some case it application might decide to
+         * minimize traffic */
+        dsigRefCtx->digestMethod = xmlSecTransformCtxCreateAndAppend(&(dsigRefCtx->transformCtx),
+                                                              dsigRefCtx->dsigCtx->defSignMethodId);
+        if(dsigRefCtx->digestMethod == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
+            return(-1);
+        }
+    } else {
+        /* if digest method is not specified in the template and not specified in
+         * the dsig context then it's an error.
+         */
+        xmlSecInvalidNodeError(cur, xmlSecNodeDigestMethod, NULL);
+        return(-1);
+    }
+    dsigRefCtx->digestMethod->operation = dsigRefCtx->dsigCtx->operation;
+
+    /* last node is required DigestValue */
+    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeDigestValue, xmlSecDSigNs))) {
+        dsigRefCtx->digestValueNode = cur;
+        cur = xmlSecGetNextElementNode(cur->next);
+    } else {
+        xmlSecInvalidNodeError(cur, xmlSecNodeDigestValue, NULL);
+        return(-1);
+    }
+
+    /* if we have something else then it's an error */
+    if(cur != NULL) {
+        xmlSecUnexpectedNodeError(cur,  NULL);
+        return(-1);
+    }
+
+    /* if we need to write result to xml node then we need base64 encode result */
+    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
+        xmlSecTransformPtr base64Encode;
+
+        /* we need to add base64 encode transform */
+        base64Encode = xmlSecTransformCtxCreateAndAppend(transformCtx, xmlSecTransformBase64Id);
+        if(base64Encode == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
+            return(-1);
+        }
+        base64Encode->operation = xmlSecTransformOperationEncode;
+    }
+
+    return(0);
+}
+
+/* calculates or verifies the digest (using the digests cache if any): the document is not modified */
+static int
+xmlSecDSigReferenceCtxExecute(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    xmlSecBuffer cacheId;
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+
+    if(dsigRefCtx->dsigCtx->digestCache == NULL) {
+        return(xmlSecDSigReferenceCtxExecuteTransforms(dsigRefCtx));
+    }
+
+    ret = xmlSecBufferInitialize(&cacheId, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        return(-1);
+    }
+
+    /* the cache id is calculated before reading the resource */
+    ret = xmlSecDSigReferenceCtxCacheFind(dsigRefCtx, &cacheId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxCacheFind", NULL);
+        xmlSecBufferFinalize(&cacheId);
+        return(-1);
+    } else if(ret == 1) {
+        /* cache hit: the transforms are not executed */
+        xmlSecBufferFinalize(&cacheId);
+        return(0);
+    }
+
+    ret = xmlSecDSigReferenceCtxExecuteTransforms(dsigRefCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxExecuteTransforms", NULL);
+        xmlSecBufferFinalize(&cacheId);
+        return(-1);
+    }
+
+    if((xmlSecBufferGetSize(&cacheId) > 0) && (dsigRefCtx->status == xmlSecDSigStatusSucceeded)) {
+        ret = xmlSecDSigReferenceCtxCacheAdd(dsigRefCtx, &cacheId);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxCacheAdd", NULL);
+            xmlSecBufferFinalize(&cacheId);
+            return(-1);
+        }
+    }
+
+    xmlSecBufferFinalize(&cacheId);
+    return(0);
+}
+
+/* executes transforms chain and calculates or verifies the digest: the document is not modified */
+static int
+xmlSecDSigReferenceCtxExecuteTransforms(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    xmlSecTransformCtxPtr transformCtx;
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestMethod != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode->doc != NULL, -1);
+
+    transformCtx = &(dsigRefCtx->transformCtx);
+
+    /* finally get transforms results */
+    ret = xmlSecTransformCtxExecute(transformCtx, dsigRefCtx->digestValueNode->doc);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxExecute", NULL);
+        return(-1);
+    }
+    dsigRefCtx->result = transformCtx->result;
+
+    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
+        if((dsigRefCtx->result == NULL) || (xmlSecBufferGetData(dsigRefCtx->result) == NULL)) {
+            xmlSecInternalError("xmlSecTransformCtxExecute", NULL);
+            return(-1);
+        }
+
+        /* set success status, the result is written to xml later */
+        dsigRefCtx->status = xmlSecDSigStatusSucceeded;
+    } else {
+        /* verify SignatureValue node content */
+        ret = xmlSecTransformVerifyNodeContent(dsigRefCtx->digestMethod,
+                            dsigRefCtx->digestValueNode, transformCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformVerifyNodeContent", NULL);
+            return(-1);
+        }
+
+        /* set status and we are done */
+        if(dsigRefCtx->digestMethod->status == xmlSecTransformStatusOk) {
+            dsigRefCtx->status = xmlSecDSigStatusSucceeded;
+        } else {
+            dsigRefCtx->status = xmlSecDSigStatusInvalid;
+        }
+    }
+
+    return(0);
+}
+
+/* writes calculated digest to &lt;dsig:DigestValue/&gt; node (sign only) */
+static int
+xmlSecDSigReferenceCtxWriteResult(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    xmlSecByte* outBuf;
+    xmlSecSize outSize;
+    int outLen;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+
+    if(dsigRefCtx->dsigCtx->operation != xmlSecTransformOperationSign) {
+        return(0);
+    }
+    xmlSecAssert2(dsigRefCtx->result != NULL, -1);
+
+    /* write signed data to xml */
+    outBuf = xmlSecBufferGetData(dsigRefCtx->result);
+    outSize = xmlSecBufferGetSize(dsigRefCtx->result);
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(outSize, outLen, return(-1), NULL);
+    xmlNodeSetContentLen(dsigRefCtx->digestValueNode, outBuf, outLen);
+    return(0);
+}
+
+/* takes the digest method (and the base64 encode on signing) out of the transforms
+ * chain: the chain result is the pre-digest data for #xmlSecDSigBatchDigestCallback */
+static int
+xmlSecDSigReferenceCtxDetachDigestMethod(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    xmlSecTransformCtxPtr transformCtx;
+    xmlSecTransformPtr digestMethod;
+    xmlSecTransformPtr base64Encode;
+    xmlSecTransformPtr memBuf;
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestMethod != NULL, -1);
+
+    transformCtx = &(dsigRefCtx->transformCtx);
+    digestMethod = dsigRefCtx->digestMethod;
+    base64Encode = digestMethod->next;
+    xmlSecAssert2(transformCtx->last == ((base64Encode != NULL) ? base64Encode : digestMethod), -1);
+
+    transformCtx->last = digestMethod->prev;
+    if(transformCtx->first == digestMethod) {
+        transformCtx->first = NULL;
+    }
+    if(base64Encode != NULL) {
+        xmlSecTransformRemove(base64Encode);
+    }
+    xmlSecTransformRemove(digestMethod);
+
+    /* verification: the digest method compares the digest itself */
+    if(base64Encode == NULL) {
+        return(0);
+    }
+
+    /* signing: the base64 encoded digest is written to the membuf */
+    ret = xmlSecTransformConnect(digestMethod, base64Encode, transformCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformConnect", xmlSecTransformGetName(digestMethod));
+        xmlSecTransformDestroy(base64Encode);
+        return(-1);
+    }
+
+    memBuf = xmlSecTransformCreate(xmlSecTransformMemBufId);
+    if(memBuf == NULL) {
+        xmlSecInternalError("xmlSecTransformCreate",
+                            xmlSecTransformKlassGetName(xmlSecTransformMemBufId));
+        return(-1);
+    }
+    ret = xmlSecTransformConnect(base64Encode, memBuf, transformCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformConnect", xmlSecTransformGetName(base64Encode));
+        xmlSecTransformDestroy(memBuf);
+        return(-1);
+    }
+    return(0);
+}
+
+static void
+xmlSecDSigReferenceCtxDestroyDetachedDigestMethod(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    xmlSecTransformPtr transform, tmp;
+
+    xmlSecAssert(dsigRefCtx != NULL);
+
+    if(dsigRefCtx->digestMethod == NULL) {
+        return;
+    }
+    for(transform = dsigRefCtx->transformCtx.first; transform != NULL; transform = transform->next) {
+        if(transform == dsigRefCtx->digestMethod) {
+            /* still in the chain */
+            return;
+        }
+    }
+    for(transform = dsigRefCtx->digestMethod; transform != NULL; transform = tmp) {
+        tmp = transform->next;
+        xmlSecTransformDestroy(transform);
+    }
+    dsigRefCtx->digestMethod = NULL;
+}
+
+/* calculates (or verifies) the digest of the pre-digest @data: @digest is the result
+ * of #xmlSecDSigBatchDigestCallback or NULL to run the detached digest method */
+static int
+xmlSecDSigReferenceCtxBatchDigestFinish(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlSecBufferPtr data,
+                                        xmlSecBufferPtr digest) {
+    xmlSecTransformCtxPtr transformCtx;
+    xmlSecTransformPtr digestMethod;
+    xmlSecBuffer expected;
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestMethod != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+
+    xmlSecAssert2(data != NULL, -1);
+
+    transformCtx = &(dsigRefCtx->transformCtx);
+    digestMethod = dsigRefCtx->digestMethod;
+
+    if(digest == NULL) {
+        ret = xmlSecTransformPushBin(digestMethod,
+            xmlSecBufferGetData(data), xmlSecBufferGetSize(data),
+            1, transformCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformPushBin", xmlSecTransformGetName(digestMethod));
+            return(-1);
+        }
+    }
+
+    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
+        xmlSecAssert2(digestMethod->next != NULL, -1);
+        xmlSecAssert2(digestMethod->next->next != NULL, -1);
+
+        if(digest != NULL) {
+            ret = xmlSecTransformPushBin(digestMethod->next,
+                xmlSecBufferGetData(digest), xmlSecBufferGetSize(digest),
+                1, transformCtx);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecTransformPushBin", xmlSecTransformGetName(digestMethod->next));
+                return(-1);
+            }
+        }
+        dsigRefCtx->result = xmlSecTransformMemBufGetBuffer(digestMethod->next->next);
+        if((dsigRefCtx->result == NULL) || (xmlSecBufferGetData(dsigRefCtx->result) == NULL)) {
+            xmlSecInternalError("xmlSecTransformMemBufGetBuffer", NULL);
+            return(-1);
+        }
+
+        /* the result is written to xml later */
+        dsigRefCtx->status = xmlSecDSigStatusSucceeded;
+        return(0);
+    }
+
+    if(digest == NULL) {
+        ret = xmlSecTransformVerifyNodeContent(digestMethod, dsigRefCtx->digestValueNode, transformCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformVerifyNodeContent", NULL);
+            return(-1);
+        }
+        dsigRefCtx->status = (digestMethod->status == xmlSecTransformStatusOk) ?
+            xmlSecDSigStatusSucceeded : xmlSecDSigStatusInvalid;
+        return(0);
+    }
+
+    /* compare with &lt;dsig:DigestValue/&gt; node content */
+    ret = xmlSecBufferInitialize(&expected, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        return(-1);
+    }
+    ret = xmlSecBufferBase64NodeContentRead(&expected, dsigRefCtx->digestValueNode);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferBase64NodeContentRead", NULL);
+        xmlSecBufferFinalize(&expected);
+        return(-1);
+    }
+    if((xmlSecBufferGetSize(&expected) == xmlSecBufferGetSize(digest)) &&
+       (xmlSecBufferGetSize(digest) > 0) &&
+       (memcmp(xmlSecBufferGetData(&expected), xmlSecBufferGetData(digest), xmlSecBufferGetSize(digest)) == 0))
+    {
+        digestMethod->status = xmlSecTransformStatusOk;
+        dsigRefCtx->status = xmlSecDSigStatusSucceeded;
+    } else {
+        xmlSecInvalidDataError("data and digest do not match",
+                xmlSecTransformGetName(digestMethod));
+        digestMethod->status = xmlSecTransformStatusFail;
+        dsigRefCtx->status = xmlSecDSigStatusInvalid;
+    }
+    xmlSecBufferFinalize(&expected);
+    return(0);
+}
+
+/* re-digests the reference only if the referenced data might have changed since
+ * the previous signature (#xmlSecDSigCtxSignIncremental) */
+static int
+xmlSecDSigReferenceCtxProcessNodeIncremental(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlNodePtr node) {
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    ret = xmlSecDSigReferenceCtxPrepareNode(dsigRefCtx, node);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxPrepareNode", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecDSigReferenceCtxIsUnchanged(dsigRefCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxIsUnchanged", NULL);
+        return(-1);
+    } else if(ret == 1) {
+        /* keep the previous digest */
+        dsigRefCtx->status = xmlSecDSigStatusSucceeded;
+        return(0);
+    }
+
+    ret = xmlSecDSigReferenceCtxExecute(dsigRefCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxExecute", NULL);
+        return(-1);
+    }
+    if(dsigRefCtx->status != xmlSecDSigStatusSucceeded) {
+        return(0);
+    }
+
+    ret = xmlSecDSigReferenceCtxWriteResult(dsigRefCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxWriteResult", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* returns 1 if the digest in the &lt;dsig:DigestValue/&gt; node is still valid,
+ * 0 if not or a negative value if an error occurs */
+static int
+xmlSecDSigReferenceCtxIsUnchanged(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    struct _xmlSecDSigDirtyNodes* dirty;
+    xmlSecTransformPtr transform;
+    xmlNodePtr target;
+    xmlNodePtr cur;
+    xmlAttrPtr attr;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx->dirtyNodes != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+
+    dirty = dsigRefCtx->dsigCtx->dirtyNodes;
+    if(dirty->keepDigests != 0) {
+        return(1);
+    }
+
+    /* only the barename references: the whole document and the xpointer
+     * references might include any node */
+    if((dsigRefCtx->uri == NULL) || (dsigRefCtx->uri[0] != '#') ||
+       (xmlStrchr(dsigRefCtx->uri, '(') != NULL)) {
+        return(0);
+    }
+
+    /* the template might have no digest yet */
+    ret = xmlSecIsEmptyNode(dsigRefCtx->digestValueNode);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecIsEmptyNode", NULL);
+        return(-1);
+    } else if(ret == 1) {
+        return(0);
+    }
+
+    /* the other transforms (XPath filter 2.0, XSLT, ...) might select nodes outside
+     * of the referenced element */
+    for(transform = dsigRefCtx->transformCtx.first; transform != NULL; transform = transform->next) {
+        if((transform == dsigRefCtx->digestMethod) ||
+           (transform->id == xmlSecTransformXPointerId) ||
+           (transform->id == xmlSecTransformEnvelopedId) ||
+           (transform->id == xmlSecTransformBase64Id) ||
+           (transform->id == xmlSecTransformMemBufId) ||
+           ((transform->id->usage & xmlSecTransformUsageC14NMethod) != 0)) {
+            continue;
+        }
+        return(0);
+    }
+
+    attr = xmlGetID(dsigRefCtx->digestValueNode->doc, dsigRefCtx->uri + 1);
+    if((attr == NULL) || (attr->parent == NULL)) {
+        /* the error is reported when the transforms are executed */
+        return(0);
+    }
+    target = attr->parent;
+
+    /* the signature itself (KeyInfo, Manifests, ...) is updated while signing */
+    for(cur = target; cur != NULL; cur = cur->parent) {
+        if(cur == dirty->signature) {
+            return(0);
+        }
+    }
+
+    /* the changes in the ancestors might change the inherited namespaces
+     * and xml:* attributes */
+    for(ii = 0; ii < dirty->size; ++ii) {
+        xmlSecAssert2(dirty->nodes[ii] != NULL, -1);
+
+        for(cur = dirty->nodes[ii]; cur != NULL; cur = cur->parent) {
+            if(cur == target) {
+                return(0);
+            }
+        }
+        for(cur = target->parent; cur != NULL; cur = cur->parent) {
+            if(cur == dirty->nodes[ii]) {
+                return(0);
+            }
+        }
+    }
+    return(1);
+}
+
+/* the task passed to #xmlSecDSigReferencesExecutor: status stays unknown on error */
+static int
+xmlSecDSigReferenceCtxExecuteTask(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+
+    ret = xmlSecDSigReferenceCtxExecute(dsigRefCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxExecute", NULL);
+        dsigRefCtx->status = xmlSecDSigStatusUnknown;
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecDSigReferenceCtxDebugDump:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ * @output:             the pointer to output FILE.
+ *
+ * Prints debug information about @dsigRefCtx to @output.
+ */
+void
+xmlSecDSigReferenceCtxDebugDump(xmlSecDSigReferenceCtxPtr dsigRefCtx, FILE* output) {
+    xmlSecAssert(dsigRefCtx != NULL);
+    xmlSecAssert(dsigRefCtx->dsigCtx != NULL);
+    xmlSecAssert(output != NULL);
+
+    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
+        fprintf(output, "= REFERENCE CALCULATION CONTEXT\n");
+    } else {
+        fprintf(output, "= REFERENCE VERIFICATION CONTEXT\n");
+    }
+    fprintf(output, "== Status: %s\n", xmlSecDSigCtxGetStatusString(dsigRefCtx->status));
+
+    if(dsigRefCtx->id != NULL) {
+        fprintf(output, "== Id: \"%s\"\n", dsigRefCtx->id);
+    }
+    if(dsigRefCtx->uri != NULL) {
+        fprintf(output, "== URI: \"%s\"\n", dsigRefCtx->uri);
+    }
+    if(dsigRefCtx->type != NULL) {
+        fprintf(output, "== Type: \"%s\"\n", dsigRefCtx->type);
+    }
+
+    fprintf(output, "== Reference Transform Ctx:\n");
+    xmlSecTransformCtxDebugDump(&(dsigRefCtx->transformCtx), output);
+
+    if(dsigRefCtx->digestMethod != NULL) {
+        fprintf(output, "== Digest Method:\n");
+        xmlSecTransformDebugDump(dsigRefCtx->digestMethod, output);
+    }
+
+    if((xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx) != NULL) &&
+       (xmlSecBufferGetData(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)) != NULL)) {
+
+        fprintf(output, "== PreDigest data - start buffer:\n");
+        (void)fwrite(xmlSecBufferGetData(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)),
+                     xmlSecBufferGetSize(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)),
+                     1, output);
+        fprintf(output, "\n== PreDigest data - end buffer\n");
+    }
+
+    if((dsigRefCtx->result != NULL) &&
+       (xmlSecBufferGetData(dsigRefCtx->result) != NULL)) {
+
+        fprintf(output, "== Result - start buffer:\n");
+        (void)fwrite(xmlSecBufferGetData(dsigRefCtx->result),
+                     xmlSecBufferGetSize(dsigRefCtx->result), 1,
+                     output);
+        fprintf(output, "\n== Result - end buffer\n");
+    }
+}
+
+/**
+ * xmlSecDSigReferenceCtxDebugXmlDump:
+ * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
+ * @output:             the pointer to output FILE.
+ *
+ * Prints debug information about @dsigRefCtx to @output in output format.
+ */
+void
+xmlSecDSigReferenceCtxDebugXmlDump(xmlSecDSigReferenceCtxPtr dsigRefCtx, FILE* output) {
+    xmlSecAssert(dsigRefCtx != NULL);
+    xmlSecAssert(dsigRefCtx->dsigCtx != NULL);
+    xmlSecAssert(output != NULL);
+
+    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
+        fprintf(output, "<ReferenceCalculationContext ");
+    } else {
+        fprintf(output, "<ReferenceVerificationContext ");
+    }
+    fprintf(output, " status=\"%s\"", xmlSecDSigCtxGetStatusString(dsigRefCtx->status));
+    fprintf(output, ">\n");
+
+    fprintf(output, "<Id>");
+    xmlSecPrintXmlString(output, dsigRefCtx->id);
+    fprintf(output, "</Id>\n");
+
+    fprintf(output, "<URI>");
+    xmlSecPrintXmlString(output, dsigRefCtx->uri);
+    fprintf(output, "</URI>\n");
+
+    fprintf(output, "<Type>");
+    xmlSecPrintXmlString(output, dsigRefCtx->type);
+    fprintf(output, "</Type>\n");
+
+    fprintf(output, "<ReferenceTransformCtx>\n");
+    xmlSecTransformCtxDebugXmlDump(&(dsigRefCtx->transformCtx), output);
+    fprintf(output, "</ReferenceTransformCtx>\n");
+
+    if(dsigRefCtx->digestMethod != NULL) {
+        fprintf(output, "<DigestMethod>\n");
+        xmlSecTransformDebugXmlDump(dsigRefCtx->digestMethod, output);
+        fprintf(output, "</DigestMethod>\n");
+    }
+
+    if((dsigRefCtx->result != NULL) &&
+       (xmlSecBufferGetData(dsigRefCtx->result) != NULL)) {
+
+        fprintf(output, "<Result>");
+        (void)fwrite(xmlSecBufferGetData(dsigRefCtx->result),
+                     xmlSecBufferGetSize(dsigRefCtx->result), 1,
+                     output);
+        fprintf(output, "</Result>\n");
+    }
+
+    if((xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx) != NULL) &&
+       (xmlSecBufferGetData(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)) != NULL)) {
+
+        fprintf(output, "<PreDigestData>");
+        (void)fwrite(xmlSecBufferGetData(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)),
+                     xmlSecBufferGetSize(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)),
+                     1, output);
+        fprintf(output, "</PreDigestData>\n");
+    }
+    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
+        fprintf(output, "</ReferenceCalculationContext>\n");
+    } else {
+        fprintf(output, "</ReferenceVerificationContext>\n");
+    }
+}
+
+
+/**************************************************************************
+ *
+ * External references digests cache. The entries are identified by the
+ * reference URI, the &lt;dsig:Transforms/&gt; node (with the namespaces
+ * in scope), the digest method and the resource freshness validator
+ * (the hash is only used to speed up the comparison) and evicted in the
+ * insertion order when the cache is full. The same document references
+ * to the pinned subtrees are identified by the node validator and the
+ * namespaces and xml:* attributes inherited by the subtree instead of URI.
+ *
+ *************************************************************************/
+typedef struct _xmlSecDSigDigestCacheEntry      xmlSecDSigDigestCacheEntry,
+                                                *xmlSecDSigDigestCacheEntryPtr;
+struct _xmlSecDSigDigestCacheEntry {
+    unsigned int                        hash;
+    xmlSecByte*                         id;
+    xmlSecSize                          idSize;
+    xmlSecByte*                         digest;
+    xmlSecSize                          digestSize;
+};
+
+struct _xmlSecDSigDigestCache {
+    xmlMutexPtr                         mutex;
+    xmlSecDSigDigestCacheEntryPtr       entries;
+    xmlSecSize                          maxSize;
+    xmlSecSize                          pos;
+    xmlSecDSigDigestCacheValidator      validator;
+    void*                               validatorCtx;
+    xmlSecDSigDigestCacheNodeValidator  nodeValidator;
+    void*                               nodeValidatorCtx;
+};
+
+static unsigned int
+xmlSecDSigDigestCacheHash(const xmlSecByte* id, xmlSecSize idSize) {
+    unsigned int hash = 5381;
+    xmlSecSize ii;
+
+    for(ii = 0; ii < idSize; ++ii) {
+        hash = (hash * 33) ^ id[ii];
+    }
+    return(hash);
+}
+
+static void
+xmlSecDSigDigestCacheEntryClear(xmlSecDSigDigestCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->digest != NULL) {
+        xmlFree(entry->digest);
+    }
+    if(entry->id != NULL) {
+        xmlFree(entry->id);
+    }
+    memset(entry, 0, sizeof(xmlSecDSigDigestCacheEntry));
+}
+
+/**
+ * xmlSecDSigDigestCacheCreate:
+ * @maxSize:            the max number of digests in the cache.
+ *
+ * Creates the cache for the external &lt;dsig:Reference/&gt; digests. When
+ * the cache is set in #xmlSecDSigCtx.digestCache, the digest of the same
+ * external resource (the same URI, transforms and digest method) is calculated
+ * only once as long as the resource freshness validator doesn't change
+ * (see #xmlSecDSigDigestCacheSetValidator). The transforms (including
+ * #xmlSecDSigCtx.referencePreExecuteCallback) are not executed for the cached
+ * digests and the references with #XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES
+ * or #XMLSEC_DSIG_FLAGS_STORE_MANIFEST_REFERENCES flags are never cached. The
+ * same document references are cached only for the subtrees pinned by the
+ * application (see #xmlSecDSigDigestCacheSetNodeValidator). The cache is
+ * locked and can be shared by the contexts in different threads.
+ *
+ * Returns: the pointer to newly allocated cache or NULL if an error occurs.
+ * The caller is responsible for destroying the cache with #xmlSecDSigDigestCacheDestroy.
+ */
+xmlSecDSigDigestCachePtr
+xmlSecDSigDigestCacheCreate(xmlSecSize maxSize) {
+    xmlSecDSigDigestCachePtr cache;
+
+    xmlSecAssert2(maxSize > 0, NULL);
+
+    cache = (xmlSecDSigDigestCachePtr)xmlMalloc(sizeof(xmlSecDSigDigestCache));
+    if(cache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigDigestCache), NULL);
+        return(NULL);
+    }
+    memset(cache, 0, sizeof(xmlSecDSigDigestCache));
+
+    cache->entries = (xmlSecDSigDigestCacheEntryPtr)xmlMalloc(sizeof(xmlSecDSigDigestCacheEntry) * maxSize);
+    if(cache->entries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigDigestCacheEntry) * maxSize, NULL);
+        xmlFree(cache);
+        return(NULL);
+    }
+    memset(cache->entries, 0, sizeof(xmlSecDSigDigestCacheEntry) * maxSize);
+
+    cache->mutex = xmlNewMutex();
+    if(cache->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(cache->entries);
+        xmlFree(cache);
+        return(NULL);
+    }
+    cache->maxSize = maxSize;
+    cache->validator = xmlSecDSigDigestCacheFileValidator;
+    return(cache);
+}
+
+/**
+ * xmlSecDSigDigestCacheDestroy:
+ * @cache:              the pointer to digests cache.
+ *
+ * Destroys the digests cache.
+ */
+void
+xmlSecDSigDigestCacheDestroy(xmlSecDSigDigestCachePtr cache) {
+    xmlSecSize ii;
 
-    case xmlSecDSigStatusInvalid:
-        return "FAILED";
+    xmlSecAssert(cache != NULL);
 
-    /* unknown status can only be caused by an error in the operation */
-    case xmlSecDSigStatusUnknown:
-    default:
-        return "ERROR";
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        xmlSecDSigDigestCacheEntryClear(&(cache->entries[ii]));
     }
+    xmlFree(cache->entries);
+    xmlFreeMutex(cache->mutex);
+    memset(cache, 0, sizeof(xmlSecDSigDigestCache));
+    xmlFree(cache);
 }
 
 /**
- * xmlSecDSigCtxGetFailureReasonString:
- * @failureReason:   the failure reason.
+ * xmlSecDSigDigestCacheSetValidator:
+ * @cache:              the pointer to digests cache.
+ * @validator:          the resource freshness validator callback.
+ * @context:            the context passed to @validator.
  *
- * Gets failure reason as a string.
+ * Sets the resource freshness validator callback. The default
+ * validator is #xmlSecDSigDigestCacheFileValidator, i.e. only the
+ * local files digests are cached. The application can call it from
+ * its own validator for the local files.
+ */
+void
+xmlSecDSigDigestCacheSetValidator(xmlSecDSigDigestCachePtr cache,
+                                  xmlSecDSigDigestCacheValidator validator, void* context) {
+    xmlSecAssert(cache != NULL);
+    xmlSecAssert(validator != NULL);
+
+    xmlMutexLock(cache->mutex);
+    cache->validator = validator;
+    cache->validatorCtx = context;
+    xmlMutexUnlock(cache->mutex);
+}
+
+/**
+ * xmlSecDSigDigestCacheFileValidator:
+ * @context:            not used.
+ * @uri:                the external reference URI (without the fragment part).
+ * @validator:          the buffer for the resource freshness validator.
  *
- * Returns failure reason as a string.
+ * The freshness validator for the local files (the plain paths
+ * and file: URIs): the file size, modification time and inode.
+ *
+ * Returns: 1 if @validator was set, 0 if @uri is not a local file
+ * or a negative value if an error occurs.
  */
-const char*
-xmlSecDSigCtxGetFailureReasonString(xmlSecDSigFailureReason failureReason) {
-    switch(failureReason) {
-    case xmlSecDSigFailureReasonReference:
-        return "REFERENCE";
+int
+xmlSecDSigDigestCacheFileValidator(void* context ATTRIBUTE_UNUSED, const xmlChar* uri,
+                                   xmlSecBufferPtr validator) {
+    char* filename;
+    struct stat st;
+    char buf[128];
+    int len;
+    int ret;
 
-    case xmlSecDSigFailureReasonSignature:
-        return "SIGNATURE";
+    xmlSecAssert2(uri != NULL, -1);
+    xmlSecAssert2(validator != NULL, -1);
 
-    case xmlSecDSigFailureReasonKeyNotFound:
-        return "KEY-NOT-FOUND";
+    filename = xmlSecFileUriToPath(uri);
+    if(filename == NULL) {
+        return(0);
+    }
+    ret = stat(filename, &st);
+    xmlFree(filename);
+    if(ret != 0) {
+        /* the error is reported when the file is opened */
+        return(0);
+    }
 
-    case xmlSecDSigFailureReasonUnknown:
-    default:
-        return "UNKNOWN";
+    len = snprintf(buf, sizeof(buf), "%lu:%ld:%lu:%lu",
+        (unsigned long)st.st_size, (long)st.st_mtime,
+        (unsigned long)st.st_ino, (unsigned long)st.st_dev);
+    if((len <= 0) || ((size_t)len >= sizeof(buf))) {
+        xmlSecInternalError("snprintf", NULL);
+        return(-1);
+    }
+    ret = xmlSecBufferSetData(validator, (const xmlSecByte*)buf, (xmlSecSize)len);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferSetData", NULL);
+        return(-1);
     }
+    return(1);
 }
 
 /**
- * xmlSecDSigCtxDebugDump:
- * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
- * @output:             the pointer to output FILE.
+ * xmlSecDSigDigestCacheSetNodeValidator:
+ * @cache:              the pointer to digests cache.
+ * @validator:          the subtree validator callback or NULL.
+ * @context:            the context passed to @validator.
  *
- * Prints the debug information about @dsigCtx to @output.
+ * Sets the subtree validator callback for the same document references
+ * (URI="#id"). By default (or if @validator is NULL) the same document
+ * references digests are not cached. The application is responsible for
+ * changing the validator when a pinned subtree is modified: libxml2 doesn't
+ * track the document modifications.
  */
 void
-xmlSecDSigCtxDebugDump(xmlSecDSigCtxPtr dsigCtx, FILE* output) {
-    xmlSecAssert(dsigCtx != NULL);
-    xmlSecAssert(output != NULL);
+xmlSecDSigDigestCacheSetNodeValidator(xmlSecDSigDigestCachePtr cache,
+                                      xmlSecDSigDigestCacheNodeValidator validator, void* context) {
+    xmlSecAssert(cache != NULL);
+
+    xmlMutexLock(cache->mutex);
+    cache->nodeValidator = validator;
+    cache->nodeValidatorCtx = context;
+    xmlMutexUnlock(cache->mutex);
+}
 
-    if(dsigCtx->operation == xmlSecTransformOperationSign) {
-        fprintf(output, "= SIGNATURE CONTEXT\n");
-    } else {
-        fprintf(output, "= VERIFICATION CONTEXT\n");
-    }
-    fprintf(output, "== Status: %s\n", xmlSecDSigCtxGetStatusString(dsigCtx->status));
-    fprintf(output, "== Failure reason: %s\n", xmlSecDSigCtxGetFailureReasonString(dsigCtx->failureReason));
+static int
+xmlSecDSigDigestCacheAppend(xmlSecBufferPtr buf, const xmlChar* str) {
+    static const xmlSecByte sep = '\n';
+    int ret;
 
-    fprintf(output, "== flags: 0x%08x\n", dsigCtx->flags);
-    fprintf(output, "== flags2: 0x%08x\n", dsigCtx->flags2);
+    xmlSecAssert2(buf != NULL, -1);
 
-    if(dsigCtx->id != NULL) {
-        fprintf(output, "== Id: \"%s\"\n", dsigCtx->id);
+    if(str != NULL) {
+        ret = xmlSecBufferAppend(buf, str, xmlSecStrlen(str));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferAppend", NULL);
+            return(-1);
+        }
+    }
+    ret = xmlSecBufferAppend(buf, &sep, 1);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        return(-1);
     }
+    return(0);
+}
 
-    fprintf(output, "== Key Info Read Ctx:\n");
-    xmlSecKeyInfoCtxDebugDump(&(dsigCtx->keyInfoReadCtx), output);
-    fprintf(output, "== Key Info Write Ctx:\n");
-    xmlSecKeyInfoCtxDebugDump(&(dsigCtx->keyInfoWriteCtx), output);
+/* appends the reference &lt;dsig:Transforms/&gt; node (if any) to @buf, the XPath
+ * expressions depend on the namespaces in scope so these are appended as well */
+static int
+xmlSecDSigReferenceCtxAppendTransforms(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlSecBufferPtr buf) {
+    xmlOutputBufferPtr output;
+    xmlNodePtr transformsNode;
+    xmlNsPtr* nsList;
+    xmlSecSize ii;
+    int ret;
 
-    fprintf(output, "== Signature Transform Ctx:\n");
-    xmlSecTransformCtxDebugDump(&(dsigCtx->transformCtx), output);
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+    xmlSecAssert2(buf != NULL, -1);
 
-    if(dsigCtx->signMethod != NULL) {
-        fprintf(output, "== Signature Method:\n");
-        xmlSecTransformDebugDump(dsigCtx->signMethod, output);
+    transformsNode = xmlSecGetNextElementNode(dsigRefCtx->digestValueNode->parent->children);
+    if((transformsNode == NULL) || (!xmlSecCheckNodeName(transformsNode, xmlSecNodeTransforms, xmlSecDSigNs))) {
+        return(0);
     }
 
-    if(dsigCtx->signKey != NULL) {
-        fprintf(output, "== Signature Key:\n");
-        xmlSecKeyDebugDump(dsigCtx->signKey, output);
+    nsList = xmlGetNsList(transformsNode->doc, transformsNode);
+    if(nsList != NULL) {
+        for(ii = 0; nsList[ii] != NULL; ++ii) {
+            ret = xmlSecDSigDigestCacheAppend(buf, nsList[ii]->prefix);
+            if(ret >= 0) {
+                ret = xmlSecDSigDigestCacheAppend(buf, nsList[ii]->href);
+            }
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigDigestCacheAppend", NULL);
+                xmlFree(nsList);
+                return(-1);
+            }
+        }
+        xmlFree(nsList);
     }
 
-    fprintf(output, "== SignedInfo References List:\n");
-    xmlSecPtrListDebugDump(&(dsigCtx->signedInfoReferences), output);
-
-    fprintf(output, "== Manifest References List:\n");
-    xmlSecPtrListDebugDump(&(dsigCtx->manifestReferences), output);
+    output = xmlSecBufferCreateOutputBuffer(buf);
+    if(output == NULL) {
+        xmlSecInternalError("xmlSecBufferCreateOutputBuffer", NULL);
+        return(-1);
+    }
+    xmlNodeDumpOutput(output, transformsNode->doc, transformsNode, 0, 0, NULL);
+    ret = xmlOutputBufferClose(output);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        return(-1);
+    }
+    return(0);
+}
 
-    if((dsigCtx->result != NULL) &&
-       (xmlSecBufferGetData(dsigCtx->result) != NULL)) {
+/* appends the namespaces and the xml:* attributes inherited by @node to @buf: these
+ * are not a part of the pinned subtree but change its canonical form */
+static int
+xmlSecDSigDigestCacheAppendNodeContext(xmlNodePtr node, xmlSecBufferPtr buf) {
+    xmlNsPtr* nsList;
+    xmlNodePtr cur;
+    xmlAttrPtr attr;
+    xmlChar* value;
+    xmlSecSize ii;
+    int ret;
 
-        fprintf(output, "== Result - start buffer:\n");
-        (void)fwrite(xmlSecBufferGetData(dsigCtx->result),
-                     xmlSecBufferGetSize(dsigCtx->result),
-                     1, output);
-        fprintf(output, "\n== Result - end buffer\n");
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(buf != NULL, -1);
+
+    nsList = xmlGetNsList(node->doc, node);
+    if(nsList != NULL) {
+        for(ii = 0; nsList[ii] != NULL; ++ii) {
+            ret = xmlSecDSigDigestCacheAppend(buf, nsList[ii]->prefix);
+            if(ret >= 0) {
+                ret = xmlSecDSigDigestCacheAppend(buf, nsList[ii]->href);
+            }
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigDigestCacheAppend", NULL);
+                xmlFree(nsList);
+                return(-1);
+            }
+        }
+        xmlFree(nsList);
+    }
+    ret = xmlSecDSigDigestCacheAppend(buf, NULL);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigDigestCacheAppend", NULL);
+        return(-1);
     }
-    if(((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNATURE) != 0) &&
-       (xmlSecDSigCtxGetPreSignBuffer(dsigCtx) != NULL) &&
-       (xmlSecBufferGetData(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)) != NULL)) {
 
-        fprintf(output, "== PreSigned data - start buffer:\n");
-        (void)fwrite(xmlSecBufferGetData(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)),
-                     xmlSecBufferGetSize(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)),
-                     1, output);
-        fprintf(output, "\n== PreSigned data - end buffer\n");
+    for(cur = node->parent; (cur != NULL) && (cur->type == XML_ELEMENT_NODE); cur = cur->parent) {
+        for(attr = cur->properties; attr != NULL; attr = attr->next) {
+            if((attr->ns == NULL) || !xmlStrEqual(attr->ns->href, XML_XML_NAMESPACE)) {
+                continue;
+            }
+            value = xmlNodeGetContent((xmlNodePtr)attr);
+            ret = xmlSecDSigDigestCacheAppend(buf, attr->name);
+            if(ret >= 0) {
+                ret = xmlSecDSigDigestCacheAppend(buf, value);
+            }
+            if(value != NULL) {
+                xmlFree(value);
+            }
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigDigestCacheAppend", NULL);
+                return(-1);
+            }
+        }
     }
+    return(0);
 }
 
-/**
- * xmlSecDSigCtxDebugXmlDump:
- * @dsigCtx:            the pointer to &lt;dsig:Signature/&gt; processing context.
- * @output:             the pointer to output FILE.
- *
- * Prints the debug information about @dsigCtx to @output in XML format.
- */
-void
-xmlSecDSigCtxDebugXmlDump(xmlSecDSigCtxPtr dsigCtx, FILE* output) {
-    xmlSecAssert(dsigCtx != NULL);
-    xmlSecAssert(output != NULL);
+/* checks if the transforms use the here() XPath function */
+static int
+xmlSecDSigDigestCacheHasHere(const xmlSecByte* data, xmlSecSize size) {
+    static const char here[] = "here(";
+    xmlSecSize ii;
 
-    if(dsigCtx->operation == xmlSecTransformOperationSign) {
-        fprintf(output, "<SignatureContext\n");
-    } else {
-        fprintf(output, "<VerificationContext\n");
+    for(ii = 0; (ii + sizeof(here) - 1) <= size; ++ii) {
+        if(memcmp(data + ii, here, sizeof(here) - 1) == 0) {
+            return(1);
+        }
     }
-    fprintf(output, " status=\"%s\"", xmlSecDSigCtxGetStatusString(dsigCtx->status));
-    fprintf(output, " failureReason=\"%s\"\n", xmlSecDSigCtxGetFailureReasonString(dsigCtx->failureReason));
-
-
-    fprintf(output, "<Flags>%08x</Flags>\n", dsigCtx->flags);
-    fprintf(output, "<Flags2>%08x</Flags2>\n", dsigCtx->flags2);
+    return(0);
+}
 
-    fprintf(output, "<Id>");
-    xmlSecPrintXmlString(output, dsigCtx->id);
-    fprintf(output, "</Id>\n");
+/* gets the validator for the same document reference (URI="#id") target node,
+ * returns 1 if the node is pinned (and @validatorBuf is set), 0 if not or a
+ * negative value if an error occurs */
+static int
+xmlSecDSigReferenceCtxCacheGetNodeValidator(xmlSecDSigReferenceCtxPtr dsigRefCtx,
+                                            xmlSecDSigDigestCachePtr cache,
+                                            xmlSecBufferPtr validatorBuf,
+                                            xmlNodePtr* node) {
+    xmlSecDSigDigestCacheNodeValidator validator;
+    void* validatorCtx;
+    xmlAttrPtr attr;
+    int ret;
 
-    fprintf(output, "<KeyInfoReadCtx>\n");
-    xmlSecKeyInfoCtxDebugXmlDump(&(dsigCtx->keyInfoReadCtx), output);
-    fprintf(output, "</KeyInfoReadCtx>\n");
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+    xmlSecAssert2(cache != NULL, -1);
+    xmlSecAssert2(validatorBuf != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
 
-    fprintf(output, "<KeyInfoWriteCtx>\n");
-    xmlSecKeyInfoCtxDebugXmlDump(&(dsigCtx->keyInfoWriteCtx), output);
-    fprintf(output, "</KeyInfoWriteCtx>\n");
+    /* only the barename references: the whole document and the xpointer
+     * references are not cached */
+    if((dsigRefCtx->uri == NULL) || (dsigRefCtx->uri[0] != '#') ||
+       (xmlStrchr(dsigRefCtx->uri, '(') != NULL)) {
+        return(0);
+    }
 
-    fprintf(output, "<SignatureTransformCtx>\n");
-    xmlSecTransformCtxDebugXmlDump(&(dsigCtx->transformCtx), output);
-    fprintf(output, "</SignatureTransformCtx>\n");
+    xmlMutexLock(cache->mutex);
+    validator = cache->nodeValidator;
+    validatorCtx = cache->nodeValidatorCtx;
+    xmlMutexUnlock(cache->mutex);
+    if(validator == NULL) {
+        return(0);
+    }
 
-    if(dsigCtx->signMethod != NULL) {
-        fprintf(output, "<SignatureMethod>\n");
-        xmlSecTransformDebugXmlDump(dsigCtx->signMethod, output);
-        fprintf(output, "</SignatureMethod>\n");
+    attr = xmlGetID(dsigRefCtx->digestValueNode->doc, dsigRefCtx->uri + 1);
+    if((attr == NULL) || (attr->parent == NULL)) {
+        /* the error is reported when the transforms are executed */
+        return(0);
     }
 
-    if(dsigCtx->signKey != NULL) {
-        fprintf(output, "<SignatureKey>\n");
-        xmlSecKeyDebugXmlDump(dsigCtx->signKey, output);
-        fprintf(output, "</SignatureKey>\n");
+    ret = validator(validatorCtx, attr->parent, validatorBuf);
+    if(ret < 0) {
+        xmlSecInternalError2("validator", NULL,
+            "uri=%s", xmlSecErrorsSafeString(dsigRefCtx->uri));
+        return(-1);
+    } else if((ret == 0) || (xmlSecBufferGetSize(validatorBuf) == 0)) {
+        return(0);
     }
+    (*node) = attr->parent;
+    return(1);
+}
 
-    fprintf(output, "<SignedInfoReferences>\n");
-    xmlSecPtrListDebugXmlDump(&(dsigCtx->signedInfoReferences), output);
-    fprintf(output, "</SignedInfoReferences>\n");
+/* returns 1 if the reference digest can be cached (and @cacheId is set), 0 if not or a negative value if an error occurs */
+static int
+xmlSecDSigReferenceCtxCacheGetId(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlSecBufferPtr cacheId) {
+    xmlSecDSigDigestCachePtr cache;
+    xmlSecDSigDigestCacheValidator validator;
+    void* validatorCtx;
+    xmlSecBuffer validatorBuf;
+    xmlSecSize transformsStart;
+    xmlNodePtr node = NULL;
+    int res = -1;
+    int ret;
 
-    fprintf(output, "<ManifestReferences>\n");
-    xmlSecPtrListDebugXmlDump(&(dsigCtx->manifestReferences), output);
-    fprintf(output, "</ManifestReferences>\n");
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestMethod != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
 
-    if((dsigCtx->result != NULL) &&
-       (xmlSecBufferGetData(dsigCtx->result) != NULL)) {
+    cache = dsigRefCtx->dsigCtx->digestCache;
+    xmlSecAssert2(cache != NULL, -1);
 
-        fprintf(output, "<Result>");
-        (void)fwrite(xmlSecBufferGetData(dsigCtx->result),
-                     xmlSecBufferGetSize(dsigCtx->result),
-                     1, output);
-        fprintf(output, "</Result>\n");
+    /* only the references without the pre-digest data requested */
+    if(dsigRefCtx->preDigestMemBufMethod != NULL) {
+        return(0);
     }
-    if(((dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNATURE) != 0) &&
-       (xmlSecDSigCtxGetPreSignBuffer(dsigCtx) != NULL) &&
-       (xmlSecBufferGetData(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)) != NULL)) {
 
-        fprintf(output, "<PreSignedData>");
-        (void)fwrite(xmlSecBufferGetData(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)),
-                     xmlSecBufferGetSize(xmlSecDSigCtxGetPreSignBuffer(dsigCtx)),
-                     1, output);
-        fprintf(output, "</PreSignedData>\n");
+    ret = xmlSecBufferInitialize(&validatorBuf, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        return(-1);
     }
 
-    if(dsigCtx->operation == xmlSecTransformOperationSign) {
-        fprintf(output, "</SignatureContext>\n");
+    if((dsigRefCtx->transformCtx.uri == NULL) || (dsigRefCtx->transformCtx.uri[0] == '\0')) {
+        /* same document: only the pinned subtrees */
+        ret = xmlSecDSigReferenceCtxCacheGetNodeValidator(dsigRefCtx, cache, &validatorBuf, &node);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigReferenceCtxCacheGetNodeValidator", NULL);
+            goto done;
+        } else if(ret == 0) {
+            res = 0;
+            goto done;
+        }
     } else {
-        fprintf(output, "</VerificationContext>\n");
-    }
-}
-
-/**************************************************************************
- *
- * xmlSecDSigReferenceCtx
- *
- *************************************************************************/
-/**
- * xmlSecDSigReferenceCtxCreate:
- * @dsigCtx:            the pointer to parent &lt;dsig:Signature/&gt; node processing context.
- * @origin:             the reference origin (&lt;dsig:SignedInfo/&gt; or &lt;dsig:Manifest/&gt; node).
- *
- * Creates new &lt;dsig:Reference/&gt; element processing context. Caller is responsible
- * for destroying the returned context by calling #xmlSecDSigReferenceCtxDestroy
- * function.
- *
- * Returns: pointer to newly created context or NULL if an error occurs.
- */
-xmlSecDSigReferenceCtxPtr
-xmlSecDSigReferenceCtxCreate(xmlSecDSigCtxPtr dsigCtx, xmlSecDSigReferenceOrigin origin) {
-    xmlSecDSigReferenceCtxPtr dsigRefCtx;
-    int ret;
+        xmlMutexLock(cache->mutex);
+        validator = cache->validator;
+        validatorCtx = cache->validatorCtx;
+        xmlMutexUnlock(cache->mutex);
 
-    xmlSecAssert2(dsigCtx != NULL, NULL);
+        ret = validator(validatorCtx, dsigRefCtx->transformCtx.uri, &validatorBuf);
+        if(ret < 0) {
+            xmlSecInternalError2("validator", NULL,
+                "uri=%s", xmlSecErrorsSafeString(dsigRefCtx->transformCtx.uri));
+            goto done;
+        } else if((ret == 0) || (xmlSecBufferGetSize(&validatorBuf) == 0)) {
+            res = 0;
+            goto done;
+        }
+    }
 
-    dsigRefCtx = (xmlSecDSigReferenceCtxPtr) xmlMalloc(sizeof(xmlSecDSigReferenceCtx));
-    if(dsigRefCtx == NULL) {
-        xmlSecMallocError(sizeof(xmlSecDSigReferenceCtx), NULL);
-        return(NULL);
+    /* uri (or the pinned subtree context), digest method, validator */
+    if(node != NULL) {
+        ret = xmlSecDSigDigestCacheAppend(cacheId, BAD_CAST "#");
+        if(ret >= 0) {
+            ret = xmlSecDSigDigestCacheAppendNodeContext(node, cacheId);
+        }
+    } else {
+        ret = xmlSecDSigDigestCacheAppend(cacheId, dsigRefCtx->uri);
+    }
+    if(ret >= 0) {
+        ret = xmlSecDSigDigestCacheAppend(cacheId, dsigRefCtx->digestMethod->id->href);
+    }
+    if(ret >= 0) {
+        ret = xmlSecBufferAppend(cacheId, xmlSecBufferGetData(&validatorBuf), xmlSecBufferGetSize(&validatorBuf));
+    }
+    if(ret >= 0) {
+        ret = xmlSecDSigDigestCacheAppend(cacheId, NULL);
+    }
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigDigestCacheAppend", NULL);
+        goto done;
     }
 
-    ret = xmlSecDSigReferenceCtxInitialize(dsigRefCtx, dsigCtx, origin);
+    /* transforms */
+    transformsStart = xmlSecBufferGetSize(cacheId);
+    ret = xmlSecDSigReferenceCtxAppendTransforms(dsigRefCtx, cacheId);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecDSigReferenceCtxInitialize", NULL);
-        xmlSecDSigReferenceCtxDestroy(dsigRefCtx);
-        return(NULL);
+        xmlSecInternalError("xmlSecDSigReferenceCtxAppendTransforms", NULL);
+        goto done;
     }
-    return(dsigRefCtx);
-}
 
-/**
- * xmlSecDSigReferenceCtxDestroy:
- * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
- *
- * Destroy context object created with #xmlSecDSigReferenceCtxCreate function.
- */
-void
-xmlSecDSigReferenceCtxDestroy(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
-    xmlSecAssert(dsigRefCtx != NULL);
+    /* the here() XPath function result depends on the reference node */
+    if((node != NULL) && xmlSecDSigDigestCacheHasHere(xmlSecBufferGetData(cacheId) + transformsStart,
+                                                      xmlSecBufferGetSize(cacheId) - transformsStart)) {
+        res = 0;
+        goto done;
+    }
 
-    xmlSecDSigReferenceCtxFinalize(dsigRefCtx);
-    xmlFree(dsigRefCtx);
+    /* success */
+    res = 1;
+
+done:
+    if(res != 1) {
+        xmlSecBufferEmpty(cacheId);
+    }
+    xmlSecBufferFinalize(&validatorBuf);
+    return(res);
 }
 
-/**
- * xmlSecDSigReferenceCtxInitialize:
- * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
- * @dsigCtx:            the pointer to parent &lt;dsig:Signature/&gt; node processing context.
- * @origin:             the reference origin (&lt;dsig:SignedInfo/&gt; or &lt;dsig:Manifest/&gt; node).
- *
- * Initializes new &lt;dsig:Reference/&gt; element processing context. Caller is responsible
- * for cleaning up the returned context by calling #xmlSecDSigReferenceCtxFinalize
- * function.
- *
- * Returns: 0 on succes or aa negative value otherwise.
- */
-int
-xmlSecDSigReferenceCtxInitialize(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlSecDSigCtxPtr dsigCtx,
-                                xmlSecDSigReferenceOrigin origin) {
+/* returns 1 if the reference data does not depend on the signatures created by
+ * #xmlSecDSigCtxSignMultiple (and @key is set), 0 if not or a negative value if an error occurs */
+static int
+xmlSecDSigReferenceCtxSharedGetKey(xmlSecDSigReferenceCtxPtr dsigRefCtx, struct _xmlSecDSigSharedRefs* shared,
+                                   xmlSecBufferPtr key) {
+    const xmlChar* uri;
+    xmlAttrPtr attr;
+    xmlNodePtr cur;
+    xmlSecSize ii;
     int ret;
 
-    xmlSecAssert2(dsigCtx != NULL, -1);
     xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+    xmlSecAssert2(shared != NULL, -1);
+    xmlSecAssert2(key != NULL, -1);
 
-    memset(dsigRefCtx, 0, sizeof(xmlSecDSigReferenceCtx));
+    uri = dsigRefCtx->uri;
 
-    dsigRefCtx->dsigCtx = dsigCtx;
-    dsigRefCtx->origin = origin;
+    /* the whole document and the xpointer references include the signatures */
+    if((uri == NULL) || (uri[0] == '\0') || (dsigRefCtx->preDigestMemBufMethod != NULL)) {
+        return(0);
+    }
+    if(uri[0] == '#') {
+        if(xmlStrchr(uri, '(') != NULL) {
+            return(0);
+        }
+        attr = xmlGetID(dsigRefCtx->digestValueNode->doc, uri + 1);
+        if((attr == NULL) || (attr->parent == NULL)) {
+            return(0);
+        }
+        for(ii = 0; ii < shared->size; ++ii) {
+            for(cur = shared->tmpls[ii]; cur != NULL; cur = cur->parent) {
+                if(cur == attr->parent) {
+                    return(0);
+                }
+            }
+        }
+    }
 
-    /* initializes transforms dsigRefCtx */
-    ret = xmlSecTransformCtxInitialize(&(dsigRefCtx->transformCtx));
+    /* uri, transforms */
+    xmlSecBufferEmpty(key);
+    ret = xmlSecDSigDigestCacheAppend(key, uri);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformCtxInitialize", NULL);
+        xmlSecInternalError("xmlSecDSigDigestCacheAppend", NULL);
         return(-1);
     }
-
-    /* copy enabled transforms */
-    if(dsigCtx->enabledReferenceTransforms != NULL) {
-        ret = xmlSecPtrListCopy(&(dsigRefCtx->transformCtx.enabledTransforms),
-                                     dsigCtx->enabledReferenceTransforms);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecPtrListCopy", NULL);
-            return(-1);
-        }
+    ret = xmlSecDSigReferenceCtxAppendTransforms(dsigRefCtx, key);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxAppendTransforms", NULL);
+        return(-1);
     }
-    dsigRefCtx->transformCtx.preExecCallback = dsigCtx->referencePreExecuteCallback;
-    dsigRefCtx->transformCtx.enabledUris = dsigCtx->enabledReferenceUris;
-    dsigRefCtx->transformCtx.userData = dsigCtx->userData;
 
-    if((dsigCtx->flags & XMLSEC_DSIG_FLAGS_USE_VISA3D_HACK) != 0) {
-        dsigRefCtx->transformCtx.flags |= XMLSEC_TRANSFORMCTX_FLAGS_USE_VISA3D_HACK;
+    /* the here() XPath function result depends on the reference node */
+    ret = xmlSecBufferAppend(key, BAD_CAST "", 1);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        return(-1);
     }
-    return(0);
+    if(xmlStrstr(xmlSecBufferGetData(key), BAD_CAST "here(") != NULL) {
+        return(0);
+    }
+    return(1);
 }
 
-/**
- * xmlSecDSigReferenceCtxFinalize:
- * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
- *
- * Cleans up context object created with #xmlSecDSigReferenceCtxInitialize function.
- */
-void
-xmlSecDSigReferenceCtxFinalize(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
-    xmlSecAssert(dsigRefCtx != NULL);
+/* finds the pre-digest data of the same reference in one of the previous signatures
+ * created by #xmlSecDSigCtxSignMultiple (@preDigest is set to NULL if there is none) */
+static int
+xmlSecDSigReferenceCtxFindShared(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlSecBufferPtr* preDigest) {
+    struct _xmlSecDSigSharedRefs* shared;
+    xmlSecDSigReferenceCtxPtr prevRefCtx;
+    xmlSecBuffer key, prevKey;
+    xmlSecSize ii, jj, size;
+    int res = -1;
+    int ret;
 
-    xmlSecTransformCtxFinalize(&(dsigRefCtx->transformCtx));
-    if(dsigRefCtx->id != NULL) {
-        xmlFree(dsigRefCtx->id);
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx->sharedRefs != NULL, -1);
+    xmlSecAssert2(preDigest != NULL, -1);
+
+    (*preDigest) = NULL;
+    shared = dsigRefCtx->dsigCtx->sharedRefs;
+    if(shared->done == 0) {
+        return(0);
     }
-    if(dsigRefCtx->uri != NULL) {
-        xmlFree(dsigRefCtx->uri);
+
+    ret = xmlSecBufferInitialize(&key, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        return(-1);
     }
-    if(dsigRefCtx->type != NULL) {
-        xmlFree(dsigRefCtx->type);
+    ret = xmlSecBufferInitialize(&prevKey, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
+        xmlSecBufferFinalize(&key);
+        return(-1);
     }
-    memset(dsigRefCtx, 0, sizeof(xmlSecDSigReferenceCtx));
-}
 
-/**
- * xmlSecDSigReferenceCtxGetPreDigestBuffer:
- * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
- *
- * Gets the results of &lt;dsig:Reference/&gt; node processing just before digesting
- * (valid only if #XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES or
- * #XMLSEC_DSIG_FLAGS_STORE_MANIFEST_REFERENCES flas of signature context
- * is set).
- *
- * Returns: pointer to the buffer or NULL if an error occurs.
- */
-xmlSecBufferPtr
-xmlSecDSigReferenceCtxGetPreDigestBuffer(xmlSecDSigReferenceCtxPtr dsigRefCtx) {
-    xmlSecAssert2(dsigRefCtx != NULL, NULL);
+    ret = xmlSecDSigReferenceCtxSharedGetKey(dsigRefCtx, shared, &key);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxSharedGetKey", NULL);
+        goto done;
+    } else if(ret == 0) {
+        res = 0;
+        goto done;
+    }
 
-    return((dsigRefCtx->preDigestMemBufMethod != NULL) ?
-            xmlSecTransformMemBufGetBuffer(dsigRefCtx->preDigestMemBufMethod) : NULL);
-}
+    for(ii = 0; (ii < shared->done) && ((*preDigest) == NULL); ++ii) {
+        xmlSecAssert2(shared->ctxs[ii] != NULL, -1);
 
-/**
- * xmlSecDSigReferenceCtxProcessNode:
- * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
- * @node:               the pointer to &lt;dsig:Reference/&gt; node.
+        size = xmlSecPtrListGetSize(&(shared->ctxs[ii]->signedInfoReferences));
+        for(jj = 0; jj < size; ++jj) {
+            prevRefCtx = (xmlSecDSigReferenceCtxPtr)xmlSecPtrListGetItem(&(shared->ctxs[ii]->signedInfoReferences), jj);
+            if((prevRefCtx == NULL) || (prevRefCtx->transformCtx.result == NULL) ||
+               (prevRefCtx->digestValueNode == NULL) || (!xmlStrEqual(prevRefCtx->uri, dsigRefCtx->uri))) {
+                continue;
+            }
+            ret = xmlSecDSigReferenceCtxSharedGetKey(prevRefCtx, shared, &prevKey);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecDSigReferenceCtxSharedGetKey", NULL);
+                goto done;
+            } else if(ret == 0) {
+                continue;
+            }
+            if((xmlSecBufferGetSize(&prevKey) == xmlSecBufferGetSize(&key)) &&
+               (memcmp(xmlSecBufferGetData(&prevKey), xmlSecBufferGetData(&key), xmlSecBufferGetSize(&key)) == 0)) {
+                (*preDigest) = prevRefCtx->transformCtx.result;
+                break;
+            }
+        }
+    }
 
- * The Reference Element (http://www.w3.org/TR/xmldsig-core/#sec-Reference)
- *
- * Reference is an element that may occur one or more times. It specifies
- * a digest algorithm and digest value, and optionally an identifier of the
- * object being signed, the type of the object, and/or a list of transforms
- * to be applied prior to digesting. The identification (URI) and transforms
- * describe how the digested content (i.e., the input to the digest method)
- * was created. The Type attribute facilitates the processing of referenced
- * data. For example, while this specification makes no requirements over
- * external data, an application may wish to signal that the referent is a
- * Manifest. An optional ID attribute permits a Reference to be referenced
- * from elsewhere.
- *
- * Returns: 0 on succes or aa negative value otherwise.
- */
-int
-xmlSecDSigReferenceCtxProcessNode(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlNodePtr node) {
+    /* success */
+    res = 0;
+
+done:
+    xmlSecBufferFinalize(&prevKey);
+    xmlSecBufferFinalize(&key);
+    return(res);
+}
+
+/* sets the reference result from the cached @digest */
+static int
+xmlSecDSigReferenceCtxCacheApply(xmlSecDSigReferenceCtxPtr dsigRefCtx, const xmlSecByte* digest,
+                                 xmlSecSize digestSize) {
     xmlSecTransformCtxPtr transformCtx;
-    xmlNodePtr digestValueNode;
-    xmlNodePtr cur;
+    xmlSecTransformPtr memBuf;
+    xmlSecBuffer expected;
+    xmlChar* str;
     int ret;
 
     xmlSecAssert2(dsigRefCtx != NULL, -1);
     xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
-    xmlSecAssert2(dsigRefCtx->digestMethod == NULL, -1);
-    xmlSecAssert2(dsigRefCtx->digestMethod == NULL, -1);
-    xmlSecAssert2(dsigRefCtx->preDigestMemBufMethod == NULL, -1);
-    xmlSecAssert2(node != NULL, -1);
-    xmlSecAssert2(node->doc != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestMethod != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->digestValueNode != NULL, -1);
+    xmlSecAssert2(digest != NULL, -1);
 
     transformCtx = &(dsigRefCtx->transformCtx);
 
-    /* read attributes first */
-    dsigRefCtx->uri = xmlGetProp(node, xmlSecAttrURI);
-    dsigRefCtx->id  = xmlGetProp(node, xmlSecAttrId);
-    dsigRefCtx->type= xmlGetProp(node, xmlSecAttrType);
-
-    /* set start URI (and check that it is enabled!) */
-    ret = xmlSecTransformCtxSetUri(transformCtx, dsigRefCtx->uri, node);
-    if(ret < 0) {
-        xmlSecInternalError2("xmlSecTransformCtxSetUri", NULL,
-                             "uri=%s", xmlSecErrorsSafeString(dsigRefCtx->uri));
-        return(-1);
-    }
-
-    /* first is optional Transforms node */
-    cur  = xmlSecGetNextElementNode(node->children);
-    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeTransforms, xmlSecDSigNs))) {
-        ret = xmlSecTransformCtxNodesListRead(transformCtx,
-                                        cur, xmlSecTransformUsageDSigTransform);
+    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
+        /* same output as the base64 transform added by xmlSecDSigReferenceCtxPrepareNode() */
+        memBuf = xmlSecTransformCtxCreateAndAppend(transformCtx, xmlSecTransformMemBufId);
+        if(memBuf == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend(xmlSecTransformMemBufId)", NULL);
+            return(-1);
+        }
+        str = xmlSecBase64Encode(digest, digestSize, xmlSecBase64GetDefaultLineSize());
+        if(str == NULL) {
+            xmlSecInternalError("xmlSecBase64Encode", NULL);
+            return(-1);
+        }
+        ret = xmlSecBufferSetData(xmlSecTransformMemBufGetBuffer(memBuf), str, xmlSecStrlen(str));
+        xmlFree(str);
         if(ret < 0) {
-            xmlSecInternalError2("xmlSecTransformCtxNodesListRead", NULL,
-                                 "node=%s", xmlSecErrorsSafeString(xmlSecNodeGetName(cur)));
+            xmlSecInternalError("xmlSecBufferSetData", NULL);
             return(-1);
         }
 
-        cur = xmlSecGetNextElementNode(cur->next);
-    }
-
-    /* insert membuf if requested */
-    if(((dsigRefCtx->origin == xmlSecDSigReferenceOriginSignedInfo) &&
-        ((dsigRefCtx->dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_SIGNEDINFO_REFERENCES) != 0)) ||
-       ((dsigRefCtx->origin == xmlSecDSigReferenceOriginManifest) &&
-        ((dsigRefCtx->dsigCtx->flags & XMLSEC_DSIG_FLAGS_STORE_MANIFEST_REFERENCES) != 0))) {
-
-        xmlSecAssert2(dsigRefCtx->preDigestMemBufMethod == NULL, -1);
-        dsigRefCtx->preDigestMemBufMethod = xmlSecTransformCtxCreateAndAppend(
-                                                transformCtx,
-                                                xmlSecTransformMemBufId);
-        if(dsigRefCtx->preDigestMemBufMethod == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend(xmlSecTransformMemBufId)", NULL);
+        transformCtx->result = xmlSecTransformMemBufGetBuffer(memBuf);
+        transformCtx->status = xmlSecTransformStatusFinished;
+        dsigRefCtx->result = transformCtx->result;
+        dsigRefCtx->status = xmlSecDSigStatusSucceeded;
+    } else {
+        ret = xmlSecBufferInitialize(&expected, 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize", NULL);
             return(-1);
         }
-    }
-
-    /* next node is required DigestMethod. */
-    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeDigestMethod, xmlSecDSigNs))) {
-        dsigRefCtx->digestMethod = xmlSecTransformCtxNodeRead(&(dsigRefCtx->transformCtx),
-                                        cur, xmlSecTransformUsageDigestMethod);
-        if(dsigRefCtx->digestMethod == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxNodeRead",
-                                xmlSecNodeGetName(cur));
+        ret = xmlSecBufferBase64NodeContentRead(&expected, dsigRefCtx->digestValueNode);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferBase64NodeContentRead", NULL);
+            xmlSecBufferFinalize(&expected);
             return(-1);
         }
 
-        cur = xmlSecGetNextElementNode(cur->next);
-    } else if(dsigRefCtx->dsigCtx->defSignMethodId != xmlSecTransformIdUnknown) {
-        /* the dsig spec does require DigestMethod node
-         * to be present but in some case it application might decide to
-         * minimize traffic */
-        dsigRefCtx->digestMethod = xmlSecTransformCtxCreateAndAppend(&(dsigRefCtx->transformCtx),
-                                                              dsigRefCtx->dsigCtx->defSignMethodId);
-        if(dsigRefCtx->digestMethod == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
-            return(-1);
+        if((xmlSecBufferGetSize(&expected) == digestSize) &&
+           (memcmp(xmlSecBufferGetData(&expected), digest, digestSize) == 0)) {
+            dsigRefCtx->digestMethod->status = xmlSecTransformStatusOk;
+            dsigRefCtx->status = xmlSecDSigStatusSucceeded;
+        } else {
+            dsigRefCtx->digestMethod->status = xmlSecTransformStatusFail;
+            dsigRefCtx->status = xmlSecDSigStatusInvalid;
         }
-    } else {
-        /* if digest method is not specified in the template and not specified in
-         * the dsig context then it's an error.
-         */
-        xmlSecInvalidNodeError(cur, xmlSecNodeDigestMethod, NULL);
+        xmlSecBufferFinalize(&expected);
+    }
+    return(0);
+}
+
+/* returns 1 if the digest was found (and the reference status is set), 0 if not or a negative value if an error occurs */
+static int
+xmlSecDSigReferenceCtxCacheFind(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlSecBufferPtr cacheId) {
+    xmlSecDSigDigestCachePtr cache;
+    xmlSecDSigDigestCacheEntryPtr entry;
+    xmlSecBuffer digest;
+    const xmlSecByte* id;
+    xmlSecSize idSize;
+    unsigned int hash;
+    xmlSecSize ii;
+    int found = 0;
+    int ret;
+
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx->digestCache != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+
+    cache = dsigRefCtx->dsigCtx->digestCache;
+
+    ret = xmlSecDSigReferenceCtxCacheGetId(dsigRefCtx, cacheId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxCacheGetId", NULL);
+        return(-1);
+    } else if(ret == 0) {
+        return(0);
+    }
+    id = xmlSecBufferGetData(cacheId);
+    idSize = xmlSecBufferGetSize(cacheId);
+    hash = xmlSecDSigDigestCacheHash(id, idSize);
+
+    ret = xmlSecBufferInitialize(&digest, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
         return(-1);
     }
-    dsigRefCtx->digestMethod->operation = dsigRefCtx->dsigCtx->operation;
 
-    /* last node is required DigestValue */
-    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeDigestValue, xmlSecDSigNs))) {
-        digestValueNode = cur;
-        cur = xmlSecGetNextElementNode(cur->next);
-    } else {
-        xmlSecInvalidNodeError(cur, xmlSecNodeDigestValue, NULL);
+    xmlMutexLock(cache->mutex);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        entry = &(cache->entries[ii]);
+        if((entry->digest == NULL) || (entry->hash != hash) ||
+           (entry->idSize != idSize) || (memcmp(entry->id, id, idSize) != 0)) {
+            continue;
+        }
+
+        ret = xmlSecBufferSetData(&digest, entry->digest, entry->digestSize);
+        found = (ret < 0) ? -1 : 1;
+        break;
+    }
+    xmlMutexUnlock(cache->mutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheReferenceDigest, (found > 0) ? 1 : 0);
+
+    if(found < 0) {
+        xmlSecInternalError("xmlSecBufferSetData", NULL);
+        xmlSecBufferFinalize(&digest);
         return(-1);
+    } else if(found == 0) {
+        xmlSecBufferFinalize(&digest);
+        return(0);
     }
 
-    /* if we have something else then it's an error */
-    if(cur != NULL) {
-        xmlSecUnexpectedNodeError(cur,  NULL);
+    ret = xmlSecDSigReferenceCtxCacheApply(dsigRefCtx, xmlSecBufferGetData(&digest), xmlSecBufferGetSize(&digest));
+    xmlSecBufferFinalize(&digest);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigReferenceCtxCacheApply", NULL);
         return(-1);
     }
+    return(1);
+}
 
-    /* if we need to write result to xml node then we need base64 encode result */
-    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
-        xmlSecTransformPtr base64Encode;
+/* adds the digest of the succeeded reference to the cache */
+static int
+xmlSecDSigReferenceCtxCacheAdd(xmlSecDSigReferenceCtxPtr dsigRefCtx, xmlSecBufferPtr cacheId) {
+    xmlSecDSigDigestCachePtr cache;
+    xmlSecDSigDigestCacheEntry newEntry;
+    xmlSecDSigDigestCacheEntryPtr entry;
+    xmlSecBuffer digest;
+    xmlChar* str;
+    xmlSecSize strSize = 0;
+    int strLen;
+    xmlSecSize ii;
+    int ret;
 
-        /* we need to add base64 encode transform */
-        base64Encode = xmlSecTransformCtxCreateAndAppend(transformCtx, xmlSecTransformBase64Id);
-        if(base64Encode == NULL) {
-            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend", NULL);
-            return(-1);
-        }
-        base64Encode->operation = xmlSecTransformOperationEncode;
-    }
+    xmlSecAssert2(dsigRefCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->dsigCtx->digestCache != NULL, -1);
+    xmlSecAssert2(dsigRefCtx->status == xmlSecDSigStatusSucceeded, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+    xmlSecAssert2(xmlSecBufferGetSize(cacheId) > 0, -1);
 
-    /* finally get transforms results */
-    ret = xmlSecTransformCtxExecute(transformCtx, node->doc);
+    cache = dsigRefCtx->dsigCtx->digestCache;
+
+    ret = xmlSecBufferInitialize(&digest, 0);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformCtxExecute", NULL);
+        xmlSecInternalError("xmlSecBufferInitialize", NULL);
         return(-1);
     }
-    dsigRefCtx->result = transformCtx->result;
 
+    /* the signed result is base64 encoded, the verified one is the DigestValue content */
     if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
-        xmlSecByte* outBuf;
-        xmlSecSize outSize;
-        int outLen;
-
-        if((dsigRefCtx->result == NULL) || (xmlSecBufferGetData(dsigRefCtx->result) == NULL)) {
-            xmlSecInternalError("xmlSecTransformCtxExecute", NULL);
+        xmlSecAssert2(dsigRefCtx->result != NULL, -1);
+
+        XMLSEC_SAFE_CAST_SIZE_TO_INT(xmlSecBufferGetSize(dsigRefCtx->result), strLen,
+            xmlSecBufferFinalize(&digest); return(-1), NULL);
+        str = xmlStrndup(xmlSecBufferGetData(dsigRefCtx->result), strLen);
+        if(str == NULL) {
+            xmlSecStrdupError(xmlSecBufferGetData(dsigRefCtx->result), NULL);
+            xmlSecBufferFinalize(&digest);
             return(-1);
         }
-
-        /* write signed data to xml */
-        outBuf = xmlSecBufferGetData(dsigRefCtx->result);
-        outSize = xmlSecBufferGetSize(dsigRefCtx->result);
-        XMLSEC_SAFE_CAST_SIZE_TO_INT(outSize, outLen, return(-1), NULL);
-        xmlNodeSetContentLen(digestValueNode, outBuf, outLen);
-
-        /* set success status and we are done */
-        dsigRefCtx->status = xmlSecDSigStatusSucceeded;
-    } else {
-        /* verify SignatureValue node content */
-        ret = xmlSecTransformVerifyNodeContent(dsigRefCtx->digestMethod,
-                            digestValueNode, transformCtx);
-        if(ret < 0) {
-            xmlSecInternalError("xmlSecTransformVerifyNodeContent", NULL);
-            return(-1);
+        ret = xmlSecBase64DecodeInPlace(str, &strSize);
+        if(ret >= 0) {
+            ret = xmlSecBufferSetData(&digest, str, strSize);
         }
+        xmlFree(str);
+    } else {
+        ret = xmlSecBufferBase64NodeContentRead(&digest, dsigRefCtx->digestValueNode);
+    }
+    if((ret < 0) || (xmlSecBufferGetSize(&digest) == 0)) {
+        xmlSecInternalError("digest", NULL);
+        xmlSecBufferFinalize(&digest);
+        return(-1);
+    }
 
-        /* set status and we are done */
-        if(dsigRefCtx->digestMethod->status == xmlSecTransformStatusOk) {
-            dsigRefCtx->status = xmlSecDSigStatusSucceeded;
-        } else {
-            dsigRefCtx->status = xmlSecDSigStatusInvalid;
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.hash = xmlSecDSigDigestCacheHash(xmlSecBufferGetData(cacheId), xmlSecBufferGetSize(cacheId));
+    newEntry.idSize = xmlSecBufferGetSize(cacheId);
+    newEntry.id = (xmlSecByte*)xmlMalloc(newEntry.idSize);
+    if(newEntry.id == NULL) {
+        xmlSecMallocError(newEntry.idSize, NULL);
+        xmlSecBufferFinalize(&digest);
+        return(-1);
+    }
+    memcpy(newEntry.id, xmlSecBufferGetData(cacheId), newEntry.idSize);
+    newEntry.digestSize = xmlSecBufferGetSize(&digest);
+    newEntry.digest = (xmlSecByte*)xmlMalloc(newEntry.digestSize);
+    if(newEntry.digest == NULL) {
+        xmlSecMallocError(newEntry.digestSize, NULL);
+        xmlSecDSigDigestCacheEntryClear(&newEntry);
+        xmlSecBufferFinalize(&digest);
+        return(-1);
+    }
+    memcpy(newEntry.digest, xmlSecBufferGetData(&digest), newEntry.digestSize);
+    xmlSecBufferFinalize(&digest);
+
+    xmlMutexLock(cache->mutex);
+
+    /* replace the same entry (e.g. added by another thread) or the oldest one */
+    entry = &(cache->entries[cache->pos]);
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        if((cache->entries[ii].digest != NULL) && (cache->entries[ii].hash == newEntry.hash) &&
+           (cache->entries[ii].idSize == newEntry.idSize) &&
+           (memcmp(cache->entries[ii].id, newEntry.id, newEntry.idSize) == 0)
+        ) {
+            entry = &(cache->entries[ii]);
+            break;
         }
     }
+    if(entry == &(cache->entries[cache->pos])) {
+        cache->pos = (cache->pos + 1) % cache->maxSize;
+    }
+    xmlSecDSigDigestCacheEntryClear(entry);
+    memcpy(entry, &newEntry, sizeof(newEntry));
 
+    xmlMutexUnlock(cache->mutex);
     return(0);
 }
 
+/**************************************************************************
+ *
+ * Signatures verification results cache. The entries are identified by
+ * the signature method, the public key value, the &lt;dsig:SignatureValue/&gt;
+ * and the canonicalized &lt;dsig:SignedInfo/&gt; (the entries are looked up
+ * in the hash table by the hash of this id and then compared in full),
+ * expire with the key validity interval (e.g. the certificate notAfter time)
+ * and are evicted in the insertion order when the cache is full. The key is still resolved (and the certificates
+ * are still verified) and the references are still digested on every
+ * verification, only the signature verification itself is skipped.
+ *
+ *************************************************************************/
+typedef struct _xmlSecDSigVerifyCacheEntry      xmlSecDSigVerifyCacheEntry,
+                                                *xmlSecDSigVerifyCacheEntryPtr;
+#define XMLSEC_DSIG_VERIFY_CACHE_MIN_TABLE_SIZE         16
+
+struct _xmlSecDSigVerifyCacheEntry {
+    xmlSecDSigVerifyCacheEntryPtr       hashNext;
+    unsigned int                        hash;
+    xmlSecByte*                         id;
+    xmlSecSize                          idSize;
+    time_t                              notValidBefore;
+    time_t                              notValidAfter;
+};
+
+struct _xmlSecDSigVerifyCache {
+    xmlMutexPtr                         mutex;
+    xmlSecDSigVerifyCacheEntryPtr       entries;
+    xmlSecSize                          maxSize;
+    xmlSecSize                          pos;
+    xmlSecDSigVerifyCacheEntryPtr*      table;
+    xmlSecSize                          tableSize;      /* power of 2 */
+};
+
+static void
+xmlSecDSigVerifyCacheEntryClear(xmlSecDSigVerifyCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->id != NULL) {
+        xmlFree(entry->id);
+    }
+    memset(entry, 0, sizeof(xmlSecDSigVerifyCacheEntry));
+}
+
 /**
- * xmlSecDSigReferenceCtxDebugDump:
- * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
- * @output:             the pointer to output FILE.
+ * xmlSecDSigVerifyCacheCreate:
+ * @maxSize:            the max number of verification results in the cache.
  *
- * Prints debug information about @dsigRefCtx to @output.
+ * Creates the cache for the signatures verification results. When the
+ * cache is set in #xmlSecDSigCtx.verifyCache, the signature of the same
+ * canonicalized &lt;dsig:SignedInfo/&gt; with the same &lt;dsig:SignatureValue/&gt;
+ * and the same public key (e.g. the same SAML assertion presented again)
+ * is verified only once until the key validity interval ends. The key is
+ * still resolved and the references are still digested for every signature,
+ * i.e. the document integrity is fully checked. Only the valid signatures
+ * of the asymmetric keys are cached. The cache is locked and can be shared
+ * by the contexts in different threads.
+ *
+ * Returns: the pointer to newly allocated cache or NULL if an error occurs.
+ * The caller is responsible for destroying the cache with #xmlSecDSigVerifyCacheDestroy.
  */
-void
-xmlSecDSigReferenceCtxDebugDump(xmlSecDSigReferenceCtxPtr dsigRefCtx, FILE* output) {
-    xmlSecAssert(dsigRefCtx != NULL);
-    xmlSecAssert(dsigRefCtx->dsigCtx != NULL);
-    xmlSecAssert(output != NULL);
+xmlSecDSigVerifyCachePtr
+xmlSecDSigVerifyCacheCreate(xmlSecSize maxSize) {
+    xmlSecDSigVerifyCachePtr cache;
+    xmlSecSize tableSize;
 
-    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
-        fprintf(output, "= REFERENCE CALCULATION CONTEXT\n");
-    } else {
-        fprintf(output, "= REFERENCE VERIFICATION CONTEXT\n");
+    xmlSecAssert2(maxSize > 0, NULL);
+
+    if(maxSize > XMLSEC_SIZE_MAX / (2 * sizeof(xmlSecDSigVerifyCacheEntry))) {
+        xmlSecInvalidSizeOtherError("verify cache size is too big", NULL);
+        return(NULL);
     }
-    fprintf(output, "== Status: %s\n", xmlSecDSigCtxGetStatusString(dsigRefCtx->status));
+    for(tableSize = XMLSEC_DSIG_VERIFY_CACHE_MIN_TABLE_SIZE; tableSize < maxSize; tableSize *= 2);
 
-    if(dsigRefCtx->id != NULL) {
-        fprintf(output, "== Id: \"%s\"\n", dsigRefCtx->id);
+    cache = (xmlSecDSigVerifyCachePtr)xmlMalloc(sizeof(xmlSecDSigVerifyCache));
+    if(cache == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigVerifyCache), NULL);
+        return(NULL);
     }
-    if(dsigRefCtx->uri != NULL) {
-        fprintf(output, "== URI: \"%s\"\n", dsigRefCtx->uri);
+    memset(cache, 0, sizeof(xmlSecDSigVerifyCache));
+
+    cache->entries = (xmlSecDSigVerifyCacheEntryPtr)xmlMalloc(sizeof(xmlSecDSigVerifyCacheEntry) * maxSize);
+    if(cache->entries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigVerifyCacheEntry) * maxSize, NULL);
+        xmlFree(cache);
+        return(NULL);
     }
-    if(dsigRefCtx->type != NULL) {
-        fprintf(output, "== Type: \"%s\"\n", dsigRefCtx->type);
+    memset(cache->entries, 0, sizeof(xmlSecDSigVerifyCacheEntry) * maxSize);
+
+    cache->table = (xmlSecDSigVerifyCacheEntryPtr*)xmlMalloc(sizeof(xmlSecDSigVerifyCacheEntryPtr) * tableSize);
+    if(cache->table == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDSigVerifyCacheEntryPtr) * tableSize, NULL);
+        xmlFree(cache->entries);
+        xmlFree(cache);
+        return(NULL);
+    }
+    memset(cache->table, 0, sizeof(xmlSecDSigVerifyCacheEntryPtr) * tableSize);
+
+    cache->mutex = xmlNewMutex();
+    if(cache->mutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(cache->table);
+        xmlFree(cache->entries);
+        xmlFree(cache);
+        return(NULL);
     }
+    cache->maxSize = maxSize;
+    cache->tableSize = tableSize;
+    return(cache);
+}
 
-    fprintf(output, "== Reference Transform Ctx:\n");
-    xmlSecTransformCtxDebugDump(&(dsigRefCtx->transformCtx), output);
+/**
+ * xmlSecDSigVerifyCacheDestroy:
+ * @cache:              the pointer to verification results cache.
+ *
+ * Destroys the verification results cache.
+ */
+void
+xmlSecDSigVerifyCacheDestroy(xmlSecDSigVerifyCachePtr cache) {
+    xmlSecSize ii;
 
-    if(dsigRefCtx->digestMethod != NULL) {
-        fprintf(output, "== Digest Method:\n");
-        xmlSecTransformDebugDump(dsigRefCtx->digestMethod, output);
+    xmlSecAssert(cache != NULL);
+
+    for(ii = 0; ii < cache->maxSize; ++ii) {
+        xmlSecDSigVerifyCacheEntryClear(&(cache->entries[ii]));
     }
+    xmlFree(cache->entries);
+    xmlFree(cache->table);
+    xmlFreeMutex(cache->mutex);
+    memset(cache, 0, sizeof(xmlSecDSigVerifyCache));
+    xmlFree(cache);
+}
 
-    if((xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx) != NULL) &&
-       (xmlSecBufferGetData(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)) != NULL)) {
+/* the caller holds the cache mutex */
+static xmlSecDSigVerifyCacheEntryPtr
+xmlSecDSigVerifyCacheLookup(xmlSecDSigVerifyCachePtr cache, unsigned int hash,
+                            const xmlSecByte* id, xmlSecSize idSize) {
+    xmlSecDSigVerifyCacheEntryPtr entry;
 
-        fprintf(output, "== PreDigest data - start buffer:\n");
-        (void)fwrite(xmlSecBufferGetData(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)),
-                     xmlSecBufferGetSize(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)),
-                     1, output);
-        fprintf(output, "\n== PreDigest data - end buffer\n");
+    xmlSecAssert2(cache != NULL, NULL);
+    xmlSecAssert2(cache->table != NULL, NULL);
+    xmlSecAssert2(id != NULL, NULL);
+
+    for(entry = cache->table[hash & (cache->tableSize - 1)]; entry != NULL; entry = entry->hashNext) {
+        if((entry->hash == hash) && (entry->idSize == idSize) && (memcmp(entry->id, id, idSize) == 0)) {
+            return(entry);
+        }
     }
+    return(NULL);
+}
 
-    if((dsigRefCtx->result != NULL) &&
-       (xmlSecBufferGetData(dsigRefCtx->result) != NULL)) {
+/* the caller holds the cache mutex */
+static void
+xmlSecDSigVerifyCacheRemove(xmlSecDSigVerifyCachePtr cache, xmlSecDSigVerifyCacheEntryPtr entry) {
+    xmlSecDSigVerifyCacheEntryPtr* cur;
 
-        fprintf(output, "== Result - start buffer:\n");
-        (void)fwrite(xmlSecBufferGetData(dsigRefCtx->result),
-                     xmlSecBufferGetSize(dsigRefCtx->result), 1,
-                     output);
-        fprintf(output, "\n== Result - end buffer\n");
+    xmlSecAssert(cache != NULL);
+    xmlSecAssert(cache->table != NULL);
+    xmlSecAssert(entry != NULL);
+
+    if(entry->id == NULL) {
+        return;
+    }
+    for(cur = &(cache->table[entry->hash & (cache->tableSize - 1)]); (*cur) != NULL; cur = &((*cur)->hashNext)) {
+        if((*cur) == entry) {
+            (*cur) = entry->hashNext;
+            break;
+        }
     }
+    xmlSecDSigVerifyCacheEntryClear(entry);
 }
 
-/**
- * xmlSecDSigReferenceCtxDebugXmlDump:
- * @dsigRefCtx:         the pointer to &lt;dsig:Reference/&gt; element processing context.
- * @output:             the pointer to output FILE.
- *
- * Prints debug information about @dsigRefCtx to @output in output format.
- */
-void
-xmlSecDSigReferenceCtxDebugXmlDump(xmlSecDSigReferenceCtxPtr dsigRefCtx, FILE* output) {
-    xmlSecAssert(dsigRefCtx != NULL);
-    xmlSecAssert(dsigRefCtx->dsigCtx != NULL);
-    xmlSecAssert(output != NULL);
+/* appends the public key value to @buf, returns 0 if the key is not an asymmetric key
+ * (the HMAC is cheaper than the cache lookup and the secret is never copied to the cache) */
+static int
+xmlSecDSigVerifyCacheAppendKey(xmlSecKeyPtr key, xmlSecBufferPtr buf) {
+    xmlSecKeyInfoCtx keyInfoCtx;
+    xmlOutputBufferPtr output;
+    xmlNodePtr node;
+    int res = -1;
+    int ret;
 
-    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
-        fprintf(output, "<ReferenceCalculationContext ");
-    } else {
-        fprintf(output, "<ReferenceVerificationContext ");
+    xmlSecAssert2(key != NULL, -1);
+    xmlSecAssert2(buf != NULL, -1);
+
+    if((!xmlSecKeyDataIsValid(key->value)) || (key->value->id->xmlWrite == NULL) ||
+       (key->value->id->dataNodeName == NULL) ||
+       ((xmlSecKeyDataGetType(key->value) & xmlSecKeyDataTypePublic) == 0)
+    ) {
+        return(0);
     }
-    fprintf(output, " status=\"%s\"", xmlSecDSigCtxGetStatusString(dsigRefCtx->status));
-    fprintf(output, ">\n");
 
-    fprintf(output, "<Id>");
-    xmlSecPrintXmlString(output, dsigRefCtx->id);
-    fprintf(output, "</Id>\n");
+    node = xmlNewNode(NULL, key->value->id->dataNodeName);
+    if(node == NULL) {
+        xmlSecXmlError2("xmlNewNode", NULL,
+                        "node=%s", xmlSecErrorsSafeString(key->value->id->dataNodeName));
+        return(-1);
+    }
+    ret = xmlSecKeyInfoCtxInitialize(&keyInfoCtx, NULL);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoCtxInitialize", NULL);
+        xmlFreeNode(node);
+        return(-1);
+    }
+    keyInfoCtx.mode = xmlSecKeyInfoModeWrite;
+    keyInfoCtx.keyReq.keyType = xmlSecKeyDataTypePublic;
 
-    fprintf(output, "<URI>");
-    xmlSecPrintXmlString(output, dsigRefCtx->uri);
-    fprintf(output, "</URI>\n");
+    ret = xmlSecKeyDataXmlWrite(key->value->id, key, node, &keyInfoCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyDataXmlWrite", xmlSecKeyDataGetName(key->value));
+        goto done;
+    }
 
-    fprintf(output, "<Type>");
-    xmlSecPrintXmlString(output, dsigRefCtx->type);
-    fprintf(output, "</Type>\n");
+    output = xmlSecBufferCreateOutputBuffer(buf);
+    if(output == NULL) {
+        xmlSecInternalError("xmlSecBufferCreateOutputBuffer", NULL);
+        goto done;
+    }
+    xmlNodeDumpOutput(output, NULL, node, 0, 0, NULL);
+    ret = xmlOutputBufferClose(output);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        goto done;
+    }
 
-    fprintf(output, "<ReferenceTransformCtx>\n");
-    xmlSecTransformCtxDebugXmlDump(&(dsigRefCtx->transformCtx), output);
-    fprintf(output, "</ReferenceTransformCtx>\n");
+    /* success */
+    res = 1;
 
-    if(dsigRefCtx->digestMethod != NULL) {
-        fprintf(output, "<DigestMethod>\n");
-        xmlSecTransformDebugXmlDump(dsigRefCtx->digestMethod, output);
-        fprintf(output, "</DigestMethod>\n");
+done:
+    xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+    xmlFreeNode(node);
+    return(res);
+}
+
+/* the cache id: the sign method, the public key, the signature value and the
+ * canonicalized SignedInfo; returns 0 if the signature can't be cached */
+static int
+xmlSecDSigVerifyCacheGetId(xmlSecDSigCtxPtr dsigCtx, xmlSecBufferPtr signedInfo,
+                           xmlSecBufferPtr signatureValue, xmlSecBufferPtr cacheId) {
+    int ret;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->signMethod != NULL, -1);
+    xmlSecAssert2(dsigCtx->signKey != NULL, -1);
+    xmlSecAssert2(signedInfo != NULL, -1);
+    xmlSecAssert2(signatureValue != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+
+    ret = xmlSecDSigDigestCacheAppend(cacheId, xmlSecTransformGetName(dsigCtx->signMethod));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigDigestCacheAppend", NULL);
+        return(-1);
+    }
+    ret = xmlSecDSigVerifyCacheAppendKey(dsigCtx->signKey, cacheId);
+    if(ret <= 0) {
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecDSigVerifyCacheAppendKey", NULL);
+        }
+        xmlSecBufferEmpty(cacheId);
+        return(ret);
+    }
+    ret = xmlSecDSigDigestCacheAppend(cacheId, NULL);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigDigestCacheAppend", NULL);
+        return(-1);
     }
 
-    if((dsigRefCtx->result != NULL) &&
-       (xmlSecBufferGetData(dsigRefCtx->result) != NULL)) {
+    /* the signature value has a fixed size for the given key and method */
+    ret = xmlSecBufferAppend(cacheId, xmlSecBufferGetData(signatureValue), xmlSecBufferGetSize(signatureValue));
+    if(ret >= 0) {
+        ret = xmlSecBufferAppend(cacheId, xmlSecBufferGetData(signedInfo), xmlSecBufferGetSize(signedInfo));
+    }
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecBufferAppend", NULL);
+        return(-1);
+    }
+    return(1);
+}
 
-        fprintf(output, "<Result>");
-        (void)fwrite(xmlSecBufferGetData(dsigRefCtx->result),
-                     xmlSecBufferGetSize(dsigRefCtx->result), 1,
-                     output);
-        fprintf(output, "</Result>\n");
+static time_t
+xmlSecDSigVerifyCacheGetTime(xmlSecDSigCtxPtr dsigCtx) {
+    xmlSecAssert2(dsigCtx != NULL, 0);
+
+    if(dsigCtx->keyInfoReadCtx.certsVerificationTime > 0) {
+        return(dsigCtx->keyInfoReadCtx.certsVerificationTime);
     }
+    return(time(NULL));
+}
 
-    if((xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx) != NULL) &&
-       (xmlSecBufferGetData(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)) != NULL)) {
+/* returns 1 if the valid signature was found, 0 if not (@cacheId is set if the
+ * signature can be cached) or a negative value if an error occurs */
+static int
+xmlSecDSigVerifyCacheFind(xmlSecDSigCtxPtr dsigCtx, xmlSecBufferPtr signedInfo,
+                          xmlSecBufferPtr signatureValue, xmlSecBufferPtr cacheId) {
+    xmlSecDSigVerifyCachePtr cache;
+    xmlSecDSigVerifyCacheEntryPtr entry;
+    const xmlSecByte* id;
+    xmlSecSize idSize;
+    unsigned int hash;
+    time_t now;
+    int found = 0;
+    int ret;
 
-        fprintf(output, "<PreDigestData>");
-        (void)fwrite(xmlSecBufferGetData(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)),
-                     xmlSecBufferGetSize(xmlSecDSigReferenceCtxGetPreDigestBuffer(dsigRefCtx)),
-                     1, output);
-        fprintf(output, "</PreDigestData>\n");
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->verifyCache != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+
+    cache = dsigCtx->verifyCache;
+
+    ret = xmlSecDSigVerifyCacheGetId(dsigCtx, signedInfo, signatureValue, cacheId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDSigVerifyCacheGetId", NULL);
+        return(-1);
+    } else if(ret == 0) {
+        return(0);
     }
-    if(dsigRefCtx->dsigCtx->operation == xmlSecTransformOperationSign) {
-        fprintf(output, "</ReferenceCalculationContext>\n");
-    } else {
-        fprintf(output, "</ReferenceVerificationContext>\n");
+    id = xmlSecBufferGetData(cacheId);
+    idSize = xmlSecBufferGetSize(cacheId);
+    hash = xmlSecDSigDigestCacheHash(id, idSize);
+    now = xmlSecDSigVerifyCacheGetTime(dsigCtx);
+
+    xmlMutexLock(cache->mutex);
+    entry = xmlSecDSigVerifyCacheLookup(cache, hash, id, idSize);
+    if(entry != NULL) {
+        if((entry->notValidBefore < entry->notValidAfter) &&
+           ((now < entry->notValidBefore) || (now > entry->notValidAfter))) {
+            /* the key is expired */
+            xmlSecDSigVerifyCacheRemove(cache, entry);
+        } else {
+            found = 1;
+        }
     }
+    xmlMutexUnlock(cache->mutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheSignature, found);
+
+    return(found);
 }
 
+/* adds the valid signature to the cache */
+static int
+xmlSecDSigVerifyCacheAdd(xmlSecDSigCtxPtr dsigCtx, xmlSecBufferPtr cacheId) {
+    xmlSecDSigVerifyCachePtr cache;
+    xmlSecDSigVerifyCacheEntry newEntry;
+    xmlSecDSigVerifyCacheEntryPtr entry;
+    xmlSecSize pos;
+
+    xmlSecAssert2(dsigCtx != NULL, -1);
+    xmlSecAssert2(dsigCtx->verifyCache != NULL, -1);
+    xmlSecAssert2(dsigCtx->signKey != NULL, -1);
+    xmlSecAssert2(cacheId != NULL, -1);
+    xmlSecAssert2(xmlSecBufferGetSize(cacheId) > 0, -1);
+
+    cache = dsigCtx->verifyCache;
+
+    /* prepare the new entry outside of the lock */
+    memset(&newEntry, 0, sizeof(newEntry));
+    newEntry.hash = xmlSecDSigDigestCacheHash(xmlSecBufferGetData(cacheId), xmlSecBufferGetSize(cacheId));
+    newEntry.idSize = xmlSecBufferGetSize(cacheId);
+    newEntry.id = (xmlSecByte*)xmlMalloc(newEntry.idSize);
+    if(newEntry.id == NULL) {
+        xmlSecMallocError(newEntry.idSize, NULL);
+        return(-1);
+    }
+    memcpy(newEntry.id, xmlSecBufferGetData(cacheId), newEntry.idSize);
+    newEntry.notValidBefore = dsigCtx->signKey->notValidBefore;
+    newEntry.notValidAfter = dsigCtx->signKey->notValidAfter;
+
+    xmlMutexLock(cache->mutex);
+
+    /* replace the same entry (e.g. added by another thread) or the oldest one */
+    entry = xmlSecDSigVerifyCacheLookup(cache, newEntry.hash, newEntry.id, newEntry.idSize);
+    if(entry == NULL) {
+        entry = &(cache->entries[cache->pos]);
+        cache->pos = (cache->pos + 1) % cache->maxSize;
+    }
+    xmlSecDSigVerifyCacheRemove(cache, entry);
+    memcpy(entry, &newEntry, sizeof(newEntry));
+
+    pos = newEntry.hash & (cache->tableSize - 1);
+    entry->hashNext = cache->table[pos];
+    cache->table[pos] = entry;
+
+    xmlMutexUnlock(cache->mutex);
+    return(0);
+}
 
 /**************************************************************************
  *
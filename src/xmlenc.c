@@ -25,29 +25,82 @@
 
 #include <libxml/tree.h>
 #include <libxml/parser.h>
+#include <libxml/entities.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/buffer.h>
+#include <xmlsec/io.h>
 #include <xmlsec/xmltree.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/keysmngr.h>
 #include <xmlsec/transforms.h>
 #include <xmlsec/keyinfo.h>
+#include <xmlsec/memstats.h>
 #include <xmlsec/xmlenc.h>
+#include <xmlsec/recorder.h>
+#include <xmlsec/templates.h>
+#include <xmlsec/parser.h>
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "docindex_helpers.h"
+#include "keysdata_helpers.h"
+#include "keysmngr_helpers.h"
+#include "stats_helpers.h"
 
 static int      xmlSecEncCtxEncDataNodeRead             (xmlSecEncCtxPtr encCtx,
                                                          xmlNodePtr node);
 static int      xmlSecEncCtxEncDataNodeWrite            (xmlSecEncCtxPtr encCtx);
+static int      xmlSecEncCtxKeyInfoNodeWrite            (xmlSecEncCtxPtr encCtx);
+static int      xmlSecEncCtxSessionKeyGet               (xmlSecEncCtxPtr encCtx);
+static int      xmlSecEncCtxAddCompression              (xmlSecEncCtxPtr encCtx);
 static int      xmlSecEncCtxCipherDataNodeRead          (xmlSecEncCtxPtr encCtx,
                                                          xmlNodePtr node);
+static int      xmlSecEncCtxXopIncludeNodeRead          (xmlSecEncCtxPtr encCtx,
+                                                         xmlNodePtr node);
 static int      xmlSecEncCtxCipherReferenceNodeRead     (xmlSecEncCtxPtr encCtx,
                                                          xmlNodePtr node);
 
+typedef struct _xmlSecEncStreamParser           xmlSecEncStreamParser, *xmlSecEncStreamParserPtr;
+
+static int      xmlSecEncCtxDecryptAndReplace           (xmlSecEncCtxPtr encCtx,
+                                                         xmlNodePtr node);
+static xmlSecBufferPtr xmlSecEncCtxDecryptInternal      (xmlSecEncCtxPtr encCtx,
+                                                         xmlNodePtr node,
+                                                         xmlSecEncCtxDecryptSinkCallback sink,
+                                                         void* sinkCtx,
+                                                         xmlSecEncStreamParserPtr parser);
+static int      xmlSecEncCtxAppendSink                  (xmlSecEncCtxPtr encCtx,
+                                                         xmlSecEncCtxDecryptSinkCallback sink,
+                                                         void* sinkCtx);
+static int      xmlSecEncCtxOutputWrite                 (void* sinkCtx,
+                                                         const xmlSecByte* data,
+                                                         xmlSecSize dataSize);
+static int      xmlSecEncCtxOutputWriteStart            (xmlOutputBufferPtr output,
+                                                         xmlNodePtr tmpl,
+                                                         xmlNodePtr target);
+static int      xmlSecEncCtxOutputWriteEnd              (xmlOutputBufferPtr output,
+                                                         xmlNodePtr tmpl,
+                                                         xmlNodePtr target);
 static void     xmlSecEncCtxMarkAsFailed                (xmlSecEncCtxPtr encCtx,
                                                          xmlSecEncFailureReason failureReason);
+static void     xmlSecEncCtxMarkIfDeadlineExceeded      (xmlSecEncCtxPtr encCtx);
+static xmlSecMemStatsPtr xmlSecEncCtxGetMemStats        (xmlSecEncCtxPtr encCtx);
+static xmlSecSettingsPtr xmlSecEncCtxGetSettings        (xmlSecEncCtxPtr encCtx);
+static int      xmlSecEncCtxBinaryEncryptInternal       (xmlSecEncCtxPtr encCtx,
+                                                         xmlNodePtr tmpl,
+                                                         const xmlSecByte* data,
+                                                         xmlSecSize dataSize);
+static int      xmlSecEncCtxXmlEncryptInternal          (xmlSecEncCtxPtr encCtx,
+                                                         xmlNodePtr tmpl,
+                                                         xmlNodePtr node);
+static int      xmlSecEncCtxUriEncryptInternal          (xmlSecEncCtxPtr encCtx,
+                                                         xmlNodePtr tmpl,
+                                                         const xmlChar *uri);
+static int      xmlSecEncCtxUriEncryptToOutputInternal  (xmlSecEncCtxPtr encCtx,
+                                                         xmlNodePtr tmpl,
+                                                         const xmlChar *uri,
+                                                         xmlOutputBufferPtr output);
 
 /* The ID attribute in XMLEnc is 'Id' */
 static const xmlChar*           xmlSecEncIds[] = { BAD_CAST "Id", NULL };
@@ -122,34 +175,45 @@ xmlSecEncCtxSetDefaults(xmlSecEncCtxPtr encCtx) {
  */
 int
 xmlSecEncCtxInitialize(xmlSecEncCtxPtr encCtx, xmlSecKeysMngrPtr keysMngr) {
+    xmlSecSettingsPtr prevSettings;
+    int res = -1;
     int ret;
 
     xmlSecAssert2(encCtx != NULL, -1);
 
     memset(encCtx, 0, sizeof(xmlSecEncCtx));
 
+    /* the defaults are taken from the keys manager settings */
+    prevSettings = xmlSecSettingsAttach((keysMngr != NULL) ? keysMngr->priv->settings : NULL);
+
     /* initialize key info */
     ret = xmlSecKeyInfoCtxInitialize(&(encCtx->keyInfoReadCtx), keysMngr);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxInitialize", NULL);
-        return(-1);
+        goto done;
     }
 
     ret = xmlSecKeyInfoCtxInitialize(&(encCtx->keyInfoWriteCtx), keysMngr);
     if(ret < 0) {
         xmlSecInternalError("xmlSecKeyInfoCtxInitialize", NULL);
-        return(-1);
+        goto done;
     }
 
     /* initializes transforms encCtx */
     ret = xmlSecTransformCtxInitialize(&(encCtx->transformCtx));
     if(ret < 0) {
         xmlSecInternalError("xmlSecTransformCtxInitialize", NULL);
-        return(-1);
+        goto done;
     }
 
     xmlSecEncCtxSetDefaults(encCtx);
-    return(0);
+
+    /* success */
+    res = 0;
+
+done:
+    xmlSecSettingsDetach(prevSettings);
+    return(res);
 }
 
 /**
@@ -196,6 +260,13 @@ xmlSecEncCtxReset(xmlSecEncCtxPtr encCtx) {
         encCtx->replacedNodeList = NULL;
     }
 
+    if(encCtx->sessionKeyId != NULL) {
+        xmlSecBufferDestroy(encCtx->sessionKeyId);
+        encCtx->sessionKeyId = NULL;
+    }
+    encCtx->sessionKeyReused    = 0;
+    xmlSecMemStatsReset(&(encCtx->memStats));
+
     if(encCtx->encKey != NULL) {
         xmlSecKeyDestroy(encCtx->encKey);
         encCtx->encKey = NULL;
@@ -237,6 +308,527 @@ xmlSecEncCtxReset(xmlSecEncCtxPtr encCtx) {
     xmlSecEncCtxSetDefaults(encCtx);
 }
 
+/**************************************************************************
+ *
+ * xmlSecEncCtxPool
+ *
+ *************************************************************************/
+static xmlSecPtrListKlass xmlSecEncCtxPoolListKlass = {
+    BAD_CAST "enc-ctx-pool-list",
+    NULL,                                               /* xmlSecPtrDuplicateItemMethod duplicateItem; */
+    (xmlSecPtrDestroyItemMethod)xmlSecEncCtxDestroy,    /* xmlSecPtrDestroyItemMethod destroyItem; */
+    NULL,                                               /* xmlSecPtrDebugDumpItemMethod debugDumpItem; */
+    NULL,                                               /* xmlSecPtrDebugDumpItemMethod debugXmlDumpItem; */
+};
+
+/**
+ * xmlSecEncCtxPoolCreate:
+ * @keysMngr:           the pointer to keys manager for the pooled contexts.
+ * @maxSize:            the max number of released contexts kept for reuse.
+ *
+ * Creates the pool of &lt;enc:EncryptedData/&gt; element processing contexts.
+ * The caller is responsible for destroying returned object by calling
+ * #xmlSecEncCtxPoolDestroy function.
+ *
+ * Returns: pointer to newly allocated pool or NULL if an error occurs.
+ */
+xmlSecEncCtxPoolPtr
+xmlSecEncCtxPoolCreate(xmlSecKeysMngrPtr keysMngr, xmlSecSize maxSize) {
+    xmlSecEncCtxPoolPtr pool;
+    int ret;
+
+    pool = (xmlSecEncCtxPoolPtr) xmlMalloc(sizeof(xmlSecEncCtxPool));
+    if(pool == NULL) {
+        xmlSecMallocError(sizeof(xmlSecEncCtxPool), NULL);
+        return(NULL);
+    }
+    memset(pool, 0, sizeof(xmlSecEncCtxPool));
+
+    ret = xmlSecPtrListInitialize(&(pool->ctxs), &xmlSecEncCtxPoolListKlass);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListInitialize", NULL);
+        xmlFree(pool);
+        return(NULL);
+    }
+    pool->keysMngr = keysMngr;
+    pool->maxSize  = maxSize;
+    return(pool);
+}
+
+/**
+ * xmlSecEncCtxPoolDestroy:
+ * @pool:               the pointer to contexts pool.
+ *
+ * Destroys the pool and all the contexts kept in it. The contexts acquired
+ * from the pool and not released yet are not affected.
+ */
+void
+xmlSecEncCtxPoolDestroy(xmlSecEncCtxPoolPtr pool) {
+    xmlSecAssert(pool != NULL);
+
+    xmlSecPtrListFinalize(&(pool->ctxs));
+    memset(pool, 0, sizeof(xmlSecEncCtxPool));
+    xmlFree(pool);
+}
+
+/**
+ * xmlSecEncCtxPoolAcquire:
+ * @pool:               the pointer to contexts pool.
+ *
+ * Gets a previously released context from the @pool or creates a new one.
+ * The reused context keeps the user settings from its last use. The caller
+ * is responsible for returning the context with #xmlSecEncCtxPoolRelease
+ * or destroying it with #xmlSecEncCtxDestroy function.
+ *
+ * Returns: pointer to &lt;enc:EncryptedData/&gt; processing context or NULL
+ * if an error occurs.
+ */
+xmlSecEncCtxPtr
+xmlSecEncCtxPoolAcquire(xmlSecEncCtxPoolPtr pool) {
+    xmlSecEncCtxPtr encCtx;
+    xmlSecSize size;
+
+    xmlSecAssert2(pool != NULL, NULL);
+
+    size = xmlSecPtrListGetSize(&(pool->ctxs));
+    if(size > 0) {
+        encCtx = (xmlSecEncCtxPtr)xmlSecPtrListRemoveAndReturn(&(pool->ctxs), size - 1);
+        if(encCtx == NULL) {
+            xmlSecInternalError("xmlSecPtrListRemoveAndReturn", NULL);
+            return(NULL);
+        }
+        return(encCtx);
+    }
+
+    encCtx = xmlSecEncCtxCreate(pool->keysMngr);
+    if(encCtx == NULL) {
+        xmlSecInternalError("xmlSecEncCtxCreate", NULL);
+        return(NULL);
+    }
+    return(encCtx);
+}
+
+/**
+ * xmlSecEncCtxPoolRelease:
+ * @pool:               the pointer to contexts pool.
+ * @encCtx:            the pointer to &lt;enc:EncryptedData/&gt; processing context.
+ *
+ * Resets @encCtx and returns it to the @pool for reuse (or destroys it
+ * if the pool is full).
+ */
+void
+xmlSecEncCtxPoolRelease(xmlSecEncCtxPoolPtr pool, xmlSecEncCtxPtr encCtx) {
+    int ret;
+
+    xmlSecAssert(pool != NULL);
+    xmlSecAssert(encCtx != NULL);
+
+    if(xmlSecPtrListGetSize(&(pool->ctxs)) >= pool->maxSize) {
+        xmlSecEncCtxDestroy(encCtx);
+        return;
+    }
+
+    xmlSecEncCtxReset(encCtx);
+    ret = xmlSecPtrListAdd(&(pool->ctxs), encCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListAdd", NULL);
+        xmlSecEncCtxDestroy(encCtx);
+        return;
+    }
+}
+
+/**************************************************************************
+ *
+ * xmlSecEncTemplate: the &lt;enc:EncryptedData/&gt; template copy in its own
+ * document with the recipients &lt;enc:EncryptedKey/&gt; nodes written once
+ *
+ *************************************************************************/
+struct _xmlSecEncTemplate {
+    xmlDocPtr                   doc;
+    xmlSecPtrList               recipientKeys;  /* in the &lt;enc:EncryptedKey/&gt; nodes order */
+};
+
+/* finds the &lt;enc:EncryptedKey/&gt; node starting from @cur (inclusive) */
+static xmlNodePtr
+xmlSecEncTemplateFindEncryptedKey(xmlNodePtr cur) {
+    for(cur = xmlSecGetNextElementNode(cur); cur != NULL; cur = xmlSecGetNextElementNode(cur->next)) {
+        if(xmlSecCheckNodeName(cur, xmlSecNodeEncryptedKey, xmlSecEncNs)) {
+            return(cur);
+        }
+    }
+    return(NULL);
+}
+
+/* the recipients &lt;enc:EncryptedKey/&gt; nodes are the &lt;dsig:KeyInfo/&gt; children */
+static xmlNodePtr
+xmlSecEncTemplateFirstEncryptedKey(xmlNodePtr encDataNode) {
+    xmlNodePtr keyInfoNode;
+
+    xmlSecAssert2(encDataNode != NULL, NULL);
+
+    keyInfoNode = xmlSecFindChild(encDataNode, xmlSecNodeKeyInfo, xmlSecDSigNs);
+    if(keyInfoNode == NULL) {
+        return(NULL);
+    }
+    return(xmlSecEncTemplateFindEncryptedKey(keyInfoNode->children));
+}
+
+/* the context for the &lt;enc:EncryptedKey/&gt; nodes, same as in #xmlSecKeyDataEncryptedKeyXmlWrite */
+static int
+xmlSecEncTemplateKeyCtxInitialize(xmlSecEncCtxPtr keyCtx, xmlSecEncCtxPtr encCtx) {
+    int ret;
+
+    xmlSecAssert2(keyCtx != NULL, -1);
+    xmlSecAssert2(encCtx != NULL, -1);
+
+    ret = xmlSecEncCtxInitialize(keyCtx, encCtx->keyInfoWriteCtx.keysMngr);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxInitialize", NULL);
+        return(-1);
+    }
+    keyCtx->mode = xmlEncCtxModeEncryptedKey;
+
+    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyCtx->keyInfoReadCtx), &(encCtx->keyInfoWriteCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(readCtx)", NULL);
+        xmlSecEncCtxFinalize(keyCtx);
+        return(-1);
+    }
+    ret = xmlSecKeyInfoCtxCopyUserPref(&(keyCtx->keyInfoWriteCtx), &(encCtx->keyInfoWriteCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoCtxCopyUserPref(writeCtx)", NULL);
+        xmlSecEncCtxFinalize(keyCtx);
+        return(-1);
+    }
+    return(0);
+}
+
+/**
+ * xmlSecEncTemplateCreate:
+ * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
+ * @tmpl:               the pointer to &lt;enc:EncryptedData/&gt; template node.
+ *
+ * Prepares the encryption template @tmpl (created with the xmlSecTmpl* functions)
+ * for encrypting many documents to the same recipients. The template is copied
+ * and the recipient key of each &lt;enc:EncryptedKey/&gt; child of the
+ * &lt;dsig:KeyInfo/&gt; node is found and written to the &lt;enc:EncryptedKey/&gt;
+ * &lt;dsig:KeyInfo/&gt; node (e.g. the X509 data) once, using the keys manager
+ * and #xmlSecEncCtx.keyInfoWriteCtx from @encCtx. The instances created by
+ * #xmlSecEncTemplateXmlEncrypt or #xmlSecEncTemplateBinaryEncrypt only
+ * encrypt the data and transport the session key to the prepared recipients.
+ * The recipients keys agreed with &lt;enc:AgreementMethod/&gt; are not supported
+ * (the key agreement must be done for each message).
+ *
+ * The template is not changed after it is created and can be used from many
+ * threads with different encryption contexts.
+ *
+ * Returns: the pointer to newly allocated template or NULL if an error occurs.
+ * The caller is responsible for destroying the template with #xmlSecEncTemplateDestroy.
+ */
+xmlSecEncTemplatePtr
+xmlSecEncTemplateCreate(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl) {
+    /* only the recipients keys are needed here, the wrapped key is discarded (16 bytes
+     * fit all the key transport and key wrap algorithms even with the small RSA keys) */
+    static const xmlSecByte dummyKey[16] = { 0 };
+    xmlSecEncTemplatePtr encTmpl;
+    xmlSecEncCtx keyCtx;
+    xmlNodePtr root, cur, keyInfoNode;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, NULL);
+    xmlSecAssert2(tmpl != NULL, NULL);
+
+    if(!xmlSecCheckNodeName(tmpl, xmlSecNodeEncryptedData, xmlSecEncNs)) {
+        xmlSecInvalidNodeError(tmpl, xmlSecNodeEncryptedData, NULL);
+        return(NULL);
+    }
+
+    encTmpl = (xmlSecEncTemplatePtr)xmlMalloc(sizeof(xmlSecEncTemplate));
+    if(encTmpl == NULL) {
+        xmlSecMallocError(sizeof(xmlSecEncTemplate), NULL);
+        return(NULL);
+    }
+    memset(encTmpl, 0, sizeof(xmlSecEncTemplate));
+
+    ret = xmlSecPtrListInitialize(&(encTmpl->recipientKeys), xmlSecKeyPtrListId);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecPtrListInitialize", NULL);
+        xmlFree(encTmpl);
+        return(NULL);
+    }
+
+    encTmpl->doc = xmlNewDoc(BAD_CAST "1.0");
+    if(encTmpl->doc == NULL) {
+        xmlSecXmlError("xmlNewDoc", NULL);
+        xmlSecEncTemplateDestroy(encTmpl);
+        return(NULL);
+    }
+    root = xmlDocCopyNode(tmpl, encTmpl->doc, 1);
+    if(root == NULL) {
+        xmlSecXmlError("xmlDocCopyNode", NULL);
+        xmlSecEncTemplateDestroy(encTmpl);
+        return(NULL);
+    }
+    xmlDocSetRootElement(encTmpl->doc, root);
+
+    ret = xmlSecEncTemplateKeyCtxInitialize(&keyCtx, encCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncTemplateKeyCtxInitialize", NULL);
+        xmlSecEncTemplateDestroy(encTmpl);
+        return(NULL);
+    }
+
+    /* find and write the recipients keys once */
+    for(cur = xmlSecEncTemplateFirstEncryptedKey(root); cur != NULL; cur = xmlSecEncTemplateFindEncryptedKey(cur->next)) {
+        keyInfoNode = xmlSecFindChild(cur, xmlSecNodeKeyInfo, xmlSecDSigNs);
+        if((keyInfoNode != NULL) && (xmlSecFindChild(keyInfoNode, xmlSecNodeAgreementMethod, xmlSecEncNs) != NULL)) {
+            xmlSecNotImplementedError("AgreementMethod in the prepared EncryptedKey");
+            goto error;
+        }
+
+        xmlSecEncCtxReset(&keyCtx);
+        ret = xmlSecEncCtxBinaryEncrypt(&keyCtx, cur, dummyKey, sizeof(dummyKey));
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecEncCtxBinaryEncrypt", NULL,
+                "recipient=" XMLSEC_SIZE_FMT, xmlSecPtrListGetSize(&(encTmpl->recipientKeys)));
+            goto error;
+        }
+        if(keyCtx.cipherValueNode != NULL) {
+            xmlNodeSetContent(keyCtx.cipherValueNode, NULL);
+        }
+
+        xmlSecAssert2(keyCtx.encKey != NULL, NULL);
+        ret = xmlSecPtrListAdd(&(encTmpl->recipientKeys), keyCtx.encKey);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecPtrListAdd", NULL);
+            goto error;
+        }
+        keyCtx.encKey = NULL; /* owned by the template now */
+    }
+    xmlSecEncCtxFinalize(&keyCtx);
+    return(encTmpl);
+
+error:
+    xmlSecEncCtxFinalize(&keyCtx);
+    xmlSecEncTemplateDestroy(encTmpl);
+    return(NULL);
+}
+
+/**
+ * xmlSecEncTemplateDestroy:
+ * @encTmpl:            the pointer to encryption template.
+ *
+ * Destroys the encryption template.
+ */
+void
+xmlSecEncTemplateDestroy(xmlSecEncTemplatePtr encTmpl) {
+    xmlSecAssert(encTmpl != NULL);
+
+    if(encTmpl->doc != NULL) {
+        xmlFreeDoc(encTmpl->doc);
+    }
+    xmlSecPtrListFinalize(&(encTmpl->recipientKeys));
+    memset(encTmpl, 0, sizeof(xmlSecEncTemplate));
+    xmlFree(encTmpl);
+}
+
+/**
+ * xmlSecEncTemplateGetRecipientsSize:
+ * @encTmpl:            the pointer to encryption template.
+ *
+ * Gets the number of the prepared &lt;enc:EncryptedKey/&gt; nodes.
+ *
+ * Returns: the number of the recipients.
+ */
+xmlSecSize
+xmlSecEncTemplateGetRecipientsSize(xmlSecEncTemplatePtr encTmpl) {
+    xmlSecAssert2(encTmpl != NULL, 0);
+
+    return(xmlSecPtrListGetSize(&(encTmpl->recipientKeys)));
+}
+
+/* creates the template instance in @doc and transports the session key to the recipients */
+static xmlNodePtr
+xmlSecEncTemplateInstantiate(xmlSecEncTemplatePtr encTmpl, xmlSecEncCtxPtr encCtx, xmlDocPtr doc) {
+    xmlSecEncCtx keyCtx;
+    xmlSecKeyInfoCtx keyInfoCtx;
+    xmlSecByte* keyBuf = NULL;
+    xmlSecSize keySize = 0;
+    xmlSecKeyPtr recipientKey;
+    xmlNodePtr res, cur;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(encTmpl != NULL, NULL);
+    xmlSecAssert2(encTmpl->doc != NULL, NULL);
+    xmlSecAssert2(encCtx != NULL, NULL);
+    xmlSecAssert2(encCtx->encKey != NULL, NULL);
+    xmlSecAssert2(doc != NULL, NULL);
+
+    res = xmlDocCopyNode(xmlDocGetRootElement(encTmpl->doc), doc, 1);
+    if(res == NULL) {
+        xmlSecXmlError("xmlDocCopyNode", NULL);
+        return(NULL);
+    }
+    if(xmlSecPtrListGetSize(&(encTmpl->recipientKeys)) <= 0) {
+        return(res);
+    }
+
+    /* dump the session key to a binary buffer */
+    ret = xmlSecKeyInfoCtxInitialize(&keyInfoCtx, NULL);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoCtxInitialize", NULL);
+        xmlFreeNode(res);
+        return(NULL);
+    }
+    keyInfoCtx.mode = xmlSecKeyInfoModeWrite;
+    keyInfoCtx.keyReq.keyType = xmlSecKeyDataTypeAny;
+    ret = xmlSecKeyDataBinWrite(encCtx->encKey->value->id, encCtx->encKey, &keyBuf, &keySize, &keyInfoCtx);
+    xmlSecKeyInfoCtxFinalize(&keyInfoCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyDataBinWrite", NULL);
+        xmlFreeNode(res);
+        return(NULL);
+    }
+
+    ret = xmlSecEncTemplateKeyCtxInitialize(&keyCtx, encCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncTemplateKeyCtxInitialize", NULL);
+        memset(keyBuf, 0, keySize);
+        xmlFree(keyBuf);
+        xmlFreeNode(res);
+        return(NULL);
+    }
+
+    /* the recipients keys and &lt;dsig:KeyInfo/&gt; nodes are ready, only wrap the key */
+    for(cur = xmlSecEncTemplateFirstEncryptedKey(res), ii = 0; cur != NULL; cur = xmlSecEncTemplateFindEncryptedKey(cur->next), ++ii) {
+        recipientKey = (xmlSecKeyPtr)xmlSecPtrListGetItem(&(encTmpl->recipientKeys), ii);
+        if(recipientKey == NULL) {
+            xmlSecInternalError2("xmlSecPtrListGetItem", NULL, "recipient=" XMLSEC_SIZE_FMT, ii);
+            goto error;
+        }
+
+        xmlSecEncCtxReset(&keyCtx);
+        keyCtx.flags |= XMLSEC_ENC_KEEP_KEYINFO;
+        keyCtx.encKey = xmlSecKeyDuplicate(recipientKey);
+        if(keyCtx.encKey == NULL) {
+            xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+            goto error;
+        }
+        ret = xmlSecEncCtxBinaryEncrypt(&keyCtx, cur, keyBuf, keySize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecEncCtxBinaryEncrypt", NULL, "recipient=" XMLSEC_SIZE_FMT, ii);
+            goto error;
+        }
+    }
+    xmlSecEncCtxFinalize(&keyCtx);
+
+    memset(keyBuf, 0, keySize);
+    xmlFree(keyBuf);
+    return(res);
+
+error:
+    xmlSecEncCtxFinalize(&keyCtx);
+    memset(keyBuf, 0, keySize);
+    xmlFree(keyBuf);
+    xmlFreeNode(res);
+    return(NULL);
+}
+
+/**
+ * xmlSecEncTemplateBinaryEncrypt:
+ * @encTmpl:            the pointer to encryption template.
+ * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
+ * @doc:                the pointer to the document for the result.
+ * @data:               the pointer for binary buffer.
+ * @dataSize:           the @data buffer size.
+ *
+ * Creates new &lt;enc:EncryptedData/&gt; node in @doc from the template and
+ * encrypts @data with the session key #xmlSecEncCtx.encKey (which must be set
+ * by the caller, e.g. with #xmlSecKeyGenerate). The session key is encrypted
+ * for each prepared recipient. The application is responsible for inserting
+ * the returned node in the XML document.
+ *
+ * Returns: the pointer to newly created &lt;enc:EncryptedData/&gt; node or
+ * NULL if an error occurs.
+ */
+xmlNodePtr
+xmlSecEncTemplateBinaryEncrypt(xmlSecEncTemplatePtr encTmpl, xmlSecEncCtxPtr encCtx, xmlDocPtr doc,
+                               const xmlSecByte* data, xmlSecSize dataSize) {
+    unsigned int flags;
+    xmlNodePtr res;
+    int ret;
+
+    xmlSecAssert2(encTmpl != NULL, NULL);
+    xmlSecAssert2(encCtx != NULL, NULL);
+    xmlSecAssert2(encCtx->encKey != NULL, NULL);
+    xmlSecAssert2(doc != NULL, NULL);
+    xmlSecAssert2(data != NULL, NULL);
+
+    res = xmlSecEncTemplateInstantiate(encTmpl, encCtx, doc);
+    if(res == NULL) {
+        xmlSecInternalError("xmlSecEncTemplateInstantiate", NULL);
+        return(NULL);
+    }
+
+    flags = encCtx->flags;
+    encCtx->flags |= XMLSEC_ENC_KEEP_KEYINFO;
+    ret = xmlSecEncCtxBinaryEncrypt(encCtx, res, data, dataSize);
+    encCtx->flags = flags;
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxBinaryEncrypt", NULL);
+        xmlFreeNode(res);
+        return(NULL);
+    }
+    return(res);
+}
+
+/**
+ * xmlSecEncTemplateXmlEncrypt:
+ * @encTmpl:            the pointer to encryption template.
+ * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
+ * @node:               the pointer to node for encryption.
+ *
+ * Creates new &lt;enc:EncryptedData/&gt; node from the template, encrypts
+ * @node with the session key #xmlSecEncCtx.encKey (which must be set by the
+ * caller, e.g. with #xmlSecKeyGenerate) and replaces @node (or its content)
+ * with the result. The session key is encrypted for each prepared recipient.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecEncTemplateXmlEncrypt(xmlSecEncTemplatePtr encTmpl, xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+    unsigned int flags;
+    xmlNodePtr tmpl;
+    int ret;
+
+    xmlSecAssert2(encTmpl != NULL, -1);
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->encKey != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->doc != NULL, -1);
+
+    /* the session key is transported first so the document is not changed on error */
+    tmpl = xmlSecEncTemplateInstantiate(encTmpl, encCtx, node->doc);
+    if(tmpl == NULL) {
+        xmlSecInternalError("xmlSecEncTemplateInstantiate", NULL);
+        return(-1);
+    }
+
+    flags = encCtx->flags;
+    encCtx->flags |= XMLSEC_ENC_KEEP_KEYINFO;
+    ret = xmlSecEncCtxXmlEncrypt(encCtx, tmpl, node);
+    encCtx->flags = flags;
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxXmlEncrypt", NULL);
+        if(tmpl->parent == NULL) {
+            xmlFreeNode(tmpl);
+        }
+        return(-1);
+    }
+    return(0);
+}
+
 /**
  * xmlSecEncCtxCopyUserPref:
  * @dst:                the pointer to destination context.
@@ -258,6 +850,8 @@ xmlSecEncCtxCopyUserPref(xmlSecEncCtxPtr dst, xmlSecEncCtxPtr src) {
     dst->flags2         = src->flags2;
     dst->defEncMethodId = src->defEncMethodId;
     dst->mode           = src->mode;
+    dst->memStats.limit = src->memStats.limit;
+    dst->maxDecompressedSize = src->maxDecompressedSize;
 
     ret = xmlSecTransformCtxCopyUserPref(&(dst->transformCtx), &(src->transformCtx));
     if(ret < 0) {
@@ -294,6 +888,9 @@ xmlSecEncCtxCopyUserPref(xmlSecEncCtxPtr dst, xmlSecEncCtxPtr src) {
 int
 xmlSecEncCtxBinaryEncrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl,
                           const xmlSecByte* data, xmlSecSize dataSize) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecStatsSpan span;
     int ret;
 
     xmlSecAssert2(encCtx != NULL, -1);
@@ -301,21 +898,48 @@ xmlSecEncCtxBinaryEncrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl,
     xmlSecAssert2(tmpl != NULL, -1);
     xmlSecAssert2(data != NULL, -1);
 
-    /* initialize context and add ID atributes to the list of known ids */
-    encCtx->operation = xmlSecTransformOperationEncrypt;
-    xmlSecAddIDs(tmpl->doc, tmpl, xmlSecEncIds);
-
-    /* read the template and set encryption method, key, etc. */
-    ret = xmlSecEncCtxEncDataNodeRead(encCtx, tmpl);
+    xmlSecStatsOpStart(xmlSecStatsOpEncEncrypt, &span);
+    prevMemStats = xmlSecMemStatsAttach(xmlSecEncCtxGetMemStats(encCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecEncCtxGetSettings(encCtx));
+    ret = xmlSecEncCtxBinaryEncryptInternal(encCtx, tmpl, data, dataSize);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecEncCtxEncDataNodeRead", NULL);
-        return(-1);
+        xmlSecEncCtxMarkIfDeadlineExceeded(encCtx);
     }
-
-    ret = xmlSecTransformCtxBinaryExecute(&(encCtx->transformCtx), data, dataSize);
+    xmlSecStatsOpEnd(&span, (ret < 0) ? 1 : 0);
     if(ret < 0) {
-        xmlSecInternalError2("xmlSecTransformCtxBinaryExecute", NULL,
-                             "dataSize=" XMLSEC_SIZE_FMT,  dataSize);
+        xmlSecInternalError("xmlSecEncCtxBinaryEncryptInternal", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecEncCtxBinaryEncryptInternal(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl,
+                                  const xmlSecByte* data, xmlSecSize dataSize) {
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->result == NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(data != NULL, -1);
+
+    /* initialize context and add ID atributes to the list of known ids */
+    encCtx->operation = xmlSecTransformOperationEncrypt;
+    xmlSecAddIDs(tmpl->doc, tmpl, xmlSecEncIds);
+
+    /* read the template and set encryption method, key, etc. */
+    ret = xmlSecEncCtxEncDataNodeRead(encCtx, tmpl);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxEncDataNodeRead", NULL);
+        return(-1);
+    }
+
+    ret = xmlSecTransformCtxBinaryExecute(&(encCtx->transformCtx), data, dataSize);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecTransformCtxBinaryExecute", NULL,
+                             "dataSize=" XMLSEC_SIZE_FMT,  dataSize);
         return(-1);
     }
 
@@ -343,6 +967,36 @@ xmlSecEncCtxBinaryEncrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl,
  */
 int
 xmlSecEncCtxXmlEncrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, xmlNodePtr node) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecStatsSpan span;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->result == NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->doc != NULL, -1);
+
+    xmlSecStatsOpStart(xmlSecStatsOpEncEncrypt, &span);
+    prevMemStats = xmlSecMemStatsAttach(xmlSecEncCtxGetMemStats(encCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecEncCtxGetSettings(encCtx));
+    ret = xmlSecEncCtxXmlEncryptInternal(encCtx, tmpl, node);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecEncCtxMarkIfDeadlineExceeded(encCtx);
+    }
+    xmlSecStatsOpEnd(&span, (ret < 0) ? 1 : 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxXmlEncryptInternal", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecEncCtxXmlEncryptInternal(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, xmlNodePtr node) {
     xmlOutputBufferPtr output;
     int ret;
 
@@ -459,6 +1113,121 @@ xmlSecEncCtxXmlEncrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, xmlNodePtr node)
     return(0);
 }
 
+/**
+ * xmlSecEncCtxXmlEncryptMultiple:
+ * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
+ * @encKeyTmpl:         the pointer to &lt;enc:EncryptedKey/&gt; template node (optional).
+ * @tmpls:              the array of &lt;enc:EncryptedData/&gt; template nodes.
+ * @nodes:              the array of nodes for encryption.
+ * @nodesSize:          the size of @tmpls and @nodes arrays.
+ *
+ * Encrypts each of the @nodes according to the template with the same index in
+ * @tmpls using the same session key from encCtx->encKey (which must be set by
+ * the caller). The templates should reference the session key with
+ * &lt;dsig:KeyName/&gt; or &lt;dsig:RetrievalMethod/&gt; nodes instead of
+ * embedding &lt;enc:EncryptedKey/&gt; nodes. If @encKeyTmpl is not NULL then
+ * the session key is encrypted (once) according to this template. The
+ * &lt;enc:DataReference/&gt; nodes for the templates that have Id attribute
+ * are added to @encKeyTmpl unless it already has &lt;enc:ReferenceList/&gt;
+ * node.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecEncCtxXmlEncryptMultiple(xmlSecEncCtxPtr encCtx, xmlNodePtr encKeyTmpl,
+                               xmlNodePtr* tmpls, xmlNodePtr* nodes, xmlSecSize nodesSize) {
+    xmlSecEncCtx encDataCtx;
+    int addDataReferences = 0;
+    xmlSecSize ii;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->result == NULL, -1);
+    xmlSecAssert2(encCtx->encKey != NULL, -1);
+    xmlSecAssert2(tmpls != NULL, -1);
+    xmlSecAssert2(nodes != NULL, -1);
+    for(ii = 0; ii < nodesSize; ++ii) {
+        xmlSecAssert2(tmpls[ii] != NULL, -1);
+        xmlSecAssert2(nodes[ii] != NULL, -1);
+    }
+
+    if((encKeyTmpl != NULL) && (xmlSecFindChild(encKeyTmpl, xmlSecNodeReferenceList, xmlSecEncNs) == NULL)) {
+        addDataReferences = 1;
+    }
+
+    ret = xmlSecEncCtxInitialize(&encDataCtx, encCtx->keyInfoReadCtx.keysMngr);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxInitialize", NULL);
+        return(-1);
+    }
+    ret = xmlSecEncCtxCopyUserPref(&encDataCtx, encCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxCopyUserPref", NULL);
+        goto done;
+    }
+
+    /* encrypt all the nodes with the same session key */
+    for(ii = 0; ii < nodesSize; ++ii) {
+        xmlChar* id;
+
+        xmlSecEncCtxReset(&encDataCtx);
+        encDataCtx.encKey = xmlSecKeyDuplicate(encCtx->encKey);
+        if(encDataCtx.encKey == NULL) {
+            xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+            goto done;
+        }
+
+        /* the template might be moved to the document (in place of the node) */
+        id = xmlGetProp(tmpls[ii], xmlSecAttrId);
+        ret = xmlSecEncCtxXmlEncrypt(&encDataCtx, tmpls[ii], nodes[ii]);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecEncCtxXmlEncrypt", NULL,
+                "index=" XMLSEC_SIZE_FMT, ii);
+            if(id != NULL) {
+                xmlFree(id);
+            }
+            goto done;
+        }
+
+        if((addDataReferences != 0) && (id != NULL)) {
+            xmlChar* uri;
+
+            uri = xmlStrncatNew(BAD_CAST "#", id, -1);
+            xmlFree(id);
+            if(uri == NULL) {
+                xmlSecXmlError("xmlStrncatNew", NULL);
+                goto done;
+            }
+            if(xmlSecTmplReferenceListAddDataReference(encKeyTmpl, uri) == NULL) {
+                xmlSecInternalError("xmlSecTmplReferenceListAddDataReference", NULL);
+                xmlFree(uri);
+                goto done;
+            }
+            xmlFree(uri);
+        } else if(id != NULL) {
+            xmlFree(id);
+        }
+    }
+
+    /* encrypt the session key once */
+    if(encKeyTmpl != NULL) {
+        ret = xmlSecKeyDataXmlWrite(xmlSecKeyDataEncryptedKeyId, encCtx->encKey,
+            encKeyTmpl, &(encCtx->keyInfoWriteCtx));
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecKeyDataXmlWrite(xmlSecKeyDataEncryptedKeyId)", NULL);
+            goto done;
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    xmlSecEncCtxFinalize(&encDataCtx);
+    return(res);
+}
+
 /**
  * xmlSecEncCtxUriEncrypt:
  * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
@@ -471,12 +1240,138 @@ xmlSecEncCtxXmlEncrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, xmlNodePtr node)
  */
 int
 xmlSecEncCtxUriEncrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, const xmlChar *uri) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecStatsSpan span;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->result == NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(uri != NULL, -1);
+
+    xmlSecStatsOpStart(xmlSecStatsOpEncEncrypt, &span);
+    prevMemStats = xmlSecMemStatsAttach(xmlSecEncCtxGetMemStats(encCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecEncCtxGetSettings(encCtx));
+    ret = xmlSecEncCtxUriEncryptInternal(encCtx, tmpl, uri);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecEncCtxMarkIfDeadlineExceeded(encCtx);
+    }
+    xmlSecStatsOpEnd(&span, (ret < 0) ? 1 : 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxUriEncryptInternal", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecEncCtxUriEncryptInternal(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, const xmlChar *uri) {
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->result == NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(uri != NULL, -1);
+
+    /* initialize context and add ID atributes to the list of known ids */
+    encCtx->operation = xmlSecTransformOperationEncrypt;
+    xmlSecAddIDs(tmpl->doc, tmpl, xmlSecEncIds);
+
+    /* we need to add input uri transform first */
+    ret = xmlSecTransformCtxSetUri(&(encCtx->transformCtx), uri, tmpl);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecTransformCtxSetUri", NULL,
+                             "uri=%s", xmlSecErrorsSafeString(uri));
+        return(-1);
+    }
+
+    /* read the template and set encryption method, key, etc. */
+    ret = xmlSecEncCtxEncDataNodeRead(encCtx, tmpl);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxEncDataNodeRead", NULL);
+        return(-1);
+    }
+
+    /* encrypt the data */
+    ret = xmlSecTransformCtxExecute(&(encCtx->transformCtx), tmpl->doc);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxExecute", NULL);
+        return(-1);
+    }
+
+    encCtx->result = encCtx->transformCtx.result;
+    xmlSecAssert2(encCtx->result != NULL, -1);
+
+    ret = xmlSecEncCtxEncDataNodeWrite(encCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxEncDataNodeWrite", NULL);
+        return(-1);
+    }
+
+    return(0);
+}
+
+/**
+ * xmlSecEncCtxUriEncryptToOutput:
+ * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
+ * @tmpl:               the pointer to &lt;enc:EncryptedData/&gt; template node.
+ * @uri:                the URI.
+ * @output:             the output buffer.
+ *
+ * Encrypts data from @uri according to template @tmpl and writes the resulting
+ * &lt;enc:EncryptedData/&gt; node to @output. The encrypted data is written
+ * into the &lt;enc:CipherValue/&gt; node content as it is produced, i.e. the
+ * memory usage doesn't depend on the @uri data size. The template must have
+ * &lt;enc:CipherValue/&gt; node, the template itself is not updated with
+ * the encrypted data (but &lt;dsig:KeyInfo/&gt; node is). The namespaces in
+ * scope of @tmpl are declared on the &lt;enc:EncryptedData/&gt; start tag.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecEncCtxUriEncryptToOutput(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, const xmlChar *uri,
+                               xmlOutputBufferPtr output) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecStatsSpan span;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->result == NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(uri != NULL, -1);
+    xmlSecAssert2(output != NULL, -1);
+
+    xmlSecStatsOpStart(xmlSecStatsOpEncEncrypt, &span);
+    prevMemStats = xmlSecMemStatsAttach(xmlSecEncCtxGetMemStats(encCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecEncCtxGetSettings(encCtx));
+    ret = xmlSecEncCtxUriEncryptToOutputInternal(encCtx, tmpl, uri, output);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(ret < 0) {
+        xmlSecEncCtxMarkIfDeadlineExceeded(encCtx);
+    }
+    xmlSecStatsOpEnd(&span, (ret < 0) ? 1 : 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxUriEncryptToOutputInternal", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecEncCtxUriEncryptToOutputInternal(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, const xmlChar *uri,
+                                       xmlOutputBufferPtr output) {
     int ret;
 
     xmlSecAssert2(encCtx != NULL, -1);
     xmlSecAssert2(encCtx->result == NULL, -1);
     xmlSecAssert2(tmpl != NULL, -1);
     xmlSecAssert2(uri != NULL, -1);
+    xmlSecAssert2(output != NULL, -1);
 
     /* initialize context and add ID atributes to the list of known ids */
     encCtx->operation = xmlSecTransformOperationEncrypt;
@@ -490,141 +1385,1221 @@ xmlSecEncCtxUriEncrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr tmpl, const xmlChar *u
         return(-1);
     }
 
-    /* read the template and set encryption method, key, etc. */
-    ret = xmlSecEncCtxEncDataNodeRead(encCtx, tmpl);
+    /* read the template and set encryption method, key, etc. */
+    ret = xmlSecEncCtxEncDataNodeRead(encCtx, tmpl);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxEncDataNodeRead", NULL);
+        return(-1);
+    }
+    if(encCtx->cipherValueNode == NULL) {
+        xmlSecNodeNotFoundError("xmlSecEncCtxEncDataNodeRead", tmpl,
+            xmlSecNodeCipherValue, NULL);
+        return(-1);
+    }
+    xmlSecAssert2(encCtx->encKey != NULL, -1);
+
+    /* update &lt;enc:KeyInfo/&gt; node before it is written out */
+    ret = xmlSecEncCtxKeyInfoNodeWrite(encCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxKeyInfoNodeWrite", NULL);
+        return(-1);
+    }
+
+    /* write everything before the &lt;enc:CipherValue/&gt; node content */
+    ret = xmlSecEncCtxOutputWriteStart(output, tmpl, encCtx->cipherValueNode);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxOutputWriteStart", NULL);
+        return(-1);
+    }
+
+    /* encrypt the data directly to the output */
+    ret = xmlSecEncCtxAppendSink(encCtx, xmlSecEncCtxOutputWrite, output);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxAppendSink", NULL);
+        return(-1);
+    }
+    ret = xmlSecTransformCtxExecute(&(encCtx->transformCtx), tmpl->doc);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxExecute", NULL);
+        return(-1);
+    }
+
+    encCtx->result = encCtx->transformCtx.result;
+    xmlSecAssert2(encCtx->result != NULL, -1);
+
+    /* write everything after the &lt;enc:CipherValue/&gt; node content */
+    ret = xmlSecEncCtxOutputWriteEnd(output, tmpl, encCtx->cipherValueNode);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxOutputWriteEnd", NULL);
+        return(-1);
+    }
+
+    ret = xmlOutputBufferFlush(output);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferFlush", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecEncCtxOutputWrite(void* sinkCtx, const xmlSecByte* data, xmlSecSize dataSize) {
+    xmlOutputBufferPtr output = (xmlOutputBufferPtr)sinkCtx;
+    int dataLen;
+    int ret;
+
+    xmlSecAssert2(output != NULL, -1);
+    xmlSecAssert2(data != NULL, -1);
+
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(dataSize, dataLen, return(-1), NULL);
+    ret = xmlOutputBufferWrite(output, dataLen, (const char*)data);
+    if(ret < 0) {
+        xmlSecXmlError2("xmlOutputBufferWrite", NULL, "size=%d", dataLen);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecEncCtxOutputWriteNs(xmlOutputBufferPtr output, xmlNsPtr ns) {
+    xmlChar* href;
+
+    xmlSecAssert2(output != NULL, -1);
+    xmlSecAssert2(ns != NULL, -1);
+
+    href = xmlEncodeSpecialChars(NULL, (ns->href != NULL) ? ns->href : BAD_CAST "");
+    if(href == NULL) {
+        xmlSecXmlError("xmlEncodeSpecialChars", NULL);
+        return(-1);
+    }
+
+    xmlOutputBufferWriteString(output, " xmlns");
+    if(ns->prefix != NULL) {
+        xmlOutputBufferWriteString(output, ":");
+        xmlOutputBufferWriteString(output, (const char*)ns->prefix);
+    }
+    xmlOutputBufferWriteString(output, "=\"");
+    xmlOutputBufferWriteString(output, (const char*)href);
+    xmlOutputBufferWriteString(output, "\"");
+
+    xmlFree(href);
+    return(0);
+}
+
+static void
+xmlSecEncCtxOutputWriteName(xmlOutputBufferPtr output, xmlNodePtr node) {
+    xmlSecAssert(output != NULL);
+    xmlSecAssert(node != NULL);
+
+    if((node->ns != NULL) && (node->ns->prefix != NULL)) {
+        xmlOutputBufferWriteString(output, (const char*)node->ns->prefix);
+        xmlOutputBufferWriteString(output, ":");
+    }
+    xmlOutputBufferWriteString(output, (const char*)node->name);
+}
+
+/* returns the child of @node that is @target or its ancestor */
+static xmlNodePtr
+xmlSecEncCtxOutputGetPathChild(xmlNodePtr node, xmlNodePtr target) {
+    xmlNodePtr cur;
+
+    xmlSecAssert2(node != NULL, NULL);
+    xmlSecAssert2(target != NULL, NULL);
+
+    cur = target;
+    while((cur != NULL) && (cur->parent != node)) {
+        cur = cur->parent;
+    }
+    return(cur);
+}
+
+/* writes the start tags from @tmpl to @target and all the nodes before them */
+static int
+xmlSecEncCtxOutputWriteStart(xmlOutputBufferPtr output, xmlNodePtr tmpl, xmlNodePtr target) {
+    xmlNodePtr node;
+    xmlNodePtr cur;
+    xmlNodePtr next = NULL;
+    xmlNsPtr ns;
+    xmlAttrPtr attr;
+    int ret;
+
+    xmlSecAssert2(output != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(target != NULL, -1);
+
+    for(node = tmpl; node != NULL; node = next) {
+        /* start tag: all the namespaces in scope go to the top element */
+        xmlOutputBufferWriteString(output, "<");
+        xmlSecEncCtxOutputWriteName(output, node);
+        if(node == tmpl) {
+            xmlNsPtr* nsList;
+            xmlSecSize ii;
+
+            nsList = xmlGetNsList(node->doc, node);
+            if(nsList != NULL) {
+                for(ii = 0, ret = 0; (nsList[ii] != NULL) && (ret >= 0); ++ii) {
+                    ret = xmlSecEncCtxOutputWriteNs(output, nsList[ii]);
+                }
+                xmlFree(nsList);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecEncCtxOutputWriteNs", NULL);
+                    return(-1);
+                }
+            }
+        } else {
+            for(ns = node->nsDef; ns != NULL; ns = ns->next) {
+                ret = xmlSecEncCtxOutputWriteNs(output, ns);
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecEncCtxOutputWriteNs", NULL);
+                    return(-1);
+                }
+            }
+        }
+        for(attr = node->properties; attr != NULL; attr = attr->next) {
+            xmlNodeDumpOutput(output, node->doc, (xmlNodePtr)attr, 0, 0, NULL);
+        }
+        xmlOutputBufferWriteString(output, ">");
+        if(node == target) {
+            break;
+        }
+
+        /* children before the one on the path to the target */
+        next = xmlSecEncCtxOutputGetPathChild(node, target);
+        xmlSecAssert2(next != NULL, -1);
+        for(cur = node->children; cur != next; cur = cur->next) {
+            xmlNodeDumpOutput(output, node->doc, cur, 0, 0, NULL);
+        }
+    }
+
+    if(output->error != 0) {
+        xmlSecXmlError2("xmlOutputBufferWrite", NULL, "error=%d", output->error);
+        return(-1);
+    }
+    return(0);
+}
+
+/* writes the end tags from @target to @tmpl and all the nodes after them */
+static int
+xmlSecEncCtxOutputWriteEnd(xmlOutputBufferPtr output, xmlNodePtr tmpl, xmlNodePtr target) {
+    xmlNodePtr node;
+    xmlNodePtr cur;
+
+    xmlSecAssert2(output != NULL, -1);
+    xmlSecAssert2(tmpl != NULL, -1);
+    xmlSecAssert2(target != NULL, -1);
+
+    for(node = target; node != NULL; node = node->parent) {
+        /* children after the one on the path to the target */
+        if(node != target) {
+            cur = xmlSecEncCtxOutputGetPathChild(node, target);
+            xmlSecAssert2(cur != NULL, -1);
+            for(cur = cur->next; cur != NULL; cur = cur->next) {
+                xmlNodeDumpOutput(output, node->doc, cur, 0, 0, NULL);
+            }
+        }
+
+        xmlOutputBufferWriteString(output, "</");
+        xmlSecEncCtxOutputWriteName(output, node);
+        xmlOutputBufferWriteString(output, ">");
+        if(node == tmpl) {
+            break;
+        }
+    }
+    xmlSecAssert2(node != NULL, -1);
+
+    if(output->error != 0) {
+        xmlSecXmlError2("xmlOutputBufferWrite", NULL, "error=%d", output->error);
+        return(-1);
+    }
+    return(0);
+}
+
+/**************************************************************************
+ *
+ * Decryption sink transform: passes the data to the callback.
+ *
+ * xmlSecTransform + xmlSecEncSinkCtx
+ *
+ *************************************************************************/
+typedef struct _xmlSecEncSinkCtx                xmlSecEncSinkCtx, *xmlSecEncSinkCtxPtr;
+struct _xmlSecEncSinkCtx {
+    xmlSecEncCtxDecryptSinkCallback     sink;
+    void*                               sinkCtx;
+};
+
+XMLSEC_TRANSFORM_DECLARE(EncSink, xmlSecEncSinkCtx)
+#define xmlSecEncSinkSize XMLSEC_TRANSFORM_SIZE(EncSink)
+
+static int              xmlSecEncSinkInitialize                 (xmlSecTransformPtr transform);
+static int              xmlSecEncSinkExecute                    (xmlSecTransformPtr transform,
+                                                                 int last,
+                                                                 xmlSecTransformCtxPtr transformCtx);
+
+static xmlSecTransformKlass xmlSecEncSinkKlass = {
+    /* klass/object sizes */
+    sizeof(xmlSecTransformKlass),               /* xmlSecSize klassSize */
+    xmlSecEncSinkSize,                          /* xmlSecSize objSize */
+
+    BAD_CAST "enc-sink",                        /* const xmlChar* name; */
+    NULL,                                       /* const xmlChar* href; */
+    0,                                          /* xmlSecAlgorithmUsage usage; */
+
+    xmlSecEncSinkInitialize,                    /* xmlSecTransformInitializeMethod initialize; */
+    NULL,                                       /* xmlSecTransformFinalizeMethod finalize; */
+    NULL,                                       /* xmlSecTransformNodeReadMethod readNode; */
+    NULL,                                       /* xmlSecTransformNodeWriteMethod writeNode; */
+    NULL,                                       /* xmlSecTransformSetKeyReqMethod setKeyReq; */
+    NULL,                                       /* xmlSecTransformSetKeyMethod setKey; */
+    NULL,                                       /* xmlSecTransformValidateMethod validate; */
+    xmlSecTransformDefaultGetDataType,          /* xmlSecTransformGetDataTypeMethod getDataType; */
+    xmlSecTransformDefaultPushBin,              /* xmlSecTransformPushBinMethod pushBin; */
+    xmlSecTransformDefaultPopBin,               /* xmlSecTransformPopBinMethod popBin; */
+    NULL,                                       /* xmlSecTransformPushXmlMethod pushXml; */
+    NULL,                                       /* xmlSecTransformPopXmlMethod popXml; */
+    xmlSecEncSinkExecute,                       /* xmlSecTransformExecuteMethod execute; */
+
+    NULL,                                       /* void* reserved0; */
+    NULL,                                       /* void* reserved1; */
+};
+
+#define xmlSecEncSinkId (&xmlSecEncSinkKlass)
+
+static int
+xmlSecEncSinkInitialize(xmlSecTransformPtr transform) {
+    xmlSecEncSinkCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecEncSinkId), -1);
+
+    ctx = xmlSecEncSinkGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    memset(ctx, 0, sizeof(xmlSecEncSinkCtx));
+    return(0);
+}
+
+static int
+xmlSecEncSinkSet(xmlSecTransformPtr transform, xmlSecEncCtxDecryptSinkCallback sink, void* sinkCtx) {
+    xmlSecEncSinkCtxPtr ctx;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecEncSinkId), -1);
+    xmlSecAssert2(sink != NULL, -1);
+
+    ctx = xmlSecEncSinkGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+
+    ctx->sink = sink;
+    ctx->sinkCtx = sinkCtx;
+    return(0);
+}
+
+static int
+xmlSecEncSinkExecute(xmlSecTransformPtr transform, int last, xmlSecTransformCtxPtr transformCtx) {
+    xmlSecEncSinkCtxPtr ctx;
+    xmlSecBufferPtr in;
+    xmlSecSize inSize;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecEncSinkId), -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    ctx = xmlSecEncSinkGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->sink != NULL, -1);
+
+    in = &(transform->inBuf);
+    inSize = xmlSecBufferGetSize(in);
+
+    if(transform->status == xmlSecTransformStatusNone) {
+        transform->status = xmlSecTransformStatusWorking;
+    }
+
+    if(transform->status == xmlSecTransformStatusWorking) {
+        /* pass everything to the sink, nothing goes to the output */
+        if(inSize > 0) {
+            ret = (ctx->sink)(ctx->sinkCtx, xmlSecBufferGetData(in), inSize);
+            if(ret < 0) {
+                xmlSecInternalError2("sink", xmlSecTransformGetName(transform),
+                    "size=" XMLSEC_SIZE_FMT, inSize);
+                return(-1);
+            }
+
+            ret = xmlSecBufferRemoveHead(in, inSize);
+            if(ret < 0) {
+                xmlSecInternalError2("xmlSecBufferRemoveHead", xmlSecTransformGetName(transform),
+                    "size=" XMLSEC_SIZE_FMT, inSize);
+                return(-1);
+            }
+        }
+
+        if(last != 0) {
+            transform->status = xmlSecTransformStatusFinished;
+        }
+    } else if(transform->status == xmlSecTransformStatusFinished) {
+        /* the only way we can get here is if there is no input */
+        xmlSecAssert2(inSize == 0, -1);
+    } else {
+        xmlSecInvalidTransfromStatusError(transform);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecEncCtxAppendSink(xmlSecEncCtxPtr encCtx, xmlSecEncCtxDecryptSinkCallback sink, void* sinkCtx) {
+    xmlSecTransformPtr sinkTransform;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(sink != NULL, -1);
+
+    sinkTransform = xmlSecTransformCtxCreateAndAppend(&(encCtx->transformCtx), xmlSecEncSinkId);
+    if(sinkTransform == NULL) {
+        xmlSecInternalError("xmlSecTransformCtxCreateAndAppend(xmlSecEncSinkId)", NULL);
+        return(-1);
+    }
+    ret = xmlSecEncSinkSet(sinkTransform, sink, sinkCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncSinkSet", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/**************************************************************************
+ *
+ * Decrypted XML streaming parser: the decrypted data are pushed to
+ * the parser inside a wrapper element that declares all the namespaces
+ * in scope of the target node parent.
+ *
+ *************************************************************************/
+#define XMLSEC_ENC_STREAM_PARSER_WRAPPER_START   "<xmlsec-stream-wrapper"
+#define XMLSEC_ENC_STREAM_PARSER_WRAPPER_END     "</xmlsec-stream-wrapper>"
+
+struct _xmlSecEncStreamParser {
+    xmlParserCtxtPtr                    parserCtx;
+};
+
+static int
+xmlSecEncStreamParserPushString(xmlSecEncStreamParserPtr parser, const xmlChar* str, int terminate) {
+    int len;
+    int ret;
+
+    xmlSecAssert2(parser != NULL, -1);
+    xmlSecAssert2(parser->parserCtx != NULL, -1);
+    xmlSecAssert2(str != NULL, -1);
+
+    len = xmlStrlen(str);
+    ret = xmlParseChunk(parser->parserCtx, (const char*)str, len, terminate);
+    if(ret != 0) {
+        xmlSecXmlParserError2("xmlParseChunk", parser->parserCtx, NULL,
+            "size=%d", len);
+        return(-1);
+    }
+    return(0);
+}
+
+/* returns 1 if the decrypted data will be parsed on the fly, 0 if not (unsupported), or -1 on error */
+static int
+xmlSecEncStreamParserStart(xmlSecEncStreamParserPtr parser, xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+    xmlNsPtr* nsList;
+    int ret;
+
+    xmlSecAssert2(parser != NULL, -1);
+    xmlSecAssert2(parser->parserCtx == NULL, -1);
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* only the data that replaces the node is parsed */
+    if((encCtx->type == NULL) ||
+       (!xmlStrEqual(encCtx->type, xmlSecTypeEncElement) && !xmlStrEqual(encCtx->type, xmlSecTypeEncContent))
+    ) {
+        return(0);
+    }
+
+    /* the parsing context (entities, encoding) must be the same as for xmlParseInNodeContext() */
+    if((node->doc == NULL) || (node->parent == NULL) || (node->parent->type != XML_ELEMENT_NODE)) {
+        return(0);
+    }
+    if((node->doc->intSubset != NULL) || (node->doc->extSubset != NULL)) {
+        return(0);
+    }
+    if((node->doc->encoding != NULL) && (xmlStrcasecmp(node->doc->encoding, BAD_CAST "UTF-8") != 0)) {
+        return(0);
+    }
+
+    parser->parserCtx = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, NULL);
+    if(parser->parserCtx == NULL) {
+        xmlSecXmlError("xmlCreatePushParserCtxt", NULL);
+        return(-1);
+    }
+    xmlSecParsePrepareCtxt(parser->parserCtx);
+
+    /* start the wrapper element with all the namespaces in the node's scope */
+    ret = xmlSecEncStreamParserPushString(parser, BAD_CAST XMLSEC_ENC_STREAM_PARSER_WRAPPER_START, 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncStreamParserPushString", NULL);
+        return(-1);
+    }
+
+    nsList = xmlGetNsList(node->doc, node->parent);
+    if(nsList != NULL) {
+        xmlChar* href;
+        xmlSecSize ii;
+
+        for(ii = 0; nsList[ii] != NULL; ++ii) {
+            if(nsList[ii]->href == NULL) {
+                continue;
+            }
+            href = xmlEncodeSpecialChars(NULL, nsList[ii]->href);
+            if(href == NULL) {
+                xmlSecXmlError("xmlEncodeSpecialChars", NULL);
+                xmlFree(nsList);
+                return(-1);
+            }
+
+            ret = xmlSecEncStreamParserPushString(parser, BAD_CAST " xmlns", 0);
+            if((ret >= 0) && (nsList[ii]->prefix != NULL)) {
+                ret = xmlSecEncStreamParserPushString(parser, BAD_CAST ":", 0);
+                if(ret >= 0) {
+                    ret = xmlSecEncStreamParserPushString(parser, nsList[ii]->prefix, 0);
+                }
+            }
+            if(ret >= 0) {
+                ret = xmlSecEncStreamParserPushString(parser, BAD_CAST "=\"", 0);
+            }
+            if(ret >= 0) {
+                ret = xmlSecEncStreamParserPushString(parser, href, 0);
+            }
+            if(ret >= 0) {
+                ret = xmlSecEncStreamParserPushString(parser, BAD_CAST "\"", 0);
+            }
+            xmlFree(href);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecEncStreamParserPushString", NULL);
+                xmlFree(nsList);
+                return(-1);
+            }
+        }
+        xmlFree(nsList);
+    }
+
+    ret = xmlSecEncStreamParserPushString(parser, BAD_CAST ">", 0);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncStreamParserPushString", NULL);
+        return(-1);
+    }
+
+    /* ready */
+    return(1);
+}
+
+static int
+xmlSecEncStreamParserWrite(void* sinkCtx, const xmlSecByte* data, xmlSecSize dataSize) {
+    xmlSecEncStreamParserPtr parser = (xmlSecEncStreamParserPtr)sinkCtx;
+    int dataLen;
+    int ret;
+
+    xmlSecAssert2(parser != NULL, -1);
+    xmlSecAssert2(parser->parserCtx != NULL, -1);
+    xmlSecAssert2(data != NULL, -1);
+
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(dataSize, dataLen, return(-1), NULL);
+    ret = xmlParseChunk(parser->parserCtx, (const char*)data, dataLen, 0);
+    if(ret != 0) {
+        xmlSecXmlParserError2("xmlParseChunk", parser->parserCtx, NULL,
+            "size=%d", dataLen);
+        return(-1);
+    }
+    return(0);
+}
+
+static int
+xmlSecEncStreamParserFinish(xmlSecEncStreamParserPtr parser, xmlNodePtr node, xmlNodePtr *replaced) {
+    xmlDocPtr doc;
+    xmlNodePtr root;
+    xmlNodePtr cur;
+    xmlNodePtr next;
+    int ret;
+
+    xmlSecAssert2(parser != NULL, -1);
+    xmlSecAssert2(parser->parserCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->parent != NULL, -1);
+
+    ret = xmlSecEncStreamParserPushString(parser, BAD_CAST XMLSEC_ENC_STREAM_PARSER_WRAPPER_END, 1);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncStreamParserPushString", NULL);
+        return(-1);
+    }
+
+    doc = parser->parserCtx->myDoc;
+    if((doc == NULL) || (!parser->parserCtx->wellFormed)) {
+        xmlSecXmlParserError("xmlParseChunk", parser->parserCtx, NULL);
+        return(-1);
+    }
+    root = xmlDocGetRootElement(doc);
+    if(root == NULL) {
+        xmlSecInternalError("xmlDocGetRootElement", NULL);
+        return(-1);
+    }
+
+    xmlSecDocIndexInvalidate(node->doc);
+
+    /* move new nodes to the node's doc and fix namespaces pointing to the wrapper */
+    for(cur = root->children; cur != NULL; cur = next) {
+        next = cur->next;
+
+        xmlUnlinkNode(cur);
+        ret = xmlDOMWrapAdoptNode(NULL, doc, cur, node->doc, node->parent, 0);
+        if(ret != 0) {
+            xmlSecXmlError("xmlDOMWrapAdoptNode", NULL);
+            xmlFreeNode(cur);
+            return(-1);
+        }
+        xmlAddPrevSibling(node, cur);
+    }
+
+    /* remove old node */
+    xmlUnlinkNode(node);
+
+    /* return the old node if requested */
+    if(replaced != NULL) {
+        (*replaced) = node;
+    } else {
+        xmlFreeNode(node);
+    }
+
+    return(0);
+}
+
+static void
+xmlSecEncStreamParserFinalize(xmlSecEncStreamParserPtr parser) {
+    xmlSecAssert(parser != NULL);
+
+    if(parser->parserCtx != NULL) {
+        if(parser->parserCtx->myDoc != NULL) {
+            xmlFreeDoc(parser->parserCtx->myDoc);
+            parser->parserCtx->myDoc = NULL;
+        }
+        xmlFreeParserCtxt(parser->parserCtx);
+    }
+    memset(parser, 0, sizeof(xmlSecEncStreamParser));
+}
+
+/**
+ * xmlSecEncCtxDecrypt:
+ * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
+ * @node:               the pointer to &lt;enc:EncryptedData/&gt; node.
+ *
+ * Decrypts @node and if necessary replaces @node with decrypted data.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecEncCtxDecrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+    xmlSecSize record;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* the input document is saved before the node is replaced */
+    record = (node->doc != NULL) ? xmlSecRecorderAddDoc(node->doc) : 0;
+    ret = xmlSecEncCtxDecryptAndReplace(encCtx, node);
+    if(record > 0) {
+        xmlSecRecorderAddOp(record, "decrypt", encCtx->flags, encCtx->flags2,
+            (encCtx->encKey != NULL) ? xmlSecKeyGetName(encCtx->encKey) : NULL,
+            (ret < 0) ? "error" : "ok");
+    }
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxDecryptAndReplace", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* decrypts @node and replaces it with the decrypted data if needed */
+static int
+xmlSecEncCtxDecryptAndReplace(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+    xmlSecBufferPtr buffer;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    /* decrypt and parse the result on the fly if requested */
+    if((encCtx->flags & XMLSEC_ENC_STREAM_DECRYPTED_XML) != 0) {
+        xmlSecEncStreamParser parser;
+
+        memset(&parser, 0, sizeof(parser));
+        buffer = xmlSecEncCtxDecryptInternal(encCtx, node, NULL, NULL, &parser);
+        if(buffer == NULL) {
+            xmlSecInternalError("xmlSecEncCtxDecryptInternal", NULL);
+            xmlSecEncStreamParserFinalize(&parser);
+            return(-1);
+        }
+
+        if(parser.parserCtx != NULL) {
+            ret = xmlSecEncStreamParserFinish(&parser, node,
+                ((encCtx->flags & XMLSEC_ENC_RETURN_REPLACED_NODE) != 0) ? &(encCtx->replacedNodeList) : NULL);
+            xmlSecEncStreamParserFinalize(&parser);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecEncStreamParserFinish",
+                                    xmlSecNodeGetName(node));
+                return(-1);
+            }
+            encCtx->resultReplaced = 1;
+            return(0);
+        }
+    } else {
+        buffer = xmlSecEncCtxDecryptToBuffer(encCtx, node);
+        if(buffer == NULL) {
+            xmlSecInternalError("xmlSecEncCtxDecryptToBuffer", NULL);
+            return(-1);
+        }
+    }
+
+    /* replace original node if requested */
+    if((encCtx->type != NULL) && xmlStrEqual(encCtx->type, xmlSecTypeEncElement)) {
+        /* check if we need to return the replaced node */
+        if((encCtx->flags & XMLSEC_ENC_RETURN_REPLACED_NODE) != 0) {
+                ret = xmlSecReplaceNodeBufferAndReturn(node, xmlSecBufferGetData(buffer),  xmlSecBufferGetSize(buffer), &(encCtx->replacedNodeList));
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecReplaceNodeBufferAndReturn",
+                                        xmlSecNodeGetName(node));
+                    return(-1);
+                }
+        } else {
+                ret = xmlSecReplaceNodeBuffer(node, xmlSecBufferGetData(buffer),  xmlSecBufferGetSize(buffer));
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecReplaceNodeBuffer",
+                                        xmlSecNodeGetName(node));
+                    return(-1);
+                }
+        }
+
+        encCtx->resultReplaced = 1;
+    } else if((encCtx->type != NULL) && xmlStrEqual(encCtx->type, xmlSecTypeEncContent)) {
+        /* replace the node with the buffer */
+
+        /* check if we need to return the replaced node */
+        if((encCtx->flags & XMLSEC_ENC_RETURN_REPLACED_NODE) != 0) {
+                ret = xmlSecReplaceNodeBufferAndReturn(node, xmlSecBufferGetData(buffer), xmlSecBufferGetSize(buffer), &(encCtx->replacedNodeList));
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecReplaceNodeBufferAndReturn",
+                                        xmlSecNodeGetName(node));
+                    return(-1);
+                }
+        } else {
+            ret = xmlSecReplaceNodeBuffer(node, xmlSecBufferGetData(buffer), xmlSecBufferGetSize(buffer));
+                if(ret < 0) {
+                    xmlSecInternalError("xmlSecReplaceNodeBuffer",
+                                        xmlSecNodeGetName(node));
+                    return(-1);
+                }
+        }
+        encCtx->resultReplaced = 1;
+    }
+
+    return(0);
+}
+
+/**
+ * xmlSecEncCtxDecryptToBuffer:
+ * @encCtx:             the pointer to encryption processing context.
+ * @node:               the pointer to &lt;enc:EncryptedData/&gt; node.
+ *
+ * Decrypts @node data to the result.
+ *
+ * Returns: a buffer with key on success or NULL if an error occurs.
+ */
+xmlSecBufferPtr
+xmlSecEncCtxDecryptToBuffer(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+    xmlSecAssert2(encCtx != NULL, NULL);
+    xmlSecAssert2(node != NULL, NULL);
+
+    return(xmlSecEncCtxDecryptInternal(encCtx, node, NULL, NULL, NULL));
+}
+
+/**
+ * xmlSecEncCtxDecryptToSink:
+ * @encCtx:             the pointer to encryption processing context.
+ * @node:               the pointer to &lt;enc:EncryptedData/&gt; node.
+ * @sink:               the callback to receive the decrypted data.
+ * @sinkCtx:            the context for @sink callback.
+ *
+ * Decrypts @node data and passes it to @sink in chunks (of at most
+ * binaryChunkSize bytes of the transforms context) as soon as the data is
+ * produced by the transforms chain, the decrypted data is not stored in
+ * the context and @node is not replaced. If the function fails then @sink
+ * might have already received some data (e.g. for the AEAD ciphers the
+ * data may come before the authentication tag is checked), the caller
+ * must discard it.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecEncCtxDecryptToSink(xmlSecEncCtxPtr encCtx, xmlNodePtr node,
+                          xmlSecEncCtxDecryptSinkCallback sink, void* sinkCtx) {
+    xmlSecBufferPtr buffer;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(sink != NULL, -1);
+
+    buffer = xmlSecEncCtxDecryptInternal(encCtx, node, sink, sinkCtx, NULL);
+    if(buffer == NULL) {
+        xmlSecInternalError("xmlSecEncCtxDecryptInternal", NULL);
+        return(-1);
+    }
+    return(0);
+}
+
+/* counts (if @uris is NULL) or stores the external &lt;enc:CipherReference/&gt; URIs in the @cur subtree */
+static int
+xmlSecEncCtxAddCipherReferenceUris(xmlSecEncCtxPtr encCtx, xmlNodePtr cur, xmlChar** uris,
+                                   xmlSecSize maxSize, xmlSecSize* size) {
+    xmlChar* uri;
+    xmlChar* xptr;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(size != NULL, -1);
+
+    if(xmlSecCheckNodeName(cur, xmlSecNodeCipherReference, xmlSecEncNs)) {
+        uri = xmlGetProp(cur, xmlSecAttrURI);
+        if(uri == NULL) {
+            return(0);
+        }
+        if((uri[0] == '\0') || (uri[0] == '#') ||
+           (xmlSecTransformUriTypeCheck(encCtx->transformCtx.enabledUris, uri) != 1) ||
+           ((uris != NULL) && ((*size) >= maxSize)))
+        {
+            xmlFree(uri);
+            return(0);
+        }
+        if(uris == NULL) {
+            xmlFree(uri);
+            ++(*size);
+            return(0);
+        }
+
+        /* same as xmlSecTransformCtxSetUri(): the fragment is not part of the resource */
+        xptr = (xmlChar*)xmlStrchr(uri, '#');
+        if(xptr != NULL) {
+            (*xptr) = '\0';
+        }
+        uris[(*size)++] = uri;
+        return(0);
+    }
+    for(cur = cur->children; cur != NULL; cur = cur->next) {
+        if(cur->type == XML_ELEMENT_NODE) {
+            ret = xmlSecEncCtxAddCipherReferenceUris(encCtx, cur, uris, maxSize, size);
+            if(ret < 0) {
+                return(-1);
+            }
+        }
+    }
+    return(0);
+}
+
+/**
+ * xmlSecEncCtxSetDeadline:
+ * @encCtx:             the pointer to encryption processing context.
+ * @timeout:            the time budget in seconds from now or 0 for no deadline.
+ * @cancelFlag:         the optional pointer to the application flag or NULL.
+ *
+ * Sets the time budget for the next encryption or decryption with @encCtx
+ * (see #xmlSecTransformCtxSetDeadline): the transforms (including the nested
+ * &lt;enc:EncryptedKey/&gt; decryption) and the keys resolution fail once
+ * the @timeout expires or the @cancelFlag is set to a non-zero value. The
+ * failed operation has the #xmlSecEncFailureReasonDeadline failure reason.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecEncCtxSetDeadline(xmlSecEncCtxPtr encCtx, double timeout, volatile int* cancelFlag) {
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+
+    ret = xmlSecTransformCtxSetDeadline(&(encCtx->transformCtx), timeout, cancelFlag);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecTransformCtxSetDeadline", NULL);
+        return(-1);
+    }
+
+    /* the keys resolution checks the deadline in these contexts */
+    encCtx->keyInfoReadCtx.retrievalMethodCtx.deadline = encCtx->transformCtx.deadline;
+    encCtx->keyInfoReadCtx.retrievalMethodCtx.cancelFlag = cancelFlag;
+    encCtx->keyInfoReadCtx.keyInfoReferenceCtx.deadline = encCtx->transformCtx.deadline;
+    encCtx->keyInfoReadCtx.keyInfoReferenceCtx.cancelFlag = cancelFlag;
+    encCtx->keyInfoWriteCtx.retrievalMethodCtx.deadline = encCtx->transformCtx.deadline;
+    encCtx->keyInfoWriteCtx.retrievalMethodCtx.cancelFlag = cancelFlag;
+    encCtx->keyInfoWriteCtx.keyInfoReferenceCtx.deadline = encCtx->transformCtx.deadline;
+    encCtx->keyInfoWriteCtx.keyInfoReferenceCtx.cancelFlag = cancelFlag;
+    return(0);
+}
+
+/**
+ * xmlSecEncCtxPrefetchCipherReferences:
+ * @encCtx:             the pointer to encryption processing context.
+ * @node:               the pointer to the root node to search for &lt;enc:CipherReference/&gt; nodes.
+ *
+ * Passes the external URIs of all the &lt;enc:CipherReference/&gt; nodes in
+ * the @node subtree (the encrypted data and the encrypted keys) that are
+ * allowed by encCtx->transformCtx.enabledUris to the I/O prefetch callback
+ * (see #xmlSecIORegisterPrefetchCallback) in one call. The application
+ * fetcher can start all the fetches concurrently while the references are
+ * still decrypted one by one (and streamed through the decryption chain).
+ * The #xmlSecEncCtxDecrypt function does it for the &lt;enc:EncryptedData/&gt;
+ * node unless the #XMLSEC_ENC_SKIP_PREFETCH flag is set, the applications
+ * that decrypt several nodes in one document can call this function once
+ * for the whole document. Nothing is done if the prefetch callback is not
+ * registered.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecEncCtxPrefetchCipherReferences(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+    xmlChar** uris = NULL;
+    xmlSecSize urisSize = 0;
+    xmlSecSize maxSize = 0;
+    xmlSecSize ii;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    if(xmlSecIOHasPrefetchCallback() == 0) {
+        return(0);
+    }
+
+    ret = xmlSecEncCtxAddCipherReferenceUris(encCtx, node, NULL, 0, &maxSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxAddCipherReferenceUris", NULL);
+        goto done;
+    }
+    if(maxSize == 0) {
+        res = 0;
+        goto done;
+    }
+
+    uris = (xmlChar**)xmlMalloc(sizeof(xmlChar*) * maxSize);
+    if(uris == NULL) {
+        xmlSecMallocError(sizeof(xmlChar*) * maxSize, NULL);
+        goto done;
+    }
+    ret = xmlSecEncCtxAddCipherReferenceUris(encCtx, node, uris, maxSize, &urisSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxAddCipherReferenceUris", NULL);
+        goto done;
+    }
+
+    ret = xmlSecIOPrefetch((const xmlChar**)uris, urisSize);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecIOPrefetch", NULL);
+        goto done;
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(uris != NULL) {
+        for(ii = 0; ii < urisSize; ++ii) {
+            xmlFree(uris[ii]);
+        }
+        xmlFree(uris);
+    }
+    return(res);
+}
+
+typedef struct _xmlSecEncBatchItem {
+    xmlNodePtr                  node;
+    xmlSecBufferPtr             result;
+    int                         failed;
+} xmlSecEncBatchItem, *xmlSecEncBatchItemPtr;
+
+typedef struct _xmlSecEncBatch {
+    xmlSecEncCtxPtr             encCtx;
+    xmlSecEncBatchItemPtr       items;
+    xmlSecSize                  size;
+    xmlSecSize                  workersNum;
+} xmlSecEncBatch, *xmlSecEncBatchPtr;
+
+static void
+xmlSecEncBatchWorker(void* taskCtx, xmlSecSize worker) {
+    xmlSecEncBatchPtr batch = (xmlSecEncBatchPtr)taskCtx;
+    xmlSecEncCtx encCtx;
+    xmlSecBufferPtr buffer;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert(batch != NULL);
+    xmlSecAssert(batch->encCtx != NULL);
+    xmlSecAssert(batch->workersNum > 0);
+    xmlSecAssert(worker < batch->workersNum);
+
+    ret = xmlSecEncCtxInitialize(&encCtx, batch->encCtx->keyInfoReadCtx.keysMngr);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecEncCtxEncDataNodeRead", NULL);
-        return(-1);
+        xmlSecInternalError("xmlSecEncCtxInitialize", NULL);
+        xmlSecEncCtxFinalize(&encCtx);
+        return;
     }
-
-    /* encrypt the data */
-    ret = xmlSecTransformCtxExecute(&(encCtx->transformCtx), tmpl->doc);
+    ret = xmlSecEncCtxCopyUserPref(&encCtx, batch->encCtx);
     if(ret < 0) {
-        xmlSecInternalError("xmlSecTransformCtxExecute", NULL);
-        return(-1);
+        xmlSecInternalError("xmlSecEncCtxCopyUserPref", NULL);
+        xmlSecEncCtxFinalize(&encCtx);
+        return;
+    }
+    /* the CipherReference nodes are prefetched for the whole batch */
+    encCtx.flags |= XMLSEC_ENC_SKIP_PREFETCH;
+
+    /* each worker takes every workersNum-th item */
+    for(ii = worker; ii < batch->size; ii += batch->workersNum) {
+        if(batch->encCtx->encKey != NULL) {
+            encCtx.encKey = xmlSecKeyDuplicate(batch->encCtx->encKey);
+            if(encCtx.encKey == NULL) {
+                xmlSecInternalError("xmlSecKeyDuplicate", NULL);
+                continue;
+            }
+        }
+
+        buffer = xmlSecEncCtxDecryptToBuffer(&encCtx, batch->items[ii].node);
+        if(buffer == NULL) {
+            xmlSecInternalError("xmlSecEncCtxDecryptToBuffer", NULL);
+        } else if((encCtx.type != NULL) &&
+            (xmlStrEqual(encCtx.type, xmlSecTypeEncElement) || xmlStrEqual(encCtx.type, xmlSecTypeEncContent))
+        ) {
+            /* keep the result, the context buffer is destroyed on reset */
+            xmlSecBufferSwap(batch->items[ii].result, buffer);
+            batch->items[ii].failed = 0;
+        } else {
+            xmlSecInvalidStringTypeError("encryption type", encCtx.type,
+                "Element or Content", NULL);
+        }
+        xmlSecEncCtxReset(&encCtx);
     }
+    xmlSecEncCtxFinalize(&encCtx);
+}
 
-    encCtx->result = encCtx->transformCtx.result;
-    xmlSecAssert2(encCtx->result != NULL, -1);
+/* counts (if @items is NULL) or stores &lt;enc:EncryptedData/&gt; nodes in the @cur subtree */
+static void
+xmlSecEncBatchAddNodes(xmlNodePtr cur, xmlSecEncBatchItemPtr items, xmlSecSize* size) {
+    xmlSecAssert(size != NULL);
 
-    ret = xmlSecEncCtxEncDataNodeWrite(encCtx);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecEncCtxEncDataNodeWrite", NULL);
-        return(-1);
+    if(cur == NULL) {
+        return;
+    }
+    if(xmlSecCheckNodeName(cur, xmlSecNodeEncryptedData, xmlSecEncNs)) {
+        if(items != NULL) {
+            items[(*size)].node = cur;
+        }
+        ++(*size);
+        return;
+    }
+    for(cur = cur->children; cur != NULL; cur = cur->next) {
+        if(cur->type == XML_ELEMENT_NODE) {
+            xmlSecEncBatchAddNodes(cur, items, size);
+        }
     }
-
-    return(0);
 }
 
 /**
- * xmlSecEncCtxDecrypt:
- * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
- * @node:               the pointer to &lt;enc:EncryptedData/&gt; node.
+ * xmlSecEncCtxDecryptMultiple:
+ * @encCtx:             the pointer to encryption processing context (used as a
+ *                      template for the workers contexts).
+ * @root:               the pointer to the root node to search for &lt;enc:EncryptedData/&gt; nodes.
+ * @workersNum:         the number of workers (e.g. threads) to use.
+ * @executor:           the optional application executor to run the workers.
+ * @executorCtx:        the context passed to @executor.
  *
- * Decrypts @node and if necessary replaces @node with decrypted data.
+ * Finds all the &lt;enc:EncryptedData/&gt; nodes in the @root subtree
+ * (including @root itself, but not the nodes inside an encrypted data)
+ * and decrypts them. The nodes are split between @workersNum workers
+ * that are run by @executor; each worker uses its own context with the
+ * user preferences copied from @encCtx (and a copy of encCtx->encKey,
+ * if it is set: e.g. the shared session key could be decrypted once by
+ * the caller). If @executor is NULL then the nodes are decrypted
+ * sequentially in the current thread. The document is only read while
+ * the workers run: all the decrypted data is parsed and replaces the
+ * &lt;enc:EncryptedData/&gt; nodes in the document order after the
+ * executor returns. If any of the nodes could not be decrypted (or has
+ * a type other than Element or Content) then the document is not changed.
  *
- * Returns: 0 on success or a negative value if an error occurs.
+ * The keys manager is only read: all the keys should be loaded into the
+ * keys manager before this call, the crypto library must be initialized
+ * for multi-threaded use.
+ *
+ * Returns: the number of decrypted nodes or a negative value if an error occurs.
  */
 int
-xmlSecEncCtxDecrypt(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
-    xmlSecBufferPtr buffer;
+xmlSecEncCtxDecryptMultiple(xmlSecEncCtxPtr encCtx, xmlNodePtr root, xmlSecSize workersNum,
+                            xmlSecEncBatchExecutor executor, void* executorCtx) {
+    xmlSecEncBatch batch;
+    xmlSecSize ii;
+    int res = -1;
     int ret;
 
     xmlSecAssert2(encCtx != NULL, -1);
-    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(encCtx->result == NULL, -1);
+    xmlSecAssert2(root != NULL, -1);
+    xmlSecAssert2(root->doc != NULL, -1);
 
-    /* decrypt */
-    buffer = xmlSecEncCtxDecryptToBuffer(encCtx, node);
-    if(buffer == NULL) {
-        xmlSecInternalError("xmlSecEncCtxDecryptToBuffer", NULL);
+    /* workers only read the document: register all the IDs beforehand */
+    xmlSecAddIDs(root->doc, NULL, xmlSecEncIds);
+
+    memset(&batch, 0, sizeof(batch));
+    batch.encCtx = encCtx;
+    xmlSecEncBatchAddNodes(root, NULL, &(batch.size));
+    if(batch.size == 0) {
+        return(0);
+    }
+    batch.items = (xmlSecEncBatchItemPtr)xmlMalloc(sizeof(xmlSecEncBatchItem) * batch.size);
+    if(batch.items == NULL) {
+        xmlSecMallocError(sizeof(xmlSecEncBatchItem) * batch.size, NULL);
         return(-1);
     }
+    memset(batch.items, 0, sizeof(xmlSecEncBatchItem) * batch.size);
 
-    /* replace original node if requested */
-    if((encCtx->type != NULL) && xmlStrEqual(encCtx->type, xmlSecTypeEncElement)) {
-        /* check if we need to return the replaced node */
-        if((encCtx->flags & XMLSEC_ENC_RETURN_REPLACED_NODE) != 0) {
-                ret = xmlSecReplaceNodeBufferAndReturn(node, xmlSecBufferGetData(buffer),  xmlSecBufferGetSize(buffer), &(encCtx->replacedNodeList));
-                if(ret < 0) {
-                    xmlSecInternalError("xmlSecReplaceNodeBufferAndReturn",
-                                        xmlSecNodeGetName(node));
-                    return(-1);
-                }
-        } else {
-                ret = xmlSecReplaceNodeBuffer(node, xmlSecBufferGetData(buffer),  xmlSecBufferGetSize(buffer));
-                if(ret < 0) {
-                    xmlSecInternalError("xmlSecReplaceNodeBuffer",
-                                        xmlSecNodeGetName(node));
-                    return(-1);
-                }
+    ii = 0;
+    xmlSecEncBatchAddNodes(root, batch.items, &ii);
+
+    /* let the application start fetching all the external data at once */
+    if((encCtx->flags & XMLSEC_ENC_SKIP_PREFETCH) == 0) {
+        ret = xmlSecEncCtxPrefetchCipherReferences(encCtx, root);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecEncCtxPrefetchCipherReferences", NULL);
+            /* the prefetch is only an optimization, the references are opened anyway */
+        }
+    }
+    for(ii = 0; ii < batch.size; ++ii) {
+        batch.items[ii].failed = 1;
+        batch.items[ii].result = xmlSecBufferCreate(0);
+        if(batch.items[ii].result == NULL) {
+            xmlSecInternalError("xmlSecBufferCreate", NULL);
+            goto done;
         }
+    }
 
-        encCtx->resultReplaced = 1;
-    } else if((encCtx->type != NULL) && xmlStrEqual(encCtx->type, xmlSecTypeEncContent)) {
-        /* replace the node with the buffer */
+    batch.workersNum = (workersNum > 0) ? workersNum : 1;
+    if(batch.workersNum > batch.size) {
+        batch.workersNum = batch.size;
+    }
 
-        /* check if we need to return the replaced node */
-        if((encCtx->flags & XMLSEC_ENC_RETURN_REPLACED_NODE) != 0) {
-                ret = xmlSecReplaceNodeBufferAndReturn(node, xmlSecBufferGetData(buffer), xmlSecBufferGetSize(buffer), &(encCtx->replacedNodeList));
-                if(ret < 0) {
-                    xmlSecInternalError("xmlSecReplaceNodeBufferAndReturn",
-                                        xmlSecNodeGetName(node));
-                    return(-1);
-                }
-        } else {
-            ret = xmlSecReplaceNodeBuffer(node, xmlSecBufferGetData(buffer), xmlSecBufferGetSize(buffer));
-                if(ret < 0) {
-                    xmlSecInternalError("xmlSecReplaceNodeBuffer",
-                                        xmlSecNodeGetName(node));
-                    return(-1);
-                }
+    /* decrypt */
+    if((executor == NULL) || (batch.workersNum == 1)) {
+        batch.workersNum = 1;
+        xmlSecEncBatchWorker(&batch, 0);
+    } else {
+        ret = executor(executorCtx, xmlSecEncBatchWorker, &batch, batch.workersNum);
+        if(ret < 0) {
+            xmlSecInternalError("executor", NULL);
+            goto done;
+        }
+    }
+    for(ii = 0; ii < batch.size; ++ii) {
+        if(batch.items[ii].failed != 0) {
+            xmlSecOtherError2(XMLSEC_ERRORS_R_XMLSEC_FAILED, NULL,
+                "EncryptedData node decryption failed: index=" XMLSEC_SIZE_FMT, ii);
+            goto done;
         }
-        encCtx->resultReplaced = 1;
     }
 
-    return(0);
+    /* replace the nodes in the document order */
+    for(ii = 0; ii < batch.size; ++ii) {
+        ret = xmlSecReplaceNodeBuffer(batch.items[ii].node,
+            xmlSecBufferGetData(batch.items[ii].result),
+            xmlSecBufferGetSize(batch.items[ii].result));
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecReplaceNodeBuffer", NULL,
+                "index=" XMLSEC_SIZE_FMT, ii);
+            goto done;
+        }
+    }
+
+    /* success */
+    XMLSEC_SAFE_CAST_SIZE_TO_INT(batch.size, res, goto done, NULL);
+
+done:
+    if(batch.items != NULL) {
+        for(ii = 0; ii < batch.size; ++ii) {
+            if(batch.items[ii].result != NULL) {
+                xmlSecBufferDestroy(batch.items[ii].result);
+            }
+        }
+        xmlFree(batch.items);
+    }
+    return(res);
 }
 
-/**
- * xmlSecEncCtxDecryptToBuffer:
- * @encCtx:             the pointer to encryption processing context.
- * @node:               the pointer to &lt;enc:EncryptedData/&gt; node.
- *
- * Decrypts @node data to the result.
- *
- * Returns: a buffer with key on success or NULL if an error occurs.
- */
-xmlSecBufferPtr
-xmlSecEncCtxDecryptToBuffer(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+static xmlSecBufferPtr
+xmlSecEncCtxDecryptInternal(xmlSecEncCtxPtr encCtx, xmlNodePtr node,
+                            xmlSecEncCtxDecryptSinkCallback sink, void* sinkCtx,
+                            xmlSecEncStreamParserPtr parser) {
+    xmlSecMemStatsPtr prevMemStats;
+    xmlSecSettingsPtr prevSettings;
+    xmlSecStatsSpan span;
     xmlSecBufferPtr res = NULL;
-    xmlChar* data = NULL;
     int ret;
 
     xmlSecAssert2(encCtx != NULL, NULL);
     xmlSecAssert2(encCtx->result == NULL, NULL);
     xmlSecAssert2(node != NULL, NULL);
 
+    XMLSEC_PROBE1(enc__decrypt__start, encCtx);
+    xmlSecStatsOpStart(xmlSecStatsOpEncDecrypt, &span);
+    prevMemStats = xmlSecMemStatsAttach(xmlSecEncCtxGetMemStats(encCtx));
+    prevSettings = xmlSecSettingsAttach(xmlSecEncCtxGetSettings(encCtx));
+
     /* initialize context and add ID atributes to the list of known ids */
     encCtx->operation = xmlSecTransformOperationDecrypt;
     xmlSecAddIDs(node->doc, node, xmlSecEncIds);
 
+    /* let the application start fetching all the external data (including the encrypted keys) */
+    if((encCtx->mode == xmlEncCtxModeEncryptedData) && ((encCtx->flags & XMLSEC_ENC_SKIP_PREFETCH) == 0)) {
+        ret = xmlSecEncCtxPrefetchCipherReferences(encCtx, node);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecEncCtxPrefetchCipherReferences", NULL);
+            /* the prefetch is only an optimization, the references are opened anyway */
+        }
+    }
+
     ret = xmlSecEncCtxEncDataNodeRead(encCtx, node);
     if(ret < 0) {
         xmlSecInternalError("xmlSecEncCtxEncDataNodeRead", NULL);
         goto done;
     }
 
-    /* decrypt the data */
-    if(encCtx->cipherValueNode != NULL) {
-        data = xmlNodeGetContent(encCtx->cipherValueNode);
-        if(data == NULL) {
-            xmlSecInvalidNodeContentError(encCtx->cipherValueNode, NULL, "empty");
+    /* the data type is known now: check if we can parse it on the fly */
+    if((sink == NULL) && (parser != NULL)) {
+        ret = xmlSecEncStreamParserStart(parser, encCtx, node);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecEncStreamParserStart", NULL);
+            goto done;
+        } else if(ret > 0) {
+            sink = xmlSecEncStreamParserWrite;
+            sinkCtx = parser;
+        }
+    }
+
+    /* pass decrypted data to the sink instead of collecting it in the result */
+    if(sink != NULL) {
+        ret = xmlSecEncCtxAppendSink(encCtx, sink, sinkCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecEncCtxAppendSink", NULL);
             goto done;
         }
+    }
 
-        ret = xmlSecTransformCtxBinaryExecute(&(encCtx->transformCtx), data, xmlSecStrlen(data));
+    /* decrypt the data */
+    if(encCtx->cipherValueNode != NULL) {
+        /* the text children are pushed to the chain without copying */
+        ret = xmlSecTransformCtxNodeContentExecute(&(encCtx->transformCtx), encCtx->cipherValueNode);
         if(ret < 0) {
-            xmlSecInternalError("xmlSecTransformCtxBinaryExecute", NULL);
+            xmlSecInternalError("xmlSecTransformCtxNodeContentExecute", NULL);
             goto done;
         }
     } else {
@@ -637,17 +2612,25 @@ xmlSecEncCtxDecryptToBuffer(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
 
     /* success  */
     res = encCtx->result = encCtx->transformCtx.result;
-    xmlSecAssert2(encCtx->result != NULL, NULL);
+    if(res == NULL) {
+        xmlSecInvalidDataError("decryption result is NULL", NULL);
+        goto done;
+    }
 
 done:
-    if(data != NULL) {
-        xmlFree(data);
+    xmlSecSettingsDetach(prevSettings);
+    xmlSecMemStatsDetach(prevMemStats);
+    if(res == NULL) {
+        xmlSecEncCtxMarkIfDeadlineExceeded(encCtx);
     }
+    xmlSecStatsOpEnd(&span, (res == NULL) ? 1 : 0);
+    XMLSEC_PROBE2(enc__decrypt__done, encCtx, res);
     return(res);
 }
 
 static int
 xmlSecEncCtxEncDataNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+    xmlSecStatsSpan span;
     xmlNodePtr cur;
     int ret;
 
@@ -779,11 +2762,26 @@ xmlSecEncCtxEncDataNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
         return(-1);
     }
 
+    /* generate (or reuse) the session key transported with &lt;enc:EncryptedKey/&gt; */
+    if((encCtx->encKey == NULL) && (encCtx->operation == xmlSecTransformOperationEncrypt) &&
+       (encCtx->mode == xmlEncCtxModeEncryptedData) && (encCtx->keyInfoNode != NULL) &&
+       (encCtx->keyInfoReadCtx.keysMngr != NULL) && (encCtx->keyInfoReadCtx.keysMngr->priv->sessionKeyCache != NULL) &&
+       (xmlSecFindChild(encCtx->keyInfoNode, xmlSecNodeEncryptedKey, xmlSecEncNs) != NULL)
+    ) {
+        ret = xmlSecEncCtxSessionKeyGet(encCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecEncCtxSessionKeyGet", NULL);
+            return(-1);
+        }
+    }
+
     /* TODO: KeyInfo node != NULL and encKey != NULL */
     if((encCtx->encKey == NULL) && (encCtx->keyInfoReadCtx.keysMngr != NULL)
                         && (encCtx->keyInfoReadCtx.keysMngr->getKey != NULL)) {
+        xmlSecStatsPhaseStart(xmlSecStatsPhaseKeyResolution, &span);
         encCtx->encKey = (encCtx->keyInfoReadCtx.keysMngr->getKey)(encCtx->keyInfoNode,
                                                              &(encCtx->keyInfoReadCtx));
+        xmlSecStatsPhaseEnd(&span);
     }
 
     /* check that we have exactly what we want */
@@ -805,6 +2803,15 @@ xmlSecEncCtxEncDataNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
         return(-1);
     }
 
+    /* compress the data before the encryption and decompress after the decryption */
+    if(((encCtx->flags & XMLSEC_ENC_COMPRESS_DEFLATE) != 0) && (encCtx->mode == xmlEncCtxModeEncryptedData)) {
+        ret = xmlSecEncCtxAddCompression(encCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecEncCtxAddCompression", NULL);
+            return(-1);
+        }
+    }
+
     /* if we need to write result to xml node then we need base64 encode it */
     if((encCtx->operation == xmlSecTransformOperationEncrypt) && (encCtx->cipherValueNode != NULL)) {
         xmlSecTransformPtr base64Encode;
@@ -822,6 +2829,41 @@ xmlSecEncCtxEncDataNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
     return(0);
 }
 
+static int
+xmlSecEncCtxAddCompression(xmlSecEncCtxPtr encCtx) {
+#ifndef XMLSEC_NO_ZLIB
+    xmlSecTransformPtr deflateTransform;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+
+    if(encCtx->operation == xmlSecTransformOperationEncrypt) {
+        /* compress the data before the cipher */
+        deflateTransform = xmlSecTransformCtxCreateAndPrepend(&(encCtx->transformCtx), xmlSecTransformDeflateId);
+        if(deflateTransform == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndPrepend(xmlSecTransformDeflateId)", NULL);
+            return(-1);
+        }
+        deflateTransform->operation = xmlSecTransformOperationEncode;
+    } else {
+        /* decompress the data after the cipher */
+        deflateTransform = xmlSecTransformCtxCreateAndAppend(&(encCtx->transformCtx), xmlSecTransformDeflateId);
+        if(deflateTransform == NULL) {
+            xmlSecInternalError("xmlSecTransformCtxCreateAndAppend(xmlSecTransformDeflateId)", NULL);
+            return(-1);
+        }
+        deflateTransform->operation = xmlSecTransformOperationDecode;
+        if(encCtx->maxDecompressedSize > 0) {
+            xmlSecTransformDeflateSetMaxOutputSize(deflateTransform, encCtx->maxDecompressedSize);
+        }
+    }
+    return(0);
+#else  /* XMLSEC_NO_ZLIB */
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecNotImplementedError("deflate compression support is disabled during compilation");
+    return(-1);
+#endif /* XMLSEC_NO_ZLIB */
+}
+
 static int
 xmlSecEncCtxEncDataNodeWrite(xmlSecEncCtxPtr encCtx) {
     int ret;
@@ -832,34 +2874,146 @@ xmlSecEncCtxEncDataNodeWrite(xmlSecEncCtxPtr encCtx) {
 
     /* write encrypted data to xml (if requested) */
     if(encCtx->cipherValueNode != NULL) {
-        xmlSecByte* inBuf;
-        xmlSecSize inSize;
-        int inLen;
+        xmlChar* content;
 
-        inBuf = xmlSecBufferGetData(encCtx->result);
-        inSize = xmlSecBufferGetSize(encCtx->result);
-        xmlSecAssert2(inBuf != NULL, -1);
-        XMLSEC_SAFE_CAST_SIZE_TO_INT(inSize, inLen, return(-1), NULL);
-
-        xmlNodeSetContentLen(encCtx->cipherValueNode, inBuf, inLen);
+        /* move the base64 encoded result into the node instead of copying it */
+        content = xmlSecBufferDetachString(encCtx->result);
+        if(content == NULL) {
+            xmlSecInternalError("xmlSecBufferDetachString", NULL);
+            return(-1);
+        }
+        xmlNodeSetContent(encCtx->cipherValueNode, NULL);
+        ret = xmlSecNodeAdoptContent(encCtx->cipherValueNode, content);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecNodeAdoptContent", NULL);
+            return(-1);
+        }
         encCtx->resultReplaced = 1;
     }
 
     /* update &lt;enc:KeyInfo/&gt; node */
-    if(encCtx->keyInfoNode != NULL) {
-        ret = xmlSecKeyInfoNodeWrite(encCtx->keyInfoNode, encCtx->encKey, &(encCtx->keyInfoWriteCtx));
+    ret = xmlSecEncCtxKeyInfoNodeWrite(encCtx);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecEncCtxKeyInfoNodeWrite", NULL);
+        return(-1);
+    }
+
+    return(0);
+}
+
+static int
+xmlSecEncCtxKeyInfoNodeWrite(xmlSecEncCtxPtr encCtx) {
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->encKey != NULL, -1);
+
+    /* the cached (or prepared) &lt;enc:KeyInfo/&gt; node already has everything */
+    if((encCtx->keyInfoNode == NULL) || (encCtx->sessionKeyReused != 0) ||
+       ((encCtx->flags & XMLSEC_ENC_KEEP_KEYINFO) != 0)) {
+        return(0);
+    }
+
+    ret = xmlSecKeyInfoNodeWrite(encCtx->keyInfoNode, encCtx->encKey, &(encCtx->keyInfoWriteCtx));
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeyInfoNodeWrite", NULL);
+        return(-1);
+    }
+
+    /* remember the generated session key (errors are not fatal) */
+    if((encCtx->sessionKeyId != NULL) && (encCtx->keyInfoReadCtx.keysMngr != NULL)) {
+        ret = xmlSecKeysMngrSessionKeyCacheAdd(encCtx->keyInfoReadCtx.keysMngr,
+            xmlSecBufferGetData(encCtx->sessionKeyId), xmlSecBufferGetSize(encCtx->sessionKeyId),
+            encCtx->encKey, encCtx->keyInfoNode);
         if(ret < 0) {
-            xmlSecInternalError("xmlSecKeyInfoNodeWrite", NULL);
-            return(-1);
+            xmlSecInternalError("xmlSecKeysMngrSessionKeyCacheAdd", NULL);
         }
+        xmlSecBufferDestroy(encCtx->sessionKeyId);
+        encCtx->sessionKeyId = NULL;
+    }
+
+    return(0);
+}
+
+/* takes the session key (and the &lt;enc:KeyInfo/&gt; node) from the keys manager cache or generates a new one */
+static int
+xmlSecEncCtxSessionKeyGet(xmlSecEncCtxPtr encCtx) {
+    xmlSecKeysMngrPtr keysMngr;
+    xmlOutputBufferPtr output;
+    xmlSecBufferPtr id;
+    xmlSecKeyPtr key = NULL;
+    xmlNodePtr keyInfoNode = NULL;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(encCtx->encKey == NULL, -1);
+    xmlSecAssert2(encCtx->encMethod != NULL, -1);
+    xmlSecAssert2(encCtx->keyInfoNode != NULL, -1);
+    xmlSecAssert2(encCtx->sessionKeyId == NULL, -1);
+
+    keysMngr = encCtx->keyInfoReadCtx.keysMngr;
+    xmlSecAssert2(keysMngr != NULL, -1);
+
+    /* the encryption method and the &lt;enc:KeyInfo/&gt; template identify the key */
+    id = xmlSecBufferCreate(1024);
+    if(id == NULL) {
+        xmlSecInternalError("xmlSecBufferCreate", NULL);
+        return(-1);
+    }
+    output = xmlSecBufferCreateOutputBuffer(id);
+    if(output == NULL) {
+        xmlSecInternalError("xmlSecBufferCreateOutputBuffer", NULL);
+        xmlSecBufferDestroy(id);
+        return(-1);
+    }
+    xmlOutputBufferWriteString(output, (const char*)xmlSecTransformGetName(encCtx->encMethod));
+    xmlOutputBufferWriteString(output, "\n");
+    xmlNodeDumpOutput(output, encCtx->keyInfoNode->doc, encCtx->keyInfoNode, 0, 0, NULL);
+    ret = xmlOutputBufferClose(output);
+    if(ret < 0) {
+        xmlSecXmlError("xmlOutputBufferClose", NULL);
+        xmlSecBufferDestroy(id);
+        return(-1);
     }
 
+    ret = xmlSecKeysMngrSessionKeyCacheFind(keysMngr, xmlSecBufferGetData(id), xmlSecBufferGetSize(id),
+        encCtx->keyInfoNode->doc, &key, &keyInfoNode);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecKeysMngrSessionKeyCacheFind", NULL);
+        xmlSecBufferDestroy(id);
+        return(-1);
+    } else if(ret > 0) {
+        xmlSecAssert2(key != NULL, -1);
+        xmlSecAssert2(keyInfoNode != NULL, -1);
+
+        /* replace the template with the cached node */
+        xmlSecDocIndexInvalidate(encCtx->keyInfoNode->doc);
+        xmlReplaceNode(encCtx->keyInfoNode, keyInfoNode);
+        xmlFreeNode(encCtx->keyInfoNode);
+        encCtx->keyInfoNode = keyInfoNode;
+        encCtx->encKey = key;
+        encCtx->sessionKeyReused = 1;
+        xmlSecBufferDestroy(id);
+        return(0);
+    }
+
+    /* generate a new key */
+    encCtx->encKey = xmlSecKeyGenerate(encCtx->keyInfoReadCtx.keyReq.keyId,
+        encCtx->keyInfoReadCtx.keyReq.keyBitsSize, xmlSecKeyDataTypeSession);
+    if(encCtx->encKey == NULL) {
+        xmlSecInternalError2("xmlSecKeyGenerate", xmlSecTransformGetName(encCtx->encMethod),
+            "size=" XMLSEC_SIZE_FMT, encCtx->keyInfoReadCtx.keyReq.keyBitsSize);
+        xmlSecBufferDestroy(id);
+        return(-1);
+    }
+    encCtx->sessionKeyId = id;
     return(0);
 }
 
 static int
 xmlSecEncCtxCipherDataNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
     xmlNodePtr cur;
+    xmlNodePtr xopNode;
     int ret;
 
     xmlSecAssert2(encCtx != NULL, -1);
@@ -869,7 +3023,20 @@ xmlSecEncCtxCipherDataNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
 
     /* we either have CipherValue or CipherReference node  */
     xmlSecAssert2(encCtx->cipherValueNode == NULL, -1);
-    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeCipherValue, xmlSecEncNs))) {
+    if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeCipherValue, xmlSecEncNs)) &&
+       (encCtx->operation == xmlSecTransformOperationDecrypt) &&
+       ((xopNode = xmlSecGetNextElementNode(cur->children)) != NULL) &&
+       (xmlSecCheckNodeName(xopNode, xmlSecNodeXopInclude, xmlSecXopNs)))
+    {
+        /* MTOM/XOP: the raw cipher text is in the referenced MIME part */
+        ret = xmlSecEncCtxXopIncludeNodeRead(encCtx, xopNode);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecEncCtxXopIncludeNodeRead",
+                                xmlSecNodeGetName(cur));
+            return(-1);
+        }
+        cur = xmlSecGetNextElementNode(cur->next);
+    } else if((cur != NULL) && (xmlSecCheckNodeName(cur, xmlSecNodeCipherValue, xmlSecEncNs))) {
         /* don't need data from CipherData node when we are encrypting */
         if(encCtx->operation == xmlSecTransformOperationDecrypt) {
             xmlSecTransformPtr base64Decode;
@@ -903,6 +3070,41 @@ xmlSecEncCtxCipherDataNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
     return(0);
 }
 
+/* the &lt;xop:Include href="cid:..."/&gt; element is read as the &lt;enc:CipherReference/&gt;
+ * without transforms: the referenced MIME part has the raw (not base64 encoded) cipher text */
+static int
+xmlSecEncCtxXopIncludeNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
+    xmlChar* href;
+    int ret;
+
+    xmlSecAssert2(encCtx != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+
+    href = xmlGetProp(node, xmlSecAttrHref);
+    if((href == NULL) || (href[0] == '\0') || (href[0] == '#')) {
+        xmlSecInvalidNodeAttributeError(node, xmlSecAttrHref, NULL, "external URI is expected");
+        if(href != NULL) {
+            xmlFree(href);
+        }
+        return(-1);
+    }
+    ret = xmlSecTransformCtxSetUri(&(encCtx->transformCtx), href, node);
+    if(ret < 0) {
+        xmlSecInternalError2("xmlSecTransformCtxSetUri", NULL,
+                             "uri=%s", xmlSecErrorsSafeString(href));
+        xmlFree(href);
+        return(-1);
+    }
+    xmlFree(href);
+
+    /* the XOP package has nothing else in the CipherValue node */
+    if(xmlSecGetNextElementNode(node->next) != NULL) {
+        xmlSecUnexpectedNodeError(xmlSecGetNextElementNode(node->next), NULL);
+        return(-1);
+    }
+    return(0);
+}
+
 static int
 xmlSecEncCtxCipherReferenceNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
     xmlNodePtr cur;
@@ -945,6 +3147,28 @@ xmlSecEncCtxCipherReferenceNodeRead(xmlSecEncCtxPtr encCtx, xmlNodePtr node) {
     return(0);
 }
 
+/* returns the stats object to attach for the operation or NULL */
+static xmlSecMemStatsPtr
+xmlSecEncCtxGetMemStats(xmlSecEncCtxPtr encCtx) {
+    xmlSecAssert2(encCtx != NULL, NULL);
+
+    if(((encCtx->flags & XMLSEC_ENC_COLLECT_MEM_STATS) == 0) && (encCtx->memStats.limit == 0)) {
+        return(NULL);
+    }
+    return(&(encCtx->memStats));
+}
+
+/* returns the keys manager settings to attach for the operation or NULL */
+static xmlSecSettingsPtr
+xmlSecEncCtxGetSettings(xmlSecEncCtxPtr encCtx) {
+    xmlSecAssert2(encCtx != NULL, NULL);
+
+    if(encCtx->keyInfoReadCtx.keysMngr == NULL) {
+        return(NULL);
+    }
+    return(encCtx->keyInfoReadCtx.keysMngr->priv->settings);
+}
+
 static void
 xmlSecEncCtxMarkAsFailed(xmlSecEncCtxPtr encCtx, xmlSecEncFailureReason failureReason) {
     xmlSecAssert(encCtx != NULL);
@@ -954,6 +3178,16 @@ xmlSecEncCtxMarkAsFailed(xmlSecEncCtxPtr encCtx, xmlSecEncFailureReason failureR
     }
 }
 
+/* the deadline failure overrides the other failure reasons */
+static void
+xmlSecEncCtxMarkIfDeadlineExceeded(xmlSecEncCtxPtr encCtx) {
+    xmlSecAssert(encCtx != NULL);
+
+    if(xmlSecTransformCtxIsDeadlineExceeded(&(encCtx->transformCtx)) != 0) {
+        encCtx->failureReason = xmlSecEncFailureReasonDeadline;
+    }
+}
+
 /**
  * xmlSecEncCtxDebugDump:
  * @encCtx:             the pointer to &lt;enc:EncryptedData/&gt; processing context.
@@ -1029,6 +3263,11 @@ xmlSecEncCtxDebugDump(xmlSecEncCtxPtr encCtx, FILE* output) {
         xmlSecKeyDebugDump(encCtx->encKey, output);
     }
 
+    if(xmlSecEncCtxGetMemStats(encCtx) != NULL) {
+        fprintf(output, "== Memory Stats:\n");
+        xmlSecMemStatsDebugDump(&(encCtx->memStats), output);
+    }
+
     if((encCtx->result != NULL) &&
        (xmlSecBufferGetData(encCtx->result) != NULL) &&
        (encCtx->resultBase64Encoded != 0)) {
@@ -1124,6 +3363,10 @@ xmlSecEncCtxDebugXmlDump(xmlSecEncCtxPtr encCtx, FILE* output) {
         fprintf(output, "</EncryptionKey>\n");
     }
 
+    if(xmlSecEncCtxGetMemStats(encCtx) != NULL) {
+        xmlSecMemStatsDebugXmlDump(&(encCtx->memStats), output);
+    }
+
     if((encCtx->result != NULL) &&
        (xmlSecBufferGetData(encCtx->result) != NULL) &&
        (encCtx->resultBase64Encoded != 0)) {
@@ -1487,6 +3730,9 @@ xmlSecEncCtxGetFailureReasonString(xmlSecEncFailureReason failureReason) {
     case xmlSecEncFailureReasonKeyNotFound:
         return "KEY-NOT-FOUND";
 
+    case xmlSecEncFailureReasonDeadline:
+        return "DEADLINE";
+
     case xmlSecEncFailureReasonUnknown:
     default:
         return "UNKNOWN";
@@ -29,9 +29,14 @@
 #include <xmlsec/transforms.h>
 #include <xmlsec/app.h>
 #include <xmlsec/io.h>
+#include <xmlsec/recorder.h>
+#include <xmlsec/secmem.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "docindex_helpers.h"
+#include "parser_helpers.h"
 
 /*
  * Custom external entity handler, denies all files except the initial
@@ -89,26 +94,51 @@ xmlSecSetExternalEntityLoader(xmlExternalEntityLoader entityLoader) {
  */
 int
 xmlSecInit(void) {
+    xmlSecStatsSpan span;
+    int res = -1;
+
+    xmlSecStatsStartupStart(xmlSecStatsStartupInit, &span);
     xmlSecErrorsInit();
     xmlSecIOInit();
 
+    if(xmlSecStatsInit() < 0) {
+        xmlSecInternalError("xmlSecStatsInit", NULL);
+        goto done;
+    }
+
+    if(xmlSecRecorderInit() < 0) {
+        xmlSecInternalError("xmlSecRecorderInit", NULL);
+        goto done;
+    }
+
+    if(xmlSecSecureMemInit() < 0) {
+        xmlSecInternalError("xmlSecSecureMemInit", NULL);
+        goto done;
+    }
+
 #ifndef XMLSEC_NO_CRYPTO_DYNAMIC_LOADING
     if(xmlSecCryptoDLInit() < 0) {
         xmlSecInternalError("xmlSecCryptoDLInit", NULL);
-        return(-1);
+        goto done;
     }
 #endif /* XMLSEC_NO_CRYPTO_DYNAMIC_LOADING */
 
     if(xmlSecKeyDataIdsInit() < 0) {
         xmlSecInternalError("xmlSecKeyDataIdsInit", NULL);
-        return(-1);
+        goto done;
     }
 
     if(xmlSecTransformIdsInit() < 0) {
         xmlSecInternalError("xmlSecTransformIdsInit", NULL);
-        return(-1);
+        goto done;
     }
 
+    /* the dictionary shared by the pooled parsers (see xmlSecParserPoolCreate) */
+    xmlSecParserDictInitialize();
+
+    /* the registry of the shared documents indexes (see xmlSecDocIndexCreate) */
+    xmlSecDocIndexInitialize();
+
     /* initialise safe external entity loader */
     if (!xmlSecDefaultExternalEntityLoader) {
         xmlSecDefaultExternalEntityLoader = xmlGetExternalEntityLoader();
@@ -118,7 +148,13 @@ xmlSecInit(void) {
 
     /* we use rand() function to generate id attributes */
     srand((unsigned int)time(NULL));
-    return(0);
+
+    /* done */
+    res = 0;
+
+done:
+    xmlSecStatsStartupEnd(&span);
+    return(res);
 }
 
 /**
@@ -132,6 +168,9 @@ int
 xmlSecShutdown(void) {
     int res = -1;
 
+    xmlSecDocIndexShutdown();
+    xmlSecDtdIDsDisableCache();
+    xmlSecParserDictShutdown();
     xmlSecTransformIdsShutdown();
     xmlSecKeyDataIdsShutdown();
 
@@ -149,6 +188,9 @@ xmlSecShutdown(void) {
 done:
 #endif /* XMLSEC_NO_CRYPTO_DYNAMIC_LOADING */
 
+    xmlSecSecureMemShutdown();
+    xmlSecRecorderShutdown();
+    xmlSecStatsShutdown();
     xmlSecIOShutdown();
     xmlSecErrorsShutdown();
     return(res);
@@ -19,33 +19,73 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <libxml/tree.h>
+#include <libxml/entities.h>
 #include <libxml/valid.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/xmltree.h>
 #include <xmlsec/parser.h>
 #include <xmlsec/private.h>
 #include <xmlsec/base64.h>
+#include <xmlsec/settings.h>
 #include <xmlsec/errors.h>
+#include <xmlsec/stats.h>
 
 #include "cast_helpers.h"
+#include "docindex_helpers.h"
+#include "parser_helpers.h"
 
 static const xmlChar*    g_xmlsec_xmltree_default_linefeed = xmlSecStringCR;
 
+static int              xmlSecCheckNodeNameValue                (const xmlChar* value,
+                                                                 const xmlChar* name);
+static int              xmlSecAddIDsNode                        (xmlDocPtr doc,
+                                                                 xmlNodePtr node,
+                                                                 void* context);
+static int              xmlSecAddIDAttrsNode                    (xmlDocPtr doc,
+                                                                 xmlNodePtr node,
+                                                                 void* context);
+
+typedef struct _xmlSecIDAttrRules {
+    const xmlSecIDAttrRule*     rules;
+    xmlSecSize                  rulesSize;
+} xmlSecIDAttrRules;
+
+typedef int             (*xmlSecAddIDsNodeCallback)             (xmlDocPtr doc,
+                                                                 xmlNodePtr node,
+                                                                 void* context);
+static int              xmlSecAddIDsWithIndex                   (xmlDocPtr doc,
+                                                                 xmlNodePtr cur,
+                                                                 const xmlChar** names,
+                                                                 xmlSecSize namesSize,
+                                                                 xmlSecAddIDsNodeCallback callback,
+                                                                 void* context);
+
 /**
  * xmlSecGetDefaultLineFeed:
  *
- * Gets the current default linefeed.
+ * Gets the current default linefeed (from the settings attached to
+ * the current thread if set, see #xmlSecSettingsAttach).
  *
  * Returns: the current default linefeed.
  */
 const xmlChar*
 xmlSecGetDefaultLineFeed(void)
 {
+    xmlSecSettingsPtr settings = xmlSecSettingsGetCurrent();
+
+    if((settings != NULL) && ((settings->flags & XMLSEC_SETTINGS_LINEFEED) != 0) && (settings->lineFeed != NULL)) {
+        return(settings->lineFeed);
+    }
     return g_xmlsec_xmltree_default_linefeed;
 }
 
@@ -146,6 +186,122 @@ xmlSecGetNodeContentAsSize(const xmlNodePtr cur, xmlSecSize defValue, xmlSecSize
     return(0);
 }
 
+/* the max nesting of the entity references followed by xmlSecNodeContentForEach */
+#define XMLSEC_NODE_CONTENT_MAX_ENTITY_DEPTH            40
+
+static int
+xmlSecNodeContentForEachChild(const xmlNodePtr parent, xmlSecNodeContentCallback callback,
+                              void* context, int depth) {
+    xmlNodePtr cur;
+    xmlEntityPtr ent;
+    int ret;
+
+    xmlSecAssert2(parent != NULL, -1);
+    xmlSecAssert2(callback != NULL, -1);
+
+    cur = parent->children;
+    while(cur != NULL) {
+        switch(cur->type) {
+        case XML_TEXT_NODE:
+        case XML_CDATA_SECTION_NODE:
+            if(cur->content != NULL) {
+                ret = callback(cur->content, xmlSecStrlen(cur->content), context);
+                if(ret < 0) {
+                    return(-1);
+                }
+            }
+            break;
+        case XML_ENTITY_REF_NODE:
+            ent = xmlGetDocEntity(cur->doc, cur->name);
+            if(ent == NULL) {
+                break;
+            }
+            if(depth >= XMLSEC_NODE_CONTENT_MAX_ENTITY_DEPTH) {
+                xmlSecInvalidNodeContentError(cur, NULL, "too many nested entity references");
+                return(-1);
+            }
+            ret = xmlSecNodeContentForEachChild((xmlNodePtr)ent, callback, context, depth + 1);
+            if(ret < 0) {
+                return(-1);
+            }
+            break;
+        case XML_ELEMENT_NODE:
+            if(cur->children != NULL) {
+                cur = cur->children;
+                continue;
+            }
+            break;
+        default:
+            break;
+        }
+
+        /* next node in document order under parent */
+        while((cur != parent) && (cur->next == NULL)) {
+            cur = cur->parent;
+        }
+        if((cur == parent) || (cur == NULL)) {
+            break;
+        }
+        cur = cur->next;
+    }
+    return(0);
+}
+
+/**
+ * xmlSecNodeContentForEach:
+ * @node:           the pointer to XML node.
+ * @callback:       the callback called for each content segment.
+ * @context:        the user data passed to @callback.
+ *
+ * Calls @callback for each text and CDATA segment of the @node content
+ * in the document order (i.e. the concatenation of the segments is the
+ * same as the string returned by xmlNodeGetContent function). The segments
+ * are not copied, the callback gets pointers to the text nodes content.
+ *
+ * Returns: 0 on success or a negative value if an error occurs or
+ * @callback returns a negative value.
+ */
+int
+xmlSecNodeContentForEach(const xmlNodePtr node, xmlSecNodeContentCallback callback, void* context) {
+    xmlChar* content;
+    int ret;
+
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(callback != NULL, -1);
+
+    switch(node->type) {
+    case XML_TEXT_NODE:
+    case XML_CDATA_SECTION_NODE:
+    case XML_COMMENT_NODE:
+    case XML_PI_NODE:
+        if(node->content == NULL) {
+            return(0);
+        }
+        ret = callback(node->content, xmlSecStrlen(node->content), context);
+        if(ret < 0) {
+            return(-1);
+        }
+        return(0);
+    case XML_ELEMENT_NODE:
+    case XML_ATTRIBUTE_NODE:
+    case XML_DOCUMENT_FRAG_NODE:
+    case XML_ENTITY_DECL:
+        return(xmlSecNodeContentForEachChild(node, callback, context, 0));
+    default:
+        /* rare cases (e.g. documents): collect the content with libxml2 */
+        content = xmlNodeGetContent(node);
+        if(content == NULL) {
+            return(0);
+        }
+        ret = callback(content, xmlSecStrlen(content), context);
+        xmlFree(content);
+        if(ret < 0) {
+            return(-1);
+        }
+        return(0);
+    }
+}
+
 /**
  * xmlSecFindSibling:
  * @cur:                the pointer to XML node.
@@ -207,13 +363,15 @@ xmlSecFindChild(const xmlNodePtr parent, const xmlChar *name, const xmlChar *ns)
  */
 xmlNodePtr
 xmlSecFindParent(const xmlNodePtr cur, const xmlChar *name, const xmlChar *ns) {
+    xmlNodePtr tmp;
+
     xmlSecAssert2(cur != NULL, NULL);
     xmlSecAssert2(name != NULL, NULL);
 
-    if(xmlSecCheckNodeName(cur, name, ns)) {
-        return(cur);
-    } else if(cur->parent != NULL) {
-        return(xmlSecFindParent(cur->parent, name, ns));
+    for(tmp = cur; tmp != NULL; tmp = tmp->parent) {
+        if(xmlSecCheckNodeName(tmp, name, ns)) {
+            return(tmp);
+        }
     }
     return(NULL);
 }
@@ -232,23 +390,45 @@ xmlSecFindParent(const xmlNodePtr cur, const xmlChar *name, const xmlChar *ns) {
  */
 xmlNodePtr
 xmlSecFindNode(const xmlNodePtr parent, const xmlChar *name, const xmlChar *ns) {
+    xmlNodePtr top;
     xmlNodePtr cur;
     xmlNodePtr ret;
 
     xmlSecAssert2(name != NULL, NULL);
 
+    /* iterative walk over @parent, its next siblings and all their descendants
+     * in the document order (deep documents do not exhaust the stack) */
+    if(parent == NULL) {
+        return(NULL);
+    }
+    top = parent->parent;
     cur = parent;
     while(cur != NULL) {
         if((cur->type == XML_ELEMENT_NODE) && xmlSecCheckNodeName(cur, name, ns)) {
             return(cur);
         }
         if(cur->children != NULL) {
+            if(cur->type != XML_ENTITY_REF_NODE) {
+                cur = cur->children;
+                continue;
+            }
+
+            /* the entity content parent is the entity declaration, not the
+             * reference: these are searched separately (the entities nesting
+             * depth is limited by libxml2) */
             ret = xmlSecFindNode(cur->children, name, ns);
             if(ret != NULL) {
                 return(ret);
             }
         }
-        cur = cur->next;
+
+        /* the next sibling or the next sibling of the nearest ancestor */
+        while((cur != NULL) && (cur->next == NULL)) {
+            cur = (cur->parent != top) ? cur->parent : NULL;
+        }
+        if(cur != NULL) {
+            cur = cur->next;
+        }
     }
     return(NULL);
 }
@@ -295,10 +475,73 @@ int
 xmlSecCheckNodeName(const xmlNodePtr cur, const xmlChar *name, const xmlChar *ns) {
     xmlSecAssert2(cur != NULL, 0);
 
-    return(xmlStrEqual(cur->name, name) &&
+    return(xmlSecCheckNodeNameValue(cur->name, name) &&
            xmlStrEqual(xmlSecGetNodeNsHref(cur), ns));
 }
 
+/*
+ * The names in the documents parsed with the shared dictionary (see
+ * xmlSecParserPoolCreate) are the dictionary strings: if such name is
+ * one of the xmlsec constants then it is exactly the interned copy of
+ * the constant. Everything else is compared with xmlStrEqual().
+ */
+static int
+xmlSecCheckNodeNameValue(const xmlChar* value, const xmlChar* name) {
+    const xmlChar* interned;
+
+    if(value == name) {
+        return(1);
+    }
+    interned = xmlSecParserDictFindName(name);
+    if(interned != NULL) {
+        if(value == interned) {
+            return(1);
+        }
+        if(xmlDictOwns(xmlSecParserGetDict(), value) == 1) {
+            return(0);
+        }
+    }
+    return(xmlStrEqual(value, name));
+}
+
+/*
+ * Sets the namespace @ns on the new node @cur. The templates add the nodes
+ * in the same namespace as their parent most of the time: the parent's
+ * namespace is in scope for the new node (it has no namespace definitions
+ * yet) and is used as is, without searching the ancestors.
+ */
+static int
+xmlSecSetNewNodeNs(xmlNodePtr cur, const xmlChar *ns) {
+    xmlNodePtr parent;
+    xmlNsPtr nsPtr;
+
+    xmlSecAssert2(cur != NULL, -1);
+
+    if(ns == NULL) {
+        return(0);
+    }
+
+    parent = cur->parent;
+    if((parent != NULL) && (parent->type == XML_ELEMENT_NODE) && (parent->ns != NULL) &&
+       ((parent->ns->href == ns) || xmlStrEqual(parent->ns->href, ns)))
+    {
+        xmlSetNs(cur, parent->ns);
+        return(0);
+    }
+
+    /* find namespace by href and check that its prefix is not overwritten */
+    nsPtr = xmlSearchNsByHref(cur->doc, cur, ns);
+    if((nsPtr == NULL) || (xmlSearchNs(cur->doc, cur, nsPtr->prefix) != nsPtr)) {
+        nsPtr = xmlNewNs(cur, ns, NULL);
+        if(nsPtr == NULL) {
+            xmlSecXmlError("xmlNewNs", NULL);
+            return(-1);
+        }
+    }
+    xmlSetNs(cur, nsPtr);
+    return(0);
+}
+
 /**
  * xmlSecAddChild:
  * @parent:             the pointer to an XML node.
@@ -317,6 +560,8 @@ xmlSecAddChild(xmlNodePtr parent, const xmlChar *name, const xmlChar *ns) {
     xmlSecAssert2(parent != NULL, NULL);
     xmlSecAssert2(name != NULL, NULL);
 
+    xmlSecDocIndexInvalidate(parent->doc);
+
     if(parent->children == NULL) {
         /* TODO: add indents */
         text = xmlNewText(xmlSecGetDefaultLineFeed());
@@ -334,19 +579,9 @@ xmlSecAddChild(xmlNodePtr parent, const xmlChar *name, const xmlChar *ns) {
     }
 
     /* namespaces support */
-    if(ns != NULL) {
-        xmlNsPtr nsPtr;
-
-        /* find namespace by href and check that its prefix is not overwritten */
-        nsPtr = xmlSearchNsByHref(cur->doc, cur, ns);
-        if((nsPtr == NULL) || (xmlSearchNs(cur->doc, cur, nsPtr->prefix) != nsPtr)) {
-            nsPtr = xmlNewNs(cur, ns, NULL);
-            if(nsPtr == NULL) {
-                xmlSecXmlError("xmlNewNs", NULL);
-                return(NULL);
-            }
-        }
-        xmlSetNs(cur, nsPtr);
+    if(xmlSecSetNewNodeNs(cur, ns) < 0) {
+        xmlSecInternalError("xmlSecSetNewNodeNs", NULL);
+        return(NULL);
     }
 
     /* TODO: add indents */
@@ -376,6 +611,11 @@ xmlSecAddChildNode(xmlNodePtr parent, xmlNodePtr child) {
     xmlSecAssert2(parent != NULL, NULL);
     xmlSecAssert2(child != NULL, NULL);
 
+    xmlSecDocIndexInvalidate(parent->doc);
+    if(child->doc != parent->doc) {
+        xmlSecDocIndexInvalidate(child->doc);
+    }
+
     if(parent->children == NULL) {
         /* TODO: add indents */
         text = xmlNewText(xmlSecGetDefaultLineFeed());
@@ -461,6 +701,8 @@ xmlSecAddNextSibling(xmlNodePtr node, const xmlChar *name, const xmlChar *ns) {
     xmlSecAssert2(node != NULL, NULL);
     xmlSecAssert2(name != NULL, NULL);
 
+    xmlSecDocIndexInvalidate(node->doc);
+
     cur = xmlNewNode(NULL, name);
     if(cur == NULL) {
         xmlSecXmlError("xmlNewNode", NULL);
@@ -469,15 +711,9 @@ xmlSecAddNextSibling(xmlNodePtr node, const xmlChar *name, const xmlChar *ns) {
     xmlAddNextSibling(node, cur);
 
     /* namespaces support */
-    if(ns != NULL) {
-        xmlNsPtr nsPtr;
-
-        /* find namespace by href and check that its prefix is not overwritten */
-        nsPtr = xmlSearchNsByHref(cur->doc, cur, ns);
-        if((nsPtr == NULL) || (xmlSearchNs(cur->doc, cur, nsPtr->prefix) != nsPtr)) {
-            nsPtr = xmlNewNs(cur, ns, NULL);
-        }
-        xmlSetNs(cur, nsPtr);
+    if(xmlSecSetNewNodeNs(cur, ns) < 0) {
+        xmlSecInternalError("xmlSecSetNewNodeNs", NULL);
+        return(NULL);
     }
 
     /* TODO: add indents */
@@ -509,6 +745,8 @@ xmlSecAddPrevSibling(xmlNodePtr node, const xmlChar *name, const xmlChar *ns) {
     xmlSecAssert2(node != NULL, NULL);
     xmlSecAssert2(name != NULL, NULL);
 
+    xmlSecDocIndexInvalidate(node->doc);
+
     cur = xmlNewNode(NULL, name);
     if(cur == NULL) {
         xmlSecXmlError("xmlNewNode", NULL);
@@ -517,15 +755,9 @@ xmlSecAddPrevSibling(xmlNodePtr node, const xmlChar *name, const xmlChar *ns) {
     xmlAddPrevSibling(node, cur);
 
     /* namespaces support */
-    if(ns != NULL) {
-        xmlNsPtr nsPtr;
-
-        /* find namespace by href and check that its prefix is not overwritten */
-        nsPtr = xmlSearchNsByHref(cur->doc, cur, ns);
-        if((nsPtr == NULL) || (xmlSearchNs(cur->doc, cur, nsPtr->prefix) != nsPtr)) {
-            nsPtr = xmlNewNs(cur, ns, NULL);
-        }
-        xmlSetNs(cur, nsPtr);
+    if(xmlSecSetNewNodeNs(cur, ns) < 0) {
+        xmlSecInternalError("xmlSecSetNewNodeNs", NULL);
+        return(NULL);
     }
 
     /* TODO: add indents */
@@ -588,6 +820,11 @@ xmlSecReplaceNodeAndReturn(xmlNodePtr node, xmlNodePtr newNode, xmlNodePtr* repl
     xmlSecAssert2(node != NULL, -1);
     xmlSecAssert2(newNode != NULL, -1);
 
+    xmlSecDocIndexInvalidate(node->doc);
+    if(newNode->doc != node->doc) {
+        xmlSecDocIndexInvalidate(newNode->doc);
+    }
+
     /* fix documents children if necessary first */
     if((node->doc != NULL) && (node->doc->children == node)) {
         node->doc->children = node->next;
@@ -646,6 +883,11 @@ xmlSecReplaceContentAndReturn(xmlNodePtr node, xmlNodePtr newNode, xmlNodePtr *r
     xmlSecAssert2(node != NULL, -1);
     xmlSecAssert2(newNode != NULL, -1);
 
+    xmlSecDocIndexInvalidate(node->doc);
+    if(newNode->doc != node->doc) {
+        xmlSecDocIndexInvalidate(newNode->doc);
+    }
+
     /* return the old nodes if requested */
     if(replaced != NULL) {
         xmlNodePtr cur, next, tail;
@@ -711,6 +953,8 @@ xmlSecReplaceNodeBufferAndReturn(xmlNodePtr node, const xmlSecByte *buffer, xmlS
     xmlSecAssert2(node != NULL, -1);
     xmlSecAssert2(node->parent != NULL, -1);
 
+    xmlSecDocIndexInvalidate(node->doc);
+
     /* parse buffer in the context of node's parent */
     XMLSEC_SAFE_CAST_SIZE_TO_INT(size, len, return(-1), NULL);
     ret = xmlParseInNodeContext(node->parent, (const char*)buffer, len,
@@ -770,6 +1014,51 @@ xmlSecNodeEncodeAndSetContent(xmlNodePtr node, const xmlChar * buffer) {
     return(0);
 }
 
+/**
+ * xmlSecNodeAdoptContent:
+ * @node:               the pointer to an XML element node.
+ * @content:            the text allocated with xmlMalloc function.
+ *
+ * Appends @content to the @node content without copying it: the new text
+ * node takes the ownership of @content (the string is freed even if an error
+ * occurs). The @content is not parsed for the entity references, i.e. it
+ * should not contain any "special" characters (e.g. base64 encoded data).
+ * If the @node already ends with a text node then the @content is copied
+ * into it.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecNodeAdoptContent(xmlNodePtr node, xmlChar* content) {
+    xmlNodePtr text;
+
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(node->type == XML_ELEMENT_NODE, -1);
+    xmlSecAssert2(content != NULL, -1);
+
+    /* libxml2 merges the adjacent text nodes anyway */
+    if((node->last != NULL) && (node->last->type == XML_TEXT_NODE)) {
+        xmlNodeAddContent(node, content);
+        xmlFree(content);
+        return(0);
+    }
+
+    text = xmlNewDocText(node->doc, NULL);
+    if(text == NULL) {
+        xmlSecXmlError("xmlNewDocText", NULL);
+        xmlFree(content);
+        return(-1);
+    }
+    text->content = content;
+
+    if(xmlAddChild(node, text) == NULL) {
+        xmlSecXmlError("xmlAddChild", NULL);
+        xmlFreeNode(text);
+        return(-1);
+    }
+    return(0);
+}
+
 /**
  * xmlSecAddIDs:
  * @doc:                the pointer to an XML document.
@@ -777,50 +1066,606 @@ xmlSecNodeEncodeAndSetContent(xmlNodePtr node, const xmlChar * buffer) {
  * @ids:                the pointer to a NULL terminated list of ID attributes.
  *
  * Walks thru all children of the @cur node and adds all attributes
- * from the @ids list to the @doc document IDs attributes hash.
+ * from the @ids list to the @doc document IDs attributes hash. If @doc
+ * has an index (see #xmlSecDocIndexCreate) then the elements with these
+ * attributes are taken from the index instead.
  */
 void
 xmlSecAddIDs(xmlDocPtr doc, xmlNodePtr cur, const xmlChar** ids) {
-    xmlNodePtr children = NULL;
+    xmlNodePtr node;
+    xmlSecSize idsSize;
+    int ret;
 
     xmlSecAssert(doc != NULL);
     xmlSecAssert(ids != NULL);
 
-    if((cur != NULL) && (cur->type == XML_ELEMENT_NODE)) {
-        xmlAttrPtr attr;
-        xmlAttrPtr tmp;
-        int i;
-        xmlChar* name;
-
-        for(attr = cur->properties; attr != NULL; attr = attr->next) {
-            for(i = 0; ids[i] != NULL; ++i) {
-                if(xmlStrEqual(attr->name, ids[i])) {
-                    name = xmlNodeListGetString(doc, attr->children, 1);
-                    if(name != NULL) {
-                        tmp = xmlGetID(doc, name);
-                        if(tmp == NULL) {
-                            xmlAddID(NULL, doc, name, attr);
-                        } else if(tmp != attr) {
-                            xmlSecInvalidStringDataError("id", name, "unique id (id already defined)", NULL);
-                            /* ignore error */
-                        }
-                        xmlFree(name);
+    if((cur != NULL) && (cur->type != XML_ELEMENT_NODE)) {
+        return;
+    }
+
+    /* the document index has the attributes owners */
+    for(idsSize = 0; ids[idsSize] != NULL; ++idsSize);
+    ret = xmlSecAddIDsWithIndex(doc, cur, ids, idsSize, xmlSecAddIDsNode, (void*)ids);
+    if(ret != 0) {
+        return;
+    }
+
+    node = (cur != NULL) ? cur : doc->children;
+    while(node != NULL) {
+        if(node->type == XML_ELEMENT_NODE) {
+            xmlSecAddIDsNode(doc, node, (void*)ids);
+            if(node->children != NULL) {
+                node = node->children;
+                continue;
+            }
+        }
+
+        /* no children: go to the next sibling of the node or of its closest ancestor */
+        while((node != NULL) && (node != cur) && (node->next == NULL)) {
+            node = node->parent;
+            if((node != NULL) && (node->type == XML_DOCUMENT_NODE)) {
+                node = NULL;
+            }
+        }
+        node = ((node != NULL) && (node != cur)) ? node->next : NULL;
+    }
+}
+
+static int
+xmlSecAddIDsNode(xmlDocPtr doc, xmlNodePtr node, void* context) {
+    const xmlChar** ids = (const xmlChar**)context;
+    xmlAttrPtr attr;
+    xmlAttrPtr tmp;
+    xmlChar* name;
+    int i;
+
+    xmlSecAssert2(doc != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(ids != NULL, -1);
+
+    for(attr = node->properties; attr != NULL; attr = attr->next) {
+        for(i = 0; ids[i] != NULL; ++i) {
+            if(xmlStrEqual(attr->name, ids[i])) {
+                name = xmlNodeListGetString(doc, attr->children, 1);
+                if(name != NULL) {
+                    tmp = xmlGetID(doc, name);
+                    if(tmp == NULL) {
+                        xmlAddID(NULL, doc, name, attr);
+                    } else if(tmp != attr) {
+                        xmlSecInvalidStringDataError("id", name, "unique id (id already defined)", NULL);
+                        /* ignore error */
                     }
+                    xmlFree(name);
+                }
+            }
+        }
+    }
+    return(0);
+}
+
+/**
+ * xmlSecAddIDAttrs:
+ * @doc:                the pointer to an XML document.
+ * @cur:                the pointer to an XML node (NULL for the whole document).
+ * @rules:              the ID attribute rules.
+ * @rulesSize:          the number of the rules in @rules.
+ *
+ * Walks thru the @cur node and all its children (or thru the whole @doc
+ * document if @cur is NULL) once and adds the attributes matching any of
+ * the @rules to the @doc document IDs attributes hash. Unlike #xmlSecAddIDs,
+ * a duplicate ID is an error. If @doc has an index (see #xmlSecDocIndexCreate)
+ * then the elements with these attributes are taken from the index instead.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecAddIDAttrs(xmlDocPtr doc, xmlNodePtr cur, const xmlSecIDAttrRule* rules, xmlSecSize rulesSize) {
+    xmlSecIDAttrRules ctx;
+    const xmlChar** names;
+    xmlNodePtr node;
+    xmlSecSize ii;
+    int ret;
+
+    xmlSecAssert2(doc != NULL, -1);
+    xmlSecAssert2(rules != NULL, -1);
+
+    ctx.rules = rules;
+    ctx.rulesSize = rulesSize;
+
+    /* the document index has the attributes owners */
+    if((rulesSize > 0) && (xmlSecDocIndexGet(doc) != NULL)) {
+        names = (const xmlChar**)xmlMalloc(rulesSize * sizeof(const xmlChar*));
+        if(names == NULL) {
+            xmlSecMallocError(rulesSize * sizeof(const xmlChar*), NULL);
+            return(-1);
+        }
+        for(ii = 0; ii < rulesSize; ++ii) {
+            names[ii] = rules[ii].attrName;
+        }
+        ret = xmlSecAddIDsWithIndex(doc, cur, names, rulesSize, xmlSecAddIDAttrsNode, &ctx);
+        xmlFree((void*)names);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecAddIDsWithIndex", NULL);
+            return(-1);
+        } else if(ret > 0) {
+            return(0);
+        }
+    }
+
+    node = (cur != NULL) ? cur : doc->children;
+    while(node != NULL) {
+        if(node->type == XML_ELEMENT_NODE) {
+            ret = xmlSecAddIDAttrsNode(doc, node, &ctx);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecAddIDAttrsNode", NULL);
+                return(-1);
+            }
+            if(node->children != NULL) {
+                node = node->children;
+                continue;
+            }
+        }
+
+        /* no children: go to the next sibling of the node or of its closest ancestor */
+        while((node != NULL) && (node != cur) && (node->next == NULL)) {
+            node = node->parent;
+            if((node != NULL) && (node->type == XML_DOCUMENT_NODE)) {
+                node = NULL;
+            }
+        }
+        node = ((node != NULL) && (node != cur)) ? node->next : NULL;
+    }
+    return(0);
+}
+
+/**************************************************************************
+ *
+ * DTD ID attributes declarations cache
+ *
+ * The DTD is parsed once per file path and modification time, only its
+ * ID attributes declarations are applied to the documents.
+ *
+ *************************************************************************/
+typedef struct _xmlSecDtdIDsCacheEntry {
+    char*               filename;
+    time_t              mtime;
+    xmlDtdPtr           dtd;
+    xmlSecIDAttrRule*   rules;      /* the strings are owned by the dtd */
+    xmlSecSize          rulesSize;
+    int                 refs;
+} xmlSecDtdIDsCacheEntry, *xmlSecDtdIDsCacheEntryPtr;
+
+static xmlMutexPtr                  gXmlSecDtdIDsCacheMutex = NULL;
+static xmlSecDtdIDsCacheEntryPtr*   gXmlSecDtdIDsCacheEntries = NULL;
+static xmlSecSize                   gXmlSecDtdIDsCacheMaxSize = 0;
+static xmlSecSize                   gXmlSecDtdIDsCachePos = 0;
+
+static void
+xmlSecDtdIDsCacheEntryDestroy(xmlSecDtdIDsCacheEntryPtr entry) {
+    xmlSecAssert(entry != NULL);
+
+    if(entry->rules != NULL) {
+        xmlFree(entry->rules);
+    }
+    if(entry->dtd != NULL) {
+        xmlFreeDtd(entry->dtd);
+    }
+    if(entry->filename != NULL) {
+        xmlFree(entry->filename);
+    }
+    memset(entry, 0, sizeof(xmlSecDtdIDsCacheEntry));
+    xmlFree(entry);
+}
+
+/* the entry is destroyed when the last reference is released */
+static void
+xmlSecDtdIDsCacheEntryRelease(xmlSecDtdIDsCacheEntryPtr entry) {
+    int refs;
+
+    xmlSecAssert(entry != NULL);
+
+    if(gXmlSecDtdIDsCacheMutex != NULL) {
+        xmlMutexLock(gXmlSecDtdIDsCacheMutex);
+        refs = --(entry->refs);
+        xmlMutexUnlock(gXmlSecDtdIDsCacheMutex);
+    } else {
+        refs = --(entry->refs);
+    }
+    if(refs <= 0) {
+        xmlSecDtdIDsCacheEntryDestroy(entry);
+    }
+}
+
+static xmlSecDtdIDsCacheEntryPtr
+xmlSecDtdIDsCacheEntryCreate(const char* filename, time_t mtime) {
+    xmlSecDtdIDsCacheEntryPtr entry;
+    xmlAttributePtr attrDecl;
+    xmlNodePtr cur;
+    const xmlChar* p;
+    xmlSecSize ii;
+
+    xmlSecAssert2(filename != NULL, NULL);
+
+    entry = (xmlSecDtdIDsCacheEntryPtr)xmlMalloc(sizeof(xmlSecDtdIDsCacheEntry));
+    if(entry == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDtdIDsCacheEntry), NULL);
+        return(NULL);
+    }
+    memset(entry, 0, sizeof(xmlSecDtdIDsCacheEntry));
+    entry->mtime = mtime;
+    entry->refs = 1;
+
+    entry->filename = (char*)xmlStrdup(BAD_CAST filename);
+    if(entry->filename == NULL) {
+        xmlSecStrdupError(BAD_CAST filename, NULL);
+        xmlSecDtdIDsCacheEntryDestroy(entry);
+        return(NULL);
+    }
+
+    entry->dtd = xmlParseDTD(NULL, BAD_CAST filename);
+    if(entry->dtd == NULL) {
+        xmlSecXmlError2("xmlParseDTD", NULL, "filename=%s", xmlSecErrorsSafeString(filename));
+        xmlSecDtdIDsCacheEntryDestroy(entry);
+        return(NULL);
+    }
+
+    /* collect the ID attributes declarations */
+    for(cur = entry->dtd->children; cur != NULL; cur = cur->next) {
+        if((cur->type == XML_ATTRIBUTE_DECL) && (((xmlAttributePtr)cur)->atype == XML_ATTRIBUTE_ID)) {
+            ++entry->rulesSize;
+        }
+    }
+    if(entry->rulesSize == 0) {
+        return(entry);
+    }
+    entry->rules = (xmlSecIDAttrRule*)xmlMalloc(sizeof(xmlSecIDAttrRule) * entry->rulesSize);
+    if(entry->rules == NULL) {
+        xmlSecMallocError(sizeof(xmlSecIDAttrRule) * entry->rulesSize, NULL);
+        xmlSecDtdIDsCacheEntryDestroy(entry);
+        return(NULL);
+    }
+    memset(entry->rules, 0, sizeof(xmlSecIDAttrRule) * entry->rulesSize);
+
+    for(cur = entry->dtd->children, ii = 0; (cur != NULL) && (ii < entry->rulesSize); cur = cur->next) {
+        if((cur->type != XML_ATTRIBUTE_DECL) || (((xmlAttributePtr)cur)->atype != XML_ATTRIBUTE_ID)) {
+            continue;
+        }
+        attrDecl = (xmlAttributePtr)cur;
+
+        /* the DTD doesn't know namespaces: match the element local name in any namespace */
+        p = (attrDecl->elem != NULL) ? xmlStrchr(attrDecl->elem, ':') : NULL;
+        entry->rules[ii].attrName = attrDecl->name;
+        entry->rules[ii].nodeName = (p != NULL) ? (p + 1) : attrDecl->elem;
+        entry->rules[ii].nodeNsHref = NULL;
+        ++ii;
+    }
+    return(entry);
+}
+
+/* returns the referenced entry or NULL if not found */
+static xmlSecDtdIDsCacheEntryPtr
+xmlSecDtdIDsCacheFind(const char* filename, time_t mtime) {
+    xmlSecDtdIDsCacheEntryPtr entry;
+    xmlSecDtdIDsCacheEntryPtr res = NULL;
+    xmlSecSize ii;
+
+    xmlSecAssert2(filename != NULL, NULL);
+    xmlSecAssert2(gXmlSecDtdIDsCacheMutex != NULL, NULL);
+
+    xmlMutexLock(gXmlSecDtdIDsCacheMutex);
+    for(ii = 0; ii < gXmlSecDtdIDsCacheMaxSize; ++ii) {
+        entry = gXmlSecDtdIDsCacheEntries[ii];
+        if((entry != NULL) && (entry->mtime == mtime) && (xmlStrEqual(BAD_CAST entry->filename, BAD_CAST filename))) {
+            ++(entry->refs);
+            res = entry;
+            break;
+        }
+    }
+    xmlMutexUnlock(gXmlSecDtdIDsCacheMutex);
+    return(res);
+}
+
+static void
+xmlSecDtdIDsCacheAdd(xmlSecDtdIDsCacheEntryPtr entry) {
+    xmlSecDtdIDsCacheEntryPtr old = NULL;
+    xmlSecDtdIDsCacheEntryPtr cur;
+    xmlSecSize ii;
+
+    xmlSecAssert(entry != NULL);
+    xmlSecAssert(gXmlSecDtdIDsCacheMutex != NULL);
+
+    xmlMutexLock(gXmlSecDtdIDsCacheMutex);
+    /* replace the stale entry for the same file (the file was modified) */
+    for(ii = 0; ii < gXmlSecDtdIDsCacheMaxSize; ++ii) {
+        cur = gXmlSecDtdIDsCacheEntries[ii];
+        if((cur != NULL) && (xmlStrEqual(BAD_CAST cur->filename, BAD_CAST entry->filename))) {
+            break;
+        }
+    }
+    if(ii >= gXmlSecDtdIDsCacheMaxSize) {
+        if(gXmlSecDtdIDsCachePos >= gXmlSecDtdIDsCacheMaxSize) {
+            gXmlSecDtdIDsCachePos = 0;
+        }
+        ii = gXmlSecDtdIDsCachePos++;
+    }
+    old = gXmlSecDtdIDsCacheEntries[ii];
+    gXmlSecDtdIDsCacheEntries[ii] = entry;
+    ++(entry->refs);
+    xmlMutexUnlock(gXmlSecDtdIDsCacheMutex);
+
+    if(old != NULL) {
+        xmlSecDtdIDsCacheEntryRelease(old);
+    }
+}
+
+/**
+ * xmlSecDtdIDsEnableCache:
+ * @maxSize:            the max number of cached DTDs.
+ *
+ * Enables the process wide cache of the DTDs used by #xmlSecAddDtdIDs:
+ * each DTD file is parsed once (until it is modified). This function is
+ * not thread safe and should be called during the application initialization.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecDtdIDsEnableCache(xmlSecSize maxSize) {
+    xmlSecAssert2(maxSize > 0, -1);
+
+    xmlSecDtdIDsDisableCache();
+
+    gXmlSecDtdIDsCacheEntries = (xmlSecDtdIDsCacheEntryPtr*)xmlMalloc(sizeof(xmlSecDtdIDsCacheEntryPtr) * maxSize);
+    if(gXmlSecDtdIDsCacheEntries == NULL) {
+        xmlSecMallocError(sizeof(xmlSecDtdIDsCacheEntryPtr) * maxSize, NULL);
+        return(-1);
+    }
+    memset(gXmlSecDtdIDsCacheEntries, 0, sizeof(xmlSecDtdIDsCacheEntryPtr) * maxSize);
+
+    gXmlSecDtdIDsCacheMutex = xmlNewMutex();
+    if(gXmlSecDtdIDsCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+        xmlFree(gXmlSecDtdIDsCacheEntries);
+        gXmlSecDtdIDsCacheEntries = NULL;
+        return(-1);
+    }
+    gXmlSecDtdIDsCacheMaxSize = maxSize;
+    gXmlSecDtdIDsCachePos = 0;
+    return(0);
+}
+
+/**
+ * xmlSecDtdIDsDisableCache:
+ *
+ * Disables the DTDs cache and releases the cached DTDs. This function
+ * is not thread safe and is called from #xmlSecShutdown.
+ */
+void
+xmlSecDtdIDsDisableCache(void) {
+    xmlSecSize ii;
+
+    if(gXmlSecDtdIDsCacheEntries != NULL) {
+        for(ii = 0; ii < gXmlSecDtdIDsCacheMaxSize; ++ii) {
+            if(gXmlSecDtdIDsCacheEntries[ii] != NULL) {
+                xmlSecDtdIDsCacheEntryRelease(gXmlSecDtdIDsCacheEntries[ii]);
+                gXmlSecDtdIDsCacheEntries[ii] = NULL;
+            }
+        }
+        xmlFree(gXmlSecDtdIDsCacheEntries);
+        gXmlSecDtdIDsCacheEntries = NULL;
+    }
+    if(gXmlSecDtdIDsCacheMutex != NULL) {
+        xmlFreeMutex(gXmlSecDtdIDsCacheMutex);
+        gXmlSecDtdIDsCacheMutex = NULL;
+    }
+    gXmlSecDtdIDsCacheMaxSize = 0;
+    gXmlSecDtdIDsCachePos = 0;
+}
+
+/**
+ * xmlSecAddDtdIDs:
+ * @doc:                the pointer to an XML document.
+ * @cur:                the pointer to an XML node (NULL for the whole document).
+ * @filename:           the DTD file name.
+ *
+ * Adds the attributes declared with the ID type in the @filename DTD
+ * to the @doc document IDs attributes hash (see #xmlSecAddIDAttrs).
+ * Unlike the DTD validation, only the ID attributes declarations are
+ * applied. The DTD elements names are matched with the elements local
+ * names in any namespace. If the DTDs cache is enabled (see
+ * #xmlSecDtdIDsEnableCache) then the DTD file is parsed only once.
+ *
+ * Returns: 0 on success or a negative value if an error occurs.
+ */
+int
+xmlSecAddDtdIDs(xmlDocPtr doc, xmlNodePtr cur, const char* filename) {
+    xmlSecDtdIDsCacheEntryPtr entry = NULL;
+    struct stat st;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(doc != NULL, -1);
+    xmlSecAssert2(filename != NULL, -1);
+
+    ret = stat(filename, &st);
+    if(ret != 0) {
+        xmlSecIOError("stat", filename, NULL);
+        goto done;
+    }
+
+    if(gXmlSecDtdIDsCacheMutex != NULL) {
+        entry = xmlSecDtdIDsCacheFind(filename, st.st_mtime);
+        xmlSecStatsCacheLookup(xmlSecStatsCacheDtd, (entry != NULL) ? 1 : 0);
+    }
+    if(entry == NULL) {
+        entry = xmlSecDtdIDsCacheEntryCreate(filename, st.st_mtime);
+        if(entry == NULL) {
+            xmlSecInternalError2("xmlSecDtdIDsCacheEntryCreate", NULL,
+                "filename=%s", xmlSecErrorsSafeString(filename));
+            goto done;
+        }
+        if(gXmlSecDtdIDsCacheMutex != NULL) {
+            xmlSecDtdIDsCacheAdd(entry);
+        }
+    }
+
+    if(entry->rulesSize > 0) {
+        ret = xmlSecAddIDAttrs(doc, cur, entry->rules, entry->rulesSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecAddIDAttrs", NULL,
+                "filename=%s", xmlSecErrorsSafeString(filename));
+            goto done;
+        }
+    }
+
+    /* success */
+    res = 0;
+
+done:
+    if(entry != NULL) {
+        xmlSecDtdIDsCacheEntryRelease(entry);
+    }
+    return(res);
+}
+
+static int
+xmlSecAddIDAttrsNode(xmlDocPtr doc, xmlNodePtr node, void* context) {
+    xmlSecIDAttrRules* ctx = (xmlSecIDAttrRules*)context;
+    const xmlSecIDAttrRule* rules;
+    xmlAttrPtr attr, tmp;
+    xmlChar* id;
+    xmlSecSize ii;
+
+    xmlSecAssert2(doc != NULL, -1);
+    xmlSecAssert2(node != NULL, -1);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->rules != NULL, -1);
+
+    rules = ctx->rules;
+    for(attr = node->properties; attr != NULL; attr = attr->next) {
+        for(ii = 0; ii < ctx->rulesSize; ++ii) {
+            if(!xmlStrEqual(attr->name, rules[ii].attrName)) {
+                continue;
+            }
+            if((rules[ii].nodeName != NULL) && !xmlStrEqual(node->name, rules[ii].nodeName)) {
+                continue;
+            }
+            if((rules[ii].nodeNsHref != NULL) && (node->ns != NULL) && !xmlStrEqual(node->ns->href, rules[ii].nodeNsHref)) {
+                continue;
+            }
+
+            id = xmlNodeListGetString(doc, attr->children, 1);
+            if(id == NULL) {
+                break;
+            }
+            tmp = xmlGetID(doc, id);
+            if(tmp == NULL) {
+                if(xmlAddID(NULL, doc, id, attr) == NULL) {
+                    xmlSecXmlError2("xmlAddID", NULL, "id=%s", xmlSecErrorsSafeString(id));
+                    xmlFree(id);
+                    return(-1);
                 }
+            } else if(tmp != attr) {
+                xmlSecInvalidStringDataError("id", id, "unique id (id already defined)", NULL);
+                xmlFree(id);
+                return(-1);
             }
+            xmlFree(id);
+
+            /* the attribute is registered, the other rules don't matter */
+            break;
         }
+    }
+    return(0);
+}
+
+/*
+ * Calls @callback in the document order for the elements in the @cur subtree
+ * (or in the whole @doc if @cur is NULL) that have an attribute with one of
+ * the @names, the elements are found in the document index attributes owners
+ * lists instead of walking the tree. Returns 1 if the index was used, 0 if
+ * @doc doesn't have an index (the caller walks the tree) or a negative value
+ * if an error occurs.
+ */
+static int
+xmlSecAddIDsWithIndex(xmlDocPtr doc, xmlNodePtr cur, const xmlChar** names, xmlSecSize namesSize,
+                      xmlSecAddIDsNodeCallback callback, void* context) {
+    xmlSecDocIndexPtr index;
+    xmlSecDocIndexNamePtr* owners = NULL;
+    xmlSecSize* positions = NULL;
+    xmlSecSize first = 0, last = 0, next;
+    xmlSecSize ii, ownersSize = 0;
+    int res = -1;
+    int ret;
+
+    xmlSecAssert2(doc != NULL, -1);
+    xmlSecAssert2(names != NULL, -1);
+    xmlSecAssert2(callback != NULL, -1);
+
+    index = xmlSecDocIndexAcquire(doc);
+    if(index == NULL) {
+        return(0);
+    }
+    ret = xmlSecDocIndexGetRange(index, cur, &first, &last);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecDocIndexGetRange", NULL);
+        return(-1);
+    } else if(ret == 0) {
+        /* the element is not indexed (e.g. not in the document tree yet) */
+        return((cur != NULL) ? 0 : 1);
+    }
+    if(namesSize == 0) {
+        return(1);
+    }
 
-        children = cur->children;
-    } else if(cur == NULL) {
-        children = doc->children;
+    owners = (xmlSecDocIndexNamePtr*)xmlMalloc(namesSize * sizeof(xmlSecDocIndexNamePtr));
+    positions = (xmlSecSize*)xmlMalloc(namesSize * sizeof(xmlSecSize));
+    if((owners == NULL) || (positions == NULL)) {
+        xmlSecMallocError(namesSize * (sizeof(xmlSecDocIndexNamePtr) + sizeof(xmlSecSize)), NULL);
+        goto done;
+    }
+    for(ii = 0; ii < namesSize; ++ii) {
+        owners[ownersSize] = xmlSecDocIndexGetAttrOwners(index, names[ii]);
+        if(owners[ownersSize] != NULL) {
+            positions[ownersSize] = xmlSecDocIndexLowerBound(owners[ownersSize], first);
+            ++ownersSize;
+        }
     }
 
-    while(children != NULL) {
-        if(children->type == XML_ELEMENT_NODE) {
-            xmlSecAddIDs(doc, children, ids);
+    /* merge the sorted owners lists: each element is processed once in the document order */
+    while(1) {
+        next = last + 1;
+        for(ii = 0; ii < ownersSize; ++ii) {
+            if((positions[ii] < owners[ii]->size) && (owners[ii]->ordinals[positions[ii]] < next)) {
+                next = owners[ii]->ordinals[positions[ii]];
+            }
         }
-        children = children->next;
+        if(next > last) {
+            break;
+        }
+        for(ii = 0; ii < ownersSize; ++ii) {
+            if((positions[ii] < owners[ii]->size) && (owners[ii]->ordinals[positions[ii]] == next)) {
+                ++positions[ii];
+            }
+        }
+
+        ret = callback(doc, xmlSecDocIndexGetElement(index, next), context);
+        if(ret < 0) {
+            xmlSecInternalError("callback", NULL);
+            goto done;
+        }
+    }
+
+    /* done */
+    res = 1;
+
+done:
+    if(owners != NULL) {
+        xmlFree(owners);
     }
+    if(positions != NULL) {
+        xmlFree(positions);
+    }
+    return(res);
 }
 
 /**
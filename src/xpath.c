@@ -18,18 +18,23 @@
 #include <string.h>
 
 #include <libxml/tree.h>
+#include <libxml/chvalid.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
 #include <libxml/xpointer.h>
+#include <libxml/threads.h>
 
 #include <xmlsec/xmlsec.h>
 #include <xmlsec/xmltree.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/list.h>
 #include <xmlsec/transforms.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/errors.h>
 
 #include "cast_helpers.h"
+#include "docindex_helpers.h"
+#include "transform_helpers.h"
 
 /**************************************************************************
  *
@@ -52,6 +57,216 @@ xmlSecXPathHereFunction(xmlXPathParserContextPtr ctxt, int nargs) {
     valuePush(ctxt, xmlXPathNewNodeSet(ctxt->context->here));
 }
 
+/**************************************************************************
+ *
+ * Compiled XPath expressions cache: the same expressions are used again
+ * and again for all the documents so we compile each expression once
+ * and share the compiled expression. The namespace prefixes are resolved
+ * by LibXML2 during the evaluation using the XPath context, thus the
+ * compiled expression does not depend on the namespace bindings and
+ * the expression string is the only key. The cache entries are never
+ * removed until the library shutdown, thus the pointers to the compiled
+ * expressions stay valid.
+ *
+ *****************************************************************************/
+#define XMLSEC_XPATH_CACHE_TABLE_SIZE           64
+#define XMLSEC_XPATH_CACHE_MAX_SIZE             256
+
+typedef struct _xmlSecXPathCacheEntry           xmlSecXPathCacheEntry,
+                                                *xmlSecXPathCacheEntryPtr;
+struct _xmlSecXPathCacheEntry {
+    xmlSecXPathCacheEntryPtr            next;
+    xmlChar*                            expr;
+    xmlXPathCompExprPtr                 comp;
+};
+
+static xmlMutexPtr              gXmlSecXPathCacheMutex = NULL;
+static xmlSecXPathCacheEntryPtr gXmlSecXPathCacheTable[XMLSEC_XPATH_CACHE_TABLE_SIZE];
+static xmlSecSize               gXmlSecXPathCacheSize = 0;
+static xmlSecSize               gXmlSecXPathCacheHits = 0;
+static xmlSecSize               gXmlSecXPathCacheMisses = 0;
+
+/**
+ * xmlSecTransformXPathCacheInitialize:
+ *
+ * Initializes the compiled XPath expressions cache. If the cache can't be
+ * initialized then expressions are compiled for each use.
+ */
+void
+xmlSecTransformXPathCacheInitialize(void) {
+    xmlSecAssert(gXmlSecXPathCacheMutex == NULL);
+
+    memset(gXmlSecXPathCacheTable, 0, sizeof(gXmlSecXPathCacheTable));
+    gXmlSecXPathCacheSize = 0;
+    gXmlSecXPathCacheHits = 0;
+    gXmlSecXPathCacheMisses = 0;
+
+    gXmlSecXPathCacheMutex = xmlNewMutex();
+    if(gXmlSecXPathCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+    }
+}
+
+/**
+ * xmlSecTransformXPathCacheShutdown:
+ *
+ * Frees all the compiled XPath expressions from the cache.
+ */
+void
+xmlSecTransformXPathCacheShutdown(void) {
+    xmlSecXPathCacheEntryPtr entry;
+    xmlSecSize ii;
+
+    for(ii = 0; ii < XMLSEC_XPATH_CACHE_TABLE_SIZE; ++ii) {
+        while(gXmlSecXPathCacheTable[ii] != NULL) {
+            entry = gXmlSecXPathCacheTable[ii];
+            gXmlSecXPathCacheTable[ii] = entry->next;
+
+            xmlXPathFreeCompExpr(entry->comp);
+            xmlFree(entry->expr);
+            xmlFree(entry);
+        }
+    }
+    gXmlSecXPathCacheSize = 0;
+
+    if(gXmlSecXPathCacheMutex != NULL) {
+        xmlFreeMutex(gXmlSecXPathCacheMutex);
+        gXmlSecXPathCacheMutex = NULL;
+    }
+}
+
+/**
+ * xmlSecTransformXPathGetCacheStats:
+ * @hits:               the pointer to the cache hits counter (may be NULL).
+ * @misses:             the pointer to the cache misses counter (may be NULL).
+ *
+ * Gets the compiled XPath expressions cache statistics (the expressions
+ * found in the cache and the expressions compiled) since the library
+ * initialization.
+ */
+void
+xmlSecTransformXPathGetCacheStats(xmlSecSize* hits, xmlSecSize* misses) {
+    if(gXmlSecXPathCacheMutex != NULL) {
+        xmlMutexLock(gXmlSecXPathCacheMutex);
+    }
+    if(hits != NULL) {
+        (*hits) = gXmlSecXPathCacheHits;
+    }
+    if(misses != NULL) {
+        (*misses) = gXmlSecXPathCacheMisses;
+    }
+    if(gXmlSecXPathCacheMutex != NULL) {
+        xmlMutexUnlock(gXmlSecXPathCacheMutex);
+    }
+}
+
+static xmlSecSize
+xmlSecXPathCacheHash(const xmlChar* expr) {
+    xmlSecSize hash = 5381;
+
+    xmlSecAssert2(expr != NULL, 0);
+
+    for(; (*expr) != '\0'; ++expr) {
+        hash = ((hash << 5) + hash) + (*expr);
+    }
+    return(hash % XMLSEC_XPATH_CACHE_TABLE_SIZE);
+}
+
+/*
+ * Returns the compiled expression: either from the cache (@owned is set to 0)
+ * or a newly compiled one that the caller has to free with xmlXPathFreeCompExpr()
+ * (@owned is set to 1).
+ */
+static xmlXPathCompExprPtr
+xmlSecXPathCacheGet(const xmlChar* expr, int* owned) {
+    xmlSecXPathCacheEntryPtr entry;
+    xmlXPathCompExprPtr comp;
+    xmlSecSize hash;
+
+    xmlSecAssert2(expr != NULL, NULL);
+    xmlSecAssert2(owned != NULL, NULL);
+
+    (*owned) = 0;
+    if(gXmlSecXPathCacheMutex == NULL) {
+        comp = xmlXPathCompile(expr);
+        if(comp == NULL) {
+            xmlSecXmlError2("xmlXPathCompile", NULL,
+                "expr=%s", xmlSecErrorsSafeString(expr));
+            return(NULL);
+        }
+        (*owned) = 1;
+        return(comp);
+    }
+
+    hash = xmlSecXPathCacheHash(expr);
+
+    xmlMutexLock(gXmlSecXPathCacheMutex);
+    for(entry = gXmlSecXPathCacheTable[hash]; entry != NULL; entry = entry->next) {
+        if(xmlStrEqual(entry->expr, expr)) {
+            ++gXmlSecXPathCacheHits;
+            comp = entry->comp;
+            xmlMutexUnlock(gXmlSecXPathCacheMutex);
+            xmlSecStatsCacheLookup(xmlSecStatsCacheXPath, 1);
+            return(comp);
+        }
+    }
+    ++gXmlSecXPathCacheMisses;
+    xmlMutexUnlock(gXmlSecXPathCacheMutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheXPath, 0);
+
+    /* compile outside of the lock */
+    comp = xmlXPathCompile(expr);
+    if(comp == NULL) {
+        xmlSecXmlError2("xmlXPathCompile", NULL,
+            "expr=%s", xmlSecErrorsSafeString(expr));
+        return(NULL);
+    }
+
+    entry = (xmlSecXPathCacheEntryPtr)xmlMalloc(sizeof(xmlSecXPathCacheEntry));
+    if(entry == NULL) {
+        xmlSecMallocError(sizeof(xmlSecXPathCacheEntry), NULL);
+        /* not fatal, just use it once */
+        (*owned) = 1;
+        return(comp);
+    }
+    memset(entry, 0, sizeof(xmlSecXPathCacheEntry));
+    entry->expr = xmlStrdup(expr);
+    if(entry->expr == NULL) {
+        xmlSecStrdupError(expr, NULL);
+        xmlFree(entry);
+        (*owned) = 1;
+        return(comp);
+    }
+    entry->comp = comp;
+
+    xmlMutexLock(gXmlSecXPathCacheMutex);
+    {
+        xmlSecXPathCacheEntryPtr cur;
+
+        /* someone else might have added it while we were compiling */
+        for(cur = gXmlSecXPathCacheTable[hash]; cur != NULL; cur = cur->next) {
+            if(xmlStrEqual(cur->expr, expr)) {
+                break;
+            }
+        }
+        if((cur == NULL) && (gXmlSecXPathCacheSize < XMLSEC_XPATH_CACHE_MAX_SIZE)) {
+            entry->next = gXmlSecXPathCacheTable[hash];
+            gXmlSecXPathCacheTable[hash] = entry;
+            ++gXmlSecXPathCacheSize;
+            entry = NULL;
+        }
+    }
+    xmlMutexUnlock(gXmlSecXPathCacheMutex);
+
+    if(entry != NULL) {
+        /* cache is full or the expression is already there */
+        xmlFree(entry->expr);
+        xmlFree(entry);
+        (*owned) = 1;
+    }
+    return(comp);
+}
+
 /**************************************************************************
  *
  * XPath/XPointer data
@@ -62,13 +277,16 @@ typedef struct _xmlSecXPathData                 xmlSecXPathData,
 typedef enum {
     xmlSecXPathDataTypeXPath,
     xmlSecXPathDataTypeXPath2,
-    xmlSecXPathDataTypeXPointer
+    xmlSecXPathDataTypeXPointer,
+    xmlSecXPathDataTypeId                       /* "xpointer(id('...'))", expr is the ID value */
 } xmlSecXPathDataType;
 
 struct _xmlSecXPathData {
     xmlSecXPathDataType                 type;
     xmlXPathContextPtr                  ctx;
     xmlChar*                            expr;
+    xmlXPathCompExprPtr                 comp;
+    int                                 compOwned;
     xmlSecNodeSetOp                     nodeSetOp;
     xmlSecNodeSetType                   nodeSetType;
 };
@@ -84,6 +302,9 @@ static int                      xmlSecXPathDataNodeRead         (xmlSecXPathData
 static xmlSecNodeSetPtr         xmlSecXPathDataExecute          (xmlSecXPathDataPtr data,
                                                                  xmlDocPtr doc,
                                                                  xmlNodePtr hereNode);
+static xmlSecNodeSetPtr         xmlSecXPathDataExecuteId        (xmlSecXPathDataPtr data,
+                                                                 xmlDocPtr doc);
+static xmlChar*                 xmlSecXPathGetIdFromXPointer    (const xmlChar* expr);
 
 static xmlSecXPathDataPtr
 xmlSecXPathDataCreate(xmlSecXPathDataType type) {
@@ -118,6 +339,9 @@ xmlSecXPathDataCreate(xmlSecXPathDataType type) {
             return(NULL);
         }
         break;
+    case xmlSecXPathDataTypeId:
+        /* no context is needed, we use xmlGetID() directly */
+        break;
     }
 
     return(data);
@@ -130,6 +354,9 @@ xmlSecXPathDataDestroy(xmlSecXPathDataPtr data) {
     if(data->expr != NULL) {
         xmlFree(data->expr);
     }
+    if((data->comp != NULL) && (data->compOwned != 0)) {
+        xmlXPathFreeCompExpr(data->comp);
+    }
     if(data->ctx != NULL) {
         xmlXPathFreeContext(data->ctx);
     }
@@ -141,7 +368,7 @@ static int
 xmlSecXPathDataSetExpr(xmlSecXPathDataPtr data, const xmlChar* expr) {
     xmlSecAssert2(data != NULL, -1);
     xmlSecAssert2(data->expr == NULL, -1);
-    xmlSecAssert2(data->ctx != NULL, -1);
+    xmlSecAssert2((data->ctx != NULL) || (data->type == xmlSecXPathDataTypeId), -1);
     xmlSecAssert2(expr != NULL, -1);
 
     data->expr = xmlStrdup(expr);
@@ -155,6 +382,7 @@ xmlSecXPathDataSetExpr(xmlSecXPathDataPtr data, const xmlChar* expr) {
 
 static int
 xmlSecXPathDataRegisterNamespaces(xmlSecXPathDataPtr data, xmlNodePtr node) {
+    xmlSecDocIndexPtr index;
     xmlNodePtr cur;
     xmlNsPtr ns;
     int ret;
@@ -163,8 +391,9 @@ xmlSecXPathDataRegisterNamespaces(xmlSecXPathDataPtr data, xmlNodePtr node) {
     xmlSecAssert2(data->ctx != NULL, -1);
     xmlSecAssert2(node != NULL, -1);
 
-    /* register namespaces */
-    for(cur = node; cur != NULL; cur = cur->parent) {
+    /* register namespaces (the document index skips the ancestors without declarations) */
+    index = xmlSecDocIndexAcquire(node->doc);
+    for(cur = node; cur != NULL; cur = xmlSecDocIndexGetNextNsHolder(index, cur)) {
         for(ns = cur->nsDef; ns != NULL; ns = ns->next) {
             /* check that we have no other namespace with same prefix already */
             if((ns->prefix != NULL) && (xmlXPathNsLookup(data->ctx, ns->prefix) == NULL)){
@@ -213,13 +442,21 @@ xmlSecXPathDataExecute(xmlSecXPathDataPtr data, xmlDocPtr doc, xmlNodePtr hereNo
 
     xmlSecAssert2(data != NULL, NULL);
     xmlSecAssert2(data->expr != NULL, NULL);
-    xmlSecAssert2(data->ctx != NULL, NULL);
     xmlSecAssert2(doc != NULL, NULL);
     xmlSecAssert2(hereNode != NULL, NULL);
 
+    /* same document ID reference doesn't need XPath engine */
+    if(data->type == xmlSecXPathDataTypeId) {
+        return(xmlSecXPathDataExecuteId(data, doc));
+    }
+    xmlSecAssert2(data->ctx != NULL, NULL);
+
     /* do not forget to set the doc */
     data->ctx->doc = doc;
 
+    /* the up to date document index has the elements ordinals set for sorting the results */
+    (void)xmlSecDocIndexAcquire(doc);
+
     /* here function works only on the same document */
     if(hereNode->doc == doc) {
         xmlXPathRegisterFunc(data->ctx, (xmlChar *)"here", xmlSecXPathHereFunction);
@@ -231,9 +468,17 @@ xmlSecXPathDataExecute(xmlSecXPathDataPtr data, xmlDocPtr doc, xmlNodePtr hereNo
     switch(data->type) {
     case xmlSecXPathDataTypeXPath:
     case xmlSecXPathDataTypeXPath2:
-        xpathObj = xmlXPathEvalExpression(data->expr, data->ctx);
+        if(data->comp == NULL) {
+            data->comp = xmlSecXPathCacheGet(data->expr, &(data->compOwned));
+            if(data->comp == NULL) {
+                xmlSecInternalError2("xmlSecXPathCacheGet", NULL,
+                                     "expr=%s", xmlSecErrorsSafeString(data->expr));
+                return(NULL);
+            }
+        }
+        xpathObj = xmlXPathCompiledEval(data->comp, data->ctx);
         if(xpathObj == NULL) {
-            xmlSecXmlError2("xmlXPathEvalExpression", NULL,
+            xmlSecXmlError2("xmlXPathCompiledEval", NULL,
                             "expr=%s", xmlSecErrorsSafeString(data->expr));
             return(NULL);
         }
@@ -278,6 +523,84 @@ xmlSecXPathDataExecute(xmlSecXPathDataPtr data, xmlDocPtr doc, xmlNodePtr hereNo
 }
 
 
+static xmlSecNodeSetPtr
+xmlSecXPathDataExecuteId(xmlSecXPathDataPtr data, xmlDocPtr doc) {
+    xmlNodeSetPtr nodeSet;
+    xmlSecNodeSetPtr nodes;
+    xmlAttrPtr attr;
+    xmlNodePtr node = NULL;
+
+    xmlSecAssert2(data != NULL, NULL);
+    xmlSecAssert2(data->type == xmlSecXPathDataTypeId, NULL);
+    xmlSecAssert2(data->expr != NULL, NULL);
+    xmlSecAssert2(doc != NULL, NULL);
+
+    /* same as XPath id() function: the element or an empty node set if not found */
+    attr = xmlGetID(doc, data->expr);
+    if(attr != NULL) {
+        if(attr->type == XML_ATTRIBUTE_NODE) {
+            node = attr->parent;
+        } else if(attr->type == XML_ELEMENT_NODE) {
+            node = (xmlNodePtr)attr;
+        }
+    }
+
+    nodeSet = xmlXPathNodeSetCreate(node);
+    if(nodeSet == NULL) {
+        xmlSecXmlError2("xmlXPathNodeSetCreate", NULL,
+                        "id=\"%s\"", xmlSecErrorsSafeString(data->expr));
+        return(NULL);
+    }
+
+    nodes = xmlSecNodeSetCreate(doc, nodeSet, data->nodeSetType);
+    if(nodes == NULL) {
+        xmlSecInternalError2("xmlSecNodeSetCreate", NULL,
+            "type=" XMLSEC_ENUM_FMT, XMLSEC_ENUM_CAST(data->nodeSetType));
+        xmlXPathFreeNodeSet(nodeSet);
+        return(NULL);
+    }
+    return(nodes);
+}
+
+/*
+ * Returns the ID value if @expr is "xpointer(id('ID'))" (or with double quotes)
+ * with a single ID that can be resolved with xmlGetID() directly, or NULL otherwise.
+ * The caller is responsible for freeing the returned string.
+ */
+static xmlChar*
+xmlSecXPathGetIdFromXPointer(const xmlChar* expr) {
+    static const char prefix[] = "xpointer(id(";
+    const xmlChar* start;
+    const xmlChar* end;
+    xmlChar quote;
+    int len;
+
+    xmlSecAssert2(expr != NULL, NULL);
+
+    if(xmlStrncmp(expr, BAD_CAST prefix, sizeof(prefix) - 1) != 0) {
+        return(NULL);
+    }
+    start = expr + sizeof(prefix) - 1;
+    quote = (*start);
+    if((quote != '\'') && (quote != '\"')) {
+        return(NULL);
+    }
+    ++start;
+
+    /* id() splits the argument on whitespaces, XPointer escapes ^, ( and ) */
+    for(end = start; ((*end) != '\0') && ((*end) != quote); ++end) {
+        if(xmlIsBlank_ch(*end) || ((*end) == '^') || ((*end) == '(') || ((*end) == ')')) {
+            return(NULL);
+        }
+    }
+    if((end == start) || ((*end) != quote) || (xmlStrcmp(end + 1, BAD_CAST "))") != 0)) {
+        return(NULL);
+    }
+
+    XMLSEC_SAFE_CAST_PTRDIFF_TO_INT((end - start), len, return(NULL), NULL);
+    return(xmlStrndup(start, len));
+}
+
 /**************************************************************************
  *
  * XPath data list
@@ -759,6 +1082,7 @@ xmlSecTransformXPointerSetExpr(xmlSecTransformPtr transform, const xmlChar* expr
                             xmlSecNodeSetType  nodeSetType, xmlNodePtr hereNode) {
     xmlSecPtrListPtr dataList;
     xmlSecXPathDataPtr data;
+    xmlChar* id;
     int ret;
 
     xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformXPointerId), -1);
@@ -772,27 +1096,40 @@ xmlSecTransformXPointerSetExpr(xmlSecTransformPtr transform, const xmlChar* expr
     xmlSecAssert2(xmlSecPtrListCheckId(dataList, xmlSecXPathDataListId), -1);
     xmlSecAssert2(xmlSecPtrListGetSize(dataList) == 0, -1);
 
-    data = xmlSecXPathDataCreate(xmlSecXPathDataTypeXPointer);
-    if(data == NULL) {
-        xmlSecInternalError("xmlSecXPathDataCreate",
-                            xmlSecTransformGetName(transform));
-        return(-1);
-    }
+    /* the most common case "#id" or "#xpointer(id('id'))": use ID directly */
+    id = xmlSecXPathGetIdFromXPointer(expr);
+    if(id != NULL) {
+        data = xmlSecXPathDataCreate(xmlSecXPathDataTypeId);
+        if(data == NULL) {
+            xmlSecInternalError("xmlSecXPathDataCreate",
+                                xmlSecTransformGetName(transform));
+            xmlFree(id);
+            return(-1);
+        }
+        data->expr = id;
+    } else {
+        data = xmlSecXPathDataCreate(xmlSecXPathDataTypeXPointer);
+        if(data == NULL) {
+            xmlSecInternalError("xmlSecXPathDataCreate",
+                                xmlSecTransformGetName(transform));
+            return(-1);
+        }
 
-    ret = xmlSecXPathDataRegisterNamespaces(data, hereNode);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecXPathDataRegisterNamespaces",
-                            xmlSecTransformGetName(transform));
-        xmlSecXPathDataDestroy(data);
-        return(-1);
-    }
+        ret = xmlSecXPathDataRegisterNamespaces(data, hereNode);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecXPathDataRegisterNamespaces",
+                                xmlSecTransformGetName(transform));
+            xmlSecXPathDataDestroy(data);
+            return(-1);
+        }
 
-    ret = xmlSecXPathDataSetExpr(data, expr);
-    if(ret < 0) {
-        xmlSecInternalError("xmlSecXPathDataSetExpr",
-                            xmlSecTransformGetName(transform));
-        xmlSecXPathDataDestroy(data);
-        return(-1);
+        ret = xmlSecXPathDataSetExpr(data, expr);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecXPathDataSetExpr",
+                                xmlSecTransformGetName(transform));
+            xmlSecXPathDataDestroy(data);
+            return(-1);
+        }
     }
 
     /* append it to the list */
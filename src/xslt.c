@@ -22,8 +22,11 @@
 #include <string.h>
 
 #include <libxml/tree.h>
+#include <libxml/parserInternals.h>
+#include <libxml/threads.h>
 #include <libxslt/xslt.h>
 #include <libxslt/xsltInternals.h>
+#include <libxslt/imports.h>
 #include <libxslt/transform.h>
 #include <libxslt/xsltutils.h>
 
@@ -33,6 +36,7 @@
 #include <xmlsec/transforms.h>
 #include <xmlsec/keys.h>
 #include <xmlsec/parser.h>
+#include <xmlsec/stats.h>
 #include <xmlsec/errors.h>
 #include "xslt.h"
 
@@ -46,6 +50,7 @@
 typedef struct _xmlSecXsltCtx                   xmlSecXsltCtx, *xmlSecXsltCtxPtr;
 struct _xmlSecXsltCtx {
     xsltStylesheetPtr   xslt;
+    int                 xsltCached;
     xmlParserCtxtPtr    parserCtx;
 };
 
@@ -69,6 +74,12 @@ static int              xmlSecXsltPushBin                       (xmlSecTransform
                                                                  xmlSecSize dataSize,
                                                                  int final,
                                                                  xmlSecTransformCtxPtr transformCtx);
+static int              xmlSecXsltPopXml                        (xmlSecTransformPtr transform,
+                                                                 xmlSecNodeSetPtr* nodes,
+                                                                 xmlSecTransformCtxPtr transformCtx);
+static xmlSecTransformDataType xmlSecXsltGetDataType            (xmlSecTransformPtr transform,
+                                                                 xmlSecTransformMode mode,
+                                                                 xmlSecTransformCtxPtr transformCtx);
 static int              xmlSecXsltExecute                       (xmlSecTransformPtr transform,
                                                                  int last,
                                                                  xmlSecTransformCtxPtr transformCtx);
@@ -77,6 +88,8 @@ static int              xmlSecXslProcess                        (xmlSecXsltCtxPt
                                                                  xmlSecBufferPtr out);
 static xmlDocPtr        xmlSecXsApplyStylesheet                 (xmlSecXsltCtxPtr ctx,
                                                                  xmlDocPtr doc);
+static xmlSecNodeSetPtr xmlSecXsltResultToNodeSet               (xmlSecXsltCtxPtr ctx,
+                                                                 xmlDocPtr docOut);
 
 static xmlSecTransformKlass xmlSecXsltKlass = {
     /* klass/object sizes */
@@ -94,11 +107,11 @@ static xmlSecTransformKlass xmlSecXsltKlass = {
     NULL,                                       /* xmlSecTransformSetKeyReqMethod setKeyReq; */
     NULL,                                       /* xmlSecTransformSetKeyMethod setKey; */
     NULL,                                       /* xmlSecTransformValidateMethod validate; */
-    xmlSecTransformDefaultGetDataType,          /* xmlSecTransformGetDataTypeMethod getDataType; */
+    xmlSecXsltGetDataType,                      /* xmlSecTransformGetDataTypeMethod getDataType; */
     xmlSecXsltPushBin,                          /* xmlSecTransformPushBinMethod pushBin; */
     xmlSecTransformDefaultPopBin,               /* xmlSecTransformPopBinMethod popBin; */
     NULL,                                       /* xmlSecTransformPushXmlMethod pushXml; */
-    NULL,                                       /* xmlSecTransformPopXmlMethod popXml; */
+    xmlSecXsltPopXml,                           /* xmlSecTransformPopXmlMethod popXml; */
     xmlSecXsltExecute,                          /* xmlSecTransformExecuteMethod execute; */
 
     NULL,                                       /* void* reserved0; */
@@ -111,6 +124,205 @@ static xmlSecTransformKlass xmlSecXsltKlass = {
 
 static xsltSecurityPrefsPtr g_xslt_default_security_prefs = NULL;
 
+/**************************************************************************
+ *
+ * Compiled stylesheets cache: the documents usually use the same few
+ * stylesheets thus we compile each stylesheet once and share the compiled
+ * stylesheet (it is not modified by xsltApplyStylesheetUser()). The key
+ * is the serialized stylesheet. The security prefs are set on the
+ * transformation context when the stylesheet is applied; however changing
+ * the default prefs also changes the cache generation so the stylesheets
+ * (and their imports) compiled before the change are not used anymore.
+ * The cache entries are never removed until the library shutdown, thus
+ * the pointers to the compiled stylesheets stay valid.
+ *
+ *****************************************************************************/
+#define XMLSEC_XSLT_CACHE_TABLE_SIZE            16
+#define XMLSEC_XSLT_CACHE_MAX_SIZE              32
+
+typedef struct _xmlSecXsltCacheEntry            xmlSecXsltCacheEntry,
+                                                *xmlSecXsltCacheEntryPtr;
+struct _xmlSecXsltCacheEntry {
+    xmlSecXsltCacheEntryPtr             next;
+    xmlSecSize                          generation;
+    xmlChar*                            data;
+    xmlSecSize                          dataSize;
+    xsltStylesheetPtr                   xslt;
+};
+
+static xmlMutexPtr              gXmlSecXsltCacheMutex = NULL;
+static xmlSecXsltCacheEntryPtr  gXmlSecXsltCacheTable[XMLSEC_XSLT_CACHE_TABLE_SIZE];
+static xmlSecSize               gXmlSecXsltCacheSize = 0;
+static xmlSecSize               gXmlSecXsltCacheGeneration = 0;
+
+static void
+xmlSecXsltCacheInitialize(void) {
+    xmlSecAssert(gXmlSecXsltCacheMutex == NULL);
+
+    memset(gXmlSecXsltCacheTable, 0, sizeof(gXmlSecXsltCacheTable));
+    gXmlSecXsltCacheSize = 0;
+    gXmlSecXsltCacheGeneration = 0;
+
+    gXmlSecXsltCacheMutex = xmlNewMutex();
+    if(gXmlSecXsltCacheMutex == NULL) {
+        xmlSecXmlError("xmlNewMutex", NULL);
+    }
+}
+
+static void
+xmlSecXsltCacheShutdown(void) {
+    xmlSecXsltCacheEntryPtr entry;
+    xmlSecSize ii;
+
+    for(ii = 0; ii < XMLSEC_XSLT_CACHE_TABLE_SIZE; ++ii) {
+        while(gXmlSecXsltCacheTable[ii] != NULL) {
+            entry = gXmlSecXsltCacheTable[ii];
+            gXmlSecXsltCacheTable[ii] = entry->next;
+
+            xsltFreeStylesheet(entry->xslt);
+            xmlFree(entry->data);
+            xmlFree(entry);
+        }
+    }
+    gXmlSecXsltCacheSize = 0;
+
+    if(gXmlSecXsltCacheMutex != NULL) {
+        xmlFreeMutex(gXmlSecXsltCacheMutex);
+        gXmlSecXsltCacheMutex = NULL;
+    }
+}
+
+static xmlSecSize
+xmlSecXsltCacheHash(const xmlChar* data, xmlSecSize dataSize) {
+    xmlSecSize hash = 5381;
+    xmlSecSize ii;
+
+    xmlSecAssert2(data != NULL, 0);
+
+    for(ii = 0; ii < dataSize; ++ii) {
+        hash = ((hash << 5) + hash) + data[ii];
+    }
+    return(hash % XMLSEC_XSLT_CACHE_TABLE_SIZE);
+}
+
+static xmlSecXsltCacheEntryPtr
+xmlSecXsltCacheFind(xmlSecSize hash, xmlSecSize generation, const xmlChar* data, xmlSecSize dataSize) {
+    xmlSecXsltCacheEntryPtr entry;
+
+    for(entry = gXmlSecXsltCacheTable[hash]; entry != NULL; entry = entry->next) {
+        if((entry->generation == generation) && (entry->dataSize == dataSize) &&
+           (memcmp(entry->data, data, dataSize) == 0)) {
+            return(entry);
+        }
+    }
+    return(NULL);
+}
+
+static xsltStylesheetPtr
+xmlSecXsltCompile(const xmlChar* data, xmlSecSize dataSize) {
+    xsltStylesheetPtr xslt;
+    xmlDocPtr doc;
+
+    xmlSecAssert2(data != NULL, NULL);
+
+    doc = xmlSecParseMemory(data, dataSize, 1);
+    if(doc == NULL) {
+        xmlSecInternalError("xmlSecParseMemory", NULL);
+        return(NULL);
+    }
+
+    xslt = xsltParseStylesheetDoc(doc);
+    if(xslt == NULL) {
+        xmlSecXsltError("xsltParseStylesheetDoc", NULL, NULL);
+        xmlFreeDoc(doc);
+        return(NULL);
+    }
+    /* doc is owned by xslt and will be freed by xsltFreeStylesheet() */
+    return(xslt);
+}
+
+/*
+ * Returns the compiled stylesheet: either from the cache (@cached is set to 1)
+ * or a newly compiled one that the caller has to free with xsltFreeStylesheet()
+ * (@cached is set to 0).
+ */
+static xsltStylesheetPtr
+xmlSecXsltCacheGet(const xmlChar* data, xmlSecSize dataSize, int* cached) {
+    xmlSecXsltCacheEntryPtr entry;
+    xsltStylesheetPtr xslt;
+    xmlSecSize hash, generation;
+
+    xmlSecAssert2(data != NULL, NULL);
+    xmlSecAssert2(cached != NULL, NULL);
+
+    (*cached) = 0;
+    if(gXmlSecXsltCacheMutex == NULL) {
+        return(xmlSecXsltCompile(data, dataSize));
+    }
+
+    hash = xmlSecXsltCacheHash(data, dataSize);
+
+    xmlMutexLock(gXmlSecXsltCacheMutex);
+    generation = gXmlSecXsltCacheGeneration;
+    entry = xmlSecXsltCacheFind(hash, generation, data, dataSize);
+    if(entry != NULL) {
+        xslt = entry->xslt;
+        xmlMutexUnlock(gXmlSecXsltCacheMutex);
+        xmlSecStatsCacheLookup(xmlSecStatsCacheXslt, 1);
+        (*cached) = 1;
+        return(xslt);
+    }
+    xmlMutexUnlock(gXmlSecXsltCacheMutex);
+    xmlSecStatsCacheLookup(xmlSecStatsCacheXslt, 0);
+
+    /* compile outside of the lock */
+    xslt = xmlSecXsltCompile(data, dataSize);
+    if(xslt == NULL) {
+        xmlSecInternalError("xmlSecXsltCompile", NULL);
+        return(NULL);
+    }
+
+    entry = (xmlSecXsltCacheEntryPtr)xmlMalloc(sizeof(xmlSecXsltCacheEntry));
+    if(entry == NULL) {
+        xmlSecMallocError(sizeof(xmlSecXsltCacheEntry), NULL);
+        /* not fatal, just use it once */
+        return(xslt);
+    }
+    memset(entry, 0, sizeof(xmlSecXsltCacheEntry));
+    entry->data = (xmlChar*)xmlMalloc(dataSize + 1);
+    if(entry->data == NULL) {
+        xmlSecMallocError(dataSize + 1, NULL);
+        xmlFree(entry);
+        return(xslt);
+    }
+    memcpy(entry->data, data, dataSize);
+    entry->data[dataSize] = '\0';
+    entry->dataSize = dataSize;
+    entry->generation = generation;
+    entry->xslt = xslt;
+
+    xmlMutexLock(gXmlSecXsltCacheMutex);
+    /* someone else might have added it while we were compiling */
+    if((xmlSecXsltCacheFind(hash, generation, data, dataSize) == NULL) &&
+       (generation == gXmlSecXsltCacheGeneration) &&
+       (gXmlSecXsltCacheSize < XMLSEC_XSLT_CACHE_MAX_SIZE))
+    {
+        entry->next = gXmlSecXsltCacheTable[hash];
+        gXmlSecXsltCacheTable[hash] = entry;
+        ++gXmlSecXsltCacheSize;
+        entry = NULL;
+        (*cached) = 1;
+    }
+    xmlMutexUnlock(gXmlSecXsltCacheMutex);
+
+    if(entry != NULL) {
+        /* cache is full, prefs changed or the stylesheet is already there */
+        xmlFree(entry->data);
+        xmlFree(entry);
+    }
+    return(xslt);
+}
+
 void xmlSecTransformXsltInitialize(void) {
     xmlSecAssert(g_xslt_default_security_prefs == NULL);
 
@@ -121,9 +333,13 @@ void xmlSecTransformXsltInitialize(void) {
     xsltSetSecurityPrefs(g_xslt_default_security_prefs,  XSLT_SECPREF_CREATE_DIRECTORY, xsltSecurityForbid);
     xsltSetSecurityPrefs(g_xslt_default_security_prefs,  XSLT_SECPREF_READ_NETWORK,     xsltSecurityForbid);
     xsltSetSecurityPrefs(g_xslt_default_security_prefs,  XSLT_SECPREF_WRITE_NETWORK,    xsltSecurityForbid);
+
+    xmlSecXsltCacheInitialize();
 }
 
 void xmlSecTransformXsltShutdown(void) {
+    xmlSecXsltCacheShutdown();
+
     if(g_xslt_default_security_prefs != NULL) {
         xsltFreeSecurityPrefs(g_xslt_default_security_prefs);
         g_xslt_default_security_prefs = NULL;
@@ -148,6 +364,13 @@ xmlSecTransformXsltSetDefaultSecurityPrefs(xsltSecurityPrefsPtr sec) {
     XMLSEC_XSLT_COPY_SEC_PREF(sec, g_xslt_default_security_prefs, XSLT_SECPREF_CREATE_DIRECTORY);
     XMLSEC_XSLT_COPY_SEC_PREF(sec, g_xslt_default_security_prefs, XSLT_SECPREF_READ_NETWORK);
     XMLSEC_XSLT_COPY_SEC_PREF(sec, g_xslt_default_security_prefs, XSLT_SECPREF_WRITE_NETWORK);
+
+    /* don't use the stylesheets compiled with the old prefs */
+    if(gXmlSecXsltCacheMutex != NULL) {
+        xmlMutexLock(gXmlSecXsltCacheMutex);
+        ++gXmlSecXsltCacheGeneration;
+        xmlMutexUnlock(gXmlSecXsltCacheMutex);
+    }
 }
 
 /**
@@ -214,7 +437,7 @@ xmlSecXsltFinalize(xmlSecTransformPtr transform) {
     ctx = xmlSecXsltGetCtx(transform);
     xmlSecAssert(ctx != NULL);
 
-    if(ctx->xslt != NULL) {
+    if((ctx->xslt != NULL) && (ctx->xsltCached == 0)) {
         xsltFreeStylesheet(ctx->xslt);
     }
     if(ctx->parserCtx != NULL) {
@@ -231,7 +454,6 @@ static int
 xmlSecXsltReadNode(xmlSecTransformPtr transform, xmlNodePtr node, xmlSecTransformCtxPtr transformCtx) {
     xmlSecXsltCtxPtr ctx;
     xmlBufferPtr buffer = NULL;
-    xmlDocPtr doc = NULL;
     xmlNodePtr cur;
     const xmlChar* buf;
     xmlSecSize bufSize;
@@ -259,33 +481,21 @@ xmlSecXsltReadNode(xmlSecTransformPtr transform, xmlNodePtr node, xmlSecTransfor
         cur = cur->next;
     }
 
-    /* parse the buffer */
+    /* get the compiled stylesheet */
     buf = xmlBufferContent(buffer);
     bufLen = xmlBufferLength(buffer);
     XMLSEC_SAFE_CAST_INT_TO_SIZE(bufLen, bufSize, goto done, xmlSecTransformGetName(transform));
-    doc = xmlSecParseMemory(buf, bufSize, 1);
-    if(doc == NULL) {
-        xmlSecInternalError("xmlSecParseMemory",
-                            xmlSecTransformGetName(transform));
-        goto done;
-    }
-
-    /* pre-process stylesheet */
-    ctx->xslt = xsltParseStylesheetDoc(doc);
+    ctx->xslt = xmlSecXsltCacheGet(buf, bufSize, &(ctx->xsltCached));
     if(ctx->xslt == NULL) {
-        xmlSecXsltError("xsltParseStylesheetDoc", NULL, xmlSecTransformGetName(transform));
-
+        xmlSecInternalError("xmlSecXsltCacheGet",
+                            xmlSecTransformGetName(transform));
         goto done;
     }
-    doc = NULL; /* owned by ctx->xslt and will be freed by xsltFreeStylesheet() */
 
     /* success */
     res = 0;
 
 done:
-    if(doc != NULL) {
-        xmlFreeDoc(doc);
-    }
     if(buffer != NULL) {
         xmlBufferFree(buffer);
     }
@@ -365,6 +575,28 @@ xmlSecXsltPushBin(xmlSecTransformPtr transform, const xmlSecByte* data,
         }
         xmlFreeDoc(docIn);
 
+        /* the next transform wants XML: give it the result doc */
+        if((transform->next != NULL) &&
+           ((xmlSecTransformGetDataType(transform->next, xmlSecTransformModePush, transformCtx) & xmlSecTransformDataTypeBin) == 0))
+        {
+            xmlSecAssert2(transform->outNodes == NULL, -1);
+
+            transform->outNodes = xmlSecXsltResultToNodeSet(ctx, docOut);
+            if(transform->outNodes == NULL) {
+                xmlSecInternalError("xmlSecXsltResultToNodeSet", xmlSecTransformGetName(transform));
+                return(-1);
+            }
+
+            ret = xmlSecTransformPushXml(transform->next, transform->outNodes, transformCtx);
+            if(ret < 0) {
+                xmlSecInternalError("xmlSecTransformPushXml", xmlSecTransformGetName(transform));
+                return(-1);
+            }
+
+            transform->status = xmlSecTransformStatusFinished;
+            return(0);
+        }
+
         if(transform->next != NULL) {
             output = xmlSecTransformCreateOutputBuffer(transform->next, transformCtx);
             if(output == NULL) {
@@ -402,6 +634,111 @@ xmlSecXsltPushBin(xmlSecTransformPtr transform, const xmlSecByte* data,
     return(0);
 }
 
+static xmlSecTransformDataType
+xmlSecXsltGetDataType(xmlSecTransformPtr transform, xmlSecTransformMode mode,
+                      xmlSecTransformCtxPtr transformCtx) {
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformXsltId), xmlSecTransformDataTypeUnknown);
+    xmlSecAssert2(transformCtx != NULL, xmlSecTransformDataTypeUnknown);
+
+    switch(mode) {
+    case xmlSecTransformModePush:
+        /* the input is always parsed from octets: it can't be the node-set
+         * itself since the XSLT functions like id() or unparsed-entity-uri()
+         * would see the original document instead of the c14n result */
+        return(xmlSecTransformDataTypeBin);
+    case xmlSecTransformModePop:
+        /* the result document can be used directly by the next XML transform */
+        return(xmlSecTransformDataTypeBin | xmlSecTransformDataTypeXml);
+    default:
+        xmlSecUnsupportedEnumValueError("mode", mode, xmlSecTransformGetName(transform));
+        return(xmlSecTransformDataTypeUnknown);
+    }
+}
+
+static int
+xmlSecXsltPopXml(xmlSecTransformPtr transform, xmlSecNodeSetPtr* nodes,
+                 xmlSecTransformCtxPtr transformCtx) {
+    xmlSecXsltCtxPtr ctx;
+    xmlSecBufferPtr in;
+    xmlDocPtr docIn;
+    xmlDocPtr docOut;
+    int ret;
+
+    xmlSecAssert2(xmlSecTransformCheckId(transform, xmlSecTransformXsltId), -1);
+    xmlSecAssert2(xmlSecTransformCheckSize(transform, xmlSecXsltSize), -1);
+    xmlSecAssert2(transform->outNodes == NULL, -1);
+    xmlSecAssert2(transformCtx != NULL, -1);
+
+    ctx = xmlSecXsltGetCtx(transform);
+    xmlSecAssert2(ctx != NULL, -1);
+    xmlSecAssert2(ctx->xslt != NULL, -1);
+
+    if(transform->status != xmlSecTransformStatusNone) {
+        xmlSecInvalidTransfromStatusError(transform);
+        return(-1);
+    }
+    transform->status = xmlSecTransformStatusWorking;
+
+    /* read all the data from the previous transform */
+    in = &(transform->inBuf);
+    while(transform->prev != NULL) {
+        xmlSecSize inSize, chunkSize;
+
+        inSize = xmlSecBufferGetSize(in);
+        chunkSize = transformCtx->binaryChunkSize;
+
+        ret = xmlSecBufferSetMaxSize(in, inSize + chunkSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetMaxSize", xmlSecTransformGetName(transform),
+                "size=" XMLSEC_SIZE_FMT, (inSize + chunkSize));
+            return(-1);
+        }
+
+        ret = xmlSecTransformPopBin(transform->prev, xmlSecBufferGetData(in) + inSize,
+                            chunkSize, &chunkSize, transformCtx);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecTransformPopBin", xmlSecTransformGetName(transform->prev));
+            return(-1);
+        }
+        if(chunkSize == 0) {
+            break;
+        }
+
+        ret = xmlSecBufferSetSize(in, inSize + chunkSize);
+        if(ret < 0) {
+            xmlSecInternalError2("xmlSecBufferSetSize", xmlSecTransformGetName(transform),
+                "size=" XMLSEC_SIZE_FMT, (inSize + chunkSize));
+            return(-1);
+        }
+    }
+
+    docIn = xmlSecParseMemory(xmlSecBufferGetData(in), xmlSecBufferGetSize(in), 1);
+    if(docIn == NULL) {
+        xmlSecInternalError("xmlSecParseMemory", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    xmlSecBufferEmpty(in);
+
+    docOut = xmlSecXsApplyStylesheet(ctx, docIn);
+    xmlFreeDoc(docIn);
+    if(docOut == NULL) {
+        xmlSecInternalError("xmlSecXsApplyStylesheet", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+
+    transform->outNodes = xmlSecXsltResultToNodeSet(ctx, docOut);
+    if(transform->outNodes == NULL) {
+        xmlSecInternalError("xmlSecXsltResultToNodeSet", xmlSecTransformGetName(transform));
+        return(-1);
+    }
+    transform->status = xmlSecTransformStatusFinished;
+
+    if(nodes != NULL) {
+        (*nodes) = transform->outNodes;
+    }
+    return(0);
+}
+
 static int
 xmlSecXsltExecute(xmlSecTransformPtr transform, int last, xmlSecTransformCtxPtr transformCtx) {
     xmlSecXsltCtxPtr ctx;
@@ -553,5 +890,171 @@ done:
     return res;
 }
 
+/* the next node in the document order in the @root subtree (attributes are not visited) */
+static xmlNodePtr
+xmlSecXsltNextNode(xmlNodePtr cur, xmlNodePtr root) {
+    xmlSecAssert2(cur != NULL, NULL);
+
+    if((cur->type == XML_ELEMENT_NODE) && (cur->children != NULL)) {
+        return(cur->children);
+    }
+    while((cur != root) && (cur->next == NULL)) {
+        cur = cur->parent;
+    }
+    return((cur != root) ? cur->next : NULL);
+}
+
+/*
+ * Returns 1 if parsing the serialized @doc would produce the same document
+ * (modulo adjacent and empty text nodes that are normalized here) or 0 otherwise:
+ * the output must be XML without indentation and DOCTYPE (that would load the DTD),
+ * the document must be well-formed and have no disable-output-escaping text.
+ */
+static int
+xmlSecXsltCheckResultDoc(xsltStylesheetPtr xslt, xmlDocPtr doc) {
+    const xmlChar* method;
+    const xmlChar* doctypePublic;
+    const xmlChar* doctypeSystem;
+    int indent;
+    xmlNodePtr root = NULL;
+    xmlNodePtr cur, next;
+
+    xmlSecAssert2(xslt != NULL, -1);
+    xmlSecAssert2(doc != NULL, -1);
+
+    XSLT_GET_IMPORT_PTR(method, xslt, method)
+    XSLT_GET_IMPORT_PTR(doctypePublic, xslt, doctypePublic)
+    XSLT_GET_IMPORT_PTR(doctypeSystem, xslt, doctypeSystem)
+    XSLT_GET_IMPORT_INT(indent, xslt, indent)
+    if(((method != NULL) && !xmlStrEqual(method, BAD_CAST "xml")) ||
+       (doctypePublic != NULL) || (doctypeSystem != NULL) || (indent == 1) ||
+       (doc->intSubset != NULL) || (doc->type != XML_DOCUMENT_NODE))
+    {
+        return(0);
+    }
+
+    /* exactly one root element, only comments and PIs around it */
+    for(cur = doc->children; cur != NULL; cur = cur->next) {
+        if(cur->type == XML_ELEMENT_NODE) {
+            if(root != NULL) {
+                return(0);
+            }
+            root = cur;
+        } else if((cur->type != XML_COMMENT_NODE) && (cur->type != XML_PI_NODE)) {
+            return(0);
+        }
+    }
+    if(root == NULL) {
+        return(0);
+    }
+    /* no method: "html" root element means HTML output */
+    if((method == NULL) && (root->ns == NULL) && (xmlStrcasecmp(root->name, BAD_CAST "html") == 0)) {
+        return(0);
+    }
+
+    /* walk the tree */
+    cur = root;
+    while(cur != NULL) {
+        if(cur->type == XML_ENTITY_REF_NODE) {
+            return(0);
+        }
+        if(cur->type == XML_TEXT_NODE) {
+            if(cur->name == xmlStringTextNoenc) {
+                return(0);
+            }
+
+            /* the parser merges adjacent text nodes and doesn't create empty ones */
+            while((cur->next != NULL) && (cur->next->type == XML_TEXT_NODE) &&
+                  (cur->next->name != xmlStringTextNoenc)) {
+                if(xmlTextMerge(cur, cur->next) == NULL) {
+                    return(-1);
+                }
+            }
+            if(xmlStrlen(cur->content) == 0) {
+                next = xmlSecXsltNextNode(cur, root);
+                xmlUnlinkNode(cur);
+                xmlFreeNode(cur);
+                cur = next;
+                continue;
+            }
+        }
+        cur = xmlSecXsltNextNode(cur, root);
+    }
+    return(1);
+}
+
+/*
+ * Converts the XSLT result to a node set, takes ownership of @docOut. If the
+ * result document can't be used directly then it is serialized and parsed
+ * again (same as the XML parser transform would do).
+ */
+static xmlSecNodeSetPtr
+xmlSecXsltResultToNodeSet(xmlSecXsltCtxPtr ctx, xmlDocPtr docOut) {
+    xmlSecNodeSetPtr nodes;
+    xmlDocPtr doc;
+    int ret;
+
+    xmlSecAssert2(ctx != NULL, NULL);
+    xmlSecAssert2(ctx->xslt != NULL, NULL);
+    xmlSecAssert2(docOut != NULL, NULL);
+
+    ret = xmlSecXsltCheckResultDoc(ctx->xslt, docOut);
+    if(ret < 0) {
+        xmlSecInternalError("xmlSecXsltCheckResultDoc", NULL);
+        xmlFreeDoc(docOut);
+        return(NULL);
+    } else if(ret == 1) {
+        doc = docOut;
+    } else {
+        xmlSecBuffer buffer;
+        xmlOutputBufferPtr output;
+
+        ret = xmlSecBufferInitialize(&buffer, 0);
+        if(ret < 0) {
+            xmlSecInternalError("xmlSecBufferInitialize", NULL);
+            xmlFreeDoc(docOut);
+            return(NULL);
+        }
+
+        output = xmlSecBufferCreateOutputBuffer(&buffer);
+        if(output == NULL) {
+            xmlSecInternalError("xmlSecBufferCreateOutputBuffer", NULL);
+            xmlSecBufferFinalize(&buffer);
+            xmlFreeDoc(docOut);
+            return(NULL);
+        }
+
+        ret = xsltSaveResultTo(output, docOut, ctx->xslt);
+        xmlFreeDoc(docOut);
+        if(ret < 0) {
+            xmlSecXsltError("xsltSaveResultTo", ctx->xslt, NULL);
+            (void)xmlOutputBufferClose(output);
+            xmlSecBufferFinalize(&buffer);
+            return(NULL);
+        }
+        ret = xmlOutputBufferClose(output);
+        if(ret < 0) {
+            xmlSecXmlError("xmlOutputBufferClose", NULL);
+            xmlSecBufferFinalize(&buffer);
+            return(NULL);
+        }
+
+        doc = xmlSecParseMemory(xmlSecBufferGetData(&buffer), xmlSecBufferGetSize(&buffer), 0);
+        xmlSecBufferFinalize(&buffer);
+        if(doc == NULL) {
+            xmlSecInternalError("xmlSecParseMemory", NULL);
+            return(NULL);
+        }
+    }
+
+    nodes = xmlSecNodeSetCreate(doc, NULL, xmlSecNodeSetTree);
+    if(nodes == NULL) {
+        xmlSecInternalError("xmlSecNodeSetCreate", NULL);
+        xmlFreeDoc(doc);
+        return(NULL);
+    }
+    xmlSecNodeSetDocDestroy(nodes); /* this node set "owns" the doc pointer */
+    return(nodes);
+}
 
 #endif /* XMLSEC_NO_XSLT */
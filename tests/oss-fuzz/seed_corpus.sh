@@ -0,0 +1,32 @@
+#!/bin/sh
+#
+# XML Security Library: creates the seed corpora for the oss-fuzz targets
+#
+# Usage:
+#       seed_corpus.sh <xmlsec-tests-folder> <output-folder>
+#
+# The corpora are the zip files named "<fuzzer>_seed_corpus.zip" as
+# expected by oss-fuzz:
+#   - xmlsec_fuzzer and xmlsec_c14n_fuzzer: all the XML test vectors;
+#   - xmlsec_xpath_fuzzer: the XML test vectors with <dsig:Transforms/>.
+#
+# This is free software; see Copyright file in the source
+# distribution for preciese wording.
+#
+# Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+#
+
+tests_folder="$1"
+out_folder="$2"
+if [ "z$tests_folder" = "z" ] || [ "z$out_folder" = "z" ] ; then
+    echo "Usage: $0 <xmlsec-tests-folder> <output-folder>" 1>&2
+    exit 1
+fi
+
+out_folder=`cd "$out_folder" && pwd` || exit 1
+cd "$tests_folder" || exit 1
+
+# the test vectors from different folders might have the same names
+find . -name '*.xml' -type f | zip -q -@ "$out_folder/xmlsec_fuzzer_seed_corpus.zip" || exit 1
+cp "$out_folder/xmlsec_fuzzer_seed_corpus.zip" "$out_folder/xmlsec_c14n_fuzzer_seed_corpus.zip" || exit 1
+find . -name '*.xml' -type f -exec grep -l 'Transforms' {} + | zip -q -@ "$out_folder/xmlsec_xpath_fuzzer_seed_corpus.zip" || exit 1
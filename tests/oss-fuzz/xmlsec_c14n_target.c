@@ -0,0 +1,122 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Performance-regression fuzz target for the C14N transforms: the input
+ * document is canonicalized with every C14N method (both with the native
+ * and LibXML2 serializers) and the processing time is checked against
+ * the budget (see xmlsec_fuzz_budget.h).
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#include <stdint.h>
+
+#include <libxml/parser.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/errors.h>
+#include <xmlsec/nodeset.h>
+#include <xmlsec/parser.h>
+#include <xmlsec/transforms.h>
+
+#include "xmlsec_fuzz_budget.h"
+
+typedef struct _xmlSecFuzzC14NRun {
+    xmlDocPtr                   doc;
+    xmlSecTransformId           id;
+    unsigned int                flags;
+} xmlSecFuzzC14NRun;
+
+static void
+ignore(void* ctx, const char* msg, ...) {
+    /* Error handler to avoid spam of error messages from libxml parser. */
+    (void)ctx;
+    (void)msg;
+}
+
+static int
+xmlSecFuzzC14NExecute(void* data) {
+    xmlSecFuzzC14NRun* run = (xmlSecFuzzC14NRun*)data;
+    xmlSecTransformCtx ctx;
+    xmlSecNodeSetPtr nodes = NULL;
+    int res = -1;
+
+    if(xmlSecTransformCtxInitialize(&ctx) < 0) {
+        return(-1);
+    }
+    ctx.flags |= run->flags;
+    if(xmlSecTransformCtxCreateAndAppend(&ctx, run->id) == NULL) {
+        goto done;
+    }
+    nodes = xmlSecNodeSetGetChildren(run->doc, NULL, 1, 0);
+    if(nodes == NULL) {
+        goto done;
+    }
+    if(xmlSecTransformCtxXmlExecute(&ctx, nodes) < 0) {
+        goto done;
+    }
+    res = 0;
+
+done:
+    if(nodes != NULL) {
+        xmlSecNodeSetDestroy(nodes);
+    }
+    xmlSecTransformCtxFinalize(&ctx);
+    return(res);
+}
+
+int
+LLVMFuzzerInitialize(int* argc, char*** argv) {
+    (void)argc;
+    (void)argv;
+
+    xmlInitParser();
+    if(xmlSecInit() < 0) {
+        abort();
+    }
+    xmlSetGenericErrorFunc(NULL, &ignore);
+    xmlSecErrorsDefaultCallbackEnableOutput(0);
+    return(0);
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static const unsigned int flags[] = {
+        0,
+        XMLSEC_TRANSFORMCTX_FLAGS_USE_LIBXML2_C14N
+    };
+    static const char* const flagsNames[] = {
+        "native",
+        "libxml2"
+    };
+    xmlSecTransformId ids[] = {
+        xmlSecTransformInclC14NId,
+        xmlSecTransformInclC14NWithCommentsId,
+        xmlSecTransformInclC14N11Id,
+        xmlSecTransformInclC14N11WithCommentsId,
+        xmlSecTransformExclC14NId,
+        xmlSecTransformExclC14NWithCommentsId,
+        xmlSecTransformRemoveXmlTagsC14NId
+    };
+    xmlSecFuzzC14NRun run;
+    char name[128];
+    size_t ii, jj;
+
+    run.doc = xmlSecParseMemory(data, size, 0);
+    if(run.doc == NULL) {
+        return(0);
+    }
+    for(ii = 0; ii < sizeof(ids) / sizeof(ids[0]); ++ii) {
+        for(jj = 0; jj < sizeof(flags) / sizeof(flags[0]); ++jj) {
+            run.id = ids[ii];
+            run.flags = flags[jj];
+            snprintf(name, sizeof(name), "%s (%s)",
+                (const char*)xmlSecTransformKlassGetName(run.id), flagsNames[jj]);
+            xmlSecFuzzBudgetCheck(name, size, xmlSecFuzzC14NExecute, &run);
+        }
+    }
+    xmlFreeDoc(run.doc);
+    return(0);
+}
@@ -0,0 +1,94 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * The processing cost budget shared by the performance-regression fuzz
+ * targets (xmlsec_c14n_target.c, xmlsec_xpath_target.c).
+ *
+ * The targets look for the algorithmic complexity problems (e.g. deep
+ * XPath filters stacks, namespaces fan-out in C14N, quadratic nodes sets
+ * operations) rather than crashes: the CPU time spent processing the input
+ * is compared with a budget that is linear in the input size and the
+ * inputs that exceed it are reported with abort() so libFuzzer saves them
+ * as crash artifacts. The budget can be changed with the environment
+ * variables:
+ *
+ *   XMLSEC_FUZZ_BUDGET_BASE_US      - the fixed part in microseconds (default 100000);
+ *   XMLSEC_FUZZ_BUDGET_US_PER_BYTE  - the per input byte part in microseconds (default 10).
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#ifndef __XMLSEC_FUZZ_BUDGET_H__
+#define __XMLSEC_FUZZ_BUDGET_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define XMLSEC_FUZZ_BUDGET_BASE_US_DEFAULT              100000.0
+#define XMLSEC_FUZZ_BUDGET_US_PER_BYTE_DEFAULT          10.0
+
+typedef int (*xmlSecFuzzBudgetRunMethod)(void* data);
+
+static double
+xmlSecFuzzBudgetGetEnv(const char* name, double defValue) {
+    const char* value = getenv(name);
+    char* end = NULL;
+    double res;
+
+    if((value == NULL) || (value[0] == '\0')) {
+        return(defValue);
+    }
+    res = strtod(value, &end);
+    if((end == NULL) || (end[0] != '\0') || (res < 0)) {
+        return(defValue);
+    }
+    return(res);
+}
+
+/* the allowed processing time (in microseconds) for @size bytes input */
+static double
+xmlSecFuzzBudgetGet(size_t size) {
+    static double baseUs = -1;
+    static double usPerByte = -1;
+
+    if(baseUs < 0) {
+        baseUs = xmlSecFuzzBudgetGetEnv("XMLSEC_FUZZ_BUDGET_BASE_US", XMLSEC_FUZZ_BUDGET_BASE_US_DEFAULT);
+        usPerByte = xmlSecFuzzBudgetGetEnv("XMLSEC_FUZZ_BUDGET_US_PER_BYTE", XMLSEC_FUZZ_BUDGET_US_PER_BYTE_DEFAULT);
+    }
+    return(baseUs + usPerByte * (double)size);
+}
+
+/* the CPU time (in microseconds) spent by @run */
+static double
+xmlSecFuzzBudgetMeasure(xmlSecFuzzBudgetRunMethod run, void* data) {
+    clock_t start;
+
+    start = clock();
+    (void)run(data);
+    return((double)(clock() - start) * 1000000.0 / (double)CLOCKS_PER_SEC);
+}
+
+/* runs @run (the @name step) for the @size bytes input and aborts if it
+ * exceeds the budget twice in a row (to filter out the scheduling noise) */
+static void
+xmlSecFuzzBudgetCheck(const char* name, size_t size, xmlSecFuzzBudgetRunMethod run, void* data) {
+    double budget = xmlSecFuzzBudgetGet(size);
+    double cost;
+
+    cost = xmlSecFuzzBudgetMeasure(run, data);
+    if(cost <= budget) {
+        return;
+    }
+    cost = xmlSecFuzzBudgetMeasure(run, data);
+    if(cost <= budget) {
+        return;
+    }
+    fprintf(stderr, "xmlsec fuzz budget exceeded: step=%s; size=%lu; cost=%.0fus; budget=%.0fus\n",
+        name, (unsigned long)size, cost, budget);
+    abort();
+}
+
+#endif /* __XMLSEC_FUZZ_BUDGET_H__ */
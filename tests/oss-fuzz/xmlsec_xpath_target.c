@@ -0,0 +1,112 @@
+/*
+ * XML Security Library (http://www.aleksey.com/xmlsec).
+ *
+ * Performance-regression fuzz target for the XPath, XPath2 (Filter 2.0),
+ * XPointer and enveloped signature transforms: the first
+ * &lt;dsig:Transforms/&gt; element in the input document is read (with only
+ * these transforms and C14N enabled) and executed on the same document.
+ * The processing time is checked against the budget
+ * (see xmlsec_fuzz_budget.h).
+ *
+ * This is free software; see Copyright file in the source
+ * distribution for preciese wording.
+ *
+ * Copyright (C) 2002-2022 Aleksey Sanin <aleksey@aleksey.com>. All Rights Reserved.
+ */
+#include <stdint.h>
+
+#include <libxml/parser.h>
+
+#include <xmlsec/xmlsec.h>
+#include <xmlsec/errors.h>
+#include <xmlsec/parser.h>
+#include <xmlsec/strings.h>
+#include <xmlsec/transforms.h>
+#include <xmlsec/xmltree.h>
+
+#include "xmlsec_fuzz_budget.h"
+
+typedef struct _xmlSecFuzzXPathRun {
+    xmlDocPtr                   doc;
+    xmlNodePtr                  transformsNode;
+} xmlSecFuzzXPathRun;
+
+static void
+ignore(void* ctx, const char* msg, ...) {
+    /* Error handler to avoid spam of error messages from libxml parser. */
+    (void)ctx;
+    (void)msg;
+}
+
+static int
+xmlSecFuzzXPathExecute(void* data) {
+    xmlSecFuzzXPathRun* run = (xmlSecFuzzXPathRun*)data;
+    xmlSecTransformId ids[] = {
+        xmlSecTransformXPathId,
+        xmlSecTransformXPath2Id,
+        xmlSecTransformXPointerId,
+        xmlSecTransformEnvelopedId,
+        xmlSecTransformInclC14NId,
+        xmlSecTransformInclC14NWithCommentsId,
+        xmlSecTransformInclC14N11Id,
+        xmlSecTransformInclC14N11WithCommentsId,
+        xmlSecTransformExclC14NId,
+        xmlSecTransformExclC14NWithCommentsId
+    };
+    xmlSecTransformCtx ctx;
+    size_t ii;
+    int res = -1;
+
+    if(xmlSecTransformCtxInitialize(&ctx) < 0) {
+        return(-1);
+    }
+    for(ii = 0; ii < sizeof(ids) / sizeof(ids[0]); ++ii) {
+        if(xmlSecPtrListAdd(&(ctx.enabledTransforms), (void*)ids[ii]) < 0) {
+            goto done;
+        }
+    }
+    if(xmlSecTransformCtxNodesListRead(&ctx, run->transformsNode, xmlSecTransformUsageDSigTransform) < 0) {
+        goto done;
+    }
+    if(xmlSecTransformCtxExecute(&ctx, run->doc) < 0) {
+        goto done;
+    }
+    res = 0;
+
+done:
+    xmlSecTransformCtxFinalize(&ctx);
+    return(res);
+}
+
+int
+LLVMFuzzerInitialize(int* argc, char*** argv) {
+    (void)argc;
+    (void)argv;
+
+    xmlInitParser();
+    if(xmlSecInit() < 0) {
+        abort();
+    }
+    xmlSetGenericErrorFunc(NULL, &ignore);
+    xmlSecErrorsDefaultCallbackEnableOutput(0);
+    return(0);
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    xmlSecFuzzXPathRun run;
+
+    run.doc = xmlSecParseMemory(data, size, 0);
+    if(run.doc == NULL) {
+        return(0);
+    }
+    run.transformsNode = NULL;
+    if(xmlDocGetRootElement(run.doc) != NULL) {
+        run.transformsNode = xmlSecFindNode(xmlDocGetRootElement(run.doc), xmlSecNodeTransforms, xmlSecDSigNs);
+    }
+    if(run.transformsNode != NULL) {
+        xmlSecFuzzBudgetCheck("transforms", size, xmlSecFuzzXPathExecute, &run);
+    }
+    xmlFreeDoc(run.doc);
+    return(0);
+}
@@ -597,6 +597,15 @@ execDSigTest $res_success \
     "--hmackey:mykey $topfolder/keys/hmackey.bin" \
     "--hmackey:mykey $topfolder/keys/hmackey.bin"
 
+execDSigTest $res_success \
+    "" \
+    "aleksey-xmldsig-01/c14n-edge-cases-hmac" \
+    "enveloped-signature xpath xpointer c14n c14n-with-comments c14n11 exc-c14n exc-c14n-with-comments sha1 hmac-sha1" \
+    "hmac" \
+    "--lax-key-search --hmackey $topfolder/keys/hmackey.bin" \
+    "--hmackey:mykey $topfolder/keys/hmackey.bin" \
+    "--hmackey:mykey $topfolder/keys/hmackey.bin"
+
 execDSigTest $res_success \
     "" \
     "aleksey-xmldsig-01/enveloping-sha1-hmac-sha1" \
@@ -1788,6 +1797,217 @@ $VALGRIND $xmlsec_app verify $xmlsec_params --keys-file $keysfile $tmpfile >> $l
 printRes $res_success $?
 fi
 
+##########################################################################
+#
+# test verification results cache: the tampered documents verified after
+# a cached success must fail
+#
+##########################################################################
+verify_cache_file="$topfolder/aleksey-xmldsig-01/enveloping-sha256-rsa-sha256"
+verify_cache_x509_params="--X509-skip-strict-checks --trusted-$cert_format $topfolder/keys/cacert.$cert_format --enabled-key-data x509"
+if [ -z "$XMLSEC_TEST_NAME" -o "$XMLSEC_TEST_NAME" = "dsig-verify-cache" ] && $xmlsec_app check-key-data x509 >> $logfile 2>> $logfile ; then
+verify_cache_params="$verify_cache_x509_params --verify-cache 16"
+echo "Test: dsig-verify-cache"
+printf "    Verify the same signature twice                      "
+printf "$verify_cache_file.xml\n$verify_cache_file.xml\n" > $tmpfile
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile 2>&1 | tee -a $logfile | grep "2 ok, 0 failed, 0 errors" > /dev/null
+printRes $res_success $?
+printf "    Verify tampered object after cached signature        "
+printf "$verify_cache_file.xml\n$verify_cache_file-tampered-object.xml\n" > $tmpfile
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile 2>&1 | tee -a $logfile | grep "1 ok, 1 failed, 0 errors" > /dev/null
+printRes $res_success $?
+printf "    Verify tampered SignedInfo after cached signature    "
+printf "$verify_cache_file.xml\n$verify_cache_file-tampered-signedinfo.xml\n" > $tmpfile
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile" >> $logfile
+# some crypto libraries (e.g. NSS) report a bad signature value as an error
+$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile 2>&1 | tee -a $logfile | grep -E "1 ok, (1 failed, 0 errors|0 failed, 1 errors)" > /dev/null
+printRes $res_success $?
+rm -f $tmpfile
+fi
+
+##########################################################################
+#
+# test certificates verification results cache: the documents verified
+# after a cached certificates chain must still be fully verified
+#
+##########################################################################
+if [ -z "$XMLSEC_TEST_NAME" -o "$XMLSEC_TEST_NAME" = "dsig-x509-verify-cache" ] && $xmlsec_app check-key-data x509 >> $logfile 2>> $logfile ; then
+if [ "z$crypto" != "zgcrypt" -a "z$crypto" != "zmscrypto" ] ; then
+verify_cache_params="$verify_cache_x509_params --X509-verify-cache 16"
+echo "Test: dsig-x509-verify-cache"
+printf "    Verify the same certificates twice                   "
+printf "$verify_cache_file.xml\n$verify_cache_file.xml\n" > $tmpfile
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile 2>&1 | tee -a $logfile | grep "2 ok, 0 failed, 0 errors" > /dev/null
+printRes $res_success $?
+printf "    Verify tampered object after cached certificates     "
+printf "$verify_cache_file.xml\n$verify_cache_file-tampered-object.xml\n" > $tmpfile
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile 2>&1 | tee -a $logfile | grep "1 ok, 1 failed, 0 errors" > /dev/null
+printRes $res_success $?
+# NSS can still build the chain from its certificates database, the
+# standalone "Missing intermidiate cert" negative test is not reliable there
+if [ "z$crypto" != "znss" ] ; then
+printf "    Verify missing intermediate cert after cached chain  "
+printf "$verify_cache_file.xml\n$topfolder/aleksey-xmldsig-01/enveloped-x509-missing-cert.xml\n" > $tmpfile
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --batch $tmpfile 2>&1 | tee -a $logfile | grep "1 ok, 0 failed, 1 errors" > /dev/null
+printRes $res_success $?
+fi
+if $xmlsec_app check-transforms dsa-sha1 >> $logfile 2>> $logfile ; then
+printf "    Verify expired cert after cached chain               "
+printf "$verify_cache_file.xml\n$topfolder/aleksey-xmldsig-01/enveloping-expired-cert.xml\n" > $tmpfile
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --verification-gmt-time 2022-12-20+00:00:00 --batch $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $verify_cache_params --verification-gmt-time 2022-12-20+00:00:00 --batch $tmpfile 2>&1 | tee -a $logfile | grep "1 ok, 0 failed, 1 errors" > /dev/null
+printRes $res_success $?
+fi
+rm -f $tmpfile
+fi
+fi
+
+
+##########################################################################
+#
+# test streaming sign and verify: the streamed signatures must be verified
+# by the regular code and vice versa, the tampered documents must fail
+#
+##########################################################################
+stream_file="$topfolder/aleksey-xmldsig-01/stream-enveloped-hmac-sha256"
+stream_params="--hmackey:mykey $topfolder/keys/hmackey.bin"
+if [ -z "$XMLSEC_TEST_NAME" -o "$XMLSEC_TEST_NAME" = "dsig-stream" ] && $xmlsec_app check-transforms enveloped-signature c14n sha256 hmac-sha256 >> $logfile 2>> $logfile ; then
+echo "Test: dsig-stream"
+printf "    Stream verify signature                              "
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $stream_params --stream $stream_file.xml" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $stream_params --stream $stream_file.xml >> $logfile 2>> $logfile
+printRes $res_success $?
+
+printf "    Stream verify regular signature                      "
+sed -e 's|<DigestValue>[^<]*</DigestValue>|<DigestValue/>|' -e 's|<SignatureValue>[^<]*</SignatureValue>|<SignatureValue/>|' $stream_file.xml > $tmpfile.2
+echo "$VALGRIND $xmlsec_app sign $xmlsec_params $stream_params --output $tmpfile.3 $tmpfile.2" >> $logfile
+$VALGRIND $xmlsec_app sign $xmlsec_params $stream_params --output $tmpfile.3 $tmpfile.2 >> $logfile 2>> $logfile && \
+    $VALGRIND $xmlsec_app verify $xmlsec_params $stream_params --stream $tmpfile.3 >> $logfile 2>> $logfile
+printRes $res_success $?
+
+printf "    Stream verify tampered signature                     "
+sed 's/text \&amp;/Text \&amp;/' $stream_file.xml > $tmpfile.2
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $stream_params --stream $tmpfile.2" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $stream_params --stream $tmpfile.2 >> $logfile 2>> $logfile
+printRes $res_fail $?
+
+printf "    Stream sign                                          "
+echo "$VALGRIND $xmlsec_app sign $xmlsec_params $stream_params --stream-template $stream_file.tmpl --output $tmpfile $stream_file-doc.xml" >> $logfile
+$VALGRIND $xmlsec_app sign $xmlsec_params $stream_params --stream-template $stream_file.tmpl --output $tmpfile $stream_file-doc.xml >> $logfile 2>> $logfile && \
+    cmp $tmpfile $stream_file.xml >> $logfile 2>> $logfile
+printRes $res_success $?
+
+printf "    Verify stream signature                              "
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $stream_params $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $stream_params $tmpfile >> $logfile 2>> $logfile
+printRes $res_success $?
+
+printf "    Verify tampered stream signature                     "
+sed 's/text \&amp;/Text \&amp;/' $tmpfile > $tmpfile.2
+echo "$VALGRIND $xmlsec_app verify $xmlsec_params $stream_params $tmpfile.2" >> $logfile
+$VALGRIND $xmlsec_app verify $xmlsec_params $stream_params $tmpfile.2 >> $logfile 2>> $logfile
+printRes $res_fail $?
+rm -f $tmpfile $tmpfile.2 $tmpfile.3
+fi
+
+##########################################################################
+#
+# test the xmlsec C14N serializer against the libxml2 one: both must
+# produce exactly the same pre-digest and pre-signed data
+#
+##########################################################################
+execC14NDiffTest() {
+    folder="$1"
+    file="$2"
+    params="$3"
+
+    printf "    %-52s " "$file"
+    echo "C14N diff test: $folder/$file.xml" >> $logfile
+    old_pwd=`pwd`
+    cd $topfolder/$folder
+    c14n_diff_res=1
+    for c14n_mode in "xmlsec" "libxml2" ; do
+        c14n_params="$params --store-signatures --store-references"
+        if [ "$c14n_mode" = "libxml2" ] ; then
+            c14n_params="$c14n_params --libxml2-c14n"
+        fi
+        echo "$VALGRIND $xmlsec_app verify $xmlsec_params $c14n_params $file.xml" >> $logfile
+        $VALGRIND $xmlsec_app verify $xmlsec_params $c14n_params $file.xml 2>> $logfile | \
+            sed -n '/== Pre\(Digest\|Signed\) data - start buffer:/,/== Pre\(Digest\|Signed\) data - end buffer/p' > $tmpfile.$c14n_mode
+    done
+    cd $old_pwd
+    if [ -s $tmpfile.xmlsec ] && cmp $tmpfile.xmlsec $tmpfile.libxml2 >> $logfile 2>> $logfile ; then
+        c14n_diff_res=0
+    fi
+    rm -f $tmpfile.xmlsec $tmpfile.libxml2
+    printRes $res_success $c14n_diff_res
+}
+
+if [ -z "$XMLSEC_TEST_NAME" -o "$XMLSEC_TEST_NAME" = "c14n-libxml2-diff" ] && $xmlsec_app check-transforms c14n c14n11 exc-c14n xpath xpointer >> $logfile 2>> $logfile ; then
+echo "Test: c14n-libxml2-diff"
+if $xmlsec_app check-transforms hmac-sha1 >> $logfile 2>> $logfile ; then
+    execC14NDiffTest "aleksey-xmldsig-01" "c14n-edge-cases-hmac" "--hmackey:mykey $topfolder/keys/hmackey.bin"
+    execC14NDiffTest "aleksey-xmldsig-01" "xpointer-hmac" "--lax-key-search --hmackey $topfolder/keys/hmackey.bin"
+    execC14NDiffTest "xmldsig2ed-tests" "defCan-1" "--lax-key-search --hmackey $topfolder/keys/hmackey.bin"
+    for n in 1 2 3 4 5 6 ; do
+        execC14NDiffTest "xmldsig2ed-tests" "xpointer-$n-SUN" "--lax-key-search --hmackey $topfolder/keys/hmackey.bin"
+    done
+
+    printf "    Sign with xmlsec C14N, verify with libxml2 C14N      "
+    echo "$VALGRIND $xmlsec_app sign $xmlsec_params --hmackey:mykey $topfolder/keys/hmackey.bin --output $tmpfile $topfolder/aleksey-xmldsig-01/c14n-edge-cases-hmac.tmpl" >> $logfile
+    $VALGRIND $xmlsec_app sign $xmlsec_params --hmackey:mykey $topfolder/keys/hmackey.bin --output $tmpfile $topfolder/aleksey-xmldsig-01/c14n-edge-cases-hmac.tmpl >> $logfile 2>> $logfile && \
+        $VALGRIND $xmlsec_app verify $xmlsec_params --hmackey:mykey $topfolder/keys/hmackey.bin --libxml2-c14n $tmpfile >> $logfile 2>> $logfile
+    printRes $res_success $?
+
+    printf "    Sign with libxml2 C14N, verify with xmlsec C14N      "
+    echo "$VALGRIND $xmlsec_app sign $xmlsec_params --hmackey:mykey $topfolder/keys/hmackey.bin --libxml2-c14n --output $tmpfile $topfolder/aleksey-xmldsig-01/c14n-edge-cases-hmac.tmpl" >> $logfile
+    $VALGRIND $xmlsec_app sign $xmlsec_params --hmackey:mykey $topfolder/keys/hmackey.bin --libxml2-c14n --output $tmpfile $topfolder/aleksey-xmldsig-01/c14n-edge-cases-hmac.tmpl >> $logfile 2>> $logfile && \
+        $VALGRIND $xmlsec_app verify $xmlsec_params --hmackey:mykey $topfolder/keys/hmackey.bin $tmpfile >> $logfile 2>> $logfile
+    printRes $res_success $?
+    rm -f $tmpfile
+fi
+if $xmlsec_app check-transforms dsa-sha1 >> $logfile 2>> $logfile ; then
+    execC14NDiffTest "merlin-c14n-three" "signature" " "
+    execC14NDiffTest "merlin-exc-c14n-one" "exc-signature" " "
+    execC14NDiffTest "merlin-xpath-filter2-three" "sign-spec" " "
+fi
+fi
+
+##########################################################################
+#
+# the C14N output is streamed to the next transform: the C14N transforms
+# output buffers (see "--transform-stats") should never grow
+#
+##########################################################################
+execC14NStreamTest() {
+    cmd="$1"
+    params="$2"
+    file="$3"
+
+    echo "$VALGRIND $xmlsec_app $cmd $xmlsec_params $params --transform-stats --print-debug --output $tmpfile $file" >> $logfile
+    $VALGRIND $xmlsec_app $cmd $xmlsec_params $params --transform-stats --print-debug --output $tmpfile $file 2>> $logfile | \
+        awk '/^=== Transform: / { c14n = ($3 ~ /c14n/) }
+             c14n && /^==== out buffer max size:/ { ++count; if($NF != 0) { grown = 1 } }
+             END { exit(((count == 0) || (grown != 0)) ? 1 : 0) }' >> $logfile 2>> $logfile
+    printRes $res_success $?
+}
+
+if [ -z "$XMLSEC_TEST_NAME" -o "$XMLSEC_TEST_NAME" = "c14n-stream" ] && $xmlsec_app check-transforms enveloped-signature c14n c14n11 exc-c14n xpath xpointer hmac-sha1 >> $logfile 2>> $logfile ; then
+echo "Test: c14n-stream"
+printf "    Sign with xmlsec C14N                                "
+execC14NStreamTest "sign" "--hmackey:mykey $topfolder/keys/hmackey.bin" "$topfolder/aleksey-xmldsig-01/c14n-edge-cases-hmac.tmpl"
+printf "    Verify with xmlsec C14N                              "
+execC14NStreamTest "verify" "--hmackey:mykey $topfolder/keys/hmackey.bin" "$topfolder/aleksey-xmldsig-01/c14n-edge-cases-hmac.xml"
+printf "    Verify with libxml2 C14N                             "
+execC14NStreamTest "verify" "--hmackey:mykey $topfolder/keys/hmackey.bin --libxml2-c14n" "$topfolder/aleksey-xmldsig-01/c14n-edge-cases-hmac.xml"
+rm -f $tmpfile
+fi
+
 
 
 ##########################################################################
@@ -1194,6 +1194,60 @@ printRes $res_success $?
 fi
 
 
+##########################################################################
+#
+# test deflate compression: the decrypted data must match the original one
+# and the decompressed size limit must be enforced
+#
+##########################################################################
+deflate_file="$topfolder/aleksey-xmlenc-01/enc-aes128cbc-keyname"
+if [ -z "$XMLSEC_TEST_NAME" -o "$XMLSEC_TEST_NAME" = "enc-deflate" ] && $xmlsec_app check-transforms deflate aes128-cbc >> $logfile 2>> $logfile ; then
+echo "Test: enc-deflate"
+rm -f $tmpfile.data
+for i in 1 2 3 4 5 6 7 8 9 10 ; do
+    for j in 1 2 3 4 5 6 7 8 9 10 ; do
+        cat $deflate_file.data $deflate_file.data $deflate_file.data $deflate_file.data >> $tmpfile.data
+    done
+done
+deflate_size=`wc -c < $tmpfile.data`
+
+printf "    Decrypt compressed data                              "
+echo "$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $topfolder/keys/keys.xml --compress-deflate --output $tmpfile.out $deflate_file-deflate.xml" >> $logfile
+$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $topfolder/keys/keys.xml --compress-deflate --output $tmpfile.out $deflate_file-deflate.xml >> $logfile 2>> $logfile && \
+    cmp $tmpfile.out $deflate_file.data >> $logfile 2>> $logfile
+printRes $res_success $?
+
+printf "    Compress and encrypt data                            "
+echo "$VALGRIND $xmlsec_app encrypt $xmlsec_params --keys-file $keysfile --compress-deflate --binary-data $tmpfile.data --output $tmpfile $deflate_file.tmpl" >> $logfile
+$VALGRIND $xmlsec_app encrypt $xmlsec_params --keys-file $keysfile --compress-deflate --binary-data $tmpfile.data --output $tmpfile $deflate_file.tmpl >> $logfile 2>> $logfile
+printRes $res_success $?
+
+printf "    Decrypt and decompress data                          "
+echo "$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $keysfile --compress-deflate --output $tmpfile.out $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $keysfile --compress-deflate --output $tmpfile.out $tmpfile >> $logfile 2>> $logfile && \
+    cmp $tmpfile.out $tmpfile.data >> $logfile 2>> $logfile
+printRes $res_success $?
+
+printf "    Decrypt without decompression                        "
+echo "$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $keysfile --output $tmpfile.out $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $keysfile --output $tmpfile.out $tmpfile >> $logfile 2>> $logfile && \
+    test `wc -c < $tmpfile.out` -lt $deflate_size
+printRes $res_success $?
+
+printf "    Decompress up to the max decompressed size           "
+echo "$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $keysfile --compress-deflate --max-decompressed-size $deflate_size --output $tmpfile.out $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $keysfile --compress-deflate --max-decompressed-size $deflate_size --output $tmpfile.out $tmpfile >> $logfile 2>> $logfile && \
+    cmp $tmpfile.out $tmpfile.data >> $logfile 2>> $logfile
+printRes $res_success $?
+
+printf "    Decompress over the max decompressed size            "
+echo "$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $keysfile --compress-deflate --max-decompressed-size `expr $deflate_size - 1` --output $tmpfile.out $tmpfile" >> $logfile
+$VALGRIND $xmlsec_app decrypt $xmlsec_params --keys-file $keysfile --compress-deflate --max-decompressed-size `expr $deflate_size - 1` --output $tmpfile.out $tmpfile >> $logfile 2>> $logfile
+printRes $res_fail $?
+rm -f $tmpfile $tmpfile.data $tmpfile.out
+fi
+
+
 ##########################################################################
 ##########################################################################
 ##########################################################################
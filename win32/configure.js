@@ -49,6 +49,7 @@ var withNss = 0;
 var withMSCrypto = 0;
 var withMSCng = 0;
 var withLibXSLT = 1;
+var withZlib = 0;
 var withIconv = 1;
 var withSizeT = 1;
 var withLegacyCrypto = 0;
@@ -118,6 +119,7 @@ function usage()
 	txt += "              \"openssl-110\", \"openssl=300\", \"openssl-300\",\n";
 	txt += "              \"nss\", \"mscrypto\", \"mscng\" (\"" + withCrypto + "\");\n"
  	txt += "  xslt:       LibXSLT is used (" + (withLibXSLT? "yes" : "no")  + ")\n";
+ 	txt += "  zlib:       Zlib is used for the deflate transform (" + (withZlib? "yes" : "no")  + ")\n";
  	txt += "  iconv:      Use the iconv library (" + (withIconv? "yes" : "no")  + ")\n";
 	txt += "  size_t:     Use the size_t (" + (withSizeT ? "yes" : "no") + ")\n";
 	txt += "  legacy - crypto:  Use the size_t (" + (withLegacyCrypto ? "yes" : "no") + ")\n";
@@ -192,6 +194,7 @@ function discoverVersion()
 	vf.WriteLine("WITH_MSCRYPTO=" + withMSCrypto);
 	vf.WriteLine("WITH_MSCNG=" + withMSCng);
 	vf.WriteLine("WITH_LIBXSLT=" + (withLibXSLT ? "1" : "0"));
+	vf.WriteLine("WITH_ZLIB=" + (withZlib ? "1" : "0"));
 	vf.WriteLine("WITH_ICONV=" + (withIconv ? "1" : "0"));
 	vf.WriteLine("WITH_SIZE_T=" + (withSizeT ? "1" : "0"));
 	vf.WriteLine("WITH_LEGACY_CRYPTO=" + (withLegacyCrypto ? "1" : "0"));
@@ -328,6 +331,8 @@ for (i = 0; (i < WScript.Arguments.length) && (error == 0); i++) {
 			withCrypto = arg.substring(opt.length + 1, arg.length);
 		else if (opt == "xslt")
 			withLibXSLT = strToBool(arg.substring(opt.length + 1, arg.length));
+		else if (opt == "zlib")
+			withZlib = strToBool(arg.substring(opt.length + 1, arg.length));
 		else if (opt == "iconv")
 			withIconv = strToBool(arg.substring(opt.length + 1, arg.length));
 		else if (opt == "size_t")
@@ -477,6 +482,7 @@ txtOut += "            Use NSS: " + boolToStr(withNss) + "\n";
 txtOut += "       Use MSCrypto: " + boolToStr(withMSCrypto) + "\n";
 txtOut += "          Use MSCng: " + boolToStr(withMSCng) + "\n";
 txtOut += "        Use LibXSLT: " + boolToStr(withLibXSLT) + "\n";
+txtOut += "           Use Zlib: " + boolToStr(withZlib) + "\n";
 txtOut += "          Use iconv: " + boolToStr(withIconv) + "\n";
 txtOut += "         Use size_t: " + boolToStr(withSizeT) + "\n";
 txtOut += "  Use legacy crypto: " + boolToStr(withLegacyCrypto) + "\n";